@@ -0,0 +1,158 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-arena.h"
+
+/* first allocation in a chunk starts after the aligned chunk header */
+#define STRESS_ARENA_HDR	\
+	((sizeof(stress_arena_chunk_t) + STRESS_ARENA_ALIGN - 1) & ~(size_t)(STRESS_ARENA_ALIGN - 1))
+
+/*
+ *  stress_arena_use()
+ *	make chunk the current chunk to allocate from
+ */
+static inline void stress_arena_use(stress_arena_t *arena, stress_arena_chunk_t *chunk)
+{
+	arena->cur = chunk;
+	arena->ptr = (uint8_t *)chunk + STRESS_ARENA_HDR;
+	arena->end = (uint8_t *)chunk + chunk->size;
+}
+
+/*
+ *  stress_arena_init()
+ *	initialize an empty arena, chunks are mapped on demand
+ */
+void stress_arena_init(stress_arena_t *arena, const size_t chunk_size)
+{
+	const size_t page_size = stress_get_page_size();
+
+	(void)memset(arena, 0, sizeof(*arena));
+	arena->chunk_size = chunk_size ? chunk_size : STRESS_ARENA_CHUNK;
+	arena->chunk_size = (arena->chunk_size + page_size - 1) & ~(page_size - 1);
+}
+
+/*
+ *  stress_arena_alloc_slow()
+ *	current chunk is full, move to the next chunk that was
+ *	kept from before a reset or map a new one; size is
+ *	already aligned
+ */
+void *stress_arena_alloc_slow(stress_arena_t *arena, const size_t size)
+{
+	const size_t page_size = stress_get_page_size();
+	stress_arena_chunk_t *chunk, *prev = arena->cur;
+	size_t chunk_size;
+	void *ptr;
+
+	for (chunk = prev ? prev->next : arena->head; chunk; prev = chunk, chunk = chunk->next) {
+		if ((chunk->size - STRESS_ARENA_HDR) >= size)
+			goto found;
+	}
+
+	chunk_size = STRESS_ARENA_HDR + size;
+	chunk_size = (chunk_size < arena->chunk_size) ? arena->chunk_size :
+		(chunk_size + page_size - 1) & ~(page_size - 1);
+	chunk = (stress_arena_chunk_t *)mmap(NULL, chunk_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (chunk == MAP_FAILED)
+		return NULL;
+	chunk->next = NULL;
+	chunk->size = chunk_size;
+	arena->mapped += chunk_size;
+	if (prev)
+		prev->next = chunk;
+	else
+		arena->head = chunk;
+found:
+	/* chunks skipped over stay at the end of the list for after a reset */
+	stress_arena_use(arena, chunk);
+	ptr = (void *)arena->ptr;
+	arena->ptr += size;
+	arena->used += size;
+
+	return ptr;
+}
+
+/*
+ *  stress_arena_reset()
+ *	release all allocations in one go, the chunks are kept
+ *	mapped for reuse
+ */
+void stress_arena_reset(stress_arena_t *arena)
+{
+	arena->used = 0;
+	if (arena->head) {
+		stress_arena_use(arena, arena->head);
+	} else {
+		arena->cur = NULL;
+		arena->ptr = NULL;
+		arena->end = NULL;
+	}
+}
+
+/*
+ *  stress_arena_destroy()
+ *	unmap all the arena chunks
+ */
+void stress_arena_destroy(stress_arena_t *arena)
+{
+	stress_arena_chunk_t *chunk = arena->head;
+
+	while (chunk) {
+		stress_arena_chunk_t *next = chunk->next;
+
+		(void)munmap((void *)chunk, chunk->size);
+		chunk = next;
+	}
+	stress_arena_init(arena, arena->chunk_size);
+}
+
+/*
+ *  stress_slab_init()
+ *	initialize a slab of obj_size objects, objects are at least
+ *	large enough to hold the free list link
+ */
+void stress_slab_init(stress_slab_t *slab, const size_t obj_size, const size_t chunk_size)
+{
+	const size_t sz = (obj_size < sizeof(void *)) ? sizeof(void *) : obj_size;
+
+	stress_arena_init(&slab->arena, chunk_size);
+	slab->free_list = NULL;
+	slab->obj_size = (sz + STRESS_ARENA_ALIGN - 1) & ~(size_t)(STRESS_ARENA_ALIGN - 1);
+}
+
+/*
+ *  stress_slab_reset()
+ *	free all objects in the slab in one go
+ */
+void stress_slab_reset(stress_slab_t *slab)
+{
+	slab->free_list = NULL;
+	stress_arena_reset(&slab->arena);
+}
+
+/*
+ *  stress_slab_destroy()
+ *	unmap all the slab memory
+ */
+void stress_slab_destroy(stress_slab_t *slab)
+{
+	slab->free_list = NULL;
+	stress_arena_destroy(&slab->arena);
+}
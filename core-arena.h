@@ -0,0 +1,129 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_ARENA_H
+#define CORE_ARENA_H
+
+#define STRESS_ARENA_ALIGN	(16)		/* allocation alignment */
+#define STRESS_ARENA_CHUNK	(1 * MB)	/* default chunk mapping size */
+
+/* mmap'd chunk, the chunk header is at the start of the mapping */
+typedef struct stress_arena_chunk {
+	struct stress_arena_chunk *next;	/* next chunk */
+	size_t	size;				/* size of the mapping */
+} stress_arena_chunk_t;
+
+/* Bump pointer arena, allocations are only released by a bulk reset */
+typedef struct {
+	stress_arena_chunk_t *head;	/* first chunk */
+	stress_arena_chunk_t *cur;	/* chunk being allocated from */
+	uint8_t	*ptr;			/* next free byte in cur */
+	uint8_t	*end;			/* end of cur */
+	size_t	chunk_size;		/* size of new chunk mappings */
+	size_t	used;			/* bytes allocated since reset */
+	size_t	mapped;			/* bytes mapped in all chunks */
+} stress_arena_t;
+
+/* Fixed size object slab, backed by an arena, with a free list */
+typedef struct {
+	stress_arena_t arena;		/* object backing store */
+	void	*free_list;		/* free'd objects */
+	size_t	obj_size;		/* object size, arena aligned */
+} stress_slab_t;
+
+extern void stress_arena_init(stress_arena_t *arena, const size_t chunk_size);
+extern void *stress_arena_alloc_slow(stress_arena_t *arena, const size_t size);
+extern void stress_arena_reset(stress_arena_t *arena);
+extern void stress_arena_destroy(stress_arena_t *arena);
+
+extern void stress_slab_init(stress_slab_t *slab, const size_t obj_size,
+	const size_t chunk_size);
+extern void stress_slab_reset(stress_slab_t *slab);
+extern void stress_slab_destroy(stress_slab_t *slab);
+
+/*
+ *  stress_arena_alloc()
+ *	bump allocate size bytes, NULL if out of memory
+ */
+static inline void *stress_arena_alloc(stress_arena_t *arena, const size_t size)
+{
+	const size_t sz = (size + STRESS_ARENA_ALIGN - 1) & ~(size_t)(STRESS_ARENA_ALIGN - 1);
+
+	if (LIKELY((size_t)(arena->end - arena->ptr) >= sz)) {
+		void *ptr = (void *)arena->ptr;
+
+		arena->ptr += sz;
+		arena->used += sz;
+		return ptr;
+	}
+	return stress_arena_alloc_slow(arena, sz);
+}
+
+/*
+ *  stress_arena_calloc()
+ *	bump allocate size zero'd bytes, NULL if out of memory
+ */
+static inline void *stress_arena_calloc(stress_arena_t *arena, const size_t size)
+{
+	void *ptr = stress_arena_alloc(arena, size);
+
+	if (LIKELY(ptr != NULL))
+		(void)memset(ptr, 0, size);
+	return ptr;
+}
+
+/*
+ *  stress_slab_alloc()
+ *	allocate a zero'd object from the slab, NULL if out of memory
+ */
+static inline void *stress_slab_alloc(stress_slab_t *slab)
+{
+	void *ptr = slab->free_list;
+
+	if (ptr) {
+		slab->free_list = *(void **)ptr;
+		(void)memset(ptr, 0, slab->obj_size);
+		return ptr;
+	}
+	return stress_arena_calloc(&slab->arena, slab->obj_size);
+}
+
+/*
+ *  stress_slab_free()
+ *	return an object to the slab free list
+ */
+static inline void stress_slab_free(stress_slab_t *slab, void *ptr)
+{
+	if (UNLIKELY(!ptr))
+		return;
+	*(void **)ptr = slab->free_list;
+	slab->free_list = ptr;
+}
+
+/*
+ *  stress_node_arena()
+ *	true if --node-alloc arena is selected, stressors that
+ *	allocate data structure nodes in their timed loops use
+ *	arenas and slabs rather than the libc allocator
+ */
+static inline bool stress_node_arena(void)
+{
+	return !!(g_opt_flags & OPT_FLAGS_NODE_ARENA);
+}
+
+#endif
@@ -88,4 +88,25 @@ static inline uint8_t stress_reverse8(register uint8_t x)
 #endif
 }
 
+/*
+ *  stress_msb64
+ *	index of the most significant set bit of x, x must be non-zero
+ */
+static inline unsigned int stress_msb64(register uint64_t x)
+{
+#if defined(HAVE_BUILTIN_CLZLL)
+	return 63U - (unsigned int)__builtin_clzll((unsigned long long)x);
+#else
+	register unsigned int n = 0;
+
+	if (x & 0xffffffff00000000ULL) { x >>= 32; n += 32; }
+	if (x & 0x00000000ffff0000ULL) { x >>= 16; n += 16; }
+	if (x & 0x000000000000ff00ULL) { x >>= 8;  n += 8; }
+	if (x & 0x00000000000000f0ULL) { x >>= 4;  n += 4; }
+	if (x & 0x000000000000000cULL) { x >>= 2;  n += 2; }
+	if (x & 0x0000000000000002ULL) { n += 1; }
+	return n;
+#endif
+}
+
 #endif
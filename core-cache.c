@@ -311,6 +311,75 @@ stress_cpu_cache_t *stress_get_cpu_cache(const stress_cpus_t *cpus, const uint16
 	return stress_get_cache_by_cpu(cpu, cache_level);
 }
 
+/*
+ * stress_get_cpu_cache_by_cpu()
+ * @cpus: array of cpus to query.
+ * @cpu_num: cpu number to query.
+ * @cache_level: numeric cache level (1-indexed).
+ * Obtain the cache of level @cache_level of a specific cpu,
+ * hybrid (big/little) and chiplet processors may have
+ * different caches on different cpus.
+ *
+ * Returns: stress_cpu_cache_t pointer, or NULL on error.
+ */
+stress_cpu_cache_t *stress_get_cpu_cache_by_cpu(
+	const stress_cpus_t *cpus,
+	const uint32_t cpu_num,
+	const uint16_t cache_level)
+{
+	const stress_cpu_t *cpu;
+
+	if (!cpus || (cpu_num >= cpus->count))
+		return NULL;
+
+	cpu = &cpus->cpus[cpu_num];
+	if (!cpu->online)
+		return NULL;
+
+	return stress_get_cache_by_cpu(cpu, cache_level);
+}
+
+/*
+ * stress_get_cpu_cache_affinity()
+ * @cpus: array of cpus to query.
+ * @cache_level: numeric cache level (1-indexed).
+ * Obtain the largest cache of level @cache_level of the cpus
+ * the caller is allowed to run on. For a process pinned to a
+ * single cpu this is the cache of that cpu. Falls back to the
+ * cache of the current cpu if the affinity cannot be determined.
+ *
+ * Returns: stress_cpu_cache_t pointer, or NULL on error.
+ */
+stress_cpu_cache_t *stress_get_cpu_cache_affinity(
+	const stress_cpus_t *cpus,
+	const uint16_t cache_level)
+{
+#if defined(HAVE_SCHED_GETAFFINITY)
+	cpu_set_t mask;
+	stress_cpu_cache_t *max_cache = NULL;
+	uint32_t i;
+
+	if (!cpus || !cache_level)
+		return NULL;
+
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0)
+		return stress_get_cpu_cache(cpus, cache_level);
+
+	for (i = 0; i < cpus->count; i++) {
+		stress_cpu_cache_t *cache;
+
+		if (!CPU_ISSET((int)i, &mask))
+			continue;
+		cache = stress_get_cpu_cache_by_cpu(cpus, i, cache_level);
+		if (cache && (!max_cache || (cache->size > max_cache->size)))
+			max_cache = cache;
+	}
+	return max_cache ? max_cache : stress_get_cpu_cache(cpus, cache_level);
+#else
+	return stress_get_cpu_cache(cpus, cache_level);
+#endif
+}
+
 #if defined(STRESS_ARCH_SPARC)
 static int stress_get_cpu_cache_value(
 	const char *cpu_path,
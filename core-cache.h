@@ -59,6 +59,10 @@ extern stress_cpus_t *stress_get_all_cpu_cache_details(void);
 extern uint16_t stress_get_max_cache_level(const stress_cpus_t *cpus);
 extern stress_cpu_cache_t *stress_get_cpu_cache(const stress_cpus_t *cpus,
 	const uint16_t cache_level);
+extern stress_cpu_cache_t *stress_get_cpu_cache_by_cpu(const stress_cpus_t *cpus,
+	const uint32_t cpu_num, const uint16_t cache_level);
+extern stress_cpu_cache_t *stress_get_cpu_cache_affinity(const stress_cpus_t *cpus,
+	const uint16_t cache_level);
 extern void stress_free_cpu_caches(stress_cpus_t *cpus);
 
 /*
@@ -0,0 +1,616 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-cgroup.h"
+
+#define CGROUP_MODE_NONE	(0)
+#define CGROUP_MODE_STRESSOR	(1)	/* one group per stressor */
+#define CGROUP_MODE_CLASS	(2)	/* one group per stressor class */
+
+#define CGROUP_LIMIT_CPU_MAX	(0)
+#define CGROUP_LIMIT_CPUS	(1)
+#define CGROUP_LIMIT_MEMS	(2)
+#define CGROUP_LIMIT_MEM_HIGH	(3)
+#define CGROUP_LIMIT_MEM_MAX	(4)
+#define CGROUP_LIMIT_IO_MAX	(5)
+#define CGROUP_LIMIT_MAX	(6)
+
+#define CGROUP_STAT_SUM		(0)	/* accumulate over runs */
+#define CGROUP_STAT_PEAK	(1)	/* maximum over runs */
+
+/* a per group resource limit */
+typedef struct {
+	const char *file;		/* cgroup interface file */
+	const char *controller;		/* controller that provides the file */
+} stress_cgroup_limit_info_t;
+
+/* a reported per group statistic */
+typedef struct {
+	const char *file;		/* cgroup interface file */
+	const char *key;		/* key in the file, NULL = single value file */
+	const char *label;		/* report label */
+	int type;			/* CGROUP_STAT_SUM or CGROUP_STAT_PEAK */
+} stress_cgroup_stat_info_t;
+
+static const stress_cgroup_limit_info_t cgroup_limits[CGROUP_LIMIT_MAX] = {
+	{ "cpu.max",		"cpu" },
+	{ "cpuset.cpus",	"cpuset" },
+	{ "cpuset.mems",	"cpuset" },
+	{ "memory.high",	"memory" },
+	{ "memory.max",		"memory" },
+	{ "io.max",		"io" },
+};
+
+static const stress_cgroup_stat_info_t cgroup_stats[] = {
+	{ "cpu.stat",		"usage_usec",	"cpu-usage-usec",	CGROUP_STAT_SUM },
+	{ "cpu.stat",		"user_usec",	"cpu-user-usec",	CGROUP_STAT_SUM },
+	{ "cpu.stat",		"system_usec",	"cpu-system-usec",	CGROUP_STAT_SUM },
+	{ "cpu.stat",		"nr_periods",	"cpu-periods",		CGROUP_STAT_SUM },
+	{ "cpu.stat",		"nr_throttled",	"cpu-throttled-periods", CGROUP_STAT_SUM },
+	{ "cpu.stat",		"throttled_usec", "cpu-throttled-usec",	CGROUP_STAT_SUM },
+	{ "memory.peak",	NULL,		"memory-peak-bytes",	CGROUP_STAT_PEAK },
+	{ "memory.stat",	"pgfault",	"memory-page-faults",	CGROUP_STAT_SUM },
+	{ "memory.stat",	"pgmajfault",	"memory-major-page-faults", CGROUP_STAT_SUM },
+	{ "memory.events",	"high",		"memory-high-events",	CGROUP_STAT_SUM },
+	{ "memory.events",	"max",		"memory-max-events",	CGROUP_STAT_SUM },
+	{ "memory.events",	"oom",		"memory-oom-events",	CGROUP_STAT_SUM },
+	{ "memory.events",	"oom_kill",	"memory-oom-kills",	CGROUP_STAT_SUM },
+	{ "io.stat",		"rbytes",	"io-read-bytes",	CGROUP_STAT_SUM },
+	{ "io.stat",		"wbytes",	"io-write-bytes",	CGROUP_STAT_SUM },
+	{ "io.stat",		"rios",		"io-read-ios",		CGROUP_STAT_SUM },
+	{ "io.stat",		"wios",		"io-write-ios",		CGROUP_STAT_SUM },
+};
+
+#define CGROUP_STATS_MAX	(SIZEOF_ARRAY(cgroup_stats))
+
+/* a cgroup of one stressor or of one class of stressors */
+typedef struct {
+	char name[64];			/* group name */
+	char *path;			/* cgroup path, NULL when not created */
+	uint64_t stats[CGROUP_STATS_MAX]; /* accumulated statistics */
+	bool stats_valid[CGROUP_STATS_MAX]; /* statistic was read */
+} stress_cgroup_group_t;
+
+/* the group of a stressor */
+typedef struct {
+	const stress_stressor_t *ss;	/* stressor */
+	size_t group;			/* index into cgroup_groups */
+} stress_cgroup_map_t;
+
+static int cgroup_mode = CGROUP_MODE_NONE;
+static char *cgroup_limit[CGROUP_LIMIT_MAX];	/* limit values, NULL = unset */
+static char *cgroup_top;			/* stress-ng-$pid group */
+static stress_cgroup_group_t *cgroup_groups;
+static size_t cgroup_groups_n;
+static stress_cgroup_map_t *cgroup_map;
+static size_t cgroup_map_n;
+
+/*
+ *  stress_cgroup_enabled()
+ *	true if stressors are placed in cgroups, --psi-cgroup
+ *	implies per stressor groups
+ */
+static bool stress_cgroup_enabled(void)
+{
+	return (cgroup_mode != CGROUP_MODE_NONE) || (g_opt_flags & OPT_FLAGS_PSI_CGROUP);
+}
+
+/*
+ *  stress_set_cgroup()
+ *	set the --cgroup grouping, per stressor or per class
+ */
+int stress_set_cgroup(const char *const opt)
+{
+	if (!strcmp(opt, "stressor")) {
+		cgroup_mode = CGROUP_MODE_STRESSOR;
+	} else if (!strcmp(opt, "class")) {
+		cgroup_mode = CGROUP_MODE_CLASS;
+	} else {
+		(void)fprintf(stderr, "cgroup must be one of: stressor class\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_set_cgroup_limit()
+ *	save a limit value, setting a limit implies --cgroup stressor
+ */
+static int stress_set_cgroup_limit(const int limit, const char *value)
+{
+	free(cgroup_limit[limit]);
+	cgroup_limit[limit] = strdup(value);
+	if (!cgroup_limit[limit]) {
+		(void)fprintf(stderr, "Cannot allocate cgroup %s value\n", cgroup_limits[limit].file);
+		return -1;
+	}
+	if (cgroup_mode == CGROUP_MODE_NONE)
+		cgroup_mode = CGROUP_MODE_STRESSOR;
+	return 0;
+}
+
+/*
+ *  stress_set_cgroup_cpu_max()
+ *	set cpu.max, either the raw "quota period" / "max" value
+ *	or a number of CPUs, e.g. 0.5 for half of one CPU
+ */
+int stress_set_cgroup_cpu_max(const char *const opt)
+{
+	char buf[64];
+	double cpus;
+
+	if (strchr(opt, ' ') || !strcmp(opt, "max"))
+		return stress_set_cgroup_limit(CGROUP_LIMIT_CPU_MAX, opt);
+	if ((sscanf(opt, "%lf", &cpus) != 1) || (cpus < 0.01) || (cpus > 65536.0)) {
+		(void)fprintf(stderr, "cgroup-cpu-max must be a number of CPUs, "
+			"\"quota period\" in microseconds or \"max\".\n");
+		_exit(EXIT_FAILURE);
+	}
+	(void)snprintf(buf, sizeof(buf), "%.0f 100000", cpus * 100000.0);
+	return stress_set_cgroup_limit(CGROUP_LIMIT_CPU_MAX, buf);
+}
+
+int stress_set_cgroup_cpuset_cpus(const char *const opt)
+{
+	return stress_set_cgroup_limit(CGROUP_LIMIT_CPUS, opt);
+}
+
+int stress_set_cgroup_cpuset_mems(const char *const opt)
+{
+	return stress_set_cgroup_limit(CGROUP_LIMIT_MEMS, opt);
+}
+
+/*
+ *  stress_set_cgroup_memory()
+ *	memory limits are "max" or a size with an optional
+ *	b, k, m or g suffix
+ */
+static int stress_set_cgroup_memory(const int limit, const char *const opt)
+{
+	char buf[32];
+
+	if (!strcmp(opt, "max"))
+		return stress_set_cgroup_limit(limit, opt);
+	(void)snprintf(buf, sizeof(buf), "%" PRIu64, stress_get_uint64_byte(opt));
+	return stress_set_cgroup_limit(limit, buf);
+}
+
+int stress_set_cgroup_memory_high(const char *const opt)
+{
+	return stress_set_cgroup_memory(CGROUP_LIMIT_MEM_HIGH, opt);
+}
+
+int stress_set_cgroup_memory_max(const char *const opt)
+{
+	return stress_set_cgroup_memory(CGROUP_LIMIT_MEM_MAX, opt);
+}
+
+int stress_set_cgroup_io_max(const char *const opt)
+{
+	return stress_set_cgroup_limit(CGROUP_LIMIT_IO_MAX, opt);
+}
+
+/*
+ *  stress_cgroup_write()
+ *	write a string to a cgroup interface file
+ */
+int stress_cgroup_write(const char *dir, const char *file, const char *value)
+{
+	char path[PATH_MAX];
+	ssize_t ret;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "%s/%s", dir, file);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -1;
+	ret = write(fd, value, strlen(value));
+	(void)close(fd);
+	return (ret < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_cgroup_mount()
+ *	get the cgroup v2 mount point, it is /sys/fs/cgroup on
+ *	unified systems and /sys/fs/cgroup/unified on hybrid ones
+ */
+int stress_cgroup_mount(char *path, const size_t path_len)
+{
+	char buf[1024], dev[256], mnt[256], type[64];
+	FILE *fp;
+
+	fp = fopen("/proc/mounts", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if ((sscanf(buf, "%255s %255s %63s", dev, mnt, type) == 3) &&
+		    !strcmp(type, "cgroup2")) {
+			(void)fclose(fp);
+			(void)shim_strlcpy(path, mnt, path_len);
+			return 0;
+		}
+	}
+	(void)fclose(fp);
+	return -1;
+}
+
+/*
+ *  stress_cgroup_own()
+ *	get the cgroup v2 directory of the stress-ng process
+ */
+static int stress_cgroup_own(char *path, const size_t path_len)
+{
+	char buf[1024], mnt[256];
+	char *own = NULL;
+	FILE *fp;
+
+	if (stress_cgroup_mount(mnt, sizeof(mnt)) < 0)
+		return -1;
+
+	/* the cgroup v2 entry is the "0::/path" line */
+	fp = fopen("/proc/self/cgroup", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (!strncmp(buf, "0::", 3)) {
+			char *ptr = strchr(buf, '\n');
+
+			if (ptr)
+				*ptr = '\0';
+			own = buf + 3;
+			break;
+		}
+	}
+	(void)fclose(fp);
+	if (!own)
+		return -1;
+	(void)snprintf(path, path_len, "%s%s", mnt, strcmp(own, "/") ? own : "");
+	return 0;
+}
+
+/*
+ *  stress_cgroup_controllers()
+ *	enable the controllers needed by the limits in the
+ *	subtree of dir, returns the controllers that failed
+ */
+static void stress_cgroup_controllers(const char *dir, char *failed, const size_t failed_len)
+{
+	size_t i;
+
+	*failed = '\0';
+	for (i = 0; i < CGROUP_LIMIT_MAX; i++) {
+		char value[32];
+
+		if (!cgroup_limit[i])
+			continue;
+		(void)snprintf(value, sizeof(value), "+%s", cgroup_limits[i].controller);
+		if ((stress_cgroup_write(dir, "cgroup.subtree_control", value) < 0) &&
+		    !strstr(failed, cgroup_limits[i].controller)) {
+			(void)shim_strlcat(failed, " ", failed_len);
+			(void)shim_strlcat(failed, cgroup_limits[i].controller, failed_len);
+		}
+	}
+}
+
+/*
+ *  stress_cgroup_top()
+ *	create the stress-ng-$pid group that holds the per stressor
+ *	groups; it has no processes of its own so controllers can
+ *	be enabled for its children
+ */
+static int stress_cgroup_top(void)
+{
+	char own[PATH_MAX / 2], path[PATH_MAX], failed[64];
+
+	if (cgroup_top)
+		return 0;
+	if (stress_cgroup_own(own, sizeof(own)) < 0) {
+		pr_inf("cgroup: no cgroup v2 mount found, stressors are not placed in cgroups\n");
+		return -1;
+	}
+	(void)snprintf(path, sizeof(path), "%s/stress-ng-%d", own, (int)getpid());
+	if ((mkdir(path, S_IRWXU) < 0) && (errno != EEXIST)) {
+		pr_inf("cgroup: cannot create cgroup %s, errno=%d (%s), "
+			"stressors are not placed in cgroups\n", path, errno, strerror(errno));
+		return -1;
+	}
+	cgroup_top = strdup(path);
+	if (!cgroup_top) {
+		(void)rmdir(path);
+		return -1;
+	}
+
+	stress_cgroup_controllers(own, failed, sizeof(failed));
+	if (!*failed)
+		stress_cgroup_controllers(cgroup_top, failed, sizeof(failed));
+	if (*failed)
+		pr_inf("cgroup: cannot enable the%s controller(s) in %s, the cgroup "
+			"containing stress-ng may have processes or not delegate them, "
+			"limits of these controllers will not be applied\n", failed, own);
+	return 0;
+}
+
+/*
+ *  stress_cgroup_group_name()
+ *	name of the group a stressor is placed in
+ */
+static void stress_cgroup_group_name(const stress_stressor_t *ss, char *name, const size_t name_len)
+{
+	if (cgroup_mode == CGROUP_MODE_CLASS)
+		(void)snprintf(name, name_len, "class-%s", stress_get_class_name(ss->stressor->info->class));
+	else
+		(void)shim_strlcpy(name, stress_munge_underscore(ss->stressor->name), name_len);
+}
+
+/*
+ *  stress_cgroup_find()
+ *	find or add the group of a stressor
+ */
+static stress_cgroup_group_t *stress_cgroup_find(const stress_stressor_t *ss, const bool add)
+{
+	stress_cgroup_map_t *map;
+	stress_cgroup_group_t *group;
+	char name[64];
+	size_t i;
+
+	for (i = 0; i < cgroup_map_n; i++) {
+		if (cgroup_map[i].ss == ss)
+			return &cgroup_groups[cgroup_map[i].group];
+	}
+	if (!add)
+		return NULL;
+
+	stress_cgroup_group_name(ss, name, sizeof(name));
+	for (i = 0; i < cgroup_groups_n; i++) {
+		if (!strcmp(cgroup_groups[i].name, name))
+			break;
+	}
+	if (i == cgroup_groups_n) {
+		group = realloc(cgroup_groups, (cgroup_groups_n + 1) * sizeof(*cgroup_groups));
+		if (!group)
+			return NULL;
+		cgroup_groups = group;
+		group = &cgroup_groups[cgroup_groups_n++];
+		(void)memset(group, 0, sizeof(*group));
+		(void)shim_strlcpy(group->name, name, sizeof(group->name));
+	}
+	map = realloc(cgroup_map, (cgroup_map_n + 1) * sizeof(*cgroup_map));
+	if (!map)
+		return NULL;
+	cgroup_map = map;
+	cgroup_map[cgroup_map_n].ss = ss;
+	cgroup_map[cgroup_map_n].group = i;
+	cgroup_map_n++;
+	return &cgroup_groups[i];
+}
+
+/*
+ *  stress_cgroup_start()
+ *	create the groups of the stressors in the list
+ *	and apply the limits
+ */
+void stress_cgroup_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!stress_cgroup_enabled() || (stress_cgroup_top() < 0))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_cgroup_group_t *group;
+		char path[PATH_MAX];
+		size_t i;
+
+		if (!ss->num_instances)
+			continue;
+		group = stress_cgroup_find(ss, true);
+		if (!group) {
+			pr_err("cgroup: cannot allocate cgroup state\n");
+			return;
+		}
+		if (group->path)
+			continue;
+		(void)snprintf(path, sizeof(path), "%s/%s", cgroup_top, group->name);
+		if ((mkdir(path, S_IRWXU) < 0) && (errno != EEXIST)) {
+			pr_inf("cgroup: cannot create cgroup %s, errno=%d (%s)\n",
+				path, errno, strerror(errno));
+			continue;
+		}
+		group->path = strdup(path);
+		if (!group->path) {
+			(void)rmdir(path);
+			continue;
+		}
+		for (i = 0; i < CGROUP_LIMIT_MAX; i++) {
+			if (cgroup_limit[i] &&
+			    (stress_cgroup_write(group->path, cgroup_limits[i].file, cgroup_limit[i]) < 0))
+				pr_inf("cgroup: cannot set %s to '%s' for %s, errno=%d (%s)\n",
+					cgroup_limits[i].file, cgroup_limit[i], group->name,
+					errno, strerror(errno));
+		}
+	}
+}
+
+/*
+ *  stress_cgroup_enter()
+ *	move the calling stressor instance into the group
+ *	of its stressor, called by the child after the fork
+ */
+void stress_cgroup_enter(const stress_stressor_t *ss)
+{
+	const stress_cgroup_group_t *group;
+	char pid[32];
+
+	if (!stress_cgroup_enabled())
+		return;
+	group = stress_cgroup_find(ss, false);
+	if (!group || !group->path)
+		return;
+	(void)snprintf(pid, sizeof(pid), "%d\n", (int)getpid());
+	if (stress_cgroup_write(group->path, "cgroup.procs", pid) < 0)
+		pr_dbg("cgroup: cannot move pid %d to %s, errno=%d (%s)\n",
+			(int)getpid(), group->path, errno, strerror(errno));
+}
+
+/*
+ *  stress_cgroup_path()
+ *	path of the group of a stressor, NULL if it has none
+ */
+const char *stress_cgroup_path(const stress_stressor_t *ss)
+{
+	const stress_cgroup_group_t *group;
+
+	if (!stress_cgroup_enabled())
+		return NULL;
+	group = stress_cgroup_find(ss, false);
+	return group ? group->path : NULL;
+}
+
+/*
+ *  stress_cgroup_read_stat()
+ *	read a statistic from a group, values of keys that occur
+ *	more than once, such as per device io.stat keys, are summed
+ */
+static bool stress_cgroup_read_stat(
+	const char *dir,
+	const stress_cgroup_stat_info_t *info,
+	uint64_t *value)
+{
+	char path[PATH_MAX], buf[4096];
+	const char *ptr;
+	bool found = false;
+	ssize_t len;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "%s/%s", dir, info->file);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	len = read(fd, buf, sizeof(buf) - 1);
+	(void)close(fd);
+	if (len <= 0)
+		return false;
+	buf[len] = '\0';
+
+	*value = 0;
+	if (!info->key) {
+		*value = (uint64_t)strtoull(buf, NULL, 10);
+		return true;
+	}
+	for (ptr = buf; (ptr = strstr(ptr, info->key)) != NULL; ptr++) {
+		const size_t key_len = strlen(info->key);
+		const char end = ptr[key_len];
+
+		/* whole keys only, "key value" and "key=value" forms */
+		if (((ptr != buf) && !isspace((int)ptr[-1])) ||
+		    ((end != ' ') && (end != '=')))
+			continue;
+		*value += (uint64_t)strtoull(ptr + key_len + 1, NULL, 10);
+		found = true;
+	}
+	return found;
+}
+
+/*
+ *  stress_cgroup_stop()
+ *	accumulate the statistics of the groups of the
+ *	stressors in the list and remove the groups
+ */
+void stress_cgroup_stop(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!stress_cgroup_enabled())
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_cgroup_group_t *group = stress_cgroup_find(ss, false);
+		size_t i;
+
+		if (!group || !group->path)
+			continue;
+		for (i = 0; i < CGROUP_STATS_MAX; i++) {
+			uint64_t value;
+
+			if (!stress_cgroup_read_stat(group->path, &cgroup_stats[i], &value))
+				continue;
+			if (cgroup_stats[i].type == CGROUP_STAT_PEAK)
+				group->stats[i] = STRESS_MAXIMUM(group->stats[i], value);
+			else
+				group->stats[i] += value;
+			group->stats_valid[i] = true;
+		}
+		if (rmdir(group->path) < 0)
+			pr_dbg("cgroup: cannot remove cgroup %s, errno=%d (%s)\n",
+				group->path, errno, strerror(errno));
+		free(group->path);
+		group->path = NULL;
+	}
+}
+
+/*
+ *  stress_cgroup_dump()
+ *	report the statistics of each group and remove the
+ *	top level stress-ng group
+ */
+void stress_cgroup_dump(FILE *yaml)
+{
+	size_t i, j;
+
+	if (!cgroup_groups_n)
+		goto free_top;
+
+	pr_inf("cgroup: cgroup v2 statistics of each %s group:\n",
+		(cgroup_mode == CGROUP_MODE_CLASS) ? "class" : "stressor");
+	pr_yaml(yaml, "cgroup:\n");
+	for (i = 0; i < CGROUP_LIMIT_MAX; i++) {
+		if (cgroup_limit[i])
+			pr_yaml(yaml, "    %s: %s\n", cgroup_limits[i].file, cgroup_limit[i]);
+	}
+	pr_yaml(yaml, "    groups:\n");
+	for (i = 0; i < cgroup_groups_n; i++) {
+		const stress_cgroup_group_t *group = &cgroup_groups[i];
+
+		pr_yaml(yaml, "      - group: %s\n", group->name);
+		for (j = 0; j < CGROUP_STATS_MAX; j++) {
+			if (!group->stats_valid[j])
+				continue;
+			pr_inf("%-20s %-26s %" PRIu64 "\n", group->name,
+				cgroup_stats[j].label, group->stats[j]);
+			pr_yaml(yaml, "        %s: %" PRIu64 "\n",
+				cgroup_stats[j].label, group->stats[j]);
+		}
+	}
+	pr_yaml(yaml, "\n");
+
+	free(cgroup_groups);
+	cgroup_groups = NULL;
+	cgroup_groups_n = 0;
+	free(cgroup_map);
+	cgroup_map = NULL;
+	cgroup_map_n = 0;
+free_top:
+	if (cgroup_top) {
+		if (rmdir(cgroup_top) < 0)
+			pr_dbg("cgroup: cannot remove cgroup %s, errno=%d (%s)\n",
+				cgroup_top, errno, strerror(errno));
+		free(cgroup_top);
+		cgroup_top = NULL;
+	}
+}
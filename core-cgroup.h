@@ -0,0 +1,38 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_CGROUP_H
+#define CORE_CGROUP_H
+
+/* cgroup v2 placement and limits, --cgroup */
+extern int stress_set_cgroup(const char *const opt);
+extern int stress_set_cgroup_cpu_max(const char *const opt);
+extern int stress_set_cgroup_cpuset_cpus(const char *const opt);
+extern int stress_set_cgroup_cpuset_mems(const char *const opt);
+extern int stress_set_cgroup_memory_high(const char *const opt);
+extern int stress_set_cgroup_memory_max(const char *const opt);
+extern int stress_set_cgroup_io_max(const char *const opt);
+extern void stress_cgroup_start(stress_stressor_t *stressors_list);
+extern void stress_cgroup_enter(const stress_stressor_t *ss);
+extern const char *stress_cgroup_path(const stress_stressor_t *ss);
+extern void stress_cgroup_stop(stress_stressor_t *stressors_list);
+extern void stress_cgroup_dump(FILE *yaml);
+extern int stress_cgroup_mount(char *path, const size_t path_len);
+extern int stress_cgroup_write(const char *dir, const char *file, const char *value);
+
+#endif
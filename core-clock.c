@@ -0,0 +1,216 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+#include "core-cpu.h"
+
+#define CLOCK_CALIBRATE_NS	(10000000ULL)	/* 10 ms calibration */
+#define CLOCK_OVERHEAD_LOOPS	(1024)		/* back to back reads */
+#define CLOCK_SKEW_MAX_NS	(1000ULL)	/* max cross CPU skew */
+
+stress_clock_t g_clock = {
+	STRESS_CLOCK_SRC_GETTIME,
+	1.0,
+	0,
+	0,
+};
+
+/*
+ *  stress_clock_src_name()
+ *	name of the timing source in use
+ */
+const char *stress_clock_src_name(void)
+{
+	switch (g_clock.src) {
+	case STRESS_CLOCK_SRC_TSC:
+		return "tsc";
+	case STRESS_CLOCK_SRC_CNTVCT:
+		return "cntvct";
+	case STRESS_CLOCK_SRC_GETTIME:
+	default:
+		break;
+	}
+#if defined(CLOCK_MONOTONIC_RAW)
+	return "clock_gettime(CLOCK_MONOTONIC_RAW)";
+#else
+	return "clock_gettime(CLOCK_MONOTONIC)";
+#endif
+}
+
+/*
+ *  stress_clock_counter_src()
+ *	the free running counter that can be used on this
+ *	system, STRESS_CLOCK_SRC_GETTIME if there is none
+ */
+static stress_clock_src_t stress_clock_counter_src(void)
+{
+#if defined(STRESS_ARCH_X86) &&	\
+    defined(__GNUC__)
+	char buf[64];
+
+	if (!stress_cpu_x86_has_tsc() || !stress_cpu_x86_has_invariant_tsc())
+		return STRESS_CLOCK_SRC_GETTIME;
+	/* the kernel drops the tsc clocksource if it finds it unstable */
+	if ((system_read("/sys/devices/system/clocksource/clocksource0/current_clocksource",
+			 buf, sizeof(buf)) > 0) && strncmp(buf, "tsc", 3))
+		return STRESS_CLOCK_SRC_GETTIME;
+	return STRESS_CLOCK_SRC_TSC;
+#elif defined(STRESS_ARCH_ARM) &&	\
+      defined(__aarch64__) &&		\
+      defined(__GNUC__)
+	return STRESS_CLOCK_SRC_CNTVCT;
+#else
+	return STRESS_CLOCK_SRC_GETTIME;
+#endif
+}
+
+/*
+ *  stress_clock_calibrate()
+ *	scale the counter ticks against the monotonic clock,
+ *	returns 0.0 if the counter does not appear to tick
+ */
+static double stress_clock_calibrate(void)
+{
+	const uint64_t ns_start = stress_clock_gettime_ns();
+	const uint64_t t_start = stress_clock_ticks();
+	uint64_t ns, t;
+
+	(void)shim_usleep((useconds_t)(CLOCK_CALIBRATE_NS / 1000));
+	do {
+		ns = stress_clock_gettime_ns() - ns_start;
+	} while (ns < CLOCK_CALIBRATE_NS);
+	t = stress_clock_ticks() - t_start;
+
+	return (t > 0) ? (double)ns / (double)t : 0.0;
+}
+
+/*
+ *  stress_clock_overhead()
+ *	minimum ns cost of a pair of back to back clock reads
+ */
+static uint64_t stress_clock_overhead(void)
+{
+	uint64_t min = ~0ULL;
+	int i;
+
+	for (i = 0; i < CLOCK_OVERHEAD_LOOPS; i++) {
+		const uint64_t t1 = stress_clock_ns();
+		const uint64_t t2 = stress_clock_ns();
+
+		if (t2 - t1 < min)
+			min = t2 - t1;
+	}
+	return (min == ~0ULL) ? 0 : min;
+}
+
+/*
+ *  stress_clock_sync_check()
+ *	compare the timing source against the monotonic clock on
+ *	each CPU this process may run on, the kernel keeps the
+ *	monotonic clock in step across CPUs so any spread in the
+ *	offsets is skew between the CPU counters. Returns -1 if
+ *	the check cannot be made, 0 otherwise with the skew in ns
+ */
+int stress_clock_sync_check(uint64_t *skew_ns)
+{
+#if defined(HAVE_AFFINITY) &&	\
+    defined(HAVE_SCHED_GETAFFINITY)
+	cpu_set_t mask, cpu_mask;
+	int64_t min_offset = INT64_MAX, max_offset = INT64_MIN;
+	int cpu, cpus = 0;
+
+	*skew_ns = 0;
+	if (g_clock.src == STRESS_CLOCK_SRC_GETTIME)
+		return 0;
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0)
+		return -1;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		uint64_t ns1, ns2, t;
+		int64_t offset;
+
+		if (!CPU_ISSET(cpu, &mask))
+			continue;
+		CPU_ZERO(&cpu_mask);
+		CPU_SET(cpu, &cpu_mask);
+		if (sched_setaffinity(0, sizeof(cpu_mask), &cpu_mask) < 0)
+			continue;
+
+		ns1 = stress_clock_gettime_ns();
+		t = stress_clock_ns();
+		ns2 = stress_clock_gettime_ns();
+
+		/* offset against the mid point of the monotonic reads */
+		offset = (int64_t)t - (int64_t)(ns1 + ((ns2 - ns1) >> 1));
+		min_offset = STRESS_MINIMUM(min_offset, offset);
+		max_offset = STRESS_MAXIMUM(max_offset, offset);
+		cpus++;
+	}
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	if (cpus < 2)
+		return -1;
+	*skew_ns = (uint64_t)(max_offset - min_offset);
+	return 0;
+#else
+	*skew_ns = 0;
+	return -1;
+#endif
+}
+
+/*
+ *  stress_clock_init()
+ *	select, calibrate and sanity check the timing source,
+ *	falls back to clock_gettime if the CPU counter is not
+ *	invariant or not in sync across the CPUs
+ */
+void stress_clock_init(void)
+{
+	uint64_t skew_ns;
+	double ns_per_tick;
+
+	g_clock.src = stress_clock_counter_src();
+	g_clock.ns_per_tick = 1.0;
+	g_clock.overhead_ns = 0;
+
+	if (g_clock.src != STRESS_CLOCK_SRC_GETTIME) {
+		ns_per_tick = stress_clock_calibrate();
+		if (ns_per_tick <= 0.0) {
+			pr_dbg("clock: %s is not ticking, using %s\n",
+				stress_clock_src_name(), "clock_gettime");
+			g_clock.src = STRESS_CLOCK_SRC_GETTIME;
+		} else {
+			g_clock.ns_per_tick = ns_per_tick;
+		}
+	}
+	g_clock.base = stress_clock_ticks();
+
+	if ((stress_clock_sync_check(&skew_ns) == 0) &&
+	    (skew_ns > CLOCK_SKEW_MAX_NS)) {
+		pr_dbg("clock: %s skew of %" PRIu64 " ns across CPUs, using %s\n",
+			stress_clock_src_name(), skew_ns, "clock_gettime");
+		g_clock.src = STRESS_CLOCK_SRC_GETTIME;
+		g_clock.ns_per_tick = 1.0;
+		g_clock.base = stress_clock_ticks();
+	}
+	g_clock.overhead_ns = stress_clock_overhead();
+
+	pr_dbg("clock: using %s, %.4f ns per tick, %" PRIu64 " ns read overhead\n",
+		stress_clock_src_name(), g_clock.ns_per_tick, g_clock.overhead_ns);
+}
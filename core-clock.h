@@ -0,0 +1,127 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_CLOCK_H
+#define CORE_CLOCK_H
+
+#include "core-arch.h"
+
+/* Timing sources, in order of preference */
+typedef enum {
+	STRESS_CLOCK_SRC_GETTIME = 0,	/* clock_gettime, ticks are ns */
+	STRESS_CLOCK_SRC_TSC,		/* x86 invariant TSC */
+	STRESS_CLOCK_SRC_CNTVCT,	/* arm64 virtual counter */
+} stress_clock_src_t;
+
+/* Calibrated timing source, set up once by stress_clock_init() */
+typedef struct {
+	stress_clock_src_t src;		/* timing source */
+	double ns_per_tick;		/* tick to ns scaling */
+	uint64_t base;			/* ticks at calibration, 0 ns */
+	uint64_t overhead_ns;		/* cost of a back to back read */
+} stress_clock_t;
+
+extern stress_clock_t g_clock;
+
+#if defined(HAVE_CLOCK_GETTIME)
+/*
+ *  stress_clock_id_ns()
+ *	read clock id in ns, 0 if it cannot be read, for times that
+ *	must come from a specific clock such as CLOCK_MONOTONIC
+ *	clock_nanosleep() deadlines or the CPU time clocks
+ */
+static inline uint64_t ALWAYS_INLINE stress_clock_id_ns(const clockid_t id)
+{
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(id, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+	return 0;
+}
+#endif
+
+/*
+ *  stress_clock_gettime_ns()
+ *	raw monotonic clock in ns, not slewed by NTP where possible
+ */
+static inline uint64_t ALWAYS_INLINE stress_clock_gettime_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC_RAW)
+	return stress_clock_id_ns(CLOCK_MONOTONIC_RAW);
+#elif defined(HAVE_CLOCK_GETTIME) &&	\
+      defined(CLOCK_MONOTONIC)
+	return stress_clock_id_ns(CLOCK_MONOTONIC);
+#else
+	return (uint64_t)(stress_time_now() * STRESS_NANOSECOND);
+#endif
+}
+
+/*
+ *  stress_clock_ticks()
+ *	read the free running counter of the timing source
+ */
+static inline uint64_t ALWAYS_INLINE stress_clock_ticks(void)
+{
+#if defined(STRESS_ARCH_X86) &&	\
+    defined(__GNUC__)
+	if (LIKELY(g_clock.src == STRESS_CLOCK_SRC_TSC)) {
+		uint32_t lo, hi;
+
+		__asm__ __volatile__("rdtsc\n" : "=a"(lo), "=d"(hi));
+		return ((uint64_t)hi << 32) | lo;
+	}
+#elif defined(STRESS_ARCH_ARM) &&	\
+      defined(__aarch64__) &&		\
+      defined(__GNUC__)
+	if (LIKELY(g_clock.src == STRESS_CLOCK_SRC_CNTVCT)) {
+		uint64_t val;
+
+		__asm__ __volatile__("mrs %0, cntvct_el0\n" : "=r"(val));
+		return val;
+	}
+#endif
+	return stress_clock_gettime_ns();
+}
+
+/*
+ *  stress_clock_ns()
+ *	calibrated time in ns since stress_clock_init()
+ */
+static inline uint64_t ALWAYS_INLINE stress_clock_ns(void)
+{
+	return (uint64_t)((double)(stress_clock_ticks() - g_clock.base) * g_clock.ns_per_tick);
+}
+
+/*
+ *  stress_clock_delta_ns()
+ *	ns between two stress_clock_ns() timestamps with the
+ *	cost of reading the clock subtracted
+ */
+static inline uint64_t ALWAYS_INLINE stress_clock_delta_ns(const uint64_t t1, const uint64_t t2)
+{
+	const uint64_t delta = t2 - t1;
+
+	return (delta > g_clock.overhead_ns) ? delta - g_clock.overhead_ns : 0;
+}
+
+extern void stress_clock_init(void);
+extern int stress_clock_sync_check(uint64_t *skew_ns);
+extern const char *stress_clock_src_name(void);
+
+#endif
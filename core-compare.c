@@ -0,0 +1,295 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-compare.h"
+#include "core-repeat.h"
+
+#define COMPARE_MAX_STRESSORS	(1024)
+#define DEFAULT_COMPARE_THRESHOLD (5.0)	/* regression threshold, % */
+
+#define SECTION_NONE		(0)
+#define SECTION_METRICS		(1)
+#define SECTION_REPEAT		(2)
+
+/* baseline result of one stressor */
+typedef struct {
+	char	name[64];		/* munged stressor name */
+	double	rate;			/* real time bogo-ops/sec */
+	double	mean;			/* --repeat mean bogo-ops/sec */
+	double	stddev;			/* --repeat standard deviation */
+	uint32_t runs;			/* --repeat runs, 0 = none */
+	bool	has_rate;		/* metrics rate was found */
+} stress_compare_base_t;
+
+static stress_compare_base_t *compare_base;	/* baseline results */
+static size_t compare_n;			/* number of baseline results */
+static char *compare_filename;			/* baseline YAML file */
+static double compare_threshold = DEFAULT_COMPARE_THRESHOLD;
+
+/*
+ *  stress_compare_find()
+ *	find or add a baseline result for a stressor
+ */
+static stress_compare_base_t *stress_compare_find(const char *name, const bool add)
+{
+	size_t i;
+
+	for (i = 0; i < compare_n; i++) {
+		if (!strcmp(compare_base[i].name, name))
+			return &compare_base[i];
+	}
+	if (!add || (compare_n >= COMPARE_MAX_STRESSORS))
+		return NULL;
+	(void)memset(&compare_base[compare_n], 0, sizeof(compare_base[compare_n]));
+	(void)shim_strlcpy(compare_base[compare_n].name, name, sizeof(compare_base[compare_n].name));
+	return &compare_base[compare_n++];
+}
+
+/*
+ *  stress_compare_value()
+ *	parse "key: value" lines, returns true if the
+ *	line starts with key after leading blanks
+ */
+static bool stress_compare_value(const char *line, const char *key, const char **value)
+{
+	const size_t len = strlen(key);
+
+	while (*line == ' ')
+		line++;
+	if (strncmp(line, key, len))
+		return false;
+	*value = line + len;
+	while (**value == ' ')
+		(*value)++;
+	return true;
+}
+
+/*
+ *  stress_compare_load()
+ *	load the metrics and repeat results from a stress-ng YAML
+ *	file, only the subset of YAML written by pr_yaml is parsed
+ */
+static int stress_compare_load(const char *filename)
+{
+	stress_compare_base_t *base = NULL;
+	uint32_t runs = 0;
+	int section = SECTION_NONE;
+	char buf[4096];
+	FILE *fp;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		(void)fprintf(stderr, "Cannot open compare baseline '%s', errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return -1;
+	}
+	compare_base = calloc(COMPARE_MAX_STRESSORS, sizeof(*compare_base));
+	if (!compare_base) {
+		(void)fprintf(stderr, "Cannot allocate compare baseline results\n");
+		(void)fclose(fp);
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		const char *value;
+		char *ptr = strchr(buf, '\n');
+
+		if (ptr)
+			*ptr = '\0';
+		if (!isspace((int)buf[0])) {
+			section = !strcmp(buf, "metrics:") ? SECTION_METRICS :
+				  !strcmp(buf, "repeat:") ? SECTION_REPEAT : SECTION_NONE;
+			base = NULL;
+			continue;
+		}
+		if (section == SECTION_NONE)
+			continue;
+
+		if (stress_compare_value(buf, "- stressor:", &value)) {
+			base = stress_compare_find(value, true);
+			if (base && (section == SECTION_REPEAT))
+				base->runs = runs;
+		} else if ((section == SECTION_REPEAT) && stress_compare_value(buf, "runs:", &value)) {
+			runs = (uint32_t)atoi(value);
+		} else if (!base) {
+			continue;
+		} else if ((section == SECTION_METRICS) &&
+			   stress_compare_value(buf, "bogo-ops-per-second-real-time:", &value)) {
+			base->rate = atof(value);
+			base->has_rate = true;
+		} else if ((section == SECTION_REPEAT) && stress_compare_value(buf, "mean:", &value)) {
+			base->mean = atof(value);
+		} else if ((section == SECTION_REPEAT) && stress_compare_value(buf, "stddev:", &value)) {
+			base->stddev = atof(value);
+		}
+	}
+	(void)fclose(fp);
+
+	if (!compare_n) {
+		(void)fprintf(stderr, "No metrics or repeat results found in compare baseline "
+			"'%s', it must be written with --yaml and --metrics or --repeat\n", filename);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_set_compare()
+ *	load the --compare baseline YAML results file
+ */
+int stress_set_compare(const char *const opt)
+{
+	free(compare_base);
+	compare_base = NULL;
+	compare_n = 0;
+	free(compare_filename);
+	compare_filename = strdup(opt);
+	if (!compare_filename) {
+		(void)fprintf(stderr, "Cannot allocate compare baseline filename\n");
+		return -1;
+	}
+	return stress_compare_load(opt);
+}
+
+/*
+ *  stress_set_compare_threshold()
+ *	set the regression threshold percentage
+ */
+int stress_set_compare_threshold(const char *const opt)
+{
+	if ((sscanf(opt, "%lf", &compare_threshold) != 1) ||
+	    (compare_threshold < 0.0) || (compare_threshold > 100.0)) {
+		(void)fprintf(stderr, "compare-threshold must be a percentage in the range 0 to 100.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_compare_welch()
+ *	Welch's t-test of two means, returns true if the
+ *	difference is significant at the 95% level
+ */
+static bool stress_compare_welch(
+	const double m1, const double s1, const uint32_t n1,
+	const double m2, const double s2, const uint32_t n2)
+{
+	const double v1 = (s1 * s1) / (double)n1;
+	const double v2 = (s2 * s2) / (double)n2;
+	const double se = sqrt(v1 + v2);
+	double df;
+
+	if (se <= 0.0)
+		return m1 != m2;
+	/* Welch-Satterthwaite degrees of freedom */
+	df = ((v1 + v2) * (v1 + v2)) /
+	     (((v1 * v1) / (double)(n1 - 1)) + ((v2 * v2) / (double)(n2 - 1)));
+	return fabs(m1 - m2) / se > stress_repeat_t95((uint32_t)df);
+}
+
+/*
+ *  stress_compare_dump()
+ *	compare the real time bogo-ops rates of this run against the
+ *	baseline; a stressor regresses if it is more than the threshold
+ *	slower and, when both results have --repeat runs, the change is
+ *	significant. Sets *success false on any regression
+ */
+void stress_compare_dump(FILE *yaml, stress_stressor_t *stressors_list, bool *success)
+{
+	stress_stressor_t *ss;
+	uint32_t regressions = 0;
+	size_t n;
+
+	if (!compare_base)
+		return;
+
+	pr_inf("compare: against %s, regression threshold %.2f%%\n",
+		compare_filename, compare_threshold);
+	pr_inf("%-13s %12s %12s %9s %6s %s\n",
+		"stressor", "baseline", "current", "change%", "signif", "verdict");
+	pr_yaml(yaml, "compare:\n");
+	pr_yaml(yaml, "    baseline: %s\n", compare_filename);
+	pr_yaml(yaml, "    threshold-percent: %f\n", compare_threshold);
+	pr_yaml(yaml, "    stressors:\n");
+
+	for (n = 0, ss = stressors_list; ss; ss = ss->next, n++) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		const stress_compare_base_t *base = stress_compare_find(munged, false);
+		double cur, cur_stddev = 0.0, base_rate, change;
+		uint32_t cur_runs = 0;
+		const char *signif = "n/a", *verdict;
+		bool significant = true;
+
+		if (!ss->stats)
+			continue;
+		if (!base || (!base->runs && !base->has_rate)) {
+			pr_inf("%-13s %12s\n", munged, "no baseline");
+			continue;
+		}
+
+		if (!stress_repeat_summary(n, &cur, &cur_stddev, &cur_runs)) {
+			uint64_t c_total = 0;
+			double r_total = 0.0;
+			int32_t j;
+
+			for (j = 0; j < ss->started_instances; j++) {
+				c_total += ss->stats[j]->ci.counter;
+				r_total += ss->stats[j]->finish - ss->stats[j]->start;
+			}
+			r_total = ss->started_instances ? r_total / (double)ss->started_instances : 0.0;
+			cur = (r_total > 0.0) ? (double)c_total / r_total : 0.0;
+		}
+		base_rate = base->runs ? base->mean : base->rate;
+		change = (base_rate > 0.0) ? 100.0 * (cur - base_rate) / base_rate : 0.0;
+
+		if ((base->runs > 1) && (cur_runs > 1)) {
+			significant = stress_compare_welch(cur, cur_stddev, cur_runs,
+				base->mean, base->stddev, base->runs);
+			signif = significant ? "yes" : "no";
+		}
+		if (significant && (change < -compare_threshold)) {
+			verdict = "REGRESSION";
+			regressions++;
+		} else if (significant && (change > compare_threshold)) {
+			verdict = "improvement";
+		} else {
+			verdict = "ok";
+		}
+		pr_inf("%-13s %12.2f %12.2f %+9.2f %6s %s\n",
+			munged, base_rate, cur, change, signif, verdict);
+
+		pr_yaml(yaml, "      - stressor: %s\n", munged);
+		pr_yaml(yaml, "        baseline: %f\n", base_rate);
+		pr_yaml(yaml, "        current: %f\n", cur);
+		pr_yaml(yaml, "        change-percent: %f\n", change);
+		pr_yaml(yaml, "        significant: %s\n", signif);
+		pr_yaml(yaml, "        verdict: %s\n", verdict);
+	}
+	pr_yaml(yaml, "\n");
+
+	if (regressions) {
+		pr_err("compare: %" PRIu32 " stressor%s regressed by more than %.2f%%\n",
+			regressions, regressions == 1 ? "" : "s", compare_threshold);
+		*success = false;
+	}
+	free(compare_base);
+	compare_base = NULL;
+	free(compare_filename);
+	compare_filename = NULL;
+}
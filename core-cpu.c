@@ -165,6 +165,8 @@
 
 #define CPUID_syscall_EDX	(1U << 11)	/* EAX=0x80000001  -> EDX */
 
+#define CPUID_invariant_tsc_EDX	(1U << 8)	/* EAX=0x80000007  -> EDX */
+
 /*
  *  stress_x86_cpuid()
  *	cpuid for x86
@@ -390,6 +392,35 @@ bool stress_cpu_x86_has_tsc(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_invariant_tsc()
+ *	does x86 cpu have a constant rate tsc that keeps
+ *	ticking in all P, C and T states?
+ */
+bool stress_cpu_x86_has_invariant_tsc(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x80000000, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_x86_cpuid(&eax, &ebx, &ecx, &edx);
+	if (eax < 0x80000007)
+		return false;
+
+	eax = 0x80000007;
+	ebx = 0;
+	ecx = 0;
+	edx = 0;
+	stress_x86_cpuid(&eax, &ebx, &ecx, &edx);
+
+	return !!(edx & CPUID_invariant_tsc_EDX);
+#else
+	return false;
+#endif
+}
+
 /*
  *  stress_cpu_x86_has_msr()
  *	does x86 cpu support MSRs?
@@ -489,3 +520,203 @@ bool stress_cpu_x86_has_sse2(void)
 	return false;
 #endif
 }
+
+/*
+ *  stress_cpu_x86_has_sse4_2()
+ *	does x86 cpu support sse4.2?
+ */
+bool stress_cpu_x86_has_sse4_2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_x86_cpuid(&eax, &ebx, &ecx, &edx);
+
+	return !!(ecx & CPUID_sse4_2_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_aes_pclmulqdq()
+ *	does x86 cpu support aes-ni and carry-less multiply?
+ */
+bool stress_cpu_x86_has_aes_pclmulqdq(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_x86_cpuid(&eax, &ebx, &ecx, &edx);
+
+	return (ecx & (CPUID_aes_ECX | CPUID_pclmulqdq_ECX)) ==
+	       (CPUID_aes_ECX | CPUID_pclmulqdq_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_sha()
+ *	does x86 cpu support the sha extensions (and sse4.1 they depend on)?
+ */
+bool stress_cpu_x86_has_sha(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_x86_cpuid(&eax, &ebx, &ecx, &edx);
+	if ((ecx & (CPUID_ssse3_ECX | CPUID_sse4_1_ECX)) !=
+	    (CPUID_ssse3_ECX | CPUID_sse4_1_ECX))
+		return false;
+
+	ebx = 0;
+	ecx = 0;
+	edx = 0;
+	stress_cpu_x86_extended_features(&ebx, &ecx, &edx);
+
+	return !!(ebx & CPUID_sha_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_avx2()
+ *	does x86 cpu support avx2?
+ */
+bool stress_cpu_x86_has_avx2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	/* AVX state must be enabled by the OS too */
+	stress_x86_cpuid(&eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_osxsave_ECX) || !(ecx & CPUID_avx_ECX))
+		return false;
+
+	ebx = 0;
+	ecx = 0;
+	edx = 0;
+	stress_cpu_x86_extended_features(&ebx, &ecx, &edx);
+
+	return !!(ebx & CPUID_avx2_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_avx512f()
+ *	does x86 cpu support avx512 foundation instructions?
+ */
+bool stress_cpu_x86_has_avx512f(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_x86_has_avx2())
+		return false;
+
+	stress_cpu_x86_extended_features(&ebx, &ecx, &edx);
+
+	return !!(ebx & CPUID_avx512_f_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_fma()
+ *	does x86 cpu support fused multiply-add?
+ */
+bool stress_cpu_x86_has_fma(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_x86_has_avx2())
+		return false;
+
+	stress_x86_cpuid(&eax, &ebx, &ecx, &edx);
+
+	return !!(ecx & CPUID_fma_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_erms()
+ *	does x86 cpu support enhanced rep movsb/stosb?
+ */
+bool stress_cpu_x86_has_erms(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_cpu_x86_extended_features(&ebx, &ecx, &edx);
+
+	return !!(ebx & CPUID_erms_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_fsrm()
+ *	does x86 cpu support fast short rep movsb?
+ */
+bool stress_cpu_x86_has_fsrm(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_cpu_x86_extended_features(&ebx, &ecx, &edx);
+
+	return !!(edx & CPUID_fsrm_EDX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_amx_int8()
+ *	does x86 cpu support amx tiles with int8 dot products?
+ *	the tile data state also has to be requested from the
+ *	kernel before it can be used
+ */
+bool stress_cpu_x86_has_amx_int8(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_cpu_x86_extended_features(&ebx, &ecx, &edx);
+
+	return (edx & (CPUID_amx_tile_EDX | CPUID_amx_int8_EDX)) ==
+		(CPUID_amx_tile_EDX | CPUID_amx_int8_EDX);
+#else
+	return false;
+#endif
+}
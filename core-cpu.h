@@ -31,10 +31,20 @@ extern WARN_UNUSED bool stress_cpu_x86_has_rdseed(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_syscall(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_rdrand(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_tsc(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_invariant_tsc(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_msr(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_clfsh(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_mmx(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_sse(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_sse2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_sse4_2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_aes_pclmulqdq(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_sha(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx512f(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_fma(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_erms(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_fsrm(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_amx_int8(void);
 
 #endif
@@ -0,0 +1,385 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-cpuidle.h"
+
+#define CPUIDLE_PATH		"/sys/devices/system/cpu"
+
+/* usage and residency of all the idle states of all CPUs */
+typedef struct {
+	uint64_t *usage;		/* [cpu][state] entry counts */
+	uint64_t *time_us;		/* [cpu][state] residency in us */
+	double time;			/* time of the reading */
+} stress_cpuidle_sample_t;
+
+/* idle state activity while a stressor ran, accumulated over its runs */
+typedef struct {
+	const stress_stressor_t *ss;	/* stressor */
+	stress_cpuidle_sample_t start;	/* counters at the start of a run */
+	uint64_t *usage;		/* [cpu][state] accumulated entries */
+	uint64_t *time_us;		/* [cpu][state] accumulated residency */
+	double run_time;		/* accumulated run time */
+} stress_cpuidle_stressor_t;
+
+static char cpuidle_names[STRESS_CPUIDLE_STATES_MAX][32];	/* state names */
+static uint32_t cpuidle_latency[STRESS_CPUIDLE_STATES_MAX];	/* exit latency us */
+static size_t cpuidle_states_n;			/* deepest state + 1 */
+static int32_t cpuidle_cpus_n;			/* CPUs configured */
+static bool cpuidle_init;			/* states have been scanned */
+static stress_cpuidle_stressor_t *cpuidle_stressors;	/* per stressor activity */
+static size_t cpuidle_stressors_n;		/* number of cpuidle_stressors */
+
+/*
+ *  stress_cpuidle_read_uint64()
+ *	read a decimal counter from a sysfs file, false if
+ *	it cannot be read
+ */
+static bool stress_cpuidle_read_uint64(const char *path, uint64_t *val)
+{
+	char buf[64];
+
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+	*val = (uint64_t)strtoull(buf, NULL, 10);
+	return true;
+}
+
+/*
+ *  stress_cpuidle_usage()
+ *	read the entry counts and residency in us of up to max
+ *	idle states of a CPU, time_us may be NULL, returns the
+ *	number of states, 0 if the CPU has no cpuidle states
+ */
+size_t stress_cpuidle_usage(
+	const int32_t cpu,
+	uint64_t *usage,
+	uint64_t *time_us,
+	const size_t max)
+{
+	size_t i;
+
+	for (i = 0; i < max; i++) {
+		char path[PATH_MAX];
+
+		(void)snprintf(path, sizeof(path), "%s/cpu%" PRId32 "/cpuidle/state%zu/usage",
+			CPUIDLE_PATH, cpu, i);
+		if (!stress_cpuidle_read_uint64(path, &usage[i]))
+			break;
+		if (!time_us)
+			continue;
+		(void)snprintf(path, sizeof(path), "%s/cpu%" PRId32 "/cpuidle/state%zu/time",
+			CPUIDLE_PATH, cpu, i);
+		if (!stress_cpuidle_read_uint64(path, &time_us[i]))
+			time_us[i] = 0;
+	}
+	return i;
+}
+
+/*
+ *  stress_cpuidle_name()
+ *	get the name of an idle state of a CPU, e.g. POLL, C1, C6,
+ *	false if the state does not exist
+ */
+bool stress_cpuidle_name(
+	const int32_t cpu,
+	const size_t state,
+	char *name,
+	const size_t len)
+{
+	char path[PATH_MAX];
+	char *ptr;
+
+	(void)snprintf(path, sizeof(path), "%s/cpu%" PRId32 "/cpuidle/state%zu/name",
+		CPUIDLE_PATH, cpu, state);
+	if (system_read(path, name, len) <= 0)
+		return false;
+	ptr = strchr(name, '\n');
+	if (ptr)
+		*ptr = '\0';
+	return true;
+}
+
+/*
+ *  stress_cpuidle_states()
+ *	find the idle states, CPUs can have different numbers of
+ *	states so the state names are taken from the first CPU
+ *	that has each state
+ */
+static void stress_cpuidle_states(void)
+{
+	int32_t cpu;
+
+	if (cpuidle_init)
+		return;
+	cpuidle_init = true;
+
+	cpuidle_cpus_n = stress_get_processors_configured();
+	if (cpuidle_cpus_n < 1)
+		cpuidle_cpus_n = 1;
+	for (cpu = 0; cpu < cpuidle_cpus_n; cpu++) {
+		uint64_t usage[STRESS_CPUIDLE_STATES_MAX];
+		const size_t n = stress_cpuidle_usage(cpu, usage, NULL, STRESS_CPUIDLE_STATES_MAX);
+		size_t i;
+
+		for (i = cpuidle_states_n; i < n; i++) {
+			char path[PATH_MAX];
+			uint64_t latency;
+
+			if (!stress_cpuidle_name(cpu, i, cpuidle_names[i], sizeof(cpuidle_names[i])))
+				(void)snprintf(cpuidle_names[i], sizeof(cpuidle_names[i]), "state%zu", i);
+			(void)snprintf(path, sizeof(path), "%s/cpu%" PRId32 "/cpuidle/state%zu/latency",
+				CPUIDLE_PATH, cpu, i);
+			cpuidle_latency[i] = stress_cpuidle_read_uint64(path, &latency) ?
+				(uint32_t)latency : 0;
+		}
+		if (n > cpuidle_states_n)
+			cpuidle_states_n = n;
+	}
+}
+
+/*
+ *  stress_cpuidle_alloc()
+ *	allocate a zeroed [cpu][state] counter array
+ */
+static uint64_t *stress_cpuidle_alloc(void)
+{
+	return calloc((size_t)cpuidle_cpus_n * STRESS_CPUIDLE_STATES_MAX, sizeof(uint64_t));
+}
+
+/*
+ *  stress_cpuidle_read()
+ *	read the idle state counters of all the CPUs
+ */
+static void stress_cpuidle_read(stress_cpuidle_sample_t *sample)
+{
+	int32_t cpu;
+
+	for (cpu = 0; cpu < cpuidle_cpus_n; cpu++) {
+		const size_t offset = (size_t)cpu * STRESS_CPUIDLE_STATES_MAX;
+
+		(void)stress_cpuidle_usage(cpu, sample->usage + offset,
+			sample->time_us + offset, cpuidle_states_n);
+	}
+	sample->time = stress_time_now();
+}
+
+/*
+ *  stress_cpuidle_find()
+ *	find or add the idle state activity of a stressor
+ */
+static stress_cpuidle_stressor_t *stress_cpuidle_find(const stress_stressor_t *ss)
+{
+	stress_cpuidle_stressor_t *cs;
+	size_t i;
+
+	for (i = 0; i < cpuidle_stressors_n; i++) {
+		if (cpuidle_stressors[i].ss == ss)
+			return &cpuidle_stressors[i];
+	}
+	cs = realloc(cpuidle_stressors, (cpuidle_stressors_n + 1) * sizeof(*cpuidle_stressors));
+	if (!cs)
+		return NULL;
+	cpuidle_stressors = cs;
+	cs = &cpuidle_stressors[cpuidle_stressors_n];
+	(void)memset(cs, 0, sizeof(*cs));
+	cs->start.usage = stress_cpuidle_alloc();
+	cs->start.time_us = stress_cpuidle_alloc();
+	cs->usage = stress_cpuidle_alloc();
+	cs->time_us = stress_cpuidle_alloc();
+	if (!cs->start.usage || !cs->start.time_us || !cs->usage || !cs->time_us) {
+		free(cs->start.usage);
+		free(cs->start.time_us);
+		free(cs->usage);
+		free(cs->time_us);
+		return NULL;
+	}
+	cs->ss = ss;
+	cpuidle_stressors_n++;
+	return cs;
+}
+
+/*
+ *  stress_cpuidle_start()
+ *	read the idle state counters at the start of a run of
+ *	the stressors in the list
+ */
+void stress_cpuidle_start(stress_stressor_t *stressors_list)
+{
+	stress_cpuidle_sample_t sample;
+	stress_stressor_t *ss;
+	const size_t size = (size_t)cpuidle_cpus_n * STRESS_CPUIDLE_STATES_MAX * sizeof(uint64_t);
+
+	if (!(g_opt_flags & OPT_FLAGS_CPUIDLE))
+		return;
+
+	stress_cpuidle_states();
+	if (!cpuidle_states_n)
+		return;
+
+	sample.usage = stress_cpuidle_alloc();
+	sample.time_us = stress_cpuidle_alloc();
+	if (!sample.usage || !sample.time_us) {
+		pr_err("cpuidle: cannot allocate idle state counters\n");
+		goto free_sample;
+	}
+	stress_cpuidle_read(&sample);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_cpuidle_stressor_t *cs;
+
+		if (!ss->num_instances)
+			continue;
+		cs = stress_cpuidle_find(ss);
+		if (!cs) {
+			pr_err("cpuidle: cannot allocate idle state counters\n");
+			break;
+		}
+		(void)memcpy(cs->start.usage, sample.usage, size);
+		(void)memcpy(cs->start.time_us, sample.time_us, size);
+		cs->start.time = sample.time;
+	}
+
+free_sample:
+	free(sample.usage);
+	free(sample.time_us);
+}
+
+/*
+ *  stress_cpuidle_stop()
+ *	read the idle state counters at the end of a run of
+ *	the stressors in the list and accumulate the deltas
+ */
+void stress_cpuidle_stop(stress_stressor_t *stressors_list)
+{
+	stress_cpuidle_sample_t sample;
+	stress_stressor_t *ss;
+	const size_t n = (size_t)cpuidle_cpus_n * STRESS_CPUIDLE_STATES_MAX;
+
+	if (!(g_opt_flags & OPT_FLAGS_CPUIDLE) || !cpuidle_states_n)
+		return;
+
+	sample.usage = stress_cpuidle_alloc();
+	sample.time_us = stress_cpuidle_alloc();
+	if (!sample.usage || !sample.time_us)
+		goto free_sample;
+	stress_cpuidle_read(&sample);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_cpuidle_stressor_t *cs;
+		size_t i;
+
+		if (!ss->num_instances)
+			continue;
+		cs = stress_cpuidle_find(ss);
+		if (!cs)
+			continue;
+		for (i = 0; i < n; i++) {
+			if (sample.usage[i] >= cs->start.usage[i])
+				cs->usage[i] += sample.usage[i] - cs->start.usage[i];
+			if (sample.time_us[i] >= cs->start.time_us[i])
+				cs->time_us[i] += sample.time_us[i] - cs->start.time_us[i];
+		}
+		cs->run_time += sample.time - cs->start.time;
+	}
+
+free_sample:
+	free(sample.usage);
+	free(sample.time_us);
+}
+
+/*
+ *  stress_cpuidle_dump()
+ *	report the idle state entries per second, residency and
+ *	mean time per entry of each stressor, the residency is
+ *	the percentage of the run time summed over all CPUs
+ */
+void stress_cpuidle_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+	size_t i;
+
+	if (!(g_opt_flags & OPT_FLAGS_CPUIDLE))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_cpuidle_stressor_t *cs = stress_cpuidle_find(ss);
+		const double cpu_time = cs ? cs->run_time * (double)cpuidle_cpus_n : 0.0;
+		size_t state;
+		int32_t cpu;
+
+		if (!cs || (cs->run_time <= 0.0) || !cpuidle_states_n)
+			continue;
+
+		if (!header) {
+			pr_inf("cpuidle: idle state residency while each stressor ran:\n");
+			pr_inf("%-13s %-10s %10s %12s %11s %12s\n",
+				"stressor", "state", "exit us", "entries/s", "residency%",
+				"us per entry");
+			pr_yaml(yaml, "cpuidle:\n");
+			header = true;
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      run-time: %f\n", cs->run_time);
+		for (state = 0; state < cpuidle_states_n; state++) {
+			uint64_t usage = 0, time_us = 0;
+
+			for (cpu = 0; cpu < cpuidle_cpus_n; cpu++) {
+				const size_t j = ((size_t)cpu * STRESS_CPUIDLE_STATES_MAX) + state;
+
+				usage += cs->usage[j];
+				time_us += cs->time_us[j];
+			}
+			pr_inf("%-13s %-10s %10" PRIu32 " %12.1f %11.2f %12.1f\n",
+				munged, cpuidle_names[state], cpuidle_latency[state],
+				(double)usage / cs->run_time,
+				100.0 * (double)time_us / (cpu_time * 1000000.0),
+				usage ? (double)time_us / (double)usage : 0.0);
+			pr_yaml(yaml, "      %s-entries: %" PRIu64 "\n", cpuidle_names[state], usage);
+			pr_yaml(yaml, "      %s-residency-us: %" PRIu64 "\n", cpuidle_names[state], time_us);
+		}
+		for (cpu = 0; cpu < cpuidle_cpus_n; cpu++) {
+			const size_t offset = (size_t)cpu * STRESS_CPUIDLE_STATES_MAX;
+
+			pr_yaml(yaml, "      cpu%" PRId32 ":\n", cpu);
+			for (state = 0; state < cpuidle_states_n; state++) {
+				pr_yaml(yaml, "        %s-entries: %" PRIu64 "\n",
+					cpuidle_names[state], cs->usage[offset + state]);
+				pr_yaml(yaml, "        %s-residency-us: %" PRIu64 "\n",
+					cpuidle_names[state], cs->time_us[offset + state]);
+			}
+		}
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	else
+		pr_inf("cpuidle: no idle state information, %s/cpu*/cpuidle "
+			"is not available\n", CPUIDLE_PATH);
+
+	for (i = 0; i < cpuidle_stressors_n; i++) {
+		free(cpuidle_stressors[i].start.usage);
+		free(cpuidle_stressors[i].start.time_us);
+		free(cpuidle_stressors[i].usage);
+		free(cpuidle_stressors[i].time_us);
+	}
+	free(cpuidle_stressors);
+	cpuidle_stressors = NULL;
+	cpuidle_stressors_n = 0;
+}
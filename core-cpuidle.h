@@ -0,0 +1,33 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_CPUIDLE_H
+#define CORE_CPUIDLE_H
+
+#define STRESS_CPUIDLE_STATES_MAX	(16)
+
+/* cpuidle C-state residency, --cpuidle */
+extern size_t stress_cpuidle_usage(const int32_t cpu, uint64_t *usage,
+	uint64_t *time_us, const size_t max);
+extern bool stress_cpuidle_name(const int32_t cpu, const size_t state,
+	char *name, const size_t len);
+extern void stress_cpuidle_start(stress_stressor_t *stressors_list);
+extern void stress_cpuidle_stop(stress_stressor_t *stressors_list);
+extern void stress_cpuidle_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
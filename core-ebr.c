@@ -0,0 +1,260 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-ebr.h"
+
+#if defined(HAVE_ATOMIC)
+
+#define STRESS_EBR_LIMBO_MIN	(256)	/* initial limbo list size */
+
+/*
+ *  stress_ebr_limbo_free()
+ *	free all the objects in a limbo list
+ */
+static void stress_ebr_limbo_free(
+	stress_ebr_t *ebr,
+	stress_ebr_thread_t *t,
+	stress_ebr_limbo_t *limbo)
+{
+	size_t i, freed = 0;
+
+	for (i = 0; i < limbo->n; i++) {
+		ebr->free_func(limbo->objs[i].ptr);
+		freed += limbo->objs[i].size;
+	}
+	t->frees += limbo->n;
+	limbo->n = 0;
+	__atomic_store_n(&t->pending, t->pending - freed, __ATOMIC_RELAXED);
+}
+
+/*
+ *  stress_ebr_init()
+ *	initialize a reclamation domain for n_threads threads,
+ *	thread ids are 0..n_threads-1, returns -1 on failure
+ */
+int stress_ebr_init(stress_ebr_t *ebr, const size_t n_threads, stress_ebr_free_t free_func)
+{
+	size_t i;
+
+	(void)memset(ebr, 0, sizeof(*ebr));
+	if ((n_threads < 1) || (n_threads > STRESS_EBR_MAX_THREADS))
+		return -1;
+	ebr->threads = (stress_ebr_thread_t *)mmap(NULL, n_threads * sizeof(*ebr->threads),
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ebr->threads == MAP_FAILED) {
+		ebr->threads = NULL;
+		return -1;
+	}
+	ebr->n_threads = n_threads;
+	ebr->free_func = free_func;
+	ebr->epoch = 1;
+	for (i = 0; i < n_threads; i++)
+		ebr->threads[i].seen = 1;
+	return 0;
+}
+
+/*
+ *  stress_ebr_enter()
+ *	enter a critical section, shared objects may only be
+ *	referenced inside a critical section. Limbo lists that
+ *	have passed a grace period since the last enter are free'd
+ */
+void stress_ebr_enter(stress_ebr_t *ebr, const size_t tid)
+{
+	stress_ebr_thread_t *t = &ebr->threads[tid];
+	const uint64_t epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_ACQUIRE);
+	uint64_t e;
+
+	__atomic_store_n(&t->epoch, epoch | STRESS_EBR_ACTIVE, __ATOMIC_SEQ_CST);
+	/* the announcement must be visible before any shared loads */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (epoch == t->seen)
+		return;
+	/* objects retired in epoch e - 2 are unreachable by now */
+	for (e = t->seen + 1; e <= epoch; e++) {
+		stress_ebr_limbo_free(ebr, t, &t->limbo[(e + 1) % STRESS_EBR_EPOCHS]);
+		if (e - t->seen >= STRESS_EBR_EPOCHS)
+			break;
+	}
+	t->seen = epoch;
+}
+
+/*
+ *  stress_ebr_advance()
+ *	move the global epoch on if every active thread has
+ *	observed the current epoch
+ */
+static void stress_ebr_advance(stress_ebr_t *ebr)
+{
+	uint64_t epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_SEQ_CST);
+	size_t i;
+
+	for (i = 0; i < ebr->n_threads; i++) {
+		const uint64_t e = __atomic_load_n(&ebr->threads[i].epoch, __ATOMIC_SEQ_CST);
+
+		if ((e & STRESS_EBR_ACTIVE) && ((e & ~STRESS_EBR_ACTIVE) != epoch))
+			return;
+	}
+	(void)__atomic_compare_exchange_n(&ebr->epoch, &epoch, epoch + 1,
+		false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/*
+ *  stress_ebr_retire()
+ *	defer freeing of an object that has been unlinked from the
+ *	shared structure, must be called inside a critical section.
+ *	The object is stamped with the global epoch at the time of
+ *	retirement and is free'd two epochs later
+ */
+void stress_ebr_retire(stress_ebr_t *ebr, const size_t tid, void *ptr, const size_t size)
+{
+	stress_ebr_thread_t *t = &ebr->threads[tid];
+	const uint64_t epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_SEQ_CST);
+	stress_ebr_limbo_t *limbo = &t->limbo[epoch % STRESS_EBR_EPOCHS];
+
+	if (UNLIKELY(limbo->n >= limbo->max)) {
+		const size_t max = limbo->max ? limbo->max * 2 : STRESS_EBR_LIMBO_MIN;
+		stress_ebr_obj_t *objs;
+
+		objs = (stress_ebr_obj_t *)realloc((void *)limbo->objs, max * sizeof(*objs));
+		if (!objs) {
+			/* can't safely free it yet, so leak it */
+			return;
+		}
+		limbo->objs = objs;
+		limbo->max = max;
+	}
+	limbo->objs[limbo->n].ptr = ptr;
+	limbo->objs[limbo->n].size = size;
+	limbo->n++;
+	__atomic_store_n(&t->pending, t->pending + size, __ATOMIC_RELAXED);
+	if (t->pending > t->pending_peak)
+		t->pending_peak = t->pending;
+
+	t->retires++;
+	if ((t->retires % STRESS_EBR_ADVANCE) == 0)
+		stress_ebr_advance(ebr);
+}
+
+/*
+ *  stress_ebr_pending()
+ *	bytes retired but not yet free'd over all threads,
+ *	this is the memory overhead of deferred reclamation
+ */
+size_t stress_ebr_pending(stress_ebr_t *ebr)
+{
+	size_t i, pending = 0;
+
+	for (i = 0; i < ebr->n_threads; i++)
+		pending += __atomic_load_n(&ebr->threads[i].pending, __ATOMIC_RELAXED);
+	return pending;
+}
+
+/*
+ *  stress_ebr_drain()
+ *	free all retired objects, all threads must have left
+ *	their critical sections
+ */
+void stress_ebr_drain(stress_ebr_t *ebr)
+{
+	size_t i, j;
+
+	for (i = 0; i < ebr->n_threads; i++) {
+		stress_ebr_thread_t *t = &ebr->threads[i];
+
+		for (j = 0; j < STRESS_EBR_EPOCHS; j++)
+			stress_ebr_limbo_free(ebr, t, &t->limbo[j]);
+	}
+}
+
+/*
+ *  stress_ebr_destroy()
+ *	free all retired objects and the domain, all threads must
+ *	have left their critical sections
+ */
+void stress_ebr_destroy(stress_ebr_t *ebr)
+{
+	size_t i, j;
+
+	if (!ebr->threads)
+		return;
+	stress_ebr_drain(ebr);
+	for (i = 0; i < ebr->n_threads; i++) {
+		for (j = 0; j < STRESS_EBR_EPOCHS; j++)
+			free((void *)ebr->threads[i].limbo[j].objs);
+	}
+	(void)munmap((void *)ebr->threads, ebr->n_threads * sizeof(*ebr->threads));
+	ebr->threads = NULL;
+	ebr->n_threads = 0;
+}
+
+/*
+ *  stress_ebr_stats_report()
+ *	report the rate, scaling and reclamation overhead of each
+ *	step of a thread scaling run and set the misc metrics for
+ *	the first and last steps, returns the next misc stats index
+ */
+size_t stress_ebr_stats_report(
+	const stress_args_t *args,
+	const char *desc,
+	const stress_ebr_stats_t *stats,
+	const uint32_t n_counts,
+	size_t idx)
+{
+	const stress_ebr_stats_t *s1 = &stats[0];
+	const stress_ebr_stats_t *sn = &stats[n_counts - 1];
+	const double rate1 = (s1->duration > 0.0) ? (double)s1->ops / s1->duration : 0.0;
+	uint32_t c;
+
+	if (args->instance == 0) {
+		bool lock = false;
+
+		pr_lock(&lock);
+		pr_inf_lock(&lock, "%s: %s:\n", args->name, desc);
+		pr_inf_lock(&lock, "%s: %7s %13s %9s %15s %11s\n", args->name,
+			"threads", "ops/sec", "scaling", "retired peak KB", "overhead %");
+		for (c = 0; c < n_counts; c++) {
+			const stress_ebr_stats_t *st = &stats[c];
+			double rate;
+
+			if ((st->duration <= 0.0) || (s1->duration <= 0.0))
+				continue;
+			rate = (double)st->ops / st->duration;
+			pr_inf_lock(&lock, "%s: %7" PRIu32 " %13.0f %8.2fx %15.1f %11.2f\n",
+				args->name, st->threads, rate,
+				rate1 > 0.0 ? rate / rate1 : 0.0,
+				(double)st->retired_peak / KB,
+				st->live ? 100.0 * (double)st->retired_peak / (double)st->live : 0.0);
+		}
+		pr_unlock(&lock);
+	}
+
+	if ((s1->duration > 0.0) && (sn->duration > 0.0)) {
+		idx = stress_misc_stats_thread_scaling(args->misc_stats, idx, "ops/sec",
+			s1->threads, rate1, sn->threads, (double)sn->ops / sn->duration);
+		stress_misc_stats_set(args->misc_stats, idx++, "retired peak KB",
+			(double)sn->retired_peak / KB);
+		stress_misc_stats_set(args->misc_stats, idx++, "reclaim overhead %",
+			sn->live ? 100.0 * (double)sn->retired_peak / (double)sn->live : 0.0);
+	}
+	return idx;
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_EBR_H
+#define CORE_EBR_H
+
+#define STRESS_EBR_MAX_THREADS	(256)	/* maximum threads in a domain */
+#define STRESS_EBR_EPOCHS	(3)	/* limbo lists per thread */
+#define STRESS_EBR_ADVANCE	(64)	/* retires between epoch advance attempts */
+#define STRESS_EBR_ACTIVE	(1ULL << 63)
+
+typedef void (*stress_ebr_free_t)(void *ptr);
+
+/* retired object */
+typedef struct {
+	void	*ptr;			/* object to free */
+	size_t	size;			/* object size in bytes */
+} stress_ebr_obj_t;
+
+/* retired objects waiting for a grace period */
+typedef struct {
+	stress_ebr_obj_t *objs;		/* retired objects */
+	size_t	n;			/* objects in the list */
+	size_t	max;			/* allocated list size */
+} stress_ebr_limbo_t;
+
+/* per thread state, one cache line each for the shared epoch */
+typedef struct {
+	uint64_t epoch;			/* observed epoch | ACTIVE, 0 = quiescent */
+	uint64_t seen;			/* last epoch limbo lists were freed for */
+	uint64_t retires;		/* objects retired */
+	uint64_t frees;			/* objects free'd */
+	size_t	pending;		/* bytes retired but not yet free'd */
+	size_t	pending_peak;		/* peak of pending */
+	stress_ebr_limbo_t limbo[STRESS_EBR_EPOCHS];
+} ALIGN64 stress_ebr_thread_t;
+
+/*
+ *  Epoch based reclamation domain; readers and writers enter
+ *  a critical section around each operation, unlinked objects
+ *  are retired and only free'd once every thread that could
+ *  still hold a reference to them has left its critical section
+ */
+typedef struct {
+	uint64_t epoch ALIGN64;		/* global epoch */
+	size_t	n_threads;		/* threads in the domain */
+	stress_ebr_free_t free_func;	/* frees a retired object */
+	stress_ebr_thread_t *threads;	/* per thread state */
+} stress_ebr_t;
+
+/* per step results of a thread scaling run over an ebr domain */
+typedef struct {
+	uint32_t threads;		/* thread count */
+	double	duration;		/* time of the step */
+	uint64_t ops;			/* operations completed */
+	size_t	retired_peak;		/* peak bytes awaiting reclamation */
+	size_t	live;			/* bytes in the structure after the step */
+} stress_ebr_stats_t;
+
+extern int stress_ebr_init(stress_ebr_t *ebr, const size_t n_threads,
+	stress_ebr_free_t free_func);
+extern void stress_ebr_enter(stress_ebr_t *ebr, const size_t tid);
+extern void stress_ebr_retire(stress_ebr_t *ebr, const size_t tid,
+	void *ptr, const size_t size);
+extern size_t stress_ebr_pending(stress_ebr_t *ebr);
+extern void stress_ebr_drain(stress_ebr_t *ebr);
+extern void stress_ebr_destroy(stress_ebr_t *ebr);
+extern size_t stress_ebr_stats_report(const stress_args_t *args,
+	const char *desc, const stress_ebr_stats_t *stats,
+	const uint32_t n_counts, size_t idx);
+
+/*
+ *  stress_ebr_exit()
+ *	leave a critical section, references to shared objects
+ *	must not be used after this
+ */
+static inline void stress_ebr_exit(stress_ebr_t *ebr, const size_t tid)
+{
+	__atomic_store_n(&ebr->threads[tid].epoch, 0, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,1171 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-fleet.h"
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#include <netdb.h>
+
+/*
+ *  The fleet protocol is line based text over TCP, the coordinator
+ *  connects to each agent and sends:
+ *
+ *	HELLO 1 [secret]	agent replies HELLO hostname version, or
+ *				DENIED and closes the connection if the
+ *				--fleet-secret does not match
+ *	TIME			agent replies TIME realtime, repeated to
+ *				estimate the agent clock offset
+ *	JOB length start	followed by length bytes of job file, start
+ *				is the run start time on the agent clock
+ *
+ *  the agent then runs the job and streams back:
+ *
+ *	STARTED lag		start time error of the agent in seconds
+ *	RATE elapsed stressor rate	per interval bogo-ops rate
+ *	TOTAL stressor bogo-ops rate	final totals of each stressor
+ *	EXIT status		exit status of the run
+ */
+#define DEFAULT_FLEET_PORT		"7475"
+#define DEFAULT_FLEET_DELAY		(5)	/* seconds */
+#define DEFAULT_FLEET_OUTLIER		(10.0)	/* percent */
+
+#define STRESS_FLEET_INTERVAL		(1.0)	/* seconds */
+#define STRESS_FLEET_TIMEOUT		(10000)	/* milliseconds */
+#define STRESS_FLEET_PINGS		(8)
+#define STRESS_FLEET_JOB_MAX		(1024 * 1024)
+#define STRESS_FLEET_NODES_MAX		(256)
+#define STRESS_FLEET_STRESSORS_MAX	(64)
+#define STRESS_FLEET_LINE_MAX		(512)
+#define STRESS_FLEET_SECRET_MAX		(128)
+
+#if defined(MSG_NOSIGNAL)
+#define STRESS_FLEET_SEND_FLAGS		(MSG_NOSIGNAL)
+#else
+#define STRESS_FLEET_SEND_FLAGS		(0)
+#endif
+
+static int32_t fleet_delay = DEFAULT_FLEET_DELAY;
+static double fleet_outlier = DEFAULT_FLEET_OUTLIER;
+static char fleet_secret[STRESS_FLEET_SECRET_MAX + 1];	/* empty = none */
+
+/*
+ *  stress_set_fleet_delay()
+ *	set the --fleet-delay time from job dispatch to the start
+ */
+int stress_set_fleet_delay(const char *const opt)
+{
+	fleet_delay = stress_get_int32(opt);
+	if ((fleet_delay < 1) || (fleet_delay > 3600)) {
+		(void)fprintf(stderr, "fleet-delay must in the range 1 to 3600.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_set_fleet_outlier()
+ *	set the --fleet-outlier percentage from the fleet median
+ */
+int stress_set_fleet_outlier(const char *const opt)
+{
+	if ((sscanf(opt, "%lf", &fleet_outlier) != 1) ||
+	    (fleet_outlier < 0.0) || (fleet_outlier > 100.0)) {
+		(void)fprintf(stderr, "fleet-outlier must be a percentage in the range 0 to 100.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_set_fleet_secret()
+ *	read the --fleet-secret shared by the coordinator and the
+ *	agents from the first line of a file only the owner can read
+ */
+int stress_set_fleet_secret(const char *const opt)
+{
+	struct stat statbuf;
+	char buf[STRESS_FLEET_SECRET_MAX + 2];
+	size_t len;
+	FILE *fp;
+
+	fp = fopen(opt, "r");
+	if (!fp) {
+		(void)fprintf(stderr, "fleet-secret: cannot open %s, errno=%d (%s).\n",
+			opt, errno, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+	if ((fstat(fileno(fp), &statbuf) == 0) && (statbuf.st_mode & (S_IRWXG | S_IRWXO))) {
+		(void)fprintf(stderr, "fleet-secret: %s must only be accessible by its owner.\n", opt);
+		(void)fclose(fp);
+		_exit(EXIT_FAILURE);
+	}
+	(void)memset(buf, 0, sizeof(buf));
+	if (!fgets(buf, sizeof(buf), fp))
+		buf[0] = '\0';
+	(void)fclose(fp);
+	buf[strcspn(buf, "\r\n")] = '\0';
+	len = strlen(buf);
+	if ((len == 0) || (len > STRESS_FLEET_SECRET_MAX) || (strcspn(buf, " \t") != len)) {
+		(void)fprintf(stderr, "fleet-secret: %s must hold a secret of 1 to %d "
+			"characters without spaces on its first line.\n",
+			opt, STRESS_FLEET_SECRET_MAX);
+		_exit(EXIT_FAILURE);
+	}
+	(void)shim_strlcpy(fleet_secret, buf, sizeof(fleet_secret));
+	return 0;
+}
+
+#if defined(HAVE_POLL_H)
+
+/* Per agent state of the coordinator */
+typedef struct {
+	char host[256];			/* agent host name or address */
+	char port[16];			/* agent port */
+	char name[64];			/* host name reported by the agent */
+	char addr[280];			/* host:port of the agent */
+	int fd;				/* connection, -1 = none */
+	double offset;			/* agent clock - coordinator clock */
+	double rtt;			/* round trip time of the best ping */
+	double lag;			/* start error reported by the agent */
+	int status;			/* exit status of the agent run */
+	bool done;			/* agent run has finished */
+	size_t len;			/* bytes of partial line in buf */
+	char buf[STRESS_FLEET_LINE_MAX];	/* partial line from the agent */
+	double rate[STRESS_FLEET_STRESSORS_MAX];	/* latest interval rate */
+	uint64_t ops[STRESS_FLEET_STRESSORS_MAX];	/* total bogo-ops */
+	double total[STRESS_FLEET_STRESSORS_MAX];	/* total bogo-ops rate */
+	bool reported[STRESS_FLEET_STRESSORS_MAX];	/* total received */
+} stress_fleet_node_t;
+
+static pid_t fleet_report_pid;			/* reporter process pid */
+static char fleet_names[STRESS_FLEET_STRESSORS_MAX][64];
+static double fleet_peak[STRESS_FLEET_STRESSORS_MAX];
+static size_t fleet_names_count;
+static double fleet_elapsed;			/* latest agent interval time */
+
+/*
+ *  stress_fleet_send()
+ *	send a formatted protocol line
+ */
+static int stress_fleet_send(const int fd, const char *fmt, ...) FORMAT(printf, 2, 3);
+
+static int stress_fleet_send(const int fd, const char *fmt, ...)
+{
+	char buf[STRESS_FLEET_LINE_MAX];
+	const char *ptr = buf;
+	va_list ap;
+	int ret;
+	size_t len;
+
+	va_start(ap, fmt);
+	ret = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if (ret < 0)
+		return -1;
+	len = ((size_t)ret >= sizeof(buf)) ? sizeof(buf) - 1 : (size_t)ret;
+
+	while (len > 0) {
+		const ssize_t n = send(fd, ptr, len, STRESS_FLEET_SEND_FLAGS);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		ptr += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+/*
+ *  stress_fleet_recv()
+ *	receive exactly len bytes, timeout is in milliseconds
+ */
+static int stress_fleet_recv(const int fd, char *buf, size_t len, const int timeout)
+{
+	while (len > 0) {
+		struct pollfd pfd;
+		ssize_t n;
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, timeout) <= 0)
+			return -1;
+		n = recv(fd, buf, len, 0);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0)
+			return -1;
+		buf += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+/*
+ *  stress_fleet_recv_line()
+ *	receive a newline terminated line, the newline is stripped
+ */
+static int stress_fleet_recv_line(const int fd, char *buf, const size_t len, const int timeout)
+{
+	size_t i;
+
+	for (i = 0; i < len - 1; i++) {
+		if (stress_fleet_recv(fd, buf + i, 1, timeout) < 0)
+			return -1;
+		if (buf[i] == '\n') {
+			buf[i] = '\0';
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ *  stress_fleet_agent_run()
+ *	write the job to a file and run it with a new stress-ng
+ *	process that reports back over the connection
+ */
+static int stress_fleet_agent_run(
+	const char *argv0,
+	const int fd,
+	const char *job,
+	const size_t job_len,
+	const double start)
+{
+	char filename[PATH_MAX], start_str[32], fd_str[16];
+	pid_t pid;
+	int job_fd, status;
+
+	/* a unique new file, never an existing file or symlink */
+	(void)snprintf(filename, sizeof(filename), "%s/stress-ng-fleet-XXXXXX",
+		stress_get_temp_path());
+	job_fd = mkstemp(filename);
+	if (job_fd < 0) {
+		pr_err("fleet-agent: cannot create %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (write(job_fd, job, job_len) != (ssize_t)job_len) {
+		pr_err("fleet-agent: cannot write %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		(void)close(job_fd);
+		(void)unlink(filename);
+		return EXIT_FAILURE;
+	}
+	(void)close(job_fd);
+
+	(void)snprintf(start_str, sizeof(start_str), "%.6f", start);
+	(void)snprintf(fd_str, sizeof(fd_str), "%d", fd);
+
+	pid = fork();
+	if (pid < 0) {
+		pr_err("fleet-agent: fork failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+		(void)unlink(filename);
+		return EXIT_FAILURE;
+	} else if (pid == 0) {
+		char *args[] = {
+			"stress-ng", "--job", filename,
+			"--fleet-start", start_str,
+			"--fleet-report-fd", fd_str,
+			NULL
+		};
+
+		(void)execv("/proc/self/exe", args);
+		(void)execvp(argv0, args);
+		pr_err("fleet-agent: cannot exec %s, errno=%d (%s)\n",
+			argv0, errno, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			status = 0;
+			break;
+		}
+	}
+	(void)unlink(filename);
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
+
+/*
+ *  stress_fleet_secret_ok()
+ *	check the secret sent by the coordinator, the time taken
+ *	does not depend on how much of the secret matches
+ */
+static bool stress_fleet_secret_ok(const char *secret)
+{
+	const size_t len = strlen(fleet_secret);
+	const size_t secret_len = strlen(secret);
+	unsigned char diff = (secret_len != len);
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		diff |= (unsigned char)fleet_secret[i] ^
+			(unsigned char)((i < secret_len) ? secret[i] : 0);
+	return diff == 0;
+}
+
+/*
+ *  stress_fleet_agent_session()
+ *	handle a coordinator connection, nothing but the greeting
+ *	is accepted until the coordinator has sent the secret
+ */
+static void stress_fleet_agent_session(const char *argv0, const int fd)
+{
+	char line[STRESS_FLEET_LINE_MAX];
+	char hostname[256];
+	bool authenticated = false;
+
+	if (gethostname(hostname, sizeof(hostname)) < 0)
+		(void)shim_strlcpy(hostname, "unknown", sizeof(hostname));
+	hostname[sizeof(hostname) - 1] = '\0';
+
+	while (stress_fleet_recv_line(fd, line, sizeof(line), STRESS_FLEET_TIMEOUT) == 0) {
+		size_t job_len;
+		double start;
+		char *job;
+		int ret;
+
+		if (!strncmp(line, "HELLO", 5)) {
+			char secret[STRESS_FLEET_LINE_MAX];
+
+			if (sscanf(line, "HELLO %*d %511s", secret) != 1)
+				*secret = '\0';
+			if (*fleet_secret && !stress_fleet_secret_ok(secret)) {
+				pr_inf("fleet-agent: coordinator sent the wrong secret, "
+					"connection refused\n");
+				/* slow down guessing */
+				(void)sleep(1);
+				(void)stress_fleet_send(fd, "DENIED\n");
+				return;
+			}
+			authenticated = true;
+			(void)stress_fleet_send(fd, "HELLO %s %s\n", hostname, VERSION);
+			continue;
+		}
+		if (!authenticated) {
+			pr_inf("fleet-agent: request before the greeting, connection closed\n");
+			return;
+		}
+		if (!strcmp(line, "TIME")) {
+			(void)stress_fleet_send(fd, "TIME %.6f\n", stress_time_now());
+			continue;
+		}
+		if ((sscanf(line, "JOB %zu %lf", &job_len, &start) != 2) ||
+		    (job_len > STRESS_FLEET_JOB_MAX)) {
+			pr_inf("fleet-agent: unexpected request '%s'\n", line);
+			return;
+		}
+		job = malloc(job_len + 1);
+		if (!job) {
+			pr_err("fleet-agent: cannot allocate %zu byte job\n", job_len);
+			return;
+		}
+		if (stress_fleet_recv(fd, job, job_len, STRESS_FLEET_TIMEOUT) < 0) {
+			pr_err("fleet-agent: failed to receive the job\n");
+			free(job);
+			return;
+		}
+		pr_inf("fleet-agent: running %zu byte job, starting in %.3f seconds\n",
+			job_len, start - stress_time_now());
+		ret = stress_fleet_agent_run(argv0, fd, job, job_len, start);
+		free(job);
+		pr_inf("fleet-agent: job finished, exit status %d\n", ret);
+		(void)stress_fleet_send(fd, "EXIT %d\n", ret);
+		return;
+	}
+}
+
+/*
+ *  stress_fleet_loopback()
+ *	true if the address is a loopback address
+ */
+static bool stress_fleet_loopback(const struct sockaddr *addr)
+{
+	if (addr->sa_family == AF_INET) {
+		const struct sockaddr_in *in = (const struct sockaddr_in *)addr;
+
+		return (ntohl(in->sin_addr.s_addr) >> 24) == 127;
+	}
+#if defined(AF_INET6)
+	if (addr->sa_family == AF_INET6) {
+		const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)addr;
+
+		return IN6_IS_ADDR_LOOPBACK(&in6->sin6_addr);
+	}
+#endif
+	return false;
+}
+
+/*
+ *  stress_fleet_agent()
+ *	wait for coordinator connections on [host:]port and run
+ *	the jobs they send, --fleet-agent. Just a port listens on
+ *	loopback, a host of * listens on all addresses. Listening
+ *	on anything but loopback requires a --fleet-secret
+ */
+int stress_fleet_agent(const char *argv0, const char *addr)
+{
+	struct addrinfo hints, *res, *ai;
+	char *str, *host = NULL, *port, *colon;
+	int fd = -1, ret;
+
+	str = strdup(addr);
+	if (!str) {
+		pr_err("fleet-agent: cannot allocate address\n");
+		return EXIT_FAILURE;
+	}
+	port = str;
+	colon = strrchr(str, ':');
+	if (colon) {
+		*colon = '\0';
+		host = str;
+		port = colon + 1;
+		/* IPv6 addresses are given as [addr]:port */
+		if ((*host == '[') && (host[strlen(host) - 1] == ']')) {
+			host[strlen(host) - 1] = '\0';
+			host++;
+		}
+	}
+
+	(void)memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	/* no host gets the IPv4 loopback address, * the wildcard ones */
+	if (host) {
+		hints.ai_flags = AI_PASSIVE;
+		if (!strcmp(host, "*"))
+			host = NULL;
+	} else {
+		hints.ai_family = AF_INET;
+	}
+
+	ret = getaddrinfo(host, port, &hints, &res);
+	if (ret) {
+		pr_err("fleet-agent: invalid address %s: %s\n", addr, gai_strerror(ret));
+		free(str);
+		return EXIT_FAILURE;
+	}
+	for (ai = res; ai; ai = ai->ai_next) {
+		int so_reuseaddr = 1;
+
+		if (!*fleet_secret && !stress_fleet_loopback(ai->ai_addr)) {
+			pr_err("fleet-agent: listening on %s requires a --fleet-secret, "
+				"anyone who can connect could run jobs\n", addr);
+			freeaddrinfo(res);
+			free(str);
+			return EXIT_FAILURE;
+		}
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+			continue;
+		/* don't leak the listening socket into the job runs */
+		(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+		(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+			&so_reuseaddr, sizeof(so_reuseaddr));
+		if ((bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) &&
+		    (listen(fd, 4) == 0))
+			break;
+		(void)close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	free(str);
+	if (fd < 0) {
+		pr_err("fleet-agent: cannot listen on %s, errno=%d (%s)\n",
+			addr, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	pr_inf("fleet-agent: listening on %s%s\n", addr,
+		strchr(addr, ':') ? "" : " (loopback only)");
+	for (;;) {
+		const int cfd = accept(fd, NULL, NULL);
+
+		if (cfd < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_err("fleet-agent: accept failed, errno=%d (%s)\n",
+				errno, strerror(errno));
+			break;
+		}
+		stress_fleet_agent_session(argv0, cfd);
+		(void)close(cfd);
+	}
+	(void)close(fd);
+
+	return EXIT_FAILURE;
+}
+
+/*
+ *  stress_fleet_start_wait()
+ *	wait until the --fleet-start time on an agent run so all
+ *	the hosts in the fleet start their stressors together
+ */
+void stress_fleet_start_wait(void)
+{
+	char *str = NULL;
+	int32_t fd = -1;
+	double start, delta;
+
+	if (!stress_get_setting("fleet-start", &str))
+		return;
+	if (sscanf(str, "%lf", &start) != 1)
+		return;
+
+	while (keep_stressing_flag()) {
+		delta = start - stress_time_now();
+		if (delta <= 0.0)
+			break;
+		(void)shim_nanosleep_uint64((uint64_t)(STRESS_MINIMUM(delta, 0.1) * STRESS_NANOSECOND));
+	}
+	delta = stress_time_now() - start;
+	pr_dbg("fleet: started %.6f seconds after the synchronized start time\n", delta);
+	if (stress_get_setting("fleet-report-fd", &fd))
+		(void)stress_fleet_send(fd, "STARTED %.6f\n", delta);
+}
+
+/*
+ *  stress_fleet_report_start()
+ *	start a process that sends the per stressor bogo-ops rate
+ *	to the coordinator every interval on an agent run
+ */
+void stress_fleet_report_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	uint64_t *prev_counters;
+	size_t n = 0;
+	int32_t fd = -1;
+	double time_start, time_prev, time_next;
+
+	if (!stress_get_setting("fleet-report-fd", &fd))
+		return;
+
+	time_start = stress_time_now();
+	fleet_report_pid = fork();
+	if ((fleet_report_pid < 0) || (fleet_report_pid > 0))
+		return;
+
+	stress_set_proc_name("stress-ng-fleet");
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n++;
+	prev_counters = calloc(n ? n : 1, sizeof(*prev_counters));
+	if (!prev_counters) {
+		pr_err("fleet: cannot allocate counter buffer\n");
+		_exit(EXIT_NO_RESOURCE);
+	}
+
+	time_prev = time_start;
+	time_next = time_start;
+
+	while (keep_stressing_flag()) {
+		double delta, time_now, dt;
+		uint64_t *prev;
+
+		time_next += STRESS_FLEET_INTERVAL;
+		delta = time_next - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_NANOSECOND));
+
+		time_now = stress_time_now();
+		dt = time_now - time_prev;
+		time_prev = time_now;
+
+		for (prev = prev_counters, ss = stressors_list; ss; ss = ss->next, prev++) {
+			uint64_t counter = 0;
+			int32_t j;
+
+			if (!ss->stats)
+				continue;
+			for (j = 0; j < ss->num_instances; j++)
+				counter += ss->stats[j]->ci.counter;
+			/* counters restart at zero on each --repeat run */
+			if ((dt > 0.0) && (stress_fleet_send(fd, "RATE %.3f %s %f\n",
+				time_now - time_start, stress_munge_underscore(ss->stressor->name),
+				(double)((counter >= *prev) ? counter - *prev : counter) / dt) < 0))
+				_exit(EXIT_FAILURE);
+			*prev = counter;
+		}
+	}
+	free(prev_counters);
+	_exit(0);
+}
+
+/*
+ *  stress_fleet_report_stop()
+ *	stop the reporter process and send the per stressor totals
+ */
+void stress_fleet_report_stop(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	int32_t fd = -1;
+
+	if (fleet_report_pid > 0) {
+		int status;
+
+		(void)kill(fleet_report_pid, SIGKILL);
+		(void)waitpid(fleet_report_pid, &status, 0);
+		fleet_report_pid = 0;
+	}
+	if (!stress_get_setting("fleet-report-fd", &fd))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t counter = 0;
+		double rate = 0.0;
+		int32_t j;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+			const double duration = stats->finish - stats->start;
+
+			counter += stats->ci.counter;
+			if (duration > 0.0)
+				rate += (double)stats->ci.counter / duration;
+		}
+		(void)stress_fleet_send(fd, "TOTAL %s %" PRIu64 " %f\n",
+			stress_munge_underscore(ss->stressor->name), counter, rate);
+	}
+}
+
+/*
+ *  stress_fleet_name_index()
+ *	map a stressor name to an index, -1 if the table is full
+ */
+static int stress_fleet_name_index(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < fleet_names_count; i++) {
+		if (!strcmp(fleet_names[i], name))
+			return (int)i;
+	}
+	if (fleet_names_count >= STRESS_FLEET_STRESSORS_MAX)
+		return -1;
+	(void)shim_strlcpy(fleet_names[i], name, sizeof(fleet_names[i]));
+	fleet_names_count++;
+	return (int)i;
+}
+
+/*
+ *  stress_fleet_connect()
+ *	connect to an agent, exchange greetings and estimate the
+ *	agent clock offset from the ping with the shortest round
+ *	trip time, much like an NTP client
+ */
+static int stress_fleet_connect(stress_fleet_node_t *node)
+{
+	struct addrinfo hints, *res, *ai;
+	char line[STRESS_FLEET_LINE_MAX];
+	int i, ret;
+
+	(void)memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	ret = getaddrinfo(node->host, node->port, &hints, &res);
+	if (ret) {
+		pr_err("fleet: cannot resolve %s: %s\n", node->host, gai_strerror(ret));
+		return -1;
+	}
+	for (ai = res; ai; ai = ai->ai_next) {
+		node->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (node->fd < 0)
+			continue;
+		if (connect(node->fd, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		(void)close(node->fd);
+		node->fd = -1;
+	}
+	freeaddrinfo(res);
+	if (node->fd < 0) {
+		pr_err("fleet: cannot connect to %s:%s, errno=%d (%s)\n",
+			node->host, node->port, errno, strerror(errno));
+		return -1;
+	}
+
+	if ((stress_fleet_send(node->fd, "HELLO 1%s%s\n",
+			*fleet_secret ? " " : "", fleet_secret) < 0) ||
+	    (stress_fleet_recv_line(node->fd, line, sizeof(line), STRESS_FLEET_TIMEOUT) < 0)) {
+		pr_err("fleet: %s:%s is not a stress-ng fleet agent\n",
+			node->host, node->port);
+		return -1;
+	}
+	if (!strcmp(line, "DENIED")) {
+		pr_err("fleet: %s:%s refused the connection, check the --fleet-secret\n",
+			node->host, node->port);
+		return -1;
+	}
+	if (sscanf(line, "HELLO %63s", node->name) != 1) {
+		pr_err("fleet: %s:%s is not a stress-ng fleet agent\n",
+			node->host, node->port);
+		return -1;
+	}
+
+	node->rtt = -1.0;
+	for (i = 0; i < STRESS_FLEET_PINGS; i++) {
+		double t0, t1, agent_time;
+
+		t0 = stress_time_now();
+		if ((stress_fleet_send(node->fd, "TIME\n") < 0) ||
+		    (stress_fleet_recv_line(node->fd, line, sizeof(line), STRESS_FLEET_TIMEOUT) < 0) ||
+		    (sscanf(line, "TIME %lf", &agent_time) != 1)) {
+			pr_err("fleet: clock offset exchange with %s:%s failed\n",
+				node->host, node->port);
+			return -1;
+		}
+		t1 = stress_time_now();
+		if ((node->rtt < 0.0) || ((t1 - t0) < node->rtt)) {
+			node->rtt = t1 - t0;
+			node->offset = agent_time - ((t0 + t1) / 2.0);
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_fleet_line()
+ *	handle a line streamed back from an agent run
+ */
+static void stress_fleet_line(stress_fleet_node_t *node, const char *line, bool *updated)
+{
+	char name[64];
+	double value, elapsed;
+	uint64_t ops;
+	int idx;
+
+	if (sscanf(line, "RATE %lf %63s %lf", &elapsed, name, &value) == 3) {
+		idx = stress_fleet_name_index(name);
+		if (idx >= 0) {
+			node->rate[idx] = value;
+			if (elapsed > fleet_elapsed)
+				fleet_elapsed = elapsed;
+			*updated = true;
+		}
+	} else if (sscanf(line, "TOTAL %63s %" SCNu64 " %lf", name, &ops, &value) == 3) {
+		idx = stress_fleet_name_index(name);
+		if (idx >= 0) {
+			node->rate[idx] = 0.0;
+			node->ops[idx] = ops;
+			node->total[idx] = value;
+			node->reported[idx] = true;
+		}
+	} else if (sscanf(line, "STARTED %lf", &value) == 1) {
+		node->lag = value;
+	} else if (sscanf(line, "EXIT %d", &node->status) == 1) {
+		node->done = true;
+	}
+}
+
+/*
+ *  stress_fleet_read()
+ *	read streamed data from an agent, returns -1 when the
+ *	connection is closed
+ */
+static int stress_fleet_read(stress_fleet_node_t *node, bool *updated)
+{
+	char *ptr, *nl;
+	ssize_t n;
+
+	n = recv(node->fd, node->buf + node->len, sizeof(node->buf) - node->len - 1, 0);
+	if (n < 0)
+		return (errno == EINTR) ? 0 : -1;
+	if (n == 0)
+		return -1;
+	node->len += (size_t)n;
+	node->buf[node->len] = '\0';
+
+	for (ptr = node->buf; (nl = strchr(ptr, '\n')) != NULL; ptr = nl + 1) {
+		*nl = '\0';
+		stress_fleet_line(node, ptr, updated);
+	}
+	node->len -= (size_t)(ptr - node->buf);
+	(void)memmove(node->buf, ptr, node->len);
+	/* drop over long lines */
+	if (node->len >= sizeof(node->buf) - 1)
+		node->len = 0;
+	return 0;
+}
+
+/*
+ *  stress_fleet_interval()
+ *	report the fleet throughput of each stressor over the
+ *	last interval
+ */
+static void stress_fleet_interval(stress_fleet_node_t *nodes, const size_t n_nodes)
+{
+	size_t i, j;
+
+	for (i = 0; i < fleet_names_count; i++) {
+		double rate = 0.0;
+		size_t active = 0;
+
+		for (j = 0; j < n_nodes; j++) {
+			rate += nodes[j].rate[i];
+			active += (nodes[j].rate[i] > 0.0);
+		}
+		if (rate > fleet_peak[i])
+			fleet_peak[i] = rate;
+		pr_inf("fleet: %7.1fs %-14s %14.2f bogo-ops/s on %zu of %zu nodes\n",
+			fleet_elapsed, fleet_names[i], rate, active, n_nodes);
+	}
+}
+
+/*
+ *  stress_fleet_cmp()
+ *	sort doubles into ascending order
+ */
+static int stress_fleet_cmp(const void *p1, const void *p2)
+{
+	const double d1 = *(const double *)p1;
+	const double d2 = *(const double *)p2;
+
+	if (d1 < d2)
+		return -1;
+	return d1 > d2;
+}
+
+/*
+ *  stress_fleet_summary()
+ *	report the per node totals, flag nodes that are more than
+ *	--fleet-outlier percent from the fleet median
+ */
+static int stress_fleet_summary(
+	stress_fleet_node_t *nodes,
+	const size_t n_nodes,
+	FILE *yaml)
+{
+	double *rates;
+	size_t i, j;
+	int outliers = 0;
+
+	rates = calloc(n_nodes, sizeof(*rates));
+	if (!rates) {
+		pr_err("fleet: cannot allocate rate buffer\n");
+		return 0;
+	}
+
+	pr_yaml(yaml, "fleet:\n");
+	pr_inf("fleet: %-24s %-14s %14s %14s %9s\n",
+		"node", "stressor", "bogo-ops", "bogo-ops/s", "vs median");
+	for (i = 0; i < fleet_names_count; i++) {
+		double median, sum = 0.0;
+		uint64_t ops = 0;
+		size_t n = 0;
+
+		for (j = 0; j < n_nodes; j++) {
+			if (nodes[j].reported[i])
+				rates[n++] = nodes[j].total[i];
+		}
+		if (!n)
+			continue;
+		qsort(rates, n, sizeof(*rates), stress_fleet_cmp);
+		median = (n & 1) ? rates[n / 2] : (rates[(n / 2) - 1] + rates[n / 2]) / 2.0;
+
+		pr_yaml(yaml, "    - stressor: %s\n", fleet_names[i]);
+		pr_yaml(yaml, "      median-bogo-ops-per-second: %f\n", median);
+		pr_yaml(yaml, "      peak-fleet-bogo-ops-per-second: %f\n", fleet_peak[i]);
+		pr_yaml(yaml, "      nodes:\n");
+		for (j = 0; j < n_nodes; j++) {
+			const stress_fleet_node_t *node = &nodes[j];
+			const double dev = (median > 0.0) ?
+				100.0 * (node->total[i] - median) / median : 0.0;
+			const bool outlier = fabs(dev) > fleet_outlier;
+
+			if (!node->reported[i])
+				continue;
+			ops += node->ops[i];
+			sum += node->total[i];
+			pr_inf("fleet: %-24s %-14s %14" PRIu64 " %14.2f %+8.1f%%%s\n",
+				node->addr, fleet_names[i], node->ops[i],
+				node->total[i], dev, outlier ? " outlier" : "");
+			pr_yaml(yaml, "        - node: %s\n", node->name);
+			pr_yaml(yaml, "          bogo-ops: %" PRIu64 "\n", node->ops[i]);
+			pr_yaml(yaml, "          bogo-ops-per-second: %f\n", node->total[i]);
+			pr_yaml(yaml, "          deviation-percent: %f\n", dev);
+			pr_yaml(yaml, "          outlier: %s\n", outlier ? "true" : "false");
+			outliers += outlier;
+		}
+		pr_inf("fleet: %-24s %-14s %14" PRIu64 " %14.2f\n",
+			"total", fleet_names[i], ops, sum);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", ops);
+		pr_yaml(yaml, "      bogo-ops-per-second: %f\n", sum);
+	}
+	free(rates);
+
+	pr_yaml(yaml, "fleet-nodes:\n");
+	for (j = 0; j < n_nodes; j++) {
+		const stress_fleet_node_t *node = &nodes[j];
+
+		pr_yaml(yaml, "    - node: %s\n", node->name);
+		pr_yaml(yaml, "      address: %s\n", node->addr);
+		pr_yaml(yaml, "      clock-offset: %f\n", node->offset);
+		pr_yaml(yaml, "      round-trip-time: %f\n", node->rtt);
+		pr_yaml(yaml, "      start-lag: %f\n", node->lag);
+		pr_yaml(yaml, "      exit-status: %d\n", node->status);
+	}
+	if (outliers)
+		pr_warn("fleet: %d node stressor result%s more than %.1f%% from the fleet median\n",
+			outliers, outliers == 1 ? " is" : "s are", fleet_outlier);
+	return outliers;
+}
+
+/*
+ *  stress_fleet_parse_hosts()
+ *	parse a comma separated list of host:port agents, IPv6
+ *	addresses can be given as [addr]:port
+ */
+static size_t stress_fleet_parse_hosts(const char *hosts, stress_fleet_node_t *nodes)
+{
+	char *str, *tok, *saveptr = NULL;
+	size_t n = 0;
+
+	str = strdup(hosts);
+	if (!str)
+		return 0;
+	for (tok = strtok_r(str, ",", &saveptr); tok && (n < STRESS_FLEET_NODES_MAX);
+	     tok = strtok_r(NULL, ",", &saveptr)) {
+		stress_fleet_node_t *node = &nodes[n];
+		char *colon = strrchr(tok, ':');
+		char *end;
+
+		if ((*tok == '[') && ((end = strchr(tok, ']')) != NULL)) {
+			*end = '\0';
+			colon = (end[1] == ':') ? end + 1 : NULL;
+			tok++;
+		} else if (colon && (strchr(tok, ':') != colon)) {
+			colon = NULL;	/* bare IPv6 address */
+		}
+		if (colon)
+			*colon = '\0';
+		(void)shim_strlcpy(node->host, tok, sizeof(node->host));
+		(void)shim_strlcpy(node->port, colon ? colon + 1 : DEFAULT_FLEET_PORT,
+			sizeof(node->port));
+		(void)snprintf(node->name, sizeof(node->name), "%s", node->host);
+		(void)snprintf(node->addr, sizeof(node->addr), "%s:%s", node->host, node->port);
+		node->fd = -1;
+		node->status = -1;
+		n++;
+	}
+	free(str);
+	return n;
+}
+
+/*
+ *  stress_fleet_coordinator()
+ *	send the job file to all the agents with a common start
+ *	time, aggregate the fleet throughput as the agents stream
+ *	back their metrics and flag outlier nodes, --fleet
+ */
+int stress_fleet_coordinator(const char *hosts, const char *job_filename, FILE *yaml)
+{
+	stress_fleet_node_t *nodes;
+	struct pollfd *pfds;
+	size_t i, n_nodes, running;
+	char *job;
+	ssize_t job_len;
+	double start, time_next;
+	int fd, ret = EXIT_SUCCESS;
+	bool updated = false;
+
+	if (!job_filename) {
+		pr_err("fleet: a job file must be specified with --job\n");
+		return EXIT_FAILURE;
+	}
+	fd = open(job_filename, O_RDONLY);
+	if (fd < 0) {
+		pr_err("fleet: cannot open job file %s, errno=%d (%s)\n",
+			job_filename, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	job = malloc(STRESS_FLEET_JOB_MAX);
+	if (!job) {
+		pr_err("fleet: cannot allocate job buffer\n");
+		(void)close(fd);
+		return EXIT_NO_RESOURCE;
+	}
+	job_len = read(fd, job, STRESS_FLEET_JOB_MAX);
+	(void)close(fd);
+	if (job_len < 0) {
+		pr_err("fleet: cannot read job file %s, errno=%d (%s)\n",
+			job_filename, errno, strerror(errno));
+		free(job);
+		return EXIT_FAILURE;
+	}
+
+	nodes = calloc(STRESS_FLEET_NODES_MAX, sizeof(*nodes));
+	pfds = calloc(STRESS_FLEET_NODES_MAX, sizeof(*pfds));
+	if (!nodes || !pfds) {
+		pr_err("fleet: cannot allocate node table\n");
+		free(pfds);
+		free(nodes);
+		free(job);
+		return EXIT_NO_RESOURCE;
+	}
+	n_nodes = stress_fleet_parse_hosts(hosts, nodes);
+	if (!n_nodes) {
+		pr_err("fleet: no agents specified\n");
+		ret = EXIT_FAILURE;
+		goto free_all;
+	}
+
+	for (i = 0; i < n_nodes; i++) {
+		if (stress_fleet_connect(&nodes[i]) < 0) {
+			ret = EXIT_FAILURE;
+			goto close_all;
+		}
+		pr_inf("fleet: agent %s (%s) clock offset %.3f ms, round trip %.3f ms\n",
+			nodes[i].addr, nodes[i].name,
+			nodes[i].offset * 1000.0, nodes[i].rtt * 1000.0);
+	}
+
+	start = stress_time_now() + (double)fleet_delay;
+	for (i = 0; i < n_nodes; i++) {
+		stress_fleet_node_t *node = &nodes[i];
+
+		if ((stress_fleet_send(node->fd, "JOB %zd %.6f\n",
+			job_len, start + node->offset) < 0) ||
+		    (send(node->fd, job, (size_t)job_len, STRESS_FLEET_SEND_FLAGS) != job_len)) {
+			pr_err("fleet: cannot send job to %s, errno=%d (%s)\n",
+				node->addr, errno, strerror(errno));
+			ret = EXIT_FAILURE;
+			goto close_all;
+		}
+	}
+	pr_inf("fleet: dispatched %s to %zu agent%s, starting in %d seconds\n",
+		job_filename, n_nodes, n_nodes == 1 ? "" : "s", fleet_delay);
+
+	/* report midway between the agent interval updates */
+	time_next = start + (STRESS_FLEET_INTERVAL * 1.5);
+	for (running = n_nodes; running > 0; ) {
+		const double now = stress_time_now();
+		int timeout = (int)((time_next - now) * 1000.0);
+		size_t n = 0;
+
+		if (timeout <= 0) {
+			if (updated)
+				stress_fleet_interval(nodes, n_nodes);
+			updated = false;
+			time_next += STRESS_FLEET_INTERVAL;
+			continue;
+		}
+		for (i = 0; i < n_nodes; i++) {
+			if (nodes[i].fd < 0)
+				continue;
+			pfds[n].fd = nodes[i].fd;
+			pfds[n].events = POLLIN;
+			pfds[n].revents = 0;
+			n++;
+		}
+		if (poll(pfds, n, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_err("fleet: poll failed, errno=%d (%s)\n",
+				errno, strerror(errno));
+			ret = EXIT_FAILURE;
+			break;
+		}
+		for (n = 0, i = 0; i < n_nodes; i++) {
+			stress_fleet_node_t *node = &nodes[i];
+
+			if (node->fd < 0)
+				continue;
+			if (!pfds[n++].revents)
+				continue;
+			if ((stress_fleet_read(node, &updated) < 0) || node->done) {
+				if (!node->done)
+					pr_err("fleet: lost connection to %s\n", node->addr);
+				(void)close(node->fd);
+				node->fd = -1;
+				running--;
+			}
+		}
+	}
+
+	(void)stress_fleet_summary(nodes, n_nodes, yaml);
+	for (i = 0; i < n_nodes; i++) {
+		if (nodes[i].status != EXIT_SUCCESS) {
+			pr_err("fleet: agent %s run failed, exit status %d\n",
+				nodes[i].addr, nodes[i].status);
+			ret = EXIT_FAILURE;
+		}
+	}
+
+close_all:
+	for (i = 0; i < n_nodes; i++) {
+		if (nodes[i].fd >= 0)
+			(void)close(nodes[i].fd);
+	}
+free_all:
+	free(pfds);
+	free(nodes);
+	free(job);
+
+	return ret;
+}
+
+#else
+
+int stress_fleet_agent(const char *argv0, const char *addr)
+{
+	(void)argv0;
+	(void)addr;
+
+	pr_err("fleet-agent: not supported on this system\n");
+	return EXIT_NOT_SUPPORTED;
+}
+
+int stress_fleet_coordinator(const char *hosts, const char *job_filename, FILE *yaml)
+{
+	(void)hosts;
+	(void)job_filename;
+	(void)yaml;
+
+	pr_err("fleet: not supported on this system\n");
+	return EXIT_NOT_SUPPORTED;
+}
+
+void stress_fleet_start_wait(void)
+{
+}
+
+void stress_fleet_report_start(stress_stressor_t *stressors_list)
+{
+	(void)stressors_list;
+}
+
+void stress_fleet_report_stop(stress_stressor_t *stressors_list)
+{
+	(void)stressors_list;
+}
+
+#endif
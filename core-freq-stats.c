@@ -0,0 +1,264 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+#include "core-freq-stats.h"
+#include "core-perf.h"
+
+#define FREQ_PACKAGES_MAX	(256)
+
+/*
+ *  stress_freq_read_uint64()
+ *	read a decimal counter from a sysfs file, 0 if it
+ *	cannot be read
+ */
+static uint64_t stress_freq_read_uint64(const char *path)
+{
+	char buf[64];
+
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return 0;
+	return (uint64_t)strtoull(buf, NULL, 10);
+}
+
+/*
+ *  stress_freq_cpu_read()
+ *	read a per CPU sysfs counter
+ */
+static uint64_t stress_freq_cpu_read(const int32_t cpu, const char *name)
+{
+	char path[PATH_MAX];
+
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%" PRId32 "/%s", cpu, name);
+	return stress_freq_read_uint64(path);
+}
+
+/*
+ *  stress_freq_throttles()
+ *	sum the thermal and power limit throttle events of the
+ *	CPUs, and of their packages, that the calling process
+ *	is allowed to run on
+ */
+static void stress_freq_throttles(uint64_t *core, uint64_t *package)
+{
+	const int32_t cpus = stress_get_processors_configured();
+	bool seen[FREQ_PACKAGES_MAX];
+	int32_t cpu;
+#if defined(HAVE_SCHED_GETAFFINITY)
+	cpu_set_t mask;
+	const bool masked = (sched_getaffinity(0, sizeof(mask), &mask) == 0);
+#endif
+
+	*core = 0;
+	*package = 0;
+	(void)memset(seen, 0, sizeof(seen));
+
+	for (cpu = 0; cpu < cpus; cpu++) {
+		uint64_t id;
+
+#if defined(HAVE_SCHED_GETAFFINITY)
+		if (masked && (cpu < CPU_SETSIZE) && !CPU_ISSET((int)cpu, &mask))
+			continue;
+#endif
+		*core += stress_freq_cpu_read(cpu, "thermal_throttle/core_throttle_count");
+		*core += stress_freq_cpu_read(cpu, "thermal_throttle/core_power_limit_count");
+
+		/* package counters are shared by all the CPUs of a package */
+		id = stress_freq_cpu_read(cpu, "topology/physical_package_id");
+		if ((id >= FREQ_PACKAGES_MAX) || seen[id])
+			continue;
+		seen[id] = true;
+		*package += stress_freq_cpu_read(cpu, "thermal_throttle/package_throttle_count");
+		*package += stress_freq_cpu_read(cpu, "thermal_throttle/package_power_limit_count");
+	}
+}
+
+/*
+ *  stress_freq_cpu_ns()
+ *	CPU time of the calling thread in nanoseconds
+ */
+static uint64_t stress_freq_cpu_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_THREAD_CPUTIME_ID)
+	return stress_clock_id_ns(CLOCK_THREAD_CPUTIME_ID);
+#else
+	return 0;
+#endif
+}
+
+/*
+ *  stress_freq_khz()
+ *	current frequency of the CPU the caller is running on
+ */
+static uint64_t stress_freq_khz(void)
+{
+	return stress_freq_cpu_read((int32_t)stress_get_cpu(), "cpufreq/scaling_cur_freq");
+}
+
+/*
+ *  stress_freq_stats_begin()
+ *	start counting the CPU cycles of the calling thread and
+ *	read the throttle counters at the start of an instance
+ */
+void stress_freq_stats_begin(stress_freq_state_t *state)
+{
+	(void)memset(state, 0, sizeof(*state));
+	state->cycles_fd = -1;
+#if defined(STRESS_PERF_STATS)
+	state->cycles_fd = stress_perf_cycles_open();
+	if ((state->cycles_fd >= 0) &&
+	    (stress_perf_cycles_read(state->cycles_fd, &state->cycles) < 0)) {
+		(void)close(state->cycles_fd);
+		state->cycles_fd = -1;
+	}
+#endif
+	state->cpu_ns = stress_freq_cpu_ns();
+	state->khz = stress_freq_khz();
+	stress_freq_throttles(&state->core_throttles, &state->package_throttles);
+}
+
+/*
+ *  stress_freq_stats_end()
+ *	compute the effective frequency of an instance from the
+ *	cycles per CPU time, or sample the CPU frequency if there
+ *	is no cycles counter, and count the throttle events
+ */
+void stress_freq_stats_end(stress_freq_state_t *state, stress_freq_stats_t *fs)
+{
+	uint64_t core, package, khz;
+
+	(void)memset(fs, 0, sizeof(*fs));
+#if defined(STRESS_PERF_STATS)
+	if (state->cycles_fd >= 0) {
+		const uint64_t cpu_ns = stress_freq_cpu_ns();
+		uint64_t cycles;
+
+		if ((stress_perf_cycles_read(state->cycles_fd, &cycles) == 0) &&
+		    (cycles > state->cycles) && (cpu_ns > state->cpu_ns)) {
+			fs->cycles = cycles - state->cycles;
+			fs->cpu_ns = cpu_ns - state->cpu_ns;
+			fs->ghz = (double)fs->cycles / (double)fs->cpu_ns;
+			fs->cycles_valid = true;
+		}
+		(void)close(state->cycles_fd);
+		state->cycles_fd = -1;
+	}
+#endif
+	if (!fs->cycles_valid) {
+		khz = stress_freq_khz();
+		if (state->khz && khz)
+			fs->ghz = ((double)(state->khz + khz) / 2.0) / 1000000.0;
+		else
+			fs->ghz = (double)(state->khz + khz) / 1000000.0;
+	}
+
+	stress_freq_throttles(&core, &package);
+	fs->core_throttles = (core > state->core_throttles) ? core - state->core_throttles : 0;
+	fs->package_throttles = (package > state->package_throttles) ?
+		package - state->package_throttles : 0;
+	fs->valid = true;
+}
+
+/*
+ *  stress_freq_stats_dump()
+ *	report the effective CPU frequency spread of the instances
+ *	of each stressor, the throttle events and the bogo-ops
+ *	per billion CPU cycles
+ */
+void stress_freq_stats_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_FREQ_STATS))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t cycles = 0, c_total = 0, core = 0, package = 0;
+		double ghz_total = 0.0, ghz_min = 0.0, ghz_max = 0.0, ops_per_gcycle;
+		int32_t j, n = 0;
+		bool cycles_valid = true;
+		const char *munged;
+
+		if (!ss->stats)
+			continue;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_freq_stats_t *fs = &ss->stats[j]->freq;
+
+			if (!fs->valid)
+				continue;
+			if ((n == 0) || (fs->ghz < ghz_min))
+				ghz_min = fs->ghz;
+			if (fs->ghz > ghz_max)
+				ghz_max = fs->ghz;
+			ghz_total += fs->ghz;
+			cycles += fs->cycles;
+			cycles_valid &= fs->cycles_valid;
+			c_total += ss->stats[j]->ci.counter;
+			/* instances that share CPUs see the same events */
+			core = STRESS_MAXIMUM(core, fs->core_throttles);
+			package = STRESS_MAXIMUM(package, fs->package_throttles);
+			n++;
+		}
+		if (!n)
+			continue;
+
+		if (!header) {
+			pr_inf("freq-stats: effective CPU frequency of the instances of each stressor:\n");
+			pr_inf("%-13s %7s %7s %7s %9s %9s %11s\n",
+				"stressor", "GHz", "min GHz", "max GHz",
+				"core thr", "pkg thr", "ops/Gcycle");
+			pr_yaml(yaml, "freq-stats:\n");
+			header = true;
+		}
+		munged = stress_munge_underscore(ss->stressor->name);
+		ops_per_gcycle = (cycles_valid && cycles) ?
+			((double)c_total * 1000000000.0) / (double)cycles : 0.0;
+
+		if (cycles_valid) {
+			pr_inf("%-13s %7.3f %7.3f %7.3f %9" PRIu64 " %9" PRIu64 " %11.3f\n",
+				munged, ghz_total / (double)n, ghz_min, ghz_max,
+				core, package, ops_per_gcycle);
+		} else if (ghz_max > 0.0) {
+			pr_inf("%-13s %7.3f %7.3f %7.3f %9" PRIu64 " %9" PRIu64 " %11s\n",
+				munged, ghz_total / (double)n, ghz_min, ghz_max,
+				core, package, "-");
+		} else {
+			/* neither a cycles counter nor cpufreq is available */
+			pr_inf("%-13s %7s %7s %7s %9" PRIu64 " %9" PRIu64 " %11s\n",
+				munged, "-", "-", "-", core, package, "-");
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		if (ghz_max > 0.0) {
+			pr_yaml(yaml, "      ghz: %f\n", ghz_total / (double)n);
+			pr_yaml(yaml, "      ghz-min: %f\n", ghz_min);
+			pr_yaml(yaml, "      ghz-max: %f\n", ghz_max);
+		}
+		pr_yaml(yaml, "      core-throttles: %" PRIu64 "\n", core);
+		pr_yaml(yaml, "      package-throttles: %" PRIu64 "\n", package);
+		if (cycles_valid) {
+			pr_yaml(yaml, "      cycles: %" PRIu64 "\n", cycles);
+			pr_yaml(yaml, "      bogo-ops-per-gigacycle: %f\n", ops_per_gcycle);
+		}
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+}
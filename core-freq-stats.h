@@ -0,0 +1,37 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_FREQ_STATS_H
+#define CORE_FREQ_STATS_H
+
+/* counters at the start of an instance run, --freq-stats */
+typedef struct {
+	int cycles_fd;			/* CPU cycles counter, -1 = none */
+	uint64_t cycles;		/* CPU cycles */
+	uint64_t cpu_ns;		/* thread CPU time */
+	uint64_t core_throttles;	/* core throttle events */
+	uint64_t package_throttles;	/* package throttle events */
+	uint64_t khz;			/* scaling_cur_freq of the current CPU */
+} stress_freq_state_t;
+
+extern void stress_freq_stats_begin(stress_freq_state_t *state);
+extern void stress_freq_stats_end(stress_freq_state_t *state,
+	stress_freq_stats_t *fs);
+extern void stress_freq_stats_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
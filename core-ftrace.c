@@ -21,49 +21,222 @@
 #include "core-capabilities.h"
 #include "core-ftrace.h"
 
-#if defined(HAVE_SYS_TREE_H)
-#include <sys/tree.h>
-#endif
-
 #if defined(HAVE_SYS_STATFS_H)
 #include <sys/statfs.h>
 #endif
 
-#if defined(HAVE_BSD_SYS_TREE_H)
-#include <bsd/sys/tree.h>
-#endif
+#define DEFAULT_FTRACE_TOP	(10)	/* hottest functions reported */
 
-#if defined(HAVE_LIB_BSD) &&	\
-    defined(__linux__)
+/* profile of one kernel function */
+typedef struct {
+	char *func_name;	/* ftrace'd kernel function name */
+	int64_t count;		/* number of calls to func */
+	double time_us;		/* time used by func in microsecs */
+} stress_ftrace_func_t;
+
+/* sorted list of function profiles */
+typedef struct {
+	stress_ftrace_func_t *funcs;	/* functions sorted by name */
+	size_t n;			/* number of functions */
+} stress_ftrace_funcs_t;
+
+/* kernel function profile of the stressors of a run */
+typedef struct {
+	char name[128];			/* stressor, names joined by + in parallel runs */
+	uint64_t bogo_ops;		/* bogo-ops of all the runs */
+	double syscall_us;		/* time in system call functions */
+	stress_ftrace_funcs_t funcs;	/* accumulated function profile */
+} stress_ftrace_profile_t;
+
+static int32_t ftrace_top = DEFAULT_FTRACE_TOP;
+static stress_ftrace_profile_t *ftrace_profiles;	/* per stressor profiles */
+static size_t ftrace_profiles_n;
+static stress_ftrace_profile_t *ftrace_baseline;	/* --ftrace-baseline profiles */
+static size_t ftrace_baseline_n;
 
-#define MAX_MOUNTS	(256)
-#if !defined(DEBUGFS_MAGIC)
-#define DEBUGFS_MAGIC	(0x64626720)
-#endif
+/*
+ *  stress_set_ftrace_top()
+ *	set the number of hottest functions reported per stressor
+ */
+int stress_set_ftrace_top(const char *const opt)
+{
+	ftrace_top = stress_get_int32(opt);
+	if ((ftrace_top < 1) || (ftrace_top > 1000)) {
+		(void)fprintf(stderr, "ftrace-top must be in the range 1 to 1000.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
 
-struct rb_node {
-	RB_ENTRY(rb_node) rb;	/* red/black node entry */
-	char *func_name;	/* ftrace'd kernel function name */
-	int64_t start_count;	/* start number of calls to func */
-	int64_t end_count;	/* end number of calls to func */
-	double	start_time_us;	/* start time used by func in microsecs */
-	double	end_time_us;	/* end time used by func microsecs */
-};
+/*
+ *  stress_ftrace_funcs_free()
+ *	free a function profile list
+ */
+static void stress_ftrace_funcs_free(stress_ftrace_funcs_t *list)
+{
+	size_t i;
 
-static bool tracing_enabled;
+	for (i = 0; i < list->n; i++)
+		free(list->funcs[i].func_name);
+	free(list->funcs);
+	list->funcs = NULL;
+	list->n = 0;
+}
 
 /*
- *  rb_node_cmp()
- *	used for sorting functions by name
+ *  stress_ftrace_funcs_add()
+ *	append a function to a list, returns -1 if out of memory
  */
-static int rb_node_cmp(struct rb_node *n1, struct rb_node *n2)
+static int stress_ftrace_funcs_add(
+	stress_ftrace_funcs_t *list,
+	const char *func_name,
+	const int64_t count,
+	const double time_us)
 {
-	return strcmp(n1->func_name, n2->func_name);
+	stress_ftrace_func_t *funcs, *func;
+
+	funcs = realloc(list->funcs, (list->n + 1) * sizeof(*funcs));
+	if (!funcs)
+		return -1;
+	list->funcs = funcs;
+	func = &funcs[list->n];
+	func->func_name = strdup(func_name);
+	if (!func->func_name)
+		return -1;
+	func->count = count;
+	func->time_us = time_us;
+	list->n++;
+	return 0;
+}
+
+/*
+ *  stress_ftrace_profile_find()
+ *	find a profile by name, optionally adding it
+ */
+static stress_ftrace_profile_t *stress_ftrace_profile_find(
+	stress_ftrace_profile_t **profiles,
+	size_t *n,
+	const char *name,
+	const bool add)
+{
+	stress_ftrace_profile_t *profile;
+	size_t i;
+
+	for (i = 0; i < *n; i++) {
+		if (!strcmp((*profiles)[i].name, name))
+			return &(*profiles)[i];
+	}
+	if (!add)
+		return NULL;
+	profile = realloc(*profiles, (*n + 1) * sizeof(*profile));
+	if (!profile)
+		return NULL;
+	*profiles = profile;
+	profile = &profile[(*n)++];
+	(void)memset(profile, 0, sizeof(*profile));
+	(void)shim_strlcpy(profile->name, name, sizeof(profile->name));
+	return profile;
+}
+
+/*
+ *  stress_ftrace_baseline_value()
+ *	parse "key: value" lines, returns true if the
+ *	line starts with key after leading blanks
+ */
+static bool stress_ftrace_baseline_value(const char *line, const char *key, const char **value)
+{
+	const size_t len = strlen(key);
+
+	while (*line == ' ')
+		line++;
+	if (strncmp(line, key, len))
+		return false;
+	*value = line + len;
+	while (**value == ' ')
+		(*value)++;
+	return true;
+}
+
+/*
+ *  stress_set_ftrace_baseline()
+ *	load the per stressor function profiles from the ftrace
+ *	section of a stress-ng --ftrace --yaml file, the per bogo-op
+ *	times are kept in the time_us and syscall_us fields
+ */
+int stress_set_ftrace_baseline(const char *const opt)
+{
+	stress_ftrace_profile_t *profile = NULL;
+	bool section = false;
+	char buf[4096], func_name[256];
+	FILE *fp;
+
+	fp = fopen(opt, "r");
+	if (!fp) {
+		(void)fprintf(stderr, "Cannot open ftrace baseline '%s', errno=%d (%s)\n",
+			opt, errno, strerror(errno));
+		return -1;
+	}
+
+	g_opt_flags |= OPT_FLAGS_FTRACE;
+	*func_name = '\0';
+	while (fgets(buf, sizeof(buf), fp)) {
+		const char *value;
+		char *ptr = strchr(buf, '\n');
+
+		if (ptr)
+			*ptr = '\0';
+		if (!isspace((int)buf[0])) {
+			section = !strcmp(buf, "ftrace:");
+			profile = NULL;
+			continue;
+		}
+		if (!section)
+			continue;
+
+		if (stress_ftrace_baseline_value(buf, "- stressor:", &value)) {
+			profile = stress_ftrace_profile_find(&ftrace_baseline,
+				&ftrace_baseline_n, value, true);
+			if (!profile)
+				goto memory_fail;
+			profile->bogo_ops = 1;
+		} else if (!profile) {
+			continue;
+		} else if (stress_ftrace_baseline_value(buf, "syscall-time-us-per-bogo-op:", &value)) {
+			profile->syscall_us = atof(value);
+		} else if (stress_ftrace_baseline_value(buf, "- function:", &value)) {
+			(void)shim_strlcpy(func_name, value, sizeof(func_name));
+		} else if (*func_name &&
+			   stress_ftrace_baseline_value(buf, "time-us-per-bogo-op:", &value)) {
+			if (stress_ftrace_funcs_add(&profile->funcs, func_name, 1, atof(value)) < 0)
+				goto memory_fail;
+			*func_name = '\0';
+		}
+	}
+	(void)fclose(fp);
+
+	if (!ftrace_baseline_n) {
+		(void)fprintf(stderr, "No ftrace profiles found in ftrace baseline '%s'\n", opt);
+		return -1;
+	}
+	return 0;
+
+memory_fail:
+	(void)fclose(fp);
+	(void)fprintf(stderr, "Cannot allocate ftrace baseline profiles\n");
+	return -1;
 }
 
-static RB_HEAD(rb_tree, rb_node) rb_root;
-RB_PROTOTYPE(rb_tree, rb_node, rb, rb_node_cmp);
-RB_GENERATE(rb_tree, rb_node, rb, rb_node_cmp);
+#if defined(HAVE_SYS_STATFS_H) &&	\
+    defined(__linux__)
+
+#define MAX_MOUNTS	(256)
+#if !defined(DEBUGFS_MAGIC)
+#define DEBUGFS_MAGIC	(0x64626720)
+#endif
+
+static bool tracing_enabled;
+static stress_ftrace_funcs_t ftrace_start;	/* profile at start of tracing */
+static stress_ftrace_funcs_t ftrace_run_start;	/* profile at start of a run */
 
 /*
  *  stress_ftrace_get_debugfs_path()
@@ -100,157 +273,225 @@ static char *stress_ftrace_get_debugfs_path(void)
 
 /*
  *  stress_ftrace_free()
- *	free up rb tree
+ *	free up the function profiles
  */
 void stress_ftrace_free(void)
 {
-	struct rb_node *tn, *next;
+	size_t i;
 
 	if (!(g_opt_flags & OPT_FLAGS_FTRACE))
 		return;
 
-	for (tn = RB_MIN(rb_tree, &rb_root); tn; tn = next) {
-		free(tn->func_name);
-                next = RB_NEXT(rb_tree, &rb_root, tn);
-                RB_REMOVE(rb_tree, &rb_root, tn);
-		free(tn);
-	}
-	RB_INIT(&rb_root);
+	stress_ftrace_funcs_free(&ftrace_start);
+	stress_ftrace_funcs_free(&ftrace_run_start);
+	for (i = 0; i < ftrace_profiles_n; i++)
+		stress_ftrace_funcs_free(&ftrace_profiles[i].funcs);
+	free(ftrace_profiles);
+	ftrace_profiles = NULL;
+	ftrace_profiles_n = 0;
+	for (i = 0; i < ftrace_baseline_n; i++)
+		stress_ftrace_funcs_free(&ftrace_baseline[i].funcs);
+	free(ftrace_baseline);
+	ftrace_baseline = NULL;
+	ftrace_baseline_n = 0;
 }
 
 /*
- *  stress_ftrace_parse_trace_stat_file()
- *	parse the ftrace files for function timing stats
+ *  stress_ftrace_parse_line()
+ *	parse a "function hits time" line of a trace stat file,
+ *	the function name is terminated in place in buffer
  */
-static int stress_ftrace_parse_trace_stat_file(const char *path, const bool start)
+static bool stress_ftrace_parse_line(
+	char *buffer,
+	char **func_name,
+	int64_t *count,
+	double *time_us)
 {
-	FILE *fp;
-	char buffer[4096];
-
-	fp = fopen(path, "r");
-	if (!fp)
-		return 0;
-
-	while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-		struct rb_node *tn, node;
-		char *ptr, *func_name, *num = "0";
-		int64_t count;
-		double time_us;
-
-		if (strstr(buffer, "Function"))
-			continue;
-		if (strstr(buffer, "----"))
-			continue;
+	char *ptr, *num;
+
+	if (strstr(buffer, "Function"))
+		return false;
+	if (strstr(buffer, "----"))
+		return false;
+
+	/*
+	 *  Skip over leading spaces and find function name
+	 */
+	for (ptr = buffer; *ptr && isspace(*ptr); ptr++)
+		;
+	if (!*ptr)
+		return false;
+	*func_name = ptr;
+
+	/*
+	 *  Skip over leading spaces and find hit count
+	 */
+	for (; *ptr && !isspace(*ptr); ptr++)
+		;
+	if (!*ptr)
+		return false;
+	*ptr++ = '\0';
+	for (; *ptr && isspace(*ptr); ptr++)
+		;
+	num = ptr;
+	for (; *ptr && !isspace(*ptr); ptr++)
+		;
+	if (!*ptr)
+		return false;
+	*ptr++ = '\0';
+	*count = (int64_t)atoll(num);
+
+	/*
+	 *  Skip over leading spaces and find time consumed
+	 */
+	for (; *ptr && isspace(*ptr); ptr++)
+		;
+	if (!*ptr)
+		return false;
+	if (sscanf(ptr, "%lf", time_us) != 1)
+		*time_us = 0.0;
+	return true;
+}
 
-		/*
-		 *  Skip over leading spaces and find function name
-		 */
-		for (ptr = buffer; *ptr && isspace(*ptr); ptr++)
-			;
-		if (!*ptr)
-			continue;
-		func_name = ptr;
-
-		/*
-		 *  Skip over leading spaces and find hit count
-		 */
-		for (; *ptr && !isspace(*ptr); ptr++)
-			;
-		if (!*ptr)
-			continue;
-		*ptr++ = '\0';
-		for (; *ptr && isspace(*ptr); ptr++)
-			;
-		num = ptr;
-		for (; *ptr && !isspace(*ptr); ptr++)
-			;
-		if (!*ptr)
-			continue;
-		*ptr++ = '\0';
-		count = (int64_t)atoll(num);
-
-		/*
-		 *  Skip over leading spaces and find time consumed
-		 */
-		for (; *ptr && isspace(*ptr); ptr++)
-			;
-		if (!*ptr)
-			continue;
-		if (sscanf(ptr, "%lf", &time_us) != 1)
-			time_us = 0.0;
+/*
+ *  stress_ftrace_func_cmp()
+ *	used for sorting functions by name
+ */
+static int stress_ftrace_func_cmp(const void *p1, const void *p2)
+{
+	const stress_ftrace_func_t *f1 = (const stress_ftrace_func_t *)p1;
+	const stress_ftrace_func_t *f2 = (const stress_ftrace_func_t *)p2;
 
-		node.func_name = func_name;
+	return strcmp(f1->func_name, f2->func_name);
+}
 
-		tn = RB_FIND(rb_tree, &rb_root, &node);
-		if (tn) {
-			if (start) {
-				tn->start_count += count;
-				tn->start_time_us += time_us;
-			} else {
-				tn->end_count += count;
-				tn->end_time_us += time_us;
-			}
-		} else {
-			tn = malloc(sizeof(*tn));
-			if (!tn)
-				goto memory_fail;
-			tn->func_name = strdup(func_name);
-			if (!tn->func_name) {
-				free(tn);
-				goto memory_fail;
-			}
-			tn->start_count = 0;
-			tn->end_count = 0;
-			tn->start_time_us = 0.0;
-			tn->end_time_us = 0.0;
-
-			if (start) {
-				tn->start_count = count;
-				tn->start_time_us = time_us;
-			} else {
-				tn->end_count = count;
-				tn->end_time_us = time_us;
-			}
-			/* If we find an exiting matching, free the unused new tn */
-			if (RB_INSERT(rb_tree, &rb_root, tn) != NULL)
-				free(tn);
-		}
-	}
-	(void)fclose(fp);
-	return 0;
+/*
+ *  stress_ftrace_func_time_cmp()
+ *	used for sorting functions by time, longest first
+ */
+static int stress_ftrace_func_time_cmp(const void *p1, const void *p2)
+{
+	const stress_ftrace_func_t *f1 = (const stress_ftrace_func_t *)p1;
+	const stress_ftrace_func_t *f2 = (const stress_ftrace_func_t *)p2;
 
-memory_fail:
-	(void)fclose(fp);
-	pr_inf("ftrace: disabled, out of memory collecting function information\n");
-	stress_ftrace_free();
-	return -1;
+	if (f1->time_us < f2->time_us)
+		return 1;
+	if (f1->time_us > f2->time_us)
+		return -1;
+	return strcmp(f1->func_name, f2->func_name);
 }
 
 /*
- *  stress_ftrace_parse_stat_files()
- *	read trace stat files and parse the data into the rb tree
+ *  stress_ftrace_snapshot()
+ *	read the per CPU trace stat files and sum them into a list
+ *	of functions sorted by name
  */
-static int stress_ftrace_parse_stat_files(const char *path, const bool start)
+static int stress_ftrace_snapshot(const char *path, stress_ftrace_funcs_t *list)
 {
 	DIR *dp;
 	struct dirent *de;
 	char filename[PATH_MAX];
+	size_t i, j;
 
+	(void)memset(list, 0, sizeof(*list));
 	(void)snprintf(filename, sizeof(filename), "%s/tracing/trace_stat", path);
 	dp = opendir(filename);
 	if (!dp)
 		return -1;
 	while ((de = readdir(dp)) != NULL) {
-		if (strncmp(de->d_name, "function", 8) == 0) {
-			char funcfile[PATH_MAX];
+		char buffer[4096];
+		FILE *fp;
 
-			(void)snprintf(funcfile, sizeof(funcfile),
-				"%s/tracing/trace_stat/%s", path, de->d_name);
-			stress_ftrace_parse_trace_stat_file(funcfile, start);
+		if (strncmp(de->d_name, "function", 8))
+			continue;
+		(void)snprintf(filename, sizeof(filename),
+			"%s/tracing/trace_stat/%s", path, de->d_name);
+		fp = fopen(filename, "r");
+		if (!fp)
+			continue;
+		while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+			char *func_name;
+			int64_t count;
+			double time_us;
+
+			if (!stress_ftrace_parse_line(buffer, &func_name, &count, &time_us))
+				continue;
+			if (stress_ftrace_funcs_add(list, func_name, count, time_us) < 0) {
+				(void)fclose(fp);
+				(void)closedir(dp);
+				goto memory_fail;
+			}
 		}
+		(void)fclose(fp);
 	}
 	(void)closedir(dp);
 
+	if (!list->n)
+		return 0;
+
+	/* sort by name and sum the per CPU entries of each function */
+	qsort(list->funcs, list->n, sizeof(*list->funcs), stress_ftrace_func_cmp);
+	for (i = 0, j = 1; j < list->n; j++) {
+		if (!strcmp(list->funcs[i].func_name, list->funcs[j].func_name)) {
+			list->funcs[i].count += list->funcs[j].count;
+			list->funcs[i].time_us += list->funcs[j].time_us;
+			free(list->funcs[j].func_name);
+		} else {
+			list->funcs[++i] = list->funcs[j];
+		}
+	}
+	list->n = i + 1;
+	return 0;
+
+memory_fail:
+	pr_inf("ftrace: disabled, out of memory collecting function information\n");
+	stress_ftrace_funcs_free(list);
+	return -1;
+}
+
+/*
+ *  stress_ftrace_merge()
+ *	merge two lists sorted by name into out, the counts and
+ *	times are a + (sign * b), functions with no calls are dropped
+ */
+static int stress_ftrace_merge(
+	const stress_ftrace_funcs_t *a,
+	const stress_ftrace_funcs_t *b,
+	const int sign,
+	stress_ftrace_funcs_t *out)
+{
+	size_t i = 0, j = 0;
+
+	(void)memset(out, 0, sizeof(*out));
+	while ((i < a->n) || (j < b->n)) {
+		const stress_ftrace_func_t *fa = (i < a->n) ? &a->funcs[i] : NULL;
+		const stress_ftrace_func_t *fb = (j < b->n) ? &b->funcs[j] : NULL;
+		const char *func_name;
+		int64_t count = 0;
+		double time_us = 0.0;
+		int cmp;
+
+		cmp = !fa ? 1 : (!fb ? -1 : strcmp(fa->func_name, fb->func_name));
+		if (cmp <= 0) {
+			func_name = fa->func_name;
+			count += fa->count;
+			time_us += fa->time_us;
+			i++;
+		}
+		if (cmp >= 0) {
+			func_name = fb->func_name;
+			count += sign * fb->count;
+			time_us += sign * fb->time_us;
+			j++;
+		}
+		if (count <= 0)
+			continue;
+		if (stress_ftrace_funcs_add(out, func_name, count, time_us) < 0) {
+			pr_inf("ftrace: out of memory collecting function information\n");
+			stress_ftrace_funcs_free(out);
+			return -1;
+		}
+	}
 	return 0;
 }
 
@@ -298,8 +539,6 @@ int stress_ftrace_start(void)
 	if (!(g_opt_flags & OPT_FLAGS_FTRACE))
 		return 0;
 
-	RB_INIT(&rb_root);
-
 	if (!stress_check_capability(SHIM_CAP_SYS_ADMIN)) {
 		pr_inf("ftrace: requires CAP_SYS_ADMIN capability for tracing\n");
 		return -1;
@@ -325,7 +564,7 @@ int stress_ftrace_start(void)
 			errno, strerror(errno));
 		return -1;
 	}
-	if (stress_ftrace_parse_stat_files(path, true) < 0)
+	if (stress_ftrace_snapshot(path, &ftrace_start) < 0)
 		return -1;
 
 	tracing_enabled = true;
@@ -349,43 +588,108 @@ static inline bool strace_ftrace_is_syscall(const char *func_name)
 }
 
 /*
- *  stress_ftrace_start()
- *	start ftracing function calls
+ *  stress_ftrace_run_start()
+ *	take the function profile at the start of a run
  */
-static void stress_ftrace_analyze(void)
+void stress_ftrace_run_start(void)
 {
-	struct rb_node *tn, *next;
-	uint64_t sys_calls = 0, func_calls = 0;
+	char *path;
+
+	if (!tracing_enabled)
+		return;
+	path = stress_ftrace_get_debugfs_path();
+	if (path)
+		(void)stress_ftrace_snapshot(path, &ftrace_run_start);
+}
+
+/*
+ *  stress_ftrace_run_stop()
+ *	add the function profile of a run to the profile of its
+ *	stressors, this is per stressor with --seq, otherwise the
+ *	stressors that ran together share one profile
+ */
+void stress_ftrace_run_stop(stress_stressor_t *stressors_list)
+{
+	stress_ftrace_funcs_t end, delta, merged;
+	stress_ftrace_profile_t *profile;
+	stress_stressor_t *ss;
+	char name[sizeof(profile->name)];
+	uint64_t bogo_ops = 0;
+	char *path;
+	size_t i;
+
+	if (!tracing_enabled)
+		return;
+	path = stress_ftrace_get_debugfs_path();
+	if (!path || (stress_ftrace_snapshot(path, &end) < 0))
+		goto free_start;
+	if (stress_ftrace_merge(&end, &ftrace_run_start, -1, &delta) < 0)
+		goto free_end;
+
+	*name = '\0';
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (!ss->num_instances || !ss->stats)
+			continue;
+		if (*name)
+			(void)shim_strlcat(name, "+", sizeof(name));
+		(void)shim_strlcat(name, stress_munge_underscore(ss->stressor->name), sizeof(name));
+		for (j = 0; j < ss->num_instances; j++)
+			bogo_ops += ss->stats[j]->ci.counter;
+	}
+	profile = stress_ftrace_profile_find(&ftrace_profiles, &ftrace_profiles_n, name, true);
+	if (!profile || (stress_ftrace_merge(&profile->funcs, &delta, 1, &merged) < 0))
+		goto free_delta;
+	stress_ftrace_funcs_free(&profile->funcs);
+	profile->funcs = merged;
+	profile->bogo_ops += bogo_ops;
+	for (i = 0; i < delta.n; i++) {
+		if (strace_ftrace_is_syscall(delta.funcs[i].func_name))
+			profile->syscall_us += delta.funcs[i].time_us;
+	}
+
+free_delta:
+	stress_ftrace_funcs_free(&delta);
+free_end:
+	stress_ftrace_funcs_free(&end);
+free_start:
+	stress_ftrace_funcs_free(&ftrace_run_start);
+}
+
+/*
+ *  stress_ftrace_analyze()
+ *	report the system calls made over all the runs
+ */
+static void stress_ftrace_analyze(const stress_ftrace_funcs_t *delta)
+{
+	uint64_t sys_calls = 0;
+	size_t i;
 
 	pr_inf("ftrace: %-30.30s %15.15s %20.20s\n", "System Call", "Number of Calls", "Total Time (us)");
 
-	for (tn = RB_MIN(rb_tree, &rb_root); tn; tn = next) {
-		int64_t count = tn->end_count - tn->start_count;
-		if (count > 0) {
-			func_calls++;
-			if (strace_ftrace_is_syscall(tn->func_name)) {
-				double time_us = tn->end_time_us -
-						 tn->start_time_us;
+	for (i = 0; i < delta->n; i++) {
+		const stress_ftrace_func_t *func = &delta->funcs[i];
 
-				pr_inf("ftrace: %-30.30s %15" PRIu64 " %20.2f\n", tn->func_name, count, time_us);
-				sys_calls++;
-			}
+		if (strace_ftrace_is_syscall(func->func_name)) {
+			pr_inf("ftrace: %-30.30s %15" PRIu64 " %20.2f\n",
+				func->func_name, func->count, func->time_us);
+			sys_calls++;
 		}
-
-                next = RB_NEXT(rb_tree, &rb_root, tn);
 	}
-	pr_inf("ftrace: %" PRIu64 " kernel functions called, %" PRIu64 " were system calls\n",
-		func_calls, sys_calls);
+	pr_inf("ftrace: %zu kernel functions called, %" PRIu64 " were system calls\n",
+		delta->n, sys_calls);
 }
 
 /*
- *  stress_ftrace_start()
+ *  stress_ftrace_stop()
  *	stop ftracing function calls and analyze the collected
  *	stats
  */
 void stress_ftrace_stop(void)
 {
 	char *path, filename[PATH_MAX];
+	stress_ftrace_funcs_t end, delta;
 
 	if (!(g_opt_flags & OPT_FLAGS_FTRACE))
 		return;
@@ -405,10 +709,93 @@ void stress_ftrace_stop(void)
 		return;
 	}
 
-	(void)snprintf(filename, sizeof(filename), "%s/tracing/trace_stat", path);
-	if (stress_ftrace_parse_stat_files(path, false) < 0)
+	if (stress_ftrace_snapshot(path, &end) < 0)
+		return;
+	if (stress_ftrace_merge(&end, &ftrace_start, -1, &delta) == 0) {
+		stress_ftrace_analyze(&delta);
+		stress_ftrace_funcs_free(&delta);
+	}
+	stress_ftrace_funcs_free(&end);
+}
+
+/*
+ *  stress_ftrace_dump()
+ *	report the hottest kernel functions of each stressor, the
+ *	time per bogo-op and the change against --ftrace-baseline
+ */
+void stress_ftrace_dump(FILE *yaml)
+{
+	size_t i;
+
+	if (!ftrace_profiles_n)
 		return;
-	stress_ftrace_analyze();
+
+	pr_yaml(yaml, "ftrace:\n");
+	for (i = 0; i < ftrace_profiles_n; i++) {
+		const stress_ftrace_profile_t *profile = &ftrace_profiles[i];
+		const stress_ftrace_profile_t *base = stress_ftrace_profile_find(&ftrace_baseline,
+			&ftrace_baseline_n, profile->name, false);
+		const double ops = profile->bogo_ops ? (double)profile->bogo_ops : 1.0;
+		stress_ftrace_func_t *hot;
+		char delta[64];
+		size_t j, n;
+
+		*delta = '\0';
+		if (base && (base->syscall_us > 0.0))
+			(void)snprintf(delta, sizeof(delta), ", %+.1f%% against baseline",
+				((profile->syscall_us / ops) - base->syscall_us) * 100.0 / base->syscall_us);
+		pr_inf("ftrace: %s: %" PRIu64 " bogo-ops, %.3f us system call time per bogo-op%s\n",
+			profile->name, profile->bogo_ops, profile->syscall_us / ops, delta);
+		pr_yaml(yaml, "    - stressor: %s\n", profile->name);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", profile->bogo_ops);
+		pr_yaml(yaml, "      syscall-time-us: %f\n", profile->syscall_us);
+		pr_yaml(yaml, "      syscall-time-us-per-bogo-op: %f\n", profile->syscall_us / ops);
+
+		if (!profile->funcs.n)
+			continue;
+		n = STRESS_MINIMUM(profile->funcs.n, (size_t)ftrace_top);
+		hot = calloc(profile->funcs.n, sizeof(*hot));
+		if (!hot) {
+			pr_inf("ftrace: cannot allocate function profile of %s\n", profile->name);
+			continue;
+		}
+		(void)memcpy(hot, profile->funcs.funcs, profile->funcs.n * sizeof(*hot));
+		qsort(hot, profile->funcs.n, sizeof(*hot), stress_ftrace_func_time_cmp);
+
+		pr_inf("ftrace: %-30.30s %12s %14s %12s %12s %8s\n", "Function",
+			"Calls", "Time (us)", "us/bogo-op", "baseline", "delta%");
+		pr_yaml(yaml, "      functions:\n");
+		for (j = 0; j < n; j++) {
+			const stress_ftrace_func_t *func = &hot[j];
+			const double per_op = func->time_us / ops;
+			double base_per_op = -1.0;
+
+			if (base) {
+				size_t k;
+
+				for (k = 0; k < base->funcs.n; k++) {
+					if (!strcmp(base->funcs.funcs[k].func_name, func->func_name)) {
+						base_per_op = base->funcs.funcs[k].time_us;
+						break;
+					}
+				}
+			}
+			if (base_per_op > 0.0) {
+				pr_inf("ftrace: %-30.30s %12" PRId64 " %14.2f %12.4f %12.4f %+8.1f\n",
+					func->func_name, func->count, func->time_us, per_op,
+					base_per_op, (per_op - base_per_op) * 100.0 / base_per_op);
+			} else {
+				pr_inf("ftrace: %-30.30s %12" PRId64 " %14.2f %12.4f %12s %8s\n",
+					func->func_name, func->count, func->time_us, per_op, "-", "-");
+			}
+			pr_yaml(yaml, "        - function: %s\n", func->func_name);
+			pr_yaml(yaml, "          calls: %" PRId64 "\n", func->count);
+			pr_yaml(yaml, "          time-us: %f\n", func->time_us);
+			pr_yaml(yaml, "          time-us-per-bogo-op: %f\n", per_op);
+		}
+		free(hot);
+	}
+	pr_yaml(yaml, "\n");
 }
 
 #else
@@ -431,7 +818,21 @@ int stress_ftrace_start(void)
 	return 0;
 }
 
+void stress_ftrace_run_start(void)
+{
+}
+
+void stress_ftrace_run_stop(stress_stressor_t *stressors_list)
+{
+	(void)stressors_list;
+}
+
 void stress_ftrace_stop(void)
 {
 }
+
+void stress_ftrace_dump(FILE *yaml)
+{
+	(void)yaml;
+}
 #endif
@@ -20,9 +20,14 @@
 #define CORE_FTRACE_H
 
 /* ftrace helpers */
+extern int stress_set_ftrace_top(const char *const opt);
+extern int stress_set_ftrace_baseline(const char *const opt);
 extern int stress_ftrace_start(void);
 extern void stress_ftrace_stop(void);
 extern void stress_ftrace_free(void);
 extern void stress_ftrace_add_pid(const pid_t pid);
+extern void stress_ftrace_run_start(void);
+extern void stress_ftrace_run_stop(stress_stressor_t *stressors_list);
+extern void stress_ftrace_dump(FILE *yaml);
 
 #endif
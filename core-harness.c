@@ -0,0 +1,252 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+#include "core-harness.h"
+#include "core-perf.h"
+#include "core-put.h"
+
+#define HARNESS_LOOPS		(100000)	/* iterations per trial */
+#define HARNESS_SIG_LOOPS	(1000)		/* sigaction is much slower */
+#define HARNESS_TRIALS		(5)		/* best of N trials */
+
+typedef struct {
+	const char *name;		/* harness operation */
+	void (*func)(stress_counter_info_t *ci, const uint64_t loops);
+	const uint64_t loops;		/* iterations per trial */
+	double ns;			/* ns per iteration */
+	double cycles;			/* CPU cycles per iteration, < 0 unknown */
+} stress_harness_cost_t;
+
+/* minimal stressor args for the harness helpers */
+#define STRESS_HARNESS_ARGS(counter_info, ops)	\
+	{ .ci = counter_info, .name = "harness", .max_ops = ops, .instance = 0, .num_instances = 1 }
+
+/*
+ *  stress_harness_bogo_op()
+ *	an empty stressor body, just the bogo-op accounting
+ *	and loop termination checks of a stressor loop
+ */
+static void NOINLINE stress_harness_bogo_op(stress_counter_info_t *ci, const uint64_t loops)
+{
+	const stress_args_t args = STRESS_HARNESS_ARGS(ci, loops);
+
+	do {
+		inc_counter(&args);
+	} while (keep_stressing(&args));
+}
+
+/*
+ *  stress_harness_keep_stressing()
+ *	cost of the loop termination check
+ */
+static void NOINLINE stress_harness_keep_stressing(stress_counter_info_t *ci, const uint64_t loops)
+{
+	const stress_args_t args = STRESS_HARNESS_ARGS(ci, 0);
+	uint64_t i;
+
+	for (i = 0; i < loops; i++) {
+		if (!keep_stressing(&args))
+			break;
+	}
+}
+
+/*
+ *  stress_harness_inc_counter()
+ *	cost of the bogo-op counter update and its barriers
+ */
+static void NOINLINE stress_harness_inc_counter(stress_counter_info_t *ci, const uint64_t loops)
+{
+	const stress_args_t args = STRESS_HARNESS_ARGS(ci, 0);
+	uint64_t i;
+
+	for (i = 0; i < loops; i++)
+		inc_counter(&args);
+}
+
+/*
+ *  stress_harness_mwc32()
+ *	cost of a 32 bit random number
+ */
+static void NOINLINE stress_harness_mwc32(stress_counter_info_t *ci, const uint64_t loops)
+{
+	uint32_t sum = 0;
+	uint64_t i;
+
+	(void)ci;
+	for (i = 0; i < loops; i++)
+		sum += stress_mwc32();
+	stress_uint32_put(sum);
+}
+
+/*
+ *  stress_harness_sigaction()
+ *	cost of installing a signal handler, as done at the
+ *	start of each stressor instance
+ */
+static void NOINLINE stress_harness_sigaction(stress_counter_info_t *ci, const uint64_t loops)
+{
+	struct sigaction action, old_action;
+	uint64_t i;
+
+	(void)ci;
+	(void)memset(&action, 0, sizeof(action));
+	action.sa_handler = SIG_IGN;
+	(void)sigemptyset(&action.sa_mask);
+
+	for (i = 0; i < loops; i++)
+		(void)sigaction(SIGUSR2, &action, &old_action);
+}
+
+static stress_harness_cost_t harness_costs[] = {
+	{ "bogo-op loop",	stress_harness_bogo_op,		HARNESS_LOOPS,		0.0, -1.0 },
+	{ "keep_stressing",	stress_harness_keep_stressing,	HARNESS_LOOPS,		0.0, -1.0 },
+	{ "inc_counter",	stress_harness_inc_counter,	HARNESS_LOOPS,		0.0, -1.0 },
+	{ "stress_mwc32",	stress_harness_mwc32,		HARNESS_LOOPS,		0.0, -1.0 },
+	{ "sigaction",		stress_harness_sigaction,	HARNESS_SIG_LOOPS,	0.0, -1.0 },
+};
+
+static bool harness_calibrated;
+
+/*
+ *  stress_harness_calibrate()
+ *	time the harness operations a stressor loop goes through,
+ *	the best of several trials is used to filter out noise
+ */
+void stress_harness_calibrate(void)
+{
+	size_t i;
+	int cycles_fd = -1;
+
+	if (!(g_opt_flags & OPT_FLAGS_HARNESS_OVERHEAD))
+		return;
+
+#if defined(STRESS_PERF_STATS)
+	cycles_fd = stress_perf_cycles_open();
+#endif
+	for (i = 0; i < SIZEOF_ARRAY(harness_costs); i++) {
+		stress_harness_cost_t *const hc = &harness_costs[i];
+		uint64_t best_ns = ~0ULL, best_cycles = ~0ULL;
+		int trial;
+
+		for (trial = 0; trial < HARNESS_TRIALS; trial++) {
+			stress_counter_info_t ci;
+			uint64_t t1, t2, c1 = 0, c2 = 0;
+			bool cycles_ok = false;
+
+			(void)memset(&ci, 0, sizeof(ci));
+			ci.counter_ready = true;
+#if defined(STRESS_PERF_STATS)
+			if (cycles_fd >= 0)
+				cycles_ok = (stress_perf_cycles_read(cycles_fd, &c1) == 0);
+#endif
+			t1 = stress_clock_ns();
+			hc->func(&ci, hc->loops);
+			t2 = stress_clock_ns();
+#if defined(STRESS_PERF_STATS)
+			if (cycles_ok)
+				cycles_ok = (stress_perf_cycles_read(cycles_fd, &c2) == 0);
+#endif
+			best_ns = STRESS_MINIMUM(best_ns, stress_clock_delta_ns(t1, t2));
+			if (cycles_ok && (c2 > c1))
+				best_cycles = STRESS_MINIMUM(best_cycles, c2 - c1);
+		}
+		hc->ns = (double)best_ns / (double)hc->loops;
+		hc->cycles = (best_cycles == ~0ULL) ? -1.0 : (double)best_cycles / (double)hc->loops;
+	}
+	if (cycles_fd >= 0)
+		(void)close(cycles_fd);
+	harness_calibrated = true;
+	pr_dbg("harness: %.2f ns per bogo-op loop iteration\n", harness_costs[0].ns);
+}
+
+/*
+ *  stress_harness_overhead()
+ *	seconds of harness overhead in counter bogo-ops of a
+ *	stressor, 0.0 if the stressor has not opted in to have
+ *	the overhead subtracted from its metrics
+ */
+double stress_harness_overhead(const stress_stressor_t *ss, const uint64_t counter)
+{
+	if (!harness_calibrated || !ss->stressor->info->harness_adjust)
+		return 0.0;
+	return (double)counter * harness_costs[0].ns * ONE_BILLIONTH;
+}
+
+/*
+ *  stress_harness_dump()
+ *	report the harness cost per operation and the stressors
+ *	that have had it subtracted from their metrics
+ */
+void stress_harness_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t i;
+	bool header = false;
+
+	if (!harness_calibrated)
+		return;
+
+	pr_inf("harness-overhead: per iteration cost of the stress-ng harness (%s):\n",
+		stress_clock_src_name());
+	pr_inf("%-16s %10s %10s\n", "operation", "ns", "cycles");
+	pr_yaml(yaml, "harness-overhead:\n");
+	pr_yaml(yaml, "    clock-source: %s\n", stress_clock_src_name());
+	pr_yaml(yaml, "    operations:\n");
+	for (i = 0; i < SIZEOF_ARRAY(harness_costs); i++) {
+		const stress_harness_cost_t *const hc = &harness_costs[i];
+		char cycles[32];
+
+		if (hc->cycles < 0.0)
+			(void)shim_strlcpy(cycles, "-", sizeof(cycles));
+		else
+			(void)snprintf(cycles, sizeof(cycles), "%.2f", hc->cycles);
+		pr_inf("%-16s %10.2f %10s\n", hc->name, hc->ns, cycles);
+		pr_yaml(yaml, "      - operation: %s\n", hc->name);
+		pr_yaml(yaml, "        ns: %f\n", hc->ns);
+		if (hc->cycles >= 0.0)
+			pr_yaml(yaml, "        cycles: %f\n", hc->cycles);
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t c_total = 0;
+		double r_total = 0.0, overhead;
+		int32_t j;
+
+		if (!ss->stats || !ss->started_instances ||
+		    !ss->stressor->info->harness_adjust)
+			continue;
+		for (j = 0; j < ss->started_instances; j++) {
+			c_total += ss->stats[j]->ci.counter;
+			r_total += ss->stats[j]->finish - ss->stats[j]->start;
+		}
+		overhead = stress_harness_overhead(ss, c_total);
+		if (!header) {
+			pr_inf("harness-overhead: subtracted from the real time metrics of:\n");
+			pr_yaml(yaml, "    adjusted:\n");
+			header = true;
+		}
+		pr_inf("%-13s %9.2f%% of the run time\n",
+			stress_munge_underscore(ss->stressor->name),
+			(r_total > 0.0) ? 100.0 * overhead / r_total : 0.0);
+		pr_yaml(yaml, "      - stressor: %s\n", stress_munge_underscore(ss->stressor->name));
+		pr_yaml(yaml, "        overhead-seconds: %f\n", overhead);
+	}
+	pr_yaml(yaml, "\n");
+}
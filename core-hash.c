@@ -18,8 +18,14 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
+#include "core-cpu.h"
 #include "core-hash.h"
 
+#if defined(HAVE_SYS_AUXV_H)
+#include <sys/auxv.h>
+#endif
+
 /*
  *  stress_hash_jenkin()
  *	Jenkin's hash on random data
@@ -556,6 +562,392 @@ uint32_t HOT OPTIMIZE3 stress_hash_mulxror64(const char *str, const size_t len)
 	return (uint32_t)((hash >> 32) ^ hash);
 }
 
+typedef uint32_t (*stress_hash_crc32c_func_t)(uint32_t crc, const uint8_t *ptr, size_t len);
+
+static uint32_t stress_hash_crc32c_resolve(uint32_t crc, const uint8_t *ptr, size_t len);
+
+static stress_hash_crc32c_func_t stress_hash_crc32c_func = stress_hash_crc32c_resolve;
+static const char *stress_hash_crc32c_name = "software table";
+
+/*
+ *  stress_hash_crc32c_sw()
+ *	crc32c of len bytes, lookup table implementation
+ */
+static uint32_t HOT OPTIMIZE3 stress_hash_crc32c_sw(
+	register uint32_t crc,
+	register const uint8_t *ptr,
+	register size_t len)
+{
+	while (len--)
+		crc = (crc >> 8) ^ crc32c_table[(crc ^ *ptr++) & 0xff];
+
+	return crc;
+}
+
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_BUILTIN_IA32_CRC32)
+/*
+ *  stress_hash_crc32c_x86()
+ *	crc32c using the SSE4.2 crc32 instruction, 8 bytes at a time
+ */
+static uint32_t HOT OPTIMIZE3 __attribute__((target("sse4.2"))) stress_hash_crc32c_x86(
+	register uint32_t crc,
+	register const uint8_t *ptr,
+	register size_t len)
+{
+	register uint64_t crc64 = crc;
+
+	for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t)) {
+		uint64_t v;
+
+		(void)memcpy(&v, ptr, sizeof(v));
+		ptr += sizeof(v);
+		crc64 = __builtin_ia32_crc32di(crc64, v);
+	}
+	crc = (uint32_t)crc64;
+	while (len--)
+		crc = __builtin_ia32_crc32qi(crc, *ptr++);
+
+	return crc;
+}
+#endif
+
+#if defined(__aarch64__) &&			\
+    defined(HAVE_BUILTIN_AARCH64_CRC32C) &&	\
+    defined(HAVE_GETAUXVAL) &&			\
+    defined(HWCAP_CRC32)
+/*
+ *  stress_hash_crc32c_arm()
+ *	crc32c using the ARMv8 crc32c instructions, 8 bytes at a time
+ */
+static uint32_t HOT OPTIMIZE3 __attribute__((target("+crc"))) stress_hash_crc32c_arm(
+	register uint32_t crc,
+	register const uint8_t *ptr,
+	register size_t len)
+{
+	for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t)) {
+		uint64_t v;
+
+		(void)memcpy(&v, ptr, sizeof(v));
+		ptr += sizeof(v);
+		crc = __builtin_aarch64_crc32cx(crc, v);
+	}
+	while (len--)
+		crc = __builtin_aarch64_crc32cb(crc, *ptr++);
+
+	return crc;
+}
+#endif
+
+/*
+ *  stress_hash_crc32c_resolve()
+ *	select the fastest crc32c the CPU supports on the first call
+ */
+static uint32_t stress_hash_crc32c_resolve(uint32_t crc, const uint8_t *ptr, size_t len)
+{
+	stress_hash_crc32c_func = stress_hash_crc32c_sw;
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_BUILTIN_IA32_CRC32)
+	if (stress_cpu_x86_has_sse4_2()) {
+		stress_hash_crc32c_func = stress_hash_crc32c_x86;
+		stress_hash_crc32c_name = "sse4.2 crc32 instruction";
+	}
+#endif
+#if defined(__aarch64__) &&			\
+    defined(HAVE_BUILTIN_AARCH64_CRC32C) &&	\
+    defined(HAVE_GETAUXVAL) &&			\
+    defined(HWCAP_CRC32)
+	if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+		stress_hash_crc32c_func = stress_hash_crc32c_arm;
+		stress_hash_crc32c_name = "armv8 crc32c instruction";
+	}
+#endif
+	return stress_hash_crc32c_func(crc, ptr, len);
+}
+
+/*
+ *  stress_hash_crc32c_hw()
+ *	crc32c of len bytes using CRC instructions when the CPU
+ *	has them, same result as stress_hash_crc32c
+ */
+uint32_t HOT OPTIMIZE3 stress_hash_crc32c_hw(const char *str, const size_t len)
+{
+	return ~stress_hash_crc32c_func(~0U, (const uint8_t *)str, len);
+}
+
+/*
+ *  stress_hash_crc32c_hw_impl()
+ *	name of the crc32c implementation stress_hash_crc32c_hw uses
+ */
+const char *stress_hash_crc32c_hw_impl(void)
+{
+	(void)stress_hash_crc32c_func(~0U, NULL, 0);
+
+	return stress_hash_crc32c_name;
+}
+
+/*
+ *  xxh3acc, an XXH3 style hash, 8 lanes of 64 bit accumulators
+ *	consume 64 byte stripes, each lane adds its data and the
+ *	32 x 32 bit product of the halves of its data xor'd with a
+ *	secret. The accumulators are scrambled every 1K, it is not
+ *	compatible with XXH3 but has the same vectorizable inner loop
+ */
+#define XXH3ACC_STRIPE		(64)
+#define XXH3ACC_STRIPES		(16)	/* stripes per scramble */
+#define XXH3ACC_LANES		(8)
+#define XXH3ACC_PRIME32_1	(0x9e3779b1ULL)
+#define XXH3ACC_PRIME64_1	(0x9e3779b185ebca87ULL)
+#define XXH3ACC_PRIME64_2	(0xc2b2ae3d27d4eb4fULL)
+#define XXH3ACC_PRIME64_3	(0x165667b19e3779f9ULL)
+
+static const uint64_t ALIGN64 xxh3acc_secret[XXH3ACC_LANES] = {
+	0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL,
+	0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+	0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL,
+	0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL,
+};
+
+static const uint64_t ALIGN64 xxh3acc_scramble[XXH3ACC_LANES] = {
+	0xcb00c391bb52283cULL, 0xa32e531b8b65d088ULL,
+	0x4ef90da297486471ULL, 0xd8acdea946ef1938ULL,
+	0x3f349ce33f76faa8ULL, 0x1d4f0bc7c7bbdcf9ULL,
+	0x3159b4cd4be0518aULL, 0x647378d9c97e9fc8ULL,
+};
+
+/*
+ *  stress_hash_load64le()
+ *	load 64 bits little endian so hashes match on all CPUs
+ */
+static inline uint64_t ALWAYS_INLINE stress_hash_load64le(const uint8_t *ptr)
+{
+	uint64_t v;
+
+	(void)memcpy(&v, ptr, sizeof(v));
+#if defined(__BYTE_ORDER__) &&	\
+    (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+/*
+ *  stress_hash_xxh3acc_final()
+ *	fold the accumulators into a 32 bit hash
+ */
+static inline uint32_t ALWAYS_INLINE stress_hash_xxh3acc_final(const uint64_t *acc, const size_t len)
+{
+	register uint64_t h = (uint64_t)len * XXH3ACC_PRIME64_1;
+	register size_t i;
+
+	for (i = 0; i < XXH3ACC_LANES; i += 2) {
+		const uint64_t a = acc[i] ^ xxh3acc_secret[(i + 3) & 7];
+		const uint64_t b = acc[i + 1] ^ xxh3acc_secret[(i + 4) & 7];
+
+		h += (a ^ (b >> 29)) * XXH3ACC_PRIME64_2;
+		h = (h << 31) | (h >> 33);
+	}
+	h ^= h >> 37;
+	h *= XXH3ACC_PRIME64_3;
+	h ^= h >> 32;
+
+	return (uint32_t)h;
+}
+
+/*
+ *  stress_hash_xxh3acc_tail()
+ *	copy the last partial stripe, zero padded, returns true
+ *	if there is a partial stripe to hash
+ */
+static inline bool ALWAYS_INLINE stress_hash_xxh3acc_tail(
+	uint8_t *tail,
+	const uint8_t *ptr,
+	const size_t len)
+{
+	const size_t n = len & (XXH3ACC_STRIPE - 1);
+
+	if (!n)
+		return false;
+	(void)memset(tail, 0, XXH3ACC_STRIPE);
+	(void)memcpy(tail, ptr + (len - n), n);
+	return true;
+}
+
+static inline void ALWAYS_INLINE stress_hash_xxh3acc_stripe(uint64_t *acc, const uint8_t *ptr)
+{
+	register size_t i;
+
+	for (i = 0; i < XXH3ACC_LANES; i++) {
+		const uint64_t d = stress_hash_load64le(ptr + (i * sizeof(uint64_t)));
+		const uint64_t k = d ^ xxh3acc_secret[i];
+
+		acc[i] += d + ((k & 0xffffffffULL) * (k >> 32));
+	}
+}
+
+static inline void ALWAYS_INLINE stress_hash_xxh3acc_scramble(uint64_t *acc)
+{
+	register size_t i;
+
+	for (i = 0; i < XXH3ACC_LANES; i++) {
+		acc[i] ^= acc[i] >> 47;
+		acc[i] ^= xxh3acc_scramble[i];
+		acc[i] *= XXH3ACC_PRIME32_1;
+	}
+}
+
+/*
+ *  stress_hash_xxh3acc()
+ *	XXH3 style hash, scalar implementation
+ */
+uint32_t HOT OPTIMIZE3 stress_hash_xxh3acc(const char *str, const size_t len)
+{
+	const uint8_t *ptr = (const uint8_t *)str;
+	uint64_t acc[XXH3ACC_LANES] = {
+		XXH3ACC_PRIME32_1, XXH3ACC_PRIME64_1, XXH3ACC_PRIME64_2, XXH3ACC_PRIME64_3,
+		XXH3ACC_PRIME64_3, XXH3ACC_PRIME64_2, XXH3ACC_PRIME64_1, XXH3ACC_PRIME32_1,
+	};
+	uint8_t ALIGN64 tail[XXH3ACC_STRIPE];
+	register size_t i;
+	const size_t stripes = len / XXH3ACC_STRIPE;
+
+	for (i = 0; i < stripes; i++) {
+		stress_hash_xxh3acc_stripe(acc, ptr + (i * XXH3ACC_STRIPE));
+		if ((i & (XXH3ACC_STRIPES - 1)) == (XXH3ACC_STRIPES - 1))
+			stress_hash_xxh3acc_scramble(acc);
+	}
+	if (stress_hash_xxh3acc_tail(tail, ptr, len))
+		stress_hash_xxh3acc_stripe(acc, tail);
+
+	return stress_hash_xxh3acc_final(acc, len);
+}
+
+#if defined(HAVE_VECMATH)
+typedef uint64_t stress_hash_v256_t __attribute__ ((vector_size(32)));
+
+/*
+ *  STRESS_HASH_XXH3ACC_VEC()
+ *	XXH3 style hash using 256 bit vectors of 4 lanes, the target
+ *	allows wider vector instructions to be used without building
+ *	everything for them, the result matches stress_hash_xxh3acc
+ */
+#define STRESS_HASH_XXH3ACC_VEC(name, target)					\
+static inline void ALWAYS_INLINE name ## _stripe(				\
+	stress_hash_v256_t *acc,						\
+	const uint8_t *ptr)							\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < XXH3ACC_LANES / 4; i++) {				\
+		stress_hash_v256_t d, s;					\
+										\
+		(void)memcpy(&d, ptr + (i * sizeof(d)), sizeof(d));		\
+		if (!stress_hash_vec_le) {					\
+			d[0] = __builtin_bswap64(d[0]);				\
+			d[1] = __builtin_bswap64(d[1]);				\
+			d[2] = __builtin_bswap64(d[2]);				\
+			d[3] = __builtin_bswap64(d[3]);				\
+		}								\
+		(void)memcpy(&s, &xxh3acc_secret[i * 4], sizeof(s));		\
+		s ^= d;								\
+		acc[i] += d + ((s & 0xffffffffULL) * (s >> 32));		\
+	}									\
+}										\
+										\
+static uint32_t HOT OPTIMIZE3 target name(const char *str, const size_t len)	\
+{										\
+	const uint8_t *ptr = (const uint8_t *)str;				\
+	stress_hash_v256_t acc[XXH3ACC_LANES / 4] = {				\
+		{ XXH3ACC_PRIME32_1, XXH3ACC_PRIME64_1,				\
+		  XXH3ACC_PRIME64_2, XXH3ACC_PRIME64_3 },			\
+		{ XXH3ACC_PRIME64_3, XXH3ACC_PRIME64_2,				\
+		  XXH3ACC_PRIME64_1, XXH3ACC_PRIME32_1 },			\
+	};									\
+	uint64_t ALIGN64 lanes[XXH3ACC_LANES];					\
+	uint8_t ALIGN64 tail[XXH3ACC_STRIPE];					\
+	register size_t i, j;							\
+	const size_t stripes = len / XXH3ACC_STRIPE;				\
+										\
+	for (i = 0; i < stripes; i++) {						\
+		name ## _stripe(acc, ptr + (i * XXH3ACC_STRIPE));		\
+		if ((i & (XXH3ACC_STRIPES - 1)) == (XXH3ACC_STRIPES - 1)) {	\
+			for (j = 0; j < XXH3ACC_LANES / 4; j++) {		\
+				stress_hash_v256_t s;				\
+										\
+				(void)memcpy(&s, &xxh3acc_scramble[j * 4], sizeof(s)); \
+				acc[j] ^= acc[j] >> 47;				\
+				acc[j] ^= s;					\
+				acc[j] *= XXH3ACC_PRIME32_1;			\
+			}							\
+		}								\
+	}									\
+	if (stress_hash_xxh3acc_tail(tail, ptr, len))				\
+		name ## _stripe(acc, tail);					\
+										\
+	(void)memcpy(lanes, acc, sizeof(lanes));				\
+	return stress_hash_xxh3acc_final(lanes, len);				\
+}
+
+#if defined(__BYTE_ORDER__) &&	\
+    (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+static const bool stress_hash_vec_le = false;
+#else
+static const bool stress_hash_vec_le = true;
+#endif
+
+STRESS_HASH_XXH3ACC_VEC(stress_hash_xxh3acc_v256, )
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_TARGET_CLONES_AVX2)
+STRESS_HASH_XXH3ACC_VEC(stress_hash_xxh3acc_avx2, __attribute__ ((target("avx2"))))
+#endif
+#endif
+
+static uint32_t stress_hash_xxh3acc_resolve(const char *str, const size_t len);
+
+static stress_hash_func_t stress_hash_xxh3acc_vec_func = stress_hash_xxh3acc_resolve;
+static const char *stress_hash_xxh3acc_vec_name = "scalar";
+
+/*
+ *  stress_hash_xxh3acc_resolve()
+ *	select the widest vector xxh3acc the CPU supports on the first call
+ */
+static uint32_t stress_hash_xxh3acc_resolve(const char *str, const size_t len)
+{
+	stress_hash_xxh3acc_vec_func = stress_hash_xxh3acc;
+#if defined(HAVE_VECMATH)
+	stress_hash_xxh3acc_vec_func = stress_hash_xxh3acc_v256;
+	stress_hash_xxh3acc_vec_name = "generic 256 bit vectors";
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_TARGET_CLONES_AVX2)
+	if (stress_cpu_x86_has_avx2()) {
+		stress_hash_xxh3acc_vec_func = stress_hash_xxh3acc_avx2;
+		stress_hash_xxh3acc_vec_name = "avx2 256 bit vectors";
+	}
+#endif
+#endif
+	return stress_hash_xxh3acc_vec_func(str, len);
+}
+
+/*
+ *  stress_hash_xxh3acc_vec()
+ *	XXH3 style hash, vector implementation
+ */
+uint32_t HOT OPTIMIZE3 stress_hash_xxh3acc_vec(const char *str, const size_t len)
+{
+	return stress_hash_xxh3acc_vec_func(str, len);
+}
+
+/*
+ *  stress_hash_xxh3acc_vec_impl()
+ *	name of the implementation stress_hash_xxh3acc_vec uses
+ */
+const char *stress_hash_xxh3acc_vec_impl(void)
+{
+	(void)stress_hash_xxh3acc_vec_func("", 0);
+
+	return stress_hash_xxh3acc_vec_name;
+}
+
 /*
  *  stress_hash_create()
  *	create a hash table with size of n base hash entries
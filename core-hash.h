@@ -30,6 +30,8 @@ typedef struct {
 	size_t		n;		/* number of hash items in table */
 } stress_hash_table_t;
 
+typedef uint32_t (*stress_hash_func_t)(const char *str, const size_t len);
+
 /*
  *  Hashing core functions
  */
@@ -45,6 +47,8 @@ extern WARN_UNUSED uint32_t stress_hash_coffin(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_coffin32_be(const char *str, const size_t len);
 extern WARN_UNUSED uint32_t stress_hash_coffin32_le(const char *str, const size_t len);
 extern WARN_UNUSED uint32_t stress_hash_crc32c(const char *str);
+extern WARN_UNUSED uint32_t stress_hash_crc32c_hw(const char *str, const size_t len);
+extern WARN_UNUSED const char *stress_hash_crc32c_hw_impl(void);
 extern WARN_UNUSED uint32_t stress_hash_djb2a(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_fnv1a(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_jenkin(const uint8_t *data, const size_t len);
@@ -60,5 +64,8 @@ extern WARN_UNUSED uint32_t stress_hash_nhash(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_pjw(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_sdbm(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_x17(const char *str);
+extern WARN_UNUSED uint32_t stress_hash_xxh3acc(const char *str, const size_t len);
+extern WARN_UNUSED uint32_t stress_hash_xxh3acc_vec(const char *str, const size_t len);
+extern WARN_UNUSED const char *stress_hash_xxh3acc_vec_impl(void);
 
 #endif
@@ -1497,6 +1497,26 @@ void pr_yaml_runinfo(FILE *yaml)
 	pr_yaml(yaml, "\n");
 }
 
+#if defined(__linux__)
+/*
+ *  stress_cache_ways_size()
+ *	size of the part of a cache to fill, this is the
+ *	entire cache or just the --cache-ways number of ways
+ */
+static uint64_t stress_cache_ways_size(const stress_cpu_cache_t *cache)
+{
+	uint32_t ways;
+
+	if (!cache)
+		return 0;
+	if ((g_shared->mem_cache_ways == 0) || (cache->ways == 0))
+		return cache->size;
+
+	ways = STRESS_MINIMUM(g_shared->mem_cache_ways, cache->ways);
+	return (cache->size / cache->ways) * ways;
+}
+#endif
+
 /*
  *  stress_cache_alloc()
  *	allocate shared cache buffer
@@ -1507,6 +1527,7 @@ int stress_cache_alloc(const char *name)
 	stress_cpus_t *cpu_caches;
 	stress_cpu_cache_t *cache = NULL;
 	uint16_t max_cache_level = 0;
+	uint32_t i;
 #endif
 
 #if !defined(__linux__)
@@ -1543,23 +1564,29 @@ int stress_cache_alloc(const char *name)
 		goto init_done;
 	}
 
-	if (g_shared->mem_cache_ways > 0) {
-		uint64_t way_size;
+	if ((g_shared->mem_cache_ways > 0) &&
+	    (g_shared->mem_cache_ways > cache->ways)) {
+		if (stress_warn_once())
+			pr_inf("%s: cache way value too high - "
+				"defaulting to %d (the maximum)\n",
+				name, cache->ways);
+		g_shared->mem_cache_ways = cache->ways;
+	}
 
-		if (g_shared->mem_cache_ways > cache->ways) {
-			if (stress_warn_once())
-				pr_inf("%s: cache way value too high - "
-					"defaulting to %d (the maximum)\n",
-					name, cache->ways);
-			g_shared->mem_cache_ways = cache->ways;
-		}
-		way_size = cache->size / cache->ways;
+	/*
+	 *  CPUs may have different sized caches (hybrid and chiplet
+	 *  designs), so size the shared buffer for the largest cache
+	 *  and let each instance use the part that matches the cache
+	 *  of the CPU(s) it is pinned to
+	 */
+	g_shared->mem_cache_size = 0;
+	for (i = 0; i < cpu_caches->count; i++) {
+		const uint64_t size = stress_cache_ways_size(
+			stress_get_cpu_cache_by_cpu(cpu_caches, i,
+				g_shared->mem_cache_level));
 
-		/* only fill the specified number of cache ways */
-		g_shared->mem_cache_size = way_size * g_shared->mem_cache_ways;
-	} else {
-		/* fill the entire cache */
-		g_shared->mem_cache_size = cache->size;
+		if (g_shared->mem_cache_size < size)
+			g_shared->mem_cache_size = size;
 	}
 
 	if (!g_shared->mem_cache_size) {
@@ -1613,6 +1640,33 @@ void stress_cache_free(void)
 		(void)munmap((void *)g_shared->cacheline, g_shared->cacheline_size);
 }
 
+/*
+ *  stress_cache_instance_size()
+ *	number of bytes of the shared cache buffer that match
+ *	the cache of the CPU(s) the calling process is pinned to
+ */
+uint64_t stress_cache_instance_size(void)
+{
+#if defined(__linux__)
+	stress_cpus_t *cpu_caches;
+	uint64_t size;
+
+	cpu_caches = stress_get_all_cpu_cache_details();
+	if (!cpu_caches)
+		return g_shared->mem_cache_size;
+
+	size = stress_cache_ways_size(stress_get_cpu_cache_affinity(cpu_caches,
+		g_shared->mem_cache_level));
+	stress_free_cpu_caches(cpu_caches);
+
+	if ((size == 0) || (size > g_shared->mem_cache_size))
+		return g_shared->mem_cache_size;
+	return size;
+#else
+	return g_shared->mem_cache_size;
+#endif
+}
+
 /*
  *  system_write()
  *	write a buffer to a /sys or /proc entry
@@ -3188,6 +3242,36 @@ const char *stress_fs_type(const char *filename)
 #endif
 }
 
+/*
+ *  stress_misc_stats_thread_scaling()
+ *	set the misc stats for the unit rate at the lowest and
+ *	highest thread counts of a thread scaling run and the %
+ *	of linear scaling the highest count achieved, returns
+ *	the next misc stats index
+ */
+size_t stress_misc_stats_thread_scaling(
+	stress_misc_stats_t *misc_stats,
+	size_t idx,
+	const char *unit,
+	const uint32_t threads1,
+	const double rate1,
+	const uint32_t threadsn,
+	const double raten)
+{
+	char desc[32];
+
+	(void)snprintf(desc, sizeof(desc), "%s, %" PRIu32 " threads", unit, threads1);
+	stress_misc_stats_set(misc_stats, idx++, desc, rate1);
+	if (threadsn == threads1)
+		return idx;
+	(void)snprintf(desc, sizeof(desc), "%s, %" PRIu32 " threads", unit, threadsn);
+	stress_misc_stats_set(misc_stats, idx++, desc, raten);
+	if (rate1 > 0.0)
+		stress_misc_stats_set(misc_stats, idx++, "thread scaling %",
+			100.0 * raten * threads1 / (rate1 * threadsn));
+	return idx;
+}
+
 /*
  *  Indicate a stress test failed because of limited resources
  *  rather than a failure of the tests during execution.
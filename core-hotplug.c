@@ -0,0 +1,328 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-hotplug.h"
+#include "core-latency.h"
+
+#define HOTPLUG_SAMPLE_NS	(100000)	/* counter sampling period */
+#define HOTPLUG_REPORT_MAX	(64)		/* most rows in the report */
+
+#if defined(HAVE_LIB_PTHREAD)
+/* progress of the bogo-ops counter of another stressor instance */
+typedef struct {
+	uint64_t counter;		/* last counter value seen */
+	uint64_t changed;		/* time the counter last changed */
+	double gap;			/* moving average gap between changes */
+	uint32_t changes;		/* changes seen, capped */
+	bool valid;			/* instance is being tracked */
+} stress_hotplug_progress_t;
+#endif
+
+/* samples the counters of the other running stressors */
+struct stress_hotplug_stall {
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;		/* sampler thread */
+	pthread_mutex_t lock;		/* protects the fields below */
+	stress_hotplug_progress_t *progress; /* per g_shared->stats[] entry */
+	const stress_counter_info_t *ci; /* counter of the hotplug stressor */
+	uint64_t stall;			/* longest stall in the transition */
+	bool in_transition;		/* a transition is being timed */
+	bool stop;			/* sampler should exit */
+#else
+	int unused;			/* no empty structs */
+#endif
+};
+
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_hotplug_stall_sample()
+ *	check the progress of the counters of all the other running
+ *	stressors, a stall is the gap between counter changes beyond
+ *	the usual gap so slow bogo-ops do not look like stalls
+ */
+static void stress_hotplug_stall_sample(stress_hotplug_stall_t *st, const bool ending)
+{
+	const uint64_t now = stress_latency_now();
+	uint32_t i;
+
+	for (i = 0; i < g_shared->num_stats; i++) {
+		const stress_stats_t *stats = &g_shared->stats[i];
+		stress_hotplug_progress_t *p = &st->progress[i];
+		uint64_t counter, gap;
+
+		if ((&stats->ci == st->ci) || (stats->pid <= 0) ||
+		    (stats->finish > stats->start)) {
+			p->valid = false;
+			continue;
+		}
+		counter = stats->ci.counter;
+		if (!p->valid) {
+			(void)memset(p, 0, sizeof(*p));
+			p->counter = counter;
+			p->changed = now;
+			p->valid = true;
+			continue;
+		}
+		if ((counter == p->counter) && !ending)
+			continue;
+
+		gap = now - p->changed;
+		/* need a few changes to know the usual gap */
+		if (st->in_transition && (p->changes >= 4) && (gap > p->gap))
+			st->stall = STRESS_MAXIMUM(st->stall, gap - (uint64_t)p->gap);
+		if (counter == p->counter)
+			continue;
+		/* hotplug can run back to back, so learn from every gap */
+		p->gap = p->changes ? (0.9 * p->gap) + (0.1 * (double)gap) : (double)gap;
+		if (p->changes < 4)
+			p->changes++;
+		p->counter = counter;
+		p->changed = now;
+	}
+}
+
+/*
+ *  stress_hotplug_stall_sampler()
+ *	sample the counters of the other stressors every 100us
+ */
+static void *stress_hotplug_stall_sampler(void *arg)
+{
+	stress_hotplug_stall_t *st = (stress_hotplug_stall_t *)arg;
+
+	for (;;) {
+		(void)pthread_mutex_lock(&st->lock);
+		if (st->stop) {
+			(void)pthread_mutex_unlock(&st->lock);
+			break;
+		}
+		stress_hotplug_stall_sample(st, false);
+		(void)pthread_mutex_unlock(&st->lock);
+		(void)shim_nanosleep_uint64(HOTPLUG_SAMPLE_NS);
+	}
+	return NULL;
+}
+#endif
+
+/*
+ *  stress_hotplug_stall_create()
+ *	start sampling the progress of the other stressors,
+ *	returns NULL if this is not possible
+ */
+stress_hotplug_stall_t *stress_hotplug_stall_create(const stress_args_t *args)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	stress_hotplug_stall_t *st;
+
+	if (!g_shared->num_stats)
+		return NULL;
+	st = calloc(1, sizeof(*st));
+	if (!st)
+		return NULL;
+	st->progress = calloc((size_t)g_shared->num_stats, sizeof(*st->progress));
+	if (!st->progress) {
+		free(st);
+		return NULL;
+	}
+	st->ci = args->ci;
+	if (pthread_mutex_init(&st->lock, NULL) != 0) {
+		free(st->progress);
+		free(st);
+		return NULL;
+	}
+	if (pthread_create(&st->pthread, NULL, stress_hotplug_stall_sampler, st) != 0) {
+		(void)pthread_mutex_destroy(&st->lock);
+		free(st->progress);
+		free(st);
+		return NULL;
+	}
+	return st;
+#else
+	(void)args;
+	return NULL;
+#endif
+}
+
+/*
+ *  stress_hotplug_stall_begin()
+ *	mark the start of a hotplug transition
+ */
+void stress_hotplug_stall_begin(stress_hotplug_stall_t *st)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	if (!st)
+		return;
+	(void)pthread_mutex_lock(&st->lock);
+	st->stall = 0;
+	st->in_transition = true;
+	(void)pthread_mutex_unlock(&st->lock);
+#else
+	(void)st;
+#endif
+}
+
+/*
+ *  stress_hotplug_stall_end()
+ *	mark the end of a hotplug transition, returns the longest
+ *	stall in ns of the other stressors during the transition
+ */
+uint64_t stress_hotplug_stall_end(stress_hotplug_stall_t *st)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	uint64_t stall;
+
+	if (!st)
+		return 0;
+	(void)pthread_mutex_lock(&st->lock);
+	/* include stressors that have not progressed since the start */
+	stress_hotplug_stall_sample(st, true);
+	stall = st->stall;
+	st->in_transition = false;
+	(void)pthread_mutex_unlock(&st->lock);
+	return stall;
+#else
+	(void)st;
+	return 0;
+#endif
+}
+
+/*
+ *  stress_hotplug_stall_destroy()
+ *	stop sampling the progress of the other stressors
+ */
+void stress_hotplug_stall_destroy(stress_hotplug_stall_t *st)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	if (!st)
+		return;
+	(void)pthread_mutex_lock(&st->lock);
+	st->stop = true;
+	(void)pthread_mutex_unlock(&st->lock);
+	(void)pthread_join(st->pthread, NULL);
+	(void)pthread_mutex_destroy(&st->lock);
+	free(st->progress);
+	free(st);
+#else
+	(void)st;
+#endif
+}
+
+/*
+ *  stress_hotplug_ms()
+ *	format a latency percentile in ms, "-" if there are no samples
+ */
+static void stress_hotplug_ms(
+	char *buf,
+	const size_t len,
+	const stress_latency_t *lat,
+	const double percentile)
+{
+	if (!lat->count)
+		(void)shim_strlcpy(buf, "-", len);
+	else
+		(void)snprintf(buf, len, "%.3f",
+			(double)stress_latency_percentile(lat, percentile) / 1000000.0);
+}
+
+/*
+ *  stress_hotplug_row()
+ *	report the transition latencies of one CPU or memory block
+ */
+static void stress_hotplug_row(
+	const stress_args_t *args,
+	const char *name,
+	const stress_latency_t *offline,
+	const stress_latency_t *online,
+	const stress_latency_t *stall)
+{
+	char off50[16], off99[16], offmax[16], on50[16], on99[16], onmax[16], st99[16], stmax[16];
+
+	stress_hotplug_ms(off50, sizeof(off50), offline, 50.0);
+	stress_hotplug_ms(off99, sizeof(off99), offline, 99.0);
+	stress_hotplug_ms(offmax, sizeof(offmax), offline, 100.0);
+	stress_hotplug_ms(on50, sizeof(on50), online, 50.0);
+	stress_hotplug_ms(on99, sizeof(on99), online, 99.0);
+	stress_hotplug_ms(onmax, sizeof(onmax), online, 100.0);
+	stress_hotplug_ms(st99, sizeof(st99), stall, 99.0);
+	stress_hotplug_ms(stmax, sizeof(stmax), stall, 100.0);
+	pr_inf("%s: %-12s %7" PRIu64 " %9s %9s %9s %9s %9s %9s %9s %9s\n",
+		args->name, name, offline->count, off50, off99, offmax,
+		on50, on99, onmax, st99, stmax);
+}
+
+/*
+ *  stress_hotplug_report()
+ *	report the offline and online latencies and the stalls of
+ *	the other stressors of each CPU or memory block, NULL
+ *	entries have not been exercised, the totals are added to
+ *	the misc stats
+ */
+void stress_hotplug_report(
+	const stress_args_t *args,
+	stress_hotplug_lat_t * const *lats,
+	const size_t n)
+{
+	static stress_latency_t offline, online, stall;
+	size_t i, rows = 0;
+
+	stress_latency_reset(&offline);
+	stress_latency_reset(&online);
+	stress_latency_reset(&stall);
+	for (i = 0; i < n; i++) {
+		if (!lats[i])
+			continue;
+		stress_latency_merge(&offline, &lats[i]->offline);
+		stress_latency_merge(&online, &lats[i]->online);
+		stress_latency_merge(&stall, &lats[i]->stall);
+	}
+	if (!offline.count && !online.count)
+		return;
+
+	if (args->instance == 0) {
+		pr_inf("%s: hotplug transition latencies and stalls of other stressors in ms:\n",
+			args->name);
+		pr_inf("%s: %-12s %7s %9s %9s %9s %9s %9s %9s %9s %9s\n", args->name,
+			"", "count", "off p50", "off p99", "off max",
+			"on p50", "on p99", "on max", "stall p99", "stall max");
+		for (i = 0; i < n; i++) {
+			if (!lats[i] || (!lats[i]->offline.count && !lats[i]->online.count))
+				continue;
+			if (rows++ == HOTPLUG_REPORT_MAX) {
+				pr_inf("%s: (only the first %d are shown)\n",
+					args->name, HOTPLUG_REPORT_MAX);
+				break;
+			}
+			stress_hotplug_row(args, lats[i]->name, &lats[i]->offline,
+				&lats[i]->online, &lats[i]->stall);
+		}
+		stress_hotplug_row(args, "all", &offline, &online, &stall);
+	}
+
+	stress_misc_stats_set(args->misc_stats, 0, "offline p50 ms",
+		(double)stress_latency_percentile(&offline, 50.0) / 1000000.0);
+	stress_misc_stats_set(args->misc_stats, 1, "offline p99 ms",
+		(double)stress_latency_percentile(&offline, 99.0) / 1000000.0);
+	stress_misc_stats_set(args->misc_stats, 2, "online p50 ms",
+		(double)stress_latency_percentile(&online, 50.0) / 1000000.0);
+	stress_misc_stats_set(args->misc_stats, 3, "online p99 ms",
+		(double)stress_latency_percentile(&online, 99.0) / 1000000.0);
+	stress_misc_stats_set(args->misc_stats, 4, "stall p99 ms",
+		(double)stress_latency_percentile(&stall, 99.0) / 1000000.0);
+	stress_misc_stats_set(args->misc_stats, 5, "stall max ms",
+		(double)stall.max / 1000000.0);
+}
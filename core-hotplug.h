@@ -0,0 +1,40 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_HOTPLUG_H
+#define CORE_HOTPLUG_H
+
+/* offline, online and stall latencies of a CPU or memory block */
+typedef struct {
+	char name[32];			/* cpuN or memoryN */
+	stress_latency_t offline;	/* offline transition times */
+	stress_latency_t online;	/* online transition times */
+	stress_latency_t stall;		/* longest stall of other stressors */
+} stress_hotplug_lat_t;
+
+typedef struct stress_hotplug_stall stress_hotplug_stall_t;
+
+/* hotplug transition timing for the cpu-online and memhotplug stressors */
+extern stress_hotplug_stall_t *stress_hotplug_stall_create(const stress_args_t *args);
+extern void stress_hotplug_stall_begin(stress_hotplug_stall_t *st);
+extern uint64_t stress_hotplug_stall_end(stress_hotplug_stall_t *st);
+extern void stress_hotplug_stall_destroy(stress_hotplug_stall_t *st);
+extern void stress_hotplug_report(const stress_args_t *args,
+	stress_hotplug_lat_t * const *lats, const size_t n);
+
+#endif
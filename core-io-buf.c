@@ -0,0 +1,151 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-io-buf.h"
+#include "core-mem-backing.h"
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
+
+/*
+ *  stress_io_buf_align()
+ *	return the buffer alignment needed for direct I/O on the
+ *	file system that path lives on, this is at least the page
+ *	size, larger if the device has a larger logical block size
+ */
+size_t stress_io_buf_align(const stress_args_t *args, const char *path)
+{
+	size_t align = args->page_size;
+#if defined(HAVE_STATX) &&	\
+    defined(STATX_DIOALIGN)
+	shim_statx_t stx;
+
+	(void)memset(&stx, 0, sizeof(stx));
+	if (path &&
+	    (shim_statx(AT_FDCWD, path, 0, STATX_DIOALIGN, &stx) == 0) &&
+	    (stx.stx_mask & STATX_DIOALIGN)) {
+		if (align < (size_t)stx.stx_dio_mem_align)
+			align = (size_t)stx.stx_dio_mem_align;
+		if (align < (size_t)stx.stx_dio_offset_align)
+			align = (size_t)stx.stx_dio_offset_align;
+	}
+#else
+	(void)path;
+#endif
+	return align;
+}
+
+/*
+ *  stress_io_buf_pool_alloc()
+ *	allocate a pool of count buffers of at least buf_size bytes,
+ *	each aligned for direct I/O on the file system of path. The
+ *	pool honours --mem-backing and is pre-faulted so page faults
+ *	do not land in the measured I/O. Returns 0 on success, -1 on
+ *	failure with errno set.
+ */
+int stress_io_buf_pool_alloc(
+	const stress_args_t *args,
+	stress_io_buf_pool_t *pool,
+	const char *path,
+	const size_t buf_size,
+	const size_t count,
+	const int flags)
+{
+	const int mflags = (flags & STRESS_IO_BUF_SHARED) ?
+		MAP_SHARED | MAP_ANONYMOUS : MAP_PRIVATE | MAP_ANONYMOUS;
+	size_t i, sz;
+	void *ptr;
+
+	(void)memset(pool, 0, sizeof(*pool));
+	if (!buf_size || !count) {
+		errno = EINVAL;
+		return -1;
+	}
+	pool->align = stress_io_buf_align(args, path);
+	pool->buf_size = (buf_size + pool->align - 1) & ~(pool->align - 1);
+	pool->count = count;
+	if (pool->buf_size > (SIZE_MAX / count)) {
+		errno = ENOMEM;
+		return -1;
+	}
+	sz = pool->buf_size * count;
+
+	ptr = stress_mem_backing_mmap(args, &sz, PROT_READ | PROT_WRITE, mflags);
+	if (ptr == MAP_FAILED)
+		return -1;
+	pool->base = (uint8_t *)ptr;
+	pool->size = sz;
+
+	/* pre-fault */
+	for (i = 0; i < sz; i += args->page_size)
+		pool->base[i] = 0;
+
+	return 0;
+}
+
+/*
+ *  stress_io_buf_pool_free()
+ *	free a buffer pool
+ */
+void stress_io_buf_pool_free(stress_io_buf_pool_t *pool)
+{
+	if (pool->base)
+		(void)munmap((void *)pool->base, pool->size);
+	(void)memset(pool, 0, sizeof(*pool));
+}
+
+/*
+ *  stress_io_buf_pool_register()
+ *	register all the pool buffers as io_uring fixed buffers,
+ *	buffer index n is buffer n of the pool. Returns 0 on
+ *	success, -1 on failure with errno set.
+ */
+int stress_io_buf_pool_register(
+	const stress_io_buf_pool_t *pool,
+	const int io_uring_fd)
+{
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(__NR_io_uring_register)
+	struct iovec *iovecs;
+	size_t i;
+	int ret, saved_errno;
+
+	iovecs = calloc(pool->count, sizeof(*iovecs));
+	if (!iovecs)
+		return -1;
+	for (i = 0; i < pool->count; i++) {
+		iovecs[i].iov_base = (void *)stress_io_buf_get(pool, i);
+		iovecs[i].iov_len = pool->buf_size;
+	}
+	ret = (int)syscall(__NR_io_uring_register, io_uring_fd,
+		IORING_REGISTER_BUFFERS, iovecs, (unsigned int)pool->count);
+	saved_errno = errno;
+	free(iovecs);
+	errno = saved_errno;
+
+	return ret < 0 ? -1 : 0;
+#else
+	(void)pool;
+	(void)io_uring_fd;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_IO_BUF_H
+#define CORE_IO_BUF_H
+
+/* stress_io_buf_pool_alloc flags */
+#define STRESS_IO_BUF_SHARED	(0x0001)	/* shared with forked children */
+
+/* Pool of direct I/O aligned, pre-faulted file I/O buffers */
+typedef struct stress_io_buf_pool {
+	uint8_t *base;		/* start of the pool mapping */
+	size_t	size;		/* size of the pool mapping */
+	size_t	buf_size;	/* size of each buffer, multiple of align */
+	size_t	count;		/* number of buffers */
+	size_t	align;		/* buffer and direct I/O size alignment */
+} stress_io_buf_pool_t;
+
+extern size_t stress_io_buf_align(const stress_args_t *args, const char *path);
+extern int stress_io_buf_pool_alloc(const stress_args_t *args,
+	stress_io_buf_pool_t *pool, const char *path, const size_t buf_size,
+	const size_t count, const int flags);
+extern void stress_io_buf_pool_free(stress_io_buf_pool_t *pool);
+extern int stress_io_buf_pool_register(const stress_io_buf_pool_t *pool,
+	const int io_uring_fd);
+
+/*
+ *  stress_io_buf_get()
+ *	get the idx'th buffer of the pool
+ */
+static inline uint8_t *stress_io_buf_get(
+	const stress_io_buf_pool_t *pool,
+	const size_t idx)
+{
+	return pool->base + (idx * pool->buf_size);
+}
+
+#endif
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-ipc-bench.h"
+#include "core-latency.h"
+
+#define IPC_BENCH_PROCS_MAX	(16)	/* most sender/receiver pairs swept */
+#define IPC_BENCH_DRAIN_TIMEOUT	(1.0)	/* seconds to wait for in flight messages */
+
+/* per receiver results, shared with the parent */
+typedef struct {
+	stress_latency_t lat;		/* send to receive latencies */
+	uint64_t msgs;			/* messages received */
+	bool failed;			/* receive failed */
+} stress_ipc_bench_rx_t;
+
+/* shared measurement state */
+typedef struct {
+	volatile bool go;		/* senders start sending */
+	volatile bool stop;		/* senders stop sending */
+	uint64_t sent[IPC_BENCH_PROCS_MAX]; /* messages sent per sender */
+	bool send_failed;		/* a send failed */
+	stress_ipc_bench_rx_t rx[];	/* per receiver results */
+} stress_ipc_bench_shared_t;
+
+/*
+ *  stress_ipc_bench_procs_max()
+ *	most sender/receiver pairs to sweep, at least 2
+ */
+uint32_t stress_ipc_bench_procs_max(void)
+{
+	const int32_t cpus = stress_get_processors_online();
+
+	if (cpus <= 2)
+		return 2;
+	return (uint32_t)STRESS_MINIMUM(cpus, IPC_BENCH_PROCS_MAX);
+}
+
+/*
+ *  stress_ipc_bench_sender()
+ *	send timestamped messages until told to stop
+ */
+static void NORETURN stress_ipc_bench_sender(
+	const stress_ipc_bench_ops_t *ops,
+	void *ctx,
+	stress_ipc_bench_shared_t *shared,
+	const uint32_t id,
+	uint8_t *buf,
+	const size_t msg_size)
+{
+	uint64_t *hdr = (uint64_t *)(buf + ops->offset);
+	uint64_t seq = 0;
+
+	if (ops->child_init && (ops->child_init(ctx, false) < 0)) {
+		shared->send_failed = true;
+		_exit(EXIT_FAILURE);
+	}
+	while (!shared->go && !shared->stop)
+		(void)shim_usleep(100);
+
+	while (!shared->stop && keep_stressing_flag()) {
+		hdr[0] = stress_latency_now();
+		hdr[1] = seq;
+		if (ops->send(ctx, buf, msg_size) < 0) {
+			if (errno != EINTR)
+				shared->send_failed = true;
+			break;
+		}
+		seq++;
+		shared->sent[id] = seq;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_ipc_bench_receiver()
+ *	receive messages forever, recording send to receive latencies
+ */
+static void NORETURN stress_ipc_bench_receiver(
+	const stress_ipc_bench_ops_t *ops,
+	void *ctx,
+	stress_ipc_bench_rx_t *rx,
+	uint8_t *buf,
+	const size_t msg_size)
+{
+	const uint64_t *hdr = (const uint64_t *)(buf + ops->offset);
+
+	if (ops->child_init && (ops->child_init(ctx, true) < 0)) {
+		rx->failed = true;
+		_exit(EXIT_FAILURE);
+	}
+	for (;;) {
+		if (ops->recv(ctx, buf, msg_size) < 0) {
+			if (errno == EINTR)
+				continue;
+			rx->failed = true;
+			_exit(EXIT_FAILURE);
+		}
+		stress_latency_record(&rx->lat, stress_latency_now() - hdr[0]);
+		rx->msgs++;
+	}
+}
+
+/*
+ *  stress_ipc_bench_reap()
+ *	kill and reap child processes
+ */
+static void stress_ipc_bench_reap(pid_t *pids, const uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (pids[i] > 1) {
+			int status;
+
+			(void)kill(pids[i], SIGKILL);
+			(void)shim_waitpid(pids[i], &status, 0);
+			pids[i] = -1;
+		}
+	}
+}
+
+/*
+ *  stress_ipc_bench_measure()
+ *	pass msg_size byte messages from senders to receivers processes
+ *	for duration seconds over an IPC mechanism, the ctx IPC object
+ *	must already be created and shared across fork(), returns 0 on
+ *	success, -1 if the measurement could not be made
+ */
+int stress_ipc_bench_measure(
+	const stress_args_t *args,
+	const stress_ipc_bench_ops_t *ops,
+	void *ctx,
+	const size_t msg_size,
+	const uint32_t senders,
+	const uint32_t receivers,
+	const double duration,
+	stress_ipc_bench_result_t *result)
+{
+	const size_t shared_size = sizeof(stress_ipc_bench_shared_t) +
+		(receivers * sizeof(stress_ipc_bench_rx_t));
+	stress_ipc_bench_shared_t *shared;
+	stress_latency_t *lat;
+	pid_t pids[IPC_BENCH_PROCS_MAX * 2];
+	uint32_t i, nprocs = 0;
+	uint64_t sent = 0, received;
+	uint8_t *buf;
+	double t_start = 0.0, t_end = 0.0, t;
+	int rc = -1;
+
+	(void)memset(result, 0, sizeof(*result));
+	if ((senders > IPC_BENCH_PROCS_MAX) || (receivers > IPC_BENCH_PROCS_MAX) ||
+	    (msg_size < STRESS_IPC_BENCH_HDR_SIZE))
+		return -1;
+
+	shared = (stress_ipc_bench_shared_t *)mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED)
+		return -1;
+	lat = (stress_latency_t *)calloc(1, sizeof(*lat));
+	buf = (uint8_t *)calloc(1, ops->offset + msg_size);
+	if (!lat || !buf)
+		goto tidy;
+
+	for (i = 0; i < IPC_BENCH_PROCS_MAX * 2; i++)
+		pids[i] = -1;
+
+	for (i = 0; i < receivers + senders; i++) {
+		pid_t pid;
+again:
+		pid = fork();
+		if (pid < 0) {
+			if (stress_redo_fork(errno))
+				goto again;
+			goto reap;
+		} else if (pid == 0) {
+			stress_parent_died_alarm();
+			(void)sched_settings_apply(true);
+			if (i < receivers)
+				stress_ipc_bench_receiver(ops, ctx, &shared->rx[i], buf, msg_size);
+			else
+				stress_ipc_bench_sender(ops, ctx, shared, i - receivers, buf, msg_size);
+		}
+		pids[nprocs++] = pid;
+	}
+
+	t_start = stress_time_now();
+	shared->go = true;
+	while (((stress_time_now() - t_start) < duration) && keep_stressing_flag())
+		(void)shim_usleep(10000);
+	shared->stop = true;
+
+	/* senders finish their last send and exit */
+	for (i = receivers; i < nprocs; i++) {
+		int status;
+
+		(void)shim_waitpid(pids[i], &status, 0);
+		pids[i] = -1;
+	}
+	t_end = stress_time_now();
+	for (i = 0; i < senders; i++)
+		sent += shared->sent[i];
+
+	/* let the receivers drain the in flight messages */
+	t = stress_time_now();
+	do {
+		received = 0;
+		for (i = 0; i < receivers; i++)
+			received += shared->rx[i].msgs;
+		if (received >= sent)
+			break;
+		(void)shim_usleep(1000);
+	} while ((stress_time_now() - t) < IPC_BENCH_DRAIN_TIMEOUT);
+
+reap:
+	stress_ipc_bench_reap(pids, nprocs);
+	if (nprocs < receivers + senders)
+		goto tidy;
+	if (shared->send_failed) {
+		pr_fail("%s: message send failed\n", args->name);
+		goto tidy;
+	}
+
+	stress_latency_reset(lat);
+	received = 0;
+	for (i = 0; i < receivers; i++) {
+		if (shared->rx[i].failed) {
+			pr_fail("%s: message receive failed\n", args->name);
+			goto tidy;
+		}
+		stress_latency_merge(lat, &shared->rx[i].lat);
+		received += shared->rx[i].msgs;
+	}
+	if ((received == 0) || (t_end <= t_start))
+		goto tidy;
+
+	result->msgs_per_sec = (double)received / (t_end - t_start);
+	result->mb_per_sec = (result->msgs_per_sec * (double)msg_size) / (double)MB;
+	result->p50_us = (double)stress_latency_percentile(lat, 50.0) / 1000.0;
+	result->p99_us = (double)stress_latency_percentile(lat, 99.0) / 1000.0;
+	result->p999_us = (double)stress_latency_percentile(lat, 99.9) / 1000.0;
+	rc = 0;
+tidy:
+	free(buf);
+	free(lat);
+	(void)munmap((void *)shared, shared_size);
+
+	return rc;
+}
+
+/*
+ *  stress_ipc_bench_header()
+ *	print a sweep table header
+ */
+void stress_ipc_bench_header(const stress_args_t *args, const char *what)
+{
+	pr_inf("%s: %-14s %12s %10s %10s %10s %10s\n", args->name, what,
+		"msgs/sec", "MB/sec", "p50 us", "p99 us", "p99.9 us");
+}
+
+/*
+ *  stress_ipc_bench_line()
+ *	print a sweep table line, "-" for failed measurements
+ */
+void stress_ipc_bench_line(
+	const stress_args_t *args,
+	const char *label,
+	const stress_ipc_bench_result_t *result)
+{
+	if (result->msgs_per_sec <= 0.0) {
+		pr_inf("%s: %-14s %12s %10s %10s %10s %10s\n", args->name, label,
+			"-", "-", "-", "-", "-");
+		return;
+	}
+	pr_inf("%s: %-14s %12.0f %10.2f %10.2f %10.2f %10.2f\n", args->name, label,
+		result->msgs_per_sec, result->mb_per_sec,
+		result->p50_us, result->p99_us, result->p999_us);
+}
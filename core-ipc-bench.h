@@ -0,0 +1,54 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_IPC_BENCH_H
+#define CORE_IPC_BENCH_H
+
+#define STRESS_IPC_BENCH_HDR_SIZE	(16)	/* send timestamp + sequence number */
+
+/*
+ *  Message passing primitives of an IPC mechanism, buf points to the
+ *  start of the message including offset bytes reserved for the
+ *  mechanism (e.g. the SysV mtype), len is the payload size after it
+ */
+typedef struct {
+	size_t offset;		/* bytes reserved before the payload */
+	int (*child_init)(void *ctx, const bool receiver);	/* optional per process setup */
+	int (*send)(void *ctx, void *buf, const size_t len);	/* blocking send, 0 or -1 */
+	ssize_t (*recv)(void *ctx, void *buf, const size_t len); /* blocking receive, -1 on error */
+} stress_ipc_bench_ops_t;
+
+/* one sweep measurement */
+typedef struct {
+	double msgs_per_sec;	/* messages received per second */
+	double mb_per_sec;	/* payload MB received per second */
+	double p50_us;		/* send to receive latency percentiles */
+	double p99_us;
+	double p999_us;
+} stress_ipc_bench_result_t;
+
+extern int stress_ipc_bench_measure(const stress_args_t *args,
+	const stress_ipc_bench_ops_t *ops, void *ctx, const size_t msg_size,
+	const uint32_t senders, const uint32_t receivers, const double duration,
+	stress_ipc_bench_result_t *result);
+extern uint32_t stress_ipc_bench_procs_max(void);
+extern void stress_ipc_bench_header(const stress_args_t *args, const char *what);
+extern void stress_ipc_bench_line(const stress_args_t *args, const char *label,
+	const stress_ipc_bench_result_t *result);
+
+#endif
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-target.h"
 
 #define MAX_ARGS	(64)
 #define RUN_SEQUENTIAL	(0x01)
@@ -80,6 +81,52 @@ err:
 	return -1;
 }
 
+/*
+ *  stress_parse_mix()
+ *	parse the special job file "mix" command,
+ *	mix N stressor:weight [stressor:weight ...]
+ *	that runs N instances of each stressor and
+ *	rotates them on each CPU by their weights
+ */
+static int stress_parse_mix(
+	int argc,
+	char **argv)
+{
+	int i;
+
+	if (argc < 4) {
+		(void)fprintf(stderr, "mix requires an instance count and "
+			"at least one stressor:weight\n");
+		return -1;
+	}
+	for (i = 3; i < argc; i++) {
+		char *colon = strchr(argv[i], ':');
+		char opt[64];
+		char *new_argv[4];
+		uint32_t weight;
+
+		if (!colon || (colon == argv[i]) || !colon[1]) {
+			(void)fprintf(stderr, "mix stressor '%s' must be "
+				"of the form stressor:weight\n", argv[i]);
+			return -1;
+		}
+		*colon = '\0';
+		weight = stress_get_uint32(colon + 1);
+
+		/* enable N instances of the stressor */
+		(void)snprintf(opt, sizeof(opt), "--%s", argv[i]);
+		new_argv[0] = argv[0];
+		new_argv[1] = opt;
+		new_argv[2] = argv[2];
+		new_argv[3] = NULL;
+		if (stress_parse_opts(3, new_argv, true) != EXIT_SUCCESS)
+			return -1;
+		if (stress_set_target_mix(argv[i], weight) < 0)
+			return -1;
+	}
+	return 0;
+}
+
 /*
  *  stress_parse_error()
  *	generic job error message
@@ -196,6 +243,26 @@ int stress_parse_jobfile(
 				continue;
 			}
 
+			/* Check for job stressor mix */
+			if (!strcmp(new_argv[1], "mix")) {
+				if (stress_parse_mix(new_argc, new_argv) < 0) {
+					ret = -1;
+					stress_parse_error(lineno, txt);
+					goto err;
+				}
+				continue;
+			}
+
+			/* Check for job load profile phase */
+			if (!strcmp(new_argv[1], "profile")) {
+				if (stress_set_target_profile(new_argc - 2, new_argv + 2) < 0) {
+					ret = -1;
+					stress_parse_error(lineno, txt);
+					goto err;
+				}
+				continue;
+			}
+
 			/* prepend -- to command to make them into stress-ng options */
 			(void)snprintf(tmp, len, "--%s", new_argv[1]);
 			new_argv[1] = tmp;
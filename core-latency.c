@@ -0,0 +1,191 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+
+/*
+ *  stress_latency_reset()
+ *	empty a latency histogram
+ */
+void stress_latency_reset(stress_latency_t *lat)
+{
+	(void)memset(lat, 0, sizeof(*lat));
+}
+
+/*
+ *  stress_latency_merge()
+ *	add the samples of histogram src into histogram dst
+ */
+void stress_latency_merge(stress_latency_t *dst, const stress_latency_t *src)
+{
+	size_t i;
+
+	if (!src->count)
+		return;
+
+	if ((dst->count == 0) || (src->min < dst->min))
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->count += src->count;
+	dst->sum += src->sum;
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+}
+
+/*
+ *  stress_latency_bucket_value()
+ *	return the mid point latency in ns of a histogram bucket
+ */
+static uint64_t stress_latency_bucket_value(const size_t idx)
+{
+	size_t shift;
+	uint64_t sub;
+
+	if (idx < STRESS_LATENCY_SUB_BUCKETS)
+		return (uint64_t)idx;
+
+	shift = (idx / STRESS_LATENCY_SUB_BUCKETS) - 1;
+	sub = (uint64_t)((idx % STRESS_LATENCY_SUB_BUCKETS) + STRESS_LATENCY_SUB_BUCKETS);
+
+	return (sub << shift) + ((1ULL << shift) >> 1);
+}
+
+/*
+ *  stress_latency_percentile()
+ *	return the latency in ns at the given percentile (0..100),
+ *	the value is accurate to the histogram bucket resolution
+ */
+uint64_t stress_latency_percentile(const stress_latency_t *lat, const double percentile)
+{
+	uint64_t target, total = 0;
+	size_t i;
+
+	if (!lat->count)
+		return 0;
+	if (percentile >= 100.0)
+		return lat->max;
+
+	target = (uint64_t)(((double)lat->count * percentile) / 100.0);
+	if (target < 1)
+		target = 1;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++) {
+		total += lat->buckets[i];
+		if (total >= target) {
+			const uint64_t value = stress_latency_bucket_value(i);
+
+			/* clamp bucket mid point to the observed range */
+			if (value < lat->min)
+				return lat->min;
+			if (value > lat->max)
+				return lat->max;
+			return value;
+		}
+	}
+	return lat->max;
+}
+
+/*
+ *  stress_latency_mean()
+ *	return the mean latency in ns
+ */
+double stress_latency_mean(const stress_latency_t *lat)
+{
+	return lat->count ? lat->sum / (double)lat->count : 0.0;
+}
+
+/*
+ *  stress_latency_misc_stats()
+ *	report the p50, p99 and p99.9 latencies of the stressor
+ *	instance histogram as misc stats idx..idx + 2
+ */
+void stress_latency_misc_stats(
+	const stress_args_t *args,
+	const size_t idx,
+	const char *what)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	size_t i;
+
+	if (!args->latency || !args->latency->count)
+		return;
+
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		char description[32];
+
+		(void)snprintf(description, sizeof(description), "%s p%g latency (ns)",
+			what, percentiles[i]);
+		stress_misc_stats_set(args->misc_stats, idx + i, description,
+			(double)stress_latency_percentile(args->latency, percentiles[i]));
+	}
+}
+
+/*
+ *  stress_latency_dump()
+ *	dump the latency distribution of each stressor, the
+ *	histograms of all the instances are merged together
+ */
+void stress_latency_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+	static stress_latency_t lat;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+		const char *munged;
+
+		if (!ss->stats)
+			continue;
+
+		stress_latency_reset(&lat);
+		for (j = 0; j < ss->started_instances; j++)
+			stress_latency_merge(&lat, &ss->stats[j]->latency);
+		if (!lat.count)
+			continue;
+
+		if (!header) {
+			pr_inf("%-13s %10s %10s %10s %10s %10s %10s\n",
+				"latency (ns)", "samples", "mean", "p50",
+				"p99", "p99.9", "max");
+			pr_yaml(yaml, "latency:\n");
+			header = true;
+		}
+
+		munged = stress_munge_underscore(ss->stressor->name);
+		pr_inf("%-13s %10" PRIu64 " %10.0f %10" PRIu64 " %10" PRIu64
+			" %10" PRIu64 " %10" PRIu64 "\n",
+			munged, lat.count, stress_latency_mean(&lat),
+			stress_latency_percentile(&lat, 50.0),
+			stress_latency_percentile(&lat, 99.0),
+			stress_latency_percentile(&lat, 99.9),
+			lat.max);
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      samples: %" PRIu64 "\n", lat.count);
+		pr_yaml(yaml, "      mean-ns: %f\n", stress_latency_mean(&lat));
+		pr_yaml(yaml, "      min-ns: %" PRIu64 "\n", lat.min);
+		pr_yaml(yaml, "      p50-ns: %" PRIu64 "\n", stress_latency_percentile(&lat, 50.0));
+		pr_yaml(yaml, "      p99-ns: %" PRIu64 "\n", stress_latency_percentile(&lat, 99.0));
+		pr_yaml(yaml, "      p99.9-ns: %" PRIu64 "\n", stress_latency_percentile(&lat, 99.9));
+		pr_yaml(yaml, "      max-ns: %" PRIu64 "\n", lat.max);
+		pr_yaml(yaml, "\n");
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_LATENCY_H
+#define CORE_LATENCY_H
+
+#include "core-bitops.h"
+#include "core-clock.h"
+
+/*
+ *  stress_latency_now()
+ *	CLOCK_MONOTONIC time in ns for latency measurements; unlike
+ *	stress_clock_ns() it is valid across exec() and matches the
+ *	CLOCK_MONOTONIC deadlines given to clock_nanosleep()
+ */
+static inline uint64_t ALWAYS_INLINE stress_latency_now(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC)
+	return stress_clock_id_ns(CLOCK_MONOTONIC);
+#else
+	return (uint64_t)(stress_time_now() * STRESS_NANOSECOND);
+#endif
+}
+
+/*
+ *  stress_latency_bucket()
+ *	map a latency in ns to a histogram bucket index
+ */
+static inline size_t ALWAYS_INLINE stress_latency_bucket(const uint64_t ns)
+{
+	unsigned int msb;
+
+	if (ns < STRESS_LATENCY_SUB_BUCKETS)
+		return (size_t)ns;
+	if (ns >= (1ULL << STRESS_LATENCY_MAX_BITS))
+		return STRESS_LATENCY_BUCKETS - 1;
+
+	msb = stress_msb64(ns);
+	return ((size_t)(msb - STRESS_LATENCY_SUB_BITS) * STRESS_LATENCY_SUB_BUCKETS) +
+		(size_t)(ns >> (msb - STRESS_LATENCY_SUB_BITS));
+}
+
+/*
+ *  stress_latency_record()
+ *	add a latency sample in ns to a histogram, O(1)
+ */
+static inline void ALWAYS_INLINE stress_latency_record(
+	stress_latency_t *lat,
+	const uint64_t ns)
+{
+	if (UNLIKELY(!lat))
+		return;
+	if ((lat->count == 0) || (ns < lat->min))
+		lat->min = ns;
+	if (ns > lat->max)
+		lat->max = ns;
+	lat->count++;
+	lat->sum += (double)ns;
+	lat->buckets[stress_latency_bucket(ns)]++;
+}
+
+extern void stress_latency_reset(stress_latency_t *lat);
+extern void stress_latency_merge(stress_latency_t *dst,
+	const stress_latency_t *src);
+extern uint64_t stress_latency_percentile(const stress_latency_t *lat,
+	const double percentile);
+extern double stress_latency_mean(const stress_latency_t *lat);
+extern void stress_latency_misc_stats(const stress_args_t *args,
+	const size_t idx, const char *what);
+extern void stress_latency_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
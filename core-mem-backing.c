@@ -0,0 +1,303 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-mem-backing.h"
+
+#if !defined(MAP_HUGE_2MB) && defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_2MB	(21 << MAP_HUGE_SHIFT)
+#endif
+#if !defined(MAP_HUGE_1GB) && defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_1GB	(30 << MAP_HUGE_SHIFT)
+#endif
+
+#define THP_SIZE	(2 * MB)
+
+static bool mem_backing_reported;	/* backing reported by this process */
+
+typedef struct {
+	const char *name;	/* --mem-backing name */
+	const int backing;	/* STRESS_MEM_BACKING_* */
+	const size_t size;	/* page size */
+	const int flags;	/* extra mmap flags */
+} stress_mem_backing_info_t;
+
+static const stress_mem_backing_info_t mem_backing_info[] = {
+	{ "4k",		STRESS_MEM_BACKING_4K,	4 * KB,		0 },
+	{ "thp",	STRESS_MEM_BACKING_THP,	THP_SIZE,	0 },
+#if defined(MAP_HUGETLB) &&	\
+    defined(MAP_HUGE_2MB)
+	{ "2m",		STRESS_MEM_BACKING_2M,	2 * MB,		MAP_HUGETLB | MAP_HUGE_2MB },
+#endif
+#if defined(MAP_HUGETLB) &&	\
+    defined(MAP_HUGE_1GB)
+	{ "1g",		STRESS_MEM_BACKING_1G,	GB,		MAP_HUGETLB | MAP_HUGE_1GB },
+#endif
+};
+
+/*
+ *  stress_set_mem_backing()
+ *	set the --mem-backing page backing
+ */
+int stress_set_mem_backing(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(mem_backing_info); i++) {
+		if (!strcmp(opt, mem_backing_info[i].name))
+			return stress_set_setting_global("mem-backing",
+				TYPE_ID_INT, &mem_backing_info[i].backing);
+	}
+	(void)fprintf(stderr, "invalid mem-backing '%s', allowed backings are:", opt);
+	for (i = 0; i < SIZEOF_ARRAY(mem_backing_info); i++) {
+		(void)fprintf(stderr, " %s", mem_backing_info[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+/*
+ *  stress_mem_backing_thp_percent()
+ *	percentage of the mapping containing addr that is backed
+ *	by transparent huge pages, -1 if it cannot be determined
+ */
+double stress_mem_backing_thp_percent(const void *addr)
+{
+	FILE *fp;
+	char buf[256];
+	const uintptr_t ptr = (uintptr_t)addr;
+	uint64_t vma_size = 0;
+	double percent = -1.0;
+	bool found = false;
+
+	fp = fopen("/proc/self/smaps", "r");
+	if (!fp)
+		return -1.0;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		uint64_t start, end, kb;
+
+		if (!found) {
+			if ((sscanf(buf, "%" SCNx64 "-%" SCNx64, &start, &end) == 2) &&
+			    (start <= ptr) && (ptr < end)) {
+				found = true;
+				vma_size = end - start;
+			}
+			continue;
+		}
+		if (sscanf(buf, "AnonHugePages: %" SCNu64, &kb) == 1) {
+			if (vma_size)
+				percent = 100.0 * (double)(kb * KB) / (double)vma_size;
+			break;
+		}
+	}
+	(void)fclose(fp);
+
+	return percent;
+}
+
+/*
+ *  stress_mem_backing_report()
+ *	report the backing the first mapping of the first
+ *	instance actually got
+ */
+static void stress_mem_backing_report(
+	const stress_args_t *args,
+	const stress_mem_backing_info_t *info,
+	const void *ptr,
+	const char *got)
+{
+	if (mem_backing_reported || (args->instance != 0))
+		return;
+	mem_backing_reported = true;
+
+	if (info->backing == STRESS_MEM_BACKING_THP) {
+		const double percent = stress_mem_backing_thp_percent(ptr);
+
+		if (percent >= 0.0) {
+			pr_inf("%s: memory backing: requested thp, got thp with "
+				"%.1f%% of the buffer in huge pages\n",
+				args->name, percent);
+			return;
+		}
+	}
+	pr_inf("%s: memory backing: requested %s, got %s\n",
+		args->name, info->name, got);
+}
+
+/*
+ *  stress_mem_backing_mmap_thp()
+ *	mmap anonymous memory aligned to the THP size and
+ *	advise the kernel to back it with huge pages
+ */
+static void *stress_mem_backing_mmap_thp(
+	const size_t sz,
+	const int prot,
+	const int flags)
+{
+	uint8_t *ptr, *aligned;
+	size_t head, tail;
+
+	/* populate after the advice so the faults get huge pages */
+#if defined(MAP_POPULATE)
+	ptr = (uint8_t *)mmap(NULL, sz + THP_SIZE, prot, flags & ~MAP_POPULATE, -1, 0);
+#else
+	ptr = (uint8_t *)mmap(NULL, sz + THP_SIZE, prot, flags, -1, 0);
+#endif
+	if (ptr == MAP_FAILED)
+		return MAP_FAILED;
+
+	aligned = (uint8_t *)(((uintptr_t)ptr + THP_SIZE - 1) & ~(uintptr_t)(THP_SIZE - 1));
+	head = (size_t)(aligned - ptr);
+	tail = THP_SIZE - head;
+	if (head)
+		(void)munmap((void *)ptr, head);
+	if (tail)
+		(void)munmap((void *)(aligned + sz), tail);
+
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE)
+	VOID_RET(int, madvise((void *)aligned, sz, MADV_HUGEPAGE));
+#endif
+#if defined(MAP_POPULATE)
+	if ((flags & MAP_POPULATE) && (prot & PROT_WRITE)) {
+		size_t i;
+
+		for (i = 0; i < sz; i += 4 * KB)
+			aligned[i] = 0;
+	}
+#endif
+	return (void *)aligned;
+}
+
+/*
+ *  stress_mem_backing_mmap_type()
+ *	mmap an anonymous buffer of *sz bytes with a specific page
+ *	backing and no fall back to small pages, hugetlb mappings
+ *	round *sz up to the huge page size. Returns MAP_FAILED if
+ *	the backing is not available
+ */
+void *stress_mem_backing_mmap_type(
+	const int backing,
+	size_t *sz,
+	const int prot,
+	const int flags)
+{
+	void *ptr;
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(mem_backing_info); i++) {
+		const stress_mem_backing_info_t *info = &mem_backing_info[i];
+
+		if (info->backing != backing)
+			continue;
+		switch (backing) {
+		case STRESS_MEM_BACKING_2M:
+		case STRESS_MEM_BACKING_1G:
+			{
+				const size_t len = (*sz + info->size - 1) & ~(info->size - 1);
+
+				ptr = mmap(NULL, len, prot, flags | info->flags, -1, 0);
+				if (ptr != MAP_FAILED)
+					*sz = len;
+				return ptr;
+			}
+		case STRESS_MEM_BACKING_THP:
+			return stress_mem_backing_mmap_thp(*sz, prot, flags);
+		default:
+			ptr = mmap(NULL, *sz, prot, flags, -1, 0);
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_NOHUGEPAGE)
+			if (ptr != MAP_FAILED)
+				VOID_RET(int, madvise(ptr, *sz, MADV_NOHUGEPAGE));
+#endif
+			return ptr;
+		}
+	}
+	/* backing not supported on this system */
+	errno = ENOTSUP;
+	return MAP_FAILED;
+}
+
+/*
+ *  stress_mem_backing_mmap()
+ *	mmap an anonymous buffer of *sz bytes with the --mem-backing
+ *	page backing, falling back to small pages if huge pages are
+ *	not available. hugetlb mappings round *sz up to the huge page
+ *	size, the caller must munmap *sz bytes.
+ */
+void *stress_mem_backing_mmap(
+	const stress_args_t *args,
+	size_t *sz,
+	const int prot,
+	const int flags)
+{
+	int backing = STRESS_MEM_BACKING_DEFAULT;
+	const stress_mem_backing_info_t *info = NULL;
+	void *ptr;
+	size_t i;
+
+	(void)stress_get_setting("mem-backing", &backing);
+
+	for (i = 0; i < SIZEOF_ARRAY(mem_backing_info); i++) {
+		if (mem_backing_info[i].backing == backing) {
+			info = &mem_backing_info[i];
+			break;
+		}
+	}
+	if (!info)
+		return mmap(NULL, *sz, prot, flags, -1, 0);
+
+	switch (backing) {
+	case STRESS_MEM_BACKING_2M:
+	case STRESS_MEM_BACKING_1G:
+		{
+			const size_t len = (*sz + info->size - 1) & ~(info->size - 1);
+
+			ptr = mmap(NULL, len, prot, flags | info->flags, -1, 0);
+			if (ptr != MAP_FAILED) {
+				*sz = len;
+				stress_mem_backing_report(args, info, ptr, info->name);
+				return ptr;
+			}
+			if (!mem_backing_reported && (args->instance == 0))
+				pr_inf("%s: cannot mmap %s huge pages, errno=%d (%s), "
+					"check /proc/sys/vm/nr_hugepages\n",
+					args->name, info->name, errno, strerror(errno));
+		}
+		break;
+	case STRESS_MEM_BACKING_THP:
+		ptr = stress_mem_backing_mmap_thp(*sz, prot, flags);
+		if (ptr != MAP_FAILED)
+			stress_mem_backing_report(args, info, ptr, "thp");
+		return ptr;
+	default:
+		break;
+	}
+
+	/* 4k, or fall back to small pages */
+	ptr = mmap(NULL, *sz, prot, flags, -1, 0);
+	if (ptr != MAP_FAILED) {
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_NOHUGEPAGE)
+		VOID_RET(int, madvise(ptr, *sz, MADV_NOHUGEPAGE));
+#endif
+		stress_mem_backing_report(args, info, ptr, "4k");
+	}
+	return ptr;
+}
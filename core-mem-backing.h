@@ -0,0 +1,36 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_MEM_BACKING_H
+#define CORE_MEM_BACKING_H
+
+/* --mem-backing page backing of memory bandwidth stressor buffers */
+#define STRESS_MEM_BACKING_DEFAULT	(0)	/* stressor's own mapping */
+#define STRESS_MEM_BACKING_4K		(1)	/* small pages, no THP */
+#define STRESS_MEM_BACKING_THP		(2)	/* transparent huge pages */
+#define STRESS_MEM_BACKING_2M		(3)	/* 2MB hugetlb pages */
+#define STRESS_MEM_BACKING_1G		(4)	/* 1GB hugetlb pages */
+
+extern int stress_set_mem_backing(const char *opt);
+extern void *stress_mem_backing_mmap(const stress_args_t *args, size_t *sz,
+	const int prot, const int flags);
+extern void *stress_mem_backing_mmap_type(const int backing, size_t *sz,
+	const int prot, const int flags);
+extern double stress_mem_backing_thp_percent(const void *addr);
+
+#endif
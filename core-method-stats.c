@@ -0,0 +1,123 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-method-stats.h"
+
+/*
+ *  stress_method_stats_reset()
+ *	clear all the per method stats of an instance
+ */
+void stress_method_stats_reset(stress_method_stats_t *method_stats)
+{
+	(void)memset(method_stats, 0,
+		sizeof(*method_stats) * STRESS_METHOD_STATS_MAX);
+}
+
+/*
+ *  stress_method_stats_init()
+ *	name method idx and set its reference rate in calls
+ *	per second, 0.0 if the method has no reference rate
+ */
+void stress_method_stats_init(
+	const stress_args_t *args,
+	const size_t idx,
+	const char *name,
+	const double rate)
+{
+	stress_method_stats_t *ms;
+
+	if (!args->method_stats || (idx >= STRESS_METHOD_STATS_MAX))
+		return;
+	ms = &args->method_stats[idx];
+	(void)shim_strlcpy(ms->name, name, sizeof(ms->name));
+	ms->rate = rate;
+}
+
+/*
+ *  stress_method_stats_dump()
+ *	dump the time spent, calls, ns per call and normalized
+ *	score of each method of each stressor, the stats of all
+ *	the instances are summed together. The score is the
+ *	call rate relative to the reference rate, so 1.0 is
+ *	the reference system
+ */
+void stress_method_stats_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged;
+		bool methods = false;
+		size_t i;
+
+		if (!ss->stats)
+			continue;
+
+		munged = stress_munge_underscore(ss->stressor->name);
+		for (i = 0; i < STRESS_METHOD_STATS_MAX; i++) {
+			uint64_t count = 0;
+			double duration = 0.0, ns_per_call, score;
+			const char *name = NULL;
+			double rate = 0.0;
+			int32_t j;
+
+			for (j = 0; j < ss->started_instances; j++) {
+				const stress_method_stats_t *ms = &ss->stats[j]->method_stats[i];
+
+				if (!ms->count)
+					continue;
+				name = ms->name;
+				rate = ms->rate;
+				count += ms->count;
+				duration += ms->duration;
+			}
+			if (!count || !name)
+				continue;
+
+			if (!header) {
+				pr_yaml(yaml, "method-stats:\n");
+				header = true;
+			}
+			if (!methods) {
+				pr_inf("%-13s %-16s %12s %10s %12s %8s\n",
+					"method stats", "method", "calls",
+					"time (s)", "ns per call", "score");
+				pr_yaml(yaml, "    - stressor: %s\n", munged);
+				pr_yaml(yaml, "      methods:\n");
+				methods = true;
+			}
+
+			ns_per_call = (duration * STRESS_NANOSECOND) / (double)count;
+			score = ((duration > 0.0) && (rate > 0.0)) ?
+				((double)count / duration) / rate : 0.0;
+
+			pr_inf("%-13s %-16s %12" PRIu64 " %10.4f %12.1f %8.3f\n",
+				munged, name, count, duration, ns_per_call, score);
+
+			pr_yaml(yaml, "        - method: %s\n", name);
+			pr_yaml(yaml, "          calls: %" PRIu64 "\n", count);
+			pr_yaml(yaml, "          time: %f\n", duration);
+			pr_yaml(yaml, "          ns-per-call: %f\n", ns_per_call);
+			pr_yaml(yaml, "          score: %f\n", score);
+		}
+		if (methods)
+			pr_yaml(yaml, "\n");
+	}
+}
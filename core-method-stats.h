@@ -0,0 +1,60 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_METHOD_STATS_H
+#define CORE_METHOD_STATS_H
+
+/*
+ *  stress_method_stats_add_count()
+ *	account count calls of method idx that took duration
+ *	seconds in total, for methods timed in batches
+ */
+static inline void ALWAYS_INLINE stress_method_stats_add_count(
+	const stress_args_t *args,
+	const size_t idx,
+	const uint64_t count,
+	const double duration)
+{
+	stress_method_stats_t *ms;
+
+	if (UNLIKELY(!args->method_stats || (idx >= STRESS_METHOD_STATS_MAX)))
+		return;
+	ms = &args->method_stats[idx];
+	ms->count += count;
+	ms->duration += duration;
+}
+
+/*
+ *  stress_method_stats_add()
+ *	account one call of method idx that took duration seconds
+ */
+static inline void ALWAYS_INLINE stress_method_stats_add(
+	const stress_args_t *args,
+	const size_t idx,
+	const double duration)
+{
+	stress_method_stats_add_count(args, idx, 1, duration);
+}
+
+extern void stress_method_stats_reset(stress_method_stats_t *method_stats);
+extern void stress_method_stats_init(const stress_args_t *args,
+	const size_t idx, const char *name, const double rate);
+extern void stress_method_stats_dump(FILE *yaml,
+	stress_stressor_t *stressors_list);
+
+#endif
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-metrics.h"
+
+#include <float.h>
+
+/* A single bogo-ops sample of one stressor instance */
+typedef struct {
+	double time;			/* time since start of sampling */
+	double rate;			/* bogo-ops per second in interval */
+	uint64_t counter;		/* bogo-ops counter */
+	uint32_t stressor;		/* nth stressor in stressor list */
+	uint32_t instance;		/* stressor instance */
+} stress_metrics_sample_t;
+
+static int32_t metrics_interval = 0;	/* sample period in seconds, 0 = off */
+static pid_t metrics_pid;		/* sampler process pid */
+static FILE *metrics_samples;		/* samples for the YAML dump */
+
+/*
+ *  stress_ops_sampler_init()
+ *	allocate a previous bogo-ops counter for each instance of
+ *	the stressors, returns -1 if out of memory
+ */
+int stress_ops_sampler_init(stress_ops_sampler_t *sampler, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t n = 0;
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n += (size_t)ss->num_instances;
+
+	sampler->counters = calloc(n ? n : 1, sizeof(*sampler->counters));
+	sampler->n = sampler->counters ? n : 0;
+	return sampler->counters ? 0 : -1;
+}
+
+/*
+ *  stress_ops_sampler_delta()
+ *	bogo-ops of the ith instance since the previous sample,
+ *	counters restart at zero on each --repeat run
+ */
+uint64_t stress_ops_sampler_delta(stress_ops_sampler_t *sampler, const size_t i, const uint64_t counter)
+{
+	uint64_t delta;
+
+	if (i >= sampler->n)
+		return 0;
+	delta = (counter >= sampler->counters[i]) ? counter - sampler->counters[i] : counter;
+	sampler->counters[i] = counter;
+	return delta;
+}
+
+/*
+ *  stress_ops_sampler_free()
+ *	free the previous bogo-ops counters
+ */
+void stress_ops_sampler_free(stress_ops_sampler_t *sampler)
+{
+	free(sampler->counters);
+	sampler->counters = NULL;
+	sampler->n = 0;
+}
+
+/*
+ *  stress_set_metrics_interval()
+ *	set the --metrics-interval sampling period in seconds
+ */
+int stress_set_metrics_interval(const char *const opt)
+{
+	metrics_interval = stress_get_int32(opt);
+	if ((metrics_interval < 1) || (metrics_interval > 3600)) {
+		(void)fprintf(stderr, "metrics-interval must in the range 1 to 3600.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_metrics_interval_sample()
+ *	sample all running stressor instances, output the bogo-ops
+ *	rate for the period since the previous sample
+ */
+static void stress_metrics_interval_sample(
+	stress_stressor_t *stressors_list,
+	stress_ops_sampler_t *sampler,
+	const double time_start,
+	const double time_prev,
+	const double time_now,
+	FILE *csv)
+{
+	static uint32_t sample_count = 0;
+	stress_stressor_t *ss;
+	uint32_t n;
+	size_t i = 0;
+	const int fd = metrics_samples ? fileno(metrics_samples) : -1;
+
+	if ((sample_count++ % 25) == 0)
+		pr_inf("metrics: %8s %-13s %12s %12s %12s %5s\n",
+			"time", "stressor", "bogo ops/s", "min inst/s",
+			"max inst/s", "procs");
+
+	for (n = 0, ss = stressors_list; ss; ss = ss->next, n++) {
+		int32_t j;
+		uint32_t instances = 0;
+		double total = 0.0, min = DBL_MAX, max = 0.0;
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+
+		if (!ss->stats)
+			continue;
+
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+			const uint64_t counter = stats->ci.counter;
+			const uint64_t delta = stress_ops_sampler_delta(sampler, i++, counter);
+			const double start = STRESS_MAXIMUM(stats->start, time_prev);
+			const double dt = time_now - start;
+			stress_metrics_sample_t sample;
+
+			/* Not started, or finished and nothing new to report */
+			if ((stats->start <= 0.0) || (!stats->pid && !delta))
+				continue;
+
+			sample.time = time_now - time_start;
+			sample.rate = (dt > 0.0) ? (double)delta / dt : 0.0;
+			sample.counter = counter;
+			sample.stressor = n;
+			sample.instance = (uint32_t)j;
+
+			total += sample.rate;
+			if (min > sample.rate)
+				min = sample.rate;
+			if (max < sample.rate)
+				max = sample.rate;
+			instances++;
+
+			if (csv) {
+				(void)fprintf(csv, "%.3f,%s,%" PRIu32 ",%" PRIu64 ",%.3f\n",
+					sample.time, munged, sample.instance,
+					sample.counter, sample.rate);
+			}
+			if (fd >= 0)
+				VOID_RET(ssize_t, write(fd, &sample, sizeof(sample)));
+		}
+		if (instances) {
+			pr_inf("metrics: %7.2fs %-13s %12.2f %12.2f %12.2f %5" PRIu32 "\n",
+				time_now - time_start, munged, total, min, max,
+				instances);
+		}
+	}
+	if (csv)
+		(void)fflush(csv);
+}
+
+/*
+ *  stress_metrics_interval_start()
+ *	start a process that samples the bogo-ops counters of
+ *	all the stressors every --metrics-interval seconds
+ */
+void stress_metrics_interval_start(stress_stressor_t *stressors_list)
+{
+	stress_ops_sampler_t sampler;
+	char *csv_filename = NULL;
+	FILE *csv = NULL;
+	double time_start, time_prev, time_next;
+
+	if (metrics_interval == 0)
+		return;
+
+	/*
+	 *  Samples are stashed in an anonymous temporary file
+	 *  for the YAML output at the end of the run
+	 */
+	metrics_samples = tmpfile();
+	if (!metrics_samples)
+		pr_dbg("metrics-interval: cannot create temporary sample file, "
+			"no YAML data will be recorded\n");
+
+	metrics_pid = fork();
+	if ((metrics_pid < 0) || (metrics_pid > 0))
+		return;
+
+	stress_set_proc_name("stress-ng-metrics");
+
+	if (stress_ops_sampler_init(&sampler, stressors_list) < 0) {
+		pr_err("metrics-interval: cannot allocate counter buffer\n");
+		_exit(EXIT_NO_RESOURCE);
+	}
+
+	if (stress_get_setting("metrics-interval-csv", &csv_filename)) {
+		csv = fopen(csv_filename, "w");
+		if (csv) {
+			(void)fprintf(csv, "time,stressor,instance,bogo-ops,bogo-ops-per-second\n");
+		} else {
+			pr_err("metrics-interval: cannot open CSV file %s, errno=%d (%s)\n",
+				csv_filename, errno, strerror(errno));
+		}
+	}
+
+	time_start = stress_time_now();
+	time_prev = time_start;
+	time_next = time_start;
+
+	while (keep_stressing_flag()) {
+		double delta, time_now;
+
+		time_next += (double)metrics_interval;
+		delta = time_next - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_NANOSECOND));
+
+		time_now = stress_time_now();
+		stress_metrics_interval_sample(stressors_list, &sampler,
+			time_start, time_prev, time_now, csv);
+		time_prev = time_now;
+	}
+	if (csv)
+		(void)fclose(csv);
+	stress_ops_sampler_free(&sampler);
+	_exit(0);
+}
+
+/*
+ *  stress_metrics_interval_stop()
+ *	stop the bogo-ops sampling process
+ */
+void stress_metrics_interval_stop(void)
+{
+	if (metrics_pid > 0) {
+		int status;
+
+		(void)kill(metrics_pid, SIGKILL);
+		(void)waitpid(metrics_pid, &status, 0);
+		metrics_pid = 0;
+	}
+}
+
+/*
+ *  stress_metrics_interval_dump()
+ *	dump the sampled bogo-ops time series to the YAML file
+ */
+void stress_metrics_interval_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_metrics_sample_t sample;
+	stress_stressor_t *ss = stressors_list;
+	uint32_t n = 0;
+	int fd;
+
+	if (!metrics_samples)
+		return;
+
+	fd = fileno(metrics_samples);
+	if (yaml && (lseek(fd, 0, SEEK_SET) == 0)) {
+		pr_yaml(yaml, "metrics-interval:\n");
+		while (read(fd, &sample, sizeof(sample)) == (ssize_t)sizeof(sample)) {
+			/* samples are in stressor list order, so seek forward only */
+			if (sample.stressor < n) {
+				ss = stressors_list;
+				n = 0;
+			}
+			for (; ss && (n < sample.stressor); ss = ss->next, n++)
+				;
+			if (!ss)
+				break;
+
+			pr_yaml(yaml, "    - time: %f\n", sample.time);
+			pr_yaml(yaml, "      stressor: %s\n",
+				stress_munge_underscore(ss->stressor->name));
+			pr_yaml(yaml, "      instance: %" PRIu32 "\n", sample.instance);
+			pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", sample.counter);
+			pr_yaml(yaml, "      bogo-ops-per-second: %f\n", sample.rate);
+		}
+		pr_yaml(yaml, "\n");
+	}
+	(void)fclose(metrics_samples);
+	metrics_samples = NULL;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_METRICS_H
+#define CORE_METRICS_H
+
+/* bogo-ops counter of each stressor instance at the previous sample */
+typedef struct {
+	uint64_t *counters;		/* one per stressor instance */
+	size_t n;			/* number of counters */
+} stress_ops_sampler_t;
+
+extern int stress_ops_sampler_init(stress_ops_sampler_t *sampler,
+	stress_stressor_t *stressors_list);
+extern uint64_t stress_ops_sampler_delta(stress_ops_sampler_t *sampler,
+	const size_t i, const uint64_t counter);
+extern void stress_ops_sampler_free(stress_ops_sampler_t *sampler);
+
+/* Periodic bogo-ops sampling, --metrics-interval */
+extern int stress_set_metrics_interval(const char *const opt);
+extern void stress_metrics_interval_start(stress_stressor_t *stressors_list);
+extern void stress_metrics_interval_stop(void);
+extern void stress_metrics_interval_dump(FILE *yaml,
+	stress_stressor_t *stressors_list);
+
+#endif
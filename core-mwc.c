@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-target-clones.h"
 
 #if defined(HAVE_SYS_AUXV_H)
 #include <sys/auxv.h>
@@ -31,13 +32,11 @@
 #define STRESS_MWC_SEED_Z	(362436069UL)
 #define STRESS_MWC_SEED_W	(521288629UL)
 
-/* Fast random number generator state */
-typedef struct {
-	uint32_t w;
-	uint32_t z;
-} stress_mwc_t;
+/* MWC lanes of stress_mwc_fill() */
+#define STRESS_MWC_LANES	(8)
 
-static stress_mwc_t mwc = {
+/* Fast random number generator state, used by the inline stress_mwc32() */
+stress_mwc_t g_mwc = {
 	STRESS_MWC_SEED_W,
 	STRESS_MWC_SEED_Z
 };
@@ -92,8 +91,8 @@ void stress_mwc_reseed(void)
 		uint64_t seed;
 
 		if (stress_get_setting("seed", &seed)) {
-			mwc.z = seed >> 32;
-			mwc.w = seed & 0xffffffff;
+			g_mwc.z = seed >> 32;
+			g_mwc.w = seed & 0xffffffff;
 			mwc_flush();
 			return;
 		} else {
@@ -102,35 +101,35 @@ void stress_mwc_reseed(void)
 		}
 	}
 	if (g_opt_flags & OPT_FLAGS_NO_RAND_SEED) {
-		mwc.w = STRESS_MWC_SEED_W;
-		mwc.z = STRESS_MWC_SEED_Z;
+		g_mwc.w = STRESS_MWC_SEED_W;
+		g_mwc.z = STRESS_MWC_SEED_Z;
 	} else {
 		struct timeval tv;
 		struct rusage r;
 		double m1, m5, m15;
 		int i, n;
 		const uint64_t aux_rnd = stress_aux_random_seed();
-		const intptr_t p1 = (intptr_t)&mwc.z;
+		const intptr_t p1 = (intptr_t)&g_mwc.z;
 		const intptr_t p2 = (intptr_t)&tv;
 
-		mwc.z = aux_rnd >> 32;
-		mwc.w = aux_rnd & 0xffffffff;
+		g_mwc.z = aux_rnd >> 32;
+		g_mwc.w = aux_rnd & 0xffffffff;
 		if (gettimeofday(&tv, NULL) == 0)
-			mwc.z ^= (uint64_t)tv.tv_sec ^ (uint64_t)tv.tv_usec;
-		mwc.z += ~(p1 - p2);
-		mwc.w += (uint64_t)getpid() ^ (uint64_t)getppid()<<12;
+			g_mwc.z ^= (uint64_t)tv.tv_sec ^ (uint64_t)tv.tv_usec;
+		g_mwc.z += ~(p1 - p2);
+		g_mwc.w += (uint64_t)getpid() ^ (uint64_t)getppid()<<12;
 		if (stress_get_load_avg(&m1, &m5, &m15) == 0) {
-			mwc.z += (uint64_t)(128.0 * (m1 + m15));
-			mwc.w += (uint64_t)(256.0 * (m5));
+			g_mwc.z += (uint64_t)(128.0 * (m1 + m15));
+			g_mwc.w += (uint64_t)(256.0 * (m5));
 		}
 		if (getrusage(RUSAGE_SELF, &r) == 0) {
-			mwc.z += r.ru_utime.tv_usec;
-			mwc.w += r.ru_utime.tv_sec;
+			g_mwc.z += r.ru_utime.tv_usec;
+			g_mwc.w += r.ru_utime.tv_sec;
 		}
-		mwc.z ^= stress_get_cpu();
-		mwc.w ^= stress_get_phys_mem_size();
+		g_mwc.z ^= stress_get_cpu();
+		g_mwc.w ^= stress_get_phys_mem_size();
 
-		n = (int)mwc.z % 1733;
+		n = (int)g_mwc.z % 1733;
 		for (i = 0; i < n; i++) {
 			(void)stress_mwc32();
 		}
@@ -144,8 +143,8 @@ void stress_mwc_reseed(void)
  */
 void stress_mwc_set_seed(const uint32_t w, const uint32_t z)
 {
-	mwc.w = w;
-	mwc.z = z;
+	g_mwc.w = w;
+	g_mwc.z = z;
 
 	mwc_flush();
 }
@@ -156,8 +155,8 @@ void stress_mwc_set_seed(const uint32_t w, const uint32_t z)
  */
 void stress_mwc_get_seed(uint32_t *w, uint32_t *z)
 {
-	*w = mwc.w;
-	*z = mwc.z;
+	*w = g_mwc.w;
+	*z = g_mwc.z;
 }
 
 /*
@@ -169,26 +168,51 @@ void stress_mwc_seed(void)
 	stress_mwc_set_seed(STRESS_MWC_SEED_W, STRESS_MWC_SEED_Z);
 }
 
-/*
- *  stress_mwc32()
- *      Multiply-with-carry random numbers
- *      fast pseudo random number generator, see
- *      http://www.cse.yorku.ca/~oz/marsaglia-rng.html
- */
-HOT OPTIMIZE3 uint32_t stress_mwc32(void)
-{
-	mwc.z = 36969 * (mwc.z & 65535) + (mwc.z >> 16);
-	mwc.w = 18000 * (mwc.w & 65535) + (mwc.w >> 16);
-	return (mwc.z << 16) + mwc.w;
-}
+#if defined(HAVE_VECMATH)
+typedef uint32_t stress_mwc_v8_t __attribute__ ((vector_size(STRESS_MWC_LANES * sizeof(uint32_t))));
+#endif
 
 /*
- *  stress_mwc64()
- *	get a 64 bit pseudo random number
+ *  stress_mwc_fill()
+ *	fill a buffer with pseudo random data, this runs
+ *	STRESS_MWC_LANES independent multiply-with-carry generators
+ *	side by side, one per vector lane, the lanes are seeded
+ *	from the main generator so --seed runs are repeatable
  */
-HOT OPTIMIZE3 uint64_t stress_mwc64(void)
+void TARGET_CLONES OPTIMIZE3 stress_mwc_fill(void *buf, const size_t len)
 {
-	return (((uint64_t)stress_mwc32()) << 32) | stress_mwc32();
+#if defined(HAVE_VECMATH)
+	stress_mwc_v8_t z, w, r;
+#else
+	uint32_t z[STRESS_MWC_LANES], w[STRESS_MWC_LANES], r[STRESS_MWC_LANES];
+#endif
+	register uint8_t *ptr = (uint8_t *)buf;
+	register const uint8_t *end = ptr + len;
+	size_t i;
+
+	for (i = 0; i < STRESS_MWC_LANES; i++) {
+		/* a zero z or w gets stuck at zero */
+		z[i] = stress_mwc32() | 1;
+		w[i] = stress_mwc32() | 1;
+	}
+
+	while (ptr < end) {
+		const size_t n = STRESS_MINIMUM((size_t)(end - ptr), sizeof(r));
+
+#if defined(HAVE_VECMATH)
+		z = 36969 * (z & 65535) + (z >> 16);
+		w = 18000 * (w & 65535) + (w >> 16);
+		r = (z << 16) + w;
+#else
+		for (i = 0; i < STRESS_MWC_LANES; i++) {
+			z[i] = 36969 * (z[i] & 65535) + (z[i] >> 16);
+			w[i] = 18000 * (w[i] & 65535) + (w[i] >> 16);
+			r[i] = (z[i] << 16) + w[i];
+		}
+#endif
+		(void)memcpy(ptr, &r, n);
+		ptr += n;
+	}
 }
 
 /*
@@ -292,3 +292,468 @@ void HOT stress_set_sockaddr_port(
 		break;
 	}
 }
+
+typedef struct {
+	const char *name;
+	const int placement;
+} stress_net_placement_t;
+
+static const stress_net_placement_t placements[] = {
+	{ "same-cpu",		NET_PLACEMENT_SAME_CPU },
+	{ "smt",		NET_PLACEMENT_SMT },
+	{ "llc",		NET_PLACEMENT_LLC },
+	{ "socket",		NET_PLACEMENT_SOCKET },
+	{ "cross-socket",	NET_PLACEMENT_CROSS_SOCKET },
+	{ "irq",		NET_PLACEMENT_IRQ },
+};
+
+/*
+ *  stress_net_placement_name()
+ *	return human readable placement name from placement number
+ */
+const char *stress_net_placement_name(const int placement)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(placements); i++) {
+		if (placements[i].placement == placement)
+			return placements[i].name;
+	}
+	return "none";
+}
+
+/*
+ *  stress_set_net_placement()
+ *	set the client/server CPU placement option
+ */
+int stress_set_net_placement(
+	const char *name,
+	const char *placement_name,
+	int *placement)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(placements); i++) {
+		if (!strcmp(placement_name, placements[i].name)) {
+			*placement = placements[i].placement;
+			return 0;
+		}
+	}
+	(void)fprintf(stderr, "%s: placement must be one of:", name);
+	for (i = 0; i < SIZEOF_ARRAY(placements); i++)
+		(void)fprintf(stderr, " %s", placements[i].name);
+	(void)fprintf(stderr, "\n");
+	*placement = NET_PLACEMENT_NONE;
+	return -1;
+}
+
+#if defined(HAVE_AFFINITY)
+/*
+ *  stress_net_cpulist()
+ *	parse a sysfs CPU list such as 0-3,8-11 into mask,
+ *	returns -1 if the file cannot be read
+ */
+static int stress_net_cpulist(const char *path, cpu_set_t *mask)
+{
+	char buffer[4096], *str = buffer, *end;
+
+	CPU_ZERO(mask);
+	(void)memset(buffer, 0, sizeof(buffer));
+	if (system_read(path, buffer, sizeof(buffer) - 1) < 1)
+		return -1;
+
+	for (;;) {
+		unsigned long lo, hi, i;
+
+		lo = strtoul(str, &end, 10);
+		if (end == str)
+			break;
+		hi = lo;
+		str = end;
+		if (*str == '-') {
+			str++;
+			hi = strtoul(str, &end, 10);
+			if (end == str)
+				break;
+			str = end;
+		}
+		for (i = lo; (i <= hi) && (i < CPU_SETSIZE); i++)
+			CPU_SET((int)i, mask);
+		if (*str != ',')
+			break;
+		str++;
+	}
+	return 0;
+}
+
+/*
+ *  stress_net_cpu_smt()
+ *	get the SMT siblings of cpu
+ */
+static void stress_net_cpu_smt(const int cpu, cpu_set_t *mask)
+{
+	char path[PATH_MAX];
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+	if (stress_net_cpulist(path, mask) < 0) {
+		CPU_ZERO(mask);
+		CPU_SET(cpu, mask);
+	}
+}
+
+/*
+ *  stress_net_cpu_llc()
+ *	get the CPUs sharing the last level data or unified cache with cpu
+ */
+static void stress_net_cpu_llc(const int cpu, cpu_set_t *mask)
+{
+	int idx, max_level = 0;
+
+	CPU_ZERO(mask);
+	CPU_SET(cpu, mask);
+
+	for (idx = 0; idx < 16; idx++) {
+		char path[PATH_MAX], buf[64];
+		cpu_set_t shared;
+		int level;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, idx);
+		(void)memset(buf, 0, sizeof(buf));
+		if (system_read(path, buf, sizeof(buf) - 1) < 1)
+			break;
+		if (!strncmp(buf, "Instruction", 11))
+			continue;
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, idx);
+		(void)memset(buf, 0, sizeof(buf));
+		if (system_read(path, buf, sizeof(buf) - 1) < 1)
+			continue;
+		level = atoi(buf);
+		if (level <= max_level)
+			continue;
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, idx);
+		if (stress_net_cpulist(path, &shared) < 0)
+			continue;
+		max_level = level;
+		(void)memcpy(mask, &shared, sizeof(*mask));
+	}
+}
+
+/*
+ *  stress_net_cpu_package()
+ *	get the physical package (socket) id of cpu, -1 if unknown
+ */
+static int stress_net_cpu_package(const int cpu)
+{
+	char path[PATH_MAX], buf[64];
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read(path, buf, sizeof(buf) - 1) < 1)
+		return -1;
+	return atoi(buf);
+}
+
+/*
+ *  stress_net_irq_cpus()
+ *	get the CPUs the IRQs of interface ifname are routed to, the
+ *	IRQs are found by matching the interface name or the name of
+ *	its device (e.g. virtio3 for virtio-net) in /proc/interrupts,
+ *	instance selects which of the queue IRQs to use. Returns the
+ *	IRQ number or -1 if none are found.
+ */
+static int stress_net_irq_cpus(
+	const char *ifname,
+	const uint32_t instance,
+	const cpu_set_t *allowed,
+	cpu_set_t *mask)
+{
+	FILE *fp;
+	char buf[4096], devname[PATH_MAX], path[PATH_MAX];
+	int irqs[256];
+	size_t n_irqs = 0, i;
+	ssize_t len;
+
+	CPU_ZERO(mask);
+	(void)snprintf(path, sizeof(path), "/sys/class/net/%s/device", ifname);
+	len = readlink(path, buf, sizeof(buf) - 1);
+	*devname = '\0';
+	if (len > 0) {
+		const char *base;
+
+		buf[len] = '\0';
+		base = strrchr(buf, '/');
+		(void)shim_strlcpy(devname, base ? base + 1 : buf, sizeof(devname));
+	}
+
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return -1;
+	while ((n_irqs < SIZEOF_ARRAY(irqs)) && fgets(buf, sizeof(buf), fp)) {
+		char *ptr;
+		int irq;
+
+		if (sscanf(buf, " %d:", &irq) != 1)
+			continue;
+		/* the IRQ name is the last field */
+		(void)strtok(buf, "\n");
+		ptr = strrchr(buf, ' ');
+		if (!ptr)
+			continue;
+		ptr++;
+		if (strncmp(ptr, ifname, strlen(ifname)) &&
+		    (!*devname || strncmp(ptr, devname, strlen(devname))))
+			continue;
+		/* skip virtio config and control vectors */
+		if (strstr(ptr, "-config") || strstr(ptr, "-control"))
+			continue;
+		irqs[n_irqs++] = irq;
+	}
+	(void)fclose(fp);
+
+	for (i = 0; i < n_irqs; i++) {
+		const int irq = irqs[(instance + i) % n_irqs];
+		cpu_set_t irq_mask;
+
+		(void)snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq);
+		if (stress_net_cpulist(path, &irq_mask) < 0)
+			continue;
+		CPU_AND(mask, &irq_mask, allowed);
+		if (CPU_COUNT(mask) > 0)
+			return irq;
+	}
+	return -1;
+}
+
+/*
+ *  stress_net_placement_partner()
+ *	find a CPU in allowed for the other end of a connection with one
+ *	end on cpu, returns -1 if the placement cannot be satisfied
+ */
+static int stress_net_placement_partner(
+	const int placement,
+	const int cpu,
+	const cpu_set_t *allowed)
+{
+	cpu_set_t smt, llc;
+	int i, package;
+
+	switch (placement) {
+	case NET_PLACEMENT_SAME_CPU:
+		return cpu;
+	case NET_PLACEMENT_SMT:
+		stress_net_cpu_smt(cpu, &smt);
+		for (i = 0; i < CPU_SETSIZE; i++) {
+			if ((i != cpu) && CPU_ISSET(i, &smt) && CPU_ISSET(i, allowed))
+				return i;
+		}
+		break;
+	case NET_PLACEMENT_LLC:
+		/* a different core sharing the last level cache */
+		stress_net_cpu_smt(cpu, &smt);
+		stress_net_cpu_llc(cpu, &llc);
+		for (i = 0; i < CPU_SETSIZE; i++) {
+			if (!CPU_ISSET(i, &smt) && CPU_ISSET(i, &llc) && CPU_ISSET(i, allowed))
+				return i;
+		}
+		break;
+	case NET_PLACEMENT_SOCKET:
+		/* the same package but not sharing the last level cache */
+		package = stress_net_cpu_package(cpu);
+		if (package < 0)
+			break;
+		stress_net_cpu_llc(cpu, &llc);
+		for (i = 0; i < CPU_SETSIZE; i++) {
+			if (CPU_ISSET(i, &llc) || !CPU_ISSET(i, allowed))
+				continue;
+			if (stress_net_cpu_package(i) == package)
+				return i;
+		}
+		break;
+	case NET_PLACEMENT_CROSS_SOCKET:
+		package = stress_net_cpu_package(cpu);
+		if (package < 0)
+			break;
+		for (i = 0; i < CPU_SETSIZE; i++) {
+			if (!CPU_ISSET(i, allowed))
+				continue;
+			if (stress_net_cpu_package(i) != package)
+				return i;
+		}
+		break;
+	default:
+		break;
+	}
+	return -1;
+}
+
+/*
+ *  stress_net_placement_cpus()
+ *	choose the server and client CPUs for a placement policy, the
+ *	instance number spreads instances over the allowed CPUs. Returns
+ *	0 on success or -1 if the placement cannot be satisfied on this
+ *	system.
+ */
+int stress_net_placement_cpus(
+	const stress_args_t *args,
+	const int placement,
+	const char *ifname,
+	int *server_cpu,
+	int *client_cpu)
+{
+	cpu_set_t allowed;
+	int i;
+
+	*server_cpu = -1;
+	*client_cpu = -1;
+	if (placement == NET_PLACEMENT_NONE)
+		return 0;
+
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot get CPU affinity, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+		return -1;
+	}
+	if (CPU_COUNT(&allowed) == 0)
+		return -1;
+
+	if (placement == NET_PLACEMENT_IRQ) {
+		cpu_set_t irq_mask;
+		int irq;
+
+		if (!ifname) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: irq placement requires a network "
+					"interface to be specified, skipping stressor\n",
+					args->name);
+			return -1;
+		}
+		irq = stress_net_irq_cpus(ifname, args->instance, &allowed, &irq_mask);
+		if (irq < 0) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: cannot find an IRQ for interface '%s' "
+					"on the allowed CPUs, skipping stressor\n",
+					args->name, ifname);
+			return -1;
+		}
+		for (i = 0; i < CPU_SETSIZE; i++) {
+			if (CPU_ISSET(i, &irq_mask))
+				break;
+		}
+		/* receiver on the IRQ CPU, sender on a core sharing its cache */
+		*server_cpu = i;
+		*client_cpu = stress_net_placement_partner(NET_PLACEMENT_LLC, i, &allowed);
+		if (*client_cpu < 0)
+			*client_cpu = i;
+		pr_dbg("%s: interface %s IRQ %d on CPU %d\n", args->name, ifname, irq, i);
+	} else {
+		if (stress_net_placement_pair(placement, args->instance, server_cpu, client_cpu) < 0) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: no CPUs available for %s placement, "
+					"skipping stressor\n", args->name,
+					stress_net_placement_name(placement));
+			return -1;
+		}
+	}
+
+	if (args->instance == 0)
+		pr_inf("%s: %s placement, server on CPU %d, client on CPU %d\n",
+			args->name, stress_net_placement_name(placement),
+			*server_cpu, *client_cpu);
+	return 0;
+}
+
+/*
+ *  stress_net_placement_pair()
+ *	find a pair of allowed CPUs that satisfy placement, the search
+ *	starts offset CPUs into the allowed CPUs. Returns 0 on success
+ *	or -1 if the placement cannot be satisfied.
+ */
+int stress_net_placement_pair(
+	const int placement,
+	const uint32_t offset,
+	int *cpu,
+	int *partner)
+{
+	cpu_set_t allowed;
+	int cpus[CPU_SETSIZE], n_cpus = 0, i;
+
+	*cpu = -1;
+	*partner = -1;
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+		return -1;
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (CPU_ISSET(i, &allowed))
+			cpus[n_cpus++] = i;
+	}
+	for (i = 0; i < n_cpus; i++) {
+		const int c = cpus[(int)((offset + (uint32_t)i) % (uint32_t)n_cpus)];
+		const int p = stress_net_placement_partner(placement, c, &allowed);
+
+		if (p >= 0) {
+			*cpu = c;
+			*partner = p;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ *  stress_net_placement_pin()
+ *	pin the calling process to cpu, a negative cpu is a no-op
+ */
+void stress_net_placement_pin(const int cpu)
+{
+	cpu_set_t mask;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+}
+#else
+int stress_net_placement_cpus(
+	const stress_args_t *args,
+	const int placement,
+	const char *ifname,
+	int *server_cpu,
+	int *client_cpu)
+{
+	(void)ifname;
+
+	*server_cpu = -1;
+	*client_cpu = -1;
+	if (placement == NET_PLACEMENT_NONE)
+		return 0;
+	if (args->instance == 0)
+		pr_inf_skip("%s: CPU placement requires CPU affinity support, "
+			"skipping stressor\n", args->name);
+	return -1;
+}
+
+int stress_net_placement_pair(
+	const int placement,
+	const uint32_t offset,
+	int *cpu,
+	int *partner)
+{
+	(void)placement;
+	(void)offset;
+
+	*cpu = -1;
+	*partner = -1;
+	return -1;
+}
+
+void stress_net_placement_pin(const int cpu)
+{
+	(void)cpu;
+}
+#endif
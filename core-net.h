@@ -30,6 +30,15 @@
 #define NET_ADDR_ANY		(0)
 #define NET_ADDR_LOOPBACK	(1)
 
+/* Client/server CPU placement policies */
+#define NET_PLACEMENT_NONE		(0)	/* no pinning */
+#define NET_PLACEMENT_SAME_CPU		(1)	/* both ends on one CPU */
+#define NET_PLACEMENT_SMT		(2)	/* SMT siblings */
+#define NET_PLACEMENT_LLC		(3)	/* different cores, shared LLC */
+#define NET_PLACEMENT_CROSS_SOCKET	(4)	/* different sockets */
+#define NET_PLACEMENT_IRQ		(5)	/* on the NIC queue IRQ CPU */
+#define NET_PLACEMENT_SOCKET		(6)	/* same socket, different LLC */
+
 /* Network helpers */
 extern void stress_set_net_port(const char *optname, const char *opt,
 	const int min_port, const int max_port, int *port);
@@ -45,5 +54,13 @@ extern void stress_set_sockaddr_port(const int domain, const int port,
 	struct sockaddr *sockaddr);
 extern int stress_net_interface_exists(const char *interface, const int domain, struct sockaddr *addr);
 extern WARN_UNUSED const char *stress_net_domain(const int domain);
+extern WARN_UNUSED int stress_set_net_placement(const char *name,
+	const char *placement_name, int *placement);
+extern WARN_UNUSED const char *stress_net_placement_name(const int placement);
+extern WARN_UNUSED int stress_net_placement_cpus(const stress_args_t *args,
+	const int placement, const char *ifname, int *server_cpu, int *client_cpu);
+extern WARN_UNUSED int stress_net_placement_pair(const int placement,
+	const uint32_t offset, int *cpu, int *partner);
+extern void stress_net_placement_pin(const int cpu);
 
 #endif
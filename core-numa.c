@@ -17,13 +17,170 @@
  *
  */
 #include "stress-ng.h"
+#include "core-numa.h"
 
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 #include <linux/mempolicy.h>
 #endif
 
+#if !defined(MPOL_BIND)
+#define MPOL_BIND		(2)
+#endif
+#if !defined(MPOL_INTERLEAVE)
+#define MPOL_INTERLEAVE		(3)
+#endif
+#if !defined(MPOL_MF_MOVE)
+#define MPOL_MF_MOVE		(1 << 1)
+#endif
+
 static const char option[] = "option --mbind";
 
+/*
+ *  stress_numa_parse_list()
+ *	parse a sysfs list such as "0-3,8,10-11" into ids,
+ *	returns the number of ids parsed
+ */
+static size_t stress_numa_parse_list(
+	const char *str,
+	unsigned long *ids,
+	const size_t max_ids)
+{
+	size_t n = 0;
+
+	while (*str && (n < max_ids)) {
+		unsigned long lo, hi, i;
+		char *end;
+
+		lo = strtoul(str, &end, 10);
+		if (end == str)
+			break;
+		hi = lo;
+		str = end;
+		if (*str == '-') {
+			str++;
+			hi = strtoul(str, &end, 10);
+			if (end == str)
+				break;
+			str = end;
+		}
+		for (i = lo; (i <= hi) && (n < max_ids); i++)
+			ids[n++] = i;
+		if (*str != ',')
+			break;
+		str++;
+	}
+	return n;
+}
+
+/*
+ *  stress_numa_mem_nodes()
+ *	fill nodes with the ids of the NUMA nodes that have memory,
+ *	returns the number of nodes found, 0 if NUMA is not available
+ */
+size_t stress_numa_mem_nodes(unsigned long *nodes, const size_t max_nodes)
+{
+	char buffer[4096];
+
+	(void)memset(buffer, 0, sizeof(buffer));
+	if ((system_read("/sys/devices/system/node/has_memory", buffer, sizeof(buffer) - 1) < 1) &&
+	    (system_read("/sys/devices/system/node/online", buffer, sizeof(buffer) - 1) < 1))
+		return 0;
+
+	return stress_numa_parse_list(buffer, nodes, max_nodes);
+}
+
+#if defined(HAVE_AFFINITY)
+/*
+ *  stress_numa_node_cpus()
+ *	set mask to the CPUs of a NUMA node, returns the
+ *	number of CPUs in the mask or -1 on failure
+ */
+int stress_numa_node_cpus(const unsigned long node, cpu_set_t *mask)
+{
+	char path[PATH_MAX], buffer[4096];
+	unsigned long *cpus;
+	const size_t max_cpus = CPU_SETSIZE;
+	size_t i, n;
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/node/node%lu/cpulist", node);
+	(void)memset(buffer, 0, sizeof(buffer));
+	if (system_read(path, buffer, sizeof(buffer) - 1) < 1)
+		return -1;
+
+	cpus = calloc(max_cpus, sizeof(*cpus));
+	if (!cpus)
+		return -1;
+	n = stress_numa_parse_list(buffer, cpus, max_cpus);
+
+	CPU_ZERO(mask);
+	for (i = 0; i < n; i++) {
+		if (cpus[i] < max_cpus)
+			CPU_SET((int)cpus[i], mask);
+	}
+	free(cpus);
+
+	return (int)n;
+}
+
+/*
+ *  stress_numa_cpu_node()
+ *	find the NUMA memory node of a CPU, returns 0 and sets
+ *	node if found, -1 if not found or NUMA is not available
+ */
+int stress_numa_cpu_node(const int cpu, unsigned long *node)
+{
+	unsigned long nodes[STRESS_NUMA_MAX_NODES];
+	const size_t n = stress_numa_mem_nodes(nodes, SIZEOF_ARRAY(nodes));
+	size_t i;
+
+	if ((cpu < 0) || (cpu >= CPU_SETSIZE))
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		cpu_set_t mask;
+
+		if (stress_numa_node_cpus(nodes[i], &mask) < 0)
+			continue;
+		if (CPU_ISSET(cpu, &mask)) {
+			*node = nodes[i];
+			return 0;
+		}
+	}
+	return -1;
+}
+#endif
+
+/*
+ *  stress_numa_mbind_nodes()
+ *	bind (or interleave) a memory range to the given NUMA nodes,
+ *	pages that are already faulted in are moved to the nodes
+ */
+int stress_numa_mbind_nodes(
+	void *addr,
+	const size_t len,
+	const bool interleave,
+	const unsigned long *nodes,
+	const size_t n)
+{
+	unsigned long nodemask[STRESS_NUMA_MAX_NODES / (sizeof(unsigned long) * 8)];
+	const unsigned long max_node = (unsigned long)sizeof(nodemask) * 8;
+	size_t i;
+
+	(void)memset(nodemask, 0, sizeof(nodemask));
+	for (i = 0; i < n; i++) {
+		if (nodes[i] >= max_node) {
+			errno = EINVAL;
+			return -1;
+		}
+		STRESS_SETBIT(nodemask, nodes[i]);
+	}
+
+	return (int)shim_mbind(addr, (unsigned long)len,
+		interleave ? MPOL_INTERLEAVE : MPOL_BIND,
+		nodemask, max_node, MPOL_MF_MOVE);
+}
+
 #if defined(__NR_get_mempolicy) &&      \
     defined(__NR_mbind) &&              \
     defined(__NR_migrate_pages) &&      \
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_NUMA_H
+#define CORE_NUMA_H
+
+#define STRESS_NUMA_MAX_NODES	(64)
+
+/* NUMA node helpers */
+extern size_t stress_numa_mem_nodes(unsigned long *nodes, const size_t max_nodes);
+#if defined(HAVE_AFFINITY)
+extern int stress_numa_node_cpus(const unsigned long node, cpu_set_t *mask);
+extern int stress_numa_cpu_node(const int cpu, unsigned long *node);
+#endif
+extern int stress_numa_mbind_nodes(void *addr, const size_t len,
+	const bool interleave, const unsigned long *nodes, const size_t n);
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-metrics.h"
+#include "core-openmetrics.h"
+
+#define DEFAULT_OPENMETRICS_INTERVAL	(5)	/* seconds */
+
+static int32_t openmetrics_interval = DEFAULT_OPENMETRICS_INTERVAL;
+static pid_t openmetrics_pid;		/* exporter process pid */
+static double openmetrics_start;	/* time the exporter was started */
+
+/*
+ *  stress_set_openmetrics_interval()
+ *	set the --openmetrics-interval update period in seconds
+ */
+int stress_set_openmetrics_interval(const char *const opt)
+{
+	openmetrics_interval = stress_get_int32(opt);
+	if ((openmetrics_interval < 1) || (openmetrics_interval > 3600)) {
+		(void)fprintf(stderr, "openmetrics-interval must in the range 1 to 3600.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_openmetrics_stressors()
+ *	write the per stressor metric families, rates are over the
+ *	period since the previous write, sampler is NULL when
+ *	there is no previous write
+ */
+static void stress_openmetrics_stressors(
+	FILE *fp,
+	stress_stressor_t *stressors_list,
+	stress_ops_sampler_t *sampler,
+	const double dt)
+{
+	stress_stressor_t *ss;
+	size_t i = 0;
+
+	(void)fprintf(fp, "# TYPE stress_ng_bogo_ops counter\n");
+	(void)fprintf(fp, "# HELP stress_ng_bogo_ops Bogo operations completed by a stressor instance.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		int32_t j;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->num_instances; j++) {
+			if (ss->stats[j]->start <= 0.0)
+				continue;
+			(void)fprintf(fp, "stress_ng_bogo_ops_total{stressor=\"%s\",instance=\"%" PRId32 "\"} %" PRIu64 "\n",
+				munged, j, ss->stats[j]->ci.counter);
+		}
+	}
+
+	(void)fprintf(fp, "# TYPE stress_ng_bogo_ops_rate gauge\n");
+	(void)fprintf(fp, "# HELP stress_ng_bogo_ops_rate Bogo operations per second of all instances of a stressor.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		double rate = 0.0;
+		int32_t j;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->num_instances; j++) {
+			const uint64_t counter = ss->stats[j]->ci.counter;
+
+			if (sampler) {
+				const uint64_t delta = stress_ops_sampler_delta(sampler, i++, counter);
+
+				if (ss->stats[j]->pid && (dt > 0.0))
+					rate += (double)delta / dt;
+			}
+		}
+		(void)fprintf(fp, "stress_ng_bogo_ops_rate{stressor=\"%s\"} %f\n",
+			stress_munge_underscore(ss->stressor->name), rate);
+	}
+
+	(void)fprintf(fp, "# TYPE stress_ng_instances_running gauge\n");
+	(void)fprintf(fp, "# HELP stress_ng_instances_running Stressor instances currently running.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j, running = 0;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->num_instances; j++)
+			running += (ss->stats[j]->pid > 0);
+		(void)fprintf(fp, "stress_ng_instances_running{stressor=\"%s\"} %" PRId32 "\n",
+			stress_munge_underscore(ss->stressor->name), running);
+	}
+
+	(void)fprintf(fp, "# TYPE stress_ng_instances_failed gauge\n");
+	(void)fprintf(fp, "# HELP stress_ng_instances_failed Stressor instances that finished with a failure.\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j, failed = 0;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			failed += ((stats->finish > 0.0) && !stats->pid && !stats->run_ok);
+		}
+		(void)fprintf(fp, "stress_ng_instances_failed{stressor=\"%s\"} %" PRId32 "\n",
+			stress_munge_underscore(ss->stressor->name), failed);
+	}
+}
+
+/*
+ *  stress_openmetrics_write()
+ *	write all the metrics to a temporary file and rename it
+ *	over the output file so readers never see a partial file
+ */
+static void stress_openmetrics_write(
+	const char *filename,
+	stress_stressor_t *stressors_list,
+	stress_ops_sampler_t *sampler,
+	const double dt)
+{
+	char tmp[PATH_MAX];
+	FILE *fp;
+
+	(void)snprintf(tmp, sizeof(tmp), "%s.%d.tmp", filename, (int)getpid());
+	fp = fopen(tmp, "w");
+	if (!fp) {
+		pr_dbg("openmetrics: cannot create %s, errno=%d (%s)\n",
+			tmp, errno, strerror(errno));
+		return;
+	}
+	(void)fprintf(fp, "# TYPE stress_ng info\n");
+	(void)fprintf(fp, "# HELP stress_ng stress-ng version.\n");
+	(void)fprintf(fp, "stress_ng_info{version=\"" VERSION "\"} 1\n");
+	(void)fprintf(fp, "# TYPE stress_ng_run_seconds gauge\n");
+	(void)fprintf(fp, "# HELP stress_ng_run_seconds Time since the stressors were started.\n");
+	(void)fprintf(fp, "stress_ng_run_seconds %f\n", stress_time_now() - openmetrics_start);
+
+	stress_openmetrics_stressors(fp, stressors_list, sampler, dt);
+	stress_vmstat_openmetrics(fp);
+	(void)fprintf(fp, "# EOF\n");
+
+	if ((fclose(fp) < 0) || (rename(tmp, filename) < 0)) {
+		pr_dbg("openmetrics: cannot update %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		(void)unlink(tmp);
+	}
+}
+
+/*
+ *  stress_openmetrics_start()
+ *	start a process that writes an OpenMetrics text file every
+ *	--openmetrics-interval seconds, suitable for a textfile
+ *	collector such as the node_exporter one
+ */
+void stress_openmetrics_start(stress_stressor_t *stressors_list)
+{
+	stress_ops_sampler_t sampler;
+	char *filename = NULL;
+	double time_prev, time_next;
+
+	if (!stress_get_setting("openmetrics", &filename))
+		return;
+
+	openmetrics_start = stress_time_now();
+	openmetrics_pid = fork();
+	if ((openmetrics_pid < 0) || (openmetrics_pid > 0))
+		return;
+
+	stress_set_proc_name("stress-ng-openmetrics");
+
+	if (stress_ops_sampler_init(&sampler, stressors_list) < 0) {
+		pr_err("openmetrics: cannot allocate counter buffer\n");
+		_exit(EXIT_NO_RESOURCE);
+	}
+
+	time_prev = openmetrics_start;
+	time_next = openmetrics_start;
+
+	while (keep_stressing_flag()) {
+		double delta, time_now;
+
+		time_next += (double)openmetrics_interval;
+		delta = time_next - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_NANOSECOND));
+
+		time_now = stress_time_now();
+		stress_openmetrics_write(filename, stressors_list,
+			&sampler, time_now - time_prev);
+		time_prev = time_now;
+	}
+	stress_ops_sampler_free(&sampler);
+	_exit(0);
+}
+
+/*
+ *  stress_openmetrics_stop()
+ *	stop the exporter process and write the final metrics
+ */
+void stress_openmetrics_stop(stress_stressor_t *stressors_list)
+{
+	char *filename = NULL;
+
+	if (openmetrics_pid > 0) {
+		int status;
+
+		(void)kill(openmetrics_pid, SIGKILL);
+		(void)waitpid(openmetrics_pid, &status, 0);
+		openmetrics_pid = 0;
+	}
+	if (stress_get_setting("openmetrics", &filename))
+		stress_openmetrics_write(filename, stressors_list, NULL, 0.0);
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-pacer.h"
+
+#define PACER_SPIN_MAX		(0.0001)	/* spin rather than sleep below 100us */
+
+static const char * const pacer_size_dists[] = {
+	"fixed",
+	"uniform",
+	"imix",
+};
+
+/*
+ *  stress_set_pacer_size_dist()
+ *	set a packet size distribution setting, stored as an index
+ *	into pacer_size_dists
+ */
+int stress_set_pacer_size_dist(const char *setting, const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(pacer_size_dists); i++) {
+		if (!strcmp(pacer_size_dists[i], opt))
+			return stress_set_setting(setting, TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "%s must be one of:", setting);
+	for (i = 0; i < SIZEOF_ARRAY(pacer_size_dists); i++)
+		(void)fprintf(stderr, " %s", pacer_size_dists[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_pacer_init()
+ *	start pacing at pps packets per second with an empty bucket
+ */
+void stress_pacer_init(stress_pacer_t *pacer, const uint64_t pps)
+{
+	(void)memset(pacer, 0, sizeof(*pacer));
+	pacer->rate = (double)pps;
+	pacer->start = stress_time_now();
+	pacer->last = pacer->start;
+}
+
+/*
+ *  stress_pacer_wait()
+ *	wait until at least one packet may be sent and take up to max
+ *	tokens, returns the number of packets to send, 0 if the
+ *	stressor should stop. The bucket holds at most one batch so
+ *	a stall is not followed by a burst larger than a batch.
+ */
+size_t stress_pacer_wait(stress_pacer_t *pacer, const size_t max)
+{
+	while (keep_stressing_flag()) {
+		const double now = stress_time_now();
+		double wait;
+
+		pacer->tokens += (now - pacer->last) * pacer->rate;
+		pacer->last = now;
+		if (pacer->tokens > (double)STRESS_PACER_BATCH)
+			pacer->tokens = (double)STRESS_PACER_BATCH;
+		if (pacer->tokens >= 1.0) {
+			size_t n = (size_t)pacer->tokens;
+
+			if (n > max)
+				n = max;
+			pacer->tokens -= (double)n;
+			return n;
+		}
+		wait = (1.0 - pacer->tokens) / pacer->rate;
+		if (wait > PACER_SPIN_MAX)
+			(void)shim_nanosleep_uint64((uint64_t)((wait - PACER_SPIN_MAX) * STRESS_NANOSECOND));
+	}
+	return 0;
+}
+
+/*
+ *  stress_pacer_size()
+ *	pick a packet size between min and max from distribution dist
+ */
+size_t stress_pacer_size(const size_t dist, const size_t min, const size_t max)
+{
+	size_t sz;
+
+	switch (dist) {
+	case STRESS_PACER_SIZE_UNIFORM:
+		return min + (stress_mwc32() % (max - min + 1));
+	case STRESS_PACER_SIZE_IMIX:
+		/* simple IMIX, 7 x 64, 4 x 576 and 1 x 1500 bytes */
+		sz = stress_mwc8() % 12;
+		sz = (sz < 7) ? 64 : ((sz < 11) ? 576 : 1500);
+		break;
+	default:
+		return max;
+	}
+	if (sz < min)
+		return min;
+	if (sz > max)
+		return max;
+	return sz;
+}
+
+/*
+ *  stress_pacer_send()
+ *	send n packets described by iov to fd, with sendmmsg when
+ *	available. names points to one destination address if
+ *	name_stride is 0 or to n addresses name_stride bytes apart.
+ *	ENOBUFS and EAGAIN count as send side drops.
+ */
+void stress_pacer_send(
+	stress_pacer_t *pacer,
+	const int fd,
+	struct iovec *iov,
+	void *names,
+	const socklen_t name_len,
+	const size_t name_stride,
+	const size_t n)
+{
+	size_t i = 0;
+#if defined(HAVE_SENDMMSG)
+	struct mmsghdr msgs[STRESS_PACER_BATCH];
+
+	(void)memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < n; i++) {
+		msgs[i].msg_hdr.msg_name = (uint8_t *)names + (i * name_stride);
+		msgs[i].msg_hdr.msg_namelen = name_len;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	i = 0;
+	while ((i < n) && keep_stressing_flag()) {
+		const int ret = sendmmsg(fd, &msgs[i], (unsigned int)(n - i), 0);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			/* the first message failed, skip over it */
+			if ((errno == ENOBUFS) || (errno == EAGAIN))
+				pacer->enobufs++;
+			else
+				pacer->failed++;
+			i++;
+			continue;
+		}
+		pacer->sent += (uint64_t)ret;
+		i += (size_t)ret;
+	}
+#else
+	for (i = 0; (i < n) && keep_stressing_flag(); i++) {
+		const struct sockaddr *name = (const struct sockaddr *)
+			((uint8_t *)names + (i * name_stride));
+
+		if (sendto(fd, iov[i].iov_base, iov[i].iov_len, 0, name, name_len) < 0) {
+			if ((errno == ENOBUFS) || (errno == EAGAIN))
+				pacer->enobufs++;
+			else
+				pacer->failed++;
+			continue;
+		}
+		pacer->sent++;
+	}
+#endif
+}
+
+/*
+ *  stress_pacer_stats()
+ *	report target and achieved packet rates and send side drops
+ */
+void stress_pacer_stats(const stress_args_t *args, const stress_pacer_t *pacer)
+{
+	const double dt = stress_time_now() - pacer->start;
+	const double pps = (dt > 0.0) ? (double)pacer->sent / dt : 0.0;
+
+	stress_misc_stats_set(args->misc_stats, 0, "target pps", pacer->rate);
+	stress_misc_stats_set(args->misc_stats, 1, "achieved pps", pps);
+	stress_misc_stats_set(args->misc_stats, 2, "ENOBUFS drops", (double)pacer->enobufs);
+	stress_misc_stats_set(args->misc_stats, 3, "send failures", (double)pacer->failed);
+	pr_dbg("%s: %.1f pps achieved of %.1f pps target (%.2f%%), "
+		"%" PRIu64 " ENOBUFS drops, %" PRIu64 " send failures\n",
+		args->name, pps, pacer->rate,
+		pacer->rate > 0.0 ? 100.0 * pps / pacer->rate : 0.0,
+		pacer->enobufs, pacer->failed);
+}
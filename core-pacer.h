@@ -0,0 +1,51 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PACER_H
+#define CORE_PACER_H
+
+/* Token bucket packet pacing for the flood stressors, --*-flood-pps */
+
+#define STRESS_PACER_BATCH	(32)	/* max packets per send batch */
+
+typedef enum {
+	STRESS_PACER_SIZE_FIXED,	/* always the maximum size */
+	STRESS_PACER_SIZE_UNIFORM,	/* uniform between min and max */
+	STRESS_PACER_SIZE_IMIX,		/* 7:4:1 mix of 64, 576, 1500 bytes */
+} stress_pacer_size_dist_t;
+
+typedef struct {
+	double rate;		/* target packets per second */
+	double tokens;		/* packets that may be sent now */
+	double last;		/* time of the last token refill */
+	double start;		/* time pacing started */
+	uint64_t sent;		/* packets sent */
+	uint64_t enobufs;	/* packets dropped by ENOBUFS/EAGAIN */
+	uint64_t failed;	/* packets that failed for other reasons */
+} stress_pacer_t;
+
+extern int stress_set_pacer_size_dist(const char *setting, const char *opt);
+extern void stress_pacer_init(stress_pacer_t *pacer, const uint64_t pps);
+extern size_t stress_pacer_wait(stress_pacer_t *pacer, const size_t max);
+extern size_t stress_pacer_size(const size_t dist, const size_t min, const size_t max);
+extern void stress_pacer_send(stress_pacer_t *pacer, const int fd,
+	struct iovec *iov, void *names, const socklen_t name_len,
+	const size_t name_stride, const size_t n);
+extern void stress_pacer_stats(const stress_args_t *args, const stress_pacer_t *pacer);
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PAGEMAP_H
+#define CORE_PAGEMAP_H
+
+/* Virtual to physical address lookups using /proc/self/pagemap */
+
+#define STRESS_PAGEMAP_PRESENT	(1ULL << 63)
+#define STRESS_PAGEMAP_PFN_MASK	((1ULL << 54) - 1)
+
+/*
+ *  stress_pagemap_entry()
+ *	read the pagemap entry of the page holding virt_addr from
+ *	the open pagemap fd, returns the bytes read or -1 on error
+ */
+static inline ssize_t stress_pagemap_entry(
+	const int fd,
+	const size_t page_size,
+	const uintptr_t virt_addr,
+	uint64_t *entry)
+{
+	const off_t offset = (off_t)((virt_addr / page_size) * sizeof(*entry));
+
+	if (lseek(fd, offset, SEEK_SET) != offset)
+		return -1;
+	return read(fd, entry, sizeof(*entry));
+}
+
+/*
+ *  stress_pagemap_phys()
+ *	get the physical address of virt_addr, returns 0 on success
+ *	or -1 if the page is not present or the page frame number is
+ *	hidden, it reads as zero without CAP_SYS_ADMIN
+ */
+static inline int stress_pagemap_phys(
+	const int fd,
+	const size_t page_size,
+	const uintptr_t virt_addr,
+	uint64_t *phys_addr)
+{
+	uint64_t entry, pfn;
+
+	if (stress_pagemap_entry(fd, page_size, virt_addr, &entry) != (ssize_t)sizeof(entry))
+		return -1;
+	if (!(entry & STRESS_PAGEMAP_PRESENT))
+		return -1;
+	pfn = entry & STRESS_PAGEMAP_PFN_MASK;
+	if (!pfn)
+		return -1;
+	*phys_addr = (pfn * page_size) | (virt_addr & (page_size - 1));
+	return 0;
+}
+
+#endif
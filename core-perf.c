@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-perf.h"
 #include "core-perf-event.h"
 
@@ -29,6 +30,8 @@
 #include <locale.h>
 #endif
 
+#include <float.h>
+
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H) &&	\
     defined(HAVE_SYSCALL)
@@ -45,6 +48,9 @@
 
 #define UNRESOLVED	(~0UL)
 
+/* max hardware events per group, must fit on the PMU counters */
+#define STRESS_PERF_GROUP_HW_MAX	(4)
+
 /* used for table of perf events to gather */
 typedef struct {
 	const unsigned int type;	/* perf types */
@@ -379,13 +385,62 @@ static char *stress_perf_yaml_label(char *dst, const char *src, const size_t n)
 	return dst;
 }
 
+/*
+ *  stress_perf_group_max()
+ *	maximum number of events in a group of a given perf type,
+ *	hardware groups are kept small so they fit on the PMU counters
+ *	and can be scheduled, software and tracepoint events can
+ *	always be scheduled so have no practical limit
+ */
+static inline int stress_perf_group_max(const unsigned int type)
+{
+	switch (type) {
+	case PERF_TYPE_HARDWARE:
+	case PERF_TYPE_HW_CACHE:
+		return STRESS_PERF_GROUP_HW_MAX;
+	default:
+		return STRESS_PERF_MAX;
+	}
+}
+
+/*
+ *  stress_perf_open_event()
+ *	open a perf event, added to group leader group_fd if >= 0
+ */
+static int stress_perf_open_event(
+	const stress_perf_info_t *pi,
+	const int group_fd,
+	const bool grouped)
+{
+	struct perf_event_attr attr;
+
+	(void)memset(&attr, 0, sizeof(attr));
+	attr.type = pi->type;
+	attr.config = pi->config;
+	/* group members follow the leader, so only the leader is disabled */
+	attr.disabled = (group_fd < 0);
+	attr.inherit = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+	if (grouped)
+		attr.read_format |= PERF_FORMAT_GROUP;
+	attr.size = sizeof(attr);
+
+	return stress_sys_perf_event_open(&attr, 0, -1, group_fd, 0);
+}
+
 /*
  *  stress_perf_open()
- *	open perf, get leader and perf fd's
+ *	open perf, get leader and perf fd's. Events of the same type
+ *	are opened as groups so that they are scheduled together and
+ *	read with one read(2) per group; if grouped reads are not
+ *	supported each event is opened on its own
  */
 int stress_perf_open(stress_perf_t *sp)
 {
 	size_t i;
+	int leader = -1, members = 0;
+	bool grouped = true;
 
 	if (!sp)
 		return -1;
@@ -397,26 +452,50 @@ int stress_perf_open(stress_perf_t *sp)
 
 	for (i = 0; i < STRESS_PERF_MAX; i++) {
 		sp->perf_stat[i].fd = -1;
+		sp->perf_stat[i].leader = -1;
 		sp->perf_stat[i].counter = 0;
 	}
 
 	for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++) {
-		if (perf_info[i].config != UNRESOLVED) {
-			struct perf_event_attr attr;
-
-			(void)memset(&attr, 0, sizeof(attr));
-			attr.type = perf_info[i].type;
-			attr.config = perf_info[i].config;
-			attr.disabled = 1;
-			attr.inherit = 1;
-			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
-					   PERF_FORMAT_TOTAL_TIME_RUNNING;
-			attr.size = sizeof(attr);
-			sp->perf_stat[i].fd =
-				stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
-			if (sp->perf_stat[i].fd > -1)
-				sp->perf_opened++;
+		int fd = -1;
+
+		if (perf_info[i].config == UNRESOLVED)
+			continue;
+
+		/* start a new group on a change of type or a full group */
+		if ((leader >= 0) &&
+		    ((perf_info[i].type != perf_info[leader].type) ||
+		     (members >= stress_perf_group_max(perf_info[i].type)))) {
+			leader = -1;
+			members = 0;
+		}
+
+		if (grouped && (leader >= 0)) {
+			fd = stress_perf_open_event(&perf_info[i],
+				sp->perf_stat[leader].fd, true);
+			if (fd > -1) {
+				sp->perf_stat[i].leader = leader;
+				members++;
+			}
+		}
+		if (fd < 0) {
+			/* not in a group, or could not join it, so lead a new one */
+			fd = stress_perf_open_event(&perf_info[i], -1, grouped);
+			if ((fd < 0) && grouped && (errno == EINVAL)) {
+				/* older kernels can't mix inherit and grouped reads */
+				fd = stress_perf_open_event(&perf_info[i], -1, false);
+				if (fd > -1)
+					grouped = false;
+			}
+			if ((fd > -1) && grouped) {
+				leader = (int)i;
+				members = 1;
+				sp->perf_stat[i].leader = leader;
+			}
 		}
+		sp->perf_stat[i].fd = fd;
+		if (fd > -1)
+			sp->perf_opened++;
 	}
 	if (!sp->perf_opened) {
 		int ret;
@@ -444,6 +523,40 @@ int stress_perf_open(stress_perf_t *sp)
 	return 0;
 }
 
+/*
+ *  stress_perf_is_leader()
+ *	true if counter i is a group leader or not in a group,
+ *	ioctls on these apply to all the events they control
+ */
+static inline bool stress_perf_is_leader(const stress_perf_t *sp, const size_t i)
+{
+	return (sp->perf_stat[i].leader < 0) ||
+	       ((size_t)sp->perf_stat[i].leader == i);
+}
+
+/*
+ *  stress_perf_close_group()
+ *	close counter i and, if it is a group leader, its members
+ */
+static void stress_perf_close_group(stress_perf_t *sp, const size_t i)
+{
+	size_t j;
+
+	if (sp->perf_stat[i].leader == (int)i) {
+		for (j = i + 1; j < STRESS_PERF_MAX && perf_info[j].label; j++) {
+			if ((sp->perf_stat[j].leader == (int)i) &&
+			    (sp->perf_stat[j].fd > -1)) {
+				(void)close(sp->perf_stat[j].fd);
+				sp->perf_stat[j].fd = -1;
+			}
+		}
+	}
+	if (sp->perf_stat[i].fd > -1) {
+		(void)close(sp->perf_stat[i].fd);
+		sp->perf_stat[i].fd = -1;
+	}
+}
+
 /*
  *  stress_perf_enable()
  *	enable perf counters
@@ -460,17 +573,15 @@ int stress_perf_enable(stress_perf_t *sp)
 	for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++) {
 		int fd = sp->perf_stat[i].fd;
 
-		if (fd > -1) {
+		if ((fd > -1) && stress_perf_is_leader(sp, i)) {
 			if (ioctl(fd, PERF_EVENT_IOC_RESET,
 				  PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
+				stress_perf_close_group(sp, i);
 				continue;
 			}
 			if (ioctl(fd, PERF_EVENT_IOC_ENABLE,
 				  PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
+				stress_perf_close_group(sp, i);
 			}
 		}
 	}
@@ -493,17 +604,71 @@ int stress_perf_disable(stress_perf_t *sp)
 	for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++) {
 		int fd = sp->perf_stat[i].fd;
 
-		if (fd > -1) {
+		if ((fd > -1) && stress_perf_is_leader(sp, i)) {
 			if (ioctl(fd, PERF_EVENT_IOC_DISABLE,
 			          PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
+				stress_perf_close_group(sp, i);
 			}
 		}
 	}
 	return 0;
 }
 
+/*
+ *  stress_perf_scaled()
+ *	scale a counter to compensate for multiplexing
+ */
+static uint64_t stress_perf_scaled(
+	const uint64_t counter,
+	const uint64_t time_enabled,
+	const uint64_t time_running)
+{
+	double scale;
+
+	/* Ensure we don't get division by zero */
+	if (time_running == 0) {
+		scale = (time_enabled == 0) ? 1.0 : 0.0;
+	} else {
+		scale = (double)time_enabled / (double)time_running;
+	}
+	return (uint64_t)((double)counter * scale);
+}
+
+/*
+ *  stress_perf_read_group()
+ *	read all the counters in the group led by counter i with
+ *	one read, all members share the same enabled/running times
+ *	so ratios between them are not skewed by multiplexing
+ */
+static void stress_perf_read_group(stress_perf_t *sp, const size_t i)
+{
+	uint64_t data[3 + STRESS_PERF_MAX];	/* nr, enabled, running, values */
+	const size_t data_offset = 3;
+	stress_perf_stat_t *ps = sp->perf_stat;
+	ssize_t ret;
+	uint64_t n = 0;
+	size_t j;
+
+	(void)memset(data, 0, sizeof(data));
+	ret = read(ps[i].fd, data, sizeof(data));
+	if (ret < (ssize_t)(data_offset * sizeof(uint64_t)))
+		data[0] = 0;
+
+	for (j = i; j < STRESS_PERF_MAX && perf_info[j].label; j++) {
+		if ((ps[j].leader != (int)i) || (ps[j].fd < 0))
+			continue;
+		/* values are in the order the members joined the group */
+		if ((n < data[0]) &&
+		    (ret >= (ssize_t)((data_offset + n + 1) * sizeof(uint64_t)))) {
+			ps[j].counter = stress_perf_scaled(data[data_offset + n],
+				data[1], data[2]);
+		} else {
+			ps[j].counter = STRESS_PERF_INVALID;
+		}
+		n++;
+	}
+}
+
 /*
  *  stress_perf_close()
  *	read counters and close
@@ -513,7 +678,6 @@ int stress_perf_close(stress_perf_t *sp)
 	size_t i = 0;
 	stress_perf_data_t data;
 	ssize_t ret;
-	double scale;
 
 	if (!sp)
 		return -1;
@@ -526,24 +690,27 @@ int stress_perf_close(stress_perf_t *sp)
 			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
 			continue;
 		}
+		if (sp->perf_stat[i].leader == (int)i) {
+			stress_perf_read_group(sp, i);
+			continue;
+		}
+		if (sp->perf_stat[i].leader >= 0)
+			continue;	/* read by the group leader */
 
 		(void)memset(&data, 0, sizeof(data));
 		ret = read(fd, &data, sizeof(data));
 		if (ret != sizeof(data))
 			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
-		else {
-			/* Ensure we don't get division by zero */
-			if (data.time_running == 0) {
-				scale = (data.time_enabled == 0) ? 1.0 : 0.0;
-			} else {
-				scale = (double)data.time_enabled /
-					(double)data.time_running;
-			}
-			sp->perf_stat[i].counter = (uint64_t)
-				((double)data.counter * scale);
+		else
+			sp->perf_stat[i].counter = stress_perf_scaled(data.counter,
+				data.time_enabled, data.time_running);
+	}
+
+	for (i = 0; i < STRESS_PERF_MAX && perf_info[i].label; i++) {
+		if (sp->perf_stat[i].fd > -1) {
+			(void)close(sp->perf_stat[i].fd);
+			sp->perf_stat[i].fd = -1;
 		}
-		(void)close(fd);
-		sp->perf_stat[i].fd = -1;
 	}
 
 out_ok:
@@ -592,6 +759,271 @@ static const char *stress_perf_stat_scale(const uint64_t counter, const double d
 	return buffer;
 }
 
+/*
+ *  stress_perf_index()
+ *	find index of a perf counter in perf_info, -1 if not found
+ */
+static int stress_perf_index(const unsigned int type, const unsigned long config)
+{
+	int p;
+
+	for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++) {
+		if ((perf_info[p].type == type) && (perf_info[p].config == config))
+			return p;
+	}
+	return -1;
+}
+
+/*
+ *  stress_perf_ratio()
+ *	compute scale * counters[num] / counters[denom], returns
+ *	false if either counter is missing or the denominator is zero
+ */
+static bool stress_perf_ratio(
+	const uint64_t *counters,
+	const int num,
+	const int denom,
+	const double scale,
+	double *value)
+{
+	if ((num < 0) || (denom < 0))
+		return false;
+	if ((counters[num] == STRESS_PERF_INVALID) ||
+	    (counters[denom] == STRESS_PERF_INVALID) ||
+	    (counters[denom] == 0))
+		return false;
+	*value = scale * (double)counters[num] / (double)counters[denom];
+	return true;
+}
+
+/* Metrics derived from the raw perf counters */
+enum {
+	STRESS_PERF_DERIVED_IPC = 0,
+	STRESS_PERF_DERIVED_CACHE_MPKI,
+	STRESS_PERF_DERIVED_BRANCH_MPKI,
+	STRESS_PERF_DERIVED_STALLED_CPI,
+	STRESS_PERF_DERIVED_LLC_MISS_RATIO,
+	STRESS_PERF_DERIVED_MAX,
+};
+
+static const struct {
+	const char *label;		/* human readable name */
+	const char *yaml_label;		/* yaml key */
+} perf_derived_info[STRESS_PERF_DERIVED_MAX] = {
+	{ "Instr. per Cycle",		"ipc" },
+	{ "Cache MPKI",			"cache_mpki" },
+	{ "Branch MPKI",		"branch_mpki" },
+	{ "Stall Cycles per Instr.",	"stalled_cycles_per_instr" },
+	{ "LLC Read Miss Ratio",	"llc_miss_ratio" },
+};
+
+/*
+ *  stress_perf_derived()
+ *	compute the derived metrics from a set of counters,
+ *	valid[] is set true for each metric that could be computed
+ */
+static void stress_perf_derived(
+	const uint64_t *counters,
+	double metrics[STRESS_PERF_DERIVED_MAX],
+	bool valid[STRESS_PERF_DERIVED_MAX])
+{
+	int cycles = -1, instr = -1, cache_misses = -1, branch_misses = -1;
+	int stalled_fe = -1, stalled_be = -1, llc_read = -1, llc_read_miss = -1;
+	double fe = 0.0, be = 0.0;
+	bool fe_ok, be_ok;
+
+#if STRESS_PERF_DEFINED(HW_CPU_CYCLES)
+	cycles = stress_perf_index(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+#endif
+#if STRESS_PERF_DEFINED(HW_INSTRUCTIONS)
+	instr = stress_perf_index(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+#endif
+#if STRESS_PERF_DEFINED(HW_CACHE_MISSES)
+	cache_misses = stress_perf_index(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+#if STRESS_PERF_DEFINED(HW_BRANCH_MISSES)
+	branch_misses = stress_perf_index(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+#if STRESS_PERF_DEFINED(HW_STALLED_CYCLES_FRONTEND)
+	stalled_fe = stress_perf_index(PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND);
+#endif
+#if STRESS_PERF_DEFINED(HW_STALLED_CYCLES_BACKEND)
+	stalled_be = stress_perf_index(PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND);
+#endif
+#if STRESS_PERF_DEFINED(HW_CACHE_LL)
+	llc_read = stress_perf_index(PERF_TYPE_HW_CACHE,
+		(PERF_COUNT_HW_CACHE_LL) |
+		((PERF_COUNT_HW_CACHE_OP_READ) << 8) |
+		((PERF_COUNT_HW_CACHE_RESULT_ACCESS) << 16));
+	llc_read_miss = stress_perf_index(PERF_TYPE_HW_CACHE,
+		(PERF_COUNT_HW_CACHE_LL) |
+		((PERF_COUNT_HW_CACHE_OP_READ) << 8) |
+		((PERF_COUNT_HW_CACHE_RESULT_MISS) << 16));
+#endif
+
+	valid[STRESS_PERF_DERIVED_IPC] = stress_perf_ratio(counters,
+		instr, cycles, 1.0, &metrics[STRESS_PERF_DERIVED_IPC]);
+	valid[STRESS_PERF_DERIVED_CACHE_MPKI] = stress_perf_ratio(counters,
+		cache_misses, instr, 1000.0, &metrics[STRESS_PERF_DERIVED_CACHE_MPKI]);
+	valid[STRESS_PERF_DERIVED_BRANCH_MPKI] = stress_perf_ratio(counters,
+		branch_misses, instr, 1000.0, &metrics[STRESS_PERF_DERIVED_BRANCH_MPKI]);
+	valid[STRESS_PERF_DERIVED_LLC_MISS_RATIO] = stress_perf_ratio(counters,
+		llc_read_miss, llc_read, 1.0, &metrics[STRESS_PERF_DERIVED_LLC_MISS_RATIO]);
+
+	/* Like perf stat, use the larger of the frontend and backend stalls */
+	fe_ok = stress_perf_ratio(counters, stalled_fe, instr, 1.0, &fe);
+	be_ok = stress_perf_ratio(counters, stalled_be, instr, 1.0, &be);
+	valid[STRESS_PERF_DERIVED_STALLED_CPI] = fe_ok || be_ok;
+	metrics[STRESS_PERF_DERIVED_STALLED_CPI] = STRESS_MAXIMUM(fe, be);
+}
+
+/*
+ *  stress_perf_instance_counters()
+ *	copy the counters of one stressor instance
+ */
+static void stress_perf_instance_counters(const stress_perf_t *sp, uint64_t *counters)
+{
+	int p;
+
+	for (p = 0; p < STRESS_PERF_MAX; p++)
+		counters[p] = sp->perf_stat[p].counter;
+}
+
+/*
+ *  stress_perf_derived_dump()
+ *	dump derived metrics of a stressor, with the min, max and
+ *	standard deviation of the per-instance values
+ */
+static void stress_perf_derived_dump(
+	FILE *yaml,
+	const stress_stressor_t *ss,
+	const uint64_t *counter_totals)
+{
+	uint64_t counters[STRESS_PERF_MAX];
+	double totals[STRESS_PERF_DERIVED_MAX];
+	double metrics[STRESS_PERF_DERIVED_MAX];
+	bool totals_valid[STRESS_PERF_DERIVED_MAX];
+	bool valid[STRESS_PERF_DERIVED_MAX];
+	bool any_valid = false;
+	int32_t j;
+	int d;
+
+	stress_perf_derived(counter_totals, totals, totals_valid);
+
+	for (d = 0; d < STRESS_PERF_DERIVED_MAX; d++) {
+		double min = DBL_MAX, max = -DBL_MAX, sum = 0.0, sum_sq = 0.0;
+		double mean, stddev;
+		int32_t n = 0;
+		char extra[80];
+
+		if (!totals_valid[d])
+			continue;
+		any_valid = true;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_perf_t *sp = ss->stats[j]->sp;
+
+			if (!stress_perf_stat_succeeded(sp))
+				continue;
+			stress_perf_instance_counters(sp, counters);
+			stress_perf_derived(counters, metrics, valid);
+			if (!valid[d])
+				continue;
+			if (min > metrics[d])
+				min = metrics[d];
+			if (max < metrics[d])
+				max = metrics[d];
+			sum += metrics[d];
+			sum_sq += metrics[d] * metrics[d];
+			n++;
+		}
+		if (n > 0) {
+			mean = sum / (double)n;
+			stddev = sum_sq / (double)n - (mean * mean);
+			stddev = (stddev > 0.0) ? shim_sqrt(stddev) : 0.0;
+		} else {
+			min = totals[d];
+			max = totals[d];
+			stddev = 0.0;
+		}
+
+		*extra = '\0';
+		if (n > 1)
+			(void)snprintf(extra, sizeof(extra),
+				" (min %.3f, max %.3f, stddev %.3f)",
+				min, max, stddev);
+		pr_inf("%26.3f %-24s%s\n", totals[d],
+			perf_derived_info[d].label, extra);
+
+		pr_yaml(yaml, "      %s: %f\n", perf_derived_info[d].yaml_label, totals[d]);
+		pr_yaml(yaml, "      %s_min: %f\n", perf_derived_info[d].yaml_label, min);
+		pr_yaml(yaml, "      %s_max: %f\n", perf_derived_info[d].yaml_label, max);
+		pr_yaml(yaml, "      %s_stddev: %f\n", perf_derived_info[d].yaml_label, stddev);
+	}
+
+	if (!any_valid)
+		return;
+
+	/* Per-instance breakdown for the YAML output */
+	pr_yaml(yaml, "      instances:\n");
+	for (j = 0; j < ss->started_instances; j++) {
+		const stress_perf_t *sp = ss->stats[j]->sp;
+
+		if (!stress_perf_stat_succeeded(sp))
+			continue;
+		stress_perf_instance_counters(sp, counters);
+		stress_perf_derived(counters, metrics, valid);
+
+		pr_yaml(yaml, "        - instance: %" PRId32 "\n", j);
+		for (d = 0; d < STRESS_PERF_DERIVED_MAX; d++) {
+			if (valid[d])
+				pr_yaml(yaml, "          %s: %f\n",
+					perf_derived_info[d].yaml_label, metrics[d]);
+		}
+	}
+}
+
+/*
+ *  stress_perf_stat_totals()
+ *	get the labels and totals of up to max perf counters of a
+ *	stressor summed over all its instances, returns the number
+ *	of valid counters
+ */
+size_t stress_perf_stat_totals(
+	const stress_stressor_t *ss,
+	const char **labels,
+	uint64_t *totals,
+	const size_t max)
+{
+	size_t p, n = 0;
+
+	for (p = 0; (p < STRESS_PERF_MAX) && perf_info[p].label && (n < max); p++) {
+		uint64_t total = 0;
+		bool valid = false;
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_perf_t *sp = ss->stats[j]->sp;
+			const uint64_t counter = sp->perf_stat[p].counter;
+
+			if (!stress_perf_stat_succeeded(sp))
+				continue;
+			if (counter == STRESS_PERF_INVALID) {
+				valid = false;
+				break;
+			}
+			total += counter;
+			valid = true;
+		}
+		if (valid) {
+			labels[n] = perf_info[p].label;
+			totals[n] = total;
+			n++;
+		}
+	}
+	return n;
+}
+
 void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const double duration)
 {
 	bool no_perf_stats = true;
@@ -617,13 +1049,15 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 		/* Sum totals across all instances of the stressor */
 		for (p = 0; p < STRESS_PERF_MAX && perf_info[p].label; p++) {
 			int32_t j;
-			stress_perf_t *sp = &ss->stats[0]->sp;
-
-			if (!stress_perf_stat_succeeded(sp))
-				continue;
 
 			for (j = 0; j < ss->started_instances; j++) {
-				const uint64_t counter = sp->perf_stat[p].counter;
+				const stress_perf_t *sp = ss->stats[j]->sp;
+				uint64_t counter;
+
+				if (!stress_perf_stat_succeeded(sp))
+					continue;
+
+				counter = sp->perf_stat[p].counter;
 
 				if (counter == STRESS_PERF_INVALID) {
 					counter_totals[p] = STRESS_PERF_INVALID;
@@ -694,6 +1128,7 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 					yaml_label, (double)ct / duration);
 			}
 		}
+		stress_perf_derived_dump(yaml, ss, counter_totals);
 		pr_yaml(yaml, "\n");
 	}
 	if (no_perf_stats) {
@@ -721,4 +1156,605 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 		}
 	}
 }
+
+/*
+ *  stress_perf_cache_open_event()
+ *	open a hardware cache event for the calling process
+ */
+static int stress_perf_cache_open_event(const unsigned int type, const uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	(void)memset(&attr, 0, sizeof(attr));
+	attr.type = type;
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.size = sizeof(attr);
+
+	return stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+}
+
+/*
+ *  stress_perf_cache_open()
+ *	open cache reference and miss counters for the calling
+ *	process, level 1 uses the L1 data cache read counters,
+ *	other levels use the generic (last level) cache counters
+ */
+int stress_perf_cache_open(stress_perf_cache_t *pc, const uint16_t cache_level)
+{
+	unsigned int type;
+	uint64_t config_refs, config_misses;
+
+	if (!pc)
+		return -1;
+
+	if (cache_level == 1) {
+		type = PERF_TYPE_HW_CACHE;
+		config_refs = PERF_COUNT_HW_CACHE_L1D |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
+		config_misses = PERF_COUNT_HW_CACHE_L1D |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	} else {
+		type = PERF_TYPE_HARDWARE;
+		config_refs = PERF_COUNT_HW_CACHE_REFERENCES;
+		config_misses = PERF_COUNT_HW_CACHE_MISSES;
+	}
+
+	pc->fd_refs = stress_perf_cache_open_event(type, config_refs);
+	pc->fd_misses = stress_perf_cache_open_event(type, config_misses);
+	if ((pc->fd_refs < 0) || (pc->fd_misses < 0)) {
+		stress_perf_cache_close(pc);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_perf_cache_read_counter()
+ *	read a multiplex scaled counter
+ */
+static int stress_perf_cache_read_counter(const int fd, uint64_t *counter)
+{
+	uint64_t data[3];	/* value, enabled, running */
+
+	if (fd < 0)
+		return -1;
+	if (read(fd, data, sizeof(data)) != (ssize_t)sizeof(data))
+		return -1;
+	*counter = stress_perf_scaled(data[0], data[1], data[2]);
+	return 0;
+}
+
+/*
+ *  stress_perf_cache_read()
+ *	read the cache reference and miss counters
+ */
+int stress_perf_cache_read(const stress_perf_cache_t *pc, uint64_t *refs, uint64_t *misses)
+{
+	if (!pc)
+		return -1;
+	if (stress_perf_cache_read_counter(pc->fd_refs, refs) < 0)
+		return -1;
+	return stress_perf_cache_read_counter(pc->fd_misses, misses);
+}
+
+/*
+ *  stress_perf_cycles_open()
+ *	open a CPU cycles counter for the calling process, kernel
+ *	cycles are included if allowed, returns the counter fd
+ */
+int stress_perf_cycles_open(void)
+{
+	struct perf_event_attr attr;
+	int fd;
+
+	(void)memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.size = sizeof(attr);
+
+	fd = stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+	if (fd < 0) {
+		/* perf_event_paranoid may only allow user space counting */
+		attr.exclude_kernel = 1;
+		fd = stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+	}
+	return fd;
+}
+
+/*
+ *  stress_perf_cycles_read()
+ *	read the CPU cycles counter
+ */
+int stress_perf_cycles_read(const int fd, uint64_t *cycles)
+{
+	return stress_perf_cache_read_counter(fd, cycles);
+}
+
+/*
+ *  stress_perf_dtlb_open()
+ *	open a data TLB load miss counter for the calling process,
+ *	returns the counter fd
+ */
+int stress_perf_dtlb_open(void)
+{
+	return stress_perf_cache_open_event(PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_DTLB |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+}
+
+/*
+ *  stress_perf_dtlb_read()
+ *	read the data TLB load miss counter
+ */
+int stress_perf_dtlb_read(const int fd, uint64_t *misses)
+{
+	return stress_perf_cache_read_counter(fd, misses);
+}
+
+/*
+ *  stress_perf_cache_close()
+ *	close the cache reference and miss counters
+ */
+void stress_perf_cache_close(stress_perf_cache_t *pc)
+{
+	if (!pc)
+		return;
+	if (pc->fd_refs >= 0)
+		(void)close(pc->fd_refs);
+	if (pc->fd_misses >= 0)
+		(void)close(pc->fd_misses);
+	pc->fd_refs = -1;
+	pc->fd_misses = -1;
+}
+
+#define STRESS_PERF_UNCORE_PATH		"/sys/bus/event_source/devices"
+#define STRESS_PERF_UNCORE_MAX		(256)
+
+#define UNCORE_DRAM_READ		(0)
+#define UNCORE_DRAM_WRITE		(1)
+#define UNCORE_LINK			(2)
+#define UNCORE_KIND_MAX			(3)
+
+/* an open system wide uncore counter on one CPU */
+typedef struct {
+	int fd;				/* counter fd */
+	int kind;			/* UNCORE_DRAM_READ .. UNCORE_LINK */
+	double bytes;			/* bytes per count */
+} stress_perf_uncore_counter_t;
+
+/* uncore traffic while a stressor ran, accumulated over its runs */
+typedef struct {
+	const stress_stressor_t *ss;	/* stressor */
+	uint64_t start[STRESS_PERF_UNCORE_MAX];	/* counts at the start of a run */
+	double start_time;		/* time at the start of a run */
+	double bytes[UNCORE_KIND_MAX];	/* accumulated traffic */
+	double run_time;		/* accumulated run time */
+} stress_perf_uncore_stressor_t;
+
+/* IMC event names, server CAS counts and client data counts */
+static const char * const uncore_imc_read[] = {
+	"cas_count_read", "data_read", "data_reads",
+};
+static const char * const uncore_imc_write[] = {
+	"cas_count_write", "data_write", "data_writes",
+};
+
+static stress_perf_uncore_counter_t uncore_counters[STRESS_PERF_UNCORE_MAX];
+static size_t uncore_counters_n;		/* number of uncore_counters */
+static bool uncore_counters_init;		/* PMUs have been scanned */
+static stress_perf_uncore_stressor_t *uncore_stressors;	/* per stressor traffic */
+static size_t uncore_stressors_n;		/* number of uncore_stressors */
+
+/*
+ *  stress_perf_uncore_format()
+ *	place the value of a PMU format term, e.g. event or umask,
+ *	into the config bits given by the format/ sysfs file,
+ *	returns false if the term is not a config term
+ */
+static bool stress_perf_uncore_format(
+	const char *pmu,
+	const char *term,
+	uint64_t val,
+	uint64_t *config)
+{
+	char path[PATH_MAX], buf[64];
+	char *ptr, *tok, *saveptr = NULL;
+
+	(void)snprintf(path, sizeof(path), "%s/%s/format/%s",
+		STRESS_PERF_UNCORE_PATH, pmu, term);
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+	if (strncmp(buf, "config:", 7))
+		return false;
+
+	/* bit ranges are filled from the least significant bits up */
+	for (ptr = buf + 7; (tok = strtok_r(ptr, ",\n", &saveptr)) != NULL; ptr = NULL) {
+		unsigned int lo, hi, width;
+		uint64_t mask;
+
+		if (sscanf(tok, "%u-%u", &lo, &hi) != 2) {
+			if (sscanf(tok, "%u", &lo) != 1)
+				return false;
+			hi = lo;
+		}
+		if ((hi < lo) || (hi > 63))
+			return false;
+		width = hi - lo + 1;
+		mask = (width == 64) ? ~0ULL : ((1ULL << width) - 1);
+		*config |= (val & mask) << lo;
+		val = (width == 64) ? 0 : val >> width;
+	}
+	return true;
+}
+
+/*
+ *  stress_perf_uncore_config()
+ *	convert an event string such as "event=0x04,umask=0x03"
+ *	into a perf config value using the PMU format terms
+ */
+static bool stress_perf_uncore_config(
+	const char *pmu,
+	const char *event,
+	uint64_t *config)
+{
+	char buf[256];
+	char *ptr, *tok, *saveptr = NULL;
+
+	*config = 0;
+	(void)shim_strlcpy(buf, event, sizeof(buf));
+	for (ptr = buf; (tok = strtok_r(ptr, ",\n", &saveptr)) != NULL; ptr = NULL) {
+		char *eq = strchr(tok, '=');
+		uint64_t val = 1;
+
+		if (eq) {
+			*eq = '\0';
+			val = (uint64_t)strtoull(eq + 1, NULL, 0);
+		}
+		if (!stress_perf_uncore_format(pmu, tok, val, config))
+			return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_perf_uncore_event_bytes()
+ *	bytes per count of a named PMU event from the .scale and
+ *	.unit sysfs files, the default is one 64 byte cache line
+ */
+static double stress_perf_uncore_event_bytes(const char *pmu, const char *name)
+{
+	char path[PATH_MAX], buf[64];
+	double scale;
+
+	(void)snprintf(path, sizeof(path), "%s/%s/events/%s.scale",
+		STRESS_PERF_UNCORE_PATH, pmu, name);
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return 64.0;
+	scale = atof(buf);
+	if (scale <= 0.0)
+		return 64.0;
+
+	(void)snprintf(path, sizeof(path), "%s/%s/events/%s.unit",
+		STRESS_PERF_UNCORE_PATH, pmu, name);
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return scale;
+	if (!strncmp(buf, "MiB", 3))
+		return scale * (double)MB;
+	if (!strncmp(buf, "KiB", 3))
+		return scale * (double)KB;
+	if (!strncmp(buf, "MB", 2))
+		return scale * 1.0E6;
+	return scale;
+}
+
+/*
+ *  stress_perf_uncore_open()
+ *	open a system wide counter of a PMU event on each CPU in
+ *	the PMU cpumask, uncore PMUs are counted on one CPU per
+ *	socket, returns the number of counters opened
+ */
+static size_t stress_perf_uncore_open(
+	const char *pmu,
+	const uint64_t config,
+	const int kind,
+	const double bytes)
+{
+	char path[PATH_MAX], buf[256];
+	char *ptr, *tok, *saveptr = NULL;
+	struct perf_event_attr attr;
+	size_t opened = 0;
+	int type;
+
+	(void)snprintf(path, sizeof(path), "%s/%s/type", STRESS_PERF_UNCORE_PATH, pmu);
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return 0;
+	type = atoi(buf);
+	(void)snprintf(path, sizeof(path), "%s/%s/cpumask", STRESS_PERF_UNCORE_PATH, pmu);
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		(void)shim_strlcpy(buf, "0", sizeof(buf));
+
+	(void)memset(&attr, 0, sizeof(attr));
+	attr.type = (uint32_t)type;
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.size = sizeof(attr);
+
+	for (ptr = buf; (tok = strtok_r(ptr, ",\n", &saveptr)) != NULL; ptr = NULL) {
+		int lo, hi, cpu;
+
+		if (sscanf(tok, "%d-%d", &lo, &hi) != 2) {
+			if (sscanf(tok, "%d", &lo) != 1)
+				continue;
+			hi = lo;
+		}
+		for (cpu = lo; cpu <= hi; cpu++) {
+			stress_perf_uncore_counter_t *uc;
+			int fd;
+
+			if (uncore_counters_n >= STRESS_PERF_UNCORE_MAX)
+				return opened;
+			fd = stress_sys_perf_event_open(&attr, -1, cpu, -1, 0);
+			if (fd < 0)
+				continue;
+			uc = &uncore_counters[uncore_counters_n++];
+			uc->fd = fd;
+			uc->kind = kind;
+			uc->bytes = bytes;
+			opened++;
+		}
+	}
+	return opened;
+}
+
+/*
+ *  stress_perf_uncore_named()
+ *	open the first of a list of named PMU events that the
+ *	PMU provides, returns the number of counters opened
+ */
+static size_t stress_perf_uncore_named(
+	const char *pmu,
+	const char * const names[],
+	const size_t n,
+	const int kind)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		char path[PATH_MAX], event[256];
+		uint64_t config;
+
+		(void)snprintf(path, sizeof(path), "%s/%s/events/%s",
+			STRESS_PERF_UNCORE_PATH, pmu, names[i]);
+		if (system_read(path, event, sizeof(event)) <= 0)
+			continue;
+		if (!stress_perf_uncore_config(pmu, event, &config))
+			continue;
+		return stress_perf_uncore_open(pmu, config, kind,
+			stress_perf_uncore_event_bytes(pmu, names[i]));
+	}
+	return 0;
+}
+
+/*
+ *  stress_perf_uncore_counters()
+ *	find the uncore memory controller and socket link PMUs
+ *	and open their traffic counters
+ */
+static void stress_perf_uncore_counters(void)
+{
+	struct dirent **namelist = NULL;
+	size_t dram = 0;
+	int i, n;
+
+	if (uncore_counters_init)
+		return;
+	uncore_counters_init = true;
+
+	n = scandir(STRESS_PERF_UNCORE_PATH, &namelist, NULL, alphasort);
+	for (i = 0; i < n; i++) {
+		const char *d_name = namelist[i]->d_name;
+
+		if (!strncmp(d_name, "uncore_imc", 10)) {
+			/* free running counters duplicate the IMC counters */
+			if (strstr(d_name, "free_running") && dram)
+				continue;
+			dram += stress_perf_uncore_named(d_name, uncore_imc_read,
+				SIZEOF_ARRAY(uncore_imc_read), UNCORE_DRAM_READ);
+			dram += stress_perf_uncore_named(d_name, uncore_imc_write,
+				SIZEOF_ARRAY(uncore_imc_write), UNCORE_DRAM_WRITE);
+		} else if (!strncmp(d_name, "uncore_upi_", 11)) {
+			uint64_t config;
+
+			/*
+			 *  TxL_FLITS.ALL_DATA, UPI has no named traffic
+			 *  events, a 64 byte cache line is sent as 9 flits
+			 */
+			if (stress_perf_uncore_config(d_name, "event=0x02,umask=0x0f", &config))
+				(void)stress_perf_uncore_open(d_name, config,
+					UNCORE_LINK, 64.0 / 9.0);
+		}
+	}
+	stress_dirent_list_free(namelist, n);
+}
+
+/*
+ *  stress_perf_uncore_read()
+ *	read all the uncore counters
+ */
+static void stress_perf_uncore_read(uint64_t counts[STRESS_PERF_UNCORE_MAX])
+{
+	size_t i;
+
+	for (i = 0; i < uncore_counters_n; i++) {
+		if (stress_perf_cache_read_counter(uncore_counters[i].fd, &counts[i]) < 0)
+			counts[i] = 0;
+	}
+}
+
+/*
+ *  stress_perf_uncore_find()
+ *	find or add the uncore traffic state of a stressor
+ */
+static stress_perf_uncore_stressor_t *stress_perf_uncore_find(const stress_stressor_t *ss)
+{
+	stress_perf_uncore_stressor_t *us;
+	size_t i;
+
+	for (i = 0; i < uncore_stressors_n; i++) {
+		if (uncore_stressors[i].ss == ss)
+			return &uncore_stressors[i];
+	}
+	us = realloc(uncore_stressors, (uncore_stressors_n + 1) * sizeof(*uncore_stressors));
+	if (!us)
+		return NULL;
+	uncore_stressors = us;
+	us = &uncore_stressors[uncore_stressors_n++];
+	(void)memset(us, 0, sizeof(*us));
+	us->ss = ss;
+	return us;
+}
+
+/*
+ *  stress_perf_uncore_start()
+ *	read the uncore counters at the start of a run of the
+ *	stressors in the list
+ */
+void stress_perf_uncore_start(stress_stressor_t *stressors_list)
+{
+	uint64_t counts[STRESS_PERF_UNCORE_MAX];
+	stress_stressor_t *ss;
+	double now;
+
+	if (!(g_opt_flags & OPT_FLAGS_PERF_UNCORE))
+		return;
+
+	stress_perf_uncore_counters();
+	if (!uncore_counters_n)
+		return;
+	stress_perf_uncore_read(counts);
+	now = stress_time_now();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_perf_uncore_stressor_t *us;
+
+		if (!ss->num_instances)
+			continue;
+		us = stress_perf_uncore_find(ss);
+		if (!us) {
+			pr_err("perf: cannot allocate uncore counter state\n");
+			return;
+		}
+		(void)memcpy(us->start, counts, sizeof(us->start));
+		us->start_time = now;
+	}
+}
+
+/*
+ *  stress_perf_uncore_stop()
+ *	read the uncore counters at the end of a run of the
+ *	stressors in the list and accumulate the traffic
+ */
+void stress_perf_uncore_stop(stress_stressor_t *stressors_list)
+{
+	uint64_t counts[STRESS_PERF_UNCORE_MAX];
+	stress_stressor_t *ss;
+	double now;
+
+	if (!(g_opt_flags & OPT_FLAGS_PERF_UNCORE) || !uncore_counters_n)
+		return;
+
+	stress_perf_uncore_read(counts);
+	now = stress_time_now();
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_perf_uncore_stressor_t *us;
+		size_t i;
+
+		if (!ss->num_instances)
+			continue;
+		us = stress_perf_uncore_find(ss);
+		if (!us)
+			continue;
+		for (i = 0; i < uncore_counters_n; i++) {
+			const stress_perf_uncore_counter_t *uc = &uncore_counters[i];
+
+			if (counts[i] >= us->start[i])
+				us->bytes[uc->kind] += (double)(counts[i] - us->start[i]) * uc->bytes;
+		}
+		us->run_time += now - us->start_time;
+	}
+}
+
+/*
+ *  stress_perf_uncore_dump()
+ *	report the DRAM and socket link bandwidth of each stressor
+ *	next to its bogo-ops, the counters are system wide so
+ *	stressors that run at the same time share the same traffic
+ */
+void stress_perf_uncore_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+	size_t i;
+
+	if (!(g_opt_flags & OPT_FLAGS_PERF_UNCORE))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_perf_uncore_stressor_t *us = stress_perf_uncore_find(ss);
+		double rd, wr, link, dram;
+		uint64_t c_total = 0;
+		int32_t j;
+
+		if (!us || !ss->stats || (us->run_time <= 0.0) || !uncore_counters_n)
+			continue;
+		for (j = 0; j < ss->started_instances; j++)
+			c_total += ss->stats[j]->ci.counter;
+		rd = us->bytes[UNCORE_DRAM_READ] / us->run_time / BILLION;
+		wr = us->bytes[UNCORE_DRAM_WRITE] / us->run_time / BILLION;
+		link = us->bytes[UNCORE_LINK] / us->run_time / BILLION;
+		dram = (us->bytes[UNCORE_DRAM_READ] + us->bytes[UNCORE_DRAM_WRITE]) / BILLION;
+
+		if (!header) {
+			pr_inf("perf: uncore traffic while each stressor ran (system wide):\n");
+			pr_inf("%-13s %12s %9s %9s %9s %9s %13s\n",
+				"stressor", "bogo-ops", "rd GB/s", "wr GB/s",
+				"DRAM GB/s", "link GB/s", "bogo-ops/GB");
+			pr_yaml(yaml, "perf-uncore:\n");
+			header = true;
+		}
+		pr_inf("%-13s %12" PRIu64 " %9.2f %9.2f %9.2f %9.2f %13.2f\n",
+			munged, c_total, rd, wr, rd + wr, link,
+			(dram > 0.0) ? (double)c_total / dram : 0.0);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      run-time: %f\n", us->run_time);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", c_total);
+		pr_yaml(yaml, "      dram-read-gb-per-sec: %f\n", rd);
+		pr_yaml(yaml, "      dram-write-gb-per-sec: %f\n", wr);
+		pr_yaml(yaml, "      dram-gb-per-sec: %f\n", rd + wr);
+		pr_yaml(yaml, "      link-gb-per-sec: %f\n", link);
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	else
+		pr_inf("perf: no uncore information, %s has no readable uncore "
+			"IMC or UPI counters\n", STRESS_PERF_UNCORE_PATH);
+
+	for (i = 0; i < uncore_counters_n; i++)
+		(void)close(uncore_counters[i].fd);
+	uncore_counters_n = 0;
+	free(uncore_stressors);
+	uncore_stressors = NULL;
+	uncore_stressors_n = 0;
+}
 #endif
@@ -28,7 +28,34 @@ extern int stress_perf_close(stress_perf_t *sp);
 extern bool stress_perf_stat_succeeded(const stress_perf_t *sp);
 extern void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *procs_head,
 	const double duration);
+extern size_t stress_perf_stat_totals(const stress_stressor_t *ss,
+	const char **labels, uint64_t *totals, const size_t max);
 extern void stress_perf_init(void);
+
+/* per process cache reference and miss counters */
+typedef struct {
+	int	fd_refs;		/* cache references counter fd */
+	int	fd_misses;		/* cache misses counter fd */
+} stress_perf_cache_t;
+
+extern int stress_perf_cache_open(stress_perf_cache_t *pc,
+	const uint16_t cache_level);
+extern int stress_perf_cache_read(const stress_perf_cache_t *pc,
+	uint64_t *refs, uint64_t *misses);
+extern void stress_perf_cache_close(stress_perf_cache_t *pc);
+
+/* per process CPU cycles counter */
+extern int stress_perf_cycles_open(void);
+extern int stress_perf_cycles_read(const int fd, uint64_t *cycles);
+
+/* per process data TLB load miss counter */
+extern int stress_perf_dtlb_open(void);
+extern int stress_perf_dtlb_read(const int fd, uint64_t *misses);
+
+/* system wide uncore DRAM and link traffic, --perf-uncore */
+extern void stress_perf_uncore_start(stress_stressor_t *stressors_list);
+extern void stress_perf_uncore_stop(stress_stressor_t *stressors_list);
+extern void stress_perf_uncore_dump(FILE *yaml, stress_stressor_t *stressors_list);
 #endif
 
 #endif
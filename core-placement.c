@@ -0,0 +1,382 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-placement.h"
+
+#define PLACEMENT_NONE		(0)
+#define PLACEMENT_SPREAD	(1)	/* across nodes, LLCs, cores then threads */
+#define PLACEMENT_COMPACT	(2)	/* fill threads, cores, LLCs then nodes */
+#define PLACEMENT_PER_CORE	(3)	/* one instance per physical core */
+#define PLACEMENT_PER_LLC	(4)	/* one instance per last level cache */
+#define PLACEMENT_PER_NODE	(5)	/* one instance per NUMA node */
+#define PLACEMENT_SMT_PAIRS	(6)	/* pairs of instances on SMT siblings */
+
+typedef struct {
+	const char *name;
+	int policy;
+} stress_placement_policy_t;
+
+static const stress_placement_policy_t placement_policies[] = {
+	{ "spread",	PLACEMENT_SPREAD },
+	{ "compact",	PLACEMENT_COMPACT },
+	{ "per-core",	PLACEMENT_PER_CORE },
+	{ "per-llc",	PLACEMENT_PER_LLC },
+	{ "per-node",	PLACEMENT_PER_NODE },
+	{ "smt-pairs",	PLACEMENT_SMT_PAIRS },
+};
+
+static int placement_policy = PLACEMENT_NONE;
+
+/*
+ *  stress_set_placement()
+ *	set the --placement policy
+ */
+int stress_set_placement(const char *const opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(placement_policies); i++) {
+		if (!strcmp(opt, placement_policies[i].name)) {
+			placement_policy = placement_policies[i].policy;
+			return 0;
+		}
+	}
+	(void)fprintf(stderr, "placement must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(placement_policies); i++)
+		(void)fprintf(stderr, " %s", placement_policies[i].name);
+	(void)fprintf(stderr, "\n");
+	_exit(EXIT_FAILURE);
+}
+
+#if defined(HAVE_AFFINITY) &&	\
+    defined(__linux__)
+
+/* topology of one CPU, the ids are from sysfs, the ranks are dense */
+typedef struct {
+	int32_t cpu;		/* CPU number */
+	int32_t node;		/* NUMA node id */
+	int32_t llc;		/* lowest CPU sharing the last level cache */
+	int32_t core;		/* lowest SMT sibling CPU */
+	int32_t node_rank;	/* node index */
+	int32_t llc_rank;	/* LLC index within the node */
+	int32_t core_rank;	/* core index within the LLC */
+	int32_t thread_rank;	/* SMT thread index within the core */
+} stress_placement_cpu_t;
+
+static int32_t *placement_order;	/* CPUs in placement order */
+static int32_t placement_order_n;	/* number of CPUs in placement_order */
+static bool placement_init;		/* placement_order has been built */
+
+/*
+ *  stress_placement_read_int()
+ *	read the first integer of a sysfs file, this is also the
+ *	lowest CPU of a CPU list such as 0-3 or 0,4
+ */
+static int32_t stress_placement_read_int(const char *path, const int32_t def)
+{
+	FILE *fp;
+	int32_t val;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return def;
+	if (fscanf(fp, "%" SCNd32, &val) != 1)
+		val = def;
+	(void)fclose(fp);
+	return val;
+}
+
+/*
+ *  stress_placement_node()
+ *	find the NUMA node of a CPU from its nodeN sysfs link
+ */
+static int32_t stress_placement_node(const int32_t cpu)
+{
+	char path[PATH_MAX];
+	struct dirent *d;
+	DIR *dir;
+	int32_t node = 0;
+
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%" PRId32, cpu);
+	dir = opendir(path);
+	if (!dir)
+		return 0;
+	while ((d = readdir(dir)) != NULL) {
+		if (sscanf(d->d_name, "node%" SCNd32, &node) == 1)
+			break;
+	}
+	(void)closedir(dir);
+	return node;
+}
+
+/*
+ *  stress_placement_llc()
+ *	find the lowest CPU that shares the highest level cache of a
+ *	CPU, CPUs without cache information have a cache of their own
+ */
+static int32_t stress_placement_llc(const int32_t cpu)
+{
+	char path[PATH_MAX];
+	int32_t index, level_max = -1, llc = cpu;
+
+	for (index = 0; index < 16; index++) {
+		int32_t level;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cache/index%" PRId32 "/level",
+			cpu, index);
+		level = stress_placement_read_int(path, -1);
+		if (level < 0)
+			break;
+		if (level <= level_max)
+			continue;
+		level_max = level;
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cache/index%" PRId32 "/shared_cpu_list",
+			cpu, index);
+		llc = stress_placement_read_int(path, cpu);
+	}
+	return llc;
+}
+
+/*
+ *  stress_placement_cmp_*()
+ *	sort orders of the policies, ties are broken on CPU number
+ *	so the order is always the same on the same machine
+ */
+#define PLACEMENT_CMP(a, b)				\
+do {							\
+	if ((a) != (b))					\
+		return ((a) < (b)) ? -1 : 1;		\
+} while (0)
+
+static int stress_placement_cmp_topology(const void *p1, const void *p2)
+{
+	const stress_placement_cpu_t *c1 = (const stress_placement_cpu_t *)p1;
+	const stress_placement_cpu_t *c2 = (const stress_placement_cpu_t *)p2;
+
+	PLACEMENT_CMP(c1->node, c2->node);
+	PLACEMENT_CMP(c1->llc, c2->llc);
+	PLACEMENT_CMP(c1->core, c2->core);
+	PLACEMENT_CMP(c1->cpu, c2->cpu);
+	return 0;
+}
+
+static int stress_placement_cmp_spread(const void *p1, const void *p2)
+{
+	const stress_placement_cpu_t *c1 = (const stress_placement_cpu_t *)p1;
+	const stress_placement_cpu_t *c2 = (const stress_placement_cpu_t *)p2;
+
+	PLACEMENT_CMP(c1->thread_rank, c2->thread_rank);
+	PLACEMENT_CMP(c1->core_rank, c2->core_rank);
+	PLACEMENT_CMP(c1->llc_rank, c2->llc_rank);
+	PLACEMENT_CMP(c1->node_rank, c2->node_rank);
+	PLACEMENT_CMP(c1->cpu, c2->cpu);
+	return 0;
+}
+
+static int stress_placement_cmp_smt_pairs(const void *p1, const void *p2)
+{
+	const stress_placement_cpu_t *c1 = (const stress_placement_cpu_t *)p1;
+	const stress_placement_cpu_t *c2 = (const stress_placement_cpu_t *)p2;
+
+	PLACEMENT_CMP(c1->core_rank, c2->core_rank);
+	PLACEMENT_CMP(c1->llc_rank, c2->llc_rank);
+	PLACEMENT_CMP(c1->node_rank, c2->node_rank);
+	PLACEMENT_CMP(c1->thread_rank, c2->thread_rank);
+	PLACEMENT_CMP(c1->cpu, c2->cpu);
+	return 0;
+}
+
+#undef PLACEMENT_CMP
+
+/*
+ *  stress_placement_wanted()
+ *	true if a CPU is used by the policy, the per-X policies
+ *	only use the first CPU of each core, LLC or node
+ */
+static bool stress_placement_wanted(const stress_placement_cpu_t *c)
+{
+	switch (placement_policy) {
+	case PLACEMENT_PER_CORE:
+		return c->thread_rank == 0;
+	case PLACEMENT_PER_LLC:
+		return (c->thread_rank == 0) && (c->core_rank == 0);
+	case PLACEMENT_PER_NODE:
+		return (c->thread_rank == 0) && (c->core_rank == 0) && (c->llc_rank == 0);
+	default:
+		return true;
+	}
+}
+
+/*
+ *  stress_placement_order()
+ *	build the placement order of the CPUs stress-ng is allowed
+ *	to run on, so --taskset limits the CPUs that are used
+ */
+static void stress_placement_order(void)
+{
+	stress_placement_cpu_t *cpus;
+	const int32_t max_cpus = STRESS_MINIMUM(stress_get_processors_configured(), CPU_SETSIZE);
+	cpu_set_t mask;
+	int32_t i, n = 0;
+
+	placement_init = true;
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf("placement: cannot get CPU affinity, errno=%d (%s), "
+			"instances will not be placed\n", errno, strerror(errno));
+		return;
+	}
+	cpus = calloc((size_t)max_cpus + 1, sizeof(*cpus));
+	placement_order = calloc((size_t)max_cpus + 1, sizeof(*placement_order));
+	if (!cpus || !placement_order) {
+		pr_inf("placement: cannot allocate CPU topology, instances will not be placed\n");
+		free(cpus);
+		free(placement_order);
+		placement_order = NULL;
+		return;
+	}
+
+	for (i = 0; i < max_cpus; i++) {
+		char path[PATH_MAX];
+		stress_placement_cpu_t *c = &cpus[n];
+
+		if (!CPU_ISSET(i, &mask))
+			continue;
+		c->cpu = i;
+		c->node = stress_placement_node(i);
+		c->llc = stress_placement_llc(i);
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/topology/thread_siblings_list", i);
+		c->core = stress_placement_read_int(path, i);
+		n++;
+	}
+
+	/*
+	 *  sort into topology order and rank the nodes, LLCs, cores
+	 *  and threads, the ranks of the first CPU are all zero
+	 */
+	qsort(cpus, (size_t)n, sizeof(*cpus), stress_placement_cmp_topology);
+	for (i = 1; i < n; i++) {
+		stress_placement_cpu_t *c = &cpus[i];
+		const stress_placement_cpu_t *prev = &cpus[i - 1];
+
+		if (c->node != prev->node) {
+			c->node_rank = prev->node_rank + 1;
+			c->llc_rank = 0;
+			c->core_rank = 0;
+			c->thread_rank = 0;
+		} else if (c->llc != prev->llc) {
+			c->node_rank = prev->node_rank;
+			c->llc_rank = prev->llc_rank + 1;
+			c->core_rank = 0;
+			c->thread_rank = 0;
+		} else if (c->core != prev->core) {
+			c->node_rank = prev->node_rank;
+			c->llc_rank = prev->llc_rank;
+			c->core_rank = prev->core_rank + 1;
+			c->thread_rank = 0;
+		} else {
+			c->node_rank = prev->node_rank;
+			c->llc_rank = prev->llc_rank;
+			c->core_rank = prev->core_rank;
+			c->thread_rank = prev->thread_rank + 1;
+		}
+	}
+
+	switch (placement_policy) {
+	case PLACEMENT_SPREAD:
+		qsort(cpus, (size_t)n, sizeof(*cpus), stress_placement_cmp_spread);
+		break;
+	case PLACEMENT_SMT_PAIRS:
+		qsort(cpus, (size_t)n, sizeof(*cpus), stress_placement_cmp_smt_pairs);
+		break;
+	default:
+		/* compact and the per-X policies use the topology order */
+		break;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (stress_placement_wanted(&cpus[i]))
+			placement_order[placement_order_n++] = cpus[i].cpu;
+	}
+	free(cpus);
+
+	for (i = 0; i < placement_order_n; i++)
+		pr_dbg("placement: position %" PRId32 " is CPU %" PRId32 "\n",
+			i, placement_order[i]);
+}
+
+/*
+ *  stress_placement_cpu()
+ *	return the CPU of the index'th instance started in a run,
+ *	instances wrap around when there are more instances than
+ *	CPUs, -1 if there is no placement policy
+ */
+int32_t stress_placement_cpu(const int32_t index)
+{
+	if (placement_policy == PLACEMENT_NONE)
+		return -1;
+	if (!placement_init)
+		stress_placement_order();
+	if (!placement_order_n || (index < 0))
+		return -1;
+	return placement_order[index % placement_order_n];
+}
+
+/*
+ *  stress_placement_set()
+ *	pin the calling process or instance thread to a CPU
+ */
+void stress_placement_set(const char *name, const int32_t cpu)
+{
+	cpu_set_t mask;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf("%s: cannot pin to CPU %" PRId32 ", errno=%d (%s)\n",
+			name, cpu, errno, strerror(errno));
+		return;
+	}
+	pr_dbg("%s: placed on CPU %" PRId32 "\n", name, cpu);
+}
+
+#else
+
+int32_t stress_placement_cpu(const int32_t index)
+{
+	(void)index;
+
+	if (placement_policy != PLACEMENT_NONE) {
+		pr_inf("placement: setting CPU affinity not supported, "
+			"instances will not be placed\n");
+		placement_policy = PLACEMENT_NONE;
+	}
+	return -1;
+}
+
+void stress_placement_set(const char *name, const int32_t cpu)
+{
+	(void)name;
+	(void)cpu;
+}
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PLUGIN_H
+#define CORE_PLUGIN_H
+
+/*
+ *  Plugin stressor ABI, --plugin-so. This header is self contained
+ *  so plugins can be built without the rest of the stress-ng tree.
+ *
+ *  A plugin exports stress_plugin_register(), stress-ng calls it with
+ *  the ABI version it implements and the plugin returns a table of
+ *  methods, or NULL if it cannot work with that version. Each worker
+ *  instance calls a method's init() once, run_batch() until the run
+ *  ends and then deinit(), all in a child process that is restarted
+ *  if the plugin crashes.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STRESS_PLUGIN_ABI_VERSION	(1)
+
+/* misc stats 0..STRESS_PLUGIN_MISC_STATS_MAX - 1 are for the plugin */
+#define STRESS_PLUGIN_MISC_STATS_MAX	(7)
+
+/*
+ *  Harness services passed to each method, fields are only ever
+ *  appended, check size before using fields added after version 1
+ */
+typedef struct stress_plugin_api {
+	uint32_t abi_version;	/* STRESS_PLUGIN_ABI_VERSION of stress-ng */
+	uint32_t size;		/* sizeof(stress_plugin_api_t) of stress-ng */
+	const char *name;	/* stressor name, e.g. stress-ng-plugin */
+	uint32_t instance;	/* instance number, 0..instances - 1 */
+	uint32_t instances;	/* number of instances */
+	uint64_t max_ops;	/* bogo op limit, 0 = no limit */
+
+	/* false once the run should end, run_batch should return soon */
+	bool (*keep_stressing)(const struct stress_plugin_api *api);
+	/* monotonic time in nanoseconds */
+	uint64_t (*now_ns)(void);
+	/* add a latency sample in ns to the instance latency histogram */
+	void (*latency)(const struct stress_plugin_api *api, const uint64_t ns);
+	/* set misc metric idx, averaged over the instances in the report */
+	void (*misc_stats)(const struct stress_plugin_api *api, const size_t idx,
+		const char *description, const double value);
+	/* informational message prefixed with the stressor name */
+	void (*log)(const struct stress_plugin_api *api, const char *fmt, ...)
+		__attribute__((format(printf, 2, 3)));
+
+	void *priv;		/* private to stress-ng */
+} stress_plugin_api_t;
+
+typedef struct {
+	const char *name;	/* method name for --plugin-method */
+
+	/* optional, set up per instance state in *ctx, returns 0 on success */
+	int (*init)(const stress_plugin_api_t *api, void **ctx);
+	/*
+	 *  perform up to batch bogo ops, returns the number performed
+	 *  (added to the bogo op counter in one go) or < 0 on failure
+	 */
+	int64_t (*run_batch)(const stress_plugin_api_t *api, void *ctx,
+		const uint64_t batch);
+	/* optional, free the per instance state */
+	void (*deinit)(const stress_plugin_api_t *api, void *ctx);
+} stress_plugin_method_t;
+
+typedef struct {
+	uint32_t abi_version;	/* STRESS_PLUGIN_ABI_VERSION of the plugin */
+	uint32_t num_methods;	/* number of methods */
+	const stress_plugin_method_t *methods;
+} stress_plugin_t;
+
+typedef const stress_plugin_t *(*stress_plugin_register_func_t)(const uint32_t abi_version);
+
+#define STRESS_PLUGIN_REGISTER	"stress_plugin_register"
+
+#endif
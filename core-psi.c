@@ -0,0 +1,257 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-cgroup.h"
+#include "core-psi.h"
+
+#define PSI_CPU			(0)
+#define PSI_MEMORY		(1)
+#define PSI_IO			(2)
+#define PSI_MAX			(3)
+
+static const char * const psi_resources[PSI_MAX] = {
+	"cpu",
+	"memory",
+	"io",
+};
+
+/* one "some" or "full" line of a pressure file */
+typedef struct {
+	double avg10;			/* % stalled over the last 10 seconds */
+	uint64_t total;			/* total stall time, microseconds */
+} stress_psi_line_t;
+
+/* the some and full lines of a pressure file */
+typedef struct {
+	stress_psi_line_t some;
+	stress_psi_line_t full;
+	bool valid;			/* file was read */
+} stress_psi_t;
+
+/* PSI of one stressor accumulated over its runs */
+typedef struct {
+	const stress_stressor_t *ss;	/* stressor */
+	stress_psi_t start[PSI_MAX];	/* pressure at the start of a run */
+	stress_psi_t end[PSI_MAX];	/* pressure at the end of a run */
+	uint64_t some_us[PSI_MAX];	/* accumulated some stall time */
+	uint64_t full_us[PSI_MAX];	/* accumulated full stall time */
+	double t_start;			/* start time of a run */
+	double run_time;		/* accumulated run time */
+	bool in_cgroup;			/* pressure was read from a cgroup */
+} stress_psi_stressor_t;
+
+static stress_psi_stressor_t *psi_stressors;	/* per stressor PSI */
+static size_t psi_stressors_n;			/* number of psi_stressors */
+
+/*
+ *  stress_psi_find()
+ *	find or add the PSI state of a stressor
+ */
+static stress_psi_stressor_t *stress_psi_find(const stress_stressor_t *ss)
+{
+	stress_psi_stressor_t *ps;
+	size_t i;
+
+	for (i = 0; i < psi_stressors_n; i++) {
+		if (psi_stressors[i].ss == ss)
+			return &psi_stressors[i];
+	}
+	ps = realloc(psi_stressors, (psi_stressors_n + 1) * sizeof(*psi_stressors));
+	if (!ps)
+		return NULL;
+	psi_stressors = ps;
+	ps = &psi_stressors[psi_stressors_n++];
+	(void)memset(ps, 0, sizeof(*ps));
+	ps->ss = ss;
+	return ps;
+}
+
+/*
+ *  stress_psi_read()
+ *	read a pressure file, the cpu file may not have a
+ *	full line on older kernels
+ */
+static void stress_psi_read(const char *path, stress_psi_t *psi)
+{
+	char buf[256];
+	FILE *fp;
+
+	(void)memset(psi, 0, sizeof(*psi));
+	fp = fopen(path, "r");
+	if (!fp)
+		return;
+	while (fgets(buf, sizeof(buf), fp)) {
+		stress_psi_line_t line;
+		double avg60, avg300;
+		char kind[8];
+
+		if (sscanf(buf, "%7s avg10=%lf avg60=%lf avg300=%lf total=%" SCNu64,
+			   kind, &line.avg10, &avg60, &avg300, &line.total) != 5)
+			continue;
+		if (!strcmp(kind, "some")) {
+			psi->some = line;
+			psi->valid = true;
+		} else if (!strcmp(kind, "full")) {
+			psi->full = line;
+		}
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_psi_read_all()
+ *	read the cpu, memory and io pressure of a stressor, from
+ *	its cgroup if it has one, otherwise system wide
+ */
+static void stress_psi_read_all(const stress_psi_stressor_t *ps, stress_psi_t *psi)
+{
+	const char *cgroup = stress_cgroup_path(ps->ss);
+	char path[PATH_MAX];
+	size_t i;
+
+	for (i = 0; i < PSI_MAX; i++) {
+		if (cgroup)
+			(void)snprintf(path, sizeof(path), "%s/%s.pressure", cgroup, psi_resources[i]);
+		else
+			(void)snprintf(path, sizeof(path), "/proc/pressure/%s", psi_resources[i]);
+		stress_psi_read(path, &psi[i]);
+	}
+}
+
+/*
+ *  stress_psi_start()
+ *	read the pressure at the start of a run of the stressors
+ *	in the list
+ */
+void stress_psi_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!(g_opt_flags & OPT_FLAGS_PSI))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_psi_stressor_t *ps;
+
+		if (!ss->num_instances)
+			continue;
+		ps = stress_psi_find(ss);
+		if (!ps) {
+			pr_err("psi: cannot allocate pressure state\n");
+			return;
+		}
+		ps->in_cgroup = (stress_cgroup_path(ss) != NULL);
+		stress_psi_read_all(ps, ps->start);
+		ps->t_start = stress_time_now();
+	}
+}
+
+/*
+ *  stress_psi_stop()
+ *	read the pressure at the end of a run of the stressors
+ *	in the list and accumulate the stall times
+ */
+void stress_psi_stop(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!(g_opt_flags & OPT_FLAGS_PSI))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_psi_stressor_t *ps;
+		size_t i;
+
+		if (!ss->num_instances)
+			continue;
+		ps = stress_psi_find(ss);
+		if (!ps)
+			continue;
+		stress_psi_read_all(ps, ps->end);
+		ps->run_time += stress_time_now() - ps->t_start;
+		for (i = 0; i < PSI_MAX; i++) {
+			const stress_psi_t *start = &ps->start[i];
+			const stress_psi_t *end = &ps->end[i];
+
+			if (!start->valid || !end->valid)
+				continue;
+			if (end->some.total >= start->some.total)
+				ps->some_us[i] += end->some.total - start->some.total;
+			if (end->full.total >= start->full.total)
+				ps->full_us[i] += end->full.total - start->full.total;
+		}
+	}
+}
+
+/*
+ *  stress_psi_dump()
+ *	report the some and full stall time percentages over the
+ *	run time and the avg10 values at the end of the last run
+ *	of each stressor
+ */
+void stress_psi_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_PSI))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_psi_stressor_t *ps = stress_psi_find(ss);
+		size_t i;
+
+		if (!ps || (ps->run_time <= 0.0) || !ps->end[PSI_CPU].valid)
+			continue;
+		if (!header) {
+			pr_inf("psi: pressure stall information, stall %% of run time:\n");
+			pr_inf("%-13s %-6s %8s %8s %8s %8s\n",
+				"stressor", "res", "some%", "some10", "full%", "full10");
+			pr_yaml(yaml, "psi:\n");
+			header = true;
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      scope: %s\n", ps->in_cgroup ? "cgroup" : "system");
+		pr_yaml(yaml, "      run-time: %f\n", ps->run_time);
+		for (i = 0; i < PSI_MAX; i++) {
+			const double scale = 100.0 / (ps->run_time * 1000000.0);
+
+			if (!ps->end[i].valid)
+				continue;
+			pr_inf("%-13s %-6s %8.2f %8.2f %8.2f %8.2f\n",
+				munged, psi_resources[i],
+				(double)ps->some_us[i] * scale, ps->end[i].some.avg10,
+				(double)ps->full_us[i] * scale, ps->end[i].full.avg10);
+			pr_yaml(yaml, "      %s-some-stall-us: %" PRIu64 "\n", psi_resources[i], ps->some_us[i]);
+			pr_yaml(yaml, "      %s-some-percent: %f\n", psi_resources[i], (double)ps->some_us[i] * scale);
+			pr_yaml(yaml, "      %s-some-avg10: %f\n", psi_resources[i], ps->end[i].some.avg10);
+			pr_yaml(yaml, "      %s-full-stall-us: %" PRIu64 "\n", psi_resources[i], ps->full_us[i]);
+			pr_yaml(yaml, "      %s-full-percent: %f\n", psi_resources[i], (double)ps->full_us[i] * scale);
+			pr_yaml(yaml, "      %s-full-avg10: %f\n", psi_resources[i], ps->end[i].full.avg10);
+		}
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	else
+		pr_inf("psi: no pressure stall information, /proc/pressure is not available\n");
+	free(psi_stressors);
+	psi_stressors = NULL;
+	psi_stressors_n = 0;
+}
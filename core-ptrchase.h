@@ -0,0 +1,94 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PTRCHASE_H
+#define CORE_PTRCHASE_H
+
+/* Dependent load pointer chains, one pointer per cache line */
+
+/*
+ *  stress_ptrchase_build()
+ *	link the cache lines of the first bytes of buf into one
+ *	randomly ordered cycle using Sattolo's algorithm, idx
+ *	must have room for bytes / line_size entries
+ */
+static inline void stress_ptrchase_build(
+	uint8_t *buf,
+	uint32_t *idx,
+	const uint64_t bytes,
+	const size_t line_size)
+{
+	const uint32_t n = (uint32_t)(bytes / line_size);
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		idx[i] = i;
+	for (i = n - 1; i > 0; i--) {
+		const uint32_t j = stress_mwc32() % i;
+		const uint32_t tmp = idx[i];
+
+		idx[i] = idx[j];
+		idx[j] = tmp;
+	}
+	for (i = 0; i < n; i++)
+		*(void **)(buf + ((size_t)i * line_size)) = (void *)(buf + ((size_t)idx[i] * line_size));
+}
+
+/*
+ *  stress_ptrchase_chase()
+ *	follow the chain for n dependent loads, n is a multiple of 8,
+ *	returns where the chase stopped
+ */
+static inline void * OPTIMIZE3 stress_ptrchase_chase(void *ptr, uint64_t n)
+{
+	register void **p = (void **)ptr;
+
+	while (n) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		n -= 8;
+	}
+	return (void *)p;
+}
+
+/*
+ *  stress_ptrchase_chase_chains()
+ *	follow k independent chains in lock-step for n steps so up
+ *	to k loads can be outstanding at once, ptrs is updated to
+ *	where each chain stopped
+ */
+static inline void OPTIMIZE3 stress_ptrchase_chase_chains(
+	void **ptrs,
+	const size_t k,
+	uint64_t n)
+{
+	while (n--) {
+		register size_t i;
+
+		for (i = 0; i < k; i++)
+			ptrs[i] = *(void **)ptrs[i];
+	}
+}
+
+#endif
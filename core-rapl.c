@@ -0,0 +1,356 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-rapl.h"
+
+#define RAPL_PATH		"/sys/class/powercap"
+
+#define RAPL_PACKAGE		(0)
+#define RAPL_CORE		(1)
+#define RAPL_UNCORE		(2)
+#define RAPL_DRAM		(3)
+#define RAPL_PSYS		(4)
+#define RAPL_TYPE_MAX		(5)
+
+static const char * const rapl_types[RAPL_TYPE_MAX] = {
+	"package",
+	"core",
+	"uncore",
+	"dram",
+	"psys",
+};
+
+/* a readable powercap RAPL domain */
+typedef struct {
+	char path[PATH_MAX];		/* energy_uj file */
+	uint64_t max_uj;		/* counter wraps at this value */
+	int type;			/* RAPL_PACKAGE .. RAPL_PSYS */
+} stress_rapl_domain_t;
+
+/* energy used while a stressor ran, accumulated over its runs */
+typedef struct {
+	const stress_stressor_t *ss;	/* stressor */
+	stress_rapl_sample_t start;	/* energy at the start of a run */
+	double joules[RAPL_TYPE_MAX];	/* accumulated energy */
+	double run_time;		/* accumulated run time */
+} stress_rapl_stressor_t;
+
+static stress_rapl_domain_t *rapl_domains;	/* readable domains */
+static size_t rapl_domains_n;			/* number of rapl_domains */
+static bool rapl_domains_init;			/* domains have been scanned */
+static stress_rapl_stressor_t *rapl_stressors;	/* per stressor energy */
+static size_t rapl_stressors_n;			/* number of rapl_stressors */
+
+/*
+ *  stress_rapl_read_uint64()
+ *	read a decimal counter from a sysfs file, false if
+ *	it cannot be read
+ */
+static bool stress_rapl_read_uint64(const char *path, uint64_t *val)
+{
+	char buf[64];
+
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+	*val = (uint64_t)strtoull(buf, NULL, 10);
+	return true;
+}
+
+/*
+ *  stress_rapl_type()
+ *	map a powercap domain name to a RAPL domain type,
+ *	-1 if it is not a known type
+ */
+static int stress_rapl_type(const char *name)
+{
+	int i;
+
+	for (i = 0; i < RAPL_TYPE_MAX; i++) {
+		if (!strncmp(name, rapl_types[i], strlen(rapl_types[i])))
+			return i;
+	}
+	return -1;
+}
+
+/*
+ *  stress_rapl_domains()
+ *	find the readable RAPL energy counters, the package
+ *	domains are intel-rapl:N and their sub-domains are
+ *	intel-rapl:N:M, AMD CPUs use the same interface
+ */
+static void stress_rapl_domains(void)
+{
+	struct dirent **namelist = NULL;
+	int i, n;
+
+	if (rapl_domains_init)
+		return;
+	rapl_domains_init = true;
+
+	n = scandir(RAPL_PATH, &namelist, NULL, alphasort);
+	for (i = 0; i < n; i++) {
+		const char *d_name = namelist[i]->d_name;
+		stress_rapl_domain_t *domain;
+		char path[PATH_MAX], name[64];
+		uint64_t uj;
+		int type;
+
+		if (strncmp(d_name, "intel-rapl:", 11) ||
+		    (rapl_domains_n >= STRESS_RAPL_DOMAINS_MAX))
+			continue;
+		(void)snprintf(path, sizeof(path), "%s/%s/name", RAPL_PATH, d_name);
+		if (system_read(path, name, sizeof(name)) <= 0)
+			continue;
+		type = stress_rapl_type(name);
+		if (type < 0)
+			continue;
+
+		domain = realloc(rapl_domains, (rapl_domains_n + 1) * sizeof(*rapl_domains));
+		if (!domain)
+			break;
+		rapl_domains = domain;
+		domain = &rapl_domains[rapl_domains_n];
+		(void)snprintf(domain->path, sizeof(domain->path), "%s/%s/energy_uj", RAPL_PATH, d_name);
+		/* energy_uj is root only readable on many kernels */
+		if (!stress_rapl_read_uint64(domain->path, &uj))
+			continue;
+		(void)snprintf(path, sizeof(path), "%s/%s/max_energy_range_uj", RAPL_PATH, d_name);
+		if (!stress_rapl_read_uint64(path, &domain->max_uj))
+			domain->max_uj = 0;
+		domain->type = type;
+		rapl_domains_n++;
+	}
+	stress_dirent_list_free(namelist, n);
+}
+
+/*
+ *  stress_rapl_read()
+ *	read the energy counters of all the RAPL domains
+ */
+void stress_rapl_read(stress_rapl_sample_t *sample)
+{
+	size_t i;
+
+	stress_rapl_domains();
+	(void)memset(sample, 0, sizeof(*sample));
+	for (i = 0; i < rapl_domains_n; i++)
+		(void)stress_rapl_read_uint64(rapl_domains[i].path, &sample->uj[i]);
+	sample->time = stress_time_now();
+}
+
+/*
+ *  stress_rapl_joules()
+ *	energy in joules of each RAPL domain type between two
+ *	readings, allowing for the counters wrapping around
+ */
+static void stress_rapl_joules(
+	const stress_rapl_sample_t *start,
+	const stress_rapl_sample_t *end,
+	double joules[RAPL_TYPE_MAX])
+{
+	size_t i;
+
+	(void)memset(joules, 0, sizeof(*joules) * RAPL_TYPE_MAX);
+	for (i = 0; i < rapl_domains_n; i++) {
+		const uint64_t s = start->uj[i];
+		const uint64_t e = end->uj[i];
+		uint64_t uj;
+
+		if (e >= s)
+			uj = e - s;
+		else if (rapl_domains[i].max_uj > s)
+			uj = e + (rapl_domains[i].max_uj - s);
+		else
+			continue;
+		joules[rapl_domains[i].type] += (double)uj / 1000000.0;
+	}
+}
+
+/*
+ *  stress_rapl_total()
+ *	the whole system energy, the sum of the packages or
+ *	the platform (psys) domain if there are no packages
+ */
+static double stress_rapl_total(const double joules[RAPL_TYPE_MAX])
+{
+	return (joules[RAPL_PACKAGE] > 0.0) ? joules[RAPL_PACKAGE] : joules[RAPL_PSYS];
+}
+
+/*
+ *  stress_rapl_watts()
+ *	average power in watts between two readings, 0.0 if
+ *	there are no readable RAPL domains
+ */
+double stress_rapl_watts(
+	const stress_rapl_sample_t *start,
+	const stress_rapl_sample_t *end)
+{
+	const double dt = end->time - start->time;
+	double joules[RAPL_TYPE_MAX];
+
+	if (dt <= 0.0)
+		return 0.0;
+	stress_rapl_joules(start, end, joules);
+	return stress_rapl_total(joules) / dt;
+}
+
+/*
+ *  stress_rapl_find()
+ *	find or add the energy state of a stressor
+ */
+static stress_rapl_stressor_t *stress_rapl_find(const stress_stressor_t *ss)
+{
+	stress_rapl_stressor_t *rs;
+	size_t i;
+
+	for (i = 0; i < rapl_stressors_n; i++) {
+		if (rapl_stressors[i].ss == ss)
+			return &rapl_stressors[i];
+	}
+	rs = realloc(rapl_stressors, (rapl_stressors_n + 1) * sizeof(*rapl_stressors));
+	if (!rs)
+		return NULL;
+	rapl_stressors = rs;
+	rs = &rapl_stressors[rapl_stressors_n++];
+	(void)memset(rs, 0, sizeof(*rs));
+	rs->ss = ss;
+	return rs;
+}
+
+/*
+ *  stress_rapl_start()
+ *	read the energy counters at the start of a run of the
+ *	stressors in the list
+ */
+void stress_rapl_start(stress_stressor_t *stressors_list)
+{
+	stress_rapl_sample_t sample;
+	stress_stressor_t *ss;
+
+	if (!(g_opt_flags & OPT_FLAGS_RAPL))
+		return;
+
+	stress_rapl_read(&sample);
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_rapl_stressor_t *rs;
+
+		if (!ss->num_instances)
+			continue;
+		rs = stress_rapl_find(ss);
+		if (!rs) {
+			pr_err("rapl: cannot allocate energy state\n");
+			return;
+		}
+		rs->start = sample;
+	}
+}
+
+/*
+ *  stress_rapl_stop()
+ *	read the energy counters at the end of a run of the
+ *	stressors in the list and accumulate the energy used
+ */
+void stress_rapl_stop(stress_stressor_t *stressors_list)
+{
+	stress_rapl_sample_t sample;
+	stress_stressor_t *ss;
+
+	if (!(g_opt_flags & OPT_FLAGS_RAPL))
+		return;
+
+	stress_rapl_read(&sample);
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_rapl_stressor_t *rs;
+		double joules[RAPL_TYPE_MAX];
+		size_t i;
+
+		if (!ss->num_instances)
+			continue;
+		rs = stress_rapl_find(ss);
+		if (!rs)
+			continue;
+		stress_rapl_joules(&rs->start, &sample, joules);
+		for (i = 0; i < RAPL_TYPE_MAX; i++)
+			rs->joules[i] += joules[i];
+		rs->run_time += sample.time - rs->start.time;
+	}
+}
+
+/*
+ *  stress_rapl_dump()
+ *	report the energy, average power and bogo-ops per joule
+ *	of each stressor, the energy is system wide so stressors
+ *	that run at the same time share the same energy
+ */
+void stress_rapl_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_RAPL))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_rapl_stressor_t *rs = stress_rapl_find(ss);
+		uint64_t c_total = 0;
+		double total;
+		int32_t j;
+		size_t i;
+
+		if (!rs || !ss->stats || (rs->run_time <= 0.0) || !rapl_domains_n)
+			continue;
+		for (j = 0; j < ss->started_instances; j++)
+			c_total += ss->stats[j]->ci.counter;
+		total = stress_rapl_total(rs->joules);
+
+		if (!header) {
+			pr_inf("rapl: energy used while each stressor ran (system wide):\n");
+			pr_inf("%-13s %-8s %12s %10s %14s\n",
+				"stressor", "domain", "joules", "watts", "bogo-ops per J");
+			pr_yaml(yaml, "rapl:\n");
+			header = true;
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      run-time: %f\n", rs->run_time);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", c_total);
+		for (i = 0; i < RAPL_TYPE_MAX; i++) {
+			const double joules = rs->joules[i];
+			const double watts = joules / rs->run_time;
+			const double ops_per_joule = (joules > 0.0) ? (double)c_total / joules : 0.0;
+
+			if (joules <= 0.0)
+				continue;
+			pr_inf("%-13s %-8s %12.2f %10.2f %14.2f\n",
+				munged, rapl_types[i], joules, watts, ops_per_joule);
+			pr_yaml(yaml, "      %s-joules: %f\n", rapl_types[i], joules);
+			pr_yaml(yaml, "      %s-watts: %f\n", rapl_types[i], watts);
+		}
+		pr_yaml(yaml, "      bogo-ops-per-joule: %f\n",
+			(total > 0.0) ? (double)c_total / total : 0.0);
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	else
+		pr_inf("rapl: no energy information, %s RAPL energy counters "
+			"are not available or not readable\n", RAPL_PATH);
+	free(rapl_stressors);
+	rapl_stressors = NULL;
+	rapl_stressors_n = 0;
+}
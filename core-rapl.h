@@ -0,0 +1,38 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_RAPL_H
+#define CORE_RAPL_H
+
+#define STRESS_RAPL_DOMAINS_MAX	(32)
+
+/* energy counters of all the RAPL domains at one point in time */
+typedef struct {
+	uint64_t uj[STRESS_RAPL_DOMAINS_MAX];	/* energy in microjoules */
+	double time;				/* time of the reading */
+} stress_rapl_sample_t;
+
+/* RAPL energy and performance per watt, --rapl */
+extern void stress_rapl_read(stress_rapl_sample_t *sample);
+extern double stress_rapl_watts(const stress_rapl_sample_t *start,
+	const stress_rapl_sample_t *end);
+extern void stress_rapl_start(stress_stressor_t *stressors_list);
+extern void stress_rapl_stop(stress_stressor_t *stressors_list);
+extern void stress_rapl_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
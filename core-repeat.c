@@ -0,0 +1,318 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-repeat.h"
+
+#define MAX_REPEAT		(1000)
+#define MAX_REPEAT_WARMUP	(100)
+#define DEFAULT_REPEAT_CV	(2.0)	/* CV warning threshold, % */
+#define REPEAT_OUTLIER_Z	(3.5)	/* modified z-score outlier threshold */
+
+/* summary statistics of the measured runs of one stressor */
+typedef struct {
+	uint32_t n;			/* runs */
+	double	mean;			/* mean bogo-ops/sec */
+	double	median;			/* median bogo-ops/sec */
+	double	stddev;			/* sample standard deviation */
+	double	cv;			/* coefficient of variation, % */
+	double	ci95;			/* 95% confidence interval half width */
+	uint32_t outliers;		/* runs flagged as outliers */
+} stress_repeat_stats_t;
+
+static uint32_t repeat = 0;		/* measured runs, 0 = off */
+static uint32_t repeat_warmup = 0;	/* discarded warm-up runs */
+static double repeat_cv = DEFAULT_REPEAT_CV;
+static double *repeat_rates;		/* [stressor][run] bogo-ops/sec */
+static size_t repeat_stressors;		/* stressors in repeat_rates */
+
+/*
+ *  Two sided 95% Student's t critical values for 1..30 degrees
+ *  of freedom, the normal 1.96 is used for more than 30
+ */
+static const double t_95[] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+/*
+ *  stress_repeat_t95()
+ *	two sided 95% Student's t critical value for df degrees of freedom
+ */
+double stress_repeat_t95(const uint32_t df)
+{
+	if (df < 1)
+		return 0.0;
+	return (df <= SIZEOF_ARRAY(t_95)) ? t_95[df - 1] : 1.96;
+}
+
+/*
+ *  stress_set_repeat()
+ *	set the number of measured --repeat runs
+ */
+int stress_set_repeat(const char *const opt)
+{
+	repeat = stress_get_uint32(opt);
+	stress_check_range("repeat", (uint64_t)repeat, 1, MAX_REPEAT);
+	return 0;
+}
+
+/*
+ *  stress_set_repeat_warmup()
+ *	set the number of discarded warm-up runs
+ */
+int stress_set_repeat_warmup(const char *const opt)
+{
+	repeat_warmup = stress_get_uint32(opt);
+	stress_check_range("repeat-warmup", (uint64_t)repeat_warmup, 0, MAX_REPEAT_WARMUP);
+	return 0;
+}
+
+/*
+ *  stress_set_repeat_cv()
+ *	set the coefficient of variation warning threshold in percent
+ */
+int stress_set_repeat_cv(const char *const opt)
+{
+	if ((sscanf(opt, "%lf", &repeat_cv) != 1) || (repeat_cv <= 0.0) || (repeat_cv > 100.0)) {
+		(void)fprintf(stderr, "repeat-cv must be a percentage in the range 0 to 100.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_repeat_runs()
+ *	total number of runs, including warm-up runs
+ */
+uint32_t stress_repeat_runs(void)
+{
+	return repeat ? repeat + repeat_warmup : 1;
+}
+
+/*
+ *  stress_repeat_sample()
+ *	record the real time bogo-ops rate of each stressor for
+ *	a completed run, warm-up runs are not recorded
+ */
+void stress_repeat_sample(stress_stressor_t *stressors_list, const uint32_t run)
+{
+	stress_stressor_t *ss;
+	size_t n;
+
+	if (!repeat || (run < repeat_warmup))
+		return;
+
+	if (!repeat_rates) {
+		for (ss = stressors_list; ss; ss = ss->next)
+			repeat_stressors++;
+		repeat_rates = calloc(repeat_stressors * repeat, sizeof(*repeat_rates));
+		if (!repeat_rates) {
+			pr_err("repeat: cannot allocate run samples\n");
+			repeat = 0;
+			return;
+		}
+	}
+
+	for (n = 0, ss = stressors_list; ss && (n < repeat_stressors); ss = ss->next, n++) {
+		uint64_t c_total = 0;
+		double r_total = 0.0;
+		int32_t j;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			c_total += stats->ci.counter;
+			r_total += stats->finish - stats->start;
+		}
+		/* same as the real time bogo-ops/s in the metrics */
+		r_total = ss->started_instances ? r_total / (double)ss->started_instances : 0.0;
+		repeat_rates[(n * repeat) + (run - repeat_warmup)] =
+			(r_total > 0.0) ? (double)c_total / r_total : 0.0;
+	}
+}
+
+/*
+ *  stress_repeat_cmp()
+ *	qsort comparison of doubles
+ */
+static int stress_repeat_cmp(const void *p1, const void *p2)
+{
+	const double d1 = *(const double *)p1;
+	const double d2 = *(const double *)p2;
+
+	if (d1 < d2)
+		return -1;
+	if (d1 > d2)
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_repeat_median()
+ *	median of n sorted values
+ */
+static double stress_repeat_median(const double *sorted, const uint32_t n)
+{
+	return (n & 1) ? sorted[n / 2] : (sorted[(n / 2) - 1] + sorted[n / 2]) / 2.0;
+}
+
+/*
+ *  stress_repeat_stats()
+ *	compute the summary of n run rates; outliers are runs
+ *	with a modified z-score, based on the median absolute
+ *	deviation, above REPEAT_OUTLIER_Z
+ */
+static void stress_repeat_stats(
+	const double *rates,
+	const uint32_t n,
+	double *sorted,
+	stress_repeat_stats_t *st)
+{
+	double sum = 0.0, sum_sq = 0.0, mad;
+	uint32_t i;
+
+	(void)memset(st, 0, sizeof(*st));
+	st->n = n;
+	if (!n)
+		return;
+
+	for (i = 0; i < n; i++)
+		sum += rates[i];
+	st->mean = sum / (double)n;
+	for (i = 0; i < n; i++)
+		sum_sq += (rates[i] - st->mean) * (rates[i] - st->mean);
+	st->stddev = (n > 1) ? sqrt(sum_sq / (double)(n - 1)) : 0.0;
+	st->cv = (st->mean > 0.0) ? 100.0 * st->stddev / st->mean : 0.0;
+	if (n > 1)
+		st->ci95 = stress_repeat_t95(n - 1) * st->stddev / sqrt((double)n);
+
+	(void)memcpy(sorted, rates, n * sizeof(*sorted));
+	qsort(sorted, n, sizeof(*sorted), stress_repeat_cmp);
+	st->median = stress_repeat_median(sorted, n);
+
+	/* absolute deviations from the median, sorted for the MAD */
+	for (i = 0; i < n; i++)
+		sorted[i] = fabs(rates[i] - st->median);
+	qsort(sorted, n, sizeof(*sorted), stress_repeat_cmp);
+	mad = stress_repeat_median(sorted, n);
+	if (mad > 0.0) {
+		for (i = 0; i < n; i++) {
+			if (0.6745 * fabs(rates[i] - st->median) / mad > REPEAT_OUTLIER_Z)
+				st->outliers++;
+		}
+	}
+}
+
+/*
+ *  stress_repeat_summary()
+ *	get the mean and standard deviation of the measured runs
+ *	of the nth stressor, returns false if there are no runs
+ */
+bool stress_repeat_summary(
+	const size_t n,
+	double *mean,
+	double *stddev,
+	uint32_t *runs)
+{
+	stress_repeat_stats_t st;
+	double *sorted;
+
+	if (!repeat || !repeat_rates || (n >= repeat_stressors))
+		return false;
+	sorted = calloc(repeat, sizeof(*sorted));
+	if (!sorted)
+		return false;
+	stress_repeat_stats(&repeat_rates[n * repeat], repeat, sorted, &st);
+	free(sorted);
+
+	*mean = st.mean;
+	*stddev = st.stddev;
+	*runs = st.n;
+	return true;
+}
+
+/*
+ *  stress_repeat_dump()
+ *	report the per stressor statistics over the measured runs,
+ *	warn if the run to run variation exceeds the CV threshold
+ */
+void stress_repeat_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	double *sorted;
+	size_t n;
+
+	if (!repeat || !repeat_rates)
+		return;
+
+	sorted = calloc(repeat, sizeof(*sorted));
+	if (!sorted) {
+		pr_err("repeat: cannot allocate buffer for statistics\n");
+		goto free_rates;
+	}
+
+	pr_inf("repeat: %" PRIu32 " runs, %" PRIu32 " warm-up runs discarded, "
+		"real time bogo-ops/s:\n", repeat, repeat_warmup);
+	pr_inf("%-13s %12s %12s %10s %7s %21s %5s\n",
+		"stressor", "mean", "median", "stddev", "CV%", "95% CI", "outl");
+	pr_yaml(yaml, "repeat:\n");
+	pr_yaml(yaml, "    runs: %" PRIu32 "\n", repeat);
+	pr_yaml(yaml, "    warmup-runs: %" PRIu32 "\n", repeat_warmup);
+	pr_yaml(yaml, "    stressors:\n");
+
+	for (n = 0, ss = stressors_list; ss && (n < repeat_stressors); ss = ss->next, n++) {
+		const double *rates = &repeat_rates[n * repeat];
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		stress_repeat_stats_t st;
+		char ci[32];
+		uint32_t i;
+
+		if (!ss->stats)
+			continue;
+		stress_repeat_stats(rates, repeat, sorted, &st);
+		(void)snprintf(ci, sizeof(ci), "%.2f..%.2f",
+			st.mean - st.ci95, st.mean + st.ci95);
+		pr_inf("%-13s %12.2f %12.2f %10.2f %7.2f %21s %5" PRIu32 "\n",
+			munged, st.mean, st.median, st.stddev, st.cv, ci, st.outliers);
+		if ((repeat > 1) && (st.cv > repeat_cv))
+			pr_warn("repeat: %s coefficient of variation %.2f%% exceeds %.2f%%, "
+				"run to run noise may hide changes of this size\n",
+				munged, st.cv, repeat_cv);
+
+		pr_yaml(yaml, "      - stressor: %s\n", munged);
+		pr_yaml(yaml, "        mean: %f\n", st.mean);
+		pr_yaml(yaml, "        median: %f\n", st.median);
+		pr_yaml(yaml, "        stddev: %f\n", st.stddev);
+		pr_yaml(yaml, "        cv-percent: %f\n", st.cv);
+		pr_yaml(yaml, "        ci95-low: %f\n", st.mean - st.ci95);
+		pr_yaml(yaml, "        ci95-high: %f\n", st.mean + st.ci95);
+		pr_yaml(yaml, "        outliers: %" PRIu32 "\n", st.outliers);
+		pr_yaml(yaml, "        bogo-ops-per-second-real-time:\n");
+		for (i = 0; i < repeat; i++)
+			pr_yaml(yaml, "          - %f\n", rates[i]);
+	}
+	pr_yaml(yaml, "\n");
+	free(sorted);
+free_rates:
+	free(repeat_rates);
+	repeat_rates = NULL;
+}
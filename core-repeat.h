@@ -0,0 +1,33 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_REPEAT_H
+#define CORE_REPEAT_H
+
+/* Repeated runs with statistical summary, --repeat */
+extern int stress_set_repeat(const char *const opt);
+extern int stress_set_repeat_cv(const char *const opt);
+extern int stress_set_repeat_warmup(const char *const opt);
+extern uint32_t stress_repeat_runs(void);
+extern void stress_repeat_sample(stress_stressor_t *stressors_list, const uint32_t run);
+extern bool stress_repeat_summary(const size_t n, double *mean,
+	double *stddev, uint32_t *runs);
+extern double stress_repeat_t95(const uint32_t df);
+extern void stress_repeat_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
@@ -0,0 +1,558 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-resctrl.h"
+
+#define RESCTRL_GROUPS_MAX	(64)
+#define RESCTRL_DEFAULT_INTERVAL (1)	/* seconds between samples */
+
+#define RESCTRL_MBM_TOTAL	(0)	/* mbm_total_bytes */
+#define RESCTRL_MBM_LOCAL	(1)	/* mbm_local_bytes */
+#define RESCTRL_LLC_OCCUPANCY	(2)	/* llc_occupancy */
+#define RESCTRL_EVENTS		(3)
+
+static const char * const resctrl_event_files[RESCTRL_EVENTS] = {
+	"mbm_total_bytes",
+	"mbm_local_bytes",
+	"llc_occupancy",
+};
+
+/* monitoring data of a group, accumulated by the sampler process */
+typedef struct {
+	char name[64];			/* stressor name */
+	char path[PATH_MAX / 2];	/* resctrl group directory, "" when not created */
+	uint64_t last[RESCTRL_EVENTS];	/* previous counter readings */
+	double last_time;		/* time of the previous reading */
+	bool last_valid[RESCTRL_EVENTS]; /* previous reading is valid */
+	double sum[RESCTRL_EVENTS];	/* sum of per sample values */
+	double peak[RESCTRL_EVENTS];	/* peak per sample value */
+	uint64_t samples[RESCTRL_EVENTS]; /* number of per sample values */
+} stress_resctrl_group_t;
+
+static bool resctrl_enabled;
+static uint32_t resctrl_interval = RESCTRL_DEFAULT_INTERVAL;
+static uint32_t resctrl_l3_ways;	/* L3 CAT ways, 0 = no allocation */
+static uint32_t resctrl_mb;		/* MBA bandwidth %, 0 = no allocation */
+static char *resctrl_mnt;		/* resctrl mount point */
+static stress_resctrl_group_t *resctrl_groups;	/* shared with the sampler */
+static size_t resctrl_groups_n;
+static pid_t resctrl_pid;		/* sampler process */
+
+int stress_set_resctrl(const char *const opt)
+{
+	(void)opt;
+
+	resctrl_enabled = true;
+	return 0;
+}
+
+int stress_set_resctrl_interval(const char *const opt)
+{
+	resctrl_interval = stress_get_uint32(opt);
+	stress_check_range("resctrl-interval", (uint64_t)resctrl_interval, 1, 3600);
+	return 0;
+}
+
+/*
+ *  stress_set_resctrl_l3_ways()
+ *	set the number of L3 cache ways (CAT) of each group,
+ *	an allocation implies --resctrl
+ */
+int stress_set_resctrl_l3_ways(const char *const opt)
+{
+	resctrl_l3_ways = stress_get_uint32(opt);
+	stress_check_range("resctrl-l3-ways", (uint64_t)resctrl_l3_ways, 1, 64);
+	resctrl_enabled = true;
+	return 0;
+}
+
+/*
+ *  stress_set_resctrl_mb()
+ *	set the memory bandwidth percentage (MBA) of each group,
+ *	an allocation implies --resctrl
+ */
+int stress_set_resctrl_mb(const char *const opt)
+{
+	resctrl_mb = stress_get_uint32(opt);
+	stress_check_range("resctrl-mb", (uint64_t)resctrl_mb, 1, 100);
+	resctrl_enabled = true;
+	return 0;
+}
+
+/*
+ *  stress_resctrl_write()
+ *	write a string to a resctrl file
+ */
+static int stress_resctrl_write(const char *dir, const char *file, const char *value)
+{
+	char path[PATH_MAX];
+	ssize_t ret;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "%s/%s", dir, file);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -1;
+	ret = write(fd, value, strlen(value));
+	(void)close(fd);
+	return (ret < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_resctrl_read()
+ *	read a resctrl file into buf, returns -1 on failure
+ */
+static ssize_t stress_resctrl_read(const char *dir, const char *file, char *buf, const size_t buf_len)
+{
+	char path[PATH_MAX];
+	ssize_t len;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "%s/%s", dir, file);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	len = read(fd, buf, buf_len - 1);
+	(void)close(fd);
+	if (len < 0)
+		return -1;
+	buf[len] = '\0';
+	return len;
+}
+
+/*
+ *  stress_resctrl_mount()
+ *	find the resctrl mount point
+ */
+static int stress_resctrl_mount(void)
+{
+	char buf[1024], dev[256], mnt[256], type[64];
+	FILE *fp;
+
+	if (resctrl_mnt)
+		return 0;
+	fp = fopen("/proc/mounts", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if ((sscanf(buf, "%255s %255s %63s", dev, mnt, type) == 3) &&
+		    !strcmp(type, "resctrl")) {
+			resctrl_mnt = strdup(mnt);
+			break;
+		}
+	}
+	(void)fclose(fp);
+	return resctrl_mnt ? 0 : -1;
+}
+
+/*
+ *  stress_resctrl_schemata()
+ *	make the schemata line of a resource from the domains of the
+ *	same resource in the default group, with every domain set to value
+ */
+static int stress_resctrl_schemata(
+	const char *resource,
+	const char *value,
+	char *line,
+	const size_t line_len)
+{
+	char buf[4096], prefix[16];
+	char *tok, *saveptr = NULL;
+
+	if (stress_resctrl_read(resctrl_mnt, "schemata", buf, sizeof(buf)) < 0)
+		return -1;
+	(void)snprintf(prefix, sizeof(prefix), "%s:", resource);
+	for (tok = strtok_r(buf, "\n", &saveptr); tok; tok = strtok_r(NULL, "\n", &saveptr)) {
+		char *dom, *dsave = NULL;
+
+		while (*tok == ' ')
+			tok++;
+		if (strncmp(tok, prefix, strlen(prefix)))
+			continue;
+		(void)shim_strlcpy(line, prefix, line_len);
+		for (dom = strtok_r(tok + strlen(prefix), ";", &dsave); dom;
+		     dom = strtok_r(NULL, ";", &dsave)) {
+			char *eq = strchr(dom, '=');
+			char entry[64];
+
+			if (!eq)
+				continue;
+			*eq = '\0';
+			(void)snprintf(entry, sizeof(entry), "%s%s=%s",
+				(line[strlen(line) - 1] == ':') ? "" : ";", dom, value);
+			(void)shim_strlcat(line, entry, line_len);
+		}
+		(void)shim_strlcat(line, "\n", line_len);
+		return 0;
+	}
+	return -1;
+}
+
+/*
+ *  stress_resctrl_allocate()
+ *	apply the L3 CAT and MBA allocations to a control group
+ */
+static void stress_resctrl_allocate(const stress_resctrl_group_t *group)
+{
+	char line[1024], value[32], buf[64];
+
+	if (resctrl_l3_ways) {
+		uint64_t cbm_max = 0;
+		uint32_t ways;
+
+		if (stress_resctrl_read(resctrl_mnt, "info/L3/cbm_mask", buf, sizeof(buf)) > 0)
+			cbm_max = (uint64_t)strtoull(buf, NULL, 16);
+		for (ways = 0; cbm_max; cbm_max >>= 1)
+			ways += (uint32_t)(cbm_max & 1);
+		if (resctrl_l3_ways > ways) {
+			pr_inf("resctrl: cannot allocate %" PRIu32 " L3 ways to %s, "
+				"only %" PRIu32 " ways available\n", resctrl_l3_ways,
+				group->name, ways);
+		} else {
+			(void)snprintf(value, sizeof(value), "%" PRIx64,
+				(uint64_t)((resctrl_l3_ways == 64) ? ~0ULL : (1ULL << resctrl_l3_ways) - 1));
+			if ((stress_resctrl_schemata("L3", value, line, sizeof(line)) < 0) ||
+			    (stress_resctrl_write(group->path, "schemata", line) < 0))
+				pr_inf("resctrl: cannot set L3 cache allocation of %s, "
+					"errno=%d (%s)\n", group->name, errno, strerror(errno));
+		}
+	}
+	if (resctrl_mb) {
+		(void)snprintf(value, sizeof(value), "%" PRIu32, resctrl_mb);
+		if ((stress_resctrl_schemata("MB", value, line, sizeof(line)) < 0) ||
+		    (stress_resctrl_write(group->path, "schemata", line) < 0))
+			pr_inf("resctrl: cannot set memory bandwidth allocation of %s, "
+				"errno=%d (%s)\n", group->name, errno, strerror(errno));
+	}
+}
+
+/*
+ *  stress_resctrl_find()
+ *	find the group of a stressor
+ */
+static stress_resctrl_group_t *stress_resctrl_find(const stress_stressor_t *ss)
+{
+	const char *name = stress_munge_underscore(ss->stressor->name);
+	size_t i;
+
+	for (i = 0; i < resctrl_groups_n; i++) {
+		if (!strcmp(resctrl_groups[i].name, name))
+			return &resctrl_groups[i];
+	}
+	return NULL;
+}
+
+/*
+ *  stress_resctrl_read_events()
+ *	read the monitoring events of a group summed over all L3
+ *	domains, events that are unavailable are flagged as invalid
+ */
+static void stress_resctrl_read_events(
+	const stress_resctrl_group_t *group,
+	uint64_t *values,
+	bool *valid)
+{
+	char path[PATH_MAX];
+	struct dirent *d;
+	DIR *dir;
+	size_t i;
+
+	for (i = 0; i < RESCTRL_EVENTS; i++) {
+		values[i] = 0;
+		valid[i] = false;
+	}
+	(void)snprintf(path, sizeof(path), "%s/mon_data", group->path);
+	dir = opendir(path);
+	if (!dir)
+		return;
+	while ((d = readdir(dir)) != NULL) {
+		char domain[PATH_MAX + 256], buf[64];
+
+		if (strncmp(d->d_name, "mon_L3_", 7))
+			continue;
+		(void)snprintf(domain, sizeof(domain), "%s/%s", path, d->d_name);
+		for (i = 0; i < RESCTRL_EVENTS; i++) {
+			/* "Unavailable" or "Error" when the event cannot be read */
+			if ((stress_resctrl_read(domain, resctrl_event_files[i], buf, sizeof(buf)) <= 0) ||
+			    !isdigit((int)buf[0]))
+				continue;
+			values[i] += (uint64_t)strtoull(buf, NULL, 10);
+			valid[i] = true;
+		}
+	}
+	(void)closedir(dir);
+}
+
+/*
+ *  stress_resctrl_sample()
+ *	take a sample of each group, bandwidths are the change in
+ *	the byte counters since the previous sample
+ */
+static void stress_resctrl_sample(void)
+{
+	size_t i, j;
+
+	for (i = 0; i < resctrl_groups_n; i++) {
+		stress_resctrl_group_t *group = &resctrl_groups[i];
+		uint64_t values[RESCTRL_EVENTS];
+		bool valid[RESCTRL_EVENTS];
+		double sample[RESCTRL_EVENTS], now, dt;
+
+		if (!*group->path)
+			continue;
+		stress_resctrl_read_events(group, values, valid);
+		now = stress_time_now();
+		dt = now - group->last_time;
+
+		for (j = 0; j < RESCTRL_EVENTS; j++) {
+			sample[j] = -1.0;
+			if (!valid[j])
+				continue;
+			if (j == RESCTRL_LLC_OCCUPANCY) {
+				sample[j] = (double)values[j];
+			} else if (group->last_valid[j] && (dt > 0.0) &&
+				   (values[j] >= group->last[j])) {
+				sample[j] = (double)(values[j] - group->last[j]) / dt;
+			}
+			group->last[j] = values[j];
+			group->last_valid[j] = true;
+			if (sample[j] < 0.0)
+				continue;
+			group->sum[j] += sample[j];
+			group->peak[j] = STRESS_MAXIMUM(group->peak[j], sample[j]);
+			group->samples[j]++;
+		}
+		group->last_time = now;
+		pr_dbg("resctrl: %s total %.1f MB/sec, local %.1f MB/sec, LLC occupancy %.0f KB\n",
+			group->name, sample[RESCTRL_MBM_TOTAL] / (double)MB,
+			sample[RESCTRL_MBM_LOCAL] / (double)MB,
+			sample[RESCTRL_LLC_OCCUPANCY] / (double)KB);
+	}
+}
+
+/*
+ *  stress_resctrl_start()
+ *	create a resctrl group for each stressor, a control group with
+ *	its own schemata if an allocation is set, otherwise a monitoring
+ *	group, then fork a process that samples the groups
+ */
+void stress_resctrl_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!resctrl_enabled)
+		return;
+	if (stress_resctrl_mount() < 0) {
+		pr_inf("resctrl: no resctrl file system mounted, mount it with "
+			"'mount -t resctrl resctrl /sys/fs/resctrl', no resctrl "
+			"monitoring will be performed\n");
+		resctrl_enabled = false;
+		return;
+	}
+	if (!resctrl_groups) {
+		resctrl_groups = (stress_resctrl_group_t *)mmap(NULL,
+			sizeof(*resctrl_groups) * RESCTRL_GROUPS_MAX,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (resctrl_groups == MAP_FAILED) {
+			pr_inf("resctrl: cannot mmap group state, no resctrl "
+				"monitoring will be performed\n");
+			resctrl_groups = NULL;
+			resctrl_enabled = false;
+			return;
+		}
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_resctrl_group_t *group;
+		uint64_t values[RESCTRL_EVENTS];
+		bool valid[RESCTRL_EVENTS];
+		char path[PATH_MAX];
+
+		if (!ss->num_instances)
+			continue;
+		group = stress_resctrl_find(ss);
+		if (!group) {
+			if (resctrl_groups_n >= RESCTRL_GROUPS_MAX) {
+				pr_inf("resctrl: more than %d stressors, %s is not monitored\n",
+					RESCTRL_GROUPS_MAX, ss->stressor->name);
+				continue;
+			}
+			group = &resctrl_groups[resctrl_groups_n++];
+			(void)memset(group, 0, sizeof(*group));
+			(void)shim_strlcpy(group->name,
+				stress_munge_underscore(ss->stressor->name), sizeof(group->name));
+		}
+		if (*group->path)
+			continue;
+		if (resctrl_l3_ways || resctrl_mb)
+			(void)snprintf(path, sizeof(path), "%s/stress-ng-%d-%s",
+				resctrl_mnt, (int)getpid(), group->name);
+		else
+			(void)snprintf(path, sizeof(path), "%s/mon_groups/stress-ng-%d-%s",
+				resctrl_mnt, (int)getpid(), group->name);
+		if ((mkdir(path, S_IRWXU) < 0) && (errno != EEXIST)) {
+			pr_inf("resctrl: cannot create group %s, errno=%d (%s)%s\n",
+				path, errno, strerror(errno),
+				(errno == ENOSPC) ? ", out of CLOSIDs or RMIDs" : "");
+			continue;
+		}
+		(void)shim_strlcpy(group->path, path, sizeof(group->path));
+		if (resctrl_l3_ways || resctrl_mb)
+			stress_resctrl_allocate(group);
+
+		/* baseline readings for the first bandwidth sample */
+		stress_resctrl_read_events(group, values, valid);
+		(void)memcpy(group->last, values, sizeof(group->last));
+		(void)memcpy(group->last_valid, valid, sizeof(group->last_valid));
+		group->last_time = stress_time_now();
+	}
+
+	resctrl_pid = fork();
+	if (resctrl_pid < 0)
+		pr_dbg("resctrl: cannot fork sampling process, errno=%d (%s)\n",
+			errno, strerror(errno));
+	if (resctrl_pid != 0)
+		return;
+
+	stress_parent_died_alarm();
+	for (;;) {
+		(void)sleep(resctrl_interval);
+		stress_resctrl_sample();
+	}
+}
+
+/*
+ *  stress_resctrl_enter()
+ *	move the calling stressor instance into the group of its
+ *	stressor, called by the child after the fork
+ */
+void stress_resctrl_enter(const stress_stressor_t *ss)
+{
+	const stress_resctrl_group_t *group;
+	char pid[32];
+
+	if (!resctrl_enabled)
+		return;
+	group = stress_resctrl_find(ss);
+	if (!group || !*group->path)
+		return;
+	(void)snprintf(pid, sizeof(pid), "%d\n", (int)getpid());
+	if (stress_resctrl_write(group->path, "tasks", pid) < 0)
+		pr_dbg("resctrl: cannot move pid %d to %s, errno=%d (%s)\n",
+			(int)getpid(), group->path, errno, strerror(errno));
+}
+
+/*
+ *  stress_resctrl_stop()
+ *	stop the sampling process, take a final sample and
+ *	remove the groups of the stressors in the list
+ */
+void stress_resctrl_stop(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!resctrl_enabled)
+		return;
+	if (resctrl_pid > 0) {
+		int status;
+
+		(void)kill(resctrl_pid, SIGKILL);
+		(void)waitpid(resctrl_pid, &status, 0);
+		resctrl_pid = 0;
+	}
+	stress_resctrl_sample();
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_resctrl_group_t *group = stress_resctrl_find(ss);
+
+		if (!group || !*group->path)
+			continue;
+		if (rmdir(group->path) < 0)
+			pr_dbg("resctrl: cannot remove group %s, errno=%d (%s)\n",
+				group->path, errno, strerror(errno));
+		*group->path = '\0';
+	}
+}
+
+/*
+ *  stress_resctrl_dump()
+ *	report the memory bandwidth and LLC occupancy of each group
+ */
+void stress_resctrl_dump(FILE *yaml)
+{
+	static const char * const labels[RESCTRL_EVENTS] = {
+		"mbm-total-mb-per-sec",
+		"mbm-local-mb-per-sec",
+		"llc-occupancy-kb",
+	};
+	static const double scale[RESCTRL_EVENTS] = {
+		(double)MB, (double)MB, (double)KB
+	};
+	size_t i, j;
+
+	if (!resctrl_groups_n)
+		goto free_mnt;
+
+	pr_inf("resctrl: memory bandwidth (MBM) and LLC occupancy (CMT) of each stressor:\n");
+	if (resctrl_l3_ways)
+		pr_inf("resctrl: each stressor is allocated %" PRIu32 " L3 cache ways\n",
+			resctrl_l3_ways);
+	if (resctrl_mb)
+		pr_inf("resctrl: each stressor is allocated %" PRIu32 "%% memory bandwidth\n",
+			resctrl_mb);
+	pr_inf("%-20s %12s %12s %12s %12s %12s %12s\n", "stressor",
+		"total MB/s", "peak MB/s", "local MB/s", "peak MB/s",
+		"LLC KB", "peak LLC KB");
+	pr_yaml(yaml, "resctrl:\n");
+	if (resctrl_l3_ways)
+		pr_yaml(yaml, "    l3-ways: %" PRIu32 "\n", resctrl_l3_ways);
+	if (resctrl_mb)
+		pr_yaml(yaml, "    mb-percent: %" PRIu32 "\n", resctrl_mb);
+	pr_yaml(yaml, "    groups:\n");
+	for (i = 0; i < resctrl_groups_n; i++) {
+		const stress_resctrl_group_t *group = &resctrl_groups[i];
+		char str[128];
+
+		(void)snprintf(str, sizeof(str), "%-20s", group->name);
+		pr_yaml(yaml, "      - stressor: %s\n", group->name);
+		for (j = 0; j < RESCTRL_EVENTS; j++) {
+			const size_t len = strlen(str);
+			double avg, peak;
+
+			if (!group->samples[j]) {
+				(void)snprintf(str + len, sizeof(str) - len, " %12s %12s", "-", "-");
+				continue;
+			}
+			avg = group->sum[j] / (double)group->samples[j] / scale[j];
+			peak = group->peak[j] / scale[j];
+			(void)snprintf(str + len, sizeof(str) - len, " %12.1f %12.1f", avg, peak);
+			pr_yaml(yaml, "        %s: %.1f\n", labels[j], avg);
+			pr_yaml(yaml, "        peak-%s: %.1f\n", labels[j], peak);
+		}
+		pr_inf("%s\n", str);
+	}
+	pr_yaml(yaml, "\n");
+
+	(void)munmap((void *)resctrl_groups, sizeof(*resctrl_groups) * RESCTRL_GROUPS_MAX);
+	resctrl_groups = NULL;
+	resctrl_groups_n = 0;
+free_mnt:
+	free(resctrl_mnt);
+	resctrl_mnt = NULL;
+}
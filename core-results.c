@@ -0,0 +1,453 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-perf.h"
+#include "core-results.h"
+
+#if defined(HAVE_SYS_UTSNAME_H)
+#include <sys/utsname.h>
+#endif
+
+/*
+ *  Bump the schema version whenever a field is renamed, removed or
+ *  changes meaning; adding new fields does not change the version
+ */
+#define STRESS_RESULTS_SCHEMA		"stress-ng-results"
+#define STRESS_RESULTS_SCHEMA_VERSION	(1)
+#define STRESS_RESULTS_PERF_MAX		(64)
+
+/* per instance results */
+typedef struct {
+	uint64_t bogo_ops;		/* bogo ops */
+	double	wall_time;		/* wall clock time, seconds */
+	double	user_time;		/* user time, seconds */
+	double	system_time;		/* system time, seconds */
+	long int maxrss;		/* maximum RSS, KB */
+} stress_results_instance_t;
+
+/*
+ *  stress_results_instance()
+ *	gather the results of one stressor instance
+ */
+static void stress_results_instance(
+	const stress_stats_t *stats,
+	const int32_t ticks_per_sec,
+	stress_results_instance_t *ri)
+{
+	ri->bogo_ops = stats->ci.counter;
+	ri->wall_time = stats->finish - stats->start;
+	ri->maxrss = 0;
+#if defined(HAVE_GETRUSAGE)
+	ri->user_time = stats->rusage_utime;
+	ri->system_time = stats->rusage_stime;
+#if defined(HAVE_RUSAGE_RU_MAXRSS)
+	ri->maxrss = stats->rusage_maxrss;
+#endif
+#else
+	ri->user_time = (ticks_per_sec > 0) ?
+		(double)(stats->tms.tms_utime + stats->tms.tms_cutime) / (double)ticks_per_sec : 0.0;
+	ri->system_time = (ticks_per_sec > 0) ?
+		(double)(stats->tms.tms_stime + stats->tms.tms_cstime) / (double)ticks_per_sec : 0.0;
+#endif
+	(void)ticks_per_sec;
+}
+
+/*
+ *  stress_results_json_str()
+ *	output a JSON string with quotes, backslashes and
+ *	control characters escaped
+ */
+static void stress_results_json_str(FILE *fp, const char *str)
+{
+	(void)fputc('"', fp);
+	for (; *str; str++) {
+		const unsigned char ch = (unsigned char)*str;
+
+		if ((ch == '"') || (ch == '\\'))
+			(void)fprintf(fp, "\\%c", ch);
+		else if (ch < 0x20)
+			(void)fprintf(fp, "\\u%4.4x", ch);
+		else
+			(void)fputc(ch, fp);
+	}
+	(void)fputc('"', fp);
+}
+
+/*
+ *  stress_results_json_num()
+ *	output a JSON number, JSON has no NaN or infinity
+ */
+static void stress_results_json_num(FILE *fp, const double val)
+{
+	if (isfinite(val))
+		(void)fprintf(fp, "%.6f", val);
+	else
+		(void)fprintf(fp, "null");
+}
+
+/*
+ *  stress_results_json_run()
+ *	output the run information object
+ */
+static void stress_results_json_run(FILE *fp, const double duration, const bool success)
+{
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	struct utsname uts;
+#endif
+	const size_t hostname_len = stress_hostname_length();
+	char hostname[hostname_len];
+	const time_t t = time(NULL);
+
+	(void)fprintf(fp, "  \"run\": {\n");
+	(void)fprintf(fp, "    \"epoch-secs\": %ld,\n", (long)t);
+	if (!gethostname(hostname, sizeof(hostname))) {
+		(void)fprintf(fp, "    \"hostname\": ");
+		stress_results_json_str(fp, hostname);
+		(void)fprintf(fp, ",\n");
+	}
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	if (uname(&uts) == 0) {
+		(void)fprintf(fp, "    \"sysname\": ");
+		stress_results_json_str(fp, uts.sysname);
+		(void)fprintf(fp, ",\n    \"release\": ");
+		stress_results_json_str(fp, uts.release);
+		(void)fprintf(fp, ",\n    \"version\": ");
+		stress_results_json_str(fp, uts.version);
+		(void)fprintf(fp, ",\n    \"machine\": ");
+		stress_results_json_str(fp, uts.machine);
+		(void)fprintf(fp, ",\n");
+	}
+#endif
+	(void)fprintf(fp, "    \"cpus\": %" PRId32 ",\n", stress_get_processors_configured());
+	(void)fprintf(fp, "    \"cpus-online\": %" PRId32 ",\n", stress_get_processors_online());
+	(void)fprintf(fp, "    \"page-size\": %zu,\n", stress_get_page_size());
+	(void)fprintf(fp, "    \"timeout\": %" PRIu64 ",\n", g_opt_timeout);
+	(void)fprintf(fp, "    \"duration\": ");
+	stress_results_json_num(fp, duration);
+	(void)fprintf(fp, ",\n    \"success\": %s\n", success ? "true" : "false");
+	(void)fprintf(fp, "  },\n");
+}
+
+/*
+ *  stress_results_json_stressor()
+ *	output the results object of one stressor
+ */
+static void stress_results_json_stressor(
+	FILE *fp,
+	const stress_stressor_t *ss,
+	const int32_t ticks_per_sec)
+{
+	const char *munged = stress_munge_underscore(ss->stressor->name);
+	stress_results_instance_t ri, total;
+	bool run_ok = false;
+	size_t i;
+	int32_t j;
+	const char *sep;
+
+	(void)memset(&total, 0, sizeof(total));
+	for (j = 0; j < ss->started_instances; j++) {
+		stress_results_instance(ss->stats[j], ticks_per_sec, &ri);
+		total.bogo_ops += ri.bogo_ops;
+		total.wall_time += ri.wall_time;
+		total.user_time += ri.user_time;
+		total.system_time += ri.system_time;
+		total.maxrss = STRESS_MAXIMUM(total.maxrss, ri.maxrss);
+		run_ok |= ss->stats[j]->run_ok;
+	}
+	/* real time in terms of the average wall clock time of all instances */
+	if (ss->started_instances)
+		total.wall_time /= (double)ss->started_instances;
+
+	(void)fprintf(fp, "    {\n      \"stressor\": ");
+	stress_results_json_str(fp, munged);
+	(void)fprintf(fp, ",\n      \"instances\": %" PRId32 ",\n", ss->started_instances);
+	(void)fprintf(fp, "      \"run-ok\": %s,\n", run_ok ? "true" : "false");
+	(void)fprintf(fp, "      \"bogo-ops\": %" PRIu64 ",\n", total.bogo_ops);
+	(void)fprintf(fp, "      \"wall-clock-time\": ");
+	stress_results_json_num(fp, total.wall_time);
+	(void)fprintf(fp, ",\n      \"user-time\": ");
+	stress_results_json_num(fp, total.user_time);
+	(void)fprintf(fp, ",\n      \"system-time\": ");
+	stress_results_json_num(fp, total.system_time);
+	(void)fprintf(fp, ",\n      \"bogo-ops-per-second-real-time\": ");
+	stress_results_json_num(fp, (total.wall_time > 0.0) ?
+		(double)total.bogo_ops / total.wall_time : 0.0);
+	(void)fprintf(fp, ",\n      \"bogo-ops-per-second-usr-sys-time\": ");
+	stress_results_json_num(fp, (total.user_time + total.system_time > 0.0) ?
+		(double)total.bogo_ops / (total.user_time + total.system_time) : 0.0);
+	(void)fprintf(fp, ",\n      \"max-rss\": %ld,\n", total.maxrss);
+
+	/* misc metrics are averaged over the instances that set them */
+	(void)fprintf(fp, "      \"misc-metrics\": [");
+	sep = "\n";
+	for (i = 0; ss->started_instances && (i < STRESS_MISC_STATS_MAX); i++) {
+		const char *description = ss->stats[0]->misc_stats[i].description;
+		double sum = 0.0;
+		int32_t n = 0;
+
+		if (!*description)
+			continue;
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_misc_stats_t *ms = &ss->stats[j]->misc_stats[i];
+
+			if ((ms->value >= 0.0) && !strcmp(ms->description, description)) {
+				sum += ms->value;
+				n++;
+			}
+		}
+		if (!n)
+			continue;
+		(void)fprintf(fp, "%s        { \"description\": ", sep);
+		stress_results_json_str(fp, description);
+		(void)fprintf(fp, ", \"value\": ");
+		stress_results_json_num(fp, sum / (double)n);
+		(void)fprintf(fp, " }");
+		sep = ",\n";
+	}
+	(void)fprintf(fp, "%s],\n", (*sep == ',') ? "\n      " : "");
+
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	(void)fprintf(fp, "      \"perf\": [");
+	sep = "\n";
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		const char *labels[STRESS_RESULTS_PERF_MAX];
+		uint64_t totals[STRESS_RESULTS_PERF_MAX];
+		const size_t n = stress_perf_stat_totals(ss, labels, totals, STRESS_RESULTS_PERF_MAX);
+
+		for (i = 0; i < n; i++) {
+			(void)fprintf(fp, "%s        { \"event\": ", sep);
+			stress_results_json_str(fp, labels[i]);
+			(void)fprintf(fp, ", \"total\": %" PRIu64 ", \"per-second\": ", totals[i]);
+			stress_results_json_num(fp, (total.wall_time > 0.0) ?
+				(double)totals[i] / total.wall_time : 0.0);
+			(void)fprintf(fp, " }");
+			sep = ",\n";
+		}
+	}
+	(void)fprintf(fp, "%s],\n", (*sep == ',') ? "\n      " : "");
+#endif
+
+#if defined(STRESS_THERMAL_ZONES)
+	(void)fprintf(fp, "      \"thermal-zones\": [");
+	sep = "\n";
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES) {
+		const stress_tz_info_t *tz_info;
+
+		for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
+			uint64_t sum = 0;
+			uint32_t n = 0;
+
+			for (j = 0; j < ss->started_instances; j++) {
+				const uint64_t temp = ss->stats[j]->tz->tz_stat[tz_info->index].temperature;
+
+				/* Avoid crazy temperatures. e.g. > 250 C */
+				if (temp && (temp <= 250000)) {
+					sum += temp;
+					n++;
+				}
+			}
+			if (!n)
+				continue;
+			(void)fprintf(fp, "%s        { \"type\": ", sep);
+			stress_results_json_str(fp, tz_info->type);
+			(void)fprintf(fp, ", \"type-instance\": %" PRIu32 ", \"celsius\": ",
+				tz_info->type_instance);
+			stress_results_json_num(fp, ((double)sum / (double)n) / 1000.0);
+			(void)fprintf(fp, " }");
+			sep = ",\n";
+		}
+	}
+	(void)fprintf(fp, "%s],\n", (*sep == ',') ? "\n      " : "");
+#endif
+
+	(void)fprintf(fp, "      \"instance-results\": [");
+	for (j = 0; j < ss->started_instances; j++) {
+		stress_results_instance(ss->stats[j], ticks_per_sec, &ri);
+		(void)fprintf(fp, "%s        { \"instance\": %" PRId32 ", \"run-ok\": %s, "
+			"\"bogo-ops\": %" PRIu64 ", \"wall-clock-time\": ",
+			j ? ",\n" : "\n", j, ss->stats[j]->run_ok ? "true" : "false", ri.bogo_ops);
+		stress_results_json_num(fp, ri.wall_time);
+		(void)fprintf(fp, ", \"user-time\": ");
+		stress_results_json_num(fp, ri.user_time);
+		(void)fprintf(fp, ", \"system-time\": ");
+		stress_results_json_num(fp, ri.system_time);
+		(void)fprintf(fp, ", \"max-rss\": %ld", ri.maxrss);
+		if (ss->stats[j]->placement_cpu >= 0)
+			(void)fprintf(fp, ", \"cpu\": %" PRId32, ss->stats[j]->placement_cpu);
+		if (ss->stats[j]->freq.valid) {
+			const stress_freq_stats_t *fs = &ss->stats[j]->freq;
+
+			if (fs->ghz > 0.0) {
+				(void)fprintf(fp, ", \"ghz\": ");
+				stress_results_json_num(fp, fs->ghz);
+			}
+			if (fs->cycles_valid) {
+				(void)fprintf(fp, ", \"cycles\": %" PRIu64 ", \"bogo-ops-per-gigacycle\": ",
+					fs->cycles);
+				stress_results_json_num(fp, ((double)ri.bogo_ops * 1000000000.0) / (double)fs->cycles);
+			}
+			(void)fprintf(fp, ", \"core-throttles\": %" PRIu64 ", \"package-throttles\": %" PRIu64,
+				fs->core_throttles, fs->package_throttles);
+		}
+		(void)fprintf(fp, " }");
+	}
+	(void)fprintf(fp, "%s]\n    }", ss->started_instances ? "\n      " : "");
+}
+
+/*
+ *  stress_results_json()
+ *	write a single schema versioned JSON object for the run
+ */
+static void stress_results_json(
+	const char *filename,
+	stress_stressor_t *stressors_list,
+	const int32_t ticks_per_sec,
+	const double duration,
+	const bool success)
+{
+	stress_stressor_t *ss;
+	FILE *fp;
+	const char *sep = "\n";
+
+	fp = fopen(filename, "w");
+	if (!fp) {
+		pr_err("Cannot output JSON results to %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return;
+	}
+	(void)fprintf(fp, "{\n");
+	(void)fprintf(fp, "  \"schema\": \"" STRESS_RESULTS_SCHEMA "\",\n");
+	(void)fprintf(fp, "  \"schema-version\": %d,\n", STRESS_RESULTS_SCHEMA_VERSION);
+	(void)fprintf(fp, "  \"stress-ng-version\": \"" VERSION "\",\n");
+	stress_results_json_run(fp, duration, success);
+	stress_sample_json(fp, stressors_list);
+	(void)fprintf(fp, "  \"stressors\": [");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (!ss->stats)
+			continue;
+		(void)fprintf(fp, "%s", sep);
+		stress_results_json_stressor(fp, ss, ticks_per_sec);
+		sep = ",\n";
+	}
+	(void)fprintf(fp, "%s]\n}\n", (*sep == ',') ? "\n  " : "");
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_results_csv_str()
+ *	output a CSV field, quoted if it contains a comma or quote
+ */
+static void stress_results_csv_str(FILE *fp, const char *str)
+{
+	if (!strpbrk(str, ",\"\n")) {
+		(void)fputs(str, fp);
+		return;
+	}
+	(void)fputc('"', fp);
+	for (; *str; str++) {
+		if (*str == '"')
+			(void)fputc('"', fp);
+		(void)fputc(*str, fp);
+	}
+	(void)fputc('"', fp);
+}
+
+/*
+ *  stress_results_csv()
+ *	write one row per stressor instance; the columns are fixed
+ *	so the header is the same for every run and stressor, the
+ *	misc metrics occupy STRESS_MISC_STATS_MAX name/value pairs
+ */
+static void stress_results_csv(
+	const char *filename,
+	stress_stressor_t *stressors_list,
+	const int32_t ticks_per_sec)
+{
+	stress_stressor_t *ss;
+	FILE *fp;
+	const time_t t = time(NULL);
+	size_t i;
+
+	fp = fopen(filename, "w");
+	if (!fp) {
+		pr_err("Cannot output CSV results to %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return;
+	}
+	(void)fprintf(fp, "schema_version,epoch_secs,stressor,instance,run_ok,bogo_ops,"
+		"wall_clock_time,user_time,system_time,bogo_ops_per_second_real_time,max_rss");
+	for (i = 0; i < STRESS_MISC_STATS_MAX; i++)
+		(void)fprintf(fp, ",misc%zu_description,misc%zu_value", i + 1, i + 1);
+	(void)fprintf(fp, "\n");
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		int32_t j;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+			stress_results_instance_t ri;
+
+			stress_results_instance(stats, ticks_per_sec, &ri);
+			(void)fprintf(fp, "%d,%ld,", STRESS_RESULTS_SCHEMA_VERSION, (long)t);
+			stress_results_csv_str(fp, munged);
+			(void)fprintf(fp, ",%" PRId32 ",%d,%" PRIu64 ",%.6f,%.6f,%.6f,%.6f,%ld",
+				j, stats->run_ok ? 1 : 0, ri.bogo_ops, ri.wall_time,
+				ri.user_time, ri.system_time,
+				(ri.wall_time > 0.0) ? (double)ri.bogo_ops / ri.wall_time : 0.0,
+				ri.maxrss);
+			for (i = 0; i < STRESS_MISC_STATS_MAX; i++) {
+				const stress_misc_stats_t *ms = &stats->misc_stats[i];
+
+				(void)fputc(',', fp);
+				if (*ms->description && (ms->value >= 0.0)) {
+					stress_results_csv_str(fp, ms->description);
+					(void)fprintf(fp, ",%.6f", ms->value);
+				} else {
+					(void)fputc(',', fp);
+				}
+			}
+			(void)fprintf(fp, "\n");
+		}
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_results_dump()
+ *	write the --json and --csv machine readable results
+ */
+void stress_results_dump(
+	stress_stressor_t *stressors_list,
+	const int32_t ticks_per_sec,
+	const double duration,
+	const bool success)
+{
+	char *filename;
+
+	if (stress_get_setting("json", &filename))
+		stress_results_json(filename, stressors_list, ticks_per_sec, duration, success);
+	if (stress_get_setting("csv", &filename))
+		stress_results_csv(filename, stressors_list, ticks_per_sec);
+}
@@ -0,0 +1,327 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-scale-sweep.h"
+
+#define SCALE_SWEEP_MAX		(64)	/* maximum instance counts */
+
+static int32_t sweep_instances[SCALE_SWEEP_MAX];	/* sorted instance counts */
+static uint32_t sweep_steps;				/* 0 = off */
+static double *sweep_rates;		/* [stressor][step] bogo-ops/sec */
+static size_t sweep_stressors;		/* stressors in sweep_rates */
+
+/*
+ *  stress_scale_sweep_add()
+ *	add an instance count to the sweep, duplicates are ignored
+ */
+static void stress_scale_sweep_add(const int32_t instances)
+{
+	uint32_t i;
+
+	for (i = 0; i < sweep_steps; i++) {
+		if (sweep_instances[i] == instances)
+			return;
+	}
+	if (sweep_steps < SCALE_SWEEP_MAX)
+		sweep_instances[sweep_steps++] = instances;
+}
+
+/*
+ *  stress_scale_sweep_cmp()
+ *	qsort comparison of instance counts
+ */
+static int stress_scale_sweep_cmp(const void *p1, const void *p2)
+{
+	const int32_t i1 = *(const int32_t *)p1;
+	const int32_t i2 = *(const int32_t *)p2;
+
+	return (i1 > i2) - (i1 < i2);
+}
+
+/*
+ *  stress_scale_sweep_cores()
+ *	number of online physical cores, the CPUs that are the
+ *	first of their SMT siblings, 0 if unknown
+ */
+static int32_t stress_scale_sweep_cores(void)
+{
+	const int32_t cpus = stress_get_processors_configured();
+	int32_t cpu, cores = 0;
+
+	for (cpu = 0; cpu < cpus; cpu++) {
+		char path[PATH_MAX], buf[256];
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/topology/thread_siblings_list", cpu);
+		if (system_read(path, buf, sizeof(buf)) <= 0)
+			continue;
+		if (atoi(buf) == cpu)
+			cores++;
+	}
+	return cores;
+}
+
+/*
+ *  stress_set_scale_sweep()
+ *	parse a comma separated list of instance counts or auto,
+ *	auto sweeps the powers of 2, the number of physical cores
+ *	and the number of online CPUs
+ */
+int stress_set_scale_sweep(const char *const opt)
+{
+	char *str, *token, *saveptr = NULL;
+
+	sweep_steps = 0;
+	if (!strcmp(opt, "auto")) {
+		const int32_t online = STRESS_MAXIMUM(stress_get_processors_online(), 1);
+		const int32_t cores = stress_scale_sweep_cores();
+		int32_t n;
+
+		for (n = 1; n < online; n <<= 1)
+			stress_scale_sweep_add(n);
+		if ((cores > 0) && (cores < online))
+			stress_scale_sweep_add(cores);
+		stress_scale_sweep_add(online);
+		if (sweep_steps < 2) {
+			(void)fprintf(stderr, "scale-sweep: auto found just 1 online CPU, "
+				"use a list of instance counts instead\n");
+			_exit(EXIT_FAILURE);
+		}
+	} else {
+		str = strdup(opt);
+		if (!str) {
+			(void)fprintf(stderr, "scale-sweep: out of memory parsing '%s'\n", opt);
+			_exit(EXIT_FAILURE);
+		}
+		for (token = strtok_r(str, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr)) {
+			char *end;
+			const long int val = strtol(token, &end, 10);
+
+			if ((end == token) || *end || (val < 1) || (val > STRESS_PROCS_MAX)) {
+				(void)fprintf(stderr, "scale-sweep: invalid instance count '%s', "
+					"must be in the range 1 to %d\n", token, STRESS_PROCS_MAX);
+				free(str);
+				_exit(EXIT_FAILURE);
+			}
+			stress_scale_sweep_add((int32_t)val);
+		}
+		free(str);
+	}
+	if (sweep_steps < 2) {
+		(void)fprintf(stderr, "scale-sweep: at least 2 different instance counts are required\n");
+		_exit(EXIT_FAILURE);
+	}
+	qsort(sweep_instances, sweep_steps, sizeof(*sweep_instances), stress_scale_sweep_cmp);
+	return 0;
+}
+
+/*
+ *  stress_scale_sweep_steps()
+ *	number of instance counts to sweep, 0 if not sweeping
+ */
+uint32_t stress_scale_sweep_steps(void)
+{
+	return sweep_steps;
+}
+
+/*
+ *  stress_scale_sweep_max()
+ *	the largest instance count of the sweep
+ */
+int32_t stress_scale_sweep_max(void)
+{
+	return sweep_steps ? sweep_instances[sweep_steps - 1] : 0;
+}
+
+/*
+ *  stress_scale_sweep_set()
+ *	set the number of instances of all the stressors for
+ *	a step of the sweep
+ */
+void stress_scale_sweep_set(stress_stressor_t *stressors_list, const uint32_t step)
+{
+	stress_stressor_t *ss;
+
+	if (step >= sweep_steps)
+		return;
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->stats)
+			ss->num_instances = sweep_instances[step];
+	}
+}
+
+/*
+ *  stress_scale_sweep_sample()
+ *	record the real time bogo-ops rate of each stressor for
+ *	a completed step of the sweep
+ */
+void stress_scale_sweep_sample(stress_stressor_t *stressors_list, const uint32_t step)
+{
+	stress_stressor_t *ss;
+	size_t n;
+
+	if (step >= sweep_steps)
+		return;
+
+	if (!sweep_rates) {
+		for (ss = stressors_list; ss; ss = ss->next)
+			sweep_stressors++;
+		sweep_rates = calloc(sweep_stressors * sweep_steps, sizeof(*sweep_rates));
+		if (!sweep_rates) {
+			pr_err("scale-sweep: cannot allocate step samples\n");
+			sweep_steps = 0;
+			return;
+		}
+	}
+
+	for (n = 0, ss = stressors_list; ss && (n < sweep_stressors); ss = ss->next, n++) {
+		uint64_t c_total = 0;
+		double r_total = 0.0;
+		int32_t j;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			c_total += stats->ci.counter;
+			r_total += stats->finish - stats->start;
+		}
+		/* same as the real time bogo-ops/s in the metrics */
+		r_total = ss->started_instances ? r_total / (double)ss->started_instances : 0.0;
+		sweep_rates[(n * sweep_steps) + step] =
+			(r_total > 0.0) ? (double)c_total / r_total : 0.0;
+	}
+}
+
+/*
+ *  stress_scale_sweep_fit()
+ *	least squares fit of the Amdahl serial fraction and of the
+ *	Universal Scalability Law contention (sigma) and coherency
+ *	(kappa) coefficients; with the relative capacity C(n) =
+ *	X(n) / X(1) the USL C(n) = n / (1 + sigma(n - 1) + kappa n(n - 1))
+ *	is linear in sigma and kappa as n / C(n) - 1. X(1) is
+ *	extrapolated from the smallest instance count if 1 is not
+ *	swept. Returns false if there are too few points to fit.
+ */
+static bool stress_scale_sweep_fit(
+	const double *rates,
+	double *amdahl,
+	double *sigma,
+	double *kappa)
+{
+	double s11 = 0.0, s12 = 0.0, s22 = 0.0, s1y = 0.0, s2y = 0.0, det;
+	const double lambda = rates[0] / (double)sweep_instances[0];
+	uint32_t i, points = 0;
+
+	if (lambda <= 0.0)
+		return false;
+
+	for (i = 0; i < sweep_steps; i++) {
+		const double n = (double)sweep_instances[i];
+		const double capacity = rates[i] / lambda;
+		double x1, x2, y;
+
+		if ((sweep_instances[i] < 2) || (capacity <= 0.0))
+			continue;
+		x1 = n - 1.0;
+		x2 = n * (n - 1.0);
+		y = (n / capacity) - 1.0;
+		s11 += x1 * x1;
+		s12 += x1 * x2;
+		s22 += x2 * x2;
+		s1y += x1 * y;
+		s2y += x2 * y;
+		points++;
+	}
+	if (points < 2)
+		return false;
+
+	*amdahl = s1y / s11;
+	det = (s11 * s22) - (s12 * s12);
+	if (fabs(det) < 1.0E-12)
+		return false;
+	*sigma = ((s1y * s22) - (s2y * s12)) / det;
+	*kappa = ((s2y * s11) - (s1y * s12)) / det;
+	return true;
+}
+
+/*
+ *  stress_scale_sweep_dump()
+ *	report the throughput, per instance throughput and parallel
+ *	efficiency of each stressor at each instance count and the
+ *	fitted scalability coefficients
+ */
+void stress_scale_sweep_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t n;
+
+	if (!sweep_steps || !sweep_rates)
+		return;
+
+	pr_inf("scale-sweep: throughput at each instance count:\n");
+	pr_inf("%-13s %9s %13s %13s %10s\n",
+		"stressor", "instances", "bogo ops/s", "per instance", "efficiency");
+	pr_yaml(yaml, "scale-sweep:\n");
+
+	for (n = 0, ss = stressors_list; ss && (n < sweep_stressors); ss = ss->next, n++) {
+		const char *munged = stress_munge_underscore(ss->stressor->name);
+		const double *rates = &sweep_rates[n * sweep_steps];
+		const double base = rates[0] / (double)sweep_instances[0];
+		double amdahl = 0.0, sigma = 0.0, kappa = 0.0;
+		uint32_t i;
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      steps:\n");
+		for (i = 0; i < sweep_steps; i++) {
+			const double per_instance = rates[i] / (double)sweep_instances[i];
+			const double efficiency = (base > 0.0) ? 100.0 * per_instance / base : 0.0;
+
+			pr_inf("%-13s %9" PRId32 " %13.2f %13.2f %9.1f%%\n",
+				munged, sweep_instances[i], rates[i], per_instance, efficiency);
+			pr_yaml(yaml, "        - instances: %" PRId32 "\n", sweep_instances[i]);
+			pr_yaml(yaml, "          bogo-ops-per-second: %f\n", rates[i]);
+			pr_yaml(yaml, "          bogo-ops-per-second-per-instance: %f\n", per_instance);
+			pr_yaml(yaml, "          efficiency-percent: %f\n", efficiency);
+		}
+		if (!stress_scale_sweep_fit(rates, &amdahl, &sigma, &kappa)) {
+			pr_inf("%-13s too few valid instance counts to fit a scalability model\n", munged);
+			continue;
+		}
+		if ((kappa > 0.0) && (sigma < 1.0)) {
+			const double peak = sqrt((1.0 - sigma) / kappa);
+
+			pr_inf("%-13s Amdahl serial fraction %.4f, USL sigma %.4f, "
+				"kappa %.6f, peak at %.1f instances\n",
+				munged, amdahl, sigma, kappa, peak);
+			pr_yaml(yaml, "      usl-peak-instances: %f\n", peak);
+		} else {
+			pr_inf("%-13s Amdahl serial fraction %.4f, USL sigma %.4f, kappa %.6f\n",
+				munged, amdahl, sigma, kappa);
+		}
+		pr_yaml(yaml, "      amdahl-serial-fraction: %f\n", amdahl);
+		pr_yaml(yaml, "      usl-sigma: %f\n", sigma);
+		pr_yaml(yaml, "      usl-kappa: %f\n", kappa);
+	}
+	pr_yaml(yaml, "\n");
+	free(sweep_rates);
+	sweep_rates = NULL;
+	sweep_stressors = 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-schedstat.h"
+
+/*
+ *  stress_schedstat_read()
+ *	read the run time, run queue wait time and number of timeslices
+ *	of the calling thread, returns -1 if schedstat is not available
+ */
+int stress_schedstat_read(stress_schedstat_t *schedstat)
+{
+	char buf[128];
+	unsigned long long run_ns, wait_ns, timeslices;
+
+	(void)memset(schedstat, 0, sizeof(*schedstat));
+	(void)memset(buf, 0, sizeof(buf));
+	/* per thread for --instance-mode threads, else the process */
+	if ((system_read("/proc/thread-self/schedstat", buf, sizeof(buf) - 1) < 1) &&
+	    (system_read("/proc/self/schedstat", buf, sizeof(buf) - 1) < 1))
+		return -1;
+	if (sscanf(buf, "%llu %llu %llu", &run_ns, &wait_ns, &timeslices) != 3)
+		return -1;
+	schedstat->run_ns = (uint64_t)run_ns;
+	schedstat->wait_ns = (uint64_t)wait_ns;
+	schedstat->timeslices = (uint64_t)timeslices;
+	schedstat->valid = true;
+	return 0;
+}
+
+/*
+ *  stress_schedstat_delta()
+ *	turn delta, a sample at the end of a run, into the change
+ *	since the start sample
+ */
+void stress_schedstat_delta(stress_schedstat_t *delta, const stress_schedstat_t *start)
+{
+	if (!delta->valid || !start->valid) {
+		delta->valid = false;
+		return;
+	}
+	delta->run_ns -= start->run_ns;
+	delta->wait_ns -= start->wait_ns;
+	delta->timeslices -= start->timeslices;
+}
+
+/*
+ *  stress_schedstat_dump()
+ *	dump the run queue wait of each stressor, summed over all
+ *	the instances
+ */
+void stress_schedstat_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_SCHEDSTAT))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t run_ns = 0, wait_ns = 0, timeslices = 0, c_total = 0;
+		double r_total = 0.0, wait_per_sec, wait_per_slice;
+		int32_t j, n = 0;
+		const char *munged;
+
+		if (!ss->stats)
+			continue;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			if (!stats->schedstat.valid)
+				continue;
+			run_ns += stats->schedstat.run_ns;
+			wait_ns += stats->schedstat.wait_ns;
+			timeslices += stats->schedstat.timeslices;
+			c_total += stats->ci.counter;
+			r_total += stats->finish - stats->start;
+			n++;
+		}
+		if (!n)
+			continue;
+
+		if (!header) {
+			pr_inf("%-13s %9.9s %9.9s %9.9s %10.10s %10.10s %10.10s\n",
+				"schedstat", "bogo ops", "run time", "wait time",
+				"wait ms", "timeslices", "wait us");
+			pr_inf("%-13s %9.9s %9.9s %9.9s %10.10s %10.10s %10.10s\n",
+				"", "", "(secs) ", "(secs) ", "per sec", "", "per slice");
+			pr_yaml(yaml, "schedstat:\n");
+			header = true;
+		}
+
+		/* wait per second of instance wall clock time */
+		wait_per_sec = (r_total > 0.0) ?
+			((double)wait_ns / 1000000.0) / r_total : 0.0;
+		wait_per_slice = timeslices ?
+			((double)wait_ns / 1000.0) / (double)timeslices : 0.0;
+
+		munged = stress_munge_underscore(ss->stressor->name);
+		pr_inf("%-13s %9" PRIu64 " %9.2f %9.2f %10.2f %10" PRIu64 " %10.2f\n",
+			munged, c_total,
+			(double)run_ns / STRESS_NANOSECOND,
+			(double)wait_ns / STRESS_NANOSECOND,
+			wait_per_sec, timeslices, wait_per_slice);
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      run-time: %f\n", (double)run_ns / STRESS_NANOSECOND);
+		pr_yaml(yaml, "      wait-time: %f\n", (double)wait_ns / STRESS_NANOSECOND);
+		pr_yaml(yaml, "      timeslices: %" PRIu64 "\n", timeslices);
+		pr_yaml(yaml, "      wait-ms-per-second: %f\n", wait_per_sec);
+		pr_yaml(yaml, "      wait-us-per-timeslice: %f\n", wait_per_slice);
+		pr_yaml(yaml, "\n");
+	}
+}
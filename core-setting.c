@@ -18,9 +18,23 @@
  *
  */
 #include "stress-ng.h"
+#include "core-hash.h"
+
+#define SETTING_HASH_SIZE	(1021)	/* best if prime */
 
 static stress_setting_t *setting_head;	/* setting list head */
 static stress_setting_t *setting_tail;	/* setting list tail */
+static stress_setting_t *setting_hash[SETTING_HASH_SIZE]; /* settings by name */
+static uint32_t setting_count;		/* number of settings */
+
+/*
+ *  Settings of the last stressor looked up are only visible up to
+ *  the first non-global setting of the next stressor in the list,
+ *  cache this cut off index as it is the same for all lookups
+ */
+static stress_stressor_t *setting_cutoff_proc;
+static uint32_t setting_cutoff;
+static bool setting_cutoff_valid;
 
 #if defined(DEBUG_SETTINGS)
 #define	DBG(...)	pr_inf(__VA_ARGS__)
@@ -47,6 +61,46 @@ void stress_settings_free(void)
 	}
 	setting_head = NULL;
 	setting_tail = NULL;
+	(void)memset(setting_hash, 0, sizeof(setting_hash));
+	setting_count = 0;
+	setting_cutoff_valid = false;
+}
+
+/*
+ *  stress_setting_hash()
+ *	hash bucket index of a setting name
+ */
+static inline size_t stress_setting_hash(const char *name)
+{
+	return (size_t)(stress_hash_sdbm(name) % SETTING_HASH_SIZE);
+}
+
+/*
+ *  stress_setting_cutoff()
+ *	index of the first setting that is not visible to the
+ *	current stressor, settings at or after this are ignored
+ */
+static uint32_t stress_setting_cutoff(void)
+{
+	stress_setting_t *setting;
+	bool found = false;
+
+	if (setting_cutoff_valid && (setting_cutoff_proc == g_stressor_current))
+		return setting_cutoff;
+
+	setting_cutoff = UINT32_MAX;
+	for (setting = setting_head; setting; setting = setting->next) {
+		if (setting->proc == g_stressor_current)
+			found = true;
+		if (found && ((setting->proc != g_stressor_current) && (!setting->global))) {
+			setting_cutoff = setting->index;
+			break;
+		}
+	}
+	setting_cutoff_proc = g_stressor_current;
+	setting_cutoff_valid = true;
+
+	return setting_cutoff;
 }
 
 
@@ -61,6 +115,7 @@ static int stress_set_setting_generic(
 	const bool global)
 {
 	stress_setting_t *setting;
+	size_t h;
 
 	if (!value) {
 		(void)fprintf(stderr, "invalid setting '%s' value address (null)\n", name);
@@ -172,6 +227,13 @@ static int stress_set_setting_generic(
 	}
 	setting_tail = setting;
 
+	/* newest first, so the first name match is the latest setting */
+	setting->index = setting_count++;
+	h = stress_setting_hash(setting->name);
+	setting->hash_next = setting_hash[h];
+	setting_hash[h] = setting;
+	setting_cutoff_valid = false;
+
 	return 0;
 err:
 	(void)fprintf(stderr, "cannot allocate setting '%s'\n", name);
@@ -212,15 +274,13 @@ bool stress_get_setting(const char *name, void *value)
 {
 	stress_setting_t *setting;
 	bool set = false;
-	bool found = false;
+	const uint32_t cutoff = stress_setting_cutoff();
 
 	DBG("%s: get %s\n", __func__, name);
 
-	for (setting = setting_head; setting; setting = setting->next) {
-		if (setting->proc == g_stressor_current)
-			found = true;
-		if (found && ((setting->proc != g_stressor_current) && (!setting->global)))
-			break;
+	for (setting = setting_hash[stress_setting_hash(name)]; setting; setting = setting->hash_next) {
+		if (setting->index >= cutoff)
+			continue;
 
 		if (!strcmp(setting->name, name)) {
 			switch (setting->type_id) {
@@ -320,6 +380,7 @@ bool stress_get_setting(const char *name, void *value)
 				DBG("%s: UNDEF: %s -> ?\n", __func__, name);
 				break;
 			}
+			break;
 		}
 	}
 	return set;
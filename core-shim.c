@@ -22,6 +22,7 @@
 #include "stress-ng.h"
 #include "core-pragma.h"
 #include "core-arch.h"
+#include "core-syscall-stats.h"
 
 #if defined(__NR_pkey_get)
 #define HAVE_PKEY_GET
@@ -117,10 +118,18 @@ static inline long shim_enosys(long sysnr, ...)
 int shim_sched_yield(void)
 {
 #if defined(HAVE_SCHED_YIELD)
-	return sched_yield();
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = sched_yield();
+
+	stress_syscall_stats_end(STRESS_SYSCALL_SCHED_YIELD, t);
+	return ret;
 #elif defined(__NR_sched_yield) &&	\
       defined(HAVE_SYSCALL)
-	return syscall(__NR_sched_yield);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)syscall(__NR_sched_yield);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_SCHED_YIELD, t);
+	return ret;
 #else
 	UNEXPECTED
 	return sleep(0);
@@ -316,10 +325,18 @@ int shim_fallocate(int fd, int mode, off_t offset, off_t len)
 int shim_gettid(void)
 {
 #if defined(HAVE_GETTID)
-	return gettid();
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = gettid();
+
+	stress_syscall_stats_end(STRESS_SYSCALL_GETTID, t);
+	return ret;
 #elif defined(__NR_gettid) &&	\
       defined(HAVE_SYSCALL)
-	return (int)syscall(__NR_gettid);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)syscall(__NR_gettid);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_GETTID, t);
+	return ret;
 #else
 	UNEXPECTED
 	return (int)shim_enosys(0);
@@ -359,7 +376,11 @@ int shim_getdents(
 {
 #if defined(__NR_getdents) &&	\
     defined(HAVE_SYSCALL)
-	return (int)syscall(__NR_getdents, fd, dirp, count);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)syscall(__NR_getdents, fd, dirp, count);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_GETDENTS, t);
+	return ret;
 #else
 	return (int)shim_enosys(0, fd, dirp, count);
 #endif
@@ -376,7 +397,11 @@ int shim_getdents64(
 {
 #if defined(__NR_getdents64) &&	\
     defined(HAVE_SYSCALL)
-	return (int)syscall(__NR_getdents64, fd, dirp, count);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)syscall(__NR_getdents64, fd, dirp, count);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_GETDENTS64, t);
+	return ret;
 #else
 	return (int)shim_enosys(0, fd, dirp, count);
 #endif
@@ -390,10 +415,18 @@ int shim_getrandom(void *buff, size_t buflen, unsigned int flags)
 {
 #if defined(HAVE_SYS_RANDOM_H) &&	\
     defined(HAVE_GETRANDOM)
-	return (int)getrandom(buff, buflen, flags);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)getrandom(buff, buflen, flags);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_GETRANDOM, t);
+	return ret;
 #elif defined(__NR_getrandom) &&	\
       defined(HAVE_SYSCALL)
-	return (int)syscall(__NR_getrandom, buff, buflen, flags);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)syscall(__NR_getrandom, buff, buflen, flags);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_GETRANDOM, t);
+	return ret;
 #elif defined(__OpenBSD__) || defined(__APPLE__)
 	(void)flags;
 
@@ -1006,10 +1039,18 @@ int shim_statx(
 {
 	(void)memset(buffer, 0, sizeof(*buffer));
 #if defined(HAVE_STATX)
-	return statx(dfd, filename, flags, mask, (struct statx *)buffer);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = statx(dfd, filename, flags, mask, (struct statx *)buffer);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_STATX, t);
+	return ret;
 #elif defined(__NR_statx) &&	\
       defined(HAVE_SYSCALL)
-	return syscall(__NR_statx, dfd, filename, flags, mask, buffer);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)syscall(__NR_statx, dfd, filename, flags, mask, buffer);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_STATX, t);
+	return ret;
 #else
 	return shim_enosys(0, dfd, filename, flags, mask, buffer);
 #endif
@@ -1270,9 +1311,11 @@ size_t shim_strlcat(char *dst, const char *src, size_t len)
  */
 int shim_fsync(int fd)
 {
+	uint64_t t;
+	int ret;
+
 #if defined(__APPLE__) &&	\
     defined(F_FULLFSYNC)
-	int ret;
 
 	/*
 	 *  For APPLE Mac OS X try to use the full fsync fcntl
@@ -1283,7 +1326,11 @@ int shim_fsync(int fd)
 	if (ret == 0)
 		return 0;
 #endif
-	return fsync(fd);
+	t = stress_syscall_stats_start();
+	ret = fsync(fd);
+	stress_syscall_stats_end(STRESS_SYSCALL_FSYNC, t);
+
+	return ret;
 }
 
 /*
@@ -1300,10 +1347,18 @@ int shim_fdatasync(int fd)
 #if defined(__APPLE__)
 	extern int fdatasync(int fd);
 #endif
-	return fdatasync(fd);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = fdatasync(fd);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_FDATASYNC, t);
+	return ret;
 #elif defined(__NR_fdatasync) &&	\
       defined(HAVE_SYSCALL)
-	return (int)syscall(__NR_fdatasync, fd);
+	const uint64_t t = stress_syscall_stats_start();
+	const int ret = (int)syscall(__NR_fdatasync, fd);
+
+	stress_syscall_stats_end(STRESS_SYSCALL_FDATASYNC, t);
+	return ret;
 #else
 	return (int)shim_enosys(0, fd);
 #endif
@@ -52,11 +52,14 @@
 	MACRO(clock)		\
 	MACRO(clone)		\
 	MACRO(close)		\
+	MACRO(compactbench)	\
+	MACRO(connchurn)	\
 	MACRO(context)		\
 	MACRO(copy_file)	\
 	MACRO(cpu)		\
 	MACRO(cpu_online)	\
 	MACRO(crypt)		\
+	MACRO(cryptbench)	\
 	MACRO(cyclic)		\
 	MACRO(daemon)		\
 	MACRO(dccp)		\
@@ -80,10 +83,12 @@
 	MACRO(fallocate)	\
 	MACRO(fanotify)		\
 	MACRO(fault)		\
+	MACRO(faultbench)	\
 	MACRO(fcntl)		\
 	MACRO(fiemap)		\
 	MACRO(fifo)		\
 	MACRO(file_ioctl)	\
+	MACRO(filelockbench)	\
 	MACRO(filename)		\
 	MACRO(flock)		\
 	MACRO(fork)		\
@@ -98,9 +103,11 @@
 	MACRO(getdent)		\
 	MACRO(getrandom)	\
 	MACRO(goto)		\
+	MACRO(graph)		\
 	MACRO(gpu)		\
 	MACRO(handle)		\
 	MACRO(hash)		\
+	MACRO(hashtable)	\
 	MACRO(hdd)		\
 	MACRO(heapsort)		\
 	MACRO(hrtimers)		\
@@ -108,6 +115,7 @@
 	MACRO(icache)		\
 	MACRO(icmp_flood)	\
 	MACRO(idle_page)	\
+	MACRO(idlewake)		\
 	MACRO(inode_flags)	\
 	MACRO(inotify)		\
 	MACRO(io)		\
@@ -123,6 +131,7 @@
 	MACRO(key)		\
 	MACRO(kill)		\
 	MACRO(klog)		\
+	MACRO(ksmbench)		\
 	MACRO(kvm)		\
 	MACRO(l1cache)		\
 	MACRO(landlock)		\
@@ -133,7 +142,9 @@
 	MACRO(locka)		\
 	MACRO(lockbus)		\
 	MACRO(lockf)		\
+	MACRO(lockfree)		\
 	MACRO(lockofd)		\
+	MACRO(lockscale)	\
 	MACRO(longjmp)		\
 	MACRO(loop)		\
 	MACRO(lsearch)		\
@@ -149,6 +160,7 @@
 	MACRO(memrate)		\
 	MACRO(memthrash)	\
 	MACRO(mergesort)	\
+	MACRO(metamix)		\
 	MACRO(mincore)		\
 	MACRO(misaligned)	\
 	MACRO(mknod)		\
@@ -163,6 +175,7 @@
 	MACRO(mprotect)		\
 	MACRO(mq)		\
 	MACRO(mremap)		\
+	MACRO(mremapbench)	\
 	MACRO(msg)		\
 	MACRO(msync)		\
 	MACRO(msyncmany)	\
@@ -179,8 +192,10 @@
 	MACRO(oom_pipe)		\
 	MACRO(opcode)		\
 	MACRO(open)		\
+	MACRO(pagecachebench)	\
 	MACRO(pageswap)		\
 	MACRO(pci)		\
+	MACRO(percpu)		\
 	MACRO(personality)	\
 	MACRO(peterson)		\
 	MACRO(physpage)		\
@@ -191,11 +206,14 @@
 	MACRO(pkey)		\
 	MACRO(plugin)		\
 	MACRO(poll)		\
+	MACRO(pollbench)	\
 	MACRO(prctl)		\
 	MACRO(prefetch)		\
 	MACRO(procfs)		\
+	MACRO(pseudofsbench)	\
 	MACRO(pthread)		\
 	MACRO(ptrace)		\
+	MACRO(ptrchase)		\
 	MACRO(pty)		\
 	MACRO(qsort)		\
 	MACRO(quota)		\
@@ -233,11 +251,13 @@
 	MACRO(shellsort)	\
 	MACRO(shm)		\
 	MACRO(shm_sysv)		\
+	MACRO(shmbench)		\
 	MACRO(sigabrt)		\
 	MACRO(sigchld)		\
 	MACRO(sigfd)		\
 	MACRO(sigfpe)		\
 	MACRO(sigio)		\
+	MACRO(siglat)		\
 	MACRO(signal)		\
 	MACRO(signest)		\
 	MACRO(sigpending)	\
@@ -257,7 +277,9 @@
 	MACRO(sockpair)		\
 	MACRO(sockmany)		\
 	MACRO(softlockup)	\
+	MACRO(sortbench)	\
 	MACRO(spawn)		\
+	MACRO(spawnbench)	\
 	MACRO(sparsematrix)	\
 	MACRO(splice)		\
 	MACRO(stack)		\
@@ -265,6 +287,7 @@
 	MACRO(str)		\
 	MACRO(stream)		\
 	MACRO(swap)		\
+	MACRO(swapbench)	\
 	MACRO(switch)		\
 	MACRO(symlink)		\
 	MACRO(sync_file)	\
@@ -275,8 +298,10 @@
 	MACRO(sysfs)		\
 	MACRO(tee)		\
 	MACRO(timer)		\
+	MACRO(timerbench)	\
 	MACRO(timerfd)		\
 	MACRO(tlb_shootdown)	\
+	MACRO(tlbreach)		\
 	MACRO(tmpfs)		\
 	MACRO(touch)		\
 	MACRO(tree)		\
@@ -293,6 +318,7 @@
 	MACRO(utime)		\
 	MACRO(vdso)		\
 	MACRO(vecfp)		\
+	MACRO(vecfreq)		\
 	MACRO(vecmath)		\
 	MACRO(vecwide)		\
 	MACRO(verity)		\
@@ -306,10 +332,13 @@
 	MACRO(wait)		\
 	MACRO(watchdog)		\
 	MACRO(wcs)		\
+	MACRO(worksteal)	\
+	MACRO(writeback)	\
 	MACRO(x86syscall)	\
 	MACRO(xattr)		\
 	MACRO(yield)		\
 	MACRO(zero)		\
+	MACRO(zerocopy)		\
 	MACRO(zlib)		\
 	MACRO(zombie)
 
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-syscall-stats.h"
+
+stress_syscall_stat_t *g_syscall_stats;
+
+static const char * const stress_syscall_names[STRESS_SYSCALL_MAX] = {
+	"access",
+	"faccessat",
+	"fdatasync",
+	"fstat",
+	"fsync",
+	"futimens",
+	"getcwd",
+	"getdents",
+	"getdents64",
+	"getgroups",
+	"getrandom",
+	"getrlimit",
+	"gettid",
+	"gettimeofday",
+	"lstat",
+	"sched_yield",
+	"stat",
+	"statx",
+	"utimes",
+	"write",
+};
+
+/*
+ *  stress_syscall_stats_attach()
+ *	enable system call accounting into stats for the
+ *	current stressor process, NULL disables it
+ */
+void stress_syscall_stats_attach(stress_syscall_stat_t *stats)
+{
+	g_syscall_stats = (g_opt_flags & OPT_FLAGS_SYSCALL_STATS) ? stats : NULL;
+}
+
+/*
+ *  stress_syscall_stats_percentile()
+ *	upper bound in ticks of the log2 histogram bucket
+ *	holding the given percentile
+ */
+static uint64_t stress_syscall_stats_percentile(
+	const stress_syscall_stat_t *st,
+	const double percentile)
+{
+	const uint64_t threshold = (uint64_t)((double)st->count * percentile / 100.0);
+	uint64_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < STRESS_SYSCALL_BUCKETS; i++) {
+		sum += st->buckets[i];
+		if (sum > threshold)
+			break;
+	}
+	if (i >= STRESS_SYSCALL_BUCKETS)
+		return st->max;
+	return STRESS_MINIMUM(1ULL << i, st->max);
+}
+
+/*
+ *  stress_syscall_stats_dump()
+ *	report the per stressor system call counts and costs,
+ *	the instances of each stressor are summed
+ */
+void stress_syscall_stats_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+	const double ns_per_tick = g_clock.ns_per_tick;
+
+	if (!(g_opt_flags & OPT_FLAGS_SYSCALL_STATS))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_syscall_stat_t total[STRESS_SYSCALL_MAX];
+		const char *munged;
+		bool listed = false;
+		int32_t j;
+		size_t i, k;
+
+		if (!ss->stats)
+			continue;
+
+		(void)memset(total, 0, sizeof(total));
+		for (j = 0; j < ss->started_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			for (i = 0; i < STRESS_SYSCALL_MAX; i++) {
+				const stress_syscall_stat_t *st = &stats->syscall_stats[i];
+
+				total[i].count += st->count;
+				total[i].ticks += st->ticks;
+				if (st->max > total[i].max)
+					total[i].max = st->max;
+				for (k = 0; k < STRESS_SYSCALL_BUCKETS; k++)
+					total[i].buckets[k] += st->buckets[k];
+			}
+		}
+
+		munged = stress_munge_underscore(ss->stressor->name);
+		for (i = 0; i < STRESS_SYSCALL_MAX; i++) {
+			const stress_syscall_stat_t *st = &total[i];
+			double mean_ns, p50_ns, p99_ns, max_ns;
+
+			if (!st->count)
+				continue;
+			if (!header) {
+				pr_inf("syscall-stats: system call cost per stressor, "
+					"p50 and p99 are log2 bucket upper bounds:\n");
+				pr_inf("%-13s %-13s %12s %10s %10s %10s %10s\n",
+					"stressor", "syscall", "calls",
+					"mean ns", "p50 ns", "p99 ns", "max ns");
+				pr_yaml(yaml, "syscall-stats:\n");
+				header = true;
+			}
+			if (!listed) {
+				pr_yaml(yaml, "    - stressor: %s\n", munged);
+				pr_yaml(yaml, "      syscalls:\n");
+				listed = true;
+			}
+			mean_ns = ((double)st->ticks * ns_per_tick) / (double)st->count;
+			p50_ns = (double)stress_syscall_stats_percentile(st, 50.0) * ns_per_tick;
+			p99_ns = (double)stress_syscall_stats_percentile(st, 99.0) * ns_per_tick;
+			max_ns = (double)st->max * ns_per_tick;
+
+			pr_inf("%-13s %-13s %12" PRIu64 " %10.1f %10.1f %10.1f %10.1f\n",
+				munged, stress_syscall_names[i], st->count,
+				mean_ns, p50_ns, p99_ns, max_ns);
+			pr_yaml(yaml, "        - syscall: %s\n", stress_syscall_names[i]);
+			pr_yaml(yaml, "          calls: %" PRIu64 "\n", st->count);
+			pr_yaml(yaml, "          mean-ns: %f\n", mean_ns);
+			pr_yaml(yaml, "          p50-ns: %f\n", p50_ns);
+			pr_yaml(yaml, "          p99-ns: %f\n", p99_ns);
+			pr_yaml(yaml, "          max-ns: %f\n", max_ns);
+		}
+	}
+	if (header)
+		pr_yaml(yaml, "\n");
+	else
+		pr_inf("syscall-stats: no instrumented system calls were made\n");
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_SYSCALL_STATS_H
+#define CORE_SYSCALL_STATS_H
+
+#include "core-bitops.h"
+#include "core-clock.h"
+
+/* per process system call stats of the running instance, NULL = disabled */
+extern stress_syscall_stat_t *g_syscall_stats;
+
+/*
+ *  stress_syscall_stats_start()
+ *	timestamp the start of an instrumented system call,
+ *	just a pointer check when --syscall-stats is not enabled
+ */
+static inline uint64_t ALWAYS_INLINE stress_syscall_stats_start(void)
+{
+	if (LIKELY(!g_syscall_stats))
+		return 0;
+	return stress_clock_ticks();
+}
+
+/*
+ *  stress_syscall_stats_end()
+ *	account the count and cost of an instrumented system call
+ *	that started at time t
+ */
+static inline void ALWAYS_INLINE stress_syscall_stats_end(
+	const stress_syscall_id_t id,
+	const uint64_t t)
+{
+	stress_syscall_stat_t *st;
+	uint64_t delta;
+	size_t bucket;
+
+	if (LIKELY(!g_syscall_stats))
+		return;
+	delta = stress_clock_ticks() - t;
+	bucket = delta ? (size_t)stress_msb64(delta) + 1 : 0;
+	if (bucket >= STRESS_SYSCALL_BUCKETS)
+		bucket = STRESS_SYSCALL_BUCKETS - 1;
+
+	st = &g_syscall_stats[id];
+	st->count++;
+	st->ticks += delta;
+	if (delta > st->max)
+		st->max = delta;
+	st->buckets[bucket]++;
+}
+
+extern void stress_syscall_stats_attach(stress_syscall_stat_t *stats);
+extern void stress_syscall_stats_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
@@ -0,0 +1,767 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-placement.h"
+#include "core-target.h"
+
+#define STRESS_TARGET_PERIOD	(0.01)		/* throttle run + sleep period, seconds */
+#define STRESS_TARGET_INTERVAL	(0.5)		/* controller update interval, seconds */
+#define STRESS_TARGET_PROBE	(0.05)		/* unthrottled rate probe interval, seconds */
+#define STRESS_TARGET_GAIN	(0.5)		/* fraction of the error corrected per update */
+#define STRESS_TARGET_DUTY_MIN	(0.001)		/* smallest run duty cycle */
+#define STRESS_TARGET_PPM	(1000000.0)
+#define STRESS_TARGET_OPS_MIN	(4)		/* fewest bogo-ops in one rate measurement */
+#define STRESS_TARGET_WINDOW_MAX (4.0)		/* longest rate measurement, seconds */
+#define STRESS_TARGET_RUN_MAX	(1.0)		/* most run time charged to one sleep, seconds */
+#define STRESS_TARGET_SLEEP_SLICE (0.1)		/* throttle sleeps re-check the throttle this often */
+#define STRESS_TARGET_PROFILE_INTERVAL (0.1)	/* profile update interval, seconds */
+#define STRESS_TARGET_PHASES_MAX (64)		/* maximum job file profile phases */
+#define STRESS_TARGET_MIX_MAX	(16)		/* maximum job file mix components */
+#define STRESS_TARGET_MIX_PERIOD (1.0)		/* mix rotation period, seconds */
+
+#define PROFILE_STEP		(0)	/* hold a level */
+#define PROFILE_RAMP		(1)	/* linear ramp between two levels */
+#define PROFILE_SINE		(2)	/* sine wave between two levels */
+#define PROFILE_BURST		(3)	/* square wave bursts between two levels */
+
+/* controller state of one stressor */
+typedef struct {
+	uint64_t counter;		/* bogo-ops at start of measurement */
+	double	time;			/* time at start of measurement */
+	double	duty;			/* run duty cycle 0..1 */
+	bool	running;		/* instances were running at last update */
+} stress_target_state_t;
+
+/* one phase of a job file load profile */
+typedef struct {
+	int	type;			/* PROFILE_* */
+	double	duration;		/* phase duration, seconds */
+	double	from;			/* start, minimum or base level */
+	double	to;			/* end, maximum or peak level */
+	double	period;			/* sine period or burst on time, seconds */
+	double	off;			/* burst off time, seconds */
+	bool	percent;		/* levels are % load, else instances */
+} stress_target_phase_t;
+
+/* one stressor of a job file mix */
+typedef struct {
+	char	name[64];		/* stressor name */
+	uint32_t weight;		/* share of the rotation period */
+	stress_stressor_t *ss;		/* stressor, NULL if not running */
+} stress_target_mix_t;
+
+static const char * const profile_types[] = {
+	"step",
+	"ramp",
+	"sine",
+	"burst",
+};
+
+static stress_target_phase_t target_phases[STRESS_TARGET_PHASES_MAX];
+static size_t target_n_phases = 0;	/* number of profile phases */
+static stress_target_mix_t target_mix[STRESS_TARGET_MIX_MAX];
+static size_t target_n_mix = 0;		/* number of mix components */
+static uint32_t target_mix_weight = 0;	/* sum of the mix weights */
+static uint32_t target_cpu = 0;		/* target CPU utilization %, 0 = off */
+static uint64_t target_ops = 0;		/* target bogo-ops/sec per stressor, 0 = off */
+static pid_t target_pid;		/* controller process pid */
+
+/*
+ *  stress_set_target_cpu()
+ *	set the --target-cpu system wide CPU utilization percentage
+ */
+int stress_set_target_cpu(const char *const opt)
+{
+	const int32_t val = stress_get_int32(opt);
+
+	if ((val < 1) || (val > 100)) {
+		(void)fprintf(stderr, "target-cpu must in the range 1 to 100.\n");
+		_exit(EXIT_FAILURE);
+	}
+	target_cpu = (uint32_t)val;
+	return 0;
+}
+
+/*
+ *  stress_set_target_ops()
+ *	set the --target-ops bogo-ops per second rate of each stressor
+ */
+int stress_set_target_ops(const char *const opt)
+{
+	static const stress_scale_t scales[] = {
+		{ 'k',	1000ULL },
+		{ 'm',	1000000ULL },
+		{ 'g',	1000000000ULL },
+		{ 0,	0 },
+	};
+
+	target_ops = stress_get_uint64_scale(opt, scales, "rate");
+	if (target_ops < 1) {
+		(void)fprintf(stderr, "target-ops must be at least 1 bogo-op per second.\n");
+		_exit(EXIT_FAILURE);
+	}
+	return 0;
+}
+
+/*
+ *  stress_target_parse_level()
+ *	parse a profile level, either a number of instances
+ *	or a percentage of full load with a % suffix
+ */
+static double stress_target_parse_level(const char *str, bool *percent)
+{
+	const size_t len = strlen(str);
+	char *end;
+	double val;
+
+	val = strtod(str, &end);
+	*percent = (len > 1) && (str[len - 1] == '%');
+	if ((end == str) || (*end && !(*percent && (end == str + len - 1))) || (val < 0.0) ||
+	    (*percent && (val > 100.0))) {
+		(void)fprintf(stderr, "Invalid profile level '%s', expecting instances "
+			"or a percentage of load\n", str);
+		longjmp(g_error_env, 1);
+	}
+	return *percent ? val / 100.0 : val;
+}
+
+/*
+ *  stress_set_target_profile()
+ *	add a phase to the load profile from a job file line:
+ *	  profile step  T level
+ *	  profile ramp  T from to
+ *	  profile sine  T min max period
+ *	  profile burst T base peak on off
+ *	where levels are a number of running instances or a
+ *	percentage of full load and T, period, on and off are times
+ */
+int stress_set_target_profile(const int argc, char **argv)
+{
+	static const int args[] = { 3, 4, 5, 6 };
+	stress_target_phase_t *phase;
+	bool percent, percent_to;
+	size_t i;
+
+	if (argc < 1) {
+		(void)fprintf(stderr, "profile requires a step, ramp, sine or burst phase\n");
+		return -1;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(profile_types); i++) {
+		if (!strcmp(argv[0], profile_types[i]))
+			break;
+	}
+	if (i >= SIZEOF_ARRAY(profile_types)) {
+		(void)fprintf(stderr, "profile phase '%s' must be one of: step ramp sine burst\n",
+			argv[0]);
+		return -1;
+	}
+	if (argc != args[i]) {
+		(void)fprintf(stderr, "profile %s expects %d arguments\n",
+			profile_types[i], args[i] - 1);
+		return -1;
+	}
+	if (target_n_phases >= STRESS_TARGET_PHASES_MAX) {
+		(void)fprintf(stderr, "profile is limited to %d phases\n",
+			STRESS_TARGET_PHASES_MAX);
+		return -1;
+	}
+
+	phase = &target_phases[target_n_phases];
+	(void)memset(phase, 0, sizeof(*phase));
+	phase->type = (int)i;
+	phase->duration = (double)stress_get_uint64_time(argv[1]);
+	phase->from = stress_target_parse_level(argv[2], &percent);
+	phase->to = phase->from;
+	phase->percent = percent;
+	if (argc > 3) {
+		phase->to = stress_target_parse_level(argv[3], &percent_to);
+		if (percent_to != percent) {
+			(void)fprintf(stderr, "profile levels must both be instances or "
+				"both be percentages\n");
+			return -1;
+		}
+	}
+	if (argc > 4)
+		phase->period = (double)stress_get_uint64_time(argv[4]);
+	if (argc > 5)
+		phase->off = (double)stress_get_uint64_time(argv[5]);
+	if ((phase->duration <= 0.0) ||
+	    ((phase->type == PROFILE_SINE) && (phase->period <= 0.0)) ||
+	    ((phase->type == PROFILE_BURST) && (phase->period + phase->off <= 0.0))) {
+		(void)fprintf(stderr, "profile %s times must be greater than zero\n",
+			profile_types[i]);
+		return -1;
+	}
+	target_n_phases++;
+	return 0;
+}
+
+/*
+ *  stress_set_target_mix()
+ *	add a stressor and its weight to the job file mix,
+ *	the weights are the share of each rotation period
+ *	that the stressor runs on each CPU
+ */
+int stress_set_target_mix(const char *name, const uint32_t weight)
+{
+	stress_target_mix_t *mix;
+	size_t i;
+
+	if (!weight) {
+		(void)fprintf(stderr, "mix weight of %s must be greater than zero\n", name);
+		return -1;
+	}
+	for (i = 0; i < target_n_mix; i++) {
+		if (!strcmp(target_mix[i].name, name)) {
+			(void)fprintf(stderr, "mix stressor %s is used more than once\n", name);
+			return -1;
+		}
+	}
+	if (target_n_mix >= STRESS_TARGET_MIX_MAX) {
+		(void)fprintf(stderr, "mix is limited to %d stressors\n",
+			STRESS_TARGET_MIX_MAX);
+		return -1;
+	}
+	mix = &target_mix[target_n_mix];
+	(void)shim_strlcpy(mix->name, name, sizeof(mix->name));
+	mix->weight = weight;
+	mix->ss = NULL;
+	target_mix_weight += weight;
+	target_n_mix++;
+	return 0;
+}
+
+/*
+ *  stress_target_mix_find()
+ *	find the mix component of a stressor, NULL if not in the mix
+ */
+static stress_target_mix_t *stress_target_mix_find(const stress_stressor_t *ss)
+{
+	const char *name = stress_munge_underscore(ss->stressor->name);
+	size_t i;
+
+	for (i = 0; i < target_n_mix; i++) {
+		if (!strcmp(target_mix[i].name, name))
+			return &target_mix[i];
+	}
+	return NULL;
+}
+
+/*
+ *  stress_target_mix_cpu()
+ *	the CPU to pin instance j of a mix stressor to so that instance
+ *	j of every mix stressor shares the same CPU, -1 if the stressor
+ *	is not in the mix or CPU affinity is not available
+ */
+int32_t stress_target_mix_cpu(const stress_stressor_t *ss, const int32_t instance)
+{
+#if defined(HAVE_SCHED_GETAFFINITY)
+	cpu_set_t mask;
+	int32_t cpu, n;
+	const int32_t cpus = stress_get_processors_configured();
+
+	if (!target_n_mix || !stress_target_mix_find(ss))
+		return -1;
+	cpu = stress_placement_cpu(instance);
+	if (cpu >= 0)
+		return cpu;
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0)
+		return -1;
+	if (!CPU_COUNT(&mask))
+		return -1;
+	n = instance % CPU_COUNT(&mask);
+	for (cpu = 0; cpu < cpus; cpu++) {
+		if (CPU_ISSET(cpu, &mask) && (n-- == 0))
+			return cpu;
+	}
+	return -1;
+#else
+	(void)ss;
+	(void)instance;
+
+	return -1;
+#endif
+}
+
+/*
+ *  stress_throttle()
+ *	called from keep_stressing() when the controller has set a
+ *	throttle on the instance; the instance runs for the duty cycle
+ *	portion of each STRESS_TARGET_PERIOD and then sleeps in
+ *	proportion to the time it ran since its last sleep, so bogo-ops
+ *	that take longer than a period are throttled too
+ */
+void stress_throttle(const stress_args_t *args)
+{
+	stress_counter_info_t *ci = args->ci;
+	const double now = stress_time_now();
+	const double duty = 1.0 - (STRESS_MINIMUM((double)ci->throttle, STRESS_TARGET_PPM) / STRESS_TARGET_PPM);
+	double run, slept = 0.0;
+
+	/* first call of the instance */
+	if (ci->throttle_t_run <= 0.0) {
+		ci->throttle_t_run = now;
+		return;
+	}
+	run = now - ci->throttle_t_run;
+	if (run < STRESS_TARGET_PERIOD * duty)
+		return;
+	/* a stale start from before the throttle was last set */
+	run = STRESS_MINIMUM(run, STRESS_TARGET_RUN_MAX);
+
+	/*
+	 *  Sleep in slices and re-read the throttle so the controller
+	 *  can change it during a long sleep, a throttle of the whole
+	 *  period is a pause by a load profile until the throttle changes
+	 */
+	while (keep_stressing_flag()) {
+		const uint32_t throttle = ci->throttle;
+		double sleep;
+
+		if (!throttle)
+			break;
+		if (throttle >= (uint32_t)STRESS_TARGET_PPM) {
+			sleep = STRESS_TARGET_SLEEP_SLICE;
+		} else {
+			const double f = (double)throttle / STRESS_TARGET_PPM;
+
+			sleep = (run * f / (1.0 - f)) - slept;
+			if (sleep <= 0.0)
+				break;
+			sleep = STRESS_MINIMUM(sleep, STRESS_TARGET_SLEEP_SLICE);
+		}
+		(void)shim_nanosleep_uint64((uint64_t)(sleep * STRESS_NANOSECOND));
+		slept += sleep;
+	}
+	ci->throttle_t_run = stress_time_now();
+}
+
+/*
+ *  stress_target_cpu_util()
+ *	system wide CPU utilization in percent since the previous call,
+ *	returns -1.0 if /proc/stat can't be read
+ */
+static double stress_target_cpu_util(uint64_t *prev_busy, uint64_t *prev_total)
+{
+	uint64_t user, nice, sys, idle, iowait, irq, softirq, steal;
+	uint64_t busy, total, d_busy, d_total;
+	char buffer[256];
+
+	if (system_read("/proc/stat", buffer, sizeof(buffer)) < 0)
+		return -1.0;
+	if (sscanf(buffer, "cpu %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+		   " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+		   &user, &nice, &sys, &idle, &iowait, &irq, &softirq, &steal) != 8)
+		return -1.0;
+
+	busy = user + nice + sys + irq + softirq + steal;
+	total = busy + idle + iowait;
+	d_busy = busy - *prev_busy;
+	d_total = total - *prev_total;
+	*prev_busy = busy;
+	*prev_total = total;
+
+	return d_total ? 100.0 * (double)d_busy / (double)d_total : -1.0;
+}
+
+/*
+ *  stress_target_duty()
+ *	scale the duty cycle towards the target; throughput and CPU
+ *	load are roughly proportional to the run duty cycle so a
+ *	damped multiplicative correction converges without knowing
+ *	the unthrottled rate
+ */
+static double stress_target_duty(const double duty, const double target, const double measured)
+{
+	double ratio, new_duty;
+
+	ratio = (measured > 0.0) ? target / measured : 4.0;
+	ratio = STRESS_MINIMUM(STRESS_MAXIMUM(ratio, 0.25), 4.0);
+	new_duty = duty * (1.0 + STRESS_TARGET_GAIN * (ratio - 1.0));
+
+	return STRESS_MINIMUM(STRESS_MAXIMUM(new_duty, STRESS_TARGET_DUTY_MIN), 1.0);
+}
+
+/*
+ *  stress_target_set_throttle()
+ *	set the throttle of all the instances of a stressor
+ */
+static void stress_target_set_throttle(stress_stressor_t *ss, const double duty)
+{
+	const uint32_t throttle = (duty >= 1.0) ? 0 :
+		(uint32_t)((1.0 - duty) * STRESS_TARGET_PPM);
+	int32_t j;
+
+	for (j = 0; j < ss->num_instances; j++)
+		ss->stats[j]->ci.throttle = throttle;
+}
+
+/*
+ *  stress_target_profile_level()
+ *	load level of a profile phase t seconds into the phase
+ */
+static double stress_target_profile_level(const stress_target_phase_t *phase, const double t)
+{
+	switch (phase->type) {
+	case PROFILE_RAMP:
+		return phase->from + (phase->to - phase->from) * t / phase->duration;
+	case PROFILE_SINE:
+		/* starts at the minimum, like a diurnal load from midnight */
+		return phase->from + (phase->to - phase->from) *
+			(1.0 - cos(2.0 * M_PI * t / phase->period)) / 2.0;
+	case PROFILE_BURST:
+		return (fmod(t, phase->period + phase->off) < phase->period) ?
+			phase->to : phase->from;
+	default:
+		return phase->from;
+	}
+}
+
+/*
+ *  stress_target_profile_set()
+ *	set the throttles of a stressor for a profile level; a
+ *	percentage level sets the duty cycle of all the instances,
+ *	an instance level runs that many instances and parks the rest
+ *	with the fractional part as the duty cycle of the next one
+ */
+static void stress_target_profile_set(
+	stress_stressor_t *ss,
+	const double level,
+	const bool percent)
+{
+	int32_t j;
+
+	if (percent) {
+		stress_target_set_throttle(ss, level);
+		return;
+	}
+	for (j = 0; j < ss->num_instances; j++) {
+		const double duty = STRESS_MINIMUM(STRESS_MAXIMUM(level - (double)j, 0.0), 1.0);
+
+		ss->stats[j]->ci.throttle = (uint32_t)((1.0 - duty) * STRESS_TARGET_PPM);
+	}
+}
+
+/*
+ *  stress_target_profile()
+ *	run the job file load profile phases, the final
+ *	level is held once all the phases have completed
+ */
+static void stress_target_profile(stress_stressor_t *stressors_list)
+{
+	const double time_start = stress_time_now();
+	double phase_start = time_start;
+	size_t n = 0, reported = ~(size_t)0;
+
+	while (keep_stressing_flag()) {
+		const stress_target_phase_t *phase;
+		stress_stressor_t *ss;
+		double t, level;
+
+		while ((n < target_n_phases - 1) &&
+		       (stress_time_now() - phase_start >= target_phases[n].duration)) {
+			phase_start += target_phases[n].duration;
+			n++;
+		}
+		phase = &target_phases[n];
+		t = STRESS_MINIMUM(stress_time_now() - phase_start, phase->duration);
+		level = stress_target_profile_level(phase, t);
+
+		if (n != reported) {
+			pr_inf("profile: %.2fs phase %zu, %s over %.2fs\n",
+				phase_start - time_start, n + 1,
+				profile_types[phase->type], phase->duration);
+			reported = n;
+		}
+		for (ss = stressors_list; ss; ss = ss->next) {
+			if (ss->stats)
+				stress_target_profile_set(ss, level, phase->percent);
+		}
+		(void)shim_nanosleep_uint64((uint64_t)(STRESS_TARGET_PROFILE_INTERVAL * STRESS_NANOSECOND));
+	}
+}
+
+/*
+ *  stress_target_mix()
+ *	rotate the mix stressors on each CPU, instance j of each mix
+ *	stressor runs for its weighted share of every rotation period
+ *	while the other instances on that CPU are paused; the rotations
+ *	of the CPUs are staggered so the CPUs run a heterogeneous mix
+ */
+static void stress_target_mix(void)
+{
+	const double time_start = stress_time_now();
+	int32_t j, instances = 0;
+	size_t i, *active;
+
+	for (i = 0; i < target_n_mix; i++) {
+		if (target_mix[i].ss)
+			instances = STRESS_MAXIMUM(instances, target_mix[i].ss->num_instances);
+	}
+	if (!instances)
+		return;
+	active = malloc((size_t)instances * sizeof(*active));
+	if (!active) {
+		pr_err("mix: cannot allocate rotation state\n");
+		return;
+	}
+	for (j = 0; j < instances; j++)
+		active[j] = ~(size_t)0;
+
+	while (keep_stressing_flag()) {
+		const double t = (stress_time_now() - time_start) / STRESS_TARGET_MIX_PERIOD;
+
+		for (j = 0; j < instances; j++) {
+			const double offset = (double)j / (double)instances;
+			const double slot = fmod(t + offset, 1.0) * (double)target_mix_weight;
+			uint32_t weight = 0;
+			size_t k;
+
+			for (k = 0; k < target_n_mix - 1; k++) {
+				weight += target_mix[k].weight;
+				if (slot < (double)weight)
+					break;
+			}
+			if (k == active[j])
+				continue;
+			for (i = 0; i < target_n_mix; i++) {
+				stress_stressor_t *ss = target_mix[i].ss;
+
+				if (ss && (j < ss->num_instances))
+					ss->stats[j]->ci.throttle = (i == k) ? 0 :
+						(uint32_t)STRESS_TARGET_PPM;
+			}
+			active[j] = k;
+		}
+		(void)shim_nanosleep_uint64((uint64_t)(STRESS_TARGET_PERIOD * STRESS_NANOSECOND));
+	}
+	free(active);
+}
+
+/*
+ *  stress_target_mix_dump()
+ *	report the throughput of each mix stressor while it
+ *	was running, i.e. scaled by its share of the rotation
+ */
+static void stress_target_mix_dump(void)
+{
+	size_t i;
+
+	pr_inf("mix: %-15s %6s %15s %15s\n", "stressor", "share", "bogo-ops", "bogo-ops/s");
+	for (i = 0; i < target_n_mix; i++) {
+		const stress_target_mix_t *mix = &target_mix[i];
+		const double share = (double)mix->weight / (double)target_mix_weight;
+		uint64_t counter = 0;
+		double run_time = 0.0;
+		int32_t j;
+
+		if (!mix->ss || !mix->ss->stats)
+			continue;
+		for (j = 0; j < mix->ss->started_instances; j++) {
+			const stress_stats_t *const stats = mix->ss->stats[j];
+
+			counter += stats->ci.counter;
+			run_time += (stats->finish - stats->start) * share;
+		}
+		pr_inf("mix: %-15s %5.1f%% %15" PRIu64 " %15.2f\n",
+			mix->name, share * 100.0, counter,
+			run_time > 0.0 ? (double)counter / run_time : 0.0);
+	}
+}
+
+/*
+ *  stress_target_start()
+ *	start a process that adjusts the throttle of each stressor
+ *	every STRESS_TARGET_INTERVAL seconds to hold the aggregate
+ *	bogo-ops rate of each stressor, or the system wide CPU
+ *	utilization, at the requested target
+ */
+void stress_target_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	stress_target_state_t *state;
+	size_t n_stressors = 0, n;
+	uint64_t prev_busy = 0, prev_total = 0;
+	double cpu_duty, interval;
+
+	if (!target_cpu && !target_ops && !target_n_phases && !target_n_mix)
+		return;
+	if (target_n_mix) {
+		if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
+			pr_inf("mix: the stressors of a mix only rotate when run in parallel, ignoring the mix\n");
+			target_n_mix = 0;
+			return;
+		}
+		if (target_n_phases || target_cpu || target_ops) {
+			pr_err("target: a job file mix overrides load profiles, --target-cpu and --target-ops\n");
+			target_n_phases = 0;
+			target_cpu = 0;
+			target_ops = 0;
+		}
+		for (ss = stressors_list; ss; ss = ss->next) {
+			stress_target_mix_t *mix = stress_target_mix_find(ss);
+
+			if (mix && ss->num_instances && ss->stats)
+				mix->ss = ss;
+		}
+		pr_inf("mix: rotating %zu stressors per CPU every %.2fs\n",
+			target_n_mix, STRESS_TARGET_MIX_PERIOD);
+		target_pid = fork();
+		if ((target_pid < 0) || (target_pid > 0))
+			return;
+		stress_parent_died_alarm();
+		stress_set_proc_name("stress-ng-mix");
+		stress_target_mix();
+		_exit(0);
+	}
+	if (target_n_phases && (target_cpu || target_ops)) {
+		pr_err("target: a job file load profile overrides --target-cpu and --target-ops\n");
+		target_cpu = 0;
+		target_ops = 0;
+	}
+	if (target_cpu && target_ops) {
+		pr_err("target: only one of --target-cpu and --target-ops can be used, "
+			"ignoring --target-ops\n");
+		target_ops = 0;
+	}
+	if (target_n_phases)
+		pr_inf("profile: running a %zu phase load profile\n", target_n_phases);
+	else if (target_cpu)
+		pr_inf("target: throttling stressors to %" PRIu32 "%% CPU utilization\n",
+			target_cpu);
+	else
+		pr_inf("target: throttling each stressor to %" PRIu64 " bogo-ops per second\n",
+			target_ops);
+
+	target_pid = fork();
+	if ((target_pid < 0) || (target_pid > 0))
+		return;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stress-ng-target");
+
+	if (target_n_phases) {
+		stress_target_profile(stressors_list);
+		_exit(0);
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n_stressors++;
+
+	state = calloc(n_stressors ? n_stressors : 1, sizeof(*state));
+	if (!state) {
+		pr_err("target: cannot allocate controller state\n");
+		_exit(EXIT_NO_RESOURCE);
+	}
+
+	/* CPU targets start at the target, rate targets unthrottled */
+	cpu_duty = (double)target_cpu / 100.0;
+	for (n = 0; n < n_stressors; n++)
+		state[n].duty = target_cpu ? cpu_duty : 1.0;
+	(void)stress_target_cpu_util(&prev_busy, &prev_total);
+	interval = target_cpu ? STRESS_TARGET_INTERVAL : STRESS_TARGET_PROBE;
+
+	while (keep_stressing_flag()) {
+		double time_now, util = -1.0;
+		bool probing = false;
+
+		(void)shim_nanosleep_uint64((uint64_t)(interval * STRESS_NANOSECOND));
+		time_now = stress_time_now();
+
+		if (target_cpu) {
+			util = stress_target_cpu_util(&prev_busy, &prev_total);
+			if (util >= 0.0) {
+				cpu_duty = stress_target_duty(cpu_duty, (double)target_cpu, util);
+				pr_dbg("target: %.1f%% CPU utilization, run duty cycle %.1f%%\n",
+					util, cpu_duty * 100.0);
+			}
+		}
+
+		for (n = 0, ss = stressors_list; ss; ss = ss->next, n++) {
+			stress_target_state_t *st = &state[n];
+			uint64_t counter = 0;
+			bool running = false;
+			int32_t j;
+
+			if (!ss->stats)
+				continue;
+			for (j = 0; j < ss->num_instances; j++) {
+				const stress_stats_t *const stats = ss->stats[j];
+
+				counter += stats->ci.counter;
+				running |= (stats->pid && (stats->start > 0.0));
+			}
+
+			if (target_cpu) {
+				st->duty = cpu_duty;
+			} else if (running && st->running) {
+				/*
+				 *  slow bogo-ops land in an interval in bursts, so
+				 *  measure over enough ops to give a usable rate
+				 */
+				const uint64_t ops = counter - st->counter;
+				const double window = time_now - st->time;
+
+				if ((window > 0.0) &&
+				    ((ops >= STRESS_TARGET_OPS_MIN) || (window >= STRESS_TARGET_WINDOW_MAX))) {
+					const double rate = (double)ops / window;
+
+					/* an unthrottled rate gives the duty directly */
+					if ((st->duty >= 1.0) && (rate > (double)target_ops))
+						st->duty = STRESS_MAXIMUM((double)target_ops / rate, STRESS_TARGET_DUTY_MIN);
+					else
+						st->duty = stress_target_duty(st->duty, (double)target_ops, rate);
+					pr_dbg("target: %s %.2f bogo-ops/sec, run duty cycle %.1f%%\n",
+						stress_munge_underscore(ss->stressor->name),
+						rate, st->duty * 100.0);
+					st->counter = counter;
+					st->time = time_now;
+				}
+			} else {
+				st->counter = counter;
+				st->time = time_now;
+			}
+			st->running = running;
+			if (running)
+				stress_target_set_throttle(ss, st->duty);
+			probing |= (st->duty >= 1.0);
+		}
+		/* keep unthrottled stressors short of bursting at full speed */
+		interval = (probing && !target_cpu) ? STRESS_TARGET_PROBE : STRESS_TARGET_INTERVAL;
+	}
+	free(state);
+	_exit(0);
+}
+
+/*
+ *  stress_target_stop()
+ *	stop the throttle controller process
+ */
+void stress_target_stop(void)
+{
+	if (target_pid > 0) {
+		int status;
+
+		(void)kill(target_pid, SIGKILL);
+		(void)waitpid(target_pid, &status, 0);
+		target_pid = 0;
+	}
+	if (target_n_mix)
+		stress_target_mix_dump();
+}
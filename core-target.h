@@ -0,0 +1,31 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_TARGET_H
+#define CORE_TARGET_H
+
+/* Load control, --target-cpu, --target-ops and job file profiles and mixes */
+extern int stress_set_target_cpu(const char *const opt);
+extern int stress_set_target_ops(const char *const opt);
+extern int stress_set_target_profile(const int argc, char **argv);
+extern int stress_set_target_mix(const char *name, const uint32_t weight);
+extern int32_t stress_target_mix_cpu(const stress_stressor_t *ss, const int32_t instance);
+extern void stress_target_start(stress_stressor_t *stressors_list);
+extern void stress_target_stop(void);
+
+#endif
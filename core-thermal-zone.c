@@ -236,7 +236,7 @@ void stress_tz_dump(FILE *yaml, stress_stressor_t *stressors_list)
 
 			for (j = 0; j < ss->started_instances; j++) {
 				const uint64_t temp =
-					ss->stats[j]->tz.tz_stat[tz_info->index].temperature;
+					ss->stats[j]->tz->tz_stat[tz_info->index].temperature;
 				/* Avoid crazy temperatures. e.g. > 250 C */
 				if (temp <= 250000) {
 					total += temp;
@@ -23,8 +23,6 @@
 #if defined(__linux__) &&	\
     defined(HAVE_PTRACE)
 
-#define KSM_RUN_MERGE		"1"
-
 static pid_t thrash_pid;
 static pid_t parent_pid;
 static volatile bool thrash_run;
@@ -289,7 +287,7 @@ static inline void stress_merge_memory(void)
 	if (!thrash_run)
 		return;
 
-	VOID_RET(ssize_t, system_write("/proc/sys/mm/ksm/run", KSM_RUN_MERGE, 1));
+	VOID_RET(int, stress_ksm_run(KSM_RUN_MERGE));
 #endif
 }
 
@@ -418,3 +416,32 @@ int stress_pagein_self(const char *name)
 	return 0;
 }
 #endif
+
+/*
+ *  stress_ksm_run()
+ *	set the ksm run mode, returns the previous mode or -1
+ *	if ksm is not available or the mode cannot be set
+ */
+int stress_ksm_run(const int mode)
+{
+#if defined(__linux__)
+	static const char path[] = "/sys/kernel/mm/ksm/run";
+	char buf[16];
+	int old_mode;
+
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read(path, buf, sizeof(buf) - 1) < 0)
+		return -1;
+	old_mode = atoi(buf);
+	if (old_mode != mode) {
+		(void)snprintf(buf, sizeof(buf), "%d", mode);
+		if (system_write(path, buf, strlen(buf)) < 0)
+			return -1;
+	}
+	return old_mode;
+#else
+	(void)mode;
+
+	return -1;
+#endif
+}
@@ -23,4 +23,10 @@
 extern int  stress_thrash_start(void);
 extern void stress_thrash_stop(void);
 
+/* KSM run modes, see /sys/kernel/mm/ksm/run */
+#define KSM_RUN_STOP		(0)
+#define KSM_RUN_MERGE		(1)
+
+extern int stress_ksm_run(const int mode);
+
 #endif
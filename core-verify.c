@@ -0,0 +1,143 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-verify.h"
+
+#define VERIFY_SAMPLE_MAX	(1000000000)
+
+stress_verify_state_t g_verify;
+
+/*
+ *  stress_set_verify_sample()
+ *	set --verify-sample N, verify 1 in N ops, implies --verify
+ */
+int stress_set_verify_sample(const char *opt)
+{
+	uint32_t verify_sample;
+
+	verify_sample = stress_get_uint32(opt);
+	stress_check_range("verify-sample", (uint64_t)verify_sample, 1, VERIFY_SAMPLE_MAX);
+	g_opt_flags |= (OPT_FLAGS_VERIFY | PR_FAIL);
+	return stress_set_setting_global("verify-sample", TYPE_ID_UINT32, &verify_sample);
+}
+
+/*
+ *  stress_set_verify_sample_mode()
+ *	set --verify-sample-mode stride | random
+ */
+int stress_set_verify_sample_mode(const char *opt)
+{
+	bool verify_sample_random;
+
+	if (!strcmp(opt, "stride")) {
+		verify_sample_random = false;
+	} else if (!strcmp(opt, "random")) {
+		verify_sample_random = true;
+	} else {
+		(void)fprintf(stderr, "verify-sample-mode must be one of: stride random\n");
+		return -1;
+	}
+	return stress_set_setting_global("verify-sample-random", TYPE_ID_BOOL, &verify_sample_random);
+}
+
+/*
+ *  stress_verify_init()
+ *	reset the sampling state of a stressor instance, the first
+ *	verified op is randomized so instances don't check in step
+ */
+void stress_verify_init(void)
+{
+	uint32_t verify_sample = 0;
+	bool verify_sample_random = false;
+
+	(void)stress_get_setting("verify-sample", &verify_sample);
+	(void)stress_get_setting("verify-sample-random", &verify_sample_random);
+
+	g_verify.sample = verify_sample;
+	g_verify.random = verify_sample_random;
+	g_verify.ops = 0;
+	g_verify.countdown = (verify_sample > 1) ? 1 + stress_mwc32() % verify_sample : 1;
+}
+
+/*
+ *  stress_verify_next()
+ *	set the number of ops until the next verified op, a fixed
+ *	stride of N or a uniformly random gap of 1..2N - 1 that
+ *	also averages 1 in N but can't alias with periodic faults
+ */
+void stress_verify_next(void)
+{
+	if (g_verify.sample <= 1)
+		g_verify.countdown = 1;
+	else if (g_verify.random)
+		g_verify.countdown = 1 + stress_mwc32() % ((2 * g_verify.sample) - 1);
+	else
+		g_verify.countdown = g_verify.sample;
+}
+
+/*
+ *  stress_verify_dump()
+ *	report the number of verified ops against bogo ops of the
+ *	stressors that sample their verification
+ */
+void stress_verify_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+	uint32_t verify_sample = 0;
+	bool verify_sample_random = false;
+
+	if (!(g_opt_flags & OPT_FLAGS_VERIFY))
+		return;
+
+	(void)stress_get_setting("verify-sample", &verify_sample);
+	(void)stress_get_setting("verify-sample-random", &verify_sample_random);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t verified = 0, counter = 0;
+		const char *munged;
+		int32_t j;
+
+		if (!ss->stats)
+			continue;
+		for (j = 0; j < ss->started_instances; j++) {
+			verified += ss->stats[j]->verify_ops;
+			counter += ss->stats[j]->ci.counter;
+		}
+		if (!verified)
+			continue;
+
+		if (!header) {
+			if (verify_sample > 1)
+				pr_inf("verify: sampled 1 in %" PRIu32 " ops, %s\n",
+					verify_sample, verify_sample_random ? "random" : "strided");
+			pr_inf("%-13s %14s %14s\n", "verify", "verified ops", "bogo ops");
+			pr_yaml(yaml, "verify:\n");
+			header = true;
+		}
+		munged = stress_munge_underscore(ss->stressor->name);
+		pr_inf("%-13s %14" PRIu64 " %14" PRIu64 "\n", munged, verified, counter);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      verified-ops: %" PRIu64 "\n", verified);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", counter);
+		pr_yaml(yaml, "      sample: %" PRIu32 "\n", verify_sample ? verify_sample : 1);
+		pr_yaml(yaml, "      mode: %s\n", verify_sample_random ? "random" : "stride");
+		pr_yaml(yaml, "\n");
+	}
+}
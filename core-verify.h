@@ -0,0 +1,59 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_VERIFY_H
+#define CORE_VERIFY_H
+
+/* Sampled verification, --verify-sample */
+
+/* per stressor process sampling state */
+typedef struct {
+	uint32_t sample;	/* verify 1 in sample ops, 0 = every op */
+	uint32_t countdown;	/* ops until the next verified op */
+	bool random;		/* random rather than strided gaps */
+	uint64_t ops;		/* ops verified */
+} stress_verify_state_t;
+
+extern stress_verify_state_t g_verify;
+
+extern int stress_set_verify_sample(const char *opt);
+extern int stress_set_verify_sample_mode(const char *opt);
+extern void stress_verify_init(void);
+extern void stress_verify_next(void);
+extern void stress_verify_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+/*
+ *  stress_verify_sample()
+ *	return true if the current op should be verified, this is
+ *	every op with --verify and 1 in N ops with --verify-sample N,
+ *	and always false without --verify
+ */
+static inline bool ALWAYS_INLINE stress_verify_sample(void)
+{
+	if (!(g_opt_flags & OPT_FLAGS_VERIFY))
+		return false;
+	if (LIKELY(g_verify.countdown > 1)) {
+		g_verify.countdown--;
+		return false;
+	}
+	stress_verify_next();
+	g_verify.ops++;
+	return true;
+}
+
+#endif
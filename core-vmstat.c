@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-metrics.h"
+#include "core-rapl.h"
 #include "core-thermal-zone.h"
 
 #if defined(HAVE_SYS_SYSMACROS_H)
@@ -594,6 +596,105 @@ static void stress_read_vmstat(stress_vmstat_t *vmstat)
 }
 #endif
 
+#if defined(__linux__)
+/*
+ *  stress_get_meminfo_dirty()
+ *	read the Dirty and Writeback page cache sizes in KB
+ *	from /proc/meminfo, returns 0 if OK, -1 on failure
+ */
+int stress_get_meminfo_dirty(uint64_t *dirty_kb, uint64_t *writeback_kb)
+{
+	FILE *fp;
+	char buffer[256];
+	int found = 0;
+
+	fp = fopen("/proc/meminfo", "r");
+	if (!fp)
+		return -1;
+	while ((found != 3) && fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr = buffer;
+
+		if (!strncmp(buffer, "Dirty:", 6)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			*dirty_kb = (uint64_t)atoll(ptr);
+			found |= 1;
+		}
+		if (!strncmp(buffer, "Writeback:", 10)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			*writeback_kb = (uint64_t)atoll(ptr);
+			found |= 2;
+		}
+	}
+	(void)fclose(fp);
+
+	return (found == 3) ? 0 : -1;
+}
+
+/*
+ *  stress_get_vmstat_counters()
+ *	read the n named counters from /proc/vmstat into values,
+ *	counters that are not found are zero, returns 0 if OK,
+ *	-1 on failure
+ */
+int stress_get_vmstat_counters(const char * const *names, uint64_t *values, const size_t n)
+{
+	FILE *fp;
+	char buffer[256];
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		values[i] = 0;
+	fp = fopen("/proc/vmstat", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr = buffer;
+
+		for (i = 0; i < n; i++) {
+			const size_t len = strlen(names[i]);
+
+			if (!strncmp(buffer, names[i], len) && (buffer[len] == ' ')) {
+				if (stress_next_field(&ptr))
+					values[i] = (uint64_t)strtoull(ptr, NULL, 10);
+				break;
+			}
+		}
+	}
+	(void)fclose(fp);
+
+	return 0;
+}
+#else
+/*
+ *  stress_get_meminfo_dirty()
+ *	read the Dirty and Writeback page cache sizes, no-op
+ */
+int stress_get_meminfo_dirty(uint64_t *dirty_kb, uint64_t *writeback_kb)
+{
+	*dirty_kb = 0;
+	*writeback_kb = 0;
+
+	return -1;
+}
+
+/*
+ *  stress_get_vmstat_counters()
+ *	read named vmstat counters, no-op
+ */
+int stress_get_vmstat_counters(const char * const *names, uint64_t *values, const size_t n)
+{
+	size_t i;
+
+	(void)names;
+	for (i = 0; i < n; i++)
+		values[i] = 0;
+
+	return -1;
+}
+#endif
+
 #define STRESS_VMSTAT_COPY(field)	vmstat->field = (vmstat_current.field)
 #define STRESS_VMSTAT_DELTA(field)					\
 	vmstat->field = ((vmstat_current.field > vmstat_prev.field) ?	\
@@ -657,11 +758,31 @@ static double stress_get_tz_info(stress_tz_info_t *tz_info)
 #endif
 
 #if defined(__linux__)
+/*
+ *  stress_get_cpu_ghz()
+ *	get the current frequency of a CPU in GHz, 0.0 if unknown
+ */
+double stress_get_cpu_ghz(const unsigned int cpu)
+{
+	char path[PATH_MAX];
+	double freq = 0.0;
+	FILE *fp;
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%u/cpufreq/scaling_cur_freq", cpu);
+	if ((fp = fopen(path, "r")) != NULL) {
+		if (fscanf(fp, "%lf", &freq) != 1)
+			freq = 0.0;
+		(void)fclose(fp);
+	}
+	return freq * ONE_MILLIONTH;
+}
+
 /*
  *  stress_get_cpu_ghz_average()
  *	compute average CPU frequencies in GHz
  */
-static double stress_get_cpu_ghz_average(void)
+double stress_get_cpu_ghz_average(void)
 {
 	struct dirent **cpu_list = NULL;
 	int i, n_cpus, n = 0;
@@ -695,7 +816,15 @@ static double stress_get_cpu_ghz_average(void)
 	return (n == 0) ? 0.0 : (total_freq / n) * ONE_MILLIONTH;
 }
 #elif defined(__FreeBSD__)
-static double stress_get_cpu_ghz_average(void)
+double stress_get_cpu_ghz(const unsigned int cpu)
+{
+	char name[32];
+
+	(void)snprintf(name, sizeof(name), "dev.cpu.%u.freq", cpu);
+	return (double)freebsd_getsysctl_uint(name) / 1000.0;
+}
+
+double stress_get_cpu_ghz_average(void)
 {
 	const int32_t ncpus = stress_get_processors_configured();
 	int32_t i;
@@ -714,12 +843,119 @@ static double stress_get_cpu_ghz_average(void)
 	return 0.0;
 }
 #else
-static double stress_get_cpu_ghz_average(void)
+double stress_get_cpu_ghz(const unsigned int cpu)
+{
+	(void)cpu;
+
+	return 0.0;
+}
+
+double stress_get_cpu_ghz_average(void)
 {
 	return 0.0;
 }
 #endif
 
+/*
+ *  stress_vmstat_openmetrics()
+ *	write the system wide vmstat, thermal zone and iostat values
+ *	as OpenMetrics families; counters are the raw cumulative values
+ *	so the rates are left to the scraper
+ */
+void stress_vmstat_openmetrics(FILE *fp)
+{
+	stress_vmstat_t vmstat;
+	const long int clk_tck = sysconf(_SC_CLK_TCK);
+	const double tick = (clk_tck > 0) ? 1.0 / (double)clk_tck : 0.01;
+#if defined(__linux__)
+	static stress_tz_info_t *tz_info_list;
+	static bool tz_init = false;
+	stress_tz_info_t *tz_info;
+#endif
+#if defined(HAVE_SYS_SYSMACROS_H) &&	\
+    defined(__linux__)
+	static char iostat_name[PATH_MAX];
+	static char *iostat_path;
+	static bool iostat_init = false;
+	stress_iostat_t iostat;
+#endif
+
+	(void)memset(&vmstat, 0, sizeof(vmstat));
+	stress_read_vmstat(&vmstat);
+
+	(void)fprintf(fp, "# TYPE stress_ng_vmstat_procs gauge\n");
+	(void)fprintf(fp, "# HELP stress_ng_vmstat_procs Processes running or blocked.\n");
+	(void)fprintf(fp, "stress_ng_vmstat_procs{state=\"running\"} %" PRIu64 "\n", vmstat.procs_running);
+	(void)fprintf(fp, "stress_ng_vmstat_procs{state=\"blocked\"} %" PRIu64 "\n", vmstat.procs_blocked);
+	(void)fprintf(fp, "# TYPE stress_ng_vmstat_memory_bytes gauge\n");
+	(void)fprintf(fp, "# HELP stress_ng_vmstat_memory_bytes Free, buffer and page cache memory.\n");
+	(void)fprintf(fp, "stress_ng_vmstat_memory_bytes{type=\"free\"} %" PRIu64 "\n", vmstat.memory_free * 1024);
+	(void)fprintf(fp, "stress_ng_vmstat_memory_bytes{type=\"buffers\"} %" PRIu64 "\n", vmstat.memory_buff * 1024);
+	(void)fprintf(fp, "stress_ng_vmstat_memory_bytes{type=\"cached\"} %" PRIu64 "\n", vmstat.memory_cache * 1024);
+	(void)fprintf(fp, "# TYPE stress_ng_vmstat_cpu_seconds counter\n");
+	(void)fprintf(fp, "# HELP stress_ng_vmstat_cpu_seconds CPU time of all CPUs by mode.\n");
+	(void)fprintf(fp, "stress_ng_vmstat_cpu_seconds_total{mode=\"user\"} %f\n", (double)vmstat.user_time * tick);
+	(void)fprintf(fp, "stress_ng_vmstat_cpu_seconds_total{mode=\"system\"} %f\n", (double)vmstat.system_time * tick);
+	(void)fprintf(fp, "stress_ng_vmstat_cpu_seconds_total{mode=\"idle\"} %f\n", (double)vmstat.idle_time * tick);
+	(void)fprintf(fp, "stress_ng_vmstat_cpu_seconds_total{mode=\"iowait\"} %f\n", (double)vmstat.wait_time * tick);
+	(void)fprintf(fp, "stress_ng_vmstat_cpu_seconds_total{mode=\"steal\"} %f\n", (double)vmstat.stolen_time * tick);
+	(void)fprintf(fp, "# TYPE stress_ng_vmstat_swap_pages counter\n");
+	(void)fprintf(fp, "# HELP stress_ng_vmstat_swap_pages Pages swapped in and out.\n");
+	(void)fprintf(fp, "stress_ng_vmstat_swap_pages_total{direction=\"in\"} %" PRIu64 "\n", vmstat.swap_in);
+	(void)fprintf(fp, "stress_ng_vmstat_swap_pages_total{direction=\"out\"} %" PRIu64 "\n", vmstat.swap_out);
+	(void)fprintf(fp, "# TYPE stress_ng_vmstat_block_io counter\n");
+	(void)fprintf(fp, "# HELP stress_ng_vmstat_block_io Blocks paged in from and out to block devices.\n");
+	(void)fprintf(fp, "stress_ng_vmstat_block_io_total{direction=\"in\"} %" PRIu64 "\n", vmstat.block_in);
+	(void)fprintf(fp, "stress_ng_vmstat_block_io_total{direction=\"out\"} %" PRIu64 "\n", vmstat.block_out);
+	(void)fprintf(fp, "# TYPE stress_ng_vmstat_interrupts counter\n");
+	(void)fprintf(fp, "# HELP stress_ng_vmstat_interrupts Interrupts serviced.\n");
+	(void)fprintf(fp, "stress_ng_vmstat_interrupts_total %" PRIu64 "\n", vmstat.interrupt);
+	(void)fprintf(fp, "# TYPE stress_ng_vmstat_context_switches counter\n");
+	(void)fprintf(fp, "# HELP stress_ng_vmstat_context_switches Context switches.\n");
+	(void)fprintf(fp, "stress_ng_vmstat_context_switches_total %" PRIu64 "\n", vmstat.context_switch);
+
+#if defined(__linux__)
+	if (!tz_init) {
+		(void)stress_tz_init(&tz_info_list);
+		tz_init = true;
+	}
+	if (tz_info_list) {
+		(void)fprintf(fp, "# TYPE stress_ng_thermal_zone_celsius gauge\n");
+		(void)fprintf(fp, "# HELP stress_ng_thermal_zone_celsius Thermal zone temperature.\n");
+		for (tz_info = tz_info_list; tz_info; tz_info = tz_info->next) {
+			(void)fprintf(fp, "stress_ng_thermal_zone_celsius{zone=\"%s\",zone_instance=\"%" PRIu32 "\"} %.3f\n",
+				tz_info->type, tz_info->type_instance, stress_get_tz_info(tz_info));
+		}
+	}
+#endif
+
+#if defined(HAVE_SYS_SYSMACROS_H) &&	\
+    defined(__linux__)
+	if (!iostat_init) {
+		iostat_path = stress_iostat_iostat_name(iostat_name, sizeof(iostat_name));
+		iostat_init = true;
+	}
+	if (iostat_path) {
+		(void)memset(&iostat, 0, sizeof(iostat));
+		stress_read_iostat(iostat_path, &iostat);
+		/* sectors are always 512 bytes in /sys/block/$dev/stat */
+		(void)fprintf(fp, "# TYPE stress_ng_iostat_ios counter\n");
+		(void)fprintf(fp, "# HELP stress_ng_iostat_ios I/O requests completed on the temporary path device.\n");
+		(void)fprintf(fp, "stress_ng_iostat_ios_total{op=\"read\"} %" PRIu64 "\n", iostat.read_io);
+		(void)fprintf(fp, "stress_ng_iostat_ios_total{op=\"write\"} %" PRIu64 "\n", iostat.write_io);
+		(void)fprintf(fp, "stress_ng_iostat_ios_total{op=\"discard\"} %" PRIu64 "\n", iostat.discard_io);
+		(void)fprintf(fp, "# TYPE stress_ng_iostat_bytes counter\n");
+		(void)fprintf(fp, "# HELP stress_ng_iostat_bytes Bytes transferred on the temporary path device.\n");
+		(void)fprintf(fp, "stress_ng_iostat_bytes_total{op=\"read\"} %" PRIu64 "\n", iostat.read_sectors * 512);
+		(void)fprintf(fp, "stress_ng_iostat_bytes_total{op=\"write\"} %" PRIu64 "\n", iostat.write_sectors * 512);
+		(void)fprintf(fp, "stress_ng_iostat_bytes_total{op=\"discard\"} %" PRIu64 "\n", iostat.discard_sectors * 512);
+		(void)fprintf(fp, "# TYPE stress_ng_iostat_in_flight gauge\n");
+		(void)fprintf(fp, "# HELP stress_ng_iostat_in_flight I/O requests in flight on the temporary path device.\n");
+		(void)fprintf(fp, "stress_ng_iostat_in_flight %" PRIu64 "\n", iostat.in_flight);
+	}
+#endif
+}
+
 /*
  *  stress_vmstat_start()
  *	start vmstat statistics (1 per second)
@@ -933,3 +1169,561 @@ void stress_vmstat_stop(void)
 		(void)waitpid(vmstat_pid, &status, 0);
 	}
 }
+
+/*
+ *  Unified --sample sampler; the vmstat, iostat, thermal zone, CPU
+ *  frequency and bogo-ops sources are read on one shared tick from
+ *  file descriptors that are held open for the entire run
+ */
+enum {
+	SAMPLE_PROCS_RUNNING = 0,
+	SAMPLE_PROCS_BLOCKED,
+	SAMPLE_MEMORY_FREE,
+	SAMPLE_MEMORY_BUFF,
+	SAMPLE_MEMORY_CACHE,
+	SAMPLE_SWAP_IN,
+	SAMPLE_SWAP_OUT,
+	SAMPLE_BLOCK_IN,
+	SAMPLE_BLOCK_OUT,
+	SAMPLE_INTERRUPT,
+	SAMPLE_CONTEXT_SWITCH,
+	SAMPLE_CPU_USER,
+	SAMPLE_CPU_SYSTEM,
+	SAMPLE_CPU_IDLE,
+	SAMPLE_CPU_WAIT,
+	SAMPLE_CPU_STOLEN,
+	SAMPLE_CPU_GHZ,
+	SAMPLE_IO_READ,
+	SAMPLE_IO_WRITE,
+	SAMPLE_POWER_WATTS,
+	SAMPLE_MAX,
+};
+
+/* column names of the fixed sample values, in enum order */
+static const char * const sample_names[SAMPLE_MAX] = {
+	"procs-running",
+	"procs-blocked",
+	"memory-free-kb",
+	"memory-buffers-kb",
+	"memory-cached-kb",
+	"swap-in-per-second",
+	"swap-out-per-second",
+	"block-in-kb-per-second",
+	"block-out-kb-per-second",
+	"interrupts-per-second",
+	"context-switches-per-second",
+	"cpu-user-percent",
+	"cpu-system-percent",
+	"cpu-idle-percent",
+	"cpu-iowait-percent",
+	"cpu-steal-percent",
+	"cpu-ghz",
+	"io-read-kb-per-second",
+	"io-write-kb-per-second",
+	"power-watts",
+};
+
+#define SAMPLE_NAME_LEN		(32)
+#define SAMPLE_BUF_SIZE		(256 * 1024)
+
+/* start of the --sample temporary file, followed by the zone names */
+typedef struct {
+	uint32_t tz_count;		/* thermal zone temperatures per sample */
+	uint32_t stressor_count;	/* bogo-ops rates per sample */
+} stress_sample_header_t;
+
+/* held open sources of the sampler process */
+typedef struct {
+	int stat_fd;			/* /proc/stat */
+	int meminfo_fd;			/* /proc/meminfo */
+	int vmstat_fd;			/* /proc/vmstat */
+	int iostat_fd;			/* /sys/block/$dev/stat */
+	int *tz_fds;			/* thermal zone temp files */
+	int *freq_fds;			/* per CPU scaling_cur_freq files */
+	uint32_t tz_count;
+	uint32_t freq_count;
+	char *buf;			/* read buffer */
+} stress_sample_src_t;
+
+static int32_t sample_delay = 0;	/* sample period in seconds, 0 = off */
+static pid_t sample_pid;		/* sampler process pid */
+static FILE *sample_samples;		/* samples for the JSON output */
+
+int stress_set_sample(const char *const opt)
+{
+	return stress_set_generic_stat(opt, "sample", &sample_delay);
+}
+
+/*
+ *  stress_sample_read()
+ *	read a held open file from the start into buf, the buffer
+ *	is an empty string if the file is not available
+ */
+static void stress_sample_read(const int fd, char *buf, const size_t len)
+{
+	size_t total = 0;
+
+	while ((fd >= 0) && (total < len - 1)) {
+		const ssize_t ret = pread(fd, buf + total, len - 1 - total, (off_t)total);
+
+		if (ret <= 0)
+			break;
+		total += (size_t)ret;
+	}
+	buf[total] = '\0';
+}
+
+/*
+ *  stress_sample_key()
+ *	find the line starting with key and return the
+ *	value that follows it, 0 if not found
+ */
+static uint64_t stress_sample_key(const char *buf, const char *key)
+{
+	const size_t len = strlen(key);
+	const char *ptr = buf;
+
+	while (ptr && *ptr) {
+		if (!strncmp(ptr, key, len) && isspace((int)ptr[len]))
+			return (uint64_t)strtoull(ptr + len, NULL, 10);
+		ptr = strchr(ptr, '\n');
+		if (ptr)
+			ptr++;
+	}
+	return 0;
+}
+
+/*
+ *  stress_sample_read_vmstat()
+ *	read the vmstat and iostat counters and the instantaneous
+ *	CPU frequency from the held open files
+ */
+static void stress_sample_read_vmstat(
+	stress_sample_src_t *src,
+	stress_vmstat_t *vmstat,
+	stress_iostat_t *iostat,
+	double *ghz)
+{
+	uint64_t user = 0, nice = 0, sys = 0, idle = 0, iowait = 0;
+	uint64_t irq = 0, softirq = 0, steal = 0, guest = 0, guest_nice = 0;
+	uint64_t khz_total = 0;
+	uint32_t i, khz_count = 0;
+	char *buf = src->buf;
+
+	(void)memset(vmstat, 0, sizeof(*vmstat));
+	(void)memset(iostat, 0, sizeof(*iostat));
+
+	stress_sample_read(src->stat_fd, buf, SAMPLE_BUF_SIZE);
+	if (!strncmp(buf, "cpu ", 4)) {
+		(void)sscanf(buf + 4, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+			" %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+			" %" SCNu64 " %" SCNu64,
+			&user, &nice, &sys, &idle, &iowait,
+			&irq, &softirq, &steal, &guest, &guest_nice);
+	}
+	/* same accounting as the --vmstat columns */
+	vmstat->user_time = user + nice;
+	vmstat->system_time = sys + irq + softirq;
+	vmstat->idle_time = idle;
+	vmstat->wait_time = iowait;
+	vmstat->stolen_time = steal + guest + guest_nice;
+	vmstat->interrupt = stress_sample_key(buf, "intr");
+	vmstat->context_switch = stress_sample_key(buf, "ctxt");
+	vmstat->procs_running = stress_sample_key(buf, "procs_running");
+	vmstat->procs_blocked = stress_sample_key(buf, "procs_blocked");
+
+	stress_sample_read(src->meminfo_fd, buf, SAMPLE_BUF_SIZE);
+	vmstat->memory_free = stress_sample_key(buf, "MemFree:");
+	vmstat->memory_buff = stress_sample_key(buf, "Buffers:");
+	vmstat->memory_cache = stress_sample_key(buf, "Cached:");
+
+	stress_sample_read(src->vmstat_fd, buf, SAMPLE_BUF_SIZE);
+	vmstat->block_in = stress_sample_key(buf, "pgpgin");
+	vmstat->block_out = stress_sample_key(buf, "pgpgout");
+	vmstat->swap_in = stress_sample_key(buf, "pswpin");
+	vmstat->swap_out = stress_sample_key(buf, "pswpout");
+
+	if (src->iostat_fd >= 0) {
+		stress_sample_read(src->iostat_fd, buf, SAMPLE_BUF_SIZE);
+		(void)sscanf(buf, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+			" %" SCNu64 " %" SCNu64 " %" SCNu64,
+			&iostat->read_io, &iostat->read_merges,
+			&iostat->read_sectors, &iostat->read_ticks,
+			&iostat->write_io, &iostat->write_merges,
+			&iostat->write_sectors);
+	}
+
+	for (i = 0; i < src->freq_count; i++) {
+		stress_sample_read(src->freq_fds[i], buf, 64);
+		if (*buf) {
+			khz_total += (uint64_t)strtoull(buf, NULL, 10);
+			khz_count++;
+		}
+	}
+	*ghz = khz_count ? ((double)khz_total / (double)khz_count) / 1000000.0 : 0.0;
+}
+
+/*
+ *  stress_sample_open()
+ *	open a sample source, returns -1 if it is not available
+ */
+static int stress_sample_open(const char *path)
+{
+	return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+/*
+ *  stress_sample_sources()
+ *	open all the sample sources, fill in the thermal zone names
+ */
+static int stress_sample_sources(stress_sample_src_t *src, char (**tz_names)[SAMPLE_NAME_LEN])
+{
+	const int32_t cpus = stress_get_processors_configured();
+	char path[PATH_MAX];
+	int32_t cpu;
+#if defined(STRESS_THERMAL_ZONES)
+	stress_tz_info_t *tz_info, *tz_info_list = NULL;
+#endif
+
+	(void)memset(src, 0, sizeof(*src));
+	src->buf = malloc(SAMPLE_BUF_SIZE);
+	src->freq_fds = calloc((cpus > 0) ? (size_t)cpus : 1, sizeof(*src->freq_fds));
+	if (!src->buf || !src->freq_fds)
+		return -1;
+
+	src->stat_fd = stress_sample_open("/proc/stat");
+	src->meminfo_fd = stress_sample_open("/proc/meminfo");
+	src->vmstat_fd = stress_sample_open("/proc/vmstat");
+	src->iostat_fd = -1;
+#if defined(HAVE_SYS_SYSMACROS_H) &&	\
+    defined(__linux__)
+	if (stress_iostat_iostat_name(path, sizeof(path)))
+		src->iostat_fd = stress_sample_open(path);
+#endif
+	for (cpu = 0; cpu < cpus; cpu++) {
+		int fd;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/scaling_cur_freq", cpu);
+		fd = stress_sample_open(path);
+		if (fd >= 0)
+			src->freq_fds[src->freq_count++] = fd;
+	}
+
+	*tz_names = NULL;
+#if defined(STRESS_THERMAL_ZONES)
+	(void)stress_tz_init(&tz_info_list);
+	for (tz_info = tz_info_list; tz_info; tz_info = tz_info->next)
+		src->tz_count++;
+	if (src->tz_count) {
+		src->tz_fds = calloc(src->tz_count, sizeof(*src->tz_fds));
+		*tz_names = calloc(src->tz_count, sizeof(**tz_names));
+		if (!src->tz_fds || !*tz_names) {
+			stress_tz_free(&tz_info_list);
+			return -1;
+		}
+		src->tz_count = 0;
+		for (tz_info = tz_info_list; tz_info; tz_info = tz_info->next) {
+			int fd;
+
+			(void)snprintf(path, sizeof(path), "/sys/class/thermal/%s/temp", tz_info->path);
+			fd = stress_sample_open(path);
+			if (fd < 0)
+				continue;
+			(void)snprintf((*tz_names)[src->tz_count], SAMPLE_NAME_LEN,
+				"%s%" PRIu32, tz_info->type, tz_info->type_instance);
+			src->tz_fds[src->tz_count++] = fd;
+		}
+	}
+	stress_tz_free(&tz_info_list);
+#endif
+	return 0;
+}
+
+/*
+ *  stress_sample_csv_header()
+ *	output the CSV column names
+ */
+static void stress_sample_csv_header(
+	FILE *csv,
+	stress_stressor_t *stressors_list,
+	char (*tz_names)[SAMPLE_NAME_LEN],
+	const uint32_t tz_count)
+{
+	stress_stressor_t *ss;
+	uint32_t i;
+
+	(void)fprintf(csv, "time");
+	for (i = 0; i < SAMPLE_MAX; i++)
+		(void)fprintf(csv, ",%s", sample_names[i]);
+	for (i = 0; i < tz_count; i++)
+		(void)fprintf(csv, ",%s-celsius", tz_names[i]);
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->stats)
+			(void)fprintf(csv, ",%s-bogo-ops-per-second",
+				stress_munge_underscore(ss->stressor->name));
+	}
+	(void)fprintf(csv, "\n");
+}
+
+#define STRESS_SAMPLE_RATE(field)					\
+	((dt > 0.0) && (cur->field >= prev->field) ?			\
+	(double)(cur->field - prev->field) / dt : 0.0)
+
+/*
+ *  stress_sample_values()
+ *	compute the fixed sample values from the current and
+ *	previous counters over dt seconds
+ */
+static void stress_sample_values(
+	double *values,
+	const stress_vmstat_t *cur,
+	const stress_vmstat_t *prev,
+	const stress_iostat_t *io_cur,
+	const stress_iostat_t *io_prev,
+	const double ghz,
+	const double dt)
+{
+	const uint64_t cpu_cur = cur->user_time + cur->system_time +
+		cur->idle_time + cur->wait_time + cur->stolen_time;
+	const uint64_t cpu_prev = prev->user_time + prev->system_time +
+		prev->idle_time + prev->wait_time + prev->stolen_time;
+	const double cpu_total = (cpu_cur > cpu_prev) ? (double)(cpu_cur - cpu_prev) : 0.0;
+	const double cpu_scale = (cpu_total > 0.0) ? 100.0 / cpu_total : 0.0;
+
+	values[SAMPLE_PROCS_RUNNING] = (double)cur->procs_running;
+	values[SAMPLE_PROCS_BLOCKED] = (double)cur->procs_blocked;
+	values[SAMPLE_MEMORY_FREE] = (double)cur->memory_free;
+	values[SAMPLE_MEMORY_BUFF] = (double)cur->memory_buff;
+	values[SAMPLE_MEMORY_CACHE] = (double)cur->memory_cache;
+	values[SAMPLE_SWAP_IN] = STRESS_SAMPLE_RATE(swap_in);
+	values[SAMPLE_SWAP_OUT] = STRESS_SAMPLE_RATE(swap_out);
+	values[SAMPLE_BLOCK_IN] = STRESS_SAMPLE_RATE(block_in);
+	values[SAMPLE_BLOCK_OUT] = STRESS_SAMPLE_RATE(block_out);
+	values[SAMPLE_INTERRUPT] = STRESS_SAMPLE_RATE(interrupt);
+	values[SAMPLE_CONTEXT_SWITCH] = STRESS_SAMPLE_RATE(context_switch);
+	values[SAMPLE_CPU_USER] = (double)(cur->user_time - prev->user_time) * cpu_scale;
+	values[SAMPLE_CPU_SYSTEM] = (double)(cur->system_time - prev->system_time) * cpu_scale;
+	values[SAMPLE_CPU_IDLE] = (double)(cur->idle_time - prev->idle_time) * cpu_scale;
+	values[SAMPLE_CPU_WAIT] = (double)(cur->wait_time - prev->wait_time) * cpu_scale;
+	values[SAMPLE_CPU_STOLEN] = (double)(cur->stolen_time - prev->stolen_time) * cpu_scale;
+	values[SAMPLE_CPU_GHZ] = ghz;
+	/* sectors are 512 bytes, so >> 1 to get stats in 1024 bytes */
+	values[SAMPLE_IO_READ] = (dt > 0.0) ?
+		(double)((io_cur->read_sectors - io_prev->read_sectors) >> 1) / dt : 0.0;
+	values[SAMPLE_IO_WRITE] = (dt > 0.0) ?
+		(double)((io_cur->write_sectors - io_prev->write_sectors) >> 1) / dt : 0.0;
+}
+
+#undef STRESS_SAMPLE_RATE
+
+/*
+ *  stress_sample_start()
+ *	start a process that samples the system counters, thermal
+ *	zones, CPU frequency and the bogo-ops of all the stressors
+ *	every --sample seconds as one timestamped row, to the
+ *	--sample-file CSV file and to the --json results
+ */
+void stress_sample_start(stress_stressor_t *stressors_list)
+{
+	stress_sample_src_t src;
+	stress_sample_header_t header;
+	stress_vmstat_t vmstat_cur, vmstat_prev;
+	stress_iostat_t iostat_cur, iostat_prev;
+	stress_rapl_sample_t rapl_cur, rapl_prev;
+	stress_stressor_t *ss;
+	char (*tz_names)[SAMPLE_NAME_LEN] = NULL;
+	char *csv_filename = NULL;
+	FILE *csv = NULL;
+	stress_ops_sampler_t sampler;
+	double *row, ghz, time_start, time_prev, time_next;
+	size_t row_len;
+	uint32_t i, stressor_count = 0;
+	int fd;
+
+	if (sample_delay == 0)
+		return;
+
+	sample_samples = tmpfile();
+	if (!sample_samples)
+		pr_dbg("sample: cannot create temporary sample file, "
+			"no JSON samples will be recorded\n");
+
+	sample_pid = fork();
+	if ((sample_pid < 0) || (sample_pid > 0))
+		return;
+
+	stress_set_proc_name("stress-ng-sample");
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (!ss->stats)
+			continue;
+		stressor_count++;
+	}
+
+	if (stress_sample_sources(&src, &tz_names) < 0) {
+		pr_err("sample: cannot allocate sample sources\n");
+		_exit(EXIT_NO_RESOURCE);
+	}
+	row_len = 1 + SAMPLE_MAX + src.tz_count + stressor_count;
+	row = calloc(row_len, sizeof(*row));
+	if (!row || (stress_ops_sampler_init(&sampler, stressors_list) < 0)) {
+		pr_err("sample: cannot allocate sample buffers\n");
+		_exit(EXIT_NO_RESOURCE);
+	}
+
+	fd = sample_samples ? fileno(sample_samples) : -1;
+	if (fd >= 0) {
+		header.tz_count = src.tz_count;
+		header.stressor_count = stressor_count;
+		VOID_RET(ssize_t, write(fd, &header, sizeof(header)));
+		if (src.tz_count)
+			VOID_RET(ssize_t, write(fd, tz_names, src.tz_count * sizeof(*tz_names)));
+	}
+
+	if (stress_get_setting("sample-file", &csv_filename)) {
+		csv = fopen(csv_filename, "w");
+		if (csv) {
+			stress_sample_csv_header(csv, stressors_list, tz_names, src.tz_count);
+		} else {
+			pr_err("sample: cannot open CSV file %s, errno=%d (%s)\n",
+				csv_filename, errno, strerror(errno));
+		}
+	}
+
+	stress_sample_read_vmstat(&src, &vmstat_prev, &iostat_prev, &ghz);
+	stress_rapl_read(&rapl_prev);
+	time_start = stress_time_now();
+	time_prev = time_start;
+	time_next = time_start;
+
+	while (keep_stressing_flag()) {
+		double delta, time_now, dt, *ptr;
+		size_t k = 0;
+
+		time_next += (double)sample_delay;
+		delta = time_next - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_NANOSECOND));
+
+		time_now = stress_time_now();
+		dt = time_now - time_prev;
+		stress_sample_read_vmstat(&src, &vmstat_cur, &iostat_cur, &ghz);
+		stress_rapl_read(&rapl_cur);
+
+		row[0] = time_now - time_start;
+		stress_sample_values(row + 1, &vmstat_cur, &vmstat_prev,
+			&iostat_cur, &iostat_prev, ghz, dt);
+		row[1 + SAMPLE_POWER_WATTS] = stress_rapl_watts(&rapl_prev, &rapl_cur);
+		ptr = row + 1 + SAMPLE_MAX;
+		for (i = 0; i < src.tz_count; i++) {
+			stress_sample_read(src.tz_fds[i], src.buf, 64);
+			*ptr++ = (double)strtoull(src.buf, NULL, 10) / 1000.0;
+		}
+		for (ss = stressors_list; ss; ss = ss->next) {
+			uint64_t ops = 0;
+			int32_t j;
+
+			if (!ss->stats)
+				continue;
+			for (j = 0; j < ss->num_instances; j++)
+				ops += stress_ops_sampler_delta(&sampler, k++, ss->stats[j]->ci.counter);
+			*ptr++ = (dt > 0.0) ? (double)ops / dt : 0.0;
+		}
+
+		if (fd >= 0)
+			VOID_RET(ssize_t, write(fd, row, row_len * sizeof(*row)));
+		if (csv) {
+			(void)fprintf(csv, "%.3f", row[0]);
+			for (i = 1; i < row_len; i++)
+				(void)fprintf(csv, ",%.3f", row[i]);
+			(void)fprintf(csv, "\n");
+			(void)fflush(csv);
+		}
+		vmstat_prev = vmstat_cur;
+		iostat_prev = iostat_cur;
+		rapl_prev = rapl_cur;
+		time_prev = time_now;
+	}
+	if (csv)
+		(void)fclose(csv);
+	_exit(0);
+}
+
+/*
+ *  stress_sample_stop()
+ *	stop the sampler process
+ */
+void stress_sample_stop(void)
+{
+	if (sample_pid > 0) {
+		int status;
+
+		(void)kill(sample_pid, SIGKILL);
+		(void)waitpid(sample_pid, &status, 0);
+		sample_pid = 0;
+	}
+}
+
+/*
+ *  stress_sample_json()
+ *	output the recorded samples as a JSON "samples" array member
+ */
+void stress_sample_json(FILE *fp, stress_stressor_t *stressors_list)
+{
+	stress_sample_header_t header;
+	char (*tz_names)[SAMPLE_NAME_LEN] = NULL;
+	double *row = NULL;
+	size_t row_len;
+	const char *sep = "\n";
+	int fd;
+
+	if (!sample_samples)
+		return;
+
+	fd = fileno(sample_samples);
+	if ((lseek(fd, 0, SEEK_SET) != 0) ||
+	    (read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)))
+		goto close_samples;
+	if (header.tz_count) {
+		tz_names = calloc(header.tz_count, sizeof(*tz_names));
+		if (!tz_names ||
+		    (read(fd, tz_names, header.tz_count * sizeof(*tz_names)) !=
+		     (ssize_t)(header.tz_count * sizeof(*tz_names))))
+			goto free_names;
+	}
+	row_len = 1 + SAMPLE_MAX + header.tz_count + header.stressor_count;
+	row = calloc(row_len, sizeof(*row));
+	if (!row)
+		goto free_names;
+
+	(void)fprintf(fp, "  \"samples\": [");
+	while (read(fd, row, row_len * sizeof(*row)) == (ssize_t)(row_len * sizeof(*row))) {
+		stress_stressor_t *ss;
+		const double *ptr = row + 1;
+		uint32_t i;
+
+		(void)fprintf(fp, "%s    { \"time\": %.3f", sep, row[0]);
+		for (i = 0; i < SAMPLE_MAX; i++)
+			(void)fprintf(fp, ", \"%s\": %.3f", sample_names[i], *ptr++);
+		for (i = 0; i < header.tz_count; i++)
+			(void)fprintf(fp, ", \"%s-celsius\": %.3f", tz_names[i], *ptr++);
+		for (i = 0, ss = stressors_list; ss && (i < header.stressor_count); ss = ss->next) {
+			if (!ss->stats)
+				continue;
+			(void)fprintf(fp, ", \"%s-bogo-ops-per-second\": %.3f",
+				stress_munge_underscore(ss->stressor->name), *ptr++);
+			i++;
+		}
+		(void)fprintf(fp, " }");
+		sep = ",\n";
+	}
+	(void)fprintf(fp, "%s],\n", (*sep == ',') ? "\n  " : "");
+
+	free(row);
+free_names:
+	free(tz_names);
+close_samples:
+	(void)fclose(sample_samples);
+	sample_samples = NULL;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-window.h"
+
+#define WINDOW_POLL_MAX		(0.1)	/* longest snapshot sleep, seconds */
+
+static uint64_t window_warmup;		/* warm-up seconds, 0 = none */
+static uint64_t window_cooldown;	/* cool-down seconds, 0 = none */
+static pid_t window_pid;		/* counter snapshot process */
+
+/*
+ *  stress_set_warmup()
+ *	set the warm-up time that is excluded from the metrics
+ */
+int stress_set_warmup(const char *const opt)
+{
+	window_warmup = stress_get_uint64_time(opt);
+	return 0;
+}
+
+/*
+ *  stress_set_cooldown()
+ *	set the cool-down time that is excluded from the metrics
+ */
+int stress_set_cooldown(const char *const opt)
+{
+	window_cooldown = stress_get_uint64_time(opt);
+	return 0;
+}
+
+/*
+ *  stress_window_check()
+ *	sanity check the windows against the run timeout,
+ *	returns -1 if the measure window is empty
+ */
+int stress_window_check(void)
+{
+	if (!window_warmup && !window_cooldown)
+		return 0;
+
+	if (g_opt_timeout == 0) {
+		pr_err("--warmup and --cooldown require a non-zero --timeout\n");
+		return -1;
+	}
+	if (window_warmup + window_cooldown >= g_opt_timeout) {
+		pr_err("--warmup %" PRIu64 "s and --cooldown %" PRIu64
+			"s leave no measure window in a %" PRIu64 "s run\n",
+			window_warmup, window_cooldown, g_opt_timeout);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_window_snapshot()
+ *	snapshot the bogo-ops counter of an instance once the
+ *	deadline is reached, returns the deadline if it is still
+ *	pending or 0.0 if the snapshot has been taken
+ */
+static double stress_window_snapshot(
+	stress_stats_t *stats,
+	const double deadline,
+	const double now,
+	double *snap_time,
+	uint64_t *counter)
+{
+	if (*snap_time > 0.0)
+		return 0.0;
+	if (now < deadline)
+		return deadline;
+
+	/* counter must be visible before the time that flags it as valid */
+	*counter = stats->ci.counter;
+	shim_mb();
+	*snap_time = stress_time_now();
+	return 0.0;
+}
+
+/*
+ *  stress_window_start()
+ *	fork a process that snapshots the bogo-ops counters of
+ *	each instance at the end of the warm-up and the start of
+ *	the cool-down windows
+ */
+void stress_window_start(stress_stressor_t *stressors_list)
+{
+	if (!window_warmup && !window_cooldown)
+		return;
+
+	window_pid = fork();
+	if (window_pid < 0)
+		pr_dbg("window: cannot fork counter snapshot process, errno=%d (%s)\n",
+			errno, strerror(errno));
+	if (window_pid != 0)
+		return;
+
+	stress_parent_died_alarm();
+	for (;;) {
+		const double now = stress_time_now();
+		double next = now + WINDOW_POLL_MAX;
+		bool pending = false;
+		stress_stressor_t *ss;
+
+		for (ss = stressors_list; ss; ss = ss->next) {
+			int32_t j;
+
+			for (j = 0; j < ss->num_instances; j++) {
+				stress_stats_t *const stats = ss->stats[j];
+				stress_window_t *const window = &stats->window;
+				const double start = stats->start;
+				double deadline;
+
+				/* instance not started yet */
+				if (start <= 0.0) {
+					pending = true;
+					continue;
+				}
+				if (window_warmup) {
+					deadline = stress_window_snapshot(stats,
+						start + (double)window_warmup, now,
+						&window->warm_time, &window->warm_counter);
+					if (deadline > 0.0) {
+						pending = true;
+						next = STRESS_MINIMUM(next, deadline);
+					}
+				}
+				if (window_cooldown) {
+					deadline = stress_window_snapshot(stats,
+						start + (double)(g_opt_timeout - window_cooldown), now,
+						&window->cool_time, &window->cool_counter);
+					if (deadline > 0.0) {
+						pending = true;
+						next = STRESS_MINIMUM(next, deadline);
+					}
+				}
+			}
+		}
+		if (!pending)
+			break;
+		next -= stress_time_now();
+		if (next > 0.0)
+			(void)shim_usleep((useconds_t)(next * 1000000.0));
+	}
+	_exit(0);
+}
+
+/*
+ *  stress_window_stop()
+ *	stop the counter snapshot process
+ */
+void stress_window_stop(void)
+{
+	if (window_pid > 0) {
+		int status;
+
+		(void)kill(window_pid, SIGKILL);
+		(void)waitpid(window_pid, &status, 0);
+		window_pid = 0;
+	}
+}
+
+/*
+ *  stress_window_apply()
+ *	trim the bogo-ops counter and start time of an instance
+ *	down to the measure window, called by the instance once
+ *	the stressor has returned
+ */
+void stress_window_apply(const char *name, stress_stats_t *stats)
+{
+	stress_window_t *const window = &stats->window;
+	const uint64_t counter = stats->ci.counter;
+	const double now = stress_time_now();
+	uint64_t warm_counter, end_counter;
+	double warm_time, end_time;
+
+	if (!window_warmup && !window_cooldown)
+		return;
+
+	if (window_warmup) {
+		if (window->warm_time <= 0.0) {
+			pr_dbg("%s: warm-up window not completed, "
+				"metrics cover the entire run\n", name);
+			return;
+		}
+		warm_time = window->warm_time;
+		warm_counter = window->warm_counter;
+	} else {
+		warm_time = stats->start;
+		warm_counter = 0;
+	}
+	if ((window->cool_time > warm_time) && (window->cool_counter >= warm_counter)) {
+		end_time = window->cool_time;
+		end_counter = window->cool_counter;
+	} else {
+		end_time = now;
+		end_counter = counter;
+	}
+	stats->ci.counter = (end_counter > warm_counter) ? end_counter - warm_counter : 0;
+	stats->start = warm_time;
+	window->end = end_time;
+}
+
+/*
+ *  stress_window_finish()
+ *	move the finish time of an instance to the end of the
+ *	measure window, called after the run duration is checked
+ */
+void stress_window_finish(stress_stats_t *stats)
+{
+	if (stats->window.end > 0.0)
+		stats->finish = stats->window.end;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_WINDOW_H
+#define CORE_WINDOW_H
+
+/* Warm-up, measure and cool-down run windows, --warmup, --cooldown */
+extern int stress_set_warmup(const char *const opt);
+extern int stress_set_cooldown(const char *const opt);
+extern int stress_window_check(void);
+extern void stress_window_start(stress_stressor_t *stressors_list);
+extern void stress_window_stop(void);
+extern void stress_window_apply(const char *name, stress_stats_t *stats);
+extern void stress_window_finish(stress_stats_t *stats);
+
+#endif
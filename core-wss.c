@@ -0,0 +1,471 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-wss.h"
+
+#define WSS_STRESSORS_MAX	(64)
+#define WSS_DEFAULT_INTERVAL	(1)	/* seconds between samples */
+#define WSS_PIDS_MAX		(4096)	/* processes tracked per sample */
+
+#define WSS_RSS			(0)	/* resident set size */
+#define WSS_PSS			(1)	/* proportional set size */
+#define WSS_WSS			(2)	/* pages referenced in the interval */
+#define WSS_VALUES		(3)
+
+/* a process and its parent, from /proc/pid/stat */
+typedef struct {
+	pid_t pid;
+	pid_t ppid;
+} stress_wss_proc_t;
+
+/* memory usage of a stressor, accumulated by the sampler process */
+typedef struct {
+	char name[64];			/* stressor name */
+	const stress_stressor_t *ss;	/* stressor, NULL when not running */
+	double sum[WSS_VALUES];		/* sum of sampled values, bytes */
+	double peak[WSS_VALUES];	/* peak sampled value, bytes */
+	uint64_t samples[WSS_VALUES];	/* number of sampled values */
+} stress_wss_stressor_t;
+
+static bool wss_enabled;
+static uint32_t wss_interval = WSS_DEFAULT_INTERVAL;
+static char *wss_timeline;		/* timeline CSV file name */
+static FILE *wss_timeline_fp;		/* timeline CSV file */
+static double wss_time_start;		/* time of the first start */
+static stress_wss_stressor_t *wss_stressors;	/* shared with the sampler */
+static size_t wss_stressors_n;
+static pid_t wss_pid;			/* sampler process */
+
+/* sampler process state, processes whose referenced bits were cleared */
+static pid_t wss_primed[WSS_PIDS_MAX];
+static size_t wss_primed_n;
+
+int stress_set_wss(const char *const opt)
+{
+	(void)opt;
+
+	wss_enabled = true;
+	return 0;
+}
+
+int stress_set_wss_interval(const char *const opt)
+{
+	wss_interval = stress_get_uint32(opt);
+	stress_check_range("wss-interval", (uint64_t)wss_interval, 1, 3600);
+	wss_enabled = true;
+	return 0;
+}
+
+int stress_set_wss_timeline(const char *const opt)
+{
+	free(wss_timeline);
+	wss_timeline = strdup(opt);
+	if (!wss_timeline) {
+		(void)fprintf(stderr, "wss-timeline: out of memory\n");
+		return -1;
+	}
+	wss_enabled = true;
+	return 0;
+}
+
+static int stress_wss_pid_cmp(const void *p1, const void *p2)
+{
+	const pid_t pid1 = *(const pid_t *)p1;
+	const pid_t pid2 = *(const pid_t *)p2;
+
+	return (pid1 > pid2) - (pid1 < pid2);
+}
+
+/*
+ *  stress_wss_procs()
+ *	read the pid and parent pid of every process, returns the
+ *	number of processes, procs must be freed by the caller
+ */
+static size_t stress_wss_procs(stress_wss_proc_t **procs)
+{
+	size_t n = 0, n_max = 256;
+	struct dirent *d;
+	DIR *dir;
+
+	*procs = (stress_wss_proc_t *)malloc(n_max * sizeof(**procs));
+	if (!*procs)
+		return 0;
+	dir = opendir("/proc");
+	if (!dir)
+		return 0;
+	while ((d = readdir(dir)) != NULL) {
+		char path[PATH_MAX], buf[512], *ptr;
+		int ppid;
+
+		if (!isdigit((int)d->d_name[0]))
+			continue;
+		(void)snprintf(path, sizeof(path), "/proc/%s/stat", d->d_name);
+		(void)memset(buf, 0, sizeof(buf));
+		if (system_read(path, buf, sizeof(buf) - 1) <= 0)
+			continue;
+		/* the command name can contain spaces and ), skip past the last ) */
+		ptr = strrchr(buf, ')');
+		if (!ptr || (sscanf(ptr + 1, " %*c %d", &ppid) != 1))
+			continue;
+		if (n >= n_max) {
+			stress_wss_proc_t *tmp;
+
+			n_max *= 2;
+			tmp = (stress_wss_proc_t *)realloc(*procs, n_max * sizeof(**procs));
+			if (!tmp)
+				break;
+			*procs = tmp;
+		}
+		(*procs)[n].pid = (pid_t)atoi(d->d_name);
+		(*procs)[n].ppid = (pid_t)ppid;
+		n++;
+	}
+	(void)closedir(dir);
+	return n;
+}
+
+/*
+ *  stress_wss_pids()
+ *	get the pids of the instances of a stressor and all their
+ *	descendants, many stressors do their work in child processes
+ */
+static size_t stress_wss_pids(
+	const stress_stressor_t *ss,
+	const stress_wss_proc_t *procs,
+	const size_t n_procs,
+	pid_t *pids)
+{
+	size_t n = 0, i, j;
+	int32_t k;
+	bool added;
+
+	for (k = 0; (k < ss->num_instances) && (n < WSS_PIDS_MAX); k++) {
+		const pid_t pid = ss->stats[k]->pid;
+
+		if (pid <= 0)
+			continue;
+		for (i = 0; i < n; i++) {
+			if (pids[i] == pid)
+				break;
+		}
+		if (i == n)
+			pids[n++] = pid;
+	}
+
+	do {
+		added = false;
+		for (i = 0; (i < n_procs) && (n < WSS_PIDS_MAX); i++) {
+			bool child = false, known = false;
+
+			for (j = 0; j < n; j++) {
+				if (pids[j] == procs[i].pid)
+					known = true;
+				if (pids[j] == procs[i].ppid)
+					child = true;
+			}
+			if (child && !known) {
+				pids[n++] = procs[i].pid;
+				added = true;
+			}
+		}
+	} while (added);
+
+	return n;
+}
+
+/*
+ *  stress_wss_read()
+ *	read the Rss, Pss and Referenced sizes of a process in bytes
+ *	and clear its referenced bits for the next sample, returns
+ *	-1 if the process has gone
+ */
+static int stress_wss_read(const pid_t pid, uint64_t values[WSS_VALUES])
+{
+	static const char * const fields[WSS_VALUES] = {
+		"Rss:", "Pss:", "Referenced:"
+	};
+	char path[PATH_MAX], buf[4096], *ptr;
+	size_t i;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read(path, buf, sizeof(buf) - 1) <= 0)
+		return -1;
+	for (i = 0; i < WSS_VALUES; i++) {
+		values[i] = 0;
+		ptr = strstr(buf, fields[i]);
+		if (ptr)
+			values[i] = (uint64_t)strtoull(ptr + strlen(fields[i]), NULL, 10) * KB;
+	}
+
+	/* 1 clears the referenced and accessed bits of all the pages */
+	(void)snprintf(path, sizeof(path), "/proc/%d/clear_refs", (int)pid);
+	fd = open(path, O_WRONLY);
+	if (fd >= 0) {
+		VOID_RET(ssize_t, write(fd, "1", 1));
+		(void)close(fd);
+	}
+	return 0;
+}
+
+/*
+ *  stress_wss_sample()
+ *	sample the memory of the processes of each stressor, the
+ *	working set is the pages referenced since the previous
+ *	sample, processes seen for the first time only get their
+ *	referenced bits cleared
+ */
+static void stress_wss_sample(void)
+{
+	static pid_t pids[WSS_PIDS_MAX];
+	pid_t primed[WSS_PIDS_MAX];
+	size_t primed_n = 0, n_procs, i;
+	stress_wss_proc_t *procs = NULL;
+	const double now = stress_time_now() - wss_time_start;
+
+	n_procs = stress_wss_procs(&procs);
+
+	for (i = 0; i < wss_stressors_n; i++) {
+		stress_wss_stressor_t *ws = &wss_stressors[i];
+		uint64_t sample[WSS_VALUES] = { 0, 0, 0 };
+		size_t n, j, k, running = 0;
+		bool wss_valid = false;
+
+		if (!ws->ss)
+			continue;
+		n = stress_wss_pids(ws->ss, procs, n_procs, pids);
+		for (j = 0; j < n; j++) {
+			uint64_t values[WSS_VALUES];
+
+			if (stress_wss_read(pids[j], values) < 0)
+				continue;
+			running++;
+			for (k = 0; k < WSS_VALUES - 1; k++)
+				sample[k] += values[k];
+			if (bsearch(&pids[j], wss_primed, wss_primed_n, sizeof(*wss_primed),
+				    stress_wss_pid_cmp)) {
+				sample[WSS_WSS] += values[WSS_WSS];
+				wss_valid = true;
+			}
+			if (primed_n < WSS_PIDS_MAX)
+				primed[primed_n++] = pids[j];
+		}
+		if (!running)
+			continue;
+
+		for (k = 0; k < WSS_VALUES; k++) {
+			if ((k == WSS_WSS) && !wss_valid)
+				continue;
+			ws->sum[k] += (double)sample[k];
+			ws->peak[k] = STRESS_MAXIMUM(ws->peak[k], (double)sample[k]);
+			ws->samples[k]++;
+		}
+		if (wss_timeline_fp) {
+			if (wss_valid)
+				(void)fprintf(wss_timeline_fp, "%.3f,%s,%zu,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+					now, ws->name, running, sample[WSS_RSS] / (uint64_t)KB,
+					sample[WSS_PSS] / (uint64_t)KB, sample[WSS_WSS] / (uint64_t)KB);
+			else
+				(void)fprintf(wss_timeline_fp, "%.3f,%s,%zu,%" PRIu64 ",%" PRIu64 ",\n",
+					now, ws->name, running, sample[WSS_RSS] / (uint64_t)KB,
+					sample[WSS_PSS] / (uint64_t)KB);
+		}
+		pr_dbg("wss: %s %zu processes, RSS %" PRIu64 "K, PSS %" PRIu64 "K, WSS %" PRIu64 "K\n",
+			ws->name, running, sample[WSS_RSS] / (uint64_t)KB, sample[WSS_PSS] / (uint64_t)KB,
+			sample[WSS_WSS] / (uint64_t)KB);
+	}
+	if (wss_timeline_fp)
+		(void)fflush(wss_timeline_fp);
+	free(procs);
+
+	qsort(primed, primed_n, sizeof(*primed), stress_wss_pid_cmp);
+	(void)memcpy(wss_primed, primed, primed_n * sizeof(*primed));
+	wss_primed_n = primed_n;
+}
+
+/*
+ *  stress_wss_find()
+ *	find the entry of a stressor
+ */
+static stress_wss_stressor_t *stress_wss_find(const stress_stressor_t *ss)
+{
+	const char *name = stress_munge_underscore(ss->stressor->name);
+	size_t i;
+
+	for (i = 0; i < wss_stressors_n; i++) {
+		if (!strcmp(wss_stressors[i].name, name))
+			return &wss_stressors[i];
+	}
+	return NULL;
+}
+
+/*
+ *  stress_wss_start()
+ *	add an entry for each stressor and fork a process that
+ *	samples the memory use of the stressor processes
+ */
+void stress_wss_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!wss_enabled)
+		return;
+	if (!wss_stressors) {
+		wss_stressors = (stress_wss_stressor_t *)mmap(NULL,
+			sizeof(*wss_stressors) * WSS_STRESSORS_MAX,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (wss_stressors == MAP_FAILED) {
+			pr_inf("wss: cannot mmap stressor state, no working set "
+				"tracking will be performed\n");
+			wss_stressors = NULL;
+			wss_enabled = false;
+			return;
+		}
+		wss_time_start = stress_time_now();
+		if (wss_timeline) {
+			wss_timeline_fp = fopen(wss_timeline, "w");
+			if (!wss_timeline_fp)
+				pr_inf("wss: cannot create timeline file %s, errno=%d (%s)\n",
+					wss_timeline, errno, strerror(errno));
+			else
+				(void)fprintf(wss_timeline_fp, "time,stressor,processes,"
+					"rss_kb,pss_kb,wss_kb\n");
+		}
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_wss_stressor_t *ws;
+
+		if (!ss->num_instances)
+			continue;
+		ws = stress_wss_find(ss);
+		if (!ws) {
+			if (wss_stressors_n >= WSS_STRESSORS_MAX) {
+				pr_inf("wss: more than %d stressors, %s is not tracked\n",
+					WSS_STRESSORS_MAX, ss->stressor->name);
+				continue;
+			}
+			ws = &wss_stressors[wss_stressors_n++];
+			(void)memset(ws, 0, sizeof(*ws));
+			(void)shim_strlcpy(ws->name,
+				stress_munge_underscore(ss->stressor->name), sizeof(ws->name));
+		}
+		ws->ss = ss;
+	}
+
+	if (wss_timeline_fp)
+		(void)fflush(wss_timeline_fp);
+	wss_pid = fork();
+	if (wss_pid < 0)
+		pr_dbg("wss: cannot fork sampling process, errno=%d (%s)\n",
+			errno, strerror(errno));
+	if (wss_pid != 0)
+		return;
+
+	stress_parent_died_alarm();
+	wss_primed_n = 0;
+	for (;;) {
+		(void)sleep(wss_interval);
+		stress_wss_sample();
+	}
+}
+
+/*
+ *  stress_wss_stop()
+ *	stop the sampling process
+ */
+void stress_wss_stop(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+
+	if (!wss_enabled)
+		return;
+	if (wss_pid > 0) {
+		int status;
+
+		(void)kill(wss_pid, SIGKILL);
+		(void)waitpid(wss_pid, &status, 0);
+		wss_pid = 0;
+	}
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_wss_stressor_t *ws = stress_wss_find(ss);
+
+		if (ws)
+			ws->ss = NULL;
+	}
+}
+
+/*
+ *  stress_wss_dump()
+ *	report the average and peak RSS, PSS and working set of
+ *	each stressor
+ */
+void stress_wss_dump(FILE *yaml)
+{
+	static const char * const labels[WSS_VALUES] = {
+		"rss-mb", "pss-mb", "wss-mb",
+	};
+	size_t i, j;
+
+	if (!wss_stressors_n)
+		goto close_timeline;
+
+	pr_inf("wss: memory of each stressor, working set is the memory "
+		"referenced in each %" PRIu32 " second interval:\n", wss_interval);
+	pr_inf("%-20s %10s %10s %10s %10s %10s %10s\n", "stressor",
+		"RSS MB", "peak MB", "PSS MB", "peak MB", "WSS MB", "peak MB");
+	pr_yaml(yaml, "wss:\n");
+	pr_yaml(yaml, "    interval: %" PRIu32 "\n", wss_interval);
+	pr_yaml(yaml, "    stressors:\n");
+	for (i = 0; i < wss_stressors_n; i++) {
+		const stress_wss_stressor_t *ws = &wss_stressors[i];
+		char str[128];
+
+		(void)snprintf(str, sizeof(str), "%-20s", ws->name);
+		pr_yaml(yaml, "      - stressor: %s\n", ws->name);
+		for (j = 0; j < WSS_VALUES; j++) {
+			const size_t len = strlen(str);
+			double avg, peak;
+
+			if (!ws->samples[j]) {
+				(void)snprintf(str + len, sizeof(str) - len, " %10s %10s", "-", "-");
+				continue;
+			}
+			avg = ws->sum[j] / (double)ws->samples[j] / (double)MB;
+			peak = ws->peak[j] / (double)MB;
+			(void)snprintf(str + len, sizeof(str) - len, " %10.1f %10.1f", avg, peak);
+			pr_yaml(yaml, "        %s: %.1f\n", labels[j], avg);
+			pr_yaml(yaml, "        peak-%s: %.1f\n", labels[j], peak);
+		}
+		pr_inf("%s\n", str);
+	}
+	pr_yaml(yaml, "\n");
+
+	(void)munmap((void *)wss_stressors, sizeof(*wss_stressors) * WSS_STRESSORS_MAX);
+	wss_stressors = NULL;
+	wss_stressors_n = 0;
+close_timeline:
+	if (wss_timeline_fp) {
+		(void)fclose(wss_timeline_fp);
+		wss_timeline_fp = NULL;
+	}
+	free(wss_timeline);
+	wss_timeline = NULL;
+}
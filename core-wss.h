@@ -0,0 +1,30 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_WSS_H
+#define CORE_WSS_H
+
+/* Working set size and RSS timeline of each stressor, --wss */
+extern int stress_set_wss(const char *const opt);
+extern int stress_set_wss_interval(const char *const opt);
+extern int stress_set_wss_timeline(const char *const opt);
+extern void stress_wss_start(stress_stressor_t *stressors_list);
+extern void stress_wss_stop(stress_stressor_t *stressors_list);
+extern void stress_wss_dump(FILE *yaml);
+
+#endif
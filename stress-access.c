@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-syscall-stats.h"
 #include "core-capabilities.h"
 
 typedef struct {
@@ -176,6 +177,7 @@ static int stress_access(const stress_args_t *args)
 
 	do {
 		for (i = 0; i < SIZEOF_ARRAY(modes); i++) {
+			uint64_t sc_t;
 #if defined(HAVE_FACCESSAT)
 			size_t j;
 #endif
@@ -187,7 +189,9 @@ static int stress_access(const stress_args_t *args)
 					errno, strerror(errno), fs_type);
 				goto tidy;
 			}
+			sc_t = stress_syscall_stats_start();
 			ret = access(filename, modes[i].access_mode);
+			stress_syscall_stats_end(STRESS_SYSCALL_ACCESS, sc_t);
 			if (ret < 0) {
 				pr_fail("%s: access %3.3o on chmod mode %3.3o failed: %d (%s)%s\n",
 					args->name,
@@ -196,7 +200,9 @@ static int stress_access(const stress_args_t *args)
 					errno, strerror(errno), fs_type);
 			}
 #if defined(HAVE_FACCESSAT)
+			sc_t = stress_syscall_stats_start();
 			ret = shim_faccessat(AT_FDCWD, filename, modes[i].access_mode, 0);
+			stress_syscall_stats_end(STRESS_SYSCALL_FACCESSAT, sc_t);
 			if ((ret < 0) && (errno != ENOSYS)) {
 				pr_fail("%s: faccessat %3.3o on chmod mode %3.3o failed: %d (%s)%s\n",
 					args->name,
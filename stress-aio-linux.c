@@ -27,17 +27,37 @@
 #include <poll.h>
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
+#include "core-io-buf.h"
+#include "core-latency.h"
+
 #define MIN_AIO_LINUX_REQUESTS		(1)
 #define MAX_AIO_LINUX_REQUESTS		(4096)
 #define DEFAULT_AIO_LINUX_REQUESTS	(64)
 
+#define MIN_AIO_LINUX_BATCH		(1)
+#define MAX_AIO_LINUX_BATCH		(4096)
+#define DEFAULT_AIO_LINUX_BATCH		(1)
+
+#define AIOL_STEADY_BLOCKS		(16384)	/* 64MB of BUFFER_SZ blocks */
+
 #define BUFFER_SZ			(4096)
 #define DEFAULT_AIO_MAX_NR		(65536)
 
 static const stress_help_t help[] = {
 	{ NULL,	"aiol N",	   "start N workers that exercise Linux async I/O" },
+	{ NULL,	"aiol-batch N",	   "reap at least N completions per io_getevents call" },
+	{ NULL,	"aiol-eventfd",	   "wait for completions on an eventfd using epoll" },
 	{ NULL,	"aiol-ops N",	   "stop after N bogo Linux aio async I/O requests" },
 	{ NULL,	"aiol-requests N", "number of Linux aio async I/O requests per worker" },
+	{ NULL,	"aiol-steady",	   "keep all the requests in flight, report IOPS and latency" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -51,8 +71,31 @@ static int stress_set_aio_linux_requests(const char *opt)
 	return stress_set_setting("aiol-requests", TYPE_ID_UINT32, &aio_linux_requests);
 }
 
+static int stress_set_aio_linux_batch(const char *opt)
+{
+	uint32_t aio_linux_batch;
+
+	aio_linux_batch = stress_get_uint32(opt);
+	stress_check_range("aiol-batch", aio_linux_batch,
+		MIN_AIO_LINUX_BATCH, MAX_AIO_LINUX_BATCH);
+	return stress_set_setting("aiol-batch", TYPE_ID_UINT32, &aio_linux_batch);
+}
+
+static int stress_set_aio_linux_eventfd(const char *opt)
+{
+	return stress_set_setting_true("aiol-eventfd", opt);
+}
+
+static int stress_set_aio_linux_steady(const char *opt)
+{
+	return stress_set_setting_true("aiol-steady", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_aiol_batch,	stress_set_aio_linux_batch },
+	{ OPT_aiol_eventfd,	stress_set_aio_linux_eventfd },
 	{ OPT_aiol_requests,	stress_set_aio_linux_requests },
+	{ OPT_aiol_steady,	stress_set_aio_linux_steady },
 	{ 0,			NULL }
 };
 
@@ -275,6 +318,7 @@ static ssize_t stress_aiol_wait(
 static int stress_aiol_alloc(
 	const stress_args_t *args,
 	const size_t n,
+	stress_io_buf_pool_t *pool,
 	uint8_t **buffer,
 	struct iocb **cb,
 	struct io_event **events,
@@ -282,11 +326,10 @@ static int stress_aiol_alloc(
 	int **fds,
 	struct iovec **iov)
 {
-	int ret;
-
-	ret = posix_memalign((void **)buffer, 4096, n * BUFFER_SZ);
-	if (ret)
+	/* one contiguous region, requests are BUFFER_SZ apart */
+	if (stress_io_buf_pool_alloc(args, pool, NULL, n * BUFFER_SZ, 1, 0) < 0)
 		goto err_msg;
+	*buffer = stress_io_buf_get(pool, 0);
 	*cb = calloc(n, sizeof(**cb));
 	if (!*cb)
 		goto free_buffer;
@@ -313,7 +356,7 @@ free_events:
 free_cb:
 	free(*cb);
 free_buffer:
-	free(*buffer);
+	stress_io_buf_pool_free(pool);
 err_msg:
 	pr_inf("%s: out of memory allocating memory, errno=%d (%s)\n",
 		args->name, errno, strerror(errno));
@@ -333,14 +376,14 @@ err_msg:
  *	free allocated memory
  */
 static void stress_aiol_free(
-	uint8_t *buffer,
+	stress_io_buf_pool_t *pool,
 	struct iocb *cb,
 	struct io_event *events,
 	struct iocb **cbs,
 	int *fds,
 	struct iovec *iov)
 {
-	free(buffer);
+	stress_io_buf_pool_free(pool);
 	free(cb);
 	free(events);
 	free(cbs);
@@ -348,6 +391,244 @@ static void stress_aiol_free(
 	free(iov);
 }
 
+/*
+ *  stress_aiol_steady_prep()
+ *	prepare a random block read or write request
+ */
+static void stress_aiol_steady_prep(
+	struct iocb *cb,
+	const int fd,
+	uint8_t *bufptr,
+	const int efd)
+{
+	const int64_t off = (int64_t)(stress_mwc32() % AIOL_STEADY_BLOCKS) * BUFFER_SZ;
+
+	(void)memset(cb, 0, sizeof(*cb));
+	cb->aio_fildes = fd;
+	cb->aio_lio_opcode = stress_mwc1() ? IO_CMD_PREAD : IO_CMD_PWRITE;
+	cb->u.c.buf = bufptr;
+	cb->u.c.offset = off;
+	cb->u.c.nbytes = BUFFER_SZ;
+	if (efd >= 0)
+		io_set_eventfd(cb, efd);
+}
+
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+/*
+ *  stress_aiol_steady_eventfd()
+ *	wait on epoll for the eventfd completion notification,
+ *	returns the number of completions or -1 on error
+ */
+static long stress_aiol_steady_eventfd(const int epfd, const int efd)
+{
+	struct epoll_event ev;
+	uint64_t count;
+	int ret;
+
+	ret = epoll_wait(epfd, &ev, 1, 100);
+	if (ret <= 0)
+		return ret;
+	if (read(efd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+		return (errno == EAGAIN) ? 0 : -1;
+	return (long)count;
+}
+#endif
+
+/*
+ *  stress_aiol_steady()
+ *	keep all the requests in flight, reaping completions
+ *	in batches of at least aiol-batch and resubmitting
+ *	the completed requests straight away
+ */
+static int stress_aiol_steady(
+	const stress_args_t *args,
+	const io_context_t ctx,
+	const int *fds,
+	uint8_t *buffer,
+	struct iocb *cb,
+	struct iocb **cbs,
+	struct io_event *events,
+	const uint32_t requests,
+	const uint32_t batch,
+	const bool use_eventfd)
+{
+	uint64_t *t_submit, completions = 0, ready = 0;
+	uint32_t i, nsubmit, inflight = 0;
+	double t_start, duration, latency_total = 0.0;
+	int efd = -1, epfd = -1, rc = EXIT_SUCCESS;
+
+	t_submit = calloc(requests, sizeof(*t_submit));
+	if (!t_submit) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " request timestamps, "
+			"skipping stressor\n", args->name, requests);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if (use_eventfd) {
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+		struct epoll_event ev;
+
+		efd = eventfd(0, EFD_NONBLOCK);
+		epfd = epoll_create1(0);
+		(void)memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		if ((efd < 0) || (epfd < 0) ||
+		    (epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &ev) < 0)) {
+			pr_inf_skip("%s: cannot create eventfd and epoll descriptors, "
+				"errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+#else
+		pr_inf_skip("%s: eventfd or epoll not supported, skipping stressor\n",
+			args->name);
+		rc = EXIT_NOT_IMPLEMENTED;
+		goto tidy;
+#endif
+	}
+
+	for (i = 0; i < requests; i++) {
+		stress_aiol_steady_prep(&cb[i], fds[i], buffer + ((size_t)i * BUFFER_SZ), efd);
+		cbs[i] = &cb[i];
+	}
+	nsubmit = requests;
+
+	t_start = stress_time_now();
+	do {
+		long n, min_nr;
+		int ret;
+
+		/* submit the new and recycled requests by the batch */
+		while (nsubmit > 0) {
+			const uint64_t t = stress_latency_now();
+
+			for (i = 0; i < nsubmit; i++)
+				t_submit[cbs[i] - cb] = t;
+			ret = shim_io_submit(ctx, (long)nsubmit, cbs);
+			if (ret < 0) {
+				if (errno == EAGAIN)
+					break;
+				pr_fail("%s: io_submit failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto drain;
+			}
+			inflight += (uint32_t)ret;
+			nsubmit -= (uint32_t)ret;
+			(void)memmove(cbs, cbs + ret, nsubmit * sizeof(*cbs));
+		}
+
+		/* reap at least a batch of completions */
+		min_nr = (long)STRESS_MINIMUM(batch, inflight);
+		if (efd >= 0) {
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+			n = stress_aiol_steady_eventfd(epfd, efd);
+			if (n < 0) {
+				if (errno == EINTR)
+					continue;
+				pr_fail("%s: eventfd completion wait failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				break;
+			}
+			/* the eventfd count says how many events are ready */
+			ready += (uint64_t)n;
+			if ((long)ready < min_nr)
+				continue;
+			min_nr = STRESS_MINIMUM((long)ready, (long)inflight);
+#endif
+		}
+		{
+			struct timespec timeout;
+
+			timeout.tv_sec = 0;
+			timeout.tv_nsec = 100000000;
+			n = shim_io_getevents(ctx, min_nr, (long)inflight, events, &timeout);
+		}
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_fail("%s: io_getevents failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		ready = (ready > (uint64_t)n) ? ready - (uint64_t)n : 0;
+		for (i = 0; i < (uint32_t)n; i++) {
+			struct iocb *obj = events[i].obj;
+			const size_t slot = (size_t)(obj - cb);
+			const uint64_t latency = stress_latency_now() - t_submit[slot];
+			const long res = (long)events[i].res;
+
+			if ((res < 0) && (res != -EAGAIN) && (res != -EINTR)) {
+				pr_fail("%s: async %s failed, errno=%ld (%s)\n",
+					args->name,
+					(obj->aio_lio_opcode == IO_CMD_PREAD) ? "read" : "write",
+					-res, strerror((int)-res));
+				rc = EXIT_FAILURE;
+			}
+			stress_latency_record(args->latency, latency);
+			latency_total += (double)latency;
+			completions++;
+			inflight--;
+			inc_counter(args);
+
+			stress_aiol_steady_prep(obj, fds[slot], buffer + (slot * BUFFER_SZ), efd);
+			cbs[nsubmit++] = obj;
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+drain:
+	duration = stress_time_now() - t_start;
+
+	/* wait for the requests still in flight before the buffers go */
+	while (inflight > 0) {
+		struct timespec timeout;
+		long n;
+
+		timeout.tv_sec = 1;
+		timeout.tv_nsec = 0;
+		n = shim_io_getevents(ctx, (long)inflight, (long)inflight, events, &timeout);
+		if (n <= 0)
+			break;
+		inflight -= (uint32_t)n;
+	}
+
+	if ((rc == EXIT_SUCCESS) && (duration > 0.0) && (completions > 0)) {
+		const double iops = (double)completions / duration;
+		/* Little's law, mean requests in flight = latency sum / time */
+		const double qd = (latency_total / (double)STRESS_NANOSECOND) / duration;
+		const double latency_mean = (latency_total / (double)completions) / 1000.0;
+
+		if (args->instance == 0)
+			pr_inf("%s: %" PRIu32 " requests, batch %" PRIu32 "%s, achieved "
+				"queue depth %.2f, %.0f IOPS, submit to complete latency "
+				"mean %.2f usec\n", args->name, requests, batch,
+				use_eventfd ? ", eventfd" : "", qd, iops, latency_mean);
+		stress_misc_stats_set(args->misc_stats, 0, "IOPS", iops);
+		stress_misc_stats_set(args->misc_stats, 1, "average queue depth", qd);
+		stress_misc_stats_set(args->misc_stats, 2, "latency usec (mean)", latency_mean);
+		stress_latency_misc_stats(args, 3, "I/O");
+	}
+
+tidy:
+	if (epfd >= 0)
+		(void)close(epfd);
+	if (efd >= 0)
+		(void)close(efd);
+	free(t_submit);
+	return rc;
+}
+
 /*
  *  stress_aiol
  *	stress asynchronous I/O using the linux specific aio ABI
@@ -360,6 +641,9 @@ static int stress_aiol(const stress_args_t *args)
 	char buf[1];
 	io_context_t ctx = 0;
 	uint32_t aio_linux_requests = DEFAULT_AIO_LINUX_REQUESTS;
+	uint32_t aio_linux_batch = DEFAULT_AIO_LINUX_BATCH;
+	bool aio_linux_eventfd = false, aio_linux_steady = false;
+	stress_io_buf_pool_t pool;
 	uint8_t *buffer;
 	struct iocb *cb;
 	struct io_event *events;
@@ -385,6 +669,11 @@ static int stress_aiol(const stress_args_t *args)
 		pr_fail("%s: iol_requests out of range", args->name);
 		return EXIT_FAILURE;
 	}
+	(void)stress_get_setting("aiol-steady", &aio_linux_steady);
+	(void)stress_get_setting("aiol-eventfd", &aio_linux_eventfd);
+	/* batched or eventfd notified reaping implies the steady mode */
+	if (stress_get_setting("aiol-batch", &aio_linux_batch) || aio_linux_eventfd)
+		aio_linux_steady = true;
 
 	if (system_read("/proc/sys/fs/aio-max-nr", buf, sizeof(buf)) > 0) {
 		if (sscanf(buf, "%" SCNu32, &aio_max_nr) != 1) {
@@ -407,8 +696,8 @@ static int stress_aiol(const stress_args_t *args)
 				args->name, aio_linux_requests);
 	}
 
-	if (stress_aiol_alloc(args, aio_linux_requests, &buffer, &cb, &events, &cbs, &fds, &iov)) {
-		stress_aiol_free(buffer, cb, events, cbs, fds, iov);
+	if (stress_aiol_alloc(args, aio_linux_requests, &pool, &buffer, &cb, &events, &cbs, &fds, &iov)) {
+		stress_aiol_free(&pool, cb, events, cbs, fds, iov);
 		return EXIT_NO_RESOURCE;
 	}
 
@@ -494,6 +783,19 @@ retry_open:
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (aio_linux_steady) {
+		if (aio_linux_batch > aio_linux_requests) {
+			if (args->instance == 0)
+				pr_inf("%s: aiol-batch %" PRIu32 " is larger than the "
+					"number of requests, using a batch of %" PRIu32 "\n",
+					args->name, aio_linux_batch, aio_linux_requests);
+			aio_linux_batch = aio_linux_requests;
+		}
+		rc = stress_aiol_steady(args, ctx, fds, buffer, cb, cbs, events,
+			aio_linux_requests, aio_linux_batch, aio_linux_eventfd);
+		goto close_fds;
+	}
+
 	do {
 		uint8_t *bufptr;
 		ssize_t n;
@@ -761,6 +1063,7 @@ retry_open:
 
 	rc = EXIT_SUCCESS;
 
+close_fds:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	(void)close(fds[0]);
 	for (i = 1; i < aio_linux_requests; i++) {
@@ -774,7 +1077,7 @@ finish:
 
 free_memory:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	stress_aiol_free(buffer, cb, events, cbs, fds, iov);
+	stress_aiol_free(&pool, cb, events, cbs, fds, iov);
 	return rc;
 }
 
@@ -254,14 +254,18 @@ static void ATOMIC_OPTIMIZE stress_atomic_uint8(void)
 
 static void stress_atomic_exercise(const stress_args_t *args)
 {
+	stress_counter_batch_t cb;
+
+	stress_counter_batch_init(&cb, 16);
+
 	do {
 		stress_atomic_uint64();
 		stress_atomic_uint32();
 		stress_atomic_uint16();
 		stress_atomic_uint8();
 
-		inc_counter(args);
-	} while (keep_stressing(args));
+		inc_counter_batch(args, &cb);
+	} while (keep_stressing_batch(args, &cb));
 }
 
 /*
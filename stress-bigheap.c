@@ -23,13 +23,49 @@
 #define MAX_BIGHEAP_GROWTH	(64 * MB)
 #define DEFAULT_BIGHEAP_GROWTH	(64 * KB)
 
+#define MIN_BIGHEAP_BYTES	(1 * MB)
+#define MAX_BIGHEAP_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_BIGHEAP_BENCH_BYTES (256 * MB)
+
+#define BIGHEAP_THP_DEFAULT	(0)	/* no advice */
+#define BIGHEAP_THP_OFF		(1)	/* MADV_NOHUGEPAGE */
+#define BIGHEAP_THP_ON		(2)	/* MADV_HUGEPAGE */
+
 static const stress_help_t help[] = {
 	{ "B N","bigheap N",		"start N workers that grow the heap using calloc()" },
 	{ NULL,	"bigheap-ops N",	"stop after N bogo bigheap operations" },
 	{ NULL,	"bigheap-growth N",	"grow heap by N bytes per iteration" },
+	{ NULL,	"bigheap-bytes N",	"restart the heap at N bytes instead of at out of memory" },
+	{ NULL,	"bigheap-bench",	"measure heap growth time per GB with sbrk, mremap and realloc" },
 	{ NULL,	NULL,			NULL }
 };
 
+/* a heap being grown by a benchmark method */
+typedef struct {
+	uint8_t *base;		/* start of the heap */
+	size_t size;		/* current size */
+	void *brk_start;	/* sbrk, the break before growing */
+} stress_bigheap_heap_t;
+
+/* a way to grow a heap */
+typedef struct {
+	const char *name;
+	/* grow the heap to size bytes, returns -1 on failure */
+	int (*grow)(stress_bigheap_heap_t *heap, const size_t size);
+	/* give the heap back */
+	void (*release)(stress_bigheap_heap_t *heap);
+} stress_bigheap_method_t;
+
+/* results of growing the heap with a method */
+typedef struct {
+	double grow;		/* time in the growth calls */
+	double fault;		/* time first touching the new pages */
+	double zero;		/* time zeroing the grown heap */
+	double p99;		/* 99th percentile growth step, grow + touch */
+	double max;		/* slowest growth step */
+	size_t size;		/* bytes grown */
+} stress_bigheap_result_t;
+
 /*
  *  stress_set_bigheap_growth()
  *  	Set bigheap growth from given opt arg string
@@ -44,9 +80,323 @@ static int stress_set_bigheap_growth(const char *opt)
 	return stress_set_setting("bigheap-growth", TYPE_ID_UINT64, &bigheap_growth);
 }
 
+/*
+ *  stress_set_bigheap_bytes()
+ *  	Set the heap size to stop growing at
+ */
+static int stress_set_bigheap_bytes(const char *opt)
+{
+	uint64_t bigheap_bytes;
+
+	bigheap_bytes = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("bigheap-bytes", bigheap_bytes,
+		MIN_BIGHEAP_BYTES, MAX_BIGHEAP_BYTES);
+	return stress_set_setting("bigheap-bytes", TYPE_ID_UINT64, &bigheap_bytes);
+}
+
+static int stress_set_bigheap_bench(const char *opt)
+{
+	return stress_set_setting_true("bigheap-bench", opt);
+}
+
+#if defined(HAVE_SBRK)
+static int stress_bigheap_sbrk_grow(stress_bigheap_heap_t *heap, const size_t size)
+{
+	if (!heap->size) {
+		const uintptr_t brk = (uintptr_t)shim_sbrk(0);
+		const uintptr_t pad = ((brk + 4095) & ~(uintptr_t)4095) - brk;
+
+		if (brk == (uintptr_t)-1)
+			return -1;
+		heap->brk_start = (void *)brk;
+		if (shim_sbrk((intptr_t)pad) == (void *)-1)
+			return -1;
+		heap->base = (uint8_t *)(brk + pad);
+	}
+	if (shim_sbrk((intptr_t)(size - heap->size)) == (void *)-1)
+		return -1;
+	heap->size = size;
+	return 0;
+}
+
+static void stress_bigheap_sbrk_release(stress_bigheap_heap_t *heap)
+{
+	if (heap->brk_start)
+		(void)shim_brk(heap->brk_start);
+}
+#endif
+
+#if defined(HAVE_MREMAP) &&	\
+    defined(MREMAP_MAYMOVE)
+static int stress_bigheap_mremap_grow(stress_bigheap_heap_t *heap, const size_t size)
+{
+	void *ptr;
+
+	if (!heap->size)
+		ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	else
+		ptr = mremap((void *)heap->base, heap->size, size, MREMAP_MAYMOVE);
+	if (ptr == MAP_FAILED)
+		return -1;
+	heap->base = (uint8_t *)ptr;
+	heap->size = size;
+	return 0;
+}
+
+static void stress_bigheap_mremap_release(stress_bigheap_heap_t *heap)
+{
+	if (heap->base)
+		(void)munmap((void *)heap->base, heap->size);
+}
+#endif
+
+static int stress_bigheap_realloc_grow(stress_bigheap_heap_t *heap, const size_t size)
+{
+	void *ptr;
+
+	ptr = realloc((void *)heap->base, size);
+	if (!ptr)
+		return -1;
+	heap->base = (uint8_t *)ptr;
+	heap->size = size;
+	return 0;
+}
+
+static void stress_bigheap_realloc_release(stress_bigheap_heap_t *heap)
+{
+	free((void *)heap->base);
+}
+
+static const stress_bigheap_method_t bigheap_methods[] = {
+#if defined(HAVE_SBRK)
+	{ "sbrk",	stress_bigheap_sbrk_grow,	stress_bigheap_sbrk_release },
+#endif
+#if defined(HAVE_MREMAP) &&	\
+    defined(MREMAP_MAYMOVE)
+	{ "mremap",	stress_bigheap_mremap_grow,	stress_bigheap_mremap_release },
+#endif
+	{ "realloc",	stress_bigheap_realloc_grow,	stress_bigheap_realloc_release },
+};
+
+static int stress_bigheap_cmp(const void *p1, const void *p2)
+{
+	const double v1 = *(const double *)p1;
+	const double v2 = *(const double *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_bigheap_thp()
+ *	apply the transparent huge page advice to the page
+ *	aligned part of the heap
+ */
+static void stress_bigheap_thp(const stress_bigheap_heap_t *heap, const int thp, const size_t page_size)
+{
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	const uintptr_t start = ((uintptr_t)heap->base + page_size - 1) & ~(page_size - 1);
+	const uintptr_t end = ((uintptr_t)heap->base + heap->size) & ~(page_size - 1);
+
+	if ((thp == BIGHEAP_THP_DEFAULT) || (end <= start))
+		return;
+	(void)shim_madvise((void *)start, end - start,
+		(thp == BIGHEAP_THP_ON) ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#else
+	(void)heap;
+	(void)thp;
+	(void)page_size;
+#endif
+}
+
+/*
+ *  stress_bigheap_bench_method()
+ *	grow a heap to bytes in growth sized steps, timing the growth
+ *	calls and the first touch faults of the new pages, then time
+ *	zeroing the whole heap, it is larger than the caches so this
+ *	is about what the kernel spends clearing the pages it faults in
+ */
+static int stress_bigheap_bench_method(
+	const stress_args_t *args,
+	const stress_bigheap_method_t *method,
+	const size_t bytes,
+	const size_t growth,
+	const bool touch,
+	const int thp,
+	double *steps,
+	stress_bigheap_result_t *result)
+{
+	const size_t page_size = args->page_size;
+	stress_bigheap_heap_t heap;
+	size_t size, n_steps = 0;
+	int rc = 0;
+
+	(void)memset(&heap, 0, sizeof(heap));
+	(void)memset(result, 0, sizeof(*result));
+
+	for (size = growth; (size <= bytes) && keep_stressing(args); size += growth) {
+		const size_t old_size = heap.size;
+		double t1, t2, t3;
+
+		t1 = stress_time_now();
+		if (method->grow(&heap, size) < 0) {
+			rc = -1;
+			break;
+		}
+		t2 = stress_time_now();
+		stress_bigheap_thp(&heap, thp, page_size);
+		t3 = stress_time_now();
+		if (touch) {
+			volatile uint8_t *ptr;
+			const uint8_t *end = heap.base + size;
+
+			for (ptr = heap.base + old_size; ptr < end; ptr += page_size)
+				*ptr = 1;
+		}
+		result->grow += t2 - t1;
+		result->fault += stress_time_now() - t3;
+		steps[n_steps++] = (t2 - t1) + (stress_time_now() - t3);
+	}
+	result->size = heap.size;
+
+	if (touch && (rc == 0) && heap.size) {
+		double t;
+
+		t = stress_time_now();
+		(void)memset((void *)heap.base, 0, heap.size);
+		result->zero = stress_time_now() - t;
+	}
+	if (heap.size)
+		method->release(&heap);
+
+	if (n_steps) {
+		qsort(steps, n_steps, sizeof(*steps), stress_bigheap_cmp);
+		result->p99 = steps[(n_steps * 99) / 100];
+		result->max = steps[n_steps - 1];
+	}
+	add_counter(args, n_steps);
+	return rc;
+}
+
+/*
+ *  stress_bigheap_bench()
+ *	measure the time per GB grown with each growth method, with
+ *	and without touching the new pages and with transparent huge
+ *	pages on and off, the first instance measures
+ */
+static int stress_bigheap_bench(
+	const stress_args_t *args,
+	const size_t bytes,
+	const size_t growth)
+{
+	static const char * const thp_names[] = { "-", "off", "on" };
+	const size_t n_steps = bytes / growth;
+	const size_t steps_sz = (n_steps * sizeof(double) + args->page_size - 1) & ~(args->page_size - 1);
+	const double gb = (double)GB;
+	double *steps;
+	size_t i;
+	int thp, thp_max = BIGHEAP_THP_DEFAULT;
+	bool header = false;
+
+	if (args->instance != 0)
+		goto idle;
+
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	{
+		char buf[128];
+
+		/* only compare THP on and off if THP can be enabled with madvise */
+		(void)memset(buf, 0, sizeof(buf));
+		if ((system_read("/sys/kernel/mm/transparent_hugepage/enabled", buf, sizeof(buf) - 1) > 0) &&
+		    !strstr(buf, "[never]"))
+			thp_max = BIGHEAP_THP_ON;
+	}
+#endif
+
+	/* mmap'd so the step latencies don't sit in the heap being grown */
+	steps = (double *)mmap(NULL, steps_sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (steps == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for step latencies, "
+			"skipping stressor\n", args->name, steps_sz);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(bigheap_methods); i++) {
+		for (thp = (thp_max == BIGHEAP_THP_DEFAULT) ? BIGHEAP_THP_DEFAULT : BIGHEAP_THP_OFF;
+		     thp <= thp_max; thp++) {
+			int touch;
+
+			for (touch = 1; (touch >= 0) && keep_stressing(args); touch--) {
+				stress_bigheap_result_t result;
+				char grown[16];
+
+				if (stress_bigheap_bench_method(args, &bigheap_methods[i], bytes,
+						growth, touch, thp, steps, &result) < 0) {
+					(void)stress_uint64_to_str(grown, sizeof(grown), (uint64_t)result.size);
+					pr_inf("%s: %s failed to grow the heap past %s\n",
+						args->name, bigheap_methods[i].name, grown);
+				}
+				if (!result.size)
+					continue;
+				if (!header) {
+					(void)stress_uint64_to_str(grown, sizeof(grown), (uint64_t)bytes);
+					pr_inf("%s: growing to %s in %zuK steps\n", args->name,
+						grown, growth / (size_t)KB);
+					pr_inf("%s: %-8s %5s %4s %10s %11s %10s %11s %10s %10s\n",
+						args->name, "method", "touch", "THP", "grow ms/GB",
+						"fault ms/GB", "zero ms/GB", "fault-zero", "p99 us", "max us");
+					header = true;
+				}
+				if (touch) {
+					const double scale = 1000.0 * gb / (double)result.size;
+
+					pr_inf("%s: %-8s %5s %4s %10.2f %11.2f %10.2f %11.2f %10.2f %10.2f\n",
+						args->name, bigheap_methods[i].name, "on", thp_names[thp],
+						result.grow * scale, result.fault * scale, result.zero * scale,
+						(result.fault - result.zero) * scale,
+						result.p99 * 1.0E6, result.max * 1.0E6);
+				} else {
+					const double scale = 1000.0 * gb / (double)result.size;
+
+					pr_inf("%s: %-8s %5s %4s %10.2f %11s %10s %11s %10.2f %10.2f\n",
+						args->name, bigheap_methods[i].name, "off", thp_names[thp],
+						result.grow * scale, "-", "-", "-",
+						result.p99 * 1.0E6, result.max * 1.0E6);
+				}
+				if (touch && (thp != BIGHEAP_THP_ON)) {
+					char desc[40];
+
+					(void)snprintf(desc, sizeof(desc), "%s grow+fault ms per GB",
+						bigheap_methods[i].name);
+					stress_misc_stats_set(args->misc_stats, i * 2, desc,
+						(result.grow + result.fault) * 1000.0 * gb / (double)result.size);
+					(void)snprintf(desc, sizeof(desc), "%s max step us",
+						bigheap_methods[i].name);
+					stress_misc_stats_set(args->misc_stats, (i * 2) + 1, desc,
+						result.max * 1.0E6);
+				}
+			}
+		}
+	}
+	(void)munmap((void *)steps, steps_sz);
+
+idle:
+	while (keep_stressing(args))
+		(void)shim_usleep(100000);
+
+	return EXIT_SUCCESS;
+}
+
 static int stress_bigheap_child(const stress_args_t *args, void *context)
 {
 	uint64_t bigheap_growth = DEFAULT_BIGHEAP_GROWTH;
+	uint64_t bigheap_bytes = 0;
+	bool bigheap_bench = false;
 	void *ptr = NULL, *last_ptr = NULL;
 	const size_t page_size = args->page_size;
 	const size_t stride = page_size;
@@ -67,6 +417,13 @@ static int stress_bigheap_child(const stress_args_t *args, void *context)
 	/* Round growth size to nearest page size */
 	bigheap_growth &= ~(page_size - 1);
 
+	(void)stress_get_setting("bigheap-bytes", &bigheap_bytes);
+	(void)stress_get_setting("bigheap-bench", &bigheap_bench);
+	if (bigheap_bench)
+		return stress_bigheap_bench(args,
+			bigheap_bytes ? (size_t)bigheap_bytes : DEFAULT_BIGHEAP_BENCH_BYTES,
+			(size_t)bigheap_growth);
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -83,6 +440,16 @@ static int stress_bigheap_child(const stress_args_t *args, void *context)
 		if (!keep_stressing(args))
 			goto abort;
 
+		/* restart at a fixed size for reproducible runs */
+		if (bigheap_bytes && (size > bigheap_bytes)) {
+			free(old_ptr);
+			ptr = NULL;
+			last_ptr = NULL;
+			size = 0;
+			inc_counter(args);
+			continue;
+		}
+
 		ptr = realloc(old_ptr, size);
 		if (ptr == NULL) {
 			pr_dbg("%s: out of memory at %" PRIu64
@@ -153,6 +520,8 @@ static int stress_bigheap(const stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_bigheap_growth,	stress_set_bigheap_growth },
+	{ OPT_bigheap_bytes,	stress_set_bigheap_bytes },
+	{ OPT_bigheap_bench,	stress_set_bigheap_bench },
 	{ 0,			NULL },
 };
 
@@ -18,16 +18,565 @@
  *
  */
 #include "stress-ng.h"
+#include "core-perf.h"
+#include "core-put.h"
+
+#define BRANCH_SWEEP_WAYS	(11)		/* 1 to 1024 indirect branch targets */
+#define BRANCH_SWEEP_PERIODS	(17)		/* 1 to 64K conditional pattern period */
+#define BRANCH_SWEEP_SEQ	(65536)		/* length of target and pattern sequences */
+#define BRANCH_SWEEP_BRANCHES	(1U << 20)	/* branches per measurement */
 
 static const stress_help_t help[] = {
 	{ NULL,	"branch N",	"start N workers that force branch misprediction" },
 	{ NULL,	"branch-ops N",	"stop after N branch misprediction branches" },
+	{ NULL,	"branch-sweep",	"report cycles per branch over indirect targets and pattern periods" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_branch_sweep(const char *opt)
+{
+	return stress_set_setting_true("branch-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_branch_sweep,	stress_set_branch_sweep },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LABEL_AS_VALUE) &&		\
     !defined(__PCC__)
 
+/* ns and cycles of each indirect ways and conditional period measurement */
+typedef struct {
+	double ind_ns[BRANCH_SWEEP_WAYS];
+	double ind_cycles[BRANCH_SWEEP_WAYS];
+	double cond_ns[BRANCH_SWEEP_PERIODS];
+	double cond_cycles[BRANCH_SWEEP_PERIODS];
+	double branches;			/* branches per cell */
+} stress_branch_sweep_t;
+
+/*
+ *  stress_branch_indirect()
+ *	dispatch n indirect jumps through a 1024 entry target table,
+ *	the targets are taken in the order of the sequence, so the
+ *	number of distinct targets is set by the sequence
+ */
+static uint64_t NOINLINE OPTIMIZE3 stress_branch_indirect(const uint16_t *seq, const uint32_t n)
+{
+	register uint32_t i = n;
+	register uint64_t sum = 0;
+
+	static const void ALIGN64 *targets[] = {
+		&&B0x000, &&B0x001, &&B0x002, &&B0x003, &&B0x004, &&B0x005, &&B0x006, &&B0x007,
+		&&B0x008, &&B0x009, &&B0x00a, &&B0x00b, &&B0x00c, &&B0x00d, &&B0x00e, &&B0x00f,
+		&&B0x010, &&B0x011, &&B0x012, &&B0x013, &&B0x014, &&B0x015, &&B0x016, &&B0x017,
+		&&B0x018, &&B0x019, &&B0x01a, &&B0x01b, &&B0x01c, &&B0x01d, &&B0x01e, &&B0x01f,
+		&&B0x020, &&B0x021, &&B0x022, &&B0x023, &&B0x024, &&B0x025, &&B0x026, &&B0x027,
+		&&B0x028, &&B0x029, &&B0x02a, &&B0x02b, &&B0x02c, &&B0x02d, &&B0x02e, &&B0x02f,
+		&&B0x030, &&B0x031, &&B0x032, &&B0x033, &&B0x034, &&B0x035, &&B0x036, &&B0x037,
+		&&B0x038, &&B0x039, &&B0x03a, &&B0x03b, &&B0x03c, &&B0x03d, &&B0x03e, &&B0x03f,
+
+		&&B0x040, &&B0x041, &&B0x042, &&B0x043, &&B0x044, &&B0x045, &&B0x046, &&B0x047,
+		&&B0x048, &&B0x049, &&B0x04a, &&B0x04b, &&B0x04c, &&B0x04d, &&B0x04e, &&B0x04f,
+		&&B0x050, &&B0x051, &&B0x052, &&B0x053, &&B0x054, &&B0x055, &&B0x056, &&B0x057,
+		&&B0x058, &&B0x059, &&B0x05a, &&B0x05b, &&B0x05c, &&B0x05d, &&B0x05e, &&B0x05f,
+		&&B0x060, &&B0x061, &&B0x062, &&B0x063, &&B0x064, &&B0x065, &&B0x066, &&B0x067,
+		&&B0x068, &&B0x069, &&B0x06a, &&B0x06b, &&B0x06c, &&B0x06d, &&B0x06e, &&B0x06f,
+		&&B0x070, &&B0x071, &&B0x072, &&B0x073, &&B0x074, &&B0x075, &&B0x076, &&B0x077,
+		&&B0x078, &&B0x079, &&B0x07a, &&B0x07b, &&B0x07c, &&B0x07d, &&B0x07e, &&B0x07f,
+
+		&&B0x080, &&B0x081, &&B0x082, &&B0x083, &&B0x084, &&B0x085, &&B0x086, &&B0x087,
+		&&B0x088, &&B0x089, &&B0x08a, &&B0x08b, &&B0x08c, &&B0x08d, &&B0x08e, &&B0x08f,
+		&&B0x090, &&B0x091, &&B0x092, &&B0x093, &&B0x094, &&B0x095, &&B0x096, &&B0x097,
+		&&B0x098, &&B0x099, &&B0x09a, &&B0x09b, &&B0x09c, &&B0x09d, &&B0x09e, &&B0x09f,
+		&&B0x0a0, &&B0x0a1, &&B0x0a2, &&B0x0a3, &&B0x0a4, &&B0x0a5, &&B0x0a6, &&B0x0a7,
+		&&B0x0a8, &&B0x0a9, &&B0x0aa, &&B0x0ab, &&B0x0ac, &&B0x0ad, &&B0x0ae, &&B0x0af,
+		&&B0x0b0, &&B0x0b1, &&B0x0b2, &&B0x0b3, &&B0x0b4, &&B0x0b5, &&B0x0b6, &&B0x0b7,
+		&&B0x0b8, &&B0x0b9, &&B0x0ba, &&B0x0bb, &&B0x0bc, &&B0x0bd, &&B0x0be, &&B0x0bf,
+
+		&&B0x0c0, &&B0x0c1, &&B0x0c2, &&B0x0c3, &&B0x0c4, &&B0x0c5, &&B0x0c6, &&B0x0c7,
+		&&B0x0c8, &&B0x0c9, &&B0x0ca, &&B0x0cb, &&B0x0cc, &&B0x0cd, &&B0x0ce, &&B0x0cf,
+		&&B0x0d0, &&B0x0d1, &&B0x0d2, &&B0x0d3, &&B0x0d4, &&B0x0d5, &&B0x0d6, &&B0x0d7,
+		&&B0x0d8, &&B0x0d9, &&B0x0da, &&B0x0db, &&B0x0dc, &&B0x0dd, &&B0x0de, &&B0x0df,
+		&&B0x0e0, &&B0x0e1, &&B0x0e2, &&B0x0e3, &&B0x0e4, &&B0x0e5, &&B0x0e6, &&B0x0e7,
+		&&B0x0e8, &&B0x0e9, &&B0x0ea, &&B0x0eb, &&B0x0ec, &&B0x0ed, &&B0x0ee, &&B0x0ef,
+		&&B0x0f0, &&B0x0f1, &&B0x0f2, &&B0x0f3, &&B0x0f4, &&B0x0f5, &&B0x0f6, &&B0x0f7,
+		&&B0x0f8, &&B0x0f9, &&B0x0fa, &&B0x0fb, &&B0x0fc, &&B0x0fd, &&B0x0fe, &&B0x0ff,
+
+		&&B0x100, &&B0x101, &&B0x102, &&B0x103, &&B0x104, &&B0x105, &&B0x106, &&B0x107,
+		&&B0x108, &&B0x109, &&B0x10a, &&B0x10b, &&B0x10c, &&B0x10d, &&B0x10e, &&B0x10f,
+		&&B0x110, &&B0x111, &&B0x112, &&B0x113, &&B0x114, &&B0x115, &&B0x116, &&B0x117,
+		&&B0x118, &&B0x119, &&B0x11a, &&B0x11b, &&B0x11c, &&B0x11d, &&B0x11e, &&B0x11f,
+		&&B0x120, &&B0x121, &&B0x122, &&B0x123, &&B0x124, &&B0x125, &&B0x126, &&B0x127,
+		&&B0x128, &&B0x129, &&B0x12a, &&B0x12b, &&B0x12c, &&B0x12d, &&B0x12e, &&B0x12f,
+		&&B0x130, &&B0x131, &&B0x132, &&B0x133, &&B0x134, &&B0x135, &&B0x136, &&B0x137,
+		&&B0x138, &&B0x139, &&B0x13a, &&B0x13b, &&B0x13c, &&B0x13d, &&B0x13e, &&B0x13f,
+
+		&&B0x140, &&B0x141, &&B0x142, &&B0x143, &&B0x144, &&B0x145, &&B0x146, &&B0x147,
+		&&B0x148, &&B0x149, &&B0x14a, &&B0x14b, &&B0x14c, &&B0x14d, &&B0x14e, &&B0x14f,
+		&&B0x150, &&B0x151, &&B0x152, &&B0x153, &&B0x154, &&B0x155, &&B0x156, &&B0x157,
+		&&B0x158, &&B0x159, &&B0x15a, &&B0x15b, &&B0x15c, &&B0x15d, &&B0x15e, &&B0x15f,
+		&&B0x160, &&B0x161, &&B0x162, &&B0x163, &&B0x164, &&B0x165, &&B0x166, &&B0x167,
+		&&B0x168, &&B0x169, &&B0x16a, &&B0x16b, &&B0x16c, &&B0x16d, &&B0x16e, &&B0x16f,
+		&&B0x170, &&B0x171, &&B0x172, &&B0x173, &&B0x174, &&B0x175, &&B0x176, &&B0x177,
+		&&B0x178, &&B0x179, &&B0x17a, &&B0x17b, &&B0x17c, &&B0x17d, &&B0x17e, &&B0x17f,
+
+		&&B0x180, &&B0x181, &&B0x182, &&B0x183, &&B0x184, &&B0x185, &&B0x186, &&B0x187,
+		&&B0x188, &&B0x189, &&B0x18a, &&B0x18b, &&B0x18c, &&B0x18d, &&B0x18e, &&B0x18f,
+		&&B0x190, &&B0x191, &&B0x192, &&B0x193, &&B0x194, &&B0x195, &&B0x196, &&B0x197,
+		&&B0x198, &&B0x199, &&B0x19a, &&B0x19b, &&B0x19c, &&B0x19d, &&B0x19e, &&B0x19f,
+		&&B0x1a0, &&B0x1a1, &&B0x1a2, &&B0x1a3, &&B0x1a4, &&B0x1a5, &&B0x1a6, &&B0x1a7,
+		&&B0x1a8, &&B0x1a9, &&B0x1aa, &&B0x1ab, &&B0x1ac, &&B0x1ad, &&B0x1ae, &&B0x1af,
+		&&B0x1b0, &&B0x1b1, &&B0x1b2, &&B0x1b3, &&B0x1b4, &&B0x1b5, &&B0x1b6, &&B0x1b7,
+		&&B0x1b8, &&B0x1b9, &&B0x1ba, &&B0x1bb, &&B0x1bc, &&B0x1bd, &&B0x1be, &&B0x1bf,
+
+		&&B0x1c0, &&B0x1c1, &&B0x1c2, &&B0x1c3, &&B0x1c4, &&B0x1c5, &&B0x1c6, &&B0x1c7,
+		&&B0x1c8, &&B0x1c9, &&B0x1ca, &&B0x1cb, &&B0x1cc, &&B0x1cd, &&B0x1ce, &&B0x1cf,
+		&&B0x1d0, &&B0x1d1, &&B0x1d2, &&B0x1d3, &&B0x1d4, &&B0x1d5, &&B0x1d6, &&B0x1d7,
+		&&B0x1d8, &&B0x1d9, &&B0x1da, &&B0x1db, &&B0x1dc, &&B0x1dd, &&B0x1de, &&B0x1df,
+		&&B0x1e0, &&B0x1e1, &&B0x1e2, &&B0x1e3, &&B0x1e4, &&B0x1e5, &&B0x1e6, &&B0x1e7,
+		&&B0x1e8, &&B0x1e9, &&B0x1ea, &&B0x1eb, &&B0x1ec, &&B0x1ed, &&B0x1ee, &&B0x1ef,
+		&&B0x1f0, &&B0x1f1, &&B0x1f2, &&B0x1f3, &&B0x1f4, &&B0x1f5, &&B0x1f6, &&B0x1f7,
+		&&B0x1f8, &&B0x1f9, &&B0x1fa, &&B0x1fb, &&B0x1fc, &&B0x1fd, &&B0x1fe, &&B0x1ff,
+
+		&&B0x200, &&B0x201, &&B0x202, &&B0x203, &&B0x204, &&B0x205, &&B0x206, &&B0x207,
+		&&B0x208, &&B0x209, &&B0x20a, &&B0x20b, &&B0x20c, &&B0x20d, &&B0x20e, &&B0x20f,
+		&&B0x210, &&B0x211, &&B0x212, &&B0x213, &&B0x214, &&B0x215, &&B0x216, &&B0x217,
+		&&B0x218, &&B0x219, &&B0x21a, &&B0x21b, &&B0x21c, &&B0x21d, &&B0x21e, &&B0x21f,
+		&&B0x220, &&B0x221, &&B0x222, &&B0x223, &&B0x224, &&B0x225, &&B0x226, &&B0x227,
+		&&B0x228, &&B0x229, &&B0x22a, &&B0x22b, &&B0x22c, &&B0x22d, &&B0x22e, &&B0x22f,
+		&&B0x230, &&B0x231, &&B0x232, &&B0x233, &&B0x234, &&B0x235, &&B0x236, &&B0x237,
+		&&B0x238, &&B0x239, &&B0x23a, &&B0x23b, &&B0x23c, &&B0x23d, &&B0x23e, &&B0x23f,
+
+		&&B0x240, &&B0x241, &&B0x242, &&B0x243, &&B0x244, &&B0x245, &&B0x246, &&B0x247,
+		&&B0x248, &&B0x249, &&B0x24a, &&B0x24b, &&B0x24c, &&B0x24d, &&B0x24e, &&B0x24f,
+		&&B0x250, &&B0x251, &&B0x252, &&B0x253, &&B0x254, &&B0x255, &&B0x256, &&B0x257,
+		&&B0x258, &&B0x259, &&B0x25a, &&B0x25b, &&B0x25c, &&B0x25d, &&B0x25e, &&B0x25f,
+		&&B0x260, &&B0x261, &&B0x262, &&B0x263, &&B0x264, &&B0x265, &&B0x266, &&B0x267,
+		&&B0x268, &&B0x269, &&B0x26a, &&B0x26b, &&B0x26c, &&B0x26d, &&B0x26e, &&B0x26f,
+		&&B0x270, &&B0x271, &&B0x272, &&B0x273, &&B0x274, &&B0x275, &&B0x276, &&B0x277,
+		&&B0x278, &&B0x279, &&B0x27a, &&B0x27b, &&B0x27c, &&B0x27d, &&B0x27e, &&B0x27f,
+
+		&&B0x280, &&B0x281, &&B0x282, &&B0x283, &&B0x284, &&B0x285, &&B0x286, &&B0x287,
+		&&B0x288, &&B0x289, &&B0x28a, &&B0x28b, &&B0x28c, &&B0x28d, &&B0x28e, &&B0x28f,
+		&&B0x290, &&B0x291, &&B0x292, &&B0x293, &&B0x294, &&B0x295, &&B0x296, &&B0x297,
+		&&B0x298, &&B0x299, &&B0x29a, &&B0x29b, &&B0x29c, &&B0x29d, &&B0x29e, &&B0x29f,
+		&&B0x2a0, &&B0x2a1, &&B0x2a2, &&B0x2a3, &&B0x2a4, &&B0x2a5, &&B0x2a6, &&B0x2a7,
+		&&B0x2a8, &&B0x2a9, &&B0x2aa, &&B0x2ab, &&B0x2ac, &&B0x2ad, &&B0x2ae, &&B0x2af,
+		&&B0x2b0, &&B0x2b1, &&B0x2b2, &&B0x2b3, &&B0x2b4, &&B0x2b5, &&B0x2b6, &&B0x2b7,
+		&&B0x2b8, &&B0x2b9, &&B0x2ba, &&B0x2bb, &&B0x2bc, &&B0x2bd, &&B0x2be, &&B0x2bf,
+
+		&&B0x2c0, &&B0x2c1, &&B0x2c2, &&B0x2c3, &&B0x2c4, &&B0x2c5, &&B0x2c6, &&B0x2c7,
+		&&B0x2c8, &&B0x2c9, &&B0x2ca, &&B0x2cb, &&B0x2cc, &&B0x2cd, &&B0x2ce, &&B0x2cf,
+		&&B0x2d0, &&B0x2d1, &&B0x2d2, &&B0x2d3, &&B0x2d4, &&B0x2d5, &&B0x2d6, &&B0x2d7,
+		&&B0x2d8, &&B0x2d9, &&B0x2da, &&B0x2db, &&B0x2dc, &&B0x2dd, &&B0x2de, &&B0x2df,
+		&&B0x2e0, &&B0x2e1, &&B0x2e2, &&B0x2e3, &&B0x2e4, &&B0x2e5, &&B0x2e6, &&B0x2e7,
+		&&B0x2e8, &&B0x2e9, &&B0x2ea, &&B0x2eb, &&B0x2ec, &&B0x2ed, &&B0x2ee, &&B0x2ef,
+		&&B0x2f0, &&B0x2f1, &&B0x2f2, &&B0x2f3, &&B0x2f4, &&B0x2f5, &&B0x2f6, &&B0x2f7,
+		&&B0x2f8, &&B0x2f9, &&B0x2fa, &&B0x2fb, &&B0x2fc, &&B0x2fd, &&B0x2fe, &&B0x2ff,
+
+		&&B0x300, &&B0x301, &&B0x302, &&B0x303, &&B0x304, &&B0x305, &&B0x306, &&B0x307,
+		&&B0x308, &&B0x309, &&B0x30a, &&B0x30b, &&B0x30c, &&B0x30d, &&B0x30e, &&B0x30f,
+		&&B0x310, &&B0x311, &&B0x312, &&B0x313, &&B0x314, &&B0x315, &&B0x316, &&B0x317,
+		&&B0x318, &&B0x319, &&B0x31a, &&B0x31b, &&B0x31c, &&B0x31d, &&B0x31e, &&B0x31f,
+		&&B0x320, &&B0x321, &&B0x322, &&B0x323, &&B0x324, &&B0x325, &&B0x326, &&B0x327,
+		&&B0x328, &&B0x329, &&B0x32a, &&B0x32b, &&B0x32c, &&B0x32d, &&B0x32e, &&B0x32f,
+		&&B0x330, &&B0x331, &&B0x332, &&B0x333, &&B0x334, &&B0x335, &&B0x336, &&B0x337,
+		&&B0x338, &&B0x339, &&B0x33a, &&B0x33b, &&B0x33c, &&B0x33d, &&B0x33e, &&B0x33f,
+
+		&&B0x340, &&B0x341, &&B0x342, &&B0x343, &&B0x344, &&B0x345, &&B0x346, &&B0x347,
+		&&B0x348, &&B0x349, &&B0x34a, &&B0x34b, &&B0x34c, &&B0x34d, &&B0x34e, &&B0x34f,
+		&&B0x350, &&B0x351, &&B0x352, &&B0x353, &&B0x354, &&B0x355, &&B0x356, &&B0x357,
+		&&B0x358, &&B0x359, &&B0x35a, &&B0x35b, &&B0x35c, &&B0x35d, &&B0x35e, &&B0x35f,
+		&&B0x360, &&B0x361, &&B0x362, &&B0x363, &&B0x364, &&B0x365, &&B0x366, &&B0x367,
+		&&B0x368, &&B0x369, &&B0x36a, &&B0x36b, &&B0x36c, &&B0x36d, &&B0x36e, &&B0x36f,
+		&&B0x370, &&B0x371, &&B0x372, &&B0x373, &&B0x374, &&B0x375, &&B0x376, &&B0x377,
+		&&B0x378, &&B0x379, &&B0x37a, &&B0x37b, &&B0x37c, &&B0x37d, &&B0x37e, &&B0x37f,
+
+		&&B0x380, &&B0x381, &&B0x382, &&B0x383, &&B0x384, &&B0x385, &&B0x386, &&B0x387,
+		&&B0x388, &&B0x389, &&B0x38a, &&B0x38b, &&B0x38c, &&B0x38d, &&B0x38e, &&B0x38f,
+		&&B0x390, &&B0x391, &&B0x392, &&B0x393, &&B0x394, &&B0x395, &&B0x396, &&B0x397,
+		&&B0x398, &&B0x399, &&B0x39a, &&B0x39b, &&B0x39c, &&B0x39d, &&B0x39e, &&B0x39f,
+		&&B0x3a0, &&B0x3a1, &&B0x3a2, &&B0x3a3, &&B0x3a4, &&B0x3a5, &&B0x3a6, &&B0x3a7,
+		&&B0x3a8, &&B0x3a9, &&B0x3aa, &&B0x3ab, &&B0x3ac, &&B0x3ad, &&B0x3ae, &&B0x3af,
+		&&B0x3b0, &&B0x3b1, &&B0x3b2, &&B0x3b3, &&B0x3b4, &&B0x3b5, &&B0x3b6, &&B0x3b7,
+		&&B0x3b8, &&B0x3b9, &&B0x3ba, &&B0x3bb, &&B0x3bc, &&B0x3bd, &&B0x3be, &&B0x3bf,
+
+		&&B0x3c0, &&B0x3c1, &&B0x3c2, &&B0x3c3, &&B0x3c4, &&B0x3c5, &&B0x3c6, &&B0x3c7,
+		&&B0x3c8, &&B0x3c9, &&B0x3ca, &&B0x3cb, &&B0x3cc, &&B0x3cd, &&B0x3ce, &&B0x3cf,
+		&&B0x3d0, &&B0x3d1, &&B0x3d2, &&B0x3d3, &&B0x3d4, &&B0x3d5, &&B0x3d6, &&B0x3d7,
+		&&B0x3d8, &&B0x3d9, &&B0x3da, &&B0x3db, &&B0x3dc, &&B0x3dd, &&B0x3de, &&B0x3df,
+		&&B0x3e0, &&B0x3e1, &&B0x3e2, &&B0x3e3, &&B0x3e4, &&B0x3e5, &&B0x3e6, &&B0x3e7,
+		&&B0x3e8, &&B0x3e9, &&B0x3ea, &&B0x3eb, &&B0x3ec, &&B0x3ed, &&B0x3ee, &&B0x3ef,
+		&&B0x3f0, &&B0x3f1, &&B0x3f2, &&B0x3f3, &&B0x3f4, &&B0x3f5, &&B0x3f6, &&B0x3f7,
+		&&B0x3f8, &&B0x3f9, &&B0x3fa, &&B0x3fb, &&B0x3fc, &&B0x3fd, &&B0x3fe, &&B0x3ff,
+	};
+
+#define B(n) B ## n:					\
+	sum += n;					\
+	if (UNLIKELY(--i == 0))				\
+		return sum;				\
+	goto *targets[seq[i & (BRANCH_SWEEP_SEQ - 1)]];
+
+	goto *targets[seq[i & (BRANCH_SWEEP_SEQ - 1)]];
+
+	B(0x000) B(0x001) B(0x002) B(0x003) B(0x004) B(0x005) B(0x006) B(0x007)
+	B(0x008) B(0x009) B(0x00a) B(0x00b) B(0x00c) B(0x00d) B(0x00e) B(0x00f)
+	B(0x010) B(0x011) B(0x012) B(0x013) B(0x014) B(0x015) B(0x016) B(0x017)
+	B(0x018) B(0x019) B(0x01a) B(0x01b) B(0x01c) B(0x01d) B(0x01e) B(0x01f)
+	B(0x020) B(0x021) B(0x022) B(0x023) B(0x024) B(0x025) B(0x026) B(0x027)
+	B(0x028) B(0x029) B(0x02a) B(0x02b) B(0x02c) B(0x02d) B(0x02e) B(0x02f)
+	B(0x030) B(0x031) B(0x032) B(0x033) B(0x034) B(0x035) B(0x036) B(0x037)
+	B(0x038) B(0x039) B(0x03a) B(0x03b) B(0x03c) B(0x03d) B(0x03e) B(0x03f)
+
+	B(0x040) B(0x041) B(0x042) B(0x043) B(0x044) B(0x045) B(0x046) B(0x047)
+	B(0x048) B(0x049) B(0x04a) B(0x04b) B(0x04c) B(0x04d) B(0x04e) B(0x04f)
+	B(0x050) B(0x051) B(0x052) B(0x053) B(0x054) B(0x055) B(0x056) B(0x057)
+	B(0x058) B(0x059) B(0x05a) B(0x05b) B(0x05c) B(0x05d) B(0x05e) B(0x05f)
+	B(0x060) B(0x061) B(0x062) B(0x063) B(0x064) B(0x065) B(0x066) B(0x067)
+	B(0x068) B(0x069) B(0x06a) B(0x06b) B(0x06c) B(0x06d) B(0x06e) B(0x06f)
+	B(0x070) B(0x071) B(0x072) B(0x073) B(0x074) B(0x075) B(0x076) B(0x077)
+	B(0x078) B(0x079) B(0x07a) B(0x07b) B(0x07c) B(0x07d) B(0x07e) B(0x07f)
+
+	B(0x080) B(0x081) B(0x082) B(0x083) B(0x084) B(0x085) B(0x086) B(0x087)
+	B(0x088) B(0x089) B(0x08a) B(0x08b) B(0x08c) B(0x08d) B(0x08e) B(0x08f)
+	B(0x090) B(0x091) B(0x092) B(0x093) B(0x094) B(0x095) B(0x096) B(0x097)
+	B(0x098) B(0x099) B(0x09a) B(0x09b) B(0x09c) B(0x09d) B(0x09e) B(0x09f)
+	B(0x0a0) B(0x0a1) B(0x0a2) B(0x0a3) B(0x0a4) B(0x0a5) B(0x0a6) B(0x0a7)
+	B(0x0a8) B(0x0a9) B(0x0aa) B(0x0ab) B(0x0ac) B(0x0ad) B(0x0ae) B(0x0af)
+	B(0x0b0) B(0x0b1) B(0x0b2) B(0x0b3) B(0x0b4) B(0x0b5) B(0x0b6) B(0x0b7)
+	B(0x0b8) B(0x0b9) B(0x0ba) B(0x0bb) B(0x0bc) B(0x0bd) B(0x0be) B(0x0bf)
+
+	B(0x0c0) B(0x0c1) B(0x0c2) B(0x0c3) B(0x0c4) B(0x0c5) B(0x0c6) B(0x0c7)
+	B(0x0c8) B(0x0c9) B(0x0ca) B(0x0cb) B(0x0cc) B(0x0cd) B(0x0ce) B(0x0cf)
+	B(0x0d0) B(0x0d1) B(0x0d2) B(0x0d3) B(0x0d4) B(0x0d5) B(0x0d6) B(0x0d7)
+	B(0x0d8) B(0x0d9) B(0x0da) B(0x0db) B(0x0dc) B(0x0dd) B(0x0de) B(0x0df)
+	B(0x0e0) B(0x0e1) B(0x0e2) B(0x0e3) B(0x0e4) B(0x0e5) B(0x0e6) B(0x0e7)
+	B(0x0e8) B(0x0e9) B(0x0ea) B(0x0eb) B(0x0ec) B(0x0ed) B(0x0ee) B(0x0ef)
+	B(0x0f0) B(0x0f1) B(0x0f2) B(0x0f3) B(0x0f4) B(0x0f5) B(0x0f6) B(0x0f7)
+	B(0x0f8) B(0x0f9) B(0x0fa) B(0x0fb) B(0x0fc) B(0x0fd) B(0x0fe) B(0x0ff)
+
+	B(0x100) B(0x101) B(0x102) B(0x103) B(0x104) B(0x105) B(0x106) B(0x107)
+	B(0x108) B(0x109) B(0x10a) B(0x10b) B(0x10c) B(0x10d) B(0x10e) B(0x10f)
+	B(0x110) B(0x111) B(0x112) B(0x113) B(0x114) B(0x115) B(0x116) B(0x117)
+	B(0x118) B(0x119) B(0x11a) B(0x11b) B(0x11c) B(0x11d) B(0x11e) B(0x11f)
+	B(0x120) B(0x121) B(0x122) B(0x123) B(0x124) B(0x125) B(0x126) B(0x127)
+	B(0x128) B(0x129) B(0x12a) B(0x12b) B(0x12c) B(0x12d) B(0x12e) B(0x12f)
+	B(0x130) B(0x131) B(0x132) B(0x133) B(0x134) B(0x135) B(0x136) B(0x137)
+	B(0x138) B(0x139) B(0x13a) B(0x13b) B(0x13c) B(0x13d) B(0x13e) B(0x13f)
+
+	B(0x140) B(0x141) B(0x142) B(0x143) B(0x144) B(0x145) B(0x146) B(0x147)
+	B(0x148) B(0x149) B(0x14a) B(0x14b) B(0x14c) B(0x14d) B(0x14e) B(0x14f)
+	B(0x150) B(0x151) B(0x152) B(0x153) B(0x154) B(0x155) B(0x156) B(0x157)
+	B(0x158) B(0x159) B(0x15a) B(0x15b) B(0x15c) B(0x15d) B(0x15e) B(0x15f)
+	B(0x160) B(0x161) B(0x162) B(0x163) B(0x164) B(0x165) B(0x166) B(0x167)
+	B(0x168) B(0x169) B(0x16a) B(0x16b) B(0x16c) B(0x16d) B(0x16e) B(0x16f)
+	B(0x170) B(0x171) B(0x172) B(0x173) B(0x174) B(0x175) B(0x176) B(0x177)
+	B(0x178) B(0x179) B(0x17a) B(0x17b) B(0x17c) B(0x17d) B(0x17e) B(0x17f)
+
+	B(0x180) B(0x181) B(0x182) B(0x183) B(0x184) B(0x185) B(0x186) B(0x187)
+	B(0x188) B(0x189) B(0x18a) B(0x18b) B(0x18c) B(0x18d) B(0x18e) B(0x18f)
+	B(0x190) B(0x191) B(0x192) B(0x193) B(0x194) B(0x195) B(0x196) B(0x197)
+	B(0x198) B(0x199) B(0x19a) B(0x19b) B(0x19c) B(0x19d) B(0x19e) B(0x19f)
+	B(0x1a0) B(0x1a1) B(0x1a2) B(0x1a3) B(0x1a4) B(0x1a5) B(0x1a6) B(0x1a7)
+	B(0x1a8) B(0x1a9) B(0x1aa) B(0x1ab) B(0x1ac) B(0x1ad) B(0x1ae) B(0x1af)
+	B(0x1b0) B(0x1b1) B(0x1b2) B(0x1b3) B(0x1b4) B(0x1b5) B(0x1b6) B(0x1b7)
+	B(0x1b8) B(0x1b9) B(0x1ba) B(0x1bb) B(0x1bc) B(0x1bd) B(0x1be) B(0x1bf)
+
+	B(0x1c0) B(0x1c1) B(0x1c2) B(0x1c3) B(0x1c4) B(0x1c5) B(0x1c6) B(0x1c7)
+	B(0x1c8) B(0x1c9) B(0x1ca) B(0x1cb) B(0x1cc) B(0x1cd) B(0x1ce) B(0x1cf)
+	B(0x1d0) B(0x1d1) B(0x1d2) B(0x1d3) B(0x1d4) B(0x1d5) B(0x1d6) B(0x1d7)
+	B(0x1d8) B(0x1d9) B(0x1da) B(0x1db) B(0x1dc) B(0x1dd) B(0x1de) B(0x1df)
+	B(0x1e0) B(0x1e1) B(0x1e2) B(0x1e3) B(0x1e4) B(0x1e5) B(0x1e6) B(0x1e7)
+	B(0x1e8) B(0x1e9) B(0x1ea) B(0x1eb) B(0x1ec) B(0x1ed) B(0x1ee) B(0x1ef)
+	B(0x1f0) B(0x1f1) B(0x1f2) B(0x1f3) B(0x1f4) B(0x1f5) B(0x1f6) B(0x1f7)
+	B(0x1f8) B(0x1f9) B(0x1fa) B(0x1fb) B(0x1fc) B(0x1fd) B(0x1fe) B(0x1ff)
+
+	B(0x200) B(0x201) B(0x202) B(0x203) B(0x204) B(0x205) B(0x206) B(0x207)
+	B(0x208) B(0x209) B(0x20a) B(0x20b) B(0x20c) B(0x20d) B(0x20e) B(0x20f)
+	B(0x210) B(0x211) B(0x212) B(0x213) B(0x214) B(0x215) B(0x216) B(0x217)
+	B(0x218) B(0x219) B(0x21a) B(0x21b) B(0x21c) B(0x21d) B(0x21e) B(0x21f)
+	B(0x220) B(0x221) B(0x222) B(0x223) B(0x224) B(0x225) B(0x226) B(0x227)
+	B(0x228) B(0x229) B(0x22a) B(0x22b) B(0x22c) B(0x22d) B(0x22e) B(0x22f)
+	B(0x230) B(0x231) B(0x232) B(0x233) B(0x234) B(0x235) B(0x236) B(0x237)
+	B(0x238) B(0x239) B(0x23a) B(0x23b) B(0x23c) B(0x23d) B(0x23e) B(0x23f)
+
+	B(0x240) B(0x241) B(0x242) B(0x243) B(0x244) B(0x245) B(0x246) B(0x247)
+	B(0x248) B(0x249) B(0x24a) B(0x24b) B(0x24c) B(0x24d) B(0x24e) B(0x24f)
+	B(0x250) B(0x251) B(0x252) B(0x253) B(0x254) B(0x255) B(0x256) B(0x257)
+	B(0x258) B(0x259) B(0x25a) B(0x25b) B(0x25c) B(0x25d) B(0x25e) B(0x25f)
+	B(0x260) B(0x261) B(0x262) B(0x263) B(0x264) B(0x265) B(0x266) B(0x267)
+	B(0x268) B(0x269) B(0x26a) B(0x26b) B(0x26c) B(0x26d) B(0x26e) B(0x26f)
+	B(0x270) B(0x271) B(0x272) B(0x273) B(0x274) B(0x275) B(0x276) B(0x277)
+	B(0x278) B(0x279) B(0x27a) B(0x27b) B(0x27c) B(0x27d) B(0x27e) B(0x27f)
+
+	B(0x280) B(0x281) B(0x282) B(0x283) B(0x284) B(0x285) B(0x286) B(0x287)
+	B(0x288) B(0x289) B(0x28a) B(0x28b) B(0x28c) B(0x28d) B(0x28e) B(0x28f)
+	B(0x290) B(0x291) B(0x292) B(0x293) B(0x294) B(0x295) B(0x296) B(0x297)
+	B(0x298) B(0x299) B(0x29a) B(0x29b) B(0x29c) B(0x29d) B(0x29e) B(0x29f)
+	B(0x2a0) B(0x2a1) B(0x2a2) B(0x2a3) B(0x2a4) B(0x2a5) B(0x2a6) B(0x2a7)
+	B(0x2a8) B(0x2a9) B(0x2aa) B(0x2ab) B(0x2ac) B(0x2ad) B(0x2ae) B(0x2af)
+	B(0x2b0) B(0x2b1) B(0x2b2) B(0x2b3) B(0x2b4) B(0x2b5) B(0x2b6) B(0x2b7)
+	B(0x2b8) B(0x2b9) B(0x2ba) B(0x2bb) B(0x2bc) B(0x2bd) B(0x2be) B(0x2bf)
+
+	B(0x2c0) B(0x2c1) B(0x2c2) B(0x2c3) B(0x2c4) B(0x2c5) B(0x2c6) B(0x2c7)
+	B(0x2c8) B(0x2c9) B(0x2ca) B(0x2cb) B(0x2cc) B(0x2cd) B(0x2ce) B(0x2cf)
+	B(0x2d0) B(0x2d1) B(0x2d2) B(0x2d3) B(0x2d4) B(0x2d5) B(0x2d6) B(0x2d7)
+	B(0x2d8) B(0x2d9) B(0x2da) B(0x2db) B(0x2dc) B(0x2dd) B(0x2de) B(0x2df)
+	B(0x2e0) B(0x2e1) B(0x2e2) B(0x2e3) B(0x2e4) B(0x2e5) B(0x2e6) B(0x2e7)
+	B(0x2e8) B(0x2e9) B(0x2ea) B(0x2eb) B(0x2ec) B(0x2ed) B(0x2ee) B(0x2ef)
+	B(0x2f0) B(0x2f1) B(0x2f2) B(0x2f3) B(0x2f4) B(0x2f5) B(0x2f6) B(0x2f7)
+	B(0x2f8) B(0x2f9) B(0x2fa) B(0x2fb) B(0x2fc) B(0x2fd) B(0x2fe) B(0x2ff)
+
+	B(0x300) B(0x301) B(0x302) B(0x303) B(0x304) B(0x305) B(0x306) B(0x307)
+	B(0x308) B(0x309) B(0x30a) B(0x30b) B(0x30c) B(0x30d) B(0x30e) B(0x30f)
+	B(0x310) B(0x311) B(0x312) B(0x313) B(0x314) B(0x315) B(0x316) B(0x317)
+	B(0x318) B(0x319) B(0x31a) B(0x31b) B(0x31c) B(0x31d) B(0x31e) B(0x31f)
+	B(0x320) B(0x321) B(0x322) B(0x323) B(0x324) B(0x325) B(0x326) B(0x327)
+	B(0x328) B(0x329) B(0x32a) B(0x32b) B(0x32c) B(0x32d) B(0x32e) B(0x32f)
+	B(0x330) B(0x331) B(0x332) B(0x333) B(0x334) B(0x335) B(0x336) B(0x337)
+	B(0x338) B(0x339) B(0x33a) B(0x33b) B(0x33c) B(0x33d) B(0x33e) B(0x33f)
+
+	B(0x340) B(0x341) B(0x342) B(0x343) B(0x344) B(0x345) B(0x346) B(0x347)
+	B(0x348) B(0x349) B(0x34a) B(0x34b) B(0x34c) B(0x34d) B(0x34e) B(0x34f)
+	B(0x350) B(0x351) B(0x352) B(0x353) B(0x354) B(0x355) B(0x356) B(0x357)
+	B(0x358) B(0x359) B(0x35a) B(0x35b) B(0x35c) B(0x35d) B(0x35e) B(0x35f)
+	B(0x360) B(0x361) B(0x362) B(0x363) B(0x364) B(0x365) B(0x366) B(0x367)
+	B(0x368) B(0x369) B(0x36a) B(0x36b) B(0x36c) B(0x36d) B(0x36e) B(0x36f)
+	B(0x370) B(0x371) B(0x372) B(0x373) B(0x374) B(0x375) B(0x376) B(0x377)
+	B(0x378) B(0x379) B(0x37a) B(0x37b) B(0x37c) B(0x37d) B(0x37e) B(0x37f)
+
+	B(0x380) B(0x381) B(0x382) B(0x383) B(0x384) B(0x385) B(0x386) B(0x387)
+	B(0x388) B(0x389) B(0x38a) B(0x38b) B(0x38c) B(0x38d) B(0x38e) B(0x38f)
+	B(0x390) B(0x391) B(0x392) B(0x393) B(0x394) B(0x395) B(0x396) B(0x397)
+	B(0x398) B(0x399) B(0x39a) B(0x39b) B(0x39c) B(0x39d) B(0x39e) B(0x39f)
+	B(0x3a0) B(0x3a1) B(0x3a2) B(0x3a3) B(0x3a4) B(0x3a5) B(0x3a6) B(0x3a7)
+	B(0x3a8) B(0x3a9) B(0x3aa) B(0x3ab) B(0x3ac) B(0x3ad) B(0x3ae) B(0x3af)
+	B(0x3b0) B(0x3b1) B(0x3b2) B(0x3b3) B(0x3b4) B(0x3b5) B(0x3b6) B(0x3b7)
+	B(0x3b8) B(0x3b9) B(0x3ba) B(0x3bb) B(0x3bc) B(0x3bd) B(0x3be) B(0x3bf)
+
+	B(0x3c0) B(0x3c1) B(0x3c2) B(0x3c3) B(0x3c4) B(0x3c5) B(0x3c6) B(0x3c7)
+	B(0x3c8) B(0x3c9) B(0x3ca) B(0x3cb) B(0x3cc) B(0x3cd) B(0x3ce) B(0x3cf)
+	B(0x3d0) B(0x3d1) B(0x3d2) B(0x3d3) B(0x3d4) B(0x3d5) B(0x3d6) B(0x3d7)
+	B(0x3d8) B(0x3d9) B(0x3da) B(0x3db) B(0x3dc) B(0x3dd) B(0x3de) B(0x3df)
+	B(0x3e0) B(0x3e1) B(0x3e2) B(0x3e3) B(0x3e4) B(0x3e5) B(0x3e6) B(0x3e7)
+	B(0x3e8) B(0x3e9) B(0x3ea) B(0x3eb) B(0x3ec) B(0x3ed) B(0x3ee) B(0x3ef)
+	B(0x3f0) B(0x3f1) B(0x3f2) B(0x3f3) B(0x3f4) B(0x3f5) B(0x3f6) B(0x3f7)
+	B(0x3f8) B(0x3f9) B(0x3fa) B(0x3fb) B(0x3fc) B(0x3fd) B(0x3fe) B(0x3ff)
+#undef B
+
+	return sum;
+}
+
+/*
+ *  stress_branch_conditional()
+ *	n data dependent conditional branches following the pattern,
+ *	the empty asm statements stop the compiler converting the
+ *	branch into a conditional move
+ */
+static uint64_t NOINLINE OPTIMIZE3 stress_branch_conditional(const uint8_t *pattern, const uint32_t n)
+{
+	register uint64_t x = 0;
+	register uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (pattern[i & (BRANCH_SWEEP_SEQ - 1)]) {
+			__asm__ __volatile__("" : "+r"(x));
+			x += 3;
+		} else {
+			__asm__ __volatile__("" : "+r"(x));
+			x ^= 5;
+		}
+	}
+	return x;
+}
+
+/*
+ *  stress_branch_cycles()
+ *	CPU cycles of the calling process, 0 if not available
+ */
+static uint64_t stress_branch_cycles(const int fd)
+{
+#if defined(STRESS_PERF_STATS)
+	uint64_t cycles;
+
+	if ((fd >= 0) && (stress_perf_cycles_read(fd, &cycles) == 0))
+		return cycles;
+#else
+	(void)fd;
+#endif
+	return 0;
+}
+
+static void stress_branch_sweep_line(
+	const stress_args_t *args,
+	const unsigned int n,
+	const double ns,
+	const double cycles,
+	const bool have_cycles)
+{
+	if (have_cycles)
+		pr_inf("%s: %8u %10.2f %10.2f\n", args->name, n, ns, cycles);
+	else
+		pr_inf("%s: %8u %10.2f %10s\n", args->name, n, ns, "-");
+}
+
+/*
+ *  stress_branch_sweep_report()
+ *	report ns and cycles per branch, cycles are counted if a perf
+ *	cycles counter is available, otherwise estimated from the CPU
+ *	frequency
+ */
+static void stress_branch_sweep_report(
+	const stress_args_t *args,
+	const stress_branch_sweep_t *sweep,
+	const bool counted,
+	const double ghz)
+{
+	const char *how = counted ? "counted" : (ghz > 0.0 ? "estimated" : "not available");
+	const double base_ind = sweep->ind_cycles[0];
+	const double base_cond = sweep->cond_cycles[0];
+	double worst_ind = 0.0, worst_cond = 0.0;
+	size_t i;
+
+	if (sweep->branches <= 0.0)
+		return;
+
+	if (args->instance == 0) {
+		pr_inf("%s: indirect branch, per branch (cycles %s):\n", args->name, how);
+		pr_inf("%s: %8s %10s %10s\n", args->name, "targets", "ns", "cycles");
+	}
+	for (i = 0; i < BRANCH_SWEEP_WAYS; i++) {
+		const double cycles = sweep->ind_cycles[i] / sweep->branches;
+
+		worst_ind = STRESS_MAXIMUM(worst_ind, cycles);
+		if (args->instance == 0)
+			stress_branch_sweep_line(args, 1U << i, sweep->ind_ns[i] / sweep->branches,
+				cycles, ghz > 0.0);
+	}
+	if (args->instance == 0) {
+		pr_inf("%s: conditional branch, per branch (cycles %s):\n", args->name, how);
+		pr_inf("%s: %8s %10s %10s\n", args->name, "period", "ns", "cycles");
+	}
+	for (i = 0; i < BRANCH_SWEEP_PERIODS; i++) {
+		const double cycles = sweep->cond_cycles[i] / sweep->branches;
+
+		worst_cond = STRESS_MAXIMUM(worst_cond, cycles);
+		if (args->instance == 0)
+			stress_branch_sweep_line(args, 1U << i, sweep->cond_ns[i] / sweep->branches,
+				cycles, ghz > 0.0);
+	}
+	if (ghz <= 0.0) {
+		stress_misc_stats_set(args->misc_stats, 0, "indirect ns per branch, 1 target",
+			sweep->ind_ns[0] / sweep->branches);
+		stress_misc_stats_set(args->misc_stats, 1, "conditional ns per branch, period 1",
+			sweep->cond_ns[0] / sweep->branches);
+		return;
+	}
+	stress_misc_stats_set(args->misc_stats, 0, "indirect cycles per branch, 1 target",
+		base_ind / sweep->branches);
+	stress_misc_stats_set(args->misc_stats, 1, "indirect cycles per branch, worst",
+		worst_ind);
+	stress_misc_stats_set(args->misc_stats, 2, "conditional cycles per branch, period 1",
+		base_cond / sweep->branches);
+	stress_misc_stats_set(args->misc_stats, 3, "conditional cycles per branch, worst",
+		worst_cond);
+}
+
+/*
+ *  stress_branch_sweep()
+ *	each bogo-op times an indirect branch over 1 to 1024 targets and
+ *	a conditional branch with random patterns of period 1 to 64K,
+ *	the period at which the cost per branch steps up shows the
+ *	predictor capacity and history length
+ */
+static int stress_branch_sweep(const stress_args_t *args)
+{
+	stress_branch_sweep_t *sweep;
+	uint16_t *seq;
+	uint8_t *pattern, bits[BRANCH_SWEEP_SEQ];
+	double ghz = 0.0;
+	int cycles_fd = -1;
+	size_t i, j;
+
+	sweep = calloc(1, sizeof(*sweep));
+	seq = calloc(BRANCH_SWEEP_SEQ, sizeof(*seq));
+	pattern = calloc(BRANCH_SWEEP_SEQ, sizeof(*pattern));
+	if (!sweep || !seq || !pattern) {
+		pr_inf_skip("%s: cannot allocate sweep buffers, skipping stressor\n", args->name);
+		free(pattern);
+		free(seq);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+#if defined(STRESS_PERF_STATS)
+	cycles_fd = stress_perf_cycles_open();
+#endif
+	if (cycles_fd < 0)
+		ghz = stress_get_cpu_ghz_average();
+	else
+		ghz = 1.0;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < BRANCH_SWEEP_WAYS; i++) {
+			const size_t ways = (size_t)1 << i;
+			uint64_t c1, c2;
+			double t1, t2;
+
+			/* random choice of one of ways targets spread over the table */
+			for (j = 0; j < BRANCH_SWEEP_SEQ; j++)
+				seq[j] = (uint16_t)((stress_mwc16() & (ways - 1)) << (10 - i));
+
+			c1 = stress_branch_cycles(cycles_fd);
+			t1 = stress_time_now();
+			stress_uint64_put(stress_branch_indirect(seq, BRANCH_SWEEP_BRANCHES));
+			t2 = stress_time_now();
+			c2 = stress_branch_cycles(cycles_fd);
+
+			sweep->ind_ns[i] += (t2 - t1) * (double)STRESS_NANOSECOND;
+			sweep->ind_cycles[i] += (cycles_fd >= 0) ? (double)(c2 - c1) :
+				(t2 - t1) * (double)STRESS_NANOSECOND * ghz;
+		}
+		for (i = 0; i < BRANCH_SWEEP_PERIODS; i++) {
+			const size_t period = (size_t)1 << i;
+			uint64_t c1, c2;
+			double t1, t2;
+
+			/* random taken/not taken pattern, repeating with period */
+			for (j = 0; j < period; j++)
+				bits[j] = stress_mwc1();
+			for (j = 0; j < BRANCH_SWEEP_SEQ; j++)
+				pattern[j] = bits[j & (period - 1)];
+
+			c1 = stress_branch_cycles(cycles_fd);
+			t1 = stress_time_now();
+			stress_uint64_put(stress_branch_conditional(pattern, BRANCH_SWEEP_BRANCHES));
+			t2 = stress_time_now();
+			c2 = stress_branch_cycles(cycles_fd);
+
+			sweep->cond_ns[i] += (t2 - t1) * (double)STRESS_NANOSECOND;
+			sweep->cond_cycles[i] += (cycles_fd >= 0) ? (double)(c2 - c1) :
+				(t2 - t1) * (double)STRESS_NANOSECOND * ghz;
+		}
+		sweep->branches += (double)BRANCH_SWEEP_BRANCHES;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_branch_sweep_report(args, sweep, cycles_fd >= 0, ghz);
+
+	if (cycles_fd >= 0)
+		(void)close(cycles_fd);
+	free(pattern);
+	free(seq);
+	free(sweep);
+
+	return EXIT_SUCCESS;
+}
+
 #define RESEED_JMP				\
 		seed = (a * seed + c);		\
 		idx = (seed >> 22);		\
@@ -45,6 +594,7 @@ static int OPTIMIZE3 stress_branch(const stress_args_t *args)
 	register uint32_t const c = 826366247;
 	register uint32_t seed = 123456789;
 	register uint32_t idx;
+	bool branch_sweep = false;
 
 	static const void ALIGN64 *labels[] = {
 		&&L0x000, &&L0x001, &&L0x002, &&L0x003, &&L0x004, &&L0x005, &&L0x006, &&L0x007,
@@ -192,6 +742,10 @@ static int OPTIMIZE3 stress_branch(const stress_args_t *args)
 		&&L0x3f8, &&L0x3f9, &&L0x3fa, &&L0x3fb, &&L0x3fc, &&L0x3fd, &&L0x3fe, &&L0x3ff,
 	};
 
+	(void)stress_get_setting("branch-sweep", &branch_sweep);
+	if (branch_sweep)
+		return stress_branch_sweep(args);
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	for (;;) {
@@ -353,12 +907,14 @@ L0x000:
 stressor_info_t stress_branch_info = {
 	.stressor = stress_branch,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_branch_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
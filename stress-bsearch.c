@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-cache.h"
+#include "core-method-stats.h"
 
 #if defined(HAVE_SEARCH_H)
 #include <search.h>
@@ -27,13 +29,46 @@
 #define MAX_BSEARCH_SIZE	(4 * MB)
 #define DEFAULT_BSEARCH_SIZE	(64 * KB)
 
+#define BSEARCH_SWEEP_MIN	(1 * KB)
+#define BSEARCH_MAX_SIZES	(8)
+
 static const stress_help_t help[] = {
-	{ NULL,	"bsearch N",	  "start N workers that exercise a binary search" },
-	{ NULL,	"bsearch-ops N",  "stop after N binary search bogo operations" },
-	{ NULL,	"bsearch-size N", "number of 32 bit integers to bsearch" },
-	{ NULL,	NULL,		  NULL }
+	{ NULL,	"bsearch N",	    "start N workers that exercise a binary search" },
+	{ NULL,	"bsearch-method M", "select bsearch method [ all | bsearch | branchless | interpolation ]" },
+	{ NULL,	"bsearch-ops N",    "stop after N binary search bogo operations" },
+	{ NULL,	"bsearch-size N",   "number of 32 bit integers to bsearch" },
+	{ NULL,	"bsearch-sweep",    "cycle array size from 1K up to bsearch-size" },
+	{ NULL,	NULL,		    NULL }
+};
+
+static const char * const bsearch_methods[] = {
+	"all",
+	"bsearch",
+	"branchless",
+	"interpolation",
 };
 
+/*
+ *  stress_set_bsearch_method()
+ *	set the bsearch method, stored as an index into bsearch_methods
+ */
+static int stress_set_bsearch_method(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(bsearch_methods); i++) {
+		if (!strcmp(bsearch_methods[i], name))
+			return stress_set_setting("bsearch-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "bsearch-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(bsearch_methods); i++)
+		(void)fprintf(stderr, " %s", bsearch_methods[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 /*
  *  stress_set_bsearch_size()
  *	set bsearch size from given option string
@@ -48,13 +83,23 @@ static int stress_set_bsearch_size(const char *opt)
 	return stress_set_setting("bsearch-size", TYPE_ID_UINT64, &bsearch_size);
 }
 
+static int stress_set_bsearch_sweep(const char *opt)
+{
+	return stress_set_setting_true("bsearch-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_bsearch_method,	stress_set_bsearch_method },
 	{ OPT_bsearch_size,	stress_set_bsearch_size },
+	{ OPT_bsearch_sweep,	stress_set_bsearch_sweep },
 	{ 0,			NULL },
 };
 
 #if defined(HAVE_BSEARCH)
 
+typedef size_t (*stress_bsearch_func_t)(const stress_args_t *args,
+	const int32_t *data, const uint32_t *order, const size_t n);
+
 /*
  *  cmp()
  *	compare int32 values for bsearch
@@ -83,16 +128,200 @@ do {					\
 	i++;				\
 } while (0)
 
+/*
+ *  stress_bsearch_check()
+ *	verify that the element at index i was found
+ */
+static inline void stress_bsearch_check(
+	const stress_args_t *args,
+	const int32_t *data,
+	const size_t n,
+	const int32_t *result,
+	const size_t i)
+{
+	if ((result == NULL) || (result >= data + n))
+		pr_fail("%s: element %zu could not be found\n",
+			args->name, i);
+	else if (*result != data[i])
+		pr_fail("%s: element %zu "
+			"found %" PRIu32
+			", expecting %" PRIu32 "\n",
+			args->name, i, *result, data[i]);
+}
+
+/*
+ *  stress_bsearch_libc()
+ *	libc bsearch, one indirect comparison call per probe
+ */
+static size_t stress_bsearch_libc(
+	const stress_args_t *args,
+	const int32_t *data,
+	const uint32_t *order,
+	const size_t n)
+{
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		const size_t idx = (size_t)order[i];
+		const int32_t *result;
+
+		result = bsearch(&data[idx], data, n, sizeof(*data), cmp);
+		if (UNLIKELY(verify))
+			stress_bsearch_check(args, data, n, result, idx);
+	}
+	return n;
+}
+
+/*
+ *  stress_bsearch_branchless_find()
+ *	lower bound search, the probe selects the next base with a
+ *	conditional move rather than a branch so there is nothing
+ *	to mispredict; both of the possible next probes are
+ *	prefetched to overlap the cache misses of the next step
+ */
+static inline const int32_t *stress_bsearch_branchless_find(
+	const int32_t *base,
+	size_t n,
+	const int32_t key)
+{
+	while (n > 1) {
+		const size_t half = n >> 1;
+		const size_t next = (n - half) >> 1;
+
+		shim_builtin_prefetch(&base[next]);
+		shim_builtin_prefetch(&base[half + next]);
+		base = (base[half] < key) ? base + half : base;
+		n -= half;
+	}
+	return base + (*base < key);
+}
+
+/*
+ *  stress_bsearch_branchless()
+ *	inlined branchless binary search
+ */
+static size_t OPTIMIZE3 stress_bsearch_branchless(
+	const stress_args_t *args,
+	const int32_t *data,
+	const uint32_t *order,
+	const size_t n)
+{
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		const size_t idx = (size_t)order[i];
+		const int32_t *result;
+
+		result = stress_bsearch_branchless_find(data, n, data[idx]);
+		if (UNLIKELY(verify))
+			stress_bsearch_check(args, data, n, result, idx);
+	}
+	return n;
+}
+
+/*
+ *  stress_bsearch_interpolation_find()
+ *	interpolation search, guesses the position from the key
+ *	value, the data is near uniform so this takes O(log log n)
+ *	probes but each probe is a dependent divide
+ */
+static inline const int32_t *stress_bsearch_interpolation_find(
+	const int32_t *data,
+	const size_t n,
+	const int32_t key)
+{
+	size_t lo = 0, hi = n - 1;
+
+	while ((key >= data[lo]) && (key <= data[hi])) {
+		const int64_t range = (int64_t)data[hi] - (int64_t)data[lo];
+		size_t pos;
+
+		if (range == 0)
+			return (data[lo] == key) ? &data[lo] : NULL;
+		pos = lo + (size_t)((((int64_t)key - (int64_t)data[lo]) *
+			(int64_t)(hi - lo)) / range);
+		if (data[pos] == key)
+			return &data[pos];
+		/* pos > lo if data[pos] > key, so pos - 1 can't wrap */
+		if (data[pos] < key)
+			lo = pos + 1;
+		else
+			hi = pos - 1;
+		if (lo > hi)
+			break;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_bsearch_interpolation()
+ *	inlined interpolation search
+ */
+static size_t OPTIMIZE3 stress_bsearch_interpolation(
+	const stress_args_t *args,
+	const int32_t *data,
+	const uint32_t *order,
+	const size_t n)
+{
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		const size_t idx = (size_t)order[i];
+		const int32_t *result;
+
+		result = stress_bsearch_interpolation_find(data, n, data[idx]);
+		if (UNLIKELY(verify))
+			stress_bsearch_check(args, data, n, result, idx);
+	}
+	return n;
+}
+
+/* indexed by bsearch-method, "all" has no function */
+static const stress_bsearch_func_t bsearch_funcs[] = {
+	NULL,
+	stress_bsearch_libc,
+	stress_bsearch_branchless,
+	stress_bsearch_interpolation,
+};
+
+/*
+ *  stress_bsearch_order()
+ *	shuffle the lookup order of the first n elements so that
+ *	successive lookups don't follow the same search path
+ */
+static void stress_bsearch_order(uint32_t *order, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		order[i] = (uint32_t)i;
+	for (i = n - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc32() % (i + 1);
+		const uint32_t tmp = order[i];
+
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+}
+
 /*
  *  stress_bsearch()
  *	stress bsearch
  */
 static int stress_bsearch(const stress_args_t *args)
 {
-	int32_t *data, *ptr, prev = 0;
-	size_t n, n8, i;
+	int32_t *data, prev = 0;
+	uint32_t *order;
+	size_t n, n8, i, method = 1, first, last;
+	size_t sizes[BSEARCH_MAX_SIZES], n_sizes = 0, size_idx = 0, order_size = 0;
 	uint64_t bsearch_size = DEFAULT_BSEARCH_SIZE;
+	bool bsearch_sweep = false;
 
+	(void)stress_get_setting("bsearch-method", &method);
+	(void)stress_get_setting("bsearch-sweep", &bsearch_sweep);
 	if (!stress_get_setting("bsearch-size", &bsearch_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			bsearch_size = MAX_BSEARCH_SIZE;
@@ -102,12 +331,46 @@ static int stress_bsearch(const stress_args_t *args)
 	n = (size_t)bsearch_size;
 	n8 = (n + 7) & ~7UL;
 
+	/* sweep from L1 cache sized arrays in x4 steps up to the array size */
+	if (bsearch_sweep) {
+		size_t sz;
+
+		for (sz = BSEARCH_SWEEP_MIN; (sz < n) && (n_sizes < BSEARCH_MAX_SIZES - 1); sz *= 4)
+			sizes[n_sizes++] = sz;
+	}
+	sizes[n_sizes++] = n;
+
+	if (method == 0) {
+		first = 1;
+		last = SIZEOF_ARRAY(bsearch_funcs) - 1;
+	} else {
+		first = method;
+		last = method;
+	}
+	for (i = first; i <= last; i++) {
+		size_t s;
+
+		for (s = 0; s < n_sizes; s++) {
+			char name[24], str[12];
+
+			stress_uint64_to_str(str, sizeof(str), (uint64_t)sizes[s]);
+			(void)snprintf(name, sizeof(name), "%s %s", bsearch_methods[i], str);
+			stress_method_stats_init(args, (i - 1) * BSEARCH_MAX_SIZES + s, name, 0.0);
+		}
+	}
+
 	/* allocate in multiples of 8 */
 	if ((data = calloc(n8, sizeof(*data))) == NULL) {
 		pr_dbg("%s: malloc failed, out of memory\n",
 			args->name);
 		return EXIT_NO_RESOURCE;
 	}
+	if ((order = calloc(n, sizeof(*order))) == NULL) {
+		pr_dbg("%s: malloc failed, out of memory\n",
+			args->name);
+		free(data);
+		return EXIT_NO_RESOURCE;
+	}
 
 	/* Populate with ascending data */
 	prev = 0;
@@ -127,26 +390,28 @@ static int stress_bsearch(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		for (ptr = data, i = 0; i < n; i++, ptr++) {
-			int32_t *result;
-
-			result = bsearch(ptr, data, n, sizeof(*ptr), cmp);
-			if (g_opt_flags & OPT_FLAGS_VERIFY) {
-				if (result == NULL)
-					pr_fail("%s: element %zu could not be found\n",
-						args->name, i);
-				else if (*result != *ptr)
-					pr_fail("%s: element %zu "
-						"found %" PRIu32
-						", expecting %" PRIu32 "\n",
-						args->name, i, *result, *ptr);
-			}
+		const size_t sz = sizes[size_idx];
+
+		if (order_size != sz) {
+			stress_bsearch_order(order, sz);
+			order_size = sz;
+		}
+		for (i = first; keep_stressing_flag() && (i <= last); i++) {
+			const double t = stress_time_now();
+			const size_t lookups = bsearch_funcs[i](args, data, order, sz);
+
+			stress_method_stats_add_count(args, (i - 1) * BSEARCH_MAX_SIZES + size_idx,
+				(uint64_t)lookups, stress_time_now() - t);
 		}
+		size_idx++;
+		if (size_idx >= n_sizes)
+			size_idx = 0;
 		inc_counter(args);
 	} while (keep_stressing(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	free(order);
 	free(data);
 	return EXIT_SUCCESS;
 }
@@ -19,6 +19,8 @@
  */
 #include "stress-ng.h"
 #include "core-cache.h"
+#include "core-numa.h"
+#include "core-perf.h"
 #include "core-put.h"
 
 #define FLAGS_CACHE_PREFETCH	(0x0001U)
@@ -30,6 +32,9 @@
 #define FLAGS_CACHE_CLWB	(0x0040U)
 #define FLAGS_CACHE_NOAFF	(0x8000U)
 
+#define CACHE_BUFFER_SHARED	(0)
+#define CACHE_BUFFER_PRIVATE	(1)
+
 typedef void (*cache_write_func_t)(uint64_t inc, const uint64_t r, uint64_t *pi, uint64_t *pk);
 typedef void (*cache_write_page_func_t)(uint8_t *const addr, const uint64_t size);
 
@@ -58,10 +63,18 @@ static mask_flag_info_t mask_flag_info[] = {
 static sigjmp_buf jmp_env;
 static volatile uint32_t masked_flags;
 static uint64_t disabled_flags;
+static uint8_t *cache_buf;	/* shared or private cache buffer */
+static uint64_t cache_size;	/* bytes of cache_buf used by this instance */
+
+static const char *cache_buffers[] = {
+	"shared",		/* CACHE_BUFFER_SHARED */
+	"private",		/* CACHE_BUFFER_PRIVATE */
+};
 
 static const stress_help_t help[] = {
 	{ "C N","cache N",	 	"start N CPU cache thrashing workers" },
 	{ NULL,	"cache-ops N",	 	"stop after N cache bogo operations" },
+	{ NULL,	"cache-buffer B",	"use a shared or a private per instance cache buffer" },
 #if defined(HAVE_ASM_X86_CLDEMOTE)
 	{ NULL,	"cache-cldemote",	"cache line demote (x86 only)" },
 #endif
@@ -163,7 +176,32 @@ static int stress_cache_set_sfence(const char *opt)
 #endif
 }
 
+/*
+ *  stress_set_cache_buffer()
+ *	set the cache buffer mode, shared between all instances
+ *	or private node-local buffers per instance
+ */
+static int stress_set_cache_buffer(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(cache_buffers); i++) {
+		if (!strcmp(opt, cache_buffers[i])) {
+			stress_set_setting("cache-buffer", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "invalid cache-buffer '%s', allowed cache-buffer modes are:", opt);
+	for (i = 0; i < SIZEOF_ARRAY(cache_buffers); i++)
+		(void)fprintf(stderr, " %s", cache_buffers[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_cache_buffer,		stress_set_cache_buffer },
 	{ OPT_cache_cldemote,		stress_cache_set_cldemote },
 	{ OPT_cache_clflushopt,		stress_cache_set_clflushopt },
 	{ OPT_cache_enable_all,		stress_cache_set_enable_all },
@@ -264,8 +302,8 @@ static void OPTIMIZE3 stress_cache_write_mod_ ## x(			\
 	uint64_t *pi, uint64_t *pk)					\
 {									\
 	register uint64_t i = *pi, j, k = *pk;				\
-	uint8_t *const mem_cache = g_shared->mem_cache;			\
-	const uint64_t mem_cache_size = g_shared->mem_cache_size;	\
+	uint8_t *const mem_cache = cache_buf;				\
+	const uint64_t mem_cache_size = cache_size;			\
 									\
 	CACHE_WRITE_MOD(x);						\
 									\
@@ -607,6 +645,38 @@ static void stress_cache_flush(void *addr, void *bad_addr, int size)
 #endif
 }
 
+/*
+ *  stress_cache_private_alloc()
+ *	allocate a private cache buffer for this instance that is
+ *	bound to the NUMA node of the CPU it is running on and
+ *	populated from this CPU so it is node-local
+ */
+static uint8_t NOINLINE *stress_cache_private_alloc(const stress_args_t *args, const uint64_t size)
+{
+	uint8_t *buf;
+#if defined(HAVE_AFFINITY) &&	\
+    defined(HAVE_SCHED_GETCPU)
+	unsigned long node;
+#endif
+
+	buf = (uint8_t *)mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %" PRIu64 "K private cache buffer, "
+			"skipping stressor, errno=%d (%s)\n",
+			args->name, size / 1024, errno, strerror(errno));
+		return NULL;
+	}
+#if defined(HAVE_AFFINITY) &&	\
+    defined(HAVE_SCHED_GETCPU)
+	if (stress_numa_cpu_node(sched_getcpu(), &node) == 0)
+		(void)stress_numa_mbind_nodes(buf, (size_t)size, false, &node, 1);
+#endif
+	(void)memset(buf, 0, (size_t)size);
+
+	return buf;
+}
+
 /*
  *  stress_cache()
  *	stress cache by psuedo-random memory read/writes and
@@ -625,34 +695,61 @@ static int stress_cache(const stress_args_t *args)
 #endif
 	uint32_t cache_flags = 0;
 	NOCLOBBER uint32_t total = 0;
-	int ret = EXIT_SUCCESS;
-	uint8_t *const mem_cache = g_shared->mem_cache;
-	const uint64_t mem_cache_size = g_shared->mem_cache_size;
+	NOCLOBBER int ret = EXIT_SUCCESS;
+	size_t cache_buffer = CACHE_BUFFER_SHARED;
+	const uint64_t mem_cache_size = stress_cache_instance_size();
+	uint8_t *mem_cache;
 	uint64_t i = stress_mwc64() % mem_cache_size;
 	uint64_t k = i + (mem_cache_size >> 1);
 	NOCLOBBER uint64_t r = 0;
 	uint64_t inc = (mem_cache_size >> 2) + 1;
 	void *bad_addr;
+#if defined(STRESS_PERF_STATS)
+	stress_perf_cache_t perf_cache;
+	NOCLOBBER bool perf_cache_ok;
+#endif
 
 	disabled_flags = 0;
 
+	(void)stress_get_setting("cache-buffer", &cache_buffer);
+	if (cache_buffer == CACHE_BUFFER_PRIVATE) {
+		mem_cache = stress_cache_private_alloc(args, mem_cache_size);
+		if (!mem_cache)
+			return EXIT_NO_RESOURCE;
+	} else {
+		mem_cache = g_shared->mem_cache;
+	}
+	cache_buf = mem_cache;
+	cache_size = mem_cache_size;
+
 	if (sigsetjmp(jmp_env, 1)) {
 		pr_inf("%s: premature SIGSEGV caught, skipping stressor\n",
 			args->name);
-		return EXIT_NO_RESOURCE;
+		ret = EXIT_NO_RESOURCE;
+		goto tidy;
 	}
 
-	if (stress_sighandler(args->name, SIGSEGV, stress_cache_sighandler, NULL) < 0)
-		return EXIT_NO_RESOURCE;
-	if (stress_sighandler(args->name, SIGBUS, stress_cache_sighandler, NULL) < 0)
-		return EXIT_NO_RESOURCE;
-	if (stress_sighandler(args->name, SIGILL, stress_cache_sigillhandler, NULL) < 0)
-		return EXIT_NO_RESOURCE;
+	if ((stress_sighandler(args->name, SIGSEGV, stress_cache_sighandler, NULL) < 0) ||
+	    (stress_sighandler(args->name, SIGBUS, stress_cache_sighandler, NULL) < 0) ||
+	    (stress_sighandler(args->name, SIGILL, stress_cache_sigillhandler, NULL) < 0)) {
+		ret = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
 
 	(void)stress_get_setting("cache-flags", &cache_flags);
-	if (args->instance == 0)
+	if (mem_cache_size != g_shared->mem_cache_size)
+		pr_dbg("%s: instance %" PRIu32 " using %" PRIu64 "K of the "
+			"%" PRIu64 "K cache buffer to match the cache of its CPU(s)\n",
+			args->name, args->instance, mem_cache_size / 1024,
+			g_shared->mem_cache_size / 1024);
+	else if (args->instance == 0)
 		pr_dbg("%s: using cache buffer size of %" PRIu64 "K\n",
 			args->name, mem_cache_size / 1024);
+	if (args->instance == 0)
+		pr_dbg("%s: using %s cache buffer%s\n", args->name,
+			cache_buffers[cache_buffer],
+			(cache_buffer == CACHE_BUFFER_PRIVATE) ?
+			"s, one per instance" : "");
 
 #if defined(HAVE_SCHED_GETAFFINITY) && 	\
     defined(HAVE_SCHED_GETCPU)
@@ -758,6 +855,11 @@ static int stress_cache(const stress_args_t *args)
 		(void)munmap(bad_addr, args->page_size);
 
 	masked_flags = cache_flags & FLAGS_CACHE_MASK;
+#if defined(STRESS_PERF_STATS)
+	perf_cache_ok = (stress_perf_cache_open(&perf_cache, g_shared->mem_cache_level) == 0);
+	if (!perf_cache_ok && (args->instance == 0))
+		pr_dbg("%s: cache miss counters not available\n", args->name);
+#endif
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -800,8 +902,10 @@ static int stress_cache(const stress_args_t *args)
 
 			/* Pin to the current CPU */
 			current = sched_getcpu();
-			if (current < 0)
-				return EXIT_FAILURE;
+			if (current < 0) {
+				ret = EXIT_FAILURE;
+				break;
+			}
 
 			cpu = (uint32_t)current;
 		} else {
@@ -884,6 +988,29 @@ next:
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+#if defined(STRESS_PERF_STATS)
+	if (perf_cache_ok) {
+		uint64_t refs, misses;
+
+		if ((stress_perf_cache_read(&perf_cache, &refs, &misses) == 0) && (refs > 0)) {
+			const uint64_t ops = get_counter(args);
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s miss rate %% (%s)",
+				(g_shared->mem_cache_level == 1) ? "L1D" : "LLC",
+				cache_buffers[cache_buffer]);
+			stress_misc_stats_set(args->misc_stats, 0, desc,
+				100.0 * (double)misses / (double)refs);
+			stress_misc_stats_set(args->misc_stats, 1, "cache misses per bogo op",
+				ops ? (double)misses / (double)ops : 0.0);
+		}
+		stress_perf_cache_close(&perf_cache);
+	}
+#endif
+tidy:
+	if (cache_buffer == CACHE_BUFFER_PRIVATE)
+		(void)munmap((void *)mem_cache, (size_t)mem_cache_size);
+
 	return ret;
 }
 
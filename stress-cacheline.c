@@ -21,6 +21,11 @@
 
 #define DEFAULT_L1_SIZE		(64)
 
+#define CACHELINE_MATRIX_ROUNDS		(1000)	/* round trips per sample */
+#define CACHELINE_MATRIX_SAMPLES	(8)	/* samples per CPU pair and method */
+#define CACHELINE_MATRIX_WARMUP		(200)	/* untimed round trips */
+#define CACHELINE_MATRIX_METHODS	(2)	/* load (read-shared) and rfo */
+
 #if defined(HAVE_ATOMIC_FETCH_ADD) &&	\
     defined(__ATOMIC_RELAXED)
 #define SHIM_ATOMIC_INC(ptr)       \
@@ -65,6 +70,8 @@ static const stress_help_t help[] = {
 	{ NULL,	"cacheline N",		"start N workers that exercise cachelines" },
 	{ NULL,	"cacheline-ops N",	"stop after N cacheline bogo operations" },
 	{ NULL,	"cacheline-affinity",	"modify CPU affinity" },
+	{ NULL,	"cacheline-matrix",	"measure core to core cache line transfer latency matrix" },
+	{ NULL,	"cacheline-matrix-csv f","write the core to core latency matrix to CSV file f" },
 	{ NULL,	"cacheline-method M",	"use cacheline stressing method M" },
 	{ NULL,	NULL,			NULL }
 };
@@ -599,6 +606,16 @@ static int stress_set_cacheline_affinity(const char *opt)
 	return stress_set_setting_true("cacheline-affinity", opt);
 }
 
+static int stress_set_cacheline_matrix(const char *opt)
+{
+	return stress_set_setting_true("cacheline-matrix", opt);
+}
+
+static int stress_set_cacheline_matrix_csv(const char *opt)
+{
+	return stress_set_setting("cacheline-matrix-csv", TYPE_ID_STR, opt);
+}
+
 /*
  *  stress_set_cacheline_method()
  *	set the default cachline stress method
@@ -680,6 +697,389 @@ static int stress_cacheline_child(
 	return rc;
 }
 
+#if defined(__linux__) &&		\
+    defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(HAVE_AFFINITY) &&		\
+    defined(HAVE_SCHED_GETAFFINITY)
+
+static const char * const cacheline_matrix_methods[CACHELINE_MATRIX_METHODS] = {
+	"load",		/* spin on a read-shared copy, then store */
+	"rfo",		/* spin with compare-and-swap, every poll is an RFO */
+};
+
+/* per CPU pair sample statistics, index [method][a * n + b] */
+typedef struct {
+	double *min;		/* fastest sample one-way latency, ns */
+	double *sum;		/* sum of sample latencies */
+	double *sumsq;		/* sum of squared sample latencies */
+	uint32_t *count;	/* number of samples */
+} stress_cacheline_matrix_t;
+
+typedef struct {
+	uint64_t *seq;		/* ping-pong sequence, sole user of its cache line */
+	int *ready;		/* responder state, on a separate cache line */
+	int cpu;		/* CPU to pin the responder to */
+	bool rfo;		/* use the rfo method */
+	uint64_t rounds;	/* round trips to respond to */
+} stress_cacheline_pong_t;
+
+/*
+ *  stress_cacheline_pingpong()
+ *	hand the sequence cache line back and forth, the pinger owns the
+ *	even values and the responder the odd values
+ */
+static void OPTIMIZE3 stress_cacheline_pingpong(
+	uint64_t *seq,
+	const uint64_t first,
+	const uint64_t rounds,
+	const bool rfo)
+{
+	const uint64_t end = first + (2 * rounds);
+	uint64_t v;
+
+	if (rfo) {
+		for (v = first; v < end; v += 2) {
+			uint64_t expected;
+
+			do {
+				expected = v;
+			} while (!__atomic_compare_exchange_n(seq, &expected, v + 1,
+					false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+		}
+	} else {
+		for (v = first; v < end; v += 2) {
+			while (__atomic_load_n(seq, __ATOMIC_ACQUIRE) != v)
+				;
+			__atomic_store_n(seq, v + 1, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+static int stress_cacheline_pin(const int cpu)
+{
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	return sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+static void *stress_cacheline_pong(void *arg)
+{
+	stress_cacheline_pong_t *pong = (stress_cacheline_pong_t *)arg;
+
+	if (stress_cacheline_pin(pong->cpu) < 0) {
+		__atomic_store_n(pong->ready, -1, __ATOMIC_RELEASE);
+		return NULL;
+	}
+	__atomic_store_n(pong->ready, 1, __ATOMIC_RELEASE);
+	stress_cacheline_pingpong(pong->seq, 1, pong->rounds, pong->rfo);
+	return NULL;
+}
+
+/*
+ *  stress_cacheline_matrix_pair()
+ *	measure the one-way cache line transfer latency between the
+ *	calling thread on cpu_a and a responder thread on cpu_b
+ */
+static int stress_cacheline_matrix_pair(
+	const stress_args_t *args,
+	uint8_t *lines,
+	const int cpu_a,
+	const int cpu_b,
+	const size_t m,
+	const size_t idx,
+	const stress_cacheline_matrix_t *matrix)
+{
+	stress_cacheline_pong_t pong;
+	pthread_t pthread;
+	uint64_t first;
+	int ret, ready;
+	size_t i;
+
+	pong.seq = (uint64_t *)lines;
+	pong.ready = (int *)(lines + 256);	/* avoid adjacent line prefetch */
+	pong.cpu = cpu_b;
+	pong.rfo = (m == 1);
+	pong.rounds = CACHELINE_MATRIX_WARMUP +
+		(CACHELINE_MATRIX_SAMPLES * CACHELINE_MATRIX_ROUNDS);
+	*pong.seq = 0;
+	*pong.ready = 0;
+
+	if (stress_cacheline_pin(cpu_a) < 0)
+		return -1;
+	ret = pthread_create(&pthread, NULL, stress_cacheline_pong, &pong);
+	if (ret) {
+		pr_inf("%s: pthread_create failed, errno=%d (%s)\n",
+			args->name, ret, strerror(ret));
+		return -1;
+	}
+	while ((ready = __atomic_load_n(pong.ready, __ATOMIC_ACQUIRE)) == 0)
+		;
+	if (ready < 0) {
+		(void)pthread_join(pthread, NULL);
+		return -1;
+	}
+
+	stress_cacheline_pingpong(pong.seq, 0, CACHELINE_MATRIX_WARMUP, pong.rfo);
+	first = 2 * CACHELINE_MATRIX_WARMUP;
+	for (i = 0; i < CACHELINE_MATRIX_SAMPLES; i++) {
+		double t, ns;
+
+		t = stress_time_now();
+		stress_cacheline_pingpong(pong.seq, first, CACHELINE_MATRIX_ROUNDS, pong.rfo);
+		ns = (stress_time_now() - t) * (double)STRESS_NANOSECOND /
+			(2.0 * CACHELINE_MATRIX_ROUNDS);
+		first += 2 * CACHELINE_MATRIX_ROUNDS;
+
+		if ((matrix->count[idx] == 0) || (ns < matrix->min[idx]))
+			matrix->min[idx] = ns;
+		matrix->sum[idx] += ns;
+		matrix->sumsq[idx] += ns * ns;
+		matrix->count[idx]++;
+	}
+	(void)pthread_join(pthread, NULL);
+	return 0;
+}
+
+static double stress_cacheline_matrix_get(
+	const stress_cacheline_matrix_t *matrix,
+	const size_t n,
+	const size_t a,
+	const size_t b)
+{
+	const size_t idx = (a < b) ? (a * n) + b : (b * n) + a;
+
+	return matrix->count[idx] ? matrix->min[idx] : 0.0;
+}
+
+/*
+ *  stress_cacheline_matrix_report()
+ *	print the latency matrices, the spread across CPU pairs and the
+ *	sample to sample jitter of the read-shared and rfo methods
+ */
+static void stress_cacheline_matrix_report(
+	const stress_args_t *args,
+	const int *cpus,
+	const size_t n,
+	stress_cacheline_matrix_t matrix[CACHELINE_MATRIX_METHODS])
+{
+	const size_t line_size = 32 + (n * 8);
+	const char *csv_filename = NULL;
+	double mean_ns[CACHELINE_MATRIX_METHODS];
+	FILE *csv = NULL;
+	char *line;
+	size_t m, a, b;
+	int idx = 0;
+
+	(void)stress_get_setting("cacheline-matrix-csv", &csv_filename);
+	if (csv_filename) {
+		csv = fopen(csv_filename, "w");
+		if (!csv)
+			pr_inf("%s: cannot create CSV file '%s', errno=%d (%s)\n",
+				args->name, csv_filename, errno, strerror(errno));
+	}
+	line = malloc(line_size);
+	if (!line) {
+		if (csv)
+			(void)fclose(csv);
+		return;
+	}
+
+	for (m = 0; m < CACHELINE_MATRIX_METHODS; m++) {
+		const stress_cacheline_matrix_t *mx = &matrix[m];
+		double min = 0.0, max = 0.0, sum = 0.0, sumsq = 0.0, jitter = 0.0;
+		double pairs = 0.0;
+		size_t len;
+
+		pr_inf("%s: %s one-way cache line transfer latency (ns), CPU x CPU:\n",
+			args->name, cacheline_matrix_methods[m]);
+		len = (size_t)snprintf(line, line_size, "%5s", "");
+		for (b = 0; b < n; b++)
+			len += (size_t)snprintf(line + len, line_size - len, " %7d", cpus[b]);
+		pr_inf("%s: %s\n", args->name, line);
+		if (csv) {
+			(void)fprintf(csv, "%s", cacheline_matrix_methods[m]);
+			for (b = 0; b < n; b++)
+				(void)fprintf(csv, ",%d", cpus[b]);
+			(void)fprintf(csv, "\n");
+		}
+
+		for (a = 0; a < n; a++) {
+			len = (size_t)snprintf(line, line_size, "%5d", cpus[a]);
+			if (csv)
+				(void)fprintf(csv, "%d", cpus[a]);
+			for (b = 0; b < n; b++) {
+				const double ns = stress_cacheline_matrix_get(mx, n, a, b);
+
+				if (ns > 0.0) {
+					len += (size_t)snprintf(line + len, line_size - len, " %7.1f", ns);
+					if (csv)
+						(void)fprintf(csv, ",%.1f", ns);
+				} else {
+					len += (size_t)snprintf(line + len, line_size - len, " %7s", "-");
+					if (csv)
+						(void)fprintf(csv, ",");
+				}
+			}
+			pr_inf("%s: %s\n", args->name, line);
+			if (csv)
+				(void)fprintf(csv, "\n");
+		}
+		if (csv)
+			(void)fprintf(csv, "\n");
+
+		for (a = 0; a < n; a++) {
+			for (b = a + 1; b < n; b++) {
+				const size_t i = (a * n) + b;
+				const double ns = mx->min[i];
+				double mean, var;
+
+				if (!mx->count[i])
+					continue;
+				min = (pairs > 0.0) ? STRESS_MINIMUM(min, ns) : ns;
+				max = (pairs > 0.0) ? STRESS_MAXIMUM(max, ns) : ns;
+				sum += ns;
+				sumsq += ns * ns;
+				pairs += 1.0;
+
+				mean = mx->sum[i] / (double)mx->count[i];
+				var = (mx->sumsq[i] / (double)mx->count[i]) - (mean * mean);
+				jitter += (var > 0.0) ? sqrt(var) : 0.0;
+			}
+		}
+		mean_ns[m] = 0.0;
+		if (pairs > 0.0) {
+			const double var = (sumsq / pairs) - ((sum / pairs) * (sum / pairs));
+
+			mean_ns[m] = sum / pairs;
+			pr_inf("%s: %s: %.0f CPU pairs, min %.1f ns, mean %.1f ns, max %.1f ns, "
+				"stddev across pairs %.1f ns, mean per pair sample stddev %.1f ns\n",
+				args->name, cacheline_matrix_methods[m], pairs, min, mean_ns[m], max,
+				(var > 0.0) ? sqrt(var) : 0.0, jitter / pairs);
+			if (idx < STRESS_MISC_STATS_MAX - 1) {
+				char desc[48];
+
+				(void)snprintf(desc, sizeof(desc), "%s mean ns per transfer",
+					cacheline_matrix_methods[m]);
+				stress_misc_stats_set(args->misc_stats, idx++, desc, mean_ns[m]);
+				(void)snprintf(desc, sizeof(desc), "%s max ns per transfer",
+					cacheline_matrix_methods[m]);
+				stress_misc_stats_set(args->misc_stats, idx++, desc, max);
+			}
+		}
+	}
+	if ((mean_ns[0] > 0.0) && (mean_ns[1] > 0.0))
+		pr_inf("%s: rfo to load mean latency ratio %.2f\n",
+			args->name, mean_ns[1] / mean_ns[0]);
+
+	free(line);
+	if (csv)
+		(void)fclose(csv);
+}
+
+/*
+ *  stress_cacheline_matrix()
+ *	ping-pong a cache line between every pair of the allowed CPUs,
+ *	each bogo-op measures one pair with both methods, the pairs are
+ *	revisited until the run ends keeping the fastest sample
+ */
+static int stress_cacheline_matrix(const stress_args_t *args)
+{
+	stress_cacheline_matrix_t matrix[CACHELINE_MATRIX_METHODS];
+	cpu_set_t mask;
+	int *cpus;
+	uint8_t *lines;
+	size_t n = 0, m, a = 0, b = 1, pairs_done = 0;
+	int cpu, rc = EXIT_SUCCESS;
+
+	if (args->instance > 0) {
+		if (args->instance == 1)
+			pr_inf_skip("%s: only instance 0 measures the latency matrix, "
+				"skipping other instances\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf_skip("%s: sched_getaffinity failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	if (CPU_COUNT(&mask) < 2) {
+		pr_inf_skip("%s: cacheline-matrix needs at least 2 usable CPUs, "
+			"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	cpus = calloc((size_t)CPU_COUNT(&mask), sizeof(*cpus));
+	if (!cpus) {
+		pr_inf_skip("%s: cannot allocate CPU list, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &mask))
+			cpus[n++] = cpu;
+	}
+
+	(void)memset(matrix, 0, sizeof(matrix));
+	for (m = 0; m < CACHELINE_MATRIX_METHODS; m++) {
+		matrix[m].min = calloc(n * n, sizeof(*matrix[m].min));
+		matrix[m].sum = calloc(n * n, sizeof(*matrix[m].sum));
+		matrix[m].sumsq = calloc(n * n, sizeof(*matrix[m].sumsq));
+		matrix[m].count = calloc(n * n, sizeof(*matrix[m].count));
+		if (!matrix[m].min || !matrix[m].sum || !matrix[m].sumsq || !matrix[m].count) {
+			pr_inf_skip("%s: cannot allocate %zu x %zu latency matrix, "
+				"skipping stressor\n", args->name, n, n);
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+	}
+	lines = (uint8_t *)mmap(NULL, args->page_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (lines == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap cache line buffer, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	pr_inf("%s: measuring %zu x %zu CPU cache line transfer latency matrix\n",
+		args->name, n, n);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (m = 0; m < CACHELINE_MATRIX_METHODS; m++) {
+			if (stress_cacheline_matrix_pair(args, lines, cpus[a], cpus[b],
+							 m, (a * n) + b, &matrix[m]) < 0)
+				break;
+		}
+		inc_counter(args);
+		pairs_done++;
+		if (++b >= n) {
+			a = (a + 1 >= n - 1) ? 0 : a + 1;
+			b = a + 1;
+		}
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (pairs_done < (n * (n - 1)) / 2)
+		pr_inf("%s: only %zu of %zu CPU pairs measured, increase --timeout for a "
+			"full matrix\n", args->name, pairs_done, (n * (n - 1)) / 2);
+	stress_cacheline_matrix_report(args, cpus, n, matrix);
+
+	(void)munmap((void *)lines, args->page_size);
+tidy:
+	for (m = 0; m < CACHELINE_MATRIX_METHODS; m++) {
+		free(matrix[m].count);
+		free(matrix[m].sumsq);
+		free(matrix[m].sum);
+		free(matrix[m].min);
+	}
+	free(cpus);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_cacheline()
  *	execise a cacheline by multiple processes
@@ -693,7 +1093,23 @@ static int stress_cacheline(const stress_args_t *args)
 	size_t cacheline_method = 0;
 	stress_cacheline_func func;
 	bool cacheline_affinity = false;
-
+	bool cacheline_matrix = false;
+
+	(void)stress_get_setting("cacheline-matrix", &cacheline_matrix);
+	if (cacheline_matrix) {
+#if defined(__linux__) &&		\
+    defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(HAVE_AFFINITY) &&		\
+    defined(HAVE_SCHED_GETAFFINITY)
+		return stress_cacheline_matrix(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: cacheline-matrix is not supported on this system, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 	(void)stress_get_setting("cacheline-affinity", &cacheline_affinity);
 	(void)stress_get_setting("cacheline-method", &cacheline_method);
 
@@ -743,6 +1159,8 @@ finish:
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_cacheline_affinity,	stress_set_cacheline_affinity },
+	{ OPT_cacheline_matrix,		stress_set_cacheline_matrix },
+	{ OPT_cacheline_matrix_csv,	stress_set_cacheline_matrix_csv },
 	{ OPT_cacheline_method,		stress_set_cacheline_method },
 	{ 0,				NULL },
 };
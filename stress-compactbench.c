@@ -0,0 +1,407 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+
+#define MIN_COMPACTBENCH_BYTES		(16 * MB)
+#define MAX_COMPACTBENCH_BYTES		(MAX_MEM_LIMIT)
+#define DEFAULT_COMPACTBENCH_BYTES	(256 * MB)
+
+#define COMPACTBENCH_THP_SIZE		(2 * MB)	/* x86/arm64 PMD size */
+#define COMPACTBENCH_THP_PAGES		(32)		/* huge pages faulted per round */
+#define COMPACTBENCH_SAMPLES		(8192)		/* latencies kept per mode */
+
+static const stress_help_t help[] = {
+	{ NULL,	"compactbench N",	"start N workers measuring THP fault latency on fragmented memory" },
+	{ NULL,	"compactbench-bytes N",	"fragment N bytes of 4K pages, default 256M" },
+	{ NULL,	"compactbench-mode M",	"THP defrag mode: all, always, defer, defer+madvise, madvise or never" },
+	{ NULL,	"compactbench-ops N",	"stop after N THP faults" },
+	{ NULL,	NULL,			NULL }
+};
+
+/* names as used in /sys/kernel/mm/transparent_hugepage/defrag */
+static const char * const compactbench_modes[] = {
+	"all",
+	"always",
+	"defer",
+	"defer+madvise",
+	"madvise",
+	"never",
+};
+
+#define COMPACTBENCH_MODES	(SIZEOF_ARRAY(compactbench_modes))
+
+static int stress_set_compactbench_bytes(const char *opt)
+{
+	size_t compactbench_bytes;
+
+	compactbench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("compactbench-bytes", compactbench_bytes,
+		MIN_COMPACTBENCH_BYTES, MAX_COMPACTBENCH_BYTES);
+	return stress_set_setting("compactbench-bytes", TYPE_ID_SIZE_T, &compactbench_bytes);
+}
+
+static int stress_set_compactbench_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < COMPACTBENCH_MODES; i++) {
+		if (!strcmp(opt, compactbench_modes[i]))
+			return stress_set_setting("compactbench-mode", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "compactbench-mode must be one of:");
+	for (i = 0; i < COMPACTBENCH_MODES; i++)
+		(void)fprintf(stderr, " %s", compactbench_modes[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_compactbench_bytes,	stress_set_compactbench_bytes },
+	{ OPT_compactbench_mode,	stress_set_compactbench_mode },
+	{ 0,				NULL }
+};
+
+#if defined(__linux__) &&	\
+    defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_DONTNEED)
+
+/* /proc/vmstat counters sampled around each round of THP faults */
+static const char * const compactbench_counters[] = {
+	"compact_stall",
+	"compact_success",
+	"compact_fail",
+	"thp_fault_alloc",
+	"thp_fault_fallback",
+};
+
+#define COMPACT_STALL		(0)
+#define COMPACT_SUCCESS		(1)
+#define COMPACT_FAIL		(2)
+#define THP_FAULT_ALLOC		(3)
+#define THP_FAULT_FALLBACK	(4)
+#define COMPACTBENCH_COUNTERS	(SIZEOF_ARRAY(compactbench_counters))
+
+static const char compactbench_defrag_path[] = "/sys/kernel/mm/transparent_hugepage/defrag";
+static const char compactbench_enabled_path[] = "/sys/kernel/mm/transparent_hugepage/enabled";
+
+/* THP fault cost under one defrag mode */
+typedef struct {
+	uint64_t faults;		/* huge page sized faults timed */
+	uint64_t counters[COMPACTBENCH_COUNTERS];	/* vmstat deltas */
+	uint64_t *latencies;		/* fault latency samples, ns */
+	size_t n_latencies;		/* samples held */
+} stress_compactbench_stats_t;
+
+static int stress_compactbench_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_compactbench_get_mode()
+ *	return the index of the bracketed current mode in a
+ *	transparent_hugepage sysfs file, 0 if unknown
+ */
+static size_t stress_compactbench_get_mode(const char *path)
+{
+	char buf[128], *start, *end;
+	size_t i;
+
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read(path, buf, sizeof(buf) - 1) < 0)
+		return 0;
+	start = strchr(buf, '[');
+	if (!start)
+		return 0;
+	start++;
+	end = strchr(start, ']');
+	if (!end)
+		return 0;
+	*end = '\0';
+	for (i = 1; i < COMPACTBENCH_MODES; i++) {
+		if (!strcmp(start, compactbench_modes[i]))
+			return i;
+	}
+	return 0;
+}
+
+/*
+ *  stress_compactbench_fragment()
+ *	fault in a region of 4K pages in order and then free every
+ *	other page so that the free memory is scattered in 4K holes
+ *	between pages that are still in use
+ */
+static void *stress_compactbench_fragment(const size_t sz, const size_t page_size)
+{
+	uint8_t *buf;
+	size_t i;
+
+	buf = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED)
+		return NULL;
+#if defined(MADV_NOHUGEPAGE)
+	VOID_RET(int, madvise((void *)buf, sz, MADV_NOHUGEPAGE));
+#endif
+	for (i = 0; i < sz; i += page_size)
+		buf[i] = (uint8_t)i;
+	for (i = page_size; i < sz; i += 2 * page_size)
+		VOID_RET(int, madvise((void *)(buf + i), page_size, MADV_DONTNEED));
+
+	return (void *)buf;
+}
+
+/*
+ *  stress_compactbench_thp()
+ *	time the first touch of huge page sized, huge page aligned
+ *	chunks of a MADV_HUGEPAGE region, returns -1 if it cannot
+ *	be mapped
+ */
+static int stress_compactbench_thp(
+	const stress_args_t *args,
+	stress_compactbench_stats_t *stats)
+{
+	const size_t sz = COMPACTBENCH_THP_PAGES * COMPACTBENCH_THP_SIZE;
+	const size_t map_sz = sz + COMPACTBENCH_THP_SIZE;
+	uint8_t *map, *buf;
+	size_t i;
+
+	map = (uint8_t *)mmap(NULL, map_sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	buf = (uint8_t *)(((uintptr_t)map + COMPACTBENCH_THP_SIZE - 1) &
+		~(uintptr_t)(COMPACTBENCH_THP_SIZE - 1));
+	VOID_RET(int, madvise((void *)buf, sz, MADV_HUGEPAGE));
+
+	for (i = 0; i < COMPACTBENCH_THP_PAGES; i++) {
+		volatile uint8_t *ptr = (volatile uint8_t *)(buf + (i * COMPACTBENCH_THP_SIZE));
+		uint64_t t1, t2;
+		size_t n;
+
+		t1 = stress_clock_ns();
+		*ptr = (uint8_t)i;
+		t2 = stress_clock_ns();
+
+		/* keep all samples until full, then replace at random */
+		if (stats->n_latencies < COMPACTBENCH_SAMPLES)
+			n = stats->n_latencies++;
+		else
+			n = (size_t)stress_mwc32() % COMPACTBENCH_SAMPLES;
+		stats->latencies[n] = t2 - t1;
+		stats->faults++;
+		inc_counter(args);
+	}
+	(void)munmap((void *)map, map_sz);
+
+	return 0;
+}
+
+/*
+ *  stress_compactbench()
+ *	fragment physical memory with interleaved 4K allocations and
+ *	measure the latency and success rate of THP allocation by
+ *	fault and the compaction it triggers under each defrag mode
+ */
+static int stress_compactbench(const stress_args_t *args)
+{
+	static stress_compactbench_stats_t stats[COMPACTBENCH_MODES];
+	const size_t page_size = args->page_size;
+	size_t compactbench_bytes = DEFAULT_COMPACTBENCH_BYTES;
+	size_t compactbench_mode = 0, modes[COMPACTBENCH_MODES], n_modes = 0;
+	size_t m, i, idx = 0;
+	char old_defrag[32];
+	bool restore_defrag = false;
+	int rc = EXIT_SUCCESS;
+
+	if (stress_compactbench_get_mode(compactbench_enabled_path) ==
+	    COMPACTBENCH_MODES - 1) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: transparent huge pages are disabled, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)stress_get_setting("compactbench-mode", &compactbench_mode);
+	if (!stress_get_setting("compactbench-bytes", &compactbench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			compactbench_bytes = 1 * GB;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			compactbench_bytes = MIN_COMPACTBENCH_BYTES;
+	}
+	compactbench_bytes /= args->num_instances;
+	if (compactbench_bytes < MIN_COMPACTBENCH_BYTES)
+		compactbench_bytes = MIN_COMPACTBENCH_BYTES;
+	compactbench_bytes &= ~(page_size - 1);
+
+	if (compactbench_mode) {
+		modes[n_modes++] = compactbench_mode;
+	} else {
+		modes[n_modes++] = 1;	/* always */
+		modes[n_modes++] = 2;	/* defer */
+		modes[n_modes++] = 4;	/* madvise */
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	for (m = 0; m < COMPACTBENCH_MODES; m++) {
+		stats[m].latencies = (uint64_t *)calloc(COMPACTBENCH_SAMPLES,
+			sizeof(*stats[m].latencies));
+		if (!stats[m].latencies) {
+			pr_inf_skip("%s: cannot allocate latency buffers, "
+				"skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto free_all;
+		}
+	}
+
+	/*
+	 *  defrag is system wide, the first instance sweeps and restores
+	 *  it, other instances attribute their faults to the current mode
+	 */
+	(void)memset(old_defrag, 0, sizeof(old_defrag));
+	if (args->instance == 0) {
+		const size_t old_mode = stress_compactbench_get_mode(compactbench_defrag_path);
+
+		if (old_mode) {
+			(void)shim_strlcpy(old_defrag, compactbench_modes[old_mode],
+				sizeof(old_defrag));
+			if (system_write(compactbench_defrag_path, old_defrag,
+					 strlen(old_defrag)) > 0) {
+				restore_defrag = true;
+			} else {
+				pr_inf("%s: cannot write %s, errno=%d (%s), "
+					"using the current defrag mode %s\n",
+					args->name, compactbench_defrag_path,
+					errno, strerror(errno), old_defrag);
+			}
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < n_modes) && keep_stressing(args); i++) {
+			uint64_t before[COMPACTBENCH_COUNTERS], after[COMPACTBENCH_COUNTERS];
+			void *frag;
+			size_t c;
+
+			if (restore_defrag) {
+				const char *mode = compactbench_modes[modes[i]];
+
+				VOID_RET(ssize_t, system_write(compactbench_defrag_path,
+					mode, strlen(mode)));
+			}
+			m = stress_compactbench_get_mode(compactbench_defrag_path);
+
+			frag = stress_compactbench_fragment(compactbench_bytes, page_size);
+			if (!frag)
+				continue;
+
+			(void)stress_get_vmstat_counters(compactbench_counters,
+				before, COMPACTBENCH_COUNTERS);
+			if (stress_compactbench_thp(args, &stats[m]) < 0) {
+				(void)munmap(frag, compactbench_bytes);
+				continue;
+			}
+			(void)stress_get_vmstat_counters(compactbench_counters,
+				after, COMPACTBENCH_COUNTERS);
+			for (c = 0; c < COMPACTBENCH_COUNTERS; c++)
+				stats[m].counters[c] += after[c] - before[c];
+
+			(void)munmap(frag, compactbench_bytes);
+
+			/* without control of defrag just use the current mode */
+			if (!restore_defrag)
+				break;
+		}
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_inf("%s: THP faults with %zuK of memory fragmented into 4K holes\n",
+			args->name, (size_t)(compactbench_bytes / KB));
+		pr_inf("%s: %-13s %8s %6s %9s %9s %9s %8s %8s %8s\n", args->name,
+			"defrag", "faults", "THP", "p50 us", "p99 us", "max us",
+			"stalls", "success", "fail");
+	}
+	for (m = 1; m < COMPACTBENCH_MODES; m++) {
+		stress_compactbench_stats_t *st = &stats[m];
+		const uint64_t thp = st->counters[THP_FAULT_ALLOC];
+		const uint64_t attempts = thp + st->counters[THP_FAULT_FALLBACK];
+		double thp_percent, p50, p99, max;
+		const size_t n = st->n_latencies;
+
+		if (!st->faults || !n)
+			continue;
+		qsort(st->latencies, n, sizeof(*st->latencies), stress_compactbench_cmp);
+		p50 = (double)st->latencies[n / 2] / 1000.0;
+		p99 = (double)st->latencies[(n * 99) / 100] / 1000.0;
+		max = (double)st->latencies[n - 1] / 1000.0;
+		thp_percent = attempts ? 100.0 * (double)thp / (double)attempts : 0.0;
+
+		if (args->instance == 0)
+			pr_inf("%s: %-13s %8" PRIu64 " %5.1f%% %9.2f %9.2f %9.2f "
+				"%8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n",
+				args->name, compactbench_modes[m], st->faults,
+				thp_percent, p50, p99, max,
+				st->counters[COMPACT_STALL],
+				st->counters[COMPACT_SUCCESS],
+				st->counters[COMPACT_FAIL]);
+		if (idx < STRESS_MISC_STATS_MAX - 1) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s THP fault p99 us",
+				compactbench_modes[m]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, p99);
+			(void)snprintf(desc, sizeof(desc), "%s THP success %%",
+				compactbench_modes[m]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, thp_percent);
+		}
+	}
+
+free_all:
+	if (restore_defrag)
+		VOID_RET(ssize_t, system_write(compactbench_defrag_path, old_defrag,
+			strlen(old_defrag)));
+	for (m = 0; m < COMPACTBENCH_MODES; m++)
+		free(stats[m].latencies);
+
+	return rc;
+}
+
+stressor_info_t stress_compactbench_info = {
+	.stressor = stress_compactbench,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_compactbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
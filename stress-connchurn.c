@@ -0,0 +1,566 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+#include "core-net.h"
+
+#if defined(HAVE_NETINET_TCP_H)
+#include <netinet/tcp.h>
+#endif
+
+#include <netinet/in.h>
+
+#define MIN_CONNCHURN_PORT	(1024)
+#define MAX_CONNCHURN_PORT	(65535)
+#define DEFAULT_CONNCHURN_PORT	(16000)
+
+#define MIN_CONNCHURN_THREADS	(1)
+#define MAX_CONNCHURN_THREADS	(64)
+#define DEFAULT_CONNCHURN_THREADS (4)
+
+#define CONNCHURN_MSG_SIZE	(64)	/* request and response size */
+#define CONNCHURN_BACKLOG	(4096)
+
+static const stress_help_t help[] = {
+	{ NULL,	"connchurn N",		"start N workers running short lived TCP connections" },
+	{ NULL,	"connchurn-domain D",	"specify socket domain, default is ipv4" },
+	{ NULL,	"connchurn-fastopen",	"send the request in the SYN with TCP_FASTOPEN" },
+	{ NULL,	"connchurn-linger",	"close with SO_LINGER 0, reset rather than TIME_WAIT" },
+	{ NULL,	"connchurn-ops N",	"stop after N connections" },
+	{ NULL,	"connchurn-port P",	"use ports P to P + number of workers - 1" },
+	{ NULL,	"connchurn-reuseaddr",	"bind client sockets with SO_REUSEADDR before connect" },
+	{ NULL,	"connchurn-threads N",	"use N client and N server threads per worker" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_connchurn_domain(const char *name)
+{
+	int ret, connchurn_domain;
+
+	ret = stress_set_net_domain(DOMAIN_INET_ALL, "connchurn-domain",
+				     name, &connchurn_domain);
+	stress_set_setting("connchurn-domain", TYPE_ID_INT, &connchurn_domain);
+
+	return ret;
+}
+
+static int stress_set_connchurn_port(const char *opt)
+{
+	int connchurn_port;
+
+	stress_set_net_port("connchurn-port", opt,
+		MIN_CONNCHURN_PORT, MAX_CONNCHURN_PORT - STRESS_PROCS_MAX,
+		&connchurn_port);
+	return stress_set_setting("connchurn-port", TYPE_ID_INT, &connchurn_port);
+}
+
+static int stress_set_connchurn_threads(const char *opt)
+{
+	uint32_t connchurn_threads;
+
+	connchurn_threads = stress_get_uint32(opt);
+	stress_check_range("connchurn-threads", (uint64_t)connchurn_threads,
+		MIN_CONNCHURN_THREADS, MAX_CONNCHURN_THREADS);
+	return stress_set_setting("connchurn-threads", TYPE_ID_UINT32, &connchurn_threads);
+}
+
+static int stress_set_connchurn_fastopen(const char *opt)
+{
+	return stress_set_setting_true("connchurn-fastopen", opt);
+}
+
+static int stress_set_connchurn_linger(const char *opt)
+{
+	return stress_set_setting_true("connchurn-linger", opt);
+}
+
+static int stress_set_connchurn_reuseaddr(const char *opt)
+{
+	return stress_set_setting_true("connchurn-reuseaddr", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_connchurn_domain,		stress_set_connchurn_domain },
+	{ OPT_connchurn_fastopen,	stress_set_connchurn_fastopen },
+	{ OPT_connchurn_linger,		stress_set_connchurn_linger },
+	{ OPT_connchurn_port,		stress_set_connchurn_port },
+	{ OPT_connchurn_reuseaddr,	stress_set_connchurn_reuseaddr },
+	{ OPT_connchurn_threads,	stress_set_connchurn_threads },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(IPPROTO_TCP)
+
+/* Connection options shared by the client and server threads */
+typedef struct {
+	struct sockaddr_storage addr;	/* server address */
+	socklen_t addr_len;		/* server address length */
+	int domain;			/* AF_INET or AF_INET6 */
+	int lfd;			/* listening socket */
+	bool fastopen;			/* request sent in the SYN */
+	bool linger;			/* SO_LINGER 0 on close */
+	bool reuseaddr;			/* SO_REUSEADDR bind before connect */
+} stress_connchurn_opts_t;
+
+/* Per client thread state */
+typedef struct {
+	const stress_connchurn_opts_t *opts;
+	stress_latency_t latency;	/* connect latencies */
+	uint64_t conns;			/* completed connections */
+	uint64_t addr_errs;		/* EADDRNOTAVAIL, out of local ports */
+	uint64_t conn_errs;		/* refused, reset or timed out */
+	uint64_t syn_data;		/* fast open data accepted in the SYN */
+	int err;			/* errno of an unexpected failure */
+	int ret;			/* pthread_create return */
+	pthread_t pthread;
+} stress_connchurn_thread_t;
+
+static volatile bool connchurn_stop;
+
+/*
+ *  stress_connchurn_linger()
+ *	make close send a reset and skip TIME_WAIT
+ */
+static void stress_connchurn_linger(const int fd)
+{
+#if defined(SO_LINGER)
+	struct linger l;
+
+	l.l_onoff = 1;
+	l.l_linger = 0;
+	(void)setsockopt(fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+#else
+	(void)fd;
+#endif
+}
+
+/*
+ *  stress_connchurn_server_thread()
+ *	accept a connection, read the request, write the
+ *	response and close, HTTP/1.0 style
+ */
+static void *stress_connchurn_server_thread(void *arg)
+{
+	const stress_connchurn_opts_t *opts = (const stress_connchurn_opts_t *)arg;
+	char buf[CONNCHURN_MSG_SIZE];
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	(void)memset(buf, 'R', sizeof(buf));
+
+	for (;;) {
+		const int sfd = accept(opts->lfd, NULL, NULL);
+
+		if (sfd < 0) {
+			if ((errno == EMFILE) || (errno == ENFILE) || (errno == ENOBUFS))
+				(void)shim_usleep(1000);
+			continue;
+		}
+		if (recv(sfd, buf, sizeof(buf), MSG_WAITALL) > 0)
+			(void)send(sfd, buf, sizeof(buf), MSG_NOSIGNAL);
+		if (opts->linger)
+			stress_connchurn_linger(sfd);
+		(void)close(sfd);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_connchurn_server()
+ *	run the server threads until killed by the parent
+ */
+static void NORETURN stress_connchurn_server(
+	const stress_connchurn_opts_t *opts,
+	const uint32_t threads)
+{
+	pthread_t pthreads[MAX_CONNCHURN_THREADS];
+	uint32_t i;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	/* this thread is the first server thread */
+	for (i = 1; i < threads; i++)
+		(void)pthread_create(&pthreads[i], NULL,
+			stress_connchurn_server_thread, (void *)opts);
+	(void)stress_connchurn_server_thread((void *)opts);
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_connchurn_connect()
+ *	connect, for fast open the request goes out with the SYN
+ */
+static int stress_connchurn_connect(
+	const stress_connchurn_opts_t *opts,
+	const int fd,
+	const char *buf)
+{
+#if defined(MSG_FASTOPEN)
+	if (opts->fastopen)
+		return (sendto(fd, buf, CONNCHURN_MSG_SIZE, MSG_FASTOPEN | MSG_NOSIGNAL,
+			(const struct sockaddr *)&opts->addr, opts->addr_len) < 0) ? -1 : 0;
+#endif
+	if (connect(fd, (const struct sockaddr *)&opts->addr, opts->addr_len) < 0)
+		return -1;
+	return (send(fd, buf, CONNCHURN_MSG_SIZE, MSG_NOSIGNAL) < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_connchurn_client_thread()
+ *	connect, send one request, read the response until
+ *	the server closes and close, as fast as possible
+ */
+static void *stress_connchurn_client_thread(void *arg)
+{
+	stress_connchurn_thread_t *thread = (stress_connchurn_thread_t *)arg;
+	const stress_connchurn_opts_t *opts = thread->opts;
+	struct sockaddr_storage local;
+	char buf[CONNCHURN_MSG_SIZE];
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	(void)memset(buf, 'Q', sizeof(buf));
+
+	/* bind before connect to the loopback address, any port */
+	(void)memcpy(&local, &opts->addr, sizeof(local));
+	if (opts->domain == AF_INET)
+		((struct sockaddr_in *)&local)->sin_port = 0;
+	else
+		((struct sockaddr_in6 *)&local)->sin6_port = 0;
+
+	while (!connchurn_stop && keep_stressing_flag()) {
+		uint64_t t;
+		ssize_t n;
+		int fd;
+
+		fd = socket(opts->domain, SOCK_STREAM, IPPROTO_TCP);
+		if (fd < 0) {
+			if ((errno == EMFILE) || (errno == ENFILE) || (errno == ENOBUFS)) {
+				(void)shim_usleep(1000);
+				continue;
+			}
+			thread->err = errno;
+			break;
+		}
+		if (opts->reuseaddr) {
+			int one = 1;
+
+			(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+			if (bind(fd, (struct sockaddr *)&local, opts->addr_len) < 0) {
+				if (errno == EADDRINUSE)
+					thread->addr_errs++;
+				(void)close(fd);
+				continue;
+			}
+		}
+
+		t = stress_latency_now();
+		if (stress_connchurn_connect(opts, fd, buf) < 0) {
+			const int err = errno;
+
+			(void)close(fd);
+			switch (err) {
+			case EADDRNOTAVAIL:
+			case EADDRINUSE:
+				thread->addr_errs++;
+				(void)shim_usleep(1000);
+				continue;
+			case ECONNREFUSED:
+			case ECONNRESET:
+			case ETIMEDOUT:
+			case EAGAIN:
+			case EINTR:
+			case EPIPE:
+			case ENOBUFS:
+				thread->conn_errs++;
+				continue;
+			default:
+				thread->err = err;
+				break;
+			}
+			break;
+		}
+		stress_latency_record(&thread->latency, stress_latency_now() - t);
+
+		/* the response, then wait for the server to close */
+		n = recv(fd, buf, sizeof(buf), MSG_WAITALL);
+		if (n != (ssize_t)sizeof(buf))
+			thread->conn_errs++;
+		else if (!opts->linger)
+			while (recv(fd, buf, sizeof(buf), 0) > 0)
+				;
+#if defined(TCP_INFO) &&	\
+    defined(TCPI_OPT_SYN_DATA)
+		if (opts->fastopen) {
+			struct tcp_info info;
+			socklen_t len = sizeof(info);
+
+			if ((getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) &&
+			    (info.tcpi_options & TCPI_OPT_SYN_DATA))
+				thread->syn_data++;
+		}
+#endif
+		if (opts->linger)
+			stress_connchurn_linger(fd);
+		(void)close(fd);
+		thread->conns++;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_connchurn_time_wait()
+ *	number of TCP sockets in TIME_WAIT, -1 if unknown
+ */
+static int64_t stress_connchurn_time_wait(void)
+{
+	char buf[4096];
+	const char *ptr;
+	int64_t tw;
+
+	if (system_read("/proc/net/sockstat", buf, sizeof(buf)) < 0)
+		return -1;
+	ptr = strstr(buf, "TCP:");
+	if (!ptr)
+		return -1;
+	ptr = strstr(ptr, " tw ");
+	if (!ptr || (sscanf(ptr, " tw %" SCNd64, &tw) != 1))
+		return -1;
+	return tw;
+}
+
+/*
+ *  stress_connchurn
+ *	stress TCP connection setup and teardown
+ */
+static int stress_connchurn(const stress_args_t *args)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	stress_connchurn_opts_t opts;
+	stress_connchurn_thread_t *threads;
+	stress_latency_t latency;
+	struct sockaddr *addr;
+	int connchurn_port = DEFAULT_CONNCHURN_PORT;
+	uint32_t connchurn_threads = DEFAULT_CONNCHURN_THREADS, i;
+	uint64_t conns = 0, addr_errs = 0, conn_errs = 0, syn_data = 0;
+	double t_start, duration;
+	int64_t tw;
+	int one = 1, status, rc = EXIT_SUCCESS;
+	pid_t pid;
+
+	(void)memset(&opts, 0, sizeof(opts));
+	opts.domain = AF_INET;
+	(void)stress_get_setting("connchurn-domain", &opts.domain);
+	(void)stress_get_setting("connchurn-fastopen", &opts.fastopen);
+	(void)stress_get_setting("connchurn-linger", &opts.linger);
+	(void)stress_get_setting("connchurn-port", &connchurn_port);
+	(void)stress_get_setting("connchurn-reuseaddr", &opts.reuseaddr);
+	(void)stress_get_setting("connchurn-threads", &connchurn_threads);
+
+#if !defined(MSG_FASTOPEN) ||	\
+    !defined(TCP_FASTOPEN)
+	if (opts.fastopen) {
+		if (args->instance == 0)
+			pr_inf("%s: TCP_FASTOPEN not supported, using connect\n",
+				args->name);
+		opts.fastopen = false;
+	}
+#endif
+	connchurn_port += args->instance;
+	pr_dbg("%s: process [%d] using port %d\n",
+		args->name, (int)args->pid, connchurn_port);
+
+	if (stress_set_sockaddr(args->name, args->instance, args->pid,
+			opts.domain, connchurn_port, &addr, &opts.addr_len,
+			NET_ADDR_LOOPBACK) < 0)
+		return EXIT_FAILURE;
+	(void)memcpy(&opts.addr, addr, opts.addr_len);
+
+	opts.lfd = socket(opts.domain, SOCK_STREAM, IPPROTO_TCP);
+	if (opts.lfd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return rc;
+	}
+	(void)setsockopt(opts.lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(opts.lfd, (struct sockaddr *)&opts.addr, opts.addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed on port %d, errno=%d (%s)\n",
+			args->name, connchurn_port, errno, strerror(errno));
+		goto close_lfd;
+	}
+#if defined(TCP_FASTOPEN)
+	if (opts.fastopen) {
+		int qlen = CONNCHURN_BACKLOG;
+
+		if (setsockopt(opts.lfd, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen)) < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: cannot enable TCP_FASTOPEN on the listener, "
+					"errno=%d (%s), using connect\n",
+					args->name, errno, strerror(errno));
+			opts.fastopen = false;
+		} else if (args->instance == 0) {
+			char buf[16];
+
+			/* bit 1 enables the server side */
+			if ((system_read("/proc/sys/net/ipv4/tcp_fastopen", buf, sizeof(buf)) > 0) &&
+			    !(atoi(buf) & 2))
+				pr_inf("%s: server side fast open disabled by "
+					"/proc/sys/net/ipv4/tcp_fastopen, SYN data will "
+					"not be accepted\n", args->name);
+		}
+	}
+#endif
+	if (listen(opts.lfd, CONNCHURN_BACKLOG) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_lfd;
+	}
+
+	threads = calloc(connchurn_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " thread states, "
+			"skipping stressor\n", args->name, connchurn_threads);
+		rc = EXIT_NO_RESOURCE;
+		goto close_lfd;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(errno))
+			goto again;
+		rc = EXIT_FAILURE;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_threads;
+	} else if (pid == 0) {
+		stress_connchurn_server(&opts, connchurn_threads);
+	}
+
+	connchurn_stop = false;
+	for (i = 0; i < connchurn_threads; i++) {
+		threads[i].opts = &opts;
+		stress_latency_reset(&threads[i].latency);
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+			stress_connchurn_client_thread, (void *)&threads[i]);
+	}
+
+	t_start = stress_time_now();
+	do {
+		uint64_t total = 0;
+
+		(void)shim_usleep(10000);
+		for (i = 0; i < connchurn_threads; i++)
+			total += threads[i].conns;
+		set_counter(args, total);
+	} while (keep_stressing(args));
+	connchurn_stop = true;
+
+	stress_latency_reset(&latency);
+	for (i = 0; i < connchurn_threads; i++) {
+		stress_connchurn_thread_t *thread = &threads[i];
+
+		if (thread->ret)
+			continue;
+		(void)pthread_join(thread->pthread, NULL);
+		stress_latency_merge(&latency, &thread->latency);
+		conns += thread->conns;
+		addr_errs += thread->addr_errs;
+		conn_errs += thread->conn_errs;
+		syn_data += thread->syn_data;
+		if (thread->err && (rc == EXIT_SUCCESS)) {
+			pr_fail("%s: connection failed, errno=%d (%s)\n",
+				args->name, thread->err, strerror(thread->err));
+			rc = EXIT_FAILURE;
+		}
+	}
+	duration = stress_time_now() - t_start;
+	set_counter(args, conns);
+	tw = stress_connchurn_time_wait();
+
+	(void)kill(pid, SIGKILL);
+	(void)shim_waitpid(pid, &status, 0);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((duration > 0.0) && latency.count) {
+		const double rate = (double)conns / duration;
+
+		if (args->instance == 0) {
+			pr_inf("%s: %.0f connections/s with %" PRIu32 " threads, connect latency "
+				"p50 %.2f p99 %.2f p99.9 %.2f max %.2f usec\n",
+				args->name, rate, connchurn_threads,
+				(double)stress_latency_percentile(&latency, 50.0) / 1000.0,
+				(double)stress_latency_percentile(&latency, 99.0) / 1000.0,
+				(double)stress_latency_percentile(&latency, 99.9) / 1000.0,
+				(double)latency.max / 1000.0);
+			pr_inf("%s: %" PRIu64 " local address (port) exhaustion errors, "
+				"%" PRIu64 " connection errors, %" PRId64 " sockets in TIME_WAIT\n",
+				args->name, addr_errs, conn_errs, tw);
+			if (opts.fastopen)
+				pr_inf("%s: %.1f%% of connections carried the request in the SYN\n",
+					args->name, conns ? 100.0 * (double)syn_data / (double)conns : 0.0);
+		}
+		stress_misc_stats_set(args->misc_stats, 0, "connections per sec", rate);
+		for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+			char desc[40];
+
+			(void)snprintf(desc, sizeof(desc), "connect p%g latency (usec)",
+				percentiles[i]);
+			stress_misc_stats_set(args->misc_stats, 1 + (int)i, desc,
+				(double)stress_latency_percentile(&latency, percentiles[i]) / 1000.0);
+		}
+		stress_misc_stats_set(args->misc_stats, 4, "connect max latency (usec)",
+			(double)latency.max / 1000.0);
+		stress_misc_stats_set(args->misc_stats, 5, "port exhaustion errors per sec",
+			(double)addr_errs / duration);
+		if (tw >= 0)
+			stress_misc_stats_set(args->misc_stats, 6, "sockets in TIME_WAIT",
+				(double)tw);
+	}
+
+free_threads:
+	free(threads);
+close_lfd:
+	(void)close(opts.lfd);
+
+	return rc;
+}
+
+stressor_info_t stress_connchurn_info = {
+	.stressor = stress_connchurn,
+	.class = CLASS_NETWORK | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_connchurn_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_NETWORK | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
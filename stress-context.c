@@ -26,9 +26,20 @@
 static stress_help_t help[] = {
 	{ NULL,	"context N",	 "start N workers exercising user context" },
 	{ NULL,	"context-ops N", "stop context workers after N bogo operations" },
+	{ NULL,	"context-sweep", "report ns per switch for swapcontext, asm and setjmp fibers" },
 	{ NULL,	NULL,		 NULL }
 };
 
+static int stress_set_context_sweep(const char *opt)
+{
+	return stress_set_setting_true("context-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_context_sweep,	stress_set_context_sweep },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_SWAPCONTEXT) &&	\
     defined(HAVE_UCONTEXT_H)
 
@@ -111,6 +122,441 @@ static int stress_context_init(
 	return 0;
 }
 
+#define CONTEXT_SWEEP_COUNTS	(7)		/* 2, 8, 32 .. 2048, 4096 fibers */
+#define CONTEXT_SWEEP_FIBERS	(4096)		/* maximum number of fibers */
+#define CONTEXT_SWEEP_SWITCHES	(1U << 18)	/* switches per measurement */
+
+#define CONTEXT_METHOD_UCONTEXT	(0)
+#define CONTEXT_METHOD_ASM	(1)
+#define CONTEXT_METHOD_SJLJ	(2)
+#define CONTEXT_METHODS		(3)
+
+#if defined(__ELF__) &&		\
+    (defined(__x86_64__) || defined(__aarch64__))
+#define HAVE_CONTEXT_ASM_SWITCH
+#endif
+
+/*
+ *  Plain __builtin_setjmp/__builtin_longjmp are used rather than the libc
+ *  calls as _FORTIFY_SOURCE turns longjmp into __longjmp_chk that aborts
+ *  when jumping to a frame that looks deeper on a different stack
+ */
+#if (defined(__x86_64__) || defined(__aarch64__)) &&	\
+    !defined(__PCC__) &&	\
+    !defined(__TINYC__)
+#define HAVE_CONTEXT_SJLJ_SWITCH
+#endif
+
+static const char * const stress_context_methods[CONTEXT_METHODS] = {
+	"swapcontext",
+	"asm",
+	"setjmp",
+};
+
+/* fiber state shared by all switch methods */
+typedef struct {
+	ucontext_t *uctx;	/* per fiber ucontext, also used to bootstrap setjmp fibers */
+	void **sp;		/* per fiber saved stack pointer for asm switching */
+	void *(*jb)[5];		/* per fiber __builtin_setjmp buffers */
+	uint8_t *stacks;	/* fiber stacks */
+	size_t stacks_size;	/* size of fiber stacks mapping */
+	ucontext_t uctx_main;	/* sweep main context */
+	void *sp_main;		/* sweep main saved stack pointer */
+	void *jb_main[5];	/* sweep main __builtin_setjmp buffer */
+	uint32_t fibers;	/* fibers in current measurement */
+	uint32_t current;	/* currently running fiber */
+	uint32_t switches;	/* switches so far in current measurement */
+} stress_context_sweep_t;
+
+static stress_context_sweep_t sweep;
+
+/*
+ *  stress_context_stack_top()
+ *	16 byte aligned top of a fiber's stack
+ */
+static inline uintptr_t stress_context_stack_top(const uint32_t fiber)
+{
+	return ((uintptr_t)sweep.stacks + ((size_t)fiber + 1) * CONTEXT_STACK_SIZE) & ~(uintptr_t)15;
+}
+
+/*
+ *  stress_context_uctx_fiber()
+ *	round robin swapcontext fiber, returns to the sweep main
+ *	context once all the measurement switches are done
+ */
+static void stress_context_uctx_fiber(void)
+{
+	for (;;) {
+		const uint32_t i = sweep.current;
+		const uint32_t next = (i + 1 >= sweep.fibers) ? 0 : i + 1;
+
+		if (++sweep.switches >= CONTEXT_SWEEP_SWITCHES) {
+			(void)swapcontext(&sweep.uctx[i], &sweep.uctx_main);
+		} else {
+			sweep.current = next;
+			(void)swapcontext(&sweep.uctx[i], &sweep.uctx[next]);
+		}
+	}
+}
+
+/*
+ *  stress_context_uctx_setup()
+ *	create a ucontext for each fiber running func on its own stack
+ */
+static int stress_context_uctx_setup(const uint32_t fibers, void (*func)(void))
+{
+	uint32_t i;
+
+	for (i = 0; i < fibers; i++) {
+		ucontext_t *uctx = &sweep.uctx[i];
+
+		if (getcontext(uctx) < 0)
+			return -1;
+		uctx->uc_stack.ss_sp = (void *)(sweep.stacks + (size_t)i * CONTEXT_STACK_SIZE);
+		uctx->uc_stack.ss_size = CONTEXT_STACK_SIZE;
+		uctx->uc_link = &sweep.uctx_main;
+		makecontext(uctx, func, 0);
+	}
+	return 0;
+}
+
+#if defined(HAVE_CONTEXT_ASM_SWITCH)
+/*
+ *  stress_context_asm_switch(from, to)
+ *	save the callee saved registers on the current stack, store the
+ *	stack pointer in *from, load the stack pointer to and restore
+ *	the callee saved registers from it
+ */
+extern void stress_context_asm_switch(void **from, void *to);
+
+#if defined(__x86_64__)
+__asm__(
+	"	.text\n"
+	"	.p2align 4\n"
+	"	.type stress_context_asm_switch, @function\n"
+	"stress_context_asm_switch:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	"	.size stress_context_asm_switch, .-stress_context_asm_switch\n"
+);
+#define CONTEXT_ASM_FRAME_WORDS	(6)	/* rbp, rbx, r12..r15 */
+#endif
+
+#if defined(__aarch64__)
+__asm__(
+	"	.text\n"
+	"	.p2align 4\n"
+	"	.type stress_context_asm_switch, %function\n"
+	"stress_context_asm_switch:\n"
+	"	sub sp, sp, #160\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mov x2, sp\n"
+	"	str x2, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	add sp, sp, #160\n"
+	"	ret\n"
+	"	.size stress_context_asm_switch, .-stress_context_asm_switch\n"
+);
+#define CONTEXT_ASM_FRAME_WORDS	(20)	/* x19..x30, d8..d15 */
+#endif
+
+/*
+ *  stress_context_asm_fiber()
+ *	round robin asm switched fiber, never returns
+ */
+static void NORETURN stress_context_asm_fiber(void)
+{
+	for (;;) {
+		const uint32_t i = sweep.current;
+		const uint32_t next = (i + 1 >= sweep.fibers) ? 0 : i + 1;
+
+		if (++sweep.switches >= CONTEXT_SWEEP_SWITCHES) {
+			stress_context_asm_switch(&sweep.sp[i], sweep.sp_main);
+		} else {
+			sweep.current = next;
+			stress_context_asm_switch(&sweep.sp[i], sweep.sp[next]);
+		}
+	}
+}
+
+/*
+ *  stress_context_asm_setup()
+ *	build an initial switch frame on each fiber's stack that
+ *	"returns" into stress_context_asm_fiber
+ */
+static void stress_context_asm_setup(const uint32_t fibers)
+{
+	uint32_t i;
+
+	for (i = 0; i < fibers; i++) {
+		uintptr_t *sp = (uintptr_t *)stress_context_stack_top(i);
+
+#if defined(__x86_64__)
+		/* fake caller return address keeps the ABI rsp alignment on entry */
+		*--sp = 0;
+		*--sp = (uintptr_t)stress_context_asm_fiber;
+		sp -= CONTEXT_ASM_FRAME_WORDS;
+		(void)memset(sp, 0, CONTEXT_ASM_FRAME_WORDS * sizeof(*sp));
+#endif
+#if defined(__aarch64__)
+		sp -= CONTEXT_ASM_FRAME_WORDS;
+		(void)memset(sp, 0, CONTEXT_ASM_FRAME_WORDS * sizeof(*sp));
+		sp[11] = (uintptr_t)stress_context_asm_fiber;	/* x30 */
+#endif
+		sweep.sp[i] = (void *)sp;
+	}
+}
+#endif
+
+#if defined(HAVE_CONTEXT_SJLJ_SWITCH)
+/*
+ *  stress_context_sjlj_jump()
+ *	__builtin_longjmp may not be used in the same function
+ *	as the __builtin_setjmp it returns to
+ */
+static void NOINLINE NORETURN stress_context_sjlj_jump(void **jb)
+{
+	__builtin_longjmp(jb, 1);
+}
+
+/*
+ *  stress_context_sjlj_fiber()
+ *	started once with swapcontext to record its resume point,
+ *	thereafter round robin switched with setjmp/longjmp
+ */
+static void stress_context_sjlj_fiber(void)
+{
+	if (__builtin_setjmp(sweep.jb[sweep.current]) == 0)
+		(void)swapcontext(&sweep.uctx[sweep.current], &sweep.uctx_main);
+
+	for (;;) {
+		const uint32_t i = sweep.current;
+		const uint32_t next = (i + 1 >= sweep.fibers) ? 0 : i + 1;
+
+		if (++sweep.switches >= CONTEXT_SWEEP_SWITCHES) {
+			if (__builtin_setjmp(sweep.jb[i]) == 0)
+				stress_context_sjlj_jump(sweep.jb_main);
+		} else {
+			sweep.current = next;
+			if (__builtin_setjmp(sweep.jb[i]) == 0)
+				stress_context_sjlj_jump(sweep.jb[next]);
+		}
+	}
+}
+
+/*
+ *  stress_context_sjlj_setup()
+ *	bootstrap each fiber on its own stack so it records its jmp buffer
+ */
+static int stress_context_sjlj_setup(const uint32_t fibers)
+{
+	uint32_t i;
+
+	if (stress_context_uctx_setup(fibers, stress_context_sjlj_fiber) < 0)
+		return -1;
+	for (i = 0; i < fibers; i++) {
+		sweep.current = i;
+		if (swapcontext(&sweep.uctx_main, &sweep.uctx[i]) < 0)
+			return -1;
+	}
+	return 0;
+}
+#endif
+
+/*
+ *  stress_context_sweep_method()
+ *	measure the ns per switch of a method round robin switching
+ *	between fibers, returns < 0.0 if the method is not available
+ */
+static double stress_context_sweep_method(const int method, const uint32_t fibers)
+{
+	volatile double t1;
+	double t2;
+
+	sweep.fibers = fibers;
+	sweep.current = 0;
+	sweep.switches = 0;
+
+	switch (method) {
+	case CONTEXT_METHOD_UCONTEXT:
+		if (stress_context_uctx_setup(fibers, stress_context_uctx_fiber) < 0)
+			return -1.0;
+		t1 = stress_time_now();
+		if (swapcontext(&sweep.uctx_main, &sweep.uctx[0]) < 0)
+			return -1.0;
+		t2 = stress_time_now();
+		break;
+#if defined(HAVE_CONTEXT_ASM_SWITCH)
+	case CONTEXT_METHOD_ASM:
+		stress_context_asm_setup(fibers);
+		t1 = stress_time_now();
+		stress_context_asm_switch(&sweep.sp_main, sweep.sp[0]);
+		t2 = stress_time_now();
+		break;
+#endif
+#if defined(HAVE_CONTEXT_SJLJ_SWITCH)
+	case CONTEXT_METHOD_SJLJ:
+		if (stress_context_sjlj_setup(fibers) < 0)
+			return -1.0;
+		sweep.current = 0;
+		t1 = stress_time_now();
+		if (__builtin_setjmp(sweep.jb_main) == 0)
+			stress_context_sjlj_jump(sweep.jb[0]);
+		t2 = stress_time_now();
+		break;
+#endif
+	default:
+		return -1.0;
+	}
+	return ((t2 - t1) * (double)STRESS_NANOSECOND) / (double)sweep.switches;
+}
+
+/*
+ *  stress_context_sweep()
+ *	compare the cost of swapcontext, a hand rolled asm stack switch
+ *	and setjmp/longjmp fiber switching over 2..4096 fibers, the
+ *	larger fiber counts spill the saved contexts and stacks out
+ *	of the caches
+ */
+static int stress_context_sweep(const stress_args_t *args)
+{
+	static const uint32_t counts[CONTEXT_SWEEP_COUNTS] = {
+		2, 8, 32, 128, 512, 2048, CONTEXT_SWEEP_FIBERS
+	};
+	double ns[CONTEXT_SWEEP_COUNTS][CONTEXT_METHODS];
+	double ns_sum[CONTEXT_SWEEP_COUNTS][CONTEXT_METHODS];
+	uint32_t passes = 0;
+	size_t i;
+	int method, idx = 0, rc = EXIT_SUCCESS;
+
+	(void)memset(&sweep, 0, sizeof(sweep));
+	(void)memset(ns_sum, 0, sizeof(ns_sum));
+
+	sweep.stacks_size = (size_t)CONTEXT_SWEEP_FIBERS * CONTEXT_STACK_SIZE;
+	sweep.stacks = (uint8_t *)mmap(NULL, sweep.stacks_size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (sweep.stacks == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes of fiber stacks, skipping stressor\n",
+			args->name, sweep.stacks_size);
+		return EXIT_NO_RESOURCE;
+	}
+	sweep.uctx = (ucontext_t *)calloc(CONTEXT_SWEEP_FIBERS, sizeof(*sweep.uctx));
+	sweep.sp = (void **)calloc(CONTEXT_SWEEP_FIBERS, sizeof(*sweep.sp));
+	sweep.jb = (void *(*)[5])calloc(CONTEXT_SWEEP_FIBERS, sizeof(*sweep.jb));
+	if (!sweep.uctx || !sweep.sp || !sweep.jb) {
+		pr_inf_skip("%s: cannot allocate fiber contexts, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < CONTEXT_SWEEP_COUNTS) && keep_stressing(args); i++) {
+			for (method = 0; method < CONTEXT_METHODS; method++) {
+				const double t = stress_context_sweep_method(method, counts[i]);
+
+				if ((t < 0.0) || (ns_sum[i][method] < 0.0))
+					ns_sum[i][method] = -1.0;
+				else
+					ns_sum[i][method] += t;
+			}
+		}
+		if (i < CONTEXT_SWEEP_COUNTS)
+			break;
+		passes++;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (passes == 0) {
+		pr_inf("%s: context switch sweep did not complete a pass\n", args->name);
+		goto tidy;
+	}
+
+	for (i = 0; i < CONTEXT_SWEEP_COUNTS; i++) {
+		for (method = 0; method < CONTEXT_METHODS; method++)
+			ns[i][method] = (ns_sum[i][method] < 0.0) ?
+				-1.0 : ns_sum[i][method] / (double)passes;
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: ns per fiber switch over %" PRIu32 " pass%s:\n",
+			args->name, passes, passes == 1 ? "" : "es");
+		pr_inf("%s: %7s %12s %12s %12s\n", args->name, "fibers",
+			stress_context_methods[0], stress_context_methods[1],
+			stress_context_methods[2]);
+		for (i = 0; i < CONTEXT_SWEEP_COUNTS; i++) {
+			char str[CONTEXT_METHODS][16];
+
+			for (method = 0; method < CONTEXT_METHODS; method++) {
+				if (ns[i][method] < 0.0)
+					(void)shim_strlcpy(str[method], "-", sizeof(str[method]));
+				else
+					(void)snprintf(str[method], sizeof(str[method]), "%.2f", ns[i][method]);
+			}
+			pr_inf("%s: %7" PRIu32 " %12s %12s %12s\n", args->name,
+				counts[i], str[0], str[1], str[2]);
+		}
+	}
+
+	for (method = 0; method < CONTEXT_METHODS; method++) {
+		char desc[64];
+
+		if (ns[0][method] < 0.0)
+			continue;
+		(void)snprintf(desc, sizeof(desc), "%s ns, %" PRIu32 " fibers",
+			stress_context_methods[method], counts[0]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, ns[0][method]);
+		(void)snprintf(desc, sizeof(desc), "%s ns, %" PRIu32 " fibers",
+			stress_context_methods[method], counts[CONTEXT_SWEEP_COUNTS - 1]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc,
+			ns[CONTEXT_SWEEP_COUNTS - 1][method]);
+	}
+
+tidy:
+	free(sweep.jb);
+	free(sweep.sp);
+	free(sweep.uctx);
+	(void)munmap((void *)sweep.stacks, sweep.stacks_size);
+
+	return rc;
+}
+
 /*
  *  stress_context()
  *	stress that exercises CPU context save/restore
@@ -118,6 +564,11 @@ static int stress_context_init(
 static int stress_context(const stress_args_t *args)
 {
 	size_t i;
+	bool context_sweep = false;
+
+	(void)stress_get_setting("context-sweep", &context_sweep);
+	if (context_sweep)
+		return stress_context_sweep(args);
 
 	(void)memset(&uctx_main, 0, sizeof(uctx_main));
 	(void)memset(context, 0, sizeof(context));
@@ -162,6 +613,7 @@ static int stress_context(const stress_args_t *args)
 stressor_info_t stress_context_info = {
 	.stressor = stress_context,
 	.class = CLASS_MEMORY | CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -169,6 +621,7 @@ stressor_info_t stress_context_info = {
 stressor_info_t stress_context_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_MEMORY | CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
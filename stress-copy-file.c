@@ -19,6 +19,14 @@
  */
 #include "stress-ng.h"
 
+#if defined(HAVE_LINUX_FS_H)
+#include <linux/fs.h>
+#endif
+
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
 #define MIN_COPY_FILE_BYTES	(128 * MB)
 #define MAX_COPY_FILE_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_COPY_FILE_BYTES	(256 * MB)
@@ -27,7 +35,9 @@
 static const stress_help_t help[] = {
 	{ NULL,	"copy-file N",		"start N workers that copy file data" },
 	{ NULL,	"copy-file-ops N",	"stop after N copy bogo operations" },
+	{ NULL,	"copy-file-bench",	"compare GB/s and CPU% of file copy methods" },
 	{ NULL,	"copy-file-bytes N",	"specify size of file to be copied" },
+	{ NULL,	"copy-file-dest D",	"also copy to directory D on another filesystem" },
 	{ NULL,	NULL,			NULL }
 
 };
@@ -42,8 +52,20 @@ static int stress_set_copy_file_bytes(const char *opt)
 	return stress_set_setting("copy-file-bytes", TYPE_ID_UINT64, &copy_file_bytes);
 }
 
+static int stress_set_copy_file_bench(const char *opt)
+{
+	return stress_set_setting_true("copy-file-bench", opt);
+}
+
+static int stress_set_copy_file_dest(const char *opt)
+{
+	return stress_set_setting("copy-file-dest", TYPE_ID_STR, opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_copy_file_bench,	stress_set_copy_file_bench },
 	{ OPT_copy_file_bytes,	stress_set_copy_file_bytes },
+	{ OPT_copy_file_dest,	stress_set_copy_file_dest },
 	{ 0,			NULL }
 };
 
@@ -100,6 +122,405 @@ static int stress_copy_file_range_verify(
 	return 0;
 }
 
+#define COPY_FILE_BENCH_TIME	(0.25)		/* seconds per measurement */
+#define COPY_FILE_BENCH_MIN	(4 * KB)	/* smallest file size */
+#define COPY_FILE_BENCH_CHUNK	(1 * MB)	/* read/write, sendfile and splice chunk */
+#define COPY_FILE_BENCH_SIZES	(16)
+
+typedef int (*stress_copy_file_method_t)(const int fd_in, const int fd_out,
+	const off_t size, uint8_t *buf);
+
+typedef struct {
+	const char *name;
+	const stress_copy_file_method_t copy;
+} stress_copy_file_bench_method_t;
+
+typedef struct {
+	double gbps;		/* GB/s, < 0 if the method failed */
+	double cpu;		/* CPU utilisation % of the copying process */
+} stress_copy_file_bench_res_t;
+
+/*
+ *  stress_copy_file_rw()
+ *	copy with a userspace bounce buffer
+ */
+static int stress_copy_file_rw(const int fd_in, const int fd_out, const off_t size, uint8_t *buf)
+{
+	off_t off;
+
+	for (off = 0; off < size; ) {
+		const size_t n = (size_t)STRESS_MINIMUM(size - off, (off_t)COPY_FILE_BENCH_CHUNK);
+		const ssize_t ret = pread(fd_in, buf, n, off);
+
+		if (ret <= 0)
+			return -1;
+		if (pwrite(fd_out, buf, (size_t)ret, off) != ret)
+			return -1;
+		off += ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_copy_file_cfr()
+ *	copy with copy_file_range, may be offloaded to the filesystem
+ *	or server (reflink, NFS server-side copy)
+ */
+static int stress_copy_file_cfr(const int fd_in, const int fd_out, const off_t size, uint8_t *buf)
+{
+	shim_loff_t off_in = 0, off_out = 0;
+
+	(void)buf;
+	while (off_in < (shim_loff_t)size) {
+		const ssize_t ret = shim_copy_file_range(fd_in, &off_in, fd_out,
+			&off_out, (size_t)(size - off_in), 0);
+
+		if (ret <= 0)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_copy_file_reflink()
+ *	share the extents of the whole file, no data is copied
+ */
+static int stress_copy_file_reflink(const int fd_in, const int fd_out, const off_t size, uint8_t *buf)
+{
+	(void)size;
+	(void)buf;
+#if defined(FICLONE)
+	return ioctl(fd_out, FICLONE, fd_in);
+#else
+	(void)fd_in;
+	(void)fd_out;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ *  stress_copy_file_sendfile()
+ *	copy in the kernel via sendfile
+ */
+static int stress_copy_file_sendfile(const int fd_in, const int fd_out, const off_t size, uint8_t *buf)
+{
+	(void)buf;
+#if defined(HAVE_SENDFILE) &&	\
+    defined(HAVE_SYS_SENDFILE_H)
+	off_t off = 0;
+
+	while (off < size) {
+		const size_t n = (size_t)STRESS_MINIMUM(size - off, (off_t)COPY_FILE_BENCH_CHUNK);
+
+		if (sendfile(fd_out, fd_in, &off, n) <= 0)
+			return -1;
+	}
+	return 0;
+#else
+	(void)fd_in;
+	(void)fd_out;
+	(void)size;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ *  stress_copy_file_splice()
+ *	copy in the kernel by splicing through a pipe
+ */
+static int stress_copy_file_splice(const int fd_in, const int fd_out, const off_t size, uint8_t *buf)
+{
+	(void)buf;
+#if defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MOVE)
+	shim_loff_t off_in = 0, off_out = 0;
+	int fds[2], rc = -1;
+
+	if (pipe(fds) < 0)
+		return -1;
+#if defined(F_SETPIPE_SZ)
+	(void)fcntl(fds[1], F_SETPIPE_SZ, COPY_FILE_BENCH_CHUNK);
+#endif
+	while (off_in < (shim_loff_t)size) {
+		const size_t n = (size_t)STRESS_MINIMUM(size - off_in, (off_t)COPY_FILE_BENCH_CHUNK);
+		ssize_t ret = splice(fd_in, &off_in, fds[1], NULL, n, SPLICE_F_MOVE);
+
+		if (ret <= 0)
+			goto err;
+		while (ret > 0) {
+			const ssize_t out = splice(fds[0], NULL, fd_out, &off_out,
+				(size_t)ret, SPLICE_F_MOVE);
+
+			if (out <= 0)
+				goto err;
+			ret -= out;
+		}
+	}
+	rc = 0;
+err:
+	(void)close(fds[0]);
+	(void)close(fds[1]);
+	return rc;
+#else
+	(void)fd_in;
+	(void)fd_out;
+	(void)size;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static const stress_copy_file_bench_method_t copy_file_bench_methods[] = {
+	{ "read/write",	stress_copy_file_rw },
+	{ "copy_file_range", stress_copy_file_cfr },
+	{ "reflink",	stress_copy_file_reflink },
+	{ "sendfile",	stress_copy_file_sendfile },
+	{ "splice",	stress_copy_file_splice },
+};
+
+#define COPY_FILE_BENCH_METHODS	SIZEOF_ARRAY(copy_file_bench_methods)
+
+/*
+ *  stress_copy_file_cpu_time()
+ *	user + system time of this process in seconds
+ */
+static double stress_copy_file_cpu_time(void)
+{
+#if defined(HAVE_GETRUSAGE)
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1000000.0 +
+	       (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1000000.0;
+#else
+	return 0.0;
+#endif
+}
+
+/*
+ *  stress_copy_file_bench_rate()
+ *	repeatedly copy size bytes from fd_in to a truncated fd_out
+ *	including the fsync that makes the copy durable
+ */
+static void stress_copy_file_bench_rate(
+	const stress_args_t *args,
+	const stress_copy_file_bench_method_t *method,
+	const int fd_in,
+	const int fd_out,
+	const off_t size,
+	uint8_t *buf,
+	stress_copy_file_bench_res_t *res)
+{
+	const double t = stress_time_now();
+	const double cpu = stress_copy_file_cpu_time();
+	uint64_t n = 0;
+	double dt;
+
+	res->gbps = -1.0;
+	res->cpu = 0.0;
+	do {
+		if (ftruncate(fd_out, 0) < 0)
+			return;
+		if (method->copy(fd_in, fd_out, size, buf) < 0)
+			return;
+		if (shim_fsync(fd_out) < 0)
+			return;
+		n++;
+		dt = stress_time_now() - t;
+	} while (keep_stressing(args) && (dt < COPY_FILE_BENCH_TIME));
+
+	if (dt > 0.0) {
+		res->gbps = (double)n * (double)size / dt / 1.0E9;
+		res->cpu = 100.0 * (stress_copy_file_cpu_time() - cpu) / dt;
+	}
+}
+
+/*
+ *  stress_copy_file_bench_fill()
+ *	fill the source with random data, sparse files would let
+ *	some methods skip the holes
+ */
+static int stress_copy_file_bench_fill(const int fd, const off_t size, uint8_t *buf)
+{
+	off_t off;
+	size_t i;
+
+	for (i = 0; i < COPY_FILE_BENCH_CHUNK; i += sizeof(uint32_t))
+		*(uint32_t *)(buf + i) = stress_mwc32();
+	for (off = 0; off < size; ) {
+		const size_t n = (size_t)STRESS_MINIMUM(size - off, (off_t)COPY_FILE_BENCH_CHUNK);
+
+		if (pwrite(fd, buf, n, off) != (ssize_t)n)
+			return -1;
+		off += (off_t)n;
+	}
+	return shim_fsync(fd);
+}
+
+/*
+ *  stress_copy_file_bench()
+ *	compare the throughput and CPU cost of file copy methods over
+ *	file sizes from 4 KB to --copy-file-bytes, within the temp path
+ *	filesystem and to the optional --copy-file-dest directory
+ */
+static int stress_copy_file_bench(const stress_args_t *args, const uint64_t copy_file_bytes)
+{
+	static stress_copy_file_bench_res_t pass[2][COPY_FILE_BENCH_SIZES][COPY_FILE_BENCH_METHODS];
+	static stress_copy_file_bench_res_t res[2][COPY_FILE_BENCH_SIZES][COPY_FILE_BENCH_METHODS];
+	off_t sizes[COPY_FILE_BENCH_SIZES];
+	const char *copy_file_dest = NULL;
+	char filename[PATH_MAX - 5], tmp[PATH_MAX], dest[PATH_MAX], fs_src[64];
+	size_t n_sizes = 0, n_dests = 1, d, s, m;
+	int fd_in, fd_out[2] = { -1, -1 }, rc = EXIT_SUCCESS;
+	uint8_t *buf;
+	off_t size;
+	bool done = false;
+
+	for (size = COPY_FILE_BENCH_MIN; (size < (off_t)copy_file_bytes) &&
+	     (n_sizes < COPY_FILE_BENCH_SIZES - 1); size *= 16)
+		sizes[n_sizes++] = size;
+	sizes[n_sizes++] = (off_t)copy_file_bytes;
+
+	buf = (uint8_t *)mmap(NULL, COPY_FILE_BENCH_CHUNK, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %d byte buffer, skipping stressor\n",
+			args->name, (int)COPY_FILE_BENCH_CHUNK);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)stress_temp_filename_args(args,
+			filename, sizeof(filename), stress_mwc32());
+	(void)snprintf(tmp, sizeof(tmp), "%s-orig", filename);
+	(void)shim_strlcpy(fs_src, stress_fs_type(tmp), sizeof(fs_src));
+	if ((fd_in = open(tmp, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR)) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, tmp, errno, strerror(errno));
+		goto tidy_buf;
+	}
+	(void)shim_unlink(tmp);
+	if (stress_copy_file_bench_fill(fd_in, (off_t)copy_file_bytes, buf) < 0) {
+		pr_inf_skip("%s: cannot create a %" PRIu64 " byte source file, errno=%d (%s)%s, "
+			"skipping stressor\n", args->name, copy_file_bytes,
+			errno, strerror(errno), fs_src);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_in;
+	}
+
+	(void)snprintf(tmp, sizeof(tmp), "%s-copy", filename);
+	if ((fd_out[0] = open(tmp, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR)) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, tmp, errno, strerror(errno));
+		goto tidy_in;
+	}
+	(void)shim_unlink(tmp);
+
+	if (stress_get_setting("copy-file-dest", &copy_file_dest)) {
+		(void)snprintf(dest, sizeof(dest), "%s/stress-copy-file-%" PRIdMAX "-%" PRIu32,
+			copy_file_dest, (intmax_t)args->pid, args->instance);
+		if ((fd_out[1] = open(dest, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR)) < 0) {
+			pr_inf("%s: cannot open %s, errno=%d (%s), skipping cross "
+				"filesystem copies\n", args->name, dest, errno, strerror(errno));
+		} else {
+			(void)shim_unlink(dest);
+			n_dests = 2;
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (d = 0; d < n_dests; d++) {
+			for (s = 0; s < n_sizes; s++) {
+				for (m = 0; m < COPY_FILE_BENCH_METHODS; m++) {
+					if (!keep_stressing(args))
+						goto finish;
+					stress_copy_file_bench_rate(args, &copy_file_bench_methods[m],
+						fd_in, fd_out[d], sizes[s], buf, &pass[d][s][m]);
+				}
+			}
+			VOID_RET(int, ftruncate(fd_out[d], 0));
+		}
+		(void)memcpy(res, pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: file copy GB/s and CPU%% per method, source in %s%s\n",
+			args->name, filename, fs_src);
+		for (d = 0; d < n_dests; d++) {
+			char str[128];
+
+			if (d == 0)
+				pr_inf("%s: same filesystem\n", args->name);
+			else
+				pr_inf("%s: to %s%s\n", args->name, copy_file_dest,
+					stress_fs_type(copy_file_dest));
+			(void)snprintf(str, sizeof(str), "%10s", "size");
+			for (m = 0; m < COPY_FILE_BENCH_METHODS; m++) {
+				const size_t len = strlen(str);
+
+				(void)snprintf(str + len, sizeof(str) - len, " %15.15s",
+					copy_file_bench_methods[m].name);
+			}
+			pr_inf("%s: %s\n", args->name, str);
+			for (s = 0; s < n_sizes; s++) {
+				char size_str[32];
+
+				(void)snprintf(str, sizeof(str), "%10s",
+					stress_uint64_to_str(size_str, sizeof(size_str),
+						(uint64_t)sizes[s]));
+				for (m = 0; m < COPY_FILE_BENCH_METHODS; m++) {
+					const stress_copy_file_bench_res_t *r = &res[d][s][m];
+					const size_t len = strlen(str);
+
+					if (r->gbps < 0.0)
+						(void)snprintf(str + len, sizeof(str) - len, " %15s", "-");
+					else
+						(void)snprintf(str + len, sizeof(str) - len,
+							" %8.3f %5.1f%%", r->gbps, r->cpu);
+				}
+				pr_inf("%s: %s\n", args->name, str);
+			}
+		}
+	}
+	if (done) {
+		/* largest file on the same filesystem */
+		for (m = 0; m < COPY_FILE_BENCH_METHODS; m++) {
+			const stress_copy_file_bench_res_t *r = &res[0][n_sizes - 1][m];
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s GB/sec", copy_file_bench_methods[m].name);
+			stress_misc_stats_set(args->misc_stats, (int)(m * 2), str,
+				r->gbps > 0.0 ? r->gbps : 0.0);
+			(void)snprintf(str, sizeof(str), "%s CPU%%", copy_file_bench_methods[m].name);
+			stress_misc_stats_set(args->misc_stats, (int)(m * 2 + 1), str,
+				r->gbps > 0.0 ? r->cpu : 0.0);
+		}
+	}
+
+	if (fd_out[1] >= 0)
+		(void)close(fd_out[1]);
+	(void)close(fd_out[0]);
+tidy_in:
+	(void)close(fd_in);
+tidy_buf:
+	(void)munmap((void *)buf, COPY_FILE_BENCH_CHUNK);
+
+	return rc;
+}
+
 /*
  *  stress_copy_file
  *	stress reading chunks of file using copy_file_range()
@@ -110,6 +531,7 @@ static int stress_copy_file(const stress_args_t *args)
 	const int fd_bad = stress_get_bad_fd();
 	char filename[PATH_MAX - 5], tmp[PATH_MAX];
 	uint64_t copy_file_bytes = DEFAULT_COPY_FILE_BYTES;
+	bool copy_file_bench = false;
 
 	if (!stress_get_setting("copy-file-bytes", &copy_file_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -128,6 +550,12 @@ static int stress_copy_file(const stress_args_t *args)
         if (ret < 0)
                 return stress_exit_status(-ret);
 
+	(void)stress_get_setting("copy-file-bench", &copy_file_bench);
+	if (copy_file_bench) {
+		rc = stress_copy_file_bench(args, copy_file_bytes);
+		goto tidy_dir;
+	}
+
 	(void)stress_temp_filename_args(args,
 			filename, sizeof(filename), stress_mwc32());
 	(void)snprintf(tmp, sizeof(tmp), "%s-orig", filename);
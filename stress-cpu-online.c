@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-hotplug.h"
+#include "core-latency.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"cpu-online N",		"start N workers offlining/onlining the CPUs" },
@@ -53,6 +55,48 @@ static int stress_cpu_online_set(
 			args->name, errno, strerror(errno));
 		return EXIT_FAILURE;
 	}
+	return (ret < 0) ? EXIT_NO_RESOURCE : EXIT_SUCCESS;
+}
+
+/*
+ *  stress_cpu_online_timed()
+ *	set a CPU online or offline and record how long the
+ *	transition took and how long the other stressors stalled
+ */
+static int stress_cpu_online_timed(
+	const stress_args_t *args,
+	const uint32_t cpu,
+	const int setting,
+	stress_hotplug_lat_t **lats,
+	stress_hotplug_stall_t *st)
+{
+	stress_hotplug_lat_t *lat = lats[cpu];
+	uint64_t t, stall;
+	int rc;
+
+	if (!lat) {
+		lat = calloc(1, sizeof(*lat));
+		if (lat) {
+			(void)snprintf(lat->name, sizeof(lat->name), "cpu%" PRIu32, cpu);
+			lats[cpu] = lat;
+		}
+	}
+
+	stress_hotplug_stall_begin(st);
+	t = stress_latency_now();
+	rc = stress_cpu_online_set(args, cpu, setting);
+	t = stress_latency_now() - t;
+	stall = stress_hotplug_stall_end(st);
+
+	/* only time the transitions that happened */
+	if (rc != EXIT_SUCCESS)
+		return (rc == EXIT_NO_RESOURCE) ? EXIT_SUCCESS : rc;
+	stress_latency_record(args->latency, t);
+	if (lat) {
+		stress_latency_record(setting ? &lat->online : &lat->offline, t);
+		if (st)
+			stress_latency_record(&lat->stall, stall);
+	}
 	return EXIT_SUCCESS;
 }
 
@@ -89,6 +133,8 @@ static int stress_cpu_online(const stress_args_t *args)
 	int32_t cpus = stress_get_processors_configured();
 	int32_t i, cpu_online_count = 0;
 	bool *cpu_online;
+	stress_hotplug_lat_t **lats;
+	stress_hotplug_stall_t *st;
 	int rc = EXIT_SUCCESS;
 
 	if (geteuid() != 0) {
@@ -116,6 +162,12 @@ static int stress_cpu_online(const stress_args_t *args)
 		pr_err("%s: out of memory\n", args->name);
 		return EXIT_NO_RESOURCE;
 	}
+	lats = calloc((size_t)cpus, sizeof(*lats));
+	if (!lats) {
+		pr_err("%s: out of memory\n", args->name);
+		free(cpu_online);
+		return EXIT_NO_RESOURCE;
+	}
 
 	/*
 	 *  Determine how many CPUs we can online/offline via
@@ -135,6 +187,7 @@ static int stress_cpu_online(const stress_args_t *args)
 	}
 	if (cpu_online_count == 0) {
 		pr_inf("%s: no CPUs can be set online/offline\n", args->name);
+		free(lats);
 		free(cpu_online);
 		return EXIT_FAILURE;
 	}
@@ -154,6 +207,7 @@ static int stress_cpu_online(const stress_args_t *args)
 			args->name, cpu_online_count + 1);
 	}
 
+	st = stress_hotplug_stall_create(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	/*
@@ -169,10 +223,10 @@ static int stress_cpu_online(const stress_args_t *args)
 		if ((cpu == 0) && !(g_opt_flags & OPT_FLAGS_CPU_ONLINE_ALL))
 			continue;
 		if (cpu_online[cpu]) {
-			rc = stress_cpu_online_set(args, cpu, 0);
+			rc = stress_cpu_online_timed(args, cpu, 0, lats, st);
 			if (rc != EXIT_SUCCESS)
 				break;
-			rc = stress_cpu_online_set(args, cpu, 1);
+			rc = stress_cpu_online_timed(args, cpu, 1, lats, st);
 			if (rc != EXIT_SUCCESS)
 				break;
 			inc_counter(args);
@@ -188,6 +242,12 @@ static int stress_cpu_online(const stress_args_t *args)
 		if (cpu_online[i])
 			(void)stress_cpu_online_set(args, (uint32_t)i, 1);
 	}
+	stress_hotplug_stall_destroy(st);
+
+	stress_hotplug_report(args, lats, (size_t)cpus);
+	for (i = 0; i < cpus; i++)
+		free(lats[i]);
+	free(lats);
 	free(cpu_online);
 
 	return rc;
@@ -21,6 +21,7 @@
 #include "core-arch.h"
 #include "core-builtin.h"
 #include "core-cpu.h"
+#include "core-method-stats.h"
 #include "core-put.h"
 #include "core-target-clones.h"
 
@@ -2975,6 +2976,7 @@ static const stress_cpu_method_info_t cpu_methods[] = {
 };
 
 static double stress_cpu_counter_scale[SIZEOF_ARRAY(cpu_methods)];
+static bool stress_cpu_method_stats;
 
 static void stress_cpu_method(size_t method, const stress_args_t *args, double *counter)
 {
@@ -2986,7 +2988,14 @@ static void stress_cpu_method(size_t method, const stress_args_t *args, double *
 		if (!cpu_methods[i].func)
 			i = 1;
 	}
-	cpu_methods[method].func(args->name);
+	if (stress_cpu_method_stats) {
+		const double t = stress_time_now();
+
+		cpu_methods[method].func(args->name);
+		stress_method_stats_add(args, method, stress_time_now() - t);
+	} else {
+		cpu_methods[method].func(args->name);
+	}
 	*counter += stress_cpu_counter_scale[method];
 	set_counter(args, (uint64_t)*counter);
 }
@@ -3072,6 +3081,14 @@ static int HOT OPTIMIZE3 stress_cpu(const stress_args_t *args)
 			stress_cpu_counter_scale[i] = 1484.50 / cpu_methods[i].bogo_op_rate;
 	}
 
+	/* per method breakdown for --metrics, normalized to the reference rates */
+	stress_cpu_method_stats = !!(g_opt_flags & OPT_FLAGS_METRICS);
+	if (stress_cpu_method_stats) {
+		for (i = 1; cpu_methods[i].func; i++)
+			stress_method_stats_init(args, i, cpu_methods[i].name,
+				cpu_methods[i].bogo_op_rate);
+	}
+
 	pr_dbg("%s: using method '%s'\n", args->name, cpu_methods[cpu_method].name);
 
 	/*
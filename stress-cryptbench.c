@@ -0,0 +1,1533 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-arch.h"
+#include "core-cpu.h"
+#include "core-hash.h"
+#include "core-target-clones.h"
+
+#if defined(HAVE_LINUX_IF_ALG_H)
+#include <linux/if_alg.h>
+#endif
+
+#if defined(HAVE_LINUX_SOCKET_H)
+#include <linux/socket.h>
+#endif
+
+#define MIN_CRYPTBENCH_SIZE	(64)
+#define MAX_CRYPTBENCH_SIZE	(64 * KB)
+#define DEFAULT_CRYPTBENCH_SIZE	(64 * KB)
+
+#define CRYPTBENCH_BATCH	(256 * KB)	/* bytes per method, size and path per pass */
+#define CRYPTBENCH_MAX_SIZES	(6)		/* 64, 256, 1K, 4K, 16K, 64K */
+#define CRYPTBENCH_KEY_LEN	(32)
+#define CRYPTBENCH_IV_LEN	(12)
+#define CRYPTBENCH_TAG_LEN	(16)
+
+#define CRYPTBENCH_PATH_USER	(0)
+#define CRYPTBENCH_PATH_AF_ALG	(1)
+
+static const stress_help_t help[] = {
+	{ NULL,	"cryptbench N",		"start N workers measuring crypto throughput in process and via AF_ALG" },
+	{ NULL,	"cryptbench-method M",	"select aes-gcm, chacha20-poly1305, sha256, crc32c or all, default is all" },
+	{ NULL,	"cryptbench-ops N",	"stop after N crypto benchmark passes" },
+	{ NULL,	"cryptbench-size N",	"largest buffer size, sizes are 64 bytes to N in steps of 4x, default is 64K" },
+	{ NULL,	NULL,			NULL }
+};
+
+#define CRYPTBENCH_AES_GCM	(0)
+#define CRYPTBENCH_CHACHA20	(1)
+#define CRYPTBENCH_SHA256	(2)
+#define CRYPTBENCH_CRC32C	(3)
+
+static const char * const cryptbench_methods[] = {
+	"aes-gcm",
+	"chacha20-poly1305",
+	"sha256",
+	"crc32c",
+};
+
+static int stress_set_cryptbench_method(const char *opt)
+{
+	size_t i;
+
+	/* 0 is all, methods are index + 1 */
+	if (!strcmp(opt, "all")) {
+		i = 0;
+		return stress_set_setting("cryptbench-method", TYPE_ID_SIZE_T, &i);
+	}
+	for (i = 0; i < SIZEOF_ARRAY(cryptbench_methods); i++) {
+		if (!strcmp(opt, cryptbench_methods[i])) {
+			const size_t idx = i + 1;
+
+			return stress_set_setting("cryptbench-method", TYPE_ID_SIZE_T, &idx);
+		}
+	}
+
+	(void)fprintf(stderr, "cryptbench-method must be one of: all");
+	for (i = 0; i < SIZEOF_ARRAY(cryptbench_methods); i++)
+		(void)fprintf(stderr, " %s", cryptbench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_cryptbench_size(const char *opt)
+{
+	uint64_t cryptbench_size;
+
+	cryptbench_size = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("cryptbench-size", cryptbench_size,
+		MIN_CRYPTBENCH_SIZE, MAX_CRYPTBENCH_SIZE);
+	return stress_set_setting("cryptbench-size", TYPE_ID_UINT64, &cryptbench_size);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_cryptbench_method,	stress_set_cryptbench_method },
+	{ OPT_cryptbench_size,		stress_set_cryptbench_size },
+	{ 0,				NULL }
+};
+
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_BUILTIN_IA32_AESENC)
+#define HAVE_CRYPTBENCH_AES_NI
+#endif
+
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_BUILTIN_IA32_SHA256RNDS2)
+#define HAVE_CRYPTBENCH_SHA_NI
+#endif
+
+#if defined(HAVE_CRYPTBENCH_AES_NI) ||		\
+    defined(HAVE_CRYPTBENCH_SHA_NI)
+typedef long long int stress_v2di_t __attribute__((vector_size(16)));
+typedef int stress_v4si_t __attribute__((vector_size(16)));
+typedef unsigned int stress_v4su_t __attribute__((vector_size(16)));
+typedef char stress_v16qi_t __attribute__((vector_size(16)));
+#endif
+
+typedef struct {
+	uint8_t key[CRYPTBENCH_KEY_LEN];	/* cipher key, aes-gcm uses the first 16 bytes */
+	uint8_t iv[CRYPTBENCH_IV_LEN];		/* nonce, fixed for the run */
+#if defined(HAVE_CRYPTBENCH_AES_NI)
+	stress_v2di_t aes_rk[11];		/* aes-128 round keys */
+	stress_v2di_t ghash_h;			/* byte reflected ghash key */
+#endif
+	bool sha_ni;				/* use sha-ni for sha256 */
+	bool chacha_vec;			/* use 8 way vector chacha20 */
+} stress_cryptbench_ctx_t;
+
+typedef struct {
+	double bytes;		/* bytes processed */
+	double duration;	/* time taken */
+} stress_cryptbench_stats_t;
+
+static inline uint32_t stress_cryptbench_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+	       ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void stress_cryptbench_put_le32(uint8_t *p, const uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t stress_cryptbench_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	       ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void stress_cryptbench_put_be32(uint8_t *p, const uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 24);
+	p[1] = (uint8_t)(v >> 16);
+	p[2] = (uint8_t)(v >> 8);
+	p[3] = (uint8_t)v;
+}
+
+static inline void stress_cryptbench_put_be64(uint8_t *p, const uint64_t v)
+{
+	stress_cryptbench_put_be32(p, (uint32_t)(v >> 32));
+	stress_cryptbench_put_be32(p + 4, (uint32_t)v);
+}
+
+#define ROTL32(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+#define ROTR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+/*
+ *  SHA-256, FIPS 180-4
+ */
+static const uint32_t sha256_k[64] ALIGN64 = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static void stress_sha256_blocks_generic(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+	while (blocks--) {
+		uint32_t w[64], a, b, c, d, e, f, g, h;
+		register int i;
+
+		for (i = 0; i < 16; i++)
+			w[i] = stress_cryptbench_be32(data + (i * 4));
+		for (i = 16; i < 64; i++) {
+			const uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			const uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		for (i = 0; i < 64; i++) {
+			const uint32_t s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+			const uint32_t ch = (e & f) ^ (~e & g);
+			const uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+			const uint32_t s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+			const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+			const uint32_t t2 = s0 + maj;
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+
+		data += 64;
+	}
+}
+
+#if defined(HAVE_CRYPTBENCH_SHA_NI)
+/*
+ *  stress_sha256_blocks_sha_ni()
+ *	SHA-256 using the x86 sha extensions, the state is held in
+ *	ABEF and CDGH order as sha256rnds2 expects, 4 rounds per
+ *	message vector with the message schedule computed by
+ *	sha256msg1 and sha256msg2
+ */
+static void __attribute__((target("sha,sse4.1"))) stress_sha256_blocks_sha_ni(
+	uint32_t state[8],
+	const uint8_t *data,
+	size_t blocks)
+{
+	const stress_v16qi_t bswap = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+	stress_v4si_t state0, state1, tmp;
+
+	(void)memcpy(&tmp, &state[0], sizeof(tmp));
+	(void)memcpy(&state1, &state[4], sizeof(state1));
+	tmp = __builtin_shuffle(tmp, (stress_v4si_t){ 1, 0, 3, 2 });		/* CDAB */
+	state1 = __builtin_shuffle(state1, (stress_v4si_t){ 3, 2, 1, 0 });	/* EFGH */
+	state0 = __builtin_shuffle(state1, tmp, (stress_v4si_t){ 2, 3, 4, 5 });	/* ABEF */
+	state1 = __builtin_shuffle(state1, tmp, (stress_v4si_t){ 0, 1, 6, 7 });	/* CDGH */
+
+	while (blocks--) {
+		const stress_v4si_t abef = state0, cdgh = state1;
+		stress_v4si_t msg[4];
+		register int i;
+
+		for (i = 0; i < 16; i++) {
+			stress_v4si_t m, k;
+
+			if (i < 4) {
+				stress_v16qi_t b;
+
+				(void)memcpy(&b, data + (i * 16), sizeof(b));
+				msg[i] = (stress_v4si_t)__builtin_shuffle(b, bswap);
+			} else {
+				const stress_v4si_t m1 = msg[(i + 3) & 3];	/* words i*4-4 .. i*4-1 */
+				const stress_v4si_t m2 = msg[(i + 2) & 3];	/* words i*4-8 .. i*4-5 */
+
+				m = __builtin_ia32_sha256msg1(msg[i & 3], msg[(i + 1) & 3]);
+				m += __builtin_shuffle(m2, m1, (stress_v4si_t){ 1, 2, 3, 4 });
+				msg[i & 3] = __builtin_ia32_sha256msg2(m, m1);
+			}
+			(void)memcpy(&k, &sha256_k[i * 4], sizeof(k));
+			m = msg[i & 3] + k;
+			state1 = __builtin_ia32_sha256rnds2(state1, state0, m);
+			m = __builtin_shuffle(m, (stress_v4si_t){ 2, 3, 0, 0 });
+			state0 = __builtin_ia32_sha256rnds2(state0, state1, m);
+		}
+		state0 += abef;
+		state1 += cdgh;
+		data += 64;
+	}
+
+	tmp = __builtin_shuffle(state0, (stress_v4si_t){ 3, 2, 1, 0 });		/* FEBA */
+	state1 = __builtin_shuffle(state1, (stress_v4si_t){ 1, 0, 3, 2 });	/* DCHG */
+	state0 = __builtin_shuffle(tmp, state1, (stress_v4si_t){ 0, 1, 6, 7 });	/* DCBA */
+	state1 = __builtin_shuffle(tmp, state1, (stress_v4si_t){ 2, 3, 4, 5 });	/* HGFE */
+	(void)memcpy(&state[0], &state0, sizeof(state0));
+	(void)memcpy(&state[4], &state1, sizeof(state1));
+}
+#endif
+
+/*
+ *  stress_sha256()
+ *	SHA-256 digest of len bytes of data
+ */
+static void stress_sha256(
+	const bool sha_ni,
+	const uint8_t *data,
+	const size_t len,
+	uint8_t digest[32])
+{
+	uint32_t state[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+	void (*blocks)(uint32_t state[8], const uint8_t *data, size_t blocks) =
+		stress_sha256_blocks_generic;
+	uint8_t tail[128];
+	const size_t full = len / 64, rem = len & 63;
+	size_t n, i;
+
+#if defined(HAVE_CRYPTBENCH_SHA_NI)
+	if (sha_ni)
+		blocks = stress_sha256_blocks_sha_ni;
+#else
+	(void)sha_ni;
+#endif
+	blocks(state, data, full);
+
+	/* pad with 0x80, zeros and the bit length to 1 or 2 blocks */
+	(void)memset(tail, 0, sizeof(tail));
+	(void)memcpy(tail, data + (full * 64), rem);
+	tail[rem] = 0x80;
+	n = (rem < 56) ? 64 : 128;
+	stress_cryptbench_put_be64(tail + n - 8, (uint64_t)len * 8);
+	blocks(state, tail, n / 64);
+
+	for (i = 0; i < 8; i++)
+		stress_cryptbench_put_be32(digest + (i * 4), state[i]);
+}
+
+/*
+ *  ChaCha20 and Poly1305, RFC 8439
+ */
+#define CHACHA_QR(a, b, c, d)			\
+do {						\
+	a += b; d ^= a; d = ROTL32(d, 16);	\
+	c += d; b ^= c; b = ROTL32(b, 12);	\
+	a += b; d ^= a; d = ROTL32(d, 8);	\
+	c += d; b ^= c; b = ROTL32(b, 7);	\
+} while (0)
+
+#define CHACHA_DOUBLE_ROUND(x)				\
+do {							\
+	CHACHA_QR(x[0], x[4], x[8],  x[12]);		\
+	CHACHA_QR(x[1], x[5], x[9],  x[13]);		\
+	CHACHA_QR(x[2], x[6], x[10], x[14]);		\
+	CHACHA_QR(x[3], x[7], x[11], x[15]);		\
+	CHACHA_QR(x[0], x[5], x[10], x[15]);		\
+	CHACHA_QR(x[1], x[6], x[11], x[12]);		\
+	CHACHA_QR(x[2], x[7], x[8],  x[13]);		\
+	CHACHA_QR(x[3], x[4], x[9],  x[14]);		\
+} while (0)
+
+static void stress_chacha20_init(
+	uint32_t state[16],
+	const uint8_t key[32],
+	const uint8_t iv[12])
+{
+	register int i;
+
+	state[0] = 0x61707865;	/* "expand 32-byte k" */
+	state[1] = 0x3320646e;
+	state[2] = 0x79622d32;
+	state[3] = 0x6b206574;
+	for (i = 0; i < 8; i++)
+		state[4 + i] = stress_cryptbench_le32(key + (i * 4));
+	state[12] = 0;
+	for (i = 0; i < 3; i++)
+		state[13 + i] = stress_cryptbench_le32(iv + (i * 4));
+}
+
+/*
+ *  stress_chacha20_block()
+ *	generate 64 bytes of key stream for block counter
+ */
+static void stress_chacha20_block(
+	const uint32_t state[16],
+	const uint32_t counter,
+	uint8_t ks[64])
+{
+	uint32_t x[16], s[16];
+	register int i;
+
+	(void)memcpy(s, state, sizeof(s));
+	s[12] = counter;
+	(void)memcpy(x, s, sizeof(x));
+	for (i = 0; i < 10; i++)
+		CHACHA_DOUBLE_ROUND(x);
+	for (i = 0; i < 16; i++)
+		stress_cryptbench_put_le32(ks + (i * 4), x[i] + s[i]);
+}
+
+#if defined(HAVE_VECMATH)
+typedef uint32_t stress_chacha_v8_t __attribute__((vector_size(32)));
+
+/*
+ *  stress_chacha20_blocks8()
+ *	generate 512 bytes of key stream, 8 blocks in parallel with
+ *	one block per vector lane
+ */
+static void TARGET_CLONES stress_chacha20_blocks8(
+	const uint32_t state[16],
+	const uint32_t counter,
+	uint8_t ks[512])
+{
+	const stress_chacha_v8_t lane = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	stress_chacha_v8_t x[16], s[16];
+	register int i, b;
+
+	for (i = 0; i < 16; i++)
+		s[i] = (stress_chacha_v8_t){ 0 } + state[i];
+	s[12] = counter + lane;
+	(void)memcpy(x, s, sizeof(x));
+	for (i = 0; i < 10; i++)
+		CHACHA_DOUBLE_ROUND(x);
+	for (i = 0; i < 16; i++)
+		x[i] += s[i];
+	for (b = 0; b < 8; b++) {
+		for (i = 0; i < 16; i++)
+			stress_cryptbench_put_le32(ks + (b * 64) + (i * 4), x[i][b]);
+	}
+}
+#endif
+
+/*
+ *  stress_chacha20_xor()
+ *	encrypt len bytes of in to out from block counter onwards
+ */
+static void stress_chacha20_xor(
+	const uint32_t state[16],
+	uint32_t counter,
+	const bool vec,
+	const uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+	uint8_t ks[512] ALIGN64;
+	size_t i = 0, j;
+
+#if defined(HAVE_VECMATH)
+	if (vec) {
+		for (; len - i >= sizeof(ks); i += sizeof(ks), counter += 8) {
+			stress_chacha20_blocks8(state, counter, ks);
+			for (j = 0; j < sizeof(ks); j++)
+				out[i + j] = in[i + j] ^ ks[j];
+		}
+	}
+#else
+	(void)vec;
+#endif
+	for (; i < len; i += 64, counter++) {
+		const size_t n = STRESS_MINIMUM(len - i, 64);
+
+		stress_chacha20_block(state, counter, ks);
+		for (j = 0; j < n; j++)
+			out[i + j] = in[i + j] ^ ks[j];
+	}
+}
+
+typedef struct {
+	uint32_t r[5];		/* clamped key r, 26 bit limbs */
+	uint32_t s[4];		/* r[1..4] * 5 */
+	uint32_t h[5];		/* accumulator, 26 bit limbs */
+	uint32_t pad[4];	/* key s */
+} stress_poly1305_t;
+
+static void stress_poly1305_init(stress_poly1305_t *p, const uint8_t key[32])
+{
+	register int i;
+
+	p->r[0] = (stress_cryptbench_le32(key + 0)) & 0x3ffffff;
+	p->r[1] = (stress_cryptbench_le32(key + 3) >> 2) & 0x3ffff03;
+	p->r[2] = (stress_cryptbench_le32(key + 6) >> 4) & 0x3ffc0ff;
+	p->r[3] = (stress_cryptbench_le32(key + 9) >> 6) & 0x3f03fff;
+	p->r[4] = (stress_cryptbench_le32(key + 12) >> 8) & 0x00fffff;
+	for (i = 0; i < 4; i++) {
+		p->s[i] = p->r[i + 1] * 5;
+		p->pad[i] = stress_cryptbench_le32(key + 16 + (i * 4));
+	}
+	(void)memset(p->h, 0, sizeof(p->h));
+}
+
+/*
+ *  stress_poly1305_blocks()
+ *	accumulate full 16 byte blocks, the AEAD construction
+ *	pads everything to 16 bytes so there are no partial blocks
+ */
+static void stress_poly1305_blocks(stress_poly1305_t *p, const uint8_t *m, size_t blocks)
+{
+	const uint32_t r0 = p->r[0], r1 = p->r[1], r2 = p->r[2], r3 = p->r[3], r4 = p->r[4];
+	const uint32_t s1 = p->s[0], s2 = p->s[1], s3 = p->s[2], s4 = p->s[3];
+	uint32_t h0 = p->h[0], h1 = p->h[1], h2 = p->h[2], h3 = p->h[3], h4 = p->h[4];
+
+	while (blocks--) {
+		uint64_t d0, d1, d2, d3, d4;
+		uint32_t c;
+
+		h0 += (stress_cryptbench_le32(m + 0)) & 0x3ffffff;
+		h1 += (stress_cryptbench_le32(m + 3) >> 2) & 0x3ffffff;
+		h2 += (stress_cryptbench_le32(m + 6) >> 4) & 0x3ffffff;
+		h3 += (stress_cryptbench_le32(m + 9) >> 6) & 0x3ffffff;
+		h4 += (stress_cryptbench_le32(m + 12) >> 8) | (1U << 24);
+
+		d0 = ((uint64_t)h0 * r0) + ((uint64_t)h1 * s4) + ((uint64_t)h2 * s3) +
+		     ((uint64_t)h3 * s2) + ((uint64_t)h4 * s1);
+		d1 = ((uint64_t)h0 * r1) + ((uint64_t)h1 * r0) + ((uint64_t)h2 * s4) +
+		     ((uint64_t)h3 * s3) + ((uint64_t)h4 * s2);
+		d2 = ((uint64_t)h0 * r2) + ((uint64_t)h1 * r1) + ((uint64_t)h2 * r0) +
+		     ((uint64_t)h3 * s4) + ((uint64_t)h4 * s3);
+		d3 = ((uint64_t)h0 * r3) + ((uint64_t)h1 * r2) + ((uint64_t)h2 * r1) +
+		     ((uint64_t)h3 * r0) + ((uint64_t)h4 * s4);
+		d4 = ((uint64_t)h0 * r4) + ((uint64_t)h1 * r3) + ((uint64_t)h2 * r2) +
+		     ((uint64_t)h3 * r1) + ((uint64_t)h4 * r0);
+
+		c = (uint32_t)(d0 >> 26);
+		h0 = (uint32_t)d0 & 0x3ffffff;
+		d1 += c;
+		c = (uint32_t)(d1 >> 26);
+		h1 = (uint32_t)d1 & 0x3ffffff;
+		d2 += c;
+		c = (uint32_t)(d2 >> 26);
+		h2 = (uint32_t)d2 & 0x3ffffff;
+		d3 += c;
+		c = (uint32_t)(d3 >> 26);
+		h3 = (uint32_t)d3 & 0x3ffffff;
+		d4 += c;
+		c = (uint32_t)(d4 >> 26);
+		h4 = (uint32_t)d4 & 0x3ffffff;
+		h0 += c * 5;
+		c = h0 >> 26;
+		h0 &= 0x3ffffff;
+		h1 += c;
+
+		m += 16;
+	}
+	p->h[0] = h0;
+	p->h[1] = h1;
+	p->h[2] = h2;
+	p->h[3] = h3;
+	p->h[4] = h4;
+}
+
+static void stress_poly1305_finish(stress_poly1305_t *p, uint8_t tag[16])
+{
+	uint32_t h0 = p->h[0], h1 = p->h[1], h2 = p->h[2], h3 = p->h[3], h4 = p->h[4];
+	uint32_t g0, g1, g2, g3, g4, c, mask;
+	uint64_t f;
+
+	/* fully carry h */
+	c = h1 >> 26;
+	h1 &= 0x3ffffff;
+	h2 += c;
+	c = h2 >> 26;
+	h2 &= 0x3ffffff;
+	h3 += c;
+	c = h3 >> 26;
+	h3 &= 0x3ffffff;
+	h4 += c;
+	c = h4 >> 26;
+	h4 &= 0x3ffffff;
+	h0 += c * 5;
+	c = h0 >> 26;
+	h0 &= 0x3ffffff;
+	h1 += c;
+
+	/* g = h + 5 - 2^130, use it if h >= p */
+	g0 = h0 + 5;
+	c = g0 >> 26;
+	g0 &= 0x3ffffff;
+	g1 = h1 + c;
+	c = g1 >> 26;
+	g1 &= 0x3ffffff;
+	g2 = h2 + c;
+	c = g2 >> 26;
+	g2 &= 0x3ffffff;
+	g3 = h3 + c;
+	c = g3 >> 26;
+	g3 &= 0x3ffffff;
+	g4 = h4 + c - (1U << 26);
+
+	mask = (g4 >> 31) - 1;
+	h0 = (h0 & ~mask) | (g0 & mask);
+	h1 = (h1 & ~mask) | (g1 & mask);
+	h2 = (h2 & ~mask) | (g2 & mask);
+	h3 = (h3 & ~mask) | (g3 & mask);
+	h4 = (h4 & ~mask) | (g4 & mask);
+
+	/* h = (h + pad) mod 2^128 */
+	h0 = h0 | (h1 << 26);
+	h1 = (h1 >> 6) | (h2 << 20);
+	h2 = (h2 >> 12) | (h3 << 14);
+	h3 = (h3 >> 18) | (h4 << 8);
+
+	f = (uint64_t)h0 + p->pad[0];
+	stress_cryptbench_put_le32(tag + 0, (uint32_t)f);
+	f = (uint64_t)h1 + p->pad[1] + (f >> 32);
+	stress_cryptbench_put_le32(tag + 4, (uint32_t)f);
+	f = (uint64_t)h2 + p->pad[2] + (f >> 32);
+	stress_cryptbench_put_le32(tag + 8, (uint32_t)f);
+	f = (uint64_t)h3 + p->pad[3] + (f >> 32);
+	stress_cryptbench_put_le32(tag + 12, (uint32_t)f);
+}
+
+/*
+ *  stress_poly1305_padded()
+ *	accumulate len bytes zero padded to a multiple of 16 bytes
+ */
+static void stress_poly1305_padded(stress_poly1305_t *p, const uint8_t *m, const size_t len)
+{
+	const size_t rem = len & 15;
+
+	stress_poly1305_blocks(p, m, len / 16);
+	if (rem) {
+		uint8_t block[16];
+
+		(void)memset(block, 0, sizeof(block));
+		(void)memcpy(block, m + len - rem, rem);
+		stress_poly1305_blocks(p, block, 1);
+	}
+}
+
+/*
+ *  stress_chacha20_poly1305()
+ *	AEAD_CHACHA20_POLY1305 encryption, out is the ciphertext
+ *	followed by the 16 byte tag
+ */
+static void stress_chacha20_poly1305(
+	const uint8_t key[32],
+	const uint8_t iv[12],
+	const bool vec,
+	const uint8_t *aad,
+	const size_t aad_len,
+	const uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+	uint32_t state[16];
+	uint8_t block[64];
+	stress_poly1305_t poly;
+
+	stress_chacha20_init(state, key, iv);
+	stress_chacha20_block(state, 0, block);
+	stress_poly1305_init(&poly, block);
+	stress_chacha20_xor(state, 1, vec, in, len, out);
+
+	stress_poly1305_padded(&poly, aad, aad_len);
+	stress_poly1305_padded(&poly, out, len);
+	stress_cryptbench_put_le32(block + 0, (uint32_t)aad_len);
+	stress_cryptbench_put_le32(block + 4, (uint32_t)((uint64_t)aad_len >> 32));
+	stress_cryptbench_put_le32(block + 8, (uint32_t)len);
+	stress_cryptbench_put_le32(block + 12, (uint32_t)((uint64_t)len >> 32));
+	stress_poly1305_blocks(&poly, block, 1);
+	stress_poly1305_finish(&poly, out + len);
+}
+
+#if defined(HAVE_CRYPTBENCH_AES_NI)
+/*
+ *  AES-128-GCM, NIST SP 800-38D, using aes-ni for the block cipher
+ *  and carry-less multiply for GHASH on byte reflected values
+ */
+#define AES_NI_TARGET	__attribute__((target("aes,pclmul,sse4.1")))
+
+static const stress_v16qi_t aes_bswap = {
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+static inline stress_v2di_t AES_NI_TARGET stress_aes128_expand(
+	const stress_v2di_t key,
+	const stress_v2di_t assist)
+{
+	const stress_v4si_t zero = { 0, 0, 0, 0 };
+	const stress_v4si_t shl4 = { 4, 0, 1, 2 };
+	stress_v4si_t k = (stress_v4si_t)key;
+
+	k ^= __builtin_shuffle(k, zero, shl4);
+	k ^= __builtin_shuffle(k, zero, shl4);
+	k ^= __builtin_shuffle(k, zero, shl4);
+	return (stress_v2di_t)(k ^ __builtin_shuffle((stress_v4si_t)assist, (stress_v4si_t){ 3, 3, 3, 3 }));
+}
+
+#define AES128_EXPAND(rk, i, rcon)	\
+	rk[i] = stress_aes128_expand(rk[i - 1], __builtin_ia32_aeskeygenassist128(rk[i - 1], rcon))
+
+static void AES_NI_TARGET stress_aes128_key_expand(stress_v2di_t rk[11], const uint8_t key[16])
+{
+	(void)memcpy(&rk[0], key, sizeof(rk[0]));
+	AES128_EXPAND(rk, 1, 0x01);
+	AES128_EXPAND(rk, 2, 0x02);
+	AES128_EXPAND(rk, 3, 0x04);
+	AES128_EXPAND(rk, 4, 0x08);
+	AES128_EXPAND(rk, 5, 0x10);
+	AES128_EXPAND(rk, 6, 0x20);
+	AES128_EXPAND(rk, 7, 0x40);
+	AES128_EXPAND(rk, 8, 0x80);
+	AES128_EXPAND(rk, 9, 0x1b);
+	AES128_EXPAND(rk, 10, 0x36);
+}
+
+static inline stress_v2di_t AES_NI_TARGET stress_aes128_encrypt(
+	const stress_v2di_t rk[11],
+	stress_v2di_t x)
+{
+	register int i;
+
+	x ^= rk[0];
+	for (i = 1; i < 10; i++)
+		x = __builtin_ia32_aesenc128(x, rk[i]);
+	return __builtin_ia32_aesenclast128(x, rk[10]);
+}
+
+static inline stress_v2di_t AES_NI_TARGET stress_ghash_bswap(const stress_v2di_t x)
+{
+	return (stress_v2di_t)__builtin_shuffle((stress_v16qi_t)x, aes_bswap);
+}
+
+/*
+ *  stress_ghash_mul()
+ *	multiply a by b in GF(2^128) on byte reflected values, the
+ *	256 bit carry-less product is shifted left by 1 and reduced
+ *	modulo x^128 + x^7 + x^2 + x + 1
+ */
+static inline stress_v2di_t AES_NI_TARGET stress_ghash_mul(
+	const stress_v2di_t a,
+	const stress_v2di_t b)
+{
+	const stress_v4su_t zero = { 0, 0, 0, 0 };
+	stress_v4su_t lo, hi, mid, t1, t2, t3;
+
+	lo = (stress_v4su_t)__builtin_ia32_pclmulqdq128(a, b, 0x00);
+	hi = (stress_v4su_t)__builtin_ia32_pclmulqdq128(a, b, 0x11);
+	mid = (stress_v4su_t)__builtin_ia32_pclmulqdq128(a, b, 0x10) ^
+	      (stress_v4su_t)__builtin_ia32_pclmulqdq128(a, b, 0x01);
+	lo ^= __builtin_shuffle(mid, zero, (stress_v4su_t){ 4, 4, 0, 1 });
+	hi ^= __builtin_shuffle(mid, zero, (stress_v4su_t){ 2, 3, 4, 4 });
+
+	/* shift the 256 bit hi:lo left by 1 */
+	t1 = lo >> 31;
+	t2 = hi >> 31;
+	lo <<= 1;
+	hi <<= 1;
+	t3 = __builtin_shuffle(t1, zero, (stress_v4su_t){ 3, 4, 4, 4 });
+	t2 = __builtin_shuffle(t2, zero, (stress_v4su_t){ 4, 0, 1, 2 });
+	t1 = __builtin_shuffle(t1, zero, (stress_v4su_t){ 4, 0, 1, 2 });
+	lo |= t1;
+	hi |= t2 | t3;
+
+	/* reduce */
+	t1 = (lo << 31) ^ (lo << 30) ^ (lo << 25);
+	t2 = __builtin_shuffle(t1, zero, (stress_v4su_t){ 1, 2, 3, 4 });
+	t1 = __builtin_shuffle(t1, zero, (stress_v4su_t){ 4, 4, 4, 0 });
+	lo ^= t1;
+	t3 = (lo >> 1) ^ (lo >> 2) ^ (lo >> 7) ^ t2;
+	lo ^= t3;
+
+	return (stress_v2di_t)(hi ^ lo);
+}
+
+static void AES_NI_TARGET stress_aes_gcm_init(stress_cryptbench_ctx_t *ctx)
+{
+	const stress_v2di_t zero = { 0, 0 };
+
+	stress_aes128_key_expand(ctx->aes_rk, ctx->key);
+	ctx->ghash_h = stress_ghash_bswap(stress_aes128_encrypt(ctx->aes_rk, zero));
+}
+
+/*
+ *  stress_ghash_padded()
+ *	fold len bytes zero padded to a multiple of 16 bytes into x
+ */
+static inline stress_v2di_t AES_NI_TARGET stress_ghash_padded(
+	stress_v2di_t x,
+	const stress_v2di_t h,
+	const uint8_t *data,
+	const size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i += 16) {
+		stress_v2di_t b = { 0, 0 };
+
+		(void)memcpy(&b, data + i, STRESS_MINIMUM(len - i, 16));
+		x = stress_ghash_mul(x ^ stress_ghash_bswap(b), h);
+	}
+	return x;
+}
+
+/*
+ *  stress_aes_gcm()
+ *	AES-128-GCM encryption with a 96 bit IV, out is the ciphertext
+ *	followed by the 16 byte tag. The counter mode blocks are
+ *	encrypted 4 at a time to overlap the aesenc latencies
+ */
+static void AES_NI_TARGET stress_aes_gcm(
+	const stress_cryptbench_ctx_t *ctx,
+	const uint8_t *aad,
+	const size_t aad_len,
+	const uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+	const stress_v2di_t *rk = ctx->aes_rk;
+	const stress_v2di_t h = ctx->ghash_h;
+	stress_v4su_t j0 = { 0, 0, 0, 0 };
+	stress_v2di_t x = { 0, 0 }, lens;
+	uint8_t len_block[16];
+	uint32_t ctr = 2;
+	size_t i = 0;
+
+	(void)memcpy(&j0, ctx->iv, CRYPTBENCH_IV_LEN);
+	x = stress_ghash_padded(x, h, aad, aad_len);
+
+	for (; len - i >= 64; i += 64, ctr += 4) {
+		stress_v4su_t c0 = j0, c1 = j0, c2 = j0, c3 = j0;
+		stress_v2di_t x0, x1, x2, x3, p[4];
+		register int r;
+
+		c0[3] = __builtin_bswap32(ctr);
+		c1[3] = __builtin_bswap32(ctr + 1);
+		c2[3] = __builtin_bswap32(ctr + 2);
+		c3[3] = __builtin_bswap32(ctr + 3);
+		x0 = (stress_v2di_t)c0 ^ rk[0];
+		x1 = (stress_v2di_t)c1 ^ rk[0];
+		x2 = (stress_v2di_t)c2 ^ rk[0];
+		x3 = (stress_v2di_t)c3 ^ rk[0];
+		for (r = 1; r < 10; r++) {
+			x0 = __builtin_ia32_aesenc128(x0, rk[r]);
+			x1 = __builtin_ia32_aesenc128(x1, rk[r]);
+			x2 = __builtin_ia32_aesenc128(x2, rk[r]);
+			x3 = __builtin_ia32_aesenc128(x3, rk[r]);
+		}
+		(void)memcpy(p, in + i, sizeof(p));
+		p[0] ^= __builtin_ia32_aesenclast128(x0, rk[10]);
+		p[1] ^= __builtin_ia32_aesenclast128(x1, rk[10]);
+		p[2] ^= __builtin_ia32_aesenclast128(x2, rk[10]);
+		p[3] ^= __builtin_ia32_aesenclast128(x3, rk[10]);
+		(void)memcpy(out + i, p, sizeof(p));
+		x = stress_ghash_mul(x ^ stress_ghash_bswap(p[0]), h);
+		x = stress_ghash_mul(x ^ stress_ghash_bswap(p[1]), h);
+		x = stress_ghash_mul(x ^ stress_ghash_bswap(p[2]), h);
+		x = stress_ghash_mul(x ^ stress_ghash_bswap(p[3]), h);
+	}
+	for (; i < len; i += 16, ctr++) {
+		const size_t n = STRESS_MINIMUM(len - i, 16);
+		stress_v4su_t c = j0;
+		stress_v2di_t p = { 0, 0 };
+		uint8_t block[16];
+
+		c[3] = __builtin_bswap32(ctr);
+		(void)memcpy(&p, in + i, n);
+		p ^= stress_aes128_encrypt(rk, (stress_v2di_t)c);
+		(void)memcpy(block, &p, sizeof(block));
+		(void)memcpy(out + i, block, n);
+	}
+	x = stress_ghash_padded(x, h, out + (len & ~(size_t)63), len & 63);
+
+	stress_cryptbench_put_be64(len_block, (uint64_t)aad_len * 8);
+	stress_cryptbench_put_be64(len_block + 8, (uint64_t)len * 8);
+	(void)memcpy(&lens, len_block, sizeof(lens));
+	x = stress_ghash_mul(x ^ stress_ghash_bswap(lens), h);
+
+	j0[3] = __builtin_bswap32(1);
+	x = stress_ghash_bswap(x) ^ stress_aes128_encrypt(rk, (stress_v2di_t)j0);
+	(void)memcpy(out + len, &x, CRYPTBENCH_TAG_LEN);
+}
+#endif
+
+/*
+ *  In process implementations, in is len bytes, out is the
+ *  ciphertext and tag or the digest
+ */
+static void stress_cryptbench_user_aes_gcm(
+	const stress_cryptbench_ctx_t *ctx,
+	const uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+#if defined(HAVE_CRYPTBENCH_AES_NI)
+	stress_aes_gcm(ctx, NULL, 0, in, len, out);
+#else
+	(void)ctx;
+	(void)in;
+	(void)len;
+	(void)out;
+#endif
+}
+
+static void stress_cryptbench_user_chacha20(
+	const stress_cryptbench_ctx_t *ctx,
+	const uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+	stress_chacha20_poly1305(ctx->key, ctx->iv, ctx->chacha_vec, NULL, 0, in, len, out);
+}
+
+static void stress_cryptbench_user_sha256(
+	const stress_cryptbench_ctx_t *ctx,
+	const uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+	stress_sha256(ctx->sha_ni, in, len, out);
+}
+
+static void stress_cryptbench_user_crc32c(
+	const stress_cryptbench_ctx_t *ctx,
+	const uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+	(void)ctx;
+
+	/* the kernel crc32c digest is little endian */
+	stress_cryptbench_put_le32(out, stress_hash_crc32c_hw((const char *)in, len));
+}
+
+typedef struct {
+	const char *alg_type;		/* AF_ALG type */
+	const char *alg_name;		/* AF_ALG algorithm */
+	const size_t key_len;		/* AF_ALG key size, 0 for none */
+	const size_t out_len;		/* digest or tag size */
+	const bool aead;		/* true for aead, out is len + out_len */
+	void (*user)(const stress_cryptbench_ctx_t *ctx, const uint8_t *in,
+		     const size_t len, uint8_t *out);
+} stress_cryptbench_method_t;
+
+static const stress_cryptbench_method_t cryptbench_info[] = {
+	{ "aead", "gcm(aes)",			16, CRYPTBENCH_TAG_LEN, true, stress_cryptbench_user_aes_gcm },
+	{ "aead", "rfc7539(chacha20,poly1305)",	32, CRYPTBENCH_TAG_LEN, true, stress_cryptbench_user_chacha20 },
+	{ "hash", "sha256",			0,  32, false, stress_cryptbench_user_sha256 },
+	{ "hash", "crc32c",			0,  4,  false, stress_cryptbench_user_crc32c },
+};
+
+/*
+ *  stress_cryptbench_user_impl()
+ *	name of the in process implementation of method m, NULL if
+ *	there is none for this cpu
+ */
+static const char *stress_cryptbench_user_impl(const stress_cryptbench_ctx_t *ctx, const size_t m)
+{
+	switch (m) {
+	case CRYPTBENCH_AES_GCM:
+#if defined(HAVE_CRYPTBENCH_AES_NI)
+		if (stress_cpu_x86_has_aes_pclmulqdq())
+			return "aes-ni + pclmulqdq";
+#endif
+		return NULL;
+	case CRYPTBENCH_CHACHA20:
+		return ctx->chacha_vec ? "8 way vector chacha20 + 26 bit poly1305" :
+					 "scalar chacha20 + 26 bit poly1305";
+	case CRYPTBENCH_SHA256:
+		return ctx->sha_ni ? "sha-ni" : "generic C";
+	case CRYPTBENCH_CRC32C:
+		return stress_hash_crc32c_hw_impl();
+	default:
+		return NULL;
+	}
+}
+
+#if defined(HAVE_LINUX_IF_ALG_H) &&	\
+    defined(HAVE_LINUX_SOCKET_H) &&	\
+    defined(AF_ALG)
+#define HAVE_CRYPTBENCH_AF_ALG
+
+#if !defined(SOL_ALG)
+#define SOL_ALG				(279)
+#endif
+
+typedef struct {
+	int sockfd;		/* bound AF_ALG socket */
+	int opfd;		/* operation socket */
+	int pipefds[2];		/* pipe for vmsplice/splice zero copy input */
+	bool splice;		/* input is spliced rather than sent */
+} stress_cryptbench_af_alg_t;
+
+static void stress_cryptbench_af_alg_close(stress_cryptbench_af_alg_t *af)
+{
+	if (af->opfd >= 0)
+		(void)close(af->opfd);
+	if (af->sockfd >= 0)
+		(void)close(af->sockfd);
+	if (af->pipefds[0] >= 0)
+		(void)close(af->pipefds[0]);
+	if (af->pipefds[1] >= 0)
+		(void)close(af->pipefds[1]);
+	af->opfd = -1;
+	af->sockfd = -1;
+	af->pipefds[0] = -1;
+	af->pipefds[1] = -1;
+}
+
+/*
+ *  stress_cryptbench_af_alg_open()
+ *	bind and key an AF_ALG socket for method info, returns
+ *	0 on success or the errno of the failure
+ */
+static int stress_cryptbench_af_alg_open(
+	stress_cryptbench_af_alg_t *af,
+	const stress_cryptbench_method_t *info,
+	const stress_cryptbench_ctx_t *ctx,
+	const bool use_splice)
+{
+	struct sockaddr_alg sa;
+	int err;
+
+	af->opfd = -1;
+	af->pipefds[0] = -1;
+	af->pipefds[1] = -1;
+	af->splice = false;
+
+	af->sockfd = socket(AF_ALG, SOCK_SEQPACKET, 0);
+	if (af->sockfd < 0)
+		return errno;
+
+	(void)memset(&sa, 0, sizeof(sa));
+	sa.salg_family = AF_ALG;
+	(void)shim_strlcpy((char *)sa.salg_type, info->alg_type, sizeof(sa.salg_type));
+	(void)shim_strlcpy((char *)sa.salg_name, info->alg_name, sizeof(sa.salg_name));
+	if (bind(af->sockfd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		goto err;
+	if (info->key_len &&
+	    (setsockopt(af->sockfd, SOL_ALG, ALG_SET_KEY, ctx->key, (socklen_t)info->key_len) < 0))
+		goto err;
+#if defined(ALG_SET_AEAD_AUTHSIZE)
+	if (info->aead &&
+	    (setsockopt(af->sockfd, SOL_ALG, ALG_SET_AEAD_AUTHSIZE, NULL, (socklen_t)info->out_len) < 0))
+		goto err;
+#endif
+	af->opfd = accept(af->sockfd, NULL, 0);
+	if (af->opfd < 0)
+		goto err;
+
+#if defined(HAVE_VMSPLICE) &&	\
+    defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MORE)
+	if (use_splice && (pipe(af->pipefds) == 0))
+		af->splice = true;
+#else
+	(void)use_splice;
+#endif
+	return 0;
+err:
+	err = errno;
+	stress_cryptbench_af_alg_close(af);
+	return err;
+}
+
+/*
+ *  stress_cryptbench_af_alg_op()
+ *	encrypt or hash len bytes of in, the input is either
+ *	vmspliced into a pipe and spliced into the socket so the
+ *	kernel reads the user pages directly, or sent
+ */
+static bool stress_cryptbench_af_alg_op(
+	stress_cryptbench_af_alg_t *af,
+	const stress_cryptbench_method_t *info,
+	const stress_cryptbench_ctx_t *ctx,
+	uint8_t *in,
+	const size_t len,
+	uint8_t *out)
+{
+	const size_t out_len = info->aead ? len + info->out_len : info->out_len;
+
+	if (info->aead) {
+		char cbuf[CMSG_SPACE(sizeof(uint32_t)) +
+			  CMSG_SPACE(sizeof(struct af_alg_iv) + CRYPTBENCH_IV_LEN) +
+			  CMSG_SPACE(sizeof(uint32_t))] ALIGN64;
+		struct msghdr msg;
+		struct cmsghdr *cmsg;
+		struct af_alg_iv *iv;
+		uint32_t val;
+
+		(void)memset(cbuf, 0, sizeof(cbuf));
+		(void)memset(&msg, 0, sizeof(msg));
+		msg.msg_control = cbuf;
+		msg.msg_controllen = sizeof(cbuf);
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		if (!cmsg)
+			return false;
+		cmsg->cmsg_level = SOL_ALG;
+		cmsg->cmsg_type = ALG_SET_OP;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint32_t));
+		val = ALG_OP_ENCRYPT;
+		(void)memcpy(CMSG_DATA(cmsg), &val, sizeof(val));
+
+		cmsg = CMSG_NXTHDR(&msg, cmsg);
+		if (!cmsg)
+			return false;
+		cmsg->cmsg_level = SOL_ALG;
+		cmsg->cmsg_type = ALG_SET_IV;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(struct af_alg_iv) + CRYPTBENCH_IV_LEN);
+		iv = (struct af_alg_iv *)CMSG_DATA(cmsg);
+		iv->ivlen = CRYPTBENCH_IV_LEN;
+		(void)memcpy(iv->iv, ctx->iv, CRYPTBENCH_IV_LEN);
+
+#if defined(ALG_SET_AEAD_ASSOCLEN)
+		cmsg = CMSG_NXTHDR(&msg, cmsg);
+		if (!cmsg)
+			return false;
+		cmsg->cmsg_level = SOL_ALG;
+		cmsg->cmsg_type = ALG_SET_AEAD_ASSOCLEN;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint32_t));
+		val = 0;
+		(void)memcpy(CMSG_DATA(cmsg), &val, sizeof(val));
+#else
+		msg.msg_controllen = CMSG_SPACE(sizeof(uint32_t)) +
+			CMSG_SPACE(sizeof(struct af_alg_iv) + CRYPTBENCH_IV_LEN);
+#endif
+		/* operation setup only, the data follows */
+		if (sendmsg(af->opfd, &msg, MSG_MORE) < 0)
+			return false;
+	}
+
+#if defined(HAVE_VMSPLICE) &&	\
+    defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MORE)
+	if (af->splice) {
+		struct iovec iov;
+
+		iov.iov_base = (void *)in;
+		iov.iov_len = len;
+		if (vmsplice(af->pipefds[1], &iov, 1, 0) != (ssize_t)len)
+			return false;
+		if (splice(af->pipefds[0], NULL, af->opfd, NULL, len, 0) != (ssize_t)len)
+			return false;
+	} else
+#endif
+	{
+		if (send(af->opfd, in, len, 0) != (ssize_t)len)
+			return false;
+	}
+	return read(af->opfd, out, out_len) == (ssize_t)out_len;
+}
+#endif
+
+/*
+ *  stress_cryptbench_kat()
+ *	known answer tests of the in process implementations,
+ *	FIPS 180-2, the GCM specification test cases 3 and 4 and
+ *	RFC 8439 2.8.2, plus the accelerated versions against the
+ *	generic ones on random data
+ */
+static bool stress_cryptbench_kat(
+	const stress_args_t *args,
+	const stress_cryptbench_ctx_t *ctx,
+	uint8_t *buf,
+	uint8_t *out1,
+	uint8_t *out2,
+	const size_t size)
+{
+	static const uint8_t sha256_abc[32] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+	};
+	static const uint8_t sha256_abcdbcde[32] = {
+		0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+		0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1,
+	};
+	static const char plaintext[] =
+		"Ladies and Gentlemen of the class of '99: If I could offer you "
+		"only one tip for the future, sunscreen would be it.";
+	static const uint8_t chacha_aad[12] = {
+		0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+	};
+	static const uint8_t chacha_iv[12] = {
+		0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+	};
+	static const uint8_t chacha_tag[16] = {
+		0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a, 0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91,
+	};
+	static const uint8_t chacha_ct[16] = {
+		0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+	};
+	uint8_t key[32], digest[32];
+	bool ok = true;
+	size_t i;
+
+	stress_sha256(false, (const uint8_t *)"abc", 3, digest);
+	if (memcmp(digest, sha256_abc, sizeof(digest))) {
+		pr_fail("%s: generic sha256 of \"abc\" is incorrect\n", args->name);
+		ok = false;
+	}
+	stress_sha256(false, (const uint8_t *)"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, digest);
+	if (memcmp(digest, sha256_abcdbcde, sizeof(digest))) {
+		pr_fail("%s: generic sha256 of the 448 bit message is incorrect\n", args->name);
+		ok = false;
+	}
+	if (ctx->sha_ni) {
+		for (i = 0; i < size; i += 1 + (i / 2)) {
+			stress_sha256(false, buf, i, out1);
+			stress_sha256(true, buf, i, out2);
+			if (memcmp(out1, out2, 32)) {
+				pr_fail("%s: sha-ni sha256 of %zu bytes differs from generic sha256\n",
+					args->name, i);
+				ok = false;
+				break;
+			}
+		}
+	}
+
+	for (i = 0; i < sizeof(key); i++)
+		key[i] = (uint8_t)(0x80 + i);
+	stress_chacha20_poly1305(key, chacha_iv, false, chacha_aad, sizeof(chacha_aad),
+		(const uint8_t *)plaintext, sizeof(plaintext) - 1, out1);
+	if (memcmp(out1, chacha_ct, sizeof(chacha_ct)) ||
+	    memcmp(out1 + sizeof(plaintext) - 1, chacha_tag, sizeof(chacha_tag))) {
+		pr_fail("%s: chacha20-poly1305 RFC 8439 test vector is incorrect\n", args->name);
+		ok = false;
+	}
+	if (ctx->chacha_vec) {
+		stress_chacha20_poly1305(ctx->key, ctx->iv, false, NULL, 0, buf, size, out1);
+		stress_chacha20_poly1305(ctx->key, ctx->iv, true, NULL, 0, buf, size, out2);
+		if (memcmp(out1, out2, size + CRYPTBENCH_TAG_LEN)) {
+			pr_fail("%s: vector chacha20-poly1305 differs from scalar chacha20-poly1305\n",
+				args->name);
+			ok = false;
+		}
+	}
+
+#if defined(HAVE_CRYPTBENCH_AES_NI)
+	if (stress_cryptbench_user_impl(ctx, CRYPTBENCH_AES_GCM)) {
+		static const uint8_t gcm_key[16] = {
+			0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+		};
+		static const uint8_t gcm_iv[12] = {
+			0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88,
+		};
+		static const uint8_t gcm_pt[64] = {
+			0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+			0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+			0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+			0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55,
+		};
+		static const uint8_t gcm_ct[64] = {
+			0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+			0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+			0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+			0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91, 0x47, 0x3f, 0x59, 0x85,
+		};
+		static const uint8_t gcm_aad[20] = {
+			0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+			0xab, 0xad, 0xda, 0xd2,
+		};
+		static const uint8_t gcm_tag3[16] = {
+			0x4d, 0x5c, 0x2a, 0xf3, 0x27, 0xcd, 0x64, 0xa6, 0x2c, 0xf3, 0x5a, 0xbd, 0x2b, 0xa6, 0xfa, 0xb4,
+		};
+		static const uint8_t gcm_tag4[16] = {
+			0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb, 0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47,
+		};
+		stress_cryptbench_ctx_t gcm_ctx;
+
+		(void)memset(&gcm_ctx, 0, sizeof(gcm_ctx));
+		(void)memcpy(gcm_ctx.key, gcm_key, sizeof(gcm_key));
+		(void)memcpy(gcm_ctx.iv, gcm_iv, sizeof(gcm_iv));
+		stress_aes_gcm_init(&gcm_ctx);
+
+		stress_aes_gcm(&gcm_ctx, NULL, 0, gcm_pt, sizeof(gcm_pt), out1);
+		if (memcmp(out1, gcm_ct, sizeof(gcm_ct)) ||
+		    memcmp(out1 + sizeof(gcm_pt), gcm_tag3, sizeof(gcm_tag3))) {
+			pr_fail("%s: aes-gcm test case 3 is incorrect\n", args->name);
+			ok = false;
+		}
+		stress_aes_gcm(&gcm_ctx, gcm_aad, sizeof(gcm_aad), gcm_pt, 60, out1);
+		if (memcmp(out1, gcm_ct, 60) ||
+		    memcmp(out1 + 60, gcm_tag4, sizeof(gcm_tag4))) {
+			pr_fail("%s: aes-gcm test case 4 is incorrect\n", args->name);
+			ok = false;
+		}
+	}
+#endif
+
+	{
+		uint8_t crc[4];
+
+		stress_cryptbench_user_crc32c(ctx, (const uint8_t *)"123456789", 9, crc);
+		if (stress_cryptbench_le32(crc) != 0xe3069283) {
+			pr_fail("%s: crc32c check value is incorrect\n", args->name);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+/*
+ *  stress_cryptbench()
+ *	measure crypto throughput of in process implementations and
+ *	of the kernel crypto API over a range of buffer sizes
+ */
+static int stress_cryptbench(const stress_args_t *args)
+{
+	static stress_cryptbench_stats_t stats[SIZEOF_ARRAY(cryptbench_info)][CRYPTBENCH_MAX_SIZES][2];
+	stress_cryptbench_ctx_t ctx;
+#if defined(HAVE_CRYPTBENCH_AF_ALG)
+	stress_cryptbench_af_alg_t af[SIZEOF_ARRAY(cryptbench_info)];
+#endif
+	const char *user_impl[SIZEOF_ARRAY(cryptbench_info)];
+	bool af_alg_ok[SIZEOF_ARRAY(cryptbench_info)];
+	int af_alg_err[SIZEOF_ARRAY(cryptbench_info)];
+	size_t sizes[CRYPTBENCH_MAX_SIZES];
+	size_t cryptbench_method = 0, n_sizes = 0, m, s, buf_size, idx = 0;
+	uint64_t cryptbench_size = DEFAULT_CRYPTBENCH_SIZE;
+	uint8_t *buf, *in, *out1, *out2;
+	int rc = EXIT_SUCCESS;
+	bool lock = false, checked[SIZEOF_ARRAY(cryptbench_info)][CRYPTBENCH_MAX_SIZES];
+
+	(void)stress_get_setting("cryptbench-method", &cryptbench_method);
+	if (!stress_get_setting("cryptbench-size", &cryptbench_size)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			cryptbench_size = MAX_CRYPTBENCH_SIZE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			cryptbench_size = MIN_CRYPTBENCH_SIZE;
+	}
+	for (s = MIN_CRYPTBENCH_SIZE; (s <= cryptbench_size) && (n_sizes < CRYPTBENCH_MAX_SIZES); s *= 4)
+		sizes[n_sizes++] = s;
+
+	/* input, two outputs with room for a tag */
+	buf_size = (size_t)(3 * (MAX_CRYPTBENCH_SIZE + args->page_size));
+	buf = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for the buffers, skipping stressor\n",
+			args->name, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	in = buf;
+	out1 = in + MAX_CRYPTBENCH_SIZE + args->page_size;
+	out2 = out1 + MAX_CRYPTBENCH_SIZE + args->page_size;
+	stress_strnrnd((char *)in, MAX_CRYPTBENCH_SIZE);
+
+	(void)memset(&ctx, 0, sizeof(ctx));
+	stress_strnrnd((char *)ctx.key, sizeof(ctx.key));
+	stress_strnrnd((char *)ctx.iv, sizeof(ctx.iv));
+#if defined(HAVE_CRYPTBENCH_SHA_NI)
+	ctx.sha_ni = stress_cpu_x86_has_sha();
+#endif
+#if defined(HAVE_VECMATH)
+	ctx.chacha_vec = true;
+#endif
+	for (m = 0; m < SIZEOF_ARRAY(cryptbench_info); m++)
+		user_impl[m] = stress_cryptbench_user_impl(&ctx, m);
+#if defined(HAVE_CRYPTBENCH_AES_NI)
+	if (user_impl[CRYPTBENCH_AES_GCM])
+		stress_aes_gcm_init(&ctx);
+#endif
+
+	if ((g_opt_flags & OPT_FLAGS_VERIFY) &&
+	    !stress_cryptbench_kat(args, &ctx, in, out1, out2, MAX_CRYPTBENCH_SIZE)) {
+		rc = EXIT_FAILURE;
+		goto tidy_buf;
+	}
+
+	for (m = 0; m < SIZEOF_ARRAY(cryptbench_info); m++) {
+		const bool selected = !cryptbench_method || (cryptbench_method == m + 1);
+
+		af_alg_ok[m] = false;
+		af_alg_err[m] = ENOSYS;
+		if (!selected) {
+			user_impl[m] = NULL;
+			continue;
+		}
+#if defined(HAVE_CRYPTBENCH_AF_ALG)
+		af_alg_err[m] = stress_cryptbench_af_alg_open(&af[m], &cryptbench_info[m], &ctx, true);
+		af_alg_ok[m] = (af_alg_err[m] == 0);
+#endif
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(checked, 0, sizeof(checked));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (m = 0; m < SIZEOF_ARRAY(cryptbench_info); m++) {
+			const stress_cryptbench_method_t *info = &cryptbench_info[m];
+
+			for (s = 0; keep_stressing(args) && (s < n_sizes); s++) {
+				const size_t size = sizes[s];
+				const size_t n = STRESS_MAXIMUM(CRYPTBENCH_BATCH / size, 1);
+				const size_t out_len = info->aead ? size + info->out_len : info->out_len;
+				size_t i;
+				double t;
+
+				if (user_impl[m]) {
+					t = stress_time_now();
+					for (i = 0; i < n; i++)
+						info->user(&ctx, in, size, out1);
+					stats[m][s][CRYPTBENCH_PATH_USER].duration += stress_time_now() - t;
+					stats[m][s][CRYPTBENCH_PATH_USER].bytes += (double)(n * size);
+				}
+#if defined(HAVE_CRYPTBENCH_AF_ALG)
+				if (af_alg_ok[m]) {
+					t = stress_time_now();
+					for (i = 0; i < n; i++) {
+						if (!stress_cryptbench_af_alg_op(&af[m], info, &ctx, in, size, out2))
+							break;
+					}
+					if (i < n) {
+						/* zero copy input may not be supported, retry with send */
+						const bool was_splice = af[m].splice;
+
+						af_alg_err[m] = errno;
+						stress_cryptbench_af_alg_close(&af[m]);
+						if (was_splice) {
+							pr_dbg("%s: AF_ALG %s splice failed, errno=%d (%s), using send instead\n",
+								args->name, info->alg_name, af_alg_err[m], strerror(af_alg_err[m]));
+							af_alg_err[m] = stress_cryptbench_af_alg_open(&af[m], info, &ctx, false);
+						}
+						af_alg_ok[m] = was_splice && (af_alg_err[m] == 0);
+						if (!af_alg_ok[m] && (args->instance == 0))
+							pr_inf("%s: AF_ALG %s failed, errno=%d (%s), no longer using it\n",
+								args->name, info->alg_name, af_alg_err[m], strerror(af_alg_err[m]));
+					} else {
+						stats[m][s][CRYPTBENCH_PATH_AF_ALG].duration += stress_time_now() - t;
+						stats[m][s][CRYPTBENCH_PATH_AF_ALG].bytes += (double)(n * size);
+
+						/* the in process and kernel results must match */
+						if (user_impl[m] && !checked[m][s] && (g_opt_flags & OPT_FLAGS_VERIFY)) {
+							checked[m][s] = true;
+							if (memcmp(out1, out2, out_len)) {
+								pr_fail("%s: %s of %zu bytes differs between the in process "
+									"%s implementation and AF_ALG %s\n",
+									args->name, cryptbench_methods[m], size,
+									user_impl[m], info->alg_name);
+								rc = EXIT_FAILURE;
+							}
+						}
+					}
+				}
+#else
+				(void)out_len;
+#endif
+				if (user_impl[m] || af_alg_ok[m])
+					inc_counter(args);
+			}
+		}
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_lock(&lock);
+		for (m = 0; m < SIZEOF_ARRAY(cryptbench_info); m++) {
+			if (cryptbench_method && (cryptbench_method != m + 1))
+				continue;
+			pr_inf_lock(&lock, "%s: %s: in process %s, AF_ALG %s %s%s\n",
+				args->name, cryptbench_methods[m],
+				user_impl[m] ? user_impl[m] : "not available",
+				cryptbench_info[m].alg_name,
+#if defined(HAVE_CRYPTBENCH_AF_ALG)
+				af_alg_ok[m] ? (af[m].splice ? "with spliced input" : "with sent input") :
+#endif
+				"not available: ",
+				af_alg_ok[m] ? "" : strerror(af_alg_err[m]));
+		}
+		pr_inf_lock(&lock, "%s: %-18s %7s %14s %14s\n",
+			args->name, "method", "bytes", "in proc MB/s", "AF_ALG MB/s");
+		for (m = 0; m < SIZEOF_ARRAY(cryptbench_info); m++) {
+			for (s = 0; s < n_sizes; s++) {
+				const stress_cryptbench_stats_t *u = &stats[m][s][CRYPTBENCH_PATH_USER];
+				const stress_cryptbench_stats_t *k = &stats[m][s][CRYPTBENCH_PATH_AF_ALG];
+				char ustr[16], kstr[16];
+
+				if ((u->duration <= 0.0) && (k->duration <= 0.0))
+					continue;
+				if (u->duration > 0.0)
+					(void)snprintf(ustr, sizeof(ustr), "%.2f", (u->bytes / u->duration) / MB);
+				else
+					(void)shim_strlcpy(ustr, "-", sizeof(ustr));
+				if (k->duration > 0.0)
+					(void)snprintf(kstr, sizeof(kstr), "%.2f", (k->bytes / k->duration) / MB);
+				else
+					(void)shim_strlcpy(kstr, "-", sizeof(kstr));
+				pr_inf_lock(&lock, "%s: %-18s %7zu %14s %14s\n",
+					args->name, cryptbench_methods[m], sizes[s], ustr, kstr);
+			}
+		}
+		pr_unlock(&lock);
+	}
+
+	/* in process (user) and AF_ALG throughput at the largest buffer size */
+	for (m = 0; m < SIZEOF_ARRAY(cryptbench_info); m++) {
+		const stress_cryptbench_stats_t *u = &stats[m][n_sizes - 1][CRYPTBENCH_PATH_USER];
+		const stress_cryptbench_stats_t *k = &stats[m][n_sizes - 1][CRYPTBENCH_PATH_AF_ALG];
+		char desc[32];
+
+		if (u->duration > 0.0) {
+			(void)snprintf(desc, sizeof(desc), "%s user MB/sec", cryptbench_methods[m]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, (u->bytes / u->duration) / MB);
+		}
+		if (k->duration > 0.0) {
+			(void)snprintf(desc, sizeof(desc), "%s AF_ALG MB/sec", cryptbench_methods[m]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, (k->bytes / k->duration) / MB);
+		}
+	}
+
+#if defined(HAVE_CRYPTBENCH_AF_ALG)
+	for (m = 0; m < SIZEOF_ARRAY(cryptbench_info); m++) {
+		if (af_alg_ok[m])
+			stress_cryptbench_af_alg_close(&af[m]);
+	}
+#endif
+tidy_buf:
+	(void)munmap((void *)buf, buf_size);
+
+	return rc;
+}
+
+stressor_info_t stress_cryptbench_info = {
+	.stressor = stress_cryptbench,
+	.class = CLASS_CPU | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
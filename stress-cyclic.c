@@ -19,10 +19,12 @@
  */
 #include "stress-ng.h"
 #include "core-capabilities.h"
+#include "core-latency.h"
 
 #define DEFAULT_DELAY_NS	(100000)
 #define MAX_SAMPLES		(10000)
 #define MAX_BUCKETS		(250)
+#define MAX_JITTER_BUCKETS	(SIZEOF_ARRAY(jitter_buckets))
 
 typedef struct {
 	const int	policy;		/* scheduler policy */
@@ -30,6 +32,12 @@ typedef struct {
 	const char	*opt_name;	/* option name */
 } stress_policy_t;
 
+/* Upper bounds of the --cyclic-pin per-CPU jitter histogram buckets */
+static const int64_t jitter_buckets[] = {
+	1000, 2000, 5000, 10000, 20000, 50000, 100000,
+	200000, 500000, 1000000, 2000000, 5000000, 10000000, INT64_MAX,
+};
+
 typedef struct {
 	int64_t		min_ns;		/* min latency */
 	int64_t		max_ns;		/* max latency */
@@ -41,6 +49,14 @@ typedef struct {
 	double		latency_mean;	/* average latency */
 	int64_t		latency_mode;	/* first mode */
 	double		std_dev;	/* standard deviation */
+	double		start;		/* start time of measurements */
+	uint64_t	cycles;		/* total cycles measured */
+	int64_t		worst_ns;	/* worst case latency of all cycles */
+	double		worst_time;	/* when worst case occurred, secs from start */
+	time_t		worst_wall;	/* wall clock time of worst case */
+	uint64_t	hist[MAX_JITTER_BUCKETS];	/* jitter histogram */
+	int		cpu;		/* CPU pinned to, -1 if not pinned */
+	const char	*policy_name;	/* name of scheduler policy used */
 } stress_rt_stats_t;
 
 typedef int (*stress_cyclic_func)(const stress_args_t *args, stress_rt_stats_t *rt_stats, uint64_t cyclic_sleep);
@@ -54,6 +70,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"cyclic N",		"start N cyclic real time benchmark stressors" },
 	{ NULL,	"cyclic-ops N",		"stop after N cyclic timing cycles" },
 	{ NULL,	"cyclic-method M",	"specify cyclic method M, default is clock_ns" },
+	{ NULL,	"cyclic-pin",		"pin each instance to a different CPU, report per CPU jitter" },
 	{ NULL,	"cyclic-dist N",	"calculate distribution of interval N nanosecs" },
 	{ NULL,	"cyclic-policy P",	"used rr or fifo scheduling policy" },
 	{ NULL,	"cyclic-prio N",	"real time scheduling priority 1..100" },
@@ -75,6 +92,11 @@ static const stress_policy_t policies[] = {
 
 static const size_t num_policies = SIZEOF_ARRAY(policies);
 
+static int stress_set_cyclic_pin(const char *opt)
+{
+	return stress_set_setting_true("cyclic-pin", opt);
+}
+
 static int stress_set_cyclic_sleep(const char *opt)
 {
 	uint64_t cyclic_sleep;
@@ -121,11 +143,46 @@ static int stress_set_cyclic_dist(const char *opt)
 	return stress_set_setting("cyclic-dist", TYPE_ID_UINT64, &cyclic_dist);
 }
 
+#if defined(HAVE_CLOCK_GETTIME)
+/*
+ *  stress_cyclic_record()
+ *	record a latency sample, track the worst case latency
+ *	and when it occurred and update the jitter histogram
+ */
+static void stress_cyclic_record(
+	const stress_args_t *args,
+	stress_rt_stats_t *rt_stats,
+	const int64_t delta_ns)
+{
+	size_t i;
+
+	if (rt_stats->index < MAX_SAMPLES)
+		rt_stats->latencies[rt_stats->index++] = delta_ns;
+	stress_latency_record(args->latency, (delta_ns > 0) ? (uint64_t)delta_ns : 0);
+
+	rt_stats->ns += (double)delta_ns;
+	rt_stats->cycles++;
+
+	for (i = 0; i < MAX_JITTER_BUCKETS - 1; i++) {
+		if (delta_ns <= jitter_buckets[i])
+			break;
+	}
+	rt_stats->hist[i]++;
+
+	if (delta_ns > rt_stats->worst_ns) {
+		rt_stats->worst_ns = delta_ns;
+		rt_stats->worst_time = stress_time_now() - rt_stats->start;
+		rt_stats->worst_wall = time(NULL);
+	}
+}
+#endif
+
 #if (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_NANOSLEEP)) ||	\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_NANOSLEEP)) ||		\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_PSELECT)) ||		\
     (defined(HAVE_CLOCK_GETTIME))
 static void stress_cyclic_stats(
+	const stress_args_t *args,
 	stress_rt_stats_t *rt_stats,
 	const uint64_t cyclic_sleep,
 	const struct timespec *t1,
@@ -137,10 +194,7 @@ static void stress_cyclic_stats(
 		   (t2->tv_nsec - t1->tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < MAX_SAMPLES)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_record(args, rt_stats, delta_ns);
 }
 #else
 	UNEXPECTED
@@ -168,7 +222,7 @@ static int stress_cyclic_clock_nanosleep(
 	ret = clock_nanosleep(CLOCK_REALTIME, 0, &t, &trem);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -197,7 +251,7 @@ static int stress_cyclic_posix_nanosleep(
 	ret = nanosleep(&t, &trem);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -237,10 +291,7 @@ static int stress_cyclic_poll(
 		if (delta_ns >= (int64_t)cyclic_sleep) {
 			delta_ns -= cyclic_sleep;
 
-			if (rt_stats->index < MAX_SAMPLES)
-				rt_stats->latencies[rt_stats->index++] = delta_ns;
-
-			rt_stats->ns += (double)delta_ns;
+			stress_cyclic_record(args, rt_stats, delta_ns);
 			break;
 		}
 	}
@@ -272,7 +323,7 @@ static int stress_cyclic_pselect(
 	ret = pselect(0, NULL, NULL,NULL, &t, NULL);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -336,10 +387,7 @@ static int stress_cyclic_itimer(
 		(itimer_time.tv_nsec - t1.tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < MAX_SAMPLES)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_record(args, rt_stats, delta_ns);
 
 	(void)timer_delete(timerid);
 
@@ -376,7 +424,7 @@ static int stress_cyclic_usleep(
 	ret = usleep(usecs);
 	(void)clock_gettime(CLOCK_REALTIME, &t2);
 	if (ret == 0)
-		stress_cyclic_stats(rt_stats, cyclic_sleep, &t1, &t2);
+		stress_cyclic_stats(args, rt_stats, cyclic_sleep, &t1, &t2);
 	return 0;
 }
 #else
@@ -588,6 +636,122 @@ static void stress_rt_dist(
 	}
 }
 
+#if defined(HAVE_AFFINITY) &&	\
+    defined(HAVE_SCHED_GETAFFINITY)
+/*
+ *  stress_cyclic_pin()
+ *	pin instance N to the Nth allowed CPU, wrapping around
+ *	if there are more instances than CPUs
+ */
+static void stress_cyclic_pin(
+	const stress_args_t *args,
+	stress_rt_stats_t *rt_stats)
+{
+	cpu_set_t mask;
+	int cpus[CPU_SETSIZE], n_cpus = 0, i, cpu;
+
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf("%s: cannot get CPU affinity, errno=%d (%s), "
+			"not pinning instance\n",
+			args->name, errno, strerror(errno));
+		return;
+	}
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (CPU_ISSET(i, &mask))
+			cpus[n_cpus++] = i;
+	}
+	if (n_cpus == 0)
+		return;
+	if ((args->instance == 0) && (args->num_instances > (uint32_t)n_cpus))
+		pr_inf("%s: %" PRIu32 " instances pinned to %d CPUs, "
+			"some CPUs will be shared\n",
+			args->name, args->num_instances, n_cpus);
+
+	cpu = cpus[args->instance % (uint32_t)n_cpus];
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf("%s: cannot pin to CPU %d, errno=%d (%s)\n",
+			args->name, cpu, errno, strerror(errno));
+		return;
+	}
+	rt_stats->cpu = cpu;
+}
+#else
+static void stress_cyclic_pin(
+	const stress_args_t *args,
+	stress_rt_stats_t *rt_stats)
+{
+	(void)rt_stats;
+
+	if (args->instance == 0)
+		pr_inf("%s: CPU affinity not supported, --cyclic-pin "
+			"is being ignored\n", args->name);
+}
+#endif
+
+/*
+ *  stress_cyclic_wall_time()
+ *	format wall clock time t as HH:MM:SS
+ */
+static void stress_cyclic_wall_time(const time_t t, char *buf, const size_t len)
+{
+	const struct tm *tm = localtime(&t);
+
+	if (!tm || (strftime(buf, len, "%H:%M:%S", tm) == 0))
+		(void)shim_strlcpy(buf, "unknown", len);
+}
+
+/*
+ *  stress_cyclic_jitter_report()
+ *	report the per CPU jitter histogram and the worst
+ *	case latency and when it occurred
+ */
+static void stress_cyclic_jitter_report(
+	const stress_args_t *args,
+	const stress_rt_stats_t *rt_stats)
+{
+	bool lock = false;
+	size_t i, n;
+	char when[16];
+
+	if (!rt_stats->cycles) {
+		pr_inf("%s: cpu %d: no latency information available\n",
+			args->name, rt_stats->cpu);
+		return;
+	}
+	stress_cyclic_wall_time(rt_stats->worst_wall, when, sizeof(when));
+
+	/* Trim the empty buckets at the end of the histogram */
+	for (n = MAX_JITTER_BUCKETS; n > 1; n--) {
+		if (rt_stats->hist[n - 1])
+			break;
+	}
+
+	pr_lock(&lock);
+	pr_inf_lock(&lock, "%s: cpu %d: sched %s, %" PRIu64 " cycles, "
+		"mean %.2f ns, worst %" PRId64 " ns at %.3f s (%s)\n",
+		args->name, rt_stats->cpu, rt_stats->policy_name,
+		rt_stats->cycles, rt_stats->ns / (double)rt_stats->cycles,
+		rt_stats->worst_ns, rt_stats->worst_time, when);
+	pr_inf_lock(&lock, "%s: cpu %d: %14s %12s %8s\n",
+		args->name, rt_stats->cpu, "latency (us)", "cycles", "%");
+	for (i = 0; i < n; i++) {
+		char range[24];
+
+		if (jitter_buckets[i] == INT64_MAX)
+			(void)snprintf(range, sizeof(range), "> %" PRId64,
+				jitter_buckets[i - 1] / 1000);
+		else
+			(void)snprintf(range, sizeof(range), "<= %" PRId64,
+				jitter_buckets[i] / 1000);
+		pr_inf_lock(&lock, "%s: cpu %d: %14s %12" PRIu64 " %7.3f%%\n",
+			args->name, rt_stats->cpu, range, rt_stats->hist[i],
+			100.0 * (double)rt_stats->hist[i] / (double)rt_stats->cycles);
+	}
+	pr_unlock(&lock);
+}
+
 /*
  *  stress_cyclic_supported()
  *      check if we can run this as root
@@ -621,6 +785,7 @@ static int stress_cyclic(const stress_args_t *args)
 	const size_t page_size = args->page_size;
 	const size_t size = (sizeof(*rt_stats) + page_size - 1) & (~(page_size - 1));
 	stress_cyclic_func func;
+	bool cyclic_pin = false;
 
 	timeout  = g_opt_timeout;
 	(void)stress_get_setting("cyclic-sleep", &cyclic_sleep);
@@ -628,6 +793,7 @@ static int stress_cyclic(const stress_args_t *args)
 	(void)stress_get_setting("cyclic-policy", &cyclic_policy);
 	(void)stress_get_setting("cyclic-dist", &cyclic_dist);
 	(void)stress_get_setting("cyclic-method", &cyclic_method);
+	(void)stress_get_setting("cyclic-pin", &cyclic_pin);
 
 	func = cyclic_method->func;
 	policy = policies[cyclic_policy].policy;
@@ -647,7 +813,7 @@ static int stress_cyclic(const stress_args_t *args)
 			"be %" PRIu64 " seconds\n", args->name, timeout);
 	}
 
-	if ((num_instances > 1) && (args->instance == 0)) {
+	if ((num_instances > 1) && (args->instance == 0) && !cyclic_pin) {
 		pr_inf("%s: for best results, run just 1 instance of "
 			"this stressor\n", args->name);
 	}
@@ -662,6 +828,12 @@ static int stress_cyclic(const stress_args_t *args)
 	rt_stats->min_ns = INT64_MAX;
 	rt_stats->max_ns = INT64_MIN;
 	rt_stats->ns = 0.0;
+	rt_stats->start = start;
+	rt_stats->worst_ns = INT64_MIN;
+	rt_stats->policy_name = policies[cyclic_policy].name;
+	rt_stats->cpu = -1;
+	if (cyclic_pin)
+		stress_cyclic_pin(args, rt_stats);
 #if defined(HAVE_SCHED_GET_PRIORITY_MIN)
 	rt_stats->min_prio = sched_get_priority_min(policy);
 #else
@@ -699,6 +871,7 @@ again:
 #if defined(HAVE_SCHED_GET_PRIORITY_MIN) &&	\
     defined(HAVE_SCHED_GET_PRIORITY_MAX)
 		const pid_t mypid = getpid();
+		bool sched_set = false;
 #endif
 #if defined(HAVE_ATOMIC)
 		uint32_t count;
@@ -746,9 +919,37 @@ again:
 #if defined(HAVE_SCHED_GET_PRIORITY_MIN) &&	\
     defined(HAVE_SCHED_GET_PRIORITY_MAX)
 #if defined(SCHED_DEADLINE)
+		/*
+		 *  A pinned instance uses a deadline reservation that matches
+		 *  the cyclic period. The kernel only admits deadline tasks
+		 *  whose affinity spans the entire root domain, so this
+		 *  needs each CPU to be in its own exclusive cpuset; if not
+		 *  then fall back to the next scheduling policy.
+		 */
+		if ((rt_stats->cpu >= 0) && (policy == SCHED_DEADLINE)) {
+			uint64_t runtime = STRESS_MAXIMUM(cyclic_sleep / 10, 1024);
+
+			runtime = STRESS_MINIMUM(runtime, cyclic_sleep);
+			ret = stress_set_deadline_sched(mypid, cyclic_sleep, runtime, cyclic_sleep, true);
+			if (ret == 0) {
+				sched_set = true;
+			} else if (num_policies > 1) {
+				cyclic_policy = 1;
+				policy = policies[cyclic_policy].policy;
+				rt_stats->policy_name = policies[cyclic_policy].name;
+				rt_stats->max_prio = sched_get_priority_max(policy);
+				if ((cyclic_prio != INT32_MAX) && (rt_stats->max_prio > cyclic_prio))
+					rt_stats->max_prio = cyclic_prio;
+				if (args->instance == 0)
+					pr_inf("%s: cannot set DEADLINE on a pinned CPU, errno=%d (%s), "
+						"this may need an exclusive cpuset per CPU, defaulting to %s\n",
+						args->name, -ret, strerror(-ret),
+						policies[cyclic_policy].name);
+			}
+		}
 redo_policy:
 #endif
-		ret = stress_set_sched(mypid, policy, rt_stats->max_prio, true);
+		ret = sched_set ? 0 : stress_set_sched(mypid, policy, rt_stats->max_prio, true);
 		if (ret < 0) {
 #if defined(SCHED_DEADLINE)
 			/*
@@ -762,6 +963,7 @@ redo_policy:
 			    (policies[cyclic_policy].policy == SCHED_DEADLINE)) {
 				cyclic_policy = 1;
 				policy = policies[cyclic_policy].policy;
+				rt_stats->policy_name = policies[cyclic_policy].name;
 #if defined(HAVE_SCHED_GET_PRIORITY_MAX)
 				rt_stats->max_prio = sched_get_priority_max(policy);
 #else
@@ -817,7 +1019,9 @@ tidy:
 
 	stress_rt_stats(rt_stats);
 
-	if (args->instance == 0) {
+	if (cyclic_pin) {
+		stress_cyclic_jitter_report(args, rt_stats);
+	} else if (args->instance == 0) {
 		if (rt_stats->index) {
 			size_t i;
 			bool lock = false;
@@ -834,10 +1038,13 @@ tidy:
 				99.99,
 			};
 
+			char when[16];
+
+			stress_cyclic_wall_time(rt_stats->worst_wall, when, sizeof(when));
 			pr_lock(&lock);
 			pr_inf_lock(&lock, "%s: sched %s: %" PRIu64 " ns delay, %zd samples\n",
 				args->name,
-				policies[cyclic_policy].name,
+				rt_stats->policy_name,
 				cyclic_sleep,
 				rt_stats->index);
 			pr_inf_lock(&lock, "%s:   mean: %.2f ns, mode: %" PRId64 " ns\n",
@@ -849,6 +1056,13 @@ tidy:
 				rt_stats->min_ns,
 				rt_stats->max_ns,
 				rt_stats->std_dev);
+			pr_inf_lock(&lock, "%s:   worst case: %" PRId64 " ns at %.3f s (%s), "
+				"%" PRIu64 " cycles\n",
+				args->name,
+				rt_stats->worst_ns,
+				rt_stats->worst_time,
+				when,
+				rt_stats->cycles);
 
 			pr_inf_lock(&lock, "%s: latency percentiles:\n", args->name);
 			for (i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
@@ -863,7 +1077,7 @@ tidy:
 		} else {
 			pr_inf("%s: %10s: no latency information available\n",
 				args->name,
-				policies[cyclic_policy].name);
+				rt_stats->policy_name);
 		}
 	}
 
@@ -878,6 +1092,7 @@ finish:
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_cyclic_dist,	stress_set_cyclic_dist },
 	{ OPT_cyclic_method,	stress_set_cyclic_method },
+	{ OPT_cyclic_pin,	stress_set_cyclic_pin },
 	{ OPT_cyclic_policy,	stress_set_cyclic_policy },
 	{ OPT_cyclic_prio, 	stress_set_cyclic_prio },
 	{ OPT_cyclic_sleep,	stress_set_cyclic_sleep },
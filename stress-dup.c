@@ -22,9 +22,416 @@
 static const stress_help_t help[] = {
 	{ NULL,	"dup N",	"start N workers exercising dup/close" },
 	{ NULL,	"dup-ops N",	"stop after N dup/close bogo operations" },
+	{ NULL,	"dup-threads N","sweep 1 to N threads sharing one fd table" },
+	{ NULL,	"dup-fds N",	"grow the shared fd table to N fds (default 1M)" },
+	{ NULL,	"dup-scm",	"add a thread receiving fds via SCM_RIGHTS" },
 	{ NULL,	NULL,		NULL }
 };
 
+#define DUP_THREADS_MAX		(1024)
+#define DUP_FDS_MIN		(1024)
+#define DUP_FDS_MAX		(64 * 1024 * 1024)
+#define DUP_FDS_DEFAULT		(1024 * 1024)
+
+static int stress_set_dup_threads(const char *opt)
+{
+	uint32_t dup_threads;
+
+	dup_threads = stress_get_uint32(opt);
+	stress_check_range("dup-threads", (uint64_t)dup_threads, 1, DUP_THREADS_MAX);
+	return stress_set_setting("dup-threads", TYPE_ID_UINT32, &dup_threads);
+}
+
+static int stress_set_dup_fds(const char *opt)
+{
+	uint32_t dup_fds;
+
+	dup_fds = stress_get_uint32(opt);
+	stress_check_range("dup-fds", (uint64_t)dup_fds, DUP_FDS_MIN, DUP_FDS_MAX);
+	return stress_set_setting("dup-fds", TYPE_ID_UINT32, &dup_fds);
+}
+
+static int stress_set_dup_scm(const char *opt)
+{
+	return stress_set_setting_true("dup-scm", opt);
+}
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(RLIMIT_NOFILE)
+
+#define HAVE_DUP_THREADS
+
+#define DUP_FDS_RESERVED	(64)	/* fds left for stdio, sockets etc */
+#define DUP_OPEN_MASK		(15)	/* 1 in 16 fds is a fresh open */
+#define DUP_SCM_MASK		(63)	/* 1 in 64 fds is also sent via SCM_RIGHTS */
+#define DUP_POINT_DURATION	(1.0)
+
+#if defined(AF_UNIX) &&		\
+    defined(SCM_RIGHTS) &&	\
+    defined(SO_RCVTIMEO)
+#define HAVE_DUP_SCM
+#endif
+
+/*
+ *  per thread count results, shared with the measuring child
+ */
+typedef struct {
+	uint64_t ops;			/* open/dup/close calls */
+	uint64_t scm;			/* fds received via SCM_RIGHTS */
+	int max_fd;			/* highest fd allocated */
+	size_t fd_limit;		/* RLIMIT_NOFILE in the child */
+	double duration;		/* measured run time */
+	bool ok;
+} stress_dup_result_t;
+
+typedef struct {
+	pthread_t pthread;
+	int *fds;			/* fds held by this thread */
+	size_t quota;			/* fds to fill before draining */
+	uint64_t ops;
+	int max_fd;
+	int ret;
+} stress_dup_thread_t;
+
+static volatile bool dup_stop;
+static int dup_base_fd = -1;
+static int dup_scm_fds[2] = { -1, -1 };
+static uint64_t dup_scm_count;
+
+#if defined(HAVE_DUP_SCM)
+/*
+ *  stress_dup_scm_send()
+ *	pass fd to the SCM_RIGHTS receiver, never blocks
+ */
+static void stress_dup_scm_send(const int fd)
+{
+	struct iovec iov;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	char ctrl[CMSG_SPACE(sizeof(int))];
+	char data = 'D';
+
+	iov.iov_base = &data;
+	iov.iov_len = sizeof(data);
+
+	(void)memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	(void)memset(ctrl, 0, sizeof(ctrl));
+	msg.msg_control = ctrl;
+	msg.msg_controllen = sizeof(ctrl);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	(void)memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+
+	VOID_RET(ssize_t, sendmsg(dup_scm_fds[0], &msg, MSG_DONTWAIT));
+}
+
+/*
+ *  stress_dup_scm_receiver()
+ *	install fds passed over SCM_RIGHTS into the shared
+ *	fd table and close them again
+ */
+static void *stress_dup_scm_receiver(void *arg)
+{
+	(void)arg;
+
+	while (!dup_stop) {
+		struct iovec iov;
+		struct msghdr msg;
+		struct cmsghdr *cmsg;
+		char ctrl[CMSG_SPACE(sizeof(int))];
+		char data;
+
+		iov.iov_base = &data;
+		iov.iov_len = sizeof(data);
+
+		(void)memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		(void)memset(ctrl, 0, sizeof(ctrl));
+		msg.msg_control = ctrl;
+		msg.msg_controllen = sizeof(ctrl);
+
+		if (recvmsg(dup_scm_fds[1], &msg, 0) <= 0)
+			continue;
+		cmsg = CMSG_FIRSTHDR(&msg);
+		if (cmsg &&
+		    (cmsg->cmsg_level == SOL_SOCKET) &&
+		    (cmsg->cmsg_type == SCM_RIGHTS) &&
+		    ((size_t)cmsg->cmsg_len >= (size_t)CMSG_LEN(sizeof(int)))) {
+			int fd;
+
+			(void)memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+			(void)close(fd);
+			dup_scm_count++;
+		}
+	}
+	return NULL;
+}
+#endif
+
+/*
+ *  stress_dup_thread()
+ *	repeatedly fill the shared fd table with dup'd and freshly
+ *	opened fds up to the thread's quota then close them all,
+ *	the first fill of each child grows the table to full size
+ */
+static void *stress_dup_thread(void *arg)
+{
+	stress_dup_thread_t *t = (stress_dup_thread_t *)arg;
+	const bool scm = (dup_scm_fds[0] >= 0);
+
+	while (!dup_stop) {
+		size_t i, n;
+
+		for (n = 0; (n < t->quota) && !dup_stop; n++) {
+			int fd;
+
+			if ((n & DUP_OPEN_MASK) == DUP_OPEN_MASK)
+				fd = open("/dev/null", O_RDONLY);
+#if defined(F_DUPFD_CLOEXEC)
+			else if (n & 1)
+				fd = fcntl(dup_base_fd, F_DUPFD_CLOEXEC, 0);
+#endif
+			else
+				fd = dup(dup_base_fd);
+			t->ops++;
+			if (fd < 0) {
+				if ((errno == EMFILE) || (errno == ENFILE))
+					break;
+				t->ret = errno;
+				dup_stop = true;
+				break;
+			}
+			t->fds[n] = fd;
+			if (fd > t->max_fd)
+				t->max_fd = fd;
+#if defined(HAVE_DUP_SCM)
+			if (scm && ((n & DUP_SCM_MASK) == 0))
+				stress_dup_scm_send(fd);
+#else
+			(void)scm;
+#endif
+		}
+		for (i = 0; i < n; i++) {
+			(void)close(t->fds[i]);
+			t->ops++;
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  stress_dup_threads_measure()
+ *	in a child with a fresh fd table run n_threads threads
+ *	that share the table for DUP_POINT_DURATION seconds
+ */
+static void NORETURN stress_dup_threads_measure(
+	const uint32_t n_threads,
+	const size_t fd_target,
+	const bool scm,
+	stress_dup_result_t *result)
+{
+	stress_dup_thread_t *threads;
+	struct rlimit rlim;
+	size_t quota, fd_max;
+	uint32_t i, started;
+	double t_start, t_end;
+	bool failed = false;
+#if defined(HAVE_DUP_SCM)
+	pthread_t receiver;
+	bool receiver_ok = false;
+#endif
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	rlim.rlim_cur = fd_target;
+	rlim.rlim_max = fd_target;
+	if (setrlimit(RLIMIT_NOFILE, &rlim) < 0) {
+		if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+			_exit(EXIT_NO_RESOURCE);
+		rlim.rlim_cur = rlim.rlim_max;
+		(void)setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+	if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+		_exit(EXIT_NO_RESOURCE);
+	if ((rlim.rlim_cur != RLIM_INFINITY) && (rlim.rlim_cur < fd_target))
+		fd_max = (size_t)rlim.rlim_cur;
+	else
+		fd_max = fd_target;
+	if (fd_max <= DUP_FDS_RESERVED + n_threads)
+		_exit(EXIT_NO_RESOURCE);
+	quota = (fd_max - DUP_FDS_RESERVED) / n_threads;
+	result->fd_limit = fd_max;
+
+	dup_base_fd = open("/dev/null", O_RDONLY);
+	if (dup_base_fd < 0)
+		_exit(EXIT_NO_RESOURCE);
+	threads = calloc(n_threads, sizeof(*threads));
+	if (!threads)
+		_exit(EXIT_NO_RESOURCE);
+
+#if defined(HAVE_DUP_SCM)
+	if (scm && (socketpair(AF_UNIX, SOCK_DGRAM, 0, dup_scm_fds) == 0)) {
+		struct timeval tv;
+
+		tv.tv_sec = 0;
+		tv.tv_usec = 100000;
+		(void)setsockopt(dup_scm_fds[1], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		receiver_ok = (pthread_create(&receiver, NULL, stress_dup_scm_receiver, NULL) == 0);
+		if (!receiver_ok) {
+			(void)close(dup_scm_fds[0]);
+			(void)close(dup_scm_fds[1]);
+			dup_scm_fds[0] = -1;
+			dup_scm_fds[1] = -1;
+		}
+	}
+#else
+	(void)scm;
+#endif
+
+	dup_stop = false;
+	t_start = stress_time_now();
+	for (started = 0; started < n_threads; started++) {
+		stress_dup_thread_t *t = &threads[started];
+
+		t->quota = quota;
+		t->fds = calloc(quota, sizeof(*t->fds));
+		if (!t->fds)
+			break;
+		if (pthread_create(&t->pthread, NULL, stress_dup_thread, t) != 0) {
+			free(t->fds);
+			break;
+		}
+	}
+	if (started == n_threads)
+		(void)shim_usleep((useconds_t)(DUP_POINT_DURATION * 1000000.0));
+	dup_stop = true;
+	for (i = 0; i < started; i++) {
+		stress_dup_thread_t *t = &threads[i];
+
+		(void)pthread_join(t->pthread, NULL);
+		result->ops += t->ops;
+		if (t->max_fd > result->max_fd)
+			result->max_fd = t->max_fd;
+		if (t->ret)
+			failed = true;
+	}
+	t_end = stress_time_now();
+#if defined(HAVE_DUP_SCM)
+	if (receiver_ok)
+		(void)pthread_join(receiver, NULL);
+#endif
+	result->scm = dup_scm_count;
+	result->duration = t_end - t_start;
+	result->ok = (started == n_threads) && !failed;
+	_exit(result->ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*
+ *  stress_dup_threads()
+ *	sweep multi-threaded open/dup/close throughput on a shared
+ *	fd table over 1, 2, 4 .. N threads, each point is run in a
+ *	new child so the table has to grow from scratch every time
+ */
+static int stress_dup_threads(const stress_args_t *args, const uint32_t max_threads)
+{
+	uint32_t fd_target = DUP_FDS_DEFAULT;
+	uint32_t threads[32];
+	stress_dup_result_t *results, pass[32], res[32];
+	size_t i, n_points = 0;
+	bool scm = false, done = false;
+	uint32_t t;
+
+	(void)stress_get_setting("dup-fds", &fd_target);
+	(void)stress_get_setting("dup-scm", &scm);
+#if !defined(HAVE_DUP_SCM)
+	if (scm && (args->instance == 0))
+		pr_inf("%s: SCM_RIGHTS not supported, ignoring --dup-scm\n", args->name);
+	scm = false;
+#endif
+
+	for (t = 1; t < max_threads; t <<= 1)
+		threads[n_points++] = t;
+	threads[n_points++] = max_threads;
+
+	results = (stress_dup_result_t *)mmap(NULL, sizeof(*results), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (results == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(res, 0, sizeof(res));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < n_points; i++) {
+			pid_t pid;
+			int status;
+
+			if (!keep_stressing(args))
+				goto finish;
+			(void)memset(results, 0, sizeof(*results));
+			pid = fork();
+			if (pid < 0) {
+				(void)memset(&pass[i], 0, sizeof(pass[i]));
+				continue;
+			}
+			if (pid == 0)
+				stress_dup_threads_measure(threads[i], (size_t)fd_target, scm, results);
+			(void)shim_waitpid(pid, &status, 0);
+			pass[i] = *results;
+		}
+		(void)memcpy(res, pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: shared fd table, target %" PRIu32 " fds, limit %zu fds, %s\n",
+			args->name, fd_target, res[0].fd_limit,
+			scm ? "with SCM_RIGHTS receiver" : "no SCM_RIGHTS receiver");
+		pr_inf("%s: %7s %12s %12s %10s %10s\n", args->name,
+			"threads", "ops/sec", "ops/sec/thr", "scm fds/s", "peak fd");
+		for (i = 0; i < n_points; i++) {
+			const stress_dup_result_t *r = &res[i];
+
+			if (!r->ok || (r->duration <= 0.0)) {
+				pr_inf("%s: %7" PRIu32 " %12s %12s %10s %10s\n", args->name,
+					threads[i], "-", "-", "-", "-");
+				continue;
+			}
+			pr_inf("%s: %7" PRIu32 " %12.0f %12.0f %10.0f %10d\n", args->name,
+				threads[i], (double)r->ops / r->duration,
+				(double)r->ops / (r->duration * (double)threads[i]),
+				(double)r->scm / r->duration, r->max_fd);
+		}
+	}
+	if (done) {
+		for (i = 0; (i < n_points) && (i < 10); i++) {
+			const stress_dup_result_t *r = &res[i];
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "ops/sec, %" PRIu32 " threads", threads[i]);
+			stress_misc_stats_set(args->misc_stats, (int)i, str,
+				(r->ok && (r->duration > 0.0)) ? (double)r->ops / r->duration : 0.0);
+		}
+	}
+	(void)munmap((void *)results, sizeof(*results));
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 #if defined(__linux__) &&	\
     defined(HAVE_CLONE) &&	\
     defined(CLONE_VM) &&	\
@@ -195,10 +602,10 @@ static int stress_dup2_race(info_t *info)
 #endif
 
 /*
- *  stress_dup()
+ *  stress_dup_close()
  *	stress system by rapid dup/close calls
  */
-static int stress_dup(const stress_args_t *args)
+static int stress_dup_close(const stress_args_t *args)
 {
 	static int fds[STRESS_FD_MAX];
 	int rc = EXIT_SUCCESS;
@@ -384,9 +791,40 @@ tidy_mmap:
 	return rc;
 }
 
+/*
+ *  stress_dup()
+ *	stress system by rapid dup/close calls, or with --dup-threads
+ *	by threads churning fds in one shared fd table
+ */
+static int stress_dup(const stress_args_t *args)
+{
+	uint32_t dup_threads = 0;
+
+	(void)stress_get_setting("dup-threads", &dup_threads);
+	if (dup_threads > 0) {
+#if defined(HAVE_DUP_THREADS)
+		return stress_dup_threads(args, dup_threads);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: dup-threads is not supported on this system, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+	return stress_dup_close(args);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_dup_fds,		stress_set_dup_fds },
+	{ OPT_dup_scm,		stress_set_dup_scm },
+	{ OPT_dup_threads,	stress_set_dup_threads },
+	{ 0,			NULL }
+};
+
 stressor_info_t stress_dup_info = {
 	.stressor = stress_dup,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
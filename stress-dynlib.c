@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 #include "core-put.h"
 
 #if defined(HAVE_LIB_DL)
@@ -28,6 +29,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"dynlib N",	"start N workers exercising dlopen/dlclose" },
 	{ NULL,	"dynlib-ops N",	"stop after N dlopen/dlclose bogo operations" },
+	{ NULL,	"dynlib-bench",	"measure dlopen/dlsym/dlclose latency vs library and symbol count" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -98,6 +100,259 @@ static const stress_lib_info_t libnames[] = {
 #endif
 };
 
+#define DYNLIB_BENCH_SAMPLES	(128)
+#define DYNLIB_BENCH_DURATION	(0.25)
+
+/*
+ *  libm functions looked up for the dlsym symbol count sweep
+ */
+static const char * const dynlib_libm_symbols[] = {
+	"cos",		"sin",		"tan",		"acos",
+	"asin",		"atan",		"atan2",	"cosh",
+	"sinh",		"tanh",		"exp",		"exp2",
+	"expm1",	"log",		"log2",		"log10",
+	"log1p",	"pow",		"sqrt",		"cbrt",
+	"hypot",	"ceil",		"floor",	"round",
+	"trunc",	"fmod",		"remainder",	"fabs",
+	"fmin",		"fmax",		"fdim",		"erf",
+	"erfc",		"tgamma",	"lgamma",	"j0",
+	"j1",		"y0",		"y1",		"nextafter",
+	"copysign",	"frexp",	"ldexp",	"modf",
+	"scalbn",	"ilogb",	"logb",		"rint",
+};
+
+static const size_t dynlib_sym_counts[] = { 1, 8, 32, SIZEOF_ARRAY(dynlib_libm_symbols) };
+
+static const int dynlib_modes[] = { RTLD_LAZY, RTLD_NOW };
+
+/*
+ *  dlopen/dlsym/dlclose latencies for one library count
+ *  and binding mode, each sample is for the whole batch
+ */
+typedef struct {
+	stress_latency_t dlopen_lat;
+	stress_latency_t dlsym_lat;
+	stress_latency_t dlclose_lat;
+} stress_dynlib_lat_t;
+
+#define DYNLIB_MODES		(SIZEOF_ARRAY(dynlib_modes))
+#define DYNLIB_SYM_COUNTS	(SIZEOF_ARRAY(dynlib_sym_counts))
+
+static int stress_set_dynlib_bench(const char *opt)
+{
+	return stress_set_setting_true("dynlib-bench", opt);
+}
+
+static inline double stress_dynlib_us(const stress_latency_t *lat, const double percentile)
+{
+	return (double)stress_latency_percentile(lat, percentile) / 1000.0;
+}
+
+/*
+ *  stress_dynlib_bench()
+ *	measure dlopen/dlsym/dlclose batch latency against the number
+ *	of libraries opened for lazy and immediate binding, plus dlsym
+ *	latency against the number of symbols looked up. Only libraries
+ *	not already mapped into stress-ng are used so each dlopen has to
+ *	map and relocate the library and each dlclose unmaps it again.
+ */
+static int stress_dynlib_bench(const stress_args_t *args)
+{
+	const size_t n = SIZEOF_ARRAY(libnames);
+	const stress_lib_info_t *cold[n];
+	size_t lib_counts[n + 1];
+	void *handles[n];
+	stress_dynlib_lat_t *lat = NULL, *res = NULL;
+	stress_latency_t *sym_lat = NULL, *sym_res = NULL;
+	size_t i, j, n_cold = 0, n_counts = 0, lat_size, sym_size;
+	void *libm = NULL;
+	bool done = false;
+	int rc = EXIT_SUCCESS;
+
+	/* only use libraries that load and are not already mapped in */
+	for (i = 0; i < n; i++) {
+		void *handle;
+
+#if defined(RTLD_NOLOAD)
+		handle = dlopen(libnames[i].library, RTLD_LAZY | RTLD_NOLOAD);
+		if (handle) {
+			(void)dlclose(handle);
+			continue;
+		}
+#endif
+		handle = dlopen(libnames[i].library, RTLD_LAZY);
+		(void)dlerror();
+		if (!handle)
+			continue;
+		(void)dlclose(handle);
+		cold[n_cold++] = &libnames[i];
+	}
+	for (i = 1; i < n_cold; i <<= 1)
+		lib_counts[n_counts++] = i;
+	if (n_cold > 0)
+		lib_counts[n_counts++] = n_cold;
+
+#if defined(LIBM_SO)
+	libm = dlopen(LIBM_SO, RTLD_NOW);
+	(void)dlerror();
+#endif
+	if ((n_counts == 0) && !libm) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no loadable libraries found, skipping stressor\n",
+				args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	lat_size = DYNLIB_MODES * (n_counts + 1) * sizeof(*lat);
+	sym_size = DYNLIB_SYM_COUNTS * sizeof(*sym_lat);
+	lat = calloc(1, lat_size);
+	res = calloc(1, lat_size);
+	sym_lat = calloc(1, sym_size);
+	sym_res = calloc(1, sym_size);
+	if (!lat || !res || !sym_lat || !sym_res) {
+		pr_inf_skip("%s: cannot allocate latency histograms, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < DYNLIB_MODES; i++) {
+			for (j = 0; j < n_counts; j++) {
+				stress_dynlib_lat_t *l = &lat[(i * n_counts) + j];
+				const size_t count = lib_counts[j];
+				const double t_end = stress_time_now() + DYNLIB_BENCH_DURATION;
+				int s;
+
+				stress_latency_reset(&l->dlopen_lat);
+				stress_latency_reset(&l->dlsym_lat);
+				stress_latency_reset(&l->dlclose_lat);
+
+				for (s = 0; s < DYNLIB_BENCH_SAMPLES; s++) {
+					uint64_t t1, t2, t3, t4;
+					size_t k;
+
+					if (!keep_stressing(args))
+						goto finish;
+					t1 = stress_latency_now();
+					for (k = 0; k < count; k++)
+						handles[k] = dlopen(cold[k]->library, dynlib_modes[i]);
+					t2 = stress_latency_now();
+					for (k = 0; k < count; k++) {
+						if (handles[k])
+							(void)dlsym(handles[k], cold[k]->symbol);
+					}
+					t3 = stress_latency_now();
+					for (k = 0; k < count; k++) {
+						if (handles[k])
+							(void)dlclose(handles[k]);
+					}
+					t4 = stress_latency_now();
+					(void)dlerror();
+
+					stress_latency_record(&l->dlopen_lat, t2 - t1);
+					stress_latency_record(&l->dlsym_lat, t3 - t2);
+					stress_latency_record(&l->dlclose_lat, t4 - t3);
+					if (stress_time_now() > t_end)
+						break;
+				}
+			}
+		}
+		for (i = 0; libm && (i < DYNLIB_SYM_COUNTS); i++) {
+			stress_latency_t *l = &sym_lat[i];
+			const double t_end = stress_time_now() + DYNLIB_BENCH_DURATION;
+			int s;
+
+			stress_latency_reset(l);
+			for (s = 0; s < DYNLIB_BENCH_SAMPLES; s++) {
+				uint64_t t1, t2;
+				size_t k;
+
+				if (!keep_stressing(args))
+					goto finish;
+				t1 = stress_latency_now();
+				for (k = 0; k < dynlib_sym_counts[i]; k++)
+					(void)dlsym(libm, dynlib_libm_symbols[k]);
+				t2 = stress_latency_now();
+				stress_latency_record(l, t2 - t1);
+				if (stress_time_now() > t_end)
+					break;
+			}
+		}
+		(void)memcpy(res, lat, lat_size);
+		(void)memcpy(sym_res, sym_lat, sym_size);
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0) && (n_counts > 0)) {
+		pr_inf("%s: batch latency in us for %zu libraries not already loaded\n",
+			args->name, n_cold);
+		pr_inf("%s: %-4s %4s %9s %9s %9s %9s %9s %9s\n", args->name,
+			"bind", "libs", "open p50", "open p99", "sym p50",
+			"sym p99", "close p50", "close p99");
+		for (i = 0; i < DYNLIB_MODES; i++) {
+			for (j = 0; j < n_counts; j++) {
+				const stress_dynlib_lat_t *l = &res[(i * n_counts) + j];
+
+				pr_inf("%s: %-4s %4zu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+					args->name, j ? "" : (dynlib_modes[i] == RTLD_LAZY ? "lazy" : "now"),
+					lib_counts[j],
+					stress_dynlib_us(&l->dlopen_lat, 50.0),
+					stress_dynlib_us(&l->dlopen_lat, 99.0),
+					stress_dynlib_us(&l->dlsym_lat, 50.0),
+					stress_dynlib_us(&l->dlsym_lat, 99.0),
+					stress_dynlib_us(&l->dlclose_lat, 50.0),
+					stress_dynlib_us(&l->dlclose_lat, 99.0));
+			}
+		}
+	}
+	if (done && (args->instance == 0) && libm) {
+		pr_inf("%s: dlsym latency in ns for N symbols in libm\n", args->name);
+		pr_inf("%s: %7s %9s %9s %12s\n", args->name,
+			"symbols", "p50 ns", "p99 ns", "ns/symbol");
+		for (i = 0; i < DYNLIB_SYM_COUNTS; i++) {
+			const stress_latency_t *l = &sym_res[i];
+
+			pr_inf("%s: %7zu %9" PRIu64 " %9" PRIu64 " %12.1f\n", args->name,
+				dynlib_sym_counts[i],
+				stress_latency_percentile(l, 50.0),
+				stress_latency_percentile(l, 99.0),
+				stress_latency_mean(l) / (double)dynlib_sym_counts[i]);
+		}
+	}
+	if (done && (n_counts > 0)) {
+		const stress_dynlib_lat_t *lazy = &res[n_counts - 1];
+		const stress_dynlib_lat_t *now = &res[n_counts + n_counts - 1];
+
+		stress_misc_stats_set(args->misc_stats, 0, "lazy dlopen all p50 us",
+			stress_dynlib_us(&lazy->dlopen_lat, 50.0));
+		stress_misc_stats_set(args->misc_stats, 1, "lazy dlopen all p99 us",
+			stress_dynlib_us(&lazy->dlopen_lat, 99.0));
+		stress_misc_stats_set(args->misc_stats, 2, "now dlopen all p50 us",
+			stress_dynlib_us(&now->dlopen_lat, 50.0));
+		stress_misc_stats_set(args->misc_stats, 3, "now dlopen all p99 us",
+			stress_dynlib_us(&now->dlopen_lat, 99.0));
+		stress_misc_stats_set(args->misc_stats, 4, "dlclose all p50 us",
+			stress_dynlib_us(&now->dlclose_lat, 50.0));
+	}
+
+tidy:
+	if (libm)
+		(void)dlclose(libm);
+	free(sym_res);
+	free(sym_lat);
+	free(res);
+	free(lat);
+
+	return rc;
+}
+
 /*
  *  stress_segvhandler()
  *      SEGV handler
@@ -117,6 +372,11 @@ static int stress_dynlib(const stress_args_t *args)
 {
 	const size_t n = SIZEOF_ARRAY(libnames);
 	void *handles[n];
+	bool dynlib_bench = false;
+
+	(void)stress_get_setting("dynlib-bench", &dynlib_bench);
+	if (dynlib_bench)
+		return stress_dynlib_bench(args);
 
 	(void)memset(handles, 0, sizeof(handles));
 
@@ -175,15 +435,34 @@ tidy:
 
 	return EXIT_SUCCESS;
 }
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_dynlib_bench,	stress_set_dynlib_bench },
+	{ 0,			NULL }
+};
+
 stressor_info_t stress_dynlib_info = {
 	.stressor = stress_dynlib,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
+
+static int stress_set_dynlib_bench(const char *opt)
+{
+	return stress_set_setting_true("dynlib-bench", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_dynlib_bench,	stress_set_dynlib_bench },
+	{ 0,			NULL }
+};
+
 stressor_info_t stress_dynlib_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
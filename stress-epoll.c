@@ -38,12 +38,35 @@
 #define MAX_EPOLL_SOCKETS	(100000)
 #define DEFAULT_EPOLL_SOCKETS	(4096)
 
+#define MIN_EPOLL_THREADS	(1)
+#define MAX_EPOLL_THREADS	(64)
+#define DEFAULT_EPOLL_THREADS	(4)
+#define MIN_EPOLL_CLIENTS	(1)
+#define MAX_EPOLL_CLIENTS	(4096)
+#define DEFAULT_EPOLL_CLIENTS	(64)
+
+/* --epoll-mt server modes */
+#define EPOLL_MT_EXCLUSIVE	(0)	/* shared listener, EPOLLEXCLUSIVE */
+#define EPOLL_MT_REUSEPORT	(1)	/* SO_REUSEPORT listener per thread */
+
+#define EPOLL_MT_MSG_SIZE	(64)	/* size of each echoed message */
+#define EPOLL_MT_MSGS		(8)	/* messages per client connection */
+#define EPOLL_MT_CLIENT_PROCS	(8)	/* maximum client processes */
+
+static const char * const epoll_mt_modes[] = {
+	"exclusive", "reuseport"
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"epoll N",	  	"start N workers doing epoll handled socket activity" },
 	{ NULL,	"epoll-ops N",	  	"stop after N epoll bogo operations" },
 	{ NULL,	"epoll-port P",	  	"use socket ports P upwards" },
+	{ NULL,	"epoll-clients N",	"number of concurrent --epoll-mt client connections" },
 	{ NULL,	"epoll-domain D", 	"specify socket domain, default is unix" },
+	{ NULL,	"epoll-mt M",		"multi-threaded server using exclusive or reuseport" },
+	{ NULL,	"epoll-placement P",	"pin client and server CPUs [same-cpu|smt|llc|socket|cross-socket]" },
 	{ NULL, "epoll-sockets N",	"specify maximum number of open sockets" },
+	{ NULL,	"epoll-threads N",	"number of --epoll-mt server threads" },
 	{ NULL,	NULL,		  NULL }
 };
 
@@ -122,10 +145,76 @@ static int stress_set_epoll_sockets(const char *opt)
         return stress_set_setting("epoll-sockets", TYPE_ID_INT, &epoll_sockets);
 }
 
+/*
+ *  stress_set_epoll_mt()
+ *	set the multi-threaded server mode
+ */
+static int stress_set_epoll_mt(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(epoll_mt_modes); i++) {
+		if (!strcmp(opt, epoll_mt_modes[i]))
+			return stress_set_setting("epoll-mt", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "invalid epoll-mt '%s', allowed modes are:", opt);
+	for (i = 0; i < SIZEOF_ARRAY(epoll_mt_modes); i++)
+		(void)fprintf(stderr, " %s", epoll_mt_modes[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+/*
+ *  stress_set_epoll_threads()
+ *	set the number of --epoll-mt server threads
+ */
+static int stress_set_epoll_threads(const char *opt)
+{
+	uint32_t epoll_threads;
+
+	epoll_threads = stress_get_uint32(opt);
+	stress_check_range("epoll-threads", (uint64_t)epoll_threads,
+		MIN_EPOLL_THREADS, MAX_EPOLL_THREADS);
+	return stress_set_setting("epoll-threads", TYPE_ID_UINT32, &epoll_threads);
+}
+
+/*
+ *  stress_set_epoll_clients()
+ *	set the number of concurrent --epoll-mt client connections
+ */
+static int stress_set_epoll_clients(const char *opt)
+{
+	uint32_t epoll_clients;
+
+	epoll_clients = stress_get_uint32(opt);
+	stress_check_range("epoll-clients", (uint64_t)epoll_clients,
+		MIN_EPOLL_CLIENTS, MAX_EPOLL_CLIENTS);
+	return stress_set_setting("epoll-clients", TYPE_ID_UINT32, &epoll_clients);
+}
+
+/*
+ *  stress_set_epoll_placement()
+ *	set the client/server CPU placement
+ */
+static int stress_set_epoll_placement(const char *name)
+{
+	int ret, epoll_placement;
+
+	ret = stress_set_net_placement("epoll-placement", name, &epoll_placement);
+	stress_set_setting("epoll-placement", TYPE_ID_INT, &epoll_placement);
+
+	return ret;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_epoll_clients,	stress_set_epoll_clients },
 	{ OPT_epoll_domain,	stress_set_epoll_domain },
+	{ OPT_epoll_mt,		stress_set_epoll_mt },
+	{ OPT_epoll_placement,	stress_set_epoll_placement },
 	{ OPT_epoll_port,	stress_set_epoll_port },
 	{ OPT_epoll_sockets,	stress_set_epoll_sockets },
+	{ OPT_epoll_threads,	stress_set_epoll_threads },
 	{ 0,			NULL }
 };
 
@@ -994,6 +1083,647 @@ die:
 	_exit(rc);
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+
+/* Per server thread state of the --epoll-mt mode */
+typedef struct {
+	int sfd;			/* listening socket */
+	int efd;			/* the thread's epoll fd */
+	uint64_t accepts;		/* connections accepted */
+	uint64_t bytes;			/* message bytes echoed */
+	uint64_t wakeups;		/* epoll_wait calls returning events */
+	uint64_t empty;			/* listener wakeups with nothing to accept */
+	int err;			/* errno of a failure, 0 if OK */
+	int ret;			/* pthread_create return */
+	pthread_t pthread;
+} stress_epoll_mt_thread_t;
+
+/* Per connection state of an --epoll-mt client */
+typedef struct {
+	int fd;				/* socket, -1 if not connected */
+	bool connected;			/* true once connect completed */
+	int msgs;			/* messages echoed on this connection */
+	size_t got;			/* bytes of the current reply received */
+} stress_epoll_mt_conn_t;
+
+static volatile bool epoll_mt_stop;
+
+/*
+ *  stress_epoll_mt_create()
+ *	create an epoll fd
+ */
+static int stress_epoll_mt_create(void)
+{
+#if defined(HAVE_EPOLL_CREATE1)
+	return epoll_create1(0);
+#else
+	return epoll_create(1);
+#endif
+}
+
+/*
+ *  stress_epoll_mt_echo()
+ *	echo back all pending data on fd, close it on EOF or error
+ */
+static void stress_epoll_mt_echo(stress_epoll_mt_thread_t *thread, const int fd)
+{
+	char buf[EPOLL_MT_MSG_SIZE * EPOLL_MT_MSGS];
+
+	for (;;) {
+		const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+
+		if (n > 0) {
+			VOID_RET(ssize_t, send(fd, buf, (size_t)n, 0));
+			thread->bytes += (uint64_t)n;
+			continue;
+		}
+		if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+			return;
+		/* EOF or reset, closing also removes fd from the epoll set */
+		(void)close(fd);
+		return;
+	}
+}
+
+/*
+ *  stress_epoll_mt_accept()
+ *	accept all pending connections on the listener into the
+ *	thread's own epoll set
+ */
+static int stress_epoll_mt_accept(stress_epoll_mt_thread_t *thread)
+{
+	uint64_t accepted = 0;
+
+	for (;;) {
+		const int fd = accept(thread->sfd, NULL, NULL);
+
+		if (fd < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+			    (errno == EINTR) || (errno == ECONNABORTED) ||
+			    (errno == EMFILE) || (errno == ENFILE))
+				break;
+			thread->err = errno;
+			return -1;
+		}
+		if ((epoll_set_fd_nonblock(fd) < 0) ||
+		    (epoll_ctl_add(thread->efd, fd, EPOLLIN) < 0)) {
+			(void)close(fd);
+			continue;
+		}
+		accepted++;
+	}
+	/* another thread got there first */
+	if (!accepted)
+		thread->empty++;
+	thread->accepts += accepted;
+
+	return 0;
+}
+
+/*
+ *  stress_epoll_mt_server()
+ *	one epoll event loop, accepting on the listener and
+ *	echoing messages on the connections it accepted
+ */
+static void *stress_epoll_mt_server(void *arg)
+{
+	stress_epoll_mt_thread_t *thread = (stress_epoll_mt_thread_t *)arg;
+	struct epoll_event events[64];
+	sigset_t set;
+
+	/* Let the controlling thread handle the signals */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!epoll_mt_stop && keep_stressing_flag()) {
+		int i, n;
+
+		n = epoll_wait(thread->efd, events, (int)SIZEOF_ARRAY(events), 100);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			thread->err = errno;
+			break;
+		}
+		if (n > 0)
+			thread->wakeups++;
+		for (i = 0; i < n; i++) {
+			const int fd = events[i].data.fd;
+
+			if (fd == thread->sfd) {
+				if (stress_epoll_mt_accept(thread) < 0)
+					return NULL;
+			} else if (events[i].events & EPOLLIN) {
+				stress_epoll_mt_echo(thread, fd);
+			} else {
+				(void)close(fd);
+			}
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  stress_epoll_mt_client_close()
+ *	close a client connection, with a zero linger time for
+ *	ipv4 and ipv6 so the client does not hold TIME_WAIT state
+ *	and run out of ephemeral ports
+ */
+static void stress_epoll_mt_client_close(stress_epoll_mt_conn_t *conn, const int epoll_domain)
+{
+#if defined(SO_LINGER)
+	if ((epoll_domain == AF_INET) || (epoll_domain == AF_INET6)) {
+		struct linger lin;
+
+		lin.l_onoff = 1;
+		lin.l_linger = 0;
+		(void)setsockopt(conn->fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+	}
+#else
+	(void)epoll_domain;
+#endif
+	(void)close(conn->fd);
+	conn->fd = -1;
+}
+
+/*
+ *  stress_epoll_mt_client_ctl()
+ *	add or modify a client connection in the epoll set
+ */
+static int stress_epoll_mt_client_ctl(
+	const int efd,
+	const int op,
+	const stress_epoll_mt_conn_t *conn,
+	const uint32_t idx,
+	const uint32_t events)
+{
+	struct epoll_event event;
+
+	(void)memset(&event, 0, sizeof(event));
+	event.data.u32 = idx;
+	event.events = events;
+
+	return epoll_ctl(efd, op, conn->fd, &event);
+}
+
+/*
+ *  stress_epoll_mt_client_send()
+ *	send the next message and wait for its echo
+ */
+static void stress_epoll_mt_client_send(
+	stress_epoll_mt_conn_t *conn,
+	const char *buf,
+	const int epoll_domain)
+{
+	if (send(conn->fd, buf, EPOLL_MT_MSG_SIZE, 0) != EPOLL_MT_MSG_SIZE)
+		stress_epoll_mt_client_close(conn, epoll_domain);
+	conn->got = 0;
+}
+
+/*
+ *  stress_epoll_mt_client_connect()
+ *	start a non-blocking connect, a failed connect is
+ *	retried on the next pass of the client loop
+ */
+static void stress_epoll_mt_client_connect(
+	const int efd,
+	stress_epoll_mt_conn_t *conn,
+	const uint32_t idx,
+	const struct sockaddr *addr,
+	const socklen_t addr_len,
+	const int epoll_domain,
+	const char *buf)
+{
+	conn->connected = false;
+	conn->msgs = 0;
+	conn->got = 0;
+	conn->fd = socket(epoll_domain, SOCK_STREAM, 0);
+	if (conn->fd < 0)
+		return;
+	if (epoll_set_fd_nonblock(conn->fd) < 0)
+		goto err;
+
+	if (connect(conn->fd, addr, addr_len) == 0) {
+		conn->connected = true;
+		if (stress_epoll_mt_client_ctl(efd, EPOLL_CTL_ADD, conn, idx, EPOLLIN) < 0)
+			goto err;
+		stress_epoll_mt_client_send(conn, buf, epoll_domain);
+		return;
+	}
+	if ((errno == EINPROGRESS) &&
+	    (stress_epoll_mt_client_ctl(efd, EPOLL_CTL_ADD, conn, idx, EPOLLOUT) == 0))
+		return;
+err:
+	/* ECONNREFUSED, EAGAIN (unix backlog full) etc */
+	stress_epoll_mt_client_close(conn, epoll_domain);
+}
+
+/*
+ *  stress_epoll_mt_client()
+ *	keep n_conns connections busy, each connection sends
+ *	EPOLL_MT_MSGS messages one at a time waiting for each
+ *	echo, then closes and reconnects
+ */
+static void NORETURN stress_epoll_mt_client(
+	const struct sockaddr *addr,
+	const socklen_t addr_len,
+	const int epoll_domain,
+	const uint32_t n_conns)
+{
+	stress_epoll_mt_conn_t *conns;
+	struct epoll_event events[64];
+	char buf[EPOLL_MT_MSG_SIZE];
+	uint32_t i;
+	int efd;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	efd = stress_epoll_mt_create();
+	if (efd < 0)
+		_exit(EXIT_FAILURE);
+	conns = calloc(n_conns, sizeof(*conns));
+	if (!conns) {
+		(void)close(efd);
+		_exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < n_conns; i++)
+		conns[i].fd = -1;
+	(void)memset(buf, 'E', sizeof(buf));
+
+	while (keep_stressing_flag()) {
+		int k, n;
+
+		for (i = 0; i < n_conns; i++) {
+			if (conns[i].fd < 0)
+				stress_epoll_mt_client_connect(efd, &conns[i], i,
+					addr, addr_len, epoll_domain, buf);
+		}
+
+		n = epoll_wait(efd, events, (int)SIZEOF_ARRAY(events), 10);
+		for (k = 0; k < n; k++) {
+			stress_epoll_mt_conn_t *conn = &conns[events[k].data.u32];
+			ssize_t ret;
+
+			if (conn->fd < 0)
+				continue;
+			if (events[k].events & (EPOLLERR | EPOLLHUP)) {
+				stress_epoll_mt_client_close(conn, epoll_domain);
+				continue;
+			}
+			if (!conn->connected) {
+				int err = 0;
+				socklen_t len = sizeof(err);
+
+				/* non-blocking connect has completed */
+				if ((getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) || err ||
+				    (stress_epoll_mt_client_ctl(efd, EPOLL_CTL_MOD, conn,
+						events[k].data.u32, EPOLLIN) < 0)) {
+					stress_epoll_mt_client_close(conn, epoll_domain);
+					continue;
+				}
+				conn->connected = true;
+				stress_epoll_mt_client_send(conn, buf, epoll_domain);
+				continue;
+			}
+
+			ret = recv(conn->fd, buf, EPOLL_MT_MSG_SIZE - conn->got, 0);
+			if (ret <= 0) {
+				if ((ret < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+					continue;
+				stress_epoll_mt_client_close(conn, epoll_domain);
+				continue;
+			}
+			conn->got += (size_t)ret;
+			if (conn->got < EPOLL_MT_MSG_SIZE)
+				continue;
+			conn->msgs++;
+			if (conn->msgs >= EPOLL_MT_MSGS)
+				stress_epoll_mt_client_close(conn, epoll_domain);
+			else
+				stress_epoll_mt_client_send(conn, buf, epoll_domain);
+		}
+	}
+	for (i = 0; i < n_conns; i++) {
+		if (conns[i].fd >= 0)
+			(void)close(conns[i].fd);
+	}
+	free(conns);
+	(void)close(efd);
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_epoll_mt_listen()
+ *	create a non-blocking listening socket
+ */
+static int stress_epoll_mt_listen(
+	const stress_args_t *args,
+	const struct sockaddr *addr,
+	const socklen_t addr_len,
+	const int epoll_domain,
+	const size_t epoll_mt)
+{
+	int sfd, one = 1;
+
+	if ((sfd = socket(epoll_domain, SOCK_STREAM, 0)) < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	if (setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) {
+		pr_fail("%s: setsockopt SO_REUSEADDR failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+#if defined(SO_REUSEPORT)
+	if ((epoll_mt == EPOLL_MT_REUSEPORT) &&
+	    (setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)) {
+		pr_fail("%s: setsockopt SO_REUSEPORT failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+#else
+	(void)epoll_mt;
+#endif
+	if (bind(sfd, addr, addr_len) < 0) {
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	if (epoll_set_fd_nonblock(sfd) < 0) {
+		pr_fail("%s: setting socket to non-blocking failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	if (listen(sfd, SOMAXCONN) < 0) {
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	return sfd;
+err:
+	(void)close(sfd);
+	return -1;
+}
+
+/*
+ *  stress_epoll_mt_report()
+ *	report accepts/s, messages/s and the per thread load
+ *	imbalance as the busiest thread over the mean
+ */
+static void stress_epoll_mt_report(
+	const stress_args_t *args,
+	const stress_epoll_mt_thread_t *threads,
+	const uint32_t n_threads,
+	const size_t epoll_mt,
+	const double duration)
+{
+	uint64_t accepts = 0, msgs = 0, empty = 0;
+	uint64_t max_accepts = 0, max_msgs = 0;
+	uint32_t i;
+
+	if (duration <= 0.0)
+		return;
+
+	if (args->instance == 0) {
+		pr_inf("%s: %s mode, %" PRIu32 " server threads\n",
+			args->name, epoll_mt_modes[epoll_mt], n_threads);
+		pr_inf("%s: thread    accepts/s     msgs/s  wakeups/s  empty/s\n",
+			args->name);
+	}
+	for (i = 0; i < n_threads; i++) {
+		const stress_epoll_mt_thread_t *thread = &threads[i];
+		const uint64_t thread_msgs = thread->bytes / EPOLL_MT_MSG_SIZE;
+
+		accepts += thread->accepts;
+		msgs += thread_msgs;
+		empty += thread->empty;
+		if (max_accepts < thread->accepts)
+			max_accepts = thread->accepts;
+		if (max_msgs < thread_msgs)
+			max_msgs = thread_msgs;
+		if (args->instance == 0) {
+			pr_inf("%s: %6" PRIu32 " %12.1f %10.1f %10.1f %8.1f\n",
+				args->name, i,
+				(double)thread->accepts / duration,
+				(double)thread_msgs / duration,
+				(double)thread->wakeups / duration,
+				(double)thread->empty / duration);
+		}
+	}
+
+	stress_misc_stats_set(args->misc_stats, 0, "accepts per sec",
+		(double)accepts / duration);
+	stress_misc_stats_set(args->misc_stats, 1, "messages per sec",
+		(double)msgs / duration);
+	stress_misc_stats_set(args->misc_stats, 2, "accept imbalance (max/mean)",
+		accepts ? ((double)max_accepts * n_threads) / (double)accepts : 0.0);
+	stress_misc_stats_set(args->misc_stats, 3, "message imbalance (max/mean)",
+		msgs ? ((double)max_msgs * n_threads) / (double)msgs : 0.0);
+	stress_misc_stats_set(args->misc_stats, 4, "empty accept wakeups per sec",
+		(double)empty / duration);
+}
+
+/*
+ *  stress_epoll_mt()
+ *	multi-threaded server, one epoll loop per thread either
+ *	sharing a listener added with EPOLLEXCLUSIVE or each with
+ *	its own SO_REUSEPORT listener, driven by forked clients
+ *	keeping epoll_clients connections busy
+ */
+static int stress_epoll_mt(
+	const stress_args_t *args,
+	const pid_t mypid,
+	const int epoll_port,
+	const int epoll_domain,
+	const size_t epoll_mt,
+	const int client_cpu)
+{
+	uint32_t epoll_threads = DEFAULT_EPOLL_THREADS;
+	uint32_t epoll_clients = DEFAULT_EPOLL_CLIENTS;
+	pid_t pids[EPOLL_MT_CLIENT_PROCS];
+	stress_epoll_mt_thread_t *threads;
+	struct sockaddr_storage addr;
+	struct sockaddr *paddr;
+	socklen_t addr_len = 0;
+	const int port = epoll_port + (max_servers * (int)args->instance);
+	uint32_t i, n_procs;
+	uint64_t counted = 0;
+	double t_start, duration;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("epoll-threads", &epoll_threads);
+	(void)stress_get_setting("epoll-clients", &epoll_clients);
+
+#if !defined(EPOLLEXCLUSIVE)
+	if (epoll_mt == EPOLL_MT_EXCLUSIVE) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: EPOLLEXCLUSIVE is not available, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+#if !defined(SO_REUSEPORT)
+	if (epoll_mt == EPOLL_MT_REUSEPORT) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: SO_REUSEPORT is not available, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+	if ((epoll_mt == EPOLL_MT_REUSEPORT) &&
+	    (epoll_domain != AF_INET) && (epoll_domain != AF_INET6)) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: --epoll-mt reuseport requires the ipv4 "
+				"or ipv6 domain, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	if (stress_set_sockaddr(args->name, args->instance, mypid,
+		epoll_domain, port, &paddr, &addr_len, NET_ADDR_ANY) < 0)
+		return EXIT_FAILURE;
+	(void)memcpy(&addr, paddr, (size_t)addr_len);
+
+	threads = calloc(epoll_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " thread states, "
+			"skipping stressor\n", args->name, epoll_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < epoll_threads; i++) {
+		threads[i].sfd = -1;
+		threads[i].efd = -1;
+		threads[i].ret = -1;
+	}
+
+	/* the listeners and epoll sets are ready before any client connects */
+	for (i = 0; i < epoll_threads; i++) {
+		stress_epoll_mt_thread_t *thread = &threads[i];
+		uint32_t events = EPOLLIN;
+
+		if ((epoll_mt == EPOLL_MT_REUSEPORT) || (i == 0)) {
+			thread->sfd = stress_epoll_mt_listen(args,
+				(struct sockaddr *)&addr, addr_len, epoll_domain, epoll_mt);
+			if (thread->sfd < 0) {
+				rc = EXIT_FAILURE;
+				goto close_fds;
+			}
+		} else {
+			thread->sfd = threads[0].sfd;
+		}
+#if defined(EPOLLEXCLUSIVE)
+		if (epoll_mt == EPOLL_MT_EXCLUSIVE)
+			events |= EPOLLEXCLUSIVE;
+#endif
+		thread->efd = stress_epoll_mt_create();
+		if (thread->efd < 0) {
+			pr_fail("%s: epoll_create failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		if (epoll_ctl_add(thread->efd, thread->sfd, events) < 0) {
+			pr_fail("%s: epoll_ctl_add failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+	}
+
+	/* fork the clients before any threads exist */
+	(void)memset(pids, 0, sizeof(pids));
+	n_procs = STRESS_MINIMUM(epoll_threads, EPOLL_MT_CLIENT_PROCS);
+	n_procs = STRESS_MINIMUM(n_procs, epoll_clients);
+	for (i = 0; i < n_procs; i++) {
+		const uint32_t n_conns = (epoll_clients / n_procs) +
+			((i < (epoll_clients % n_procs)) ? 1 : 0);
+again:
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			if (stress_redo_fork(errno))
+				goto again;
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto reap;
+		} else if (pids[i] == 0) {
+			uint32_t j;
+
+			stress_net_placement_pin(client_cpu);
+			for (j = 0; j < epoll_threads; j++) {
+				if (threads[j].efd >= 0)
+					(void)close(threads[j].efd);
+				if ((threads[j].sfd >= 0) &&
+				    ((j == 0) || (epoll_mt == EPOLL_MT_REUSEPORT)))
+					(void)close(threads[j].sfd);
+			}
+			stress_epoll_mt_client((struct sockaddr *)&addr,
+				addr_len, epoll_domain, n_conns);
+		}
+	}
+
+	epoll_mt_stop = false;
+	for (i = 0; i < epoll_threads; i++) {
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+			stress_epoll_mt_server, (void *)&threads[i]);
+	}
+
+	t_start = stress_time_now();
+	while (keep_stressing(args)) {
+		uint64_t bytes = 0;
+
+		(void)shim_usleep(100000);
+		for (i = 0; i < epoll_threads; i++)
+			bytes += threads[i].bytes;
+		add_counter(args, (bytes / EPOLL_MT_MSG_SIZE) - counted);
+		counted = bytes / EPOLL_MT_MSG_SIZE;
+	}
+	duration = stress_time_now() - t_start;
+	epoll_mt_stop = true;
+
+	for (i = 0; i < epoll_threads; i++) {
+		if (threads[i].ret)
+			continue;
+		(void)pthread_join(threads[i].pthread, NULL);
+		if (threads[i].err && (rc == EXIT_SUCCESS)) {
+			pr_fail("%s: server thread %" PRIu32 " failed, errno=%d (%s)\n",
+				args->name, i, threads[i].err, strerror(threads[i].err));
+			rc = EXIT_FAILURE;
+		}
+	}
+	stress_epoll_mt_report(args, threads, epoll_threads, epoll_mt, duration);
+reap:
+	for (i = 0; i < n_procs; i++) {
+		int status;
+
+		if (pids[i] > 0) {
+			(void)kill(pids[i], SIGKILL);
+			(void)shim_waitpid(pids[i], &status, 0);
+		}
+	}
+close_fds:
+	for (i = 0; i < epoll_threads; i++) {
+		if (threads[i].efd >= 0)
+			(void)close(threads[i].efd);
+		if ((threads[i].sfd >= 0) &&
+		    ((i == 0) || (epoll_mt == EPOLL_MT_REUSEPORT)))
+			(void)close(threads[i].sfd);
+	}
+#if defined(AF_UNIX) &&		\
+    defined(HAVE_SOCKADDR_UN)
+	if (epoll_domain == AF_UNIX) {
+		struct sockaddr_un *addr_un = (struct sockaddr_un *)&addr;
+
+		(void)shim_unlink(addr_un->sun_path);
+	}
+#endif
+	free(threads);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_epoll
  *	stress by heavy socket I/O
@@ -1005,14 +1735,42 @@ static int stress_epoll(const stress_args_t *args)
 	int epoll_domain = AF_UNIX;
 	int epoll_port = DEFAULT_EPOLL_PORT;
 	int epoll_sockets = DEFAULT_EPOLL_SOCKETS;
+	size_t epoll_mt = EPOLL_MT_EXCLUSIVE;
+	int epoll_placement = NET_PLACEMENT_NONE;
+	int server_cpu, client_cpu;
+	bool use_epoll_mt;
 
 	(void)stress_get_setting("epoll-domain", &epoll_domain);
 	(void)stress_get_setting("epoll-port", &epoll_port);
 	(void)stress_get_setting("epoll-sockets", &epoll_sockets);
+	use_epoll_mt = stress_get_setting("epoll-mt", &epoll_mt);
+	(void)stress_get_setting("epoll-placement", &epoll_placement);
 
 	if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0)
 		return EXIT_NO_RESOURCE;
 
+	/* there is no epoll interface option, irq placement will skip */
+	if (stress_net_placement_cpus(args, epoll_placement, NULL,
+				      &server_cpu, &client_cpu) < 0)
+		return EXIT_NO_RESOURCE;
+	/* servers inherit the server CPU, clients re-pin after fork */
+	stress_net_placement_pin(server_cpu);
+
+	if (use_epoll_mt) {
+#if defined(HAVE_LIB_PTHREAD)
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_epoll_mt(args, mypid, epoll_port, epoll_domain,
+			epoll_mt, client_cpu);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --epoll-mt requires pthread support, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	if (max_servers == 1) {
 		pr_dbg("%s: process [%" PRIdMAX "] using socket port %d\n",
 			args->name, (intmax_t)args->pid,
@@ -1050,6 +1808,7 @@ static int stress_epoll(const stress_args_t *args)
 		}
 	}
 
+	stress_net_placement_pin(client_cpu);
 	epoll_client(args, mypid, epoll_port, epoll_domain);
 reap:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
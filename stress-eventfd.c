@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_SYS_EVENTFD_H)
 #include <sys/eventfd.h>
@@ -183,7 +184,7 @@ exit_child:
 		const pid_t self = getpid();
 
 		do {
-			uint64_t val = 1;
+			uint64_t val = 1, t;
 			ssize_t ret;
 
 			/*
@@ -192,6 +193,7 @@ exit_child:
 			 */
 			(void)stress_read_fdinfo(self, stress_mwc1() ? fd1 : fd2);
 
+			t = stress_latency_now();
 			for (;;) {
 				if (!keep_stressing_flag())
 					goto exit_parent;
@@ -233,6 +235,7 @@ exit_child:
 				}
 				break;
 			}
+			stress_latency_record(args->latency, stress_latency_now() - t);
 			inc_counter(args);
 		} while (keep_stressing(args));
 exit_parent:
@@ -242,6 +245,7 @@ exit_parent:
 		(void)shim_waitpid(pid, &status, 0);
 		(void)close(fd1);
 		(void)close(fd2);
+		stress_latency_misc_stats(args, 0, "round trip");
 	}
 	return EXIT_SUCCESS;
 }
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_SPAWN_H)
 #include <spawn.h>
@@ -115,6 +116,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"exec-fork-method M",	"select exec fork method: clone, fork, spawn, vfork" },
 #endif
 	{ NULL,	"exec-no-pthread",	"do not use pthread_create" },
+	{ NULL,	"exec-startup",		"measure exec startup latency vs binary, env and argv size" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -183,11 +185,21 @@ static int stress_set_exec_no_pthread(const char *opt)
 	return stress_set_setting_true("exec-no-pthread", opt);
 }
 
+/*
+ *  stress_set_exec_startup()
+ *	set exec startup benchmark flag
+ */
+static int stress_set_exec_startup(const char *opt)
+{
+	return stress_set_setting_true("exec-startup", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_exec_max,		stress_set_exec_max },
 	{ OPT_exec_method,	stress_set_exec_method },
 	{ OPT_exec_fork_method,	stress_set_exec_fork_method },
 	{ OPT_exec_no_pthread,	stress_set_exec_no_pthread },
+	{ OPT_exec_startup,	stress_set_exec_startup },
 	{ 0,			NULL }
 };
 
@@ -600,6 +612,330 @@ do_exec:
 	return rc;
 }
 
+#define EXEC_STARTUP_SAMPLES	(200)
+#define EXEC_STARTUP_DURATION	(0.5)
+#define EXEC_STARTUP_STRLEN	(1024)
+#define EXEC_STARTUP_MAX_KB	(1024)
+
+/*
+ *  exec startup benchmark configuration, env and argv
+ *  padding sizes in 1K strings
+ */
+typedef struct {
+	size_t env_kb;
+	size_t argv_kb;
+} stress_exec_startup_cfg_t;
+
+typedef struct {
+	const char *name;		/* binary name in report */
+	char path[PATH_MAX];		/* binary to exec */
+	const char *arg1;		/* first argument, NULL for none */
+	bool available;
+} stress_exec_startup_bin_t;
+
+static const stress_exec_startup_cfg_t exec_startup_cfgs[] = {
+	{ 0,	0 },
+	{ 16,	0 },
+	{ 256,	0 },
+	{ 1024,	0 },
+	{ 0,	16 },
+	{ 0,	256 },
+	{ 0,	1024 },
+};
+
+#if (defined(__x86_64__) || defined(__aarch64__)) &&	\
+    defined(__BYTE_ORDER__) &&				\
+    (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define HAVE_EXEC_TINY_ELF
+
+static inline void stress_exec_put16(uint8_t *ptr, const uint16_t val)
+{
+	(void)memcpy(ptr, &val, sizeof(val));
+}
+
+static inline void stress_exec_put32(uint8_t *ptr, const uint32_t val)
+{
+	(void)memcpy(ptr, &val, sizeof(val));
+}
+
+static inline void stress_exec_put64(uint8_t *ptr, const uint64_t val)
+{
+	(void)memcpy(ptr, &val, sizeof(val));
+}
+
+/*
+ *  stress_exec_tiny_elf()
+ *	build a minimal statically linked ELF executable that just
+ *	calls exit_group(0), no libc, no dynamic loader, no sections
+ */
+static size_t stress_exec_tiny_elf(uint8_t *buf, const size_t len)
+{
+#if defined(__x86_64__)
+	/* mov $231, %eax; xor %edi, %edi; syscall */
+	static const uint8_t code[] = {
+		0xb8, 0xe7, 0x00, 0x00, 0x00, 0x31, 0xff, 0x0f, 0x05
+	};
+	const uint16_t machine = 62;	/* EM_X86_64 */
+#else
+	/* mov x0, #0; mov x8, #94; svc #0 */
+	static const uint8_t code[] = {
+		0x00, 0x00, 0x80, 0xd2, 0xc8, 0x0b, 0x80, 0xd2, 0x01, 0x00, 0x00, 0xd4
+	};
+	const uint16_t machine = 183;	/* EM_AARCH64 */
+#endif
+	const uint64_t vaddr = 0x400000;
+	const size_t ehdr_size = 64, phdr_size = 56;
+	const size_t size = ehdr_size + phdr_size + sizeof(code);
+
+	if (len < size)
+		return 0;
+	(void)memset(buf, 0, size);
+
+	/* ELF header */
+	buf[0] = 0x7f;
+	buf[1] = 'E';
+	buf[2] = 'L';
+	buf[3] = 'F';
+	buf[4] = 2;				/* ELFCLASS64 */
+	buf[5] = 1;				/* ELFDATA2LSB */
+	buf[6] = 1;				/* EV_CURRENT */
+	stress_exec_put16(buf + 16, 2);		/* ET_EXEC */
+	stress_exec_put16(buf + 18, machine);
+	stress_exec_put32(buf + 20, 1);		/* EV_CURRENT */
+	stress_exec_put64(buf + 24, vaddr + ehdr_size + phdr_size);
+	stress_exec_put64(buf + 32, ehdr_size);	/* e_phoff */
+	stress_exec_put16(buf + 52, (uint16_t)ehdr_size);
+	stress_exec_put16(buf + 54, (uint16_t)phdr_size);
+	stress_exec_put16(buf + 56, 1);		/* e_phnum */
+
+	/* single PT_LOAD R+X program header */
+	stress_exec_put32(buf + 64, 1);		/* PT_LOAD */
+	stress_exec_put32(buf + 68, 5);		/* PF_R | PF_X */
+	stress_exec_put64(buf + 80, vaddr);
+	stress_exec_put64(buf + 88, vaddr);
+	stress_exec_put64(buf + 96, size);
+	stress_exec_put64(buf + 104, size);
+	stress_exec_put64(buf + 112, 0x1000);
+
+	(void)memcpy(buf + ehdr_size + phdr_size, code, sizeof(code));
+	return size;
+}
+#endif
+
+/*
+ *  stress_exec_startup_time()
+ *	fork, exec and reap one child, return the round trip
+ *	time in ns or 0 if the exec failed
+ */
+static uint64_t stress_exec_startup_time(const char *path, char **argv, char **env)
+{
+	uint64_t t_start, t_end;
+	pid_t pid;
+	int status;
+
+	t_start = stress_latency_now();
+	pid = fork();
+	if (pid < 0)
+		return 0;
+	if (pid == 0) {
+		(void)execve(path, argv, env);
+		_exit(EXIT_FAILURE);
+	}
+	if (shim_waitpid(pid, &status, 0) < 0)
+		return 0;
+	t_end = stress_latency_now();
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+		return 0;
+	return t_end - t_start;
+}
+
+/*
+ *  stress_exec_startup()
+ *	measure fork+exec+exit latency of a minimal static binary,
+ *	a dynamically linked system binary and stress-ng itself
+ *	while sweeping the size of the environment and arguments
+ */
+static int stress_exec_startup(const stress_args_t *args)
+{
+	stress_exec_startup_bin_t bins[3];
+	const size_t n_bins = SIZEOF_ARRAY(bins);
+	const size_t n_cfgs = SIZEOF_ARRAY(exec_startup_cfgs);
+	const size_t n_ptrs = EXEC_STARTUP_MAX_KB + 3;
+	stress_latency_t *lat = NULL, *res = NULL;
+	char tiny_prog[PATH_MAX];
+	char **argv = NULL, **env = NULL, *str = NULL;
+	size_t i, j;
+	ssize_t len;
+	bool done = false;
+	int ret, rc = EXIT_SUCCESS;
+
+	(void)memset(bins, 0, sizeof(bins));
+	bins[0].name = "tiny static";
+	bins[1].name = "true";
+#if defined(BUILD_STATIC)
+	bins[2].name = "stress-ng static";
+#else
+	bins[2].name = "stress-ng dynamic";
+#endif
+	bins[2].arg1 = "--exec-exit";
+
+	len = shim_readlink("/proc/self/exe", bins[2].path, sizeof(bins[2].path) - 1);
+	if ((len > 0) && (len < (ssize_t)sizeof(bins[2].path))) {
+		bins[2].path[len] = '\0';
+		bins[2].available = true;
+	}
+	for (i = 0; i < 2; i++) {
+		static const char * const true_paths[] = { "/bin/true", "/usr/bin/true" };
+
+		if (access(true_paths[i], X_OK) == 0) {
+			(void)shim_strlcpy(bins[1].path, true_paths[i], sizeof(bins[1].path));
+			bins[1].available = true;
+			break;
+		}
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0)
+		return stress_exit_status(-ret);
+	(void)stress_temp_filename_args(args, tiny_prog, sizeof(tiny_prog), stress_mwc32());
+#if defined(HAVE_EXEC_TINY_ELF)
+	{
+		uint8_t buf[256];
+		const size_t size = stress_exec_tiny_elf(buf, sizeof(buf));
+		int fd;
+
+		fd = open(tiny_prog, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IXUSR);
+		if (fd >= 0) {
+			if ((size > 0) && (write(fd, buf, size) == (ssize_t)size)) {
+				(void)shim_strlcpy(bins[0].path, tiny_prog, sizeof(bins[0].path));
+				bins[0].available = true;
+			}
+			(void)close(fd);
+		}
+	}
+#endif
+
+	lat = calloc(n_bins * n_cfgs, sizeof(*lat));
+	res = calloc(n_bins * n_cfgs, sizeof(*res));
+	argv = calloc(n_ptrs, sizeof(*argv));
+	env = calloc(n_ptrs, sizeof(*env));
+	str = malloc(EXEC_STARTUP_STRLEN);
+	if (!lat || !res || !argv || !env || !str) {
+		pr_inf_skip("%s: cannot allocate exec startup buffers, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	(void)memset(str, 'X', EXEC_STARTUP_STRLEN - 1);
+	str[0] = 'E';
+	str[1] = '=';
+	str[EXEC_STARTUP_STRLEN - 1] = '\0';
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < n_bins; i++) {
+			const stress_exec_startup_bin_t *bin = &bins[i];
+
+			if (!bin->available)
+				continue;
+			for (j = 0; j < n_cfgs; j++) {
+				const stress_exec_startup_cfg_t *cfg = &exec_startup_cfgs[j];
+				stress_latency_t *l = &lat[(i * n_cfgs) + j];
+				size_t k, argc = 0;
+				double t_end;
+				int n;
+
+				argv[argc++] = (char *)bin->name;
+				if (bin->arg1)
+					argv[argc++] = (char *)bin->arg1;
+				for (k = 0; k < cfg->argv_kb; k++)
+					argv[argc++] = str;
+				argv[argc] = NULL;
+				for (k = 0; k < cfg->env_kb; k++)
+					env[k] = str;
+				env[k] = NULL;
+
+				stress_latency_reset(l);
+				t_end = stress_time_now() + EXEC_STARTUP_DURATION;
+				for (n = 0; n < EXEC_STARTUP_SAMPLES; n++) {
+					const uint64_t ns = stress_exec_startup_time(bin->path, argv, env);
+
+					if (!keep_stressing(args))
+						goto finish;
+					if (ns == 0)
+						break;
+					stress_latency_record(l, ns);
+					if (stress_time_now() > t_end)
+						break;
+				}
+			}
+		}
+		(void)memcpy(res, lat, n_bins * n_cfgs * sizeof(*res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: fork+exec+exit+wait latency, env and argv padded with 1K strings\n",
+			args->name);
+		pr_inf("%s: %-17s %7s %7s %10s %10s %10s\n", args->name,
+			"binary", "env KB", "argv KB", "p50 us", "p99 us", "mean us");
+		for (i = 0; i < n_bins; i++) {
+			if (!bins[i].available) {
+				pr_inf("%s: %-17s not available\n", args->name, bins[i].name);
+				continue;
+			}
+			for (j = 0; j < n_cfgs; j++) {
+				const stress_exec_startup_cfg_t *cfg = &exec_startup_cfgs[j];
+				const stress_latency_t *l = &res[(i * n_cfgs) + j];
+
+				if (l->count == 0) {
+					pr_inf("%s: %-17s %7zu %7zu %10s %10s %10s\n", args->name,
+						j ? "" : bins[i].name, cfg->env_kb, cfg->argv_kb,
+						"-", "-", "-");
+					continue;
+				}
+				pr_inf("%s: %-17s %7zu %7zu %10.1f %10.1f %10.1f\n", args->name,
+					j ? "" : bins[i].name, cfg->env_kb, cfg->argv_kb,
+					(double)stress_latency_percentile(l, 50.0) / 1000.0,
+					(double)stress_latency_percentile(l, 99.0) / 1000.0,
+					stress_latency_mean(l) / 1000.0);
+			}
+		}
+	}
+	if (done) {
+		static const char * const stat_names[][2] = {
+			{ "tiny static exec p50 us",	"tiny static exec p99 us" },
+			{ "true exec p50 us",		"true exec p99 us" },
+			{ "stress-ng exec p50 us",	"stress-ng exec p99 us" },
+		};
+
+		for (i = 0; i < n_bins; i++) {
+			const stress_latency_t *l = &res[i * n_cfgs];
+
+			stress_misc_stats_set(args->misc_stats, (int)(i * 2), stat_names[i][0],
+				(double)stress_latency_percentile(l, 50.0) / 1000.0);
+			stress_misc_stats_set(args->misc_stats, (int)(i * 2) + 1, stat_names[i][1],
+				(double)stress_latency_percentile(l, 99.0) / 1000.0);
+		}
+	}
+
+tidy:
+	free(str);
+	free(env);
+	free(argv);
+	free(res);
+	free(lat);
+	(void)shim_unlink(tiny_prog);
+	(void)stress_temp_dir_rm_args(args);
+
+	return rc;
+}
+
 /*
  *  stress_exec()
  *	stress by forking and exec'ing
@@ -619,9 +955,14 @@ static int stress_exec(const stress_args_t *args)
 	int exec_method = EXEC_METHOD_ALL;
 	int exec_fork_method = EXEC_FORK_METHOD_FORK;
 	bool exec_no_pthread = false;
+	bool exec_startup = false;
 	size_t arg_max, cache_max;
 	char *str;
 
+	(void)stress_get_setting("exec-startup", &exec_startup);
+	if (exec_startup)
+		return stress_exec_startup(args);
+
 	(void)stress_get_setting("exec-max", &exec_max);
 	(void)stress_get_setting("exec-method", &exec_method);
 	(void)stress_get_setting("exec-fork-method", &exec_fork_method);
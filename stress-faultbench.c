@@ -0,0 +1,655 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+
+#if defined(__NR_userfaultfd)
+#define HAVE_USERFAULTFD
+#endif
+
+#if defined(HAVE_LINUX_USERFAULTFD_H)
+#include <linux/userfaultfd.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#define MIN_FAULTBENCH_BYTES	(64 * KB)
+#define MAX_FAULTBENCH_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_FAULTBENCH_BYTES (16 * MB)
+
+#define MIN_FAULTBENCH_THREADS	(1)
+#define MAX_FAULTBENCH_THREADS	(256)
+
+static const stress_help_t help[] = {
+	{ NULL,	"faultbench N",		"start N workers measuring page fault throughput" },
+	{ NULL,	"faultbench-bytes N",	"size of the region each thread faults in per pass" },
+	{ NULL,	"faultbench-method M",	"fault type, one of all, anon, file, shared, thp, uffd-copy or uffd-zero" },
+	{ NULL,	"faultbench-ops N",	"stop after N page faults" },
+	{ NULL,	"faultbench-threads N",	"sweep 1, 2, 4 .. N faulting threads, default is the number of CPUs" },
+	{ NULL,	NULL,			NULL }
+};
+
+#define FAULTBENCH_ANON		(1)	/* private anonymous, small pages */
+#define FAULTBENCH_FILE		(2)	/* shared file mapping */
+#define FAULTBENCH_SHARED	(3)	/* shared anonymous (shmem) */
+#define FAULTBENCH_THP		(4)	/* private anonymous, huge page eligible */
+#define FAULTBENCH_UFFD_COPY	(5)	/* userfaultfd resolved by UFFDIO_COPY */
+#define FAULTBENCH_UFFD_ZERO	(6)	/* userfaultfd resolved by UFFDIO_ZEROPAGE */
+
+static const char * const faultbench_methods[] = {
+	"all",
+	"anon",
+	"file",
+	"shared",
+	"thp",
+	"uffd-copy",
+	"uffd-zero",
+};
+
+#define FAULTBENCH_METHODS	(SIZEOF_ARRAY(faultbench_methods))
+
+static int stress_set_faultbench_bytes(const char *opt)
+{
+	size_t faultbench_bytes;
+
+	faultbench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("faultbench-bytes", faultbench_bytes,
+		MIN_FAULTBENCH_BYTES, MAX_FAULTBENCH_BYTES);
+	return stress_set_setting("faultbench-bytes", TYPE_ID_SIZE_T, &faultbench_bytes);
+}
+
+static int stress_set_faultbench_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < FAULTBENCH_METHODS; i++) {
+		if (!strcmp(opt, faultbench_methods[i]))
+			return stress_set_setting("faultbench-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "faultbench-method must be one of:");
+	for (i = 0; i < FAULTBENCH_METHODS; i++)
+		(void)fprintf(stderr, " %s", faultbench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_faultbench_threads(const char *opt)
+{
+	uint32_t faultbench_threads;
+
+	faultbench_threads = stress_get_uint32(opt);
+	stress_check_range("faultbench-threads", (uint64_t)faultbench_threads,
+		MIN_FAULTBENCH_THREADS, MAX_FAULTBENCH_THREADS);
+	return stress_set_setting("faultbench-threads", TYPE_ID_UINT32, &faultbench_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_faultbench_bytes,		stress_set_faultbench_bytes },
+	{ OPT_faultbench_method,	stress_set_faultbench_method },
+	{ OPT_faultbench_threads,	stress_set_faultbench_threads },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD)
+
+#define FAULTBENCH_STEPS	(12)		/* 1, 2, 4 .. N threads */
+#define FAULTBENCH_STEP		(0.25)		/* seconds per step */
+#define FAULTBENCH_THP_SIZE	(2 * MB)
+
+#if defined(HAVE_USERFAULTFD) &&		\
+    defined(HAVE_LINUX_USERFAULTFD_H) &&	\
+    defined(HAVE_POLL_H)
+#define HAVE_FAULTBENCH_UFFD
+#endif
+
+struct stress_faultbench;
+
+/* faulting thread and its userfaultfd handler thread */
+typedef struct {
+	struct stress_faultbench *fb;	/* shared state */
+	pthread_t pthread;		/* faulting thread */
+	int	ret;			/* pthread_create return */
+	uint32_t tid;			/* thread index */
+	uint64_t faults;		/* page faults taken */
+	double	fault_time;		/* time in touch loops */
+	bool	failed;			/* mapping failed */
+#if defined(HAVE_FAULTBENCH_UFFD)
+	int	uffd;			/* userfaultfd, -1 if none */
+	pthread_t handler;		/* fault handler thread */
+	int	handler_ret;		/* pthread_create return */
+	volatile bool handler_stop;	/* handler stop flag */
+	uint64_t resolved;		/* faults resolved by the handler */
+#endif
+} ALIGN64 stress_faultbench_thread_t;
+
+typedef struct stress_faultbench {
+	size_t	method;			/* FAULTBENCH_* */
+	size_t	region_size;		/* bytes per thread per pass */
+	size_t	page_size;		/* small page size */
+	int	fd;			/* file for FAULTBENCH_FILE */
+	uint8_t	*copy_src;		/* UFFDIO_COPY source page */
+	volatile bool start;		/* threads may start */
+	volatile bool stop;		/* threads must stop */
+} stress_faultbench_t;
+
+typedef struct {
+	uint32_t threads;		/* faulting threads */
+	uint64_t faults;		/* page faults */
+	double	fault_time;		/* thread time in touch loops */
+	double	wall;			/* elapsed time of steps */
+} stress_faultbench_stats_t;
+
+/*
+ *  stress_faultbench_thread_faults()
+ *	minor + major faults of the calling thread, 0 if unknown
+ */
+static uint64_t stress_faultbench_thread_faults(void)
+{
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_THREAD) &&	\
+    defined(HAVE_RUSAGE_RU_MINFLT)
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_THREAD, &usage) == 0)
+		return (uint64_t)usage.ru_minflt + (uint64_t)usage.ru_majflt;
+#endif
+	return 0;
+}
+
+#if defined(HAVE_FAULTBENCH_UFFD)
+/*
+ *  stress_faultbench_uffd_open()
+ *	open a non-blocking userfaultfd, unprivileged users may only
+ *	be allowed user mode faults. Returns -1 on failure
+ */
+static int stress_faultbench_uffd_open(void)
+{
+	struct uffdio_api api;
+	int fd;
+
+	fd = shim_userfaultfd(O_CLOEXEC | O_NONBLOCK);
+#if defined(UFFD_USER_MODE_ONLY)
+	if ((fd < 0) && (errno == EPERM))
+		fd = shim_userfaultfd(O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+#endif
+	if (fd < 0)
+		return -1;
+
+	(void)memset(&api, 0, sizeof(api));
+	api.api = UFFD_API;
+	api.features = 0;
+	if ((ioctl(fd, UFFDIO_API, &api) < 0) || (api.api != UFFD_API)) {
+		(void)close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ *  stress_faultbench_handler()
+ *	resolve the missing page faults of one faulting thread
+ */
+static void *stress_faultbench_handler(void *arg)
+{
+	static void *nowt = NULL;
+	stress_faultbench_thread_t *t = (stress_faultbench_thread_t *)arg;
+	const stress_faultbench_t *fb = t->fb;
+	const uintptr_t mask = ~(uintptr_t)(fb->page_size - 1);
+	struct pollfd fds;
+
+	fds.fd = t->uffd;
+	fds.events = POLLIN;
+
+	while (!t->handler_stop) {
+		struct uffd_msg msg;
+		uintptr_t addr;
+
+		fds.revents = 0;
+		if (poll(&fds, 1, 10) < 1)
+			continue;
+		if (read(t->uffd, &msg, sizeof(msg)) != (ssize_t)sizeof(msg))
+			continue;
+		if (msg.event != UFFD_EVENT_PAGEFAULT)
+			continue;
+		addr = (uintptr_t)msg.arg.pagefault.address & mask;
+
+		if (fb->method == FAULTBENCH_UFFD_COPY) {
+			struct uffdio_copy copy;
+
+			copy.dst = (unsigned long)addr;
+			copy.src = (unsigned long)fb->copy_src;
+			copy.len = fb->page_size;
+			copy.mode = 0;
+			copy.copy = 0;
+			if (ioctl(t->uffd, UFFDIO_COPY, &copy) == 0)
+				t->resolved++;
+		} else {
+			struct uffdio_zeropage zeropage;
+
+			zeropage.range.start = (unsigned long)addr;
+			zeropage.range.len = fb->page_size;
+			zeropage.mode = 0;
+			zeropage.zeropage = 0;
+			if (ioctl(t->uffd, UFFDIO_ZEROPAGE, &zeropage) == 0)
+				t->resolved++;
+		}
+	}
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_faultbench_map()
+ *	map a fresh region for one pass, *base and *len are what
+ *	must be unmapped afterwards. Returns NULL on failure
+ */
+static uint8_t *stress_faultbench_map(
+	const stress_faultbench_t *fb,
+	const stress_faultbench_thread_t *t,
+	void **base,
+	size_t *len)
+{
+	const size_t sz = fb->region_size;
+	uint8_t *ptr;
+
+	*len = sz;
+	switch (fb->method) {
+	case FAULTBENCH_FILE:
+		ptr = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fb->fd, (off_t)t->tid * (off_t)sz);
+		break;
+	case FAULTBENCH_SHARED:
+		ptr = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		break;
+	case FAULTBENCH_THP:
+		*len = sz + FAULTBENCH_THP_SIZE;
+		ptr = (uint8_t *)mmap(NULL, *len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED)
+			break;
+		*base = (void *)ptr;
+		ptr = (uint8_t *)(((uintptr_t)ptr + FAULTBENCH_THP_SIZE - 1) &
+			~(uintptr_t)(FAULTBENCH_THP_SIZE - 1));
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE)
+		VOID_RET(int, madvise((void *)ptr, sz, MADV_HUGEPAGE));
+#endif
+		return ptr;
+	default:
+		ptr = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_NOHUGEPAGE)
+		if ((ptr != MAP_FAILED) && (fb->method == FAULTBENCH_ANON))
+			VOID_RET(int, madvise((void *)ptr, sz, MADV_NOHUGEPAGE));
+#endif
+		break;
+	}
+	if (ptr == MAP_FAILED)
+		return NULL;
+	*base = (void *)ptr;
+	return ptr;
+}
+
+/*
+ *  stress_faultbench_thread()
+ *	map a region, fault every page in, unmap it, repeat; the
+ *	mmap and munmap calls contend for the mm's locks with the
+ *	faults of the other threads
+ */
+static void *stress_faultbench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_faultbench_thread_t *t = (stress_faultbench_thread_t *)arg;
+	const stress_faultbench_t *fb = t->fb;
+	const size_t page_size = fb->page_size;
+	const bool uffd = (fb->method == FAULTBENCH_UFFD_COPY) ||
+			  (fb->method == FAULTBENCH_UFFD_ZERO);
+
+	while (!fb->start && !fb->stop)
+		(void)shim_sched_yield();
+
+	while (!fb->stop) {
+		void *base = NULL;
+		size_t len, i;
+		uint8_t *ptr;
+		uint64_t faults;
+		double t1;
+
+		ptr = stress_faultbench_map(fb, t, &base, &len);
+		if (!ptr) {
+			t->failed = true;
+			break;
+		}
+#if defined(HAVE_FAULTBENCH_UFFD)
+		if (uffd) {
+			struct uffdio_register reg;
+
+			(void)memset(&reg, 0, sizeof(reg));
+			reg.range.start = (unsigned long)ptr;
+			reg.range.len = fb->region_size;
+			reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+			if (ioctl(t->uffd, UFFDIO_REGISTER, &reg) < 0) {
+				(void)munmap(base, len);
+				t->failed = true;
+				break;
+			}
+		}
+#endif
+		faults = stress_faultbench_thread_faults();
+		t1 = stress_time_now();
+		if (uffd) {
+			/* read faults, a write after UFFDIO_ZEROPAGE would fault again */
+			for (i = 0; i < fb->region_size; i += page_size)
+				(void)*(volatile uint8_t *)(ptr + i);
+		} else {
+			for (i = 0; i < fb->region_size; i += page_size)
+				*(volatile uint8_t *)(ptr + i) = (uint8_t)i;
+		}
+		t->fault_time += stress_time_now() - t1;
+		faults = stress_faultbench_thread_faults() - faults;
+		/* without per thread rusage count one fault per page */
+		if (!faults && !uffd)
+			faults = fb->region_size / page_size;
+		t->faults += uffd ? 0 : faults;
+		(void)munmap(base, len);
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_faultbench_step()
+ *	run n_threads faulting threads for FAULTBENCH_STEP seconds
+ */
+static int stress_faultbench_step(
+	const stress_args_t *args,
+	stress_faultbench_t *fb,
+	stress_faultbench_thread_t *threads,
+	const uint32_t n_threads,
+	stress_faultbench_stats_t *stats)
+{
+	uint32_t i, started = 0;
+	uint64_t faults = 0;
+	double t_start, fault_time = 0.0;
+	bool failed = false;
+	int rc = EXIT_SUCCESS;
+
+	fb->start = false;
+	fb->stop = false;
+	(void)memset(threads, 0, sizeof(*threads) * n_threads);
+	for (i = 0; i < n_threads; i++) {
+		stress_faultbench_thread_t *t = &threads[i];
+
+		t->fb = fb;
+		t->tid = i;
+#if defined(HAVE_FAULTBENCH_UFFD)
+		t->uffd = -1;
+		t->handler_ret = -1;
+		if ((fb->method == FAULTBENCH_UFFD_COPY) || (fb->method == FAULTBENCH_UFFD_ZERO)) {
+			t->uffd = stress_faultbench_uffd_open();
+			if (t->uffd < 0)
+				break;
+			t->handler_ret = pthread_create(&t->handler, NULL,
+				stress_faultbench_handler, (void *)t);
+			if (t->handler_ret) {
+				(void)close(t->uffd);
+				t->uffd = -1;
+				break;
+			}
+		}
+#endif
+		t->ret = pthread_create(&t->pthread, NULL, stress_faultbench_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+	if (started < n_threads) {
+		pr_inf_skip("%s: cannot create %" PRIu32 " fault threads, skipping stressor\n",
+			args->name, n_threads);
+		rc = EXIT_NO_RESOURCE;
+	}
+
+	t_start = stress_time_now();
+	fb->start = true;
+	while ((rc == EXIT_SUCCESS) && keep_stressing(args) &&
+	       (stress_time_now() < t_start + FAULTBENCH_STEP))
+		(void)shim_usleep(10000);
+	fb->stop = true;
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	stats->wall += stress_time_now() - t_start;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_faultbench_thread_t *t = &threads[i];
+
+#if defined(HAVE_FAULTBENCH_UFFD)
+		if (t->handler_ret == 0) {
+			t->handler_stop = true;
+			(void)pthread_join(t->handler, NULL);
+			t->faults += t->resolved;
+		}
+		if (t->uffd >= 0)
+			(void)close(t->uffd);
+#endif
+		if (i >= started)
+			continue;
+		faults += t->faults;
+		fault_time += t->fault_time;
+		failed |= t->failed;
+	}
+	stats->threads = n_threads;
+	stats->faults += faults;
+	stats->fault_time += fault_time;
+	add_counter(args, faults);
+
+	if (failed && (rc == EXIT_SUCCESS)) {
+		pr_inf_skip("%s: %s: cannot map or register a %zu byte region, "
+			"skipping stressor\n", args->name, faultbench_methods[fb->method],
+			fb->region_size);
+		rc = EXIT_NO_RESOURCE;
+	}
+	return rc;
+}
+
+/*
+ *  stress_faultbench()
+ *	measure page fault throughput and latency over fault types
+ *	and the number of threads faulting in a single mm
+ */
+static int stress_faultbench(const stress_args_t *args)
+{
+	static stress_faultbench_stats_t stats[FAULTBENCH_METHODS][FAULTBENCH_STEPS];
+	stress_faultbench_t fb;
+	stress_faultbench_thread_t *threads;
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t faultbench_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+	uint32_t steps[FAULTBENCH_STEPS], n_steps = 0, s;
+	size_t faultbench_bytes = DEFAULT_FAULTBENCH_BYTES;
+	size_t faultbench_method = 0, threads_size, m, idx = 0;
+	bool skipped[FAULTBENCH_METHODS];
+	char filename[PATH_MAX];
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("faultbench-method", &faultbench_method);
+	if (!stress_get_setting("faultbench-bytes", &faultbench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			faultbench_bytes = 256 * MB;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			faultbench_bytes = MIN_FAULTBENCH_BYTES;
+	}
+	if (!stress_get_setting("faultbench-threads", &faultbench_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			faultbench_threads = MAX_FAULTBENCH_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			faultbench_threads = MIN_FAULTBENCH_THREADS;
+	}
+	if (faultbench_threads > MAX_FAULTBENCH_THREADS)
+		faultbench_threads = MAX_FAULTBENCH_THREADS;
+
+	for (s = 1; (s < faultbench_threads) && (n_steps < FAULTBENCH_STEPS - 1); s <<= 1)
+		steps[n_steps++] = s;
+	steps[n_steps++] = faultbench_threads;
+
+	(void)memset(&fb, 0, sizeof(fb));
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(skipped, 0, sizeof(skipped));
+	fb.page_size = args->page_size;
+	fb.region_size = (faultbench_bytes + FAULTBENCH_THP_SIZE - 1) & ~(size_t)(FAULTBENCH_THP_SIZE - 1);
+	fb.fd = -1;
+
+	threads_size = sizeof(*threads) * faultbench_threads;
+	threads = (stress_faultbench_thread_t *)mmap(NULL, threads_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for the thread state, skipping stressor\n",
+			args->name, threads_size);
+		return EXIT_NO_RESOURCE;
+	}
+	fb.copy_src = (uint8_t *)mmap(NULL, args->page_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (fb.copy_src == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap the copy page, skipping stressor\n", args->name);
+		(void)munmap((void *)threads, threads_size);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(fb.copy_src, 0xa5, args->page_size);
+
+	/* each thread faults its own slice of the file */
+	if (!faultbench_method || (faultbench_method == FAULTBENCH_FILE)) {
+		rc = stress_temp_dir_mk_args(args);
+		if (rc < 0) {
+			rc = stress_exit_status(-rc);
+			goto unmap;
+		}
+		rc = EXIT_SUCCESS;
+		(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+		fb.fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+		if (fb.fd >= 0) {
+			(void)shim_unlink(filename);
+			if (ftruncate(fb.fd, (off_t)fb.region_size * faultbench_threads) < 0) {
+				(void)close(fb.fd);
+				fb.fd = -1;
+			}
+		}
+		if (fb.fd < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: file method skipped, cannot create a %zu byte file\n",
+					args->name, fb.region_size * faultbench_threads);
+			skipped[FAULTBENCH_FILE] = true;
+		}
+	}
+
+#if defined(HAVE_FAULTBENCH_UFFD)
+	{
+		const int fd = stress_faultbench_uffd_open();
+
+		if (fd >= 0) {
+			(void)close(fd);
+		} else {
+			if ((args->instance == 0) &&
+			    (!faultbench_method || (faultbench_method >= FAULTBENCH_UFFD_COPY)))
+				pr_inf("%s: uffd methods skipped, userfaultfd failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			skipped[FAULTBENCH_UFFD_COPY] = true;
+			skipped[FAULTBENCH_UFFD_ZERO] = true;
+		}
+	}
+#else
+	if ((args->instance == 0) &&
+	    (!faultbench_method || (faultbench_method >= FAULTBENCH_UFFD_COPY)))
+		pr_inf("%s: uffd methods skipped, userfaultfd is not supported\n", args->name);
+	skipped[FAULTBENCH_UFFD_COPY] = true;
+	skipped[FAULTBENCH_UFFD_ZERO] = true;
+#endif
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 1; (m < FAULTBENCH_METHODS) && (rc == EXIT_SUCCESS); m++) {
+			if ((faultbench_method && (faultbench_method != m)) || skipped[m])
+				continue;
+			fb.method = m;
+			for (s = 0; (s < n_steps) && keep_stressing(args); s++) {
+				rc = stress_faultbench_step(args, &fb, threads, steps[s], &stats[m][s]);
+				if (rc != EXIT_SUCCESS)
+					break;
+			}
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-9s %7s %12s %10s %9s\n", args->name,
+			"method", "threads", "faults/sec", "ns/fault", "scaling");
+	for (m = 1; m < FAULTBENCH_METHODS; m++) {
+		const stress_faultbench_stats_t *base = &stats[m][0];
+		const double base_rate = (base->wall > 0.0) ? (double)base->faults / base->wall : 0.0;
+		double rate = 0.0;
+
+		for (s = 0; s < n_steps; s++) {
+			const stress_faultbench_stats_t *st = &stats[m][s];
+			double ns, scaling;
+
+			if (!st->faults || (st->wall <= 0.0))
+				continue;
+			rate = (double)st->faults / st->wall;
+			ns = (double)STRESS_NANOSECOND * st->fault_time / (double)st->faults;
+			/* throughput relative to perfect scaling of one thread */
+			scaling = (base_rate > 0.0) ?
+				100.0 * rate / (base_rate * (double)st->threads) : 0.0;
+			if (args->instance == 0)
+				pr_inf("%s: %-9s %7" PRIu32 " %12.0f %10.1f %8.1f%%\n", args->name,
+					faultbench_methods[m], st->threads, rate, ns, scaling);
+		}
+		if (rate > 0.0) {
+			char desc[40];
+
+			(void)snprintf(desc, sizeof(desc), "%s faults/s, %" PRIu32 " threads",
+				faultbench_methods[m], faultbench_threads);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, rate);
+		}
+	}
+
+	if (fb.fd >= 0) {
+		(void)close(fb.fd);
+		(void)stress_temp_dir_rm_args(args);
+	}
+unmap:
+	(void)munmap((void *)fb.copy_src, args->page_size);
+	(void)munmap((void *)threads, threads_size);
+
+	return rc;
+}
+
+stressor_info_t stress_faultbench_info = {
+	.stressor = stress_faultbench,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_faultbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
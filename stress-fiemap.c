@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_LINUX_FIEMAP_H)
 #include <linux/fiemap.h>
@@ -37,6 +38,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"fiemap N",	  "start N workers exercising the FIEMAP ioctl" },
 	{ NULL,	"fiemap-ops N",	  "stop after N FIEMAP ioctl bogo operations" },
+	{ NULL,	"fiemap-bench",	  "measure fallocate latency, FIEMAP time and fragmentation" },
 	{ NULL,	"fiemap-bytes N", "specify size of file to fiemap" },
 	{ NULL,	NULL,		   NULL }
 };
@@ -51,7 +53,13 @@ static int stress_set_fiemap_bytes(const char *opt)
 	return stress_set_setting("fiemap-bytes", TYPE_ID_UINT64, &fiemap_bytes);
 }
 
+static int stress_set_fiemap_bench(const char *opt)
+{
+	return stress_set_setting_true("fiemap-bench", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_fiemap_bench,	stress_set_fiemap_bench },
 	{ OPT_fiemap_bytes,	stress_set_fiemap_bytes },
 	{ 0,			NULL }
 };
@@ -224,6 +232,412 @@ static inline pid_t stress_fiemap_spawn(const stress_args_t *args, const int fd)
 	return pid;
 }
 
+#if defined(FALLOC_FL_PUNCH_HOLE) &&	\
+    defined(FALLOC_FL_KEEP_SIZE)
+#define HAVE_FIEMAP_BENCH
+#define FIEMAP_BENCH_BLOCK	(4 * KB)	/* punch/allocate granularity */
+#define FIEMAP_BENCH_ZERO	(64 * KB)	/* zero range size */
+#define FIEMAP_BENCH_OPS	(128)		/* timed ops per operation type */
+#define FIEMAP_BENCH_MAPS	(8)		/* timed full file FIEMAPs */
+#define FIEMAP_BENCH_BATCH	(512)		/* extents per FIEMAP call */
+#define FIEMAP_BENCH_MAX_SIZES	(8)
+#define FIEMAP_BENCH_MAX_LEVELS	(6)
+#define FIEMAP_BENCH_ROUNDS	(8)		/* mixed workload rounds */
+#define FIEMAP_BENCH_ROUND_OPS	(2048)		/* mixed workload ops per round */
+
+enum {
+	FIEMAP_BENCH_ALLOC,
+	FIEMAP_BENCH_PUNCH,
+	FIEMAP_BENCH_ZERO_RANGE,
+	FIEMAP_BENCH_MAP,
+	FIEMAP_BENCH_OP_TYPES,
+};
+
+static const uint64_t fiemap_bench_levels[] = {
+	1, 16, 256, 4096, 65536
+};
+
+typedef struct {
+	uint64_t size;				/* file size in bytes */
+	uint64_t extents;			/* extents before the timed ops */
+	bool ok[FIEMAP_BENCH_OP_TYPES];		/* op supported */
+	uint64_t p50[FIEMAP_BENCH_OP_TYPES];	/* median latency ns */
+	uint64_t p99[FIEMAP_BENCH_OP_TYPES];	/* 99th percentile latency ns */
+} stress_fiemap_bench_cell_t;
+
+typedef struct {
+	uint64_t extents;			/* extents after the round */
+	double mean_kb;				/* mean extent size KB */
+	double map_us;				/* full file FIEMAP time us */
+} stress_fiemap_bench_round_t;
+
+typedef struct {
+	stress_fiemap_bench_cell_t cells[FIEMAP_BENCH_MAX_SIZES * FIEMAP_BENCH_MAX_LEVELS];
+	stress_fiemap_bench_round_t rounds[FIEMAP_BENCH_ROUNDS];
+	size_t n_cells;
+	size_t n_rounds;
+	uint64_t mixed_size;
+} stress_fiemap_bench_t;
+
+/*
+ *  stress_fiemap_bench_map()
+ *	walk all extents with FIEMAP in FIEMAP_BENCH_BATCH sized
+ *	batches, returns the extent count and mapped bytes
+ */
+static int stress_fiemap_bench_map(
+	const int fd,
+	struct fiemap *fm,
+	uint64_t *extents,
+	uint64_t *bytes)
+{
+	uint64_t start = 0;
+
+	*extents = 0;
+	*bytes = 0;
+	for (;;) {
+		const struct fiemap_extent *last;
+		uint32_t i;
+
+		(void)memset(fm, 0, sizeof(*fm));
+		fm->fm_start = start;
+		fm->fm_length = ~0ULL - start;
+		fm->fm_extent_count = FIEMAP_BENCH_BATCH;
+		if (ioctl(fd, FS_IOC_FIEMAP, fm) < 0)
+			return -1;
+		if (fm->fm_mapped_extents == 0)
+			break;
+		for (i = 0; i < fm->fm_mapped_extents; i++)
+			*bytes += fm->fm_extents[i].fe_length;
+		*extents += fm->fm_mapped_extents;
+		last = &fm->fm_extents[fm->fm_mapped_extents - 1];
+		if (last->fe_flags & FIEMAP_EXTENT_LAST)
+			break;
+		start = last->fe_logical + last->fe_length;
+	}
+	return 0;
+}
+
+/*
+ *  stress_fiemap_bench_fragment()
+ *	preallocate size bytes and punch evenly spaced holes to
+ *	leave roughly the requested number of extents
+ */
+static int stress_fiemap_bench_fragment(
+	const int fd,
+	const uint64_t size,
+	const uint64_t extents)
+{
+	const uint64_t stride = (size / extents) & ~(FIEMAP_BENCH_BLOCK - 1);
+	uint64_t i;
+
+	if (ftruncate(fd, 0) < 0)
+		return -1;
+	if (shim_fallocate(fd, 0, 0, (off_t)size) < 0)
+		return -1;
+	for (i = 1; i < extents; i++) {
+		if (shim_fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+				(off_t)(i * stride), FIEMAP_BENCH_BLOCK) < 0)
+			return -1;
+	}
+	return shim_fsync(fd);
+}
+
+/*
+ *  stress_fiemap_bench_offset()
+ *	random block aligned offset with len bytes left in the file
+ */
+static inline off_t stress_fiemap_bench_offset(const uint64_t size, const uint64_t len)
+{
+	return (off_t)((stress_mwc64() % (size - len)) & ~(FIEMAP_BENCH_BLOCK - 1));
+}
+
+/*
+ *  stress_fiemap_bench_cell()
+ *	time punch hole + re-allocate pairs, zero range and full
+ *	file FIEMAP on a file of a given size and extent count
+ */
+static void stress_fiemap_bench_cell(
+	const stress_args_t *args,
+	const int fd,
+	struct fiemap *fm,
+	stress_fiemap_bench_cell_t *cell)
+{
+	static stress_latency_t lat[FIEMAP_BENCH_OP_TYPES];
+	uint64_t bytes;
+	size_t i, t;
+
+	for (t = 0; t < FIEMAP_BENCH_OP_TYPES; t++) {
+		stress_latency_reset(&lat[t]);
+		cell->ok[t] = true;
+	}
+	if (stress_fiemap_bench_map(fd, fm, &cell->extents, &bytes) < 0)
+		cell->ok[FIEMAP_BENCH_MAP] = false;
+
+	for (i = 0; (i < FIEMAP_BENCH_OPS) && keep_stressing(args); i++) {
+		const off_t off = stress_fiemap_bench_offset(cell->size, FIEMAP_BENCH_ZERO);
+		uint64_t t1, t2;
+
+		if (cell->ok[FIEMAP_BENCH_PUNCH]) {
+			t1 = stress_latency_now();
+			if (shim_fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+					off, FIEMAP_BENCH_BLOCK) < 0)
+				cell->ok[FIEMAP_BENCH_PUNCH] = false;
+			t2 = stress_latency_now();
+			stress_latency_record(&lat[FIEMAP_BENCH_PUNCH], t2 - t1);
+		}
+		if (cell->ok[FIEMAP_BENCH_ALLOC]) {
+			t1 = stress_latency_now();
+			if (shim_fallocate(fd, 0, off, FIEMAP_BENCH_BLOCK) < 0)
+				cell->ok[FIEMAP_BENCH_ALLOC] = false;
+			t2 = stress_latency_now();
+			stress_latency_record(&lat[FIEMAP_BENCH_ALLOC], t2 - t1);
+		}
+#if defined(FALLOC_FL_ZERO_RANGE)
+		if (cell->ok[FIEMAP_BENCH_ZERO_RANGE]) {
+			t1 = stress_latency_now();
+			if (shim_fallocate(fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE,
+					off, FIEMAP_BENCH_ZERO) < 0)
+				cell->ok[FIEMAP_BENCH_ZERO_RANGE] = false;
+			t2 = stress_latency_now();
+			stress_latency_record(&lat[FIEMAP_BENCH_ZERO_RANGE], t2 - t1);
+		}
+#else
+		cell->ok[FIEMAP_BENCH_ZERO_RANGE] = false;
+#endif
+	}
+	for (i = 0; (i < FIEMAP_BENCH_MAPS) && cell->ok[FIEMAP_BENCH_MAP] && keep_stressing(args); i++) {
+		const uint64_t t1 = stress_latency_now();
+		uint64_t extents;
+
+		if (stress_fiemap_bench_map(fd, fm, &extents, &bytes) < 0)
+			cell->ok[FIEMAP_BENCH_MAP] = false;
+		stress_latency_record(&lat[FIEMAP_BENCH_MAP], stress_latency_now() - t1);
+	}
+	for (t = 0; t < FIEMAP_BENCH_OP_TYPES; t++) {
+		if (lat[t].count == 0)
+			cell->ok[t] = false;
+		cell->p50[t] = stress_latency_percentile(&lat[t], 50.0);
+		cell->p99[t] = stress_latency_percentile(&lat[t], 99.0);
+	}
+}
+
+/*
+ *  stress_fiemap_bench_mixed()
+ *	age a preallocated file with a mix of small writes, punches,
+ *	zero ranges and preallocations, mapping it after each round
+ *	to track how fragmentation grows
+ */
+static void stress_fiemap_bench_mixed(
+	const stress_args_t *args,
+	const int fd,
+	struct fiemap *fm,
+	stress_fiemap_bench_t *bench)
+{
+	const uint64_t size = bench->mixed_size;
+	uint8_t buf[FIEMAP_BENCH_BLOCK];
+	size_t r, i;
+
+	bench->n_rounds = 0;
+	if (ftruncate(fd, 0) < 0)
+		return;
+	if (shim_fallocate(fd, 0, 0, (off_t)size) < 0)
+		return;
+	stress_strnrnd((char *)buf, sizeof(buf));
+
+	for (r = 0; r < FIEMAP_BENCH_ROUNDS; r++) {
+		stress_fiemap_bench_round_t *round = &bench->rounds[r];
+		uint64_t bytes, t;
+
+		for (i = 0; i < FIEMAP_BENCH_ROUND_OPS; i++) {
+			const uint8_t op = stress_mwc8() % 5;
+			const uint64_t len = ((uint64_t)stress_mwc8() % 16 + 1) * FIEMAP_BENCH_BLOCK;
+			const off_t off = stress_fiemap_bench_offset(size, FIEMAP_BENCH_ZERO);
+
+			switch (op) {
+			case 0:
+			case 1:
+				VOID_RET(ssize_t, pwrite(fd, buf, sizeof(buf), off));
+				break;
+			case 2:
+				VOID_RET(int, shim_fallocate(fd, FALLOC_FL_PUNCH_HOLE |
+					FALLOC_FL_KEEP_SIZE, off, (off_t)len));
+				break;
+			case 3:
+#if defined(FALLOC_FL_ZERO_RANGE)
+				VOID_RET(int, shim_fallocate(fd, FALLOC_FL_ZERO_RANGE |
+					FALLOC_FL_KEEP_SIZE, off, (off_t)len));
+#endif
+				break;
+			default:
+				VOID_RET(int, shim_fallocate(fd, 0, off, (off_t)len));
+				break;
+			}
+		}
+		if (!keep_stressing(args))
+			return;
+		/* flush delayed allocations so FIEMAP sees real extents */
+		(void)shim_fsync(fd);
+		t = stress_latency_now();
+		if (stress_fiemap_bench_map(fd, fm, &round->extents, &bytes) < 0)
+			return;
+		round->map_us = (double)(stress_latency_now() - t) / 1000.0;
+		round->mean_kb = round->extents ?
+			(double)bytes / (double)round->extents / (double)KB : 0.0;
+		bench->n_rounds++;
+	}
+}
+
+/*
+ *  stress_fiemap_bench()
+ *	measure fallocate, punch hole and zero range latency against
+ *	file size and existing extent count, FIEMAP time on fragmented
+ *	files and the fragmentation left by a mixed workload
+ */
+static int stress_fiemap_bench(
+	const stress_args_t *args,
+	const int fd,
+	const uint64_t fiemap_bytes)
+{
+	static stress_fiemap_bench_t pass, res;
+	static const char * const op_names[] = {
+		"alloc", "punch", "zero", "fiemap"
+	};
+	struct fiemap *fm;
+	uint64_t sizes[FIEMAP_BENCH_MAX_SIZES], size;
+	size_t n_sizes = 0, s, l, c, t;
+	bool done = false;
+
+	for (size = MIN_FIEMAP_SIZE; (size < fiemap_bytes) &&
+	     (n_sizes < FIEMAP_BENCH_MAX_SIZES - 1); size *= 16)
+		sizes[n_sizes++] = size;
+	sizes[n_sizes++] = fiemap_bytes & ~(FIEMAP_BENCH_BLOCK - 1);
+
+	fm = (struct fiemap *)calloc(1, sizeof(*fm) +
+		FIEMAP_BENCH_BATCH * sizeof(struct fiemap_extent));
+	if (!fm) {
+		pr_inf_skip("%s: cannot allocate fiemap buffer, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	do {
+		(void)memset(&pass, 0, sizeof(pass));
+		for (s = 0; s < n_sizes; s++) {
+			/* at most one 4K hole per 8K so extents stay distinct */
+			const uint64_t max_extents = sizes[s] / (2 * FIEMAP_BENCH_BLOCK);
+			uint64_t prev = 0;
+
+			for (l = 0; l < FIEMAP_BENCH_MAX_LEVELS; l++) {
+				stress_fiemap_bench_cell_t *cell = &pass.cells[pass.n_cells];
+				uint64_t extents;
+
+				if (l < SIZEOF_ARRAY(fiemap_bench_levels))
+					extents = fiemap_bench_levels[l];
+				else
+					extents = max_extents;
+				if (extents > max_extents)
+					extents = max_extents;
+				if (extents <= prev)
+					continue;
+				prev = extents;
+				if (!keep_stressing(args))
+					goto finish;
+				if (stress_fiemap_bench_fragment(fd, sizes[s], extents) < 0) {
+					pr_inf_skip("%s: cannot preallocate and punch a %" PRIu64
+						" byte file, errno=%d (%s), skipping stressor\n",
+						args->name, sizes[s], errno, strerror(errno));
+					free(fm);
+					return EXIT_NO_RESOURCE;
+				}
+				cell->size = sizes[s];
+				stress_fiemap_bench_cell(args, fd, fm, cell);
+				pass.n_cells++;
+			}
+		}
+		pass.mixed_size = sizes[n_sizes - 1];
+		stress_fiemap_bench_mixed(args, fd, fm, &pass);
+		if (pass.n_rounds < FIEMAP_BENCH_ROUNDS)
+			break;
+		(void)memcpy(&res, &pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+finish:
+	VOID_RET(int, ftruncate(fd, 0));
+	free(fm);
+
+	if (!done)
+		return EXIT_SUCCESS;
+
+	if (args->instance == 0) {
+		char str[160];
+
+		pr_inf("%s: fallocate latency p50/p99 us, %d KB alloc and punch, "
+			"%d KB zero range, full file FIEMAP\n", args->name,
+			(int)(FIEMAP_BENCH_BLOCK / KB), (int)(FIEMAP_BENCH_ZERO / KB));
+		(void)snprintf(str, sizeof(str), "%8s %8s", "size", "extents");
+		for (t = 0; t < FIEMAP_BENCH_OP_TYPES; t++) {
+			const size_t len = strlen(str);
+
+			(void)snprintf(str + len, sizeof(str) - len, " %17s", op_names[t]);
+		}
+		pr_inf("%s: %s\n", args->name, str);
+		for (c = 0; c < res.n_cells; c++) {
+			const stress_fiemap_bench_cell_t *cell = &res.cells[c];
+			char size_str[32];
+
+			(void)snprintf(str, sizeof(str), "%8s %8" PRIu64,
+				stress_uint64_to_str(size_str, sizeof(size_str), cell->size),
+				cell->extents);
+			for (t = 0; t < FIEMAP_BENCH_OP_TYPES; t++) {
+				const size_t len = strlen(str);
+
+				if (!cell->ok[t])
+					(void)snprintf(str + len, sizeof(str) - len, " %17s", "-");
+				else
+					(void)snprintf(str + len, sizeof(str) - len, " %8.1f/%8.1f",
+						(double)cell->p50[t] / 1000.0,
+						(double)cell->p99[t] / 1000.0);
+			}
+			pr_inf("%s: %s\n", args->name, str);
+		}
+
+		pr_inf("%s: mixed workload fragmentation, %" PRIu64 " MB file, %d ops "
+			"per round of writes, punches, zero ranges and preallocations\n",
+			args->name, (uint64_t)(res.mixed_size / MB), FIEMAP_BENCH_ROUND_OPS);
+		pr_inf("%s: %5s %8s %11s %13s %10s\n", args->name,
+			"round", "extents", "extents/MB", "mean extent KB", "fiemap us");
+		for (c = 0; c < res.n_rounds; c++) {
+			const stress_fiemap_bench_round_t *round = &res.rounds[c];
+
+			pr_inf("%s: %5zu %8" PRIu64 " %11.2f %14.1f %10.1f\n", args->name,
+				c + 1, round->extents,
+				(double)round->extents / ((double)res.mixed_size / (double)MB),
+				round->mean_kb, round->map_us);
+		}
+	}
+
+	/* largest file, most fragmented level */
+	{
+		const stress_fiemap_bench_cell_t *cell = &res.cells[res.n_cells - 1];
+		const stress_fiemap_bench_round_t *round = &res.rounds[res.n_rounds - 1];
+
+		for (t = 0; t < FIEMAP_BENCH_OP_TYPES; t++) {
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s p99 usec", op_names[t]);
+			stress_misc_stats_set(args->misc_stats, (int)t, str,
+				cell->ok[t] ? (double)cell->p99[t] / 1000.0 : 0.0);
+		}
+		stress_misc_stats_set(args->misc_stats, (int)t, "mixed workload extents",
+			(double)round->extents);
+		stress_misc_stats_set(args->misc_stats, (int)t + 1, "mixed workload extents/MB",
+			(double)round->extents / ((double)res.mixed_size / (double)MB));
+	}
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_fiemap
  *	stress fiemap IOCTL
@@ -237,6 +651,7 @@ static int stress_fiemap(const stress_args_t *args)
 	uint64_t fiemap_bytes = DEFAULT_FIEMAP_SIZE;
 	struct fiemap fiemap;
 	const char *fs_type;
+	bool fiemap_bench = false;
 
 	counter_lock = stress_lock_create();
 	if (!counter_lock) {
@@ -284,6 +699,20 @@ static int stress_fiemap(const stress_args_t *args)
 		}
 	}
 
+	(void)stress_get_setting("fiemap-bench", &fiemap_bench);
+	if (fiemap_bench) {
+#if defined(HAVE_FIEMAP_BENCH)
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_fiemap_bench(args, fd, fiemap_bytes);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: fallocate punch hole is not available, "
+				"skipping stressor\n", args->name);
+		rc = EXIT_NOT_IMPLEMENTED;
+#endif
+		goto close_clean;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	for (n = 0; n < MAX_FIEMAP_PROCS; n++) {
@@ -0,0 +1,493 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+
+#define MIN_FILELOCKBENCH_PROCS		(2)
+#define MAX_FILELOCKBENCH_PROCS		(64)
+#define DEFAULT_FILELOCKBENCH_PROCS	(4)
+
+#define MIN_FILELOCKBENCH_OVERLAP	(0)
+#define MAX_FILELOCKBENCH_OVERLAP	(100)
+#define DEFAULT_FILELOCKBENCH_OVERLAP	(50)
+
+#define FILELOCKBENCH_RANGE		(4096)	/* bytes per byte range lock */
+#define FILELOCKBENCH_SAMPLES		(4096)	/* wait times kept per process */
+#define FILELOCKBENCH_PHASE		(0.25)	/* seconds per method and range */
+
+static const stress_help_t help[] = {
+	{ NULL,	"filelockbench N",		"start N workers measuring file lock contention and fairness" },
+	{ NULL,	"filelockbench-method M",	"one of all, flock, fcntl or ofd" },
+	{ NULL,	"filelockbench-ops N",		"stop after N lock acquisitions" },
+	{ NULL,	"filelockbench-overlap P",	"byte range locks of neighbouring processes overlap by P%" },
+	{ NULL,	"filelockbench-procs N",	"contend with N processes, default 4" },
+	{ NULL,	NULL,				NULL }
+};
+
+#define FILELOCKBENCH_FLOCK	(1)	/* flock(2), whole file only */
+#define FILELOCKBENCH_FCNTL	(2)	/* POSIX fcntl F_SETLKW, per process */
+#define FILELOCKBENCH_OFD	(3)	/* fcntl F_OFD_SETLKW, per open file */
+
+static const char * const filelockbench_methods[] = {
+	"all",
+	"flock",
+	"fcntl",
+	"ofd",
+};
+
+#define FILELOCKBENCH_METHODS	(SIZEOF_ARRAY(filelockbench_methods))
+
+static int stress_set_filelockbench_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < FILELOCKBENCH_METHODS; i++) {
+		if (!strcmp(opt, filelockbench_methods[i]))
+			return stress_set_setting("filelockbench-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "filelockbench-method must be one of:");
+	for (i = 0; i < FILELOCKBENCH_METHODS; i++)
+		(void)fprintf(stderr, " %s", filelockbench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_filelockbench_overlap(const char *opt)
+{
+	uint32_t filelockbench_overlap;
+
+	filelockbench_overlap = stress_get_uint32(opt);
+	stress_check_range("filelockbench-overlap", (uint64_t)filelockbench_overlap,
+		MIN_FILELOCKBENCH_OVERLAP, MAX_FILELOCKBENCH_OVERLAP);
+	return stress_set_setting("filelockbench-overlap", TYPE_ID_UINT32, &filelockbench_overlap);
+}
+
+static int stress_set_filelockbench_procs(const char *opt)
+{
+	uint32_t filelockbench_procs;
+
+	filelockbench_procs = stress_get_uint32(opt);
+	stress_check_range("filelockbench-procs", (uint64_t)filelockbench_procs,
+		MIN_FILELOCKBENCH_PROCS, MAX_FILELOCKBENCH_PROCS);
+	return stress_set_setting("filelockbench-procs", TYPE_ID_UINT32, &filelockbench_procs);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_filelockbench_method,	stress_set_filelockbench_method },
+	{ OPT_filelockbench_overlap,	stress_set_filelockbench_overlap },
+	{ OPT_filelockbench_procs,	stress_set_filelockbench_procs },
+	{ 0,				NULL }
+};
+
+#if defined(F_SETLKW) &&	\
+    defined(F_WRLCK) &&		\
+    defined(F_UNLCK)
+
+#define FILELOCKBENCH_WHOLE	(0)	/* lock the whole file */
+#define FILELOCKBENCH_BYTES	(1)	/* lock a byte range */
+
+static const char * const filelockbench_ranges[] = {
+	"whole",
+	"range",
+};
+
+#define FILELOCKBENCH_RANGES	(SIZEOF_ARRAY(filelockbench_ranges))
+
+/* lock activity of one contending process, in shared memory */
+typedef struct {
+	uint64_t acquired;		/* locks taken */
+	uint64_t max_wait;		/* longest wait, ns */
+	size_t	n_samples;		/* wait samples held */
+	int	err;			/* errno of a failed lock call */
+	uint64_t samples[FILELOCKBENCH_SAMPLES];	/* wait times, ns */
+} ALIGN64 stress_filelockbench_proc_t;
+
+typedef struct {
+	volatile bool start;		/* processes may start */
+	stress_filelockbench_proc_t procs[];
+} stress_filelockbench_shared_t;
+
+/* contention figures of one method and range */
+typedef struct {
+	uint64_t acquired;		/* locks taken */
+	double	duration;		/* seconds of contention */
+	uint64_t p50;			/* wait percentiles, ns */
+	uint64_t p99;
+	uint64_t max;
+	double	jain;			/* Jain fairness index, % */
+	double	spread;			/* (max - min) / mean acquisitions, % */
+	bool	measured;
+} stress_filelockbench_stats_t;
+
+static int stress_filelockbench_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_filelockbench_lock()
+ *	take (lock true) or drop a write lock, returns 0 or -1
+ */
+static int stress_filelockbench_lock(
+	const int fd,
+	const size_t method,
+	const off_t start,
+	const off_t len,
+	const bool lock)
+{
+	struct flock fl;
+
+	switch (method) {
+#if defined(HAVE_FLOCK) &&	\
+    defined(LOCK_EX) &&		\
+    defined(LOCK_UN)
+	case FILELOCKBENCH_FLOCK:
+		return flock(fd, lock ? LOCK_EX : LOCK_UN);
+#endif
+	case FILELOCKBENCH_FCNTL:
+		(void)memset(&fl, 0, sizeof(fl));
+		fl.l_type = lock ? F_WRLCK : F_UNLCK;
+		fl.l_whence = SEEK_SET;
+		fl.l_start = start;
+		fl.l_len = len;
+		return fcntl(fd, F_SETLKW, &fl);
+#if defined(F_OFD_SETLKW)
+	case FILELOCKBENCH_OFD:
+		(void)memset(&fl, 0, sizeof(fl));
+		fl.l_type = lock ? F_WRLCK : F_UNLCK;
+		fl.l_whence = SEEK_SET;
+		fl.l_start = start;
+		fl.l_len = len;
+		return fcntl(fd, F_OFD_SETLKW, &fl);
+#endif
+	default:
+		(void)start;
+		(void)len;
+		(void)lock;
+		errno = ENOSYS;
+		return -1;
+	}
+}
+
+/*
+ *  stress_filelockbench_child()
+ *	open the file, so OFD locks belong to this process, and take
+ *	and drop the lock as fast as possible for the phase, timing
+ *	how long each lock call waited
+ */
+static void stress_filelockbench_child(
+	const stress_args_t *args,
+	const char *filename,
+	stress_filelockbench_shared_t *shared,
+	const uint32_t proc,
+	const size_t method,
+	const off_t start,
+	const off_t len)
+{
+	stress_filelockbench_proc_t *p = &shared->procs[proc];
+	double t_end;
+	int fd;
+
+	fd = open(filename, O_RDWR);
+	if (fd < 0) {
+		p->err = errno;
+		return;
+	}
+
+	while (!shared->start)
+		(void)shim_sched_yield();
+
+	t_end = stress_time_now() + FILELOCKBENCH_PHASE;
+	do {
+		uint64_t t1, t2, wait;
+		size_t n;
+
+		t1 = stress_clock_ns();
+		if (stress_filelockbench_lock(fd, method, start, len, true) < 0) {
+			if (errno == EINTR)
+				continue;
+			p->err = errno;
+			break;
+		}
+		t2 = stress_clock_ns();
+		p->acquired++;
+		(void)stress_filelockbench_lock(fd, method, start, len, false);
+
+		/* keep all samples until full, then replace at random */
+		wait = t2 - t1;
+		if (p->n_samples < FILELOCKBENCH_SAMPLES)
+			n = p->n_samples++;
+		else
+			n = (size_t)stress_mwc32() % FILELOCKBENCH_SAMPLES;
+		p->samples[n] = wait;
+		if (wait > p->max_wait)
+			p->max_wait = wait;
+	} while (((p->acquired & 15) != 0) ||
+		 ((stress_time_now() < t_end) && keep_stressing_flag()));
+
+	(void)close(fd);
+	(void)args;
+}
+
+/*
+ *  stress_filelockbench_step()
+ *	fork the contending processes for one method and range and
+ *	gather their acquisitions, wait times and fairness, returns
+ *	-1 with errno if the lock call failed
+ */
+static int stress_filelockbench_step(
+	const stress_args_t *args,
+	const char *filename,
+	stress_filelockbench_shared_t *shared,
+	const uint32_t n_procs,
+	const size_t method,
+	const size_t range,
+	const uint32_t overlap,
+	uint64_t *waits,
+	stress_filelockbench_stats_t *stats)
+{
+	pid_t pids[MAX_FILELOCKBENCH_PROCS];
+	uint64_t min_acq = ~0ULL, max_acq = 0, sum = 0;
+	double sum_sq = 0.0, t1, t2, mean;
+	/* neighbouring byte ranges are shifted by the non-overlapping part */
+	const off_t shift = (off_t)((FILELOCKBENCH_RANGE * (100 - overlap)) / 100);
+	uint32_t i, started = 0;
+	size_t n_waits = 0;
+	int err = 0;
+
+	(void)memset((void *)shared->procs, 0, sizeof(*shared->procs) * n_procs);
+	shared->start = false;
+
+	for (i = 0; i < n_procs; i++) {
+		const off_t start = (range == FILELOCKBENCH_WHOLE) ? 0 : (off_t)i * shift;
+		const off_t len = (range == FILELOCKBENCH_WHOLE) ? 0 : FILELOCKBENCH_RANGE;
+again:
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			if (stress_redo_fork(errno))
+				goto again;
+			break;
+		} else if (pids[i] == 0) {
+			stress_parent_died_alarm();
+			(void)sched_settings_apply(true);
+			stress_filelockbench_child(args, filename, shared, i,
+				method, start, len);
+			_exit(0);
+		}
+		started++;
+	}
+	t1 = stress_time_now();
+	shared->start = true;
+	for (i = 0; i < started; i++) {
+		int status;
+
+		(void)shim_waitpid(pids[i], &status, 0);
+	}
+	t2 = stress_time_now();
+	if (started < n_procs)
+		return 0;
+
+	for (i = 0; i < n_procs; i++) {
+		const stress_filelockbench_proc_t *p = &shared->procs[i];
+
+		if (p->err)
+			err = p->err;
+		sum += p->acquired;
+		sum_sq += (double)p->acquired * (double)p->acquired;
+		if (p->acquired < min_acq)
+			min_acq = p->acquired;
+		if (p->acquired > max_acq)
+			max_acq = p->acquired;
+		if (p->max_wait > stats->max)
+			stats->max = p->max_wait;
+		(void)memcpy((void *)(waits + n_waits), (const void *)p->samples,
+			p->n_samples * sizeof(*waits));
+		n_waits += p->n_samples;
+	}
+	add_counter(args, sum);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	if (!sum || !n_waits)
+		return 0;
+
+	qsort(waits, n_waits, sizeof(*waits), stress_filelockbench_cmp);
+	mean = (double)sum / (double)n_procs;
+	stats->acquired += sum;
+	stats->duration += t2 - t1;
+	/* percentiles and fairness are from the latest step */
+	stats->p50 = waits[n_waits / 2];
+	stats->p99 = waits[(n_waits * 99) / 100];
+	stats->jain = 100.0 * ((double)sum * (double)sum) / ((double)n_procs * sum_sq);
+	stats->spread = 100.0 * (double)(max_acq - min_acq) / mean;
+	stats->measured = true;
+
+	return 0;
+}
+
+/*
+ *  stress_filelockbench()
+ *	measure lock acquisition rate, wait time percentiles and the
+ *	fairness between processes contending on flock, POSIX fcntl
+ *	and OFD locks on a whole file and on overlapping byte ranges
+ */
+static int stress_filelockbench(const stress_args_t *args)
+{
+	static stress_filelockbench_stats_t stats[FILELOCKBENCH_METHODS][FILELOCKBENCH_RANGES];
+	stress_filelockbench_shared_t *shared;
+	char filename[PATH_MAX];
+	uint64_t *waits;
+	size_t filelockbench_method = 0, m, r, shared_size, idx = 0;
+	uint32_t filelockbench_procs = DEFAULT_FILELOCKBENCH_PROCS;
+	uint32_t filelockbench_overlap = DEFAULT_FILELOCKBENCH_OVERLAP;
+	bool skipped[FILELOCKBENCH_METHODS];
+	int rc = EXIT_SUCCESS, ret, fd;
+
+	(void)stress_get_setting("filelockbench-method", &filelockbench_method);
+	(void)stress_get_setting("filelockbench-overlap", &filelockbench_overlap);
+	if (!stress_get_setting("filelockbench-procs", &filelockbench_procs)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			filelockbench_procs = MAX_FILELOCKBENCH_PROCS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			filelockbench_procs = MIN_FILELOCKBENCH_PROCS;
+	}
+
+	shared_size = sizeof(*shared) + (sizeof(*shared->procs) * filelockbench_procs);
+	shared = (stress_filelockbench_shared_t *)mmap(NULL, shared_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate shared lock statistics, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	waits = (uint64_t *)calloc((size_t)filelockbench_procs * FILELOCKBENCH_SAMPLES,
+		sizeof(*waits));
+	if (!waits) {
+		pr_inf_skip("%s: cannot allocate wait samples, skipping stressor\n",
+			args->name);
+		(void)munmap((void *)shared, shared_size);
+		return EXIT_NO_RESOURCE;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto free_all;
+	}
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto tidy_dir;
+	}
+	(void)close(fd);
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(skipped, 0, sizeof(skipped));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 1; (m < FILELOCKBENCH_METHODS) && keep_stressing(args); m++) {
+			if ((filelockbench_method && (filelockbench_method != m)) || skipped[m])
+				continue;
+			for (r = 0; (r < FILELOCKBENCH_RANGES) && keep_stressing(args); r++) {
+				/* flock only locks whole files */
+				if ((m == FILELOCKBENCH_FLOCK) && (r == FILELOCKBENCH_BYTES))
+					continue;
+				if (stress_filelockbench_step(args, filename, shared,
+						filelockbench_procs, m, r, filelockbench_overlap,
+						waits, &stats[m][r]) < 0) {
+					if (args->instance == 0)
+						pr_inf("%s: %s skipped, errno=%d (%s)\n",
+							args->name, filelockbench_methods[m],
+							errno, strerror(errno));
+					skipped[m] = true;
+					break;
+				}
+			}
+		}
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_inf("%s: %" PRIu32 " processes, byte ranges of %d bytes overlapping by %" PRIu32 "%%\n",
+			args->name, filelockbench_procs, FILELOCKBENCH_RANGE, filelockbench_overlap);
+		pr_inf("%s: %-6s %-5s %12s %9s %9s %9s %7s %7s\n", args->name,
+			"method", "lock", "acquires/sec", "p50 us", "p99 us", "max us",
+			"fair", "spread");
+	}
+	for (m = 1; m < FILELOCKBENCH_METHODS; m++) {
+		for (r = 0; r < FILELOCKBENCH_RANGES; r++) {
+			const stress_filelockbench_stats_t *st = &stats[m][r];
+			double rate;
+
+			if (!st->measured || (st->duration <= 0.0))
+				continue;
+			rate = (double)st->acquired / st->duration;
+			if (args->instance == 0)
+				pr_inf("%s: %-6s %-5s %12.0f %9.2f %9.2f %9.2f %6.1f%% %6.1f%%\n",
+					args->name, filelockbench_methods[m],
+					filelockbench_ranges[r], rate,
+					(double)st->p50 / 1000.0, (double)st->p99 / 1000.0,
+					(double)st->max / 1000.0, st->jain, st->spread);
+			if (idx < STRESS_MISC_STATS_MAX - 1) {
+				char desc[32];
+
+				(void)snprintf(desc, sizeof(desc), "%s %s acquires/sec",
+					filelockbench_methods[m], filelockbench_ranges[r]);
+				stress_misc_stats_set(args->misc_stats, idx++, desc, rate);
+				(void)snprintf(desc, sizeof(desc), "%s %s fairness %%",
+					filelockbench_methods[m], filelockbench_ranges[r]);
+				stress_misc_stats_set(args->misc_stats, idx++, desc, st->jain);
+			}
+		}
+	}
+
+	(void)shim_unlink(filename);
+tidy_dir:
+	(void)stress_temp_dir_rm_args(args);
+free_all:
+	free(waits);
+	(void)munmap((void *)shared, shared_size);
+
+	return rc;
+}
+
+stressor_info_t stress_filelockbench_info = {
+	.stressor = stress_filelockbench,
+	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_filelockbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -32,9 +32,20 @@
 static const stress_help_t help[] = {
 	{ NULL,	"fp-error N",	  "start N workers exercising floating point errors" },
 	{ NULL,	"fp-error-ops N", "stop after N fp-error bogo operations" },
+	{ NULL,	"fp-error-penalty", "report the slowdown of denormal, infinity and NaN operands" },
 	{ NULL,	NULL,		  NULL }
 };
 
+static int stress_set_fp_error_penalty(const char *opt)
+{
+	return stress_set_setting_true("fp-error-penalty", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_fp_error_penalty,	stress_set_fp_error_penalty },
+	{ 0,			NULL }
+};
+
 #if !defined(__UCLIBC__) &&	\
     defined(HAVE_FENV_H) &&	\
     defined(HAVE_FLOAT_H)
@@ -114,12 +125,427 @@ static void stress_fp_check(
 #endif
 }
 
+#define FP_PENALTY_ELEMENTS	(256)
+#define FP_PENALTY_NS		(5000000.0)
+
+/* operand classes, the first is the reference for slowdowns */
+enum {
+	FP_PENALTY_NORMAL = 0,
+	FP_PENALTY_DENORMAL,
+	FP_PENALTY_INF,
+	FP_PENALTY_NAN,
+	FP_PENALTY_CLASSES,
+};
+
+enum {
+	FP_PENALTY_ADD = 0,
+	FP_PENALTY_MUL,
+	FP_PENALTY_FMA,
+	FP_PENALTY_DIV,
+	FP_PENALTY_SQRT,
+	FP_PENALTY_OPS,
+};
+
+static const char * const fp_penalty_ops[] = {
+	"add", "mul", "fma", "div", "sqrt"
+};
+
+typedef double stress_fp_v2d_t __attribute__ ((vector_size(16)));
+typedef float stress_fp_v4f_t __attribute__ ((vector_size(16)));
+
+/*
+ *  Set the flush to zero and denormals are zero modes, returns
+ *  false if the architecture has no such control
+ */
+#if defined(STRESS_ARCH_X86) &&	\
+    (defined(__x86_64__) || defined(__x86_64))
+#define HAVE_FP_PENALTY_FTZ
+#define HAVE_FP_PENALTY_SQRT_ASM
+
+static uint32_t stress_fp_ftz_get(void)
+{
+	uint32_t mxcsr;
+
+	__asm__ __volatile__("stmxcsr %0" : "=m"(mxcsr));
+	return mxcsr;
+}
+
+static void stress_fp_ftz_restore(uint32_t mxcsr)
+{
+	__asm__ __volatile__("ldmxcsr %0" : : "m"(mxcsr));
+}
+
+static bool stress_fp_ftz_set(const bool on)
+{
+	/* MXCSR FTZ is bit 15, DAZ is bit 6 */
+	uint32_t mxcsr = stress_fp_ftz_get();
+
+	mxcsr = on ? (mxcsr | 0x8040) : (mxcsr & ~0x8040U);
+	stress_fp_ftz_restore(mxcsr);
+	return true;
+}
+
+static inline double stress_fp_sqrtd(double x)
+{
+	double r;
+
+	__asm__("sqrtsd %1, %0" : "=x"(r) : "x"(x));
+	return r;
+}
+
+static inline float stress_fp_sqrtf(float x)
+{
+	float r;
+
+	__asm__("sqrtss %1, %0" : "=x"(r) : "x"(x));
+	return r;
+}
+
+static inline stress_fp_v2d_t stress_fp_sqrtv2d(stress_fp_v2d_t x)
+{
+	stress_fp_v2d_t r;
+
+	__asm__("sqrtpd %1, %0" : "=x"(r) : "x"(x));
+	return r;
+}
+
+static inline stress_fp_v4f_t stress_fp_sqrtv4f(stress_fp_v4f_t x)
+{
+	stress_fp_v4f_t r;
+
+	__asm__("sqrtps %1, %0" : "=x"(r) : "x"(x));
+	return r;
+}
+#elif defined(STRESS_ARCH_ARM) &&	\
+      defined(__aarch64__)
+#define HAVE_FP_PENALTY_FTZ
+#define HAVE_FP_PENALTY_SQRT_ASM
+
+static uint32_t stress_fp_ftz_get(void)
+{
+	uint64_t fpcr;
+
+	__asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+	return (uint32_t)fpcr;
+}
+
+static void stress_fp_ftz_restore(uint32_t fpcr)
+{
+	const uint64_t val = (uint64_t)fpcr;
+
+	__asm__ __volatile__("msr fpcr, %0" : : "r"(val));
+}
+
+static bool stress_fp_ftz_set(const bool on)
+{
+	/* FPCR FZ is bit 24, it flushes both inputs and outputs */
+	uint32_t fpcr = stress_fp_ftz_get();
+
+	fpcr = on ? (fpcr | (1U << 24)) : (fpcr & ~(1U << 24));
+	stress_fp_ftz_restore(fpcr);
+	return true;
+}
+
+static inline double stress_fp_sqrtd(double x)
+{
+	double r;
+
+	__asm__("fsqrt %d0, %d1" : "=w"(r) : "w"(x));
+	return r;
+}
+
+static inline float stress_fp_sqrtf(float x)
+{
+	float r;
+
+	__asm__("fsqrt %s0, %s1" : "=w"(r) : "w"(x));
+	return r;
+}
+
+static inline stress_fp_v2d_t stress_fp_sqrtv2d(stress_fp_v2d_t x)
+{
+	stress_fp_v2d_t r;
+
+	__asm__("fsqrt %0.2d, %1.2d" : "=w"(r) : "w"(x));
+	return r;
+}
+
+static inline stress_fp_v4f_t stress_fp_sqrtv4f(stress_fp_v4f_t x)
+{
+	stress_fp_v4f_t r;
+
+	__asm__("fsqrt %0.4s, %1.4s" : "=w"(r) : "w"(x));
+	return r;
+}
+#else
+static uint32_t stress_fp_ftz_get(void)
+{
+	return 0;
+}
+
+static void stress_fp_ftz_restore(uint32_t val)
+{
+	(void)val;
+}
+
+static bool stress_fp_ftz_set(const bool on)
+{
+	return !on;
+}
+#endif
+
+/*
+ *  One operation over the operand arrays, the empty asm with a
+ *  memory clobber stops the compiler vectorizing the scalar loops
+ *  or folding passes together so each element is one instruction
+ */
+#define STRESS_FP_PENALTY_OP(name, type, expr)			\
+static void OPTIMIZE3 name(					\
+	const type *a,						\
+	const type *b,						\
+	const type *c,						\
+	type *r)						\
+{								\
+	register size_t i;					\
+								\
+	(void)b;						\
+	(void)c;						\
+	for (i = 0; i < FP_PENALTY_ELEMENTS; i++) {		\
+		r[i] = expr;					\
+		__asm__ __volatile__("" : : "r"(&r[i]) : "memory");\
+	}							\
+}
+
+/*
+ *  A kind of operand, scalar or 128 bit vector of float or double,
+ *  with its operand arrays and operation functions
+ */
+#define STRESS_FP_PENALTY_KIND(kind, type, etype, denorm, sqrt_expr)\
+static type kind ## _a[FP_PENALTY_ELEMENTS];			\
+static type kind ## _b[FP_PENALTY_ELEMENTS];			\
+static type kind ## _c[FP_PENALTY_ELEMENTS];			\
+static type kind ## _r[FP_PENALTY_ELEMENTS];			\
+								\
+STRESS_FP_PENALTY_OP(kind ## _add, type, a[i] + b[i])		\
+STRESS_FP_PENALTY_OP(kind ## _mul, type, a[i] * b[i])		\
+STRESS_FP_PENALTY_OP(kind ## _fma, type, a[i] * b[i] + c[i])	\
+STRESS_FP_PENALTY_OP(kind ## _div, type, a[i] / b[i])		\
+STRESS_FP_PENALTY_OP(kind ## _sqrt, type, sqrt_expr)		\
+								\
+static void (*kind ## _ops[])(const type *a, const type *b,	\
+	const type *c, type *r) = {				\
+	kind ## _add,						\
+	kind ## _mul,						\
+	kind ## _fma,						\
+	kind ## _div,						\
+	kind ## _sqrt,						\
+};								\
+								\
+static double kind ## _run(const stress_args_t *args,		\
+	const size_t op, const int class)			\
+{								\
+	double av, bv, cv, t1, t2;				\
+	size_t i;						\
+	uint32_t passes, p;					\
+								\
+	stress_fp_penalty_operands(op, class, (double)(denorm),	\
+		&av, &bv, &cv);					\
+	for (i = 0; i < FP_PENALTY_ELEMENTS; i++) {		\
+		kind ## _a[i] = (type){ 0 } + (etype)av;		\
+		kind ## _b[i] = (type){ 0 } + (etype)bv;		\
+		kind ## _c[i] = (type){ 0 } + (etype)cv;		\
+	}							\
+	/* warm up and calibrate to about FP_PENALTY_NS */	\
+	t1 = stress_time_now();					\
+	for (p = 0; p < 16; p++)				\
+		kind ## _ops[op](kind ## _a, kind ## _b,	\
+			kind ## _c, kind ## _r);		\
+	t2 = stress_time_now();					\
+	passes = (t2 > t1) ?					\
+		(uint32_t)((FP_PENALTY_NS / 1.0E9) * 16.0 / (t2 - t1)) : 16;\
+	passes = STRESS_MINIMUM(STRESS_MAXIMUM(passes, 16), 1000000);\
+								\
+	t1 = stress_time_now();					\
+	for (p = 0; p < passes; p++)				\
+		kind ## _ops[op](kind ## _a, kind ## _b,	\
+			kind ## _c, kind ## _r);		\
+	t2 = stress_time_now();					\
+	add_counter(args, passes);				\
+								\
+	return ((t2 - t1) * 1.0E9) /				\
+		((double)passes * FP_PENALTY_ELEMENTS);		\
+}
+
+/*
+ *  stress_fp_penalty_operands()
+ *	operand values for an operation that keep the result
+ *	in the same class as the inputs
+ */
+static void stress_fp_penalty_operands(
+	const size_t op,
+	const int class,
+	const double denorm,
+	double *av,
+	double *bv,
+	double *cv)
+{
+	switch (class) {
+	default:
+	case FP_PENALTY_NORMAL:
+		*av = 1.25;
+		*bv = 1.5;
+		*cv = 0.75;
+		break;
+	case FP_PENALTY_DENORMAL:
+		*av = denorm;
+		*bv = (op == FP_PENALTY_ADD) ? denorm :
+		      ((op == FP_PENALTY_DIV) ? 2.0 : 0.5);
+		*cv = denorm;
+		break;
+	case FP_PENALTY_INF:
+		*av = (double)INFINITY;
+		*bv = 1.5;
+		*cv = 0.75;
+		break;
+	case FP_PENALTY_NAN:
+		*av = (double)NAN;
+		*bv = 1.5;
+		*cv = 0.75;
+		break;
+	}
+}
+
+#if defined(HAVE_FP_PENALTY_SQRT_ASM)
+STRESS_FP_PENALTY_KIND(fp_penalty_f, float, float, FLT_MIN / 4.0, stress_fp_sqrtf(a[i]))
+STRESS_FP_PENALTY_KIND(fp_penalty_d, double, double, DBL_MIN / 4.0, stress_fp_sqrtd(a[i]))
+STRESS_FP_PENALTY_KIND(fp_penalty_v4f, stress_fp_v4f_t, float, FLT_MIN / 4.0, stress_fp_sqrtv4f(a[i]))
+STRESS_FP_PENALTY_KIND(fp_penalty_v2d, stress_fp_v2d_t, double, DBL_MIN / 4.0, stress_fp_sqrtv2d(a[i]))
+#else
+/* no sqrt instruction wrappers, sqrt is the libm call */
+STRESS_FP_PENALTY_KIND(fp_penalty_f, float, float, FLT_MIN / 4.0, sqrtf(a[i]))
+STRESS_FP_PENALTY_KIND(fp_penalty_d, double, double, DBL_MIN / 4.0, sqrt(a[i]))
+STRESS_FP_PENALTY_KIND(fp_penalty_v4f, stress_fp_v4f_t, float, FLT_MIN / 4.0, a[i] * b[i])
+STRESS_FP_PENALTY_KIND(fp_penalty_v2d, stress_fp_v2d_t, double, DBL_MIN / 4.0, a[i] * b[i])
+#endif
+
+typedef struct {
+	const char *name;
+	double (*run)(const stress_args_t *args, const size_t op, const int class);
+	bool simd;
+} stress_fp_penalty_kind_t;
+
+static const stress_fp_penalty_kind_t fp_penalty_kinds[] = {
+	{ "float",	fp_penalty_f_run,	false },
+	{ "double",	fp_penalty_d_run,	false },
+	{ "float4",	fp_penalty_v4f_run,	true },
+	{ "double2",	fp_penalty_v2d_run,	true },
+};
+
+/*
+ *  stress_fp_penalty()
+ *	measure the slowdown of operations on denormal, infinity and
+ *	NaN operands against normal operands, with and without flush
+ *	to zero and denormals are zero
+ */
+static int stress_fp_penalty(const stress_args_t *args)
+{
+	const uint32_t saved = stress_fp_ftz_get();
+	bool ftz = true;
+	double max_denorm[2] = { 0.0, 0.0 }, max_ftz = 0.0, max_inf = 0.0, max_nan = 0.0;
+	size_t k, op;
+
+	if (args->instance != 0) {
+		/* one benchmarking instance, others would skew the results */
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		while (keep_stressing(args))
+			(void)shim_usleep(100000);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return EXIT_SUCCESS;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	pr_inf("%s: ns per operation on normal operands and the slowdown on other operands:\n",
+		args->name);
+	pr_inf("%s: %-8s %-4s %8s %9s %9s %9s %9s\n", args->name,
+		"type", "op", "normal", "denormal", "FTZ/DAZ", "inf", "nan");
+
+	for (k = 0; k < SIZEOF_ARRAY(fp_penalty_kinds); k++) {
+		const stress_fp_penalty_kind_t *kind = &fp_penalty_kinds[k];
+
+		for (op = 0; (op < FP_PENALTY_OPS) && keep_stressing(args); op++) {
+			double ns[FP_PENALTY_CLASSES], ns_ftz = -1.0;
+			char ftz_str[16];
+			int class;
+
+#if !defined(HAVE_FP_PENALTY_SQRT_ASM)
+			if (kind->simd && (op == FP_PENALTY_SQRT))
+				continue;
+#endif
+			(void)stress_fp_ftz_set(false);
+			for (class = 0; class < FP_PENALTY_CLASSES; class++)
+				ns[class] = kind->run(args, op, class);
+			if (stress_fp_ftz_set(true) && ftz) {
+				ns_ftz = kind->run(args, op, FP_PENALTY_DENORMAL);
+				(void)stress_fp_ftz_set(false);
+			} else {
+				ftz = false;
+			}
+			if (ns[FP_PENALTY_NORMAL] <= 0.0)
+				continue;
+
+			if (ns_ftz > 0.0)
+				(void)snprintf(ftz_str, sizeof(ftz_str), "%8.2fx",
+					ns_ftz / ns[FP_PENALTY_NORMAL]);
+			else
+				(void)shim_strlcpy(ftz_str, "-", sizeof(ftz_str));
+
+			pr_inf("%s: %-8s %-4s %8.3f %8.2fx %9s %8.2fx %8.2fx\n", args->name,
+				kind->name, fp_penalty_ops[op], ns[FP_PENALTY_NORMAL],
+				ns[FP_PENALTY_DENORMAL] / ns[FP_PENALTY_NORMAL], ftz_str,
+				ns[FP_PENALTY_INF] / ns[FP_PENALTY_NORMAL],
+				ns[FP_PENALTY_NAN] / ns[FP_PENALTY_NORMAL]);
+
+			max_denorm[kind->simd] = STRESS_MAXIMUM(max_denorm[kind->simd],
+				ns[FP_PENALTY_DENORMAL] / ns[FP_PENALTY_NORMAL]);
+			if (ns_ftz > 0.0)
+				max_ftz = STRESS_MAXIMUM(max_ftz, ns_ftz / ns[FP_PENALTY_NORMAL]);
+			max_inf = STRESS_MAXIMUM(max_inf, ns[FP_PENALTY_INF] / ns[FP_PENALTY_NORMAL]);
+			max_nan = STRESS_MAXIMUM(max_nan, ns[FP_PENALTY_NAN] / ns[FP_PENALTY_NORMAL]);
+		}
+	}
+	stress_fp_ftz_restore(saved);
+
+	pr_inf("%s: float4 and double2 are 128 bit vectors, fma is fused only when "
+		"the build targets FMA\n", args->name);
+
+	stress_misc_stats_set(args->misc_stats, 0, "max scalar denormal slowdown", max_denorm[0]);
+	stress_misc_stats_set(args->misc_stats, 1, "max SIMD denormal slowdown", max_denorm[1]);
+	stress_misc_stats_set(args->misc_stats, 2, "max infinity slowdown", max_inf);
+	stress_misc_stats_set(args->misc_stats, 3, "max NaN slowdown", max_nan);
+	if (ftz)
+		stress_misc_stats_set(args->misc_stats, 4, "max FTZ/DAZ denormal slowdown", max_ftz);
+
+	while (keep_stressing(args))
+		(void)shim_usleep(100000);
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_fp_error()
  *	stress floating point error handling
  */
 static int stress_fp_error(const stress_args_t *args)
 {
+	bool fp_error_penalty = false;
+
+	(void)stress_get_setting("fp-error-penalty", &fp_error_penalty);
+	if (fp_error_penalty)
+		return stress_fp_penalty(args);
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -220,12 +646,14 @@ stressor_info_t stress_fp_error_info = {
 	.stressor = stress_fp_error,
 	.class = CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_fp_error_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
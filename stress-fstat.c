@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-syscall-stats.h"
 
 #define MAX_FSTAT_THREADS	(4)
 #define FSTAT_LOOPS		(16)
@@ -99,11 +100,19 @@ static void stress_fstat_helper(const stress_ctxt_t *ctxt)
 	shim_statx_t bufx;
 #endif
 	stress_stat_info_t *si = ctxt->si;
+	uint64_t sc_t;
+	int ret;
 
-	if ((stat(si->path, &buf) < 0) && (errno != ENOMEM)) {
+	sc_t = stress_syscall_stats_start();
+	ret = stat(si->path, &buf);
+	stress_syscall_stats_end(STRESS_SYSCALL_STAT, sc_t);
+	if ((ret < 0) && (errno != ENOMEM)) {
 		si->ignore |= IGNORE_STAT;
 	}
-	if ((lstat(si->path, &buf) < 0) && (errno != ENOMEM)) {
+	sc_t = stress_syscall_stats_start();
+	ret = lstat(si->path, &buf);
+	stress_syscall_stats_end(STRESS_SYSCALL_LSTAT, sc_t);
+	if ((ret < 0) && (errno != ENOMEM)) {
 		si->ignore |= IGNORE_LSTAT;
 	}
 #if defined(AT_EMPTY_PATH) &&	\
@@ -141,7 +150,10 @@ static void stress_fstat_helper(const stress_ctxt_t *ctxt)
 			si->access = false;
 			return;
 		}
-		if ((fstat(fd, &buf) < 0) && (errno != ENOMEM))
+		sc_t = stress_syscall_stats_start();
+		ret = fstat(fd, &buf);
+		stress_syscall_stats_end(STRESS_SYSCALL_FSTAT, sc_t);
+		if ((ret < 0) && (errno != ENOMEM))
 			si->ignore |= IGNORE_FSTAT;
 		(void)close(fd);
 	}
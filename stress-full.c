@@ -154,6 +154,8 @@ stressor_info_t stress_full_info = {
 	.stressor = stress_full,
 	.class = CLASS_DEV | CLASS_MEMORY | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.thread_safe = true,
+	.harness_adjust = true,
 	.help = help
 };
 #else
@@ -18,15 +18,63 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_LINUX_FUTEX_H)
 #include <linux/futex.h>
 #endif
 
+#define MIN_FUTEX_THREADS	(1)
+#define MAX_FUTEX_THREADS	(256)
+
 static const stress_help_t help[] = {
-	{ NULL,	"futex N",	"start N workers exercising a fast mutex" },
-	{ NULL,	"futex-ops N",	"stop after N fast mutex bogo operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"futex N",		"start N workers exercising a fast mutex" },
+	{ NULL,	"futex-method M",	"futex mode, wait or pi, requeue, waitv, hash or all scalability" },
+	{ NULL,	"futex-ops N",		"stop after N fast mutex bogo operations" },
+	{ NULL,	"futex-threads N",	"sweep 1 to N threads in the scalability modes" },
+	{ NULL,	NULL,			NULL }
+};
+
+/* method names, the scalability modes follow "all" */
+static const char * const futex_methods[] = {
+	"wait",
+	"all",
+	"pi",
+	"requeue",
+	"waitv",
+	"hash",
+};
+
+static int stress_set_futex_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(futex_methods); i++) {
+		if (!strcmp(opt, futex_methods[i]))
+			return stress_set_setting("futex-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "futex-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(futex_methods); i++)
+		(void)fprintf(stderr, " %s", futex_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_futex_threads(const char *opt)
+{
+	uint32_t futex_threads;
+
+	futex_threads = stress_get_uint32(opt);
+	stress_check_range("futex-threads", (uint64_t)futex_threads,
+		MIN_FUTEX_THREADS, MAX_FUTEX_THREADS);
+	return stress_set_setting("futex-threads", TYPE_ID_UINT32, &futex_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_futex_method,	stress_set_futex_method },
+	{ OPT_futex_threads,	stress_set_futex_threads },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_LINUX_FUTEX_H) &&	\
@@ -83,6 +131,694 @@ static int stress_futex_wait(uint32_t *futex, const int val, const long nsec)
 	return shim_futex_wait(futex, val, &t);
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+
+#define FUTEX_METHODS		(SIZEOF_ARRAY(futex_methods) - 2)
+#define FUTEX_STEP		(0.2)		/* seconds per method and thread count */
+#define FUTEX_MAX_COUNTS	(10)		/* 1, 2, 4 .. 256 and the maximum */
+#define FUTEX_TIMEOUT_NS	(10000000)	/* wait timeout so stop is noticed */
+#define FUTEX_HASH_SLOTS	(256)		/* independent futexes per hash pair */
+#define FUTEX_WAITV_SLOTS	(8)		/* futexes per waitv wait */
+#define FUTEX_PI_CS_LINES	(4)		/* cache lines written holding the PI lock */
+#define FUTEX_THINK		(64)		/* loops between PI lock acquisitions */
+
+/* a futex word and the time it was last woken, one per cache line */
+typedef struct {
+	uint32_t word;
+	uint64_t ts;
+} ALIGN64 stress_futex_slot_t;
+
+/* state shared by all the threads of a step */
+typedef struct {
+	uint32_t pi ALIGN64;			/* PI lock, 0 or owner tid */
+	uint64_t release_ts;			/* time of the last PI unlock */
+	uint64_t cs[FUTEX_PI_CS_LINES * 8] ALIGN64;	/* PI critical section data */
+	uint32_t owner;				/* current PI owner, 0 is none */
+	uint64_t violations;			/* mutual exclusions violated */
+
+	uint32_t cond ALIGN64;			/* requeue condvar sequence */
+	uint32_t mutex ALIGN64;			/* requeue mutex, 0, 1 or 2 */
+	uint32_t waiting ALIGN64;		/* requeue waiters ready */
+	uint32_t n_waiters;			/* requeue waiters started */
+	uint64_t broadcast_ts;			/* time of the last broadcast */
+
+	volatile bool start ALIGN64;		/* start the step */
+	volatile bool stop;			/* end the step */
+	volatile bool unsupported;		/* kernel lacks the futex op */
+} stress_futex_bench_t;
+
+/* per thread state */
+typedef struct {
+	stress_futex_bench_t *fb;
+	stress_futex_slot_t *slots;		/* pair slots, hash and waitv */
+	uint32_t n_slots;
+	uint32_t id;				/* thread id, 1 upwards */
+	bool first;				/* first sender of the pair */
+	uint64_t ops;
+	uint64_t wakes;				/* operations that slept */
+	uint64_t wake_ns;			/* total wake latency */
+	uint64_t wake_max;			/* slowest wake */
+	pthread_t pthread;
+	int ret;
+} ALIGN64 stress_futex_thread_t;
+
+/* sweep totals per method and thread count */
+typedef struct {
+	uint32_t threads;			/* threads that ran */
+	uint64_t ops;
+	double duration;
+	uint64_t steps;
+	uint64_t wakes;
+	uint64_t wake_ns;
+	uint64_t wake_max;
+} stress_futex_stats_t;
+
+typedef struct {
+	void *(*func)(void *arg);		/* thread function */
+	uint32_t (*threads)(const uint32_t n);	/* threads needed for n */
+	uint32_t n_slots;			/* pair slots per pair */
+} stress_futex_impl_t;
+
+static inline long stress_futex_op(
+	uint32_t *uaddr,
+	const int op,
+	const uint32_t val,
+	const struct timespec *timeout,
+	uint32_t *uaddr2,
+	const uint32_t val3)
+{
+	return syscall(__NR_futex, uaddr, op, val, timeout, uaddr2, val3);
+}
+
+static inline void stress_futex_wake_record(
+	stress_futex_thread_t *t,
+	const uint64_t ns)
+{
+	t->wakes++;
+	t->wake_ns += ns;
+	if (t->wake_max < ns)
+		t->wake_max = ns;
+}
+
+static void stress_futex_thread_init(void)
+{
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+}
+
+static void stress_futex_wait_start(const stress_futex_bench_t *fb)
+{
+	while (!fb->start && !fb->stop)
+		shim_sched_yield();
+}
+
+static uint32_t stress_futex_threads_n(const uint32_t n)
+{
+	return n;
+}
+
+static uint32_t stress_futex_threads_requeue(const uint32_t n)
+{
+	/* n waiters and a broadcaster */
+	return n + 1;
+}
+
+static uint32_t stress_futex_threads_pairs(const uint32_t n)
+{
+	/* waker and waiter pairs */
+	return (n + 1) & ~1U;
+}
+
+#if defined(FUTEX_LOCK_PI) &&	\
+    defined(FUTEX_UNLOCK_PI)
+/*
+ *  stress_futex_pi_thread()
+ *	contend on a priority inheritance futex lock, the uncontended
+ *	path is a user space compare and swap of the tid, time the
+ *	handoff from the previous owner's unlock when the lock had
+ *	to be taken in the kernel
+ */
+static void *stress_futex_pi_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_thread_t *t = (stress_futex_thread_t *)arg;
+	stress_futex_bench_t *fb = t->fb;
+	const uint32_t tid = (uint32_t)shim_gettid();
+
+	stress_futex_thread_init();
+	stress_futex_wait_start(fb);
+
+	while (!fb->stop) {
+		uint32_t expected = 0;
+		volatile uint32_t i;
+		size_t j;
+
+		if (!__atomic_compare_exchange_n(&fb->pi, &expected, tid, false,
+				__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			struct timespec ts;
+
+			/* FUTEX_LOCK_PI takes an absolute CLOCK_REALTIME timeout */
+			(void)clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += FUTEX_TIMEOUT_NS;
+			if (ts.tv_nsec >= STRESS_NANOSECOND) {
+				ts.tv_sec++;
+				ts.tv_nsec -= STRESS_NANOSECOND;
+			}
+			if (stress_futex_op(&fb->pi, FUTEX_LOCK_PI, 0, &ts, NULL, 0) < 0) {
+				if (errno == ENOSYS) {
+					fb->unsupported = true;
+					break;
+				}
+				continue;
+			}
+			stress_futex_wake_record(t, stress_latency_now() - fb->release_ts);
+		}
+		if (fb->owner)
+			fb->violations++;
+		fb->owner = t->id;
+		for (j = 0; j < FUTEX_PI_CS_LINES; j++)
+			fb->cs[j * 8]++;
+		if (fb->owner != t->id)
+			fb->violations++;
+		fb->owner = 0;
+		fb->release_ts = stress_latency_now();
+
+		expected = tid;
+		if (!__atomic_compare_exchange_n(&fb->pi, &expected, 0, false,
+				__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			(void)stress_futex_op(&fb->pi, FUTEX_UNLOCK_PI, 0, NULL, NULL, 0);
+		t->ops++;
+
+		for (i = 0; i < FUTEX_THINK; i++)
+			;
+	}
+	return &nowt;
+}
+#else
+static void *stress_futex_pi_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_thread_t *t = (stress_futex_thread_t *)arg;
+
+	t->fb->unsupported = true;
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_futex_mutex_lock()
+ *	3 state futex mutex lock, always leave it marked as contended
+ *	as requeued waiters may be queued on it
+ */
+static void stress_futex_mutex_lock(uint32_t *mutex)
+{
+	while (__atomic_exchange_n(mutex, 2, __ATOMIC_ACQUIRE) != 0)
+		(void)shim_futex_wait(mutex, 2, NULL);
+}
+
+static void stress_futex_mutex_unlock(uint32_t *mutex)
+{
+	if (__atomic_fetch_sub(mutex, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n(mutex, 0, __ATOMIC_RELEASE);
+		(void)shim_futex_wake(mutex, 1);
+	}
+}
+
+#if defined(FUTEX_CMP_REQUEUE)
+/*
+ *  stress_futex_requeue_thread()
+ *	thread 1 broadcasts a condition variable once all the waiters
+ *	are waiting, waking one waiter and requeueing the rest onto the
+ *	mutex with FUTEX_CMP_REQUEUE. The waiters time from the broadcast
+ *	to owning the mutex, which serializes the thundering herd.
+ */
+static void *stress_futex_requeue_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_thread_t *t = (stress_futex_thread_t *)arg;
+	stress_futex_bench_t *fb = t->fb;
+
+	stress_futex_thread_init();
+	stress_futex_wait_start(fb);
+
+	if (t->id == 1) {
+		while (!fb->stop) {
+			uint32_t waiting, seq;
+
+			waiting = __atomic_load_n(&fb->waiting, __ATOMIC_ACQUIRE);
+			if (waiting < fb->n_waiters) {
+				const struct timespec ts = { 0, FUTEX_TIMEOUT_NS };
+
+				(void)shim_futex_wait(&fb->waiting, (int)waiting, &ts);
+				continue;
+			}
+			stress_futex_mutex_lock(&fb->mutex);
+			fb->waiting = 0;
+			fb->broadcast_ts = stress_latency_now();
+			seq = __atomic_add_fetch(&fb->cond, 1, __ATOMIC_RELEASE);
+			if (stress_futex_op(&fb->cond, FUTEX_CMP_REQUEUE, 1,
+					(const struct timespec *)(uintptr_t)INT_MAX,
+					&fb->mutex, seq) < 0) {
+				if (errno == ENOSYS)
+					fb->unsupported = true;
+			}
+			stress_futex_mutex_unlock(&fb->mutex);
+		}
+		/* release any waiters still waiting on the condition */
+		(void)__atomic_add_fetch(&fb->cond, 1, __ATOMIC_RELEASE);
+		(void)shim_futex_wake(&fb->cond, INT_MAX);
+		return &nowt;
+	}
+
+	stress_futex_mutex_lock(&fb->mutex);
+	for (;;) {
+		const uint32_t seq = __atomic_load_n(&fb->cond, __ATOMIC_ACQUIRE);
+		const uint32_t waiting = __atomic_add_fetch(&fb->waiting, 1, __ATOMIC_RELEASE);
+
+		stress_futex_mutex_unlock(&fb->mutex);
+		if (waiting == fb->n_waiters)
+			(void)shim_futex_wake(&fb->waiting, 1);
+
+		while (__atomic_load_n(&fb->cond, __ATOMIC_ACQUIRE) == seq) {
+			const struct timespec ts = { 0, FUTEX_TIMEOUT_NS };
+
+			if (fb->stop || fb->unsupported)
+				return &nowt;
+			(void)shim_futex_wait(&fb->cond, (int)seq, &ts);
+		}
+		stress_futex_mutex_lock(&fb->mutex);
+		stress_futex_wake_record(t, stress_latency_now() - fb->broadcast_ts);
+		t->ops++;
+		if (fb->stop) {
+			stress_futex_mutex_unlock(&fb->mutex);
+			break;
+		}
+	}
+	return &nowt;
+}
+#else
+static void *stress_futex_requeue_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_thread_t *t = (stress_futex_thread_t *)arg;
+
+	t->fb->unsupported = true;
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_futex_pingpong_send()
+ *	pass turn k to the partner on slot s, setting the slot futex to
+ *	k + 1 and waking it
+ */
+static inline void stress_futex_pingpong_send(
+	stress_futex_thread_t *t,
+	const uint32_t k,
+	const uint32_t s)
+{
+	stress_futex_slot_t *slot = &t->slots[s];
+
+	slot->ts = stress_latency_now();
+	__atomic_store_n(&slot->word, k + 1, __ATOMIC_RELEASE);
+	(void)shim_futex_wake(&slot->word, 1);
+	t->ops++;
+}
+
+/*
+ *  stress_futex_hash_recv()
+ *	wait for turn k on slot s, returns false when the step ends
+ */
+static bool stress_futex_hash_recv(
+	stress_futex_thread_t *t,
+	const uint32_t k,
+	const uint32_t s)
+{
+	stress_futex_slot_t *slot = &t->slots[s];
+	bool slept = false;
+
+	for (;;) {
+		const uint32_t val = __atomic_load_n(&slot->word, __ATOMIC_ACQUIRE);
+		const struct timespec ts = { 0, FUTEX_TIMEOUT_NS };
+
+		if (val == k + 1)
+			break;
+		if (t->fb->stop)
+			return false;
+		(void)shim_futex_wait(&slot->word, (int)val, &ts);
+		slept = true;
+	}
+	if (slept)
+		stress_futex_wake_record(t, stress_latency_now() - slot->ts);
+	return true;
+}
+
+/*
+ *  stress_futex_hash_thread()
+ *	pairs of threads ping-pong turns, turn k using the futex in
+ *	slot k modulo FUTEX_HASH_SLOTS so many independent futexes
+ *	are live at once and collide in the kernel futex hash buckets
+ */
+static void *stress_futex_hash_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_thread_t *t = (stress_futex_thread_t *)arg;
+	uint32_t k;
+
+	stress_futex_thread_init();
+	stress_futex_wait_start(t->fb);
+
+	for (k = 0; !t->fb->stop; k += 2) {
+		if (t->first) {
+			stress_futex_pingpong_send(t, k, k % t->n_slots);
+			if (!stress_futex_hash_recv(t, k + 1, (k + 1) % t->n_slots))
+				break;
+		} else {
+			if (!stress_futex_hash_recv(t, k, k % t->n_slots))
+				break;
+			stress_futex_pingpong_send(t, k + 1, (k + 1) % t->n_slots);
+		}
+	}
+	return &nowt;
+}
+
+#if defined(FUTEX_32) &&	\
+    defined(CLOCK_MONOTONIC)
+/* slot of turn k, scattered over the FUTEX_WAITV_SLOTS slots */
+static inline uint32_t stress_futex_waitv_slot(const uint32_t k)
+{
+	return (k * 2654435761U) >> 29;
+}
+
+/*
+ *  stress_futex_waitv_recv()
+ *	wait for turn k on any of the slots with futex_waitv, returns
+ *	false when the step ends
+ */
+static bool stress_futex_waitv_recv(
+	stress_futex_thread_t *t,
+	const uint32_t k)
+{
+	stress_futex_slot_t *slot = &t->slots[stress_futex_waitv_slot(k)];
+	struct shim_futex_waitv w[FUTEX_WAITV_SLOTS];
+	bool slept = false;
+
+	(void)memset(w, 0, sizeof(w));
+	for (;;) {
+		struct timespec ts;
+		uint32_t i;
+
+		for (i = 0; i < FUTEX_WAITV_SLOTS; i++) {
+			w[i].val = __atomic_load_n(&t->slots[i].word, __ATOMIC_ACQUIRE);
+			w[i].uaddr = (uintptr_t)&t->slots[i].word;
+			w[i].flags = FUTEX_32;
+		}
+		if (__atomic_load_n(&slot->word, __ATOMIC_ACQUIRE) == k + 1)
+			break;
+		if (t->fb->stop)
+			return false;
+		if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+			return false;
+		ts.tv_nsec += FUTEX_TIMEOUT_NS;
+		if (ts.tv_nsec >= STRESS_NANOSECOND) {
+			ts.tv_sec++;
+			ts.tv_nsec -= STRESS_NANOSECOND;
+		}
+		if ((shim_futex_waitv(w, FUTEX_WAITV_SLOTS, 0, &ts, CLOCK_MONOTONIC) < 0) &&
+		    (errno == ENOSYS)) {
+			t->fb->unsupported = true;
+			return false;
+		}
+		slept = true;
+	}
+	if (slept)
+		stress_futex_wake_record(t, stress_latency_now() - slot->ts);
+	return true;
+}
+
+/*
+ *  stress_futex_waitv_thread()
+ *	pairs of threads ping-pong turns, each wait is on all the pair
+ *	slots with futex_waitv and the turn is woken on one of them
+ */
+static void *stress_futex_waitv_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_thread_t *t = (stress_futex_thread_t *)arg;
+	uint32_t k;
+
+	stress_futex_thread_init();
+	stress_futex_wait_start(t->fb);
+
+	for (k = 0; !t->fb->stop; k += 2) {
+		if (t->first) {
+			stress_futex_pingpong_send(t, k, stress_futex_waitv_slot(k));
+			if (!stress_futex_waitv_recv(t, k + 1))
+				break;
+		} else {
+			if (!stress_futex_waitv_recv(t, k))
+				break;
+			stress_futex_pingpong_send(t, k + 1, stress_futex_waitv_slot(k + 1));
+		}
+	}
+	return &nowt;
+}
+#else
+static void *stress_futex_waitv_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_thread_t *t = (stress_futex_thread_t *)arg;
+
+	t->fb->unsupported = true;
+	return &nowt;
+}
+#endif
+
+/* implementations, in futex_methods order after "all" */
+static const stress_futex_impl_t futex_impls[] = {
+	{ stress_futex_pi_thread,	stress_futex_threads_n,		0 },
+	{ stress_futex_requeue_thread,	stress_futex_threads_requeue,	0 },
+	{ stress_futex_waitv_thread,	stress_futex_threads_pairs,	FUTEX_WAITV_SLOTS },
+	{ stress_futex_hash_thread,	stress_futex_threads_pairs,	FUTEX_HASH_SLOTS },
+};
+
+/*
+ *  stress_futex_step()
+ *	run the threads of one futex mode for FUTEX_STEP seconds and
+ *	add the results to stats, returns -1 if the mode is not available
+ */
+static int stress_futex_step(
+	const stress_args_t *args,
+	stress_futex_bench_t *fb,
+	stress_futex_thread_t *threads,
+	stress_futex_slot_t *slots,
+	const size_t method,
+	const uint32_t n_threads,
+	stress_futex_stats_t *stats)
+{
+	const stress_futex_impl_t *impl = &futex_impls[method];
+	uint64_t ops = 0;
+	uint32_t i, started = 0;
+	double t_start, duration;
+
+	(void)memset(fb, 0, sizeof(*fb));
+	if (impl->n_slots)
+		(void)memset(slots, 0, sizeof(*slots) * impl->n_slots * ((n_threads + 1) / 2));
+
+	for (i = 0; i < n_threads; i++) {
+		stress_futex_thread_t *t = &threads[i];
+
+		(void)memset(t, 0, sizeof(*t));
+		t->fb = fb;
+		t->id = i + 1;
+		t->first = !(i & 1);
+		t->n_slots = impl->n_slots;
+		t->slots = &slots[(i / 2) * impl->n_slots];
+		t->ret = pthread_create(&t->pthread, NULL, impl->func, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+	/* requeue thread 1 is the broadcaster */
+	fb->n_waiters = started ? started - 1 : 0;
+
+	t_start = stress_time_now();
+	fb->start = true;
+	shim_mb();
+	(void)shim_usleep((uint64_t)(FUTEX_STEP * 1000000.0));
+	fb->stop = true;
+	shim_mb();
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	duration = stress_time_now() - t_start;
+
+	if (fb->unsupported)
+		return -1;
+	if (!started)
+		return 0;
+	if (fb->violations) {
+		pr_fail("%s: %s lock allowed %" PRIu64 " mutual exclusion violations\n",
+			args->name, futex_methods[method + 2], fb->violations);
+	}
+
+	for (i = 0; i < started; i++) {
+		const stress_futex_thread_t *t = &threads[i];
+
+		ops += t->ops;
+		stats->wakes += t->wakes;
+		stats->wake_ns += t->wake_ns;
+		if (stats->wake_max < t->wake_max)
+			stats->wake_max = t->wake_max;
+	}
+	stats->threads = started;
+	stats->ops += ops;
+	stats->duration += duration;
+	stats->steps++;
+	add_counter(args, ops);
+
+	return 0;
+}
+
+/*
+ *  stress_futex_bench()
+ *	sweep the futex scalability modes over 1, 2, 4 .. N threads
+ */
+static int stress_futex_bench(const stress_args_t *args, const size_t futex_method)
+{
+	static stress_futex_stats_t stats[FUTEX_METHODS][FUTEX_MAX_COUNTS];
+	bool available[FUTEX_METHODS];
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t futex_threads = (cpus > 1) ? (uint32_t)cpus : 4;
+	uint32_t counts[FUTEX_MAX_COUNTS], n, max_threads;
+	size_t i, j, n_counts = 0, idx = 0, threads_size, slots_size;
+	stress_futex_thread_t *threads;
+	stress_futex_slot_t *slots;
+	stress_futex_bench_t *fb;
+
+	if (!stress_get_setting("futex-threads", &futex_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			futex_threads = MAX_FUTEX_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			futex_threads = MIN_FUTEX_THREADS;
+	}
+	if (futex_threads > MAX_FUTEX_THREADS)
+		futex_threads = MAX_FUTEX_THREADS;
+
+	/* 1, 2, 4 .. up to and including futex_threads */
+	for (n = 1; (n < futex_threads) && (n_counts < FUTEX_MAX_COUNTS - 1); n <<= 1)
+		counts[n_counts++] = n;
+	counts[n_counts++] = futex_threads;
+
+	max_threads = futex_threads + 2;
+	threads_size = sizeof(*threads) * max_threads;
+	slots_size = sizeof(*slots) * FUTEX_HASH_SLOTS * (max_threads / 2);
+
+	threads = (stress_futex_thread_t *)mmap(NULL, threads_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %" PRIu32 " thread states, skipping stressor\n",
+			args->name, max_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	slots = (stress_futex_slot_t *)mmap(NULL, slots_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (slots == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap futex slots, skipping stressor\n", args->name);
+		(void)munmap((void *)threads, threads_size);
+		return EXIT_NO_RESOURCE;
+	}
+	fb = (stress_futex_bench_t *)mmap(NULL, sizeof(*fb), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (fb == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap futex state, skipping stressor\n", args->name);
+		(void)munmap((void *)slots, slots_size);
+		(void)munmap((void *)threads, threads_size);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	for (i = 0; i < FUTEX_METHODS; i++)
+		available[i] = (futex_method == 1) || (futex_method == i + 2);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < FUTEX_METHODS); i++) {
+			uint32_t prev = 0;
+
+			if (!available[i])
+				continue;
+			for (j = 0; keep_stressing(args) && (j < n_counts); j++) {
+				const uint32_t n_threads = futex_impls[i].threads(counts[j]);
+
+				/* pairs round 1 up to 2, don't run it twice */
+				if (n_threads == prev)
+					continue;
+				prev = n_threads;
+				if (stress_futex_step(args, fb, threads, slots, i, n_threads, &stats[i][j]) < 0) {
+					if (args->instance == 0)
+						pr_inf("%s: futex %s is not available\n",
+							args->name, futex_methods[i + 2]);
+					available[i] = false;
+					break;
+				}
+			}
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: method    threads      ops/s    wake ns  wake max us\n",
+			args->name);
+	for (i = 0; i < FUTEX_METHODS; i++) {
+		const stress_futex_stats_t *top = NULL;
+
+		for (j = 0; j < n_counts; j++) {
+			const stress_futex_stats_t *st = &stats[i][j];
+
+			if (!st->steps)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %-10s %6" PRIu32 " %10.0f %10.1f %12.1f\n",
+					args->name, futex_methods[i + 2], st->threads,
+					(st->duration > 0.0) ? (double)st->ops / st->duration : 0.0,
+					st->wakes ? (double)st->wake_ns / (double)st->wakes : 0.0,
+					(double)st->wake_max / 1000.0);
+			top = st;
+		}
+		/* rate and wake latency at the highest thread count per mode */
+		if (top && (top->duration > 0.0) && (idx < STRESS_MISC_STATS_MAX - 1)) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s ops/s", futex_methods[i + 2]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				(double)top->ops / top->duration);
+			(void)snprintf(desc, sizeof(desc), "%s wake ns", futex_methods[i + 2]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				top->wakes ? (double)top->wake_ns / (double)top->wakes : 0.0);
+		}
+	}
+
+	(void)munmap((void *)fb, sizeof(*fb));
+	(void)munmap((void *)slots, slots_size);
+	(void)munmap((void *)threads, threads_size);
+
+	return EXIT_SUCCESS;
+}
+#else
+static int stress_futex_bench(const stress_args_t *args, const size_t futex_method)
+{
+	(void)futex_method;
+
+	if (args->instance == 0)
+		pr_inf_skip("%s: futex scalability modes need pthread and atomic "
+			"support, skipping stressor\n", args->name);
+	return EXIT_NOT_IMPLEMENTED;
+}
+#endif
+
 /*
  *  stress_futex()
  *	stress system by futex calls. The intention is not to
@@ -93,8 +829,13 @@ static int stress_futex(const stress_args_t *args)
 {
 	uint64_t *timeout = &g_shared->futex.timeout[args->instance];
 	uint32_t *futex = &g_shared->futex.futex[args->instance];
+	size_t futex_method = 0;
 	pid_t pid;
 
+	(void)stress_get_setting("futex-method", &futex_method);
+	if (futex_method)
+		return stress_futex_bench(args, futex_method);
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 again:
 	pid = fork();
@@ -133,6 +874,7 @@ again:
 
 		pr_dbg("%s: futex timeouts: %" PRIu64 "\n",
 			args->name, *timeout);
+		stress_latency_misc_stats(args, 0, "wait");
 	} else {
 		uint64_t threshold = THRESHOLD;
 
@@ -142,11 +884,13 @@ again:
 		do {
 			/* Small timeout to force rapid timer wakeups */
 			int ret;
+			uint64_t t;
 
 			/* Break early before potential long wait */
 			if (!keep_stressing_flag())
 				break;
 
+			t = stress_latency_now();
 			ret = stress_futex_wait(futex, 0, 5000);
 
 			/* timeout, re-do, stress on stupid fast polling */
@@ -161,6 +905,8 @@ again:
 					threshold += THRESHOLD;
 				}
 			} else {
+				if (ret == 0)
+					stress_latency_record(args->latency, stress_latency_now() - t);
 				if ((ret < 0) && (g_opt_flags & OPT_FLAGS_VERIFY)) {
 					if (errno != EINTR) {
 						pr_fail("%s: futex_wait failed, errno=%d (%s)\n",
@@ -180,6 +926,7 @@ finish:
 stressor_info_t stress_futex_info = {
 	.stressor = stress_futex,
 	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -187,6 +934,7 @@ stressor_info_t stress_futex_info = {
 stressor_info_t stress_futex_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
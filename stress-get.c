@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-syscall-stats.h"
 #include "core-capabilities.h"
 
 #if defined(HAVE_LINUX_SYSCTL_H)
@@ -198,6 +199,7 @@ static int stress_get(const stress_args_t *args)
 		struct timezone tz;
 		struct rlimit rlim;
 		time_t t, t1, t2;
+		uint64_t sc_t;
 
 		(void)mypid;
 
@@ -269,7 +271,9 @@ static int stress_get(const stress_args_t *args)
 		UNEXPECTED
 #endif
 
+		sc_t = stress_syscall_stats_start();
 		ptr = getcwd(path, sizeof path);
+		stress_syscall_stats_end(STRESS_SYSCALL_GETCWD, sc_t);
 		if (verify) {
 			if (!ptr) {
 				pr_fail("%s: getcwd %s failed, errno=%d (%s)%s\n",
@@ -303,7 +307,9 @@ static int stress_get(const stress_args_t *args)
 		/*
 		 *  Try to get GIDS_MAX number of gids
 		 */
+		sc_t = stress_syscall_stats_start();
 		ret = getgroups(GIDS_MAX, gids);
+		stress_syscall_stats_end(STRESS_SYSCALL_GETGROUPS, sc_t);
 		if (verify && (ret < 0) && (errno != EINVAL))
 			pr_fail("%s: getgroups failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
@@ -412,7 +418,9 @@ static int stress_get(const stress_args_t *args)
 		(void)getrlimit((shim_rlimit_resource_t)INT_MAX, &rlim);
 
 		for (i = 0; i < SIZEOF_ARRAY(rlimits); i++) {
+			sc_t = stress_syscall_stats_start();
 			ret = getrlimit(rlimits[i], &rlim);
+			stress_syscall_stats_end(STRESS_SYSCALL_GETRLIMIT, sc_t);
 			if (verify && (ret < 0))
 				pr_fail("%s: getrlimit(%zu, ..) failed, errno=%d (%s)\n",
 					args->name, i, errno, strerror(errno));
@@ -575,7 +583,9 @@ static int stress_get(const stress_args_t *args)
 		 *  The following gettimeofday calls probably use the VDSO
 		 *  on Linux
 		 */
+		sc_t = stress_syscall_stats_start();
 		ret = gettimeofday(&tv, NULL);
+		stress_syscall_stats_end(STRESS_SYSCALL_GETTIMEOFDAY, sc_t);
 		if (ret < 0) {
 			pr_fail("%s: gettimeval failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
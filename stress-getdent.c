@@ -27,10 +27,53 @@
 #define HAVE_GETDENTS64
 #endif
 
+#define MIN_GETDENT_ENTRIES	(1000)
+#define MAX_GETDENT_ENTRIES	(10000000)
+#define DEFAULT_GETDENT_ENTRIES	(100000)
+
+#define MIN_GETDENT_READERS	(1)
+#define MAX_GETDENT_READERS	(64)
+#define DEFAULT_GETDENT_READERS	(8)
+
 static const stress_help_t help[] = {
-	{ NULL,	"getdent N",	 "start N workers reading directories using getdents" },
-	{ NULL,	"getdent-ops N", "stop after N getdents bogo operations" },
-	{ NULL,	NULL,		 NULL }
+	{ NULL,	"getdent N",		"start N workers reading directories using getdents" },
+	{ NULL,	"getdent-bench",	"measure enumeration rates of 1K..N entry directories" },
+	{ NULL,	"getdent-entries N",	"largest directory size for --getdent-bench" },
+	{ NULL,	"getdent-ops N",	"stop after N getdents bogo operations" },
+	{ NULL,	"getdent-readers N",	"maximum concurrent readers for --getdent-bench" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_getdent_bench(const char *opt)
+{
+	return stress_set_setting_true("getdent-bench", opt);
+}
+
+static int stress_set_getdent_entries(const char *opt)
+{
+	uint64_t getdent_entries;
+
+	getdent_entries = stress_get_uint64(opt);
+	stress_check_range("getdent-entries", getdent_entries,
+		MIN_GETDENT_ENTRIES, MAX_GETDENT_ENTRIES);
+	return stress_set_setting("getdent-entries", TYPE_ID_UINT64, &getdent_entries);
+}
+
+static int stress_set_getdent_readers(const char *opt)
+{
+	uint32_t getdent_readers;
+
+	getdent_readers = stress_get_uint32(opt);
+	stress_check_range("getdent-readers", (uint64_t)getdent_readers,
+		MIN_GETDENT_READERS, MAX_GETDENT_READERS);
+	return stress_set_setting("getdent-readers", TYPE_ID_UINT32, &getdent_readers);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_getdent_bench,	stress_set_getdent_bench },
+	{ OPT_getdent_entries,	stress_set_getdent_entries },
+	{ OPT_getdent_readers,	stress_set_getdent_readers },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_GETDENTS64) || defined(HAVE_GETDENTS)
@@ -247,6 +290,436 @@ exit_close:
 }
 #endif
 
+#if defined(HAVE_GETDENTS64)
+
+#define GETDENT_BENCH_TIME	(0.25)		/* seconds per warm measurement */
+#define GETDENT_BENCH_MAX_LEVELS (8)
+#define GETDENT_BENCH_MAX_POINTS (8)
+#define GETDENT_BENCH_READER_BUF (64 * KB)	/* concurrent reader buffer size */
+
+enum {
+	GETDENT_BENCH_WARM,
+	GETDENT_BENCH_COLD,
+};
+
+static const size_t getdent_bench_bufs[] = {
+	4 * KB, 16 * KB, 64 * KB, 256 * KB, 1 * MB
+};
+
+#define GETDENT_BENCH_BUFS	SIZEOF_ARRAY(getdent_bench_bufs)
+#define GETDENT_BENCH_READDIR	(GETDENT_BENCH_BUFS)
+#define GETDENT_BENCH_STATX	(GETDENT_BENCH_BUFS + 1)
+#define GETDENT_BENCH_METHODS	(GETDENT_BENCH_BUFS + 2)
+
+typedef struct {
+	uint64_t entries[GETDENT_BENCH_MAX_LEVELS];
+	/* K entries per second, < 0 if not measured */
+	double rate[GETDENT_BENCH_MAX_LEVELS][2][GETDENT_BENCH_METHODS];
+	uint32_t readers[GETDENT_BENCH_MAX_POINTS];
+	double reader_rate[GETDENT_BENCH_MAX_POINTS];
+	size_t n_levels;
+	size_t n_points;
+} stress_getdent_bench_t;
+
+/*
+ *  stress_getdent_bench_getdents()
+ *	count the entries of path with getdents64 and a buf_sz buffer
+ */
+static int64_t stress_getdent_bench_getdents(
+	const char *path,
+	char *buf,
+	const size_t buf_sz)
+{
+	int64_t n = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return -1;
+	for (;;) {
+		char *ptr;
+		const int nread = shim_getdents64((unsigned int)fd,
+			(struct shim_linux_dirent64 *)buf, (unsigned int)buf_sz);
+
+		if (nread < 0) {
+			n = -1;
+			break;
+		}
+		if (nread == 0)
+			break;
+		for (ptr = buf; ptr < buf + nread; n++)
+			ptr += ((struct shim_linux_dirent64 *)ptr)->d_reclen;
+	}
+	(void)close(fd);
+	return n;
+}
+
+/*
+ *  stress_getdent_bench_readdir()
+ *	count the entries of path with readdir, with statx of each
+ *	entry if do_statx is set
+ */
+static int64_t stress_getdent_bench_readdir(const char *path, const bool do_statx)
+{
+	DIR *dir;
+	struct dirent *d;
+	int64_t n = 0;
+
+	dir = opendir(path);
+	if (!dir)
+		return -1;
+	while ((d = readdir(dir)) != NULL) {
+		if (do_statx) {
+			shim_statx_t bufx;
+
+			if (shim_statx(dirfd(dir), d->d_name, AT_SYMLINK_NOFOLLOW,
+					SHIM_STATX_BASIC_STATS, &bufx) < 0) {
+				struct stat statbuf;
+
+				/* statx not available, use fstatat */
+				if (fstatat(dirfd(dir), d->d_name, &statbuf,
+						AT_SYMLINK_NOFOLLOW) < 0) {
+					n = -1;
+					break;
+				}
+			}
+		}
+		n++;
+	}
+	(void)closedir(dir);
+	return n;
+}
+
+static int64_t stress_getdent_bench_scan(
+	const char *path,
+	const size_t method,
+	char *buf)
+{
+	if (method < GETDENT_BENCH_BUFS)
+		return stress_getdent_bench_getdents(path, buf, getdent_bench_bufs[method]);
+	return stress_getdent_bench_readdir(path, method == GETDENT_BENCH_STATX);
+}
+
+/*
+ *  stress_getdent_bench_drop_caches()
+ *	drop the dentry, inode and page caches, needs root
+ */
+static bool stress_getdent_bench_drop_caches(void)
+{
+	(void)sync();
+	return system_write("/proc/sys/vm/drop_caches", "3", 1) >= 0;
+}
+
+/*
+ *  stress_getdent_bench_rate()
+ *	K entries per second of a method, a single scan after dropping
+ *	caches when cold, repeated scans of a cached directory when warm
+ */
+static double stress_getdent_bench_rate(
+	const stress_args_t *args,
+	const char *path,
+	const size_t method,
+	char *buf,
+	const bool cold)
+{
+	double t, dt;
+	uint64_t n = 0;
+
+	if (cold) {
+		if (!stress_getdent_bench_drop_caches())
+			return -1.0;
+	} else if (stress_getdent_bench_scan(path, method, buf) < 0) {
+		return -1.0;
+	}
+	t = stress_time_now();
+	do {
+		const int64_t ret = stress_getdent_bench_scan(path, method, buf);
+
+		if (ret < 0)
+			return -1.0;
+		n += (uint64_t)ret;
+		dt = stress_time_now() - t;
+	} while (!cold && keep_stressing(args) && (dt < GETDENT_BENCH_TIME));
+
+	return (dt > 0.0) ? (double)n / dt / 1000.0 : -1.0;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_t pthread;
+	const stress_args_t *args;
+	const char *path;
+	double rate;		/* K entries per second, < 0 on failure */
+} stress_getdent_bench_reader_t;
+
+/*
+ *  stress_getdent_bench_reader()
+ *	scan the directory with getdents64 for GETDENT_BENCH_TIME seconds
+ */
+static void *stress_getdent_bench_reader(void *arg)
+{
+	stress_getdent_bench_reader_t *r = (stress_getdent_bench_reader_t *)arg;
+	char *buf;
+
+	r->rate = -1.0;
+	buf = (char *)malloc(GETDENT_BENCH_READER_BUF);
+	if (!buf)
+		return NULL;
+	r->rate = stress_getdent_bench_rate(r->args, r->path, 2, buf, false);
+	free(buf);
+	return NULL;
+}
+
+/*
+ *  stress_getdent_bench_readers()
+ *	aggregate K entries per second of n concurrent readers
+ */
+static double stress_getdent_bench_readers(
+	const stress_args_t *args,
+	const char *path,
+	const uint32_t n)
+{
+	static stress_getdent_bench_reader_t readers[MAX_GETDENT_READERS];
+	double rate = 0.0;
+	uint32_t i, started;
+	bool ok = true;
+
+	for (started = 0; started < n; started++) {
+		readers[started].args = args;
+		readers[started].path = path;
+		if (pthread_create(&readers[started].pthread, NULL,
+				stress_getdent_bench_reader, &readers[started]) != 0) {
+			ok = false;
+			break;
+		}
+	}
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(readers[i].pthread, NULL);
+		if (readers[i].rate < 0.0)
+			ok = false;
+		rate += readers[i].rate;
+	}
+	return ok ? rate : -1.0;
+}
+#endif
+
+/*
+ *  stress_getdent_bench_populate()
+ *	grow the directory to n empty files with fixed length names
+ */
+static int stress_getdent_bench_populate(
+	const stress_args_t *args,
+	const int dfd,
+	uint64_t *created,
+	const uint64_t n)
+{
+	while (*created < n) {
+		char name[32];
+		int fd;
+
+		if (((*created & 0x3ff) == 0) && !keep_stressing(args))
+			return 1;
+		(void)snprintf(name, sizeof(name), "%16.16" PRIx64, *created);
+		fd = openat(dfd, name, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR);
+		if (fd < 0)
+			return -1;
+		(void)close(fd);
+		(*created)++;
+	}
+	return 0;
+}
+
+/*
+ *  stress_getdent_bench_unpopulate()
+ *	remove all the files created in the directory
+ */
+static void stress_getdent_bench_unpopulate(const int dfd, const uint64_t created)
+{
+	uint64_t i;
+
+	for (i = 0; i < created; i++) {
+		char name[32];
+
+		(void)snprintf(name, sizeof(name), "%16.16" PRIx64, i);
+		(void)unlinkat(dfd, name, 0);
+	}
+}
+
+/*
+ *  stress_getdent_bench()
+ *	measure directory enumeration rates over directory sizes,
+ *	getdents64 buffer sizes, readdir and readdir + statx, cold
+ *	and warm, then concurrent getdents64 readers
+ */
+static int stress_getdent_bench(const stress_args_t *args)
+{
+	static stress_getdent_bench_t pass, res;
+	static const char * const cache_names[] = { "warm", "cold" };
+	uint64_t getdent_entries = DEFAULT_GETDENT_ENTRIES, n;
+	uint32_t getdent_readers = DEFAULT_GETDENT_READERS, r;
+	char path[PATH_MAX], dir[PATH_MAX + 16];
+	char *buf;
+	size_t l, c, m, p;
+	int ret, dfd, rc = EXIT_SUCCESS;
+	bool done = false, cold;
+
+	(void)stress_get_setting("getdent-entries", &getdent_entries);
+	(void)stress_get_setting("getdent-readers", &getdent_readers);
+
+	buf = (char *)mmap(NULL, 1 * MB, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap 1 MB getdents buffer, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		(void)munmap((void *)buf, 1 * MB);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_dir_args(args, path, sizeof(path));
+	(void)snprintf(dir, sizeof(dir), "%s/bench", path);
+	if ((mkdir(dir, S_IRWXU) < 0) ||
+	    ((dfd = open(dir, O_RDONLY | O_DIRECTORY)) < 0)) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: cannot create directory %s, errno=%d (%s)\n",
+			args->name, dir, errno, strerror(errno));
+		(void)shim_rmdir(dir);
+		goto tidy;
+	}
+	cold = stress_getdent_bench_drop_caches();
+	if (!cold && (args->instance == 0))
+		pr_inf("%s: cannot drop caches, cold cache results not available\n",
+			args->name);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		uint64_t created = 0;
+
+		(void)memset(&pass, 0, sizeof(pass));
+		for (n = 1000; (n < getdent_entries) && (pass.n_levels < GETDENT_BENCH_MAX_LEVELS - 1); n *= 10)
+			pass.entries[pass.n_levels++] = n;
+		pass.entries[pass.n_levels++] = getdent_entries;
+		for (r = 1; (r < getdent_readers) && (pass.n_points < GETDENT_BENCH_MAX_POINTS - 1); r <<= 1)
+			pass.readers[pass.n_points++] = r;
+		pass.readers[pass.n_points++] = getdent_readers;
+
+		for (l = 0; l < pass.n_levels; l++) {
+			ret = stress_getdent_bench_populate(args, dfd, &created, pass.entries[l]);
+			if (ret < 0) {
+				pr_inf_skip("%s: cannot create %" PRIu64 " directory entries, "
+					"errno=%d (%s)%s, skipping stressor\n", args->name,
+					pass.entries[l], errno, strerror(errno), stress_fs_type(dir));
+				stress_getdent_bench_unpopulate(dfd, created);
+				rc = EXIT_NO_RESOURCE;
+				goto close_dir;
+			}
+			if (ret > 0)
+				break;
+			for (c = 0; c < 2; c++) {
+				for (m = 0; m < GETDENT_BENCH_METHODS; m++) {
+					pass.rate[l][c][m] = ((c == GETDENT_BENCH_COLD) && !cold) ? -1.0 :
+						stress_getdent_bench_rate(args, dir, m, buf,
+							c == GETDENT_BENCH_COLD);
+				}
+			}
+		}
+#if defined(HAVE_LIB_PTHREAD)
+		for (p = 0; (p < pass.n_points) && (l == pass.n_levels); p++) {
+			pass.reader_rate[p] = keep_stressing(args) ?
+				stress_getdent_bench_readers(args, dir, pass.readers[p]) : -1.0;
+		}
+#endif
+		stress_getdent_bench_unpopulate(dfd, created);
+		if ((l < pass.n_levels) || !keep_stressing(args))
+			break;
+		(void)memcpy(&res, &pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		char str[160];
+
+		pr_inf("%s: directory enumeration, K entries/sec, getdents64 buffer "
+			"sizes, readdir and readdir + statx%s\n", args->name, stress_fs_type(dir));
+		(void)snprintf(str, sizeof(str), "%9s %5s", "entries", "cache");
+		for (m = 0; m < GETDENT_BENCH_BUFS; m++) {
+			char sz[16];
+			const size_t len = strlen(str);
+
+			(void)snprintf(str + len, sizeof(str) - len, " %9s",
+				stress_uint64_to_str(sz, sizeof(sz), (uint64_t)getdent_bench_bufs[m]));
+		}
+		(void)shim_strlcat(str, "   readdir     statx", sizeof(str));
+		pr_inf("%s: %s\n", args->name, str);
+		for (l = 0; l < res.n_levels; l++) {
+			for (c = 0; c < 2; c++) {
+				(void)snprintf(str, sizeof(str), "%9" PRIu64 " %5s",
+					res.entries[l], cache_names[c]);
+				for (m = 0; m < GETDENT_BENCH_METHODS; m++) {
+					const size_t len = strlen(str);
+
+					if (res.rate[l][c][m] < 0.0)
+						(void)snprintf(str + len, sizeof(str) - len, " %9s", "-");
+					else
+						(void)snprintf(str + len, sizeof(str) - len, " %9.1f",
+							res.rate[l][c][m]);
+				}
+				pr_inf("%s: %s\n", args->name, str);
+			}
+		}
+#if defined(HAVE_LIB_PTHREAD)
+		pr_inf("%s: concurrent getdents64 readers, %d KB buffer, %" PRIu64 " entries\n",
+			args->name, (int)(GETDENT_BENCH_READER_BUF / KB),
+			res.entries[res.n_levels - 1]);
+		pr_inf("%s: %7s %15s %8s\n", args->name, "readers", "K entries/sec", "speedup");
+		for (p = 0; p < res.n_points; p++) {
+			if ((res.reader_rate[p] < 0.0) || (res.reader_rate[0] <= 0.0)) {
+				pr_inf("%s: %7" PRIu32 " %15s %8s\n", args->name,
+					res.readers[p], "-", "-");
+				continue;
+			}
+			pr_inf("%s: %7" PRIu32 " %15.1f %7.2fx\n", args->name,
+				res.readers[p], res.reader_rate[p],
+				res.reader_rate[p] / res.reader_rate[0]);
+		}
+#endif
+	}
+	if (done) {
+		/* largest directory, warm cache */
+		l = res.n_levels - 1;
+		for (m = 0; m < GETDENT_BENCH_METHODS; m++) {
+			char str[32], sz[16];
+
+			if (m < GETDENT_BENCH_BUFS)
+				(void)snprintf(str, sizeof(str), "getdents64 %s Kents/sec",
+					stress_uint64_to_str(sz, sizeof(sz), (uint64_t)getdent_bench_bufs[m]));
+			else
+				(void)snprintf(str, sizeof(str), "%s Kents/sec",
+					(m == GETDENT_BENCH_READDIR) ? "readdir" : "statx");
+			stress_misc_stats_set(args->misc_stats, (int)m, str,
+				res.rate[l][GETDENT_BENCH_WARM][m] > 0.0 ?
+				res.rate[l][GETDENT_BENCH_WARM][m] : 0.0);
+		}
+	}
+
+close_dir:
+	(void)close(dfd);
+	(void)shim_rmdir(dir);
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)stress_temp_dir_rm_args(args);
+	(void)munmap((void *)buf, 1 * MB);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_getdent
  *	stress reading directories
@@ -255,6 +728,13 @@ static int stress_getdent(const stress_args_t *args)
 {
 	const size_t page_size = args->page_size;
 	const int bad_fd = stress_get_bad_fd();
+#if defined(HAVE_GETDENTS64)
+	bool getdent_bench = false;
+
+	(void)stress_get_setting("getdent-bench", &getdent_bench);
+	if (getdent_bench)
+		return stress_getdent_bench(args);
+#endif
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -286,13 +766,16 @@ static int stress_getdent(const stress_args_t *args)
 stressor_info_t stress_getdent_info = {
 	.stressor = stress_getdent,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
+	.thread_safe = true,
 	.help = help
 };
 #else
 stressor_info_t stress_getdent_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
@@ -18,17 +18,53 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
+#include "core-cpu.h"
 
 #if defined(HAVE_LINUX_RANDOM_H)
 #include <linux/random.h>
 #endif
 
+#if defined(HAVE_SYS_AUXV_H)
+#include <sys/auxv.h>
+#endif
+
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
+#define GETRANDOM_BENCH_THREADS_MAX	(64)
+
 static const stress_help_t help[] = {
 	{ NULL,	"getrandom N",	   "start N workers fetching random data via getrandom()" },
+	{ NULL,	"getrandom-bench", "compare throughput of the available entropy sources" },
+	{ NULL,	"getrandom-bench-threads N", "sweep the entropy sources over 1 to N threads" },
 	{ NULL,	"getrandom-ops N", "stop after N getrandom bogo operations" },
 	{ NULL, NULL,		   NULL }
 };
 
+static int stress_set_getrandom_bench(const char *opt)
+{
+	return stress_set_setting_true("getrandom-bench", opt);
+}
+
+static int stress_set_getrandom_bench_threads(const char *opt)
+{
+	uint32_t getrandom_bench_threads;
+
+	getrandom_bench_threads = stress_get_uint32(opt);
+	stress_check_range("getrandom-bench-threads", (uint64_t)getrandom_bench_threads,
+		1, GETRANDOM_BENCH_THREADS_MAX);
+	(void)stress_set_setting_true("getrandom-bench", NULL);
+	return stress_set_setting("getrandom-bench-threads", TYPE_ID_UINT32, &getrandom_bench_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_getrandom_bench,		stress_set_getrandom_bench },
+	{ OPT_getrandom_bench_threads,	stress_set_getrandom_bench_threads },
+	{ 0,				NULL }
+};
+
 #if defined(__OpenBSD__) || 	\
     defined(__APPLE__) || 	\
     defined(__FreeBSD__) ||	\
@@ -103,12 +139,766 @@ static const getrandom_flags_t getrandom_flags[] = {
 	GETRANDOM_FLAG_INFO(~0U),
 };
 
+#if defined(__linux__) &&	\
+    defined(HAVE_LIB_PTHREAD)
+
+#define HAVE_GETRANDOM_BENCH
+
+#define GETRANDOM_BENCH_BUF_SIZE	(65536)
+#define GETRANDOM_BENCH_THREAD_SIZE	(64)
+#define GETRANDOM_BENCH_SIZE_NS		(50000000ULL)
+#define GETRANDOM_BENCH_THREAD_US	(100000)
+#define GETRANDOM_BENCH_RETRIES		(1000)
+
+#if !defined(HWCAP2_RNG)
+#define HWCAP2_RNG			(1 << 16)
+#endif
+
+/* per thread state of the entropy sources */
+typedef struct {
+	int fd;			/* /dev/urandom file descriptor */
+	void *vstate;		/* vDSO getrandom opaque state */
+	size_t vstate_size;	/* mmap'd size of vstate */
+	uint64_t retries;	/* hardware RNG underflow retries */
+	uint64_t values;	/* hardware RNG 64 bit values read */
+} stress_getrandom_ctx_t;
+
+typedef struct {
+	const char *name;	/* source name */
+	bool hw;		/* true if a CPU instruction */
+	bool (*supported)(void);
+	ssize_t (*fill)(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len);
+} stress_getrandom_source_t;
+
+typedef struct {
+	pthread_t pthread;	/* benchmark thread */
+	const stress_getrandom_source_t *source;
+	stress_getrandom_ctx_t ctx;
+	int32_t cpu;		/* CPU to pin to, -1 = don't pin */
+	volatile bool *start;	/* set when all threads are created */
+	volatile bool *stop;	/* set at the end of the window */
+	uint64_t bytes;		/* bytes filled */
+	uint8_t buf[GETRANDOM_BENCH_THREAD_SIZE];
+} stress_getrandom_thread_t;
+
+static const size_t getrandom_bench_sizes[] = {
+	8, 64, 512, 4096, GETRANDOM_BENCH_BUF_SIZE
+};
+
+/*
+ *  stress_getrandom_hw_fill()
+ *	fill buf 64 bits at a time with a hardware RNG step
+ *	function, counting the retries on underflow
+ */
+static inline ssize_t stress_getrandom_hw_fill(
+	stress_getrandom_ctx_t *ctx,
+	uint8_t *buf,
+	const size_t len,
+	bool (*step)(uint64_t *val))
+{
+	size_t i;
+
+	for (i = 0; i < len; i += sizeof(uint64_t)) {
+		uint64_t val;
+		int retries = 0;
+
+		while (!step(&val)) {
+			if (++retries > GETRANDOM_BENCH_RETRIES)
+				return -1;
+		}
+		ctx->retries += (uint64_t)retries;
+		ctx->values++;
+		(void)memcpy(buf + i, &val,
+			(len - i) < sizeof(val) ? (len - i) : sizeof(val));
+	}
+	return (ssize_t)len;
+}
+
+#if defined(STRESS_ARCH_X86) &&		\
+    (defined(__x86_64__) || defined(__x86_64)) &&	\
+    defined(HAVE_ASM_X86_RDRAND)
+static inline bool stress_getrandom_rdrand_step(uint64_t *val)
+{
+	unsigned long long int tmp;
+	unsigned char ok;
+
+	__asm__ __volatile__("rdrand %0; setc %1" : "=r"(tmp), "=qm"(ok) : : "cc");
+	*val = (uint64_t)tmp;
+	return ok;
+}
+
+static bool stress_getrandom_rdrand_supported(void)
+{
+	return stress_cpu_x86_has_rdrand();
+}
+
+static ssize_t stress_getrandom_rdrand_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	return stress_getrandom_hw_fill(ctx, buf, len, stress_getrandom_rdrand_step);
+}
+#endif
+
+#if defined(STRESS_ARCH_X86) &&		\
+    (defined(__x86_64__) || defined(__x86_64)) &&	\
+    defined(HAVE_ASM_X86_RDSEED)
+static inline bool stress_getrandom_rdseed_step(uint64_t *val)
+{
+	unsigned long long int tmp;
+	unsigned char ok;
+
+	__asm__ __volatile__("rdseed %0; setc %1" : "=r"(tmp), "=qm"(ok) : : "cc");
+	*val = (uint64_t)tmp;
+	return ok;
+}
+
+static bool stress_getrandom_rdseed_supported(void)
+{
+	return stress_cpu_x86_has_rdseed();
+}
+
+static ssize_t stress_getrandom_rdseed_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	return stress_getrandom_hw_fill(ctx, buf, len, stress_getrandom_rdseed_step);
+}
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&		\
+    defined(__aarch64__) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(AT_HWCAP2)
+#define HAVE_GETRANDOM_RNDR
+
+/* RNDR and RNDRRS clear the Z flag on success */
+static inline bool stress_getrandom_rndr_step(uint64_t *val)
+{
+	uint64_t tmp, ok;
+
+	__asm__ __volatile__("mrs %0, s3_3_c2_c4_0\n\tcset %1, ne" : "=r"(tmp), "=r"(ok) : : "cc");
+	*val = tmp;
+	return ok;
+}
+
+static inline bool stress_getrandom_rndrrs_step(uint64_t *val)
+{
+	uint64_t tmp, ok;
+
+	__asm__ __volatile__("mrs %0, s3_3_c2_c4_1\n\tcset %1, ne" : "=r"(tmp), "=r"(ok) : : "cc");
+	*val = tmp;
+	return ok;
+}
+
+static bool stress_getrandom_rndr_supported(void)
+{
+	return !!(getauxval(AT_HWCAP2) & HWCAP2_RNG);
+}
+
+static ssize_t stress_getrandom_rndr_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	return stress_getrandom_hw_fill(ctx, buf, len, stress_getrandom_rndr_step);
+}
+
+static ssize_t stress_getrandom_rndrrs_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	return stress_getrandom_hw_fill(ctx, buf, len, stress_getrandom_rndrrs_step);
+}
+#endif
+
+/*
+ *  stress_getrandom_flags_fill()
+ *	fill buf using getrandom() with the given flags
+ */
+static ssize_t stress_getrandom_flags_fill(uint8_t *buf, const size_t len, const unsigned int flags)
+{
+	size_t n = 0;
+
+	while (n < len) {
+		const ssize_t ret = (ssize_t)shim_getrandom(buf + n, len - n, flags);
+
+		if (ret <= 0) {
+			if ((ret < 0) && (errno == EINTR))
+				continue;
+			return -1;
+		}
+		n += (size_t)ret;
+	}
+	return (ssize_t)n;
+}
+
+static bool stress_getrandom_flags_supported(const unsigned int flags)
+{
+	uint8_t buf[8];
+
+	return stress_getrandom_flags_fill(buf, sizeof(buf), flags) == (ssize_t)sizeof(buf);
+}
+
+static bool stress_getrandom_0_supported(void)
+{
+	return stress_getrandom_flags_supported(0);
+}
+
+static ssize_t stress_getrandom_0_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	(void)ctx;
+
+	return stress_getrandom_flags_fill(buf, len, 0);
+}
+
+#if defined(GRND_NONBLOCK)
+static bool stress_getrandom_nonblock_supported(void)
+{
+	return stress_getrandom_flags_supported(GRND_NONBLOCK);
+}
+
+static ssize_t stress_getrandom_nonblock_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	(void)ctx;
+
+	return stress_getrandom_flags_fill(buf, len, GRND_NONBLOCK);
+}
+#endif
+
+#if defined(GRND_INSECURE)
+static bool stress_getrandom_insecure_supported(void)
+{
+	return stress_getrandom_flags_supported(GRND_INSECURE);
+}
+
+static ssize_t stress_getrandom_insecure_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	(void)ctx;
+
+	return stress_getrandom_flags_fill(buf, len, GRND_INSECURE);
+}
+#endif
+
+static bool stress_getrandom_urandom_supported(void)
+{
+	return access("/dev/urandom", R_OK) == 0;
+}
+
+static ssize_t stress_getrandom_urandom_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	size_t n = 0;
+
+	while (n < len) {
+		const ssize_t ret = read(ctx->fd, buf + n, len - n);
+
+		if (ret <= 0) {
+			if ((ret < 0) && (errno == EINTR))
+				continue;
+			return -1;
+		}
+		n += (size_t)ret;
+	}
+	return (ssize_t)n;
+}
+
+#if defined(HAVE_SYS_AUXV_H) &&	\
+    defined(HAVE_LINK_H) &&	\
+    defined(HAVE_GETAUXVAL) &&	\
+    defined(AT_SYSINFO_EHDR)
+#define HAVE_GETRANDOM_VDSO
+
+/* layout returned by the vDSO when querying the opaque state parameters */
+typedef struct {
+	uint32_t size_of_opaque_state;
+	uint32_t mmap_prot;
+	uint32_t mmap_flags;
+	uint32_t reserved[13];
+} stress_vgetrandom_params_t;
+
+typedef ssize_t (*stress_vgetrandom_func_t)(void *buf, size_t len,
+	unsigned int flags, void *opaque_state, size_t opaque_len);
+
+static stress_vgetrandom_func_t vgetrandom_func;
+static stress_vgetrandom_params_t vgetrandom_params;
+
+/*
+ *  stress_getrandom_vdso_sym()
+ *	find a function symbol in the vDSO via its DT_HASH
+ *	symbol table, returns NULL if not found
+ */
+static void *stress_getrandom_vdso_sym(const char *name)
+{
+	const ElfW(Ehdr) *ehdr = (const ElfW(Ehdr) *)getauxval(AT_SYSINFO_EHDR);
+	const ElfW(Phdr) *phdr;
+	const ElfW(Dyn) *dyn = NULL;
+	const ElfW(Sym) *symtab = NULL;
+	const ElfW(Word) *hash = NULL;
+	const char *strtab = NULL;
+	uintptr_t base = 0;
+	bool loaded = false;
+	ElfW(Word) i;
+
+	if (!ehdr)
+		return NULL;
+
+	phdr = (const ElfW(Phdr) *)((uintptr_t)ehdr + ehdr->e_phoff);
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if ((phdr[i].p_type == PT_LOAD) && !loaded) {
+			base = (uintptr_t)ehdr + phdr[i].p_offset - phdr[i].p_vaddr;
+			loaded = true;
+		} else if (phdr[i].p_type == PT_DYNAMIC) {
+			dyn = (const ElfW(Dyn) *)((uintptr_t)ehdr + phdr[i].p_offset);
+		}
+	}
+	if (!dyn || !loaded)
+		return NULL;
+
+	for (; dyn->d_tag != DT_NULL; dyn++) {
+		switch (dyn->d_tag) {
+		case DT_HASH:
+			hash = (const ElfW(Word) *)(base + dyn->d_un.d_ptr);
+			break;
+		case DT_SYMTAB:
+			symtab = (const ElfW(Sym) *)(base + dyn->d_un.d_ptr);
+			break;
+		case DT_STRTAB:
+			strtab = (const char *)(base + dyn->d_un.d_ptr);
+			break;
+		default:
+			break;
+		}
+	}
+	if (!hash || !symtab || !strtab)
+		return NULL;
+
+	/* hash[1] is nchain, the number of symbols */
+	for (i = 0; i < hash[1]; i++) {
+		const ElfW(Sym) *sym = &symtab[i];
+
+		if ((ELF64_ST_TYPE(sym->st_info) != STT_FUNC) ||
+		    (sym->st_shndx == SHN_UNDEF))
+			continue;
+		if (!strcmp(strtab + sym->st_name, name))
+			return (void *)(base + sym->st_value);
+	}
+	return NULL;
+}
+
+static bool stress_getrandom_vdso_supported(void)
+{
+	stress_vgetrandom_func_t func;
+
+	func = (stress_vgetrandom_func_t)stress_getrandom_vdso_sym("__vdso_getrandom");
+	if (!func)
+		func = (stress_vgetrandom_func_t)stress_getrandom_vdso_sym("__kernel_getrandom");
+	if (!func)
+		return false;
+
+	/* a length of ~0 queries the opaque state parameters */
+	(void)memset(&vgetrandom_params, 0, sizeof(vgetrandom_params));
+	if (func(NULL, 0, 0, &vgetrandom_params, ~0UL) != 0)
+		return false;
+	if (vgetrandom_params.size_of_opaque_state == 0)
+		return false;
+	vgetrandom_func = func;
+	return true;
+}
+
+static ssize_t stress_getrandom_vdso_fill(stress_getrandom_ctx_t *ctx, uint8_t *buf, const size_t len)
+{
+	size_t n = 0;
+
+	while (n < len) {
+		const ssize_t ret = vgetrandom_func(buf + n, len - n, 0,
+			ctx->vstate, vgetrandom_params.size_of_opaque_state);
+
+		if (ret <= 0) {
+			if ((ret < 0) && (errno == EINTR))
+				continue;
+			return -1;
+		}
+		n += (size_t)ret;
+	}
+	return (ssize_t)n;
+}
+#endif
+
+static const stress_getrandom_source_t getrandom_sources[] = {
+#if defined(STRESS_ARCH_X86) &&		\
+    (defined(__x86_64__) || defined(__x86_64)) &&	\
+    defined(HAVE_ASM_X86_RDRAND)
+	{ "rdrand",		true,	stress_getrandom_rdrand_supported,	stress_getrandom_rdrand_fill },
+#endif
+#if defined(STRESS_ARCH_X86) &&		\
+    (defined(__x86_64__) || defined(__x86_64)) &&	\
+    defined(HAVE_ASM_X86_RDSEED)
+	{ "rdseed",		true,	stress_getrandom_rdseed_supported,	stress_getrandom_rdseed_fill },
+#endif
+#if defined(HAVE_GETRANDOM_RNDR)
+	{ "rndr",		true,	stress_getrandom_rndr_supported,	stress_getrandom_rndr_fill },
+	{ "rndrrs",		true,	stress_getrandom_rndr_supported,	stress_getrandom_rndrrs_fill },
+#endif
+	{ "getrandom",		false,	stress_getrandom_0_supported,		stress_getrandom_0_fill },
+#if defined(GRND_NONBLOCK)
+	{ "getrandom-nonblock",	false,	stress_getrandom_nonblock_supported,	stress_getrandom_nonblock_fill },
+#endif
+#if defined(GRND_INSECURE)
+	{ "getrandom-insecure",	false,	stress_getrandom_insecure_supported,	stress_getrandom_insecure_fill },
+#endif
+#if defined(HAVE_GETRANDOM_VDSO)
+	{ "vgetrandom",		false,	stress_getrandom_vdso_supported,	stress_getrandom_vdso_fill },
+#endif
+	{ "urandom",		false,	stress_getrandom_urandom_supported,	stress_getrandom_urandom_fill },
+};
+
+/*
+ *  stress_getrandom_ctx_init()
+ *	open /dev/urandom and allocate the vDSO opaque state
+ */
+static void stress_getrandom_ctx_init(stress_getrandom_ctx_t *ctx)
+{
+	(void)memset(ctx, 0, sizeof(*ctx));
+	ctx->fd = open("/dev/urandom", O_RDONLY);
+	ctx->vstate = MAP_FAILED;
+#if defined(HAVE_GETRANDOM_VDSO)
+	if (vgetrandom_func) {
+		const size_t page_size = stress_get_page_size();
+
+		ctx->vstate_size = (vgetrandom_params.size_of_opaque_state + page_size - 1) & ~(page_size - 1);
+		ctx->vstate = mmap(NULL, ctx->vstate_size, (int)vgetrandom_params.mmap_prot,
+			(int)vgetrandom_params.mmap_flags, -1, 0);
+	}
+#endif
+}
+
+/*
+ *  stress_getrandom_ctx_free()
+ *	free resources of stress_getrandom_ctx_init
+ */
+static void stress_getrandom_ctx_free(stress_getrandom_ctx_t *ctx)
+{
+	if (ctx->fd >= 0)
+		(void)close(ctx->fd);
+	if (ctx->vstate != MAP_FAILED)
+		(void)munmap(ctx->vstate, ctx->vstate_size);
+}
+
+/*
+ *  stress_getrandom_ctx_usable()
+ *	check the per thread resources a source needs are available
+ */
+static bool stress_getrandom_ctx_usable(
+	const stress_getrandom_source_t *source,
+	const stress_getrandom_ctx_t *ctx)
+{
+	if (!strcmp(source->name, "urandom"))
+		return ctx->fd >= 0;
+	if (!strcmp(source->name, "vgetrandom"))
+		return ctx->vstate != MAP_FAILED;
+	return true;
+}
+
+/*
+ *  stress_getrandom_bench_size()
+ *	measure MB/s of a source filling size bytes per request
+ *	from a single thread, returns < 0 on failure
+ */
+static double stress_getrandom_bench_size(
+	const stress_args_t *args,
+	const stress_getrandom_source_t *source,
+	stress_getrandom_ctx_t *ctx,
+	uint8_t *buf,
+	const size_t size)
+{
+	const double t_start = stress_time_now();
+	const double t_end = t_start + ((double)GETRANDOM_BENCH_SIZE_NS / 1.0E9);
+	double t;
+	uint64_t bytes = 0;
+
+	do {
+		int i;
+
+		for (i = 0; i < 16; i++) {
+			if (source->fill(ctx, buf, size) < 0)
+				return -1.0;
+		}
+		bytes += 16 * size;
+		add_counter(args, 16);
+		t = stress_time_now();
+	} while ((t < t_end) && keep_stressing(args));
+
+	return ((double)bytes / (t - t_start)) / 1.0E6;
+}
+
+/*
+ *  stress_getrandom_bench_thread()
+ *	fill from a source until told to stop
+ */
+static void *stress_getrandom_bench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_getrandom_thread_t *thread = (stress_getrandom_thread_t *)arg;
+
+#if defined(HAVE_AFFINITY)
+	if (thread->cpu >= 0) {
+		cpu_set_t mask;
+
+		CPU_ZERO(&mask);
+		CPU_SET(thread->cpu, &mask);
+		(void)sched_setaffinity(0, sizeof(mask), &mask);
+	}
+#endif
+	while (!*thread->start && !*thread->stop)
+		(void)shim_sched_yield();
+
+	while (!*thread->stop) {
+		if (thread->source->fill(&thread->ctx, thread->buf, sizeof(thread->buf)) < 0)
+			break;
+		thread->bytes += sizeof(thread->buf);
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_getrandom_bench_threads()
+ *	measure the aggregate MB/s of n_threads threads pinned
+ *	to different CPUs filling from one source, returns < 0
+ *	on failure
+ */
+static double stress_getrandom_bench_threads(
+	const stress_args_t *args,
+	const stress_getrandom_source_t *source,
+	stress_getrandom_thread_t *threads,
+	const uint32_t n_threads,
+	const int32_t n_cpus,
+	uint64_t *retries,
+	uint64_t *values)
+{
+	volatile bool start = false, stop = false;
+	uint32_t i, created;
+	uint64_t bytes = 0;
+	double t_start, t_end;
+
+	for (created = 0; created < n_threads; created++) {
+		stress_getrandom_thread_t *thread = &threads[created];
+
+		thread->source = source;
+		stress_getrandom_ctx_init(&thread->ctx);
+		thread->cpu = (n_cpus > 1) ? (int32_t)(created % (uint32_t)n_cpus) : -1;
+		thread->start = &start;
+		thread->stop = &stop;
+		thread->bytes = 0;
+		if (!stress_getrandom_ctx_usable(source, &thread->ctx) ||
+		    (pthread_create(&thread->pthread, NULL,
+				    stress_getrandom_bench_thread, thread) != 0)) {
+			stress_getrandom_ctx_free(&thread->ctx);
+			break;
+		}
+	}
+
+	t_start = stress_time_now();
+	start = true;
+	if (created == n_threads)
+		(void)shim_usleep(GETRANDOM_BENCH_THREAD_US);
+	stop = true;
+	t_end = stress_time_now();
+
+	for (i = 0; i < created; i++) {
+		stress_getrandom_thread_t *thread = &threads[i];
+
+		(void)pthread_join(thread->pthread, NULL);
+		bytes += thread->bytes;
+		*retries += thread->ctx.retries;
+		*values += thread->ctx.values;
+		stress_getrandom_ctx_free(&thread->ctx);
+	}
+	add_counter(args, bytes / GETRANDOM_BENCH_THREAD_SIZE);
+
+	if ((created < n_threads) || (t_end <= t_start))
+		return -1.0;
+	return ((double)bytes / (t_end - t_start)) / 1.0E6;
+}
+
+/*
+ *  stress_getrandom_bench_idle()
+ *	sleep until the end of the run
+ */
+static void stress_getrandom_bench_idle(const stress_args_t *args)
+{
+	while (keep_stressing(args))
+		(void)shim_usleep(100000);
+}
+
+/*
+ *  stress_getrandom_bench()
+ *	compare MB/s and ns per 64 bit value of the entropy sources
+ *	over request sizes and then over thread counts at a 64 byte
+ *	request size to expose cross-core contention
+ */
+static int stress_getrandom_bench(const stress_args_t *args)
+{
+	const stress_getrandom_source_t *sources[SIZEOF_ARRAY(getrandom_sources)];
+	double mbs[SIZEOF_ARRAY(getrandom_sources)][SIZEOF_ARRAY(getrandom_bench_sizes)];
+	stress_getrandom_thread_t *threads;
+	stress_getrandom_ctx_t ctx;
+	uint32_t getrandom_bench_threads, n_threads[8], n_counts = 0, t;
+	const int32_t n_cpus = stress_get_processors_online();
+	size_t i, j, n_sources = 0, metric = 0;
+	uint8_t *buf;
+	char str[256];
+
+	getrandom_bench_threads = (n_cpus > 0) ? (uint32_t)n_cpus : 1;
+	if (getrandom_bench_threads > GETRANDOM_BENCH_THREADS_MAX)
+		getrandom_bench_threads = GETRANDOM_BENCH_THREADS_MAX;
+	(void)stress_get_setting("getrandom-bench-threads", &getrandom_bench_threads);
+	for (t = 1; (t < getrandom_bench_threads) && (n_counts < SIZEOF_ARRAY(n_threads) - 1); t <<= 1)
+		n_threads[n_counts++] = t;
+	n_threads[n_counts++] = getrandom_bench_threads;
+
+	if (args->instance != 0) {
+		/* one benchmarking instance, others would skew the results */
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		stress_getrandom_bench_idle(args);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return EXIT_SUCCESS;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(getrandom_sources); i++) {
+		if (getrandom_sources[i].supported())
+			sources[n_sources++] = &getrandom_sources[i];
+	}
+
+	buf = (uint8_t *)mmap(NULL, GETRANDOM_BENCH_BUF_SIZE, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %d byte buffer, skipping stressor\n",
+			args->name, GETRANDOM_BENCH_BUF_SIZE);
+		return EXIT_NO_RESOURCE;
+	}
+	threads = (stress_getrandom_thread_t *)calloc(getrandom_bench_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " benchmark threads, skipping stressor\n",
+			args->name, getrandom_bench_threads);
+		(void)munmap((void *)buf, GETRANDOM_BENCH_BUF_SIZE);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	stress_getrandom_ctx_init(&ctx);
+	for (i = 0; i < n_sources; i++) {
+		const bool usable = stress_getrandom_ctx_usable(sources[i], &ctx);
+
+		for (j = 0; j < SIZEOF_ARRAY(getrandom_bench_sizes); j++) {
+			mbs[i][j] = (usable && keep_stressing(args)) ?
+				stress_getrandom_bench_size(args, sources[i], &ctx,
+					buf, getrandom_bench_sizes[j]) : -1.0;
+		}
+	}
+	stress_getrandom_ctx_free(&ctx);
+
+	pr_inf("%s: single thread throughput, MB/s (ns per 64 bit value):\n", args->name);
+	(void)snprintf(str, sizeof(str), "%-18s", "source");
+	for (j = 0; j < SIZEOF_ARRAY(getrandom_bench_sizes); j++) {
+		char size[16];
+
+		(void)snprintf(size, sizeof(size), "%zuB", getrandom_bench_sizes[j]);
+		(void)shim_strlcat(str, " ", sizeof(str));
+		(void)snprintf(str + strlen(str), sizeof(str) - strlen(str), "%17s", size);
+	}
+	pr_inf("%s: %s\n", args->name, str);
+	for (i = 0; i < n_sources; i++) {
+		(void)snprintf(str, sizeof(str), "%-18s", sources[i]->name);
+		for (j = 0; j < SIZEOF_ARRAY(getrandom_bench_sizes); j++) {
+			if (mbs[i][j] > 0.0)
+				(void)snprintf(str + strlen(str), sizeof(str) - strlen(str),
+					" %8.1f (%6.1f)", mbs[i][j], 8000.0 / mbs[i][j]);
+			else
+				(void)snprintf(str + strlen(str), sizeof(str) - strlen(str),
+					" %17s", "-");
+		}
+		pr_inf("%s: %s\n", args->name, str);
+		/* 64 byte requests are typical of TLS key and nonce generation */
+		if ((mbs[i][1] > 0.0) && (metric < STRESS_MISC_STATS_MAX)) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s ns/u64 @64B", sources[i]->name);
+			stress_misc_stats_set(args->misc_stats, metric++, desc, 8000.0 / mbs[i][1]);
+		}
+	}
+
+	pr_inf("%s: %d byte requests over threads, aggregate MB/s (scaling %%):\n",
+		args->name, GETRANDOM_BENCH_THREAD_SIZE);
+	(void)snprintf(str, sizeof(str), "%-18s", "source");
+	for (t = 0; t < n_counts; t++)
+		(void)snprintf(str + strlen(str), sizeof(str) - strlen(str),
+			" %10" PRIu32 "T    ", n_threads[t]);
+	(void)shim_strlcat(str, " retry/Mval", sizeof(str));
+	pr_inf("%s: %s\n", args->name, str);
+
+	for (i = 0; i < n_sources; i++) {
+		uint64_t retries = 0, values = 0;
+		double mbs1 = -1.0, scaling = -1.0;
+
+		(void)snprintf(str, sizeof(str), "%-18s", sources[i]->name);
+		for (t = 0; t < n_counts; t++) {
+			const double rate = keep_stressing(args) ?
+				stress_getrandom_bench_threads(args, sources[i], threads,
+					n_threads[t], n_cpus, &retries, &values) : -1.0;
+
+			if (t == 0)
+				mbs1 = rate;
+			if ((rate > 0.0) && (mbs1 > 0.0)) {
+				scaling = 100.0 * rate / (mbs1 * n_threads[t]);
+				(void)snprintf(str + strlen(str), sizeof(str) - strlen(str),
+					" %8.1f (%3.0f%%)", rate, scaling);
+			} else {
+				(void)snprintf(str + strlen(str), sizeof(str) - strlen(str),
+					" %15s", "-");
+			}
+		}
+		if (values)
+			(void)snprintf(str + strlen(str), sizeof(str) - strlen(str),
+				" %10.1f", 1.0E6 * (double)retries / (double)values);
+		else
+			(void)snprintf(str + strlen(str), sizeof(str) - strlen(str),
+				" %10s", "-");
+		pr_inf("%s: %s\n", args->name, str);
+
+		if (sources[i]->hw && (scaling > 0.0) && (metric < STRESS_MISC_STATS_MAX)) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s %" PRIu32 "T scaling %%",
+				sources[i]->name, n_threads[n_counts - 1]);
+			stress_misc_stats_set(args->misc_stats, metric++, desc, scaling);
+		}
+	}
+	pr_inf("%s: scaling is aggregate MB/s over threads x 1 thread MB/s, "
+		"retry/Mval is hardware RNG underflow retries per million values\n", args->name);
+
+	stress_getrandom_bench_idle(args);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	free(threads);
+	(void)munmap((void *)buf, GETRANDOM_BENCH_BUF_SIZE);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_getrandom
  *	stress reading random values using getrandom()
  */
 static int stress_getrandom(const stress_args_t *args)
 {
+	bool getrandom_bench = false;
+
+	(void)stress_get_setting("getrandom-bench", &getrandom_bench);
+	if (getrandom_bench) {
+#if defined(HAVE_GETRANDOM_BENCH)
+		return stress_getrandom_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --getrandom-bench is not supported on this "
+				"system, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -151,12 +941,15 @@ stressor_info_t stress_getrandom_info = {
 	.supported = stress_getrandom_supported,
 	.class = CLASS_OS | CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.thread_safe = true,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_getrandom_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_OS | CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-thermal-zone.h"
 
 #if defined(HAVE_EGL_H)
 #include <EGL/egl.h>
@@ -122,6 +123,160 @@ static struct gbm_surface *gs;
 static const char default_gpu_devnode[] = "/dev/dri/renderD128";
 static GLubyte *teximage = NULL;
 
+#define GPU_SAMPLE_INTERVAL	(1.0)	/* seconds between clock/thermal samples */
+#define GPU_SUSTAIN_WINDOWS	(10)	/* last N samples averaged as sustained */
+#define GPU_FRAG_OPS		(10)	/* approx ALU ops per frag_n loop iteration */
+
+/* DRM sysfs/hwmon attributes of the render node, empty if not found */
+typedef struct {
+	char freq_path[PATH_MAX];
+	double freq_scale;		/* multiplier to convert to MHz */
+	char temp_path[PATH_MAX];
+} stress_gpu_sysfs_t;
+
+/* peak and sustained (moving average) of a sampled value */
+typedef struct {
+	double peak;
+	double ring[GPU_SUSTAIN_WINDOWS];
+	size_t n;
+} stress_gpu_track_t;
+
+/*
+ *  stress_gpu_sysfs_find()
+ *	find file in the first entry of dir that starts with prefix
+ */
+static bool stress_gpu_sysfs_find(
+	const char *dir,
+	const char *prefix,
+	const char *file,
+	char *path,
+	const size_t len)
+{
+	DIR *dp;
+	struct dirent *d;
+	bool found = false;
+
+	dp = opendir(dir);
+	if (!dp)
+		return false;
+	while (!found && ((d = readdir(dp)) != NULL)) {
+		if (d->d_name[0] == '.')
+			continue;
+		if (strncmp(d->d_name, prefix, strlen(prefix)))
+			continue;
+		(void)snprintf(path, len, "%s/%s/%s", dir, d->d_name, file);
+		found = (access(path, R_OK) == 0);
+	}
+	(void)closedir(dp);
+	if (!found)
+		*path = '\0';
+	return found;
+}
+
+/*
+ *  stress_gpu_sysfs_init()
+ *	locate the GPU clock and temperature attributes of the
+ *	render node; i915 exposes the actual GT clock in MHz,
+ *	amdgpu a hwmon clock in Hz and most SoC GPUs a devfreq
+ *	clock in Hz, the temperature comes from hwmon
+ */
+static void stress_gpu_sysfs_init(const char *gpu_devnode, stress_gpu_sysfs_t *sysfs)
+{
+	const char *node = strrchr(gpu_devnode, '/');
+	char dev[PATH_MAX], dir[PATH_MAX + 16];
+
+	(void)memset(sysfs, 0, sizeof(*sysfs));
+	node = node ? node + 1 : gpu_devnode;
+	(void)snprintf(dev, sizeof(dev), "/sys/class/drm/%s/device", node);
+
+	(void)snprintf(dir, sizeof(dir), "%s/hwmon", dev);
+	(void)stress_gpu_sysfs_find(dir, "hwmon", "temp1_input",
+		sysfs->temp_path, sizeof(sysfs->temp_path));
+
+	(void)snprintf(dir, sizeof(dir), "%s/drm", dev);
+	sysfs->freq_scale = 1.0;
+	if (stress_gpu_sysfs_find(dir, "card", "gt_act_freq_mhz",
+			sysfs->freq_path, sizeof(sysfs->freq_path)))
+		return;
+	sysfs->freq_scale = 1.0E-6;
+	(void)snprintf(dir, sizeof(dir), "%s/hwmon", dev);
+	if (stress_gpu_sysfs_find(dir, "hwmon", "freq1_input",
+			sysfs->freq_path, sizeof(sysfs->freq_path)))
+		return;
+	(void)snprintf(dir, sizeof(dir), "%s/devfreq", dev);
+	(void)stress_gpu_sysfs_find(dir, "", "cur_freq",
+		sysfs->freq_path, sizeof(sysfs->freq_path));
+}
+
+/*
+ *  stress_gpu_sysfs_read()
+ *	read a numeric sysfs attribute and scale it, -1.0 if unavailable
+ */
+static double stress_gpu_sysfs_read(const char *path, const double scale)
+{
+	char buf[64];
+	uint64_t val;
+
+	if (!*path)
+		return -1.0;
+	if (system_read(path, buf, sizeof(buf)) <= 0)
+		return -1.0;
+	if (sscanf(buf, "%" SCNu64, &val) != 1)
+		return -1.0;
+	return (double)val * scale;
+}
+
+/*
+ *  stress_gpu_cpu_temp()
+ *	hottest CPU thermal zone in degrees C, -1.0 if --tz is not enabled
+ */
+static double stress_gpu_cpu_temp(void)
+{
+#if defined(STRESS_THERMAL_ZONES)
+	stress_tz_t tz;
+	stress_tz_info_t *tz_info;
+	uint64_t max = 0;
+
+	if (!g_shared->tz_info)
+		return -1.0;
+	(void)memset(&tz, 0, sizeof(tz));
+	(void)stress_tz_get_temperatures(&g_shared->tz_info, &tz);
+	for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
+		const uint64_t temp = tz.tz_stat[tz_info->index].temperature;
+
+		/* Avoid crazy temperatures. e.g. > 250 C */
+		if ((temp <= 250000) && (temp > max))
+			max = temp;
+	}
+	return max ? (double)max / 1000.0 : -1.0;
+#else
+	return -1.0;
+#endif
+}
+
+static void stress_gpu_track(stress_gpu_track_t *track, const double val)
+{
+	if (val < 0.0)
+		return;
+	if (val > track->peak)
+		track->peak = val;
+	track->ring[track->n % GPU_SUSTAIN_WINDOWS] = val;
+	track->n++;
+}
+
+static double stress_gpu_sustained(const stress_gpu_track_t *track)
+{
+	const size_t n = (track->n < GPU_SUSTAIN_WINDOWS) ? track->n : GPU_SUSTAIN_WINDOWS;
+	double sum = 0.0;
+	size_t i;
+
+	if (n == 0)
+		return 0.0;
+	for (i = 0; i < n; i++)
+		sum += track->ring[i];
+	return sum / (double)n;
+}
+
 static const char vert_shader[] =
     "attribute vec4 pos;\n"
     "attribute vec4 color;\n"
@@ -322,20 +477,31 @@ static int gles2_init(
 	return EXIT_SUCCESS;
 }
 
-static void stress_gpu_run(const GLsizei texsize, const GLsizei uploads)
+static void stress_gpu_run(
+	const GLsizei texsize,
+	const GLsizei uploads,
+	double *t_upload,
+	double *t_draw)
 {
+	double t;
+
 	if (texsize > 0) {
 		int i;
 
+		t = stress_time_now();
 		for (i = 0; i < uploads; i++) {
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texsize,
 				     texsize, 0, GL_RGBA, GL_UNSIGNED_BYTE,
 				     teximage);
 		}
+		glFinish();
+		*t_upload += stress_time_now() - t;
 	}
+	t = stress_time_now();
 	glClear(GL_COLOR_BUFFER_BIT);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 	glFinish();
+	*t_draw += stress_time_now() - t;
 }
 
 static int get_config(const stress_args_t *args, EGLConfig *config)
@@ -475,6 +641,11 @@ static int stress_gpu(const stress_args_t *args)
 	GLsizei texsize = 4096;
 	GLsizei uploads = 1;
 	const char *gpu_devnode = default_gpu_devnode;
+	stress_gpu_sysfs_t sysfs;
+	stress_gpu_track_t fill, mhz;
+	double t_start, t_sample, t_upload = 0.0, t_draw = 0.0, t_draw_sample = 0.0;
+	double pixels, gpu_temp_max = -1.0, cpu_temp_max = -1.0;
+	uint64_t frames = 0, frames_sample = 0;
 
 	(void)stress_get_setting("gpu-devnode", &gpu_devnode);
 	(void)stress_get_setting("gpu-frag", &frag_n);
@@ -483,6 +654,8 @@ static int stress_gpu(const stress_args_t *args)
 	(void)stress_get_setting("gpu-tex-size", &texsize);
 	(void)stress_get_setting("gpu-upload", &uploads);
 
+	pixels = (double)size_x * (double)size_y;
+
 	ret = egl_init(args, gpu_devnode, size_x, size_y);
 	if (ret != EXIT_SUCCESS)
 		goto deinit;
@@ -491,15 +664,85 @@ static int stress_gpu(const stress_args_t *args)
 	if (ret != EXIT_SUCCESS)
 		goto deinit;
 
+	stress_gpu_sysfs_init(gpu_devnode, &sysfs);
+	(void)memset(&fill, 0, sizeof(fill));
+	(void)memset(&mhz, 0, sizeof(mhz));
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	t_start = stress_time_now();
+	t_sample = t_start;
 	do {
-		stress_gpu_run(texsize, uploads);
-		if (glGetError() != GL_NO_ERROR)
-			return EXIT_NO_RESOURCE;
+		double now;
+
+		stress_gpu_run(texsize, uploads, &t_upload, &t_draw);
+		if (glGetError() != GL_NO_ERROR) {
+			ret = EXIT_NO_RESOURCE;
+			goto deinit;
+		}
 		inc_counter(args);
+		frames++;
+
+		now = stress_time_now();
+		if (now - t_sample >= GPU_SAMPLE_INTERVAL) {
+			const double dt = t_draw - t_draw_sample;
+			const double gpix = (dt > 0.0) ?
+				(double)(frames - frames_sample) * pixels / dt / 1.0E9 : -1.0;
+			const double freq = stress_gpu_sysfs_read(sysfs.freq_path, sysfs.freq_scale);
+			const double gpu_temp = stress_gpu_sysfs_read(sysfs.temp_path, 0.001);
+			const double cpu_temp = stress_gpu_cpu_temp();
+			char freq_str[32] = "", gpu_str[32] = "", cpu_str[32] = "";
+
+			stress_gpu_track(&fill, gpix);
+			stress_gpu_track(&mhz, freq);
+			if (gpu_temp > gpu_temp_max)
+				gpu_temp_max = gpu_temp;
+			if (cpu_temp > cpu_temp_max)
+				cpu_temp_max = cpu_temp;
+			/* only log the samples this system provides */
+			if (freq >= 0.0)
+				(void)snprintf(freq_str, sizeof(freq_str), ", GPU clock %.0f MHz", freq);
+			if (gpu_temp >= 0.0)
+				(void)snprintf(gpu_str, sizeof(gpu_str), ", GPU temp %.1f C", gpu_temp);
+			if (cpu_temp >= 0.0)
+				(void)snprintf(cpu_str, sizeof(cpu_str), ", CPU temp %.1f C", cpu_temp);
+			pr_dbg("%s: %.0fs fill %.3f GPixels/sec%s%s%s\n",
+				args->name, now - t_start, gpix, freq_str, gpu_str, cpu_str);
+
+			t_sample = now;
+			t_draw_sample = t_draw;
+			frames_sample = frames;
+		}
 	} while (keep_stressing(args));
 
+	if (t_draw > 0.0) {
+		const double gpix = (double)frames * pixels / t_draw / 1.0E9;
+
+		stress_misc_stats_set(args->misc_stats, 0, "fill GPixels/sec", gpix);
+		stress_misc_stats_set(args->misc_stats, 1, "fill GPixels/sec peak", fill.peak);
+		stress_misc_stats_set(args->misc_stats, 2, "fill GPixels/sec sustained",
+			stress_gpu_sustained(&fill));
+		if (frag_n > 0)
+			stress_misc_stats_set(args->misc_stats, 3, "shader ALU Gops/sec",
+				gpix * (double)frag_n * GPU_FRAG_OPS);
+	}
+	if (t_upload > 0.0) {
+		const double bytes = (double)frames * (double)uploads *
+				     (double)texsize * (double)texsize * 4.0;
+
+		stress_misc_stats_set(args->misc_stats, 4, "texture upload GB/sec",
+			bytes / t_upload / 1.0E9);
+	}
+	if (mhz.n > 0) {
+		stress_misc_stats_set(args->misc_stats, 5, "GPU MHz peak", mhz.peak);
+		stress_misc_stats_set(args->misc_stats, 6, "GPU MHz sustained",
+			stress_gpu_sustained(&mhz));
+	}
+	if (gpu_temp_max > 0.0)
+		stress_misc_stats_set(args->misc_stats, 7, "GPU temperature max C", gpu_temp_max);
+	if (cpu_temp_max > 0.0)
+		stress_misc_stats_set(args->misc_stats, 8, "CPU temperature max C", cpu_temp_max);
+
 	ret = EXIT_SUCCESS;
 deinit:
 	if (teximage)
@@ -0,0 +1,853 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+
+#define MIN_GRAPH_SCALE		(8)
+#define MAX_GRAPH_SCALE		(26)
+#define DEFAULT_GRAPH_SCALE	(16)
+
+#define MIN_GRAPH_EDGEFACTOR	(1)
+#define MAX_GRAPH_EDGEFACTOR	(64)
+#define DEFAULT_GRAPH_EDGEFACTOR (16)
+
+#define MIN_GRAPH_THREADS	(1)
+#define MAX_GRAPH_THREADS	(256)
+
+static const stress_help_t help[] = {
+	{ NULL,	"graph N",		"start N workers doing BFS and PageRank on an R-MAT graph" },
+	{ NULL,	"graph-edgefactor N",	"generate N edges per vertex" },
+	{ NULL,	"graph-method M",	"graph kernel, one of all, bfs or pagerank" },
+	{ NULL,	"graph-ops N",		"stop after N BFS searches or PageRank rounds" },
+	{ NULL,	"graph-scale N",	"generate a graph of 2^N vertices" },
+	{ NULL,	"graph-threads N",	"number of threads, default is the number of CPUs" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const graph_methods[] = {
+	"all",
+	"bfs",
+	"pagerank",
+};
+
+static int stress_set_graph_edgefactor(const char *opt)
+{
+	uint32_t graph_edgefactor;
+
+	graph_edgefactor = stress_get_uint32(opt);
+	stress_check_range("graph-edgefactor", (uint64_t)graph_edgefactor,
+		MIN_GRAPH_EDGEFACTOR, MAX_GRAPH_EDGEFACTOR);
+	return stress_set_setting("graph-edgefactor", TYPE_ID_UINT32, &graph_edgefactor);
+}
+
+static int stress_set_graph_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(graph_methods); i++) {
+		if (!strcmp(opt, graph_methods[i]))
+			return stress_set_setting("graph-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "graph-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(graph_methods); i++)
+		(void)fprintf(stderr, " %s", graph_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_graph_scale(const char *opt)
+{
+	uint32_t graph_scale;
+
+	graph_scale = stress_get_uint32(opt);
+	stress_check_range("graph-scale", (uint64_t)graph_scale,
+		MIN_GRAPH_SCALE, MAX_GRAPH_SCALE);
+	return stress_set_setting("graph-scale", TYPE_ID_UINT32, &graph_scale);
+}
+
+static int stress_set_graph_threads(const char *opt)
+{
+	uint32_t graph_threads;
+
+	graph_threads = stress_get_uint32(opt);
+	stress_check_range("graph-threads", (uint64_t)graph_threads,
+		MIN_GRAPH_THREADS, MAX_GRAPH_THREADS);
+	return stress_set_setting("graph-threads", TYPE_ID_UINT32, &graph_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_graph_edgefactor,		stress_set_graph_edgefactor },
+	{ OPT_graph_method,		stress_set_graph_method },
+	{ OPT_graph_scale,		stress_set_graph_scale },
+	{ OPT_graph_threads,		stress_set_graph_threads },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+
+#define GRAPH_NONE		(0xffffffffU)	/* vertex not reached */
+#define GRAPH_TD_CHUNK		(64)		/* frontier vertices per claim */
+#define GRAPH_QBUF		(256)		/* per thread next frontier buffer */
+#define GRAPH_ALPHA		(14)		/* top-down to bottom-up threshold */
+#define GRAPH_BETA		(24)		/* bottom-up to top-down threshold */
+#define GRAPH_PR_ITERS		(4)		/* PageRank iterations per round */
+#define GRAPH_PR_DAMPING	(0.85)
+
+/* R-MAT quadrant probabilities a, b, c (d is the remainder), Graph500 */
+#define GRAPH_RMAT_A		(0.57)
+#define GRAPH_RMAT_B		(0.19)
+#define GRAPH_RMAT_C		(0.19)
+
+/* jobs run by all threads between two barriers */
+#define GRAPH_JOB_STOP		(0)
+#define GRAPH_JOB_BFS_INIT	(1)
+#define GRAPH_JOB_BFS_TD	(2)
+#define GRAPH_JOB_BFS_BU	(3)
+#define GRAPH_JOB_PR_CONTRIB	(4)
+#define GRAPH_JOB_PR_PULL	(5)
+
+struct stress_graph;
+
+/* per thread state and per job reduction values */
+typedef struct {
+	struct stress_graph *g;		/* graph */
+	pthread_t pthread;		/* thread handle */
+	uint32_t tid;			/* thread index */
+	int	ret;			/* pthread_create return */
+	bool	sense;			/* barrier sense */
+	uint64_t n_next;		/* vertices added to next frontier */
+	uint64_t m_next;		/* sum of degrees of those vertices */
+	double	dangling;		/* PageRank of zero degree vertices */
+	uint32_t qbuf[GRAPH_QBUF];	/* next frontier buffer */
+	uint32_t qlen;			/* vertices in qbuf */
+} ALIGN64 stress_graph_thread_t;
+
+/* CSR graph and the shared BFS and PageRank state */
+typedef struct stress_graph {
+	uint32_t n;			/* vertices */
+	uint64_t m;			/* directed edges, 2 x undirected */
+	uint64_t *offsets;		/* n + 1 adjacency starts */
+	uint32_t *adj;			/* adjacency lists */
+	uint32_t *parent;		/* BFS parent, GRAPH_NONE if not reached */
+	uint32_t *level;		/* BFS depth */
+	uint32_t *queue;		/* current frontier */
+	uint32_t *next_queue;		/* next frontier */
+	uint64_t *bm;			/* current frontier bitmap */
+	uint64_t *next_bm;		/* next frontier bitmap */
+	double	*pr;			/* PageRank */
+	double	*pr_next;		/* next iteration PageRank */
+	double	*contrib;		/* PageRank / degree */
+	uint32_t *part;			/* n_threads + 1 vertex ranges */
+	void	*mapping;		/* all of the above */
+	size_t	mapping_size;		/* size of mapping */
+
+	uint64_t queue_len;		/* current frontier length */
+	uint64_t next_len ALIGN64;	/* next frontier length, atomic */
+	uint64_t td_next ALIGN64;	/* next frontier index to claim, atomic */
+	uint32_t bar_count ALIGN64;	/* threads waiting at barrier, atomic */
+	bool	bar_sense;		/* barrier release sense */
+	int	job;			/* GRAPH_JOB_* */
+	uint32_t cur_level;		/* BFS level being expanded */
+	double	pr_base;		/* teleport + dangling share */
+	uint32_t n_threads;		/* threads including the main thread */
+	stress_graph_thread_t *threads;	/* per thread state */
+} stress_graph_t;
+
+typedef struct {
+	double	duration;		/* time in kernel */
+	double	edges;			/* edges traversed */
+	uint64_t runs;			/* BFS searches or PageRank iterations */
+	uint64_t levels;		/* BFS levels */
+	uint64_t bu_levels;		/* BFS levels done bottom-up */
+} stress_graph_stats_t;
+
+static inline uint64_t stress_graph_degree(const stress_graph_t *g, const uint32_t v)
+{
+	return g->offsets[v + 1] - g->offsets[v];
+}
+
+/*
+ *  stress_graph_barrier()
+ *	sense reversing barrier over all the graph threads
+ */
+static void stress_graph_barrier(stress_graph_t *g, stress_graph_thread_t *t)
+{
+	const bool sense = !t->sense;
+
+	t->sense = sense;
+	if (__atomic_add_fetch(&g->bar_count, 1, __ATOMIC_ACQ_REL) ==
+	    __atomic_load_n(&g->n_threads, __ATOMIC_ACQUIRE)) {
+		__atomic_store_n(&g->bar_count, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&g->bar_sense, sense, __ATOMIC_RELEASE);
+	} else {
+		while (__atomic_load_n(&g->bar_sense, __ATOMIC_ACQUIRE) != sense)
+			(void)shim_sched_yield();
+	}
+}
+
+/*
+ *  stress_graph_flush()
+ *	append the thread's buffered next frontier to the next queue
+ */
+static void stress_graph_flush(stress_graph_t *g, stress_graph_thread_t *t)
+{
+	uint64_t pos;
+
+	if (!t->qlen)
+		return;
+	pos = __atomic_fetch_add(&g->next_len, (uint64_t)t->qlen, __ATOMIC_RELAXED);
+	(void)memcpy(&g->next_queue[pos], t->qbuf, sizeof(*t->qbuf) * t->qlen);
+	t->qlen = 0;
+}
+
+/*
+ *  stress_graph_visit()
+ *	v has joined the next frontier
+ */
+static inline void stress_graph_visit(
+	stress_graph_t *g,
+	stress_graph_thread_t *t,
+	const uint32_t v)
+{
+	g->level[v] = g->cur_level + 1;
+	t->n_next++;
+	t->m_next += stress_graph_degree(g, v);
+	t->qbuf[t->qlen++] = v;
+	if (UNLIKELY(t->qlen == GRAPH_QBUF))
+		stress_graph_flush(g, t);
+}
+
+/*
+ *  stress_graph_bfs_td()
+ *	top-down step, threads claim chunks of the frontier and
+ *	race to claim each unreached neighbour with a CAS
+ */
+static void stress_graph_bfs_td(stress_graph_t *g, stress_graph_thread_t *t)
+{
+	for (;;) {
+		const uint64_t begin = __atomic_fetch_add(&g->td_next, GRAPH_TD_CHUNK, __ATOMIC_RELAXED);
+		const uint64_t end = (begin + GRAPH_TD_CHUNK < g->queue_len) ?
+			begin + GRAPH_TD_CHUNK : g->queue_len;
+		uint64_t i;
+
+		if (begin >= g->queue_len)
+			break;
+		for (i = begin; i < end; i++) {
+			const uint32_t u = g->queue[i];
+			uint64_t j;
+
+			for (j = g->offsets[u]; j < g->offsets[u + 1]; j++) {
+				const uint32_t v = g->adj[j];
+				uint32_t none = GRAPH_NONE;
+
+				if (g->parent[v] != GRAPH_NONE)
+					continue;
+				if (__atomic_compare_exchange_n(&g->parent[v], &none, u,
+						false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+					__atomic_fetch_or(&g->next_bm[v >> 6], 1ULL << (v & 63), __ATOMIC_RELAXED);
+					stress_graph_visit(g, t, v);
+				}
+			}
+		}
+	}
+	stress_graph_flush(g, t);
+}
+
+/*
+ *  stress_graph_bfs_bu()
+ *	bottom-up step, each thread checks its own unreached vertices
+ *	for a neighbour in the frontier bitmap and stops at the first
+ */
+static void stress_graph_bfs_bu(stress_graph_t *g, stress_graph_thread_t *t)
+{
+	const uint32_t begin = g->part[t->tid];
+	const uint32_t end = g->part[t->tid + 1];
+	uint32_t v;
+
+	for (v = begin; v < end; v++) {
+		uint64_t j;
+
+		if (g->parent[v] != GRAPH_NONE)
+			continue;
+		for (j = g->offsets[v]; j < g->offsets[v + 1]; j++) {
+			const uint32_t u = g->adj[j];
+
+			if (g->bm[u >> 6] & (1ULL << (u & 63))) {
+				g->parent[v] = u;
+				/* vertex ranges are 64 aligned, so the word is ours */
+				g->next_bm[v >> 6] |= 1ULL << (v & 63);
+				stress_graph_visit(g, t, v);
+				break;
+			}
+		}
+	}
+	stress_graph_flush(g, t);
+}
+
+/*
+ *  stress_graph_job()
+ *	run this thread's share of the current job
+ */
+static void stress_graph_job(stress_graph_t *g, stress_graph_thread_t *t)
+{
+	const uint32_t begin = g->part[t->tid];
+	const uint32_t end = g->part[t->tid + 1];
+	uint32_t v;
+
+	t->n_next = 0;
+	t->m_next = 0;
+	t->dangling = 0.0;
+
+	switch (g->job) {
+	case GRAPH_JOB_BFS_INIT:
+		for (v = begin; v < end; v++)
+			g->parent[v] = GRAPH_NONE;
+		(void)memset(&g->bm[begin >> 6], 0, ((end - begin + 63) >> 6) * sizeof(*g->bm));
+		(void)memset(&g->next_bm[begin >> 6], 0, ((end - begin + 63) >> 6) * sizeof(*g->next_bm));
+		break;
+	case GRAPH_JOB_BFS_TD:
+		stress_graph_bfs_td(g, t);
+		break;
+	case GRAPH_JOB_BFS_BU:
+		stress_graph_bfs_bu(g, t);
+		break;
+	case GRAPH_JOB_PR_CONTRIB:
+		for (v = begin; v < end; v++) {
+			const uint64_t deg = stress_graph_degree(g, v);
+
+			if (deg) {
+				g->contrib[v] = g->pr[v] / (double)deg;
+			} else {
+				g->contrib[v] = 0.0;
+				t->dangling += g->pr[v];
+			}
+		}
+		break;
+	case GRAPH_JOB_PR_PULL:
+		for (v = begin; v < end; v++) {
+			double sum = 0.0;
+			uint64_t j;
+
+			for (j = g->offsets[v]; j < g->offsets[v + 1]; j++)
+				sum += g->contrib[g->adj[j]];
+			g->pr_next[v] = g->pr_base + (GRAPH_PR_DAMPING * sum);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ *  stress_graph_thread()
+ *	worker thread, waits for a job, runs its share, waits for
+ *	all the threads to finish
+ */
+static void *stress_graph_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_graph_thread_t *t = (stress_graph_thread_t *)arg;
+	stress_graph_t *g = t->g;
+
+	for (;;) {
+		stress_graph_barrier(g, t);
+		if (g->job == GRAPH_JOB_STOP)
+			break;
+		stress_graph_job(g, t);
+		stress_graph_barrier(g, t);
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_graph_run()
+ *	main thread runs a job across all the threads
+ */
+static void stress_graph_run(stress_graph_t *g, const int job)
+{
+	stress_graph_thread_t *t = &g->threads[0];
+
+	g->job = job;
+	stress_graph_barrier(g, t);
+	stress_graph_job(g, t);
+	stress_graph_barrier(g, t);
+}
+
+/*
+ *  stress_graph_bfs()
+ *	direction optimizing BFS from root, switches to bottom-up when
+ *	the frontier's edges exceed the unexplored edges / GRAPH_ALPHA
+ *	and back to top-down when the frontier shrinks below
+ *	n / GRAPH_BETA vertices. Returns the edges in the reached component
+ */
+static double stress_graph_bfs(stress_graph_t *g, const uint32_t root, stress_graph_stats_t *stats)
+{
+	uint64_t m_f = stress_graph_degree(g, root);
+	uint64_t m_u = g->m - m_f, n_f = 1, m_reached = m_f;
+	bool bottom_up = false;
+
+	stress_graph_run(g, GRAPH_JOB_BFS_INIT);
+	g->parent[root] = root;
+	g->level[root] = 0;
+	g->queue[0] = root;
+	g->queue_len = 1;
+	g->bm[root >> 6] |= 1ULL << (root & 63);
+	g->cur_level = 0;
+
+	while (g->queue_len) {
+		uint32_t *tmp_q;
+		uint64_t *tmp_bm;
+		uint32_t i;
+
+		if (!bottom_up && (m_f > m_u / GRAPH_ALPHA))
+			bottom_up = true;
+		else if (bottom_up && (n_f < g->n / GRAPH_BETA))
+			bottom_up = false;
+
+		g->next_len = 0;
+		g->td_next = 0;
+		stress_graph_run(g, bottom_up ? GRAPH_JOB_BFS_BU : GRAPH_JOB_BFS_TD);
+		stats->levels++;
+		stats->bu_levels += bottom_up;
+
+		n_f = 0;
+		m_f = 0;
+		for (i = 0; i < g->n_threads; i++) {
+			n_f += g->threads[i].n_next;
+			m_f += g->threads[i].m_next;
+		}
+		m_u -= m_f;
+		m_reached += m_f;
+
+		tmp_q = g->queue;
+		g->queue = g->next_queue;
+		g->next_queue = tmp_q;
+		g->queue_len = g->next_len;
+		tmp_bm = g->bm;
+		g->bm = g->next_bm;
+		g->next_bm = tmp_bm;
+		(void)memset(g->next_bm, 0, ((g->n + 63) >> 6) * sizeof(*g->next_bm));
+		g->cur_level++;
+	}
+	/* Graph500 counts undirected edges with an end in the tree */
+	return (double)m_reached / 2.0;
+}
+
+/*
+ *  stress_graph_bfs_check()
+ *	a valid BFS tree has the root at level 0, every reached vertex
+ *	one level below its parent, and every edge joining vertices
+ *	that are both reached or both unreached and at most one level apart
+ */
+static bool stress_graph_bfs_check(const stress_graph_t *g, const uint32_t root)
+{
+	uint32_t u;
+
+	if ((g->parent[root] != root) || (g->level[root] != 0))
+		return false;
+	for (u = 0; u < g->n; u++) {
+		const uint32_t pu = g->parent[u];
+		uint64_t j;
+
+		if ((pu != GRAPH_NONE) && (u != root)) {
+			if ((pu >= g->n) || (g->parent[pu] == GRAPH_NONE) ||
+			    (g->level[u] != g->level[pu] + 1))
+				return false;
+		}
+		for (j = g->offsets[u]; j < g->offsets[u + 1]; j++) {
+			const uint32_t v = g->adj[j];
+
+			if ((pu == GRAPH_NONE) != (g->parent[v] == GRAPH_NONE))
+				return false;
+			if ((pu != GRAPH_NONE) &&
+			    ((g->level[u] > g->level[v] + 1) || (g->level[v] > g->level[u] + 1)))
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ *  stress_graph_pagerank()
+ *	GRAPH_PR_ITERS pull based PageRank iterations, returns
+ *	the sum of the ranks, which should stay at 1
+ */
+static double stress_graph_pagerank(stress_graph_t *g)
+{
+	double sum = 0.0;
+	uint32_t i, v;
+	int iter;
+
+	for (iter = 0; iter < GRAPH_PR_ITERS; iter++) {
+		double dangling = 0.0, *tmp;
+
+		stress_graph_run(g, GRAPH_JOB_PR_CONTRIB);
+		for (i = 0; i < g->n_threads; i++)
+			dangling += g->threads[i].dangling;
+		/* dangling vertices link to every vertex */
+		g->pr_base = ((1.0 - GRAPH_PR_DAMPING) +
+			(GRAPH_PR_DAMPING * dangling)) / (double)g->n;
+		stress_graph_run(g, GRAPH_JOB_PR_PULL);
+		tmp = g->pr;
+		g->pr = g->pr_next;
+		g->pr_next = tmp;
+	}
+	for (v = 0; v < g->n; v++)
+		sum += g->pr[v];
+	return sum;
+}
+
+/*
+ *  stress_graph_partition()
+ *	split the vertices into 64 aligned ranges with about the
+ *	same number of edges for each thread
+ */
+static void stress_graph_partition(stress_graph_t *g)
+{
+	uint32_t t, v = 0;
+
+	for (t = 0; t < g->n_threads; t++) {
+		const uint64_t target = (g->m * (t + 1)) / g->n_threads;
+
+		g->part[t] = v;
+		while ((v < g->n) && (g->offsets[v] < target))
+			v += 64;
+		if ((v > g->n) || (t == g->n_threads - 1))
+			v = g->n;
+	}
+	g->part[g->n_threads] = g->n;
+}
+
+/*
+ *  stress_graph_create()
+ *	generate an R-MAT graph with 2^scale vertices and
+ *	edgefactor x 2^scale undirected edges, relabel the vertices
+ *	randomly so that the high degree vertices are spread out,
+ *	drop self loops and store both directions in CSR form
+ */
+static int stress_graph_create(
+	stress_graph_t *g,
+	const uint32_t scale,
+	const uint32_t edgefactor,
+	const uint32_t n_threads)
+{
+	const uint32_t n = 1U << scale;
+	const uint64_t n_edges = (uint64_t)n * edgefactor;
+	const uint32_t a = (uint32_t)(GRAPH_RMAT_A * 65536.0);
+	const uint32_t ab = (uint32_t)((GRAPH_RMAT_A + GRAPH_RMAT_B) * 65536.0);
+	const uint32_t abc = (uint32_t)((GRAPH_RMAT_A + GRAPH_RMAT_B + GRAPH_RMAT_C) * 65536.0);
+	const size_t words = ((size_t)n + 63) >> 6;
+	size_t edges_size, offs[13], sz = 0;
+	uint32_t *edges, *perm;
+	uint64_t i, m = 0;
+	uint8_t *ptr;
+	uint32_t v;
+
+	(void)memset(g, 0, sizeof(*g));
+	edges_size = (size_t)n_edges * 2 * sizeof(*edges) + (size_t)n * sizeof(*perm);
+	edges = (uint32_t *)mmap(NULL, edges_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (edges == MAP_FAILED)
+		return -1;
+	perm = edges + (n_edges * 2);
+
+	for (v = 0; v < n; v++)
+		perm[v] = v;
+	for (v = n - 1; v > 0; v--) {
+		const uint32_t j = stress_mwc32() % (v + 1);
+		const uint32_t tmp = perm[v];
+
+		perm[v] = perm[j];
+		perm[j] = tmp;
+	}
+	for (i = 0; i < n_edges; i++) {
+		uint32_t src = 0, dst = 0, bit;
+
+		for (bit = 0; bit < scale; bit++) {
+			const uint32_t r = stress_mwc16();
+
+			src <<= 1;
+			dst <<= 1;
+			if (r >= abc) {
+				src |= 1;
+				dst |= 1;
+			} else if (r >= ab) {
+				src |= 1;
+			} else if (r >= a) {
+				dst |= 1;
+			}
+		}
+		edges[i * 2] = perm[src];
+		edges[(i * 2) + 1] = perm[dst];
+		m += (src != dst) ? 2 : 0;
+	}
+
+	/* one mapping, each array cache line aligned */
+#define GRAPH_ALLOC(idx, bytes)	do { offs[idx] = sz; sz += ((bytes) + 63) & ~(size_t)63; } while (0)
+	GRAPH_ALLOC(0, ((size_t)n + 1) * sizeof(*g->offsets));
+	GRAPH_ALLOC(1, (size_t)m * sizeof(*g->adj));
+	GRAPH_ALLOC(2, (size_t)n * sizeof(*g->parent));
+	GRAPH_ALLOC(3, (size_t)n * sizeof(*g->level));
+	GRAPH_ALLOC(4, (size_t)n * sizeof(*g->queue));
+	GRAPH_ALLOC(5, (size_t)n * sizeof(*g->next_queue));
+	GRAPH_ALLOC(6, words * sizeof(*g->bm));
+	GRAPH_ALLOC(7, words * sizeof(*g->next_bm));
+	GRAPH_ALLOC(8, (size_t)n * sizeof(*g->pr));
+	GRAPH_ALLOC(9, (size_t)n * sizeof(*g->pr_next));
+	GRAPH_ALLOC(10, (size_t)n * sizeof(*g->contrib));
+	GRAPH_ALLOC(11, ((size_t)n_threads + 1) * sizeof(*g->part));
+	GRAPH_ALLOC(12, (size_t)n_threads * sizeof(*g->threads));
+#undef GRAPH_ALLOC
+	g->mapping = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (g->mapping == MAP_FAILED) {
+		(void)munmap((void *)edges, edges_size);
+		g->mapping = NULL;
+		return -1;
+	}
+	g->mapping_size = sz;
+	ptr = (uint8_t *)g->mapping;
+	g->offsets = (uint64_t *)(ptr + offs[0]);
+	g->adj = (uint32_t *)(ptr + offs[1]);
+	g->parent = (uint32_t *)(ptr + offs[2]);
+	g->level = (uint32_t *)(ptr + offs[3]);
+	g->queue = (uint32_t *)(ptr + offs[4]);
+	g->next_queue = (uint32_t *)(ptr + offs[5]);
+	g->bm = (uint64_t *)(ptr + offs[6]);
+	g->next_bm = (uint64_t *)(ptr + offs[7]);
+	g->pr = (double *)(ptr + offs[8]);
+	g->pr_next = (double *)(ptr + offs[9]);
+	g->contrib = (double *)(ptr + offs[10]);
+	g->part = (uint32_t *)(ptr + offs[11]);
+	g->threads = (stress_graph_thread_t *)(ptr + offs[12]);
+	g->n = n;
+	g->m = m;
+	g->n_threads = n_threads;
+
+	/* count degrees, prefix sum, then fill using offsets as cursors */
+	for (i = 0; i < n_edges; i++) {
+		const uint32_t src = edges[i * 2], dst = edges[(i * 2) + 1];
+
+		if (src != dst) {
+			g->offsets[src + 1]++;
+			g->offsets[dst + 1]++;
+		}
+	}
+	for (v = 0; v < n; v++)
+		g->offsets[v + 1] += g->offsets[v];
+	for (i = 0; i < n_edges; i++) {
+		const uint32_t src = edges[i * 2], dst = edges[(i * 2) + 1];
+
+		if (src != dst) {
+			g->adj[g->offsets[src]++] = dst;
+			g->adj[g->offsets[dst]++] = src;
+		}
+	}
+	for (v = n; v > 0; v--)
+		g->offsets[v] = g->offsets[v - 1];
+	g->offsets[0] = 0;
+	(void)munmap((void *)edges, edges_size);
+
+	for (v = 0; v < n; v++)
+		g->pr[v] = 1.0 / (double)n;
+	stress_graph_partition(g);
+
+	return 0;
+}
+
+/*
+ *  stress_graph_root()
+ *	pick a random root that is not isolated
+ */
+static uint32_t stress_graph_root(const stress_graph_t *g)
+{
+	uint32_t root = 0;
+	int i;
+
+	for (i = 0; i < 64; i++) {
+		root = stress_mwc32() & (g->n - 1);
+		if (stress_graph_degree(g, root))
+			break;
+	}
+	return root;
+}
+
+/*
+ *  stress_graph()
+ *	stress irregular parallel graph traversal
+ */
+static int stress_graph(const stress_args_t *args)
+{
+	stress_graph_t g;
+	stress_graph_stats_t bfs, pr;
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t graph_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+	uint32_t graph_scale = DEFAULT_GRAPH_SCALE;
+	uint32_t graph_edgefactor = DEFAULT_GRAPH_EDGEFACTOR;
+	uint32_t i, started = 1;
+	size_t graph_method = 0, idx = 0;
+	uint64_t max_deg = 0;
+	double t_build;
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	(void)stress_get_setting("graph-edgefactor", &graph_edgefactor);
+	(void)stress_get_setting("graph-method", &graph_method);
+	if (!stress_get_setting("graph-scale", &graph_scale)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			graph_scale = MAX_GRAPH_SCALE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			graph_scale = MIN_GRAPH_SCALE;
+	}
+	if (!stress_get_setting("graph-threads", &graph_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			graph_threads = MAX_GRAPH_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			graph_threads = MIN_GRAPH_THREADS;
+	}
+	if (graph_threads > MAX_GRAPH_THREADS)
+		graph_threads = MAX_GRAPH_THREADS;
+
+	t_build = stress_time_now();
+	if (stress_graph_create(&g, graph_scale, graph_edgefactor, graph_threads) < 0) {
+		pr_inf_skip("%s: cannot mmap a graph of 2^%" PRIu32 " vertices and %" PRIu32
+			" edges per vertex, skipping stressor\n", args->name,
+			graph_scale, graph_edgefactor);
+		return EXIT_NO_RESOURCE;
+	}
+	t_build = stress_time_now() - t_build;
+	for (i = 0; i < g.n; i++) {
+		const uint64_t deg = stress_graph_degree(&g, i);
+
+		if (deg > max_deg)
+			max_deg = deg;
+	}
+
+	for (i = 0; i < graph_threads; i++) {
+		g.threads[i].g = &g;
+		g.threads[i].tid = i;
+	}
+	for (i = 1; i < graph_threads; i++) {
+		stress_graph_thread_t *t = &g.threads[i];
+
+		t->ret = pthread_create(&t->pthread, NULL, stress_graph_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+	if (started < graph_threads) {
+		pr_inf_skip("%s: cannot create %" PRIu32 " pthreads, errno=%d (%s), "
+			"skipping stressor\n", args->name, graph_threads,
+			g.threads[started].ret, strerror(g.threads[started].ret));
+		/* release the started threads with a smaller barrier */
+		__atomic_store_n(&g.n_threads, started, __ATOMIC_RELEASE);
+		rc = EXIT_NO_RESOURCE;
+	}
+
+	(void)memset(&bfs, 0, sizeof(bfs));
+	(void)memset(&pr, 0, sizeof(pr));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	while ((rc == EXIT_SUCCESS) && keep_stressing(args)) {
+		if ((graph_method == 0) || (graph_method == 1)) {
+			const uint32_t root = stress_graph_root(&g);
+			const double t = stress_time_now();
+			const double edges = stress_graph_bfs(&g, root, &bfs);
+
+			bfs.duration += stress_time_now() - t;
+			bfs.edges += edges;
+			bfs.runs++;
+			if (verify && !stress_graph_bfs_check(&g, root)) {
+				pr_fail("%s: BFS from root %" PRIu32 " produced an invalid BFS tree\n",
+					args->name, root);
+				rc = EXIT_FAILURE;
+			}
+			inc_counter(args);
+		}
+		if ((graph_method == 0) || (graph_method == 2)) {
+			const double t = stress_time_now();
+			const double sum = stress_graph_pagerank(&g);
+
+			pr.duration += stress_time_now() - t;
+			pr.edges += (double)g.m * GRAPH_PR_ITERS;
+			pr.runs += GRAPH_PR_ITERS;
+			if (verify && (fabs(sum - 1.0) > 1.0E-6)) {
+				pr_fail("%s: PageRank sum is %.9f, expected 1.0\n",
+					args->name, sum);
+				rc = EXIT_FAILURE;
+			}
+			inc_counter(args);
+		}
+	}
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	g.job = GRAPH_JOB_STOP;
+	stress_graph_barrier(&g, &g.threads[0]);
+	for (i = 1; i < started; i++)
+		(void)pthread_join(g.threads[i].pthread, NULL);
+
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " vertices, %" PRIu64 " edges, max degree %" PRIu64
+			", built in %.2f secs, %" PRIu32 " threads\n",
+			args->name, g.n, g.m / 2, max_deg, t_build, g.n_threads);
+	if (bfs.runs && (bfs.duration > 0.0)) {
+		const double mteps = (bfs.edges / bfs.duration) / 1000000.0;
+		const double bu_pc = bfs.levels ?
+			100.0 * (double)bfs.bu_levels / (double)bfs.levels : 0.0;
+
+		if (args->instance == 0)
+			pr_inf("%s: bfs      %10.2f MTEPS, %.3f ms per search, %.1f levels, "
+				"%.1f%% bottom-up\n", args->name, mteps,
+				1000.0 * bfs.duration / (double)bfs.runs,
+				(double)bfs.levels / (double)bfs.runs, bu_pc);
+		stress_misc_stats_set(args->misc_stats, idx++, "BFS MTEPS", mteps);
+		stress_misc_stats_set(args->misc_stats, idx++, "BFS bottom-up levels %", bu_pc);
+	}
+	if (pr.runs && (pr.duration > 0.0)) {
+		const double mteps = (pr.edges / pr.duration) / 1000000.0;
+		const double rate = (double)pr.runs / pr.duration;
+
+		if (args->instance == 0)
+			pr_inf("%s: pagerank %10.2f MTEPS, %.2f iterations per sec\n",
+				args->name, mteps, rate);
+		stress_misc_stats_set(args->misc_stats, idx++, "PageRank MTEPS", mteps);
+		stress_misc_stats_set(args->misc_stats, idx++, "PageRank iterations/sec", rate);
+	}
+
+	(void)munmap(g.mapping, g.mapping_size);
+
+	return rc;
+}
+
+stressor_info_t stress_graph_info = {
+	.stressor = stress_graph,
+	.class = CLASS_MEMORY | CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
+#else
+stressor_info_t stress_graph_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_MEMORY | CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -18,14 +18,27 @@
  */
 #include "stress-ng.h"
 #include "core-hash.h"
+#include "core-put.h"
 #if defined(HAVE_XXHASH_H)
 #include <xxhash.h>
 #endif
 
+/* input lengths for the throughput measurements */
+static const size_t hash_lengths[] = {
+	8, 64, 512, 4096, 65536
+};
+
+#define HASH_LENGTHS		SIZEOF_ARRAY(hash_lengths)
+#define HASH_LENGTH_MAX		(65536)
+#define HASH_THROUGHPUT_BYTES	(4096)	/* bytes hashed per length per call */
+
 typedef struct {
 	double_t	duration;
 	double		chi_squared;
 	uint64_t	total;
+	size_t		length;			/* next throughput length */
+	double		bytes[HASH_LENGTHS];	/* bytes hashed per length */
+	double		bytes_duration[HASH_LENGTHS];
 } stress_hash_stats_t;
 
 typedef struct {
@@ -54,8 +67,42 @@ static const stress_help_t help[] = {
 	{ NULL,	 NULL,			NULL }
 };
 
+/* verify sum for xxh3acc and xxh3acc_vec, same on all CPUs */
+#define XXH3ACC_RESULT		(0x97a7b765)
+
 static stress_hash_method_info_t hash_methods[];
 
+static char ALIGN64 hash_throughput_buffer[HASH_LENGTH_MAX + 1];
+
+/*
+ *  stress_hash_throughput()
+ *	hash strings of one of the hash_lengths, a different length
+ *	each call, and account the bytes hashed per second
+ */
+static void stress_hash_throughput(
+	stress_hash_stats_t *stats,
+	const stress_hash_func hash_func)
+{
+	const size_t idx = stats->length;
+	const size_t len = hash_lengths[idx];
+	const size_t n = (len < HASH_THROUGHPUT_BYTES) ? HASH_THROUGHPUT_BYTES / len : 1;
+	uint32_t sum = 0;
+	size_t i;
+	double t;
+
+	/* the string hashes need a terminated string */
+	hash_throughput_buffer[len] = '\0';
+	t = stress_time_now();
+	for (i = 0; i < n; i++)
+		sum += hash_func(hash_throughput_buffer, len);
+	stats->bytes_duration[idx] += stress_time_now() - t;
+	stats->bytes[idx] += (double)(n * len);
+	hash_throughput_buffer[len] = ' ';
+	stress_uint32_put(sum);
+
+	stats->length = (idx + 1) % HASH_LENGTHS;
+}
+
 /*
  *  stress_hash_generic()
  *	stress test generic string hash function
@@ -116,6 +163,8 @@ static void stress_hash_generic(
 
 	stats->chi_squared = sum / divisor;
 
+	stress_hash_throughput(stats, hash_func);
+
 	if (verify && (i_sum != result))
 		pr_fail("%s: error detected, failed hash checksum %s, "
 			"expected %" PRIx32 ", got %" PRIx32 "\n",
@@ -289,6 +338,19 @@ static void stress_hash_method_crc32c(
 	stress_hash_generic(name, hmi, bucket, stress_hash_crc32c_wrapper, 0x923ab2b3, 0x923ab2b3);
 }
 
+/*
+ *  stress_hash_method_crc32c_hw()
+ *	stress test hash crc32c using CRC instructions if available,
+ *	gives the same hashes as crc32c
+ */
+static void stress_hash_method_crc32c_hw(
+	const char *name,
+	const struct stress_hash_method_info *hmi,
+	const stress_bucket_t *bucket)
+{
+	stress_hash_generic(name, hmi, bucket, stress_hash_crc32c_hw, 0x923ab2b3, 0x923ab2b3);
+}
+
 static uint32_t OPTIMIZE3 stress_hash_xor(const char *str, const size_t len)
 {
 	register uint32_t sum = 0;
@@ -504,6 +566,31 @@ static void stress_hash_method_mulxror64(
 }
 
 
+/*
+ *  stress_hash_method_xxh3acc()
+ *	stress test XXH3 style hash xxh3acc
+ */
+static void stress_hash_method_xxh3acc(
+	const char *name,
+	const struct stress_hash_method_info *hmi,
+	const stress_bucket_t *bucket)
+{
+	stress_hash_generic(name, hmi, bucket, stress_hash_xxh3acc, XXH3ACC_RESULT, XXH3ACC_RESULT);
+}
+
+/*
+ *  stress_hash_method_xxh3acc_vec()
+ *	stress test XXH3 style hash xxh3acc using vector instructions,
+ *	gives the same hashes as xxh3acc
+ */
+static void stress_hash_method_xxh3acc_vec(
+	const char *name,
+	const struct stress_hash_method_info *hmi,
+	const stress_bucket_t *bucket)
+{
+	stress_hash_generic(name, hmi, bucket, stress_hash_xxh3acc_vec, XXH3ACC_RESULT, XXH3ACC_RESULT);
+}
+
 /*
  *  stress_hash_all()
  *	iterate over all hash stressor methods
@@ -533,6 +620,7 @@ static stress_hash_method_info_t hash_methods[] = {
 	{ "coffin",		stress_hash_method_coffin,	NULL },
 	{ "coffin32",		stress_hash_method_coffin32,	NULL },
 	{ "crc32c",		stress_hash_method_crc32c,	NULL },
+	{ "crc32c_hw",		stress_hash_method_crc32c_hw,	NULL },
 	{ "djb2a",		stress_hash_method_djb2a,	NULL },
 	{ "fnv1a",		stress_hash_method_fnv1a,	NULL },
 	{ "jenkin",		stress_hash_method_jenkin,	NULL },
@@ -549,6 +637,8 @@ static stress_hash_method_info_t hash_methods[] = {
 	{ "sdbm",		stress_hash_method_sdbm,	NULL },
 	{ "x17",		stress_hash_method_x17,		NULL },
 	{ "xor",		stress_hash_method_xor,		NULL },
+	{ "xxh3acc",		stress_hash_method_xxh3acc,	NULL },
+	{ "xxh3acc_vec",	stress_hash_method_xxh3acc_vec,	NULL },
 #if defined(HAVE_XXHASH_H) &&	\
     defined(HAVE_LIB_XXHASH)
 	{ "xxh64",		stress_hash_method_xxh64,	NULL },
@@ -588,11 +678,12 @@ static int stress_set_hash_method(const char *name)
  */
 static int HOT OPTIMIZE3 stress_hash(const stress_args_t *args)
 {
-	size_t i;
+	size_t i, j;
 	const stress_hash_method_info_t *hm;
 	size_t hash_method = 0;
 	bool lock = false;
 	stress_bucket_t bucket;
+	stress_counter_batch_t cb;
 
 	bucket.n_keys = 128;
 	bucket.n_buckets = 256;
@@ -611,17 +702,28 @@ static int HOT OPTIMIZE3 stress_hash(const stress_args_t *args)
 		hash_stats[i].duration = 0.0;
 		hash_stats[i].total = false;
 		hash_stats[i].chi_squared = 0.0;
+		hash_stats[i].length = 0;
+		for (j = 0; j < HASH_LENGTHS; j++) {
+			hash_stats[i].bytes[j] = 0.0;
+			hash_stats[i].bytes_duration[j] = 0.0;
+		}
 		hash_methods[i].stats = &hash_stats[i];
 	}
 
+	/* ASCII range ' '..'_', no terminating zeros */
+	stress_uint8rnd4((uint8_t *)hash_throughput_buffer, sizeof(hash_throughput_buffer));
+	for (i = 0; i < sizeof(hash_throughput_buffer); i++)
+		hash_throughput_buffer[i] = (hash_throughput_buffer[i] & 0x3f) + ' ';
+
 	pr_dbg("%s: using method '%s'\n", args->name, hm->name);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	stress_counter_batch_init(&cb, 16);
 	do {
 		(void)hm->func(args->name, hm, &bucket);
-		inc_counter(args);
-	} while (keep_stressing(args));
+		inc_counter_batch(args, &cb);
+	} while (keep_stressing_batch(args, &cb));
 
 	if (args->instance == 0) {
 		pr_lock(&lock);
@@ -638,9 +740,45 @@ static int HOT OPTIMIZE3 stress_hash(const stress_args_t *args)
 					args->name, hash_methods[i].name, rate, stats->chi_squared);
 			}
 		}
+
+		pr_inf_lock(&lock, "%s: %12.12s %9s %9s %9s %9s %9s (MB/sec by input length)\n",
+			args->name, "hash", "8B", "64B", "512B", "4KB", "64KB");
+		for (i = 1; hash_methods[i].name; i++) {
+			stress_hash_stats_t *stats = hash_methods[i].stats;
+			char buf[64] = "";
+
+			if (stats->total == 0)
+				continue;
+			for (j = 0; j < HASH_LENGTHS; j++) {
+				char tmp[16];
+				const double rate = (stats->bytes_duration[j] > 0.0) ?
+					stats->bytes[j] / stats->bytes_duration[j] : 0.0;
+
+				(void)snprintf(tmp, sizeof(tmp), " %9.1f", rate / (double)MB);
+				(void)shim_strlcat(buf, tmp, sizeof(buf));
+			}
+			pr_inf_lock(&lock, "%s: %12.12s%s\n", args->name, hash_methods[i].name, buf);
+		}
+		pr_inf_lock(&lock, "%s: crc32c_hw is using %s, xxh3acc_vec is using %s\n",
+			args->name, stress_hash_crc32c_hw_impl(), stress_hash_xxh3acc_vec_impl());
 		pr_unlock(&lock);
 	}
 
+	/* bytes per second for a single hash method */
+	if (hash_method) {
+		const stress_hash_stats_t *stats = hm->stats;
+
+		for (j = 0; j < HASH_LENGTHS; j++) {
+			char desc[40];
+
+			if (stats->bytes_duration[j] <= 0.0)
+				continue;
+			(void)snprintf(desc, sizeof(desc), "MB/sec for %zu byte inputs", hash_lengths[j]);
+			stress_misc_stats_set(args->misc_stats, j, desc,
+				(stats->bytes[j] / stats->bytes_duration[j]) / (double)MB);
+		}
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	free(bucket.buckets);
@@ -0,0 +1,856 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-bitops.h"
+#include "core-put.h"
+
+#define MIN_HASHTABLE_SIZE	(16 * KB)
+#define MAX_HASHTABLE_SIZE	(256 * MB)
+#define DEFAULT_HASHTABLE_SIZE	(64 * MB)
+
+#define HASHTABLE_SLOT_SIZE	(16)		/* key + value */
+#define HASHTABLE_MAX_SIZES	(8)		/* 16K, 256K, 4M, 64M, 256M */
+#define HASHTABLE_CUCKOO_WAYS	(4)		/* slots per cuckoo bucket */
+#define HASHTABLE_CUCKOO_KICKS	(512)		/* displacements before stashing */
+#define HASHTABLE_CUCKOO_STASH	(64)		/* overflow stash items */
+#define HASHTABLE_SWISS_EMPTY	(0x80)		/* control byte empty slot */
+#define HASHTABLE_SWISS_DELETED	(0xfe)		/* control byte tombstone */
+
+#define HASHTABLE_PHASE_INSERT	(0)
+#define HASHTABLE_PHASE_HIT	(1)
+#define HASHTABLE_PHASE_MISS	(2)
+#define HASHTABLE_PHASE_DELETE	(3)
+#define HASHTABLE_PHASES	(4)
+
+#define LSB_BYTES		(0x0101010101010101ULL)
+#define MSB_BYTES		(0x8080808080808080ULL)
+
+static const stress_help_t help[] = {
+	{ NULL,	"hashtable N",		"start N workers that benchmark hash table implementations" },
+	{ NULL,	"hashtable-method M",	"select chain, linear, robin, swiss, cuckoo or all" },
+	{ NULL,	"hashtable-ops N",	"stop after N hash table fill and empty cycles" },
+	{ NULL,	"hashtable-size N",	"sweep table sizes from 16K up to N bytes, default is 64M" },
+	{ NULL,	NULL,			NULL }
+};
+
+/* load factors in percent, swept for each table size */
+static const uint32_t hashtable_loads[] = {
+	50, 75, 90, 95
+};
+
+/*
+ *  Hash table state, a single mmap'd region is carved up
+ *  by each implementation's init function
+ */
+typedef struct {
+	uint64_t *keys;			/* slot keys, 0 is an empty slot */
+	uint64_t *values;		/* slot values */
+	uint64_t *ctrl;			/* swiss control bytes, 8 per group */
+	uint32_t *heads;		/* chain bucket heads, node index + 1 */
+	uint32_t *next;			/* chain node next, node index + 1 */
+	uint32_t free_node;		/* chain next unused node */
+	uint32_t free_list;		/* chain freed nodes, node index + 1 */
+	size_t mask;			/* slots, groups or buckets - 1 */
+	size_t stash_n;			/* cuckoo stash items in use */
+	uint64_t stash_keys[HASHTABLE_CUCKOO_STASH];
+	uint64_t stash_values[HASHTABLE_CUCKOO_STASH];
+} stress_hashtable_t;
+
+typedef struct {
+	const char *name;
+	void (*init)(stress_hashtable_t *ht, void *mem, const size_t slots);
+	bool (*insert)(stress_hashtable_t *ht, const uint64_t key, const uint64_t value);
+	bool (*lookup)(const stress_hashtable_t *ht, const uint64_t key, uint64_t *value);
+	bool (*remove)(stress_hashtable_t *ht, const uint64_t key);
+	size_t (*mem_size)(const size_t slots);
+} stress_hashtable_method_t;
+
+typedef struct {
+	double ops;
+	double duration;
+} stress_hashtable_stats_t;
+
+/*
+ *  stress_hashtable_mix()
+ *	murmur3 64 bit finalizer, a bijection so distinct
+ *	non-zero inputs give distinct non-zero keys
+ */
+static inline uint64_t ALWAYS_INLINE stress_hashtable_mix(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+static inline uint64_t ALWAYS_INLINE stress_hashtable_hash(const uint64_t key)
+{
+	const uint64_t h = key * 0x9e3779b97f4a7c15ULL;
+
+	return h ^ (h >> 29);
+}
+
+/*
+ *  Chained hashing, one bucket head per slot and a pool
+ *  of nodes, nodes are linked by index to keep them small
+ */
+static size_t stress_hashtable_chain_mem_size(const size_t slots)
+{
+	return slots * ((2 * sizeof(uint64_t)) + (2 * sizeof(uint32_t)));
+}
+
+static void stress_hashtable_chain_init(stress_hashtable_t *ht, void *mem, const size_t slots)
+{
+	ht->keys = (uint64_t *)mem;
+	ht->values = ht->keys + slots;
+	ht->heads = (uint32_t *)(ht->values + slots);
+	ht->next = ht->heads + slots;
+	ht->mask = slots - 1;
+	ht->free_node = 0;
+	ht->free_list = 0;
+	(void)memset(ht->heads, 0, slots * sizeof(*ht->heads));
+}
+
+static bool stress_hashtable_chain_insert(stress_hashtable_t *ht, const uint64_t key, const uint64_t value)
+{
+	const size_t b = stress_hashtable_hash(key) & ht->mask;
+	uint32_t node;
+
+	if (ht->free_list) {
+		node = ht->free_list - 1;
+		ht->free_list = ht->next[node];
+	} else {
+		if (ht->free_node > ht->mask)
+			return false;
+		node = ht->free_node++;
+	}
+	ht->keys[node] = key;
+	ht->values[node] = value;
+	ht->next[node] = ht->heads[b];
+	ht->heads[b] = node + 1;
+	return true;
+}
+
+static bool stress_hashtable_chain_lookup(const stress_hashtable_t *ht, const uint64_t key, uint64_t *value)
+{
+	uint32_t n = ht->heads[stress_hashtable_hash(key) & ht->mask];
+
+	while (n) {
+		if (ht->keys[n - 1] == key) {
+			*value = ht->values[n - 1];
+			return true;
+		}
+		n = ht->next[n - 1];
+	}
+	return false;
+}
+
+static bool stress_hashtable_chain_remove(stress_hashtable_t *ht, const uint64_t key)
+{
+	uint32_t *prev = &ht->heads[stress_hashtable_hash(key) & ht->mask];
+
+	while (*prev) {
+		const uint32_t node = *prev - 1;
+
+		if (ht->keys[node] == key) {
+			*prev = ht->next[node];
+			ht->next[node] = ht->free_list;
+			ht->free_list = node + 1;
+			return true;
+		}
+		prev = &ht->next[node];
+	}
+	return false;
+}
+
+/*
+ *  Open addressing, linear probing and Robin Hood hashing share
+ *  the same key and value slot arrays, deletes shift the following
+ *  displaced items back so no tombstones are required
+ */
+static size_t stress_hashtable_open_mem_size(const size_t slots)
+{
+	return slots * (2 * sizeof(uint64_t));
+}
+
+static void stress_hashtable_open_init(stress_hashtable_t *ht, void *mem, const size_t slots)
+{
+	ht->keys = (uint64_t *)mem;
+	ht->values = ht->keys + slots;
+	ht->mask = slots - 1;
+	(void)memset(ht->keys, 0, slots * sizeof(*ht->keys));
+}
+
+static bool stress_hashtable_linear_insert(stress_hashtable_t *ht, const uint64_t key, const uint64_t value)
+{
+	size_t i = stress_hashtable_hash(key) & ht->mask;
+
+	while (ht->keys[i])
+		i = (i + 1) & ht->mask;
+	ht->keys[i] = key;
+	ht->values[i] = value;
+	return true;
+}
+
+static bool stress_hashtable_open_lookup(const stress_hashtable_t *ht, const uint64_t key, uint64_t *value)
+{
+	size_t i = stress_hashtable_hash(key) & ht->mask;
+
+	while (ht->keys[i]) {
+		if (ht->keys[i] == key) {
+			*value = ht->values[i];
+			return true;
+		}
+		i = (i + 1) & ht->mask;
+	}
+	return false;
+}
+
+/*
+ *  stress_hashtable_open_remove()
+ *	backward shift deletion, valid for both linear probing
+ *	and Robin Hood hashing
+ */
+static bool stress_hashtable_open_remove(stress_hashtable_t *ht, const uint64_t key)
+{
+	size_t i = stress_hashtable_hash(key) & ht->mask, j;
+
+	while (ht->keys[i] != key) {
+		if (!ht->keys[i])
+			return false;
+		i = (i + 1) & ht->mask;
+	}
+	for (j = (i + 1) & ht->mask; ht->keys[j]; j = (j + 1) & ht->mask) {
+		const size_t home = stress_hashtable_hash(ht->keys[j]) & ht->mask;
+
+		/* can the item at j move back into the hole at i? */
+		if (((j - home) & ht->mask) >= ((j - i) & ht->mask)) {
+			ht->keys[i] = ht->keys[j];
+			ht->values[i] = ht->values[j];
+			i = j;
+		}
+	}
+	ht->keys[i] = 0;
+	return true;
+}
+
+/*
+ *  stress_hashtable_robin_insert()
+ *	take the slot of any item nearer its home than the item
+ *	being inserted and carry on inserting the displaced item
+ */
+static bool stress_hashtable_robin_insert(stress_hashtable_t *ht, uint64_t key, uint64_t value)
+{
+	size_t i = stress_hashtable_hash(key) & ht->mask, dist = 0;
+
+	while (ht->keys[i]) {
+		const size_t d = (i - stress_hashtable_hash(ht->keys[i])) & ht->mask;
+
+		if (d < dist) {
+			const uint64_t k = ht->keys[i];
+			const uint64_t v = ht->values[i];
+
+			ht->keys[i] = key;
+			ht->values[i] = value;
+			key = k;
+			value = v;
+			dist = d;
+		}
+		i = (i + 1) & ht->mask;
+		dist++;
+	}
+	ht->keys[i] = key;
+	ht->values[i] = value;
+	return true;
+}
+
+/*
+ *  stress_hashtable_robin_lookup()
+ *	a miss stops as soon as an item nearer its home than
+ *	the probe distance is found
+ */
+static bool stress_hashtable_robin_lookup(const stress_hashtable_t *ht, const uint64_t key, uint64_t *value)
+{
+	size_t i = stress_hashtable_hash(key) & ht->mask, dist = 0;
+
+	while (ht->keys[i]) {
+		if (ht->keys[i] == key) {
+			*value = ht->values[i];
+			return true;
+		}
+		if (((i - stress_hashtable_hash(ht->keys[i])) & ht->mask) < dist)
+			return false;
+		i = (i + 1) & ht->mask;
+		dist++;
+	}
+	return false;
+}
+
+/*
+ *  SwissTable style hashing, slots are in groups of 8 with a
+ *  control byte per slot holding 7 bits of the hash. A group's
+ *  control bytes are matched in one go with SWAR bit tricks,
+ *  groups are probed quadratically
+ */
+static size_t stress_hashtable_swiss_mem_size(const size_t slots)
+{
+	return slots * ((2 * sizeof(uint64_t)) + 1);
+}
+
+static void stress_hashtable_swiss_init(stress_hashtable_t *ht, void *mem, const size_t slots)
+{
+	ht->keys = (uint64_t *)mem;
+	ht->values = ht->keys + slots;
+	ht->ctrl = ht->values + slots;
+	ht->mask = (slots / 8) - 1;
+	(void)memset(ht->ctrl, HASHTABLE_SWISS_EMPTY, slots);
+}
+
+/* bytes of group matching control byte c have their top bit set */
+static inline uint64_t ALWAYS_INLINE stress_hashtable_swiss_match(const uint64_t group, const uint8_t c)
+{
+	const uint64_t x = group ^ (LSB_BYTES * c);
+
+	return (x - LSB_BYTES) & ~x & MSB_BYTES;
+}
+
+static inline uint64_t ALWAYS_INLINE stress_hashtable_swiss_match_empty(const uint64_t group)
+{
+	return group & (~group << 6) & MSB_BYTES;
+}
+
+static inline uint64_t ALWAYS_INLINE stress_hashtable_swiss_match_free(const uint64_t group)
+{
+	return group & ~(group << 7) & MSB_BYTES;
+}
+
+/* index of the lowest byte set in a match mask */
+static inline size_t ALWAYS_INLINE stress_hashtable_swiss_first(const uint64_t mask)
+{
+#if defined(HAVE_BUILTIN_CTZ)
+	return (size_t)__builtin_ctzll(mask) >> 3;
+#else
+	size_t i;
+
+	for (i = 0; !(mask & (0x80ULL << (i << 3))); i++)
+		;
+	return i;
+#endif
+}
+
+static inline void ALWAYS_INLINE stress_hashtable_swiss_set(
+	stress_hashtable_t *ht,
+	const size_t g,
+	const size_t i,
+	const uint8_t c)
+{
+	const size_t shift = i << 3;
+
+	ht->ctrl[g] = (ht->ctrl[g] & ~(0xffULL << shift)) | ((uint64_t)c << shift);
+}
+
+static bool stress_hashtable_swiss_insert(stress_hashtable_t *ht, const uint64_t key, const uint64_t value)
+{
+	const uint64_t h = stress_hashtable_hash(key);
+	size_t g = (size_t)(h >> 7) & ht->mask, step = 0;
+
+	for (;;) {
+		const uint64_t m = stress_hashtable_swiss_match_free(ht->ctrl[g]);
+
+		if (m) {
+			const size_t i = stress_hashtable_swiss_first(m);
+			const size_t slot = (g << 3) + i;
+
+			stress_hashtable_swiss_set(ht, g, i, (uint8_t)(h & 0x7f));
+			ht->keys[slot] = key;
+			ht->values[slot] = value;
+			return true;
+		}
+		if (++step > ht->mask)
+			return false;
+		g = (g + step) & ht->mask;
+	}
+}
+
+/*
+ *  stress_hashtable_swiss_find()
+ *	return the slot holding key or -1 if not found
+ */
+static inline ssize_t ALWAYS_INLINE stress_hashtable_swiss_find(const stress_hashtable_t *ht, const uint64_t key)
+{
+	const uint64_t h = stress_hashtable_hash(key);
+	size_t g = (size_t)(h >> 7) & ht->mask, step = 0;
+
+	for (;;) {
+		const uint64_t group = ht->ctrl[g];
+		uint64_t m = stress_hashtable_swiss_match(group, (uint8_t)(h & 0x7f));
+
+		while (m) {
+			const size_t slot = (g << 3) + stress_hashtable_swiss_first(m);
+
+			if (ht->keys[slot] == key)
+				return (ssize_t)slot;
+			m &= m - 1;
+		}
+		if (stress_hashtable_swiss_match_empty(group))
+			return -1;
+		if (++step > ht->mask)
+			return -1;
+		g = (g + step) & ht->mask;
+	}
+}
+
+static bool stress_hashtable_swiss_lookup(const stress_hashtable_t *ht, const uint64_t key, uint64_t *value)
+{
+	const ssize_t slot = stress_hashtable_swiss_find(ht, key);
+
+	if (slot < 0)
+		return false;
+	*value = ht->values[slot];
+	return true;
+}
+
+static bool stress_hashtable_swiss_remove(stress_hashtable_t *ht, const uint64_t key)
+{
+	const ssize_t slot = stress_hashtable_swiss_find(ht, key);
+
+	if (slot < 0)
+		return false;
+	stress_hashtable_swiss_set(ht, (size_t)slot >> 3, (size_t)slot & 7, HASHTABLE_SWISS_DELETED);
+	return true;
+}
+
+/*
+ *  Bucketized cuckoo hashing, each key has two candidate buckets
+ *  of 4 slots. A full pair of buckets displaces a random item to
+ *  its alternate bucket, long displacement chains end up in a
+ *  small stash
+ */
+static void stress_hashtable_cuckoo_init(stress_hashtable_t *ht, void *mem, const size_t slots)
+{
+	ht->keys = (uint64_t *)mem;
+	ht->values = ht->keys + slots;
+	ht->mask = (slots / HASHTABLE_CUCKOO_WAYS) - 1;
+	ht->stash_n = 0;
+	(void)memset(ht->keys, 0, slots * sizeof(*ht->keys));
+}
+
+static inline size_t ALWAYS_INLINE stress_hashtable_cuckoo_b1(const stress_hashtable_t *ht, const uint64_t key)
+{
+	return (size_t)stress_hashtable_hash(key) & ht->mask;
+}
+
+static inline size_t ALWAYS_INLINE stress_hashtable_cuckoo_b2(const stress_hashtable_t *ht, const uint64_t key)
+{
+	return (size_t)(stress_hashtable_hash(key) >> 32) & ht->mask;
+}
+
+static inline bool ALWAYS_INLINE stress_hashtable_cuckoo_put(
+	stress_hashtable_t *ht,
+	const size_t b,
+	const uint64_t key,
+	const uint64_t value)
+{
+	uint64_t *keys = &ht->keys[b * HASHTABLE_CUCKOO_WAYS];
+	size_t i;
+
+	for (i = 0; i < HASHTABLE_CUCKOO_WAYS; i++) {
+		if (!keys[i]) {
+			keys[i] = key;
+			ht->values[(b * HASHTABLE_CUCKOO_WAYS) + i] = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool stress_hashtable_cuckoo_insert(stress_hashtable_t *ht, uint64_t key, uint64_t value)
+{
+	size_t b = stress_hashtable_cuckoo_b1(ht, key), kicks;
+
+	if (stress_hashtable_cuckoo_put(ht, b, key, value))
+		return true;
+	b = stress_hashtable_cuckoo_b2(ht, key);
+	if (stress_hashtable_cuckoo_put(ht, b, key, value))
+		return true;
+
+	for (kicks = 0; kicks < HASHTABLE_CUCKOO_KICKS; kicks++) {
+		const size_t slot = (b * HASHTABLE_CUCKOO_WAYS) + (stress_mwc8() % HASHTABLE_CUCKOO_WAYS);
+		const uint64_t k = ht->keys[slot];
+		const uint64_t v = ht->values[slot];
+		const size_t b1 = stress_hashtable_cuckoo_b1(ht, k);
+
+		ht->keys[slot] = key;
+		ht->values[slot] = value;
+		key = k;
+		value = v;
+		b = (b1 == b) ? stress_hashtable_cuckoo_b2(ht, k) : b1;
+		if (stress_hashtable_cuckoo_put(ht, b, key, value))
+			return true;
+	}
+	if (ht->stash_n >= HASHTABLE_CUCKOO_STASH)
+		return false;
+	ht->stash_keys[ht->stash_n] = key;
+	ht->stash_values[ht->stash_n] = value;
+	ht->stash_n++;
+	return true;
+}
+
+static inline ssize_t ALWAYS_INLINE stress_hashtable_cuckoo_find_bucket(
+	const stress_hashtable_t *ht,
+	const size_t b,
+	const uint64_t key)
+{
+	const uint64_t *keys = &ht->keys[b * HASHTABLE_CUCKOO_WAYS];
+	size_t i;
+
+	for (i = 0; i < HASHTABLE_CUCKOO_WAYS; i++) {
+		if (keys[i] == key)
+			return (ssize_t)((b * HASHTABLE_CUCKOO_WAYS) + i);
+	}
+	return -1;
+}
+
+static bool stress_hashtable_cuckoo_lookup(const stress_hashtable_t *ht, const uint64_t key, uint64_t *value)
+{
+	ssize_t slot;
+	size_t i;
+
+	slot = stress_hashtable_cuckoo_find_bucket(ht, stress_hashtable_cuckoo_b1(ht, key), key);
+	if (slot < 0)
+		slot = stress_hashtable_cuckoo_find_bucket(ht, stress_hashtable_cuckoo_b2(ht, key), key);
+	if (slot >= 0) {
+		*value = ht->values[slot];
+		return true;
+	}
+	for (i = 0; i < ht->stash_n; i++) {
+		if (ht->stash_keys[i] == key) {
+			*value = ht->stash_values[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool stress_hashtable_cuckoo_remove(stress_hashtable_t *ht, const uint64_t key)
+{
+	ssize_t slot;
+	size_t i;
+
+	slot = stress_hashtable_cuckoo_find_bucket(ht, stress_hashtable_cuckoo_b1(ht, key), key);
+	if (slot < 0)
+		slot = stress_hashtable_cuckoo_find_bucket(ht, stress_hashtable_cuckoo_b2(ht, key), key);
+	if (slot >= 0) {
+		ht->keys[slot] = 0;
+		return true;
+	}
+	for (i = 0; i < ht->stash_n; i++) {
+		if (ht->stash_keys[i] == key) {
+			ht->stash_n--;
+			ht->stash_keys[i] = ht->stash_keys[ht->stash_n];
+			ht->stash_values[i] = ht->stash_values[ht->stash_n];
+			return true;
+		}
+	}
+	return false;
+}
+
+static const stress_hashtable_method_t hashtable_methods[] = {
+	{ "chain",	stress_hashtable_chain_init,	stress_hashtable_chain_insert,
+	  stress_hashtable_chain_lookup,	stress_hashtable_chain_remove,
+	  stress_hashtable_chain_mem_size },
+	{ "linear",	stress_hashtable_open_init,	stress_hashtable_linear_insert,
+	  stress_hashtable_open_lookup,		stress_hashtable_open_remove,
+	  stress_hashtable_open_mem_size },
+	{ "robin",	stress_hashtable_open_init,	stress_hashtable_robin_insert,
+	  stress_hashtable_robin_lookup,	stress_hashtable_open_remove,
+	  stress_hashtable_open_mem_size },
+	{ "swiss",	stress_hashtable_swiss_init,	stress_hashtable_swiss_insert,
+	  stress_hashtable_swiss_lookup,	stress_hashtable_swiss_remove,
+	  stress_hashtable_swiss_mem_size },
+	{ "cuckoo",	stress_hashtable_cuckoo_init,	stress_hashtable_cuckoo_insert,
+	  stress_hashtable_cuckoo_lookup,	stress_hashtable_cuckoo_remove,
+	  stress_hashtable_open_mem_size },
+};
+
+static int stress_set_hashtable_method(const char *opt)
+{
+	size_t i;
+
+	/* 0 is all, methods are index + 1 */
+	if (!strcmp(opt, "all")) {
+		i = 0;
+		return stress_set_setting("hashtable-method", TYPE_ID_SIZE_T, &i);
+	}
+	for (i = 0; i < SIZEOF_ARRAY(hashtable_methods); i++) {
+		if (!strcmp(opt, hashtable_methods[i].name)) {
+			const size_t idx = i + 1;
+
+			return stress_set_setting("hashtable-method", TYPE_ID_SIZE_T, &idx);
+		}
+	}
+
+	(void)fprintf(stderr, "hashtable-method must be one of: all");
+	for (i = 0; i < SIZEOF_ARRAY(hashtable_methods); i++)
+		(void)fprintf(stderr, " %s", hashtable_methods[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_hashtable_size(const char *opt)
+{
+	uint64_t hashtable_size;
+
+	hashtable_size = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("hashtable-size", hashtable_size,
+		MIN_HASHTABLE_SIZE, MAX_HASHTABLE_SIZE);
+	return stress_set_setting("hashtable-size", TYPE_ID_UINT64, &hashtable_size);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_hashtable_method,	stress_set_hashtable_method },
+	{ OPT_hashtable_size,	stress_set_hashtable_size },
+	{ 0,			NULL }
+};
+
+/*
+ *  stress_hashtable_cycle()
+ *	fill a table of slots to load percent and time the inserts,
+ *	hit and miss lookups and deleting all the items, returns
+ *	false on a verification failure
+ */
+static bool stress_hashtable_cycle(
+	const stress_args_t *args,
+	const stress_hashtable_method_t *method,
+	stress_hashtable_t *ht,
+	void *mem,
+	const uint64_t *hit_keys,
+	const uint64_t *miss_keys,
+	const size_t slots,
+	const uint32_t load,
+	stress_hashtable_stats_t *stats)
+{
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t i, n = (slots * load) / 100;
+	size_t errors = 0;
+	uint64_t value, sum = 0;
+	double t;
+
+	method->init(ht, mem, slots);
+
+	/* keys are unique so inserts do not check for existing keys */
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		if (!method->insert(ht, hit_keys[i], (uint64_t)i))
+			break;
+	}
+	stats[HASHTABLE_PHASE_INSERT].duration += stress_time_now() - t;
+	stats[HASHTABLE_PHASE_INSERT].ops += (double)i;
+	if (i < n) {
+		pr_dbg("%s: %s table of %zu slots full after %zu of %zu inserts\n",
+			args->name, method->name, slots, i, n);
+		n = i;
+	}
+
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		value = ~(uint64_t)0;
+		if (method->lookup(ht, hit_keys[i], &value))
+			sum += value;
+		if (verify && (value != (uint64_t)i))
+			errors++;
+	}
+	stats[HASHTABLE_PHASE_HIT].duration += stress_time_now() - t;
+	stats[HASHTABLE_PHASE_HIT].ops += (double)n;
+
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		if (method->lookup(ht, miss_keys[i], &value)) {
+			sum += value;
+			errors++;
+		}
+	}
+	stats[HASHTABLE_PHASE_MISS].duration += stress_time_now() - t;
+	stats[HASHTABLE_PHASE_MISS].ops += (double)n;
+
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		if (!method->remove(ht, hit_keys[i]))
+			errors++;
+	}
+	stats[HASHTABLE_PHASE_DELETE].duration += stress_time_now() - t;
+	stats[HASHTABLE_PHASE_DELETE].ops += (double)n;
+
+	if (verify) {
+		for (i = 0; i < n; i++) {
+			if (method->lookup(ht, hit_keys[i], &value))
+				errors++;
+		}
+	}
+	stress_uint64_put(sum);
+
+	if (errors) {
+		pr_fail("%s: %s table of %zu slots at %" PRIu32
+			"%% load had %zu lookup or delete errors\n",
+			args->name, method->name, slots, load, errors);
+		return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_hashtable()
+ *	benchmark hash table implementations over a range of
+ *	table sizes and load factors
+ */
+static int stress_hashtable(const stress_args_t *args)
+{
+	static stress_hashtable_stats_t stats[SIZEOF_ARRAY(hashtable_methods)]
+		[HASHTABLE_MAX_SIZES][SIZEOF_ARRAY(hashtable_loads)][HASHTABLE_PHASES];
+	static stress_hashtable_t ht;
+	uint64_t hashtable_size = DEFAULT_HASHTABLE_SIZE;
+	size_t hashtable_method = 0;
+	size_t sizes[HASHTABLE_MAX_SIZES];
+	size_t i, s, l, p, n_sizes = 0, max_slots, mem_size = 0, keys_size, idx = 0;
+	uint64_t *keys;
+	void *mem;
+	uint64_t salt;
+	int ret = EXIT_SUCCESS;
+
+	(void)stress_get_setting("hashtable-method", &hashtable_method);
+	if (!stress_get_setting("hashtable-size", &hashtable_size)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			hashtable_size = MAX_HASHTABLE_SIZE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			hashtable_size = MIN_HASHTABLE_SIZE;
+	}
+
+	/* power of 2 slot counts from 16K of slots, 16 times larger each step */
+	max_slots = (size_t)1 << stress_msb64(hashtable_size / HASHTABLE_SLOT_SIZE);
+	for (s = MIN_HASHTABLE_SIZE / HASHTABLE_SLOT_SIZE; s < max_slots; s <<= 4)
+		sizes[n_sizes++] = s;
+	sizes[n_sizes++] = max_slots;
+
+	for (i = 0; i < SIZEOF_ARRAY(hashtable_methods); i++) {
+		const size_t sz = hashtable_methods[i].mem_size(max_slots);
+
+		if (mem_size < sz)
+			mem_size = sz;
+	}
+	/* hit keys followed by miss keys */
+	keys_size = 2 * max_slots * sizeof(*keys);
+	keys = (uint64_t *)mmap(NULL, keys_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (keys == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for keys, skipping stressor\n",
+			args->name, keys_size);
+		return EXIT_NO_RESOURCE;
+	}
+	mem = mmap(NULL, mem_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for the hash table, skipping stressor\n",
+			args->name, mem_size);
+		(void)munmap((void *)keys, keys_size);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		/* unique non-zero keys, different each time around */
+		salt = (uint64_t)stress_mwc32() << 24;
+		for (i = 0; i < 2 * max_slots; i++)
+			keys[i] = stress_hashtable_mix(salt + i + 1);
+
+		for (s = 0; keep_stressing(args) && (s < n_sizes); s++) {
+			for (l = 0; keep_stressing(args) && (l < SIZEOF_ARRAY(hashtable_loads)); l++) {
+				for (i = 0; keep_stressing(args) && (i < SIZEOF_ARRAY(hashtable_methods)); i++) {
+					if (hashtable_method && (hashtable_method != i + 1))
+						continue;
+					if (!stress_hashtable_cycle(args, &hashtable_methods[i], &ht,
+							mem, keys, keys + max_slots, sizes[s],
+							hashtable_loads[l], stats[i][s][l]))
+						ret = EXIT_FAILURE;
+					inc_counter(args);
+				}
+			}
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: method  table size load  insert ns     hit ns    miss ns  delete ns\n",
+			args->name);
+
+	for (i = 0; i < SIZEOF_ARRAY(hashtable_methods); i++) {
+		double lookup_ops = 0.0, lookup_dur = 0.0, update_ops = 0.0, update_dur = 0.0;
+		char desc[40];
+
+		for (s = 0; s < n_sizes; s++) {
+			for (l = 0; l < SIZEOF_ARRAY(hashtable_loads); l++) {
+				const stress_hashtable_stats_t *st = stats[i][s][l];
+				char size[32], buf[64] = "";
+
+				if (st[HASHTABLE_PHASE_INSERT].ops <= 0.0)
+					continue;
+				for (p = 0; p < HASHTABLE_PHASES; p++) {
+					char tmp[16];
+					const double ns = (st[p].ops > 0.0) ?
+						(1000000000.0 * st[p].duration) / st[p].ops : 0.0;
+
+					(void)snprintf(tmp, sizeof(tmp), " %10.2f", ns);
+					(void)shim_strlcat(buf, tmp, sizeof(buf));
+				}
+				lookup_ops += st[HASHTABLE_PHASE_HIT].ops + st[HASHTABLE_PHASE_MISS].ops;
+				lookup_dur += st[HASHTABLE_PHASE_HIT].duration + st[HASHTABLE_PHASE_MISS].duration;
+				update_ops += st[HASHTABLE_PHASE_INSERT].ops + st[HASHTABLE_PHASE_DELETE].ops;
+				update_dur += st[HASHTABLE_PHASE_INSERT].duration + st[HASHTABLE_PHASE_DELETE].duration;
+				if (args->instance == 0)
+					pr_inf("%s: %-7s %10s %3" PRIu32 "%%%s\n", args->name,
+						hashtable_methods[i].name,
+						stress_uint64_to_str(size, sizeof(size),
+							(uint64_t)sizes[s] * HASHTABLE_SLOT_SIZE),
+						hashtable_loads[l], buf);
+			}
+		}
+		if ((lookup_ops <= 0.0) || (idx + 2 > STRESS_MISC_STATS_MAX))
+			continue;
+		(void)snprintf(desc, sizeof(desc), "%s lookup ns/op", hashtable_methods[i].name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc,
+			(1000000000.0 * lookup_dur) / lookup_ops);
+		(void)snprintf(desc, sizeof(desc), "%s insert+delete ns/op", hashtable_methods[i].name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc,
+			(1000000000.0 * update_dur) / update_ops);
+	}
+	(void)munmap(mem, mem_size);
+	(void)munmap((void *)keys, keys_size);
+
+	return ret;
+}
+
+stressor_info_t stress_hashtable_info = {
+	.stressor = stress_hashtable,
+	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
@@ -27,6 +27,23 @@
 #include <utime.h>
 #endif
 
+#if defined(HAVE_LINUX_AIO_ABI_H)
+#include <linux/aio_abi.h>
+#endif
+
+#include "core-io-buf.h"
+#include "core-latency.h"
+#include "core-verify.h"
+
+#if defined(HAVE_LINUX_AIO_ABI_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_setup) &&		\
+    defined(__NR_io_destroy) &&		\
+    defined(__NR_io_submit) &&		\
+    defined(__NR_io_getevents)
+#define HAVE_HDD_AIO
+#endif
+
 #define MIN_HDD_BYTES		(1 * MB)
 #define MAX_HDD_BYTES		(MAX_FILE_LIMIT)
 #define DEFAULT_HDD_BYTES	(1 * GB)
@@ -68,6 +85,17 @@
 #define HDD_OPT_FDATASYNC	(0x00800000)
 #define HDD_OPT_SYNCFS		(0x01000000)
 
+/* --hdd-profile settings */
+#define HDD_PROFILE_BS_MAX	(8)
+#define HDD_PROFILE_QD_MAX	(1024)
+
+#define HDD_PATTERN_SEQ		(0)
+#define HDD_PATTERN_RAND	(1)
+#define HDD_PATTERN_ZIPF	(2)
+
+#define HDD_ENGINE_SYNC		(0)
+#define HDD_ENGINE_AIO		(1)
+
 typedef struct {
 	const char *opt;	/* User option */
 	const int flag;		/* HDD_OPT_ flag */
@@ -76,11 +104,48 @@ typedef struct {
 	const int oflag;	/* open O_* flags */
 } stress_hdd_opts_t;
 
+typedef struct {
+	uint64_t size;		/* block size in bytes */
+	uint32_t weight;	/* relative frequency of this block size */
+} stress_hdd_bs_t;
+
+typedef struct {
+	stress_hdd_bs_t bs[HDD_PROFILE_BS_MAX];	/* block size distribution */
+	size_t bs_count;	/* number of block sizes */
+	uint64_t bs_min;	/* smallest block size, offset granularity */
+	uint64_t bs_max;	/* largest block size */
+	uint32_t bs_weight_total; /* sum of the block size weights */
+	uint32_t read_pct;	/* percentage of reads, rest are writes */
+	uint32_t qd;		/* requests in flight */
+	int pattern;		/* HDD_PATTERN_* access pattern */
+	int engine;		/* HDD_ENGINE_* I/O engine */
+	double zipf_theta;	/* zipf hot-set skew */
+	bool direct;		/* use O_DIRECT */
+} stress_hdd_profile_t;
+
+typedef struct {
+	uint64_t n;		/* number of items */
+	double theta;		/* skew */
+	double alpha;		/* 1 / (1 - theta) */
+	double zetan;		/* zeta(n, theta) */
+	double eta;
+} stress_hdd_zipf_t;
+
+typedef struct {
+	uint64_t ops;		/* completed requests */
+	uint64_t bytes;		/* bytes transferred */
+	stress_latency_t latency; /* submit to complete latency */
+} stress_hdd_op_stats_t;
+
+static const char * const hdd_patterns[] = { "seq", "rand", "zipf" };
+static const char * const hdd_engines[] = { "sync", "aio" };
+
 static const stress_help_t help[] = {
 	{ "d N","hdd N",		"start N workers spinning on write()/unlink()" },
 	{ NULL,	"hdd-ops N",		"stop after N hdd bogo operations" },
 	{ NULL,	"hdd-bytes N",		"write N bytes per hdd worker (default is 1GB)" },
 	{ NULL,	"hdd-opts list",	"specify list of various stressor options" },
+	{ NULL,	"hdd-profile spec",	"run a fio style job profile, e.g. read=70,bs=4k:3/64k:1,qd=16,pattern=zipf" },
 	{ NULL,	"hdd-write-size N",	"set the default write size to N bytes" },
 	{ NULL, NULL,			NULL }
 };
@@ -567,6 +632,629 @@ static inline uint8_t data_value(const uint64_t i, uint64_t j, const stress_args
 	return v;
 }
 
+/*
+ *  stress_hdd_profile_parse()
+ *	parse a --hdd-profile job description, a comma separated
+ *	list of key=value settings, returns -1 on error
+ */
+static int stress_hdd_profile_parse(const char *opt, stress_hdd_profile_t *profile)
+{
+	char *str, *ptr, *token;
+	bool engine_set = false;
+	size_t i;
+
+	(void)memset(profile, 0, sizeof(*profile));
+	profile->read_pct = 50;
+	profile->qd = 1;
+	profile->pattern = HDD_PATTERN_RAND;
+	profile->engine = HDD_ENGINE_SYNC;
+	profile->zipf_theta = 0.99;
+
+	str = stress_const_optdup(opt);
+	if (!str)
+		return -1;
+
+	for (ptr = str; (token = strtok(ptr, ",")) != NULL; ptr = NULL) {
+		char *value = strchr(token, '=');
+
+		if (!strcmp(token, "direct")) {
+#if defined(O_DIRECT)
+			profile->direct = true;
+			continue;
+#else
+			(void)fprintf(stderr, "hdd-profile: direct I/O is not supported\n");
+			goto err;
+#endif
+		}
+		if (!value || !value[1]) {
+			(void)fprintf(stderr, "hdd-profile: setting '%s' has no value, "
+				"settings are: read=N, bs=SIZE[:WEIGHT][/SIZE[:WEIGHT]...], "
+				"qd=N, pattern=seq|rand|zipf, zipf=THETA, engine=sync|aio, direct\n",
+				token);
+			goto err;
+		}
+		*value++ = '\0';
+
+		if (!strcmp(token, "read")) {
+			profile->read_pct = stress_get_uint32(value);
+			if (profile->read_pct > 100) {
+				(void)fprintf(stderr, "hdd-profile: read percentage must be "
+					"in the range 0 to 100\n");
+				goto err;
+			}
+		} else if (!strcmp(token, "bs")) {
+			char *bs_ptr, *bs_token, *saveptr = NULL;
+
+			profile->bs_count = 0;
+			for (bs_ptr = value; (bs_token = strtok_r(bs_ptr, "/", &saveptr)) != NULL; bs_ptr = NULL) {
+				char *weight = strchr(bs_token, ':');
+				stress_hdd_bs_t *bs;
+
+				if (profile->bs_count >= HDD_PROFILE_BS_MAX) {
+					(void)fprintf(stderr, "hdd-profile: at most %d block "
+						"sizes allowed\n", HDD_PROFILE_BS_MAX);
+					goto err;
+				}
+				bs = &profile->bs[profile->bs_count++];
+				if (weight)
+					*weight++ = '\0';
+				bs->size = stress_get_uint64_byte(bs_token);
+				bs->weight = weight ? stress_get_uint32(weight) : 1;
+				if ((bs->size < 512) || (bs->size > MAX_HDD_WRITE_SIZE) ||
+				    (bs->weight < 1) || (bs->weight > 1000)) {
+					(void)fprintf(stderr, "hdd-profile: block size must be "
+						"in the range 512 to %" PRIu64 " bytes and the "
+						"weight in the range 1 to 1000\n",
+						(uint64_t)MAX_HDD_WRITE_SIZE);
+					goto err;
+				}
+			}
+		} else if (!strcmp(token, "qd")) {
+			profile->qd = stress_get_uint32(value);
+			if ((profile->qd < 1) || (profile->qd > HDD_PROFILE_QD_MAX)) {
+				(void)fprintf(stderr, "hdd-profile: queue depth must be "
+					"in the range 1 to %d\n", HDD_PROFILE_QD_MAX);
+				goto err;
+			}
+		} else if (!strcmp(token, "pattern")) {
+			for (i = 0; i < SIZEOF_ARRAY(hdd_patterns); i++) {
+				if (!strcmp(value, hdd_patterns[i]))
+					break;
+			}
+			if (i >= SIZEOF_ARRAY(hdd_patterns)) {
+				(void)fprintf(stderr, "hdd-profile: invalid pattern '%s', "
+					"allowed patterns are: seq rand zipf\n", value);
+				goto err;
+			}
+			profile->pattern = (int)i;
+		} else if (!strcmp(token, "zipf")) {
+			profile->zipf_theta = atof(value);
+			if ((profile->zipf_theta < 0.01) || (profile->zipf_theta > 0.999)) {
+				(void)fprintf(stderr, "hdd-profile: zipf theta must be "
+					"in the range 0.01 to 0.999\n");
+				goto err;
+			}
+		} else if (!strcmp(token, "engine")) {
+			for (i = 0; i < SIZEOF_ARRAY(hdd_engines); i++) {
+				if (!strcmp(value, hdd_engines[i]))
+					break;
+			}
+			if (i >= SIZEOF_ARRAY(hdd_engines)) {
+				(void)fprintf(stderr, "hdd-profile: invalid engine '%s', "
+					"allowed engines are: sync aio\n", value);
+				goto err;
+			}
+#if !defined(HAVE_HDD_AIO)
+			if (i == HDD_ENGINE_AIO) {
+				(void)fprintf(stderr, "hdd-profile: aio engine is not "
+					"supported on this system\n");
+				goto err;
+			}
+#endif
+			profile->engine = (int)i;
+			engine_set = true;
+		} else {
+			(void)fprintf(stderr, "hdd-profile: invalid setting '%s', "
+				"settings are: read, bs, qd, pattern, zipf, engine, direct\n",
+				token);
+			goto err;
+		}
+	}
+
+	/* a queue depth more than 1 needs an asynchronous engine */
+	if (profile->qd > 1) {
+		if (!engine_set) {
+#if defined(HAVE_HDD_AIO)
+			profile->engine = HDD_ENGINE_AIO;
+#endif
+		}
+		if (profile->engine == HDD_ENGINE_SYNC) {
+			(void)fprintf(stderr, "hdd-profile: a queue depth of more than 1 "
+				"needs the aio engine\n");
+			goto err;
+		}
+	}
+	if (profile->bs_count == 0) {
+		profile->bs[0].size = DEFAULT_HDD_WRITE_SIZE;
+		profile->bs[0].weight = 1;
+		profile->bs_count = 1;
+	}
+	profile->bs_min = profile->bs[0].size;
+	for (i = 0; i < profile->bs_count; i++) {
+		if (profile->direct && (profile->bs[i].size & (BUF_ALIGNMENT - 1))) {
+			(void)fprintf(stderr, "hdd-profile: block sizes must be multiples "
+				"of %d bytes for direct I/O\n", BUF_ALIGNMENT);
+			goto err;
+		}
+		profile->bs_weight_total += profile->bs[i].weight;
+		profile->bs_min = STRESS_MINIMUM(profile->bs_min, profile->bs[i].size);
+		profile->bs_max = STRESS_MAXIMUM(profile->bs_max, profile->bs[i].size);
+	}
+	free(str);
+	return 0;
+err:
+	free(str);
+	return -1;
+}
+
+static int stress_set_hdd_profile(const char *opt)
+{
+	stress_hdd_profile_t profile;
+
+	if (stress_hdd_profile_parse(opt, &profile) < 0)
+		_exit(EXIT_FAILURE);
+	return stress_set_setting("hdd-profile", TYPE_ID_STR, opt);
+}
+
+/*
+ *  stress_hdd_zipf_init()
+ *	initialize a zipfian distribution over n items, using the
+ *	method from "Quickly Generating Billion-Record Synthetic
+ *	Databases", Gray et al, SIGMOD 1994
+ */
+static void stress_hdd_zipf_init(stress_hdd_zipf_t *zipf, const uint64_t n, const double theta)
+{
+	uint64_t i;
+	double zeta2 = 1.0 + pow(0.5, theta);
+
+	zipf->n = n;
+	zipf->theta = theta;
+	zipf->alpha = 1.0 / (1.0 - theta);
+	zipf->zetan = 0.0;
+	for (i = 1; i <= n; i++)
+		zipf->zetan += 1.0 / pow((double)i, theta);
+	zipf->eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) /
+		    (1.0 - (zeta2 / zipf->zetan));
+}
+
+/*
+ *  stress_hdd_zipf()
+ *	zipfian distributed item 0..n-1, the hot items are
+ *	scattered over the file rather than all at the start
+ */
+static uint64_t stress_hdd_zipf(const stress_hdd_zipf_t *zipf)
+{
+	const double u = (double)stress_mwc64() / 18446744073709551616.0;
+	const double uz = u * zipf->zetan;
+	uint64_t rank;
+
+	if (uz < 1.0)
+		rank = 0;
+	else if (uz < 1.0 + pow(0.5, zipf->theta))
+		rank = 1;
+	else
+		rank = (uint64_t)((double)zipf->n * pow((zipf->eta * u) - zipf->eta + 1.0, zipf->alpha));
+
+	return ((rank * 0x9e3779b97f4a7c15ULL) >> 11) % zipf->n;
+}
+
+/*
+ *  stress_hdd_profile_next()
+ *	pick the next I/O type, block size and offset
+ */
+static void stress_hdd_profile_next(
+	const stress_hdd_profile_t *profile,
+	const stress_hdd_zipf_t *zipf,
+	const uint64_t file_size,
+	uint64_t *cursor,
+	bool *rd,
+	uint64_t *size,
+	uint64_t *offset)
+{
+	const uint64_t slots = ((file_size - profile->bs_max) / profile->bs_min) + 1;
+	uint32_t w;
+	size_t i;
+
+	*rd = (stress_mwc32() % 100) < profile->read_pct;
+
+	w = stress_mwc32() % profile->bs_weight_total;
+	for (i = 0; i < profile->bs_count - 1; i++) {
+		if (w < profile->bs[i].weight)
+			break;
+		w -= profile->bs[i].weight;
+	}
+	*size = profile->bs[i].size;
+
+	switch (profile->pattern) {
+	case HDD_PATTERN_SEQ:
+		if (*cursor + *size > file_size)
+			*cursor = 0;
+		*offset = *cursor;
+		*cursor += ((*size + profile->bs_min - 1) / profile->bs_min) * profile->bs_min;
+		break;
+	case HDD_PATTERN_ZIPF:
+		*offset = stress_hdd_zipf(zipf) * profile->bs_min;
+		break;
+	default:
+		*offset = (stress_mwc64() % slots) * profile->bs_min;
+		break;
+	}
+	/* larger blocks must not run off the end of the file */
+	if (*offset + *size > file_size)
+		*offset = file_size - *size;
+}
+
+/*
+ *  stress_hdd_profile_account()
+ *	account a completed I/O
+ */
+static inline void stress_hdd_profile_account(
+	const stress_args_t *args,
+	stress_hdd_op_stats_t *stats,
+	const uint64_t bytes,
+	const uint64_t ns)
+{
+	stats->ops++;
+	stats->bytes += bytes;
+	stress_latency_record(&stats->latency, ns);
+	stress_latency_record(args->latency, ns);
+	inc_counter(args);
+}
+
+/*
+ *  stress_hdd_profile_sync()
+ *	synchronous pread/pwrite engine, one request in flight
+ */
+static int stress_hdd_profile_sync(
+	const stress_args_t *args,
+	const int fd,
+	uint8_t *buf,
+	const stress_hdd_profile_t *profile,
+	const stress_hdd_zipf_t *zipf,
+	const uint64_t file_size,
+	stress_hdd_op_stats_t *stats)
+{
+	uint64_t cursor = 0;
+
+	do {
+		bool rd;
+		uint64_t size, offset, t;
+		ssize_t ret;
+
+		stress_hdd_profile_next(profile, zipf, file_size, &cursor, &rd, &size, &offset);
+		t = stress_latency_now();
+		if (rd)
+			ret = pread(fd, buf, (size_t)size, (off_t)offset);
+		else
+			ret = pwrite(fd, buf, (size_t)size, (off_t)offset);
+		t = stress_latency_now() - t;
+		if (ret < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			if (errno == ENOSPC)
+				break;
+			pr_fail("%s: %s failed, errno=%d (%s)\n", args->name,
+				rd ? "pread" : "pwrite", errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		stress_hdd_profile_account(args, &stats[rd ? 0 : 1], (uint64_t)ret, t);
+	} while (keep_stressing(args));
+
+	return EXIT_SUCCESS;
+}
+
+#if defined(HAVE_HDD_AIO)
+/*
+ *  stress_hdd_profile_aio()
+ *	Linux kernel asynchronous I/O engine, keeps the profile
+ *	queue depth of requests in flight
+ */
+static int stress_hdd_profile_aio(
+	const stress_args_t *args,
+	const int fd,
+	uint8_t *bufs,
+	const stress_hdd_profile_t *profile,
+	const stress_hdd_zipf_t *zipf,
+	const uint64_t file_size,
+	stress_hdd_op_stats_t *stats)
+{
+	const uint32_t qd = profile->qd;
+	aio_context_t ctx = 0;
+	struct iocb *iocbs, **pending;
+	struct io_event *events;
+	uint64_t *t_submit, cursor = 0;
+	uint32_t i, npending;
+	int rc = EXIT_SUCCESS;
+
+	iocbs = calloc(qd, sizeof(*iocbs));
+	pending = calloc(qd, sizeof(*pending));
+	events = calloc(qd, sizeof(*events));
+	t_submit = calloc(qd, sizeof(*t_submit));
+	if (!iocbs || !pending || !events || !t_submit) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " aio requests, "
+			"skipping stressor\n", args->name, qd);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	if (syscall(__NR_io_setup, qd, &ctx) < 0) {
+		pr_inf_skip("%s: io_setup of %" PRIu32 " requests failed, errno=%d (%s), "
+			"skipping stressor\n", args->name, qd, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	/* all the requests are initially waiting to be submitted */
+	for (i = 0; i < qd; i++)
+		pending[i] = &iocbs[i];
+	npending = qd;
+
+	do {
+		struct timespec timeout;
+		long ret;
+
+		/* (re)fill and submit all the idle requests */
+		for (i = 0; i < npending; i++) {
+			struct iocb *cb = pending[i];
+			const uint32_t slot = (uint32_t)(cb - iocbs);
+			bool rd;
+			uint64_t size, offset;
+
+			stress_hdd_profile_next(profile, zipf, file_size, &cursor, &rd, &size, &offset);
+			(void)memset(cb, 0, sizeof(*cb));
+			cb->aio_data = (uint64_t)slot;
+			cb->aio_lio_opcode = rd ? IOCB_CMD_PREAD : IOCB_CMD_PWRITE;
+			cb->aio_fildes = (uint32_t)fd;
+			cb->aio_buf = (uint64_t)(uintptr_t)(bufs + ((size_t)slot * profile->bs_max));
+			cb->aio_nbytes = size;
+			cb->aio_offset = (int64_t)offset;
+			t_submit[slot] = stress_latency_now();
+		}
+		while (npending > 0) {
+			ret = syscall(__NR_io_submit, ctx, (long)npending, pending);
+			if (ret < 0) {
+				if ((errno == EAGAIN) || (errno == EINTR))
+					break;
+				pr_fail("%s: io_submit failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto destroy;
+			}
+			npending -= (uint32_t)ret;
+			(void)memmove(pending, pending + ret, npending * sizeof(*pending));
+		}
+
+		/* reap at least one completion, the timeout allows for a keep_stressing check */
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = 100000000;
+		ret = syscall(__NR_io_getevents, ctx, 1L, (long)qd, events, &timeout);
+		if (ret < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			pr_fail("%s: io_getevents failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		for (i = 0; i < (uint32_t)ret; i++) {
+			const uint32_t slot = (uint32_t)events[i].data;
+			const struct iocb *cb = &iocbs[slot];
+			const bool rd = (cb->aio_lio_opcode == IOCB_CMD_PREAD);
+
+			if ((events[i].res < 0) && (events[i].res != -EAGAIN) &&
+			    (events[i].res != -EINTR) && (events[i].res != -ENOSPC)) {
+				pr_fail("%s: asynchronous %s failed, errno=%d (%s)\n",
+					args->name, rd ? "read" : "write",
+					(int)-events[i].res, strerror((int)-events[i].res));
+				rc = EXIT_FAILURE;
+			} else if (events[i].res >= 0) {
+				stress_hdd_profile_account(args, &stats[rd ? 0 : 1],
+					(uint64_t)events[i].res,
+					stress_latency_now() - t_submit[slot]);
+			}
+			pending[npending++] = &iocbs[slot];
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+
+destroy:
+	/* io_destroy waits for the requests still in flight */
+	(void)syscall(__NR_io_destroy, ctx);
+tidy:
+	free(t_submit);
+	free(events);
+	free(pending);
+	free(iocbs);
+
+	return rc;
+}
+#endif
+
+/*
+ *  stress_hdd_profile_report()
+ *	report IOPS, throughput and latency percentiles per I/O type
+ */
+static void stress_hdd_profile_report(
+	const stress_args_t *args,
+	const char *opt,
+	const stress_hdd_profile_t *profile,
+	const stress_hdd_op_stats_t *stats,
+	const double duration)
+{
+	static const char * const op_names[] = { "read", "write" };
+	size_t i;
+
+	if (duration <= 0.0)
+		return;
+
+	if (args->instance == 0) {
+		pr_inf("%s: profile '%s': %" PRIu32 "%% reads, queue depth %" PRIu32
+			", %s pattern, %s engine%s\n", args->name, opt,
+			profile->read_pct, profile->qd,
+			hdd_patterns[profile->pattern], hdd_engines[profile->engine],
+			profile->direct ? ", direct I/O" : "");
+		pr_inf("%s: %-5s %10s %10s %10s %10s %10s %10s %10s\n",
+			args->name, "op", "IOPS", "MB/s", "mean-us", "p50-us",
+			"p99-us", "p99.9-us", "max-us");
+	}
+	for (i = 0; i < SIZEOF_ARRAY(op_names); i++) {
+		const stress_latency_t *lat = &stats[i].latency;
+		const double iops = (double)stats[i].ops / duration;
+		const double mb_per_sec = ((double)stats[i].bytes / duration) / (double)MB;
+		char desc[40];
+
+		if (!stats[i].ops)
+			continue;
+		if (args->instance == 0) {
+			pr_inf("%s: %-5s %10.0f %10.2f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+				args->name, op_names[i], iops, mb_per_sec,
+				stress_latency_mean(lat) / 1000.0,
+				(double)stress_latency_percentile(lat, 50.0) / 1000.0,
+				(double)stress_latency_percentile(lat, 99.0) / 1000.0,
+				(double)stress_latency_percentile(lat, 99.9) / 1000.0,
+				(double)lat->max / 1000.0);
+		}
+		(void)snprintf(desc, sizeof(desc), "%s IOPS", op_names[i]);
+		stress_misc_stats_set(args->misc_stats, (i * 4) + 0, desc, iops);
+		(void)snprintf(desc, sizeof(desc), "%s MB per sec", op_names[i]);
+		stress_misc_stats_set(args->misc_stats, (i * 4) + 1, desc, mb_per_sec);
+		(void)snprintf(desc, sizeof(desc), "%s p50 latency usec", op_names[i]);
+		stress_misc_stats_set(args->misc_stats, (i * 4) + 2, desc,
+			(double)stress_latency_percentile(lat, 50.0) / 1000.0);
+		(void)snprintf(desc, sizeof(desc), "%s p99 latency usec", op_names[i]);
+		stress_misc_stats_set(args->misc_stats, (i * 4) + 3, desc,
+			(double)stress_latency_percentile(lat, 99.0) / 1000.0);
+	}
+}
+
+/*
+ *  stress_hdd_profile()
+ *	run a fio style job profile on a preallocated file
+ */
+static int stress_hdd_profile(const stress_args_t *args, const char *opt, uint64_t hdd_bytes)
+{
+	stress_hdd_profile_t profile;
+	stress_hdd_op_stats_t *stats = NULL;
+	stress_hdd_zipf_t zipf;
+	char filename[PATH_MAX];
+	stress_io_buf_pool_t pool;
+	uint8_t *bufs;
+	size_t bufs_size;
+	uint64_t i, file_size;
+	double t_start, duration;
+	int fd, ret, rc = EXIT_FAILURE, flags = O_CREAT | O_RDWR | O_TRUNC;
+
+	if (stress_hdd_profile_parse(opt, &profile) < 0)
+		return EXIT_FAILURE;
+#if defined(O_DIRECT)
+	if (profile.direct)
+		flags |= O_DIRECT;
+#endif
+	file_size = STRESS_MAXIMUM(hdd_bytes, profile.bs_max);
+	file_size = (file_size / profile.bs_min) * profile.bs_min;
+	if (profile.pattern == HDD_PATTERN_ZIPF)
+		stress_hdd_zipf_init(&zipf, ((file_size - profile.bs_max) / profile.bs_min) + 1,
+			profile.zipf_theta);
+	else
+		(void)memset(&zipf, 0, sizeof(zipf));
+
+	(void)memset(&pool, 0, sizeof(pool));
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0)
+		return stress_exit_status((int)-ret);
+
+	/* one buffer per request in flight, bs_max apart */
+	bufs_size = (size_t)profile.qd * (size_t)profile.bs_max;
+	(void)stress_temp_dir_args(args, filename, sizeof(filename));
+	ret = stress_io_buf_pool_alloc(args, &pool, filename, bufs_size, 1, 0);
+	stats = calloc(2, sizeof(*stats));
+	if ((ret < 0) || !stats) {
+		pr_inf_skip("%s: cannot allocate %zu byte I/O buffers, skipping stressor\n",
+			args->name, bufs_size);
+		rc = EXIT_NO_RESOURCE;
+		goto free_bufs;
+	}
+	bufs = stress_io_buf_get(&pool, 0);
+	stress_mwc_fill(bufs, bufs_size);
+
+	if (profile.direct) {
+		for (i = 0; i < profile.bs_count; i++) {
+			if (profile.bs[i].size & (uint64_t)(pool.align - 1)) {
+				pr_inf_skip("%s: block size %" PRIu64 " is not a multiple of the "
+					"%zu byte direct I/O alignment of the file system, "
+					"skipping stressor\n", args->name,
+					profile.bs[i].size, pool.align);
+				rc = EXIT_NO_RESOURCE;
+				goto free_bufs;
+			}
+		}
+	}
+
+	(void)stress_temp_filename_args(args,
+		filename, sizeof(filename), stress_mwc32());
+	if ((fd = open(filename, flags, S_IRUSR | S_IWUSR)) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		(void)shim_unlink(filename);
+		goto free_bufs;
+	}
+	(void)shim_unlink(filename);
+
+	/* fill the file so reads do not just hit holes */
+	for (i = 0; keep_stressing_flag() && (i < file_size); ) {
+		const size_t sz = (size_t)STRESS_MINIMUM(file_size - i, (uint64_t)bufs_size);
+		const ssize_t n = pwrite(fd, bufs, sz, (off_t)i);
+
+		if (n <= 0) {
+			if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+				continue;
+			if ((n < 0) && (errno == EINVAL) && profile.direct) {
+				pr_inf_skip("%s: direct I/O not supported on this file system, "
+					"skipping stressor\n", args->name);
+				rc = EXIT_NO_RESOURCE;
+				goto close_fd;
+			}
+			pr_inf_skip("%s: cannot fill %" PRIu64 " byte file, errno=%d (%s), "
+				"skipping stressor\n", args->name, file_size, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_fd;
+		}
+		i += (uint64_t)n;
+	}
+	(void)shim_fsync(fd);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t_start = stress_time_now();
+#if defined(HAVE_HDD_AIO)
+	if (profile.engine == HDD_ENGINE_AIO)
+		rc = stress_hdd_profile_aio(args, fd, bufs, &profile, &zipf, file_size, stats);
+	else
+#endif
+		rc = stress_hdd_profile_sync(args, fd, bufs, &profile, &zipf, file_size, stats);
+	duration = stress_time_now() - t_start;
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (rc == EXIT_SUCCESS)
+		stress_hdd_profile_report(args, opt, &profile, stats, duration);
+close_fd:
+	(void)close(fd);
+free_bufs:
+	free(stats);
+	stress_io_buf_pool_free(&pool);
+	(void)stress_temp_dir_rm_args(args);
+
+	return rc;
+}
+
 /*
  *  stress_hdd
  *	stress I/O via writes
@@ -574,7 +1262,7 @@ static inline uint8_t data_value(const uint64_t i, uint64_t j, const stress_args
 static int stress_hdd(const stress_args_t *args)
 {
 	uint8_t *buf = NULL;
-	void *alloc_buf;
+	stress_io_buf_pool_t pool;
 	uint64_t i, min_size, size_remainder;
 	int rc = EXIT_FAILURE;
 	ssize_t ret;
@@ -585,6 +1273,7 @@ static int stress_hdd(const stress_args_t *args)
 	int hdd_flags = 0, hdd_oflags = 0;
 	int flags, fadvise_flags;
 	bool opts_set = false;
+	char *hdd_profile = NULL;
 
 	(void)stress_get_setting("hdd-flags", &hdd_flags);
 	(void)stress_get_setting("hdd-oflags", &hdd_oflags);
@@ -604,6 +1293,9 @@ static int stress_hdd(const stress_args_t *args)
 	if (hdd_bytes < MIN_HDD_WRITE_SIZE)
 		hdd_bytes = MIN_HDD_WRITE_SIZE;
 
+	if (stress_get_setting("hdd-profile", &hdd_profile))
+		return stress_hdd_profile(args, hdd_profile, hdd_bytes);
+
 	if (!stress_get_setting("hdd-write-size", &hdd_write_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			hdd_write_size = MAX_HDD_WRITE_SIZE;
@@ -654,25 +1346,29 @@ static int stress_hdd(const stress_args_t *args)
 	if ((hdd_flags & HDD_OPT_RD_MASK) == 0)
 		hdd_flags |= HDD_OPT_RD_SEQ;
 
-#if defined(HAVE_POSIX_MEMALIGN)
-	ret = posix_memalign((void **)&alloc_buf, BUF_ALIGNMENT, (size_t)hdd_write_size);
-	if (ret || !alloc_buf) {
-		rc = stress_exit_status(errno);
-		pr_err("%s: cannot allocate buffer\n", args->name);
-		(void)stress_temp_dir_rm_args(args);
-		return rc;
+	(void)stress_temp_dir_args(args, filename, sizeof(filename));
+	if (hdd_flags & HDD_OPT_O_DIRECT) {
+		const uint64_t align = (uint64_t)stress_io_buf_align(args, filename);
+		const uint64_t unit = (hdd_flags & HDD_OPT_IOVEC) ?
+			HDD_IO_VEC_MAX * align : align;
+
+		/* direct I/O sizes must be multiples of the block alignment */
+		if (hdd_write_size % unit) {
+			hdd_write_size += unit - (hdd_write_size % unit);
+			pr_inf("%s: increasing read/write size to %" PRIu64
+				" bytes for direct I/O alignment\n",
+				args->name, hdd_write_size);
+			if (hdd_bytes < hdd_write_size)
+				hdd_bytes = hdd_write_size;
+		}
 	}
-	buf = alloc_buf;
-#else
-	/* Work around lack of posix_memalign */
-	alloc_buf = malloc((size_t)hdd_write_size + BUF_ALIGNMENT);
-	if (!alloc_buf) {
+	if (stress_io_buf_pool_alloc(args, &pool, filename, (size_t)hdd_write_size, 1, 0) < 0) {
+		rc = stress_exit_status(errno);
 		pr_err("%s: cannot allocate buffer\n", args->name);
 		(void)stress_temp_dir_rm_args(args);
 		return rc;
 	}
-	buf = (uint8_t *)stress_align_address(alloc_buf, BUF_ALIGNMENT);
-#endif
+	buf = stress_io_buf_get(&pool, 0);
 	(void)memset(buf, stress_mwc8(), hdd_write_size);
 	(void)stress_temp_filename_args(args,
 		filename, sizeof(filename), stress_mwc32());
@@ -882,7 +1578,7 @@ seq_rd_retry:
 					misreads++;
 				}
 
-				if (g_opt_flags & OPT_FLAGS_VERIFY) {
+				if (stress_verify_sample()) {
 					if (hdd_flags & HDD_OPT_WR_SEQ) {
 						size_t j;
 
@@ -953,7 +1649,7 @@ rnd_rd_retry:
 				if (ret != (ssize_t)hdd_write_size)
 					misreads++;
 
-				if (g_opt_flags & OPT_FLAGS_VERIFY) {
+				if (stress_verify_sample()) {
 					size_t j;
 
 					for (j = 0; j < (size_t)ret; j++) {
@@ -988,7 +1684,7 @@ yielded:
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	free(alloc_buf);
+	stress_io_buf_pool_free(&pool);
 	(void)stress_temp_dir_rm_args(args);
 	return rc;
 }
@@ -996,6 +1692,7 @@ finish:
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_hdd_bytes,	stress_set_hdd_bytes },
 	{ OPT_hdd_opts,		stress_set_hdd_opts },
+	{ OPT_hdd_profile,	stress_set_hdd_profile },
 	{ OPT_hdd_write_size,	stress_set_hdd_write_size },
 	{ 0,			NULL },
 };
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-method-stats.h"
 
 #if defined(HAVE_SEARCH_H)
 #include <search.h>
@@ -28,12 +29,40 @@
 #define DEFAULT_HSEARCH_SIZE	(8 * KB)
 
 static const stress_help_t help[] = {
-	{ NULL,	"hsearch N",	  "start N workers that exercise a hash table search" },
-	{ NULL,	"hsearch-ops N",  "stop after N hash search bogo operations" },
-	{ NULL,	"hsearch-size N", "number of integers to insert into hash table" },
-	{ NULL,	NULL,		  NULL }
+	{ NULL,	"hsearch N",	    "start N workers that exercise a hash table search" },
+	{ NULL,	"hsearch-method M", "select hsearch method [ all | hsearch | inline ]" },
+	{ NULL,	"hsearch-ops N",    "stop after N hash search bogo operations" },
+	{ NULL,	"hsearch-size N",   "number of integers to insert into hash table" },
+	{ NULL,	NULL,		    NULL }
+};
+
+static const char * const hsearch_methods[] = {
+	"all",
+	"hsearch",
+	"inline",
 };
 
+/*
+ *  stress_set_hsearch_method()
+ *	set the hsearch method, stored as an index into hsearch_methods
+ */
+static int stress_set_hsearch_method(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(hsearch_methods); i++) {
+		if (!strcmp(hsearch_methods[i], name))
+			return stress_set_setting("hsearch-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "hsearch-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(hsearch_methods); i++)
+		(void)fprintf(stderr, " %s", hsearch_methods[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 /*
  *  stress_set_hsearch_size()
  *      set hsearch size from given option string
@@ -49,12 +78,136 @@ static int stress_set_hsearch_size(const char *opt)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_hsearch_method,	stress_set_hsearch_method },
 	{ OPT_hsearch_size,	stress_set_hsearch_size },
 	{ 0,			NULL }
 };
 
 #if defined(HAVE_HSEARCH)
 
+/* open addressed hash table entry for the inline method */
+typedef struct {
+	const char *key;	/* key string, NULL = empty slot */
+	size_t data;		/* key data */
+	uint32_t hash;		/* full key hash */
+} stress_hsearch_entry_t;
+
+/*
+ *  stress_hsearch_hash()
+ *	FNV-1a hash of a key string
+ */
+static inline uint32_t stress_hsearch_hash(const char *str)
+{
+	register uint32_t hash = 2166136261U;
+
+	while (*str) {
+		hash ^= (uint8_t)*str++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/*
+ *  stress_hsearch_inline_find()
+ *	linear probe for a key, the full hash is compared before
+ *	the key string so mismatches rarely touch the key memory
+ */
+static inline const stress_hsearch_entry_t *stress_hsearch_inline_find(
+	const stress_hsearch_entry_t *table,
+	const size_t mask,
+	const char *key)
+{
+	const uint32_t hash = stress_hsearch_hash(key);
+	size_t i = (size_t)hash & mask;
+
+	while (table[i].key) {
+		if ((table[i].hash == hash) && !strcmp(table[i].key, key))
+			return &table[i];
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_hsearch_inline_insert()
+ *	add a key, the table is sized so it can't fill up
+ */
+static void stress_hsearch_inline_insert(
+	stress_hsearch_entry_t *table,
+	const size_t mask,
+	const char *key,
+	const size_t data)
+{
+	const uint32_t hash = stress_hsearch_hash(key);
+	size_t i = (size_t)hash & mask;
+
+	while (table[i].key)
+		i = (i + 1) & mask;
+	table[i].key = key;
+	table[i].data = data;
+	table[i].hash = hash;
+}
+
+/*
+ *  stress_hsearch_libc()
+ *	find all the keys using libc hsearch
+ */
+static size_t stress_hsearch_libc(
+	const stress_args_t *args,
+	char **keys,
+	const size_t max)
+{
+	size_t i;
+
+	for (i = 0; keep_stressing_flag() && i < max; i++) {
+		ENTRY e, *ep;
+
+		e.key = keys[i];
+		e.data = NULL;	/* Keep Coverity quiet */
+		ep = hsearch(e, FIND);
+		if (g_opt_flags & OPT_FLAGS_VERIFY) {
+			if (ep == NULL) {
+				pr_fail("%s: cannot find key %s\n", args->name, keys[i]);
+			} else {
+				if (i != (size_t)ep->data) {
+					pr_fail("%s: hash returned incorrect data %zd\n", args->name, i);
+				}
+			}
+		}
+	}
+	return i;
+}
+
+/*
+ *  stress_hsearch_inline()
+ *	find all the keys using the inlined open addressed table
+ */
+static size_t OPTIMIZE3 stress_hsearch_inline(
+	const stress_args_t *args,
+	char **keys,
+	const size_t max,
+	const stress_hsearch_entry_t *table,
+	const size_t mask)
+{
+	size_t i;
+
+	for (i = 0; keep_stressing_flag() && i < max; i++) {
+		const stress_hsearch_entry_t *ep;
+
+		ep = stress_hsearch_inline_find(table, mask, keys[i]);
+		if (g_opt_flags & OPT_FLAGS_VERIFY) {
+			if (ep == NULL) {
+				pr_fail("%s: cannot find key %s\n", args->name, keys[i]);
+			} else {
+				if (i != ep->data) {
+					pr_fail("%s: hash returned incorrect data %zd\n", args->name, i);
+				}
+			}
+		}
+	}
+	return i;
+}
+
 /*
  *  stress_hsearch()
  *	stress hsearch
@@ -62,10 +215,12 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 static int stress_hsearch(const stress_args_t *args)
 {
 	uint64_t hsearch_size = DEFAULT_HSEARCH_SIZE;
-	size_t i, max;
+	size_t i, max, method = 1, first, last, table_size, mask;
 	int ret = EXIT_FAILURE;
 	char **keys;
+	stress_hsearch_entry_t *table = NULL;
 
+	(void)stress_get_setting("hsearch-method", &method);
 	if (!stress_get_setting("hsearch-size", &hsearch_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			hsearch_size = MAX_HSEARCH_SIZE;
@@ -75,6 +230,21 @@ static int stress_hsearch(const stress_args_t *args)
 
 	max = (size_t)hsearch_size;
 
+	if (method == 0) {
+		first = 1;
+		last = SIZEOF_ARRAY(hsearch_methods) - 1;
+	} else {
+		first = method;
+		last = method;
+	}
+	for (i = first; i <= last; i++) {
+		char name[24], str[12];
+
+		stress_uint64_to_str(str, sizeof(str), (uint64_t)max);
+		(void)snprintf(name, sizeof(name), "%s %s", hsearch_methods[i], str);
+		stress_method_stats_init(args, i - 1, name, 0.0);
+	}
+
 	/* Make hash table with 25% slack */
 	if (!hcreate(max + (max / 4))) {
 		pr_fail("%s: hcreate of size %zd failed\n", args->name, max + (max / 4));
@@ -87,6 +257,18 @@ static int stress_hsearch(const stress_args_t *args)
 		goto free_hash;
 	}
 
+	/* Power of 2 sized table for the inline method, at least 25% slack */
+	for (table_size = 1; table_size < max + (max / 4); table_size <<= 1)
+		;
+	mask = table_size - 1;
+	if (last == 2) {
+		table = calloc(table_size, sizeof(*table));
+		if (!table) {
+			pr_err("%s: cannot allocate inline hash table\n", args->name);
+			goto free_all;
+		}
+	}
+
 	/* Populate hash, make it 100% full for worst performance */
 	for (i = 0; i < max; i++) {
 		char buffer[32];
@@ -106,26 +288,21 @@ static int stress_hsearch(const stress_args_t *args)
 			pr_err("%s: cannot allocate new hash item\n", args->name);
 			goto free_all;
 		}
+		if (table)
+			stress_hsearch_inline_insert(table, mask, keys[i], i);
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		for (i = 0; keep_stressing_flag() && i < max; i++) {
-			ENTRY e, *ep;
-
-			e.key = keys[i];
-			e.data = NULL;	/* Keep Coverity quiet */
-			ep = hsearch(e, FIND);
-			if (g_opt_flags & OPT_FLAGS_VERIFY) {
-				if (ep == NULL) {
-					pr_fail("%s: cannot find key %s\n", args->name, keys[i]);
-				} else {
-					if (i != (size_t)ep->data) {
-						pr_fail("%s: hash returned incorrect data %zd\n", args->name, i);
-					}
-				}
-			}
+		for (i = first; keep_stressing_flag() && (i <= last); i++) {
+			const double t = stress_time_now();
+			const size_t lookups = (i == 1) ?
+				stress_hsearch_libc(args, keys, max) :
+				stress_hsearch_inline(args, keys, max, table, mask);
+
+			stress_method_stats_add_count(args, i - 1, (uint64_t)lookups,
+				stress_time_now() - t);
 		}
 		inc_counter(args);
 	} while (keep_stressing(args));
@@ -151,6 +328,7 @@ free_all:
 		free(keys[i]);
 #endif
 	free(keys);
+	free(table);
 free_hash:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	hdestroy();
@@ -20,13 +20,339 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-cache.h"
+#include "core-perf.h"
+
+#define ICACHE_SWEEP_SIZES	(8)		/* 4K to 64M code footprint, powers of 4 */
+#define ICACHE_SWEEP_MIN	(4 * KB)
+#define ICACHE_SWEEP_MAX	(64 * MB)
+#define ICACHE_SWEEP_BLOCK	(64)		/* bytes per fetch block */
+#define ICACHE_SWEEP_BLOCKS	(1U << 22)	/* fetch blocks executed per measurement */
+#define ICACHE_SWEEP_LAYOUTS	(2)		/* straight-line, jump-chained */
 
 static const stress_help_t help[] = {
 	{ NULL,	"icache N",	"start N CPU instruction cache thrashing workers" },
 	{ NULL,	"icache-ops N",	"stop after N icache bogo operations" },
+	{ NULL,	"icache-sweep",	"report cycles per fetch block over 4K to 64M generated code footprints" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_icache_sweep(const char *opt)
+{
+	return stress_set_setting_true("icache-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_icache_sweep,	stress_set_icache_sweep },
+	{ 0,			NULL }
+};
+
+#if (defined(__x86_64__) ||		\
+     defined(__aarch64__)) &&		\
+     defined(__GNUC__) &&		\
+     defined(HAVE_MPROTECT)
+
+#define HAVE_ICACHE_SWEEP
+
+typedef void (*stress_icache_sweep_func_t)(void);
+
+static const char * const icache_sweep_layouts[ICACHE_SWEEP_LAYOUTS] = {
+	"straight", "chained"
+};
+
+/* ns and cycles of each layout and footprint */
+typedef struct {
+	double ns[ICACHE_SWEEP_LAYOUTS][ICACHE_SWEEP_SIZES];
+	double cycles[ICACHE_SWEEP_LAYOUTS][ICACHE_SWEEP_SIZES];
+	double blocks[ICACHE_SWEEP_LAYOUTS][ICACHE_SWEEP_SIZES];
+} stress_icache_sweep_t;
+
+#if defined(__x86_64__)
+/* 8 byte nop, nopl 0x0(%rax,%rax,1) */
+static const uint8_t icache_nop8[8] = { 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+static void stress_icache_sweep_fill(uint8_t *block)
+{
+	size_t i;
+
+	for (i = 0; i < ICACHE_SWEEP_BLOCK; i += sizeof(icache_nop8))
+		(void)memcpy(block + i, icache_nop8, sizeof(icache_nop8));
+}
+
+static void stress_icache_sweep_jmp(uint8_t *block, const uint8_t *target)
+{
+	const int32_t rel = (int32_t)(target - (block + 5));
+
+	(void)memset(block, 0xcc, ICACHE_SWEEP_BLOCK);	/* int3 */
+	block[0] = 0xe9;				/* jmp rel32 */
+	(void)memcpy(block + 1, &rel, sizeof(rel));
+}
+
+static void stress_icache_sweep_ret(uint8_t *block)
+{
+	/* replace the last nop, ret on an instruction boundary */
+	(void)memset(block + ICACHE_SWEEP_BLOCK - sizeof(icache_nop8), 0xcc, sizeof(icache_nop8));
+	block[ICACHE_SWEEP_BLOCK - sizeof(icache_nop8)] = 0xc3;	/* ret */
+}
+#else
+static void stress_icache_sweep_put(uint8_t *block, const size_t offset, const uint32_t insn)
+{
+	(void)memcpy(block + offset, &insn, sizeof(insn));
+}
+
+static void stress_icache_sweep_fill(uint8_t *block)
+{
+	size_t i;
+
+	for (i = 0; i < ICACHE_SWEEP_BLOCK; i += 4)
+		stress_icache_sweep_put(block, i, 0xd503201f);	/* nop */
+}
+
+static void stress_icache_sweep_jmp(uint8_t *block, const uint8_t *target)
+{
+	const int64_t rel = (int64_t)(target - block) >> 2;
+
+	stress_icache_sweep_fill(block);
+	stress_icache_sweep_put(block, 0, 0x14000000 | ((uint32_t)rel & 0x03ffffff));	/* b */
+}
+
+static void stress_icache_sweep_ret(uint8_t *block)
+{
+	stress_icache_sweep_put(block, ICACHE_SWEEP_BLOCK - 4, 0xd65f03c0);	/* ret */
+}
+#endif
+
+/*
+ *  stress_icache_sweep_gen()
+ *	generate size bytes of code, straight-line falls through nops
+ *	from the first to the last fetch block, jump-chained branches
+ *	from each fetch block to the next one of a random permutation
+ *	of the blocks to defeat the sequential instruction prefetcher
+ */
+static void stress_icache_sweep_gen(
+	uint8_t *code,
+	const size_t size,
+	const size_t layout,
+	uint32_t *perm)
+{
+	const size_t blocks = size / ICACHE_SWEEP_BLOCK;
+	size_t i;
+
+	if (layout == 0) {
+		for (i = 0; i < blocks; i++)
+			stress_icache_sweep_fill(code + (i * ICACHE_SWEEP_BLOCK));
+		stress_icache_sweep_ret(code + size - ICACHE_SWEEP_BLOCK);
+		return;
+	}
+
+	/* perm[0] is always block 0, the entry point */
+	for (i = 0; i < blocks; i++)
+		perm[i] = (uint32_t)i;
+	for (i = blocks - 1; i > 1; i--) {
+		const size_t j = 1 + (size_t)(stress_mwc32() % (uint32_t)i);
+		const uint32_t tmp = perm[i];
+
+		perm[i] = perm[j];
+		perm[j] = tmp;
+	}
+	for (i = 0; i < blocks - 1; i++)
+		stress_icache_sweep_jmp(code + ((size_t)perm[i] * ICACHE_SWEEP_BLOCK),
+			code + ((size_t)perm[i + 1] * ICACHE_SWEEP_BLOCK));
+	stress_icache_sweep_fill(code + ((size_t)perm[blocks - 1] * ICACHE_SWEEP_BLOCK));
+	stress_icache_sweep_ret(code + ((size_t)perm[blocks - 1] * ICACHE_SWEEP_BLOCK));
+}
+
+/*
+ *  stress_icache_cycles()
+ *	CPU cycles of the calling process, 0 if not available
+ */
+static uint64_t stress_icache_cycles(const int fd)
+{
+#if defined(STRESS_PERF_STATS)
+	uint64_t cycles;
+
+	if ((fd >= 0) && (stress_perf_cycles_read(fd, &cycles) == 0))
+		return cycles;
+#else
+	(void)fd;
+#endif
+	return 0;
+}
+
+/*
+ *  stress_icache_sweep_report()
+ *	report ns and cycles per 64 byte fetch block, cycles are counted
+ *	if a perf cycles counter is available, otherwise estimated from
+ *	the CPU frequency
+ */
+static void stress_icache_sweep_report(
+	const stress_args_t *args,
+	const stress_icache_sweep_t *sweep,
+	const bool counted,
+	const double ghz)
+{
+	const char *how = counted ? "counted" : (ghz > 0.0 ? "estimated" : "not available");
+	size_t l, i;
+	int idx = 0;
+
+	if (args->instance == 0) {
+		pr_inf("%s: per %d byte fetch block (cycles %s):\n", args->name,
+			ICACHE_SWEEP_BLOCK, how);
+		pr_inf("%s: %9s %21s %21s\n", args->name, "footprint",
+			"straight", "chained");
+		pr_inf("%s: %9s %10s %10s %10s %10s\n", args->name, "",
+			"ns", "cycles", "ns", "cycles");
+	}
+	for (i = 0; i < ICACHE_SWEEP_SIZES; i++) {
+		const size_t size = ICACHE_SWEEP_MIN << (2 * i);
+		char line[80], sz[16];
+		size_t len;
+
+		if (size >= MB)
+			(void)snprintf(sz, sizeof(sz), "%zuM", size / (size_t)MB);
+		else
+			(void)snprintf(sz, sizeof(sz), "%zuK", size / (size_t)KB);
+		len = (size_t)snprintf(line, sizeof(line), "%9s", sz);
+		for (l = 0; l < ICACHE_SWEEP_LAYOUTS; l++) {
+			const double blocks = sweep->blocks[l][i];
+			const double ns = (blocks > 0.0) ? sweep->ns[l][i] / blocks : 0.0;
+			const double cycles = (blocks > 0.0) ? sweep->cycles[l][i] / blocks : 0.0;
+
+			if (blocks <= 0.0)
+				len += (size_t)snprintf(line + len, sizeof(line) - len, " %10s %10s", "-", "-");
+			else if (ghz > 0.0)
+				len += (size_t)snprintf(line + len, sizeof(line) - len, " %10.3f %10.2f", ns, cycles);
+			else
+				len += (size_t)snprintf(line + len, sizeof(line) - len, " %10.3f %10s", ns, "-");
+
+			/* 64K (L1i sized) and 16M (beyond L2) footprints */
+			if ((blocks > 0.0) && ((size == 64 * KB) || (size == 16 * MB)) &&
+			    (idx < STRESS_MISC_STATS_MAX)) {
+				char desc[64];
+
+				(void)snprintf(desc, sizeof(desc), "%s %s %s per fetch block",
+					icache_sweep_layouts[l], sz, (ghz > 0.0) ? "cycles" : "ns");
+				stress_misc_stats_set(args->misc_stats, idx++, desc,
+					(ghz > 0.0) ? cycles : ns);
+			}
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %s\n", args->name, line);
+	}
+}
+
+/*
+ *  stress_icache_sweep()
+ *	each bogo-op generates and times straight-line and jump-chained
+ *	code of 4K to 64M bytes, each measurement executes at least
+ *	ICACHE_SWEEP_BLOCKS fetch blocks
+ */
+static int stress_icache_sweep(const stress_args_t *args)
+{
+	const size_t max_blocks = ICACHE_SWEEP_MAX / ICACHE_SWEEP_BLOCK;
+	stress_icache_sweep_t *sweep;
+	uint8_t *code;
+	uint32_t *perm;
+	double ghz;
+	int cycles_fd = -1, rc = EXIT_SUCCESS;
+
+	sweep = calloc(1, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	perm = calloc(max_blocks, sizeof(*perm));
+	if (!perm) {
+		pr_inf_skip("%s: cannot allocate block permutation, skipping stressor\n", args->name);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+	code = (uint8_t *)mmap(NULL, ICACHE_SWEEP_MAX, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte code buffer, skipping stressor\n",
+			args->name, (size_t)ICACHE_SWEEP_MAX);
+		free(perm);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+#if defined(MADV_NOHUGEPAGE)
+	/* small pages so the footprint is also an instruction TLB footprint */
+	(void)shim_madvise((void *)code, ICACHE_SWEEP_MAX, MADV_NOHUGEPAGE);
+#endif
+
+#if defined(STRESS_PERF_STATS)
+	cycles_fd = stress_perf_cycles_open();
+#endif
+	ghz = (cycles_fd >= 0) ? 1.0 : stress_get_cpu_ghz_average();
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		size_t l, i;
+
+		for (l = 0; l < ICACHE_SWEEP_LAYOUTS; l++) {
+			for (i = 0; i < ICACHE_SWEEP_SIZES; i++) {
+				const size_t size = ICACHE_SWEEP_MIN << (2 * i);
+				const size_t blocks = size / ICACHE_SWEEP_BLOCK;
+				const size_t calls = (blocks >= ICACHE_SWEEP_BLOCKS) ?
+					1 : ICACHE_SWEEP_BLOCKS / blocks;
+				stress_icache_sweep_func_t func;
+				uint64_t c1, c2;
+				double t1, t2;
+				size_t n;
+
+				if (mprotect(code, size, PROT_READ | PROT_WRITE) < 0) {
+					pr_inf_skip("%s: mprotect failed on code buffer, errno=%d (%s), "
+						"skipping stressor\n", args->name, errno, strerror(errno));
+					rc = EXIT_NO_RESOURCE;
+					goto done;
+				}
+				stress_icache_sweep_gen(code, size, l, perm);
+				if (mprotect(code, size, PROT_READ | PROT_EXEC) < 0) {
+					pr_inf_skip("%s: cannot make generated code executable, errno=%d (%s), "
+						"skipping stressor\n", args->name, errno, strerror(errno));
+					rc = EXIT_NO_RESOURCE;
+					goto done;
+				}
+				shim_flush_icache((char *)code, (char *)code + size);
+
+				func = (stress_icache_sweep_func_t)(uintptr_t)code;
+				func();		/* warm up, fault the pages in */
+
+				c1 = stress_icache_cycles(cycles_fd);
+				t1 = stress_time_now();
+				for (n = 0; n < calls; n++)
+					func();
+				t2 = stress_time_now();
+				c2 = stress_icache_cycles(cycles_fd);
+
+				sweep->ns[l][i] += (t2 - t1) * (double)STRESS_NANOSECOND;
+				sweep->cycles[l][i] += (cycles_fd >= 0) ? (double)(c2 - c1) :
+					(t2 - t1) * (double)STRESS_NANOSECOND * ghz;
+				sweep->blocks[l][i] += (double)(calls * blocks);
+
+				if (!keep_stressing_flag())
+					goto done;
+			}
+		}
+		inc_counter(args);
+	} while (keep_stressing(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (rc == EXIT_SUCCESS)
+		stress_icache_sweep_report(args, sweep, cycles_fd >= 0, ghz);
+
+	if (cycles_fd >= 0)
+		(void)close(cycles_fd);
+	(void)munmap((void *)code, ICACHE_SWEEP_MAX);
+	free(perm);
+	free(sweep);
+
+	return rc;
+}
+#endif
+
 #if (defined(STRESS_ARCH_X86) ||	\
      defined(STRESS_ARCH_ARM) ||	\
      defined(STRESS_ARCH_RISCV) ||	\
@@ -191,6 +517,19 @@ STRESS_ICACHE(stress_icache_4K, SIZE_4K, stress_icache_func_4K)
 static int stress_icache(const stress_args_t *args)
 {
 	int ret;
+	bool icache_sweep = false;
+
+	(void)stress_get_setting("icache-sweep", &icache_sweep);
+	if (icache_sweep) {
+#if defined(HAVE_ICACHE_SWEEP)
+		return stress_icache_sweep(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: icache-sweep code generation is only implemented "
+				"for x86-64 and AArch64, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -226,12 +565,14 @@ static int stress_icache(const stress_args_t *args)
 stressor_info_t stress_icache_info = {
 	.stressor = stress_icache,
 	.class = CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_icache_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
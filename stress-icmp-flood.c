@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-capabilities.h"
+#include "core-pacer.h"
 
 #if defined(HAVE_NETINET_IP_H)
 #include <netinet/ip.h>
@@ -33,9 +34,31 @@
 static const stress_help_t help[] = {
 	{ NULL,	"icmp-flood N",		"start N ICMP packet flood workers" },
 	{ NULL,	"icmp-flood-ops N",	"stop after N ICMP bogo operations (ICMP packets)" },
+	{ NULL,	"icmp-flood-pps N",	"pace the flood at N packets per second" },
+	{ NULL,	"icmp-flood-size-dist D", "paced packet sizes, fixed, uniform or imix" },
 	{ NULL,	NULL,			NULL }
 };
 
+static int stress_set_icmp_flood_pps(const char *opt)
+{
+	uint64_t icmp_flood_pps;
+
+	icmp_flood_pps = stress_get_uint64(opt);
+	stress_check_range("icmp-flood-pps", icmp_flood_pps, 1, 100000000);
+	return stress_set_setting("icmp-flood-pps", TYPE_ID_UINT64, &icmp_flood_pps);
+}
+
+static int stress_set_icmp_flood_size_dist(const char *opt)
+{
+	return stress_set_pacer_size_dist("icmp-flood-size-dist", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_icmp_flood_pps,		stress_set_icmp_flood_pps },
+	{ OPT_icmp_flood_size_dist,	stress_set_icmp_flood_size_dist },
+	{ 0,				NULL }
+};
+
 #if defined(HAVE_NETINET_IP_H) &&	\
     defined(HAVE_NETINET_IP_ICMP_H) &&	\
     defined(HAVE_ICMPHDR)
@@ -57,6 +80,84 @@ static int stress_icmp_flood_supported(const char *name)
 	return 0;
 }
 
+/*
+ *  stress_icmp_flood_pkt()
+ *	fill in the IP and ICMP echo headers of a pkt_len sized packet
+ *	to addr, the payload is left as is
+ */
+static void stress_icmp_flood_pkt(char *pkt, const size_t pkt_len, const unsigned long addr)
+{
+	struct iphdr *const ip_hdr = (struct iphdr *)pkt;
+	struct icmphdr *const icmp_hdr = (struct icmphdr *)(pkt + sizeof(struct iphdr));
+	const size_t payload_len = pkt_len - sizeof(struct iphdr) - sizeof(struct icmphdr);
+
+	(void)memset(pkt, 0, sizeof(struct iphdr) + sizeof(struct icmphdr));
+
+	ip_hdr->version = 4;
+	ip_hdr->ihl = 5;
+	ip_hdr->tos = 0;
+	ip_hdr->tot_len = htons(pkt_len);
+	ip_hdr->id = stress_mwc16();
+	ip_hdr->frag_off = 0;
+	ip_hdr->ttl = 64;
+	ip_hdr->protocol = IPPROTO_ICMP;
+	ip_hdr->saddr = (in_addr_t)addr;
+	ip_hdr->daddr = (in_addr_t)addr;
+
+	icmp_hdr->type = ICMP_ECHO;
+	icmp_hdr->code = 0;
+	icmp_hdr->un.echo.sequence = stress_mwc16();
+	icmp_hdr->un.echo.id = stress_mwc16();
+	icmp_hdr->checksum = stress_ipv4_checksum((uint16_t *)icmp_hdr,
+		sizeof(struct icmphdr) + payload_len);
+}
+
+/*
+ *  stress_icmp_flood_paced()
+ *	ICMP flood at a fixed packet rate, token bucket paced and
+ *	sent in batches with packet sizes from a size distribution
+ */
+static void stress_icmp_flood_paced(
+	const stress_args_t *args,
+	const int fd,
+	const unsigned long addr,
+	struct sockaddr_in *servaddr,
+	const uint64_t icmp_flood_pps,
+	const size_t icmp_flood_size_dist)
+{
+	const size_t hdr_len = sizeof(struct iphdr) + sizeof(struct icmphdr);
+	const size_t max_pkt_len = hdr_len + MAX_PAYLOAD_SIZE;
+	static char ALIGN64 pkts[STRESS_PACER_BATCH][sizeof(struct iphdr) +
+		sizeof(struct icmphdr) + MAX_PAYLOAD_SIZE];
+	struct iovec iov[STRESS_PACER_BATCH];
+	stress_pacer_t pacer;
+	size_t i;
+
+	for (i = 0; i < STRESS_PACER_BATCH; i++) {
+		stress_strnrnd(pkts[i] + hdr_len, MAX_PAYLOAD_SIZE);
+		iov[i].iov_base = pkts[i];
+	}
+
+	stress_pacer_init(&pacer, icmp_flood_pps);
+	do {
+		const size_t n = stress_pacer_wait(&pacer, STRESS_PACER_BATCH);
+
+		if (!n)
+			break;
+		for (i = 0; i < n; i++) {
+			const size_t pkt_len = stress_pacer_size(icmp_flood_size_dist,
+				hdr_len + 1, max_pkt_len);
+
+			stress_icmp_flood_pkt(pkts[i], pkt_len, addr);
+			iov[i].iov_len = pkt_len;
+		}
+		stress_pacer_send(&pacer, fd, iov, servaddr, sizeof(*servaddr), 0, n);
+		set_counter(args, pacer.sent);
+	} while (keep_stressing(args));
+
+	stress_pacer_stats(args, &pacer);
+}
+
 /*
  *  stress_icmp_flood
  *	stress local host with ICMP flood
@@ -68,12 +169,12 @@ static int stress_icmp_flood(const stress_args_t *args)
 	const unsigned long addr = inet_addr("127.0.0.1");
 	struct sockaddr_in servaddr;
 	uint64_t counter, sendto_fails = 0;
+	uint64_t icmp_flood_pps = 0;
+	size_t icmp_flood_size_dist = STRESS_PACER_SIZE_UNIFORM;
 
 	const size_t max_payload_len = MAX_PAYLOAD_SIZE + 1;
 	const size_t max_pkt_len = sizeof(struct iphdr) + sizeof(struct icmphdr) + max_payload_len;
 	char ALIGN64 pkt[max_pkt_len];
-	struct iphdr *const ip_hdr = (struct iphdr *)pkt;
-	struct icmphdr *const icmp_hdr = (struct icmphdr *)(pkt + sizeof(struct iphdr));
 	char *const payload = pkt + sizeof(struct iphdr) + sizeof(struct icmphdr);
 
 	(void)memset(pkt, 0, sizeof(pkt));
@@ -102,8 +203,18 @@ static int stress_icmp_flood(const stress_args_t *args)
 	servaddr.sin_addr.s_addr = (in_addr_t)addr;
 	(void)memset(&servaddr.sin_zero, 0, sizeof(servaddr.sin_zero));
 
+	(void)stress_get_setting("icmp-flood-pps", &icmp_flood_pps);
+	(void)stress_get_setting("icmp-flood-size-dist", &icmp_flood_size_dist);
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (icmp_flood_pps) {
+		stress_icmp_flood_paced(args, fd, addr, &servaddr,
+			icmp_flood_pps, icmp_flood_size_dist);
+		rc = EXIT_SUCCESS;
+		goto err_socket;
+	}
+
 	do {
 		const size_t payload_len = (stress_mwc32() % MAX_PAYLOAD_SIZE) + 1;
 		const size_t pkt_len =
@@ -111,29 +222,12 @@ static int stress_icmp_flood(const stress_args_t *args)
 
 		(void)memset(pkt, 0, sizeof(pkt));
 
-		ip_hdr->version = 4;
-		ip_hdr->ihl = 5;
-		ip_hdr->tos = 0;
-		ip_hdr->tot_len = htons(pkt_len);
-		ip_hdr->id = stress_mwc16();
-		ip_hdr->frag_off = 0;
-		ip_hdr->ttl = 64;
-		ip_hdr->protocol = IPPROTO_ICMP;
-		ip_hdr->saddr = (in_addr_t)addr;
-		ip_hdr->daddr = (in_addr_t)addr;
-
-		icmp_hdr->type = ICMP_ECHO;
-		icmp_hdr->code = 0;
-		icmp_hdr->un.echo.sequence = stress_mwc16();
-		icmp_hdr->un.echo.id = stress_mwc16();
-
 		/*
 		 * Generating random data is expensive so do it every 64 packets
 		 */
 		if ((get_counter(args) & 0x3f) == 0)
 			stress_strnrnd(payload, payload_len);
-		icmp_hdr->checksum = stress_ipv4_checksum((uint16_t *)icmp_hdr,
-			sizeof(struct icmphdr) + payload_len);
+		stress_icmp_flood_pkt(pkt, pkt_len, addr);
 
 		if ((sendto(fd, pkt, pkt_len, 0,
 			   (struct sockaddr*)&servaddr, sizeof(servaddr))) < 1) {
@@ -164,12 +258,14 @@ stressor_info_t stress_icmp_flood_info = {
 	.supported = stress_icmp_flood_supported,
 	.class = CLASS_OS | CLASS_NETWORK,
 	.verify = VERIFY_ALWAYS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_icmp_flood_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_OS | CLASS_NETWORK,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
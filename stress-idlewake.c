@@ -0,0 +1,435 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-cpuidle.h"
+#include "core-latency.h"
+
+#define MIN_IDLEWAKE_SAMPLES		(1)
+#define MAX_IDLEWAKE_SAMPLES		(100000)
+#define DEFAULT_IDLEWAKE_SAMPLES	(100)
+
+#define IDLEWAKE_TIMER			(0)	/* timer expiry wakeup */
+#define IDLEWAKE_IPI			(1)	/* cross CPU futex wakeup */
+#define IDLEWAKE_METHODS		(2)
+
+static const stress_help_t help[] = {
+	{ NULL,	"idlewake N",		"start N workers measuring wakeup latency from idle" },
+	{ NULL,	"idlewake-ops N",	"stop after N wakeups" },
+	{ NULL,	"idlewake-samples N",	"wakeups per sleep duration per pass, default 100" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_idlewake_samples(const char *opt)
+{
+	uint32_t idlewake_samples;
+
+	idlewake_samples = stress_get_uint32(opt);
+	stress_check_range("idlewake-samples", (uint64_t)idlewake_samples,
+		MIN_IDLEWAKE_SAMPLES, MAX_IDLEWAKE_SAMPLES);
+	return stress_set_setting("idlewake-samples", TYPE_ID_UINT32, &idlewake_samples);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_idlewake_samples,	stress_set_idlewake_samples },
+	{ 0,			NULL }
+};
+
+#if defined(__linux__) &&		\
+    defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_AFFINITY) &&		\
+    defined(HAVE_CLOCK_NANOSLEEP) &&	\
+    defined(CLOCK_MONOTONIC) &&		\
+    defined(TIMER_ABSTIME)
+
+/* idle durations, the CPU is given time to reach deeper C-states */
+typedef struct {
+	const uint64_t ns;		/* sleep in ns */
+	const char *label;		/* human readable sleep */
+	const bool stats;		/* report in misc stats */
+} stress_idlewake_sleep_t;
+
+static const stress_idlewake_sleep_t idlewake_sleeps[] = {
+	{ 10000,	"10us",		false },
+	{ 50000,	"50us",		false },
+	{ 100000,	"100us",	true },
+	{ 500000,	"500us",	false },
+	{ 1000000,	"1ms",		true },
+	{ 5000000,	"5ms",		false },
+	{ 10000000,	"10ms",		true },
+};
+
+#define IDLEWAKE_SLEEPS		(SIZEOF_ARRAY(idlewake_sleeps))
+
+/* wakeup latencies and idle state entries of a method and sleep duration */
+typedef struct {
+	stress_latency_t latency;	/* wakeup latencies */
+	uint64_t usage[STRESS_CPUIDLE_STATES_MAX]; /* idle state entries of the woken CPU */
+} stress_idlewake_result_t;
+
+/* futex handshake between the waker and the waiting thread */
+typedef struct {
+	uint32_t futex;			/* 1 when a wakeup is posted */
+	uint32_t acks;			/* wakeups handled by the waiter */
+	bool stop;			/* waiter should exit */
+	uint64_t t_wake;		/* time the wakeup was posted */
+	uint64_t latency;		/* latency of the last wakeup */
+	int32_t cpu;			/* CPU the waiter runs on */
+} stress_idlewake_ipi_t;
+
+/*
+ *  stress_idlewake_pin()
+ *	pin the calling thread to a CPU
+ */
+static void stress_idlewake_pin(const int32_t cpu)
+{
+	cpu_set_t mask;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+/*
+ *  stress_idlewake_waiter()
+ *	block on the futex and time how long it takes to run
+ *	after the waker on the other CPU posts a wakeup
+ */
+static void *stress_idlewake_waiter(void *arg)
+{
+	stress_idlewake_ipi_t *ipi = (stress_idlewake_ipi_t *)arg;
+
+	stress_idlewake_pin(ipi->cpu);
+	while (!__atomic_load_n(&ipi->stop, __ATOMIC_ACQUIRE)) {
+		uint64_t t;
+
+		if (__atomic_load_n(&ipi->futex, __ATOMIC_ACQUIRE) == 0) {
+			(void)shim_futex_wait(&ipi->futex, 0, NULL);
+			continue;
+		}
+		t = stress_latency_now();
+		ipi->latency = t - __atomic_load_n(&ipi->t_wake, __ATOMIC_ACQUIRE);
+		__atomic_store_n(&ipi->futex, 0, __ATOMIC_RELEASE);
+		(void)__atomic_fetch_add(&ipi->acks, 1, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_idlewake_cpus()
+ *	pick a waker and a waiter CPU from the allowed CPUs, each
+ *	instance uses a different pair where possible, the waiter
+ *	CPU is -1 if only one CPU is allowed
+ */
+static void stress_idlewake_cpus(
+	const stress_args_t *args,
+	int32_t *waker,
+	int32_t *waiter)
+{
+	cpu_set_t mask;
+	int32_t cpus[2] = { -1, -1 };
+	int32_t cpu, n, allowed, skip;
+
+	*waker = -1;
+	*waiter = -1;
+	CPU_ZERO(&mask);
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0)
+		return;
+	allowed = (int32_t)CPU_COUNT(&mask);
+	if (allowed < 1)
+		return;
+	skip = (int32_t)((args->instance * 2) % (uint32_t)allowed);
+	for (n = 0, cpu = 0; (cpu < CPU_SETSIZE) && (n < 2); cpu++) {
+		if (!CPU_ISSET(cpu, &mask))
+			continue;
+		if (skip > 0) {
+			skip--;
+			continue;
+		}
+		cpus[n++] = cpu;
+	}
+	*waker = cpus[0];
+	*waiter = (allowed > 1) ? cpus[1] : -1;
+	/* wrapped around the end of the allowed CPUs */
+	if ((allowed > 1) && (*waiter < 0)) {
+		for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &mask) && (cpu != *waker)) {
+				*waiter = cpu;
+				break;
+			}
+		}
+	}
+}
+
+/*
+ *  stress_idlewake_usage()
+ *	add the idle state entries of a CPU since a previous
+ *	reading to a result
+ */
+static void stress_idlewake_usage(
+	const int32_t cpu,
+	const uint64_t *before,
+	const size_t n_before,
+	stress_idlewake_result_t *result)
+{
+	uint64_t after[STRESS_CPUIDLE_STATES_MAX];
+	size_t i, n;
+
+	if (cpu < 0)
+		return;
+	n = stress_cpuidle_usage(cpu, after, NULL, STRESS_CPUIDLE_STATES_MAX);
+	n = STRESS_MINIMUM(n, n_before);
+	for (i = 0; i < n; i++) {
+		if (after[i] >= before[i])
+			result->usage[i] += after[i] - before[i];
+	}
+}
+
+/*
+ *  stress_idlewake_state()
+ *	name of the idle state entered most often, "-" if
+ *	there is no cpuidle information
+ */
+static void stress_idlewake_state(
+	const int32_t cpu,
+	const stress_idlewake_result_t *result,
+	char *name,
+	const size_t len)
+{
+	size_t i, most = 0;
+
+	(void)shim_strlcpy(name, "-", len);
+	for (i = 1; i < STRESS_CPUIDLE_STATES_MAX; i++) {
+		if (result->usage[i] > result->usage[most])
+			most = i;
+	}
+	if ((cpu >= 0) && result->usage[most])
+		(void)stress_cpuidle_name(cpu, most, name, len);
+}
+
+/*
+ *  stress_idlewake_timer()
+ *	sleep until an absolute time and measure how late the
+ *	wakeup is, this includes the C-state exit latency
+ */
+static int stress_idlewake_timer(
+	const stress_args_t *args,
+	const uint64_t sleep_ns,
+	const uint32_t samples,
+	const int32_t cpu,
+	stress_idlewake_result_t *result)
+{
+	uint64_t before[STRESS_CPUIDLE_STATES_MAX];
+	size_t n_before = 0;
+	uint32_t i;
+
+	if (cpu >= 0)
+		n_before = stress_cpuidle_usage(cpu, before, NULL, STRESS_CPUIDLE_STATES_MAX);
+	for (i = 0; (i < samples) && keep_stressing(args); i++) {
+		struct timespec ts;
+		const uint64_t target = stress_latency_now() + sleep_ns;
+		uint64_t t;
+
+		ts.tv_sec = (time_t)(target / STRESS_NANOSECOND);
+		ts.tv_nsec = (long)(target % STRESS_NANOSECOND);
+		if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+			continue;
+		t = stress_latency_now();
+		stress_latency_record(&result->latency, (t > target) ? t - target : 0);
+		inc_counter(args);
+	}
+	stress_idlewake_usage(cpu, before, n_before, result);
+	return 0;
+}
+
+/*
+ *  stress_idlewake_ipi()
+ *	sleep to let the waiter CPU go idle and then wake the
+ *	waiter with a futex wake, the wakeup of a thread on
+ *	another CPU is sent as a reschedule IPI
+ */
+static int stress_idlewake_ipi(
+	const stress_args_t *args,
+	const uint64_t sleep_ns,
+	const uint32_t samples,
+	stress_idlewake_ipi_t *ipi,
+	stress_idlewake_result_t *result)
+{
+	uint64_t before[STRESS_CPUIDLE_STATES_MAX];
+	size_t n_before;
+	uint32_t i;
+
+	n_before = stress_cpuidle_usage(ipi->cpu, before, NULL, STRESS_CPUIDLE_STATES_MAX);
+	for (i = 0; (i < samples) && keep_stressing(args); i++) {
+		const uint32_t acks = __atomic_load_n(&ipi->acks, __ATOMIC_ACQUIRE);
+		const double timeout = stress_time_now() + 1.0;
+
+		(void)shim_nanosleep_uint64(sleep_ns);
+		__atomic_store_n(&ipi->t_wake, stress_latency_now(), __ATOMIC_RELEASE);
+		__atomic_store_n(&ipi->futex, 1, __ATOMIC_RELEASE);
+		(void)shim_futex_wake(&ipi->futex, 1);
+
+		/* wait for the waiter to run and go back to sleep */
+		while (__atomic_load_n(&ipi->acks, __ATOMIC_ACQUIRE) == acks) {
+			if (stress_time_now() > timeout) {
+				pr_fail("%s: futex wakeup of waiter thread timed out\n", args->name);
+				return -1;
+			}
+		}
+		stress_latency_record(&result->latency, ipi->latency);
+		inc_counter(args);
+	}
+	stress_idlewake_usage(ipi->cpu, before, n_before, result);
+	return 0;
+}
+
+/*
+ *  stress_idlewake()
+ *	stress wakeups from idle
+ */
+static int stress_idlewake(const stress_args_t *args)
+{
+	static stress_idlewake_result_t results[IDLEWAKE_METHODS][IDLEWAKE_SLEEPS];
+	static stress_idlewake_ipi_t ipi;
+	uint32_t idlewake_samples = DEFAULT_IDLEWAKE_SAMPLES;
+	int32_t waker_cpu, waiter_cpu;
+	pthread_t pthread;
+	int ret, rc = EXIT_SUCCESS;
+	bool ipi_ok = false;
+	size_t s, m, idx = 0;
+
+	(void)stress_get_setting("idlewake-samples", &idlewake_samples);
+
+	(void)memset(results, 0, sizeof(results));
+	for (m = 0; m < IDLEWAKE_METHODS; m++) {
+		for (s = 0; s < IDLEWAKE_SLEEPS; s++)
+			stress_latency_reset(&results[m][s].latency);
+	}
+
+#if defined(PR_SET_TIMERSLACK)
+	/* do not let the kernel defer the timer wakeups */
+	(void)prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+#endif
+	stress_idlewake_cpus(args, &waker_cpu, &waiter_cpu);
+	stress_idlewake_pin(waker_cpu);
+
+	(void)memset(&ipi, 0, sizeof(ipi));
+	ipi.cpu = waiter_cpu;
+	if (waiter_cpu >= 0) {
+		ret = pthread_create(&pthread, NULL, stress_idlewake_waiter, &ipi);
+		if (ret == 0)
+			ipi_ok = true;
+		else
+			pr_inf("%s: cannot create waiter thread, skipping IPI wakeups, "
+				"errno=%d (%s)\n", args->name, ret, strerror(ret));
+	} else if (args->instance == 0) {
+		pr_inf("%s: only one CPU available, skipping IPI wakeups\n", args->name);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (s = 0; (s < IDLEWAKE_SLEEPS) && keep_stressing(args); s++) {
+			(void)stress_idlewake_timer(args, idlewake_sleeps[s].ns,
+				idlewake_samples, waker_cpu, &results[IDLEWAKE_TIMER][s]);
+			if (!ipi_ok)
+				continue;
+			if (stress_idlewake_ipi(args, idlewake_sleeps[s].ns,
+					idlewake_samples, &ipi, &results[IDLEWAKE_IPI][s]) < 0) {
+				rc = EXIT_FAILURE;
+				goto stop;
+			}
+		}
+	} while (keep_stressing(args));
+
+stop:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (ipi_ok) {
+		__atomic_store_n(&ipi.stop, true, __ATOMIC_RELEASE);
+		__atomic_store_n(&ipi.futex, 1, __ATOMIC_RELEASE);
+		(void)shim_futex_wake(&ipi.futex, 1);
+		(void)pthread_join(pthread, NULL);
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: wakeup latency in us, timer on CPU %" PRId32 ", IPI to CPU %" PRId32 ":\n",
+			args->name, waker_cpu, waiter_cpu);
+		pr_inf("%s: %8s %8s %8s %8s %-8s %8s %8s %8s %-8s\n", args->name,
+			"sleep", "timer50", "timer99", "max", "state",
+			"ipi50", "ipi99", "max", "state");
+	}
+	for (s = 0; s < IDLEWAKE_SLEEPS; s++) {
+		char cols[IDLEWAKE_METHODS][80];
+
+		for (m = 0; m < IDLEWAKE_METHODS; m++) {
+			const stress_idlewake_result_t *r = &results[m][s];
+			const int32_t cpu = (m == IDLEWAKE_TIMER) ? waker_cpu : waiter_cpu;
+			char state[32];
+
+			stress_idlewake_state(cpu, r, state, sizeof(state));
+			if (r->latency.count) {
+				(void)snprintf(cols[m], sizeof(cols[m]), "%8.1f %8.1f %8.1f %-8s",
+					(double)stress_latency_percentile(&r->latency, 50.0) / 1000.0,
+					(double)stress_latency_percentile(&r->latency, 99.0) / 1000.0,
+					(double)r->latency.max / 1000.0, state);
+			} else {
+				(void)snprintf(cols[m], sizeof(cols[m]), "%8s %8s %8s %-8s",
+					"-", "-", "-", "-");
+			}
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %8s %s %s\n", args->name, idlewake_sleeps[s].label,
+				cols[IDLEWAKE_TIMER], cols[IDLEWAKE_IPI]);
+
+		/* p50 and p99 of the 100us, 1ms and 10ms sleeps */
+		if (!idlewake_sleeps[s].stats)
+			continue;
+		for (m = 0; m < IDLEWAKE_METHODS; m++) {
+			const stress_idlewake_result_t *r = &results[m][s];
+			const char *method = (m == IDLEWAKE_TIMER) ? "timer" : "IPI";
+			char desc[32];
+
+			if (!r->latency.count || (idx >= STRESS_MISC_STATS_MAX - 1))
+				continue;
+			(void)snprintf(desc, sizeof(desc), "%s %s p50 wake us", method, idlewake_sleeps[s].label);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				(double)stress_latency_percentile(&r->latency, 50.0) / 1000.0);
+			(void)snprintf(desc, sizeof(desc), "%s %s p99 wake us", method, idlewake_sleeps[s].label);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				(double)stress_latency_percentile(&r->latency, 99.0) / 1000.0);
+		}
+	}
+
+	return rc;
+}
+
+stressor_info_t stress_idlewake_info = {
+	.stressor = stress_idlewake,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_idlewake_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -19,19 +19,82 @@
  */
 
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #if defined(HAVE_SYS_EPOLL_H)
 #include <sys/epoll.h>
 #endif
 
+#if defined(HAVE_SYS_FANOTIFY_H)
+#include <sys/fanotify.h>
+#endif
+
 #if defined(HAVE_SYS_INOTIFY_H)
 #include <sys/inotify.h>
 #endif
 
+#define MIN_INOTIFY_WATCHES		(1)
+#define MAX_INOTIFY_WATCHES		(1000000)
+#define DEFAULT_INOTIFY_WATCHES		(1024)
+
+#define MIN_INOTIFY_PRODUCERS		(1)
+#define MAX_INOTIFY_PRODUCERS		(64)
+#define DEFAULT_INOTIFY_PRODUCERS	(4)
+
+#define MIN_INOTIFY_QUEUE		(16)
+#define MAX_INOTIFY_QUEUE		(16 * 1024 * 1024)
+
 static const stress_help_t help[] = {
-	{ NULL,	"inotify N",	 "start N workers exercising inotify events" },
-	{ NULL,	"inotify-ops N", "stop inotify workers after N bogo operations" },
-	{ NULL, NULL,		 NULL }
+	{ NULL,	"inotify N",		"start N workers exercising inotify events" },
+	{ NULL,	"inotify-bench",	"measure inotify/fanotify event rates, latency and overflows" },
+	{ NULL,	"inotify-ops N",	"stop inotify workers after N bogo operations" },
+	{ NULL,	"inotify-producers N",	"number of event producer threads for --inotify-bench" },
+	{ NULL,	"inotify-queue N",	"set inotify max_queued_events for --inotify-bench" },
+	{ NULL,	"inotify-watches N",	"number of watched directories for --inotify-bench" },
+	{ NULL, NULL,			NULL }
+};
+
+static int stress_set_inotify_bench(const char *opt)
+{
+	return stress_set_setting_true("inotify-bench", opt);
+}
+
+static int stress_set_inotify_producers(const char *opt)
+{
+	uint32_t inotify_producers;
+
+	inotify_producers = stress_get_uint32(opt);
+	stress_check_range("inotify-producers", (uint64_t)inotify_producers,
+		MIN_INOTIFY_PRODUCERS, MAX_INOTIFY_PRODUCERS);
+	return stress_set_setting("inotify-producers", TYPE_ID_UINT32, &inotify_producers);
+}
+
+static int stress_set_inotify_queue(const char *opt)
+{
+	uint32_t inotify_queue;
+
+	inotify_queue = stress_get_uint32(opt);
+	stress_check_range("inotify-queue", (uint64_t)inotify_queue,
+		MIN_INOTIFY_QUEUE, MAX_INOTIFY_QUEUE);
+	return stress_set_setting("inotify-queue", TYPE_ID_UINT32, &inotify_queue);
+}
+
+static int stress_set_inotify_watches(const char *opt)
+{
+	uint32_t inotify_watches;
+
+	inotify_watches = stress_get_uint32(opt);
+	stress_check_range("inotify-watches", (uint64_t)inotify_watches,
+		MIN_INOTIFY_WATCHES, MAX_INOTIFY_WATCHES);
+	return stress_set_setting("inotify-watches", TYPE_ID_UINT32, &inotify_watches);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_inotify_bench,		stress_set_inotify_bench },
+	{ OPT_inotify_producers,	stress_set_inotify_producers },
+	{ OPT_inotify_queue,		stress_set_inotify_queue },
+	{ OPT_inotify_watches,		stress_set_inotify_watches },
+	{ 0,				NULL }
 };
 
 #if defined(HAVE_INOTIFY) &&		\
@@ -931,6 +994,604 @@ static const stress_inotify_t inotify_stressors[] = {
 	{ NULL,				NULL }
 };
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(IN_CREATE) &&		\
+    defined(IN_NONBLOCK) &&		\
+    defined(IN_Q_OVERFLOW)
+
+#define HAVE_INOTIFY_BENCH
+
+#if defined(HAVE_SYS_FANOTIFY_H) &&		\
+    defined(HAVE_FANOTIFY) &&			\
+    defined(FAN_CLASS_NOTIF) &&			\
+    defined(FAN_CREATE) &&			\
+    defined(FAN_NONBLOCK) &&			\
+    defined(FAN_Q_OVERFLOW) &&			\
+    defined(FAN_REPORT_FID) &&			\
+    defined(FAN_REPORT_DFID_NAME) &&		\
+    defined(FAN_EVENT_INFO_TYPE_DFID_NAME)
+#define HAVE_INOTIFY_BENCH_FANOTIFY
+#endif
+
+#define INOTIFY_BENCH_TIME	(0.5)		/* seconds per measurement */
+#define INOTIFY_BENCH_DRAIN_MS	(50)		/* idle ms to treat queue as drained */
+#define INOTIFY_BENCH_BUF_SIZE	(64 * KB)
+#define INOTIFY_BENCH_DIR_FANOUT (1024)		/* leaf directories per middle directory */
+
+#define INOTIFY_MAX_QUEUED	"/proc/sys/fs/inotify/max_queued_events"
+#define INOTIFY_MAX_WATCHES	"/proc/sys/fs/inotify/max_user_watches"
+
+enum {
+	INOTIFY_BENCH_INOTIFY,
+	INOTIFY_BENCH_FANOTIFY,
+	INOTIFY_BENCH_BACKENDS,
+};
+
+static const char * const inotify_bench_backends[] = {
+	"inotify",
+	"fanotify",
+};
+
+/* per producer event rates, 0 is unlimited */
+static const uint64_t inotify_bench_rates[] = {
+	1000, 10000, 100000, 0
+};
+
+#define INOTIFY_BENCH_RATES	SIZEOF_ARRAY(inotify_bench_rates)
+
+typedef struct {
+	double gen_rate;	/* K events per second generated */
+	double read_rate;	/* K events per second read */
+	double overflow_rate;	/* queue overflows per second */
+	double lost;		/* % of generated events never read */
+	uint64_t p50;		/* median delivery latency ns */
+	uint64_t p99;		/* 99th percentile delivery latency ns */
+	bool valid;
+} stress_inotify_bench_cell_t;
+
+typedef struct {
+	stress_inotify_bench_cell_t cell[INOTIFY_BENCH_BACKENDS][INOTIFY_BENCH_RATES];
+	uint32_t marks[INOTIFY_BENCH_BACKENDS];	/* watches or marks added */
+} stress_inotify_bench_t;
+
+typedef struct {
+	pthread_t pthread;
+	const stress_args_t *args;
+	const char *path;
+	volatile bool *stop;
+	uint64_t rate;		/* events per second, 0 is unlimited */
+	uint64_t generated;	/* events generated */
+	uint32_t dirs;		/* number of watched directories */
+	uint32_t id;
+} stress_inotify_bench_producer_t;
+
+static inline void stress_inotify_bench_dirname(
+	char *dirname,
+	const size_t len,
+	const char *path,
+	const uint32_t i)
+{
+	(void)snprintf(dirname, len, "%s/bench/%" PRIx32 "/%" PRIx32, path,
+		i / INOTIFY_BENCH_DIR_FANOUT, i % INOTIFY_BENCH_DIR_FANOUT);
+}
+
+/*
+ *  stress_inotify_bench_tree()
+ *	make (or remove if make is false) the first n leaf directories
+ *	of the watched tree, returns the number of directories made
+ */
+static uint32_t stress_inotify_bench_tree(
+	const stress_args_t *args,
+	const char *path,
+	const uint32_t n,
+	const bool make)
+{
+	char dirname[PATH_MAX];
+	uint32_t i;
+
+	if (!make) {
+		for (i = 0; i < n; i++) {
+			stress_inotify_bench_dirname(dirname, sizeof(dirname), path, i);
+			(void)shim_rmdir(dirname);
+			if (((i + 1) % INOTIFY_BENCH_DIR_FANOUT == 0) || (i + 1 == n)) {
+				*strrchr(dirname, '/') = '\0';
+				(void)shim_rmdir(dirname);
+			}
+		}
+		(void)snprintf(dirname, sizeof(dirname), "%s/bench", path);
+		(void)shim_rmdir(dirname);
+		return 0;
+	}
+
+	(void)snprintf(dirname, sizeof(dirname), "%s/bench", path);
+	if ((mkdir(dirname, DIR_FLAGS) < 0) && (errno != EEXIST))
+		return 0;
+	for (i = 0; (i < n) && keep_stressing(args); i++) {
+		stress_inotify_bench_dirname(dirname, sizeof(dirname), path, i);
+		if ((i % INOTIFY_BENCH_DIR_FANOUT) == 0) {
+			char *ptr = strrchr(dirname, '/');
+
+			*ptr = '\0';
+			if ((mkdir(dirname, DIR_FLAGS) < 0) && (errno != EEXIST))
+				break;
+			*ptr = '/';
+		}
+		if ((mkdir(dirname, DIR_FLAGS) < 0) && (errno != EEXIST))
+			break;
+	}
+	return i;
+}
+
+/*
+ *  stress_inotify_bench_producer()
+ *	create and unlink files named with their creation time in
+ *	random watched directories at the given rate
+ */
+static void *stress_inotify_bench_producer(void *arg)
+{
+	stress_inotify_bench_producer_t *p = (stress_inotify_bench_producer_t *)arg;
+	const uint64_t t_start = stress_latency_now();
+	char dirname[PATH_MAX], filename[PATH_MAX + 64];
+
+	while (!*p->stop && keep_stressing(p->args)) {
+		int fd;
+
+		if (p->rate) {
+			const uint64_t t_due = t_start + (p->generated * STRESS_NANOSECOND) / p->rate;
+			const uint64_t t_now = stress_latency_now();
+
+			if (t_now < t_due) {
+				(void)shim_nanosleep_uint64(t_due - t_now);
+				continue;
+			}
+		}
+		stress_inotify_bench_dirname(dirname, sizeof(dirname), p->path,
+			stress_mwc32() % p->dirs);
+		(void)snprintf(filename, sizeof(filename), "%s/p%" PRIu32 "_%" PRIu64,
+			dirname, p->id, stress_latency_now());
+		fd = open(filename, O_CREAT | O_WRONLY, FILE_FLAGS);
+		if (fd < 0)
+			break;
+		(void)close(fd);
+		(void)shim_unlink(filename);
+		p->generated++;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_inotify_bench_latency()
+ *	record the delivery latency of an event from the creation time
+ *	encoded in its file name
+ */
+static inline void stress_inotify_bench_latency(
+	stress_latency_t *lat,
+	const char *name,
+	const uint64_t t_now)
+{
+	const char *ptr = strchr(name, '_');
+	uint64_t t;
+
+	if ((name[0] != 'p') || !ptr)
+		return;
+	t = (uint64_t)strtoull(ptr + 1, NULL, 10);
+	if (t_now > t)
+		stress_latency_record(lat, t_now - t);
+}
+
+/*
+ *  stress_inotify_bench_read()
+ *	read and account for a buffer of events, returns the number of
+ *	file events read, -1 if nothing could be read
+ */
+static int64_t stress_inotify_bench_read(
+	const int fd,
+	const int backend,
+	char *buf,
+	stress_latency_t *lat,
+	uint64_t *overflows)
+{
+	const ssize_t len = read(fd, buf, INOTIFY_BENCH_BUF_SIZE);
+	const uint64_t t_now = stress_latency_now();
+	int64_t n = 0;
+
+	if (len <= 0)
+		return -1;
+
+#if defined(HAVE_INOTIFY_BENCH_FANOTIFY)
+	if (backend == INOTIFY_BENCH_FANOTIFY) {
+		struct fanotify_event_metadata *meta = (struct fanotify_event_metadata *)buf;
+		ssize_t left = len;
+
+		for (; FAN_EVENT_OK(meta, left); meta = FAN_EVENT_NEXT(meta, left)) {
+			char *ptr = (char *)(meta + 1);
+			char *end = (char *)meta + meta->event_len;
+
+			if (meta->fd >= 0)
+				(void)close(meta->fd);
+			if (meta->mask & FAN_Q_OVERFLOW) {
+				(*overflows)++;
+				continue;
+			}
+			n++;
+			while (ptr + sizeof(struct fanotify_event_info_header) <= end) {
+				struct fanotify_event_info_fid *fid = (struct fanotify_event_info_fid *)ptr;
+
+				if (fid->hdr.len == 0)
+					break;
+				if (fid->hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) {
+					struct file_handle *fh = (struct file_handle *)fid->handle;
+
+					stress_inotify_bench_latency(lat,
+						(char *)fh->f_handle + fh->handle_bytes, t_now);
+					break;
+				}
+				ptr += fid->hdr.len;
+			}
+		}
+		return n;
+	}
+#else
+	(void)backend;
+#endif
+	{
+		char *ptr = buf;
+
+		while (ptr < buf + len) {
+			struct inotify_event *event = (struct inotify_event *)ptr;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				(*overflows)++;
+			} else {
+				n++;
+				if (event->len)
+					stress_inotify_bench_latency(lat, event->name, t_now);
+			}
+			ptr += sizeof(*event) + event->len;
+		}
+	}
+	return n;
+}
+
+/*
+ *  stress_inotify_bench_wait()
+ *	wait up to ms milliseconds for events, true if events are ready
+ */
+static bool stress_inotify_bench_wait(const int fd, const int ms)
+{
+	fd_set rfds;
+	struct timeval tv;
+
+	FD_ZERO(&rfds);
+	FD_SET(fd, &rfds);
+	tv.tv_sec = 0;
+	tv.tv_usec = ms * 1000;
+	return select(fd + 1, &rfds, NULL, NULL, &tv) > 0;
+}
+
+/*
+ *  stress_inotify_bench_drain()
+ *	read events until none arrive for INOTIFY_BENCH_DRAIN_MS
+ */
+static void stress_inotify_bench_drain(
+	const int fd,
+	const int backend,
+	char *buf,
+	stress_latency_t *lat,
+	uint64_t *received,
+	uint64_t *overflows)
+{
+	while (stress_inotify_bench_wait(fd, INOTIFY_BENCH_DRAIN_MS)) {
+		const int64_t n = stress_inotify_bench_read(fd, backend, buf, lat, overflows);
+
+		if (n < 0)
+			break;
+		*received += (uint64_t)n;
+	}
+}
+
+/*
+ *  stress_inotify_bench_init()
+ *	create a notification group watching the first n directories,
+ *	returns the fd and the number of watches or marks added
+ */
+static int stress_inotify_bench_init(
+	const stress_args_t *args,
+	const int backend,
+	const char *path,
+	const uint32_t n,
+	uint32_t *added)
+{
+	char dirname[PATH_MAX];
+	int fd;
+	uint32_t i;
+
+	*added = 0;
+#if defined(HAVE_INOTIFY_BENCH_FANOTIFY)
+	if (backend == INOTIFY_BENCH_FANOTIFY)
+		fd = fanotify_init(FAN_CLASS_NOTIF | FAN_NONBLOCK |
+			FAN_REPORT_FID | FAN_REPORT_DFID_NAME, O_RDONLY);
+	else
+#endif
+	if (backend == INOTIFY_BENCH_INOTIFY)
+		fd = inotify_init1(IN_NONBLOCK);
+	else
+		return -1;
+	if (fd < 0)
+		return -1;
+
+	for (i = 0; (i < n) && keep_stressing(args); i++) {
+		int ret;
+
+		stress_inotify_bench_dirname(dirname, sizeof(dirname), path, i);
+#if defined(HAVE_INOTIFY_BENCH_FANOTIFY)
+		if (backend == INOTIFY_BENCH_FANOTIFY)
+			ret = fanotify_mark(fd, FAN_MARK_ADD, FAN_CREATE, AT_FDCWD, dirname);
+		else
+#endif
+			ret = inotify_add_watch(fd, dirname, IN_CREATE);
+		if (ret < 0)
+			break;
+	}
+	*added = i;
+	if (i == 0) {
+		(void)close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ *  stress_inotify_bench_cell()
+ *	run the producers at a given rate for INOTIFY_BENCH_TIME seconds
+ *	while reading events, then drain the queue and account
+ */
+static void stress_inotify_bench_cell(
+	const stress_args_t *args,
+	const int fd,
+	const int backend,
+	const char *path,
+	const uint32_t dirs,
+	const uint32_t producers,
+	const uint64_t rate,
+	char *buf,
+	stress_inotify_bench_cell_t *cell)
+{
+	static stress_inotify_bench_producer_t p[MAX_INOTIFY_PRODUCERS];
+	static stress_latency_t lat;
+	volatile bool stop = false;
+	uint64_t received = 0, overflows = 0, generated = 0;
+	uint32_t i, started;
+	double t_start, dt;
+
+	(void)memset(cell, 0, sizeof(*cell));
+	stress_latency_reset(&lat);
+
+	for (started = 0; started < producers; started++) {
+		p[started].args = args;
+		p[started].path = path;
+		p[started].stop = &stop;
+		p[started].rate = rate;
+		p[started].generated = 0;
+		p[started].dirs = dirs;
+		p[started].id = started;
+		if (pthread_create(&p[started].pthread, NULL,
+				stress_inotify_bench_producer, &p[started]) != 0)
+			break;
+	}
+	t_start = stress_time_now();
+	do {
+		if (stress_inotify_bench_wait(fd, 10)) {
+			const int64_t n = stress_inotify_bench_read(fd, backend, buf, &lat, &overflows);
+
+			if (n > 0)
+				received += (uint64_t)n;
+		}
+		dt = stress_time_now() - t_start;
+	} while (keep_stressing(args) && (dt < INOTIFY_BENCH_TIME));
+	stop = true;
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(p[i].pthread, NULL);
+		generated += p[i].generated;
+	}
+	stress_inotify_bench_drain(fd, backend, buf, &lat, &received, &overflows);
+	dt = stress_time_now() - t_start;
+
+	if ((started == 0) || (generated == 0) || (dt <= 0.0))
+		return;
+	cell->gen_rate = (double)generated / dt / 1000.0;
+	cell->read_rate = (double)received / dt / 1000.0;
+	cell->overflow_rate = (double)overflows / dt;
+	cell->lost = (received >= generated) ? 0.0 :
+		100.0 * (double)(generated - received) / (double)generated;
+	cell->p50 = stress_latency_percentile(&lat, 50.0);
+	cell->p99 = stress_latency_percentile(&lat, 99.0);
+	cell->valid = (lat.count > 0);
+}
+
+/*
+ *  stress_inotify_bench_sysctl()
+ *	raise an inotify sysctl to at least val, or set it to val if
+ *	force is true, saving the original value in orig, needs root
+ */
+static bool stress_inotify_bench_sysctl(
+	const char *path,
+	const uint64_t val,
+	const bool force,
+	char *orig,
+	const size_t orig_len)
+{
+	char str[32];
+
+	(void)memset(orig, 0, orig_len);
+	if (system_read(path, orig, orig_len - 1) < 0) {
+		*orig = '\0';
+		return false;
+	}
+	if (!force && ((uint64_t)strtoull(orig, NULL, 10) >= val)) {
+		*orig = '\0';
+		return true;
+	}
+	(void)snprintf(str, sizeof(str), "%" PRIu64 "\n", val);
+	if (system_write(path, str, strlen(str)) < 0) {
+		*orig = '\0';
+		return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_inotify_bench()
+ *	measure event throughput, delivery latency and queue overflows
+ *	of inotify and fanotify with producer threads creating files in
+ *	a watched tree of directories at a sweep of event rates
+ */
+static int stress_inotify_bench(const stress_args_t *args)
+{
+	static stress_inotify_bench_t pass, res;
+	uint32_t inotify_watches = DEFAULT_INOTIFY_WATCHES;
+	uint32_t inotify_producers = DEFAULT_INOTIFY_PRODUCERS;
+	uint32_t inotify_queue = 0, dirs;
+	char path[PATH_MAX - 64], orig_queued[32], orig_watches[32], queued[32];
+	char *buf;
+	int ret, b;
+	size_t r;
+	bool done = false;
+
+	(void)stress_get_setting("inotify-watches", &inotify_watches);
+	(void)stress_get_setting("inotify-producers", &inotify_producers);
+	(void)stress_get_setting("inotify-queue", &inotify_queue);
+
+	buf = (char *)malloc(INOTIFY_BENCH_BUF_SIZE);
+	if (!buf) {
+		pr_inf_skip("%s: cannot allocate event buffer, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_temp_dir_args(args, path, sizeof(path));
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(buf);
+		return stress_exit_status(-ret);
+	}
+
+	if (inotify_queue &&
+	    !stress_inotify_bench_sysctl(INOTIFY_MAX_QUEUED, inotify_queue, true,
+			orig_queued, sizeof(orig_queued)) &&
+	    (args->instance == 0))
+		pr_inf("%s: cannot set %s, errno=%d (%s), using current setting\n",
+			args->name, INOTIFY_MAX_QUEUED, errno, strerror(errno));
+	if (!inotify_queue)
+		*orig_queued = '\0';
+	(void)stress_inotify_bench_sysctl(INOTIFY_MAX_WATCHES,
+		(uint64_t)inotify_watches + 1024, false, orig_watches, sizeof(orig_watches));
+	(void)memset(queued, 0, sizeof(queued));
+	if (system_read(INOTIFY_MAX_QUEUED, queued, sizeof(queued) - 1) < 0)
+		(void)shim_strlcpy(queued, "unknown", sizeof(queued));
+	else
+		queued[strcspn(queued, "\n")] = '\0';
+
+	dirs = stress_inotify_bench_tree(args, path, inotify_watches, true);
+	if (dirs == 0) {
+		pr_inf_skip("%s: cannot create watched directories, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		ret = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		(void)memset(&pass, 0, sizeof(pass));
+		for (b = 0; (b < INOTIFY_BENCH_BACKENDS) && keep_stressing(args); b++) {
+			uint64_t received = 0, overflows = 0;
+			const int fd = stress_inotify_bench_init(args, b, path, dirs, &pass.marks[b]);
+
+			if (fd < 0)
+				continue;
+			for (r = 0; (r < INOTIFY_BENCH_RATES) && keep_stressing(args); r++) {
+				stress_inotify_bench_cell(args, fd, b, path, pass.marks[b],
+					inotify_producers, inotify_bench_rates[r], buf,
+					&pass.cell[b][r]);
+				stress_inotify_bench_drain(fd, b, buf, NULL, &received, &overflows);
+			}
+			(void)close(fd);
+		}
+		if (!keep_stressing(args))
+			break;
+		(void)memcpy(&res, &pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: file creation event delivery, %" PRIu32 " producers, "
+			"%.1f secs per rate, inotify max_queued_events %s%s\n",
+			args->name, inotify_producers, INOTIFY_BENCH_TIME, queued,
+			stress_fs_type(path));
+		pr_inf("%s: %8s %7s %9s %10s %10s %8s %8s %10s %6s\n", args->name,
+			"backend", "watches", "rate/prod", "gen K/sec", "read K/sec",
+			"p50 us", "p99 us", "overflow/s", "lost%");
+		for (b = 0; b < INOTIFY_BENCH_BACKENDS; b++) {
+			for (r = 0; r < INOTIFY_BENCH_RATES; r++) {
+				const stress_inotify_bench_cell_t *cell = &res.cell[b][r];
+				char rate[32];
+
+				if (inotify_bench_rates[r])
+					(void)snprintf(rate, sizeof(rate), "%" PRIu64, inotify_bench_rates[r]);
+				else
+					(void)shim_strlcpy(rate, "max", sizeof(rate));
+				if (!cell->valid) {
+					pr_inf("%s: %8s %7s %9s %10s %10s %8s %8s %10s %6s\n",
+						args->name, inotify_bench_backends[b], "-", rate,
+						"-", "-", "-", "-", "-", "-");
+					continue;
+				}
+				pr_inf("%s: %8s %7" PRIu32 " %9s %10.1f %10.1f %8.1f %8.1f %10.1f %6.2f\n",
+					args->name, inotify_bench_backends[b], res.marks[b], rate,
+					cell->gen_rate, cell->read_rate,
+					(double)cell->p50 / 1000.0, (double)cell->p99 / 1000.0,
+					cell->overflow_rate, cell->lost);
+			}
+		}
+		if (res.marks[INOTIFY_BENCH_INOTIFY] < dirs)
+			pr_inf("%s: only %" PRIu32 " of %" PRIu32 " inotify watches could be "
+				"added, see %s\n", args->name, res.marks[INOTIFY_BENCH_INOTIFY],
+				dirs, INOTIFY_MAX_WATCHES);
+	}
+	if (done) {
+		for (b = 0; b < INOTIFY_BENCH_BACKENDS; b++) {
+			/* unlimited rate */
+			const stress_inotify_bench_cell_t *cell = &res.cell[b][INOTIFY_BENCH_RATES - 1];
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s read K events/sec", inotify_bench_backends[b]);
+			stress_misc_stats_set(args->misc_stats, b * 4, str, cell->read_rate);
+			(void)snprintf(str, sizeof(str), "%s p99 latency usec", inotify_bench_backends[b]);
+			stress_misc_stats_set(args->misc_stats, (b * 4) + 1, str, (double)cell->p99 / 1000.0);
+			(void)snprintf(str, sizeof(str), "%s overflows/sec", inotify_bench_backends[b]);
+			stress_misc_stats_set(args->misc_stats, (b * 4) + 2, str, cell->overflow_rate);
+			(void)snprintf(str, sizeof(str), "%s lost events %%", inotify_bench_backends[b]);
+			stress_misc_stats_set(args->misc_stats, (b * 4) + 3, str, cell->lost);
+		}
+	}
+	ret = EXIT_SUCCESS;
+
+tidy:
+	(void)stress_inotify_bench_tree(args, path, dirs, false);
+	if (*orig_queued)
+		(void)system_write(INOTIFY_MAX_QUEUED, orig_queued, strlen(orig_queued));
+	if (*orig_watches)
+		(void)system_write(INOTIFY_MAX_WATCHES, orig_watches, strlen(orig_watches));
+	(void)stress_temp_dir_rm_args(args);
+	free(buf);
+
+	return ret;
+}
+#endif
+
 /*
  *  stress_inotify()
  *	stress inotify
@@ -940,6 +1601,13 @@ static int stress_inotify(const stress_args_t *args)
 	char pathname[PATH_MAX - 16];
 	int ret, i;
 	const int bad_fd = stress_get_bad_fd();
+#if defined(HAVE_INOTIFY_BENCH)
+	bool inotify_bench = false;
+
+	(void)stress_get_setting("inotify-bench", &inotify_bench);
+	if (inotify_bench)
+		return stress_inotify_bench(args);
+#endif
 
 	stress_temp_dir_args(args, pathname, sizeof(pathname));
 	ret = stress_temp_dir_mk_args(args);
@@ -963,6 +1631,7 @@ static int stress_inotify(const stress_args_t *args)
 stressor_info_t stress_inotify_info = {
 	.stressor = stress_inotify,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -970,6 +1639,7 @@ stressor_info_t stress_inotify_info = {
 stressor_info_t stress_inotify_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
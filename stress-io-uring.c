@@ -19,21 +19,140 @@
  */
 #include "stress-ng.h"
 #include "io-uring.h"
+#include "core-io-buf.h"
 
 #if defined(HAVE_LINUX_IO_URING_H)
 #include <linux/io_uring.h>
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#if defined(HAVE_NETINET_TCP_H)
+#include <netinet/tcp.h>
+#endif
+
 #if !defined(O_DSYNC)
 #define O_DSYNC		(0)
 #endif
 
+#define IO_URING_ENTRIES	(256)
+
+#define MIN_IO_URING_DEPTH	(1)
+#define MAX_IO_URING_DEPTH	(4096)
+#define DEFAULT_IO_URING_DEPTH	(1)
+
+#define MIN_IO_URING_BATCH	(1)
+#define MAX_IO_URING_BATCH	(MAX_IO_URING_DEPTH)
+#define DEFAULT_IO_URING_BATCH	(1)
+
+#define MIN_IO_URING_NET_SIZE	(1)
+#define MAX_IO_URING_NET_SIZE	(64 * KB)
+#define DEFAULT_IO_URING_NET_SIZE (64)
+
+#define DEFAULT_IO_URING_NET_PORT (15000)
+
 static const stress_help_t help[] = {
 	{ NULL,	"io-uring N",		"start N workers that issue io-uring I/O requests" },
+	{ NULL,	"io-uring-batch N",	"submit and reap I/O requests in batches of N" },
+	{ NULL,	"io-uring-depth N",	"keep N read/write requests in flight" },
+	{ NULL,	"io-uring-fixed",	"use registered files and buffers" },
+	{ NULL,	"io-uring-iopoll",	"busy poll for completions on O_DIRECT I/O" },
+	{ NULL,	"io-uring-net P",	"echo loopback tcp or udp messages, compared to epoll" },
+	{ NULL,	"io-uring-net-size N",	"size of each io-uring-net message in bytes" },
 	{ NULL,	"io-uring-ops N",	"stop after N bogo io-uring I/O requests" },
+	{ NULL,	"io-uring-sqpoll",	"use a kernel thread to poll the submission queue" },
+	{ NULL,	"io-uring-sqpoll-cpu N", "pin the submission queue poll thread to CPU N" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_io_uring_batch(const char *opt)
+{
+	uint32_t io_uring_batch;
+
+	io_uring_batch = stress_get_uint32(opt);
+	stress_check_range("io-uring-batch", (uint64_t)io_uring_batch,
+		MIN_IO_URING_BATCH, MAX_IO_URING_BATCH);
+	return stress_set_setting("io-uring-batch", TYPE_ID_UINT32, &io_uring_batch);
+}
+
+static int stress_set_io_uring_depth(const char *opt)
+{
+	uint32_t io_uring_depth;
+
+	io_uring_depth = stress_get_uint32(opt);
+	stress_check_range("io-uring-depth", (uint64_t)io_uring_depth,
+		MIN_IO_URING_DEPTH, MAX_IO_URING_DEPTH);
+	return stress_set_setting("io-uring-depth", TYPE_ID_UINT32, &io_uring_depth);
+}
+
+static int stress_set_io_uring_fixed(const char *opt)
+{
+	return stress_set_setting_true("io-uring-fixed", opt);
+}
+
+static int stress_set_io_uring_iopoll(const char *opt)
+{
+	return stress_set_setting_true("io-uring-iopoll", opt);
+}
+
+static int stress_set_io_uring_net(const char *opt)
+{
+	int io_uring_net;
+
+	if (!strcmp(opt, "tcp")) {
+		io_uring_net = IPPROTO_TCP;
+	} else if (!strcmp(opt, "udp")) {
+		io_uring_net = IPPROTO_UDP;
+	} else {
+		(void)fprintf(stderr, "invalid io-uring-net '%s', allowed modes are: tcp udp\n", opt);
+		return -1;
+	}
+	return stress_set_setting("io-uring-net", TYPE_ID_INT, &io_uring_net);
+}
+
+static int stress_set_io_uring_net_size(const char *opt)
+{
+	size_t io_uring_net_size;
+
+	io_uring_net_size = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("io-uring-net-size", (uint64_t)io_uring_net_size,
+		MIN_IO_URING_NET_SIZE, MAX_IO_URING_NET_SIZE);
+	return stress_set_setting("io-uring-net-size", TYPE_ID_SIZE_T, &io_uring_net_size);
+}
+
+static int stress_set_io_uring_sqpoll(const char *opt)
+{
+	return stress_set_setting_true("io-uring-sqpoll", opt);
+}
+
+static int stress_set_io_uring_sqpoll_cpu(const char *opt)
+{
+	int32_t io_uring_sqpoll_cpu;
+	const int32_t cpus = stress_get_processors_configured();
+
+	io_uring_sqpoll_cpu = stress_get_int32(opt);
+	stress_check_range("io-uring-sqpoll-cpu", (uint64_t)io_uring_sqpoll_cpu,
+		0, (uint64_t)(cpus > 0 ? cpus - 1 : 0));
+	return stress_set_setting("io-uring-sqpoll-cpu", TYPE_ID_INT32, &io_uring_sqpoll_cpu);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_io_uring_batch,		stress_set_io_uring_batch },
+	{ OPT_io_uring_depth,		stress_set_io_uring_depth },
+	{ OPT_io_uring_fixed,		stress_set_io_uring_fixed },
+	{ OPT_io_uring_iopoll,		stress_set_io_uring_iopoll },
+	{ OPT_io_uring_net,		stress_set_io_uring_net },
+	{ OPT_io_uring_net_size,	stress_set_io_uring_net_size },
+	{ OPT_io_uring_sqpoll,		stress_set_io_uring_sqpoll },
+	{ OPT_io_uring_sqpoll_cpu,	stress_set_io_uring_sqpoll_cpu },
+	{ 0,				NULL }
+};
+
 #if defined(HAVE_LINUX_IO_URING_H) &&	\
     defined(HAVE_SYSCALL) &&		\
     defined(__NR_io_uring_enter) &&	\
@@ -53,7 +172,7 @@ static const stress_help_t help[] = {
      defined(HAVE_IORING_OP_CLOSE) ||	\
      defined(HAVE_IORING_OP_MADVISE) ||	\
      defined(HAVE_IORING_OP_STATX) || 	\
-     defined(HAVE_IORING_OP_GETXATTR) || \
+     defined(HAVE_IORING_OP_FGETXATTR) || \
      defined(HAVE_IORING_OP_SYNC_FILE_RANGE))
 
 
@@ -109,6 +228,37 @@ typedef struct {
 	size_t sqes_size;
 } stress_io_uring_submit_t;
 
+/*
+ *  io uring deep queue in-flight request
+ */
+typedef struct {
+	double t_submit;	/* time the request was queued */
+	uint8_t *buf;		/* request I/O buffer */
+} stress_io_uring_req_t;
+
+/*
+ *  io uring deep queue modes
+ */
+typedef struct {
+	uint32_t depth;		/* requests to keep in flight */
+	uint32_t batch;		/* requests to submit and reap per batch */
+	size_t blocks;		/* number of blocks in the file */
+	size_t block_size;	/* bytes per request */
+	bool sqpoll;		/* kernel thread polls the submission queue */
+	bool iopoll;		/* busy poll for O_DIRECT completions */
+	bool fixed;		/* registered file and buffers */
+} stress_io_uring_deep_opts_t;
+
+/*
+ *  io uring deep queue completion stats
+ */
+typedef struct {
+	uint64_t completions;	/* completed requests */
+	double latency_total;	/* sum of completion latencies */
+	double latency_max;	/* maximum completion latency */
+	int err;		/* errno of the first failed request */
+} stress_io_uring_deep_stats_t;
+
 typedef void (*stress_io_uring_setup)(stress_io_uring_file_t *io_uring_file, struct io_uring_sqe *sqe);
 
 /*
@@ -145,6 +295,21 @@ static int shim_io_uring_enter(
 		min_complete, flags, NULL, 0);
 }
 
+#if defined(__NR_io_uring_register)
+/*
+ *  shim_io_uring_register
+ *	wrapper for io_uring_register()
+ */
+static int shim_io_uring_register(
+	int fd,
+	unsigned int opcode,
+	void *arg,
+	unsigned int nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+#endif
+
 /*
  *  stress_io_uring_unmap_iovecs()
  *	free uring file iovecs
@@ -178,20 +343,41 @@ static void stress_io_uring_unmap_iovecs(stress_io_uring_file_t *io_uring_file)
  */
 static int stress_setup_io_uring(
 	const stress_args_t *args,
-	stress_io_uring_submit_t *submit)
+	stress_io_uring_submit_t *submit,
+	const unsigned entries,
+	const unsigned setup_flags,
+	const int sq_thread_cpu)
 {
 	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
 	stress_uring_io_cq_ring_t *cring = &submit->cq_ring;
 	struct io_uring_params p;
 
 	(void)memset(&p, 0, sizeof(p));
-	submit->io_uring_fd = shim_io_uring_setup(256, &p);
+	p.flags = setup_flags;
+#if defined(IORING_SETUP_SQPOLL) &&	\
+    defined(IORING_SETUP_SQ_AFF)
+	if (setup_flags & IORING_SETUP_SQPOLL) {
+		p.sq_thread_idle = 1000;	/* milliseconds */
+		if (sq_thread_cpu >= 0) {
+			p.flags |= IORING_SETUP_SQ_AFF;
+			p.sq_thread_cpu = (uint32_t)sq_thread_cpu;
+		}
+	}
+#else
+	(void)sq_thread_cpu;
+#endif
+	submit->io_uring_fd = shim_io_uring_setup(entries, &p);
 	if (submit->io_uring_fd < 0) {
 		if (errno == ENOSYS) {
 			pr_inf_skip("%s: io-uring not supported by the kernel, skipping stressor\n",
 				args->name);
 			return EXIT_NOT_IMPLEMENTED;
 		}
+		if (setup_flags && ((errno == EPERM) || (errno == EINVAL))) {
+			pr_inf_skip("%s: io-uring setup with flags 0x%x failed, errno=%d (%s), "
+				"skipping stressor\n", args->name, p.flags, errno, strerror(errno));
+			return EXIT_NO_RESOURCE;
+		}
 		if (errno == ENOMEM) {
 			pr_inf_skip("%s: io-uring setup failed, out of memory, skipping stressor\n",
 				args->name);
@@ -315,8 +501,12 @@ static inline int stress_io_uring_complete(
 			const int err = abs(cqe->res);
 
 			/* Silently ignore EOPNOTSUPP completion errors */
-			if (errno == EOPNOTSUPP) {
+			if (err == EOPNOTSUPP) {
 				*supported = false;
+#if defined(HAVE_IORING_OP_FGETXATTR)
+			} else if ((opcode == IORING_OP_FGETXATTR) && (err == ENODATA)) {
+				/* the attribute does not exist, this is expected */
+#endif
 			} else  {
 				pr_fail("%s: completion opcode=%d (%s), error=%d (%s)\n",
 					args->name, opcode,
@@ -600,11 +790,13 @@ static void stress_io_uring_statx_setup(
 	stress_io_uring_file_t *io_uring_file,
 	struct io_uring_sqe *sqe)
 {
-	shim_statx_t statxbuf;
+	/* the kernel fills this in asynchronously, so it can't be on the stack */
+	static shim_statx_t statxbuf;
 
+	/* statx the open file via the fd, the file has been unlinked */
 	sqe->opcode = IORING_OP_STATX;
 	sqe->fd = io_uring_file->fd;
-	sqe->addr = (uintptr_t)io_uring_file->filename;
+	sqe->addr = (uintptr_t)"";
 	sqe->addr2 = (uintptr_t)&statxbuf;
 	sqe->statx_flags = AT_EMPTY_PATH;
 	sqe->ioprio = 0;
@@ -633,20 +825,22 @@ static void stress_io_uring_sync_file_range_setup(
 }
 #endif
 
-#if defined(HAVE_IORING_OP_GETXATTR)
+#if defined(HAVE_IORING_OP_FGETXATTR)
 /*
- *  stress_io_uring_getxattr_setup()
- *	setup getxattr submit over io_uring
+ *  stress_io_uring_fgetxattr_setup()
+ *	setup fgetxattr submit over io_uring
  */
-static void stress_io_uring_getxattr_setup(
+static void stress_io_uring_fgetxattr_setup(
 	stress_io_uring_file_t *io_uring_file,
 	struct io_uring_sqe *sqe)
 {
-	char value[1024];
+	/* the kernel fills this in asynchronously, so it can't be on the stack */
+	static char value[1024];
 
-	sqe->opcode = IORING_OP_STATX;
+	/* the file has been unlinked, so get the attribute via the fd */
+	sqe->opcode = IORING_OP_FGETXATTR;
 	sqe->fd = io_uring_file->fd;
-	sqe->addr = (uintptr_t)io_uring_file->filename;
+	sqe->addr = (uintptr_t)"user.stress-ng";
 	sqe->addr2 = (uintptr_t)value;
 	sqe->len = sizeof(value);
 	sqe->xattr_flags = 0;
@@ -694,8 +888,8 @@ static const stress_io_uring_setup_info_t stress_io_uring_setups[] = {
 #if defined(HAVE_IORING_OP_SYNC_FILE_RANGE)
 	{ IORING_OP_SYNC_FILE_RANGE, "IORING_OP_SYNC_FILE_RANGE", stress_io_uring_sync_file_range_setup },
 #endif
-#if defined(HAVE_IORING_OP_GETXATTR)
-	{ IORING_OP_GETXATTR, "IORING_OP_GETXATTR",	stress_io_uring_getxattr_setup },
+#if defined(HAVE_IORING_OP_FGETXATTR)
+	{ IORING_OP_FGETXATTR, "IORING_OP_FGETXATTR",	stress_io_uring_fgetxattr_setup },
 #endif
 };
 
@@ -715,6 +909,1037 @@ static const char *stress_io_uring_opcode_name(const uint8_t opcode)
 }
 
 
+/*
+ *  stress_io_uring_deep_reap()
+ *	reap all the available completions, returns the
+ *	number of completions or -1 on a failed request
+ */
+static int stress_io_uring_deep_reap(
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_req_t *reqs,
+	uint32_t *free_slots,
+	uint32_t *nfree,
+	stress_io_uring_deep_stats_t *stats)
+{
+	stress_uring_io_cq_ring_t *cring = &submit->cq_ring;
+	unsigned head = *cring->head;
+	const double t_now = stress_time_now();
+	int n = 0, ret = 0;
+
+	for (;;) {
+		const struct io_uring_cqe *cqe;
+		uint32_t slot;
+		double latency;
+
+		shim_mb();
+		if (head == *cring->tail)
+			break;
+
+		cqe = &cring->cqes[head & *cring->ring_mask];
+		slot = (uint32_t)cqe->user_data;
+		if ((cqe->res < 0) && (cqe->res != -EAGAIN) && (cqe->res != -EINTR)) {
+			if (!stats->err)
+				stats->err = -cqe->res;
+			ret = -1;
+		}
+		latency = t_now - reqs[slot].t_submit;
+		stats->latency_total += latency;
+		if (stats->latency_max < latency)
+			stats->latency_max = latency;
+		stats->completions++;
+		free_slots[(*nfree)++] = slot;
+		head++;
+		n++;
+	}
+	*cring->head = head;
+	shim_mb();
+
+	return ret < 0 ? ret : n;
+}
+
+/*
+ *  stress_io_uring_deep_register()
+ *	register the file and the request buffers with the ring
+ */
+static int stress_io_uring_deep_register(
+	const stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	int fd,
+	const stress_io_buf_pool_t *pool)
+{
+#if defined(__NR_io_uring_register) &&	\
+    defined(HAVE_IORING_OP_READ_FIXED) && \
+    defined(HAVE_IORING_OP_WRITE_FIXED)
+	if (shim_io_uring_register(submit->io_uring_fd,
+			IORING_REGISTER_FILES, &fd, 1) < 0) {
+		pr_inf_skip("%s: cannot register file, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	if (stress_io_buf_pool_register(pool, submit->io_uring_fd) < 0) {
+		pr_inf_skip("%s: cannot register %zu buffers, errno=%d (%s), "
+			"skipping stressor\n", args->name, pool->count,
+			errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	return EXIT_SUCCESS;
+#else
+	(void)submit;
+	(void)fd;
+	(void)pool;
+
+	pr_inf_skip("%s: registered files and buffers not supported, "
+		"skipping stressor\n", args->name);
+	return EXIT_NOT_IMPLEMENTED;
+#endif
+}
+
+/*
+ *  stress_io_uring_deep_prep()
+ *	prepare a random block read or write request
+ */
+static inline void stress_io_uring_deep_prep(
+	struct io_uring_sqe *sqe,
+	const int fd,
+	const uint32_t slot,
+	const stress_io_uring_req_t *req,
+	const stress_io_uring_deep_opts_t *opts)
+{
+	const bool rd = stress_mwc1();
+
+	(void)memset(sqe, 0, sizeof(*sqe));
+#if defined(HAVE_IORING_OP_READ_FIXED) && \
+    defined(HAVE_IORING_OP_WRITE_FIXED)
+	if (opts->fixed) {
+		sqe->opcode = rd ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+		sqe->fd = 0;	/* index into the registered files */
+		sqe->flags = IOSQE_FIXED_FILE;
+		sqe->buf_index = (uint16_t)slot;
+	} else
+#endif
+	{
+		sqe->opcode = rd ? IORING_OP_READ : IORING_OP_WRITE;
+		sqe->fd = fd;
+	}
+	sqe->addr = (uintptr_t)req->buf;
+	sqe->len = (uint32_t)opts->block_size;
+	sqe->off = (uint64_t)(stress_mwc32() % opts->blocks) * opts->block_size;
+	sqe->user_data = (uint64_t)slot;
+}
+
+/*
+ *  stress_io_uring_deep_mode()
+ *	human readable deep queue mode
+ */
+static void stress_io_uring_deep_mode(
+	char *buf,
+	const size_t buf_len,
+	const stress_io_uring_deep_opts_t *opts)
+{
+	(void)snprintf(buf, buf_len, "%s%s%s%s",
+		opts->sqpoll ? "sqpoll " : "",
+		opts->iopoll ? "iopoll " : "",
+		opts->fixed ? "fixed " : "",
+		(opts->sqpoll || opts->iopoll || opts->fixed) ? "" : "default ");
+	if (*buf)
+		buf[strlen(buf) - 1] = '\0';
+}
+
+/*
+ *  stress_io_uring_deep()
+ *	keep depth random block reads and writes in flight,
+ *	submitting and reaping them in batches
+ */
+static int stress_io_uring_deep(
+	const stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	const int fd,
+	const stress_io_uring_deep_opts_t *opts)
+{
+	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
+	stress_io_uring_deep_stats_t stats;
+	stress_io_uring_req_t *reqs;
+	const uint32_t depth = opts->depth;
+	const uint32_t batch = opts->batch;
+	uint32_t *free_slots, nfree = depth, i;
+	stress_io_buf_pool_t pool;
+	char path[PATH_MAX];
+	double t_start, duration, cpu_start, cpu_end;
+	struct rusage usage;
+	unsigned enter_flags = 0;
+	uint64_t syscalls = 0;
+	int rc = EXIT_SUCCESS;
+
+	reqs = calloc(depth, sizeof(*reqs));
+	free_slots = calloc(depth, sizeof(*free_slots));
+	(void)stress_temp_dir_args(args, path, sizeof(path));
+	if ((stress_io_buf_pool_alloc(args, &pool, path, opts->block_size, depth, 0) < 0) ||
+	    !reqs || !free_slots) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " deep queue requests, "
+			"skipping stressor\n", args->name, depth);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	for (i = 0; i < depth; i++) {
+		reqs[i].buf = stress_io_buf_get(&pool, i);
+		(void)memset(reqs[i].buf, stress_mwc8(), opts->block_size);
+		free_slots[i] = i;
+	}
+	if (opts->fixed) {
+		rc = stress_io_uring_deep_register(args, submit, fd, &pool);
+		if (rc != EXIT_SUCCESS)
+			goto tidy;
+	}
+	/* polled completions have to be reaped by io_uring_enter */
+	if (opts->iopoll)
+		enter_flags |= IORING_ENTER_GETEVENTS;
+
+	(void)memset(&stats, 0, sizeof(stats));
+	(void)getrusage(RUSAGE_SELF, &usage);
+	cpu_start = stress_timeval_to_double(&usage.ru_utime) +
+		    stress_timeval_to_double(&usage.ru_stime);
+	t_start = stress_time_now();
+	do {
+		const uint32_t inflight = depth - nfree;
+		const uint32_t n = STRESS_MINIMUM(batch, nfree);
+		unsigned tail = *sring->tail, to_submit, to_wait, flags = enter_flags;
+		int ret;
+
+		/* queue up to a batch of new requests */
+		for (i = 0; i < n; i++) {
+			const uint32_t slot = free_slots[--nfree];
+			const unsigned index = tail & *sring->ring_mask;
+
+			stress_io_uring_deep_prep(&submit->sqes_mmap[index],
+				fd, slot, &reqs[slot], opts);
+			sring->array[index] = index;
+			reqs[slot].t_submit = stress_time_now();
+			tail++;
+		}
+		shim_mb();
+		*sring->tail = tail;
+		shim_mb();
+
+		/* once the queue is full wait for a batch to complete */
+		to_submit = tail - *sring->head;
+		to_wait = (inflight + n >= depth) ? STRESS_MINIMUM(batch, inflight + n) : 0;
+		if (to_wait)
+			flags |= IORING_ENTER_GETEVENTS;
+#if defined(IORING_SQ_NEED_WAKEUP) &&	\
+    defined(IORING_ENTER_SQ_WAKEUP)
+		if (opts->sqpoll) {
+			/* the poll thread submits, only wake it up if it sleeps */
+			if (*sring->flags & IORING_SQ_NEED_WAKEUP)
+				flags |= IORING_ENTER_SQ_WAKEUP;
+			to_submit = 0;
+		}
+#endif
+		if (to_submit || flags) {
+			ret = shim_io_uring_enter(submit->io_uring_fd, to_submit,
+				to_wait, flags);
+			syscalls++;
+			if ((ret < 0) && (errno != EINTR) && (errno != EAGAIN) &&
+			    (errno != EBUSY) && (errno != ENOSPC)) {
+				pr_fail("%s: io_uring_enter failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				break;
+			}
+		}
+		ret = stress_io_uring_deep_reap(submit, reqs, free_slots, &nfree, &stats);
+		if (ret < 0)
+			break;
+		for (i = 0; i < (uint32_t)ret; i++)
+			inc_counter(args);
+	} while (keep_stressing(args));
+	duration = stress_time_now() - t_start;
+	(void)getrusage(RUSAGE_SELF, &usage);
+	cpu_end = stress_timeval_to_double(&usage.ru_utime) +
+		  stress_timeval_to_double(&usage.ru_stime);
+
+	if (stats.err) {
+		if ((stats.err == EOPNOTSUPP) && opts->iopoll) {
+			pr_inf_skip("%s: polled I/O is not supported by the file "
+				"system or device, skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+		} else {
+			pr_fail("%s: deep queue I/O completion failed, error=%d (%s)\n",
+				args->name, stats.err, strerror(stats.err));
+			rc = EXIT_FAILURE;
+		}
+	}
+
+	/* drain the requests still in flight before the buffers go */
+	if (nfree < depth) {
+		VOID_RET(int, shim_io_uring_enter(submit->io_uring_fd, 0,
+			depth - nfree, IORING_ENTER_GETEVENTS));
+		(void)stress_io_uring_deep_reap(submit, reqs,
+			free_slots, &nfree, &stats);
+	}
+
+	if ((rc == EXIT_SUCCESS) && (duration > 0.0) && (stats.completions > 0)) {
+		const double ops = (double)stats.completions;
+		const double iops = ops / duration;
+		const double latency_mean = stats.latency_total / ops;
+		const double cpu_per_op = (cpu_end - cpu_start) / ops;
+		char mode[32];
+
+		stress_io_uring_deep_mode(mode, sizeof(mode), opts);
+		if (args->instance == 0)
+			pr_inf("%s: %s mode, depth %" PRIu32 ", batch %" PRIu32 ", "
+				"%.0f IOPS, %.2f usec CPU per op, %.3f syscalls per op, "
+				"completion latency mean %.2f usec, max %.2f usec\n",
+				args->name, mode, depth, batch, iops,
+				cpu_per_op * 1000000.0, (double)syscalls / ops,
+				latency_mean * 1000000.0, stats.latency_max * 1000000.0);
+		stress_misc_stats_set(args->misc_stats, 0, "IOPS", iops);
+		stress_misc_stats_set(args->misc_stats, 1, "CPU usec per op",
+			cpu_per_op * 1000000.0);
+		stress_misc_stats_set(args->misc_stats, 2, "completion latency usec (mean)",
+			latency_mean * 1000000.0);
+		stress_misc_stats_set(args->misc_stats, 3, "completion latency usec (max)",
+			stats.latency_max * 1000000.0);
+	}
+
+tidy:
+	stress_io_buf_pool_free(&pool);
+	free(free_slots);
+	free(reqs);
+
+	return rc;
+}
+
+#if defined(HAVE_IORING_OP_ACCEPT) &&	\
+    defined(HAVE_IORING_OP_RECV) &&	\
+    defined(HAVE_IORING_OP_SEND) &&	\
+    defined(HAVE_IORING_OP_TIMEOUT) &&	\
+    defined(IORING_ACCEPT_MULTISHOT) &&	\
+    defined(IORING_RECV_MULTISHOT) &&	\
+    defined(IORING_CQE_F_MORE) &&	\
+    defined(IORING_CQE_F_BUFFER) &&	\
+    defined(IOSQE_BUFFER_SELECT) &&	\
+    defined(__NR_io_uring_register) &&	\
+    defined(MSG_NOSIGNAL)
+#define STRESS_IO_URING_NET
+
+#define IO_URING_NET_BUFS	(256)	/* provided buffer ring entries */
+#define IO_URING_NET_CONNS	(64)	/* max server side connections */
+#define IO_URING_NET_CLIENTS	(4)	/* client messages in flight */
+#define IO_URING_NET_ROUND	(1.0)	/* seconds per io_uring or epoll round */
+
+#define IO_URING_NET_ENGINE_URING (0)
+#define IO_URING_NET_ENGINE_EPOLL (1)
+#define IO_URING_NET_ENGINES	(2)
+
+/* completion user data, type in the top 32 bits, index in the bottom */
+#define IO_URING_NET_UD_ACCEPT	(1)
+#define IO_URING_NET_UD_RECV	(2)	/* index is the connection slot */
+#define IO_URING_NET_UD_SEND	(3)	/* index is the buffer id */
+#define IO_URING_NET_UD_TIMEOUT	(4)
+#define IO_URING_NET_UD(type, idx)	(((uint64_t)(type) << 32) | (uint64_t)(idx))
+
+/*
+ *  io uring net echo server state
+ */
+typedef struct {
+	int proto;		/* IPPROTO_TCP or IPPROTO_UDP */
+	int fd;			/* tcp listener or connected udp socket */
+	size_t msg_size;	/* bytes per message */
+	stress_io_buf_pool_t pool; /* receive buffers, one per buffer id */
+	struct sockaddr_in server_addr;
+	struct sockaddr_in client_addr;
+	bool send_zc;		/* send with IORING_OP_SEND_ZC */
+} stress_io_uring_net_t;
+
+/*
+ *  io uring net per engine echo stats
+ */
+typedef struct {
+	uint64_t bytes;		/* bytes echoed */
+	uint64_t syscalls;	/* io_uring_enter or epoll_wait calls */
+	double duration;	/* seconds run */
+	double cpu;		/* server user + system seconds */
+} stress_io_uring_net_stats_t;
+
+/*
+ *  io uring net in-flight send of a provided buffer
+ */
+typedef struct {
+	int fd;			/* socket being sent to */
+	uint32_t off;		/* bytes of the buffer sent so far */
+	uint32_t len;		/* bytes received into the buffer */
+	uint32_t refs;		/* send and notification completions due */
+} stress_io_uring_net_send_t;
+
+/*
+ *  stress_io_uring_net_cpu()
+ *	user + system CPU seconds used by the server
+ */
+static double stress_io_uring_net_cpu(void)
+{
+	struct rusage usage;
+
+	(void)getrusage(RUSAGE_SELF, &usage);
+	return stress_timeval_to_double(&usage.ru_utime) +
+	       stress_timeval_to_double(&usage.ru_stime);
+}
+
+/*
+ *  stress_io_uring_net_client()
+ *	send messages to the echo server and wait for them to
+ *	come back, reconnecting or resending when the server
+ *	switches between the io_uring and epoll engines
+ */
+static void stress_io_uring_net_client(
+	const stress_args_t *args,
+	const stress_io_uring_net_t *net)
+{
+	int fds[IO_URING_NET_CLIENTS];
+	const struct timeval tv = { 0, 100000 };
+	const int type = (net->proto == IPPROTO_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+	const size_t n = (net->proto == IPPROTO_TCP) ? IO_URING_NET_CLIENTS : 1;
+	uint8_t *buf;
+	size_t i;
+
+	buf = stress_io_buf_get(&net->pool, 0);
+	(void)memset(buf, 'A' + (args->instance % 26), net->msg_size);
+	for (i = 0; i < n; i++)
+		fds[i] = -1;
+
+	while (keep_stressing_flag()) {
+		size_t j;
+
+		for (i = 0; i < n; i++) {
+			int one = 1;
+
+			if (fds[i] >= 0)
+				continue;
+			fds[i] = socket(AF_INET, type, net->proto);
+			if (fds[i] < 0)
+				continue;
+			(void)setsockopt(fds[i], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#if defined(TCP_NODELAY)
+			if (net->proto == IPPROTO_TCP)
+				(void)setsockopt(fds[i], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+			(void)setsockopt(fds[i], SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+			if (((net->proto == IPPROTO_UDP) &&
+			     (bind(fds[i], (const struct sockaddr *)&net->client_addr,
+				   sizeof(net->client_addr)) < 0)) ||
+			    (connect(fds[i], (const struct sockaddr *)&net->server_addr,
+				     sizeof(net->server_addr)) < 0)) {
+				(void)close(fds[i]);
+				fds[i] = -1;
+				(void)shim_usleep(1000);
+			}
+		}
+
+		/* udp keeps several datagrams in flight on the one socket */
+		for (i = 0; i < IO_URING_NET_CLIENTS; i++) {
+			const int fd = fds[i % n];
+
+			if ((fd >= 0) && (send(fd, buf, net->msg_size, MSG_NOSIGNAL) < 0) &&
+			    (net->proto == IPPROTO_TCP)) {
+				(void)close(fd);
+				fds[i] = -1;
+			}
+		}
+		for (i = 0; i < IO_URING_NET_CLIENTS; i++) {
+			const int fd = fds[i % n];
+			ssize_t ret;
+
+			if (fd < 0)
+				continue;
+			if (net->proto == IPPROTO_UDP) {
+				/* lost on an engine switch, resend */
+				if (recv(fd, buf, net->msg_size, 0) < 0)
+					break;
+				continue;
+			}
+			for (j = 0; j < net->msg_size; j += (size_t)ret) {
+				ret = recv(fd, buf + j, net->msg_size - j, 0);
+				if (ret <= 0) {
+					(void)close(fd);
+					fds[i] = -1;
+					break;
+				}
+			}
+		}
+	}
+	for (i = 0; i < n; i++) {
+		if (fds[i] >= 0)
+			(void)close(fds[i]);
+	}
+}
+
+/*
+ *  stress_io_uring_net_sqe()
+ *	get the next free submission queue entry, submitting
+ *	the queued entries if the queue is full
+ */
+static struct io_uring_sqe *stress_io_uring_net_sqe(
+	stress_io_uring_submit_t *submit,
+	unsigned *tail,
+	uint64_t *syscalls)
+{
+	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
+	struct io_uring_sqe *sqe;
+	unsigned index;
+
+	if ((*tail - *sring->head) >= *sring->ring_entries) {
+		shim_mb();
+		*sring->tail = *tail;
+		shim_mb();
+		VOID_RET(int, shim_io_uring_enter(submit->io_uring_fd,
+			*tail - *sring->head, 0, 0));
+		(*syscalls)++;
+	}
+	index = *tail & *sring->ring_mask;
+	sring->array[index] = index;
+	(*tail)++;
+	sqe = &submit->sqes_mmap[index];
+	(void)memset(sqe, 0, sizeof(*sqe));
+
+	return sqe;
+}
+
+/*
+ *  stress_io_uring_net_recv()
+ *	queue a multishot recv into the provided buffer ring
+ */
+static void stress_io_uring_net_recv(
+	stress_io_uring_submit_t *submit,
+	unsigned *tail,
+	uint64_t *syscalls,
+	const int fd,
+	const uint32_t slot)
+{
+	struct io_uring_sqe *sqe = stress_io_uring_net_sqe(submit, tail, syscalls);
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = 0;
+	sqe->user_data = IO_URING_NET_UD(IO_URING_NET_UD_RECV, slot);
+}
+
+/*
+ *  stress_io_uring_net_send()
+ *	queue a send of the unsent part of a provided buffer
+ */
+static void stress_io_uring_net_send(
+	stress_io_uring_submit_t *submit,
+	unsigned *tail,
+	uint64_t *syscalls,
+	const stress_io_uring_net_t *net,
+	stress_io_uring_net_send_t *send,
+	const uint16_t bid)
+{
+	struct io_uring_sqe *sqe = stress_io_uring_net_sqe(submit, tail, syscalls);
+
+#if defined(HAVE_IORING_OP_SEND_ZC) &&	\
+    defined(IORING_CQE_F_NOTIF)
+	sqe->opcode = net->send_zc ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+#else
+	sqe->opcode = IORING_OP_SEND;
+#endif
+	sqe->fd = send->fd;
+	sqe->addr = (uintptr_t)(stress_io_buf_get(&net->pool, bid) + send->off);
+	sqe->len = send->len - send->off;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = IO_URING_NET_UD(IO_URING_NET_UD_SEND, bid);
+	send->refs++;
+}
+
+/*
+ *  stress_io_uring_net_uring()
+ *	run an io_uring echo server round, multishot accept the
+ *	tcp connections, multishot recv into a provided buffer
+ *	ring and echo each buffer back with a (zero copy) send
+ */
+static int stress_io_uring_net_uring(
+	const stress_args_t *args,
+	stress_io_uring_net_t *net,
+	stress_io_uring_net_stats_t *stats)
+{
+	stress_io_uring_submit_t submit;
+	stress_uring_io_cq_ring_t *cring = &submit.cq_ring;
+	stress_io_uring_net_send_t sends[IO_URING_NET_BUFS];
+	int conns[IO_URING_NET_CONNS];
+	bool rearm[IO_URING_NET_CONNS];
+	struct io_uring_buf_ring *br;
+	struct io_uring_buf_reg reg;
+	struct io_uring_sqe *sqe;
+	struct __kernel_timespec ts;
+	const size_t br_size = IO_URING_NET_BUFS * sizeof(struct io_uring_buf);
+	const bool tcp = (net->proto == IPPROTO_TCP);
+	unsigned tail;
+	uint16_t br_tail = 0;
+	double t_start, cpu_start;
+	bool done = false;
+	int i, rc;
+
+	(void)memset(&submit, 0, sizeof(submit));
+	rc = stress_setup_io_uring(args, &submit, IO_URING_ENTRIES, 0, -1);
+	if (rc != EXIT_SUCCESS)
+		return rc;
+
+	br = (struct io_uring_buf_ring *)mmap(NULL, br_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (br == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap provided buffer ring, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		stress_close_io_uring(&submit);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uintptr_t)br;
+	reg.ring_entries = IO_URING_NET_BUFS;
+	reg.bgid = 0;
+	if (shim_io_uring_register(submit.io_uring_fd,
+			IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		pr_inf_skip("%s: cannot register provided buffer ring, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		rc = EXIT_NOT_IMPLEMENTED;
+		goto tidy;
+	}
+	for (i = 0; i < IO_URING_NET_BUFS; i++) {
+		struct io_uring_buf *buf = &br->bufs[br_tail & (IO_URING_NET_BUFS - 1)];
+
+		buf->addr = (uintptr_t)stress_io_buf_get(&net->pool, (size_t)i);
+		buf->len = (uint32_t)net->msg_size;
+		buf->bid = (uint16_t)i;
+		br_tail++;
+	}
+	shim_mb();
+	br->tail = br_tail;
+	shim_mb();
+
+	(void)memset(sends, 0, sizeof(sends));
+	for (i = 0; i < IO_URING_NET_CONNS; i++) {
+		conns[i] = -1;
+		rearm[i] = false;
+	}
+
+	/* the round ends on a timeout completion */
+	tail = *submit.sq_ring.tail;
+	ts.tv_sec = (long long)IO_URING_NET_ROUND;
+	ts.tv_nsec = (long long)((IO_URING_NET_ROUND - (double)ts.tv_sec) * STRESS_NANOSECOND);
+	sqe = stress_io_uring_net_sqe(&submit, &tail, &stats->syscalls);
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->addr = (uintptr_t)&ts;
+	sqe->len = 1;
+	sqe->user_data = IO_URING_NET_UD(IO_URING_NET_UD_TIMEOUT, 0);
+	if (tcp) {
+		sqe = stress_io_uring_net_sqe(&submit, &tail, &stats->syscalls);
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->fd = net->fd;
+		sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		sqe->user_data = IO_URING_NET_UD(IO_URING_NET_UD_ACCEPT, 0);
+	} else {
+		conns[0] = net->fd;
+		stress_io_uring_net_recv(&submit, &tail, &stats->syscalls, net->fd, 0);
+	}
+
+	cpu_start = stress_io_uring_net_cpu();
+	t_start = stress_time_now();
+	while (!done && keep_stressing(args)) {
+		unsigned head;
+		int ret;
+
+		shim_mb();
+		*submit.sq_ring.tail = tail;
+		shim_mb();
+		ret = shim_io_uring_enter(submit.io_uring_fd,
+			tail - *submit.sq_ring.head, 1, IORING_ENTER_GETEVENTS);
+		stats->syscalls++;
+		if ((ret < 0) && (errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) {
+			pr_fail("%s: io_uring_enter failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+
+		head = *cring->head;
+		for (;;) {
+			const struct io_uring_cqe *cqe;
+			uint32_t type, idx;
+
+			shim_mb();
+			if (head == *cring->tail)
+				break;
+			cqe = &cring->cqes[head & *cring->ring_mask];
+			head++;
+			type = (uint32_t)(cqe->user_data >> 32);
+			idx = (uint32_t)(cqe->user_data & 0xffffffff);
+
+			switch (type) {
+			case IO_URING_NET_UD_TIMEOUT:
+				done = true;
+				break;
+			case IO_URING_NET_UD_ACCEPT:
+				if (cqe->res >= 0) {
+					for (i = 0; i < IO_URING_NET_CONNS; i++)
+						if (conns[i] < 0)
+							break;
+					if (i == IO_URING_NET_CONNS) {
+						(void)close(cqe->res);
+					} else {
+						conns[i] = cqe->res;
+						stress_io_uring_net_recv(&submit, &tail,
+							&stats->syscalls, conns[i], (uint32_t)i);
+					}
+				} else if (cqe->res == -EINVAL) {
+					pr_inf_skip("%s: multishot accept not supported, "
+						"skipping stressor\n", args->name);
+					rc = EXIT_NOT_IMPLEMENTED;
+					done = true;
+					break;
+				}
+				if (!(cqe->flags & IORING_CQE_F_MORE)) {
+					sqe = stress_io_uring_net_sqe(&submit, &tail, &stats->syscalls);
+					sqe->opcode = IORING_OP_ACCEPT;
+					sqe->fd = net->fd;
+					sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+					sqe->user_data = IO_URING_NET_UD(IO_URING_NET_UD_ACCEPT, 0);
+				}
+				break;
+			case IO_URING_NET_UD_RECV:
+				if ((cqe->res > 0) && (cqe->flags & IORING_CQE_F_BUFFER)) {
+					const uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+					stress_io_uring_net_send_t *send = &sends[bid];
+
+					send->fd = conns[idx];
+					send->off = 0;
+					send->len = (uint32_t)cqe->res;
+					stress_io_uring_net_send(&submit, &tail,
+						&stats->syscalls, net, send, bid);
+				} else if (cqe->res == -EINVAL) {
+					pr_inf_skip("%s: multishot recv not supported, "
+						"skipping stressor\n", args->name);
+					rc = EXIT_NOT_IMPLEMENTED;
+					done = true;
+					break;
+				}
+				if (cqe->flags & IORING_CQE_F_MORE)
+					break;
+				/* run out of buffers or udp errors, rearm */
+				if (!tcp || (cqe->res == -ENOBUFS) || (cqe->res > 0)) {
+					rearm[idx] = true;
+				} else {
+					(void)close(conns[idx]);
+					conns[idx] = -1;
+				}
+				break;
+			case IO_URING_NET_UD_SEND: {
+				stress_io_uring_net_send_t *send = &sends[idx];
+
+#if defined(IORING_CQE_F_NOTIF)
+				/* the buffer is in use until the notification */
+				if (cqe->flags & IORING_CQE_F_NOTIF) {
+					send->refs--;
+				} else
+#endif
+				{
+					if (!(cqe->flags & IORING_CQE_F_MORE))
+						send->refs--;
+					if (cqe->res > 0) {
+						stats->bytes += (uint64_t)cqe->res;
+						send->off += (uint32_t)cqe->res;
+					} else if (net->send_zc &&
+						   ((cqe->res == -EOPNOTSUPP) || (cqe->res == -EINVAL))) {
+						/* no zero copy send, fall back to copying sends */
+						net->send_zc = false;
+					} else {
+						send->off = send->len;
+					}
+					if (send->off < send->len)
+						stress_io_uring_net_send(&submit, &tail,
+							&stats->syscalls, net, send, (uint16_t)idx);
+				}
+				if (!send->refs) {
+					struct io_uring_buf *buf;
+
+					buf = &br->bufs[br_tail & (IO_URING_NET_BUFS - 1)];
+					buf->addr = (uintptr_t)stress_io_buf_get(&net->pool, idx);
+					buf->len = (uint32_t)net->msg_size;
+					buf->bid = (uint16_t)idx;
+					br_tail++;
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+		*cring->head = head;
+		shim_mb();
+		br->tail = br_tail;
+		shim_mb();
+
+		for (i = 0; i < IO_URING_NET_CONNS; i++) {
+			if (rearm[i] && (conns[i] >= 0))
+				stress_io_uring_net_recv(&submit, &tail,
+					&stats->syscalls, conns[i], (uint32_t)i);
+			rearm[i] = false;
+		}
+	}
+	stats->duration += stress_time_now() - t_start;
+	stats->cpu += stress_io_uring_net_cpu() - cpu_start;
+
+	if (tcp) {
+		for (i = 0; i < IO_URING_NET_CONNS; i++) {
+			if (conns[i] >= 0)
+				(void)close(conns[i]);
+		}
+	}
+tidy:
+	/* closing the ring cancels the multishot requests */
+	stress_close_io_uring(&submit);
+	(void)munmap((void *)br, br_size);
+
+	return rc;
+}
+
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+/*
+ *  stress_io_uring_net_epoll()
+ *	run a level triggered epoll echo server round with
+ *	non-blocking recv and send, the comparison baseline
+ */
+static int stress_io_uring_net_epoll(
+	const stress_args_t *args,
+	const stress_io_uring_net_t *net,
+	stress_io_uring_net_stats_t *stats)
+{
+	struct epoll_event ev, events[IO_URING_NET_CONNS];
+	int conns[IO_URING_NET_CONNS];
+	uint8_t *buf = stress_io_buf_get(&net->pool, 0);
+	const bool tcp = (net->proto == IPPROTO_TCP);
+	double t_start, t_end, cpu_start;
+	int efd, i, nconns = 0;
+
+	efd = epoll_create1(0);
+	if (efd < 0) {
+		pr_fail("%s: epoll_create1 failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	(void)memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = net->fd;
+	if (epoll_ctl(efd, EPOLL_CTL_ADD, net->fd, &ev) < 0) {
+		pr_fail("%s: epoll_ctl failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(efd);
+		return EXIT_FAILURE;
+	}
+
+	cpu_start = stress_io_uring_net_cpu();
+	t_start = stress_time_now();
+	t_end = t_start + IO_URING_NET_ROUND;
+	while (keep_stressing(args) && (stress_time_now() < t_end)) {
+		const int n = epoll_wait(efd, events, IO_URING_NET_CONNS, 10);
+
+		stats->syscalls++;
+		for (i = 0; i < n; i++) {
+			const int fd = events[i].data.fd;
+			ssize_t ret;
+
+			if (tcp && (fd == net->fd)) {
+				const int sfd = accept(net->fd, NULL, NULL);
+
+				if (sfd < 0)
+					continue;
+				ev.data.fd = sfd;
+				if ((nconns == IO_URING_NET_CONNS) ||
+				    (epoll_ctl(efd, EPOLL_CTL_ADD, sfd, &ev) < 0)) {
+					(void)close(sfd);
+					continue;
+				}
+				conns[nconns++] = sfd;
+				continue;
+			}
+			while ((ret = recv(fd, buf, net->msg_size, MSG_DONTWAIT)) > 0) {
+				ssize_t j, sent;
+
+				for (j = 0; j < ret; j += sent) {
+					sent = send(fd, buf + j, (size_t)(ret - j), MSG_NOSIGNAL);
+					if (sent <= 0)
+						break;
+					stats->bytes += (uint64_t)sent;
+				}
+				if (tcp)
+					break;
+			}
+			if (tcp && ((ret == 0) || ((ret < 0) && (errno != EAGAIN) && (errno != EINTR)))) {
+				int j;
+
+				for (j = 0; j < nconns; j++) {
+					if (conns[j] == fd) {
+						conns[j] = conns[--nconns];
+						break;
+					}
+				}
+				(void)close(fd);
+			}
+		}
+	}
+	stats->duration += stress_time_now() - t_start;
+	stats->cpu += stress_io_uring_net_cpu() - cpu_start;
+
+	for (i = 0; i < nconns; i++)
+		(void)close(conns[i]);
+	(void)close(efd);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
+/*
+ *  stress_io_uring_net()
+ *	echo loopback tcp or udp messages from a client process,
+ *	alternating between io_uring and epoll servers every round
+ */
+static int stress_io_uring_net(
+	const stress_args_t *args,
+	const int proto,
+	const size_t msg_size)
+{
+	static const char * const engines[] = { "io_uring", "epoll" };
+	stress_io_uring_net_stats_t stats[IO_URING_NET_ENGINES];
+	stress_io_uring_net_t net;
+	const int port = DEFAULT_IO_URING_NET_PORT + (2 * (int)args->instance);
+	const char *proto_name = (proto == IPPROTO_TCP) ? "tcp" : "udp";
+	int one = 1, status, rc = EXIT_SUCCESS;
+	uint32_t round;
+	size_t i;
+	pid_t pid;
+
+	(void)memset(&net, 0, sizeof(net));
+	net.proto = proto;
+	net.msg_size = msg_size;
+#if defined(HAVE_IORING_OP_SEND_ZC) &&	\
+    defined(IORING_CQE_F_NOTIF)
+	net.send_zc = true;
+#endif
+	net.server_addr.sin_family = AF_INET;
+	net.server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	net.server_addr.sin_port = htons(port);
+	net.client_addr = net.server_addr;
+	net.client_addr.sin_port = htons(port + 1);
+
+	if (stress_io_buf_pool_alloc(args, &net.pool, NULL, msg_size, IO_URING_NET_BUFS, 0) < 0) {
+		pr_inf_skip("%s: cannot allocate %d message buffers, skipping stressor\n",
+			args->name, IO_URING_NET_BUFS);
+		return EXIT_NO_RESOURCE;
+	}
+
+	net.fd = socket(AF_INET, (proto == IPPROTO_TCP) ? SOCK_STREAM : SOCK_DGRAM, proto);
+	if (net.fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_pool;
+	}
+	(void)setsockopt(net.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(net.fd, (struct sockaddr *)&net.server_addr, sizeof(net.server_addr)) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind to port %d failed, errno=%d (%s)\n",
+			args->name, port, errno, strerror(errno));
+		goto close_fd;
+	}
+	if (((proto == IPPROTO_TCP) && (listen(net.fd, IO_URING_NET_CONNS) < 0)) ||
+	    ((proto == IPPROTO_UDP) && (connect(net.fd,
+		(struct sockaddr *)&net.client_addr, sizeof(net.client_addr)) < 0))) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: %s failed, errno=%d (%s)\n", args->name,
+			(proto == IPPROTO_TCP) ? "listen" : "connect",
+			errno, strerror(errno));
+		goto close_fd;
+	}
+	/* the epoll server accepts until EAGAIN */
+	(void)fcntl(net.fd, F_SETFL, fcntl(net.fd, F_GETFL) | O_NONBLOCK);
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (keep_stressing_flag() && (errno == EAGAIN))
+			goto again;
+		rc = EXIT_FAILURE;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_fd;
+	} else if (pid == 0) {
+		(void)close(net.fd);
+		stress_io_uring_net_client(args, &net);
+		_exit(EXIT_SUCCESS);
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	for (round = 0; keep_stressing(args); round++) {
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+		const size_t engine = round & 1;
+#else
+		const size_t engine = IO_URING_NET_ENGINE_URING;
+#endif
+		const uint64_t bytes = stats[engine].bytes;
+
+		if (engine == IO_URING_NET_ENGINE_URING)
+			rc = stress_io_uring_net_uring(args, &net, &stats[engine]);
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+		else
+			rc = stress_io_uring_net_epoll(args, &net, &stats[engine]);
+#endif
+		add_counter(args, (stats[engine].bytes - bytes) / msg_size);
+		if (rc != EXIT_SUCCESS)
+			break;
+	}
+
+	(void)kill(pid, SIGKILL);
+	(void)shim_waitpid(pid, &status, 0);
+
+	if (rc == EXIT_SUCCESS) {
+		double rate[IO_URING_NET_ENGINES];
+
+		for (i = 0; i < IO_URING_NET_ENGINES; i++) {
+			const double msgs = (double)(stats[i].bytes / msg_size);
+
+			rate[i] = 0.0;
+			if ((stats[i].duration <= 0.0) || (msgs <= 0.0))
+				continue;
+			rate[i] = msgs / stats[i].duration;
+			if (args->instance == 0)
+				pr_inf("%s: %s %s echo, %zu byte messages%s: %.0f msgs/s, "
+					"%.2f usec CPU per msg, %.3f syscalls per msg\n",
+					args->name, engines[i], proto_name, msg_size,
+					((i == IO_URING_NET_ENGINE_URING) && net.send_zc) ? ", zero copy send" : "",
+					rate[i], (stats[i].cpu * 1000000.0) / msgs,
+					(double)stats[i].syscalls / msgs);
+			stress_misc_stats_set(args->misc_stats, (int)(i * 2),
+				i ? "epoll msgs per sec" : "io_uring msgs per sec", rate[i]);
+			stress_misc_stats_set(args->misc_stats, (int)(i * 2) + 1,
+				i ? "epoll CPU usec per msg" : "io_uring CPU usec per msg",
+				(stats[i].cpu * 1000000.0) / msgs);
+		}
+		if (rate[IO_URING_NET_ENGINE_EPOLL] > 0.0)
+			stress_misc_stats_set(args->misc_stats, 4, "io_uring/epoll msgs/s ratio",
+				rate[IO_URING_NET_ENGINE_URING] / rate[IO_URING_NET_ENGINE_EPOLL]);
+	}
+
+close_fd:
+	(void)close(net.fd);
+free_pool:
+	stress_io_buf_pool_free(&net.pool);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_io_uring
  *	stress asynchronous I/O
@@ -731,6 +1956,79 @@ static int stress_io_uring(const stress_args_t *args)
 	stress_io_uring_submit_t submit;
 	const pid_t self = getpid();
 	bool supported[SIZEOF_ARRAY(stress_io_uring_setups)];
+	stress_io_uring_deep_opts_t opts;
+	int32_t io_uring_sqpoll_cpu = -1;
+	unsigned setup_flags = 0;
+	int open_flags = O_CREAT | O_RDWR | O_DSYNC;
+	int io_uring_net = 0;
+	size_t io_uring_net_size = DEFAULT_IO_URING_NET_SIZE;
+	bool deep;
+
+	(void)memset(&opts, 0, sizeof(opts));
+	opts.depth = DEFAULT_IO_URING_DEPTH;
+	opts.batch = DEFAULT_IO_URING_BATCH;
+	opts.blocks = blocks;
+	opts.block_size = block_size;
+	(void)stress_get_setting("io-uring-depth", &opts.depth);
+	(void)stress_get_setting("io-uring-batch", &opts.batch);
+	(void)stress_get_setting("io-uring-fixed", &opts.fixed);
+	(void)stress_get_setting("io-uring-iopoll", &opts.iopoll);
+	(void)stress_get_setting("io-uring-sqpoll", &opts.sqpoll);
+	(void)stress_get_setting("io-uring-sqpoll-cpu", &io_uring_sqpoll_cpu);
+	(void)stress_get_setting("io-uring-net", &io_uring_net);
+	(void)stress_get_setting("io-uring-net-size", &io_uring_net_size);
+	if (io_uring_net) {
+#if defined(STRESS_IO_URING_NET)
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_io_uring_net(args, io_uring_net, io_uring_net_size);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+#else
+		pr_inf_skip("%s: io-uring-net requires multishot accept and recv "
+			"support, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+	if (opts.batch > opts.depth) {
+		if (args->instance == 0)
+			pr_inf("%s: io-uring-batch %" PRIu32 " is larger than "
+				"io-uring-depth, using a batch of %" PRIu32 "\n",
+				args->name, opts.batch, opts.depth);
+		opts.batch = opts.depth;
+	}
+	if ((io_uring_sqpoll_cpu >= 0) && !opts.sqpoll) {
+		if (args->instance == 0)
+			pr_inf("%s: io-uring-sqpoll-cpu requires io-uring-sqpoll, "
+				"ignoring it\n", args->name);
+		io_uring_sqpoll_cpu = -1;
+	}
+
+	/*
+	 *  Deep queue, polled and registered resource modes
+	 *  just do block reads and writes
+	 */
+	deep = (opts.depth > 1) || opts.sqpoll || opts.iopoll || opts.fixed;
+#if defined(IORING_SETUP_SQPOLL)
+	if (opts.sqpoll)
+		setup_flags |= IORING_SETUP_SQPOLL;
+#endif
+#if defined(IORING_SETUP_IOPOLL) &&	\
+    defined(O_DIRECT)
+	if (opts.iopoll) {
+		/* polled I/O needs O_DIRECT and aligned blocks */
+		setup_flags |= IORING_SETUP_IOPOLL;
+		open_flags |= O_DIRECT;
+		opts.block_size = STRESS_MAXIMUM(block_size, (size_t)args->page_size);
+		opts.blocks = (size_t)file_size / opts.block_size;
+	}
+#else
+	if (opts.iopoll) {
+		pr_inf_skip("%s: polled I/O not supported, skipping stressor\n",
+			args->name);
+		stress_io_uring_unmap_iovecs(&io_uring_file);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
 
 	(void)memset(&submit, 0, sizeof(submit));
 	(void)memset(&io_uring_file, 0, sizeof(io_uring_file));
@@ -777,11 +2075,19 @@ static int stress_io_uring(const stress_args_t *args)
 
 	io_uring_file.filename = filename;
 
-	rc = stress_setup_io_uring(args, &submit);
+	rc = stress_setup_io_uring(args, &submit,
+		STRESS_MAXIMUM(IO_URING_ENTRIES, opts.depth),
+		setup_flags, (int)io_uring_sqpoll_cpu);
 	if (rc != EXIT_SUCCESS)
 		goto clean;
 
-	if ((io_uring_file.fd = open(filename, O_CREAT | O_RDWR | O_DSYNC, S_IRUSR | S_IWUSR)) < 0) {
+	if ((io_uring_file.fd = open(filename, open_flags, S_IRUSR | S_IWUSR)) < 0) {
+		if (opts.iopoll && (errno == EINVAL)) {
+			pr_inf_skip("%s: cannot open %s with O_DIRECT for polled I/O, "
+				"skipping stressor\n", args->name, filename);
+			rc = EXIT_NO_RESOURCE;
+			goto clean;
+		}
 		rc = stress_exit_status(errno);
 		pr_fail("%s: open on %s failed, errno=%d (%s)\n",
 			args->name, filename, errno, strerror(errno));
@@ -791,11 +2097,16 @@ static int stress_io_uring(const stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (deep) {
+		rc = stress_io_uring_deep(args, &submit, io_uring_file.fd, &opts);
+		goto close_file;
+	}
+
 	/*
 	 *  Assume all opcodes are supported
 	 */
 	for (j = 0; j < SIZEOF_ARRAY(stress_io_uring_setups); j++) {
-		supported[i] = true;
+		supported[j] = true;
 	}
 
 	rc = EXIT_SUCCESS;
@@ -817,6 +2128,7 @@ static int stress_io_uring(const stress_args_t *args)
 		}
 	} while (keep_stressing(args));
 
+close_file:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	(void)close(io_uring_file.fd);
 clean:
@@ -830,6 +2142,7 @@ clean:
 stressor_info_t stress_io_uring_info = {
 	.stressor = stress_io_uring,
 	.class = CLASS_IO | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -837,6 +2150,7 @@ stressor_info_t stress_io_uring_info = {
 stressor_info_t stress_io_uring_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_IO | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
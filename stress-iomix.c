@@ -18,11 +18,17 @@
  *
  */
 #include "stress-ng.h"
+#include "core-cgroup.h"
+#include "core-io-buf.h"
+#include "core-io-priority.h"
 #include "core-put.h"
 
 #if defined(HAVE_LINUX_FS_H)
 #include <linux/fs.h>
 #endif
+#if defined(HAVE_SYS_SYSMACROS_H)
+#include <sys/sysmacros.h>
+#endif
 #if defined(HAVE_SYS_SENDFILE_H)
 #include <sys/sendfile.h>
 #endif
@@ -31,16 +37,51 @@
 #define MAX_IOMIX_BYTES		(MAX_FILE_LIMIT)
 #define DEFAULT_IOMIX_BYTES	(1 * GB)
 
+#define IOMIX_BUF_SIZE		(512)
+
+#define MIN_IOMIX_ISOLATION_WRITERS	(1)
+#define MAX_IOMIX_ISOLATION_WRITERS	(64)
+#define DEFAULT_IOMIX_ISOLATION_WRITERS	(2)
+
+#define IOMIX_ISOLATION_FG_BYTES	(64 * MB)	/* random read file size */
+#define IOMIX_ISOLATION_READ_SIZE	(4 * KB)
+#define IOMIX_ISOLATION_WRITE_SIZE	(1 * MB)
+#define IOMIX_ISOLATION_SYNC_BYTES	(16 * MB)	/* writers fdatasync this often */
+#define IOMIX_ISOLATION_WINDOW		(2.0)		/* seconds measured per phase */
+#define IOMIX_ISOLATION_WARMUP		(0.5)		/* seconds of writing before measuring */
+#define IOMIX_ISOLATION_SAMPLES		(256 * 1024)
+#define IOMIX_ISOLATION_MIN_TARGET_US	(50)		/* lowest io.latency target */
+
 typedef void (*stress_iomix_func)(const stress_args_t *args, const int fd, const char *fs_type, const off_t iomix_bytes);
 
 static const stress_help_t help[] = {
 	{ NULL,	"iomix N",	 "start N workers that have a mix of I/O operations" },
 	{ NULL,	"iomix-bytes N", "write N bytes per iomix worker (default is 1GB)" },
 	{ NULL,	"iomix-ops N",	 "stop iomix workers after N iomix bogo operations" },
+	{ NULL,	"iomix-isolation", "measure random read latency next to low priority writers" },
+	{ NULL,	"iomix-isolation-writers N", "run N background writers (default is 2)" },
 	{ NULL, NULL,		 NULL }
 };
 
+/* a foreground and background priority and placement to measure */
+typedef struct {
+	const char *what;	/* phase name */
+	bool writers;		/* run the background writers */
+	int fg_class;		/* foreground ioprio class, UNDEFINED = inherit */
+	int bg_class;		/* background ioprio class, UNDEFINED = inherit */
+	bool cgroup;		/* place fg and bg in weighted cgroups */
+} stress_iomix_phase_t;
+
+/* foreground random reader results, shared with the reader process */
+typedef struct {
+	uint64_t reads;		/* reads completed */
+	size_t n;		/* latencies recorded */
+	bool rt_failed;		/* realtime class denied, used best effort 0 */
+	uint64_t latencies[IOMIX_ISOLATION_SAMPLES];	/* read latencies in ns */
+} stress_iomix_isolation_t;
+
 static void *counter_lock;
+static char *iomix_buf;		/* this worker's slot of the shared buffer pool */
 
 static int stress_set_iomix_bytes(const char *opt)
 {
@@ -52,6 +93,21 @@ static int stress_set_iomix_bytes(const char *opt)
 	return stress_set_setting("iomix-bytes", TYPE_ID_OFF_T, &iomix_bytes);
 }
 
+static int stress_set_iomix_isolation(const char *opt)
+{
+	return stress_set_setting_true("iomix-isolation", opt);
+}
+
+static int stress_set_iomix_isolation_writers(const char *opt)
+{
+	uint32_t iomix_isolation_writers;
+
+	iomix_isolation_writers = stress_get_uint32(opt);
+	stress_check_range("iomix-isolation-writers", (uint64_t)iomix_isolation_writers,
+		MIN_IOMIX_ISOLATION_WRITERS, MAX_IOMIX_ISOLATION_WRITERS);
+	return stress_set_setting("iomix-isolation-writers", TYPE_ID_UINT32, &iomix_isolation_writers);
+}
+
 /*
  *  stress_iomix_rnd_offset()
  *	generate a random offset between 0..max-1
@@ -160,9 +216,9 @@ static void stress_iomix_wr_seq_bursts(
 		UNEXPECTED
 #endif
 		for (i = 0; (i < n) && (posn < iomix_bytes); i++) {
-			char buffer[512];
+			char *buffer = iomix_buf;
 			ssize_t rc;
-			const size_t len = 1 + (stress_mwc32() & (sizeof(buffer) - 1));
+			const size_t len = 1 + (stress_mwc32() & (IOMIX_BUF_SIZE - 1));
 
 			stress_strnrnd(buffer, len);
 
@@ -205,9 +261,9 @@ static void stress_iomix_wr_rnd_bursts(
 		int i;
 
 		for (i = 0; i < n; i++) {
-			char buffer[512];
+			char *buffer = iomix_buf;
 			ssize_t rc;
-			const size_t len = 1 + (stress_mwc32() & (sizeof(buffer) - 1));
+			const size_t len = 1 + (stress_mwc32() & (IOMIX_BUF_SIZE - 1));
 			off_t ret, posn;
 
 			posn = stress_iomix_rnd_offset(iomix_bytes);
@@ -262,9 +318,9 @@ static void stress_iomix_wr_seq_slow(
 		UNEXPECTED
 #endif
 		while (posn < iomix_bytes) {
-			char buffer[512];
+			char *buffer = iomix_buf;
 			ssize_t rc;
-			const size_t len = 1 + (stress_mwc32() & (sizeof(buffer) - 1));
+			const size_t len = 1 + (stress_mwc32() & (IOMIX_BUF_SIZE - 1));
 
 			stress_strnrnd(buffer, len);
 
@@ -316,9 +372,9 @@ static void stress_iomix_rd_seq_bursts(
 		UNEXPECTED
 #endif
 		for (i = 0; (i < n) && (posn < iomix_bytes); i++) {
-			char buffer[512];
+			char *buffer = iomix_buf;
 			ssize_t rc;
-			const size_t len = 1 + (stress_mwc32() & (sizeof(buffer) - 1));
+			const size_t len = 1 + (stress_mwc32() & (IOMIX_BUF_SIZE - 1));
 
 			rc = read(fd, buffer, len);
 			if (rc < 0) {
@@ -352,9 +408,9 @@ static void stress_iomix_rd_rnd_bursts(
 		int i;
 
 		for (i = 0; i < n; i++) {
-			char buffer[512];
+			char *buffer = iomix_buf;
 			ssize_t rc;
-			const size_t len = 1 + (stress_mwc32() & (sizeof(buffer) - 1));
+			const size_t len = 1 + (stress_mwc32() & (IOMIX_BUF_SIZE - 1));
 			off_t ret, posn;
 
 			posn = stress_iomix_rnd_offset(iomix_bytes);
@@ -409,9 +465,9 @@ static void stress_iomix_rd_seq_slow(
 		UNEXPECTED
 #endif
 		while (posn < iomix_bytes) {
-			char buffer[512];
+			char *buffer = iomix_buf;
 			ssize_t rc;
-			const size_t len = 1 + (stress_mwc32() & (sizeof(buffer) - 1));
+			const size_t len = 1 + (stress_mwc32() & (IOMIX_BUF_SIZE - 1));
 
 			/* Add some unhelpful advice */
 			stress_iomix_fadvise_random_dontneed(fd, posn, (ssize_t)len);
@@ -946,6 +1002,505 @@ static stress_iomix_func iomix_funcs[] = {
 #endif
 };
 
+/*
+ *  stress_iomix_isolation_ioprio()
+ *	set the I/O priority class of the calling process at the
+ *	highest level of the class, returns false if realtime was
+ *	denied and best effort was used instead
+ */
+static bool stress_iomix_isolation_ioprio(const int class)
+{
+	if (class == UNDEFINED)
+		return true;
+	if (shim_ioprio_set(IOPRIO_WHO_PROCESS, 0, IOPRIO_PRIO_VALUE(class, 0)) == 0)
+		return true;
+	if (class == IOPRIO_CLASS_RT) {
+		(void)shim_ioprio_set(IOPRIO_WHO_PROCESS, 0,
+			IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 0));
+		return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_iomix_isolation_reader()
+ *	latency sensitive foreground, random reads that
+ *	miss the page cache for the measurement window
+ */
+static void NORETURN stress_iomix_isolation_reader(
+	const int fd,
+	const bool direct,
+	const off_t size,
+	const stress_iomix_phase_t *phase,
+	const char *cgroup,
+	uint8_t *buf,
+	stress_iomix_isolation_t *isolation)
+{
+	const uint64_t blocks = (uint64_t)size / IOMIX_ISOLATION_READ_SIZE;
+	double end;
+
+	(void)sched_settings_apply(true);
+	if (!stress_iomix_isolation_ioprio(phase->fg_class))
+		isolation->rt_failed = true;
+	if (phase->cgroup)
+		(void)stress_cgroup_write(cgroup, "cgroup.procs", "0");
+
+	end = stress_time_now() + IOMIX_ISOLATION_WINDOW;
+	while (keep_stressing_flag()) {
+		const off_t offset = (off_t)((stress_mwc64() % blocks) * IOMIX_ISOLATION_READ_SIZE);
+		double t1, t2;
+		ssize_t ret;
+
+		if (!direct)
+			stress_iomix_fadvise_random_dontneed(fd, offset, IOMIX_ISOLATION_READ_SIZE);
+		t1 = stress_time_now();
+		ret = pread(fd, buf, IOMIX_ISOLATION_READ_SIZE, offset);
+		t2 = stress_time_now();
+		if (ret < 0)
+			break;
+		isolation->reads++;
+		if (isolation->n < IOMIX_ISOLATION_SAMPLES)
+			isolation->latencies[isolation->n++] =
+				(uint64_t)((t2 - t1) * (double)STRESS_NANOSECOND);
+		if (t2 >= end)
+			break;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_iomix_isolation_writer()
+ *	background sequential writer, wraps around at the
+ *	end of the file and syncs every so often
+ */
+static void NORETURN stress_iomix_isolation_writer(
+	const int fd,
+	const off_t size,
+	const stress_iomix_phase_t *phase,
+	const char *cgroup,
+	const uint8_t *buf)
+{
+	off_t offset = 0;
+	size_t unsynced = 0;
+
+	(void)sched_settings_apply(true);
+	(void)stress_iomix_isolation_ioprio(phase->bg_class);
+	if (phase->cgroup)
+		(void)stress_cgroup_write(cgroup, "cgroup.procs", "0");
+
+	while (keep_stressing_flag()) {
+		if (pwrite(fd, buf, IOMIX_ISOLATION_WRITE_SIZE, offset) < 0)
+			break;
+		offset += IOMIX_ISOLATION_WRITE_SIZE;
+		if (offset + (off_t)IOMIX_ISOLATION_WRITE_SIZE > size)
+			offset = 0;
+		unsynced += IOMIX_ISOLATION_WRITE_SIZE;
+		if (unsynced >= IOMIX_ISOLATION_SYNC_BYTES) {
+			(void)shim_fdatasync(fd);
+			unsynced = 0;
+		}
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_iomix_isolation_phase()
+ *	start the background writers, let them get going and then
+ *	measure the foreground reader, returns false on failure
+ */
+static bool stress_iomix_isolation_phase(
+	const stress_iomix_phase_t *phase,
+	const int fg_fd,
+	const bool direct,
+	const int *bg_fds,
+	const uint32_t writers,
+	const off_t bg_bytes,
+	const char *fg_cgroup,
+	const char *bg_cgroup,
+	uint8_t *rd_buf,
+	const uint8_t *wr_buf,
+	stress_iomix_isolation_t *isolation)
+{
+	pid_t pids[MAX_IOMIX_ISOLATION_WRITERS];
+	pid_t pid;
+	uint32_t i, started = 0;
+	int status;
+
+	isolation->reads = 0;
+	isolation->n = 0;
+	isolation->rt_failed = false;
+
+	if (phase->writers) {
+		for (started = 0; started < writers; started++) {
+			pids[started] = fork();
+			if (pids[started] < 0)
+				break;
+			if (pids[started] == 0)
+				stress_iomix_isolation_writer(bg_fds[started], bg_bytes,
+					phase, bg_cgroup, wr_buf);
+		}
+		(void)shim_usleep((uint64_t)(IOMIX_ISOLATION_WARMUP * 1000000.0));
+	}
+
+	pid = fork();
+	if (pid == 0)
+		stress_iomix_isolation_reader(fg_fd, direct, IOMIX_ISOLATION_FG_BYTES,
+			phase, fg_cgroup, rd_buf, isolation);
+	if (pid > 0)
+		(void)shim_waitpid(pid, &status, 0);
+
+	for (i = 0; i < started; i++)
+		(void)kill(pids[i], SIGKILL);
+	for (i = 0; i < started; i++)
+		(void)shim_waitpid(pids[i], &status, 0);
+	/* write back what the writers left behind before the next phase */
+	for (i = 0; i < started; i++)
+		(void)shim_fsync(bg_fds[i]);
+
+	return (pid > 0) && (started == (phase->writers ? writers : 0)) && isolation->n;
+}
+
+static int stress_iomix_isolation_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_iomix_isolation_device()
+ *	find the whole disk the file is on, its I/O scheduler and
+ *	whether it is rotational, returns false if the file is not
+ *	on a block device
+ */
+static bool stress_iomix_isolation_device(
+	const int fd,
+	char *devnum,
+	const size_t devnum_len,
+	char *sched,
+	const size_t sched_len,
+	bool *rotational)
+{
+#if defined(HAVE_SYS_SYSMACROS_H)
+	struct stat statbuf;
+	char path[PATH_MAX], buf[256];
+	char *ptr, *end;
+
+	if ((fstat(fd, &statbuf) < 0) || (major(statbuf.st_dev) == 0))
+		return false;
+	(void)snprintf(path, sizeof(path), "/sys/dev/block/%u:%u",
+		major(statbuf.st_dev), minor(statbuf.st_dev));
+	(void)snprintf(devnum, devnum_len, "%u:%u",
+		major(statbuf.st_dev), minor(statbuf.st_dev));
+
+	/* cgroup I/O controls are per disk, not per partition */
+	(void)shim_strlcat(path, "/partition", sizeof(path));
+	if (access(path, R_OK) == 0) {
+		path[strlen(path) - 10] = '\0';
+		(void)shim_strlcat(path, "/..", sizeof(path));
+		(void)snprintf(buf, sizeof(buf), "%s/dev", path);
+		(void)memset(devnum, 0, devnum_len);
+		if (system_read(buf, devnum, devnum_len - 1) <= 0)
+			return false;
+		devnum[strcspn(devnum, "\n")] = '\0';
+	} else {
+		path[strlen(path) - 10] = '\0';
+	}
+
+	(void)snprintf(path, sizeof(path), "/sys/dev/block/%s/queue/scheduler", devnum);
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read(path, buf, sizeof(buf) - 1) <= 0)
+		return false;
+	/* the scheduler in use is bracketed, "[mq-deadline] kyber bfq none" */
+	ptr = strchr(buf, '[');
+	end = ptr ? strchr(ptr, ']') : NULL;
+	if (ptr && end) {
+		*end = '\0';
+		(void)shim_strlcpy(sched, ptr + 1, sched_len);
+	} else {
+		buf[strcspn(buf, " \n")] = '\0';
+		(void)shim_strlcpy(sched, buf, sched_len);
+	}
+
+	(void)snprintf(path, sizeof(path), "/sys/dev/block/%s/queue/rotational", devnum);
+	(void)memset(buf, 0, sizeof(buf));
+	*rotational = (system_read(path, buf, sizeof(buf) - 1) > 0) && (buf[0] == '1');
+	return true;
+#else
+	(void)fd;
+	(void)devnum;
+	(void)devnum_len;
+	(void)sched;
+	(void)sched_len;
+	(void)rotational;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_iomix_isolation_cgroup()
+ *	create a stress-ng-iomix-$pid cgroup at the top of the
+ *	cgroup v2 hierarchy with heavily weighted fg and lightly
+ *	weighted bg groups, fg gets an io.latency target on the
+ *	disk, returns the controls that could be set or NULL if
+ *	there are none
+ */
+static const char *stress_iomix_isolation_cgroup(
+	const char *devnum,
+	const uint64_t target_us,
+	char *top,
+	char *fg,
+	char *bg,
+	const size_t len,
+	char *controls,
+	const size_t controls_len)
+{
+	char mnt[256], value[64];
+
+	*controls = '\0';
+	if (stress_cgroup_mount(mnt, sizeof(mnt)) < 0)
+		return NULL;
+	(void)snprintf(top, len, "%s/stress-ng-iomix-%d", mnt, (int)getpid());
+	(void)snprintf(fg, len, "%s/stress-ng-iomix-%d/fg", mnt, (int)getpid());
+	(void)snprintf(bg, len, "%s/stress-ng-iomix-%d/bg", mnt, (int)getpid());
+	if ((mkdir(top, S_IRWXU) < 0) && (errno != EEXIST))
+		return NULL;
+	/* the root group may have processes and still enable controllers */
+	(void)stress_cgroup_write(mnt, "cgroup.subtree_control", "+io");
+	if ((stress_cgroup_write(top, "cgroup.subtree_control", "+io") < 0) ||
+	    ((mkdir(fg, S_IRWXU) < 0) && (errno != EEXIST)) ||
+	    ((mkdir(bg, S_IRWXU) < 0) && (errno != EEXIST)))
+		goto tidy;
+
+	/* io.weight needs io.cost, io.bfq.weight needs the bfq scheduler */
+	if ((stress_cgroup_write(fg, "io.weight", "default 10000") == 0) &&
+	    (stress_cgroup_write(bg, "io.weight", "default 1") == 0))
+		(void)shim_strlcat(controls, " io.weight", controls_len);
+	if ((stress_cgroup_write(fg, "io.bfq.weight", "1000") == 0) &&
+	    (stress_cgroup_write(bg, "io.bfq.weight", "1") == 0))
+		(void)shim_strlcat(controls, " io.bfq.weight", controls_len);
+	if (*devnum) {
+		(void)snprintf(value, sizeof(value), "%s target=%" PRIu64, devnum, target_us);
+		if (stress_cgroup_write(fg, "io.latency", value) == 0)
+			(void)shim_strlcat(controls, " io.latency", controls_len);
+	}
+	if (*controls)
+		return controls + 1;
+tidy:
+	(void)rmdir(fg);
+	(void)rmdir(bg);
+	(void)rmdir(top);
+	return NULL;
+}
+
+/*
+ *  stress_iomix_isolation()
+ *	measure how well I/O priorities and cgroup I/O controls
+ *	isolate a latency sensitive random reader from background
+ *	sequential writers, comparing the reader latency with the
+ *	writers at the same priority, with the reader at realtime
+ *	and the writers at idle I/O priority and with the reader
+ *	and writers in weighted cgroups against the reader alone
+ */
+static int stress_iomix_isolation(const stress_args_t *args, const off_t iomix_bytes)
+{
+	static const stress_iomix_phase_t phases[] = {
+		{ "solo",	false,	UNDEFINED,		UNDEFINED,		false },
+		{ "contended",	true,	UNDEFINED,		UNDEFINED,		false },
+		{ "ioprio",	true,	IOPRIO_CLASS_RT,	IOPRIO_CLASS_IDLE,	false },
+		{ "cgroup",	true,	UNDEFINED,		UNDEFINED,		true },
+	};
+	uint32_t writers = DEFAULT_IOMIX_ISOLATION_WRITERS;
+	int bg_fds[MAX_IOMIX_ISOLATION_WRITERS];
+	int fd, fg_fd = -1, ret, flags = O_RDONLY;
+	uint32_t i, opened = 0;
+	off_t bg_bytes, offset;
+	char filename[PATH_MAX], devnum[32], sched[32];
+	char cg_top[PATH_MAX / 2], cg_fg[PATH_MAX / 2], cg_bg[PATH_MAX / 2], controls[64];
+	const char *cgroup_controls = NULL;
+	stress_iomix_isolation_t *isolation;
+	uint8_t *rd_buf, *wr_buf;
+	double solo_p99 = 0.0;
+	bool direct = false, rotational = false, device;
+	size_t j;
+
+	if (args->instance != 0)
+		goto idle;
+
+	(void)stress_get_setting("iomix-isolation-writers", &writers);
+	bg_bytes = iomix_bytes / (off_t)writers;
+	if (bg_bytes < (off_t)(IOMIX_ISOLATION_WRITE_SIZE * 2))
+		bg_bytes = (off_t)(IOMIX_ISOLATION_WRITE_SIZE * 2);
+
+	isolation = (stress_iomix_isolation_t *)mmap(NULL, sizeof(*isolation),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (isolation == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap latency samples, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	/* page aligned for O_DIRECT */
+	rd_buf = (uint8_t *)mmap(NULL, IOMIX_ISOLATION_READ_SIZE + IOMIX_ISOLATION_WRITE_SIZE,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (rd_buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap I/O buffers, skipping stressor\n", args->name);
+		(void)munmap((void *)isolation, sizeof(*isolation));
+		return EXIT_NO_RESOURCE;
+	}
+	wr_buf = rd_buf + IOMIX_ISOLATION_READ_SIZE;
+	stress_uint8rnd4(wr_buf, IOMIX_ISOLATION_WRITE_SIZE);
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		ret = stress_exit_status(-ret);
+		goto tidy_mmap;
+	}
+
+	/* the foreground file, written so reads are of real blocks */
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		ret = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto tidy_dir;
+	}
+	for (offset = 0; keep_stressing(args) && (offset < (off_t)IOMIX_ISOLATION_FG_BYTES);
+	     offset += IOMIX_ISOLATION_WRITE_SIZE) {
+		if (pwrite(fd, wr_buf, IOMIX_ISOLATION_WRITE_SIZE, offset) < 0) {
+			ret = (errno == ENOSPC) ? EXIT_NO_RESOURCE : EXIT_FAILURE;
+			if (ret == EXIT_FAILURE)
+				pr_fail("%s: write failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			(void)close(fd);
+			(void)shim_unlink(filename);
+			goto tidy_dir;
+		}
+	}
+	(void)shim_fsync(fd);
+#if defined(O_DIRECT)
+	fg_fd = open(filename, O_RDONLY | O_DIRECT);
+	direct = (fg_fd >= 0);
+#endif
+	if (fg_fd < 0)
+		fg_fd = open(filename, flags);
+	device = stress_iomix_isolation_device(fd, devnum, sizeof(devnum),
+		sched, sizeof(sched), &rotational);
+	(void)close(fd);
+	(void)shim_unlink(filename);
+	if (fg_fd < 0) {
+		ret = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto tidy_dir;
+	}
+
+	for (opened = 0; opened < writers; opened++) {
+		(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+		bg_fds[opened] = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+		if (bg_fds[opened] < 0)
+			break;
+		(void)shim_unlink(filename);
+	}
+	if (opened < writers) {
+		ret = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto tidy_fds;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	if (device) {
+		pr_inf("%s: device %s, %s, scheduler %s, %s 4K random reads, "
+			"%" PRIu32 " sequential writers\n", args->name, devnum,
+			rotational ? "rotational" : "non-rotational", sched,
+			direct ? "O_DIRECT" : "buffered", writers);
+	} else {
+		*devnum = '\0';
+		pr_inf("%s: no block device found for the temporary files, "
+			"latencies may be of the page cache rather than a device\n", args->name);
+	}
+	pr_inf("%s: %-10s %10s %9s %9s %9s %10s %10s\n", args->name,
+		"phase", "reads/s", "p50 us", "p99 us", "p99.9 us", "max us", "p99 x solo");
+
+	for (j = 0; keep_stressing(args) && (j < SIZEOF_ARRAY(phases)); j++) {
+		const stress_iomix_phase_t *phase = &phases[j];
+		double p50, p99, p999, max;
+		size_t n;
+		char desc[32];
+
+		if (phase->cgroup) {
+			/* protect the reader at its solo p99 latency */
+			const uint64_t target_us = STRESS_MAXIMUM((uint64_t)solo_p99,
+				IOMIX_ISOLATION_MIN_TARGET_US);
+
+			cgroup_controls = stress_iomix_isolation_cgroup(devnum, target_us,
+				cg_top, cg_fg, cg_bg, sizeof(cg_top), controls, sizeof(controls));
+			if (!cgroup_controls) {
+				pr_inf("%s: %-10s no cgroup v2 I/O controls available, skipped\n",
+					args->name, phase->what);
+				continue;
+			}
+		}
+		if (!stress_iomix_isolation_phase(phase, fg_fd, direct, bg_fds, writers,
+				bg_bytes, cg_fg, cg_bg, rd_buf, wr_buf, isolation)) {
+			pr_inf("%s: %-10s %10s %9s %9s %9s %10s %10s\n", args->name,
+				phase->what, "failed", "-", "-", "-", "-", "-");
+			continue;
+		}
+		add_counter(args, isolation->reads);
+
+		n = isolation->n;
+		qsort(isolation->latencies, n, sizeof(*isolation->latencies),
+			stress_iomix_isolation_cmp);
+		p50 = (double)isolation->latencies[n / 2] / 1000.0;
+		p99 = (double)isolation->latencies[(n * 99) / 100] / 1000.0;
+		p999 = (double)isolation->latencies[(n * 999) / 1000] / 1000.0;
+		max = (double)isolation->latencies[n - 1] / 1000.0;
+		if (!phase->writers)
+			solo_p99 = p99;
+
+		pr_inf("%s: %-10s %10.0f %9.1f %9.1f %9.1f %10.1f %10.2f\n", args->name,
+			phase->what, (double)isolation->reads / IOMIX_ISOLATION_WINDOW,
+			p50, p99, p999, max, (solo_p99 > 0.0) ? p99 / solo_p99 : 0.0);
+		if (isolation->rt_failed)
+			pr_inf("%s: %-10s realtime I/O priority denied, reader used best effort 0\n",
+				args->name, phase->what);
+		if (phase->cgroup)
+			pr_inf("%s: %-10s cgroup controls: %s\n", args->name,
+				phase->what, cgroup_controls);
+		(void)snprintf(desc, sizeof(desc), "%s read p99 us", phase->what);
+		stress_misc_stats_set(args->misc_stats, j, desc, p99);
+	}
+
+	if (cgroup_controls) {
+		(void)rmdir(cg_fg);
+		(void)rmdir(cg_bg);
+		(void)rmdir(cg_top);
+	}
+	ret = EXIT_SUCCESS;
+
+tidy_fds:
+	for (i = 0; i < opened; i++)
+		(void)close(bg_fds[i]);
+	(void)close(fg_fd);
+tidy_dir:
+	(void)stress_temp_dir_rm_args(args);
+tidy_mmap:
+	(void)munmap((void *)rd_buf, IOMIX_ISOLATION_READ_SIZE + IOMIX_ISOLATION_WRITE_SIZE);
+	(void)munmap((void *)isolation, sizeof(*isolation));
+	if (ret != EXIT_SUCCESS)
+		return ret;
+
+idle:
+	while (keep_stressing(args))
+		(void)shim_usleep(100000);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_iomix
  *	stress I/O via random mix of io ops
@@ -958,13 +1513,16 @@ static int stress_iomix(const stress_args_t *args)
 	const size_t page_size = args->page_size;
 	size_t i;
 	int pids[SIZEOF_ARRAY(iomix_funcs)];
+	stress_io_buf_pool_t pool;
 	const char *fs_type;
 	int oflags = O_CREAT | O_RDWR;
 	const pid_t parent = getpid();
+	bool iomix_isolation = false;
 
 #if defined(O_SYNC)
 	oflags |= O_SYNC;
 #endif
+	(void)memset(&pool, 0, sizeof(pool));
 
 	counter_lock = stress_lock_create();
 	if (!counter_lock) {
@@ -984,6 +1542,12 @@ static int stress_iomix(const stress_args_t *args)
 	if (iomix_bytes < (off_t)page_size)
 		iomix_bytes = (off_t)page_size;
 
+	(void)stress_get_setting("iomix-isolation", &iomix_isolation);
+	if (iomix_isolation) {
+		ret = stress_iomix_isolation(args, iomix_bytes);
+		goto lock_destroy;
+	}
+
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0) {
 		ret = stress_exit_status(-ret);
@@ -1017,6 +1581,16 @@ static int stress_iomix(const stress_args_t *args)
 		goto tidy;
 	}
 
+	/* one buffer per worker, shared so the workers need no copies */
+	(void)stress_temp_dir_args(args, filename, sizeof(filename));
+	if (stress_io_buf_pool_alloc(args, &pool, filename, IOMIX_BUF_SIZE,
+			SIZEOF_ARRAY(iomix_funcs), STRESS_IO_BUF_SHARED) < 0) {
+		pr_inf_skip("%s: cannot allocate I/O buffers, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		ret = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
 	(void)memset(pids, 0, sizeof(pids));
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -1028,6 +1602,7 @@ static int stress_iomix(const stress_args_t *args)
 		} else if (pids[i] == 0) {
 			/* Child */
 			(void)sched_settings_apply(true);
+			iomix_buf = (char *)stress_io_buf_get(&pool, i);
 			iomix_funcs[i](args, fd, fs_type, iomix_bytes);
 			(void)kill(parent, SIGALRM);
 			_exit(EXIT_SUCCESS);
@@ -1056,6 +1631,7 @@ reap:
 
 tidy:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_io_buf_pool_free(&pool);
 	(void)close(fd);
 	(void)stress_temp_dir_rm_args(args);
 lock_destroy:
@@ -1067,6 +1643,8 @@ lock_destroy:
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_iomix_bytes,	stress_set_iomix_bytes },
+	{ OPT_iomix_isolation,	stress_set_iomix_isolation },
+	{ OPT_iomix_isolation_writers, stress_set_iomix_isolation_writers },
 	{ 0,			NULL }
 };
 
@@ -28,14 +28,32 @@
 static const stress_help_t help[] = {
 	{ NULL,	"ipsec-mb N",	  "start N workers exercising the IPSec MB encoding" },
 	{ NULL,	"ipsec-mb-ops N", "stop after N ipsec bogo encoding operations" },
+	{ NULL,	"ipsec-mb-bench", "measure GB/s per algorithm, CPU feature, size and batch" },
 	{ NULL, "ipsec-mb-feature F","specify CPU feature F" },
+	{ NULL,	"ipsec-mb-threads N", "scale the ipsec-mb bench up to N threads" },
 	{ NULL,	NULL,		  NULL }
 };
 
 static int stress_set_ipsec_mb_feature(const char *opt);
 
+static int stress_set_ipsec_mb_bench(const char *opt)
+{
+	return stress_set_setting_true("ipsec-mb-bench", opt);
+}
+
+static int stress_set_ipsec_mb_threads(const char *opt)
+{
+	uint32_t ipsec_mb_threads;
+
+	ipsec_mb_threads = stress_get_uint32(opt);
+	stress_check_range("ipsec-mb-threads", (uint64_t)ipsec_mb_threads, 1, 256);
+	return stress_set_setting("ipsec-mb-threads", TYPE_ID_UINT32, &ipsec_mb_threads);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_ipsec_mb_bench,	stress_set_ipsec_mb_bench },
 	{ OPT_ipsec_mb_feature,	stress_set_ipsec_mb_feature },
+	{ OPT_ipsec_mb_threads,	stress_set_ipsec_mb_threads },
 	{ 0,                    NULL }
 };
 
@@ -601,6 +619,488 @@ static void stress_hmac_sha512(
 	stress_job_empty(mb_mgr);
 }
 
+#define IPSEC_MB_BENCH_BYTES	(1024 * 1024)	/* bytes per timed call */
+#define IPSEC_MB_BENCH_TIME	(0.01)		/* seconds per measurement */
+#define IPSEC_MB_SCALE_TIME	(0.05)		/* seconds per scaling measurement */
+#define IPSEC_MB_SCALE_SIZE	(4096)
+#define IPSEC_MB_SCALE_JOBS	(16)
+#define IPSEC_MB_MAX_THREADS	(256)
+#define IPSEC_MB_BENCH_SIZE_MAX	(4096)		/* largest bench buffer */
+#define IPSEC_MB_BENCH_JOBS_MAX	(16)		/* largest bench batch */
+#define IPSEC_MB_BENCH_OUTPUT	(IPSEC_MB_BENCH_SIZE_MAX * IPSEC_MB_BENCH_JOBS_MAX)
+
+#define IPSEC_MB_AES_CBC	(0)
+#define IPSEC_MB_AES_CTR	(1)
+#define IPSEC_MB_AES_CMAC	(2)
+#define IPSEC_MB_SHA512		(3)
+#define IPSEC_MB_HMAC_MD5	(4)
+#define IPSEC_MB_HMAC_SHA1	(5)
+#define IPSEC_MB_HMAC_SHA512	(6)
+
+/* indexed by the IPSEC_MB_* algorithms */
+static const char * const ipsec_mb_algos[] = {
+	"aes-cbc",
+	"aes-ctr",
+	"aes-cmac",
+	"sha512",
+	"hmac-md5",
+	"hmac-sha1",
+	"hmac-sha512",
+};
+
+static const size_t ipsec_mb_sizes[] = { 64, 512, IPSEC_MB_BENCH_SIZE_MAX };
+static const int ipsec_mb_jobs[] = { 1, 4, 8, IPSEC_MB_BENCH_JOBS_MAX };
+
+#define IPSEC_MB_ALGOS	(SIZEOF_ARRAY(ipsec_mb_algos))
+#define IPSEC_MB_SIZES	(SIZEOF_ARRAY(ipsec_mb_sizes))
+#define IPSEC_MB_JOBS	(SIZEOF_ARRAY(ipsec_mb_jobs))
+
+/*
+ *  ipsec-mb-bench keys and job output, the keys are set up once per
+ *  manager rather than per call as the stressor's job helpers do so
+ *  just job submission and processing is timed
+ */
+typedef struct {
+	uint8_t iv[16] ALIGNED(16);
+	uint32_t aes_enc_keys[15 * 4] ALIGNED(16);
+	uint32_t aes_dec_keys[15 * 4] ALIGNED(16);
+	uint32_t cmac_keys[15 * 4] ALIGNED(16);
+	uint32_t cmac_skey1[4];
+	uint32_t cmac_skey2[4];
+	uint8_t hmac_ipad[20] ALIGNED(16);	/* md5 and sha1 */
+	uint8_t hmac_opad[20] ALIGNED(16);
+	uint8_t sha512_ipad[SHA512_DIGEST_SIZE_IN_BYTES] ALIGNED(16);
+	uint8_t sha512_opad[SHA512_DIGEST_SIZE_IN_BYTES] ALIGNED(16);
+	uint8_t *output;	/* IPSEC_MB_BENCH_OUTPUT bytes of job output */
+} stress_ipsec_mb_bench_t;
+
+/*
+ *  stress_ipsec_mb_bench_alloc()
+ *	allocate the bench job output, returns -1 on failure
+ */
+static int stress_ipsec_mb_bench_alloc(stress_ipsec_mb_bench_t *bench)
+{
+	bench->output = (uint8_t *)mmap(NULL, IPSEC_MB_BENCH_OUTPUT,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bench->output == MAP_FAILED) {
+		bench->output = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+static void stress_ipsec_mb_bench_free(stress_ipsec_mb_bench_t *bench)
+{
+	if (bench->output)
+		(void)munmap((void *)bench->output, IPSEC_MB_BENCH_OUTPUT);
+	bench->output = NULL;
+}
+
+/*
+ *  stress_ipsec_mb_bench_keys()
+ *	set up the bench keys with an initialised manager, keys are
+ *	derived in the same way as the job helpers derive them
+ */
+static void stress_ipsec_mb_bench_keys(MB_MGR *p_mgr, stress_ipsec_mb_bench_t *bench)
+{
+	uint8_t key[SHA_512_BLOCK_SIZE] ALIGNED(16);
+	uint8_t buf[SHA_512_BLOCK_SIZE] ALIGNED(16);
+	uint32_t dust[15 * 4] ALIGNED(16);
+	size_t i;
+
+	stress_rnd_fill(bench->iv, sizeof(bench->iv));
+	stress_rnd_fill(key, 32);
+	IMB_AES_KEYEXP_256(p_mgr, key, bench->aes_enc_keys, bench->aes_dec_keys);
+	stress_rnd_fill(key, 16);
+	IMB_AES_KEYEXP_128(p_mgr, key, bench->cmac_keys, dust);
+	IMB_AES_CMAC_SUBKEY_GEN_128(p_mgr, bench->cmac_keys, bench->cmac_skey1, bench->cmac_skey2);
+
+	stress_rnd_fill(key, 64);
+	for (i = 0; i < 64; i++)
+		buf[i] = key[i] ^ 0x36;
+	IMB_MD5_ONE_BLOCK(p_mgr, buf, bench->hmac_ipad);
+	for (i = 0; i < 64; i++)
+		buf[i] = key[i] ^ 0x5c;
+	IMB_MD5_ONE_BLOCK(p_mgr, buf, bench->hmac_opad);
+
+	stress_rnd_fill(buf, sizeof(buf));
+	(void)memset(key, 0, sizeof(key));
+	IMB_SHA512(p_mgr, buf, SHA_512_BLOCK_SIZE, key);
+	for (i = 0; i < sizeof(key); i++)
+		buf[i] = key[i] ^ 0x36;
+	IMB_SHA512_ONE_BLOCK(p_mgr, buf, bench->sha512_ipad);
+	for (i = 0; i < sizeof(key); i++)
+		buf[i] = key[i] ^ 0x5c;
+	IMB_SHA512_ONE_BLOCK(p_mgr, buf, bench->sha512_opad);
+}
+
+/*
+ *  stress_ipsec_mb_bench_job()
+ *	fill in a job of algorithm algo, the fields match the
+ *	stressor's job helpers
+ */
+static void stress_ipsec_mb_bench_job(
+	struct JOB_AES_HMAC *job,
+	const stress_ipsec_mb_bench_t *bench,
+	const size_t algo,
+	const uint8_t *data,
+	const size_t data_len,
+	uint8_t *dst)
+{
+	job->cipher_direction = ENCRYPT;
+	job->src = data;
+	job->user_data = dst;
+
+	switch (algo) {
+	case IPSEC_MB_AES_CBC:
+	case IPSEC_MB_AES_CTR:
+		job->chain_order = CIPHER_HASH;
+		job->hash_alg = NULL_HASH;
+		job->dst = dst;
+		job->aes_enc_key_expanded = bench->aes_enc_keys;
+		job->aes_key_len_in_bytes = 32;
+		job->iv = bench->iv;
+		job->cipher_start_src_offset_in_bytes = 0;
+		job->msg_len_to_cipher_in_bytes = data_len;
+		if (algo == IPSEC_MB_AES_CBC) {
+			job->cipher_mode = CBC;
+			job->aes_dec_key_expanded = bench->aes_dec_keys;
+			job->iv_len_in_bytes = 16;
+		} else {
+			job->cipher_mode = CNTR;
+			job->aes_dec_key_expanded = bench->aes_enc_keys;
+			job->iv_len_in_bytes = 12;	/* 4 byte nonce + 8 byte IV */
+		}
+		break;
+	case IPSEC_MB_AES_CMAC:
+		job->chain_order = HASH_CIPHER;
+		job->cipher_mode = NULL_CIPHER;
+		job->hash_alg = AES_CMAC;
+		job->hash_start_src_offset_in_bytes = 0;
+		job->msg_len_to_hash_in_bytes = data_len;
+		job->auth_tag_output = dst;
+		job->auth_tag_output_len_in_bytes = 16;
+		job->u.CMAC._key_expanded = bench->cmac_keys;
+		job->u.CMAC._skey1 = bench->cmac_skey1;
+		job->u.CMAC._skey2 = bench->cmac_skey2;
+		break;
+	case IPSEC_MB_SHA512:
+		job->chain_order = HASH_CIPHER;
+		job->cipher_mode = NULL_CIPHER;
+		job->hash_alg = PLAIN_SHA_512;
+		job->msg_len_to_hash_in_bytes = data_len;
+		job->auth_tag_output = dst;
+		job->auth_tag_output_len_in_bytes = SHA512_DIGEST_SIZE_IN_BYTES;
+		break;
+	default:
+		job->chain_order = HASH_CIPHER;
+		job->cipher_mode = NULL_CIPHER;
+		job->hash_start_src_offset_in_bytes = 0;
+		job->msg_len_to_hash_in_bytes = data_len;
+		job->auth_tag_output = dst;
+		if (algo == IPSEC_MB_HMAC_SHA512) {
+			job->hash_alg = SHA_512;
+			job->auth_tag_output_len_in_bytes = SHA512_DIGEST_SIZE_IN_BYTES;
+			job->u.HMAC._hashed_auth_key_xor_ipad = bench->sha512_ipad;
+			job->u.HMAC._hashed_auth_key_xor_opad = bench->sha512_opad;
+		} else {
+			job->hash_alg = (algo == IPSEC_MB_HMAC_MD5) ? MD5 : SHA1;
+			job->auth_tag_output_len_in_bytes = (algo == IPSEC_MB_HMAC_MD5) ? 16 : 20;
+			job->u.HMAC._hashed_auth_key_xor_ipad = bench->hmac_ipad;
+			job->u.HMAC._hashed_auth_key_xor_opad = bench->hmac_opad;
+		}
+		break;
+	}
+}
+
+/*
+ *  stress_ipsec_mb_bench_batch()
+ *	submit and flush rounds batches of jobs jobs of data_len bytes
+ */
+static void stress_ipsec_mb_bench_batch(
+	const stress_args_t *args,
+	struct MB_MGR *mb_mgr,
+	const stress_ipsec_mb_bench_t *bench,
+	const size_t algo,
+	const uint8_t *data,
+	const size_t data_len,
+	const int jobs,
+	const int rounds)
+{
+	const char *name = ipsec_mb_algos[algo];
+	struct JOB_AES_HMAC *job;
+	int j, r, jobs_done = 0;
+
+	stress_job_empty(mb_mgr);
+
+	for (r = 0; r < rounds; r++) {
+		uint8_t *dst = bench->output;
+
+		for (j = 0; j < jobs; j++, dst += data_len) {
+			job = stress_job_get_next(mb_mgr);
+			stress_ipsec_mb_bench_job(job, bench, algo, data, data_len, dst);
+			job = IMB_SUBMIT_JOB(mb_mgr);
+			if (job)
+				stress_job_check_status(args, name, job, &jobs_done);
+		}
+
+		while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
+			stress_job_check_status(args, name, job, &jobs_done);
+	}
+
+	stress_jobs_done(args, name, jobs * rounds, jobs_done);
+}
+
+/*
+ *  stress_ipsec_mb_rate()
+ *	run jobs job batches of data_len bytes of one algorithm for
+ *	duration seconds, returns GB/s
+ */
+static double stress_ipsec_mb_rate(
+	const stress_args_t *args,
+	MB_MGR *p_mgr,
+	const stress_ipsec_mb_bench_t *bench,
+	const size_t algo,
+	const uint8_t *data,
+	const size_t data_len,
+	const int jobs,
+	const double duration)
+{
+	const size_t batch_bytes = data_len * (size_t)jobs;
+	const int rounds = (batch_bytes >= IPSEC_MB_BENCH_BYTES) ?
+		1 : (int)(IPSEC_MB_BENCH_BYTES / batch_bytes);
+	uint64_t bytes = 0;
+	double t, dt;
+
+	t = stress_time_now();
+	do {
+		stress_ipsec_mb_bench_batch(args, p_mgr, bench, algo, data, data_len, jobs, rounds);
+		bytes += (uint64_t)batch_bytes * (uint64_t)rounds;
+		dt = stress_time_now() - t;
+	} while (keep_stressing_flag() && (dt < duration));
+
+	return (dt > 0.0) ? (double)bytes / dt / 1.0E9 : 0.0;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_t pthread;
+	const stress_args_t *args;
+	void (*init_func)(MB_MGR *p_mgr);
+	size_t algo;
+	stress_ipsec_mb_bench_t bench;
+	double gbps;		/* thread throughput, < 0 on failure */
+} stress_ipsec_mb_thread_t;
+
+/*
+ *  stress_ipsec_mb_thread()
+ *	run one algorithm on a private multi-buffer manager
+ */
+static void *stress_ipsec_mb_thread(void *arg)
+{
+	stress_ipsec_mb_thread_t *t = (stress_ipsec_mb_thread_t *)arg;
+	uint8_t data[IPSEC_MB_SCALE_SIZE] ALIGNED(64);
+	MB_MGR *p_mgr;
+
+	t->gbps = -1.0;
+	p_mgr = alloc_mb_mgr(0);
+	if (!p_mgr)
+		return NULL;
+	if (stress_ipsec_mb_bench_alloc(&t->bench) < 0) {
+		free_mb_mgr(p_mgr);
+		return NULL;
+	}
+	t->init_func(p_mgr);
+	stress_ipsec_mb_bench_keys(p_mgr, &t->bench);
+	stress_rnd_fill(data, sizeof(data));
+	t->gbps = stress_ipsec_mb_rate(t->args, p_mgr, &t->bench, t->algo, data,
+		sizeof(data), IPSEC_MB_SCALE_JOBS, IPSEC_MB_SCALE_TIME);
+	stress_ipsec_mb_bench_free(&t->bench);
+	free_mb_mgr(p_mgr);
+	return NULL;
+}
+
+/*
+ *  stress_ipsec_mb_scale()
+ *	aggregate GB/s of n threads running the same algorithm
+ */
+static double stress_ipsec_mb_scale(
+	const stress_args_t *args,
+	void (*init_func)(MB_MGR *p_mgr),
+	const size_t algo,
+	const uint32_t n)
+{
+	static stress_ipsec_mb_thread_t threads[IPSEC_MB_MAX_THREADS];
+	double gbps = 0.0;
+	uint32_t i, started;
+	bool ok = true;
+
+	for (started = 0; started < n; started++) {
+		threads[started].args = args;
+		threads[started].init_func = init_func;
+		threads[started].algo = algo;
+		if (pthread_create(&threads[started].pthread, NULL,
+				stress_ipsec_mb_thread, &threads[started]) != 0) {
+			ok = false;
+			break;
+		}
+	}
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		if (threads[i].gbps < 0.0)
+			ok = false;
+		gbps += threads[i].gbps;
+	}
+	return ok ? gbps : -1.0;
+}
+#endif
+
+/*
+ *  stress_ipsec_mb_bench()
+ *	measure per algorithm, per instruction set throughput across
+ *	buffer sizes and job batch sizes, then the thread scaling of
+ *	the widest instruction set
+ */
+static void stress_ipsec_mb_bench(
+	const stress_args_t *args,
+	MB_MGR *p_mgr,
+	const uint64_t features,
+	const uint8_t *data)
+{
+	static stress_ipsec_mb_bench_t bench;
+	static double res[SIZEOF_ARRAY(init_mb)][IPSEC_MB_ALGOS][IPSEC_MB_SIZES][IPSEC_MB_JOBS];
+#if defined(HAVE_LIB_PTHREAD)
+	static double scale[IPSEC_MB_ALGOS][9];
+	uint32_t ipsec_mb_threads = 4, threads[9], n_threads = 0, th;
+#endif
+	const size_t n_features = SIZEOF_ARRAY(init_mb);
+	size_t i, a, s, j, widest = 0;
+	bool done = false;
+
+#if defined(HAVE_LIB_PTHREAD)
+	(void)stress_get_setting("ipsec-mb-threads", &ipsec_mb_threads);
+	for (th = 1; th < ipsec_mb_threads; th <<= 1)
+		threads[n_threads++] = th;
+	threads[n_threads++] = ipsec_mb_threads;
+#endif
+	for (i = 0; i < n_features; i++) {
+		if ((init_mb[i].features & features) == init_mb[i].features)
+			widest = i;
+	}
+
+	if (stress_ipsec_mb_bench_alloc(&bench) < 0) {
+		pr_inf_skip("%s: failed to allocate %d bytes of bench job output, skipping\n",
+			args->name, IPSEC_MB_BENCH_OUTPUT);
+		return;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < n_features; i++) {
+			if ((init_mb[i].features & features) != init_mb[i].features)
+				continue;
+			init_mb[i].init_func(p_mgr);
+			stress_ipsec_mb_bench_keys(p_mgr, &bench);
+			for (a = 0; a < IPSEC_MB_ALGOS; a++) {
+				for (s = 0; s < IPSEC_MB_SIZES; s++) {
+					for (j = 0; j < IPSEC_MB_JOBS; j++) {
+						if (!keep_stressing(args))
+							goto finish;
+						res[i][a][s][j] = stress_ipsec_mb_rate(args, p_mgr,
+							&bench, a, data, ipsec_mb_sizes[s],
+							ipsec_mb_jobs[j], IPSEC_MB_BENCH_TIME);
+					}
+				}
+			}
+		}
+#if defined(HAVE_LIB_PTHREAD)
+		for (a = 0; a < IPSEC_MB_ALGOS; a++) {
+			for (th = 0; th < n_threads; th++) {
+				if (!keep_stressing(args))
+					goto finish;
+				scale[a][th] = stress_ipsec_mb_scale(args,
+					init_mb[widest].init_func, a, threads[th]);
+			}
+		}
+#endif
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_ipsec_mb_bench_free(&bench);
+
+	if (!done)
+		return;
+
+	if (args->instance == 0) {
+		char str[128];
+
+		for (i = 0; i < n_features; i++) {
+			if ((init_mb[i].features & features) != init_mb[i].features)
+				continue;
+			pr_inf("%s: %s throughput GB/s, columns are jobs per batch\n",
+				args->name, init_mb[i].name);
+			(void)snprintf(str, sizeof(str), "%-12s %5s", "algorithm", "size");
+			for (j = 0; j < IPSEC_MB_JOBS; j++) {
+				const size_t len = strlen(str);
+
+				(void)snprintf(str + len, sizeof(str) - len, " %7d", ipsec_mb_jobs[j]);
+			}
+			pr_inf("%s: %s\n", args->name, str);
+			for (a = 0; a < IPSEC_MB_ALGOS; a++) {
+				for (s = 0; s < IPSEC_MB_SIZES; s++) {
+					(void)snprintf(str, sizeof(str), "%-12s %5zu",
+						ipsec_mb_algos[a], ipsec_mb_sizes[s]);
+					for (j = 0; j < IPSEC_MB_JOBS; j++) {
+						const size_t len = strlen(str);
+
+						(void)snprintf(str + len, sizeof(str) - len,
+							" %7.3f", res[i][a][s][j]);
+					}
+					pr_inf("%s: %s\n", args->name, str);
+				}
+			}
+		}
+#if defined(HAVE_LIB_PTHREAD)
+		pr_inf("%s: %s thread scaling, aggregate GB/s, %d byte buffers, "
+			"%d jobs per batch, columns are threads\n", args->name,
+			init_mb[widest].name, IPSEC_MB_SCALE_SIZE, IPSEC_MB_SCALE_JOBS);
+		(void)snprintf(str, sizeof(str), "%-12s", "algorithm");
+		for (th = 0; th < n_threads; th++) {
+			const size_t len = strlen(str);
+
+			(void)snprintf(str + len, sizeof(str) - len, " %7" PRIu32, threads[th]);
+		}
+		pr_inf("%s: %s\n", args->name, str);
+		for (a = 0; a < IPSEC_MB_ALGOS; a++) {
+			(void)snprintf(str, sizeof(str), "%-12s", ipsec_mb_algos[a]);
+			for (th = 0; th < n_threads; th++) {
+				const size_t len = strlen(str);
+
+				if (scale[a][th] < 0.0)
+					(void)snprintf(str + len, sizeof(str) - len, " %7s", "-");
+				else
+					(void)snprintf(str + len, sizeof(str) - len, " %7.3f", scale[a][th]);
+			}
+			pr_inf("%s: %s\n", args->name, str);
+		}
+#endif
+	}
+
+	/* widest ISA, 4096 byte buffers, largest batch */
+	for (a = 0; a < IPSEC_MB_ALGOS; a++) {
+		char str[32];
+
+		(void)snprintf(str, sizeof(str), "%s %s GB/s",
+			init_mb[widest].name, ipsec_mb_algos[a]);
+		stress_misc_stats_set(args->misc_stats, (int)a, str,
+			res[widest][a][IPSEC_MB_SIZES - 1][IPSEC_MB_JOBS - 1]);
+	}
+}
+
 /*
  *  stress_ipsec_mb()
  *      stress Intel ipsec_mb instruction
@@ -616,6 +1116,7 @@ static int stress_ipsec_mb(const stress_args_t *args)
 	uint64_t count = 0;
 	bool got_features = false;
 	uint64_t ipsec_mb_feature = ~0ULL;
+	bool ipsec_mb_bench = false;
 
 	p_mgr = alloc_mb_mgr(0);
 	if (!p_mgr) {
@@ -666,6 +1167,13 @@ static int stress_ipsec_mb(const stress_args_t *args)
 
 	stress_rnd_fill(data, sizeof(data));
 
+	(void)stress_get_setting("ipsec-mb-bench", &ipsec_mb_bench);
+	if (ipsec_mb_bench) {
+		stress_ipsec_mb_bench(args, p_mgr, features, data);
+		free_mb_mgr(p_mgr);
+		return EXIT_SUCCESS;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
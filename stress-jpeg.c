@@ -38,10 +38,12 @@ typedef struct {
 static const stress_help_t help[] = {
 	{ NULL,	"jpeg N",		"start N workers that burn cycles with no-ops" },
 	{ NULL,	"jpeg-ops N",		"stop after N jpeg bogo no-op operations" },
+	{ NULL,	"jpeg-bench",		"measure MPix/s over sizes, quality, subsampling and SIMD" },
 	{ NULL,	"jpeg-height N",	"image height in pixels "},
 	{ NULL,	"jpeg-image type",	"image type: one of brown, flat, gradient, noise, plasma or xstripes" },
 	{ NULL,	"jpeg-width N",		"image width  in pixels "},
 	{ NULL,	"jpeg-quality Q",	"compression quality 1 (low) .. 100 (high)" },
+	{ NULL,	"jpeg-threads N",	"scale the jpeg bench up to N encoder threads" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -54,6 +56,28 @@ static const jpeg_image_type_t jpeg_image_types[] = {
 	{ "xstripes",	JPEG_IMAGE_XSTRIPES },
 };
 
+/*
+ *  stress_set_jpeg_bench()
+ *	enable the encode throughput benchmark
+ */
+static int stress_set_jpeg_bench(const char *opt)
+{
+	return stress_set_setting_true("jpeg-bench", opt);
+}
+
+/*
+ *  stress_set_jpeg_threads()
+ *	set maximum number of jpeg bench encoder threads
+ */
+static int stress_set_jpeg_threads(const char *opt)
+{
+	uint32_t jpeg_threads;
+
+	jpeg_threads = stress_get_uint32(opt);
+	stress_check_range("jpeg-threads", (uint64_t)jpeg_threads, 1, 256);
+	return stress_set_setting("jpeg-threads", TYPE_ID_UINT32, &jpeg_threads);
+}
+
 /*
  *  stress_set_jpeg_height()
  *      set jpeg height
@@ -115,10 +139,12 @@ static int stress_set_jpeg_image(const char *opt)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_jpeg_bench,	stress_set_jpeg_bench },
 	{ OPT_jpeg_height,	stress_set_jpeg_height },
 	{ OPT_jpeg_image,	stress_set_jpeg_image },
 	{ OPT_jpeg_width,	stress_set_jpeg_width },
 	{ OPT_jpeg_quality,	stress_set_jpeg_quality },
+	{ OPT_jpeg_threads,	stress_set_jpeg_threads },
 	{ 0,			NULL }
 };
 
@@ -279,11 +305,46 @@ static void OPTIMIZE3 stress_rgb_flat(
 	}
 }
 
+/*
+ *  stress_rgb_generate()
+ *	fill rgb with an image of the given type
+ */
+static void stress_rgb_generate(
+	uint8_t		*rgb,
+	const int32_t	x_max,
+	const int32_t	y_max,
+	const int	jpeg_image)
+{
+	switch (jpeg_image) {
+	default:
+	case JPEG_IMAGE_PLASMA:
+		stress_rgb_plasma(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_NOISE:
+		stress_rgb_noise(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_GRADIENT:
+		stress_rgb_gradient(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_XSTRIPES:
+		stress_rgb_xstripes(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_FLAT:
+		stress_rgb_flat(rgb, x_max, y_max);
+		break;
+	case JPEG_IMAGE_BROWN:
+		stress_rgb_brown(rgb, x_max, y_max);
+		break;
+	}
+}
+
 static int stress_rgb_compress_to_jpeg(
 	uint8_t		*rgb,
 	const int32_t	x_max,
 	const int32_t	y_max,
-	const int32_t	quality)
+	const int32_t	quality,
+	const int	h_samp,
+	const int	v_samp)
 {
 	struct jpeg_compress_struct cinfo;
 	struct jpeg_error_mgr jerr;
@@ -293,7 +354,7 @@ static int stress_rgb_compress_to_jpeg(
 	char *ptr;
 #endif
 	size_t size = 0;
-	int32_t y;
+	int32_t y, row;
 	static int32_t yy = 0;
 	const int row_stride = x_max * 3;
 
@@ -323,14 +384,19 @@ static int stress_rgb_compress_to_jpeg(
 	cinfo.in_color_space = JCS_RGB;
 	jpeg_set_defaults(&cinfo);
 	jpeg_set_quality(&cinfo, (int)quality, TRUE);
+	/* luma sampling factors select 4:4:4, 4:2:2 or 4:2:0 chroma */
+	cinfo.comp_info[0].h_samp_factor = h_samp;
+	cinfo.comp_info[0].v_samp_factor = v_samp;
 	jpeg_start_compress(&cinfo, TRUE);
 
+	/* local copy of the start row, yy is shared by bench threads */
+	row = yy;
 	for (y = 0; y < y_max; y++, rgb += row_stride) {
-		yy %= y_max;
-		row_pointer[yy] = rgb;
-		yy++;
+		row %= y_max;
+		row_pointer[row] = rgb;
+		row++;
 	}
-	yy++;
+	yy = row + 1;
 
 	(void)jpeg_write_scanlines(&cinfo, row_pointer, (JDIMENSION)y_max);
 	jpeg_finish_compress(&cinfo);
@@ -344,6 +410,404 @@ static int stress_rgb_compress_to_jpeg(
 	return (int)size;
 }
 
+#define JPEG_BENCH_TIME		(0.1)	/* seconds per sweep cell */
+#define JPEG_BENCH_SCALE_TIME	(0.5)	/* seconds per thread count */
+#define JPEG_BENCH_SCALE_WIDTH	(1920)
+#define JPEG_BENCH_SCALE_HEIGHT	(1080)
+#define JPEG_BENCH_IMAGES	(4)	/* distinct images for the thread pool */
+#define JPEG_BENCH_MAX_THREADS	(256)
+#define JPEG_BENCH_MAX_POINTS	(9)
+
+typedef struct {
+	const int32_t width;
+	const int32_t height;
+} stress_jpeg_bench_size_t;
+
+typedef struct {
+	const char *name;
+	const int h_samp;	/* luma horizontal sampling factor */
+	const int v_samp;	/* luma vertical sampling factor */
+} stress_jpeg_bench_subsamp_t;
+
+static const stress_jpeg_bench_size_t jpeg_bench_sizes[] = {
+	{ 640,	480 },
+	{ 1920,	1080 },
+	{ 3840,	2160 },
+};
+
+static const int32_t jpeg_bench_qualities[] = {
+	50, 75, 95
+};
+
+static const stress_jpeg_bench_subsamp_t jpeg_bench_subsamps[] = {
+	{ "4:4:4",	1, 1 },
+	{ "4:2:2",	2, 1 },
+	{ "4:2:0",	2, 2 },
+};
+
+#define JPEG_BENCH_SIZES	SIZEOF_ARRAY(jpeg_bench_sizes)
+#define JPEG_BENCH_QUALITIES	SIZEOF_ARRAY(jpeg_bench_qualities)
+#define JPEG_BENCH_SUBSAMPS	SIZEOF_ARRAY(jpeg_bench_subsamps)
+
+/*
+ *  results shared between the bench children and the stressor,
+ *  MPix/s values < 0 mark cells that could not be measured
+ */
+typedef struct {
+	double mpix[2][JPEG_BENCH_SIZES][JPEG_BENCH_QUALITIES][JPEG_BENCH_SUBSAMPS];
+	double scale[JPEG_BENCH_MAX_POINTS];
+	uint32_t threads[JPEG_BENCH_MAX_POINTS];
+	size_t n_points;
+	bool done[2];		/* sweep completed, [0] SIMD on, [1] SIMD off */
+} stress_jpeg_bench_shared_t;
+
+/*
+ *  stress_jpeg_bench_rate()
+ *	encode the same image repeatedly for duration seconds,
+ *	return MPix/s or -1.0 on failure
+ */
+static double stress_jpeg_bench_rate(
+	const stress_args_t *args,
+	uint8_t *rgb,
+	const int32_t x_max,
+	const int32_t y_max,
+	const int32_t quality,
+	const stress_jpeg_bench_subsamp_t *subsamp,
+	const double duration)
+{
+	const double t = stress_time_now();
+	double dt;
+	uint64_t n = 0;
+
+	do {
+		if (stress_rgb_compress_to_jpeg(rgb, x_max, y_max, quality,
+				subsamp->h_samp, subsamp->v_samp) <= 0)
+			return -1.0;
+		n++;
+		dt = stress_time_now() - t;
+	} while (keep_stressing(args) && (dt < duration));
+
+	return (dt > 0.0) ? (double)n * (double)x_max * (double)y_max / dt / 1.0E6 : -1.0;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_t pthread;
+	const stress_args_t *args;
+	uint8_t *rgb;
+	int32_t quality;
+	double mpix;		/* thread throughput, < 0 on failure */
+} stress_jpeg_bench_thread_t;
+
+/*
+ *  stress_jpeg_bench_thread()
+ *	encode one image with a private compressor instance
+ */
+static void *stress_jpeg_bench_thread(void *arg)
+{
+	stress_jpeg_bench_thread_t *t = (stress_jpeg_bench_thread_t *)arg;
+
+	t->mpix = stress_jpeg_bench_rate(t->args, t->rgb,
+		JPEG_BENCH_SCALE_WIDTH, JPEG_BENCH_SCALE_HEIGHT, t->quality,
+		&jpeg_bench_subsamps[JPEG_BENCH_SUBSAMPS - 1], JPEG_BENCH_SCALE_TIME);
+	return NULL;
+}
+
+/*
+ *  stress_jpeg_bench_scale()
+ *	aggregate MPix/s of n threads encoding independent images
+ */
+static double stress_jpeg_bench_scale(
+	const stress_args_t *args,
+	uint8_t *images[JPEG_BENCH_IMAGES],
+	const int32_t quality,
+	const uint32_t n)
+{
+	static stress_jpeg_bench_thread_t threads[JPEG_BENCH_MAX_THREADS];
+	double mpix = 0.0;
+	uint32_t i, started;
+	bool ok = true;
+
+	for (started = 0; started < n; started++) {
+		threads[started].args = args;
+		threads[started].rgb = images[started % JPEG_BENCH_IMAGES];
+		threads[started].quality = quality;
+		if (pthread_create(&threads[started].pthread, NULL,
+				stress_jpeg_bench_thread, &threads[started]) != 0) {
+			ok = false;
+			break;
+		}
+	}
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		if (threads[i].mpix < 0.0)
+			ok = false;
+		mpix += threads[i].mpix;
+	}
+	return ok ? mpix : -1.0;
+}
+#endif
+
+/*
+ *  stress_jpeg_bench_child()
+ *	run the size, quality and subsampling sweep with libjpeg-turbo
+ *	SIMD enabled or disabled. The SIMD choice is latched on the
+ *	first compress call of a process, hence a child per setting.
+ *	The SIMD enabled child also measures thread scaling.
+ */
+static void NORETURN stress_jpeg_bench_child(
+	const stress_args_t *args,
+	stress_jpeg_bench_shared_t *shared,
+	const bool simd,
+	const int jpeg_image,
+	const int32_t jpeg_quality)
+{
+	const size_t max_size = (size_t)jpeg_bench_sizes[JPEG_BENCH_SIZES - 1].width *
+				(size_t)jpeg_bench_sizes[JPEG_BENCH_SIZES - 1].height * 3;
+	uint8_t *rgb;
+	size_t s, q, c;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	if (simd) {
+		(void)unsetenv("JSIMD_FORCENONE");
+	} else {
+		if (setenv("JSIMD_FORCENONE", "1", 1) < 0)
+			_exit(EXIT_NO_RESOURCE);
+	}
+
+	rgb = (uint8_t *)malloc(max_size);
+	if (!rgb)
+		_exit(EXIT_NO_RESOURCE);
+	stress_mwc_set_seed(0xf1379ab2, 0x679ce25d);
+
+	for (s = 0; s < JPEG_BENCH_SIZES; s++) {
+		const int32_t x_max = jpeg_bench_sizes[s].width;
+		const int32_t y_max = jpeg_bench_sizes[s].height;
+
+		stress_rgb_generate(rgb, x_max, y_max, jpeg_image);
+		for (q = 0; q < JPEG_BENCH_QUALITIES; q++) {
+			for (c = 0; c < JPEG_BENCH_SUBSAMPS; c++) {
+				if (!keep_stressing(args))
+					_exit(EXIT_SUCCESS);
+				shared->mpix[!simd][s][q][c] = stress_jpeg_bench_rate(args,
+					rgb, x_max, y_max, jpeg_bench_qualities[q],
+					&jpeg_bench_subsamps[c], JPEG_BENCH_TIME);
+			}
+		}
+	}
+	free(rgb);
+
+#if defined(HAVE_LIB_PTHREAD)
+	if (simd) {
+		const size_t size = (size_t)JPEG_BENCH_SCALE_WIDTH *
+				    (size_t)JPEG_BENCH_SCALE_HEIGHT * 3;
+		uint8_t *images[JPEG_BENCH_IMAGES];
+		size_t i, p;
+
+		for (i = 0; i < JPEG_BENCH_IMAGES; i++) {
+			images[i] = (uint8_t *)malloc(size);
+			if (!images[i]) {
+				while (i > 0)
+					free(images[--i]);
+				_exit(EXIT_NO_RESOURCE);
+			}
+			stress_rgb_generate(images[i], JPEG_BENCH_SCALE_WIDTH,
+				JPEG_BENCH_SCALE_HEIGHT, jpeg_image);
+		}
+		for (p = 0; p < shared->n_points; p++) {
+			if (!keep_stressing(args))
+				_exit(EXIT_SUCCESS);
+			shared->scale[p] = stress_jpeg_bench_scale(args, images,
+				jpeg_quality, shared->threads[p]);
+		}
+		for (i = 0; i < JPEG_BENCH_IMAGES; i++)
+			free(images[i]);
+	}
+#else
+	(void)jpeg_quality;
+#endif
+	shared->done[!simd] = true;
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_jpeg_bench()
+ *	measure jpeg encode throughput in MPix/s across image sizes,
+ *	quality levels, chroma subsampling and SIMD on/off, then the
+ *	aggregate throughput of a pool of encoder threads
+ */
+static int stress_jpeg_bench(const stress_args_t *args)
+{
+	stress_jpeg_bench_shared_t *shared, res;
+	uint32_t jpeg_threads = 4, th;
+	int32_t jpeg_quality = 95;
+	int jpeg_image = JPEG_IMAGE_PLASMA;
+	size_t s, q, c, p;
+	bool done = false;
+	const size_t shared_size = (sizeof(*shared) + args->page_size - 1) & ~(args->page_size - 1);
+#if defined(LIBJPEG_TURBO_VERSION)
+	const int n_simd = 2;
+#else
+	const int n_simd = 1;
+#endif
+
+	(void)stress_get_setting("jpeg-threads", &jpeg_threads);
+	(void)stress_get_setting("jpeg-quality", &jpeg_quality);
+	(void)stress_get_setting("jpeg-image", &jpeg_image);
+
+	shared = (stress_jpeg_bench_shared_t *)mmap(NULL, shared_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes, errno=%d (%s), skipping stressor\n",
+			args->name, shared_size, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		int i;
+
+		for (i = 0; i < 2; i++) {
+			for (s = 0; s < JPEG_BENCH_SIZES; s++)
+				for (q = 0; q < JPEG_BENCH_QUALITIES; q++)
+					for (c = 0; c < JPEG_BENCH_SUBSAMPS; c++)
+						shared->mpix[i][s][q][c] = -1.0;
+			shared->done[i] = false;
+		}
+		shared->n_points = 0;
+		for (th = 1; th < jpeg_threads; th <<= 1)
+			shared->threads[shared->n_points++] = th;
+		shared->threads[shared->n_points++] = jpeg_threads;
+		for (p = 0; p < shared->n_points; p++)
+			shared->scale[p] = -1.0;
+
+		for (i = 0; i < n_simd; i++) {
+			pid_t pid;
+			int status;
+again:
+			pid = fork();
+			if (pid < 0) {
+				if (stress_redo_fork(errno))
+					goto again;
+				if (!keep_stressing(args))
+					break;
+				pr_fail("%s: fork failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				(void)munmap((void *)shared, shared_size);
+				return EXIT_FAILURE;
+			} else if (pid == 0) {
+				stress_jpeg_bench_child(args, shared, i == 0,
+					jpeg_image, jpeg_quality);
+			}
+			if (shim_waitpid(pid, &status, 0) < 0) {
+				(void)kill(pid, SIGKILL);
+				(void)shim_waitpid(pid, &status, 0);
+			}
+			if (!shared->done[i])
+				break;
+		}
+		if ((i < n_simd) || !shared->done[0])
+			break;
+		(void)memcpy(&res, shared, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)shared, shared_size);
+
+	if (!done)
+		return EXIT_SUCCESS;
+
+	if (args->instance == 0) {
+		char str[128];
+		const char *image = "plasma";
+
+		for (s = 0; s < SIZEOF_ARRAY(jpeg_image_types); s++) {
+			if (jpeg_image_types[s].type == jpeg_image)
+				image = jpeg_image_types[s].name;
+		}
+		pr_inf("%s: encode throughput MPix/s, %s image, columns are "
+			"chroma subsampling%s\n", args->name, image,
+			(n_simd > 1) ? ", SIMD on/off" : "");
+		(void)snprintf(str, sizeof(str), "%-9s %7s", "size", "quality");
+		for (c = 0; c < JPEG_BENCH_SUBSAMPS; c++) {
+			const size_t len = strlen(str);
+
+			(void)snprintf(str + len, sizeof(str) - len, " %15s",
+				jpeg_bench_subsamps[c].name);
+		}
+		pr_inf("%s: %s\n", args->name, str);
+		for (s = 0; s < JPEG_BENCH_SIZES; s++) {
+			for (q = 0; q < JPEG_BENCH_QUALITIES; q++) {
+				char size[16];
+
+				(void)snprintf(size, sizeof(size), "%" PRId32 "x%" PRId32,
+					jpeg_bench_sizes[s].width, jpeg_bench_sizes[s].height);
+				(void)snprintf(str, sizeof(str), "%-9s %7" PRId32,
+					size, jpeg_bench_qualities[q]);
+				for (c = 0; c < JPEG_BENCH_SUBSAMPS; c++) {
+					const double on = res.mpix[0][s][q][c];
+					const double off = res.mpix[1][s][q][c];
+					const size_t len = strlen(str);
+
+					if (n_simd < 2) {
+						if (on < 0.0)
+							(void)snprintf(str + len, sizeof(str) - len, " %15s", "-");
+						else
+							(void)snprintf(str + len, sizeof(str) - len, " %15.2f", on);
+					} else if ((on < 0.0) || (off < 0.0)) {
+						(void)snprintf(str + len, sizeof(str) - len, " %15s", "-");
+					} else {
+						(void)snprintf(str + len, sizeof(str) - len,
+							" %7.2f/%7.2f", on, off);
+					}
+				}
+				pr_inf("%s: %s\n", args->name, str);
+			}
+		}
+#if defined(HAVE_LIB_PTHREAD)
+		pr_inf("%s: thread pool scaling, aggregate MPix/s, %dx%d, "
+			"quality %" PRId32 ", 4:2:0, independent images\n", args->name,
+			JPEG_BENCH_SCALE_WIDTH, JPEG_BENCH_SCALE_HEIGHT, jpeg_quality);
+		pr_inf("%s: %7s %10s %8s\n", args->name, "threads", "MPix/s", "speedup");
+		for (p = 0; p < res.n_points; p++) {
+			if ((res.scale[p] < 0.0) || (res.scale[0] <= 0.0)) {
+				pr_inf("%s: %7" PRIu32 " %10s %8s\n", args->name,
+					res.threads[p], "-", "-");
+				continue;
+			}
+			pr_inf("%s: %7" PRIu32 " %10.2f %7.2fx\n", args->name,
+				res.threads[p], res.scale[p], res.scale[p] / res.scale[0]);
+		}
+#endif
+	}
+
+	/* quality 95 4:2:0 per size with SIMD, plus the thread pool peak */
+	for (s = 0; s < JPEG_BENCH_SIZES; s++) {
+		char str[32];
+		const double mpix = res.mpix[0][s][JPEG_BENCH_QUALITIES - 1][JPEG_BENCH_SUBSAMPS - 1];
+
+		(void)snprintf(str, sizeof(str), "%" PRId32 "x%" PRId32 " MPix/sec",
+			jpeg_bench_sizes[s].width, jpeg_bench_sizes[s].height);
+		stress_misc_stats_set(args->misc_stats, (int)s, str, mpix > 0.0 ? mpix : 0.0);
+	}
+#if defined(HAVE_LIB_PTHREAD)
+	{
+		char str[32];
+		const double mpix = res.scale[res.n_points - 1];
+
+		(void)snprintf(str, sizeof(str), "%" PRIu32 " threads MPix/sec", jpeg_threads);
+		stress_misc_stats_set(args->misc_stats, (int)JPEG_BENCH_SIZES, str,
+			mpix > 0.0 ? mpix : 0.0);
+	}
+#endif
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_jpeg()
  *	stress jpeg compression
@@ -359,6 +823,11 @@ static int stress_jpeg(const stress_args_t *args)
 	int32_t jpeg_quality = 95;
 	size_t rgb_size;
 	int jpeg_image = JPEG_IMAGE_PLASMA;
+	bool jpeg_bench = false;
+
+	(void)stress_get_setting("jpeg-bench", &jpeg_bench);
+	if (jpeg_bench)
+		return stress_jpeg_bench(args);
 
 	(void)stress_get_setting("jpeg-width", &x_max);
 	(void)stress_get_setting("jpeg-height", &y_max);
@@ -376,27 +845,7 @@ static int stress_jpeg(const stress_args_t *args)
 
 	stress_mwc_set_seed(0xf1379ab2, 0x679ce25d);
 
-	switch (jpeg_image) {
-	default:
-	case JPEG_IMAGE_PLASMA:
-		stress_rgb_plasma(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_NOISE:
-		stress_rgb_noise(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_GRADIENT:
-		stress_rgb_gradient(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_XSTRIPES:
-		stress_rgb_xstripes(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_FLAT:
-		stress_rgb_flat(rgb, x_max, y_max);
-		break;
-	case JPEG_IMAGE_BROWN:
-		stress_rgb_brown(rgb, x_max, y_max);
-		break;
-	}
+	stress_rgb_generate(rgb, x_max, y_max, jpeg_image);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -406,7 +855,7 @@ static int stress_jpeg(const stress_args_t *args)
 		double t1, t2;
 
 		t1 = stress_time_now();
-		size = stress_rgb_compress_to_jpeg(rgb, x_max, y_max, jpeg_quality);
+		size = stress_rgb_compress_to_jpeg(rgb, x_max, y_max, jpeg_quality, 2, 2);
 		t2 = stress_time_now();
 		t_jpeg += (t2 - t1);
 		if (size > 0) {
@@ -422,6 +871,11 @@ static int stress_jpeg(const stress_args_t *args)
 			args->name, 100.0 * size_compressed / size_uncompressed,
 			t_jpeg, (double)get_counter(args) / t_jpeg);
 	}
+	if (t_jpeg > 0.0) {
+		const double pixels = (double)get_counter(args) * (double)x_max * (double)y_max;
+
+		stress_misc_stats_set(args->misc_stats, 0, "MPix/sec", pixels / t_jpeg / 1.0E6);
+	}
 
 	(void)munmap((void *)rgb, rgb_size);
 
@@ -0,0 +1,445 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+#include "core-thrash.h"
+
+#define MIN_KSMBENCH_BYTES	(1 * MB)
+#define MAX_KSMBENCH_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_KSMBENCH_BYTES	(16 * MB)
+
+#define DEFAULT_KSMBENCH_DUP	(50)
+#define DEFAULT_KSMBENCH_ENTROPY (25)
+
+#define KSMBENCH_WINDOW		(8.0)	/* longest wait for merging, seconds */
+#define KSMBENCH_SAMPLE		(0.25)	/* ksm counter sample period, seconds */
+#define KSMBENCH_STABLE		(4)	/* samples without change to settle */
+
+static const stress_help_t help[] = {
+	{ NULL,	"ksmbench N",		"start N workers measuring KSM and zswap/zram memory savings" },
+	{ NULL,	"ksmbench-bytes N",	"size of the region of pages to merge and compress, default 16M" },
+	{ NULL,	"ksmbench-dup P",	"percentage of pages that are duplicates, default 50" },
+	{ NULL,	"ksmbench-entropy P",	"percentage of random bytes in unique pages, default 25" },
+	{ NULL,	"ksmbench-ops N",	"stop after N pages touched back in" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_ksmbench_bytes(const char *opt)
+{
+	size_t ksmbench_bytes;
+
+	ksmbench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("ksmbench-bytes", ksmbench_bytes,
+		MIN_KSMBENCH_BYTES, MAX_KSMBENCH_BYTES);
+	return stress_set_setting("ksmbench-bytes", TYPE_ID_SIZE_T, &ksmbench_bytes);
+}
+
+static int stress_set_ksmbench_dup(const char *opt)
+{
+	uint32_t ksmbench_dup;
+
+	ksmbench_dup = stress_get_uint32(opt);
+	stress_check_range("ksmbench-dup", (uint64_t)ksmbench_dup, 0, 100);
+	return stress_set_setting("ksmbench-dup", TYPE_ID_UINT32, &ksmbench_dup);
+}
+
+static int stress_set_ksmbench_entropy(const char *opt)
+{
+	uint32_t ksmbench_entropy;
+
+	ksmbench_entropy = stress_get_uint32(opt);
+	stress_check_range("ksmbench-entropy", (uint64_t)ksmbench_entropy, 0, 100);
+	return stress_set_setting("ksmbench-entropy", TYPE_ID_UINT32, &ksmbench_entropy);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_ksmbench_bytes,		stress_set_ksmbench_bytes },
+	{ OPT_ksmbench_dup,		stress_set_ksmbench_dup },
+	{ OPT_ksmbench_entropy,		stress_set_ksmbench_entropy },
+	{ 0,				NULL }
+};
+
+#if defined(__linux__) &&		\
+    defined(HAVE_MADVISE) &&		\
+    defined(MADV_MERGEABLE)
+
+/* system wide ksm counters, in pages */
+typedef struct {
+	uint64_t pages_shared;		/* deduplicated pages in use */
+	uint64_t pages_sharing;		/* pages saved by sharing them */
+	uint64_t full_scans;		/* complete scans of the mergeable areas */
+} stress_ksmbench_ksm_t;
+
+/* system wide compressed swap usage, in bytes */
+typedef struct {
+	uint64_t orig;			/* uncompressed size of stored pages */
+	uint64_t compr;			/* compressed size */
+} stress_ksmbench_compr_t;
+
+/* touch back in latency percentiles */
+typedef struct {
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t max;
+} stress_ksmbench_latency_t;
+
+static const char ksmbench_text[] =
+	"the quick brown fox jumps over the lazy dog, 0123456789. ";
+
+/*
+ *  stress_ksmbench_read_ksm()
+ *	read the ksm page counters, returns -1 if ksm is not available
+ */
+static int stress_ksmbench_read_ksm(stress_ksmbench_ksm_t *ksm)
+{
+	static const char * const names[] = {
+		"pages_shared",
+		"pages_sharing",
+		"full_scans",
+	};
+	uint64_t *vals[SIZEOF_ARRAY(names)];
+	size_t i;
+
+	vals[0] = &ksm->pages_shared;
+	vals[1] = &ksm->pages_sharing;
+	vals[2] = &ksm->full_scans;
+
+	for (i = 0; i < SIZEOF_ARRAY(names); i++) {
+		char path[PATH_MAX], buf[32];
+
+		(void)snprintf(path, sizeof(path), "/sys/kernel/mm/ksm/%s", names[i]);
+		(void)memset(buf, 0, sizeof(buf));
+		if (system_read(path, buf, sizeof(buf) - 1) < 0)
+			return -1;
+		*vals[i] = (uint64_t)strtoull(buf, NULL, 10);
+	}
+	return 0;
+}
+
+/*
+ *  stress_ksmbench_read_compr()
+ *	sum the zswap (from /proc/meminfo Zswap and Zswapped) and the
+ *	zram (from mm_stat) uncompressed and compressed sizes
+ */
+static void stress_ksmbench_read_compr(stress_ksmbench_compr_t *compr)
+{
+	FILE *fp;
+	DIR *dir;
+	struct dirent *d;
+	char buf[256];
+
+	compr->orig = 0;
+	compr->compr = 0;
+
+	fp = fopen("/proc/meminfo", "r");
+	if (fp) {
+		while (fgets(buf, sizeof(buf), fp)) {
+			unsigned long long kb;
+
+			if (sscanf(buf, "Zswapped: %llu", &kb) == 1)
+				compr->orig += (uint64_t)kb * KB;
+			else if (sscanf(buf, "Zswap: %llu", &kb) == 1)
+				compr->compr += (uint64_t)kb * KB;
+		}
+		(void)fclose(fp);
+	}
+
+	dir = opendir("/sys/block");
+	if (!dir)
+		return;
+	while ((d = readdir(dir)) != NULL) {
+		char path[PATH_MAX];
+		unsigned long long orig, compressed;
+
+		if (strncmp(d->d_name, "zram", 4))
+			continue;
+		(void)snprintf(path, sizeof(path), "/sys/block/%s/mm_stat", d->d_name);
+		(void)memset(buf, 0, sizeof(buf));
+		if (system_read(path, buf, sizeof(buf) - 1) < 0)
+			continue;
+		if (sscanf(buf, "%llu %llu", &orig, &compressed) == 2) {
+			compr->orig += (uint64_t)orig;
+			compr->compr += (uint64_t)compressed;
+		}
+	}
+	(void)closedir(dir);
+}
+
+/*
+ *  stress_ksmbench_fill()
+ *	fill the region, dup percent of pages are copies of one
+ *	template page, the rest are unique pages with entropy
+ *	percent random bytes followed by repeated text
+ */
+static void stress_ksmbench_fill(
+	const stress_args_t *args,
+	uint8_t *buf,
+	const size_t n_pages,
+	const uint32_t dup,
+	const uint32_t entropy)
+{
+	const size_t page_size = args->page_size;
+	const size_t random_bytes = (page_size * entropy) / 100;
+	size_t i, j;
+
+	for (i = 0; i < n_pages; i++) {
+		uint8_t *page = buf + (i * page_size);
+		uint64_t stamp;
+
+		if ((i > 0) && ((stress_mwc32() % 100) < dup)) {
+			(void)memcpy((void *)page, (void *)buf, page_size);
+			continue;
+		}
+		stress_mwc_fill(page, random_bytes);
+		for (j = random_bytes; j < page_size; j++)
+			page[j] = (uint8_t)ksmbench_text[j % (sizeof(ksmbench_text) - 1)];
+		/* keep unique pages unique, page 0 is the duplicate template */
+		if (i > 0) {
+			stamp = ((uint64_t)args->instance << 40) | (uint64_t)i;
+			(void)memcpy((void *)(page + page_size - sizeof(stamp)),
+				(void *)&stamp, sizeof(stamp));
+		}
+	}
+}
+
+static int stress_ksmbench_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_ksmbench_touch()
+ *	touch each page back in, writing to break ksm sharing or
+ *	reading to swap compressed pages back in, and compute the
+ *	latency percentiles
+ */
+static void stress_ksmbench_touch(
+	const stress_args_t *args,
+	uint8_t *buf,
+	const size_t n_pages,
+	const bool do_write,
+	uint64_t *latencies,
+	stress_ksmbench_latency_t *latency)
+{
+	const size_t page_size = args->page_size;
+	size_t i;
+
+	for (i = 0; i < n_pages; i++) {
+		volatile uint8_t *ptr = (volatile uint8_t *)(buf + (i * page_size));
+		uint64_t t1, t2;
+
+		t1 = stress_clock_ns();
+		if (do_write)
+			*ptr = *ptr;
+		else
+			(void)*ptr;
+		t2 = stress_clock_ns();
+		latencies[i] = t2 - t1;
+	}
+	add_counter(args, (uint64_t)n_pages);
+
+	qsort(latencies, n_pages, sizeof(*latencies), stress_ksmbench_cmp);
+	latency->p50 = latencies[n_pages / 2];
+	latency->p99 = latencies[(n_pages * 99) / 100];
+	latency->max = latencies[n_pages - 1];
+}
+
+/*
+ *  stress_ksmbench()
+ *	quantify the memory saved by ksm merging and zswap/zram
+ *	compression of a region of controlled duplication and
+ *	compressibility, and the latency of touching it back in
+ */
+static int stress_ksmbench(const stress_args_t *args)
+{
+	const size_t page_size = args->page_size;
+	size_t ksmbench_bytes = DEFAULT_KSMBENCH_BYTES;
+	uint32_t ksmbench_dup = DEFAULT_KSMBENCH_DUP;
+	uint32_t ksmbench_entropy = DEFAULT_KSMBENCH_ENTROPY;
+	size_t n_pages;
+	uint64_t *latencies;
+	uint8_t *buf;
+	int old_run = -1;
+	bool have_ksm, reported = false;
+	stress_ksmbench_ksm_t ksm_base;
+
+	(void)stress_get_setting("ksmbench-dup", &ksmbench_dup);
+	(void)stress_get_setting("ksmbench-entropy", &ksmbench_entropy);
+	if (!stress_get_setting("ksmbench-bytes", &ksmbench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			ksmbench_bytes = 256 * MB;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			ksmbench_bytes = MIN_KSMBENCH_BYTES;
+	}
+	ksmbench_bytes /= args->num_instances;
+	if (ksmbench_bytes < MIN_KSMBENCH_BYTES)
+		ksmbench_bytes = MIN_KSMBENCH_BYTES;
+	n_pages = ksmbench_bytes / page_size;
+	ksmbench_bytes = n_pages * page_size;
+
+	have_ksm = (stress_ksmbench_read_ksm(&ksm_base) == 0);
+	if (have_ksm && (args->instance == 0)) {
+		old_run = stress_ksm_run(KSM_RUN_MERGE);
+		if ((old_run < 0) && (args->instance == 0))
+			pr_inf("%s: cannot enable ksm merging, sharing will only "
+				"be seen if ksm is already running\n", args->name);
+	} else if (!have_ksm && (args->instance == 0)) {
+		pr_inf("%s: ksm not available, only measuring compression\n", args->name);
+	}
+
+	latencies = (uint64_t *)calloc(n_pages, sizeof(*latencies));
+	if (!latencies) {
+		pr_inf_skip("%s: cannot allocate latency samples, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		stress_ksmbench_ksm_t ksm, ksm_prev;
+		stress_ksmbench_compr_t compr1, compr2;
+		stress_ksmbench_latency_t unmerge, swapin;
+		double t_start, t_merged = 0.0, t_now;
+		uint64_t sharing = 0, saved_orig = 0, saved_compr = 0;
+		int stable = 0;
+		bool pageout = false;
+
+		buf = (uint8_t *)mmap(NULL, ksmbench_bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (buf == MAP_FAILED) {
+			(void)shim_usleep(100000);
+			continue;
+		}
+		stress_ksmbench_fill(args, buf, n_pages, ksmbench_dup, ksmbench_entropy);
+
+		/* let ksmd scan the region until pages_sharing settles */
+		(void)stress_ksmbench_read_ksm(&ksm_base);
+		ksm_prev = ksm_base;
+		VOID_RET(int, madvise((void *)buf, ksmbench_bytes, MADV_MERGEABLE));
+		t_start = stress_time_now();
+		while (have_ksm && keep_stressing(args)) {
+			(void)shim_nanosleep_uint64((uint64_t)(KSMBENCH_SAMPLE * STRESS_NANOSECOND));
+			if (stress_ksmbench_read_ksm(&ksm) < 0)
+				break;
+			t_now = stress_time_now();
+			if ((args->instance == 0) && !reported)
+				pr_inf("%s: %6.2fs pages_shared %" PRIu64 ", pages_sharing %"
+					PRIu64 ", full_scans %" PRIu64 "\n", args->name,
+					t_now - t_start, ksm.pages_shared,
+					ksm.pages_sharing, ksm.full_scans);
+			if (ksm.pages_sharing != ksm_prev.pages_sharing) {
+				t_merged = t_now - t_start;
+				stable = 0;
+			} else if ((ksm.pages_sharing > ksm_base.pages_sharing) &&
+				   (++stable >= KSMBENCH_STABLE)) {
+				break;
+			}
+			ksm_prev = ksm;
+			if (t_now - t_start > KSMBENCH_WINDOW)
+				break;
+		}
+		if (ksm_prev.pages_sharing > ksm_base.pages_sharing)
+			sharing = ksm_prev.pages_sharing - ksm_base.pages_sharing;
+
+		/* writing to the merged pages breaks the sharing by copy-on-write */
+		stress_ksmbench_touch(args, buf, n_pages, true, latencies, &unmerge);
+		VOID_RET(int, madvise((void *)buf, ksmbench_bytes, MADV_UNMERGEABLE));
+
+		/* push the pages out to swap, with zswap or zram they are compressed */
+#if defined(MADV_PAGEOUT)
+		stress_ksmbench_read_compr(&compr1);
+		if (madvise((void *)buf, ksmbench_bytes, MADV_PAGEOUT) == 0) {
+			stress_ksmbench_read_compr(&compr2);
+			if (compr2.orig > compr1.orig)
+				saved_orig = compr2.orig - compr1.orig;
+			if (compr2.compr > compr1.compr)
+				saved_compr = compr2.compr - compr1.compr;
+			pageout = true;
+		}
+#else
+		(void)compr1;
+		(void)compr2;
+#endif
+		stress_ksmbench_touch(args, buf, n_pages, false, latencies, &swapin);
+		(void)munmap((void *)buf, ksmbench_bytes);
+
+		if ((args->instance == 0) && !reported) {
+			pr_inf("%s: %zu pages, %" PRIu32 "%% duplicate, %" PRIu32
+				"%% random bytes per unique page\n", args->name,
+				n_pages, ksmbench_dup, ksmbench_entropy);
+			if (have_ksm) {
+				pr_inf("%s: ksm: %" PRIu64 " pages sharing (%.1f%% saved, "
+					"system wide), settled after %.2fs\n",
+					args->name, sharing,
+					100.0 * (double)sharing / (double)n_pages, t_merged);
+			}
+			pr_inf("%s: unmerge write touch latency ns: p50 %" PRIu64
+				", p99 %" PRIu64 ", max %" PRIu64 "\n", args->name,
+				unmerge.p50, unmerge.p99, unmerge.max);
+			if (saved_orig && saved_compr) {
+				pr_inf("%s: zswap/zram: %" PRIu64 "K stored in %" PRIu64
+					"K, compression ratio %.2f\n", args->name,
+					(uint64_t)(saved_orig / KB), (uint64_t)(saved_compr / KB),
+					(double)saved_orig / (double)saved_compr);
+			} else if (pageout) {
+				pr_inf("%s: zswap/zram: no compressed pages seen, is "
+					"compressed swap enabled?\n", args->name);
+			}
+			pr_inf("%s: swap in read touch latency ns: p50 %" PRIu64
+				", p99 %" PRIu64 ", max %" PRIu64 "\n", args->name,
+				swapin.p50, swapin.p99, swapin.max);
+		}
+		if (!reported) {
+			stress_misc_stats_set(args->misc_stats, 0, "ksm pages saved %",
+				100.0 * (double)sharing / (double)n_pages);
+			stress_misc_stats_set(args->misc_stats, 1, "zswap/zram compr. ratio",
+				saved_compr ? (double)saved_orig / (double)saved_compr : 0.0);
+			stress_misc_stats_set(args->misc_stats, 2, "unmerge touch p99 ns",
+				(double)unmerge.p99);
+			stress_misc_stats_set(args->misc_stats, 3, "swap in touch p99 ns",
+				(double)swapin.p99);
+			reported = true;
+		}
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (old_run >= 0)
+		VOID_RET(int, stress_ksm_run(old_run));
+	free(latencies);
+
+	return EXIT_SUCCESS;
+}
+
+stressor_info_t stress_ksmbench_info = {
+	.stressor = stress_ksmbench,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_ksmbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
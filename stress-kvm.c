@@ -18,6 +18,7 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-cpu.h"
 
 #if defined(HAVE_LINUX_KVM_H)
 #include <linux/kvm.h>
@@ -26,9 +27,31 @@
 static const stress_help_t help[] = {
 	{ NULL,	"kvm N",	"start N workers exercising /dev/kvm" },
 	{ NULL, "kvm-ops N",	"stop after N kvm create/run/destroy operations" },
+	{ NULL,	"kvm-exit-bench", "measure PIO, MMIO, HLT and hypercall VM exit round trip cost" },
+	{ NULL,	"kvm-exit-vcpus N", "sweep the VM exit benchmark over 1 to N vCPU threads" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_kvm_exit_bench(const char *opt)
+{
+	return stress_set_setting_true("kvm-exit-bench", opt);
+}
+
+static int stress_set_kvm_exit_vcpus(const char *opt)
+{
+	uint32_t kvm_exit_vcpus;
+
+	kvm_exit_vcpus = stress_get_uint32(opt);
+	stress_check_range("kvm-exit-vcpus", (uint64_t)kvm_exit_vcpus, 1, 64);
+	return stress_set_setting("kvm-exit-vcpus", TYPE_ID_UINT32, &kvm_exit_vcpus);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_kvm_exit_bench,	stress_set_kvm_exit_bench },
+	{ OPT_kvm_exit_vcpus,	stress_set_kvm_exit_vcpus },
+	{ 0,			NULL }
+};
+
 #if defined(__linux__)	&&			\
     defined(HAVE_LINUX_KVM_H) && 		\
     defined(KVM_CREATE_VM) &&			\
@@ -59,6 +82,501 @@ static const uint8_t kvm_x86_kernel[] = {
 	0xeb, 0xf1,  /* jmp    0 <_start> */
 };
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(KVM_EXIT_MMIO) &&		\
+    defined(KVM_EXIT_HLT)
+
+#define KVM_BENCH_METHODS	(4)		/* pio, mmio, hlt, hypercall */
+#define KVM_BENCH_DURATION	(0.1)		/* seconds per measurement */
+#define KVM_BENCH_TIMEOUT	(2.0)		/* seconds before a guest is deemed stuck */
+#define KVM_BENCH_VCPUS_MAX	(64)		/* most vCPU threads swept */
+#define KVM_BENCH_MEM_SIZE	(4096)		/* guest RAM */
+#define KVM_BENCH_FAULT_ADDR	(0x400)		/* exception stub, after the real mode IVT */
+#define KVM_BENCH_CODE_ADDR	(0x500)		/* guest exit loop */
+#define KVM_BENCH_PORT		(0x10)		/* guest PIO exit port */
+#define KVM_BENCH_FAULT_PORT	(0x11)		/* guest exception PIO exit port */
+#define KVM_BENCH_MMIO_ADDR	(0x2000)	/* unbacked guest physical address */
+#define KVM_BENCH_HYPERCALLS	(1024)		/* hypercalls per PIO exit */
+
+/*
+ *  16 bit real mode guest exit loops, all real mode interrupt vectors
+ *  point to an exception stub so a guest that faults, for example on
+ *  an unsupported hypercall instruction, reports it rather than spinning
+ */
+static const uint8_t kvm_bench_fault[] = {
+	0xe6, 0x11,		/* out    %al,$0x11 */
+	0xeb, 0xfc,		/* jmp    0 */
+};
+
+static const uint8_t kvm_bench_pio[] = {
+	0xe6, 0x10,		/* out    %al,$0x10 */
+	0xeb, 0xfc,		/* jmp    0 */
+};
+
+static const uint8_t kvm_bench_mmio[] = {
+	0xa2, 0x00, 0x20,	/* mov    %al,0x2000 */
+	0xeb, 0xfb,		/* jmp    0 */
+};
+
+static const uint8_t kvm_bench_hlt[] = {
+	0xf4,			/* hlt */
+	0xeb, 0xfd,		/* jmp    0 */
+};
+
+/* bytes 12..14 are patched with vmcall or vmmcall */
+static const uint8_t kvm_bench_hypercall[] = {
+	0x66, 0xb9, 0x00, 0x04, 0x00, 0x00,	/* mov    $0x400,%ecx */
+	0x66, 0xb8, 0xff, 0xff, 0x00, 0x00,	/* 6: mov $0xffff,%eax (no such hypercall) */
+	0x0f, 0x01, 0xc1,			/* vmcall */
+	0x66, 0x49,				/* dec    %ecx */
+	0x75, 0xf3,				/* jnz    6 */
+	0xe6, 0x10,				/* out    %al,$0x10 */
+	0xeb, 0xe9,				/* jmp    0 */
+};
+
+typedef struct {
+	const char *name;	/* method name */
+	const uint8_t *code;	/* guest code */
+	size_t code_size;	/* guest code size */
+	uint32_t exit_reason;	/* expected KVM_RUN exit reason */
+	uint64_t exits;		/* VM exits per KVM_RUN */
+} stress_kvm_bench_method_t;
+
+static const stress_kvm_bench_method_t kvm_bench_methods[KVM_BENCH_METHODS] = {
+	{ "pio",	kvm_bench_pio,		sizeof(kvm_bench_pio),	KVM_EXIT_IO,	1 },
+	{ "mmio",	kvm_bench_mmio,		sizeof(kvm_bench_mmio),	KVM_EXIT_MMIO,	1 },
+	{ "hlt",	kvm_bench_hlt,		sizeof(kvm_bench_hlt),	KVM_EXIT_HLT,	1 },
+	{ "hypercall",	kvm_bench_hypercall,	sizeof(kvm_bench_hypercall), KVM_EXIT_IO, KVM_BENCH_HYPERCALLS },
+};
+
+/* per vCPU thread state */
+typedef struct {
+	const stress_args_t *args;	/* stressor args */
+	const stress_kvm_bench_method_t *method; /* exit method */
+	pthread_t pthread;		/* vCPU thread */
+	int vcpu_fd;			/* vCPU fd */
+	struct kvm_run *run;		/* vCPU shared run area */
+	uint64_t exits;			/* VM exits measured */
+	double duration;		/* seconds measured */
+	bool failed;			/* unexpected exit or KVM_RUN failure */
+	bool faulted;			/* guest took an exception */
+	volatile bool done;		/* vCPU thread finished */
+} stress_kvm_bench_vcpu_t;
+
+static volatile bool kvm_bench_go;
+
+/*
+ *  stress_kvm_bench_sigusr1_handler()
+ *	kick a stuck vCPU thread out of KVM_RUN
+ */
+static void MLOCKED_TEXT stress_kvm_bench_sigusr1_handler(int signum)
+{
+	(void)signum;
+}
+
+/*
+ *  stress_kvm_bench_vcpu()
+ *	run a vCPU for KVM_BENCH_DURATION seconds counting VM exits
+ */
+static void *stress_kvm_bench_vcpu(void *arg)
+{
+	static void *nowt = NULL;
+	stress_kvm_bench_vcpu_t *vcpu = (stress_kvm_bench_vcpu_t *)arg;
+	const stress_kvm_bench_method_t *method = vcpu->method;
+	double t1, t2;
+
+	while (!kvm_bench_go)
+		(void)shim_sched_yield();
+
+	t1 = stress_time_now();
+	do {
+		int i;
+
+		for (i = 0; i < 16; i++) {
+			if (ioctl(vcpu->vcpu_fd, KVM_RUN, 0) < 0) {
+				if (errno != EINTR) {
+					pr_fail("%s: ioctl KVM_RUN failed, errno=%d (%s)\n",
+						vcpu->args->name, errno, strerror(errno));
+					vcpu->failed = true;
+				}
+				goto done;
+			}
+			if ((vcpu->run->exit_reason == KVM_EXIT_IO) &&
+			    (vcpu->run->io.port == KVM_BENCH_FAULT_PORT)) {
+				vcpu->faulted = true;
+				goto done;
+			}
+			if ((vcpu->run->exit_reason != method->exit_reason) ||
+			    ((method->exit_reason == KVM_EXIT_IO) &&
+			     (vcpu->run->io.port != KVM_BENCH_PORT)) ||
+			    ((method->exit_reason == KVM_EXIT_MMIO) &&
+			     (vcpu->run->mmio.phys_addr != KVM_BENCH_MMIO_ADDR))) {
+				pr_fail("%s: %s guest made unexpected exit, reason %" PRIu32 "\n",
+					vcpu->args->name, method->name, vcpu->run->exit_reason);
+				vcpu->failed = true;
+				goto done;
+			}
+			vcpu->exits += method->exits;
+		}
+		t2 = stress_time_now();
+	} while (((t2 - t1) < KVM_BENCH_DURATION) && keep_stressing_flag());
+done:
+	vcpu->duration = stress_time_now() - t1;
+	vcpu->done = true;
+
+	return &nowt;
+}
+
+/*
+ *  stress_kvm_bench_vcpu_init()
+ *	create a real mode vCPU starting at the guest exit loop
+ */
+static int stress_kvm_bench_vcpu_init(
+	const stress_args_t *args,
+	const int kvm_fd,
+	const int vm_fd,
+	const int id,
+	stress_kvm_bench_vcpu_t *vcpu)
+{
+	struct kvm_sregs sregs;
+	struct kvm_regs regs;
+	ssize_t run_size;
+
+	vcpu->vcpu_fd = ioctl(vm_fd, KVM_CREATE_VCPU, id);
+	if (vcpu->vcpu_fd < 0) {
+		pr_inf("%s: ioctl KVM_CREATE_VCPU failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	if (ioctl(vcpu->vcpu_fd, KVM_GET_SREGS, &sregs) < 0)
+		goto fail;
+	sregs.cs.selector = 0;
+	sregs.cs.base = 0;
+	sregs.ds.selector = 0;
+	sregs.ds.base = 0;
+	sregs.es.selector = 0;
+	sregs.es.base = 0;
+	sregs.ss.selector = 0;
+	sregs.ss.base = 0;
+	if (ioctl(vcpu->vcpu_fd, KVM_SET_SREGS, &sregs) < 0)
+		goto fail;
+
+	(void)memset(&regs, 0, sizeof(regs));
+	regs.rflags = 2;
+	regs.rip = KVM_BENCH_CODE_ADDR;
+	if (ioctl(vcpu->vcpu_fd, KVM_SET_REGS, &regs) < 0)
+		goto fail;
+
+	run_size = (ssize_t)ioctl(kvm_fd, KVM_GET_VCPU_MMAP_SIZE, 0);
+	if (run_size < 0)
+		goto fail;
+	vcpu->run = (struct kvm_run *)mmap(NULL, (size_t)run_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, vcpu->vcpu_fd, 0);
+	if (vcpu->run == MAP_FAILED) {
+		vcpu->run = NULL;
+		goto fail;
+	}
+	return 0;
+fail:
+	pr_inf("%s: failed to set up vCPU %d, errno=%d (%s)\n",
+		args->name, id, errno, strerror(errno));
+	(void)close(vcpu->vcpu_fd);
+	vcpu->vcpu_fd = -1;
+	return -1;
+}
+
+/*
+ *  stress_kvm_bench_measure()
+ *	create a VM running the method's guest on nvcpus vCPU threads,
+ *	sets mean ns per exit per vCPU and aggregate exits per second,
+ *	returns -1 if the VM could not be run, -2 on a guest failure and
+ *	-3 if the guest faulted or got stuck and the exit type is not supported
+ */
+static int stress_kvm_bench_measure(
+	const stress_args_t *args,
+	const int kvm_fd,
+	const stress_kvm_bench_method_t *method,
+	const uint32_t nvcpus,
+	stress_kvm_bench_vcpu_t *vcpus,
+	double *ns_per_exit,
+	double *exits_per_sec)
+{
+	struct kvm_userspace_memory_region kvm_mem;
+	uint8_t *vm_mem;
+	uint16_t *ivt;
+	uint32_t i, created = 0, started = 0;
+	int vm_fd, rc = -1;
+	const size_t run_size = (size_t)ioctl(kvm_fd, KVM_GET_VCPU_MMAP_SIZE, 0);
+	double ns_sum = 0.0, rate = 0.0, t_start;
+
+	vm_fd = ioctl(kvm_fd, KVM_CREATE_VM, 0);
+	if (vm_fd < 0) {
+		pr_inf("%s: ioctl KVM_CREATE_VM failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	vm_mem = (uint8_t *)mmap(NULL, KVM_BENCH_MEM_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (vm_mem == MAP_FAILED)
+		goto tidy_vm_fd;
+	ivt = (uint16_t *)vm_mem;
+	for (i = 0; i < 256; i++) {
+		ivt[(i * 2) + 0] = KVM_BENCH_FAULT_ADDR;	/* offset */
+		ivt[(i * 2) + 1] = 0;				/* segment */
+	}
+	(void)memcpy(vm_mem + KVM_BENCH_FAULT_ADDR, kvm_bench_fault, sizeof(kvm_bench_fault));
+	(void)memcpy(vm_mem + KVM_BENCH_CODE_ADDR, method->code, method->code_size);
+	if ((method->code == kvm_bench_hypercall) && !stress_cpu_is_x86())
+		vm_mem[KVM_BENCH_CODE_ADDR + 14] = 0xd9;	/* AMD vmmcall */
+
+	(void)memset(&kvm_mem, 0, sizeof(kvm_mem));
+	kvm_mem.slot = 0;
+	kvm_mem.guest_phys_addr = 0;
+	kvm_mem.memory_size = KVM_BENCH_MEM_SIZE;
+	kvm_mem.userspace_addr = (uintptr_t)vm_mem;
+	if (ioctl(vm_fd, KVM_SET_USER_MEMORY_REGION, &kvm_mem) < 0) {
+		pr_inf("%s: ioctl KVM_SET_USER_MEMORY_REGION failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto tidy_vm_mem;
+	}
+
+	kvm_bench_go = false;
+	for (created = 0; created < nvcpus; created++) {
+		stress_kvm_bench_vcpu_t *vcpu = &vcpus[created];
+
+		(void)memset(vcpu, 0, sizeof(*vcpu));
+		vcpu->args = args;
+		vcpu->method = method;
+		if (stress_kvm_bench_vcpu_init(args, kvm_fd, vm_fd, (int)created, vcpu) < 0)
+			goto tidy_vcpus;
+	}
+	for (started = 0; started < nvcpus; started++) {
+		if (pthread_create(&vcpus[started].pthread, NULL,
+				   stress_kvm_bench_vcpu, &vcpus[started]) != 0) {
+			pr_inf("%s: pthread_create failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			break;
+		}
+	}
+	kvm_bench_go = true;
+
+	/*
+	 *  A guest that neither exits nor faults, for example when a
+	 *  hypercall instruction is silently swallowed, never returns
+	 *  from KVM_RUN, so kick any vCPU threads still running well
+	 *  after the measurement time
+	 */
+	t_start = stress_time_now();
+	for (i = 0; i < started; i++) {
+		while (!vcpus[i].done &&
+		       ((stress_time_now() - t_start) < KVM_BENCH_TIMEOUT))
+			(void)shim_usleep(10000);
+	}
+	for (i = 0; i < started; i++) {
+		if (!vcpus[i].done) {
+#if defined(KVM_CAP_IMMEDIATE_EXIT)
+			vcpus[i].run->immediate_exit = 1;
+#endif
+			vcpus[i].faulted = true;
+			(void)pthread_kill(vcpus[i].pthread, SIGUSR1);
+		}
+	}
+	for (i = 0; i < started; i++)
+		(void)pthread_join(vcpus[i].pthread, NULL);
+	if (started < nvcpus)
+		goto tidy_vcpus;
+
+	for (i = 0; i < nvcpus; i++) {
+		if (vcpus[i].failed) {
+			rc = -2;
+			goto tidy_vcpus;
+		}
+		if (vcpus[i].faulted) {
+			rc = -3;
+			goto tidy_vcpus;
+		}
+		if ((vcpus[i].exits == 0) || (vcpus[i].duration <= 0.0))
+			goto tidy_vcpus;
+		ns_sum += (vcpus[i].duration * (double)STRESS_NANOSECOND) / (double)vcpus[i].exits;
+		rate += (double)vcpus[i].exits / vcpus[i].duration;
+	}
+	*ns_per_exit = ns_sum / (double)nvcpus;
+	*exits_per_sec = rate;
+	rc = 0;
+
+tidy_vcpus:
+	for (i = 0; i < created; i++) {
+		if (vcpus[i].run)
+			(void)munmap((void *)vcpus[i].run, run_size);
+		(void)close(vcpus[i].vcpu_fd);
+	}
+tidy_vm_mem:
+	(void)munmap((void *)vm_mem, KVM_BENCH_MEM_SIZE);
+tidy_vm_fd:
+	(void)close(vm_fd);
+
+	return rc;
+}
+
+/*
+ *  stress_kvm_exit_bench()
+ *	measure the VM exit to VM entry round trip of PIO, MMIO and HLT
+ *	exits to user space and of hypercalls handled in the kernel,
+ *	scaling over 1 .. N vCPU threads
+ */
+static int stress_kvm_exit_bench(const stress_args_t *args)
+{
+	uint32_t counts[16], ncounts = 0, n, max_vcpus = 0, passes = 0;
+	double ns[16][KVM_BENCH_METHODS], rate[16][KVM_BENCH_METHODS];
+	bool faulted[KVM_BENCH_METHODS];
+	stress_kvm_bench_vcpu_t *vcpus;
+	int kvm_fd, rc = EXIT_SUCCESS, j, idx = 0;
+	size_t i;
+
+	if ((kvm_fd = open("/dev/kvm", O_RDWR)) < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot open /dev/kvm, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	if (!stress_get_setting("kvm-exit-vcpus", &max_vcpus)) {
+		const int32_t cpus = stress_get_processors_online();
+
+		max_vcpus = (cpus > 0) ? (uint32_t)cpus : 1;
+	}
+	max_vcpus = STRESS_MINIMUM(max_vcpus, KVM_BENCH_VCPUS_MAX);
+#if defined(KVM_CHECK_EXTENSION) &&	\
+    defined(KVM_CAP_MAX_VCPUS)
+	{
+		const int cap = ioctl(kvm_fd, KVM_CHECK_EXTENSION, KVM_CAP_MAX_VCPUS);
+
+		if ((cap > 0) && ((uint32_t)cap < max_vcpus))
+			max_vcpus = (uint32_t)cap;
+	}
+#endif
+	for (n = 1; n < max_vcpus; n <<= 1)
+		counts[ncounts++] = n;
+	counts[ncounts++] = max_vcpus;
+
+	vcpus = (stress_kvm_bench_vcpu_t *)calloc(max_vcpus, sizeof(*vcpus));
+	if (!vcpus) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " vCPU states, skipping stressor\n",
+			args->name, max_vcpus);
+		(void)close(kvm_fd);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(ns, 0, sizeof(ns));
+	(void)memset(rate, 0, sizeof(rate));
+	(void)memset(faulted, 0, sizeof(faulted));
+
+	if (stress_sighandler(args->name, SIGUSR1, stress_kvm_bench_sigusr1_handler, NULL) < 0) {
+		free(vcpus);
+		(void)close(kvm_fd);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < ncounts) && keep_stressing(args); i++) {
+			for (j = 0; (j < KVM_BENCH_METHODS) && keep_stressing(args); j++) {
+				double t_ns = 0.0, t_rate = 0.0;
+				int ret;
+
+				if (faulted[j])
+					continue;
+				ret = stress_kvm_bench_measure(args, kvm_fd,
+					&kvm_bench_methods[j], counts[i], vcpus, &t_ns, &t_rate);
+				if (ret == -3) {
+					if (args->instance == 0)
+						pr_inf("%s: %s guest faulted or did not exit, %s exits "
+							"are not supported by this KVM\n", args->name,
+							kvm_bench_methods[j].name, kvm_bench_methods[j].name);
+					faulted[j] = true;
+					continue;
+				}
+				if (ret == -2) {
+					rc = EXIT_FAILURE;
+					goto tidy;
+				}
+				if (ret < 0) {
+					if (!keep_stressing_flag())
+						break;
+					pr_inf_skip("%s: %s exit benchmark with %" PRIu32
+						" vCPUs failed, skipping stressor\n",
+						args->name, kvm_bench_methods[j].name, counts[i]);
+					rc = EXIT_NO_RESOURCE;
+					goto tidy;
+				}
+				ns[i][j] += t_ns;
+				rate[i][j] += t_rate;
+			}
+			if (j < KVM_BENCH_METHODS)
+				break;
+		}
+		if (i < ncounts)
+			break;
+		passes++;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (passes == 0) {
+		pr_inf("%s: VM exit benchmark did not complete a pass\n", args->name);
+		goto tidy;
+	}
+	for (i = 0; i < ncounts; i++) {
+		for (j = 0; j < KVM_BENCH_METHODS; j++) {
+			ns[i][j] /= (double)passes;
+			rate[i][j] /= (double)passes;
+		}
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: VM exit round trip, ns per exit per vCPU (aggregate K exits/sec), "
+			"pio, mmio and hlt exit to user space, hypercalls return from the kernel:\n",
+			args->name);
+		pr_inf("%s: %5s %20s %20s %20s %20s\n", args->name, "vCPUs",
+			kvm_bench_methods[0].name, kvm_bench_methods[1].name,
+			kvm_bench_methods[2].name, kvm_bench_methods[3].name);
+		for (i = 0; i < ncounts; i++) {
+			char str[KVM_BENCH_METHODS][32];
+
+			for (j = 0; j < KVM_BENCH_METHODS; j++) {
+				if (faulted[j])
+					(void)shim_strlcpy(str[j], "-", sizeof(str[j]));
+				else
+					(void)snprintf(str[j], sizeof(str[j]), "%.1f (%.1fK)",
+						ns[i][j], rate[i][j] / 1000.0);
+			}
+			pr_inf("%s: %5" PRIu32 " %20s %20s %20s %20s\n", args->name,
+				counts[i], str[0], str[1], str[2], str[3]);
+		}
+	}
+
+	for (j = 0; j < KVM_BENCH_METHODS; j++) {
+		char desc[32];
+
+		if (faulted[j])
+			continue;
+		(void)snprintf(desc, sizeof(desc), "%s ns per exit, 1 vCPU",
+			kvm_bench_methods[j].name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, ns[0][j]);
+		(void)snprintf(desc, sizeof(desc), "%s exits/sec, %" PRIu32 " vCPUs",
+			kvm_bench_methods[j].name, counts[ncounts - 1]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, rate[ncounts - 1][j]);
+	}
+
+tidy:
+	free(vcpus);
+	(void)close(kvm_fd);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_kvm
  *	stress /dev/kvm
@@ -66,6 +584,21 @@ static const uint8_t kvm_x86_kernel[] = {
 static int stress_kvm(const stress_args_t *args)
 {
 	bool pr_version = false;
+	bool kvm_exit_bench = false;
+
+	(void)stress_get_setting("kvm-exit-bench", &kvm_exit_bench);
+	if (kvm_exit_bench) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(KVM_EXIT_MMIO) &&		\
+    defined(KVM_EXIT_HLT)
+		return stress_kvm_exit_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: kvm-exit-bench is not supported on this system, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -280,6 +813,7 @@ tidy_kvm_fd:
 stressor_info_t stress_kvm_info = {
 	.stressor = stress_kvm,
 	.class = CLASS_DEV | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -287,6 +821,7 @@ stressor_info_t stress_kvm_info = {
 stressor_info_t stress_kvm_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_DEV | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
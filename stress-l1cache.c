@@ -186,7 +186,8 @@ static int stress_l1cache_info_ok(
 	if (stress_get_max_cache_level(cpu_caches) < 1)
 		goto bad_cache_free;
 
-	cache = stress_get_cpu_cache(cpu_caches, 1);
+	/* use the L1 of the CPU(s) this instance is pinned to */
+	cache = stress_get_cpu_cache_affinity(cpu_caches, 1);
 	if (!cache) {
 		goto bad_cache_free;
 	}
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-ebr.h"
 
 #if defined(HAVE_SYS_QUEUE_H)
 #include <sys/queue.h>
@@ -27,6 +28,9 @@
 #define MAX_LIST_SIZE		(1000000)
 #define DEFAULT_LIST_SIZE	(5000)
 
+#define MIN_LIST_THREADS	(1)
+#define MAX_LIST_THREADS	(64)
+
 struct list_entry;
 
 typedef void (*stress_list_func)(const stress_args_t *args,
@@ -45,6 +49,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"list-ops N",	 "stop after N bogo list operations" },
 	{ NULL,	"list-method M", "select tlistmethod, all, circleq, insque, list, slist, stailq, tailq" },
 	{ NULL,	"list-size N",	 "N is the number of items in the list" },
+	{ NULL,	"list-threads N", "N threads share one RCU style list" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -162,6 +167,20 @@ static int stress_set_list_size(const char *opt)
 	return stress_set_setting("list-size", TYPE_ID_UINT64, &list_size);
 }
 
+/*
+ *  stress_set_list_threads()
+ *	set number of threads for the shared list mode
+ */
+static int stress_set_list_threads(const char *opt)
+{
+	uint32_t list_threads;
+
+	list_threads = stress_get_uint32(opt);
+	stress_check_range("list-threads", (uint64_t)list_threads,
+		MIN_LIST_THREADS, MAX_LIST_THREADS);
+	return stress_set_setting("list-threads", TYPE_ID_UINT32, &list_threads);
+}
+
 #if defined(HAVE_SYS_QUEUE_H)
 
 /*
@@ -489,6 +508,7 @@ static int stress_set_list_method(const char *name)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_list_method,	stress_set_list_method },
 	{ OPT_list_size,	stress_set_list_size },
+	{ OPT_list_threads,	stress_set_list_threads },
 	{ 0,			NULL }
 };
 
@@ -506,6 +526,352 @@ static inline uint64_t ror64(const uint64_t val)
 	return (tmp | bit0);
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+
+#define LIST_STEP		(0.5)	/* seconds per thread count */
+#define LIST_SAMPLES		(32)	/* reclamation samples per step */
+#define LIST_MAX_COUNTS		(8)	/* thread counts in the sweep */
+
+/*
+ *  RCU style sorted list, readers traverse without locks and
+ *  writers are serialized by a mutex and publish with release
+ *  stores. Unlinked nodes keep their next pointer so a reader
+ *  on a deleted node can still walk on, they are retired and
+ *  free'd once all readers that could see them have finished
+ */
+typedef struct rcu_list_node {
+	uint64_t value;
+	struct rcu_list_node *next;
+} rcu_list_node_t;
+
+typedef struct {
+	rcu_list_node_t head;		/* value 0 sentinel */
+	pthread_mutex_t lock;		/* writer lock */
+	stress_ebr_t ebr;		/* node reclamation */
+} rcu_list_t;
+
+typedef struct {
+	rcu_list_t *list;		/* shared list */
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	size_t tid;			/* thread id in the ebr domain */
+	uint64_t range;			/* values are 1..range */
+	uint64_t seed;			/* per thread random state */
+	uint64_t ops;			/* operations completed */
+	int64_t delta;			/* inserts - deletes */
+	volatile bool *stop;		/* stop flag */
+} ALIGN64 rcu_list_thread_t;
+
+/*
+ *  rcu_list_rand()
+ *	per thread xorshift random values
+ */
+static inline uint64_t rcu_list_rand(uint64_t *seed)
+{
+	register uint64_t x = *seed;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*seed = x;
+	return x;
+}
+
+static void rcu_list_node_free(void *ptr)
+{
+	free(ptr);
+}
+
+/*
+ *  rcu_list_search()
+ *	lockless reader
+ */
+static bool rcu_list_search(rcu_list_t *list, const uint64_t value)
+{
+	const rcu_list_node_t *node = __atomic_load_n(&list->head.next, __ATOMIC_ACQUIRE);
+
+	while (node && (node->value < value))
+		node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+	return node && (node->value == value);
+}
+
+/*
+ *  rcu_list_pred()
+ *	find the node before value, writer lock must be held
+ */
+static rcu_list_node_t *rcu_list_pred(rcu_list_t *list, const uint64_t value)
+{
+	rcu_list_node_t *pred = &list->head;
+
+	while (pred->next && (pred->next->value < value))
+		pred = pred->next;
+	return pred;
+}
+
+/*
+ *  rcu_list_insert()
+ *	insert value, returns 1 if inserted, 0 if already present
+ *	and -1 if out of memory
+ */
+static int rcu_list_insert(rcu_list_t *list, const uint64_t value)
+{
+	rcu_list_node_t *pred, *node;
+
+	/* allocate outside the lock to keep the writer section short */
+	node = (rcu_list_node_t *)malloc(sizeof(*node));
+	if (!node)
+		return -1;
+	node->value = value;
+
+	(void)pthread_mutex_lock(&list->lock);
+	pred = rcu_list_pred(list, value);
+	if (pred->next && (pred->next->value == value)) {
+		(void)pthread_mutex_unlock(&list->lock);
+		free(node);
+		return 0;
+	}
+	node->next = pred->next;
+	__atomic_store_n(&pred->next, node, __ATOMIC_RELEASE);
+	(void)pthread_mutex_unlock(&list->lock);
+	return 1;
+}
+
+/*
+ *  rcu_list_delete()
+ *	unlink value and retire it, returns true if deleted
+ */
+static bool rcu_list_delete(rcu_list_t *list, const uint64_t value, const size_t tid)
+{
+	rcu_list_node_t *pred, *node;
+
+	(void)pthread_mutex_lock(&list->lock);
+	pred = rcu_list_pred(list, value);
+	node = pred->next;
+	if (!node || (node->value != value)) {
+		(void)pthread_mutex_unlock(&list->lock);
+		return false;
+	}
+	__atomic_store_n(&pred->next, node->next, __ATOMIC_RELEASE);
+	(void)pthread_mutex_unlock(&list->lock);
+	stress_ebr_retire(&list->ebr, tid, node, sizeof(*node));
+	return true;
+}
+
+/*
+ *  rcu_list_thread()
+ *	mixed workload, 80% search, 10% insert, 10% delete
+ */
+static void *rcu_list_thread(void *arg)
+{
+	rcu_list_thread_t *t = (rcu_list_thread_t *)arg;
+	rcu_list_t *list = t->list;
+	uint64_t ops = 0;
+	int64_t delta = 0;
+
+	while (!__atomic_load_n(t->stop, __ATOMIC_RELAXED)) {
+		const uint64_t r = rcu_list_rand(&t->seed);
+		const uint64_t value = 1 + ((r >> 8) % t->range);
+		const uint32_t op = (uint32_t)(r & 0xff) % 10;
+
+		stress_ebr_enter(&list->ebr, t->tid);
+		if (op == 0) {
+			if (rcu_list_insert(list, value) > 0)
+				delta++;
+		} else if (op == 1) {
+			if (rcu_list_delete(list, value, t->tid))
+				delta--;
+		} else {
+			(void)rcu_list_search(list, value);
+		}
+		stress_ebr_exit(&list->ebr, t->tid);
+		ops++;
+	}
+	t->ops = ops;
+	t->delta = delta;
+	return NULL;
+}
+
+/*
+ *  rcu_list_check()
+ *	with all threads stopped check the list is strictly
+ *	ordered and count the nodes
+ */
+static bool rcu_list_check(rcu_list_t *list, size_t *count)
+{
+	const rcu_list_node_t *node;
+	uint64_t prev = 0;
+	bool ok = true;
+
+	*count = 0;
+	for (node = list->head.next; node; node = node->next) {
+		if (node->value <= prev)
+			ok = false;
+		prev = node->value;
+		(*count)++;
+	}
+	return ok;
+}
+
+/*
+ *  rcu_list_destroy()
+ *	free all the nodes, all threads must have stopped
+ */
+static void rcu_list_destroy(rcu_list_t *list)
+{
+	rcu_list_node_t *node = list->head.next;
+
+	while (node) {
+		rcu_list_node_t *next = node->next;
+
+		free(node);
+		node = next;
+	}
+	list->head.next = NULL;
+	stress_ebr_destroy(&list->ebr);
+	(void)pthread_mutex_destroy(&list->lock);
+}
+
+/*
+ *  stress_list_concurrent()
+ *	N threads insert, search and delete on one shared RCU style
+ *	list with epoch based reclamation of deleted nodes, stepping
+ *	the thread count 1, 2, 4 .. N to show the scaling
+ */
+static int stress_list_concurrent(
+	const stress_args_t *args,
+	const size_t n,
+	const uint32_t max_threads)
+{
+	rcu_list_t list;
+	rcu_list_node_t *tail;
+	rcu_list_thread_t *threads;
+	stress_ebr_stats_t stats[LIST_MAX_COUNTS];
+	const size_t threads_size = sizeof(*threads) * max_threads;
+	const uint64_t range = (uint64_t)n * 2;
+	uint32_t counts[LIST_MAX_COUNTS], n_counts = 0, c, i;
+	uint64_t value, seed = stress_mwc64() | 1;
+	int64_t expected = 0;
+	size_t count;
+	volatile bool stop = false;
+	int rc = EXIT_SUCCESS;
+	char desc[80];
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(&list, 0, sizeof(list));
+	if (pthread_mutex_init(&list.lock, NULL) != 0) {
+		pr_inf_skip("%s: cannot initialize list mutex, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (stress_ebr_init(&list.ebr, max_threads, rcu_list_node_free) < 0) {
+		pr_inf_skip("%s: cannot initialize epoch reclamation, skipping stressor\n", args->name);
+		(void)pthread_mutex_destroy(&list.lock);
+		return EXIT_NO_RESOURCE;
+	}
+	threads = (rcu_list_thread_t *)mmap(NULL, threads_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap thread data, skipping stressor\n", args->name);
+		rcu_list_destroy(&list);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* half fill the value range, built in order to avoid O(n^2) inserts */
+	tail = &list.head;
+	for (value = 1; value <= range; value++) {
+		rcu_list_node_t *node;
+
+		if (rcu_list_rand(&seed) & 1)
+			continue;
+		node = (rcu_list_node_t *)malloc(sizeof(*node));
+		if (!node) {
+			pr_inf_skip("%s: out of memory filling the list, skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+		node->value = value;
+		node->next = NULL;
+		tail->next = node;
+		tail = node;
+		expected++;
+	}
+
+	for (c = 1; (c < max_threads) && (n_counts < LIST_MAX_COUNTS - 1); c *= 2)
+		counts[n_counts++] = c;
+	counts[n_counts++] = max_threads;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (c = 0; (c < n_counts) && keep_stressing(args); c++) {
+			stress_ebr_stats_t *st = &stats[c];
+			double t_start;
+			size_t k;
+			uint64_t ops = 0;
+
+			stop = false;
+			for (i = 0; i < counts[c]; i++) {
+				rcu_list_thread_t *t = &threads[i];
+
+				t->list = &list;
+				t->tid = i;
+				t->range = range;
+				t->seed = stress_mwc64() | 1;
+				t->ops = 0;
+				t->delta = 0;
+				t->stop = &stop;
+				t->ret = pthread_create(&t->pthread, NULL, rcu_list_thread, (void *)t);
+			}
+			t_start = stress_time_now();
+			for (k = 0; k < LIST_SAMPLES; k++) {
+				size_t pending;
+
+				(void)shim_usleep((uint64_t)(LIST_STEP * 1000000.0 / LIST_SAMPLES));
+				pending = stress_ebr_pending(&list.ebr);
+				if (pending > st->retired_peak)
+					st->retired_peak = pending;
+				if (!keep_stressing_flag())
+					break;
+			}
+			stop = true;
+			for (i = 0; i < counts[c]; i++) {
+				rcu_list_thread_t *t = &threads[i];
+
+				if (t->ret)
+					continue;
+				(void)pthread_join(t->pthread, NULL);
+				ops += t->ops;
+				expected += t->delta;
+			}
+			st->duration += stress_time_now() - t_start;
+			stress_ebr_drain(&list.ebr);
+			st->threads = counts[c];
+			st->ops += ops;
+
+			if (!rcu_list_check(&list, &count) || ((int64_t)count != expected)) {
+				pr_fail("%s: shared list corrupt, %zu nodes, expected %" PRId64 "\n",
+					args->name, count, expected);
+				rc = EXIT_FAILURE;
+			}
+			st->live = count * sizeof(rcu_list_node_t);
+			add_counter(args, ops);
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	(void)snprintf(desc, sizeof(desc), "shared RCU style list, %" PRIu64 " values, 80%% search, "
+		"10%% insert, 10%% delete", range);
+	(void)stress_ebr_stats_report(args, desc, stats, n_counts, 0);
+
+tidy:
+	(void)munmap((void *)threads, threads_size);
+	rcu_list_destroy(&list);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_list()
  *	stress list
@@ -518,6 +884,7 @@ static int stress_list(const stress_args_t *args)
 	struct sigaction old_action;
 	int ret;
 	stress_list_method_info_t const *info = &list_methods[0];
+	uint32_t list_threads = 0;
 
 	(void)stress_get_setting("list-method", &info);
 
@@ -529,6 +896,18 @@ static int stress_list(const stress_args_t *args)
 	}
 	n = (size_t)list_size;
 
+	(void)stress_get_setting("list-threads", &list_threads);
+	if (list_threads) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+		return stress_list_concurrent(args, n, list_threads);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --list-threads requires pthread and atomic "
+				"support, using private lists\n", args->name);
+#endif
+	}
+
 	entries = calloc(n, sizeof(*entries));
 	if (!entries) {
 		pr_fail("%s: malloc failed, out of memory\n", args->name);
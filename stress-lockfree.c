@@ -0,0 +1,760 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+
+#define MIN_LOCKFREE_WORKERS	(1)
+#define MAX_LOCKFREE_WORKERS	(64)
+#define DEFAULT_LOCKFREE_WORKERS (2)
+
+/* producers, consumers and the parent that drains at the end */
+#define LOCKFREE_SLOTS		((2 * MAX_LOCKFREE_WORKERS) + 1)
+#define LOCKFREE_HAZARDS	(2)			/* hazard pointers per slot */
+#define LOCKFREE_RETIRED	(2 * LOCKFREE_HAZARDS * LOCKFREE_SLOTS)
+#define LOCKFREE_NODES		((LOCKFREE_SLOTS * LOCKFREE_RETIRED) + 4096)
+#define LOCKFREE_RING_SIZE	(1024)			/* power of 2 */
+#define LOCKFREE_STEP		(0.25)			/* seconds per method */
+#define LOCKFREE_SAMPLE		(16)			/* time every 16th op */
+
+#define LOCKFREE_NIL		(0)			/* node index 0 is unused */
+
+static const stress_help_t help[] = {
+	{ NULL,	"lockfree N",		"start N workers exercising lock-free queues and stacks" },
+	{ NULL,	"lockfree-consumers N",	"number of consumer processes, default 2" },
+	{ NULL,	"lockfree-method M",	"mpmc, treiber, msqueue or all, default is all" },
+	{ NULL,	"lockfree-ops N",	"stop after N push and pop operations" },
+	{ NULL,	"lockfree-producers N",	"number of producer processes, default 2" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const lockfree_methods[] = {
+	"all",
+	"mpmc",
+	"treiber",
+	"msqueue",
+};
+
+static int stress_set_lockfree_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(lockfree_methods); i++) {
+		if (!strcmp(opt, lockfree_methods[i]))
+			return stress_set_setting("lockfree-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "lockfree-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(lockfree_methods); i++)
+		(void)fprintf(stderr, " %s", lockfree_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_lockfree_workers(const char *opt, const char *name)
+{
+	uint32_t workers;
+
+	workers = stress_get_uint32(opt);
+	stress_check_range(name, (uint64_t)workers,
+		MIN_LOCKFREE_WORKERS, MAX_LOCKFREE_WORKERS);
+	return stress_set_setting(name, TYPE_ID_UINT32, &workers);
+}
+
+static int stress_set_lockfree_consumers(const char *opt)
+{
+	return stress_set_lockfree_workers(opt, "lockfree-consumers");
+}
+
+static int stress_set_lockfree_producers(const char *opt)
+{
+	return stress_set_lockfree_workers(opt, "lockfree-producers");
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_lockfree_consumers,	stress_set_lockfree_consumers },
+	{ OPT_lockfree_method,		stress_set_lockfree_method },
+	{ OPT_lockfree_producers,	stress_set_lockfree_producers },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_ATOMIC)
+
+#define LOCKFREE_METHODS	(SIZEOF_ARRAY(lockfree_methods) - 1)
+
+/* pool node, nodes are never unmapped so stale reads are harmless */
+typedef struct {
+	uint64_t value;
+	uint32_t next;		/* next in the stack or queue */
+	uint32_t free_next;	/* next in the free pool */
+} stress_lockfree_node_t;
+
+/* bounded MPMC ring cell, seq tells producers and consumers its state */
+typedef struct {
+	uint64_t seq;
+	uint64_t value;
+} stress_lockfree_cell_t;
+
+/* per process hazard pointers, one cache line each */
+typedef struct {
+	uint32_t hp[LOCKFREE_HAZARDS];
+} ALIGN64 stress_lockfree_hazard_t;
+
+/* per process results */
+typedef struct {
+	uint64_t ops;		/* successful pushes or pops */
+	uint64_t cas;		/* compare and swap attempts */
+	uint64_t cas_fail;	/* failed compare and swaps */
+	uint64_t retries;	/* full or empty retries */
+	uint64_t count;		/* items pushed or popped */
+	uint64_t sum;		/* sum of values pushed or popped */
+	uint64_t lat_ns;	/* sampled op latency total */
+	uint64_t lat_samples;
+	uint64_t lat_max;
+} ALIGN64 stress_lockfree_worker_t;
+
+typedef struct {
+	uint64_t enq_pos ALIGN64;		/* MPMC ring */
+	uint64_t deq_pos ALIGN64;
+	uint64_t stack ALIGN64;			/* Treiber stack, tag:index */
+	uint64_t pool ALIGN64;			/* free node pool, tag:index */
+	uint32_t head ALIGN64;			/* Michael-Scott queue */
+	uint32_t tail ALIGN64;
+	volatile bool stop ALIGN64;
+	uint32_t n_slots;			/* hazard slots in use */
+	stress_lockfree_hazard_t hazards[LOCKFREE_SLOTS];
+	stress_lockfree_worker_t workers[LOCKFREE_SLOTS];
+	stress_lockfree_cell_t ring[LOCKFREE_RING_SIZE] ALIGN64;
+	stress_lockfree_node_t nodes[LOCKFREE_NODES] ALIGN64;
+} stress_lockfree_t;
+
+/* per process state */
+typedef struct {
+	stress_lockfree_t *lf;
+	stress_lockfree_worker_t w;		/* local copy of the results */
+	uint32_t slot;				/* hazard and results slot */
+	uint32_t n_retired;
+	uint32_t retired[LOCKFREE_RETIRED];
+	uint64_t hazard_map[(LOCKFREE_NODES + 63) / 64];
+} stress_lockfree_ctxt_t;
+
+typedef struct {
+	void (*init)(stress_lockfree_t *lf);
+	bool (*push)(stress_lockfree_ctxt_t *c, const uint64_t value);
+	bool (*pop)(stress_lockfree_ctxt_t *c, uint64_t *value);
+} stress_lockfree_impl_t;
+
+/* totals per method over all the rounds */
+typedef struct {
+	uint64_t ops;
+	uint64_t cas;
+	uint64_t cas_fail;
+	uint64_t lat_ns;
+	uint64_t lat_samples;
+	uint64_t lat_max;
+	double duration;
+} stress_lockfree_stats_t;
+
+#define TAGGED(tag, idx)	(((uint64_t)(tag) << 32) | (uint64_t)(idx))
+#define TAGGED_IDX(t)		((uint32_t)((t) & 0xffffffffULL))
+#define TAGGED_TAG(t)		((uint32_t)((t) >> 32))
+
+static inline bool stress_lockfree_cas64(
+	stress_lockfree_ctxt_t *c,
+	uint64_t *ptr,
+	uint64_t *expected,
+	const uint64_t desired)
+{
+	c->w.cas++;
+	if (__atomic_compare_exchange_n(ptr, expected, desired, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return true;
+	c->w.cas_fail++;
+	return false;
+}
+
+static inline bool stress_lockfree_cas32(
+	stress_lockfree_ctxt_t *c,
+	uint32_t *ptr,
+	uint32_t expected,
+	const uint32_t desired)
+{
+	c->w.cas++;
+	if (__atomic_compare_exchange_n(ptr, &expected, desired, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return true;
+	c->w.cas_fail++;
+	return false;
+}
+
+/*
+ *  tagged index stack, the tag changes on every successful update
+ *  so a pop that read a recycled head fails its CAS, the ABA problem
+ */
+static void stress_lockfree_tagged_push(
+	stress_lockfree_ctxt_t *c,
+	uint64_t *top,
+	uint32_t *next,
+	const uint32_t idx)
+{
+	uint64_t old = __atomic_load_n(top, __ATOMIC_ACQUIRE);
+
+	do {
+		*next = TAGGED_IDX(old);
+	} while (!stress_lockfree_cas64(c, top, &old, TAGGED(TAGGED_TAG(old) + 1, idx)));
+}
+
+static uint32_t stress_lockfree_pool_alloc(stress_lockfree_ctxt_t *c)
+{
+	stress_lockfree_t *lf = c->lf;
+	uint64_t old = __atomic_load_n(&lf->pool, __ATOMIC_ACQUIRE);
+
+	for (;;) {
+		const uint32_t idx = TAGGED_IDX(old);
+		uint32_t next;
+
+		if (idx == LOCKFREE_NIL)
+			return LOCKFREE_NIL;
+		next = __atomic_load_n(&lf->nodes[idx].free_next, __ATOMIC_RELAXED);
+		if (stress_lockfree_cas64(c, &lf->pool, &old, TAGGED(TAGGED_TAG(old) + 1, next)))
+			return idx;
+	}
+}
+
+static void stress_lockfree_pool_free(stress_lockfree_ctxt_t *c, const uint32_t idx)
+{
+	stress_lockfree_tagged_push(c, &c->lf->pool, &c->lf->nodes[idx].free_next, idx);
+}
+
+static void stress_lockfree_pool_init(stress_lockfree_t *lf)
+{
+	uint32_t i;
+
+	for (i = 1; i < LOCKFREE_NODES - 1; i++)
+		lf->nodes[i].free_next = i + 1;
+	lf->nodes[LOCKFREE_NODES - 1].free_next = LOCKFREE_NIL;
+	lf->pool = TAGGED(0, 1);
+}
+
+/*
+ *  bounded MPMC ring queue, each cell carries a sequence number so
+ *  producers and consumers only contend on the enqueue and dequeue
+ *  positions
+ */
+static void stress_lockfree_mpmc_init(stress_lockfree_t *lf)
+{
+	uint64_t i;
+
+	for (i = 0; i < LOCKFREE_RING_SIZE; i++)
+		lf->ring[i].seq = i;
+	lf->enq_pos = 0;
+	lf->deq_pos = 0;
+}
+
+static bool stress_lockfree_mpmc_push(stress_lockfree_ctxt_t *c, const uint64_t value)
+{
+	stress_lockfree_t *lf = c->lf;
+	uint64_t pos = __atomic_load_n(&lf->enq_pos, __ATOMIC_RELAXED);
+	stress_lockfree_cell_t *cell;
+
+	for (;;) {
+		int64_t diff;
+
+		cell = &lf->ring[pos & (LOCKFREE_RING_SIZE - 1)];
+		diff = (int64_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (int64_t)pos;
+		if (diff == 0) {
+			if (stress_lockfree_cas64(c, &lf->enq_pos, &pos, pos + 1))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = __atomic_load_n(&lf->enq_pos, __ATOMIC_RELAXED);
+		}
+	}
+	cell->value = value;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static bool stress_lockfree_mpmc_pop(stress_lockfree_ctxt_t *c, uint64_t *value)
+{
+	stress_lockfree_t *lf = c->lf;
+	uint64_t pos = __atomic_load_n(&lf->deq_pos, __ATOMIC_RELAXED);
+	stress_lockfree_cell_t *cell;
+
+	for (;;) {
+		int64_t diff;
+
+		cell = &lf->ring[pos & (LOCKFREE_RING_SIZE - 1)];
+		diff = (int64_t)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (int64_t)(pos + 1);
+		if (diff == 0) {
+			if (stress_lockfree_cas64(c, &lf->deq_pos, &pos, pos + 1))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = __atomic_load_n(&lf->deq_pos, __ATOMIC_RELAXED);
+		}
+	}
+	*value = cell->value;
+	__atomic_store_n(&cell->seq, pos + LOCKFREE_RING_SIZE, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/*
+ *  Treiber stack with a tagged head for ABA protection
+ */
+static void stress_lockfree_treiber_init(stress_lockfree_t *lf)
+{
+	stress_lockfree_pool_init(lf);
+	lf->stack = TAGGED(0, LOCKFREE_NIL);
+}
+
+static bool stress_lockfree_treiber_push(stress_lockfree_ctxt_t *c, const uint64_t value)
+{
+	stress_lockfree_t *lf = c->lf;
+	const uint32_t idx = stress_lockfree_pool_alloc(c);
+
+	if (idx == LOCKFREE_NIL)
+		return false;
+	lf->nodes[idx].value = value;
+	stress_lockfree_tagged_push(c, &lf->stack, &lf->nodes[idx].next, idx);
+
+	return true;
+}
+
+static bool stress_lockfree_treiber_pop(stress_lockfree_ctxt_t *c, uint64_t *value)
+{
+	stress_lockfree_t *lf = c->lf;
+	uint64_t old = __atomic_load_n(&lf->stack, __ATOMIC_ACQUIRE);
+	uint32_t idx;
+
+	for (;;) {
+		uint32_t next;
+
+		idx = TAGGED_IDX(old);
+		if (idx == LOCKFREE_NIL)
+			return false;
+		next = __atomic_load_n(&lf->nodes[idx].next, __ATOMIC_RELAXED);
+		if (stress_lockfree_cas64(c, &lf->stack, &old, TAGGED(TAGGED_TAG(old) + 1, next)))
+			break;
+	}
+	*value = lf->nodes[idx].value;
+	stress_lockfree_pool_free(c, idx);
+
+	return true;
+}
+
+/*
+ *  Michael-Scott queue, dequeued nodes are retired and only go back
+ *  to the pool once no hazard pointer refers to them
+ */
+static void stress_lockfree_msqueue_init(stress_lockfree_t *lf)
+{
+	uint32_t dummy;
+
+	stress_lockfree_pool_init(lf);
+	/* the first pool node becomes the dummy node */
+	dummy = TAGGED_IDX(lf->pool);
+	lf->pool = TAGGED(1, lf->nodes[dummy].free_next);
+	lf->nodes[dummy].next = LOCKFREE_NIL;
+	lf->head = dummy;
+	lf->tail = dummy;
+}
+
+static inline uint32_t stress_lockfree_protect(
+	stress_lockfree_ctxt_t *c,
+	const int hazard,
+	uint32_t *src)
+{
+	uint32_t *hp = &c->lf->hazards[c->slot].hp[hazard];
+	uint32_t idx;
+
+	do {
+		idx = __atomic_load_n(src, __ATOMIC_ACQUIRE);
+		__atomic_store_n(hp, idx, __ATOMIC_SEQ_CST);
+	} while (__atomic_load_n(src, __ATOMIC_SEQ_CST) != idx);
+
+	return idx;
+}
+
+static void stress_lockfree_clear_hazards(stress_lockfree_ctxt_t *c)
+{
+	stress_lockfree_hazard_t *h = &c->lf->hazards[c->slot];
+	int i;
+
+	for (i = 0; i < LOCKFREE_HAZARDS; i++)
+		__atomic_store_n(&h->hp[i], LOCKFREE_NIL, __ATOMIC_RELEASE);
+}
+
+/*
+ *  stress_lockfree_retire()
+ *	queue a dequeued node and, once the retired list is full, free
+ *	every retired node that is not protected by a hazard pointer
+ */
+static void stress_lockfree_retire(stress_lockfree_ctxt_t *c, const uint32_t idx)
+{
+	stress_lockfree_t *lf = c->lf;
+	uint32_t i, j, n_hazards = 0, kept = 0;
+	uint32_t hazards[LOCKFREE_SLOTS * LOCKFREE_HAZARDS];
+
+	c->retired[c->n_retired++] = idx;
+	if (c->n_retired < 2 * LOCKFREE_HAZARDS * lf->n_slots)
+		return;
+
+	for (i = 0; i < lf->n_slots; i++) {
+		for (j = 0; j < LOCKFREE_HAZARDS; j++) {
+			const uint32_t hp = __atomic_load_n(&lf->hazards[i].hp[j], __ATOMIC_SEQ_CST);
+
+			if (hp != LOCKFREE_NIL) {
+				c->hazard_map[hp / 64] |= 1ULL << (hp & 63);
+				hazards[n_hazards++] = hp;
+			}
+		}
+	}
+	for (i = 0; i < c->n_retired; i++) {
+		const uint32_t r = c->retired[i];
+
+		if (c->hazard_map[r / 64] & (1ULL << (r & 63)))
+			c->retired[kept++] = r;
+		else
+			stress_lockfree_pool_free(c, r);
+	}
+	c->n_retired = kept;
+	for (i = 0; i < n_hazards; i++)
+		c->hazard_map[hazards[i] / 64] = 0;
+}
+
+static bool stress_lockfree_msqueue_push(stress_lockfree_ctxt_t *c, const uint64_t value)
+{
+	stress_lockfree_t *lf = c->lf;
+	const uint32_t idx = stress_lockfree_pool_alloc(c);
+
+	if (idx == LOCKFREE_NIL)
+		return false;
+	lf->nodes[idx].value = value;
+	__atomic_store_n(&lf->nodes[idx].next, LOCKFREE_NIL, __ATOMIC_RELAXED);
+
+	for (;;) {
+		const uint32_t tail = stress_lockfree_protect(c, 0, &lf->tail);
+		const uint32_t next = __atomic_load_n(&lf->nodes[tail].next, __ATOMIC_ACQUIRE);
+
+		if (tail != __atomic_load_n(&lf->tail, __ATOMIC_ACQUIRE))
+			continue;
+		if (next != LOCKFREE_NIL) {
+			/* tail is lagging, help it along */
+			(void)stress_lockfree_cas32(c, &lf->tail, tail, next);
+			continue;
+		}
+		if (stress_lockfree_cas32(c, &lf->nodes[tail].next, LOCKFREE_NIL, idx)) {
+			(void)stress_lockfree_cas32(c, &lf->tail, tail, idx);
+			break;
+		}
+	}
+	stress_lockfree_clear_hazards(c);
+
+	return true;
+}
+
+static bool stress_lockfree_msqueue_pop(stress_lockfree_ctxt_t *c, uint64_t *value)
+{
+	stress_lockfree_t *lf = c->lf;
+	uint32_t head;
+
+	for (;;) {
+		uint32_t tail, next;
+
+		head = stress_lockfree_protect(c, 0, &lf->head);
+		tail = __atomic_load_n(&lf->tail, __ATOMIC_ACQUIRE);
+		next = stress_lockfree_protect(c, 1, &lf->nodes[head].next);
+		if (head != __atomic_load_n(&lf->head, __ATOMIC_SEQ_CST))
+			continue;
+		if (next == LOCKFREE_NIL) {
+			stress_lockfree_clear_hazards(c);
+			return false;
+		}
+		if (head == tail) {
+			(void)stress_lockfree_cas32(c, &lf->tail, tail, next);
+			continue;
+		}
+		*value = lf->nodes[next].value;
+		if (stress_lockfree_cas32(c, &lf->head, head, next))
+			break;
+	}
+	stress_lockfree_clear_hazards(c);
+	stress_lockfree_retire(c, head);
+
+	return true;
+}
+
+/* same order as lockfree_methods[] without "all" */
+static const stress_lockfree_impl_t lockfree_impls[] = {
+	{ stress_lockfree_mpmc_init,	stress_lockfree_mpmc_push,	stress_lockfree_mpmc_pop },
+	{ stress_lockfree_treiber_init,	stress_lockfree_treiber_push,	stress_lockfree_treiber_pop },
+	{ stress_lockfree_msqueue_init,	stress_lockfree_msqueue_push,	stress_lockfree_msqueue_pop },
+};
+
+/*
+ *  stress_lockfree_worker()
+ *	push or pop as fast as possible until told to stop, timing
+ *	every LOCKFREE_SAMPLE'th operation
+ */
+static void stress_lockfree_worker(
+	stress_lockfree_ctxt_t *c,
+	const stress_lockfree_impl_t *impl,
+	const bool producer)
+{
+	stress_lockfree_t *lf = c->lf;
+	uint64_t seq = 0;
+
+	while (!lf->stop && keep_stressing_flag()) {
+		const bool sample = ((seq & (LOCKFREE_SAMPLE - 1)) == 0);
+		uint64_t t = 0, value = 0;
+		bool ok;
+
+		if (sample)
+			t = stress_latency_now();
+		if (producer) {
+			value = ((uint64_t)(c->slot + 1) << 40) | (c->w.count + 1);
+			ok = impl->push(c, value);
+		} else {
+			ok = impl->pop(c, &value);
+		}
+		if (!ok) {
+			c->w.retries++;
+			(void)shim_sched_yield();
+			continue;
+		}
+		if (sample) {
+			const uint64_t lat = stress_latency_now() - t;
+
+			c->w.lat_ns += lat;
+			c->w.lat_samples++;
+			if (c->w.lat_max < lat)
+				c->w.lat_max = lat;
+		}
+		c->w.ops++;
+		c->w.count++;
+		c->w.sum += value;
+		seq++;
+	}
+	lf->workers[c->slot] = c->w;
+}
+
+/*
+ *  stress_lockfree_round()
+ *	run producers and consumers on one method for LOCKFREE_STEP
+ *	seconds, drain what is left and check nothing was lost
+ */
+static int stress_lockfree_round(
+	const stress_args_t *args,
+	stress_lockfree_t *lf,
+	stress_lockfree_ctxt_t *c,
+	const size_t method,
+	const uint32_t producers,
+	const uint32_t consumers,
+	stress_lockfree_stats_t *stats)
+{
+	const stress_lockfree_impl_t *impl = &lockfree_impls[method];
+	const uint32_t n_workers = producers + consumers;
+	pid_t pids[2 * MAX_LOCKFREE_WORKERS];
+	uint64_t pushed = 0, pushed_sum = 0, popped = 0, popped_sum = 0, ops = 0, value;
+	uint32_t i, started = 0;
+	int rc = EXIT_SUCCESS;
+	double t_start;
+
+	(void)memset(lf->hazards, 0, sizeof(lf->hazards));
+	(void)memset(lf->workers, 0, sizeof(lf->workers));
+	lf->stop = false;
+	lf->n_slots = n_workers + 1;
+	impl->init(lf);
+
+	t_start = stress_time_now();
+	for (i = 0; i < n_workers; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			break;
+		} else if (pids[i] == 0) {
+			stress_parent_died_alarm();
+			(void)sched_settings_apply(true);
+
+			(void)memset(&c->w, 0, sizeof(c->w));
+			c->slot = i;
+			c->n_retired = 0;
+			stress_lockfree_worker(c, impl, i < producers);
+			_exit(0);
+		}
+		started++;
+	}
+	if (started == n_workers)
+		(void)shim_usleep((uint64_t)(LOCKFREE_STEP * 1000000.0));
+	lf->stop = true;
+	shim_mb();
+	for (i = 0; i < started; i++) {
+		int status;
+
+		(void)waitpid(pids[i], &status, 0);
+	}
+	stats->duration += stress_time_now() - t_start;
+
+	if (started < n_workers) {
+		pr_inf_skip("%s: cannot fork %" PRIu32 " workers, errno=%d (%s), "
+			"skipping stressor\n", args->name, n_workers, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = 0; i < n_workers; i++) {
+		const stress_lockfree_worker_t *w = &lf->workers[i];
+
+		if (i < producers) {
+			pushed += w->count;
+			pushed_sum += w->sum;
+		} else {
+			popped += w->count;
+			popped_sum += w->sum;
+		}
+		ops += w->ops;
+		stats->cas += w->cas;
+		stats->cas_fail += w->cas_fail;
+		stats->lat_ns += w->lat_ns;
+		stats->lat_samples += w->lat_samples;
+		if (stats->lat_max < w->lat_max)
+			stats->lat_max = w->lat_max;
+	}
+	stats->ops += ops;
+
+	/* drain using the last hazard slot */
+	(void)memset(&c->w, 0, sizeof(c->w));
+	c->slot = n_workers;
+	c->n_retired = 0;
+	while (impl->pop(c, &value)) {
+		popped++;
+		popped_sum += value;
+	}
+
+	if ((pushed != popped) || (pushed_sum != popped_sum)) {
+		pr_fail("%s: %s pushed %" PRIu64 " items but popped %" PRIu64
+			" items, checksums 0x%" PRIx64 " and 0x%" PRIx64 "\n",
+			args->name, lockfree_methods[method + 1],
+			pushed, popped, pushed_sum, popped_sum);
+		rc = EXIT_FAILURE;
+	}
+	add_counter(args, ops);
+
+	return rc;
+}
+
+/*
+ *  stress_lockfree()
+ *	stress lock-free queues and stacks with N producers and M consumers
+ */
+static int stress_lockfree(const stress_args_t *args)
+{
+	static stress_lockfree_stats_t stats[LOCKFREE_METHODS];
+	uint32_t producers = DEFAULT_LOCKFREE_WORKERS;
+	uint32_t consumers = DEFAULT_LOCKFREE_WORKERS;
+	size_t lockfree_method = 0, i, idx = 0;
+	stress_lockfree_ctxt_t *c;
+	stress_lockfree_t *lf;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("lockfree-method", &lockfree_method);
+	(void)stress_get_setting("lockfree-producers", &producers);
+	(void)stress_get_setting("lockfree-consumers", &consumers);
+
+	lf = (stress_lockfree_t *)mmap(NULL, sizeof(*lf), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (lf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes for the shared queues, skipping stressor\n",
+			args->name, sizeof(*lf));
+		return EXIT_NO_RESOURCE;
+	}
+	c = (stress_lockfree_ctxt_t *)mmap(NULL, sizeof(*c), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (c == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes for the worker state, skipping stressor\n",
+			args->name, sizeof(*c));
+		(void)munmap((void *)lf, sizeof(*lf));
+		return EXIT_NO_RESOURCE;
+	}
+	c->lf = lf;
+	(void)memset(stats, 0, sizeof(stats));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < LOCKFREE_METHODS); i++) {
+			if (lockfree_method && (lockfree_method != i + 1))
+				continue;
+			rc = stress_lockfree_round(args, lf, c, i, producers, consumers, &stats[i]);
+			if (rc != EXIT_SUCCESS)
+				break;
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " producers, %" PRIu32 " consumers\n",
+			args->name, producers, consumers);
+	for (i = 0; i < LOCKFREE_METHODS; i++) {
+		const stress_lockfree_stats_t *st = &stats[i];
+		const double mops = (st->duration > 0.0) ?
+			((double)st->ops / st->duration) / 1000000.0 : 0.0;
+		const double fail = st->cas ?
+			100.0 * (double)st->cas_fail / (double)st->cas : 0.0;
+		const double lat = st->lat_samples ?
+			(double)st->lat_ns / (double)st->lat_samples : 0.0;
+		char desc[40];
+
+		if (!st->ops)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %-8s %8.3f Mops/s, %5.1f%% CAS failures, "
+				"%.1f ns per op, %.1f us max\n", args->name,
+				lockfree_methods[i + 1], mops, fail, lat,
+				(double)st->lat_max / 1000.0);
+		(void)snprintf(desc, sizeof(desc), "%s Mops/s", lockfree_methods[i + 1]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, mops);
+		(void)snprintf(desc, sizeof(desc), "%s CAS failure %%", lockfree_methods[i + 1]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, fail);
+		(void)snprintf(desc, sizeof(desc), "%s ns per op", lockfree_methods[i + 1]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, lat);
+	}
+
+	(void)munmap((void *)c, sizeof(*c));
+	(void)munmap((void *)lf, sizeof(*lf));
+
+	return rc;
+}
+
+stressor_info_t stress_lockfree_info = {
+	.stressor = stress_lockfree,
+	.class = CLASS_CPU_CACHE | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_ALWAYS,
+	.help = help
+};
+#else
+stressor_info_t stress_lockfree_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_CPU_CACHE | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -0,0 +1,736 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+
+#define MIN_LOCKSCALE_THREADS	(1)
+#define MAX_LOCKSCALE_THREADS	(256)
+
+#define LOCKSCALE_STEP		(0.2)	/* seconds per method and thread count */
+#define LOCKSCALE_MAX_COUNTS	(10)	/* 1, 2, 4 .. 256 and the maximum */
+#define LOCKSCALE_SPINS		(1024)	/* spins before yielding the CPU */
+#define LOCKSCALE_CS_LINES	(4)	/* cache lines written per acquisition */
+#define LOCKSCALE_THINK		(64)	/* loops between acquisitions */
+
+static const stress_help_t help[] = {
+	{ NULL,	"lockscale N",		"start N workers sweeping lock algorithms over thread counts" },
+	{ NULL,	"lockscale-method M",	"lock algorithm to sweep, default is all" },
+	{ NULL,	"lockscale-ops N",	"stop after N lock acquisitions" },
+	{ NULL,	"lockscale-threads N",	"sweep 1 to N threads, default is the number of CPUs" },
+	{ NULL,	NULL,			NULL }
+};
+
+/* method names, the implementations are in the same order */
+static const char * const lockscale_methods[] = {
+	"all",
+	"ticket",
+	"mcs",
+	"clh",
+	"ttas",
+	"mutex",
+	"adaptive",
+	"rwlock",
+	"futex",
+	"core-lock",
+};
+
+static int stress_set_lockscale_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(lockscale_methods); i++) {
+		if (!strcmp(opt, lockscale_methods[i]))
+			return stress_set_setting("lockscale-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "lockscale-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(lockscale_methods); i++)
+		(void)fprintf(stderr, " %s", lockscale_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_lockscale_threads(const char *opt)
+{
+	uint32_t lockscale_threads;
+
+	lockscale_threads = stress_get_uint32(opt);
+	stress_check_range("lockscale-threads", (uint64_t)lockscale_threads,
+		MIN_LOCKSCALE_THREADS, MAX_LOCKSCALE_THREADS);
+	return stress_set_setting("lockscale-threads", TYPE_ID_UINT32, &lockscale_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_lockscale_method,		stress_set_lockscale_method },
+	{ OPT_lockscale_threads,	stress_set_lockscale_threads },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+
+#define LOCKSCALE_METHODS	(SIZEOF_ARRAY(lockscale_methods) - 1)
+
+/* MCS queue node, waiters spin on their own node */
+typedef struct stress_lockscale_mcs {
+	struct stress_lockscale_mcs *next;
+	uint32_t locked;
+} ALIGN64 stress_lockscale_mcs_t;
+
+/* CLH queue node, waiters spin on their predecessor's node */
+typedef struct {
+	uint32_t locked;
+} ALIGN64 stress_lockscale_clh_t;
+
+/* the lock under test and the data it protects */
+typedef struct {
+	uint32_t ticket_next ALIGN64;		/* ticket lock */
+	uint32_t ticket_serving ALIGN64;
+	uint32_t ttas ALIGN64;			/* test and test-and-set lock */
+	stress_lockscale_mcs_t *mcs_tail ALIGN64;	/* MCS lock */
+	stress_lockscale_clh_t *clh_tail ALIGN64;	/* CLH lock */
+	stress_lockscale_clh_t clh_dummy;
+	uint32_t futex ALIGN64;			/* futex lock */
+	pthread_mutex_t mutex ALIGN64;		/* mutex and adaptive mutex */
+	pthread_rwlock_t rwlock ALIGN64;	/* rwlock, write locked */
+	void *core_lock;			/* core-lock backend */
+
+	uint64_t cs[LOCKSCALE_CS_LINES * 8] ALIGN64;	/* critical section data */
+	uint64_t last_release;			/* time of the last release */
+	uint32_t owner;				/* current owner, 0 is none */
+	uint32_t last_owner;			/* last owner */
+	uint64_t violations;			/* mutual exclusions violated */
+
+	volatile bool start ALIGN64;		/* start the step */
+	volatile bool stop;			/* end the step */
+} stress_lockscale_t;
+
+/* per thread state */
+typedef struct {
+	stress_lockscale_mcs_t mcs;		/* own MCS node */
+	stress_lockscale_clh_t clh;		/* initial own CLH node */
+	stress_lockscale_clh_t *clh_node;	/* CLH node in use */
+	stress_lockscale_clh_t *clh_pred;	/* CLH predecessor node */
+	stress_lockscale_t *ls;
+	size_t method;				/* index in lockscale_impls */
+	uint32_t id;				/* thread id, 1 upwards */
+	uint64_t acquisitions;
+	uint64_t handoffs;			/* acquisitions after another owner */
+	uint64_t handoff_ns;			/* total handoff time */
+	uint64_t handoff_max;			/* slowest handoff */
+	pthread_t pthread;
+	int ret;
+} ALIGN64 stress_lockscale_thread_t;
+
+/* sweep totals per method and thread count */
+typedef struct {
+	uint32_t threads;			/* threads that ran */
+	uint64_t acquisitions;
+	double duration;
+	double spread;				/* sum of per step (max - min) / mean */
+	uint64_t steps;
+	uint64_t handoffs;
+	uint64_t handoff_ns;
+	uint64_t handoff_max;
+} stress_lockscale_stats_t;
+
+typedef struct {
+	int (*init)(stress_lockscale_t *ls);
+	void (*deinit)(stress_lockscale_t *ls);
+	void (*acquire)(stress_lockscale_t *ls, stress_lockscale_thread_t *t);
+	void (*release)(stress_lockscale_t *ls, stress_lockscale_thread_t *t);
+} stress_lockscale_impl_t;
+
+/*
+ *  stress_lockscale_relax()
+ *	spin wait body, yield now and then so oversubscribed
+ *	sweeps with more threads than CPUs make progress
+ */
+static inline void stress_lockscale_relax(uint32_t *spins)
+{
+#if defined(HAVE_ASM_X86_PAUSE)
+	__asm__ __volatile__("pause;\n" ::: "memory");
+#endif
+	if (++(*spins) >= LOCKSCALE_SPINS) {
+		*spins = 0;
+		(void)shim_sched_yield();
+	}
+}
+
+static void stress_lockscale_nop_deinit(stress_lockscale_t *ls)
+{
+	(void)ls;
+}
+
+/*
+ *  ticket lock, FIFO by taking a ticket and waiting to be served
+ */
+static int stress_lockscale_ticket_init(stress_lockscale_t *ls)
+{
+	ls->ticket_next = 0;
+	ls->ticket_serving = 0;
+
+	return 0;
+}
+
+static void stress_lockscale_ticket_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	const uint32_t ticket = __atomic_fetch_add(&ls->ticket_next, 1, __ATOMIC_RELAXED);
+	uint32_t spins = 0;
+
+	(void)t;
+	while (__atomic_load_n(&ls->ticket_serving, __ATOMIC_ACQUIRE) != ticket)
+		stress_lockscale_relax(&spins);
+}
+
+static void stress_lockscale_ticket_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	__atomic_store_n(&ls->ticket_serving, ls->ticket_serving + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ *  MCS queue lock, each waiter spins on a flag in its own node
+ */
+static int stress_lockscale_mcs_init(stress_lockscale_t *ls)
+{
+	ls->mcs_tail = NULL;
+
+	return 0;
+}
+
+static void stress_lockscale_mcs_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	stress_lockscale_mcs_t *node = &t->mcs, *pred;
+	uint32_t spins = 0;
+
+	node->next = NULL;
+	node->locked = 1;
+	pred = __atomic_exchange_n(&ls->mcs_tail, node, __ATOMIC_ACQ_REL);
+	if (!pred)
+		return;
+	__atomic_store_n(&pred->next, node, __ATOMIC_RELEASE);
+	while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE))
+		stress_lockscale_relax(&spins);
+}
+
+static void stress_lockscale_mcs_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	stress_lockscale_mcs_t *node = &t->mcs;
+	stress_lockscale_mcs_t *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+
+	if (!next) {
+		stress_lockscale_mcs_t *expected = node;
+		uint32_t spins = 0;
+
+		if (__atomic_compare_exchange_n(&ls->mcs_tail, &expected, NULL,
+				false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			return;
+		/* a successor is between the exchange and linking in */
+		while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)))
+			stress_lockscale_relax(&spins);
+	}
+	__atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ *  CLH queue lock, each waiter spins on its predecessor's node
+ *  and takes it over for its next acquisition
+ */
+static int stress_lockscale_clh_init(stress_lockscale_t *ls)
+{
+	ls->clh_dummy.locked = 0;
+	ls->clh_tail = &ls->clh_dummy;
+
+	return 0;
+}
+
+static void stress_lockscale_clh_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	stress_lockscale_clh_t *node = t->clh_node, *pred;
+	uint32_t spins = 0;
+
+	__atomic_store_n(&node->locked, 1, __ATOMIC_RELAXED);
+	pred = __atomic_exchange_n(&ls->clh_tail, node, __ATOMIC_ACQ_REL);
+	while (__atomic_load_n(&pred->locked, __ATOMIC_ACQUIRE))
+		stress_lockscale_relax(&spins);
+	t->clh_pred = pred;
+}
+
+static void stress_lockscale_clh_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)ls;
+	__atomic_store_n(&t->clh_node->locked, 0, __ATOMIC_RELEASE);
+	t->clh_node = t->clh_pred;
+}
+
+/*
+ *  test and test-and-set lock with exponential backoff
+ */
+static int stress_lockscale_ttas_init(stress_lockscale_t *ls)
+{
+	ls->ttas = 0;
+
+	return 0;
+}
+
+static void stress_lockscale_ttas_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	uint32_t spins = 0, backoff = 1;
+
+	(void)t;
+	for (;;) {
+		uint32_t i;
+
+		while (__atomic_load_n(&ls->ttas, __ATOMIC_RELAXED))
+			stress_lockscale_relax(&spins);
+		if (!__atomic_exchange_n(&ls->ttas, 1, __ATOMIC_ACQUIRE))
+			return;
+		for (i = 0; i < backoff; i++)
+			stress_lockscale_relax(&spins);
+		if (backoff < LOCKSCALE_SPINS)
+			backoff <<= 1;
+	}
+}
+
+static void stress_lockscale_ttas_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	__atomic_store_n(&ls->ttas, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ *  pthread mutex, default and adaptive (spin then sleep) types
+ */
+static int stress_lockscale_mutex_init(stress_lockscale_t *ls)
+{
+	return pthread_mutex_init(&ls->mutex, NULL) ? -1 : 0;
+}
+
+static int stress_lockscale_adaptive_init(stress_lockscale_t *ls)
+{
+#if defined(__GLIBC__)
+	pthread_mutexattr_t attr;
+	int ret;
+
+	if (pthread_mutexattr_init(&attr))
+		return -1;
+	ret = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+	if (!ret)
+		ret = pthread_mutex_init(&ls->mutex, &attr);
+	(void)pthread_mutexattr_destroy(&attr);
+
+	return ret ? -1 : 0;
+#else
+	(void)ls;
+
+	return -1;
+#endif
+}
+
+static void stress_lockscale_mutex_deinit(stress_lockscale_t *ls)
+{
+	(void)pthread_mutex_destroy(&ls->mutex);
+}
+
+static void stress_lockscale_mutex_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	(void)pthread_mutex_lock(&ls->mutex);
+}
+
+static void stress_lockscale_mutex_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	(void)pthread_mutex_unlock(&ls->mutex);
+}
+
+/*
+ *  pthread rwlock, every acquisition is a writer
+ */
+static int stress_lockscale_rwlock_init(stress_lockscale_t *ls)
+{
+	return pthread_rwlock_init(&ls->rwlock, NULL) ? -1 : 0;
+}
+
+static void stress_lockscale_rwlock_deinit(stress_lockscale_t *ls)
+{
+	(void)pthread_rwlock_destroy(&ls->rwlock);
+}
+
+static void stress_lockscale_rwlock_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	(void)pthread_rwlock_wrlock(&ls->rwlock);
+}
+
+static void stress_lockscale_rwlock_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	(void)pthread_rwlock_unlock(&ls->rwlock);
+}
+
+/*
+ *  futex lock, 0 unlocked, 1 locked, 2 locked with waiters
+ */
+static int stress_lockscale_futex_init(stress_lockscale_t *ls)
+{
+#if defined(__NR_futex)
+	ls->futex = 0;
+
+	return 0;
+#else
+	(void)ls;
+
+	return -1;
+#endif
+}
+
+static void stress_lockscale_futex_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	uint32_t c = 0;
+
+	(void)t;
+	if (__atomic_compare_exchange_n(&ls->futex, &c, 1, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+	if (c != 2)
+		c = __atomic_exchange_n(&ls->futex, 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		(void)shim_futex_wait(&ls->futex, 2, NULL);
+		c = __atomic_exchange_n(&ls->futex, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+static void stress_lockscale_futex_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	if (__atomic_fetch_sub(&ls->futex, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n(&ls->futex, 0, __ATOMIC_RELEASE);
+		(void)shim_futex_wake(&ls->futex, 1);
+	}
+}
+
+/*
+ *  the lock stress-ng uses internally, see core-lock.c
+ */
+static int stress_lockscale_core_init(stress_lockscale_t *ls)
+{
+	ls->core_lock = stress_lock_create();
+
+	return ls->core_lock ? 0 : -1;
+}
+
+static void stress_lockscale_core_deinit(stress_lockscale_t *ls)
+{
+	(void)stress_lock_destroy(ls->core_lock);
+	ls->core_lock = NULL;
+}
+
+static void stress_lockscale_core_acquire(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	(void)stress_lock_acquire(ls->core_lock);
+}
+
+static void stress_lockscale_core_release(stress_lockscale_t *ls, stress_lockscale_thread_t *t)
+{
+	(void)t;
+	(void)stress_lock_release(ls->core_lock);
+}
+
+/* same order as lockscale_methods[] without "all" */
+static const stress_lockscale_impl_t lockscale_impls[] = {
+	{ stress_lockscale_ticket_init,	stress_lockscale_nop_deinit,
+	  stress_lockscale_ticket_acquire, stress_lockscale_ticket_release },
+	{ stress_lockscale_mcs_init,	stress_lockscale_nop_deinit,
+	  stress_lockscale_mcs_acquire,	stress_lockscale_mcs_release },
+	{ stress_lockscale_clh_init,	stress_lockscale_nop_deinit,
+	  stress_lockscale_clh_acquire,	stress_lockscale_clh_release },
+	{ stress_lockscale_ttas_init,	stress_lockscale_nop_deinit,
+	  stress_lockscale_ttas_acquire, stress_lockscale_ttas_release },
+	{ stress_lockscale_mutex_init,	stress_lockscale_mutex_deinit,
+	  stress_lockscale_mutex_acquire, stress_lockscale_mutex_release },
+	{ stress_lockscale_adaptive_init, stress_lockscale_mutex_deinit,
+	  stress_lockscale_mutex_acquire, stress_lockscale_mutex_release },
+	{ stress_lockscale_rwlock_init,	stress_lockscale_rwlock_deinit,
+	  stress_lockscale_rwlock_acquire, stress_lockscale_rwlock_release },
+	{ stress_lockscale_futex_init,	stress_lockscale_nop_deinit,
+	  stress_lockscale_futex_acquire, stress_lockscale_futex_release },
+	{ stress_lockscale_core_init,	stress_lockscale_core_deinit,
+	  stress_lockscale_core_acquire, stress_lockscale_core_release },
+};
+
+/*
+ *  stress_lockscale_thread()
+ *	acquire the lock, check for exclusive ownership while writing
+ *	the critical section data, time the handoff from a different
+ *	previous owner, release and think a little
+ */
+static void *stress_lockscale_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_lockscale_thread_t *t = (stress_lockscale_thread_t *)arg;
+	stress_lockscale_t *ls = t->ls;
+	const stress_lockscale_impl_t *impl = &lockscale_impls[t->method];
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!ls->start && !ls->stop)
+		shim_mb();
+
+	while (!ls->stop) {
+		uint64_t now;
+		volatile uint32_t i;
+		size_t j;
+
+		impl->acquire(ls, t);
+		now = stress_latency_now();
+		if (ls->owner)
+			ls->violations++;
+		ls->owner = t->id;
+		if (ls->last_owner && (ls->last_owner != t->id)) {
+			const uint64_t handoff = now - ls->last_release;
+
+			t->handoffs++;
+			t->handoff_ns += handoff;
+			if (t->handoff_max < handoff)
+				t->handoff_max = handoff;
+		}
+		for (j = 0; j < LOCKSCALE_CS_LINES; j++)
+			ls->cs[j * 8]++;
+		if (ls->owner != t->id)
+			ls->violations++;
+		ls->owner = 0;
+		ls->last_owner = t->id;
+		ls->last_release = stress_latency_now();
+		impl->release(ls, t);
+		t->acquisitions++;
+
+		for (i = 0; i < LOCKSCALE_THINK; i++)
+			;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_lockscale_step()
+ *	run n_threads threads on one lock method for LOCKSCALE_STEP
+ *	seconds and add the results to stats, returns -1 if the method
+ *	is not available
+ */
+static int stress_lockscale_step(
+	const stress_args_t *args,
+	stress_lockscale_t *ls,
+	stress_lockscale_thread_t *threads,
+	const size_t method,
+	const uint32_t n_threads,
+	stress_lockscale_stats_t *stats)
+{
+	const stress_lockscale_impl_t *impl = &lockscale_impls[method];
+	uint64_t acquisitions = 0, min = UINT64_MAX, max = 0;
+	uint32_t i, started = 0;
+	double t_start, duration;
+
+	(void)memset(ls, 0, sizeof(*ls));
+	if (impl->init(ls) < 0)
+		return -1;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_lockscale_thread_t *t = &threads[i];
+
+		(void)memset(t, 0, sizeof(*t));
+		t->ls = ls;
+		t->method = method;
+		t->id = i + 1;
+		t->clh_node = &t->clh;
+		t->ret = pthread_create(&t->pthread, NULL, stress_lockscale_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+
+	t_start = stress_time_now();
+	ls->start = true;
+	shim_mb();
+	(void)shim_usleep((uint64_t)(LOCKSCALE_STEP * 1000000.0));
+	ls->stop = true;
+	shim_mb();
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	duration = stress_time_now() - t_start;
+	impl->deinit(ls);
+
+	if (!started)
+		return 0;
+	if (ls->violations) {
+		pr_fail("%s: %s lock allowed %" PRIu64 " mutual exclusion violations\n",
+			args->name, lockscale_methods[method + 1], ls->violations);
+	}
+
+	for (i = 0; i < started; i++) {
+		const stress_lockscale_thread_t *t = &threads[i];
+
+		acquisitions += t->acquisitions;
+		if (min > t->acquisitions)
+			min = t->acquisitions;
+		if (max < t->acquisitions)
+			max = t->acquisitions;
+		stats->handoffs += t->handoffs;
+		stats->handoff_ns += t->handoff_ns;
+		if (stats->handoff_max < t->handoff_max)
+			stats->handoff_max = t->handoff_max;
+	}
+	stats->threads = started;
+	stats->acquisitions += acquisitions;
+	stats->duration += duration;
+	if (acquisitions) {
+		const double mean = (double)acquisitions / (double)started;
+
+		stats->spread += (double)(max - min) / mean;
+		stats->steps++;
+	}
+	add_counter(args, acquisitions);
+
+	return 0;
+}
+
+/*
+ *  stress_lockscale()
+ *	sweep lock algorithms over 1, 2, 4 .. N threads
+ */
+static int stress_lockscale(const stress_args_t *args)
+{
+	static stress_lockscale_stats_t stats[LOCKSCALE_METHODS][LOCKSCALE_MAX_COUNTS];
+	bool available[LOCKSCALE_METHODS];
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t lockscale_threads = (cpus > 1) ? (uint32_t)cpus : 4;
+	uint32_t counts[LOCKSCALE_MAX_COUNTS], n;
+	size_t lockscale_method = 0, i, j, n_counts = 0, idx = 0;
+	stress_lockscale_thread_t *threads;
+	stress_lockscale_t *ls;
+
+	(void)stress_get_setting("lockscale-method", &lockscale_method);
+	if (!stress_get_setting("lockscale-threads", &lockscale_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			lockscale_threads = MAX_LOCKSCALE_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			lockscale_threads = MIN_LOCKSCALE_THREADS;
+	}
+	if (lockscale_threads > MAX_LOCKSCALE_THREADS)
+		lockscale_threads = MAX_LOCKSCALE_THREADS;
+
+	/* 1, 2, 4 .. up to and including lockscale_threads */
+	for (n = 1; (n < lockscale_threads) && (n_counts < LOCKSCALE_MAX_COUNTS - 1); n <<= 1)
+		counts[n_counts++] = n;
+	counts[n_counts++] = lockscale_threads;
+
+	threads = (stress_lockscale_thread_t *)mmap(NULL,
+		sizeof(*threads) * lockscale_threads, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %" PRIu32 " thread states, skipping stressor\n",
+			args->name, lockscale_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	ls = (stress_lockscale_t *)mmap(NULL, sizeof(*ls), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ls == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap lock state, skipping stressor\n", args->name);
+		(void)munmap((void *)threads, sizeof(*threads) * lockscale_threads);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	for (i = 0; i < LOCKSCALE_METHODS; i++)
+		available[i] = (lockscale_method == 0) || (lockscale_method == i + 1);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < LOCKSCALE_METHODS); i++) {
+			if (!available[i])
+				continue;
+			for (j = 0; keep_stressing(args) && (j < n_counts); j++) {
+				if (stress_lockscale_step(args, ls, threads, i, counts[j], &stats[i][j]) < 0) {
+					if (args->instance == 0)
+						pr_inf("%s: %s lock is not available\n",
+							args->name, lockscale_methods[i + 1]);
+					available[i] = false;
+					break;
+				}
+			}
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: method    threads  Macq/s  spread %%  handoff ns  handoff max us\n",
+			args->name);
+	for (i = 0; i < LOCKSCALE_METHODS; i++) {
+		double top = 0.0;
+
+		for (j = 0; j < n_counts; j++) {
+			const stress_lockscale_stats_t *st = &stats[i][j];
+			const double macq = (st->duration > 0.0) ?
+				((double)st->acquisitions / st->duration) / 1000000.0 : 0.0;
+
+			if (!st->steps)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %-10s %6" PRIu32 " %7.2f %9.1f %11.1f %15.1f\n",
+					args->name, lockscale_methods[i + 1], st->threads, macq,
+					100.0 * st->spread / (double)st->steps,
+					st->handoffs ? (double)st->handoff_ns / (double)st->handoffs : 0.0,
+					(double)st->handoff_max / 1000.0);
+			if (j == n_counts - 1)
+				top = macq;
+		}
+		/* acquisition rate at the highest thread count per method */
+		if ((top > 0.0) && (idx < 10)) {
+			char desc[40];
+
+			(void)snprintf(desc, sizeof(desc), "%s Macq/s, %" PRIu32 " threads",
+				lockscale_methods[i + 1], lockscale_threads);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, top);
+		}
+	}
+
+	(void)munmap((void *)ls, sizeof(*ls));
+	(void)munmap((void *)threads, sizeof(*threads) * lockscale_threads);
+
+	return EXIT_SUCCESS;
+}
+
+stressor_info_t stress_lockscale_info = {
+	.stressor = stress_lockscale,
+	.class = CLASS_CPU_CACHE | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_ALWAYS,
+	.help = help
+};
+#else
+stressor_info_t stress_lockscale_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_CPU_CACHE | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -27,9 +27,24 @@
 static const stress_help_t help[] = {
 	{ NULL,	"loop N",	"start N workers exercising loopback devices" },
 	{ NULL,	"loop-ops N",	"stop after N bogo loopback operations" },
+	{ NULL,	"loop-bench",	"measure loop device MB/s and IOPS with direct I/O on and off" },
 	{ NULL,	NULL,		NULL }
 };
 
+/*
+ *  stress_set_loop_bench()
+ *	enable the loop device I/O throughput benchmark
+ */
+static int stress_set_loop_bench(const char *opt)
+{
+	return stress_set_setting_true("loop-bench", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_loop_bench,	stress_set_loop_bench },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LINUX_LOOP_H) && \
     defined(LOOP_CTL_GET_FREE) && \
     defined(LOOP_SET_FD) && \
@@ -91,6 +106,449 @@ static int stress_loop_supported(const char *name)
 	return 0;
 }
 
+#define LOOP_BENCH_SIZE		(64 * MB)	/* backing store size */
+#define LOOP_BENCH_TIME		(0.25)		/* seconds per measurement */
+#define LOOP_BENCH_SEQ_IO	(128 * KB)	/* sequential I/O size */
+#define LOOP_BENCH_RND_IO	(4 * KB)	/* random I/O size */
+
+typedef struct {
+	const char *name;
+	const bool write;
+	const bool rnd;
+} stress_loop_bench_pattern_t;
+
+static const char * const loop_bench_backings[] = {
+	"file",
+	"memfd",
+};
+
+static const stress_loop_bench_pattern_t loop_bench_patterns[] = {
+	{ "seq-rd",	false,	false },
+	{ "seq-wr",	true,	false },
+	{ "rnd-rd",	false,	true },
+	{ "rnd-wr",	true,	true },
+};
+
+static const uint32_t loop_bench_blk_sizes[] = {
+	512, 4096
+};
+
+#define LOOP_BENCH_BACKINGS	SIZEOF_ARRAY(loop_bench_backings)
+#define LOOP_BENCH_PATTERNS	SIZEOF_ARRAY(loop_bench_patterns)
+#define LOOP_BENCH_BLK_SIZES	SIZEOF_ARRAY(loop_bench_blk_sizes)
+
+typedef struct {
+	bool ok;				/* device configured as requested */
+	double mbs[LOOP_BENCH_PATTERNS];	/* MB/s, < 0 on I/O failure */
+	double iops[LOOP_BENCH_PATTERNS];	/* I/O operations per second */
+	double dbl_mb;				/* MB cached twice, < 0 unknown */
+} stress_loop_bench_res_t;
+
+/*
+ *  stress_loop_bench_io()
+ *	O_DIRECT I/O to the loop device for LOOP_BENCH_TIME seconds
+ *	so each request goes through the loop driver to the backing
+ *	store rather than being served from the loop device page cache
+ */
+static void stress_loop_bench_io(
+	const stress_args_t *args,
+	const int fd,
+	uint8_t *buf,
+	const stress_loop_bench_pattern_t *pattern,
+	double *mbs,
+	double *iops)
+{
+	const size_t io = pattern->rnd ? LOOP_BENCH_RND_IO : LOOP_BENCH_SEQ_IO;
+	const uint32_t n_blocks = (uint32_t)(LOOP_BENCH_SIZE / io);
+	const double t = stress_time_now();
+	uint32_t blk = 0;
+	uint64_t ops = 0;
+	double dt;
+
+	*mbs = -1.0;
+	*iops = -1.0;
+	do {
+		const off_t off = (off_t)(pattern->rnd ? stress_mwc32() % n_blocks : blk) * (off_t)io;
+		ssize_t ret;
+
+		if (pattern->write)
+			ret = pwrite(fd, buf, io, off);
+		else
+			ret = pread(fd, buf, io, off);
+		if (ret != (ssize_t)io)
+			return;
+		blk = (blk + 1) % n_blocks;
+		ops++;
+		dt = stress_time_now() - t;
+	} while (keep_stressing(args) && (dt < LOOP_BENCH_TIME));
+
+	if (dt > 0.0) {
+		*iops = (double)ops / dt;
+		*mbs = *iops * (double)io / (double)MB;
+	}
+}
+
+/*
+ *  stress_loop_bench_cached()
+ *	bytes of fd's first size bytes resident in the page cache
+ */
+static double stress_loop_bench_cached(
+	const stress_args_t *args,
+	const int fd,
+	const size_t size)
+{
+	const size_t pages = size / args->page_size;
+	unsigned char *vec;
+	void *ptr;
+	size_t i, n = 0;
+
+	vec = (unsigned char *)calloc(pages, 1);
+	if (!vec)
+		return -1.0;
+	ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		free(vec);
+		return -1.0;
+	}
+	if (shim_mincore(ptr, size, vec) < 0) {
+		(void)munmap(ptr, size);
+		free(vec);
+		return -1.0;
+	}
+	for (i = 0; i < pages; i++)
+		n += (vec[i] & 1);
+	(void)munmap(ptr, size);
+	free(vec);
+
+	return (double)n * (double)args->page_size;
+}
+
+/*
+ *  stress_loop_bench_double_cache()
+ *	read the whole loop device through its page cache and return
+ *	the MB that end up cached both on the loop device and in the
+ *	backing store, the double caching that direct I/O avoids
+ */
+static double stress_loop_bench_double_cache(
+	const stress_args_t *args,
+	const char *dev_name,
+	const int backing_fd,
+	uint8_t *buf)
+{
+	double loop_cached, backing_cached;
+	off_t off;
+	int fd;
+
+	fd = open(dev_name, O_RDONLY);
+	if (fd < 0)
+		return -1.0;
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	(void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	(void)posix_fadvise(backing_fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	for (off = 0; off < (off_t)LOOP_BENCH_SIZE; off += LOOP_BENCH_SEQ_IO) {
+		if (pread(fd, buf, LOOP_BENCH_SEQ_IO, off) != (ssize_t)LOOP_BENCH_SEQ_IO) {
+			(void)close(fd);
+			return -1.0;
+		}
+	}
+	loop_cached = stress_loop_bench_cached(args, fd, LOOP_BENCH_SIZE);
+	backing_cached = stress_loop_bench_cached(args, backing_fd, LOOP_BENCH_SIZE);
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	(void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	(void)close(fd);
+
+	if ((loop_cached < 0.0) || (backing_cached < 0.0))
+		return -1.0;
+	return STRESS_MINIMUM(loop_cached, backing_cached) / (double)MB;
+}
+
+/*
+ *  stress_loop_bench_configure()
+ *	set the loop block size and direct I/O mode, returns true
+ *	if the device reports the requested direct I/O state
+ */
+static bool stress_loop_bench_configure(
+	const int loop_dev,
+	const uint32_t blk_size,
+	const bool dio)
+{
+#if defined(LOOP_SET_BLOCK_SIZE) &&	\
+    defined(LOOP_SET_DIRECT_IO) &&	\
+    defined(LOOP_GET_STATUS64)
+	struct loop_info64 info64;
+
+	/* Sync is required to avoid loop_set_block_size warnings */
+	(void)shim_fsync(loop_dev);
+	if (ioctl(loop_dev, LOOP_SET_BLOCK_SIZE, (unsigned long)blk_size) < 0)
+		return false;
+	if ((ioctl(loop_dev, LOOP_SET_DIRECT_IO, (unsigned long)dio) < 0) && dio)
+		return false;
+	if (ioctl(loop_dev, LOOP_GET_STATUS64, &info64) < 0)
+		return false;
+	return !!(info64.lo_flags & LO_FLAGS_DIRECT_IO) == dio;
+#else
+	(void)loop_dev;
+	(void)blk_size;
+
+	return !dio;
+#endif
+}
+
+/*
+ *  stress_loop_bench_backing()
+ *	open and fill a backing store, a file in the temp path or
+ *	a shmem backed memfd
+ */
+static int stress_loop_bench_backing(
+	const stress_args_t *args,
+	const size_t backing,
+	uint8_t *buf)
+{
+	char filename[PATH_MAX];
+	off_t off;
+	int fd;
+
+	if (backing == 0) {
+		(void)stress_temp_filename_args(args,
+			filename, sizeof(filename), stress_mwc32());
+		fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+		if (fd < 0)
+			return -1;
+		(void)shim_unlink(filename);
+	} else {
+		fd = shim_memfd_create("stress-loop-bench", 0);
+		if (fd < 0)
+			return -1;
+	}
+	for (off = 0; off < (off_t)LOOP_BENCH_SIZE; off += LOOP_BENCH_SEQ_IO) {
+		if (pwrite(fd, buf, LOOP_BENCH_SEQ_IO, off) != (ssize_t)LOOP_BENCH_SEQ_IO) {
+			(void)close(fd);
+			return -1;
+		}
+	}
+	(void)shim_fsync(fd);
+	return fd;
+}
+
+/*
+ *  stress_loop_bench_detach()
+ *	disassociate and remove a loop device
+ */
+static void stress_loop_bench_detach(
+	const int ctrl_dev,
+	const int loop_dev,
+	const long dev_num,
+	const int backing_fd)
+{
+	int i;
+
+	for (i = 0; i < 1000; i++) {
+		if ((ioctl(loop_dev, LOOP_CLR_FD, backing_fd) == 0) || (errno != EBUSY))
+			break;
+		(void)shim_usleep(10);
+	}
+	(void)close(loop_dev);
+	for (i = 0; i < 1000; i++) {
+		if ((ioctl(ctrl_dev, LOOP_CTL_REMOVE, dev_num) == 0) || (errno != EBUSY))
+			break;
+		(void)shim_usleep(10);
+	}
+}
+
+/*
+ *  stress_loop_bench_backing_run()
+ *	attach a backing store to a free loop device and measure
+ *	each direct I/O mode and block size, returns -1 if no loop
+ *	device could be attached, 1 if interrupted, 0 when complete
+ */
+static int stress_loop_bench_backing_run(
+	const stress_args_t *args,
+	const int ctrl_dev,
+	const int backing_fd,
+	uint8_t *buf,
+	stress_loop_bench_res_t res[2][LOOP_BENCH_BLK_SIZES])
+{
+	char dev_name[PATH_MAX];
+	size_t dio, b, p;
+	long dev_num;
+	int loop_dev, fd, ret = 0;
+
+	dev_num = ioctl(ctrl_dev, LOOP_CTL_GET_FREE);
+	if (dev_num < 0)
+		return -1;
+	(void)snprintf(dev_name, sizeof(dev_name), "/dev/loop%ld", dev_num);
+	loop_dev = open(dev_name, O_RDWR);
+	if (loop_dev < 0)
+		return -1;
+	if (ioctl(loop_dev, LOOP_SET_FD, backing_fd) < 0) {
+		(void)close(loop_dev);
+		return -1;
+	}
+
+	for (dio = 0; dio < 2; dio++) {
+		for (b = 0; b < LOOP_BENCH_BLK_SIZES; b++) {
+			stress_loop_bench_res_t *r = &res[dio][b];
+
+			if (!keep_stressing(args)) {
+				ret = 1;
+				goto detach;
+			}
+			r->ok = stress_loop_bench_configure(loop_dev, loop_bench_blk_sizes[b], dio);
+			if (!r->ok)
+				continue;
+			fd = open(dev_name, O_RDWR | O_DIRECT);
+			if (fd < 0) {
+				r->ok = false;
+				continue;
+			}
+			for (p = 0; p < LOOP_BENCH_PATTERNS; p++)
+				stress_loop_bench_io(args, fd, buf, &loop_bench_patterns[p],
+					&r->mbs[p], &r->iops[p]);
+			(void)close(fd);
+			r->dbl_mb = stress_loop_bench_double_cache(args, dev_name, backing_fd, buf);
+		}
+	}
+detach:
+	stress_loop_bench_detach(ctrl_dev, loop_dev, dev_num, backing_fd);
+	return ret;
+}
+
+/*
+ *  stress_loop_bench()
+ *	measure loop device sequential and random throughput with
+ *	direct I/O on and off, per backing store and block size
+ */
+static int stress_loop_bench(const stress_args_t *args)
+{
+	static stress_loop_bench_res_t pass[LOOP_BENCH_BACKINGS][2][LOOP_BENCH_BLK_SIZES];
+	static stress_loop_bench_res_t res[LOOP_BENCH_BACKINGS][2][LOOP_BENCH_BLK_SIZES];
+	stress_loop_bench_res_t *best = NULL;
+	const char *fs_type;
+	char path[PATH_MAX];
+	uint8_t *buf;
+	size_t i, dio, b, p;
+	bool done = false;
+
+	buf = (uint8_t *)mmap(NULL, LOOP_BENCH_SEQ_IO, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %d byte I/O buffer, skipping stressor\n",
+			args->name, (int)LOOP_BENCH_SEQ_IO);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < LOOP_BENCH_SEQ_IO; i += sizeof(uint32_t))
+		*(uint32_t *)(buf + i) = stress_mwc32();
+	(void)stress_temp_dir_args(args, path, sizeof(path));
+	fs_type = stress_fs_type(path);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		int ctrl_dev, ret = 0;
+
+		ctrl_dev = open("/dev/loop-control", O_RDWR);
+		if (ctrl_dev < 0) {
+			pr_inf_skip("%s: cannot open /dev/loop-control, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+			(void)munmap((void *)buf, LOOP_BENCH_SEQ_IO);
+			return EXIT_NO_RESOURCE;
+		}
+		(void)memset(pass, 0, sizeof(pass));
+		for (i = 0; (i < LOOP_BENCH_BACKINGS) && (ret == 0); i++) {
+			int backing_fd;
+
+			backing_fd = stress_loop_bench_backing(args, i, buf);
+			if (backing_fd < 0)
+				continue;
+			ret = stress_loop_bench_backing_run(args, ctrl_dev, backing_fd, buf, pass[i]);
+			if (ret < 0) {
+				(void)close(backing_fd);
+				(void)close(ctrl_dev);
+				pr_inf_skip("%s: cannot attach a loop device, errno=%d (%s), "
+					"skipping stressor\n", args->name, errno, strerror(errno));
+				(void)munmap((void *)buf, LOOP_BENCH_SEQ_IO);
+				return EXIT_NO_RESOURCE;
+			}
+			(void)close(backing_fd);
+		}
+		(void)close(ctrl_dev);
+		if (ret != 0)
+			break;
+		(void)memcpy(res, pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)buf, LOOP_BENCH_SEQ_IO);
+
+	if (!done)
+		return EXIT_SUCCESS;
+
+	if (args->instance == 0) {
+		pr_inf("%s: loop device O_DIRECT I/O, %d MB backing store, %d KB sequential "
+			"and %d KB random I/O, file backing in %s%s\n", args->name,
+			(int)(LOOP_BENCH_SIZE / MB), (int)(LOOP_BENCH_SEQ_IO / KB),
+			(int)(LOOP_BENCH_RND_IO / KB), path, fs_type);
+		pr_inf("%s: %-7s %-3s %5s %11s %11s %11s %11s %12s\n", args->name,
+			"backing", "dio", "bsize", "seq-rd MB/s", "seq-wr MB/s",
+			"rnd-rd IOPS", "rnd-wr IOPS", "dbl-cache MB");
+		for (i = 0; i < LOOP_BENCH_BACKINGS; i++) {
+			for (dio = 0; dio < 2; dio++) {
+				for (b = 0; b < LOOP_BENCH_BLK_SIZES; b++) {
+					const stress_loop_bench_res_t *r = &res[i][dio][b];
+					char str[128];
+					size_t len;
+
+					(void)snprintf(str, sizeof(str), "%-7s %-3s %5" PRIu32,
+						loop_bench_backings[i], dio ? "on" : "off",
+						loop_bench_blk_sizes[b]);
+					for (p = 0; p < LOOP_BENCH_PATTERNS; p++) {
+						const double val = loop_bench_patterns[p].rnd ?
+							r->iops[p] : r->mbs[p];
+
+						len = strlen(str);
+						if (!r->ok || (val < 0.0))
+							(void)snprintf(str + len, sizeof(str) - len, " %11s", "-");
+						else
+							(void)snprintf(str + len, sizeof(str) - len, " %11.1f", val);
+					}
+					len = strlen(str);
+					if (!r->ok || (r->dbl_mb < 0.0))
+						(void)snprintf(str + len, sizeof(str) - len, " %12s", "-");
+					else
+						(void)snprintf(str + len, sizeof(str) - len, " %12.1f", r->dbl_mb);
+					pr_inf("%s: %s\n", args->name, str);
+				}
+			}
+		}
+	}
+
+	/* file backed, 4K block size, direct I/O off and on */
+	for (dio = 0; dio < 2; dio++) {
+		best = &res[0][dio][LOOP_BENCH_BLK_SIZES - 1];
+		for (p = 0; p < LOOP_BENCH_PATTERNS; p++) {
+			char str[32];
+			const bool rnd = loop_bench_patterns[p].rnd;
+			const double val = rnd ? best->iops[p] : best->mbs[p];
+
+			(void)snprintf(str, sizeof(str), "dio %s %s %s", dio ? "on" : "off",
+				loop_bench_patterns[p].name, rnd ? "IOPS" : "MB/sec");
+			stress_misc_stats_set(args->misc_stats, (int)(dio * LOOP_BENCH_PATTERNS + p),
+				str, (best->ok && (val > 0.0)) ? val : 0.0);
+		}
+	}
+	best = &res[0][0][LOOP_BENCH_BLK_SIZES - 1];
+	stress_misc_stats_set(args->misc_stats, 8, "dio off double cached MB",
+		(best->ok && (best->dbl_mb > 0.0)) ? best->dbl_mb : 0.0);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_loop()
  *	stress loopback device
@@ -101,11 +559,18 @@ static int stress_loop(const stress_args_t *args)
 	char backing_file[PATH_MAX];
 	size_t backing_size = 2 * MB;
 	const int bad_fd = stress_get_bad_fd();
+	bool loop_bench = false;
 
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
 		return stress_exit_status(-ret);
 
+	(void)stress_get_setting("loop-bench", &loop_bench);
+	if (loop_bench) {
+		rc = stress_loop_bench(args);
+		goto tidy;
+	}
+
 	(void)stress_temp_filename_args(args,
 		backing_file, sizeof(backing_file), stress_mwc32());
 
@@ -399,6 +864,7 @@ stressor_info_t stress_loop_info = {
 	.stressor = stress_loop,
 	.supported = stress_loop_supported,
 	.class = CLASS_OS | CLASS_DEV,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -414,6 +880,7 @@ stressor_info_t stress_loop_info = {
 	.stressor = stress_not_implemented,
 	.supported = stress_loop_supported,
 	.class = CLASS_OS | CLASS_DEV,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
@@ -18,6 +18,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-method-stats.h"
+#include "core-target-clones.h"
+#include "core-vecmath.h"
 
 #if defined(HAVE_SEARCH_H)
 #include <search.h>
@@ -27,13 +30,46 @@
 #define MAX_LSEARCH_SIZE	(1 * MB)
 #define DEFAULT_LSEARCH_SIZE	(8 * KB)
 
+#define LSEARCH_SWEEP_MIN	(1 * KB)
+#define LSEARCH_MAX_SIZES	(8)
+
 static const stress_help_t help[] = {
-	{ NULL,	"lsearch N",	  "start N workers that exercise a linear search" },
-	{ NULL,	"lsearch-ops N",  "stop after N linear search bogo operations" },
-	{ NULL,	"lsearch-size N", "number of 32 bit integers to lsearch" },
-	{ NULL, NULL,		  NULL }
+	{ NULL,	"lsearch N",	    "start N workers that exercise a linear search" },
+	{ NULL,	"lsearch-method M", "select lsearch method [ all | lsearch | linear | simd ]" },
+	{ NULL,	"lsearch-ops N",    "stop after N linear search bogo operations" },
+	{ NULL,	"lsearch-size N",   "number of 32 bit integers to lsearch" },
+	{ NULL,	"lsearch-sweep",    "cycle array size from 1K up to lsearch-size" },
+	{ NULL, NULL,		    NULL }
+};
+
+static const char * const lsearch_methods[] = {
+	"all",
+	"lsearch",
+	"linear",
+	"simd",
 };
 
+/*
+ *  stress_set_lsearch_method()
+ *	set the lsearch method, stored as an index into lsearch_methods
+ */
+static int stress_set_lsearch_method(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(lsearch_methods); i++) {
+		if (!strcmp(lsearch_methods[i], name))
+			return stress_set_setting("lsearch-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "lsearch-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(lsearch_methods); i++)
+		(void)fprintf(stderr, " %s", lsearch_methods[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 /*
  *  stress_set_lsearch_size()
  *      set lsearch size from given option string
@@ -48,13 +84,23 @@ static int stress_set_lsearch_size(const char *opt)
 	return stress_set_setting("lsearch-size", TYPE_ID_UINT64, &lsearch_size);
 }
 
+static int stress_set_lsearch_sweep(const char *opt)
+{
+	return stress_set_setting_true("lsearch-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_lsearch_method,	stress_set_lsearch_method },
 	{ OPT_lsearch_size,	stress_set_lsearch_size },
+	{ OPT_lsearch_sweep,	stress_set_lsearch_sweep },
 	{ 0,			NULL }
 };
 
 #if defined(HAVE_LSEARCH)
 
+typedef const int32_t *(*stress_lsearch_find_t)(const int32_t key,
+	const int32_t *root, const size_t n);
+
 /*
  *  cmp()
  *	lsearch int32 comparison for sorting
@@ -64,6 +110,132 @@ static int cmp(const void *p1, const void *p2)
 	return (int)(*(const int32_t *)p1 - *(const int32_t *)p2);
 }
 
+/*
+ *  stress_lsearch_libc_find()
+ *	libc lfind, one indirect comparison call per element
+ */
+static const int32_t *stress_lsearch_libc_find(
+	const int32_t key,
+	const int32_t *root,
+	const size_t n)
+{
+	size_t nmemb = n;
+
+	return (const int32_t *)lfind(&key, root, &nmemb, sizeof(*root), cmp);
+}
+
+/*
+ *  stress_lsearch_linear_find()
+ *	inlined scalar compare loop, no indirect calls
+ */
+static const int32_t * OPTIMIZE3 stress_lsearch_linear_find(
+	const int32_t key,
+	const int32_t *root,
+	const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (root[i] == key)
+			return &root[i];
+	}
+	return NULL;
+}
+
+#if defined(HAVE_VECMATH)
+typedef int32_t stress_vint32x8_t __attribute__ ((vector_size (32)));
+typedef uint64_t stress_vuint64x4_t __attribute__ ((vector_size (32)));
+
+/*
+ *  stress_lsearch_simd_find()
+ *	compare 32 elements per iteration as four 8 x int32 vectors,
+ *	the compare masks are or'd together so there is only one
+ *	branch per 128 bytes; the hit is then located with a scalar
+ *	scan of the 32 elements
+ */
+static const int32_t * OPTIMIZE3 TARGET_CLONES stress_lsearch_simd_find(
+	const int32_t key,
+	const int32_t *root,
+	const size_t n)
+{
+	const stress_vint32x8_t vkey = {
+		key, key, key, key, key, key, key, key
+	};
+	size_t i;
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		stress_vint32x8_t v0, v1, v2, v3;
+		stress_vuint64x4_t hit;
+
+		(void)memcpy(&v0, &root[i + 0], sizeof(v0));
+		(void)memcpy(&v1, &root[i + 8], sizeof(v1));
+		(void)memcpy(&v2, &root[i + 16], sizeof(v2));
+		(void)memcpy(&v3, &root[i + 24], sizeof(v3));
+		hit = (stress_vuint64x4_t)((v0 == vkey) | (v1 == vkey) |
+					   (v2 == vkey) | (v3 == vkey));
+		if (UNLIKELY(hit[0] | hit[1] | hit[2] | hit[3]))
+			return stress_lsearch_linear_find(key, &root[i], 32);
+	}
+	return stress_lsearch_linear_find(key, &root[i], n - i);
+}
+#else
+/* no vector extensions, fall back to the scalar loop */
+#define stress_lsearch_simd_find	stress_lsearch_linear_find
+#endif
+
+/* indexed by lsearch-method, "all" has no function */
+static const stress_lsearch_find_t lsearch_funcs[] = {
+	NULL,
+	stress_lsearch_libc_find,
+	stress_lsearch_linear_find,
+	stress_lsearch_simd_find,
+};
+
+/*
+ *  stress_lsearch_method()
+ *	build the unique root array with method find followed by
+ *	an append if not found (lsearch semantics), then find each
+ *	item; returns the number of timed lookups
+ */
+static size_t stress_lsearch_method(
+	const stress_args_t *args,
+	const size_t method,
+	int32_t *data,
+	int32_t *root,
+	const size_t max,
+	double *duration)
+{
+	const stress_lsearch_find_t find = lsearch_funcs[method];
+	size_t i, n = 0;
+	double t;
+
+	/* Step #1, populate with data */
+	for (i = 0; keep_stressing_flag() && i < max; i++) {
+		data[i] = (int32_t)(((stress_mwc32() & 0xfff) << 20) ^ i);
+		if (method == 1) {
+			VOID_RET(void *, lsearch(&data[i], root, &n, sizeof(*data), cmp));
+		} else if (!find(data[i], root, n)) {
+			root[n++] = data[i];
+		}
+	}
+	/* Step #2, find */
+	t = stress_time_now();
+	for (i = 0; keep_stressing_flag() && i < n; i++) {
+		const int32_t *result;
+
+		result = find(data[i], root, n);
+		if (g_opt_flags & OPT_FLAGS_VERIFY) {
+			if (result == NULL)
+				pr_fail("%s: element %zu could not be found\n", args->name, i);
+			else if (*result != data[i])
+				pr_fail("%s: element %zu found %" PRIu32 ", expecting %" PRIu32 "\n",
+				args->name, i, *result, data[i]);
+		}
+	}
+	*duration = stress_time_now() - t;
+	return i;
+}
+
 /*
  *  stress_lsearch()
  *	stress lsearch
@@ -71,9 +243,13 @@ static int cmp(const void *p1, const void *p2)
 static int stress_lsearch(const stress_args_t *args)
 {
 	int32_t *data, *root;
-	size_t i, max;
+	size_t i, max, method = 1, first, last;
+	size_t sizes[LSEARCH_MAX_SIZES], n_sizes = 0, size_idx = 0;
 	uint64_t lsearch_size = DEFAULT_LSEARCH_SIZE;
+	bool lsearch_sweep = false;
 
+	(void)stress_get_setting("lsearch-method", &method);
+	(void)stress_get_setting("lsearch-sweep", &lsearch_sweep);
 	if (!stress_get_setting("lsearch-size", &lsearch_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			lsearch_size = MAX_LSEARCH_SIZE;
@@ -82,6 +258,34 @@ static int stress_lsearch(const stress_args_t *args)
 	}
 	max = (size_t)lsearch_size;
 
+	/* sweep from L1 cache sized arrays in x4 steps up to the array size */
+	if (lsearch_sweep) {
+		size_t sz;
+
+		for (sz = LSEARCH_SWEEP_MIN; (sz < max) && (n_sizes < LSEARCH_MAX_SIZES - 1); sz *= 4)
+			sizes[n_sizes++] = sz;
+	}
+	sizes[n_sizes++] = max;
+
+	if (method == 0) {
+		first = 1;
+		last = SIZEOF_ARRAY(lsearch_funcs) - 1;
+	} else {
+		first = method;
+		last = method;
+	}
+	for (i = first; i <= last; i++) {
+		size_t s;
+
+		for (s = 0; s < n_sizes; s++) {
+			char name[24], str[12];
+
+			stress_uint64_to_str(str, sizeof(str), (uint64_t)sizes[s]);
+			(void)snprintf(name, sizeof(name), "%s %s", lsearch_methods[i], str);
+			stress_method_stats_init(args, (i - 1) * LSEARCH_MAX_SIZES + s, name, 0.0);
+		}
+	}
+
 	if ((data = calloc(max, sizeof(*data))) == NULL) {
 		pr_fail("%s: malloc failed, out of memory\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -95,26 +299,17 @@ static int stress_lsearch(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		size_t n = 0;
+		for (i = first; keep_stressing_flag() && (i <= last); i++) {
+			double duration;
+			const size_t lookups = stress_lsearch_method(args, i, data, root,
+				sizes[size_idx], &duration);
 
-		/* Step #1, populate with data */
-		for (i = 0; keep_stressing_flag() && i < max; i++) {
-			data[i] = (int32_t)(((stress_mwc32() & 0xfff) << 20) ^ i);
-			VOID_RET(void *, lsearch(&data[i], root, &n, sizeof(*data), cmp));
-		}
-		/* Step #2, find */
-		for (i = 0; keep_stressing_flag() && i < n; i++) {
-			int32_t *result;
-
-			result = lfind(&data[i], root, &n, sizeof(*data), cmp);
-			if (g_opt_flags & OPT_FLAGS_VERIFY) {
-				if (result == NULL)
-					pr_fail("%s: element %zu could not be found\n", args->name, i);
-				else if (*result != data[i])
-					pr_fail("%s: element %zu found %" PRIu32 ", expecting %" PRIu32 "\n",
-					args->name, i, *result, data[i]);
-			}
+			stress_method_stats_add_count(args, (i - 1) * LSEARCH_MAX_SIZES + size_idx,
+				(uint64_t)lookups, duration);
 		}
+		size_idx++;
+		if (size_idx >= n_sizes)
+			size_idx = 0;
 		inc_counter(args);
 	} while (keep_stressing(args));
 
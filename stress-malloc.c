@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-bitops.h"
+#include "core-clock.h"
 
 #if defined(HAVE_MALLOC_H)
 #include <malloc.h>
@@ -56,6 +58,9 @@ static size_t malloc_pthreads;		/* Number of pthreads */
 static size_t malloc_threshold;		/* When to use mmap and not sbrk */
 #endif
 static bool malloc_touch;		/* True will touch allocate pages */
+static bool malloc_bytes_set;		/* True if --malloc-bytes was given */
+static size_t malloc_bench;		/* Benchmark size distribution, 0 = off */
+static bool malloc_bench_xfree;		/* Benchmark frees on another thread */
 static void *counter_lock;		/* Counter lock */
 
 static void (*free_func)(void *ptr, size_t len);
@@ -75,6 +80,9 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"malloc N",		"start N workers exercising malloc/realloc/free" },
+	{ NULL,	"malloc-bench D",	"benchmark allocator with fixed, powerlaw or trace sizes" },
+	{ NULL,	"malloc-bench-trace F",	"replay allocation trace file F in trace benchmark" },
+	{ NULL,	"malloc-bench-xfree",	"benchmark frees on a different thread to allocs" },
 	{ NULL,	"malloc-bytes N",	"allocate up to N bytes per allocation" },
 	{ NULL,	"malloc-max N",		"keep up to N allocations at a time" },
 	{ NULL,	"malloc-ops N",		"stop after N malloc bogo operations" },
@@ -85,6 +93,133 @@ static const stress_help_t help[] = {
 	{ NULL,	NULL,			NULL }
 };
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  Allocator benchmark mode: replay a size distribution through the
+ *  libc allocator (or whatever is LD_PRELOAD'd in its place) over a
+ *  sweep of thread counts, optionally freeing on a different thread
+ *  to the one that allocated.
+ */
+#define MALLOC_BENCH_STEP		(0.5)		/* seconds per thread count */
+#define MALLOC_BENCH_SAMPLES		(32)		/* RSS samples per step */
+#define MALLOC_BENCH_RING		(4096)		/* producer to consumer ring */
+#define MALLOC_BENCH_CLASSES		(33)		/* log2 size classes */
+#define MALLOC_BENCH_LAT_BUCKETS	(96)		/* 4 latency buckets per power of 2 ns */
+#define MALLOC_BENCH_SAMPLE_MASK	(7)		/* time 1 in 8 allocations */
+#define MALLOC_BENCH_SIZES		(65536)		/* precomputed size table */
+#define MALLOC_BENCH_MAX_COUNTS		(8)		/* 1, 2, 4 .. 32 threads */
+#define MALLOC_BENCH_TRACE_MAX_ID	(1U << 20)
+#define MALLOC_BENCH_TRACE_MAX_OPS	(16U << 20)
+#define MALLOC_BENCH_FIXED_BYTES	(64)
+#define MALLOC_BENCH_POWERLAW_MIN	(16)
+#define MALLOC_BENCH_POWERLAW_ALPHA	(1.3)
+
+#define MALLOC_BENCH_FIXED		(1)
+#define MALLOC_BENCH_POWERLAW		(2)
+#define MALLOC_BENCH_TRACE		(3)
+
+typedef struct {
+	uint32_t id;			/* trace allocation id */
+	uint32_t size;			/* allocation size, 0 = free */
+} stress_malloc_trace_op_t;
+
+typedef struct {
+	void *ptr;			/* allocation handed to consumer */
+	size_t len;			/* allocation length */
+} stress_malloc_ring_slot_t;
+
+typedef struct {
+	uint32_t head ALIGN64;		/* written by producer */
+	uint32_t tail ALIGN64;		/* written by consumer */
+	bool done ALIGN64;		/* producer has finished */
+	stress_malloc_ring_slot_t slots[MALLOC_BENCH_RING];
+} stress_malloc_ring_t;
+
+typedef struct stress_malloc_bench stress_malloc_bench_t;
+
+typedef struct {
+	stress_malloc_bench_t *bench;	/* shared benchmark state */
+	stress_malloc_ring_t *ring;	/* cross thread free ring, NULL if local */
+	pthread_t pthread;		/* the pthread */
+	int ret;			/* pthread create return */
+	size_t index;			/* thread index */
+	size_t trace_pos;		/* trace replay position */
+	uint64_t allocs;		/* allocations this step */
+	uint64_t alloc_bytes;		/* bytes allocated this step */
+	uint64_t free_bytes;		/* bytes freed this step */
+	uint64_t hist[MALLOC_BENCH_CLASSES][MALLOC_BENCH_LAT_BUCKETS];
+} ALIGN64 stress_malloc_bench_thread_t;
+
+struct stress_malloc_bench {
+	const stress_args_t *args;	/* args info */
+	size_t dist;			/* size distribution */
+	size_t *sizes;			/* precomputed sizes, fixed/powerlaw */
+	stress_malloc_trace_op_t *ops;	/* trace operations */
+	size_t n_ops;			/* number of trace operations */
+	size_t n_slots;			/* live allocation slots per thread */
+	bool xfree;			/* free on consumer thread */
+	bool verify;			/* verify allocations */
+	volatile bool stop;		/* end of step */
+};
+
+typedef struct {
+	uint32_t threads;		/* thread count */
+	double duration;		/* total run time */
+	uint64_t allocs;		/* total allocations */
+	size_t rss_peak;		/* peak RSS growth */
+	size_t retained;		/* RSS growth after all frees */
+	double frag;			/* sum of fragmentation samples */
+	size_t frag_samples;		/* number of fragmentation samples */
+	size_t n_rss;			/* timeline samples, last sweep */
+	size_t rss[MALLOC_BENCH_SAMPLES];
+	double frag_timeline[MALLOC_BENCH_SAMPLES];
+	uint64_t hist[MALLOC_BENCH_LAT_BUCKETS];
+} stress_malloc_bench_stats_t;
+
+static const char * const malloc_bench_dists[] = {
+	"fixed",
+	"powerlaw",
+	"trace",
+};
+
+static int stress_set_malloc_bench(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(malloc_bench_dists); i++) {
+		if (!strcmp(opt, malloc_bench_dists[i])) {
+			const size_t dist = i + 1;
+
+			return stress_set_setting("malloc-bench", TYPE_ID_SIZE_T, &dist);
+		}
+	}
+	(void)fprintf(stderr, "malloc-bench must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(malloc_bench_dists); i++)
+		(void)fprintf(stderr, " %s", malloc_bench_dists[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+#else
+static int stress_set_malloc_bench(const char *opt)
+{
+	(void)opt;
+
+	(void)fprintf(stderr, "malloc-bench requires pthread support\n");
+	return -1;
+}
+#endif
+
+static int stress_set_malloc_bench_trace(const char *opt)
+{
+	return stress_set_setting("malloc-bench-trace", TYPE_ID_STR, opt);
+}
+
+static int stress_set_malloc_bench_xfree(const char *opt)
+{
+	return stress_set_setting_true("malloc-bench-xfree", opt);
+}
+
 static int stress_set_malloc_bytes(const char *opt)
 {
 	size_t bytes;
@@ -318,6 +453,671 @@ static void *stress_malloc_loop(void *ptr)
 	return &nowt;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_malloc_bench_bucket()
+ *	map latency in ns to a log2 bucket with 4 sub-buckets
+ *	per power of 2
+ */
+static inline size_t stress_malloc_bench_bucket(const uint64_t ns)
+{
+	size_t msb, bucket;
+
+	if (ns < 8)
+		return (size_t)ns;
+	msb = (size_t)stress_msb64(ns);
+	bucket = (4 * (msb - 1)) + (size_t)((ns >> (msb - 2)) & 3);
+
+	return (bucket < MALLOC_BENCH_LAT_BUCKETS) ? bucket : MALLOC_BENCH_LAT_BUCKETS - 1;
+}
+
+/*
+ *  stress_malloc_bench_bucket_ns()
+ *	upper bound in ns of a latency bucket
+ */
+static uint64_t stress_malloc_bench_bucket_ns(const size_t bucket)
+{
+	size_t msb;
+
+	if (bucket < 8)
+		return (uint64_t)bucket;
+	msb = (bucket / 4) + 1;
+
+	return ((uint64_t)(4 + (bucket & 3) + 1) << (msb - 2)) - 1;
+}
+
+/*
+ *  stress_malloc_bench_percentile()
+ *	latency in ns at percentile pct of a bucket histogram
+ */
+static uint64_t stress_malloc_bench_percentile(const uint64_t *hist, const double pct)
+{
+	uint64_t total = 0, sum = 0, target;
+	size_t i;
+
+	for (i = 0; i < MALLOC_BENCH_LAT_BUCKETS; i++)
+		total += hist[i];
+	if (!total)
+		return 0;
+	target = (uint64_t)((double)total * pct / 100.0);
+	if (target < 1)
+		target = 1;
+	for (i = 0; i < MALLOC_BENCH_LAT_BUCKETS; i++) {
+		sum += hist[i];
+		if (sum >= target)
+			break;
+	}
+	return stress_malloc_bench_bucket_ns(i < MALLOC_BENCH_LAT_BUCKETS ? i : MALLOC_BENCH_LAT_BUCKETS - 1);
+}
+
+/*
+ *  stress_malloc_bench_rss()
+ *	resident set size in bytes from /proc/self/statm, 0 if unknown
+ */
+static size_t stress_malloc_bench_rss(const size_t page_size)
+{
+	char buf[128];
+	unsigned long int size, resident;
+	ssize_t ret;
+	int fd;
+
+	fd = open("/proc/self/statm", O_RDONLY);
+	if (fd < 0)
+		return 0;
+	ret = read(fd, buf, sizeof(buf) - 1);
+	(void)close(fd);
+	if (ret <= 0)
+		return 0;
+	buf[ret] = '\0';
+	if (sscanf(buf, "%lu %lu", &size, &resident) != 2)
+		return 0;
+	return (size_t)resident * page_size;
+}
+
+/*
+ *  stress_malloc_bench_alloc()
+ *	allocate len bytes, timing 1 in 8 allocations
+ */
+static inline void *stress_malloc_bench_alloc(
+	stress_malloc_bench_thread_t *t,
+	const size_t len,
+	const size_t page_size)
+{
+	uintptr_t *ptr;
+
+	if ((t->allocs & MALLOC_BENCH_SAMPLE_MASK) == 0) {
+		const uint64_t t1 = stress_clock_ns();
+		size_t class;
+
+		ptr = (uintptr_t *)malloc(len);
+		class = (size_t)stress_msb64((uint64_t)len);
+		if (class >= MALLOC_BENCH_CLASSES)
+			class = MALLOC_BENCH_CLASSES - 1;
+		t->hist[class][stress_malloc_bench_bucket(stress_clock_delta_ns(t1, stress_clock_ns()))]++;
+	} else {
+		ptr = (uintptr_t *)malloc(len);
+	}
+	if (UNLIKELY(!ptr))
+		return NULL;
+
+	if (malloc_touch)
+		stress_malloc_page_touch((uint8_t *)ptr, len, page_size);
+	if (len >= sizeof(*ptr))
+		*ptr = (uintptr_t)ptr;	/* stash address */
+	else
+		*(uint8_t *)ptr = 0xff;
+	t->allocs++;
+	__atomic_store_n(&t->alloc_bytes, t->alloc_bytes + len, __ATOMIC_RELAXED);
+
+	return ptr;
+}
+
+/*
+ *  stress_malloc_bench_free()
+ *	verify and free an allocation
+ */
+static inline void stress_malloc_bench_free(
+	stress_malloc_bench_thread_t *t,
+	uintptr_t *ptr,
+	const size_t len)
+{
+	const stress_malloc_bench_t *b = t->bench;
+
+	if (b->verify && (len >= sizeof(*ptr)) && ((uintptr_t)ptr != *ptr)) {
+		pr_fail("%s: allocation at %p does not contain correct value\n",
+			b->args->name, (void *)ptr);
+	}
+	free_func(ptr, len);
+	__atomic_store_n(&t->free_bytes, t->free_bytes + len, __ATOMIC_RELAXED);
+}
+
+/*
+ *  stress_malloc_bench_next()
+ *	next operation: returns size to allocate into slot *id,
+ *	or 0 to free slot *id
+ */
+static inline size_t stress_malloc_bench_next(
+	stress_malloc_bench_thread_t *t,
+	size_t *id)
+{
+	const stress_malloc_bench_t *b = t->bench;
+
+	if (b->dist == MALLOC_BENCH_TRACE) {
+		const stress_malloc_trace_op_t *op = &b->ops[t->trace_pos];
+
+		if (++t->trace_pos >= b->n_ops)
+			t->trace_pos = 0;
+		*id = (size_t)op->id;
+		return (size_t)op->size;
+	} else {
+		const uint32_t rnd = stress_mwc32();
+
+		*id = (size_t)((rnd >> 16) % b->n_slots);
+		return b->sizes[rnd & (MALLOC_BENCH_SIZES - 1)];
+	}
+}
+
+/*
+ *  stress_malloc_bench_local()
+ *	allocate and free on the same thread, keeping up to
+ *	n_slots allocations live
+ */
+static void *stress_malloc_bench_local(void *arg)
+{
+	static void *nowt = NULL;
+	stress_malloc_bench_thread_t *t = (stress_malloc_bench_thread_t *)arg;
+	const stress_malloc_bench_t *b = t->bench;
+	const size_t page_size = b->args->page_size;
+	stress_malloc_info_t *info;
+	size_t i;
+
+	info = (stress_malloc_info_t *)calloc(b->n_slots, sizeof(*info));
+	if (!info)
+		return &nowt;
+
+	while (!b->stop) {
+		size_t id;
+		const size_t len = stress_malloc_bench_next(t, &id);
+		stress_malloc_info_t *slot = &info[id];
+
+		if (slot->addr) {
+			/* trace frees, or random slot already in use */
+			stress_malloc_bench_free(t, slot->addr, (size_t)slot->len);
+			slot->addr = NULL;
+			slot->len = 0;
+			if ((b->dist != MALLOC_BENCH_TRACE) || !len)
+				continue;
+		}
+		if (len) {
+			slot->addr = stress_malloc_bench_alloc(t, len, page_size);
+			slot->len = slot->addr ? (ssize_t)len : 0;
+		}
+	}
+
+	for (i = 0; i < b->n_slots; i++) {
+		if (info[i].addr)
+			stress_malloc_bench_free(t, info[i].addr, (size_t)info[i].len);
+	}
+	free(info);
+
+	return &nowt;
+}
+
+/*
+ *  stress_malloc_bench_producer()
+ *	allocate and hand allocations to the paired consumer
+ */
+static void *stress_malloc_bench_producer(void *arg)
+{
+	static void *nowt = NULL;
+	stress_malloc_bench_thread_t *t = (stress_malloc_bench_thread_t *)arg;
+	const stress_malloc_bench_t *b = t->bench;
+	stress_malloc_ring_t *ring = t->ring;
+	const size_t page_size = b->args->page_size;
+	uint32_t head = ring->head;
+
+	while (!b->stop) {
+		size_t id, len;
+		void *ptr;
+
+		/* trace frees are done by the consumer in ring order */
+		len = stress_malloc_bench_next(t, &id);
+		if (!len)
+			continue;
+		ptr = stress_malloc_bench_alloc(t, len, page_size);
+		if (!ptr)
+			continue;
+		while ((head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) >= MALLOC_BENCH_RING) {
+			if (b->stop) {
+				stress_malloc_bench_free(t, ptr, len);
+				goto done;
+			}
+			(void)shim_sched_yield();
+		}
+		ring->slots[head % MALLOC_BENCH_RING].ptr = ptr;
+		ring->slots[head % MALLOC_BENCH_RING].len = len;
+		head++;
+		__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+	}
+done:
+	__atomic_store_n(&ring->done, true, __ATOMIC_RELEASE);
+
+	return &nowt;
+}
+
+/*
+ *  stress_malloc_bench_consumer()
+ *	free allocations made by the paired producer
+ */
+static void *stress_malloc_bench_consumer(void *arg)
+{
+	static void *nowt = NULL;
+	stress_malloc_bench_thread_t *t = (stress_malloc_bench_thread_t *)arg;
+	stress_malloc_ring_t *ring = t->ring;
+	uint32_t tail = ring->tail;
+
+	for (;;) {
+		const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+		if (head == tail) {
+			if (__atomic_load_n(&ring->done, __ATOMIC_ACQUIRE) &&
+			    (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail))
+				break;
+			(void)shim_sched_yield();
+			continue;
+		}
+		while (tail != head) {
+			stress_malloc_ring_slot_t *slot = &ring->slots[tail % MALLOC_BENCH_RING];
+
+			stress_malloc_bench_free(t, slot->ptr, slot->len);
+			tail++;
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	return &nowt;
+}
+
+/*
+ *  stress_malloc_bench_step()
+ *	run n threads for one step, sampling RSS and fragmentation
+ */
+static void stress_malloc_bench_step(
+	stress_malloc_bench_t *b,
+	stress_malloc_bench_thread_t *threads,
+	stress_malloc_ring_t *rings,
+	const uint32_t n,
+	stress_malloc_bench_stats_t *st)
+{
+	const stress_args_t *args = b->args;
+	const size_t page_size = args->page_size;
+	const size_t rss0 = stress_malloc_bench_rss(page_size);
+	size_t i, k, rss_after;
+	double t_start, duration;
+
+	b->stop = false;
+	for (i = 0; i < n; i++) {
+		stress_malloc_bench_thread_t *t = &threads[i];
+		void *(*func)(void *) = stress_malloc_bench_local;
+
+		t->bench = b;
+		t->index = i;
+		t->ring = NULL;
+		t->allocs = 0;
+		t->alloc_bytes = 0;
+		t->free_bytes = 0;
+		(void)memset(t->hist, 0, sizeof(t->hist));
+		if (b->xfree) {
+			t->ring = &rings[i / 2];
+			func = (i & 1) ? stress_malloc_bench_consumer : stress_malloc_bench_producer;
+			if ((i & 1) == 0) {
+				t->ring->head = 0;
+				t->ring->tail = 0;
+				t->ring->done = false;
+			}
+		}
+		/* stagger trace replay so threads are not in lock step */
+		t->trace_pos = b->n_ops ? (i * (b->n_ops / n)) % b->n_ops : 0;
+		t->ret = pthread_create(&t->pthread, NULL, func, (void *)t);
+		/* a consumer with no producer would never see the ring finish */
+		if (b->xfree && t->ret)
+			__atomic_store_n(&t->ring->done, true, __ATOMIC_RELEASE);
+	}
+
+	t_start = stress_time_now();
+	st->n_rss = 0;
+	for (k = 0; k < MALLOC_BENCH_SAMPLES; k++) {
+		size_t rss, live = 0;
+
+		(void)shim_usleep((uint64_t)(MALLOC_BENCH_STEP * 1000000.0 / MALLOC_BENCH_SAMPLES));
+		rss = stress_malloc_bench_rss(page_size);
+		for (i = 0; i < n; i++) {
+			live += (size_t)__atomic_load_n(&threads[i].alloc_bytes, __ATOMIC_RELAXED);
+			live -= (size_t)__atomic_load_n(&threads[i].free_bytes, __ATOMIC_RELAXED);
+		}
+		rss = (rss > rss0) ? rss - rss0 : 0;
+		if (rss > st->rss_peak)
+			st->rss_peak = rss;
+		st->rss[st->n_rss] = rss;
+		st->frag_timeline[st->n_rss] = 0.0;
+		if ((rss > 0) && (rss > live)) {
+			st->frag_timeline[st->n_rss] = 100.0 * (double)(rss - live) / (double)rss;
+			st->frag += st->frag_timeline[st->n_rss];
+		}
+		st->frag_samples++;
+		st->n_rss++;
+		if (!keep_stressing_flag())
+			break;
+	}
+	b->stop = true;
+
+	for (i = 0; i < n; i++) {
+		if (!threads[i].ret)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+	duration = stress_time_now() - t_start;
+
+	/* free anything left in a ring whose consumer did not run */
+	if (b->xfree) {
+		for (i = 0; i + 1 < n; i += 2) {
+			stress_malloc_ring_t *ring = &rings[i / 2];
+
+			while (ring->tail != ring->head) {
+				stress_malloc_ring_slot_t *slot = &ring->slots[ring->tail % MALLOC_BENCH_RING];
+
+				free_func(slot->ptr, slot->len);
+				ring->tail++;
+			}
+		}
+	}
+	rss_after = stress_malloc_bench_rss(page_size);
+	st->retained = (rss_after > rss0) ? rss_after - rss0 : 0;
+
+	st->threads = n;
+	st->duration += duration;
+	for (i = 0; i < n; i++) {
+		size_t c, j;
+
+		st->allocs += threads[i].allocs;
+		for (c = 0; c < MALLOC_BENCH_CLASSES; c++)
+			for (j = 0; j < MALLOC_BENCH_LAT_BUCKETS; j++)
+				st->hist[j] += threads[i].hist[c][j];
+	}
+}
+
+/*
+ *  stress_malloc_bench_trace_load()
+ *	load an allocation trace, one operation per line:
+ *	"a ID SIZE" to allocate, "f ID" to free, '#' comments
+ */
+static int stress_malloc_bench_trace_load(stress_malloc_bench_t *b, const char *filename)
+{
+	const stress_args_t *args = b->args;
+	FILE *fp;
+	char line[256];
+	size_t n = 0, lineno = 0, max_id = 0;
+	bool ok = true;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		pr_inf("%s: cannot open trace file %s, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return -1;
+	}
+	b->ops = NULL;
+	b->n_ops = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		char op;
+		unsigned long int id, size = 0;
+		int ret;
+
+		lineno++;
+		ret = sscanf(line, " %c %lu %lu", &op, &id, &size);
+		if ((ret < 1) || (op == '#'))
+			continue;
+		if ((ret < 2) || (id >= MALLOC_BENCH_TRACE_MAX_ID) ||
+		    ((op == 'a') && ((ret != 3) || (size == 0) || (size > MAX_32))) ||
+		    ((op != 'a') && (op != 'f'))) {
+			pr_inf("%s: trace file %s line %zu is malformed or out of range\n",
+				args->name, filename, lineno);
+			ok = false;
+			break;
+		}
+		if (n >= MALLOC_BENCH_TRACE_MAX_OPS)
+			break;
+		if (n == b->n_ops) {
+			const size_t new_n = n ? n * 2 : 4096;
+			stress_malloc_trace_op_t *ops;
+
+			ops = (stress_malloc_trace_op_t *)realloc(b->ops, new_n * sizeof(*ops));
+			if (!ops) {
+				pr_inf("%s: cannot allocate trace buffer\n", args->name);
+				ok = false;
+				break;
+			}
+			b->ops = ops;
+			b->n_ops = new_n;
+		}
+		b->ops[n].id = (uint32_t)id;
+		b->ops[n].size = (op == 'a') ? (uint32_t)size : 0;
+		if (id > max_id)
+			max_id = id;
+		n++;
+	}
+	(void)fclose(fp);
+
+	if (ok && (n == 0)) {
+		pr_inf("%s: trace file %s contains no operations\n", args->name, filename);
+		ok = false;
+	}
+	if (!ok) {
+		free(b->ops);
+		b->ops = NULL;
+		b->n_ops = 0;
+		return -1;
+	}
+	b->n_ops = n;
+	b->n_slots = max_id + 1;
+
+	return 0;
+}
+
+/*
+ *  stress_malloc_bench()
+ *	allocator benchmark, sweep thread counts and report
+ *	allocs/sec, p99 allocation latency, RSS and fragmentation
+ */
+static int stress_malloc_bench(const stress_args_t *args, const size_t dist, const bool xfree)
+{
+	stress_malloc_bench_t b;
+	stress_malloc_bench_thread_t *threads;
+	stress_malloc_ring_t *rings;
+	stress_malloc_bench_stats_t stats[MALLOC_BENCH_MAX_COUNTS];
+	uint64_t class_hist[MALLOC_BENCH_CLASSES][MALLOC_BENCH_LAT_BUCKETS];
+	uint32_t counts[MALLOC_BENCH_MAX_COUNTS];
+	uint32_t max_threads, c, n_counts = 0;
+	const size_t threads_size = sizeof(*threads) * MAX_MALLOC_PTHREADS;
+	const size_t rings_size = sizeof(*rings) * (MAX_MALLOC_PTHREADS / 2);
+	const bool report = (args->instance == 0);
+	size_t i, idx = 0;
+	int ret = EXIT_SUCCESS;
+	bool lock = false;
+
+	(void)memset(&b, 0, sizeof(b));
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(class_hist, 0, sizeof(class_hist));
+	b.args = args;
+	b.dist = dist;
+	b.xfree = xfree;
+	b.verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	b.n_slots = malloc_max;
+
+	if (dist == MALLOC_BENCH_TRACE) {
+		char *filename = NULL;
+
+		(void)stress_get_setting("malloc-bench-trace", &filename);
+		if (!filename) {
+			if (report)
+				pr_inf("%s: --malloc-bench trace requires --malloc-bench-trace FILE\n", args->name);
+			return EXIT_FAILURE;
+		}
+		if (stress_malloc_bench_trace_load(&b, filename) < 0)
+			return EXIT_FAILURE;
+	} else {
+		b.sizes = (size_t *)malloc(sizeof(*b.sizes) * MALLOC_BENCH_SIZES);
+		if (!b.sizes) {
+			pr_inf_skip("%s: cannot allocate size table, skipping stressor\n", args->name);
+			return EXIT_NO_RESOURCE;
+		}
+		for (i = 0; i < MALLOC_BENCH_SIZES; i++) {
+			if (dist == MALLOC_BENCH_FIXED) {
+				b.sizes[i] = malloc_bytes_set ? malloc_bytes : MALLOC_BENCH_FIXED_BYTES;
+			} else {
+				/* Pareto, many small allocations with a long tail up to malloc-bytes */
+				const double u = ((double)stress_mwc32() + 1.0) / 4294967296.0;
+				const double sz = MALLOC_BENCH_POWERLAW_MIN * pow(u, -1.0 / MALLOC_BENCH_POWERLAW_ALPHA);
+
+				b.sizes[i] = (sz < (double)malloc_bytes) ? (size_t)sz : malloc_bytes;
+			}
+		}
+	}
+
+	threads = (stress_malloc_bench_thread_t *)mmap(NULL, threads_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap thread data, skipping stressor\n", args->name);
+		ret = EXIT_NO_RESOURCE;
+		goto free_data;
+	}
+	rings = (stress_malloc_ring_t *)mmap(NULL, rings_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (rings == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap ring buffers, skipping stressor\n", args->name);
+		ret = EXIT_NO_RESOURCE;
+		goto unmap_threads;
+	}
+
+	max_threads = (uint32_t)malloc_pthreads;
+	if (max_threads == 0) {
+		const int32_t cpus = stress_get_processors_online();
+
+		max_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+		if (xfree)
+			max_threads *= 2;
+	}
+	if (max_threads > MAX_MALLOC_PTHREADS)
+		max_threads = MAX_MALLOC_PTHREADS;
+	if (xfree)
+		max_threads = (max_threads < 2) ? 2 : max_threads & ~1U;
+	for (c = xfree ? 2 : 1; (c < max_threads) && (n_counts < MALLOC_BENCH_MAX_COUNTS - 1); c *= 2)
+		counts[n_counts++] = c;
+	counts[n_counts++] = max_threads;
+
+	do {
+		for (c = 0; (c < n_counts) && keep_stressing(args); c++) {
+			stress_malloc_bench_thread_t *t;
+			uint64_t before = stats[c].allocs;
+
+			stress_malloc_bench_step(&b, threads, rings, counts[c], &stats[c]);
+			for (t = threads; t < threads + counts[c]; t++) {
+				size_t cl, j;
+
+				for (cl = 0; cl < MALLOC_BENCH_CLASSES; cl++)
+					for (j = 0; j < MALLOC_BENCH_LAT_BUCKETS; j++)
+						class_hist[cl][j] += t->hist[cl][j];
+			}
+			add_counter(args, stats[c].allocs - before);
+		}
+	} while (keep_stressing(args));
+
+	if (report) {
+		pr_lock(&lock);
+		pr_inf_lock(&lock, "%s: %s distribution%s, %s allocator scaling:\n",
+			args->name, malloc_bench_dists[dist - 1],
+			xfree ? ", cross thread free" : "",
+			xfree ? "producer/consumer" : "per thread");
+		pr_inf_lock(&lock, "%s: %7s %13s %9s %11s %9s %12s\n",
+			args->name, "threads", "allocs/sec", "p99 ns",
+			"peak RSS MB", "frag %", "retained MB");
+		for (c = 0; c < n_counts; c++) {
+			const stress_malloc_bench_stats_t *st = &stats[c];
+
+			if (st->duration <= 0.0)
+				continue;
+			pr_inf_lock(&lock, "%s: %7" PRIu32 " %13.0f %9" PRIu64 " %11.2f %9.2f %12.2f\n",
+				args->name, st->threads, (double)st->allocs / st->duration,
+				stress_malloc_bench_percentile(st->hist, 99.0),
+				(double)st->rss_peak / MB,
+				st->frag_samples ? st->frag / st->frag_samples : 0.0,
+				(double)st->retained / MB);
+		}
+		for (c = 0; c < n_counts; c++) {
+			const stress_malloc_bench_stats_t *st = &stats[c];
+			char buf[MALLOC_BENCH_SAMPLES * 16];
+			size_t k, len = 0;
+
+			if (!st->n_rss)
+				continue;
+			for (k = 0; (k < st->n_rss) && (len < sizeof(buf)); k += 4) {
+				len += (size_t)snprintf(buf + len, sizeof(buf) - len, " %.1f/%.0f%%",
+					(double)st->rss[k] / MB, st->frag_timeline[k]);
+			}
+			pr_dbg_lock(&lock, "%s: %2" PRIu32 " threads RSS MB/frag over time:%s\n",
+				args->name, st->threads, buf);
+		}
+		pr_inf_lock(&lock, "%s: %11s %12s %7s %9s %9s\n",
+			args->name, "size class", "allocs", "%", "p50 ns", "p99 ns");
+		{
+			uint64_t total = 0;
+			size_t cl, j;
+
+			for (cl = 0; cl < MALLOC_BENCH_CLASSES; cl++)
+				for (j = 0; j < MALLOC_BENCH_LAT_BUCKETS; j++)
+					total += class_hist[cl][j];
+			for (cl = 0; (cl < MALLOC_BENCH_CLASSES) && total; cl++) {
+				uint64_t count = 0;
+				char range[24];
+
+				for (j = 0; j < MALLOC_BENCH_LAT_BUCKETS; j++)
+					count += class_hist[cl][j];
+				if (!count)
+					continue;
+				(void)snprintf(range, sizeof(range), "<%" PRIu64,
+					(uint64_t)1 << (cl + 1));
+				pr_inf_lock(&lock, "%s: %11s %12" PRIu64 " %6.2f%% %9" PRIu64 " %9" PRIu64 "\n",
+					args->name, range, count, 100.0 * (double)count / (double)total,
+					stress_malloc_bench_percentile(class_hist[cl], 50.0),
+					stress_malloc_bench_percentile(class_hist[cl], 99.0));
+			}
+		}
+		pr_unlock(&lock);
+	}
+
+	if ((stats[0].duration > 0.0) && (stats[n_counts - 1].duration > 0.0)) {
+		const stress_malloc_bench_stats_t *s1 = &stats[0];
+		const stress_malloc_bench_stats_t *sn = &stats[n_counts - 1];
+
+		idx = stress_misc_stats_thread_scaling(args->misc_stats, idx, "allocs/sec",
+			s1->threads, (double)s1->allocs / s1->duration,
+			sn->threads, (double)sn->allocs / sn->duration);
+		stress_misc_stats_set(args->misc_stats, idx++, "p99 alloc latency ns",
+			(double)stress_malloc_bench_percentile(sn->hist, 99.0));
+		stress_misc_stats_set(args->misc_stats, idx++, "peak RSS MB", (double)sn->rss_peak / MB);
+		stress_misc_stats_set(args->misc_stats, idx++, "fragmentation %",
+			sn->frag_samples ? sn->frag / sn->frag_samples : 0.0);
+	}
+
+	(void)munmap((void *)rings, rings_size);
+unmap_threads:
+	(void)munmap((void *)threads, threads_size);
+free_data:
+	free(b.sizes);
+	free(b.ops);
+
+	return ret;
+}
+#endif
+
 static int stress_malloc_child(const stress_args_t *args, void *context)
 {
 #if defined(HAVE_LIB_PTHREAD)
@@ -340,6 +1140,13 @@ static int stress_malloc_child(const stress_args_t *args, void *context)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 #if defined(HAVE_LIB_PTHREAD)
+	if (malloc_bench) {
+		const int ret = stress_malloc_bench(args, malloc_bench, malloc_bench_xfree);
+
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return ret;
+	}
+
 	keep_thread_running_flag = true;
 	(void)memset(pthreads, 0, sizeof(pthreads));
 	for (j = 0; j < malloc_pthreads; j++) {
@@ -392,7 +1199,8 @@ static int stress_malloc(const stress_args_t *args)
 	}
 
 	malloc_bytes = DEFAULT_MALLOC_BYTES;
-	if (!stress_get_setting("malloc-bytes", &malloc_bytes)) {
+	malloc_bytes_set = stress_get_setting("malloc-bytes", &malloc_bytes);
+	if (!malloc_bytes_set) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			malloc_bytes = MAX_32;
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
@@ -425,6 +1233,11 @@ static int stress_malloc(const stress_args_t *args)
 	(void)stress_get_setting("malloc-zerofree", &malloc_zerofree);
 	free_func = malloc_zerofree ? stress_malloc_zerofree : stress_malloc_free;
 
+	malloc_bench = 0;
+	malloc_bench_xfree = false;
+	(void)stress_get_setting("malloc-bench", &malloc_bench);
+	(void)stress_get_setting("malloc-bench-xfree", &malloc_bench_xfree);
+
 	ret = stress_oomable_child(args, NULL, stress_malloc_child, STRESS_OOMABLE_NORMAL);
 
 	(void)stress_lock_destroy(counter_lock);
@@ -433,6 +1246,9 @@ static int stress_malloc(const stress_args_t *args)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_malloc_bench,	stress_set_malloc_bench },
+	{ OPT_malloc_bench_trace, stress_set_malloc_bench_trace },
+	{ OPT_malloc_bench_xfree, stress_set_malloc_bench_xfree },
 	{ OPT_malloc_max,	stress_set_malloc_max },
 	{ OPT_malloc_bytes,	stress_set_malloc_bytes },
 	{ OPT_malloc_pthreads,	stress_set_malloc_pthreads },
@@ -30,6 +30,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"matrix-3d-ops N",	"stop after N 3D maxtrix bogo operations" },
 	{ NULL,	"matrix-3d-method M",	"specify 3D matrix stress method M, default is all" },
 	{ NULL,	"matrix-3d-size N",	"specify the size of the N x N x N matrix" },
+	{ NULL,	"matrix-3d-type T",	"specify the element type, f16, bf16, f32, f64, int8 or int32" },
 	{ NULL,	"matrix-3d-zyx",	"matrix operation is z by y by x instead of x by y by z" },
 	{ NULL,	NULL,			NULL }
 };
@@ -37,23 +38,49 @@ static const stress_help_t help[] = {
 #if defined(HAVE_VLA_ARG) &&	\
     !defined(__PCC__)
 
-typedef float 	stress_matrix_3d_type_t;
-
 /*
- *  the matrix stress test has different classes of maxtrix stressor
+ *  3D matrix methods, name, x by y by z function, z by y by x
+ *  function and the flop count multiplier of the n^3 elements
  */
-typedef void (*stress_matrix_3d_func)(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n]);
+#define STRESS_MATRIX_3D_METHODS(MACRO, tname)					\
+	MACRO("add",		xyz_add,	zyx_add,	1, tname)	\
+	MACRO("copy",		xyz_copy,	zyx_copy,	0, tname)	\
+	MACRO("div",		xyz_div,	zyx_div,	1, tname)	\
+	MACRO("frobenius",	xyz_frobenius,	zyx_frobenius,	2, tname)	\
+	MACRO("hadamard",	xyz_hadamard,	zyx_hadamard,	1, tname)	\
+	MACRO("identity",	xyz_identity,	zyx_identity,	0, tname)	\
+	MACRO("mean",		xyz_mean,	zyx_mean,	2, tname)	\
+	MACRO("mult",		xyz_mult,	zyx_mult,	1, tname)	\
+	MACRO("negate",		xyz_negate,	zyx_negate,	1, tname)	\
+	MACRO("sub",		xyz_sub,	zyx_sub,	1, tname)	\
+	MACRO("trans",		xyz_trans,	zyx_trans,	0, tname)	\
+	MACRO("zero",		xyz_zero,	zyx_zero,	0, tname)
+
+#define STRESS_MATRIX_3D_FUNC_ENTRY(name, xyz, zyx, flops, tname)		\
+	{ stress_matrix_3d_ ## xyz ## _ ## tname, stress_matrix_3d_ ## zyx ## _ ## tname },
+
+#define STRESS_MATRIX_3D_INFO_ENTRY(name, xyz, zyx, flops, tname)		\
+	{ name, flops },
 
 typedef struct {
-	const char			*name;		/* human readable form of stressor */
-	const stress_matrix_3d_func	func[2];	/* method functions, x by y by z, z by y by x */
+	const char		*name;		/* human readable form of stressor */
+	const uint8_t		flops;		/* flop count is flops x n^3 */
 } stress_matrix_3d_method_info_t;
 
-static const stress_matrix_3d_method_info_t matrix_3d_methods[];
+typedef struct {
+	const char		*name;		/* element type name */
+	const size_t		size;		/* element size in bytes */
+	const bool		fp;		/* floating point type */
+	void (*init)(const size_t n, void *a, void *b, void *r);
+	void (*run)(const size_t method, const size_t matrix_3d_zyx,
+		const size_t n, void *a, void *b, void *r);
+} stress_matrix_3d_type_info_t;
+
+static const stress_matrix_3d_method_info_t matrix_3d_methods[] = {
+	{ "all",	0 },		/* Special "all" test */
+	STRESS_MATRIX_3D_METHODS(STRESS_MATRIX_3D_INFO_ENTRY, none)
+	{ NULL,		0 }
+};
 
 static int stress_set_matrix_3d_size(const char *opt)
 {
@@ -75,757 +102,801 @@ static int stress_set_matrix_3d_zyx(const char *opt)
 }
 
 /*
- *  stress_matrix_3d_xyz_add()
- *	matrix addition
+ *  stress_matrix_3d_data_fp()
+ *	generate some random floating point data in the range 0..scale
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_add(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
+static inline double stress_matrix_3d_data_fp(const double scale)
 {
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = a[i][j][k] + b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+	return (double)stress_mwc64() * (scale / (double)((uint64_t)~0));
 }
 
 /*
- *  stress_matrix_3d_zyx_add()
- *	matrix addition
+ *  stress_matrix_3d_data_int()
+ *	generate some random non-zero integer data in the range 1..max
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_add(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
+static inline int32_t stress_matrix_3d_data_int(const uint32_t max)
 {
-	register size_t k;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = a[i][j][k] + b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+	return (int32_t)(1 + (stress_mwc32() % max));
 }
 
 /*
- *  stress_matrix_3d_xyz_sub()
- *	matrix subtraction
+ *  STRESS_MATRIX_3D_ADD()
+ *	matrix addition
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_sub(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = a[i][j][k] - b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_ADD(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_add_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = a[i][j][k] + b[i][j][k];		\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_add_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = a[i][j][k] + b[i][j][k];		\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_zyx_add()
+ *  STRESS_MATRIX_3D_SUB()
  *	matrix subtraction
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_sub(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = a[i][j][k] + b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_SUB(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_sub_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = a[i][j][k] - b[i][j][k];		\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_sub_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = a[i][j][k] + b[i][j][k];		\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_trans()
+ *  STRESS_MATRIX_3D_TRANS()
  *	matrix transpose
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_trans(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],	/* Ignored */
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = a[k][j][i];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_TRANS(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_trans_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],	/* Ignored */				\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = a[k][j][i];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_trans_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],	/* Ignored */				\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	(void)b;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = a[k][j][i];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_trans()
- *	matrix transpose
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_trans(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],	/* Ignored */
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	(void)b;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = a[k][j][i];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_mult()
+ *  STRESS_MATRIX_3D_MULT()
  *	matrix scalar multiply
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_mult(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-	stress_matrix_3d_type_t v = b[0][0][0];
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = v * a[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_MULT(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_mult_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+	type v = b[0][0][0];							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = v * a[i][j][k];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_mult_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+	type v = b[0][0][0];							\
+										\
+	(void)b;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = v * a[i][j][k];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_mult()
- *	matrix scalar multiply
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_mult(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-	stress_matrix_3d_type_t v = b[0][0][0];
-
-	(void)b;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = v * a[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_div()
+ *  STRESS_MATRIX_3D_DIV()
  *	matrix scalar divide
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_div(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-	stress_matrix_3d_type_t v = b[0][0][0];
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = a[i][j][k] / v;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_div()
- *	matrix scalar divide
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_div(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-	stress_matrix_3d_type_t v = b[0][0][0];
-
-	(void)b;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = a[i][j][k] / v;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_hadamard()
- *	matrix hadamard product
- *	(A o B)ij = AijBij
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_hadamard(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = a[i][j][k] * b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_DIV(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_div_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+	type v = b[0][0][0];							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = a[i][j][k] / v;			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_div_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+	type v = b[0][0][0];							\
+										\
+	(void)b;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = a[i][j][k] / v;			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_hadamard()
+ *  STRESS_MATRIX_3D_HADAMARD()
  *	matrix hadamard product
  *	(A o B)ij = AijBij
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_hadamard(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = a[i][j][k] * b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_HADAMARD(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_hadamard_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = a[i][j][k] * b[i][j][k];		\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_hadamard_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = a[i][j][k] * b[i][j][k];		\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_frobenius()
+ *  STRESS_MATRIX_3D_FROBENIUS()
  *	matrix frobenius product
  *	A : B = Sum(AijBij)
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_frobenius(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-	stress_matrix_3d_type_t sum = 0.0;
-
-	(void)r;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				sum += a[i][j][k] * b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-	stress_float_put((float)sum);
+#define STRESS_MATRIX_3D_FROBENIUS(tname, type, atype)				\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_frobenius_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+	atype sum = 0.0;							\
+										\
+	(void)r;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				sum += (atype)a[i][j][k] * (atype)b[i][j][k];	\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+	stress_float_put((float)sum);						\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_frobenius_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+	atype sum = 0.0;							\
+										\
+	(void)r;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				sum += (atype)a[i][j][k] * (atype)b[i][j][k];	\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+	stress_float_put((float)sum);						\
 }
 
 /*
- *  stress_matrix_3d_frobenius()
- *	matrix frobenius product
- *	A : B = Sum(AijBij)
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_frobenius(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-	stress_matrix_3d_type_t sum = 0.0;
-
-	(void)r;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				sum += a[i][j][k] * b[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-	stress_float_put((float)sum);
-}
-
-/*
- *  stress_matrix_3d_copy()
- *	naive matrix copy, r = a
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_copy(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = a[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_copy()
+ *  STRESS_MATRIX_3D_COPY()
  *	naive matrix copy, r = a
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_copy(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	(void)b;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = a[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_mean(void)
- *	arithmetic mean
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_mean(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = (a[i][j][k] + b[i][j][k]) / (stress_matrix_3d_type_t)2.0;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_COPY(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_copy_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = a[i][j][k];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_copy_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	(void)b;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = a[i][j][k];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_mean(void)
+ *  STRESS_MATRIX_3D_MEAN()
  *	arithmetic mean
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_mean(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = (a[i][j][k] + b[i][j][k]) / (stress_matrix_3d_type_t)2.0;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_MEAN(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_mean_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = (a[i][j][k] + b[i][j][k]) / (type)2.0; \
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_mean_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = (a[i][j][k] + b[i][j][k]) / (type)2.0; \
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_zero()
+ *  STRESS_MATRIX_3D_ZERO()
  *	simply zero the result matrix
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_zero(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	(void)a;
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = 0.0;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_zero()
- *	simply zero the result matrix
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_zero(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	(void)a;
-	(void)b;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = 0.0;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_negate()
- *	simply negate the matrix a and put result in r
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_negate(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	(void)a;
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = -a[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_ZERO(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_zero_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = 0.0;				\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_zero_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = 0.0;				\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_negate()
+ *  STRESS_MATRIX_3D_NEGATE()
  *	simply negate the matrix a and put result in r
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_negate(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	(void)a;
-	(void)b;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = -a[i][j][k];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_NEGATE(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_negate_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = -a[i][j][k];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_negate_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = -a[i][j][k];			\
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_identity()
+ *  STRESS_MATRIX_3D_IDENTITY()
  *	set r to the identity matrix
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_identity(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t i;
-
-	(void)a;
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j][k] = ((i == j) && (j == k)) ? 1.0 : 0.0;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
-}
-
-/*
- *  stress_matrix_3d_identity()
- *	set r to the identity matrix
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_identity(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	register size_t k;
-
-	(void)a;
-	(void)b;
-
-	for (k = 0; k < n; k++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t i;
-
-			for (i = 0; i < n; i++) {
-				r[i][j][k] = ((i == j) && (j == k)) ? 1.0 : 0.0;
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_3D_IDENTITY(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_xyz_identity_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t i;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				r[i][j][k] = ((i == j) && (j == k)) ? 1.0 : 0.0; \
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_zyx_identity_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n])						\
+{										\
+	register size_t k;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (k = 0; k < n; k++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t i;					\
+										\
+			for (i = 0; i < n; i++) {				\
+				r[i][j][k] = ((i == j) && (j == k)) ? 1.0 : 0.0; \
+			}							\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_3d_all()
- *	iterate over all cpu stressors
+ *  STRESS_MATRIX_3D_RUN()
+ *	method table, init and run functions for element type type
  */
-static void OPTIMIZE3 stress_matrix_3d_xyz_all(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	static int i = 1;	/* Skip over stress_matrix_3d_all */
-
-	matrix_3d_methods[i++].func[0](n, a, b, r);
-	if (!matrix_3d_methods[i].name)
-		i = 1;
+#define STRESS_MATRIX_3D_RUN(tname, type, data)					\
+typedef void (*stress_matrix_3d_func_##tname)(					\
+	const size_t n,								\
+	type a[RESTRICT n][n][n],						\
+	type b[RESTRICT n][n][n],						\
+	type r[RESTRICT n][n][n]);						\
+										\
+/* ordered as matrix_3d_methods, x by y by z and z by y by x */			\
+static const stress_matrix_3d_func_##tname stress_matrix_3d_funcs_##tname[][2] = { \
+	{ NULL, NULL },								\
+	STRESS_MATRIX_3D_METHODS(STRESS_MATRIX_3D_FUNC_ENTRY, tname)		\
+};										\
+										\
+/*										\
+ *  stress_matrix_3d_init()							\
+ *	fill a and b with data, zero the result r				\
+ */										\
+static void stress_matrix_3d_init_##tname(					\
+	const size_t n,								\
+	void *va,								\
+	void *vb,								\
+	void *vr)								\
+{										\
+	type (*a)[n][n] = (type (*)[n][n])va;					\
+	type (*b)[n][n] = (type (*)[n][n])vb;					\
+	type (*r)[n][n] = (type (*)[n][n])vr;					\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				a[i][j][k] = (type)data;			\
+				b[i][j][k] = (type)data;			\
+				r[i][j][k] = (type)0;				\
+			}							\
+		}								\
+	}									\
+}										\
+										\
+/*										\
+ *  stress_matrix_3d_run()							\
+ *	run method on matrices of this type					\
+ */										\
+static void stress_matrix_3d_run_##tname(					\
+	const size_t method,							\
+	const size_t matrix_3d_zyx,						\
+	const size_t n,								\
+	void *a,								\
+	void *b,								\
+	void *r)								\
+{										\
+	stress_matrix_3d_funcs_##tname[method][matrix_3d_zyx](n,		\
+		(type (*)[n][n])a, (type (*)[n][n])b, (type (*)[n][n])r);	\
 }
 
 /*
- *  stress_matrix_3d_all()
- *	iterate over all cpu stressors
+ *  STRESS_MATRIX_3D_FUNCS()
+ *	generate the matrix methods for element type type, each
+ *	element of a and b is initialised to data, sums are
+ *	accumulated in atype, the integer types use unsigned atypes
+ *	so the frobenius sums wrap rather than overflow
  */
-static void OPTIMIZE3 stress_matrix_3d_zyx_all(
-	const size_t n,
-	stress_matrix_3d_type_t a[RESTRICT n][n][n],
-	stress_matrix_3d_type_t b[RESTRICT n][n][n],
-	stress_matrix_3d_type_t r[RESTRICT n][n][n])
-{
-	static int i = 1;	/* Skip over stress_matrix_3d_all */
-
-	matrix_3d_methods[i++].func[1](n, a, b, r);
-	if (!matrix_3d_methods[i].name)
-		i = 1;
-}
+#define STRESS_MATRIX_3D_FUNCS(tname, type, atype, data)			\
+	STRESS_MATRIX_3D_ADD(tname, type)					\
+	STRESS_MATRIX_3D_SUB(tname, type)					\
+	STRESS_MATRIX_3D_TRANS(tname, type)					\
+	STRESS_MATRIX_3D_MULT(tname, type)					\
+	STRESS_MATRIX_3D_DIV(tname, type)					\
+	STRESS_MATRIX_3D_HADAMARD(tname, type)					\
+	STRESS_MATRIX_3D_FROBENIUS(tname, type, atype)				\
+	STRESS_MATRIX_3D_COPY(tname, type)					\
+	STRESS_MATRIX_3D_MEAN(tname, type)					\
+	STRESS_MATRIX_3D_ZERO(tname, type)					\
+	STRESS_MATRIX_3D_NEGATE(tname, type)					\
+	STRESS_MATRIX_3D_IDENTITY(tname, type)					\
+	STRESS_MATRIX_3D_RUN(tname, type, data)
+
+#if defined(HAVE_FLOAT_F16)
+STRESS_MATRIX_3D_FUNCS(f16, _Float16, _Float16, stress_matrix_3d_data_fp(1.0))
+#endif
+#if defined(HAVE_FLOAT_BF16)
+STRESS_MATRIX_3D_FUNCS(bf16, __bf16, __bf16, stress_matrix_3d_data_fp(65535.0))
+#endif
+STRESS_MATRIX_3D_FUNCS(f32, float, float, stress_matrix_3d_data_fp(65535.0))
+STRESS_MATRIX_3D_FUNCS(f64, double, double, stress_matrix_3d_data_fp(65535.0))
+STRESS_MATRIX_3D_FUNCS(int8, int8_t, uint8_t, stress_matrix_3d_data_int(7))
+STRESS_MATRIX_3D_FUNCS(int32, int32_t, uint32_t, stress_matrix_3d_data_int(127))
 
+#define STRESS_MATRIX_3D_TYPE(tname, type, fp)					\
+	{ # tname, sizeof(type), fp, stress_matrix_3d_init_ ## tname, stress_matrix_3d_run_ ## tname }
 
 /*
- * Table of cpu stress methods, ordered x by y by z and z by y by x
+ *  Element types, types the compiler has no arithmetic
+ *  support for have no init or run functions
  */
-static const stress_matrix_3d_method_info_t matrix_3d_methods[] = {
-	{ "all",		{ stress_matrix_3d_xyz_all,	stress_matrix_3d_zyx_all } },/* Special "all" test */
-
-	{ "add",		{ stress_matrix_3d_xyz_add,	stress_matrix_3d_zyx_add } },
-	{ "copy",		{ stress_matrix_3d_xyz_copy,	stress_matrix_3d_zyx_copy } },
-	{ "div",		{ stress_matrix_3d_xyz_div,	stress_matrix_3d_zyx_div } },
-	{ "frobenius",		{ stress_matrix_3d_xyz_frobenius,stress_matrix_3d_zyx_frobenius } },
-	{ "hadamard",		{ stress_matrix_3d_xyz_hadamard,	stress_matrix_3d_zyx_hadamard } },
-	{ "identity",		{ stress_matrix_3d_xyz_identity,	stress_matrix_3d_zyx_identity } },
-	{ "mean",		{ stress_matrix_3d_xyz_mean,	stress_matrix_3d_zyx_mean } },
-	{ "mult",		{ stress_matrix_3d_xyz_mult,	stress_matrix_3d_zyx_mult } },
-	{ "negate",		{ stress_matrix_3d_xyz_negate,	stress_matrix_3d_zyx_negate } },
-	{ "sub",		{ stress_matrix_3d_xyz_sub,	stress_matrix_3d_zyx_sub } },
-	{ "trans",		{ stress_matrix_3d_xyz_trans,	stress_matrix_3d_zyx_trans } },
-	{ "zero",		{ stress_matrix_3d_xyz_zero,	stress_matrix_3d_zyx_zero } },
-	{ NULL,			{ NULL, NULL } }
+static const stress_matrix_3d_type_info_t matrix_3d_types[] = {
+#if defined(HAVE_FLOAT_F16)
+	STRESS_MATRIX_3D_TYPE(f16, _Float16, true),
+#else
+	{ "f16",	2, true, NULL, NULL },
+#endif
+#if defined(HAVE_FLOAT_BF16)
+	STRESS_MATRIX_3D_TYPE(bf16, __bf16, true),
+#else
+	{ "bf16",	2, true, NULL, NULL },
+#endif
+	STRESS_MATRIX_3D_TYPE(f32, float, true),
+	STRESS_MATRIX_3D_TYPE(f64, double, true),
+	STRESS_MATRIX_3D_TYPE(int8, int8_t, false),
+	STRESS_MATRIX_3D_TYPE(int32, int32_t, false),
 };
 
 static const stress_matrix_3d_method_info_t *stress_get_matrix_3d_method(
@@ -878,84 +949,100 @@ static inline size_t round_up(size_t page_size, size_t n)
 }
 
 /*
- *  stress_matrix_data()
- *`	generate some random data scaled by v
+ *  stress_set_matrix_3d_type()
+ *	set the 3D matrix element type
  */
-static inline stress_matrix_3d_type_t stress_matrix_data(const stress_matrix_3d_type_t v)
+static int stress_set_matrix_3d_type(const char *name)
 {
-	const uint64_t r = stress_mwc64();
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(matrix_3d_types); i++) {
+		if (!strcmp(matrix_3d_types[i].name, name))
+			return stress_set_setting("matrix-3d-type", TYPE_ID_SIZE_T, &i);
+	}
 
-	return v * (stress_matrix_3d_type_t)r;
+	(void)fprintf(stderr, "matrix-3d-type must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(matrix_3d_types); i++)
+		(void)fprintf(stderr, " %s", matrix_3d_types[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
 }
 
 static inline int stress_matrix_3d_exercise(
 	const stress_args_t *args,
-	const stress_matrix_3d_func func,
+	const stress_matrix_3d_type_info_t *matrix_3d_type,
+	const size_t method,
+	const size_t matrix_3d_zyx,
 	const size_t n)
 {
 	int ret = EXIT_NO_RESOURCE;
-	typedef stress_matrix_3d_type_t (*matrix_3d_ptr_t)[n][n];
-	size_t matrix_3d_size = round_up(args->page_size, (sizeof(stress_matrix_3d_type_t) * n * n * n));
-
-	matrix_3d_ptr_t a, b = NULL, r = NULL;
-	register size_t i;
-	const stress_matrix_3d_type_t v = 65535 / (stress_matrix_3d_type_t)((uint64_t)~0);
+	size_t matrix_3d_size = round_up(args->page_size, (matrix_3d_type->size * n * n * n));
+	void *a, *b = NULL, *r = NULL;
+	size_t all_index = 1;
+	double flops = 0.0, t_start, duration;
 	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
 #if defined(MAP_POPULATE)
 	flags |= MAP_POPULATE;
 #endif
 
-	a = (matrix_3d_ptr_t)mmap(NULL, matrix_3d_size,
+	a = mmap(NULL, matrix_3d_size,
 		PROT_READ | PROT_WRITE, flags, -1, 0);
 	if (a == MAP_FAILED) {
 		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
 		goto tidy_ret;
 	}
-	b = (matrix_3d_ptr_t)mmap(NULL, matrix_3d_size,
+	b = mmap(NULL, matrix_3d_size,
 		PROT_READ | PROT_WRITE, flags, -1, 0);
 	if (b == MAP_FAILED) {
 		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
 		goto tidy_a;
 	}
-	r = (matrix_3d_ptr_t)mmap(NULL, matrix_3d_size,
+	r = mmap(NULL, matrix_3d_size,
 		PROT_READ | PROT_WRITE, flags, -1, 0);
 	if (r == MAP_FAILED) {
 		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
 		goto tidy_b;
 	}
 
-	/*
-	 *  Initialise matrices
-	 */
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				a[i][j][k] = stress_matrix_data(v);
-				b[i][j][k] = stress_matrix_data(v);
-				r[i][j][k] = 0.0;
-			}
-		}
-	}
+	matrix_3d_type->init(n, a, b, r);
 
 	/*
 	 * Normal use case, 100% load, simple spinning on CPU
 	 */
+	t_start = stress_time_now();
 	do {
-		(void)func(n, a, b, r);
+		size_t idx = method;
+
+		if (!idx) {
+			idx = all_index++;
+			if (!matrix_3d_methods[all_index].name)
+				all_index = 1;
+		}
+		matrix_3d_type->run(idx, matrix_3d_zyx, n, a, b, r);
+		flops += (double)matrix_3d_methods[idx].flops *
+			(double)n * (double)n * (double)n;
 		inc_counter(args);
 	} while (keep_stressing(args));
+	duration = stress_time_now() - t_start;
+
+	if ((duration > 0.0) && (flops > 0.0)) {
+		char desc[32];
+
+		/* integer types count integer operations */
+		(void)snprintf(desc, sizeof(desc), "%s %s", matrix_3d_type->name,
+			matrix_3d_type->fp ? "GFLOP/s" : "GOP/s");
+		stress_misc_stats_set(args->misc_stats, 0, desc,
+			(flops / duration) / 1000000000.0);
+	}
 
 	ret = EXIT_SUCCESS;
 
-	(void)munmap((void *)r, matrix_3d_size);
+	(void)munmap(r, matrix_3d_size);
 tidy_b:
-	(void)munmap((void *)b, matrix_3d_size);
+	(void)munmap(b, matrix_3d_size);
 tidy_a:
-	(void)munmap((void *)a, matrix_3d_size);
+	(void)munmap(a, matrix_3d_size);
 tidy_ret:
 	return ret;
 }
@@ -968,13 +1055,22 @@ static int stress_matrix(const stress_args_t *args)
 {
 	char *matrix_3d_method_name = NULL;
 	const stress_matrix_3d_method_info_t *matrix_3d_method;
-	stress_matrix_3d_func func;
+	const stress_matrix_3d_type_info_t *matrix_3d_type;
 	size_t matrix_3d_size = 128;
 	size_t matrix_3d_yx = 0;
+	size_t matrix_3d_type_idx = 2;	/* f32 */
 	int rc;
 
 	(void)stress_get_setting("matrix-3d-method", &matrix_3d_method_name);
 	(void)stress_get_setting("matrix-3d-zyx", &matrix_3d_yx);
+	(void)stress_get_setting("matrix-3d-type", &matrix_3d_type_idx);
+	matrix_3d_type = &matrix_3d_types[matrix_3d_type_idx];
+	if (!matrix_3d_type->init) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: matrix type %s is not supported by the compiler, "
+				"skipping stressor\n", args->name, matrix_3d_type->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
 
 	matrix_3d_method = stress_get_matrix_3d_method(matrix_3d_method_name);
 	if (!matrix_3d_method) {
@@ -983,10 +1079,11 @@ static int stress_matrix(const stress_args_t *args)
 		return EXIT_FAILURE;
 	}
 
-	func = matrix_3d_method->func[matrix_3d_yx];
 	if (args->instance == 0)
-		pr_dbg("%s: using method '%s' (%s)\n", args->name, matrix_3d_method->name,
-			matrix_3d_yx ? "z by y by x" : "x by y by z");
+		pr_dbg("%s: using method '%s' (%s) on %s elements\n", args->name,
+			matrix_3d_method->name,
+			matrix_3d_yx ? "z by y by x" : "x by y by z",
+			matrix_3d_type->name);
 
 	if (!stress_get_setting("matrix-3d-size", &matrix_3d_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -997,7 +1094,9 @@ static int stress_matrix(const stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	rc = stress_matrix_3d_exercise(args, func, matrix_3d_size);
+	rc = stress_matrix_3d_exercise(args, matrix_3d_type,
+		(size_t)(matrix_3d_method - matrix_3d_methods), matrix_3d_yx,
+		matrix_3d_size);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -1012,6 +1111,7 @@ static void stress_matrix_3d_set_default(void)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_matrix_3d_method,	stress_set_matrix_3d_method },
 	{ OPT_matrix_3d_size,	stress_set_matrix_3d_size },
+	{ OPT_matrix_3d_type,	stress_set_matrix_3d_type },
 	{ OPT_matrix_3d_zyx,	stress_set_matrix_3d_zyx },
 	{ 0,			NULL }
 };
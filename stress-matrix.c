@@ -24,35 +24,98 @@
 #define MIN_MATRIX_SIZE		(16)
 #define MAX_MATRIX_SIZE		(8192)
 #define DEFAULT_MATRIX_SIZE	(256)
+#define MAX_MATRIX_THREADS	(256)
+
+#define MATRIX_TILE		(64)	/* prod-tiled tile size */
+#define MATRIX_KC		(256)	/* rows of b per register block pass */
+#define MATRIX_MR		(4)	/* register block rows */
+#define MATRIX_NR		(32)	/* prod-regblock register block columns */
 
 static const stress_help_t help[] = {
 	{ NULL,	"matrix N",		"start N workers exercising matrix operations" },
 	{ NULL,	"matrix-ops N",		"stop after N maxtrix bogo operations" },
 	{ NULL,	"matrix-method M",	"specify matrix stress method M, default is all" },
 	{ NULL,	"matrix-size N",	"specify the size of the N x N matrix" },
+	{ NULL,	"matrix-type T",	"specify the element type, f16, bf16, f32, f64, int8 or int32" },
 	{ NULL,	"matrix-yx",		"matrix operation is y by x instead of x by y" },
 	{ NULL,	NULL,			NULL }
 };
 
 #if defined(HAVE_VLA_ARG)
 
-typedef float	stress_matrix_type_t;
+#define MATRIX_VEC_BYTES	(64)	/* prod-fma vector size */
+#define MATRIX_VL(type)		(MATRIX_VEC_BYTES / sizeof(type))
 
 /*
- *  the matrix stress test has different classes of maxtrix stressor
+ *  Matrix methods, name, x by y function, y by x function,
+ *  flop count multiplier and power of n of the flop count,
+ *  the blocked product methods pick their own loop order
+ *  so they use the same function for both
  */
-typedef void (*stress_matrix_func)(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n]);
+#define STRESS_MATRIX_METHODS(MACRO, tname)					\
+	MACRO("add",		xy_add,		yx_add,		1, 2, tname)	\
+	MACRO("copy",		xy_copy,	yx_copy,	0, 2, tname)	\
+	MACRO("div",		xy_div,		yx_div,		1, 2, tname)	\
+	MACRO("frobenius",	xy_frobenius,	yx_frobenius,	2, 2, tname)	\
+	MACRO("hadamard",	xy_hadamard,	yx_hadamard,	1, 2, tname)	\
+	MACRO("identity",	xy_identity,	yx_identity,	0, 2, tname)	\
+	MACRO("mean",		xy_mean,	yx_mean,	2, 2, tname)	\
+	MACRO("mult",		xy_mult,	yx_mult,	1, 2, tname)	\
+	MACRO("negate",		xy_negate,	yx_negate,	1, 2, tname)	\
+	MACRO("prod",		xy_prod,	yx_prod,	2, 3, tname)	\
+	MACRO("prod-fma",	xy_prod_fma,	xy_prod_fma,	2, 3, tname)	\
+	MACRO("prod-regblock",	xy_prod_regblock, xy_prod_regblock, 2, 3, tname) \
+	MACRO("prod-threads",	xy_prod_threads, xy_prod_threads, 2, 3, tname)	\
+	MACRO("prod-tiled",	xy_prod_tiled,	xy_prod_tiled,	2, 3, tname)	\
+	MACRO("sub",		xy_sub,		yx_sub,		1, 2, tname)	\
+	MACRO("square",		xy_square,	yx_square,	2, 3, tname)	\
+	MACRO("trans",		xy_trans,	yx_trans,	0, 2, tname)	\
+	MACRO("zero",		xy_zero,	yx_zero,	0, 2, tname)
+
+#define STRESS_MATRIX_FUNC_ENTRY(name, xy, yx, flops, order, tname)		\
+	{ stress_matrix_ ## xy ## _ ## tname, stress_matrix_ ## yx ## _ ## tname },
+
+#define STRESS_MATRIX_INFO_ENTRY(name, xy, yx, flops, order, tname)		\
+	{ name, flops, order },
 
 typedef struct {
-	const char			*name;		/* human readable form of stressor */
-	const stress_matrix_func	func[2];	/* method functions, x by y, y by x */
+	const char		*name;		/* human readable form of stressor */
+	const uint8_t		flops;		/* flop count is flops x n^order */
+	const uint8_t		order;		/* power of n of the flop count */
 } stress_matrix_method_info_t;
 
-static const stress_matrix_method_info_t matrix_methods[];
+typedef struct {
+	const char		*name;		/* element type name */
+	const size_t		size;		/* element size in bytes */
+	const bool		fp;		/* floating point type */
+	void (*init)(const size_t n, void *a, void *b, void *r);
+	void (*run)(const size_t method, const size_t matrix_yx,
+		const size_t n, void *a, void *b, void *r);
+} stress_matrix_type_info_t;
+
+/* compute rows i_start..i_end of a matrix product */
+typedef void (*stress_matrix_rows_func)(const size_t n, void *a, void *b,
+	void *r, const size_t i_start, const size_t i_end);
+
+#if defined(HAVE_LIB_PTHREAD)
+/* prod-threads band of rows */
+typedef struct {
+	size_t n;
+	void *a, *b, *r;
+	size_t i_start, i_end;
+	stress_matrix_rows_func rows;
+	pthread_t pthread;
+	int ret;
+} stress_matrix_thread_t;
+#endif
+
+static const stress_matrix_method_info_t matrix_methods[] = {
+	{ "all",	0, 0 },		/* Special "all" test */
+	STRESS_MATRIX_METHODS(STRESS_MATRIX_INFO_ENTRY, none)
+	{ NULL,		0, 0 }
+};
+
+static uint32_t matrix_threads = 1;
 
 static int stress_set_matrix_size(const char *opt)
 {
@@ -74,776 +137,1174 @@ static int stress_set_matrix_yx(const char *opt)
 }
 
 /*
- *  stress_matrix_xy_prod()
- *	matrix product
+ *  stress_matrix_data_fp()
+ *	generate some random floating point data in the range 0..scale
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_prod(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
+static inline double stress_matrix_data_fp(const double scale)
 {
-	size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j] += a[i][k] * b[k][j];
-			}
-			if (!keep_stressing_flag())
-				return;
-		}
-	}
+	return (double)stress_mwc64() * (scale / (double)((uint64_t)~0));
 }
 
 /*
- *  stress_matrix_yx_prod()
- *	matrix product
+ *  stress_matrix_data_int()
+ *	generate some random non-zero integer data in the range 1..max
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_prod(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
+static inline int32_t stress_matrix_data_int(const uint32_t max)
 {
-	size_t j;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j] += a[i][k] * b[k][j];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+	return (int32_t)(1 + (stress_mwc32() % max));
 }
 
+#if defined(HAVE_LIB_PTHREAD)
 /*
- *  stress_matrix_xy_add()
- *	matrix addition
+ *  stress_matrix_prod_thread()
+ *	compute a band of rows of the threaded matrix product
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_add(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
+static void *stress_matrix_prod_thread(void *arg)
 {
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
+	static void *nowt = NULL;
+	const stress_matrix_thread_t *t = (const stress_matrix_thread_t *)arg;
 
-		for (j = 0; j < n; j++) {
-			r[i][j] = a[i][j] + b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+	t->rows(t->n, t->a, t->b, t->r, t->i_start, t->i_end);
+	return &nowt;
 }
 
 /*
- *  stress_matrix_yx_add()
- *	matrix addition
+ *  stress_matrix_prod_threads()
+ *	matrix product with the rows split into bands across
+ *	matrix_threads threads, the calling thread computes the
+ *	first band, bands that fail to get a thread are computed
+ *	by the calling thread too
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_add(
+static void stress_matrix_prod_threads(
 	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
+	void *a,
+	void *b,
+	void *r,
+	stress_matrix_rows_func rows_func)
 {
-	register size_t j;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			r[i][j] = a[i][j] + b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
+	stress_matrix_thread_t threads[MAX_MATRIX_THREADS];
+	const size_t rows = (n + MATRIX_MR - 1) / MATRIX_MR;
+	size_t i, n_threads = STRESS_MINIMUM((size_t)matrix_threads, rows);
+	size_t band;
+
+	if (n_threads < 2) {
+		rows_func(n, a, b, r, 0, n);
+		return;
 	}
-}
-
-/*
- *  stress_matrix_xy_sub()
- *	matrix subtraction
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_sub(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			r[i][j] = a[i][j] - b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
+	/* bands are a multiple of MATRIX_MR rows */
+	band = ((rows + n_threads - 1) / n_threads) * MATRIX_MR;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_matrix_thread_t *t = &threads[i];
+
+		t->n = n;
+		t->a = a;
+		t->b = b;
+		t->r = r;
+		t->i_start = STRESS_MINIMUM(i * band, n);
+		t->i_end = STRESS_MINIMUM(t->i_start + band, n);
+		t->rows = rows_func;
+		t->ret = -1;
+		if (i > 0)
+			t->ret = pthread_create(&t->pthread, NULL, stress_matrix_prod_thread, (void *)t);
+	}
+	rows_func(n, a, b, r, threads[0].i_start, threads[0].i_end);
+	for (i = 1; i < n_threads; i++) {
+		stress_matrix_thread_t *t = &threads[i];
+
+		if (t->ret == 0)
+			(void)pthread_join(t->pthread, NULL);
+		else
+			rows_func(n, a, b, r, t->i_start, t->i_end);
 	}
 }
-
-/*
- *  stress_matrix_xy_sub()
- *	matrix subtraction
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_sub(
+#else
+static void stress_matrix_prod_threads(
 	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
+	void *a,
+	void *b,
+	void *r,
+	stress_matrix_rows_func rows_func)
 {
-	register size_t j;
-
-	for (j = 0; j < n; j++) {
-
-		register size_t i;
-		for (i = 0; i < n; i++) {
-			r[i][j] = a[i][j] - b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+	rows_func(n, a, b, r, 0, n);
 }
+#endif
 
 /*
- *  stress_matrix_trans()
- *	matrix transpose
+ *  STRESS_MATRIX_VEC()
+ *	prod-fma vector types of atype lanes and scalar broadcast
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_trans(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],	/* Ignored */
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			r[i][j] = a[j][i];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_VEC(tname, itype, atype)					\
+typedef atype stress_matrix_vec_##tname##_t					\
+	__attribute__ ((vector_size(MATRIX_VEC_BYTES)));			\
+typedef itype stress_matrix_ivec_##tname##_t					\
+	__attribute__ ((vector_size(MATRIX_VEC_BYTES)));			\
+										\
+/*										\
+ *  stress_matrix_splat()							\
+ *	broadcast a scalar to all vector lanes via a same sized			\
+ *	integer since half precision scalars are evaluated as float		\
+ *	and cannot be implicitly converted to a vector				\
+ */										\
+static inline void stress_matrix_splat_##tname(					\
+	stress_matrix_vec_##tname##_t *vec, const atype v)			\
+{										\
+	itype bits;								\
+										\
+	(void)memcpy(&bits, &v, sizeof(bits));					\
+	*vec = (stress_matrix_vec_##tname##_t)					\
+		((stress_matrix_ivec_##tname##_t){ 0 } + bits);			\
 }
 
 /*
- *  stress_matrix_trans()
- *	matrix transpose
+ *  STRESS_MATRIX_PROD()
+ *	matrix product
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_trans(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],	/* Ignored */
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			r[i][j] = a[j][i];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_PROD(tname, type, atype)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_prod_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	size_t i;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+			atype sum = (atype)r[i][j];				\
+										\
+			for (k = 0; k < n; k++) {				\
+				sum += (atype)a[i][k] * (atype)b[k][j];		\
+			}							\
+			r[i][j] = (type)sum;					\
+			if (!keep_stressing_flag())				\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_prod_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	size_t j;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			register size_t k;					\
+			atype sum = (atype)r[i][j];				\
+										\
+			for (k = 0; k < n; k++) {				\
+				sum += (atype)a[i][k] * (atype)b[k][j];		\
+			}							\
+			r[i][j] = (type)sum;					\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_mult()
- *	matrix scalar multiply
+ *  STRESS_MATRIX_ADD()
+ *	matrix addition
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_mult(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-	stress_matrix_type_t v = b[0][0];
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			r[i][j] = v * a[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_ADD(tname, type)						\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_add_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			r[i][j] = a[i][j] + b[i][j];				\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_add_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			r[i][j] = a[i][j] + b[i][j];				\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_mult()
- *	matrix scalar multiply
+ *  STRESS_MATRIX_SUB()
+ *	matrix subtraction
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_mult(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-	stress_matrix_type_t v = b[0][0];
-
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			r[i][j] = v * a[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_SUB(tname, type)						\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_sub_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			r[i][j] = a[i][j] - b[i][j];				\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_sub_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	for (j = 0; j < n; j++) {						\
+										\
+		register size_t i;						\
+		for (i = 0; i < n; i++) {					\
+			r[i][j] = a[i][j] - b[i][j];				\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_div()
- *	matrix scalar divide
+ *  STRESS_MATRIX_TRANS()
+ *	matrix transpose
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_div(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-	stress_matrix_type_t v = b[0][0];
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			r[i][j] = a[i][j] / v;
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_TRANS(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_trans_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],	/* Ignored */					\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			r[i][j] = a[j][i];					\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_trans_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],	/* Ignored */					\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			r[i][j] = a[j][i];					\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_div()
- *	matrix scalar divide
+ *  STRESS_MATRIX_MULT()
+ *	matrix scalar multiply
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_div(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-	stress_matrix_type_t v = b[0][0];
-
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			r[i][j] = a[i][j] / v;
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_MULT(tname, type)						\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_mult_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+	type v = b[0][0];							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			r[i][j] = v * a[i][j];					\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_mult_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+	type v = b[0][0];							\
+										\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			r[i][j] = v * a[i][j];					\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_hadamard()
- *	matrix hadamard product
- *	(A o B)ij = AijBij
+ *  STRESS_MATRIX_DIV()
+ *	matrix scalar divide
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_hadamard(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			r[i][j] = a[i][j] * b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_DIV(tname, type)						\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_div_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+	type v = b[0][0];							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			r[i][j] = a[i][j] / v;					\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_div_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+	type v = b[0][0];							\
+										\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			r[i][j] = a[i][j] / v;					\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_hadamard()
+ *  STRESS_MATRIX_HADAMARD()
  *	matrix hadamard product
  *	(A o B)ij = AijBij
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_hadamard(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			r[i][j] = a[i][j] * b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_HADAMARD(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_hadamard_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			r[i][j] = a[i][j] * b[i][j];				\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_hadamard_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			r[i][j] = a[i][j] * b[i][j];				\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_frobenius()
+ *  STRESS_MATRIX_FROBENIUS()
  *	matrix frobenius product
  *	A : B = Sum(AijBij)
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_frobenius(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-	stress_matrix_type_t sum = 0.0;
-
-	(void)r;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			sum += a[i][j] * b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
-	stress_float_put((float)sum);
-}
-
-/*
- *  stress_matrix_frobenius()
- *	matrix frobenius product
- *	A : B = Sum(AijBij)
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_frobenius(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-	stress_matrix_type_t sum = 0.0;
-
-	(void)r;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			sum += a[i][j] * b[i][j];
-		}
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
-	stress_float_put((float)sum);
-}
-
-/*
- *  stress_matrix_copy()
- *	naive matrix copy, r = a
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_copy(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++)
-			r[i][j] = a[i][j];
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_FROBENIUS(tname, type, atype)				\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_frobenius_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+	atype sum = 0.0;							\
+										\
+	(void)r;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			sum += (atype)a[i][j] * (atype)b[i][j];			\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+	stress_float_put((float)sum);						\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_frobenius_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+	atype sum = 0.0;							\
+										\
+	(void)r;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			sum += (atype)a[i][j] * (atype)b[i][j];			\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+	stress_float_put((float)sum);						\
 }
 
 /*
- *  stress_matrix_copy()
+ *  STRESS_MATRIX_COPY()
  *	naive matrix copy, r = a
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_copy(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++)
-			r[i][j] = a[i][j];
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_COPY(tname, type)						\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_copy_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++)						\
+			r[i][j] = a[i][j];					\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_copy_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++)						\
+			r[i][j] = a[i][j];					\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_mean(void)
+ *  STRESS_MATRIX_MEAN()
  *	arithmetic mean
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_mean(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++)
-			r[i][j] = (a[i][j] + b[i][j]) / (stress_matrix_type_t)2.0;
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_MEAN(tname, type)						\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_mean_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++)						\
+			r[i][j] = (a[i][j] + b[i][j]) / (type)2.0;		\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_mean_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++)						\
+			r[i][j] = (a[i][j] + b[i][j]) / (type)2.0;		\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_mean(void)
- *	arithmetic mean
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_mean(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++)
-			r[i][j] = (a[i][j] + b[i][j]) / (stress_matrix_type_t)2.0;
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
-}
-
-/*
- *  stress_matrix_zero()
+ *  STRESS_MATRIX_ZERO()
  *	simply zero the result matrix
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_zero(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	(void)a;
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++)
-			r[i][j] = 0.0;
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_ZERO(tname, type)						\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_zero_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++)						\
+			r[i][j] = 0.0;						\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_zero_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++)						\
+			r[i][j] = 0.0;						\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_zero()
- *	simply zero the result matrix
- */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_zero(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-
-	(void)a;
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++)
-			r[i][j] = 0.0;
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
-}
-
-/*
- *  stress_matrix_negate()
+ *  STRESS_MATRIX_NEGATE()
  *	simply negate the matrix a and put result in r
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_negate(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	(void)a;
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++)
-			r[i][j] = -a[i][j];
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_NEGATE(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_negate_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++)						\
+			r[i][j] = -a[i][j];					\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_negate_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++)						\
+			r[i][j] = -a[i][j];					\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_negate()
- *	simply negate the matrix a and put result in r
+ *  STRESS_MATRIX_IDENTITY()
+ *	set r to the identity matrix
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_negate(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-
-	(void)a;
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++)
-			r[i][j] = -a[i][j];
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_IDENTITY(tname, type)					\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_identity_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t i;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++)						\
+			r[i][j] = (i == j) ? 1.0 : 0.0;				\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_identity_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	register size_t j;							\
+										\
+	(void)a;								\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++)						\
+			r[i][j] = (i == j) ? 1.0 : 0.0;				\
+										\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_identity()
- *	set r to the identity matrix
+ *  STRESS_MATRIX_SQUARE()
+ *	matrix product, r = a x a
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_identity(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t i;
-
-	(void)a;
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++)
-			r[i][j] = (i == j) ? 1.0 : 0.0;
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_SQUARE(tname, type, atype)				\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_square_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	size_t i;								\
+										\
+	(void)b;								\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			register size_t k;					\
+			atype sum = (atype)r[i][j];				\
+										\
+			for (k = 0; k < n; k++) {				\
+				sum += (atype)a[i][k] * (atype)a[k][j];		\
+			}							\
+			r[i][j] = (type)sum;					\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_square_##tname(		\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	size_t j;								\
+										\
+	(void)b;								\
+										\
+	for (j = 0; j < n; j++) {						\
+		register size_t i;						\
+										\
+		for (i = 0; i < n; i++) {					\
+			register size_t k;					\
+			atype sum = (atype)r[i][j];				\
+										\
+			for (k = 0; k < n; k++) {				\
+				sum += (atype)a[i][k] * (atype)a[k][j];		\
+			}							\
+			r[i][j] = (type)sum;					\
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+	}									\
 }
 
 /*
- *  stress_matrix_identity()
- *	set r to the identity matrix
+ *  STRESS_MATRIX_PROD_TILED()
+ *	matrix product, cache blocked into MATRIX_TILE x MATRIX_TILE
+ *	tiles so the working set stays in cache for large matrices
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_identity(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	register size_t j;
-
-	(void)a;
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++)
-			r[i][j] = (i == j) ? 1.0 : 0.0;
-
-		if (UNLIKELY(!keep_stressing_flag()))
-			return;
-	}
+#define STRESS_MATRIX_PROD_TILED(tname, type, atype)				\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_prod_tiled_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	size_t ii;								\
+										\
+	for (ii = 0; ii < n; ii += MATRIX_TILE) {				\
+		const size_t i_end = STRESS_MINIMUM(ii + MATRIX_TILE, n);	\
+		size_t kk;							\
+										\
+		for (kk = 0; kk < n; kk += MATRIX_TILE) {			\
+			const size_t k_end = STRESS_MINIMUM(kk + MATRIX_TILE, n); \
+			size_t jj;						\
+										\
+			for (jj = 0; jj < n; jj += MATRIX_TILE) {		\
+				const size_t j_end = STRESS_MINIMUM(jj + MATRIX_TILE, n); \
+				register size_t i;				\
+										\
+				for (i = ii; i < i_end; i++) {			\
+					register size_t k;			\
+										\
+					for (k = kk; k < k_end; k++) {		\
+						register size_t j;		\
+						const atype aik = (atype)a[i][k]; \
+										\
+						for (j = jj; j < j_end; j++)	\
+							r[i][j] = (type)((atype)r[i][j] + aik * (atype)b[k][j]); \
+					}					\
+				}						\
+			}							\
+		}								\
+		if (UNLIKELY(!keep_stressing_flag()))				\
+			return;							\
+	}									\
 }
 
 /*
- *  stress_matrix_xy_square()
- *	matrix product, r = a x a
+ *  STRESS_MATRIX_PROD_REGBLOCK()
+ *	prod-regblock register blocked matrix product
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_square(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	size_t i;
-
-	(void)b;
-
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j] += a[i][k] * a[k][j];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_PROD_REGBLOCK(tname, type, atype)				\
+/*										\
+ *  stress_matrix_prod_edge()							\
+ *	scalar matrix product of rows i_start..i_end and columns		\
+ *	j_start..n over k_start..k_end for the register block edges		\
+ */										\
+static inline void stress_matrix_prod_edge_##tname(				\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n],							\
+	const size_t i_start,							\
+	const size_t i_end,							\
+	const size_t j_start,							\
+	const size_t k_start,							\
+	const size_t k_end)							\
+{										\
+	register size_t i;							\
+										\
+	for (i = i_start; i < i_end; i++) {					\
+		register size_t k;						\
+										\
+		for (k = k_start; k < k_end; k++) {				\
+			register size_t j;					\
+			const atype aik = (atype)a[i][k];			\
+										\
+			for (j = j_start; j < n; j++)				\
+				r[i][j] = (type)((atype)r[i][j] + aik * (atype)b[k][j]); \
+		}								\
+	}									\
+}										\
+										\
+/*										\
+ *  stress_matrix_xy_prod_regblock()						\
+ *	matrix product, MATRIX_MR x MATRIX_NR blocks of the result are		\
+ *	accumulated in registers over MATRIX_KC rows of b at a time		\
+ */										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_prod_regblock_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	size_t kk;								\
+										\
+	for (kk = 0; kk < n; kk += MATRIX_KC) {					\
+		const size_t k_end = STRESS_MINIMUM(kk + MATRIX_KC, n);		\
+		size_t i;							\
+										\
+		for (i = 0; i + MATRIX_MR <= n; i += MATRIX_MR) {		\
+			size_t j;						\
+										\
+			for (j = 0; j + MATRIX_NR <= n; j += MATRIX_NR) {	\
+				atype c[MATRIX_MR][MATRIX_NR];			\
+				register size_t k, ir, jr;			\
+										\
+				for (ir = 0; ir < MATRIX_MR; ir++)		\
+					for (jr = 0; jr < MATRIX_NR; jr++)	\
+						c[ir][jr] = (atype)r[i + ir][j + jr]; \
+										\
+				for (k = kk; k < k_end; k++) {			\
+					for (ir = 0; ir < MATRIX_MR; ir++) {	\
+						const atype aik = (atype)a[i + ir][k]; \
+										\
+						for (jr = 0; jr < MATRIX_NR; jr++) \
+							c[ir][jr] += aik * (atype)b[k][j + jr]; \
+					}					\
+				}						\
+										\
+				for (ir = 0; ir < MATRIX_MR; ir++)		\
+					for (jr = 0; jr < MATRIX_NR; jr++)	\
+						r[i + ir][j + jr] = (type)c[ir][jr]; \
+			}							\
+			stress_matrix_prod_edge_##tname(n, a, b, r, i, i + MATRIX_MR, j, kk, k_end); \
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+		stress_matrix_prod_edge_##tname(n, a, b, r, i, n, 0, kk, k_end); \
+	}									\
 }
 
 /*
- *  stress_matrix_yx_square()
- *	matrix product, r = a x a
+ *  STRESS_MATRIX_PROD_FMA()
+ *	prod-fma and prod-threads vector multiply-add matrix products
  */
-static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_square(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	size_t j;
-
-	(void)b;
-
-	for (j = 0; j < n; j++) {
-		register size_t i;
-
-		for (i = 0; i < n; i++) {
-			register size_t k;
-
-			for (k = 0; k < n; k++) {
-				r[i][j] += a[i][k] * a[k][j];
-			}
-			if (UNLIKELY(!keep_stressing_flag()))
-				return;
-		}
-	}
+#define STRESS_MATRIX_PROD_FMA(tname, type, atype)				\
+/*										\
+ *  stress_matrix_prod_fma_rows()						\
+ *	matrix product of rows i_start..i_end, MATRIX_MR x 2 vectors of		\
+ *	the result are accumulated with explicit vector multiply-adds,		\
+ *	these are contracted to FMA instructions by the compiler for the	\
+ *	AVX2 + FMA and AVX-512 target clones and for NEON			\
+ */										\
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_prod_fma_rows_##tname(	\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n],							\
+	const size_t i_start,							\
+	const size_t i_end)							\
+{										\
+	size_t kk;								\
+										\
+	for (kk = 0; kk < n; kk += MATRIX_KC) {					\
+		const size_t k_end = STRESS_MINIMUM(kk + MATRIX_KC, n);		\
+		size_t i;							\
+										\
+		for (i = i_start; i + MATRIX_MR <= i_end; i += MATRIX_MR) {	\
+			size_t j;						\
+										\
+			for (j = 0; j + (2 * MATRIX_VL(type)) <= n; j += 2 * MATRIX_VL(type)) { \
+				stress_matrix_vec_##tname##_t c00, c01, c10, c11, c20, c21, c30, c31; \
+				register size_t k;				\
+										\
+				(void)memcpy(&c00, &r[i + 0][j], sizeof(c00));	\
+				(void)memcpy(&c01, &r[i + 0][j + MATRIX_VL(type)], sizeof(c01)); \
+				(void)memcpy(&c10, &r[i + 1][j], sizeof(c10));	\
+				(void)memcpy(&c11, &r[i + 1][j + MATRIX_VL(type)], sizeof(c11)); \
+				(void)memcpy(&c20, &r[i + 2][j], sizeof(c20));	\
+				(void)memcpy(&c21, &r[i + 2][j + MATRIX_VL(type)], sizeof(c21)); \
+				(void)memcpy(&c30, &r[i + 3][j], sizeof(c30));	\
+				(void)memcpy(&c31, &r[i + 3][j + MATRIX_VL(type)], sizeof(c31)); \
+										\
+				for (k = kk; k < k_end; k++) {			\
+					stress_matrix_vec_##tname##_t b0, b1;	\
+					stress_matrix_vec_##tname##_t a0, a1, a2, a3; \
+										\
+					stress_matrix_splat_##tname(&a0, (atype)a[i + 0][k]); \
+					stress_matrix_splat_##tname(&a1, (atype)a[i + 1][k]); \
+					stress_matrix_splat_##tname(&a2, (atype)a[i + 2][k]); \
+					stress_matrix_splat_##tname(&a3, (atype)a[i + 3][k]); \
+					(void)memcpy(&b0, &b[k][j], sizeof(b0)); \
+					(void)memcpy(&b1, &b[k][j + MATRIX_VL(type)], sizeof(b1)); \
+					c00 += a0 * b0;				\
+					c01 += a0 * b1;				\
+					c10 += a1 * b0;				\
+					c11 += a1 * b1;				\
+					c20 += a2 * b0;				\
+					c21 += a2 * b1;				\
+					c30 += a3 * b0;				\
+					c31 += a3 * b1;				\
+				}						\
+										\
+				(void)memcpy(&r[i + 0][j], &c00, sizeof(c00));	\
+				(void)memcpy(&r[i + 0][j + MATRIX_VL(type)], &c01, sizeof(c01)); \
+				(void)memcpy(&r[i + 1][j], &c10, sizeof(c10));	\
+				(void)memcpy(&r[i + 1][j + MATRIX_VL(type)], &c11, sizeof(c11)); \
+				(void)memcpy(&r[i + 2][j], &c20, sizeof(c20));	\
+				(void)memcpy(&r[i + 2][j + MATRIX_VL(type)], &c21, sizeof(c21)); \
+				(void)memcpy(&r[i + 3][j], &c30, sizeof(c30));	\
+				(void)memcpy(&r[i + 3][j + MATRIX_VL(type)], &c31, sizeof(c31)); \
+			}							\
+			stress_matrix_prod_edge_##tname(n, a, b, r, i, i + MATRIX_MR, j, kk, k_end); \
+			if (UNLIKELY(!keep_stressing_flag()))			\
+				return;						\
+		}								\
+		stress_matrix_prod_edge_##tname(n, a, b, r, i, i_end, 0, kk, k_end); \
+	}									\
+}										\
+										\
+/*										\
+ *  stress_matrix_xy_prod_fma()							\
+ *	matrix product using explicit vector multiply-adds			\
+ */										\
+static void OPTIMIZE3 stress_matrix_xy_prod_fma_##tname(			\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	stress_matrix_prod_fma_rows_##tname(n, a, b, r, 0, n);			\
+}										\
+										\
+/*										\
+ *  stress_matrix_prod_fma_band()						\
+ *	prod-threads band of rows						\
+ */										\
+static void stress_matrix_prod_fma_band_##tname(				\
+	const size_t n,								\
+	void *a,								\
+	void *b,								\
+	void *r,								\
+	const size_t i_start,							\
+	const size_t i_end)							\
+{										\
+	stress_matrix_prod_fma_rows_##tname(n, (type (*)[n])a,			\
+		(type (*)[n])b, (type (*)[n])r, i_start, i_end);		\
+}										\
+										\
+/*										\
+ *  stress_matrix_xy_prod_threads()						\
+ *	matrix product with the rows split across threads			\
+ */										\
+static void OPTIMIZE3 stress_matrix_xy_prod_threads_##tname(			\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n])							\
+{										\
+	stress_matrix_prod_threads(n, (void *)a, (void *)b, (void *)r,		\
+		stress_matrix_prod_fma_band_##tname);				\
 }
 
-
 /*
- *  stress_matrix_all()
- *	iterate over all cpu stressors
+ *  STRESS_MATRIX_RUN()
+ *	method table, init and run functions for element type type
  */
-static void OPTIMIZE3 stress_matrix_xy_all(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	static int i = 1;	/* Skip over stress_matrix_all */
-
-	matrix_methods[i++].func[0](n, a, b, r);
-	if (!matrix_methods[i].name)
-		i = 1;
+#define STRESS_MATRIX_RUN(tname, type, data)					\
+typedef void (*stress_matrix_func_##tname)(					\
+	const size_t n,								\
+	type a[RESTRICT n][n],							\
+	type b[RESTRICT n][n],							\
+	type r[RESTRICT n][n]);							\
+										\
+/* ordered as matrix_methods, x by y and y by x */				\
+static const stress_matrix_func_##tname stress_matrix_funcs_##tname[][2] = {	\
+	{ NULL, NULL },								\
+	STRESS_MATRIX_METHODS(STRESS_MATRIX_FUNC_ENTRY, tname)			\
+};										\
+										\
+/*										\
+ *  stress_matrix_init()							\
+ *	fill a and b with data, zero the result r				\
+ */										\
+static void stress_matrix_init_##tname(						\
+	const size_t n,								\
+	void *va,								\
+	void *vb,								\
+	void *vr)								\
+{										\
+	type (*a)[n] = (type (*)[n])va;						\
+	type (*b)[n] = (type (*)[n])vb;						\
+	type (*r)[n] = (type (*)[n])vr;						\
+	register size_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		register size_t j;						\
+										\
+		for (j = 0; j < n; j++) {					\
+			a[i][j] = (type)data;					\
+			b[i][j] = (type)data;					\
+			r[i][j] = (type)0;					\
+		}								\
+	}									\
+}										\
+										\
+/*										\
+ *  stress_matrix_run()								\
+ *	run method on the matrices						\
+ */										\
+static void stress_matrix_run_##tname(						\
+	const size_t method,							\
+	const size_t matrix_yx,							\
+	const size_t n,								\
+	void *a,								\
+	void *b,								\
+	void *r)								\
+{										\
+	stress_matrix_funcs_##tname[method][matrix_yx](n,			\
+		(type (*)[n])a, (type (*)[n])b, (type (*)[n])r);		\
 }
 
 /*
- *  stress_matrix_all()
- *	iterate over all cpu stressors
+ *  STRESS_MATRIX_FUNCS()
+ *	generate the matrix methods for element type type, each
+ *	element of a and b is initialised to data, products are
+ *	accumulated in atype, the integer types use unsigned atypes
+ *	so the accumulating methods wrap rather than overflow
  */
-static void OPTIMIZE3 stress_matrix_yx_all(
-	const size_t n,
-	stress_matrix_type_t a[RESTRICT n][n],
-	stress_matrix_type_t b[RESTRICT n][n],
-	stress_matrix_type_t r[RESTRICT n][n])
-{
-	static int i = 1;	/* Skip over stress_matrix_all */
-
-	matrix_methods[i++].func[1](n, a, b, r);
-	if (!matrix_methods[i].name)
-		i = 1;
-}
+#define STRESS_MATRIX_FUNCS(tname, type, itype, atype, data)			\
+	STRESS_MATRIX_VEC(tname, itype, atype)					\
+	STRESS_MATRIX_PROD(tname, type, atype)					\
+	STRESS_MATRIX_ADD(tname, type)						\
+	STRESS_MATRIX_SUB(tname, type)						\
+	STRESS_MATRIX_TRANS(tname, type)					\
+	STRESS_MATRIX_MULT(tname, type)						\
+	STRESS_MATRIX_DIV(tname, type)						\
+	STRESS_MATRIX_HADAMARD(tname, type)					\
+	STRESS_MATRIX_FROBENIUS(tname, type, atype)				\
+	STRESS_MATRIX_COPY(tname, type)						\
+	STRESS_MATRIX_MEAN(tname, type)						\
+	STRESS_MATRIX_ZERO(tname, type)						\
+	STRESS_MATRIX_NEGATE(tname, type)					\
+	STRESS_MATRIX_IDENTITY(tname, type)					\
+	STRESS_MATRIX_SQUARE(tname, type, atype)				\
+	STRESS_MATRIX_PROD_TILED(tname, type, atype)				\
+	STRESS_MATRIX_PROD_REGBLOCK(tname, type, atype)				\
+	STRESS_MATRIX_PROD_FMA(tname, type, atype)				\
+	STRESS_MATRIX_RUN(tname, type, data)
+
+#if defined(HAVE_FLOAT_F16)
+STRESS_MATRIX_FUNCS(f16, _Float16, int16_t, _Float16, stress_matrix_data_fp(1.0))
+#endif
+#if defined(HAVE_FLOAT_BF16)
+STRESS_MATRIX_FUNCS(bf16, __bf16, int16_t, __bf16, stress_matrix_data_fp(65535.0))
+#endif
+STRESS_MATRIX_FUNCS(f32, float, int32_t, float, stress_matrix_data_fp(65535.0))
+STRESS_MATRIX_FUNCS(f64, double, int64_t, double, stress_matrix_data_fp(65535.0))
+STRESS_MATRIX_FUNCS(int8, int8_t, int8_t, uint8_t, stress_matrix_data_int(7))
+STRESS_MATRIX_FUNCS(int32, int32_t, int32_t, uint32_t, stress_matrix_data_int(127))
 
+#define STRESS_MATRIX_TYPE(tname, type, fp)					\
+	{ # tname, sizeof(type), fp, stress_matrix_init_ ## tname, stress_matrix_run_ ## tname }
 
 /*
- * Table of cpu stress methods, ordered x by y and y by x
+ *  Element types, types the compiler has no arithmetic
+ *  support for have no init or run functions
  */
-static const stress_matrix_method_info_t matrix_methods[] = {
-	{ "all",		{ stress_matrix_xy_all,		stress_matrix_yx_all } },/* Special "all" test */
-
-	{ "add",		{ stress_matrix_xy_add,		stress_matrix_yx_add } },
-	{ "copy",		{ stress_matrix_xy_copy,	stress_matrix_yx_copy } },
-	{ "div",		{ stress_matrix_xy_div,		stress_matrix_yx_div } },
-	{ "frobenius",		{ stress_matrix_xy_frobenius,	stress_matrix_yx_frobenius } },
-	{ "hadamard",		{ stress_matrix_xy_hadamard,	stress_matrix_yx_hadamard } },
-	{ "identity",		{ stress_matrix_xy_identity,	stress_matrix_yx_identity } },
-	{ "mean",		{ stress_matrix_xy_mean,	stress_matrix_yx_mean } },
-	{ "mult",		{ stress_matrix_xy_mult,	stress_matrix_yx_mult } },
-	{ "negate",		{ stress_matrix_xy_negate,	stress_matrix_yx_negate } },
-	{ "prod",		{ stress_matrix_xy_prod,	stress_matrix_yx_prod } },
-	{ "sub",		{ stress_matrix_xy_sub,		stress_matrix_yx_sub } },
-	{ "square",		{ stress_matrix_xy_square,	stress_matrix_yx_square } },
-	{ "trans",		{ stress_matrix_xy_trans,	stress_matrix_yx_trans } },
-	{ "zero",		{ stress_matrix_xy_zero,	stress_matrix_yx_zero } },
-	{ NULL,			{ NULL, NULL } }
+static const stress_matrix_type_info_t matrix_types[] = {
+#if defined(HAVE_FLOAT_F16)
+	STRESS_MATRIX_TYPE(f16, _Float16, true),
+#else
+	{ "f16",	2, true, NULL, NULL },
+#endif
+#if defined(HAVE_FLOAT_BF16)
+	STRESS_MATRIX_TYPE(bf16, __bf16, true),
+#else
+	{ "bf16",	2, true, NULL, NULL },
+#endif
+	STRESS_MATRIX_TYPE(f32, float, true),
+	STRESS_MATRIX_TYPE(f64, double, true),
+	STRESS_MATRIX_TYPE(int8, int8_t, false),
+	STRESS_MATRIX_TYPE(int32, int32_t, false),
 };
 
 static const stress_matrix_method_info_t *stress_get_matrix_method(
@@ -896,72 +1357,94 @@ static inline size_t round_up(size_t page_size, size_t n)
 }
 
 /*
- *  stress_matrix_data()
- *`	generate some random data scaled by v
+ *  stress_set_matrix_type()
+ *	set the matrix element type
  */
-static inline stress_matrix_type_t stress_matrix_data(const stress_matrix_type_t v)
+static int stress_set_matrix_type(const char *name)
 {
-	const uint64_t r = stress_mwc64();
+	size_t i;
 
-	return v * (stress_matrix_type_t)r;
+	for (i = 0; i < SIZEOF_ARRAY(matrix_types); i++) {
+		if (!strcmp(matrix_types[i].name, name))
+			return stress_set_setting("matrix-type", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "matrix-type must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(matrix_types); i++)
+		(void)fprintf(stderr, " %s", matrix_types[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
 }
 
 static inline int stress_matrix_exercise(
 	const stress_args_t *args,
-	const stress_matrix_func func,
+	const stress_matrix_type_info_t *matrix_type,
+	const size_t method,
+	const size_t matrix_yx,
 	const size_t n)
 {
 	int ret = EXIT_NO_RESOURCE;
-	typedef stress_matrix_type_t (*matrix_ptr_t)[n];
-	size_t matrix_size = round_up(args->page_size, (sizeof(stress_matrix_type_t) * n * n));
+	size_t matrix_size = round_up(args->page_size, (matrix_type->size * n * n));
 
-	matrix_ptr_t a, b = NULL, r = NULL;
-	register size_t i;
-	const stress_matrix_type_t v = 65535 / (stress_matrix_type_t)((uint64_t)~0);
+	void *a, *b = NULL, *r = NULL;
 	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	size_t all_index = 1;	/* Skip over "all" */
+	double flops = 0.0, t_start, duration;
 #if defined(MAP_POPULATE)
 	flags |= MAP_POPULATE;
 #endif
 
-	a = (matrix_ptr_t)mmap(NULL, matrix_size,
+	a = mmap(NULL, matrix_size,
 		PROT_READ | PROT_WRITE, flags, -1, 0);
 	if (a == MAP_FAILED) {
 		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
 		goto tidy_ret;
 	}
-	b = (matrix_ptr_t)mmap(NULL, matrix_size,
+	b = mmap(NULL, matrix_size,
 		PROT_READ | PROT_WRITE, flags, -1, 0);
 	if (b == MAP_FAILED) {
 		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
 		goto tidy_a;
 	}
-	r = (matrix_ptr_t)mmap(NULL, matrix_size,
+	r = mmap(NULL, matrix_size,
 		PROT_READ | PROT_WRITE, flags, -1, 0);
 	if (r == MAP_FAILED) {
 		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
 		goto tidy_b;
 	}
 
-	/*
-	 *  Initialise matrices
-	 */
-	for (i = 0; i < n; i++) {
-		register size_t j;
-
-		for (j = 0; j < n; j++) {
-			a[i][j] = stress_matrix_data(v);
-			b[i][j] = stress_matrix_data(v);
-			r[i][j] = 0.0;
-		}
-	}
+	matrix_type->init(n, a, b, r);
 
 	/*
-	 * Normal use case, 100% load, simple spinning on CPU
+	 * Normal use case, 100% load, simple spinning on CPU,
+	 * "all" iterates over all the other methods
 	 */
+	t_start = stress_time_now();
 	do {
-		(void)func(n, a, b, r);
+		size_t idx = method;
+
+		if (!idx) {
+			idx = all_index++;
+			if (!matrix_methods[all_index].name)
+				all_index = 1;
+		}
+		matrix_type->run(idx, matrix_yx, n, a, b, r);
+		flops += (double)matrix_methods[idx].flops *
+			pow((double)n, (double)matrix_methods[idx].order);
 		inc_counter(args);
 	} while (keep_stressing(args));
+	duration = stress_time_now() - t_start;
+
+	if ((duration > 0.0) && (flops > 0.0)) {
+		char desc[32];
+
+		/* integer types count integer operations */
+		(void)snprintf(desc, sizeof(desc), "%s %s", matrix_type->name,
+			matrix_type->fp ? "GFLOP/s" : "GOP/s");
+		stress_misc_stats_set(args->misc_stats, 0, desc,
+			(flops / duration) / 1000000000.0);
+	}
 
 	ret = EXIT_SUCCESS;
 
@@ -982,13 +1465,23 @@ static int stress_matrix(const stress_args_t *args)
 {
 	char *matrix_method_name = NULL;
 	const stress_matrix_method_info_t *matrix_method;
-	stress_matrix_func func;
+	const int32_t cpus = stress_get_processors_online();
+	const stress_matrix_type_info_t *matrix_type;
 	size_t matrix_size = 128;
 	size_t matrix_yx = 0;
+	size_t matrix_type_idx = 2;	/* f32 */
 	int rc;
 
 	(void)stress_get_setting("matrix-method", &matrix_method_name);
 	(void)stress_get_setting("matrix-yx", &matrix_yx);
+	(void)stress_get_setting("matrix-type", &matrix_type_idx);
+	matrix_type = &matrix_types[matrix_type_idx];
+	if (!matrix_type->init) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: matrix type %s is not supported by the compiler, "
+				"skipping stressor\n", args->name, matrix_type->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
 
 	matrix_method = stress_get_matrix_method(matrix_method_name);
 	if (!matrix_method) {
@@ -997,10 +1490,10 @@ static int stress_matrix(const stress_args_t *args)
 		return EXIT_FAILURE;
 	}
 
-	func = matrix_method->func[matrix_yx];
 	if (args->instance == 0)
-		pr_dbg("%s: using method '%s' (%s)\n", args->name, matrix_method->name,
-			matrix_yx ? "y by x" : "x by y");
+		pr_dbg("%s: using method '%s' (%s) on %s elements\n", args->name,
+			matrix_method->name, matrix_yx ? "y by x" : "x by y",
+			matrix_type->name);
 
 	if (!stress_get_setting("matrix-size", &matrix_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -1009,9 +1502,16 @@ static int stress_matrix(const stress_args_t *args)
 			matrix_size = MIN_MATRIX_SIZE;
 	}
 
+	/* prod-threads shares the online CPUs between the instances */
+	if (cpus > (int32_t)args->num_instances)
+		matrix_threads = (uint32_t)cpus / args->num_instances;
+	if (matrix_threads > MAX_MATRIX_THREADS)
+		matrix_threads = MAX_MATRIX_THREADS;
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	rc = stress_matrix_exercise(args, func, matrix_size);
+	rc = stress_matrix_exercise(args, matrix_type,
+		(size_t)(matrix_method - matrix_methods), matrix_yx, matrix_size);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -1026,6 +1526,7 @@ static void stress_matrix_set_default(void)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_matrix_method,	stress_set_matrix_method },
 	{ OPT_matrix_size,	stress_set_matrix_size },
+	{ OPT_matrix_type,	stress_set_matrix_type },
 	{ OPT_matrix_yx,	stress_set_matrix_yx },
 	{ 0,			NULL },
 };
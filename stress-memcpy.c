@@ -18,19 +18,30 @@
  *
  */
 #include "stress-ng.h"
+#include "core-cache.h"
+#include "core-cpu.h"
+#include "core-nt-store.h"
 #include "core-target-clones.h"
+#include "core-verify.h"
 
 #define ALIGN_SIZE	(64)
 
+#define MEMCPY_SWEEP_MIN	(8)		/* smallest sweep copy size */
+#define MEMCPY_SWEEP_SIZES	(24)		/* 8 bytes to 64MB in powers of 2 */
+#define MEMCPY_SWEEP_MAX	((size_t)MEMCPY_SWEEP_MIN << (MEMCPY_SWEEP_SIZES - 1))
+#define MEMCPY_SWEEP_BYTES	(8 * MB)	/* bytes copied per sweep size */
+#define MEMCPY_PREFETCH_AHEAD	(512)		/* prefetch distance in bytes */
+
 static const stress_help_t help[] = {
 	{ NULL,	"memcpy N",	   "start N workers performing memory copies" },
 	{ NULL,	"memcpy-ops N",	   "stop after N memcpy bogo operations" },
-	{ NULL,	"memcpy-method M", "set memcpy method (M = all, libc, builtin, naive..)" },
+	{ NULL,	"memcpy-method M", "set memcpy method (M = all, libc, builtin, naive, rep_movsb, avx2..)" },
+	{ NULL,	"memcpy-sweep",	   "report copy GB/s over sizes 8B to 64MB and misalignments" },
 	{ NULL,	NULL,		   NULL }
 };
 
 static const char *s_args_name = "";
-static char *s_method_name = "";
+static const char *s_method_name = "";
 
 typedef struct {
 	uint8_t buffer[STR_SHARED_SIZE + ALIGN_SIZE];
@@ -41,6 +52,7 @@ typedef void (*stress_memcpy_func)(stress_buffer_t *b, uint8_t *b_str, uint8_t *
 typedef struct {
 	const char *name;
 	const stress_memcpy_func func;
+	bool (*supported)(void);	/* NULL = always supported */
 } stress_memcpy_method_info_t;
 
 typedef void * (*memcpy_func_t)(void *dest, const void *src, size_t n);
@@ -56,6 +68,8 @@ static OPTIMIZE3 void *memcpy_check_func(memcpy_func_t func, void *dest, const v
 {
 	void *ptr = func(dest, src, n);
 
+	if (!stress_verify_sample())
+		return ptr;
 	if (memcmp(dest, src, n)) {
 		pr_fail("%s: %s: memcpy content is different than expected\n", s_args_name, s_method_name);
 	}
@@ -74,6 +88,8 @@ static OPTIMIZE3 void *memmove_check_func(memcpy_func_t func, void *dest, const
 {
 	void *ptr = func(dest, src, n);
 
+	if (!stress_verify_sample())
+		return ptr;
 	if (memcmp(dest, src, n)) {
 		pr_fail("%s: %s: memmove content is different than expected\n", s_args_name, s_method_name);
 	}
@@ -132,6 +148,130 @@ TEST_NAIVE_MEMMOVE(test_naive_memmove_o1, NOINLINE OPTIMIZE1)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o2, NOINLINE OPTIMIZE2)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o3, NOINLINE OPTIMIZE3)
 
+#if defined(STRESS_ARCH_X86)
+/*
+ *  test_rep_movsb_memcpy()
+ *	copy with rep movsb, this is the fastest copy for most sizes
+ *	on CPUs with enhanced rep movsb (ERMS) and fast short rep
+ *	movsb (FSRM), it is very slow on older CPUs
+ */
+static NOINLINE void *test_rep_movsb_memcpy(void *dest, const void *src, size_t n)
+{
+	void *cdest = dest;
+
+	__asm__ __volatile__("rep movsb"
+		: "+D" (cdest), "+S" (src), "+c" (n)
+		:
+		: "memory");
+	return dest;
+}
+#define HAVE_MEMCPY_REP_MOVSB
+#endif
+
+#if defined(HAVE_VECMATH) &&	\
+    defined(STRESS_ARCH_X86)
+/*
+ *  Explicit width vector copies, 4 vectors per loop so the loads
+ *  are issued before the stores. The vector types are byte aligned
+ *  so the misaligned sweep copies are unaligned loads and stores.
+ */
+#define TEST_VECTOR_MEMCPY(name, width, target)				\
+typedef uint8_t name ## _vec_t						\
+	__attribute__ ((vector_size(width), aligned(1), __may_alias__));	\
+									\
+static NOINLINE OPTIMIZE3 target void *name(void *dest, const void *src, size_t n)	\
+{									\
+	register name ## _vec_t *vdest = (name ## _vec_t *)dest;	\
+	register const name ## _vec_t *vsrc = (const name ## _vec_t *)src;	\
+	register char *cdest;						\
+	register const char *csrc;					\
+									\
+	for (; n >= 4 * width; n -= 4 * width, vdest += 4, vsrc += 4) {	\
+		const name ## _vec_t v0 = vsrc[0];			\
+		const name ## _vec_t v1 = vsrc[1];			\
+		const name ## _vec_t v2 = vsrc[2];			\
+		const name ## _vec_t v3 = vsrc[3];			\
+									\
+		vdest[0] = v0;						\
+		vdest[1] = v1;						\
+		vdest[2] = v2;						\
+		vdest[3] = v3;						\
+	}								\
+	for (; n >= width; n -= width)					\
+		*(vdest++) = *(vsrc++);					\
+	cdest = (char *)vdest;						\
+	csrc = (const char *)vsrc;					\
+	while (n--)							\
+		*(cdest++) = *(csrc++);					\
+	return dest;							\
+}
+
+#if defined(HAVE_TARGET_CLONES_AVX2)
+TEST_VECTOR_MEMCPY(test_avx2_memcpy, 32, __attribute__ ((target("avx2"))))
+#define HAVE_MEMCPY_AVX2
+#endif
+
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+TEST_VECTOR_MEMCPY(test_avx512_memcpy, 64, __attribute__ ((target("avx512f"))))
+#define HAVE_MEMCPY_AVX512
+#endif
+#endif
+
+#if defined(HAVE_NT_STORE128)
+/*
+ *  test_nt_memcpy()
+ *	copy with non-temporal streaming stores that bypass the
+ *	cache, this avoids the read for ownership of the destination
+ *	and the eviction of the working set on very large copies
+ */
+static NOINLINE OPTIMIZE3 void *test_nt_memcpy(void *dest, const void *src, size_t n)
+{
+	register char *cdest = (char *)dest;
+	register const char *csrc = (const char *)src;
+
+	/* non-temporal stores must be 16 byte aligned */
+	for (; n && ((uintptr_t)cdest & 15); n--)
+		*(cdest++) = *(csrc++);
+	for (; n >= 64; n -= 64, cdest += 64, csrc += 64) {
+		__uint128_t v0, v1, v2, v3;
+
+		(void)memcpy(&v0, csrc, sizeof(v0));
+		(void)memcpy(&v1, csrc + 16, sizeof(v1));
+		(void)memcpy(&v2, csrc + 32, sizeof(v2));
+		(void)memcpy(&v3, csrc + 48, sizeof(v3));
+		stress_nt_store128((__uint128_t *)cdest, v0);
+		stress_nt_store128((__uint128_t *)(cdest + 16), v1);
+		stress_nt_store128((__uint128_t *)(cdest + 32), v2);
+		stress_nt_store128((__uint128_t *)(cdest + 48), v3);
+	}
+	/* order the streaming stores before any later loads */
+	shim_mfence();
+	while (n--)
+		*(cdest++) = *(csrc++);
+	return dest;
+}
+#define HAVE_MEMCPY_NT
+#endif
+
+/*
+ *  test_prefetch_memcpy()
+ *	copy 64 byte blocks with a software prefetch of the source
+ *	MEMCPY_PREFETCH_AHEAD bytes ahead of the copy
+ */
+static NOINLINE OPTIMIZE3 void *test_prefetch_memcpy(void *dest, const void *src, size_t n)
+{
+	register char *cdest = (char *)dest;
+	register const char *csrc = (const char *)src;
+
+	for (; n >= 64; n -= 64, cdest += 64, csrc += 64) {
+		shim_builtin_prefetch(csrc + MEMCPY_PREFETCH_AHEAD, 0, 0);
+		(void)memcpy(cdest, csrc, 64);
+	}
+	while (n--)
+		*(cdest++) = *(csrc++);
+	return dest;
+}
+
 static NOINLINE void stress_memcpy_libc(
 	stress_buffer_t *b,
 	uint8_t *b_str,
@@ -202,7 +342,7 @@ static NOINLINE void stress_memcpy_builtin(
 #endif
 }
 
-#define STRESS_MEMCPY_NAIVE(method, name, cpy, move)					\
+#define STRESS_MEMCPY_METHOD(method, name, cpy, move)					\
 static NOINLINE void name(								\
 	stress_buffer_t *b,								\
 	uint8_t *b_str,									\
@@ -221,11 +361,24 @@ static NOINLINE void name(								\
 	(void)memmove_check(move, aligned_buf, aligned_buf + 1, STR_SHARED_SIZE - 1);	\
 }
 
-STRESS_MEMCPY_NAIVE("naive", stress_memcpy_naive, test_naive_memcpy, test_naive_memmove)
-STRESS_MEMCPY_NAIVE("naive_o0", stress_memcpy_naive_o0, test_naive_memcpy_o0, test_naive_memmove_o0)
-STRESS_MEMCPY_NAIVE("naive_o1", stress_memcpy_naive_o1, test_naive_memcpy_o1, test_naive_memmove_o1)
-STRESS_MEMCPY_NAIVE("naive_o2", stress_memcpy_naive_o2, test_naive_memcpy_o2, test_naive_memmove_o2)
-STRESS_MEMCPY_NAIVE("naive_o3", stress_memcpy_naive_o3, test_naive_memcpy_o3, test_naive_memmove_o3)
+STRESS_MEMCPY_METHOD("naive", stress_memcpy_naive, test_naive_memcpy, test_naive_memmove)
+STRESS_MEMCPY_METHOD("naive_o0", stress_memcpy_naive_o0, test_naive_memcpy_o0, test_naive_memmove_o0)
+STRESS_MEMCPY_METHOD("naive_o1", stress_memcpy_naive_o1, test_naive_memcpy_o1, test_naive_memmove_o1)
+STRESS_MEMCPY_METHOD("naive_o2", stress_memcpy_naive_o2, test_naive_memcpy_o2, test_naive_memmove_o2)
+STRESS_MEMCPY_METHOD("naive_o3", stress_memcpy_naive_o3, test_naive_memcpy_o3, test_naive_memmove_o3)
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+STRESS_MEMCPY_METHOD("rep_movsb", stress_memcpy_rep_movsb, test_rep_movsb_memcpy, memmove)
+#endif
+#if defined(HAVE_MEMCPY_AVX2)
+STRESS_MEMCPY_METHOD("avx2", stress_memcpy_avx2, test_avx2_memcpy, memmove)
+#endif
+#if defined(HAVE_MEMCPY_AVX512)
+STRESS_MEMCPY_METHOD("avx512", stress_memcpy_avx512, test_avx512_memcpy, memmove)
+#endif
+#if defined(HAVE_MEMCPY_NT)
+STRESS_MEMCPY_METHOD("nt", stress_memcpy_nt, test_nt_memcpy, memmove)
+#endif
+STRESS_MEMCPY_METHOD("prefetch", stress_memcpy_prefetch, test_prefetch_memcpy, memmove)
 
 static NOINLINE void stress_memcpy_all(
 	stress_buffer_t *b,
@@ -260,17 +413,84 @@ static NOINLINE void stress_memcpy_all(
 }
 
 static const stress_memcpy_method_info_t stress_memcpy_methods[] = {
-	{ "all",	stress_memcpy_all },
-	{ "libc",	stress_memcpy_libc },
-	{ "builtin",	stress_memcpy_builtin },
-	{ "naive",      stress_memcpy_naive },
-	{ "naive_o0",	stress_memcpy_naive_o0 },
-	{ "naive_o1",	stress_memcpy_naive_o1 },
-	{ "naive_o2",	stress_memcpy_naive_o2 },
-	{ "naive_o3",	stress_memcpy_naive_o3 },
-	{ NULL,         NULL }
+	{ "all",	stress_memcpy_all,		NULL },
+	{ "libc",	stress_memcpy_libc,		NULL },
+	{ "builtin",	stress_memcpy_builtin,		NULL },
+	{ "naive",      stress_memcpy_naive,		NULL },
+	{ "naive_o0",	stress_memcpy_naive_o0,		NULL },
+	{ "naive_o1",	stress_memcpy_naive_o1,		NULL },
+	{ "naive_o2",	stress_memcpy_naive_o2,		NULL },
+	{ "naive_o3",	stress_memcpy_naive_o3,		NULL },
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+	{ "rep_movsb",	stress_memcpy_rep_movsb,	stress_cpu_is_x86 },
+#endif
+#if defined(HAVE_MEMCPY_AVX2)
+	{ "avx2",	stress_memcpy_avx2,		stress_cpu_x86_has_avx2 },
+#endif
+#if defined(HAVE_MEMCPY_AVX512)
+	{ "avx512",	stress_memcpy_avx512,		stress_cpu_x86_has_avx512f },
+#endif
+#if defined(HAVE_MEMCPY_NT)
+	{ "nt",		stress_memcpy_nt,		stress_cpu_x86_has_sse2 },
+#endif
+	{ "prefetch",	stress_memcpy_prefetch,		NULL },
+	{ NULL,         NULL,				NULL }
+};
+
+/* copy functions of each method for --memcpy-sweep, same order as above */
+typedef struct {
+	const char *name;
+	const memcpy_func_t func;
+	bool (*supported)(void);	/* NULL = always supported */
+} stress_memcpy_copy_info_t;
+
+static const stress_memcpy_copy_info_t stress_memcpy_copies[] = {
+	{ "libc",	memcpy,				NULL },
+#if defined(HAVE_BUILTIN_MEMCPY) &&	\
+    defined(HAVE_BUILTIN_MEMMOVE)
+	{ "builtin",	stress_builtin_memcpy_wrapper,	NULL },
+#endif
+	{ "naive",	test_naive_memcpy,		NULL },
+	{ "naive_o0",	test_naive_memcpy_o0,		NULL },
+	{ "naive_o1",	test_naive_memcpy_o1,		NULL },
+	{ "naive_o2",	test_naive_memcpy_o2,		NULL },
+	{ "naive_o3",	test_naive_memcpy_o3,		NULL },
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+	{ "rep_movsb",	test_rep_movsb_memcpy,		stress_cpu_is_x86 },
+#endif
+#if defined(HAVE_MEMCPY_AVX2)
+	{ "avx2",	test_avx2_memcpy,		stress_cpu_x86_has_avx2 },
+#endif
+#if defined(HAVE_MEMCPY_AVX512)
+	{ "avx512",	test_avx512_memcpy,		stress_cpu_x86_has_avx512f },
+#endif
+#if defined(HAVE_MEMCPY_NT)
+	{ "nt",		test_nt_memcpy,			stress_cpu_x86_has_sse2 },
+#endif
+	{ "prefetch",	test_prefetch_memcpy,		NULL },
+};
+
+#define MEMCPY_COPIES	SIZEOF_ARRAY(stress_memcpy_copies)
+
+/* source and destination misalignments of the sweep */
+static const struct {
+	const size_t src;
+	const size_t dst;
+} stress_memcpy_sweep_align[] = {
+	{ 0,	0 },
+	{ 1,	0 },
+	{ 0,	1 },
+	{ 7,	13 },
 };
 
+#define MEMCPY_SWEEP_ALIGNS	SIZEOF_ARRAY(stress_memcpy_sweep_align)
+
+/* bytes copied and copy time of each copy, misalignment and size */
+typedef struct {
+	double bytes[MEMCPY_COPIES][MEMCPY_SWEEP_ALIGNS][MEMCPY_SWEEP_SIZES];
+	double secs[MEMCPY_COPIES][MEMCPY_SWEEP_ALIGNS][MEMCPY_SWEEP_SIZES];
+} stress_memcpy_sweep_t;
+
 /*
  *  stress_set_memcpy_method()
  *      set default memcpy stress method
@@ -295,11 +515,229 @@ static int stress_set_memcpy_method(const char *name)
 	return -1;
 }
 
+static int stress_set_memcpy_sweep(const char *opt)
+{
+	return stress_set_setting_true("memcpy-sweep", opt);
+}
+
 static void stress_memcpy_set_default(void)
 {
 	stress_set_memcpy_method("all");
 }
 
+/*
+ *  stress_memcpy_sweep()
+ *	time the copy at each size and misalignment, at least
+ *	MEMCPY_SWEEP_BYTES are copied at each size
+ */
+static void stress_memcpy_sweep(
+	const stress_args_t *args,
+	const size_t c,
+	stress_memcpy_sweep_t *sweep,
+	uint8_t *src,
+	uint8_t *dst)
+{
+	const memcpy_func_t func = stress_memcpy_copies[c].func;
+	size_t a, s;
+
+	s_method_name = stress_memcpy_copies[c].name;
+
+	for (a = 0; a < MEMCPY_SWEEP_ALIGNS; a++) {
+		uint8_t *s_ptr = src + stress_memcpy_sweep_align[a].src;
+		uint8_t *d_ptr = dst + stress_memcpy_sweep_align[a].dst;
+
+		for (s = 0; s < MEMCPY_SWEEP_SIZES; s++) {
+			const size_t size = (size_t)MEMCPY_SWEEP_MIN << s;
+			const size_t reps = (size >= MEMCPY_SWEEP_BYTES) ? 1 : MEMCPY_SWEEP_BYTES / size;
+			double t;
+			size_t i;
+
+			t = stress_time_now();
+			for (i = 0; i < reps; i++)
+				(void)func(d_ptr, s_ptr, size);
+			sweep->secs[c][a][s] += stress_time_now() - t;
+			sweep->bytes[c][a][s] += (double)size * (double)reps;
+
+			if (stress_verify_sample() && memcmp(d_ptr, s_ptr, size))
+				pr_fail("%s: %s: %zu byte copy, src+%zu dst+%zu, content is different than expected\n",
+					args->name, s_method_name, size,
+					stress_memcpy_sweep_align[a].src,
+					stress_memcpy_sweep_align[a].dst);
+			if (!keep_stressing_flag())
+				return;
+		}
+	}
+}
+
+/*
+ *  stress_memcpy_sweep_report()
+ *	report the GB/s of each copy for each size and misalignment
+ *	and the fastest copy, the crossover points are where the
+ *	fastest copy changes
+ */
+static void stress_memcpy_sweep_report(
+	const stress_args_t *args,
+	const stress_memcpy_sweep_t *sweep,
+	const bool *used)
+{
+	size_t a, s, c;
+	int idx = 0;
+
+	if (args->instance == 0)
+		pr_inf("%s: rep movsb ERMS: %s, FSRM: %s\n", args->name,
+			stress_cpu_x86_has_erms() ? "yes" : "no",
+			stress_cpu_x86_has_fsrm() ? "yes" : "no");
+
+	for (a = 0; a < MEMCPY_SWEEP_ALIGNS; a++) {
+		char line[256], label[32];
+		size_t len;
+
+		if (args->instance != 0)
+			break;
+
+		(void)snprintf(label, sizeof(label), "GB/s src+%zu dst+%zu",
+			stress_memcpy_sweep_align[a].src, stress_memcpy_sweep_align[a].dst);
+		len = (size_t)snprintf(line, sizeof(line), "%-18s", label);
+		for (c = 0; c < MEMCPY_COPIES; c++) {
+			if (used[c])
+				len += (size_t)snprintf(line + len, sizeof(line) - len,
+					" %9s", stress_memcpy_copies[c].name);
+		}
+		(void)snprintf(line + len, sizeof(line) - len, " %s", "fastest");
+		pr_inf("%s: %s\n", args->name, line);
+
+		for (s = 0; s < MEMCPY_SWEEP_SIZES; s++) {
+			const size_t size = (size_t)MEMCPY_SWEEP_MIN << s;
+			const char *fastest = "-";
+			double best = 0.0;
+
+			if (size >= MB)
+				len = (size_t)snprintf(line, sizeof(line), "%17zuM", (size_t)(size / MB));
+			else if (size >= KB)
+				len = (size_t)snprintf(line, sizeof(line), "%17zuK", (size_t)(size / KB));
+			else
+				len = (size_t)snprintf(line, sizeof(line), "%17zuB", size);
+			for (c = 0; c < MEMCPY_COPIES; c++) {
+				const double secs = sweep->secs[c][a][s];
+				const double rate = (secs > 0.0) ?
+					sweep->bytes[c][a][s] / (secs * 1.0E9) : 0.0;
+
+				if (!used[c])
+					continue;
+				len += (size_t)snprintf(line + len, sizeof(line) - len, " %9.2f", rate);
+				if (rate > best) {
+					best = rate;
+					fastest = stress_memcpy_copies[c].name;
+				}
+			}
+			(void)snprintf(line + len, sizeof(line) - len, " %s", fastest);
+			pr_inf("%s: %s\n", args->name, line);
+		}
+	}
+
+	/* peak aligned copy rate of each copy */
+	for (c = 0; (c < MEMCPY_COPIES) && (idx < STRESS_MISC_STATS_MAX); c++) {
+		char desc[32];
+		double peak = 0.0;
+
+		if (!used[c])
+			continue;
+		for (s = 0; s < MEMCPY_SWEEP_SIZES; s++) {
+			const double secs = sweep->secs[c][0][s];
+			const double rate = (secs > 0.0) ?
+				sweep->bytes[c][0][s] / (secs * 1.0E9) : 0.0;
+
+			if (rate > peak)
+				peak = rate;
+		}
+		(void)snprintf(desc, sizeof(desc), "%s peak GB/s", stress_memcpy_copies[c].name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, peak);
+	}
+}
+
+/*
+ *  stress_memcpy_sweep_run()
+ *	each bogo-op is a sweep of all the sizes and misalignments
+ *	with one copy, the all method cycles through all the copies
+ *	that the CPU supports
+ */
+static int stress_memcpy_sweep_run(
+	const stress_args_t *args,
+	const stress_memcpy_method_info_t *memcpy_method)
+{
+	const size_t buf_size = MEMCPY_SWEEP_MAX + args->page_size;
+	stress_memcpy_sweep_t *sweep;
+	bool used[MEMCPY_COPIES];
+	uint8_t *src, *dst;
+	size_t c, n = 0;
+
+	(void)memset(used, 0, sizeof(used));
+	for (c = 0; c < MEMCPY_COPIES; c++) {
+		const stress_memcpy_copy_info_t *info = &stress_memcpy_copies[c];
+
+		if (info->supported && !info->supported())
+			continue;
+		if ((memcpy_method->func == stress_memcpy_all) ||
+		    !strcmp(info->name, memcpy_method->name)) {
+			used[c] = true;
+			n++;
+		}
+	}
+	if (!n) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: memcpy-method '%s' is not supported by the sweep, "
+				"skipping stressor\n", args->name, memcpy_method->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	sweep = calloc(1, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	src = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (src == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte sweep buffer, skipping stressor\n",
+			args->name, buf_size);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+	dst = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (dst == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte sweep buffer, skipping stressor\n",
+			args->name, buf_size);
+		(void)munmap((void *)src, buf_size);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+	/* fault in the buffers so the large copies are not page fault bound */
+	stress_uint8rnd4(src, buf_size);
+	(void)memset(dst, 0, buf_size);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	c = 0;
+	do {
+		while (!used[c])
+			c = (c + 1) % MEMCPY_COPIES;
+		stress_memcpy_sweep(args, c, sweep, src, dst);
+		c = (c + 1) % MEMCPY_COPIES;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_memcpy_sweep_report(args, sweep, used);
+
+	(void)munmap((void *)dst, buf_size);
+	(void)munmap((void *)src, buf_size);
+	free(sweep);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_memcpy()
  *	stress memory copies
@@ -311,6 +749,7 @@ static int stress_memcpy(const stress_args_t *args)
 	uint8_t *str_shared = g_shared->str_shared;
 	uint8_t *aligned_buf = stress_align_address(b.buffer, ALIGN_SIZE);
 	const stress_memcpy_method_info_t *memcpy_method = &stress_memcpy_methods[0];
+	bool memcpy_sweep = false;
 
 	s_args_name = args->name;
 
@@ -323,6 +762,16 @@ static int stress_memcpy(const stress_args_t *args)
 	}
 
 	(void)stress_get_setting("memcpy-method", &memcpy_method);
+	(void)stress_get_setting("memcpy-sweep", &memcpy_sweep);
+
+	if (memcpy_method->supported && !memcpy_method->supported()) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: memcpy-method '%s' is not supported by this CPU, "
+				"skipping stressor\n", args->name, memcpy_method->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (memcpy_sweep)
+		return stress_memcpy_sweep_run(args, memcpy_method);
 
 	stress_strnrnd((char *)aligned_buf, ALIGN_SIZE);
 
@@ -340,6 +789,7 @@ static int stress_memcpy(const stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_memcpy_method,	stress_set_memcpy_method },
+	{ OPT_memcpy_sweep,	stress_set_memcpy_sweep },
 	{ 0,			NULL }
 };
 
@@ -19,11 +19,14 @@
  */
 #include "stress-ng.h"
 #include "core-capabilities.h"
+#include "core-hotplug.h"
+#include "core-latency.h"
 
 #if defined(__linux__)
 typedef struct {
 	char *name;
 	bool timeout;
+	stress_hotplug_lat_t *lat;	/* transition latencies */
 } stress_mem_info_t;
 #endif
 
@@ -85,7 +88,52 @@ static void stress_memhotplug_set_timer(const unsigned int secs)
 	(void)setitimer(ITIMER_PROF, &timer, NULL);
 }
 
-static void stress_memhotplug_mem_toggle(stress_mem_info_t *mem_info)
+/*
+ *  stress_memhotplug_write()
+ *	write a memory block state and record how long the transition
+ *	took and how long the other stressors stalled
+ */
+static ssize_t stress_memhotplug_write(
+	const stress_args_t *args,
+	stress_mem_info_t *mem_info,
+	const int fd,
+	const char *state,
+	stress_hotplug_stall_t *st)
+{
+	const size_t len = strlen(state);
+	uint64_t t, stall;
+	ssize_t n;
+
+	if (!mem_info->lat) {
+		mem_info->lat = calloc(1, sizeof(*mem_info->lat));
+		if (mem_info->lat)
+			(void)shim_strlcpy(mem_info->lat->name, mem_info->name,
+				sizeof(mem_info->lat->name));
+	}
+
+	stress_hotplug_stall_begin(st);
+	t = stress_latency_now();
+	n = write(fd, state, len);
+	t = stress_latency_now() - t;
+	stall = stress_hotplug_stall_end(st);
+
+	/* only time the transitions that happened */
+	if (n != (ssize_t)len)
+		return n;
+	stress_latency_record(args->latency, t);
+	if (mem_info->lat) {
+		stress_latency_record(strcmp(state, "online") ?
+			&mem_info->lat->offline : &mem_info->lat->online, t);
+		if (st)
+			stress_latency_record(&mem_info->lat->stall, stall);
+	}
+	return n;
+}
+
+static void stress_memhotplug_mem_toggle(
+	const stress_args_t *args,
+	stress_mem_info_t *mem_info,
+	stress_hotplug_stall_t *st)
 {
 	char path[PATH_MAX];
 	int fd;
@@ -109,7 +157,7 @@ static void stress_memhotplug_mem_toggle(stress_mem_info_t *mem_info)
 
 	stress_memhotplug_set_timer(3);
 	errno = 0;
-	n = write(fd, "offline", 7);
+	n = stress_memhotplug_write(args, mem_info, fd, "offline", st);
 	if (n < 0) {
 		if (errno == EINTR)
 			mem_info->timeout = true;
@@ -117,7 +165,7 @@ static void stress_memhotplug_mem_toggle(stress_mem_info_t *mem_info)
 
 	stress_memhotplug_set_timer(5);
 	errno = 0;
-	VOID_RET(ssize_t, write(fd, "online", 6));
+	VOID_RET(ssize_t, stress_memhotplug_write(args, mem_info, fd, "online", st));
 	stress_memhotplug_set_timer(0);
 	(void)close(fd);
 }
@@ -154,6 +202,8 @@ static int stress_memhotplug(const stress_args_t *args)
 	DIR *dir;
 	struct dirent *d;
 	stress_mem_info_t *mem_info;
+	stress_hotplug_lat_t **lats;
+	stress_hotplug_stall_t *st;
 	size_t i, n = 0, max;
 
 	if (stress_sighandler(args->name, SIGPROF, stress_itimer_handler, NULL))
@@ -195,6 +245,7 @@ static int stress_memhotplug(const stress_args_t *args)
 		     stress_memhotplug_removable(d->d_name)) {
 			mem_info[max].name = strdup(d->d_name);
 			mem_info[max].timeout = false;
+			mem_info[max].lat = NULL;
 			max++;
 		}
 	}
@@ -203,12 +254,13 @@ static int stress_memhotplug(const stress_args_t *args)
 	pr_dbg("%s: found %zd removable hotplug memory regions\n",
 		args->name, max);
 
+	st = stress_hotplug_stall_create(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
 		bool ok = false;
 		for (i = 0; keep_stressing(args) && (i < max); i++) {
-			stress_memhotplug_mem_toggle(&mem_info[i]);
+			stress_memhotplug_mem_toggle(args, &mem_info[i], st);
 			if (!mem_info[i].timeout)
 				ok = true;
 			inc_counter(args);
@@ -223,8 +275,19 @@ static int stress_memhotplug(const stress_args_t *args)
 
 	for (i = 0; i < max; i++)
 		stress_memhotplug_mem_online(&mem_info[i]);
-	for (i = 0; i < n; i++)
+	stress_hotplug_stall_destroy(st);
+
+	lats = calloc(max, sizeof(*lats));
+	if (lats) {
+		for (i = 0; i < max; i++)
+			lats[i] = mem_info[i].lat;
+		stress_hotplug_report(args, lats, max);
+		free(lats);
+	}
+	for (i = 0; i < n; i++) {
 		free(mem_info[i].name);
+		free(mem_info[i].lat);
+	}
 	free(mem_info);
 
 	return EXIT_SUCCESS;
@@ -19,7 +19,9 @@
  */
 #include "stress-ng.h"
 #include "core-cache.h"
+#include "core-mem-backing.h"
 #include "core-nt-store.h"
+#include "core-ptrchase.h"
 #include "core-target-clones.h"
 #include "core-vecmath.h"
 
@@ -30,12 +32,22 @@
 #define MAX_MEMRATE_BYTES       (MAX_MEM_LIMIT)
 #define DEFAULT_MEMRATE_BYTES   (256 * MB)
 
+#define DEFAULT_MEMRATE_LATENCY_STEPS	(8)
+#define MAX_MEMRATE_LATENCY_STEPS	(64)
+#define MAX_MEMRATE_LATENCY_THREADS	(1024)
+#define MEMRATE_LATENCY_STEP_TIME	(1.0)		/* seconds per load step */
+#define MEMRATE_LATENCY_LOADS		(1U << 16)	/* chased loads per timing */
+#define MEMRATE_LATENCY_LINE		(64)		/* pointer chase stride */
+
 static const stress_help_t help[] = {
 	{ NULL,	"memrate N",		"start N workers exercised memory read/writes" },
 	{ NULL,	"memrate-ops N",	"stop after N memrate bogo operations" },
 	{ NULL,	"memrate-bytes N",	"size of memory buffer being exercised" },
 	{ NULL,	"memrate-rd-mbs N",	"read rate from buffer in megabytes per second" },
 	{ NULL,	"memrate-wr-mbs N",	"write rate to buffer in megabytes per second" },
+	{ NULL,	"memrate-latency",	"measure load latency while sweeping injected read bandwidth" },
+	{ NULL,	"memrate-latency-steps N", "number of injected bandwidth steps for memrate-latency" },
+	{ NULL,	"memrate-latency-threads N", "number of bandwidth load threads for memrate-latency" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -70,6 +82,28 @@ typedef struct {
 	stress_memrate_func_t	func_rate;
 } stress_memrate_info_t;
 
+/* --memrate-latency bandwidth load thread */
+typedef struct {
+	stress_memrate_context_t context;	/* slice of buffer and read rate */
+	stress_memrate_func_t func;		/* load kernel */
+	double kbytes;				/* data read */
+	double duration;			/* time spent reading */
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;
+#endif
+	int ret;				/* pthread_create return */
+} stress_memrate_load_t;
+
+/* --memrate-latency results of one injected bandwidth step */
+typedef struct {
+	uint64_t loads;		/* dependent loads chased */
+	double duration;	/* time taken by the loads */
+	double rate;		/* sum of achieved MB/sec of each sample */
+	uint32_t samples;	/* number of times the step was run */
+} stress_memrate_latency_t;
+
+static volatile bool memrate_load_stop;
+
 static int stress_set_memrate_bytes(const char *opt)
 {
 	uint64_t memrate_bytes;
@@ -90,6 +124,31 @@ static int stress_set_memrate_rd_mbs(const char *opt)
 	return stress_set_setting("memrate-rd-mbs", TYPE_ID_UINT64, &memrate_rd_mbs);
 }
 
+static int stress_set_memrate_latency(const char *opt)
+{
+	return stress_set_setting_true("memrate-latency", opt);
+}
+
+static int stress_set_memrate_latency_steps(const char *opt)
+{
+	uint32_t memrate_latency_steps;
+
+	memrate_latency_steps = stress_get_uint32(opt);
+	stress_check_range("memrate-latency-steps", memrate_latency_steps,
+		1, MAX_MEMRATE_LATENCY_STEPS);
+	return stress_set_setting("memrate-latency-steps", TYPE_ID_UINT32, &memrate_latency_steps);
+}
+
+static int stress_set_memrate_latency_threads(const char *opt)
+{
+	uint32_t memrate_latency_threads;
+
+	memrate_latency_threads = stress_get_uint32(opt);
+	stress_check_range("memrate-latency-threads", memrate_latency_threads,
+		1, MAX_MEMRATE_LATENCY_THREADS);
+	return stress_set_setting("memrate-latency-threads", TYPE_ID_UINT32, &memrate_latency_threads);
+}
+
 static int stress_set_memrate_wr_mbs(const char *opt)
 {
 	uint64_t memrate_wr_mbs;
@@ -578,17 +637,14 @@ static void OPTIMIZE3 stress_memrate_init_data(
 	void *start,
 	void *end)
 {
-	register volatile uint32_t *ptr;
-
-	for (ptr = start; ptr < (uint32_t *)end; ptr++)
-		*ptr = stress_mwc32();
+	stress_mwc_fill(start, (size_t)((uint8_t *)end - (uint8_t *)start));
 }
 
-static inline void *stress_memrate_mmap(const stress_args_t *args, uint64_t sz)
+static inline void *stress_memrate_mmap(const stress_args_t *args, size_t *sz)
 {
 	void *ptr;
 
-	ptr = mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+	ptr = stress_mem_backing_mmap(args, sz, PROT_READ | PROT_WRITE,
 #if defined(MAP_POPULATE)
 		MAP_POPULATE |
 #endif
@@ -597,18 +653,18 @@ static inline void *stress_memrate_mmap(const stress_args_t *args, uint64_t sz)
 #else
 		MAP_SHARED |
 #endif
-		MAP_ANONYMOUS, -1, 0);
+		MAP_ANONYMOUS);
 	/* Coverity Scan believes NULL can be returned, doh */
 	if (!ptr || (ptr == MAP_FAILED)) {
-		pr_err("%s: cannot allocate %" PRIu64 " bytes\n",
-			args->name, sz);
+		pr_err("%s: cannot allocate %zu bytes\n",
+			args->name, *sz);
 		ptr = MAP_FAILED;
 	} else {
 #if defined(HAVE_MADVISE) &&	\
     defined(MADV_HUGEPAGE)
 		int ret, advice = MADV_NORMAL;
 
-		ret = madvise(ptr, sz, advice);
+		ret = madvise(ptr, *sz, advice);
 		(void)ret;
 #endif
 	}
@@ -627,12 +683,233 @@ static inline uint64_t stress_memrate_dispatch(
 	return info->func_rate(context, valid);
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_memrate_latency_load()
+ *	pthread that injects memory bandwidth load until told to stop
+ */
+static void *stress_memrate_latency_load(void *arg)
+{
+	stress_memrate_load_t *load = (stress_memrate_load_t *)arg;
+	sigset_t set;
+	double t1;
+
+	/* Let the controlling thread handle the signals */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	t1 = stress_time_now();
+	while (!memrate_load_stop && keep_stressing_flag()) {
+		bool valid = false;
+
+		load->kbytes += (double)load->func(&load->context, &valid);
+	}
+	load->duration = stress_time_now() - t1;
+
+	return NULL;
+}
+
+/*
+ *  stress_memrate_latency_step()
+ *	run n_loads load threads with the given kernel and per thread
+ *	read rate while chasing the pointer chain for a step period,
+ *	returns the achieved load bandwidth in MB/sec
+ */
+static double stress_memrate_latency_step(
+	stress_memrate_load_t *loads,
+	const uint32_t n_loads,
+	const stress_memrate_func_t func,
+	const uint64_t rd_mbs,
+	stress_memrate_latency_t *step,
+	void **chase)
+{
+	const double t_end = stress_time_now() + MEMRATE_LATENCY_STEP_TIME;
+	double rate = 0.0, duration = 0.0;
+	uint64_t loaded = 0;
+	uint32_t i;
+
+	memrate_load_stop = false;
+	for (i = 0; i < n_loads; i++) {
+		loads[i].func = func;
+		loads[i].context.memrate_rd_mbs = rd_mbs;
+		loads[i].kbytes = 0.0;
+		loads[i].duration = 0.0;
+		loads[i].ret = pthread_create(&loads[i].pthread, NULL,
+			stress_memrate_latency_load, (void *)&loads[i]);
+	}
+
+	do {
+		double t1, t2;
+
+		t1 = stress_time_now();
+		*chase = stress_ptrchase_chase(*chase, MEMRATE_LATENCY_LOADS);
+		t2 = stress_time_now();
+		loaded += MEMRATE_LATENCY_LOADS;
+		duration += t2 - t1;
+	} while (keep_stressing_flag() && (stress_time_now() < t_end));
+
+	memrate_load_stop = true;
+	for (i = 0; i < n_loads; i++) {
+		if (loads[i].ret)
+			continue;
+		(void)pthread_join(loads[i].pthread, NULL);
+		if (loads[i].duration > 0.0)
+			rate += loads[i].kbytes / (loads[i].duration * KB);
+	}
+
+	step->loads += loaded;
+	step->duration += duration;
+	step->rate += rate;
+	step->samples++;
+
+	return rate;
+}
+
+/*
+ *  stress_memrate_latency()
+ *	loaded latency, measure the dependent load latency on one
+ *	thread while the other threads inject read bandwidth, sweeping
+ *	the injected bandwidth from idle to unthrottled
+ */
+static int stress_memrate_latency(
+	const stress_args_t *args,
+	stress_memrate_context_t *context)
+{
+	uint32_t memrate_latency_steps = DEFAULT_MEMRATE_LATENCY_STEPS;
+	uint32_t memrate_latency_threads, i;
+	int32_t cpus = stress_get_processors_online();
+	stress_memrate_latency_t steps[MAX_MEMRATE_LATENCY_STEPS + 1];
+	stress_memrate_load_t *loads;
+	stress_memrate_func_t func = NULL, func_rate = NULL;
+	size_t chase_sz, idx_sz, slice;
+	uint8_t *chase_buf;
+	uint32_t *idx;
+	double peak = 0.0;
+	void *chase;
+	bool lock = false;
+
+	for (i = 0; i < memrate_items; i++) {
+		const size_t len = strlen(memrate_info[i].name);
+
+		/* widest read kernel without software prefetching */
+		if ((memrate_info[i].rdwr == MR_RD) &&
+		    ((len < 2) || strcmp(memrate_info[i].name + len - 2, "pf"))) {
+			func = memrate_info[i].func;
+			func_rate = memrate_info[i].func_rate;
+			break;
+		}
+	}
+	if (!func)
+		return EXIT_NO_RESOURCE;
+
+	cpus = (cpus > 1) ? (cpus - 1) / (int32_t)args->num_instances : 1;
+	memrate_latency_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+	(void)stress_get_setting("memrate-latency-steps", &memrate_latency_steps);
+	(void)stress_get_setting("memrate-latency-threads", &memrate_latency_threads);
+
+	loads = calloc(memrate_latency_threads, sizeof(*loads));
+	if (!loads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " load threads, "
+			"skipping stressor\n", args->name, memrate_latency_threads);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* chase a chain as large as the load buffer, well past the LLC */
+	chase_sz = (size_t)context->memrate_bytes;
+	chase_buf = (uint8_t *)stress_mem_backing_mmap(args, &chase_sz,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS);
+	if (chase_buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte pointer chase buffer, "
+			"skipping stressor\n", args->name, chase_sz);
+		free(loads);
+		return EXIT_NO_RESOURCE;
+	}
+	idx_sz = (size_t)(context->memrate_bytes / MEMRATE_LATENCY_LINE) * sizeof(*idx);
+	idx = (uint32_t *)mmap(NULL, idx_sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (idx == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte pointer chase index, "
+			"skipping stressor\n", args->name, idx_sz);
+		(void)munmap((void *)chase_buf, chase_sz);
+		free(loads);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_ptrchase_build(chase_buf, idx, context->memrate_bytes, MEMRATE_LATENCY_LINE);
+	(void)munmap((void *)idx, idx_sz);
+	chase = (void *)chase_buf;
+
+	/* each load thread reads its own slice of the load buffer */
+	slice = ((size_t)context->memrate_bytes / memrate_latency_threads) & ~(size_t)(KB - 1);
+	if (slice < KB)
+		slice = KB;
+	for (i = 0; i < memrate_latency_threads; i++) {
+		const size_t offset = ((size_t)i * slice) % ((size_t)context->memrate_bytes - slice + 1);
+
+		loads[i].context = *context;
+		loads[i].context.start = (uint8_t *)context->start + offset;
+		loads[i].context.end = (uint8_t *)loads[i].context.start + slice;
+	}
+	(void)memset(steps, 0, sizeof(steps));
+
+	do {
+		double rate;
+
+		/* unthrottled load sets the peak the other steps are a share of */
+		rate = stress_memrate_latency_step(loads, memrate_latency_threads,
+			func, ~0ULL, &steps[memrate_latency_steps], &chase);
+		if (peak <= 0.0)
+			peak = rate;
+
+		for (i = 0; keep_stressing(args) && (i < memrate_latency_steps); i++) {
+			const double target = (peak * (double)i) / (double)memrate_latency_steps;
+			const uint64_t rd_mbs = (uint64_t)(target / (double)memrate_latency_threads);
+
+			/* step 0 is idle latency, no load threads */
+			stress_memrate_latency_step(loads, (i && rd_mbs) ? memrate_latency_threads : 0,
+				func_rate, rd_mbs ? rd_mbs : 1, &steps[i], &chase);
+		}
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	pr_lock(&lock);
+	pr_inf_lock(&lock, "%s: loaded latency, %" PRIu32 " load threads, "
+		"%" PRIu64 "MB pointer chase:\n", args->name,
+		memrate_latency_threads, context->memrate_bytes / (uint64_t)MB);
+	pr_inf_lock(&lock, "%s: %6s %12s %12s %12s\n", args->name,
+		"load", "target MB/s", "actual MB/s", "ns per load");
+	for (i = 0; i <= memrate_latency_steps; i++) {
+		const stress_memrate_latency_t *step = &steps[i];
+		const double pc = (100.0 * (double)i) / (double)memrate_latency_steps;
+		double ns, rate;
+		char tmp[32];
+
+		if (!step->samples || !step->loads)
+			continue;
+		ns = (step->duration * (double)STRESS_NANOSECOND) / (double)step->loads;
+		rate = step->rate / (double)step->samples;
+
+		pr_inf_lock(&lock, "%s: %5.1f%% %12.2f %12.2f %12.2f\n", args->name,
+			pc, (peak * pc) / 100.0, rate, ns);
+		(void)snprintf(tmp, sizeof(tmp), "ns per load at %.0f%% load", pc);
+		stress_misc_stats_set(args->misc_stats, (int)i, tmp, ns);
+	}
+	pr_unlock(&lock);
+
+	(void)munmap((void *)chase_buf, chase_sz);
+	free(loads);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 static int stress_memrate_child(const stress_args_t *args, void *ctxt)
 {
 	stress_memrate_context_t *context = (stress_memrate_context_t *)ctxt;
 	void *buffer, *buffer_end;
+	size_t buffer_sz = (size_t)context->memrate_bytes;
+	bool memrate_latency = false;
 
-	buffer = stress_memrate_mmap(args, context->memrate_bytes);
+	buffer = stress_memrate_mmap(args, &buffer_sz);
 	if (buffer == MAP_FAILED)
 		return EXIT_NO_RESOURCE;
 
@@ -642,6 +919,21 @@ static int stress_memrate_child(const stress_args_t *args, void *ctxt)
 	context->start = buffer;
 	context->end = buffer_end;
 
+	(void)stress_get_setting("memrate-latency", &memrate_latency);
+	if (memrate_latency) {
+#if defined(HAVE_LIB_PTHREAD)
+		const int rc = stress_memrate_latency(args, context);
+#else
+		const int rc = EXIT_NOT_IMPLEMENTED;
+
+		if (args->instance == 0)
+			pr_inf_skip("%s: pthreads not supported, cannot run "
+				"--memrate-latency, skipping stressor\n", args->name);
+#endif
+		(void)munmap((void *)buffer, buffer_sz);
+		return rc;
+	}
+
 	do {
 		size_t i;
 
@@ -665,7 +957,7 @@ static int stress_memrate_child(const stress_args_t *args, void *ctxt)
 		inc_counter(args);
 	} while (keep_stressing(args));
 
-	(void)munmap((void *)buffer, context->memrate_bytes);
+	(void)munmap((void *)buffer, buffer_sz);
 	return EXIT_SUCCESS;
 }
 
@@ -736,6 +1028,9 @@ static int stress_memrate(const stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_memrate_bytes,	stress_set_memrate_bytes },
+	{ OPT_memrate_latency,	stress_set_memrate_latency },
+	{ OPT_memrate_latency_steps, stress_set_memrate_latency_steps },
+	{ OPT_memrate_latency_threads, stress_set_memrate_latency_threads },
 	{ OPT_memrate_rd_mbs,	stress_set_memrate_rd_mbs },
 	{ OPT_memrate_wr_mbs,	stress_set_memrate_wr_mbs },
 	{ 0,			NULL }
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-cache.h"
+#include "core-mem-backing.h"
 #include "core-nt-store.h"
 #include "core-pthread.h"
 #include "core-target-clones.h"
@@ -690,6 +691,7 @@ static int stress_memthrash_child(const stress_args_t *args, void *ctxt)
 	pthread_t pthreads[max_threads];
 	int pthreads_ret[max_threads], ret;
 	stress_pthread_args_t pargs;
+	size_t mem_sz = MEM_SIZE;
 
 	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
 #if defined(MAP_POPULATE)
@@ -706,7 +708,7 @@ static int stress_memthrash_child(const stress_args_t *args, void *ctxt)
 	(void)memset(pthreads_ret, 0, sizeof(pthreads_ret));
 
 mmap_retry:
-	mem = mmap(NULL, MEM_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+	mem = stress_mem_backing_mmap(args, &mem_sz, PROT_READ | PROT_WRITE, flags);
 	if (mem == MAP_FAILED) {
 #if defined(MAP_POPULATE)
 		flags &= ~MAP_POPULATE;	/* Less aggressive, more OOMable */
@@ -752,7 +754,7 @@ reap:
 		}
 	}
 reap_mem:
-	(void)munmap(mem, MEM_SIZE);
+	(void)munmap(mem, mem_sz);
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,456 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+
+#define MIN_METAMIX_THREADS	(1)
+#define MAX_METAMIX_THREADS	(256)
+#define DEFAULT_METAMIX_THREADS	(4)
+
+#define METAMIX_BATCH		(32)	/* files per thread per round */
+#define METAMIX_STEP_TIME	(1.0)	/* seconds per thread count step */
+#define METAMIX_MAX_STEPS	(16)
+
+/* Metadata operations of a round */
+#define METAMIX_OP_CREATE	(0)
+#define METAMIX_OP_STAT		(1)
+#define METAMIX_OP_RENAME	(2)
+#define METAMIX_OP_READDIR	(3)
+#define METAMIX_OP_UNLINK	(4)
+#define METAMIX_OPS		(5)
+
+/* Directory layouts */
+#define METAMIX_MODE_SHARED	(0)	/* all threads in one directory */
+#define METAMIX_MODE_SHARDED	(1)	/* a directory per thread */
+#define METAMIX_MODES		(2)
+#define METAMIX_MODE_BOTH	(METAMIX_MODES)
+
+static const char * const metamix_modes[] = {
+	"shared", "sharded", "both"
+};
+
+static const char * const metamix_op_names[METAMIX_OPS] = {
+	"create", "stat", "rename", "readdir", "unlink"
+};
+
+/* Totals of one mode and thread count step */
+typedef struct {
+	uint32_t threads;		/* threads in this step */
+	uint64_t ops[METAMIX_OPS];	/* ops completed */
+	double duration[METAMIX_OPS];	/* thread time spent in the ops */
+	double wall;			/* wall clock time of the steps */
+} stress_metamix_result_t;
+
+static const stress_help_t help[] = {
+	{ NULL,	"metamix N",		"start N workers running file metadata operation mixes" },
+	{ NULL,	"metamix-mode M",	"directory layout: shared, sharded or both" },
+	{ NULL,	"metamix-ops N",	"stop after N metadata operations" },
+	{ NULL,	"metamix-threads N",	"scale from 1 up to N threads per worker" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_metamix_threads(const char *opt)
+{
+	uint32_t metamix_threads;
+
+	metamix_threads = stress_get_uint32(opt);
+	stress_check_range("metamix-threads", (uint64_t)metamix_threads,
+		MIN_METAMIX_THREADS, MAX_METAMIX_THREADS);
+	return stress_set_setting("metamix-threads", TYPE_ID_UINT32, &metamix_threads);
+}
+
+static int stress_set_metamix_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(metamix_modes); i++) {
+		if (!strcmp(opt, metamix_modes[i]))
+			return stress_set_setting("metamix-mode", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "invalid metamix-mode '%s', allowed modes are:", opt);
+	for (i = 0; i < SIZEOF_ARRAY(metamix_modes); i++)
+		(void)fprintf(stderr, " %s", metamix_modes[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_metamix_mode,	stress_set_metamix_mode },
+	{ OPT_metamix_threads,	stress_set_metamix_threads },
+	{ 0,			NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD)
+
+/* Per thread state of a step */
+typedef struct {
+	char dir[PATH_MAX + 32];	/* directory the thread works in */
+	uint32_t id;			/* thread number */
+	uint64_t ops[METAMIX_OPS];	/* ops completed */
+	double duration[METAMIX_OPS];	/* time spent in the ops */
+	int err;			/* errno of a failed op, 0 if OK */
+	int ret;			/* pthread_create return */
+	pthread_t pthread;
+} stress_metamix_thread_t;
+
+static volatile bool metamix_stop;
+
+/*
+ *  stress_metamix_names()
+ *	file names before and after the rename
+ */
+static inline void stress_metamix_names(
+	const stress_metamix_thread_t *thread,
+	const int i,
+	char *name,
+	char *rname,
+	const size_t len)
+{
+	(void)snprintf(name, len, "%s/m%" PRIu32 "-%d", thread->dir, thread->id, i);
+	(void)snprintf(rname, len, "%s/r%" PRIu32 "-%d", thread->dir, thread->id, i);
+}
+
+/*
+ *  stress_metamix_thread()
+ *	run rounds of create, stat, rename, readdir and unlink
+ *	until told to stop
+ */
+static void *stress_metamix_thread(void *arg)
+{
+	stress_metamix_thread_t *thread = (stress_metamix_thread_t *)arg;
+	char name[PATH_MAX + 64], rname[PATH_MAX + 64];
+	sigset_t set;
+	int i;
+
+	/* Let the controlling thread handle the signals */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!metamix_stop && keep_stressing_flag()) {
+		struct stat statbuf;
+		struct dirent *d;
+		DIR *dir;
+		double t;
+
+		for (i = 0; i < METAMIX_BATCH; i++) {
+			int fd;
+
+			stress_metamix_names(thread, i, name, rname, sizeof(name));
+			t = stress_time_now();
+			fd = open(name, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR);
+			if (fd < 0) {
+				thread->err = errno;
+				goto done;
+			}
+			(void)close(fd);
+			thread->duration[METAMIX_OP_CREATE] += stress_time_now() - t;
+			thread->ops[METAMIX_OP_CREATE]++;
+		}
+		for (i = 0; i < METAMIX_BATCH; i++) {
+			stress_metamix_names(thread, i, name, rname, sizeof(name));
+			t = stress_time_now();
+			if (stat(name, &statbuf) < 0) {
+				thread->err = errno;
+				goto done;
+			}
+			thread->duration[METAMIX_OP_STAT] += stress_time_now() - t;
+			thread->ops[METAMIX_OP_STAT]++;
+		}
+		for (i = 0; i < METAMIX_BATCH; i++) {
+			stress_metamix_names(thread, i, name, rname, sizeof(name));
+			t = stress_time_now();
+			if (rename(name, rname) < 0) {
+				thread->err = errno;
+				goto done;
+			}
+			thread->duration[METAMIX_OP_RENAME] += stress_time_now() - t;
+			thread->ops[METAMIX_OP_RENAME]++;
+		}
+
+		/* a full scan, a shared directory also holds the other threads' files */
+		t = stress_time_now();
+		dir = opendir(thread->dir);
+		if (!dir) {
+			thread->err = errno;
+			goto done;
+		}
+		while ((d = readdir(dir)) != NULL)
+			;
+		(void)closedir(dir);
+		thread->duration[METAMIX_OP_READDIR] += stress_time_now() - t;
+		thread->ops[METAMIX_OP_READDIR]++;
+
+		for (i = 0; i < METAMIX_BATCH; i++) {
+			stress_metamix_names(thread, i, name, rname, sizeof(name));
+			t = stress_time_now();
+			if (unlink(rname) < 0) {
+				thread->err = errno;
+				goto done;
+			}
+			thread->duration[METAMIX_OP_UNLINK] += stress_time_now() - t;
+			thread->ops[METAMIX_OP_UNLINK]++;
+		}
+	}
+done:
+	/* remove anything left over by an interrupted round */
+	for (i = 0; i < METAMIX_BATCH; i++) {
+		stress_metamix_names(thread, i, name, rname, sizeof(name));
+		(void)unlink(name);
+		(void)unlink(rname);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_metamix_step()
+ *	run n threads in the given directory layout for a step
+ *	period and add their op counts and times to result
+ */
+static int stress_metamix_step(
+	const stress_args_t *args,
+	stress_metamix_thread_t *threads,
+	const uint32_t n,
+	const int mode,
+	const char *base,
+	stress_metamix_result_t *result)
+{
+	double t_start, t_end;
+	uint64_t total = 0;
+	uint32_t i;
+	int rc = EXIT_SUCCESS;
+	size_t op;
+
+	metamix_stop = false;
+	for (i = 0; i < n; i++) {
+		stress_metamix_thread_t *thread = &threads[i];
+
+		(void)memset(thread->ops, 0, sizeof(thread->ops));
+		(void)memset(thread->duration, 0, sizeof(thread->duration));
+		thread->id = i;
+		thread->err = 0;
+		if (mode == METAMIX_MODE_SHARED)
+			(void)snprintf(thread->dir, sizeof(thread->dir), "%s/shared", base);
+		else
+			(void)snprintf(thread->dir, sizeof(thread->dir), "%s/shard%" PRIu32, base, i);
+		thread->ret = pthread_create(&thread->pthread, NULL,
+			stress_metamix_thread, (void *)thread);
+	}
+
+	t_start = stress_time_now();
+	t_end = t_start + METAMIX_STEP_TIME;
+	while (keep_stressing(args) && (stress_time_now() < t_end))
+		(void)shim_usleep(10000);
+	metamix_stop = true;
+
+	for (i = 0; i < n; i++) {
+		stress_metamix_thread_t *thread = &threads[i];
+
+		if (thread->ret)
+			continue;
+		(void)pthread_join(thread->pthread, NULL);
+		for (op = 0; op < METAMIX_OPS; op++) {
+			result->ops[op] += thread->ops[op];
+			result->duration[op] += thread->duration[op];
+			total += thread->ops[op];
+		}
+		if (thread->err && (rc == EXIT_SUCCESS)) {
+			if ((thread->err == ENOSPC) || (thread->err == EDQUOT) ||
+			    (thread->err == EMFILE) || (thread->err == ENFILE)) {
+				pr_inf_skip("%s: out of resources, errno=%d (%s), "
+					"skipping stressor\n", args->name,
+					thread->err, strerror(thread->err));
+				rc = EXIT_NO_RESOURCE;
+			} else {
+				pr_fail("%s: %s directory metadata operation failed, "
+					"errno=%d (%s)\n", args->name, metamix_modes[mode],
+					thread->err, strerror(thread->err));
+				rc = EXIT_FAILURE;
+			}
+		}
+	}
+	result->wall += stress_time_now() - t_start;
+	add_counter(args, total);
+
+	return rc;
+}
+
+/*
+ *  stress_metamix_report()
+ *	report aggregate ops/s per op type and the scaling over
+ *	the single thread rate for each mode and thread count
+ */
+static void stress_metamix_report(
+	const stress_args_t *args,
+	stress_metamix_result_t results[METAMIX_MODES][METAMIX_MAX_STEPS],
+	const size_t n_steps,
+	const size_t mode_mask)
+{
+	size_t mode, step, op, stat_idx = 0;
+
+	if (args->instance == 0) {
+		pr_inf("%s: metadata ops/s (thousands) per op type and thread count\n",
+			args->name);
+		pr_inf("%s: %-8s %7s %8s %8s %8s %8s %8s %9s %7s\n", args->name,
+			"mode", "threads", metamix_op_names[0], metamix_op_names[1],
+			metamix_op_names[2], metamix_op_names[3], metamix_op_names[4],
+			"total", "scaling");
+	}
+	for (mode = 0; mode < METAMIX_MODES; mode++) {
+		double rate_1 = 0.0, rate_n = 0.0;
+		uint32_t threads_n = 0;
+
+		if (!(mode_mask & (1U << mode)))
+			continue;
+		for (step = 0; step < n_steps; step++) {
+			const stress_metamix_result_t *r = &results[mode][step];
+			double rates[METAMIX_OPS], total = 0.0;
+
+			if (r->wall <= 0.0)
+				continue;
+			for (op = 0; op < METAMIX_OPS; op++) {
+				/* aggregate rate, ops over the mean per thread time */
+				rates[op] = (r->duration[op] > 0.0) ?
+					((double)r->ops[op] * (double)r->threads) / r->duration[op] : 0.0;
+				total += (double)r->ops[op];
+			}
+			total /= r->wall;
+			if (step == 0)
+				rate_1 = total;
+			rate_n = total;
+			threads_n = r->threads;
+			if (args->instance == 0) {
+				pr_inf("%s: %-8s %7" PRIu32 " %8.1f %8.1f %8.1f %8.2f %8.1f %9.1f %6.2fx\n",
+					args->name, metamix_modes[mode], r->threads,
+					rates[0] / 1000.0, rates[1] / 1000.0, rates[2] / 1000.0,
+					rates[3] / 1000.0, rates[4] / 1000.0, total / 1000.0,
+					(rate_1 > 0.0) ? total / rate_1 : 0.0);
+			}
+		}
+		if (rate_n > 0.0) {
+			char desc[48];
+
+			(void)snprintf(desc, sizeof(desc), "%s %" PRIu32 " thread ops/s",
+				metamix_modes[mode], threads_n);
+			stress_misc_stats_set(args->misc_stats, stat_idx++, desc, rate_n);
+			(void)snprintf(desc, sizeof(desc), "%s scaling 1 to %" PRIu32 " threads",
+				metamix_modes[mode], threads_n);
+			stress_misc_stats_set(args->misc_stats, stat_idx++, desc,
+				(rate_1 > 0.0) ? rate_n / rate_1 : 0.0);
+		}
+	}
+}
+
+/*
+ *  stress_metamix
+ *	run create/stat/rename/readdir/unlink mixes over a
+ *	sweep of thread counts in shared and sharded directories
+ */
+static int stress_metamix(const stress_args_t *args)
+{
+	static stress_metamix_result_t results[METAMIX_MODES][METAMIX_MAX_STEPS];
+	uint32_t metamix_threads = DEFAULT_METAMIX_THREADS;
+	uint32_t counts[METAMIX_MAX_STEPS], n, i;
+	size_t metamix_mode = METAMIX_MODE_BOTH;
+	size_t n_steps = 0, step, mode, mode_mask;
+	stress_metamix_thread_t *threads;
+	char base[PATH_MAX], path[PATH_MAX + 16];
+	int ret, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("metamix-threads", &metamix_threads);
+	(void)stress_get_setting("metamix-mode", &metamix_mode);
+	mode_mask = (metamix_mode == METAMIX_MODE_BOTH) ?
+		((1U << METAMIX_MODES) - 1) : (1U << metamix_mode);
+
+	/* 1, 2, 4 .. threads */
+	for (n = 1; (n < metamix_threads) && (n_steps < METAMIX_MAX_STEPS - 1); n <<= 1)
+		counts[n_steps++] = n;
+	counts[n_steps++] = metamix_threads;
+
+	threads = calloc(metamix_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " thread states, "
+			"skipping stressor\n", args->name, metamix_threads);
+		return EXIT_NO_RESOURCE;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(threads);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_dir_args(args, base, sizeof(base));
+	(void)snprintf(path, sizeof(path), "%s/shared", base);
+	(void)mkdir(path, S_IRUSR | S_IWUSR | S_IXUSR);
+	for (i = 0; i < metamix_threads; i++) {
+		(void)snprintf(path, sizeof(path), "%s/shard%" PRIu32, base, i);
+		(void)mkdir(path, S_IRUSR | S_IWUSR | S_IXUSR);
+	}
+
+	(void)memset(results, 0, sizeof(results));
+	for (mode = 0; mode < METAMIX_MODES; mode++) {
+		for (step = 0; step < n_steps; step++)
+			results[mode][step].threads = counts[step];
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (step = 0; (step < n_steps) && keep_stressing(args); step++) {
+			for (mode = 0; (mode < METAMIX_MODES) && keep_stressing(args); mode++) {
+				if (!(mode_mask & (1U << mode)))
+					continue;
+				rc = stress_metamix_step(args, threads, counts[step],
+					(int)mode, base, &results[mode][step]);
+				if (rc != EXIT_SUCCESS)
+					goto tidy;
+			}
+		}
+	} while (keep_stressing(args));
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (rc == EXIT_SUCCESS)
+		stress_metamix_report(args, results, n_steps, mode_mask);
+
+	(void)snprintf(path, sizeof(path), "%s/shared", base);
+	(void)rmdir(path);
+	for (i = 0; i < metamix_threads; i++) {
+		(void)snprintf(path, sizeof(path), "%s/shard%" PRIu32, base, i);
+		(void)rmdir(path);
+	}
+	(void)stress_temp_dir_rm_args(args);
+	free(threads);
+
+	return rc;
+}
+
+stressor_info_t stress_metamix_info = {
+	.stressor = stress_metamix,
+	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_metamix_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -24,6 +24,12 @@
 
 #define MISALIGN_LOOPS		(32768)
 
+#define MISALIGN_TIMING_WIDTHS	(4)	/* 16, 32, 64 and 128 bits */
+#define MISALIGN_TIMING_OPS	(3)	/* load, store, atomic */
+#define MISALIGN_TIMING_BOUNDS	(4)	/* aligned, in-line, split-line, split-page */
+#define MISALIGN_TIMING_MIN_SECS (0.001)	/* minimum timed duration per cell */
+#define MISALIGN_TIMING_MAX_N	(1U << 20)
+
 /* Disable atomic ops for SH4 as this breaks gcc on Debian sid */
 #if defined(STRESS_ARCH_SH4)
 #undef HAVE_ATOMIC
@@ -33,6 +39,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"misaligned N",	   	"start N workers performing misaligned read/writes" },
 	{ NULL,	"misaligned-ops N",	"stop after N misaligned bogo operations" },
 	{ NULL,	"misaligned-method M",	"use misaligned memory read/write method" },
+	{ NULL,	"misaligned-timing",	"report ns per aligned, misaligned, split line and split page access" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -880,6 +887,352 @@ static void stress_misaligned_set_default(void)
 	stress_set_misaligned_method("all");
 }
 
+static int stress_set_misaligned_timing(const char *opt)
+{
+	return stress_set_setting_true("misaligned-timing", opt);
+}
+
+/*
+ *  Timing loops, 4 accesses to the same address per iteration so the
+ *  per access cost of the boundary type dominates the loop overhead
+ */
+typedef void (*stress_misaligned_timing_func)(uint8_t *ptr, const uint32_t n);
+
+#define STRESS_MISALIGNED_TIMING_LDST(width, type)				\
+static void NOINLINE stress_misaligned_timing_ld ## width(uint8_t *ptr, const uint32_t n)\
+{										\
+	volatile type *p = (volatile type *)ptr;				\
+	register uint32_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		(void)*p;							\
+		(void)*p;							\
+		(void)*p;							\
+		(void)*p;							\
+	}									\
+}										\
+										\
+static void NOINLINE stress_misaligned_timing_st ## width(uint8_t *ptr, const uint32_t n)\
+{										\
+	volatile type *p = (volatile type *)ptr;				\
+	register uint32_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		*p = (type)i;							\
+		*p = (type)i;							\
+		*p = (type)i;							\
+		*p = (type)i;							\
+	}									\
+}
+
+#define STRESS_MISALIGNED_TIMING_ATOMIC(width, type, atomic_add)		\
+static void NOINLINE stress_misaligned_timing_atomic ## width(uint8_t *ptr, const uint32_t n)\
+{										\
+	volatile type *p = (volatile type *)ptr;				\
+	register uint32_t i;							\
+										\
+	for (i = 0; i < n; i++) {						\
+		atomic_add(p, 1, __ATOMIC_SEQ_CST);				\
+		atomic_add(p, 1, __ATOMIC_SEQ_CST);				\
+		atomic_add(p, 1, __ATOMIC_SEQ_CST);				\
+		atomic_add(p, 1, __ATOMIC_SEQ_CST);				\
+	}									\
+}
+
+STRESS_MISALIGNED_TIMING_LDST(16, uint16_t)
+STRESS_MISALIGNED_TIMING_LDST(32, uint32_t)
+STRESS_MISALIGNED_TIMING_LDST(64, uint64_t)
+#if defined(HAVE_INT128_T)
+/* byte aligned so 128 bit accesses use unaligned vector moves on x86 */
+typedef __uint128_t stress_misaligned_uint128_t __attribute__ ((aligned(1)));
+STRESS_MISALIGNED_TIMING_LDST(128, stress_misaligned_uint128_t)
+#endif
+
+#if defined(HAVE_ATOMIC_FETCH_ADD_2) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+STRESS_MISALIGNED_TIMING_ATOMIC(16, uint16_t, __atomic_fetch_add_2)
+#define STRESS_MISALIGNED_TIMING_ATOMIC16	stress_misaligned_timing_atomic16
+#else
+#define STRESS_MISALIGNED_TIMING_ATOMIC16	NULL
+#endif
+#if defined(HAVE_ATOMIC_FETCH_ADD_4) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+STRESS_MISALIGNED_TIMING_ATOMIC(32, uint32_t, __atomic_fetch_add_4)
+#define STRESS_MISALIGNED_TIMING_ATOMIC32	stress_misaligned_timing_atomic32
+#else
+#define STRESS_MISALIGNED_TIMING_ATOMIC32	NULL
+#endif
+#if defined(HAVE_ATOMIC_FETCH_ADD_8) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__ATOMIC_SEQ_CST)
+STRESS_MISALIGNED_TIMING_ATOMIC(64, uint64_t, __atomic_fetch_add_8)
+#define STRESS_MISALIGNED_TIMING_ATOMIC64	stress_misaligned_timing_atomic64
+#else
+#define STRESS_MISALIGNED_TIMING_ATOMIC64	NULL
+#endif
+
+typedef struct {
+	const char *name;
+	const size_t bytes;
+	const stress_misaligned_timing_func func[MISALIGN_TIMING_OPS];
+} stress_misaligned_timing_width_t;
+
+static const stress_misaligned_timing_width_t misaligned_timing_widths[] = {
+	{ "int16",	2,	{ stress_misaligned_timing_ld16, stress_misaligned_timing_st16,
+				  STRESS_MISALIGNED_TIMING_ATOMIC16 } },
+	{ "int32",	4,	{ stress_misaligned_timing_ld32, stress_misaligned_timing_st32,
+				  STRESS_MISALIGNED_TIMING_ATOMIC32 } },
+	{ "int64",	8,	{ stress_misaligned_timing_ld64, stress_misaligned_timing_st64,
+				  STRESS_MISALIGNED_TIMING_ATOMIC64 } },
+#if defined(HAVE_INT128_T)
+	/* no 128 bit atomic add */
+	{ "int128",	16,	{ stress_misaligned_timing_ld128, stress_misaligned_timing_st128,
+				  NULL } },
+#endif
+};
+
+static const char * const misaligned_timing_ops[MISALIGN_TIMING_OPS] = {
+	"load", "store", "atomic"
+};
+
+static const char * const misaligned_timing_bounds[MISALIGN_TIMING_BOUNDS] = {
+	"aligned", "in-line", "split-line", "split-page"
+};
+
+/* fastest ns per access, < 0.0 if not measured, trapped is set on a fault */
+typedef struct {
+	double ns[MISALIGN_TIMING_WIDTHS][MISALIGN_TIMING_OPS][MISALIGN_TIMING_BOUNDS];
+	bool trapped[MISALIGN_TIMING_WIDTHS][MISALIGN_TIMING_OPS][MISALIGN_TIMING_BOUNDS];
+} stress_misaligned_timing_t;
+
+/*
+ *  stress_misaligned_timing_offset()
+ *	offset into the 2 page buffer of each boundary type, the aligned
+ *	and in-line accesses are well away from the page boundary, the
+ *	split accesses straddle the boundary by half the access width
+ */
+static size_t stress_misaligned_timing_offset(
+	const size_t bound,
+	const size_t bytes,
+	const size_t page_size)
+{
+	switch (bound) {
+	case 0:
+		return 128;
+	case 1:
+		return 128 + 1;
+	case 2:
+		return 128 + 64 - (bytes / 2);
+	default:
+		break;
+	}
+	return page_size - (bytes / 2);
+}
+
+/*
+ *  stress_misaligned_timing_cell()
+ *	time a access loop doubling the count until it runs for long
+ *	enough, returns -1 if the access faulted
+ */
+static int stress_misaligned_timing_cell(
+	stress_misaligned_timing_func func,
+	uint8_t *ptr,
+	double *ns)
+{
+	uint32_t n;
+	double dt;
+
+	current_method = NULL;
+	if (sigsetjmp(jmp_env, 1))
+		return -1;
+
+	for (n = 1; ; n <<= 1) {
+		const double t = stress_time_now();
+
+		func(ptr, n);
+		dt = stress_time_now() - t;
+		if ((dt >= MISALIGN_TIMING_MIN_SECS) || (n >= MISALIGN_TIMING_MAX_N))
+			break;
+	}
+	*ns = (dt * (double)STRESS_NANOSECOND) / (4.0 * (double)n);
+	return 0;
+}
+
+/*
+ *  stress_misaligned_timing_pass()
+ *	time every width, operation and boundary type once, keeping
+ *	the fastest time of each
+ */
+static void stress_misaligned_timing_pass(
+	stress_misaligned_timing_t *timing,
+	uint8_t *buffer,
+	const size_t page_size)
+{
+	size_t w, op, bound;
+
+	for (w = 0; w < SIZEOF_ARRAY(misaligned_timing_widths); w++) {
+		const stress_misaligned_timing_width_t *width = &misaligned_timing_widths[w];
+
+		for (op = 0; op < MISALIGN_TIMING_OPS; op++) {
+			if (!width->func[op])
+				continue;
+			for (bound = 0; bound < MISALIGN_TIMING_BOUNDS; bound++) {
+				const size_t offset = stress_misaligned_timing_offset(bound, width->bytes, page_size);
+				double ns;
+
+				if (timing->trapped[w][op][bound])
+					continue;
+				if (stress_misaligned_timing_cell(width->func[op], buffer + offset, &ns) < 0) {
+					timing->trapped[w][op][bound] = true;
+					continue;
+				}
+				if ((timing->ns[w][op][bound] < 0.0) || (ns < timing->ns[w][op][bound]))
+					timing->ns[w][op][bound] = ns;
+				if (!keep_stressing_flag())
+					return;
+			}
+		}
+	}
+}
+
+/*
+ *  stress_misaligned_timing_split_lock()
+ *	report the kernel split lock policy, split lock atomics may
+ *	be slowed down, warned about or trapped by the kernel
+ */
+static void stress_misaligned_timing_split_lock(const stress_args_t *args)
+{
+#if defined(__linux__) &&	\
+    defined(STRESS_ARCH_X86)
+	char buf[4096], *ptr;
+	ssize_t ret;
+
+	ret = system_read("/proc/cmdline", buf, sizeof(buf) - 1);
+	if (ret > 0) {
+		buf[ret] = '\0';
+		ptr = strstr(buf, "split_lock_detect=");
+		if (ptr) {
+			char *end = strpbrk(ptr, " \n");
+
+			if (end)
+				*end = '\0';
+			pr_inf("%s: kernel %s\n", args->name, ptr);
+		} else {
+			pr_inf("%s: kernel split_lock_detect is the default\n", args->name);
+		}
+	}
+	ret = system_read("/proc/sys/kernel/split_lock_mitigate", buf, sizeof(buf) - 1);
+	if (ret > 0) {
+		buf[ret] = '\0';
+		ptr = strchr(buf, '\n');
+		if (ptr)
+			*ptr = '\0';
+		pr_inf("%s: kernel split_lock_mitigate %s\n", args->name, buf);
+	}
+#else
+	(void)args;
+#endif
+}
+
+/*
+ *  stress_misaligned_timing_report()
+ *	report the ns per access of each width, operation and boundary
+ *	type and the penalty of each relative to the aligned access
+ */
+static void stress_misaligned_timing_report(
+	const stress_args_t *args,
+	const stress_misaligned_timing_t *timing)
+{
+	size_t w, op, bound;
+	int idx = 0;
+
+	if (args->instance == 0) {
+		stress_misaligned_timing_split_lock(args);
+		pr_inf("%s: ns per access %20s %20s %20s %20s\n", args->name,
+			misaligned_timing_bounds[0], misaligned_timing_bounds[1],
+			misaligned_timing_bounds[2], misaligned_timing_bounds[3]);
+	}
+	for (w = 0; w < SIZEOF_ARRAY(misaligned_timing_widths); w++) {
+		for (op = 0; op < MISALIGN_TIMING_OPS; op++) {
+			const double aligned = timing->ns[w][op][0];
+			char line[160];
+			size_t len;
+
+			if (!misaligned_timing_widths[w].func[op])
+				continue;
+			len = (size_t)snprintf(line, sizeof(line), "%-6s %-6s",
+				misaligned_timing_widths[w].name, misaligned_timing_ops[op]);
+			for (bound = 0; bound < MISALIGN_TIMING_BOUNDS; bound++) {
+				const double ns = timing->ns[w][op][bound];
+
+				char cell[32];
+
+				if (timing->trapped[w][op][bound])
+					(void)shim_strlcpy(cell, "trapped", sizeof(cell));
+				else if (ns < 0.0)
+					(void)shim_strlcpy(cell, "-", sizeof(cell));
+				else if ((bound == 0) || (aligned <= 0.0))
+					(void)snprintf(cell, sizeof(cell), "%.2f", ns);
+				else
+					(void)snprintf(cell, sizeof(cell), "%.2f (%.1fx)", ns, ns / aligned);
+				len += (size_t)snprintf(line + len, sizeof(line) - len, " %20s", cell);
+
+				/* 64 bit split penalties and split lock cost */
+				if ((misaligned_timing_widths[w].bytes == 8) && (bound >= 2) &&
+				    (ns >= 0.0) && (idx < STRESS_MISC_STATS_MAX)) {
+					char desc[64];
+
+					(void)snprintf(desc, sizeof(desc), "int64 %s %s ns",
+						misaligned_timing_bounds[bound], misaligned_timing_ops[op]);
+					stress_misc_stats_set(args->misc_stats, idx++, desc, ns);
+				}
+			}
+			if (args->instance == 0)
+				pr_inf("%s: %s\n", args->name, line);
+		}
+	}
+}
+
+/*
+ *  stress_misaligned_timing_run()
+ *	each bogo-op times all the widths, operations and boundary
+ *	types once
+ */
+static int stress_misaligned_timing_run(
+	const stress_args_t *args,
+	uint8_t *buffer,
+	const size_t page_size)
+{
+	stress_misaligned_timing_t *timing;
+	size_t w, op, bound;
+
+	timing = calloc(1, sizeof(*timing));
+	if (!timing) {
+		pr_inf_skip("%s: cannot allocate timing results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (w = 0; w < MISALIGN_TIMING_WIDTHS; w++)
+		for (op = 0; op < MISALIGN_TIMING_OPS; op++)
+			for (bound = 0; bound < MISALIGN_TIMING_BOUNDS; bound++)
+				timing->ns[w][op][bound] = -1.0;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		stress_misaligned_timing_pass(timing, buffer, page_size);
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_misaligned_timing_report(args, timing);
+	free(timing);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_misaligned()
  *	stress memory copies
@@ -891,8 +1244,10 @@ static int stress_misaligned(const stress_args_t *args)
 	int ret, rc;
 	const size_t page_size = args->page_size;
 	const size_t buffer_size = page_size << 1;
+	bool misaligned_timing = false;
 
 	(void)stress_get_setting("misaligned-method", &misaligned_method);
+	(void)stress_get_setting("misaligned-timing", &misaligned_timing);
 
 	if (stress_sighandler(args->name, SIGBUS, stress_misaligned_handler, NULL) < 0)
 		return EXIT_NO_RESOURCE;
@@ -911,6 +1266,14 @@ static int stress_misaligned(const stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
+	if (misaligned_timing) {
+		rc = stress_misaligned_timing_run(args, buffer, page_size);
+		(void)stress_sighandler_default(SIGBUS);
+		(void)stress_sighandler_default(SIGILL);
+		(void)stress_sighandler_default(SIGSEGV);
+		goto tidy;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	current_method = misaligned_method;
@@ -941,6 +1304,7 @@ static int stress_misaligned(const stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+tidy:
 	(void)munmap((void *)buffer, buffer_size);
 
 	return rc;
@@ -948,6 +1312,7 @@ static int stress_misaligned(const stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_misaligned_method,	stress_set_misaligned_method },
+	{ OPT_misaligned_timing,	stress_set_misaligned_timing },
 	{ 0,			NULL }
 };
 
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-ipc-bench.h"
 
 #if defined(HAVE_MQUEUE_H)
 #include <mqueue.h>
@@ -27,6 +28,10 @@
 #include <poll.h>
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
 #define MIN_MQ_SIZE		(1)
 #define MAX_MQ_SIZE		(32)
 #define DEFAULT_MQ_SIZE		(10)
@@ -35,6 +40,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"mq N",		"start N workers passing messages using POSIX messages" },
 	{ NULL,	"mq-ops N",	"stop mq workers after N bogo messages" },
 	{ NULL,	"mq-size N",	"specify the size of the POSIX message queue" },
+	{ NULL,	"mq-sweep",	"report throughput and latency over sizes, depths, senders and receive methods" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -49,8 +55,14 @@ static int stress_set_mq_size(const char *opt)
 	return stress_set_setting("mq-size", TYPE_ID_INT, &mq_size);
 }
 
+static int stress_set_mq_sweep(const char *opt)
+{
+	return stress_set_setting_true("mq-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_mq_size,	stress_set_mq_size },
+	{ OPT_mq_sweep,	stress_set_mq_sweep },
 	{ 0,		NULL }
 };
 
@@ -96,6 +108,294 @@ static void stress_mq_invalid_open(
 	}
 }
 
+#define MQ_SWEEP_DURATION	(0.2)		/* seconds per measurement */
+#define MQ_SWEEP_DEPTH		(10)		/* default queue depth */
+#define MQ_SWEEP_MSG_SIZE	(64)		/* default message size */
+
+#define MQ_RECV_BLOCKING	(0)
+#define MQ_RECV_NOTIFY		(1)
+#define MQ_RECV_EPOLL		(2)
+
+/* sweep message queue, shared with the sender and receiver processes */
+typedef struct {
+	mqd_t mq;		/* blocking descriptor inherited by all */
+	char name[64];		/* queue name for non-blocking receivers */
+	int method;		/* MQ_RECV_* receive method */
+} stress_mq_sweep_t;
+
+/* per receiver process state */
+static mqd_t mq_sweep_rx = (mqd_t)-1;
+static bool mq_sweep_notify_registered;
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+static int mq_sweep_epfd = -1;
+#endif
+
+/*
+ *  stress_mq_sweep_child_init()
+ *	notify and epoll receivers open their own non-blocking
+ *	descriptor, the senders and blocking receivers use the
+ *	inherited blocking descriptor
+ */
+static int stress_mq_sweep_child_init(void *ctx, const bool receiver)
+{
+	stress_mq_sweep_t *sweep = (stress_mq_sweep_t *)ctx;
+
+	if (!receiver || (sweep->method == MQ_RECV_BLOCKING))
+		return 0;
+
+	mq_sweep_rx = mq_open(sweep->name, O_RDONLY | O_NONBLOCK);
+	if (mq_sweep_rx == (mqd_t)-1)
+		return -1;
+
+	if (sweep->method == MQ_RECV_NOTIFY) {
+		sigset_t set;
+
+		(void)sigemptyset(&set);
+		(void)sigaddset(&set, SIGUSR1);
+		return sigprocmask(SIG_BLOCK, &set, NULL);
+	}
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+	if (sweep->method == MQ_RECV_EPOLL) {
+		struct epoll_event ev;
+
+		mq_sweep_epfd = epoll_create1(0);
+		if (mq_sweep_epfd < 0)
+			return -1;
+		(void)memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = (int)mq_sweep_rx;
+		return epoll_ctl(mq_sweep_epfd, EPOLL_CTL_ADD, (int)mq_sweep_rx, &ev);
+	}
+#endif
+	return -1;
+}
+
+static int stress_mq_sweep_send(void *ctx, void *buf, const size_t len)
+{
+	const stress_mq_sweep_t *sweep = (const stress_mq_sweep_t *)ctx;
+
+	return mq_send(sweep->mq, (char *)buf, len, 0);
+}
+
+/*
+ *  stress_mq_sweep_recv()
+ *	receive a message, blocking in mq_receive or draining a non-blocking
+ *	descriptor and waiting for a mq_notify signal or epoll readiness
+ */
+static ssize_t stress_mq_sweep_recv(void *ctx, void *buf, const size_t len)
+{
+	const stress_mq_sweep_t *sweep = (const stress_mq_sweep_t *)ctx;
+
+	if (sweep->method == MQ_RECV_BLOCKING)
+		return mq_receive(sweep->mq, (char *)buf, len, NULL);
+
+	for (;;) {
+		const ssize_t ret = mq_receive(mq_sweep_rx, (char *)buf, len, NULL);
+
+		if ((ret >= 0) || (errno != EAGAIN))
+			return ret;
+
+		if (sweep->method == MQ_RECV_NOTIFY) {
+			/*
+			 *  Registering can race with a message arriving,
+			 *  so always retry the receive before waiting
+			 */
+			if (!mq_sweep_notify_registered) {
+				struct sigevent sev;
+
+				(void)memset(&sev, 0, sizeof(sev));
+				sev.sigev_notify = SIGEV_SIGNAL;
+				sev.sigev_signo = SIGUSR1;
+				if (mq_notify(mq_sweep_rx, &sev) < 0)
+					return -1;
+				mq_sweep_notify_registered = true;
+			} else {
+				sigset_t set;
+
+				(void)sigemptyset(&set);
+				(void)sigaddset(&set, SIGUSR1);
+				if (sigwaitinfo(&set, NULL) < 0)
+					return -1;
+				mq_sweep_notify_registered = false;
+			}
+		}
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+		if (sweep->method == MQ_RECV_EPOLL) {
+			struct epoll_event ev;
+
+			if (epoll_wait(mq_sweep_epfd, &ev, 1, -1) < 0)
+				return -1;
+		}
+#endif
+	}
+}
+
+static const stress_ipc_bench_ops_t mq_sweep_ops = {
+	0,
+	stress_mq_sweep_child_init,
+	stress_mq_sweep_send,
+	stress_mq_sweep_recv,
+};
+
+/*
+ *  stress_mq_sweep_measure()
+ *	create a queue of depth msg_size messages and measure it,
+ *	a queue the system limits do not allow is reported as "-"
+ */
+static int stress_mq_sweep_measure(
+	const stress_args_t *args,
+	const int method,
+	const size_t msg_size,
+	const long depth,
+	const uint32_t procs,
+	stress_ipc_bench_result_t *result)
+{
+	stress_mq_sweep_t sweep;
+	struct mq_attr attr;
+	int ret;
+
+	(void)memset(result, 0, sizeof(*result));
+	(void)memset(&sweep, 0, sizeof(sweep));
+	(void)snprintf(sweep.name, sizeof(sweep.name), "/%s-sweep-%" PRIdMAX "-%" PRIu32,
+		args->name, (intmax_t)args->pid, args->instance);
+	sweep.method = method;
+
+	attr.mq_flags = 0;
+	attr.mq_maxmsg = depth;
+	attr.mq_msgsize = (long)msg_size;
+	attr.mq_curmsgs = 0;
+	sweep.mq = mq_open(sweep.name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR, &attr);
+	if (sweep.mq == (mqd_t)-1) {
+		pr_dbg("%s: mq_open of %ld x %zu byte message queue failed, errno=%d (%s)\n",
+			args->name, depth, msg_size, errno, strerror(errno));
+		return 0;
+	}
+	ret = stress_ipc_bench_measure(args, &mq_sweep_ops, &sweep, msg_size,
+		procs, procs, MQ_SWEEP_DURATION, result);
+	(void)mq_close(sweep.mq);
+	(void)mq_unlink(sweep.name);
+
+	return ((ret < 0) && keep_stressing_flag()) ? -1 : 0;
+}
+
+/* results of one complete sweep pass */
+typedef struct {
+	stress_ipc_bench_result_t sizes[6];
+	stress_ipc_bench_result_t depths[4];
+	stress_ipc_bench_result_t procs[8];
+	stress_ipc_bench_result_t methods[3];
+} stress_mq_sweep_results_t;
+
+/*
+ *  stress_mq_sweep()
+ *	POSIX message queue throughput and send to receive latency over
+ *	message sizes, queue depths, sender/receiver pairs and blocking,
+ *	mq_notify and epoll receives
+ */
+static int stress_mq_sweep(const stress_args_t *args)
+{
+	static const size_t sizes[] = { 16, 64, 256, 1024, 4096, 8192 };
+	static const long depths[] = { 1, 4, 10, 64 };
+	static const char * const methods[] = { "blocking", "mq_notify", "epoll" };
+	stress_mq_sweep_results_t pass, res;
+	uint32_t procs[SIZEOF_ARRAY(pass.procs)], nprocs = 0, n;
+	const uint32_t procs_max = stress_ipc_bench_procs_max();
+	size_t i;
+	char label[32];
+	bool done = false;
+
+	for (n = 1; (n < procs_max) && (nprocs < SIZEOF_ARRAY(procs) - 1); n <<= 1)
+		procs[nprocs++] = n;
+	procs[nprocs++] = procs_max;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < SIZEOF_ARRAY(sizes); i++) {
+			if (stress_mq_sweep_measure(args, MQ_RECV_BLOCKING, sizes[i],
+						    MQ_SWEEP_DEPTH, 1, &pass.sizes[i]) < 0)
+				goto fail;
+		}
+		for (i = 0; i < SIZEOF_ARRAY(depths); i++) {
+			if (stress_mq_sweep_measure(args, MQ_RECV_BLOCKING, MQ_SWEEP_MSG_SIZE,
+						    depths[i], 1, &pass.depths[i]) < 0)
+				goto fail;
+		}
+		for (i = 0; i < nprocs; i++) {
+			if (stress_mq_sweep_measure(args, MQ_RECV_BLOCKING, MQ_SWEEP_MSG_SIZE,
+						    MQ_SWEEP_DEPTH, procs[i], &pass.procs[i]) < 0)
+				goto fail;
+		}
+		for (i = 0; i < SIZEOF_ARRAY(methods); i++) {
+#if !defined(HAVE_SYS_EPOLL_H) ||	\
+    !defined(HAVE_EPOLL_CREATE1)
+			if (i == MQ_RECV_EPOLL) {
+				(void)memset(&pass.methods[i], 0, sizeof(pass.methods[i]));
+				continue;
+			}
+#endif
+			if (stress_mq_sweep_measure(args, (int)i, MQ_SWEEP_MSG_SIZE,
+						    MQ_SWEEP_DEPTH, 1, &pass.methods[i]) < 0)
+				goto fail;
+		}
+		if (!keep_stressing_flag())
+			break;
+		res = pass;
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (!done) {
+		pr_inf("%s: message queue sweep did not complete a pass\n", args->name);
+		return EXIT_SUCCESS;
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: POSIX mq, 1 sender, 1 receiver, depth %d:\n", args->name, MQ_SWEEP_DEPTH);
+		stress_ipc_bench_header(args, "msg size");
+		for (i = 0; i < SIZEOF_ARRAY(sizes); i++) {
+			(void)snprintf(label, sizeof(label), "%zu B", sizes[i]);
+			stress_ipc_bench_line(args, label, &res.sizes[i]);
+		}
+		pr_inf("%s: POSIX mq, 1 sender, 1 receiver, %d byte messages:\n",
+			args->name, MQ_SWEEP_MSG_SIZE);
+		stress_ipc_bench_header(args, "queue depth");
+		for (i = 0; i < SIZEOF_ARRAY(depths); i++) {
+			(void)snprintf(label, sizeof(label), "%ld", depths[i]);
+			stress_ipc_bench_line(args, label, &res.depths[i]);
+		}
+		pr_inf("%s: POSIX mq, depth %d, %d byte messages:\n",
+			args->name, MQ_SWEEP_DEPTH, MQ_SWEEP_MSG_SIZE);
+		stress_ipc_bench_header(args, "senders:recvrs");
+		for (i = 0; i < nprocs; i++) {
+			(void)snprintf(label, sizeof(label), "%" PRIu32 ":%" PRIu32, procs[i], procs[i]);
+			stress_ipc_bench_line(args, label, &res.procs[i]);
+		}
+		pr_inf("%s: POSIX mq, 1 sender, 1 receiver, depth %d, %d byte messages:\n",
+			args->name, MQ_SWEEP_DEPTH, MQ_SWEEP_MSG_SIZE);
+		stress_ipc_bench_header(args, "receive");
+		for (i = 0; i < SIZEOF_ARRAY(methods); i++)
+			stress_ipc_bench_line(args, methods[i], &res.methods[i]);
+	}
+
+	stress_misc_stats_set(args->misc_stats, 0, "64 B msgs/sec", res.methods[MQ_RECV_BLOCKING].msgs_per_sec);
+	stress_misc_stats_set(args->misc_stats, 1, "64 B p50 latency (usec)", res.methods[MQ_RECV_BLOCKING].p50_us);
+	stress_misc_stats_set(args->misc_stats, 2, "64 B p99 latency (usec)", res.methods[MQ_RECV_BLOCKING].p99_us);
+	stress_misc_stats_set(args->misc_stats, 3, "4096 B MB/sec", res.sizes[4].mb_per_sec);
+	stress_misc_stats_set(args->misc_stats, 4, "mq_notify msgs/sec", res.methods[MQ_RECV_NOTIFY].msgs_per_sec);
+	stress_misc_stats_set(args->misc_stats, 5, "epoll msgs/sec", res.methods[MQ_RECV_EPOLL].msgs_per_sec);
+
+	return EXIT_SUCCESS;
+fail:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	return EXIT_FAILURE;
+}
+
 /*
  *  stress_mq
  *	stress POSIX message queues
@@ -112,6 +412,11 @@ static int stress_mq(const stress_args_t *args)
 	time_t time_start;
 	struct timespec abs_timeout;
 	unsigned int max_prio = UINT_MAX;
+	bool mq_sweep = false;
+
+	(void)stress_get_setting("mq-sweep", &mq_sweep);
+	if (mq_sweep)
+		return stress_mq_sweep(args);
 
 #if defined(SIGUSR2)
 	if (stress_sighandler(args->name, SIGUSR2, stress_sigusr2_handler, NULL) < 0)
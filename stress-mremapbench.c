@@ -0,0 +1,384 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+
+#define MIN_MREMAPBENCH_BYTES		(1 * MB)
+#define MAX_MREMAPBENCH_BYTES		(MAX_MEM_LIMIT)
+#define DEFAULT_MREMAPBENCH_BYTES	(64 * MB)
+
+#define MREMAPBENCH_START_BYTES		(64 * KB)	/* initial buffer size */
+#define MREMAPBENCH_PHASE		(0.25)		/* seconds per method */
+
+static const stress_help_t help[] = {
+	{ NULL,	"mremapbench N",	"start N workers measuring buffer growth by mremap vs copying" },
+	{ NULL,	"mremapbench-bytes N",	"grow a 64K buffer by doubling up to N bytes, default 64M" },
+	{ NULL,	"mremapbench-method M",	"one of all, mremap, copy or dontunmap" },
+	{ NULL,	"mremapbench-ops N",	"stop after N buffer growths" },
+	{ NULL,	NULL,			NULL }
+};
+
+#define MREMAPBENCH_MREMAP	(1)	/* mremap MREMAP_MAYMOVE */
+#define MREMAPBENCH_COPY	(2)	/* mmap new, memcpy, munmap old */
+#define MREMAPBENCH_DONTUNMAP	(3)	/* mmap new, mremap MREMAP_DONTUNMAP into it */
+
+static const char * const mremapbench_methods[] = {
+	"all",
+	"mremap",
+	"copy",
+	"dontunmap",
+};
+
+#define MREMAPBENCH_METHODS	(SIZEOF_ARRAY(mremapbench_methods))
+
+static int stress_set_mremapbench_bytes(const char *opt)
+{
+	size_t mremapbench_bytes;
+
+	mremapbench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("mremapbench-bytes", mremapbench_bytes,
+		MIN_MREMAPBENCH_BYTES, MAX_MREMAPBENCH_BYTES);
+	return stress_set_setting("mremapbench-bytes", TYPE_ID_SIZE_T, &mremapbench_bytes);
+}
+
+static int stress_set_mremapbench_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < MREMAPBENCH_METHODS; i++) {
+		if (!strcmp(opt, mremapbench_methods[i]))
+			return stress_set_setting("mremapbench-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "mremapbench-method must be one of:");
+	for (i = 0; i < MREMAPBENCH_METHODS; i++)
+		(void)fprintf(stderr, " %s", mremapbench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_mremapbench_bytes,	stress_set_mremapbench_bytes },
+	{ OPT_mremapbench_method,	stress_set_mremapbench_method },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_MREMAP) &&	\
+    defined(MREMAP_MAYMOVE) &&	\
+    NEED_GLIBC(2,4,0)
+
+#define MREMAPBENCH_PAGES	(2)	/* small pages, then THP */
+
+static const char * const mremapbench_pages[] = {
+	"4K",
+	"THP",
+};
+
+/* growth cost of one method and page size */
+typedef struct {
+	uint64_t sequences;		/* 64K to N byte growth sequences */
+	uint64_t growths;		/* resizes */
+	uint64_t in_place;		/* resizes that did not move */
+	uint64_t bytes;			/* final buffer bytes over all sequences */
+	uint64_t moved;			/* bytes of buffer carried over by resizes */
+	double resize_time;		/* time in the resize calls */
+	double total_time;		/* time of the sequences, including touching */
+} stress_mremapbench_stats_t;
+
+/*
+ *  stress_mremapbench_mmap()
+ *	map a private anonymous region, advised to use THP if asked
+ */
+static void *stress_mremapbench_mmap(const size_t sz, const bool thp)
+{
+	void *ptr;
+
+	ptr = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE)
+	if (thp)
+		VOID_RET(int, madvise(ptr, sz, MADV_HUGEPAGE));
+#else
+	(void)thp;
+#endif
+	return ptr;
+}
+
+/*
+ *  stress_mremapbench_touch()
+ *	fault in the grown tail of the buffer
+ */
+static inline void stress_mremapbench_touch(
+	uint8_t *buf,
+	const size_t start,
+	const size_t end,
+	const size_t page_size)
+{
+	size_t i;
+
+	for (i = start; i < end; i += page_size)
+		buf[i] = (uint8_t)i;
+}
+
+/*
+ *  stress_mremapbench_grow()
+ *	grow buf from old_sz to new_sz bytes, keeping its contents,
+ *	returns the new buffer or NULL on failure
+ */
+static uint8_t *stress_mremapbench_grow(
+	const size_t method,
+	uint8_t *buf,
+	const size_t old_sz,
+	const size_t new_sz,
+	const bool thp)
+{
+	uint8_t *new_buf;
+
+	switch (method) {
+	case MREMAPBENCH_MREMAP:
+		new_buf = (uint8_t *)mremap((void *)buf, old_sz, new_sz, MREMAP_MAYMOVE);
+		if (new_buf == MAP_FAILED)
+			return NULL;
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE)
+		if (thp)
+			VOID_RET(int, madvise((void *)new_buf, new_sz, MADV_HUGEPAGE));
+#endif
+		return new_buf;
+	case MREMAPBENCH_COPY:
+		new_buf = (uint8_t *)stress_mremapbench_mmap(new_sz, thp);
+		if (!new_buf)
+			return NULL;
+		(void)memcpy((void *)new_buf, (void *)buf, old_sz);
+		(void)munmap((void *)buf, old_sz);
+		return new_buf;
+#if defined(MREMAP_DONTUNMAP) &&	\
+    defined(MREMAP_FIXED)
+	case MREMAPBENCH_DONTUNMAP:
+		{
+			void *ptr;
+
+			/*
+			 *  move the page tables into the start of a new larger
+			 *  mapping, the old range is left mapped but empty
+			 */
+			new_buf = (uint8_t *)stress_mremapbench_mmap(new_sz, thp);
+			if (!new_buf)
+				return NULL;
+			ptr = mremap((void *)buf, old_sz, old_sz,
+				MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP,
+				(void *)new_buf);
+			if (ptr == MAP_FAILED) {
+				(void)munmap((void *)new_buf, new_sz);
+				return NULL;
+			}
+			(void)munmap((void *)buf, old_sz);
+			return new_buf;
+		}
+#endif
+	default:
+		(void)thp;
+		errno = ENOSYS;
+		return NULL;
+	}
+}
+
+/*
+ *  stress_mremapbench_sequence()
+ *	grow a buffer geometrically from 64K to max_bytes, checking
+ *	the contents survive each resize
+ */
+static int stress_mremapbench_sequence(
+	const stress_args_t *args,
+	const size_t method,
+	const bool thp,
+	const size_t max_bytes,
+	stress_mremapbench_stats_t *stats)
+{
+	const size_t page_size = args->page_size;
+	uint8_t *buf;
+	size_t sz = MREMAPBENCH_START_BYTES;
+	double t_start;
+
+	t_start = stress_time_now();
+	buf = (uint8_t *)stress_mremapbench_mmap(sz, thp);
+	if (!buf)
+		return -1;
+	stress_mremapbench_touch(buf, 0, sz, page_size);
+
+	while (sz < max_bytes) {
+		const size_t new_sz = STRESS_MINIMUM(sz * 2, max_bytes);
+		const uint8_t check = buf[sz - page_size];
+		uint8_t *new_buf;
+		double t1, t2;
+
+		t1 = stress_time_now();
+		new_buf = stress_mremapbench_grow(method, buf, sz, new_sz, thp);
+		t2 = stress_time_now();
+		if (!new_buf) {
+			(void)munmap((void *)buf, sz);
+			return -1;
+		}
+		if (new_buf[sz - page_size] != check) {
+			pr_fail("%s: %s resize from %zu to %zu bytes lost the buffer contents\n",
+				args->name, mremapbench_methods[method], sz, new_sz);
+			(void)munmap((void *)new_buf, new_sz);
+			errno = 0;
+			return -2;
+		}
+		stress_mremapbench_touch(new_buf, sz, new_sz, page_size);
+
+		stats->resize_time += t2 - t1;
+		stats->moved += sz;
+		stats->growths++;
+		if (new_buf == buf)
+			stats->in_place++;
+		buf = new_buf;
+		sz = new_sz;
+		inc_counter(args);
+		if (!keep_stressing(args))
+			break;
+	}
+	(void)munmap((void *)buf, sz);
+
+	stats->total_time += stress_time_now() - t_start;
+	stats->bytes += sz;
+	stats->sequences++;
+	return 0;
+}
+
+/*
+ *  stress_mremapbench()
+ *	compare the cost of growing a buffer by mremap, by copying
+ *	into a new mapping and by moving its page tables into a new
+ *	mapping with MREMAP_DONTUNMAP, on small pages and THP
+ */
+static int stress_mremapbench(const stress_args_t *args)
+{
+	static stress_mremapbench_stats_t stats[MREMAPBENCH_METHODS][MREMAPBENCH_PAGES];
+	size_t mremapbench_bytes = DEFAULT_MREMAPBENCH_BYTES;
+	size_t mremapbench_method = 0, m, p, idx = 0;
+	bool skipped[MREMAPBENCH_METHODS];
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("mremapbench-method", &mremapbench_method);
+	if (!stress_get_setting("mremapbench-bytes", &mremapbench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			mremapbench_bytes = MAX_32;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			mremapbench_bytes = MIN_MREMAPBENCH_BYTES;
+	}
+	mremapbench_bytes /= args->num_instances;
+	if (mremapbench_bytes < MIN_MREMAPBENCH_BYTES)
+		mremapbench_bytes = MIN_MREMAPBENCH_BYTES;
+	mremapbench_bytes &= ~(args->page_size - 1);
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(skipped, 0, sizeof(skipped));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 1; (m < MREMAPBENCH_METHODS) && keep_stressing(args); m++) {
+			if ((mremapbench_method && (mremapbench_method != m)) || skipped[m])
+				continue;
+			for (p = 0; (p < MREMAPBENCH_PAGES) && keep_stressing(args); p++) {
+				const double t_end = stress_time_now() + MREMAPBENCH_PHASE;
+
+				do {
+					const int ret = stress_mremapbench_sequence(args, m,
+						p > 0, mremapbench_bytes, &stats[m][p]);
+
+					if (ret == -2) {
+						rc = EXIT_FAILURE;
+						goto report;
+					}
+					if (ret < 0) {
+						if ((errno == ENOMEM) || (errno == EAGAIN))
+							break;
+						if (args->instance == 0)
+							pr_inf("%s: %s skipped, errno=%d (%s)\n",
+								args->name, mremapbench_methods[m],
+								errno, strerror(errno));
+						skipped[m] = true;
+						break;
+					}
+				} while (keep_stressing(args) && (stress_time_now() < t_end));
+				if (skipped[m])
+					break;
+			}
+		}
+	} while (keep_stressing(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: growing 64K to %zuK by doubling\n",
+			args->name, (size_t)(mremapbench_bytes / KB));
+	if (args->instance == 0)
+		pr_inf("%s: %-10s %5s %10s %14s %12s %9s\n", args->name,
+			"method", "pages", "GB/sec", "resize ns/4K", "resizes/sec",
+			"in place");
+	for (m = 1; m < MREMAPBENCH_METHODS; m++) {
+		for (p = 0; p < MREMAPBENCH_PAGES; p++) {
+			const stress_mremapbench_stats_t *st = &stats[m][p];
+			double rate, ns_per_page, resize_rate, in_place;
+
+			if (!st->sequences || (st->total_time <= 0.0) || (st->resize_time <= 0.0))
+				continue;
+			/* final buffer bytes produced per second of growing */
+			rate = (double)st->bytes / (st->total_time * (double)GB);
+			ns_per_page = (double)STRESS_NANOSECOND * st->resize_time /
+				((double)st->moved / 4096.0);
+			resize_rate = (double)st->growths / st->resize_time;
+			in_place = 100.0 * (double)st->in_place / (double)st->growths;
+			if (args->instance == 0)
+				pr_inf("%s: %-10s %5s %10.2f %14.2f %12.0f %8.1f%%\n",
+					args->name, mremapbench_methods[m],
+					mremapbench_pages[p], rate, ns_per_page,
+					resize_rate, in_place);
+			if (idx < STRESS_MISC_STATS_MAX) {
+				char desc[32];
+
+				(void)snprintf(desc, sizeof(desc), "%s %s grow GB/sec",
+					mremapbench_methods[m], mremapbench_pages[p]);
+				stress_misc_stats_set(args->misc_stats, idx++, desc, rate);
+			}
+		}
+	}
+
+	return rc;
+}
+
+stressor_info_t stress_mremapbench_info = {
+	.stressor = stress_mremapbench,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_mremapbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-ipc-bench.h"
 
 #if defined(HAVE_SYS_IPC_H)
 #include <sys/ipc.h>
@@ -33,6 +34,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"msg N",	"start N workers stressing System V messages" },
 	{ NULL,	"msg-ops N",	"stop msg workers after N bogo messages" },
 	{ NULL, "msg-types N",	"enable N different message types" },
+	{ NULL,	"msg-sweep",	"report throughput and latency over sizes, depths and senders" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -44,8 +46,14 @@ static int stress_set_msg_types(const char *opt) {
 	return stress_set_setting("msg-types", TYPE_ID_INT32, &msg_types);
 }
 
+static int stress_set_msg_sweep(const char *opt)
+{
+	return stress_set_setting_true("msg-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_msg_types,	stress_set_msg_types },
+	{ OPT_msg_sweep,	stress_set_msg_sweep },
 	{ 0,                    NULL },
 };
 
@@ -219,6 +227,187 @@ static inline size_t stress_max_ids(const stress_args_t *args)
 	return max_ids;
 }
 
+#define MSG_SWEEP_DURATION	(0.2)		/* seconds per measurement */
+#define MSG_SWEEP_MSG_SIZE	(64)		/* default message size */
+
+/* System V message with the largest sweep payload */
+typedef struct {
+	long mtype;
+	uint8_t mtext[8192];
+} stress_msg_sweep_msg_t;
+
+static int stress_msg_sweep_send(void *ctx, void *buf, const size_t len)
+{
+	const int msgq_id = *(int *)ctx;
+
+	((stress_msg_sweep_msg_t *)buf)->mtype = 1;
+	return msgsnd(msgq_id, buf, len, 0);
+}
+
+static ssize_t stress_msg_sweep_recv(void *ctx, void *buf, const size_t len)
+{
+	const int msgq_id = *(int *)ctx;
+
+	return msgrcv(msgq_id, buf, len, 0, 0);
+}
+
+static const stress_ipc_bench_ops_t msg_sweep_ops = {
+	offsetof(stress_msg_sweep_msg_t, mtext),
+	NULL,
+	stress_msg_sweep_send,
+	stress_msg_sweep_recv,
+};
+
+/*
+ *  stress_msg_sweep_measure()
+ *	create a queue of qbytes bytes (0 for the system default) and
+ *	measure it, a queue the system limits do not allow is reported as "-"
+ */
+static int stress_msg_sweep_measure(
+	const stress_args_t *args,
+	const size_t msg_size,
+	const size_t qbytes,
+	const uint32_t procs,
+	stress_ipc_bench_result_t *result)
+{
+	int msgq_id, ret;
+
+	(void)memset(result, 0, sizeof(*result));
+
+	msgq_id = msgget(IPC_PRIVATE, S_IRUSR | S_IWUSR | IPC_CREAT | IPC_EXCL);
+	if (msgq_id < 0) {
+		pr_dbg("%s: msgget failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return 0;
+	}
+	if (qbytes) {
+		struct msqid_ds buf;
+
+		if (msgctl(msgq_id, IPC_STAT, &buf) < 0)
+			goto no_qbytes;
+		buf.msg_qbytes = (msglen_t)qbytes;
+		if (msgctl(msgq_id, IPC_SET, &buf) < 0)
+			goto no_qbytes;
+	}
+	ret = stress_ipc_bench_measure(args, &msg_sweep_ops, &msgq_id, msg_size,
+		procs, procs, MSG_SWEEP_DURATION, result);
+	(void)msgctl(msgq_id, IPC_RMID, NULL);
+
+	return ((ret < 0) && keep_stressing_flag()) ? -1 : 0;
+
+no_qbytes:
+	pr_dbg("%s: cannot set message queue to %zu bytes, errno=%d (%s)\n",
+		args->name, qbytes, errno, strerror(errno));
+	(void)msgctl(msgq_id, IPC_RMID, NULL);
+	return 0;
+}
+
+/* results of one complete sweep pass */
+typedef struct {
+	stress_ipc_bench_result_t sizes[6];
+	stress_ipc_bench_result_t depths[4];
+	stress_ipc_bench_result_t procs[8];
+} stress_msg_sweep_results_t;
+
+/*
+ *  stress_msg_sweep()
+ *	System V message queue throughput and send to receive latency
+ *	over message sizes, queue depths and sender/receiver pairs
+ */
+static int stress_msg_sweep(const stress_args_t *args)
+{
+	static const size_t sizes[] = { 16, 64, 256, 1024, 4096, 8192 };
+	static const size_t depths[] = { 1, 4, 16, 64 };
+	stress_msg_sweep_results_t pass, res;
+	uint32_t procs[SIZEOF_ARRAY(pass.procs)], nprocs = 0, n;
+	const uint32_t procs_max = stress_ipc_bench_procs_max();
+	size_t i, msgmax = sizeof(((stress_msg_sweep_msg_t *)NULL)->mtext);
+	char label[32], buf[32];
+	bool done = false;
+
+	/* messages larger than kernel.msgmax cannot be sent */
+	if (system_read("/proc/sys/kernel/msgmax", buf, sizeof(buf) - 1) > 0) {
+		unsigned long val;
+
+		buf[sizeof(buf) - 1] = '\0';
+		if ((sscanf(buf, "%lu", &val) == 1) && (val < msgmax))
+			msgmax = (size_t)val;
+	}
+
+	for (n = 1; (n < procs_max) && (nprocs < SIZEOF_ARRAY(procs) - 1); n <<= 1)
+		procs[nprocs++] = n;
+	procs[nprocs++] = procs_max;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < SIZEOF_ARRAY(sizes); i++) {
+			if (sizes[i] > msgmax) {
+				(void)memset(&pass.sizes[i], 0, sizeof(pass.sizes[i]));
+				continue;
+			}
+			if (stress_msg_sweep_measure(args, sizes[i], 0, 1, &pass.sizes[i]) < 0)
+				goto fail;
+		}
+		for (i = 0; i < SIZEOF_ARRAY(depths); i++) {
+			if (stress_msg_sweep_measure(args, MSG_SWEEP_MSG_SIZE,
+						     depths[i] * MSG_SWEEP_MSG_SIZE, 1, &pass.depths[i]) < 0)
+				goto fail;
+		}
+		for (i = 0; i < nprocs; i++) {
+			if (stress_msg_sweep_measure(args, MSG_SWEEP_MSG_SIZE, 0,
+						     procs[i], &pass.procs[i]) < 0)
+				goto fail;
+		}
+		if (!keep_stressing_flag())
+			break;
+		res = pass;
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (!done) {
+		pr_inf("%s: message queue sweep did not complete a pass\n", args->name);
+		return EXIT_SUCCESS;
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: System V msg, 1 sender, 1 receiver, default queue bytes:\n", args->name);
+		stress_ipc_bench_header(args, "msg size");
+		for (i = 0; i < SIZEOF_ARRAY(sizes); i++) {
+			(void)snprintf(label, sizeof(label), "%zu B", sizes[i]);
+			stress_ipc_bench_line(args, label, &res.sizes[i]);
+		}
+		pr_inf("%s: System V msg, 1 sender, 1 receiver, %d byte messages:\n",
+			args->name, MSG_SWEEP_MSG_SIZE);
+		stress_ipc_bench_header(args, "queue depth");
+		for (i = 0; i < SIZEOF_ARRAY(depths); i++) {
+			(void)snprintf(label, sizeof(label), "%zu", depths[i]);
+			stress_ipc_bench_line(args, label, &res.depths[i]);
+		}
+		pr_inf("%s: System V msg, default queue bytes, %d byte messages:\n",
+			args->name, MSG_SWEEP_MSG_SIZE);
+		stress_ipc_bench_header(args, "senders:recvrs");
+		for (i = 0; i < nprocs; i++) {
+			(void)snprintf(label, sizeof(label), "%" PRIu32 ":%" PRIu32, procs[i], procs[i]);
+			stress_ipc_bench_line(args, label, &res.procs[i]);
+		}
+	}
+
+	stress_misc_stats_set(args->misc_stats, 0, "64 B msgs/sec", res.sizes[1].msgs_per_sec);
+	stress_misc_stats_set(args->misc_stats, 1, "64 B p50 latency (usec)", res.sizes[1].p50_us);
+	stress_misc_stats_set(args->misc_stats, 2, "64 B p99 latency (usec)", res.sizes[1].p99_us);
+	stress_misc_stats_set(args->misc_stats, 3, "4096 B MB/sec", res.sizes[4].mb_per_sec);
+	stress_misc_stats_set(args->misc_stats, 4, "max pairs msgs/sec", res.procs[nprocs - 1].msgs_per_sec);
+
+	return EXIT_SUCCESS;
+fail:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	return EXIT_FAILURE;
+}
+
 /*
  *  stress_msg
  *	stress by message queues
@@ -234,6 +423,11 @@ static int stress_msg(const stress_args_t *args)
 	const size_t max_ids = stress_max_ids(args);
 	int *msgq_ids;
 	size_t j, n;
+	bool msg_sweep = false;
+
+	(void)stress_get_setting("msg-sweep", &msg_sweep);
+	if (msg_sweep)
+		return stress_msg_sweep(args);
 
 	(void)stress_get_setting("msg-types", &msg_types);
 
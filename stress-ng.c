@@ -18,15 +18,45 @@
  *
  */
 #include "stress-ng.h"
+#include "core-clock.h"
+#include "core-freq-stats.h"
 #include "core-ftrace.h"
+#include "core-harness.h"
 #include "core-hash.h"
+#include "core-latency.h"
+#include "core-method-stats.h"
+#include "core-mem-backing.h"
+#include "core-numa.h"
+#include "core-metrics.h"
+#include "core-fleet.h"
+#include "core-openmetrics.h"
+#include "core-cgroup.h"
+#include "core-compare.h"
+#include "core-cpuidle.h"
+#include "core-repeat.h"
+#include "core-results.h"
+#include "core-scale-sweep.h"
+#include "core-schedstat.h"
+#include "core-target.h"
 #include "core-perf.h"
+#include "core-placement.h"
+#include "core-psi.h"
 #include "core-put.h"
+#include "core-rapl.h"
+#include "core-resctrl.h"
 #include "core-smart.h"
 #include "core-stressors.h"
+#include "core-syscall-stats.h"
 #include "core-syslog.h"
 #include "core-thermal-zone.h"
 #include "core-thrash.h"
+#include "core-verify.h"
+#include "core-window.h"
+#include "core-wss.h"
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
 
 #if defined(HAVE_SYS_UTSNAME_H)
 #include <sys/utsname.h>
@@ -56,6 +86,7 @@ stress_stressor_t *g_stressor_current;
 /* Various option settings and flags */
 static volatile bool wait_flag = true;		/* false = exit run wait loop */
 static int terminate_signum;			/* signal sent to process */
+static int sync_start_fds[2] = { -1, -1 };	/* --sync-start barrier pipe */
 static pid_t main_pid;				/* stress-ng main pid */
 
 /* Globals */
@@ -78,8 +109,11 @@ static const stress_opt_flag_t opt_flags[] = {
 	{ OPT_abort,		OPT_FLAGS_ABORT },
 	{ OPT_aggressive,	OPT_FLAGS_AGGRESSIVE_MASK },
 	{ OPT_cpu_online_all,	OPT_FLAGS_CPU_ONLINE_ALL },
+	{ OPT_cpuidle,		OPT_FLAGS_CPUIDLE },
 	{ OPT_dry_run,		OPT_FLAGS_DRY_RUN },
+	{ OPT_freq_stats,	OPT_FLAGS_FREQ_STATS },
 	{ OPT_ftrace,		OPT_FLAGS_FTRACE },
+	{ OPT_harness_overhead,	OPT_FLAGS_HARNESS_OVERHEAD },
 	{ OPT_ignite_cpu,	OPT_FLAGS_IGNITE_CPU },
 	{ OPT_keep_files, 	OPT_FLAGS_KEEP_FILES },
 	{ OPT_keep_name, 	OPT_FLAGS_KEEP_NAME },
@@ -97,11 +131,18 @@ static const stress_opt_flag_t opt_flags[] = {
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ OPT_perf_stats,	OPT_FLAGS_PERF_STATS },
+	{ OPT_perf_uncore,	OPT_FLAGS_PERF_STATS | OPT_FLAGS_PERF_UNCORE },
 #endif
+	{ OPT_psi,		OPT_FLAGS_PSI },
+	{ OPT_psi_cgroup,	OPT_FLAGS_PSI | OPT_FLAGS_PSI_CGROUP },
+	{ OPT_rapl,		OPT_FLAGS_RAPL },
+	{ OPT_schedstat,	OPT_FLAGS_SCHEDSTAT },
 	{ OPT_skip_silent,	OPT_FLAGS_SKIP_SILENT },
 	{ OPT_smart,		OPT_FLAGS_SMART },
 	{ OPT_sock_nodelay,	OPT_FLAGS_SOCKET_NODELAY },
 	{ OPT_stdout,		OPT_FLAGS_STDOUT },
+	{ OPT_sync_start,	OPT_FLAGS_SYNC_START },
+	{ OPT_syscall_stats,	OPT_FLAGS_SYSCALL_STATS },
 #if defined(HAVE_SYSLOG_H)
 	{ OPT_syslog,		OPT_FLAGS_SYSLOG },
 #endif
@@ -111,6 +152,8 @@ static const stress_opt_flag_t opt_flags[] = {
 	{ OPT_thermal_zones,	OPT_FLAGS_THERMAL_ZONES },
 	{ OPT_verbose,		PR_ALL },
 	{ OPT_verify,		OPT_FLAGS_VERIFY | PR_FAIL },
+	{ OPT_waves,		OPT_FLAGS_WAVES },
+	{ OPT_worker_pool,	OPT_FLAGS_WORKER_POOL },
 };
 
 /*
@@ -245,8 +288,11 @@ static const struct option long_options[] = {
 	{ "aio-ops",		1,	0,	OPT_aio_ops },
 	{ "aio-requests",	1,	0,	OPT_aio_requests },
 	{ "aiol",		1,	0,	OPT_aiol},
+	{ "aiol-batch",		1,	0,	OPT_aiol_batch },
+	{ "aiol-eventfd",	0,	0,	OPT_aiol_eventfd },
 	{ "aiol-ops",		1,	0,	OPT_aiol_ops },
 	{ "aiol-requests",	1,	0,	OPT_aiol_requests },
+	{ "aiol-steady",	0,	0,	OPT_aiol_steady },
 	{ "alarm",		1,	0,	OPT_alarm },
 	{ "alarm-ops",		1,	0,	OPT_alarm_ops },
 	{ "all",		1,	0,	OPT_all },
@@ -262,21 +308,27 @@ static const struct option long_options[] = {
 	{ "bigheap",		1,	0,	OPT_bigheap },
 	{ "bigheap-ops",	1,	0,	OPT_bigheap_ops },
 	{ "bigheap-growth",	1,	0,	OPT_bigheap_growth },
+	{ "bigheap-bytes",	1,	0,	OPT_bigheap_bytes },
+	{ "bigheap-bench",	0,	0,	OPT_bigheap_bench },
 	{ "bind-mount",		1,	0,	OPT_bind_mount },
 	{ "bind-mount-ops",	1,	0,	OPT_bind_mount_ops },
 	{ "binderfs",		1,	0,	OPT_binderfs },
 	{ "binderfs-opts",	1,	0,	OPT_binderfs_ops },
 	{ "branch",		1,	0,	OPT_branch },
 	{ "branch-ops",		1,	0,	OPT_branch_ops },
+	{ "branch-sweep",	0,	0,	OPT_branch_sweep },
 	{ "brk",		1,	0,	OPT_brk },
 	{ "brk-ops",		1,	0,	OPT_brk_ops },
 	{ "brk-mlock",		0,	0,	OPT_brk_mlock },
 	{ "brk-notouch",	0,	0,	OPT_brk_notouch },
 	{ "bsearch",		1,	0,	OPT_bsearch },
+	{ "bsearch-method",	1,	0,	OPT_bsearch_method },
 	{ "bsearch-ops",	1,	0,	OPT_bsearch_ops },
 	{ "bsearch-size",	1,	0,	OPT_bsearch_size },
+	{ "bsearch-sweep",	0,	0,	OPT_bsearch_sweep },
 	{ "cache",		1,	0, 	OPT_cache },
 	{ "cache-ops",		1,	0,	OPT_cache_ops },
+	{ "cache-buffer",	1,	0,	OPT_cache_buffer },
 	{ "cache-cldemote",	0,	0,	OPT_cache_cldemote },
 	{ "cache-clflushopt",	0,	0,	OPT_cache_clflushopt },
 	{ "cache-clwb",		0,	0,	OPT_cache_clwb },
@@ -291,9 +343,18 @@ static const struct option long_options[] = {
 	{ "cacheline",		1,	0, 	OPT_cacheline },
 	{ "cacheline-ops",	1,	0,	OPT_cacheline_ops },
 	{ "cacheline-affinity",	0,	0,	OPT_cacheline_affinity },
+	{ "cacheline-matrix",	0,	0,	OPT_cacheline_matrix },
+	{ "cacheline-matrix-csv",1,	0,	OPT_cacheline_matrix_csv },
 	{ "cacheline-method",	1,	0,	OPT_cacheline_method },
 	{ "cap",		1,	0, 	OPT_cap },
 	{ "cap-ops",		1,	0, 	OPT_cap_ops },
+	{ "cgroup",		1,	0,	OPT_cgroup },
+	{ "cgroup-cpu-max",	1,	0,	OPT_cgroup_cpu_max },
+	{ "cgroup-cpuset-cpus",	1,	0,	OPT_cgroup_cpuset_cpus },
+	{ "cgroup-cpuset-mems",	1,	0,	OPT_cgroup_cpuset_mems },
+	{ "cgroup-io-max",	1,	0,	OPT_cgroup_io_max },
+	{ "cgroup-memory-high",	1,	0,	OPT_cgroup_memory_high },
+	{ "cgroup-memory-max",	1,	0,	OPT_cgroup_memory_max },
 	{ "chattr",		1,	0, 	OPT_chattr },
 	{ "chattr-ops",		1,	0,	OPT_chattr_ops },
 	{ "chdir",		1,	0, 	OPT_chdir },
@@ -313,11 +374,30 @@ static const struct option long_options[] = {
 	{ "clone-max",		1,	0,	OPT_clone_max },
 	{ "close",		1,	0,	OPT_close },
 	{ "close-ops",		1,	0,	OPT_close_ops },
+	{ "compactbench",	1,	0,	OPT_compactbench },
+	{ "compactbench-ops",	1,	0,	OPT_compactbench_ops },
+	{ "compactbench-bytes",	1,	0,	OPT_compactbench_bytes },
+	{ "compactbench-mode",	1,	0,	OPT_compactbench_mode },
+	{ "compare",		1,	0,	OPT_compare },
+	{ "compare-threshold",	1,	0,	OPT_compare_threshold },
+	{ "csv",		1,	0,	OPT_csv },
+	{ "connchurn",		1,	0,	OPT_connchurn },
+	{ "connchurn-ops",	1,	0,	OPT_connchurn_ops },
+	{ "connchurn-domain",	1,	0,	OPT_connchurn_domain },
+	{ "connchurn-fastopen",	0,	0,	OPT_connchurn_fastopen },
+	{ "connchurn-linger",	0,	0,	OPT_connchurn_linger },
+	{ "connchurn-port",	1,	0,	OPT_connchurn_port },
+	{ "connchurn-reuseaddr",0,	0,	OPT_connchurn_reuseaddr },
+	{ "connchurn-threads",	1,	0,	OPT_connchurn_threads },
 	{ "context",		1,	0,	OPT_context },
 	{ "context-ops",	1,	0,	OPT_context_ops },
+	{ "context-sweep",	0,	0,	OPT_context_sweep },
+	{ "cooldown",		1,	0,	OPT_cooldown },
 	{ "copy-file",		1,	0,	OPT_copy_file },
 	{ "copy-file-ops",	1,	0,	OPT_copy_file_ops },
+	{ "copy-file-bench",	0,	0,	OPT_copy_file_bench },
 	{ "copy-file-bytes",	1,	0,	OPT_copy_file_bytes },
+	{ "copy-file-dest",	1,	0,	OPT_copy_file_dest },
 	{ "cpu",		1,	0,	OPT_cpu },
 	{ "cpu-ops",		1,	0,	OPT_cpu_ops },
 	{ "cpu-load",		1,	0,	OPT_cpu_load },
@@ -326,12 +406,18 @@ static const struct option long_options[] = {
 	{ "cpu-online",		1,	0,	OPT_cpu_online },
 	{ "cpu-online-ops",	1,	0,	OPT_cpu_online_ops },
 	{ "cpu-online-all",	0,	0,	OPT_cpu_online_all },
+	{ "cpuidle",		0,	0,	OPT_cpuidle },
 	{ "crypt",		1,	0,	OPT_crypt },
 	{ "crypt-ops",		1,	0,	OPT_crypt_ops },
+	{ "cryptbench",		1,	0,	OPT_cryptbench },
+	{ "cryptbench-method",	1,	0,	OPT_cryptbench_method },
+	{ "cryptbench-ops",	1,	0,	OPT_cryptbench_ops },
+	{ "cryptbench-size",	1,	0,	OPT_cryptbench_size },
 	{ "cyclic",		1,	0,	OPT_cyclic },
 	{ "cyclic-dist",	1,	0,	OPT_cyclic_dist },
 	{ "cyclic-method",	1,	0,	OPT_cyclic_method },
 	{ "cyclic-ops",		1,	0,	OPT_cyclic_ops },
+	{ "cyclic-pin",		0,	0,	OPT_cyclic_pin },
 	{ "cyclic-policy",	1,	0,	OPT_cyclic_policy },
 	{ "cyclic-prio",	1,	0,	OPT_cyclic_prio },
 	{ "cyclic-sleep",	1,	0,	OPT_cyclic_sleep },
@@ -371,8 +457,12 @@ static const struct option long_options[] = {
 	{ "dnotify-ops",	1,	0,	OPT_dnotify_ops },
 	{ "dup",		1,	0,	OPT_dup },
 	{ "dup-ops",		1,	0,	OPT_dup_ops },
+	{ "dup-fds",		1,	0,	OPT_dup_fds },
+	{ "dup-scm",		0,	0,	OPT_dup_scm },
+	{ "dup-threads",	1,	0,	OPT_dup_threads },
 	{ "dynlib",		1,	0,	OPT_dynlib },
 	{ "dynlib-ops",		1,	0,	OPT_dynlib_ops },
+	{ "dynlib-bench",	0,	0,	OPT_dynlib_bench },
 	{ "efivar",		1,	0,	OPT_efivar },
 	{ "efivar-ops",		1,	0,	OPT_efivar_ops },
 	{ "enosys",		1,	0,	OPT_enosys },
@@ -381,9 +471,13 @@ static const struct option long_options[] = {
 	{ "env-ops",		1,	0,	OPT_env_ops },
 	{ "epoll",		1,	0,	OPT_epoll },
 	{ "epoll-ops",		1,	0,	OPT_epoll_ops },
+	{ "epoll-clients",	1,	0,	OPT_epoll_clients },
 	{ "epoll-domain",	1,	0,	OPT_epoll_domain },
+	{ "epoll-mt",		1,	0,	OPT_epoll_mt },
+	{ "epoll-placement",1,	0,	OPT_epoll_placement },
 	{ "epoll-port",		1,	0,	OPT_epoll_port },
 	{ "epoll-sockets",	1,	0,	OPT_epoll_sockets },
+	{ "epoll-threads",	1,	0,	OPT_epoll_threads },
 	{ "eventfd",		1,	0,	OPT_eventfd },
 	{ "eventfd-ops",	1,	0,	OPT_eventfd_ops },
 	{ "eventfd-nonblock",	0,	0,	OPT_eventfd_nonblock },
@@ -394,6 +488,7 @@ static const struct option long_options[] = {
 	{ "exec-method",	1,	0,	OPT_exec_method },
 	{ "exec-fork-method",	1,	0,	OPT_exec_fork_method },
 	{ "exec-no-pthread",	0,	0,	OPT_exec_no_pthread },
+	{ "exec-startup",	0,	0,	OPT_exec_startup },
 	{ "exit-group",		1,	0,	OPT_exit_group },
 	{ "exit-group-ops",	1,	0,	OPT_exit_group_ops },
 	{ "fallocate",		1,	0,	OPT_fallocate },
@@ -401,19 +496,37 @@ static const struct option long_options[] = {
 	{ "fallocate-bytes",	1,	0,	OPT_fallocate_bytes },
 	{ "fault",		1,	0,	OPT_fault },
 	{ "fault-ops",		1,	0,	OPT_fault_ops },
+	{ "faultbench",		1,	0,	OPT_faultbench },
+	{ "faultbench-ops",	1,	0,	OPT_faultbench_ops },
+	{ "faultbench-bytes",	1,	0,	OPT_faultbench_bytes },
+	{ "faultbench-method",	1,	0,	OPT_faultbench_method },
+	{ "faultbench-threads",	1,	0,	OPT_faultbench_threads },
 	{ "fcntl",		1,	0,	OPT_fcntl},
 	{ "fcntl-ops",		1,	0,	OPT_fcntl_ops },
 	{ "fiemap",		1,	0,	OPT_fiemap },
 	{ "fiemap-ops",		1,	0,	OPT_fiemap_ops },
+	{ "fiemap-bench",	0,	0,	OPT_fiemap_bench },
 	{ "fiemap-bytes",	1,	0,	OPT_fiemap_bytes },
 	{ "fifo",		1,	0,	OPT_fifo },
 	{ "fifo-ops",		1,	0,	OPT_fifo_ops },
 	{ "fifo-readers",	1,	0,	OPT_fifo_readers },
 	{ "file-ioctl",		1,	0,	OPT_file_ioctl },
 	{ "file-ioctl-ops",	1,	0,	OPT_file_ioctl_ops },
+	{ "filelockbench",	1,	0,	OPT_filelockbench },
+	{ "filelockbench-ops",	1,	0,	OPT_filelockbench_ops },
+	{ "filelockbench-method",1,	0,	OPT_filelockbench_method },
+	{ "filelockbench-overlap",1,	0,	OPT_filelockbench_overlap },
+	{ "filelockbench-procs",1,	0,	OPT_filelockbench_procs },
 	{ "filename",		1,	0,	OPT_filename },
 	{ "filename-ops",	1,	0,	OPT_filename_ops },
 	{ "filename-opts",	1,	0,	OPT_filename_opts },
+	{ "fleet",		1,	0,	OPT_fleet },
+	{ "fleet-agent",	1,	0,	OPT_fleet_agent },
+	{ "fleet-delay",	1,	0,	OPT_fleet_delay },
+	{ "fleet-outlier",	1,	0,	OPT_fleet_outlier },
+	{ "fleet-report-fd",	1,	0,	OPT_fleet_report_fd },
+	{ "fleet-secret",	1,	0,	OPT_fleet_secret },
+	{ "fleet-start",	1,	0,	OPT_fleet_start },
 	{ "flock",		1,	0,	OPT_flock },
 	{ "flock-ops",		1,	0,	OPT_flock_ops },
 	{ "fanotify",		1,	0,	OPT_fanotify },
@@ -424,12 +537,16 @@ static const struct option long_options[] = {
 	{ "fork-vm",		0,	0,	OPT_fork_vm },
 	{ "fp-error",		1,	0,	OPT_fp_error},
 	{ "fp-error-ops",	1,	0,	OPT_fp_error_ops },
+	{ "fp-error-penalty",	0,	0,	OPT_fp_error_penalty },
 	{ "fpunch",		1,	0,	OPT_fpunch },
 	{ "fpunch-ops",		1,	0,	OPT_fpunch_ops },
+	{ "freq-stats",		0,	0,	OPT_freq_stats },
 	{ "fstat",		1,	0,	OPT_fstat },
 	{ "fstat-ops",		1,	0,	OPT_fstat_ops },
 	{ "fstat-dir",		1,	0,	OPT_fstat_dir },
 	{ "ftrace",		0,	0,	OPT_ftrace },
+	{ "ftrace-baseline",	1,	0,	OPT_ftrace_baseline },
+	{ "ftrace-top",		1,	0,	OPT_ftrace_top },
 	{ "full",		1,	0,	OPT_full },
 	{ "full-ops",		1,	0,	OPT_full_ops },
 	{ "funccall",		1,	0,	OPT_funccall },
@@ -439,16 +556,29 @@ static const struct option long_options[] = {
 	{ "funcret-ops",	1,	0,	OPT_funcret_ops },
 	{ "funcret-method",	1,	0,	OPT_funcret_method },
 	{ "futex",		1,	0,	OPT_futex },
+	{ "futex-method",	1,	0,	OPT_futex_method },
 	{ "futex-ops",		1,	0,	OPT_futex_ops },
+	{ "futex-threads",	1,	0,	OPT_futex_threads },
 	{ "get",		1,	0,	OPT_get },
 	{ "get-ops",		1,	0,	OPT_get_ops },
 	{ "getrandom",		1,	0,	OPT_getrandom },
 	{ "getrandom-ops",	1,	0,	OPT_getrandom_ops },
+	{ "getrandom-bench",	0,	0,	OPT_getrandom_bench },
+	{ "getrandom-bench-threads",1,	0,	OPT_getrandom_bench_threads },
 	{ "getdent",		1,	0,	OPT_getdent },
 	{ "getdent-ops",	1,	0,	OPT_getdent_ops },
+	{ "getdent-bench",	0,	0,	OPT_getdent_bench },
+	{ "getdent-entries",	1,	0,	OPT_getdent_entries },
+	{ "getdent-readers",	1,	0,	OPT_getdent_readers },
 	{ "goto",		1,	0,	OPT_goto },
 	{ "goto-ops",		1,	0,	OPT_goto_ops },
 	{ "goto-direction", 	1,	0,	OPT_goto_direction },
+	{ "graph",		1,	0,	OPT_graph },
+	{ "graph-edgefactor",	1,	0,	OPT_graph_edgefactor },
+	{ "graph-method",	1,	0,	OPT_graph_method },
+	{ "graph-ops",		1,	0,	OPT_graph_ops },
+	{ "graph-scale",	1,	0,	OPT_graph_scale },
+	{ "graph-threads",	1,	0,	OPT_graph_threads },
 	{ "gpu",		1,	0,	OPT_gpu },
 	{ "gpu-ops",		1,	0,	OPT_gpu_ops },
 	{ "gpu-devnode",	1,	0,	OPT_gpu_devnode },
@@ -459,14 +589,20 @@ static const struct option long_options[] = {
 	{ "gpu-ysize",		1,	0,	OPT_gpu_ysize },
 	{ "handle",		1,	0,	OPT_handle },
 	{ "handle-ops",		1,	0,	OPT_handle_ops },
+	{ "harness-overhead",	0,	0,	OPT_harness_overhead },
 	{ "hash",		1,	0,	OPT_hash },
 	{ "hash-ops",		1,	0,	OPT_hash_ops },
 	{ "hash-method",	1,	0,	OPT_hash_method },
+	{ "hashtable",		1,	0,	OPT_hashtable },
+	{ "hashtable-method",	1,	0,	OPT_hashtable_method },
+	{ "hashtable-ops",	1,	0,	OPT_hashtable_ops },
+	{ "hashtable-size",	1,	0,	OPT_hashtable_size },
 	{ "hdd",		1,	0,	OPT_hdd },
 	{ "hdd-ops",		1,	0,	OPT_hdd_ops },
 	{ "hdd-bytes",		1,	0,	OPT_hdd_bytes },
 	{ "hdd-write-size", 	1,	0,	OPT_hdd_write_size },
 	{ "hdd-opts",		1,	0,	OPT_hdd_opts },
+	{ "hdd-profile",	1,	0,	OPT_hdd_profile },
 	{ "heapsort",		1,	0,	OPT_heapsort },
 	{ "heapsort-ops",	1,	0,	OPT_heapsort_ops },
 	{ "heapsort-size",	1,	0,	OPT_heapsort_integers },
@@ -475,23 +611,37 @@ static const struct option long_options[] = {
 	{ "hrtimers-adjust",	0,	0,	OPT_hrtimers_adjust },
 	{ "help",		0,	0,	OPT_help },
 	{ "hsearch",		1,	0,	OPT_hsearch },
+	{ "hsearch-method",	1,	0,	OPT_hsearch_method },
 	{ "hsearch-ops",	1,	0,	OPT_hsearch_ops },
 	{ "hsearch-size",	1,	0,	OPT_hsearch_size },
 	{ "icache",		1,	0,	OPT_icache },
 	{ "icache-ops",		1,	0,	OPT_icache_ops },
+	{ "icache-sweep",	0,	0,	OPT_icache_sweep },
 	{ "icmp-flood",		1,	0,	OPT_icmp_flood },
 	{ "icmp-flood-ops",	1,	0,	OPT_icmp_flood_ops },
+	{ "icmp-flood-pps",	1,	0,	OPT_icmp_flood_pps },
+	{ "icmp-flood-size-dist",1,	0,	OPT_icmp_flood_size_dist },
 	{ "idle-page",		1,	0,	OPT_idle_page },
 	{ "idle-page-ops",	1,	0,	OPT_idle_page_ops },
+	{ "idlewake",		1,	0,	OPT_idlewake },
+	{ "idlewake-ops",	1,	0,	OPT_idlewake_ops },
+	{ "idlewake-samples",	1,	0,	OPT_idlewake_samples },
 	{ "ignite-cpu",		0,	0, 	OPT_ignite_cpu },
 	{ "inode-flags",	1,	0,	OPT_inode_flags },
 	{ "inode-flags-ops",	1,	0,	OPT_inode_flags_ops },
 	{ "inotify",		1,	0,	OPT_inotify },
 	{ "inotify-ops",	1,	0,	OPT_inotify_ops },
+	{ "inotify-bench",	0,	0,	OPT_inotify_bench },
+	{ "inotify-producers",	1,	0,	OPT_inotify_producers },
+	{ "inotify-queue",	1,	0,	OPT_inotify_queue },
+	{ "inotify-watches",	1,	0,	OPT_inotify_watches },
+	{ "instance-mode",	1,	0,	OPT_instance_mode },
 	{ "io",			1,	0,	OPT_io },
 	{ "io-ops",		1,	0,	OPT_io_ops },
 	{ "iomix",		1,	0,	OPT_iomix },
 	{ "iomix-bytes",	1,	0,	OPT_iomix_bytes },
+	{ "iomix-isolation",	0,	0,	OPT_iomix_isolation },
+	{ "iomix-isolation-writers",1,	0,	OPT_iomix_isolation_writers },
 	{ "iomix-ops",		1,	0,	OPT_iomix_ops },
 	{ "ionice-class",	1,	0,	OPT_ionice_class },
 	{ "ionice-level",	1,	0,	OPT_ionice_level },
@@ -503,20 +653,33 @@ static const struct option long_options[] = {
 	{ "iostat",		1,	0,	OPT_iostat },
 	{ "io-uring",		1,	0,	OPT_io_uring },
 	{ "io-uring-ops",	1,	0,	OPT_io_uring_ops },
+	{ "io-uring-batch",	1,	0,	OPT_io_uring_batch },
+	{ "io-uring-depth",	1,	0,	OPT_io_uring_depth },
+	{ "io-uring-fixed",	0,	0,	OPT_io_uring_fixed },
+	{ "io-uring-iopoll",	0,	0,	OPT_io_uring_iopoll },
+	{ "io-uring-net",	1,	0,	OPT_io_uring_net },
+	{ "io-uring-net-size",	1,	0,	OPT_io_uring_net_size },
+	{ "io-uring-sqpoll",	0,	0,	OPT_io_uring_sqpoll },
+	{ "io-uring-sqpoll-cpu",1,	0,	OPT_io_uring_sqpoll_cpu },
 	{ "ipsec-mb",		1,	0,	OPT_ipsec_mb },
 	{ "ipsec-mb-ops",	1,	0,	OPT_ipsec_mb_ops },
+	{ "ipsec-mb-bench",	0,	0,	OPT_ipsec_mb_bench },
 	{ "ipsec-mb-feature",	1,	0,	OPT_ipsec_mb_feature },
+	{ "ipsec-mb-threads",	1,	0,	OPT_ipsec_mb_threads },
 	{ "itimer",		1,	0,	OPT_itimer },
 	{ "itimer-ops",		1,	0,	OPT_itimer_ops },
 	{ "itimer-freq",	1,	0,	OPT_itimer_freq },
 	{ "itimer-rand",	0,	0,	OPT_itimer_rand },
 	{ "job",		1,	0,	OPT_job },
 	{ "jpeg",		1,	0,	OPT_jpeg },
+	{ "json",		1,	0,	OPT_json },
 	{ "jpeg-ops",		1,	0,	OPT_jpeg_ops },
+	{ "jpeg-bench",		0,	0,	OPT_jpeg_bench },
 	{ "jpeg-height",	1,	0,	OPT_jpeg_height },
 	{ "jpeg-image",		1,	0,	OPT_jpeg_image },
 	{ "jpeg-width",		1,	0,	OPT_jpeg_width },
 	{ "jpeg-quality",	1,	0,	OPT_jpeg_quality },
+	{ "jpeg-threads",	1,	0,	OPT_jpeg_threads },
 	{ "judy",		1,	0,	OPT_judy },
 	{ "judy-ops",		1,	0,	OPT_judy_ops },
 	{ "judy-size",		1,	0,	OPT_judy_size },
@@ -531,8 +694,15 @@ static const struct option long_options[] = {
 	{ "klog",		1,	0,	OPT_klog },
 	{ "klog-ops",		1,	0,	OPT_klog_ops },
 	{ "klog-check",		0,	0,	OPT_klog_check },
+	{ "ksmbench",		1,	0,	OPT_ksmbench },
+	{ "ksmbench-ops",	1,	0,	OPT_ksmbench_ops },
+	{ "ksmbench-bytes",	1,	0,	OPT_ksmbench_bytes },
+	{ "ksmbench-dup",	1,	0,	OPT_ksmbench_dup },
+	{ "ksmbench-entropy",	1,	0,	OPT_ksmbench_entropy },
 	{ "kvm",		1,	0,	OPT_kvm },
 	{ "kvm-ops",		1,	0,	OPT_kvm_ops },
+	{ "kvm-exit-bench",	0,	0,	OPT_kvm_exit_bench },
+	{ "kvm-exit-vcpus",	1,	0,	OPT_kvm_exit_vcpus },
 	{ "l1cache",		1,	0, 	OPT_l1cache },
 	{ "l1cache-ops",	1,	0,	OPT_l1cache_ops },
 	{ "l1cache-line-size",	1,	0,	OPT_l1cache_line_size },
@@ -550,6 +720,7 @@ static const struct option long_options[] = {
 	{ "list-ops",		1,	0,	OPT_list_ops },
 	{ "list-method",	1,	0,	OPT_list_method },
 	{ "list-size",		1,	0,	OPT_list_size },
+	{ "list-threads",	1,	0,	OPT_list_threads },
 	{ "loadavg",		1,	0,	OPT_loadavg },
 	{ "loadavg-ops",	1,	0,	OPT_loadavg_ops },
 	{ "locka",		1,	0,	OPT_locka },
@@ -559,20 +730,35 @@ static const struct option long_options[] = {
 	{ "lockf",		1,	0,	OPT_lockf },
 	{ "lockf-ops",		1,	0,	OPT_lockf_ops },
 	{ "lockf-nonblock", 	0,	0,	OPT_lockf_nonblock },
+	{ "lockfree",		1,	0,	OPT_lockfree },
+	{ "lockfree-ops",	1,	0,	OPT_lockfree_ops },
+	{ "lockfree-consumers",	1,	0,	OPT_lockfree_consumers },
+	{ "lockfree-method",	1,	0,	OPT_lockfree_method },
+	{ "lockfree-producers",	1,	0,	OPT_lockfree_producers },
 	{ "lockofd",		1,	0,	OPT_lockofd },
 	{ "lockofd-ops",	1,	0,	OPT_lockofd_ops },
+	{ "lockscale",		1,	0,	OPT_lockscale },
+	{ "lockscale-ops",	1,	0,	OPT_lockscale_ops },
+	{ "lockscale-method",	1,	0,	OPT_lockscale_method },
+	{ "lockscale-threads",	1,	0,	OPT_lockscale_threads },
 	{ "log-brief",		0,	0,	OPT_log_brief },
 	{ "log-file",		1,	0,	OPT_log_file },
 	{ "longjmp",		1,	0,	OPT_longjmp },
 	{ "longjmp-ops",	1,	0,	OPT_longjmp_ops },
 	{ "loop",		1,	0,	OPT_loop },
 	{ "loop-ops",		1,	0,	OPT_loop_ops },
+	{ "loop-bench",		0,	0,	OPT_loop_bench },
 	{ "lsearch",		1,	0,	OPT_lsearch },
+	{ "lsearch-method",	1,	0,	OPT_lsearch_method },
 	{ "lsearch-ops",	1,	0,	OPT_lsearch_ops },
 	{ "lsearch-size",	1,	0,	OPT_lsearch_size },
+	{ "lsearch-sweep",	0,	0,	OPT_lsearch_sweep },
 	{ "madvise",		1,	0,	OPT_madvise },
 	{ "madvise-ops",	1,	0,	OPT_madvise_ops },
 	{ "malloc",		1,	0,	OPT_malloc },
+	{ "malloc-bench",	1,	0,	OPT_malloc_bench },
+	{ "malloc-bench-trace",1,	0,	OPT_malloc_bench_trace },
+	{ "malloc-bench-xfree",0,	0,	OPT_malloc_bench_xfree },
 	{ "malloc-bytes",	1,	0,	OPT_malloc_bytes },
 	{ "malloc-max",		1,	0,	OPT_malloc_max },
 	{ "malloc-ops",		1,	0,	OPT_malloc_ops },
@@ -584,22 +770,26 @@ static const struct option long_options[] = {
 	{ "matrix-ops",		1,	0,	OPT_matrix_ops },
 	{ "matrix-method",	1,	0,	OPT_matrix_method },
 	{ "matrix-size",	1,	0,	OPT_matrix_size },
+	{ "matrix-type",	1,	0,	OPT_matrix_type },
 	{ "matrix-yx",		0,	0,	OPT_matrix_yx },
 	{ "matrix-3d",		1,	0,	OPT_matrix_3d },
 	{ "matrix-3d-ops",	1,	0,	OPT_matrix_3d_ops },
 	{ "matrix-3d-method",	1,	0,	OPT_matrix_3d_method },
 	{ "matrix-3d-size",	1,	0,	OPT_matrix_3d_size },
+	{ "matrix-3d-type",	1,	0,	OPT_matrix_3d_type },
 	{ "matrix-3d-zyx",	0,	0,	OPT_matrix_3d_zyx },
 	{ "maximize",		0,	0,	OPT_maximize },
 	{ "max-fd",		1,	0,	OPT_max_fd },
 	{ "mbind",		1,	0,	OPT_mbind },
 	{ "mcontend",		1,	0,	OPT_mcontend },
 	{ "mcontend-ops",	1,	0,	OPT_mcontend_ops },
+	{ "mem-backing",	1,	0,	OPT_mem_backing },
 	{ "membarrier",		1,	0,	OPT_membarrier },
 	{ "membarrier-ops",	1,	0,	OPT_membarrier_ops },
 	{ "memcpy",		1,	0,	OPT_memcpy },
 	{ "memcpy-ops",		1,	0,	OPT_memcpy_ops },
 	{ "memcpy-method",	1,	0,	OPT_memcpy_method },
+	{ "memcpy-sweep",	0,	0,	OPT_memcpy_sweep },
 	{ "memfd",		1,	0,	OPT_memfd },
 	{ "memfd-ops",		1,	0,	OPT_memfd_ops },
 	{ "memfd-bytes",	1,	0,	OPT_memfd_bytes },
@@ -611,20 +801,30 @@ static const struct option long_options[] = {
 	{ "memrate-rd-mbs",	1,	0,	OPT_memrate_rd_mbs },
 	{ "memrate-wr-mbs",	1,	0,	OPT_memrate_wr_mbs },
 	{ "memrate-bytes",	1,	0,	OPT_memrate_bytes },
+	{ "memrate-latency",	0,	0,	OPT_memrate_latency },
+	{ "memrate-latency-steps",1,	0,	OPT_memrate_latency_steps },
+	{ "memrate-latency-threads",1,	0,	OPT_memrate_latency_threads },
 	{ "memthrash",		1,	0,	OPT_memthrash },
 	{ "memthrash-ops",	1,	0,	OPT_memthrash_ops },
 	{ "memthrash-method",	1,	0,	OPT_memthrash_method },
 	{ "mergesort",		1,	0,	OPT_mergesort },
 	{ "mergesort-ops",	1,	0,	OPT_mergesort_ops },
 	{ "mergesort-size",	1,	0,	OPT_mergesort_integers },
+	{ "metamix",		1,	0,	OPT_metamix },
+	{ "metamix-ops",	1,	0,	OPT_metamix_ops },
+	{ "metamix-mode",	1,	0,	OPT_metamix_mode },
+	{ "metamix-threads",	1,	0,	OPT_metamix_threads },
 	{ "metrics",		0,	0,	OPT_metrics },
 	{ "metrics-brief",	0,	0,	OPT_metrics_brief },
+	{ "metrics-interval",	1,	0,	OPT_metrics_interval },
+	{ "metrics-interval-csv",1,	0,	OPT_metrics_interval_csv },
 	{ "mincore",		1,	0,	OPT_mincore },
 	{ "mincore-ops",	1,	0,	OPT_mincore_ops },
 	{ "mincore-random",	0,	0,	OPT_mincore_rand },
 	{ "misaligned",		1,	0,	OPT_misaligned },
 	{ "misaligned-ops",	1,	0,	OPT_misaligned_ops },
 	{ "misaligned-method",	1,	0,	OPT_misaligned_method },
+	{ "misaligned-timing",	0,	0,	OPT_misaligned_timing },
 	{ "minimize",		0,	0,	OPT_minimize },
 	{ "mknod",		1,	0,	OPT_mknod },
 	{ "mknod-ops",		1,	0,	OPT_mknod_ops },
@@ -658,13 +858,19 @@ static const struct option long_options[] = {
 	{ "mq",			1,	0,	OPT_mq },
 	{ "mq-ops",		1,	0,	OPT_mq_ops },
 	{ "mq-size",		1,	0,	OPT_mq_size },
+	{ "mq-sweep",		0,	0,	OPT_mq_sweep },
 	{ "mremap",		1,	0,	OPT_mremap },
 	{ "mremap-ops",		1,	0,	OPT_mremap_ops },
 	{ "mremap-bytes",	1,	0,	OPT_mremap_bytes },
 	{ "mremap-mlock",	0,	0,	OPT_mremap_mlock },
+	{ "mremapbench",	1,	0,	OPT_mremapbench },
+	{ "mremapbench-ops",	1,	0,	OPT_mremapbench_ops },
+	{ "mremapbench-bytes",	1,	0,	OPT_mremapbench_bytes },
+	{ "mremapbench-method",	1,	0,	OPT_mremapbench_method },
 	{ "msg",		1,	0,	OPT_msg },
 	{ "msg-ops",		1,	0,	OPT_msg_ops },
 	{ "msg-types",		1,	0,	OPT_msg_types },
+	{ "msg-sweep",		0,	0,	OPT_msg_sweep },
 	{ "msync",		1,	0,	OPT_msync },
 	{ "msync-ops",		1,	0,	OPT_msync_ops },
 	{ "msync-bytes",	1,	0,	OPT_msync_bytes },
@@ -686,7 +892,11 @@ static const struct option long_options[] = {
 	{ "netlink-task-ops",	1,	0,	OPT_netlink_task_ops },
 	{ "nice",		1,	0,	OPT_nice },
 	{ "nice-ops",		1,	0,	OPT_nice_ops },
+	{ "nice-fairness",	0,	0,	OPT_nice_fairness },
+	{ "nice-fairness-slice",1,	0,	OPT_nice_fairness_slice },
+	{ "nice-fairness-tasks",1,	0,	OPT_nice_fairness_tasks },
 	{ "no-madvise",		0,	0,	OPT_no_madvise },
+	{ "node-alloc",		1,	0,	OPT_node_alloc },
 	{ "no-oom-adjust",	0,	0,	OPT_no_oom_adjust },
 	{ "no-rand-seed", 	0,	0,	OPT_no_rand_seed },
 	{ "nop",		1,	0,	OPT_nop },
@@ -696,6 +906,9 @@ static const struct option long_options[] = {
 	{ "null-ops",		1,	0,	OPT_null_ops },
 	{ "numa",		1,	0,	OPT_numa },
 	{ "numa-ops",		1,	0,	OPT_numa_ops },
+	{ "numa-migrate",	0,	0,	OPT_numa_migrate },
+	{ "numa-migrate-batch",	1,	0,	OPT_numa_migrate_batch },
+	{ "numa-migrate-bytes",	1,	0,	OPT_numa_migrate_bytes },
 	{ "oomable",		0,	0,	OPT_oomable },
 	{ "oom-pipe",		1,	0,	OPT_oom_pipe },
 	{ "oom-pipe-ops",	1,	0,	OPT_oom_pipe_ops },
@@ -703,19 +916,31 @@ static const struct option long_options[] = {
 	{ "opcode-ops",		1,	0,	OPT_opcode_ops },
 	{ "opcode-method",	1,	0,	OPT_opcode_method },
 	{ "open",		1,	0,	OPT_open },
+	{ "openmetrics",	1,	0,	OPT_openmetrics },
+	{ "openmetrics-interval",1,	0,	OPT_openmetrics_interval },
 	{ "open-fd",		0,	0,	OPT_open_fd },
 	{ "open-ops",		1,	0,	OPT_open_ops },
 	{ "open-max",		1,	0,	OPT_open_max },
 	{ "page-in",		0,	0,	OPT_page_in },
+	{ "pagecachebench",	1,	0,	OPT_pagecachebench },
+	{ "pagecachebench-ops",	1,	0,	OPT_pagecachebench_ops },
+	{ "pagecachebench-bytes",1,	0,	OPT_pagecachebench_bytes },
+	{ "pagecachebench-method",1,	0,	OPT_pagecachebench_method },
+	{ "pagecachebench-threads",1,	0,	OPT_pagecachebench_threads },
 	{ "pageswap",		1,	0,	OPT_pageswap },
 	{ "pageswap-ops",	1,	0,	OPT_pageswap_ops },
 	{ "parallel",		1,	0,	OPT_all },
 	{ "pathological",	0,	0,	OPT_pathological },
 	{ "pci",		1,	0,	OPT_pci},
 	{ "pci-ops",		1,	0,	OPT_pci_ops },
+	{ "percpu",		1,	0,	OPT_percpu },
+	{ "percpu-method",	1,	0,	OPT_percpu_method },
+	{ "percpu-ops",		1,	0,	OPT_percpu_ops },
+	{ "percpu-threads",	1,	0,	OPT_percpu_threads },
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ "perf",		0,	0,	OPT_perf_stats },
+	{ "perf-uncore",	0,	0,	OPT_perf_uncore },
 #endif
 	{ "personality",	1,	0,	OPT_personality },
 	{ "personality-ops",	1,	0,	OPT_personality_ops },
@@ -736,27 +961,51 @@ static const struct option long_options[] = {
 	{ "pipeherd",		1,	0,	OPT_pipeherd },
 	{ "pipeherd-ops",	1,	0,	OPT_pipeherd_ops },
 	{ "pipeherd-yield", 	0,	0,	OPT_pipeherd_yield },
+	{ "pipeherd-bench",	0,	0,	OPT_pipeherd_bench },
+	{ "pipeherd-bench-max",	1,	0,	OPT_pipeherd_bench_max },
 	{ "pkey",		1,	0,	OPT_pkey },
 	{ "pkey-ops",		1,	0,	OPT_pkey_ops },
+	{ "placement",		1,	0,	OPT_placement },
 	{ "plugin",		1,	0,	OPT_plugin },
 	{ "plugin-ops",		1,	0,	OPT_plugin_ops },
+	{ "plugin-batch",	1,	0,	OPT_plugin_batch },
 	{ "plugin-method",	1,	0,	OPT_plugin_method },
 	{ "plugin-so",		1,	0,	OPT_plugin_so },
 	{ "poll",		1,	0,	OPT_poll },
 	{ "poll-ops",		1,	0,	OPT_poll_ops },
 	{ "poll-fds",		1,	0,	OPT_poll_fds },
+	{ "pollbench",		1,	0,	OPT_pollbench },
+	{ "pollbench-ops",	1,	0,	OPT_pollbench_ops },
+	{ "pollbench-active",	1,	0,	OPT_pollbench_active },
+	{ "pollbench-fds",	1,	0,	OPT_pollbench_fds },
+	{ "pollbench-method",	1,	0,	OPT_pollbench_method },
 	{ "prctl",		1,	0,	OPT_prctl },
 	{ "prctl-ops",		1,	0,	OPT_prctl_ops },
 	{ "prefetch",		1,	0,	OPT_prefetch },
 	{ "prefetch-ops",	1,	0,	OPT_prefetch_ops },
 	{ "prefetch-l3-size",	1,	0,	OPT_prefetch_l3_size },
+	{ "prefetch-sweep",	0,	0,	OPT_prefetch_sweep },
+	{ "prefetch-sweep-hwpf",0,	0,	OPT_prefetch_sweep_hwpf },
 	{ "procfs",		1,	0,	OPT_procfs },
 	{ "procfs-ops",		1,	0,	OPT_procfs_ops },
+	{ "pseudofsbench",	1,	0,	OPT_pseudofsbench },
+	{ "pseudofsbench-ops",	1,	0,	OPT_pseudofsbench_ops },
+	{ "pseudofsbench-files",1,	0,	OPT_pseudofsbench_files },
+	{ "pseudofsbench-threads",1,	0,	OPT_pseudofsbench_threads },
+	{ "psi",		0,	0,	OPT_psi },
+	{ "psi-cgroup",		0,	0,	OPT_psi_cgroup },
 	{ "pthread",		1,	0,	OPT_pthread },
 	{ "pthread-ops",	1,	0,	OPT_pthread_ops },
 	{ "pthread-max",	1,	0,	OPT_pthread_max },
+	{ "pthread-bench",	0,	0,	OPT_pthread_bench },
+	{ "pthread-bench-tls-so",1,	0,	OPT_pthread_bench_tls_so },
 	{ "ptrace",		1,	0,	OPT_ptrace },
+	{ "ptrace-bench",	0,	0,	OPT_ptrace_bench },
 	{ "ptrace-ops",		1,	0,	OPT_ptrace_ops },
+	{ "ptrchase",		1,	0,	OPT_ptrchase },
+	{ "ptrchase-ops",	1,	0,	OPT_ptrchase_ops },
+	{ "ptrchase-max-bytes",	1,	0,	OPT_ptrchase_max_bytes },
+	{ "ptrchase-mlp",	0,	0,	OPT_ptrchase_mlp },
 	{ "pty",		1,	0,	OPT_pty },
 	{ "pty-ops",		1,	0,	OPT_pty_ops },
 	{ "pty-max",		1,	0,	OPT_pty_max },
@@ -778,12 +1027,15 @@ static const struct option long_options[] = {
 	{ "randlist-items", 	1,	0,	OPT_randlist_items },
 	{ "randlist-size", 	1,	0,	OPT_randlist_size },
 	{ "random",		1,	0,	OPT_random },
+	{ "rapl",		0,	0,	OPT_rapl },
 	{ "rawdev",		1,	0,	OPT_rawdev },
 	{ "rawdev-ops",		1,	0,	OPT_rawdev_ops },
 	{ "rawdev-method",	1,	0,	OPT_rawdev_method },
 	{ "rawpkt",		1,	0,	OPT_rawpkt },
 	{ "rawpkt-ops",		1,	0,	OPT_rawpkt_ops },
+	{ "rawpkt-if",		1,	0,	OPT_rawpkt_if },
 	{ "rawpkt-port",	1,	0,	OPT_rawpkt_port },
+	{ "rawpkt-ring",	0,	0,	OPT_rawpkt_ring },
 	{ "rawsock",		1,	0,	OPT_rawsock },
 	{ "rawsock-ops",	1,	0,	OPT_rawsock_ops },
 	{ "rawudp",		1,	0,	OPT_rawudp },
@@ -796,6 +1048,7 @@ static const struct option long_options[] = {
 	{ "readahead",		1,	0,	OPT_readahead },
 	{ "readahead-ops",	1,	0,	OPT_readahead_ops },
 	{ "readahead-bytes",	1,	0,	OPT_readahead_bytes },
+	{ "readahead-bench",	0,	0,	OPT_readahead_bench },
 	{ "reboot",		1,	0,	OPT_reboot },
 	{ "reboot-ops",		1,	0,	OPT_reboot_ops },
 	{ "regs",		1,	0,	OPT_regs },
@@ -804,8 +1057,15 @@ static const struct option long_options[] = {
 	{ "remap-ops",		1,	0,	OPT_remap_ops },
 	{ "rename",		1,	0,	OPT_rename },
 	{ "rename-ops",		1,	0,	OPT_rename_ops },
+	{ "repeat",		1,	0,	OPT_repeat },
+	{ "repeat-cv",		1,	0,	OPT_repeat_cv },
+	{ "repeat-warmup",	1,	0,	OPT_repeat_warmup },
 	{ "resched",		1,	0,	OPT_resched },
 	{ "resched-ops",	1,	0,	OPT_resched_ops },
+	{ "resctrl",		0,	0,	OPT_resctrl },
+	{ "resctrl-interval",	1,	0,	OPT_resctrl_interval },
+	{ "resctrl-l3-ways",	1,	0,	OPT_resctrl_l3_ways },
+	{ "resctrl-mb",		1,	0,	OPT_resctrl_mb },
 	{ "resources",		1,	0,	OPT_resources },
 	{ "resources-ops",	1,	0,	OPT_resources_ops },
 	{ "revio",		1,	0,	OPT_revio },
@@ -820,6 +1080,9 @@ static const struct option long_options[] = {
 	{ "rseq-ops",		1,	0,	OPT_rseq_ops },
 	{ "rtc",		1,	0,	OPT_rtc },
 	{ "rtc-ops",		1,	0,	OPT_rtc_ops },
+	{ "sample",		1,	0,	OPT_sample },
+	{ "sample-file",	1,	0,	OPT_sample_file },
+	{ "scale-sweep",	1,	0,	OPT_scale_sweep },
 	{ "sched",		1,	0,	OPT_sched },
 	{ "sched-prio",		1,	0,	OPT_sched_prio },
 	{ "schedpolicy",	1,	0,	OPT_schedpolicy },
@@ -828,17 +1091,23 @@ static const struct option long_options[] = {
 	{ "sched-runtime",	1,	0,	OPT_sched_runtime },
 	{ "sched-deadline",	1,	0,	OPT_sched_deadline },
 	{ "sched-reclaim",	0,	0,      OPT_sched_reclaim },
+	{ "schedstat",		0,	0,	OPT_schedstat },
 	{ "schedpolicy",	1,	0,	OPT_schedpolicy },
 	{ "sctp",		1,	0,	OPT_sctp },
 	{ "sctp-ops",		1,	0,	OPT_sctp_ops },
+	{ "sctp-assocs",	1,	0,	OPT_sctp_assocs },
+	{ "sctp-bench",		0,	0,	OPT_sctp_bench },
 	{ "sctp-domain",	1,	0,	OPT_sctp_domain },
 	{ "sctp-if",		1,	0,	OPT_sctp_if },
 	{ "sctp-port",		1,	0,	OPT_sctp_port },
 	{ "sctp-sched",		1,	0,	OPT_sctp_sched },
+	{ "sctp-streams",	1,	0,	OPT_sctp_streams },
 	{ "seal",		1,	0,	OPT_seal },
 	{ "seal-ops",		1,	0,	OPT_seal_ops },
 	{ "seccomp",		1,	0,	OPT_seccomp },
 	{ "seccomp-ops",	1,	0,	OPT_seccomp_ops },
+	{ "seccomp-bench",	0,	0,	OPT_seccomp_bench },
+	{ "seccomp-stack",	1,	0,	OPT_seccomp_stack },
 	{ "secretmem",		1,	0,	OPT_secretmem },
 	{ "secretmem-ops",	1,	0,	OPT_secretmem_ops },
 	{ "seed",		1,	0,	OPT_seed },
@@ -871,6 +1140,11 @@ static const struct option long_options[] = {
 	{ "shm-sysv-ops",	1,	0,	OPT_shm_sysv_ops },
 	{ "shm-sysv-bytes",	1,	0,	OPT_shm_sysv_bytes },
 	{ "shm-sysv-segs",	1,	0,	OPT_shm_sysv_segments },
+	{ "shmbench",		1,	0,	OPT_shmbench },
+	{ "shmbench-ops",	1,	0,	OPT_shmbench_ops },
+	{ "shmbench-bytes",	1,	0,	OPT_shmbench_bytes },
+	{ "shmbench-method",	1,	0,	OPT_shmbench_method },
+	{ "shmbench-wake",	1,	0,	OPT_shmbench_wake },
 	{ "sigabrt",		1,	0,	OPT_sigabrt },
 	{ "sigabrt-ops",	1,	0,	OPT_sigabrt_ops },
 	{ "sigchld",		1,	0,	OPT_sigchld },
@@ -879,6 +1153,10 @@ static const struct option long_options[] = {
 	{ "sigfd-ops",		1,	0,	OPT_sigfd_ops },
 	{ "sigio",		1,	0,	OPT_sigio },
 	{ "sigio-ops",		1,	0,	OPT_sigio_ops },
+	{ "siglat",		1,	0,	OPT_siglat },
+	{ "siglat-method",	1,	0,	OPT_siglat_method },
+	{ "siglat-ops",		1,	0,	OPT_siglat_ops },
+	{ "siglat-threads",	1,	0,	OPT_siglat_threads },
 	{ "sigfpe",		1,	0,	OPT_sigfpe },
 	{ "sigfpe-ops",		1,	0,	OPT_sigfpe_ops },
 	{ "signal",		1,	0,	OPT_signal },
@@ -902,6 +1180,7 @@ static const struct option long_options[] = {
 	{ "skiplist",		1,	0,	OPT_skiplist },
 	{ "skiplist-ops",	1,	0,	OPT_skiplist_ops },
 	{ "skiplist-size",	1,	0,	OPT_skiplist_size },
+	{ "skiplist-threads",	1,	0,	OPT_skiplist_threads },
 	{ "skip-silent",	0,	0,	OPT_skip_silent },
 	{ "sleep",		1,	0,	OPT_sleep },
 	{ "sleep-ops",		1,	0,	OPT_sleep_ops },
@@ -915,14 +1194,20 @@ static const struct option long_options[] = {
 	{ "sock-nodelay",	0,	0,	OPT_sock_nodelay },
 	{ "sock-ops",		1,	0,	OPT_sock_ops },
 	{ "sock-opts",		1,	0,	OPT_sock_opts },
+	{ "sock-placement",1,	0,	OPT_sock_placement },
 	{ "sock-port",		1,	0,	OPT_sock_port },
 	{ "sock-protocol",	1,	0,	OPT_sock_protocol },
+	{ "sock-rr",		0,	0,	OPT_sock_rr },
+	{ "sock-rr-req",	1,	0,	OPT_sock_rr_req },
+	{ "sock-rr-resp",	1,	0,	OPT_sock_rr_resp },
 	{ "sock-type",		1,	0,	OPT_sock_type },
 	{ "sock-zerocopy", 	0,	0,	OPT_sock_zerocopy },
 	{ "sockabuse",		1,	0,	OPT_sockabuse },
 	{ "sockabuse-ops",	1,	0,	OPT_sockabuse_ops },
 	{ "sockdiag",		1,	0,	OPT_sockdiag },
+	{ "sockdiag-bench",	0,	0,	OPT_sockdiag_bench },
 	{ "sockdiag-ops",	1,	0,	OPT_sockdiag_ops },
+	{ "sockdiag-sockets",	1,	0,	OPT_sockdiag_sockets },
 	{ "sockfd",		1,	0,	OPT_sockfd },
 	{ "sockfd-ops",		1,	0,	OPT_sockfd_ops },
 	{ "sockfd-port",	1,	0,	OPT_sockfd_port },
@@ -930,20 +1215,37 @@ static const struct option long_options[] = {
 	{ "sockmany-ops",	1,	0,	OPT_sockmany_ops },
 	{ "sockmany-if",	1,	0,	OPT_sockmany_if },
 	{ "sockpair",		1,	0,	OPT_sockpair },
+	{ "sockpair-bench",	0,	0,	OPT_sockpair_bench },
 	{ "sockpair-ops",	1,	0,	OPT_sockpair_ops },
 	{ "softlockup",		1,	0,	OPT_softlockup },
 	{ "softlockup-ops",	1,	0,	OPT_softlockup_ops },
+	{ "sortbench",		1,	0,	OPT_sortbench },
+	{ "sortbench-data",	1,	0,	OPT_sortbench_data },
+	{ "sortbench-method",	1,	0,	OPT_sortbench_method },
+	{ "sortbench-ops",	1,	0,	OPT_sortbench_ops },
+	{ "sortbench-presort",	1,	0,	OPT_sortbench_presort },
+	{ "sortbench-size",	1,	0,	OPT_sortbench_size },
+	{ "sortbench-threads",	1,	0,	OPT_sortbench_threads },
 	{ "sparsematrix",	1,	0,	OPT_sparsematrix},
 	{ "sparsematrix-ops",	1,	0,	OPT_sparsematrix_ops },
 	{ "sparsematrix-items",	1,	0,	OPT_sparsematrix_items },
 	{ "sparsematrix-method",1,	0,	OPT_sparsematrix_method },
 	{ "sparsematrix-size",	1,	0,	OPT_sparsematrix_size },
+	{ "sparsematrix-spmv",	1,	0,	OPT_sparsematrix_spmv },
+	{ "sparsematrix-threads",1,	0,	OPT_sparsematrix_threads },
+	{ "sparsematrix-band",	1,	0,	OPT_sparsematrix_band },
 	{ "spawn",		1,	0,	OPT_spawn },
 	{ "spawn-ops",		1,	0,	OPT_spawn_ops },
+	{ "spawnbench",		1,	0,	OPT_spawnbench },
+	{ "spawnbench-method",	1,	0,	OPT_spawnbench_method },
+	{ "spawnbench-ops",	1,	0,	OPT_spawnbench_ops },
+	{ "spawnbench-rss",	1,	0,	OPT_spawnbench_rss },
 	{ "splice",		1,	0,	OPT_splice },
 	{ "splice-bytes",	1,	0,	OPT_splice_bytes },
 	{ "splice-ops",		1,	0,	OPT_splice_ops },
 	{ "stack",		1,	0,	OPT_stack},
+	{ "stack-bench",	0,	0,	OPT_stack_bench },
+	{ "stack-bench-size",	1,	0,	OPT_stack_bench_size },
 	{ "stack-fill",		0,	0,	OPT_stack_fill },
 	{ "stack-mlock",	0,	0,	OPT_stack_mlock },
 	{ "stack-ops",		1,	0,	OPT_stack_ops },
@@ -953,29 +1255,43 @@ static const struct option long_options[] = {
 	{ "str",		1,	0,	OPT_str },
 	{ "str-ops",		1,	0,	OPT_str_ops },
 	{ "str-method",		1,	0,	OPT_str_method },
+	{ "str-sweep",		0,	0,	OPT_str_sweep },
 	{ "stressors",		0,	0,	OPT_stressors },
 	{ "stream",		1,	0,	OPT_stream },
 	{ "stream-ops",		1,	0,	OPT_stream_ops },
 	{ "stream-index",	1,	0,	OPT_stream_index },
 	{ "stream-l3-size",	1,	0,	OPT_stream_l3_size },
 	{ "stream-madvise",	1,	0,	OPT_stream_madvise },
+	{ "stream-numa",	1,	0,	OPT_stream_numa },
+	{ "stream-numa-node",	1,	0,	OPT_stream_numa_node },
+	{ "stream-simd",	1,	0,	OPT_stream_simd },
 	{ "swap",		1,	0,	OPT_swap },
 	{ "swap-ops",		1,	0,	OPT_swap_ops },
+	{ "swapbench",		1,	0,	OPT_swapbench },
+	{ "swapbench-ops",	1,	0,	OPT_swapbench_ops },
+	{ "swapbench-bytes",	1,	0,	OPT_swapbench_bytes },
+	{ "swapbench-page-cluster",1,	0,	OPT_swapbench_page_cluster },
+	{ "swapbench-pattern",	1,	0,	OPT_swapbench_pattern },
+	{ "swapbench-threads",	1,	0,	OPT_swapbench_threads },
 	{ "switch",		1,	0,	OPT_switch },
 	{ "switch-ops",		1,	0,	OPT_switch_ops },
 	{ "switch-freq",	1,	0,	OPT_switch_freq },
+	{ "switch-matrix",	0,	0,	OPT_switch_matrix },
 	{ "switch-method",	1,	0,	OPT_switch_method },
 	{ "symlink",		1,	0,	OPT_symlink },
 	{ "symlink-ops",	1,	0,	OPT_symlink_ops },
 	{ "sync-file",		1,	0,	OPT_sync_file },
 	{ "sync-file-ops", 	1,	0,	OPT_sync_file_ops },
 	{ "sync-file-bytes", 	1,	0,	OPT_sync_file_bytes },
+	{ "sync-file-matrix",	0,	0,	OPT_sync_file_matrix },
+	{ "sync-start",		0,	0,	OPT_sync_start },
 	{ "syncload",		1,	0,	OPT_syncload },
 	{ "syncload-ops",	1,	0,	OPT_syncload_ops },
 	{ "syncload-msbusy",	1,	0,	OPT_syncload_msbusy },
 	{ "syncload-mssleep",	1,	0,	OPT_syncload_mssleep },
 	{ "sysbadaddr",		1,	0,	OPT_sysbadaddr },
 	{ "sysbadaddr-ops",	1,	0,	OPT_sysbadaddr_ops },
+	{ "syscall-stats",	0,	0,	OPT_syscall_stats },
 	{ "sysfs",		1,	0,	OPT_sysfs },
 	{ "sysfs-ops",		1,	0,	OPT_sysfs_ops },
 	{ "sysinfo",		1,	0,	OPT_sysinfo },
@@ -985,6 +1301,8 @@ static const struct option long_options[] = {
 #if defined(HAVE_SYSLOG_H)
 	{ "syslog",		0,	0,	OPT_syslog },
 #endif
+	{ "target-cpu",		1,	0,	OPT_target_cpu },
+	{ "target-ops",		1,	0,	OPT_target_ops },
 	{ "taskset",		1,	0,	OPT_taskset },
 	{ "tee",		1,	0,	OPT_tee },
 	{ "tee-ops",		1,	0,	OPT_tee_ops },
@@ -994,6 +1312,10 @@ static const struct option long_options[] = {
 	{ "timer-ops",		1,	0,	OPT_timer_ops },
 	{ "timer-freq",		1,	0,	OPT_timer_freq },
 	{ "timer-rand", 	0,	0,	OPT_timer_rand },
+	{ "timerbench",		1,	0,	OPT_timerbench },
+	{ "timerbench-ops",	1,	0,	OPT_timerbench_ops },
+	{ "timerbench-method",	1,	0,	OPT_timerbench_method },
+	{ "timerbench-samples",	1,	0,	OPT_timerbench_samples },
 	{ "timerfd",		1,	0,	OPT_timerfd },
 	{ "timerfd-ops",	1,	0,	OPT_timerfd_ops },
 	{ "timerfd-fds",	1,	0,	OPT_timerfd_fds },
@@ -1002,6 +1324,12 @@ static const struct option long_options[] = {
 	{ "timer-slack"	,	1,	0,	OPT_timer_slack },
 	{ "tlb-shootdown",	1,	0,	OPT_tlb_shootdown },
 	{ "tlb-shootdown-ops",	1,	0,	OPT_tlb_shootdown_ops },
+	{ "tlb-shootdown-sweep",0,	0,	OPT_tlb_shootdown_sweep },
+	{ "tlbreach",		1,	0,	OPT_tlbreach },
+	{ "tlbreach-bytes",	1,	0,	OPT_tlbreach_bytes },
+	{ "tlbreach-ops",	1,	0,	OPT_tlbreach_ops },
+	{ "tlbreach-page",	1,	0,	OPT_tlbreach_page },
+	{ "tlbreach-pattern",	1,	0,	OPT_tlbreach_pattern },
 	{ "tmpfs",		1,	0,	OPT_tmpfs },
 	{ "tmpfs-ops",		1,	0,	OPT_tmpfs_ops },
 	{ "tmpfs-mmap-async",	0,	0,	OPT_tmpfs_mmap_async },
@@ -1014,6 +1342,7 @@ static const struct option long_options[] = {
 	{ "tree-ops",		1,	0,	OPT_tree_ops },
 	{ "tree-method",	1,	0,	OPT_tree_method },
 	{ "tree-size",		1,	0,	OPT_tree_size },
+	{ "tree-sweep",		0,	0,	OPT_tree_sweep },
 	{ "tsc",		1,	0,	OPT_tsc },
 	{ "tsc-ops",		1,	0,	OPT_tsc_ops },
 	{ "tsearch",		1,	0,	OPT_tsearch },
@@ -1025,22 +1354,34 @@ static const struct option long_options[] = {
 	{ "timestamp",		0,	0,	OPT_timestamp },
 	{ "tz",			0,	0,	OPT_thermal_zones },
 	{ "tun",		1,	0,	OPT_tun},
+	{ "tun-bench",		0,	0,	OPT_tun_bench },
 	{ "tun-ops",		1,	0,	OPT_tun_ops },
+	{ "tun-queues",		1,	0,	OPT_tun_queues },
 	{ "tun-tap",		0,	0,	OPT_tun_tap },
 	{ "udp",		1,	0,	OPT_udp },
 	{ "udp-ops",		1,	0,	OPT_udp_ops },
+	{ "udp-batch",		1,	0,	OPT_udp_batch },
+	{ "udp-bench",		0,	0,	OPT_udp_bench },
+	{ "udp-busy-poll",	1,	0,	OPT_udp_busy_poll },
 	{ "udp-domain",		1,	0,	OPT_udp_domain },
 	{ "udp-gro",		0,	0,	OPT_udp_gro },
+	{ "udp-gso",		1,	0,	OPT_udp_gso },
 	{ "udp-lite",		0,	0,	OPT_udp_lite },
+	{ "udp-placement",1,	0,	OPT_udp_placement },
 	{ "udp-port",		1,	0,	OPT_udp_port },
 	{ "udp-flood",		1,	0,	OPT_udp_flood },
 	{ "udp-flood-domain",	1,	0,	OPT_udp_flood_domain },
 	{ "udp-flood-if",	1,	0,	OPT_udp_flood_if },
+	{ "udp-flood-pps",	1,	0,	OPT_udp_flood_pps },
+	{ "udp-flood-size-dist",1,	0,	OPT_udp_flood_size_dist },
 	{ "udp-flood-ops",	1,	0,	OPT_udp_flood_ops },
 	{ "udp-if",		1,	0,	OPT_udp_if },
 	{ "unshare",		1,	0,	OPT_unshare },
 	{ "unshare-ops",	1,	0,	OPT_unshare_ops },
+	{ "unshare-bench",	0,	0,	OPT_unshare_bench },
+	{ "unshare-mounts",	1,	0,	OPT_unshare_mounts },
 	{ "uprobe",		1,	0,	OPT_uprobe },
+	{ "uprobe-bench",	0,	0,	OPT_uprobe_bench },
 	{ "uprobe-ops",		1,	0,	OPT_uprobe_ops },
 	{ "urandom",		1,	0,	OPT_urandom },
 	{ "urandom-ops",	1,	0,	OPT_urandom_ops },
@@ -1055,15 +1396,22 @@ static const struct option long_options[] = {
 	{ "vdso",		1,	0,	OPT_vdso },
 	{ "vdso-ops",		1,	0,	OPT_vdso_ops },
 	{ "vdso-func",		1,	0,	OPT_vdso_func },
+	{ "vdso-matrix",	0,	0,	OPT_vdso_matrix },
 	{ "vecfp",		1,	0,	OPT_vecfp },
 	{ "vecfp-ops",		1,	0,	OPT_vecfp_ops },
 	{ "vecfp-method",	1,	0,	OPT_vecfp_method },
+	{ "vecfreq",		1,	0,	OPT_vecfreq },
+	{ "vecfreq-dwell",	1,	0,	OPT_vecfreq_dwell },
+	{ "vecfreq-ops",	1,	0,	OPT_vecfreq_ops },
+	{ "vecfreq-tier",	1,	0,	OPT_vecfreq_tier },
 	{ "vecmath",		1,	0,	OPT_vecmath },
 	{ "vecmath-ops",	1,	0,	OPT_vecmath_ops },
 	{ "vecwide",		1,	0,	OPT_vecwide},
 	{ "vecwide-ops",	1,	0,	OPT_vecwide_ops },
 	{ "verbose",		0,	0,	OPT_verbose },
 	{ "verify",		0,	0,	OPT_verify },
+	{ "verify-sample",	1,	0,	OPT_verify_sample },
+	{ "verify-sample-mode",	1,	0,	OPT_verify_sample_mode },
 	{ "verifiable",		0,	0,	OPT_verifiable },
 	{ "verity",		1,	0,	OPT_verity },
 	{ "verity-ops",		1,	0,	OPT_verity_ops },
@@ -1086,12 +1434,17 @@ static const struct option long_options[] = {
 #endif
 	{ "vm-ops",		1,	0,	OPT_vm_ops },
 	{ "vm-madvise",		1,	0,	OPT_vm_madvise },
+	{ "vm-prefault",	1,	0,	OPT_vm_prefault },
+	{ "vm-rowhammer-sides",	1,	0,	OPT_vm_rowhammer_sides },
+	{ "vm-rowhammer-row-stride",1,	0,	OPT_vm_rowhammer_row_stride },
 	{ "vm-method",		1,	0,	OPT_vm_method },
 	{ "vm-addr",		1,	0,	OPT_vm_addr },
 	{ "vm-addr-ops",	1,	0,	OPT_vm_addr_ops },
 	{ "vm-addr-method",	1,	0,	OPT_vm_addr_method },
 	{ "vm-rw",		1,	0,	OPT_vm_rw },
+	{ "vm-rw-bench",	0,	0,	OPT_vm_rw_bench },
 	{ "vm-rw-bytes",	1,	0,	OPT_vm_rw_bytes },
+	{ "vm-rw-threads",	1,	0,	OPT_vm_rw_threads },
 	{ "vm-rw-ops",		1,	0,	OPT_vm_rw_ops },
 	{ "vm-segv",		1,	0,	OPT_vm_segv },
 	{ "vm-segv-ops",	1,	0,	OPT_vm_segv_ops },
@@ -1101,29 +1454,54 @@ static const struct option long_options[] = {
 	{ "vmstat",		1,	0,	OPT_vmstat },
 	{ "wait",		1,	0,	OPT_wait },
 	{ "wait-ops",		1,	0,	OPT_wait_ops },
+	{ "warmup",		1,	0,	OPT_warmup },
+	{ "waves",		0,	0,	OPT_waves },
 	{ "watchdog",		1,	0,	OPT_watchdog },
 	{ "watchdog-ops",	1,	0,	OPT_watchdog_ops },
 	{ "wcs",		1,	0,	OPT_wcs},
 	{ "wcs-ops",		1,	0,	OPT_wcs_ops },
 	{ "wcs-method",		1,	0,	OPT_wcs_method },
+	{ "wcs-sweep",		0,	0,	OPT_wcs_sweep },
+	{ "worker-pool",	0,	0,	OPT_worker_pool },
+	{ "worksteal",		1,	0,	OPT_worksteal },
+	{ "worksteal-ops",	1,	0,	OPT_worksteal_ops },
+	{ "worksteal-depth",	1,	0,	OPT_worksteal_depth },
+	{ "worksteal-grain",	1,	0,	OPT_worksteal_grain },
+	{ "worksteal-park",	1,	0,	OPT_worksteal_park },
+	{ "wss",		0,	0,	OPT_wss },
+	{ "wss-interval",	1,	0,	OPT_wss_interval },
+	{ "wss-timeline",	1,	0,	OPT_wss_timeline },
+	{ "worksteal-threads",	1,	0,	OPT_worksteal_threads },
+	{ "writeback",		1,	0,	OPT_writeback },
+	{ "writeback-ops",	1,	0,	OPT_writeback_ops },
+	{ "writeback-bytes",	1,	0,	OPT_writeback_bytes },
+	{ "writeback-rate",	1,	0,	OPT_writeback_rate },
 	{ "x86syscall",		1,	0,	OPT_x86syscall },
 	{ "x86syscall-ops",	1,	0,	OPT_x86syscall_ops },
 	{ "x86syscall-func",	1,	0,	OPT_x86syscall_func },
 	{ "xattr",		1,	0,	OPT_xattr },
 	{ "xattr-ops",		1,	0,	OPT_xattr_ops },
+	{ "xattr-bench",	0,	0,	OPT_xattr_bench },
+	{ "xattr-threads",	1,	0,	OPT_xattr_threads },
 	{ "yaml",		1,	0,	OPT_yaml },
 	{ "yield",		1,	0,	OPT_yield },
 	{ "yield-ops",		1,	0,	OPT_yield_ops },
 	{ "zero",		1,	0,	OPT_zero },
 	{ "zero-ops",		1,	0,	OPT_zero_ops },
+	{ "zerocopy",		1,	0,	OPT_zerocopy },
+	{ "zerocopy-ops",	1,	0,	OPT_zerocopy_ops },
+	{ "zerocopy-bytes",	1,	0,	OPT_zerocopy_bytes },
+	{ "zerocopy-method",	1,	0,	OPT_zerocopy_method },
 	{ "zlib",		1,	0,	OPT_zlib },
 	{ "zlib-ops",		1,	0,	OPT_zlib_ops },
 	{ "zlib-method",	1,	0,	OPT_zlib_method },
+	{ "zlib-codec",		1,	0,	OPT_zlib_codec },
 	{ "zlib-level",		1,	0,	OPT_zlib_level },
 	{ "zlib-mem-level",	1,	0,	OPT_zlib_mem_level },
 	{ "zlib-window-bits",	1,	0,	OPT_zlib_window_bits },
 	{ "zlib-stream-bytes",	1,	0,	OPT_zlib_stream_bytes, },
 	{ "zlib-strategy",	1,	0,	OPT_zlib_strategy, },
+	{ "zlib-threads",	1,	0,	OPT_zlib_threads },
 	{ "zombie",		1,	0,	OPT_zombie },
 	{ "zombie-ops",		1,	0,	OPT_zombie_ops },
 	{ "zombie-max",		1,	0,	OPT_zombie_max },
@@ -1138,14 +1516,37 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"aggressive",		"enable all aggressive options" },
 	{ "a N",	"all N",		"start N workers of each stress test" },
 	{ "b N",	"backoff N",		"wait of N microseconds before work starts" },
+	{ NULL,		"cgroup M",		"run stressors in cgroup v2 groups per M: stressor or class" },
+	{ NULL,		"cgroup-cpu-max C",	"limit each cgroup to C CPUs or a \"quota period\" cpu.max" },
+	{ NULL,		"cgroup-cpuset-cpus L",	"limit each cgroup to the CPUs in list L" },
+	{ NULL,		"cgroup-cpuset-mems L",	"limit each cgroup to the memory nodes in list L" },
+	{ NULL,		"cgroup-io-max S",	"set the io.max of each cgroup to S" },
+	{ NULL,		"cgroup-memory-high B",	"throttle each cgroup above B bytes of memory" },
+	{ NULL,		"cgroup-memory-max B",	"limit each cgroup to B bytes of memory" },
 	{ NULL,		"class name",		"specify a class of stressors, use with --sequential" },
+	{ NULL,		"compare file",		"compare the bogo-ops rates against a baseline YAML file" },
+	{ NULL,		"compare-threshold P",	"fail the --compare if a stressor is more than P% slower" },
+	{ NULL,		"cooldown T",		"exclude the last T seconds of the run from the metrics" },
+	{ NULL,		"cpuidle",		"report C-state entries and residency of each stressor" },
+	{ NULL,		"csv file",		"output per instance results to CSV file" },
 	{ "n",		"dry-run",		"do not run" },
+	{ NULL,		"fleet host:port,...",	"run the --job on fleet agents with a synchronized start" },
+	{ NULL,		"fleet-agent [host:]port", "run jobs sent by a --fleet coordinator" },
+	{ NULL,		"fleet-delay N",	"start the --fleet run N seconds after the job is sent" },
+	{ NULL,		"fleet-outlier P",	"flag --fleet nodes more than P% from the median" },
+	{ NULL,		"fleet-secret F",	"authenticate --fleet connections with the secret in file F" },
+	{ NULL,		"freq-stats",		"report the effective CPU frequency and throttling of each stressor" },
 	{ NULL,		"ftrace",		"enable kernel function call tracing" },
+	{ NULL,		"ftrace-baseline f",	"compare the ftrace profile of each stressor with a previous --yaml file" },
+	{ NULL,		"ftrace-top N",		"report the N hottest kernel functions of each stressor" },
+	{ NULL,		"harness-overhead",	"measure the stress-ng harness cost per bogo-op and report it" },
 	{ "h",		"help",			"show help" },
 	{ NULL,		"ignite-cpu",		"alter kernel controls to make CPU run hot" },
+	{ NULL,		"instance-mode M",	"run thread safe stressor instances as processes or threads" },
 	{ NULL,		"ionice-class C",	"specify ionice class (idle, besteffort, realtime)" },
 	{ NULL,		"ionice-level L",	"specify ionice level (0 max, 7 min)" },
 	{ "j",		"job jobfile",		"run the named jobfile" },
+	{ NULL,		"json file",		"output results to JSON file" },
 	{ "k",		"keep-name",		"keep stress worker names to be 'stress-ng'" },
 	{ NULL,		"keep-files",		"do not remove files or directories" },
 	{ NULL,		"klog-check",		"check kernel message log for errors" },
@@ -1154,35 +1555,61 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"maximize",		"enable maximum stress options" },
 	{ NULL,		"max-fd",		"set maximum file descriptor limit" },
 	{ NULL,		"mbind",		"set NUMA memory binding to specific nodes" },
+	{ NULL,		"mem-backing B",	"memory stressor page backing: 4k, thp, 2m or 1g" },
 	{ "M",		"metrics",		"print pseudo metrics of activity" },
 	{ NULL,		"metrics-brief",	"enable metrics and only show non-zero results" },
+	{ NULL,		"metrics-interval N",	"show bogo-ops rates of stressors every N seconds" },
+	{ NULL,		"metrics-interval-csv f","output --metrics-interval samples to CSV file f" },
 	{ NULL,		"minimize",		"enable minimal stress options" },
 	{ NULL,		"no-madvise",		"don't use random madvise options for each mmap" },
+	{ NULL,		"node-alloc M",		"allocate stressor data structure nodes with libc or arena" },
 	{ NULL,		"no-rand-seed",		"seed random numbers with the same constant" },
 	{ NULL,		"oomable",		"Do not respawn a stressor if it gets OOM'd" },
+	{ NULL,		"openmetrics file",	"write live OpenMetrics text file for a textfile collector" },
+	{ NULL,		"openmetrics-interval N","update the --openmetrics file every N seconds" },
 	{ NULL,		"page-in",		"touch allocated pages that are not in core" },
 	{ NULL,		"parallel N",		"synonym for 'all N'" },
 	{ NULL,		"pathological",		"enable stressors that are known to hang a machine" },
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ NULL,		"perf",			"display perf statistics" },
+	{ NULL,		"perf-uncore",		"report DRAM and cross-socket link bandwidth per stressor" },
 #endif
+	{ NULL,		"placement P",		"pin instances to CPUs: spread, compact, per-core, per-llc, per-node, smt-pairs" },
+	{ NULL,		"psi",			"report pressure stall information of each stressor (Linux only)" },
+	{ NULL,		"psi-cgroup",		"run each stressor in its own cgroup and report its pressure" },
 	{ "q",		"quiet",		"quiet output" },
 	{ "r",		"random N",		"start N random workers" },
+	{ NULL,		"rapl",			"report RAPL energy, power and bogo-ops per joule of each stressor" },
+	{ NULL,		"repeat N",		"run the stressors N times and summarize the run to run variation" },
+	{ NULL,		"repeat-cv P",		"warn if the --repeat coefficient of variation exceeds P%" },
+	{ NULL,		"repeat-warmup N",	"discard N warm-up runs before the --repeat runs" },
+	{ NULL,		"resctrl",		"report resctrl memory bandwidth and LLC occupancy per stressor" },
+	{ NULL,		"resctrl-interval N",	"sample resctrl monitoring data every N seconds" },
+	{ NULL,		"resctrl-l3-ways N",	"allocate N L3 cache ways (CAT) to each stressor" },
+	{ NULL,		"resctrl-mb P",		"allocate P% memory bandwidth (MBA) to each stressor" },
+	{ NULL,		"sample N",		"sample system counters and bogo-ops rates every N seconds" },
+	{ NULL,		"sample-file f",	"output --sample rows to CSV file f" },
+	{ NULL,		"scale-sweep L",	"run the stressors with each instance count in list L or auto" },
 	{ NULL,		"sched type",		"set scheduler type" },
 	{ NULL,		"sched-prio N",		"set scheduler priority level N" },
 	{ NULL,		"sched-period N",	"set period for SCHED_DEADLINE to N nanosecs (Linux only)" },
 	{ NULL,		"sched-runtime N",	"set runtime for SCHED_DEADLINE to N nanosecs (Linux only)" },
 	{ NULL,		"sched-deadline N",	"set deadline for SCHED_DEADLINE to N nanosecs (Linux only)" },
 	{ NULL,		"sched-reclaim",        "set reclaim cpu bandwidth for deadline scheduler (Linux only)" },
+	{ NULL,		"schedstat",		"report run queue wait time of each stressor (Linux only)" },
 	{ NULL,		"seed N",		"set the random number generator seed with a 64 bit value" },
 	{ NULL,		"sequential N",		"run all stressors one by one, invoking N of them" },
 	{ NULL,		"skip-silent",		"silently skip unimplemented stressors" },
 	{ NULL,		"stressors",		"show available stress tests" },
 	{ NULL,		"smart",		"show changes in S.M.A.R.T. data" },
+	{ NULL,		"sync-start",		"start all stressor instances at the same time" },
+	{ NULL,		"syscall-stats",	"report per stressor system call counts and latencies" },
 #if defined(HAVE_SYSLOG_H)
 	{ NULL,		"syslog",		"log messages to the syslog" },
 #endif
+	{ NULL,		"target-cpu P",		"throttle stressors to hold P% system CPU utilization" },
+	{ NULL,		"target-ops N",		"throttle each stressor to N bogo-ops per second" },
 	{ NULL,		"taskset",		"use specific CPUs (set CPU affinity)" },
 	{ NULL,		"temp-path path",	"specify path for temporary directories and files" },
 	{ NULL,		"thrash",		"force all pages in causing swap thrashing" },
@@ -1195,8 +1622,16 @@ static const stress_help_t help_generic[] = {
 #endif
 	{ "v",		"verbose",		"verbose output" },
 	{ NULL,		"verify",		"verify results (not available on all tests)" },
+	{ NULL,		"verify-sample N",	"verify 1 in N ops of stressors that support sampling" },
+	{ NULL,		"verify-sample-mode M",	"verify sampling, M = stride or random" },
 	{ NULL,		"verifiable",		"show stressors that enable verification via --verify" },
 	{ "V",		"version",		"show version" },
+	{ NULL,		"warmup T",		"exclude the first T seconds of the run from the metrics" },
+	{ NULL,		"waves",		"run --sequential stressors in waves of non-conflicting stressors" },
+	{ NULL,		"worker-pool",		"keep pre-forked workers alive across --sequential stressors" },
+	{ NULL,		"wss",			"report RSS, PSS and working set size of each stressor" },
+	{ NULL,		"wss-interval N",	"sample the working set every N seconds" },
+	{ NULL,		"wss-timeline f",	"write the --wss samples to CSV file f" },
 	{ "Y",		"yaml file",		"output results to YAML formatted file" },
 	{ "x",		"exclude",		"list of stressors to exclude (not run)" },
 	{ NULL,		NULL,			NULL }
@@ -1277,6 +1712,21 @@ static uint32_t stress_get_class_id(char *const str)
 	return 0;
 }
 
+/*
+ *  stress_get_class_name()
+ *	name of the first class in a class bit mask
+ */
+const char *stress_get_class_name(const uint32_t class)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(classes); i++) {
+		if (class & classes[i].class)
+			return classes[i].name;
+	}
+	return "unknown";
+}
+
 /*
  *  stress_get_class()
  *	parse for allowed class types, return bit mask of types, 0 if error
@@ -1838,6 +2288,395 @@ static void stress_clean_dir(
 	}
 }
 
+/*
+ *  stress_wait_status()
+ *	report how stressor instance j (process ret) exited
+ *	with wait status status and mark it as finished
+ */
+static void MLOCKED_TEXT stress_wait_status(
+	stress_stressor_t *ss,
+	const int32_t j,
+	const pid_t ret,
+	const int status,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stats_t *const stats = ss->stats[j];
+	int wexit_status = WEXITSTATUS(status);
+	bool do_abort = false;
+	const char *stressor_name = stress_munge_underscore(ss->stressor->name);
+	char name[64];
+
+	(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
+			stress_munge_underscore(stressor_name));
+
+	if (WIFSIGNALED(status)) {
+#if defined(WTERMSIG)
+		const int wterm_signal = WTERMSIG(status);
+
+		if (wterm_signal != SIGALRM) {
+#if NEED_GLIBC(2,1,0)
+			const char *signame = strsignal(wterm_signal);
+
+			pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d (%s)\n",
+				ret, stressor_name, wterm_signal, signame);
+#else
+			pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d\n",
+				ret, stressor_name, wterm_signal);
+#endif
+		}
+#else
+		pr_dbg("process [%d] (stress-ng-%s) terminated on signal\n",
+			ret, stressor_name);
+#endif
+		/*
+		 *  If the stressor got killed by OOM or SIGKILL
+		 *  then somebody outside of our control nuked it
+		 *  so don't necessarily flag that up as a direct
+		 *  failure.
+		 */
+		if (stress_process_oomed(ret)) {
+			pr_dbg("process [%d] (stress-ng-%s) was killed by the OOM killer\n",
+				ret, stressor_name);
+		} else if (WTERMSIG(status) == SIGKILL) {
+			pr_dbg("process [%d] (stress-ng-%s) was possibly killed by the OOM killer\n",
+				ret, stressor_name);
+		} else {
+			*success = false;
+		}
+	}
+	switch (wexit_status) {
+	case EXIT_SUCCESS:
+		break;
+	case EXIT_NO_RESOURCE:
+		pr_err_skip("process [%d] (stress-ng-%s) aborted early, out of system resources\n",
+			ret, stressor_name);
+		*resource_success = false;
+		do_abort = true;
+		break;
+	case EXIT_NOT_IMPLEMENTED:
+		do_abort = true;
+		break;
+	case EXIT_SIGNALED:
+		do_abort = true;
+#if defined(STRESS_REPORT_EXIT_SIGNALED)
+		pr_dbg("process [%d] (stress-ng-%s) aborted via a termination signal\n",
+			ret, stressor_name);
+#endif
+		break;
+	case EXIT_BY_SYS_EXIT:
+		pr_dbg("process [%d] (stress-ng-%s) aborted via exit() which was not expected\n",
+			ret, stressor_name);
+		do_abort = true;
+		break;
+	case EXIT_METRICS_UNTRUSTWORTHY:
+		*metrics_success = false;
+		break;
+	case EXIT_FAILURE:
+		/*
+		 *  Stressors should really return EXIT_NOT_SUCCESS
+		 *  as EXIT_FAILURE should indicate a core stress-ng
+		 *  problem.
+		 */
+		wexit_status = EXIT_NOT_SUCCESS;
+		CASE_FALLTHROUGH;
+	default:
+		pr_err("process [%d] (stress-ng-%s) terminated with an error, exit status=%d (%s)\n",
+			ret, stressor_name, wexit_status,
+			stress_exit_status_to_string(wexit_status));
+		*success = false;
+		do_abort = true;
+		break;
+	}
+	if ((g_opt_flags & OPT_FLAGS_ABORT) && do_abort) {
+		keep_stressing_set_flag(false);
+		wait_flag = false;
+		stress_kill_stressors(SIGALRM);
+	}
+
+	stress_stressor_finished(&stats->pid);
+	pr_dbg("process [%d] terminated\n", ret);
+
+	stress_clean_dir(name, ret, (uint32_t)j);
+}
+
+/*
+ *  stress_wait_pid()
+ *	wait for and reap stressor instance j, report how it exited
+ */
+static void MLOCKED_TEXT stress_wait_pid(
+	stress_stressor_t *ss,
+	const int32_t j,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stats_t *const stats = ss->stats[j];
+	const pid_t pid = stats->pid;
+redo:
+	if (pid) {
+		int status, ret;
+
+		ret = shim_waitpid(pid, &status, 0);
+		if (ret > 0) {
+			stress_wait_status(ss, j, ret, status,
+				success, resource_success, metrics_success);
+		} else if (ret == -1) {
+			/* Somebody interrupted the wait */
+			if (errno == EINTR)
+				goto redo;
+			/* This child did not exist, mark it done anyhow */
+			if (errno == ECHILD)
+				stress_stressor_finished(&stats->pid);
+		}
+	}
+}
+
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1) &&	\
+    defined(EPOLLIN)
+/*
+ *  stress_wait_pidfds()
+ *	reap the stressors in the order they exit by waiting on
+ *	their pidfds with epoll rather than blocking on each pid in
+ *	turn. Instances that cannot get a pidfd (e.g. pre Linux 5.3
+ *	or out of file descriptors) are left for the caller to reap
+ */
+static void MLOCKED_TEXT stress_wait_pidfds(
+	stress_stressor_t *stressors_list,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	typedef struct {
+		stress_stressor_t *ss;	/* stressor */
+		int32_t j;		/* instance */
+		int pidfd;		/* pidfd, -1 once reaped */
+	} stress_pidfd_t;
+
+	stress_stressor_t *ss;
+	stress_pidfd_t *pidfds;
+	size_t n = 0, i, waiting = 0;
+	int epoll_fd;
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n += (size_t)ss->started_instances;
+	if (!n)
+		return;
+	pidfds = (stress_pidfd_t *)calloc(n, sizeof(*pidfds));
+	if (!pidfds)
+		return;
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		free(pidfds);
+		return;
+	}
+
+	n = 0;
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			const pid_t pid = ss->stats[j]->pid;
+			struct epoll_event ev;
+			int pidfd;
+
+			if (!pid)
+				continue;
+			pidfd = shim_pidfd_open(pid, 0);
+			if (pidfd < 0)
+				continue;
+			(void)memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.u64 = (uint64_t)n;
+			if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pidfd, &ev) < 0) {
+				(void)close(pidfd);
+				continue;
+			}
+			pidfds[n].ss = ss;
+			pidfds[n].j = j;
+			pidfds[n].pidfd = pidfd;
+			n++;
+			waiting++;
+		}
+	}
+
+	while (waiting) {
+		struct epoll_event events[64];
+		int ret, k;
+
+		ret = epoll_wait(epoll_fd, events, (int)SIZEOF_ARRAY(events), -1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (k = 0; k < ret; k++) {
+			stress_pidfd_t *p = &pidfds[events[k].data.u64];
+
+			/* a readable pidfd means the child has exited */
+			stress_wait_pid(p->ss, p->j, success, resource_success, metrics_success);
+			(void)epoll_ctl(epoll_fd, EPOLL_CTL_DEL, p->pidfd, NULL);
+			(void)close(p->pidfd);
+			p->pidfd = -1;
+			waiting--;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (pidfds[i].pidfd >= 0)
+			(void)close(pidfds[i].pidfd);
+	}
+	(void)close(epoll_fd);
+	free(pidfds);
+}
+#endif
+
+#define STRESS_POOL_IDLE	(0)	/* worker waiting for a job */
+#define STRESS_POOL_RUN		(1)	/* worker running a job */
+#define STRESS_POOL_DONE	(2)	/* job finished, status is valid */
+#define STRESS_POOL_EXIT	(3)	/* worker should exit */
+
+#if defined(W_EXITCODE)
+#define STRESS_POOL_EXITCODE(rc)	W_EXITCODE(rc, 0)
+#else
+#define STRESS_POOL_EXITCODE(rc)	(((rc) & 0xff) << 8)
+#endif
+
+/* --worker-pool worker slot, shared by the parent and pool worker */
+typedef struct {
+	int state;			/* STRESS_POOL_* job state, futex word */
+	pid_t worker;			/* worker pid, 0 if not running */
+	pid_t pid;			/* pid of the process that ran the job */
+	int status;			/* job wait status */
+	stress_stressor_t *stressor;	/* stressor to run */
+	stress_checksum_t *checksum;	/* instance checksum */
+	int64_t backoff;		/* start backoff */
+	int32_t started_instances;	/* instances started before this one */
+	double fork_time_start;		/* time the job was dispatched */
+} stress_pool_slot_t;
+
+static stress_pool_slot_t *stress_pool;	/* --worker-pool slots, NULL if no pool */
+static int32_t stress_pool_workers;	/* number of --worker-pool slots */
+
+/*
+ *  stress_pool_slot()
+ *	return the --worker-pool slot running instance j of stressor ss,
+ *	NULL if the instance is not running in a pool worker
+ */
+static stress_pool_slot_t *stress_pool_slot(const stress_stressor_t *ss, const int32_t j)
+{
+	stress_pool_slot_t *slot;
+
+	if (!stress_pool || (j >= stress_pool_workers))
+		return NULL;
+	slot = &stress_pool[j];
+	if ((slot->stressor != ss) || !slot->worker || (ss->stats[j]->pid != slot->worker))
+		return NULL;
+	return slot;
+}
+
+/*
+ *  stress_pool_state()
+ *	read the job state of a --worker-pool slot, the acquire
+ *	pairs with the release in stress_pool_state_store() so the
+ *	job fields written before the state change are visible
+ */
+static inline int stress_pool_state(const stress_pool_slot_t *slot)
+{
+#if defined(HAVE_ATOMIC_LOAD)
+	return __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+#else
+	const int state = *(const volatile int *)&slot->state;
+
+	shim_mb();
+	return state;
+#endif
+}
+
+/*
+ *  stress_pool_state_store()
+ *	publish the job state of a --worker-pool slot
+ */
+static inline void stress_pool_state_store(stress_pool_slot_t *slot, const int state)
+{
+#if defined(HAVE_ATOMIC_STORE)
+	__atomic_store_n(&slot->state, state, __ATOMIC_RELEASE);
+#else
+	shim_mb();
+	*(volatile int *)&slot->state = state;
+#endif
+}
+
+/*
+ *  stress_pool_state_set()
+ *	set the job state of a --worker-pool slot and wake the other side
+ */
+static void stress_pool_state_set(stress_pool_slot_t *slot, const int state)
+{
+	stress_pool_state_store(slot, state);
+	(void)shim_futex_wake(&slot->state, 1);
+}
+
+/*
+ *  stress_pool_state_wait()
+ *	wait up to nsec nanoseconds for the job state of
+ *	a --worker-pool slot to change from state
+ */
+static void stress_pool_state_wait(stress_pool_slot_t *slot, const int state, const long nsec)
+{
+	struct timespec ts;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = nsec;
+	if ((shim_futex_wait(&slot->state, state, &ts) < 0) && (errno == ENOSYS))
+		(void)shim_usleep((useconds_t)(nsec / 1000));
+}
+
+/*
+ *  stress_pool_wait()
+ *	wait for the stressor instances running in --worker-pool workers
+ *	to finish, a worker that died is reported as the stressor
+ */
+static void MLOCKED_TEXT stress_pool_wait(
+	stress_stressor_t *stressors_list,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		for (j = 0; j < ss->started_instances; j++) {
+			stress_pool_slot_t *slot = stress_pool_slot(ss, j);
+
+			if (!slot)
+				continue;
+			while (stress_pool_state(slot) == STRESS_POOL_RUN) {
+				int status;
+				const pid_t worker = slot->worker;
+
+				if (waitpid(worker, &status, WNOHANG) == worker) {
+					slot->worker = 0;
+					stress_pool_state_store(slot, STRESS_POOL_IDLE);
+					stress_wait_status(ss, j, worker, status,
+						success, resource_success, metrics_success);
+					break;
+				}
+				stress_pool_state_wait(slot, STRESS_POOL_RUN, 100000000L);
+			}
+			if (stress_pool_state(slot) == STRESS_POOL_DONE) {
+				stress_wait_status(ss, j, slot->pid, slot->status,
+					success, resource_success, metrics_success);
+				stress_pool_state_store(slot, STRESS_POOL_IDLE);
+			}
+		}
+	}
+}
+
 /*
  *  stress_wait_stressors()
  * 	wait for stressor child processes
@@ -1894,10 +2733,17 @@ static void MLOCKED_TEXT stress_wait_stressors(
 						cpu_set_t mask;
 						int32_t cpu_num;
 						int status, ret;
+						const stress_pool_slot_t *slot = stress_pool_slot(ss, j);
 
-						ret = waitpid(pid, &status, WNOHANG);
-						if ((ret < 0) && (errno == ESRCH))
-							continue;
+						if (slot) {
+							/* pool workers outlive their stressor */
+							if (stress_pool_state(slot) != STRESS_POOL_RUN)
+								continue;
+						} else {
+							ret = waitpid(pid, &status, WNOHANG);
+							if ((ret < 0) && (errno == ESRCH))
+								continue;
+						}
 						procs_alive = true;
 
 						do {
@@ -1917,125 +2763,19 @@ static void MLOCKED_TEXT stress_wait_stressors(
 	}
 do_wait:
 #endif
+	if (stress_pool)
+		stress_pool_wait(stressors_list, success, resource_success, metrics_success);
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1) &&	\
+    defined(EPOLLIN)
+	stress_wait_pidfds(stressors_list, success, resource_success, metrics_success);
+#endif
+	/* reap any instances not reaped via their pidfds */
 	for (ss = stressors_list; ss; ss = ss->next) {
 		int32_t j;
 
-		for (j = 0; j < ss->started_instances; j++) {
-			stress_stats_t *const stats = ss->stats[j];
-			const pid_t pid = stats->pid;
-redo:
-			if (pid) {
-				int status, ret;
-				bool do_abort = false;
-				const char *stressor_name = stress_munge_underscore(ss->stressor->name);
-				char name[64];
-
-				(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
-                                        stress_munge_underscore(stressor_name));
-
-				ret = shim_waitpid(pid, &status, 0);
-				if (ret > 0) {
-					int wexit_status = WEXITSTATUS(status);
-
-					if (WIFSIGNALED(status)) {
-#if defined(WTERMSIG)
-						const int wterm_signal = WTERMSIG(status);
-
-						if (wterm_signal != SIGALRM) {
-#if NEED_GLIBC(2,1,0)
-							const char *signame = strsignal(wterm_signal);
-
-							pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d (%s)\n",
-								ret, stressor_name, wterm_signal, signame);
-#else
-							pr_dbg("process [%d] (stress-ng-%s) terminated on signal: %d\n",
-								ret, stressor_name, wterm_signal);
-#endif
-						}
-#else
-						pr_dbg("process [%d] (stress-ng-%s) terminated on signal\n",
-							ret, stressor_name);
-#endif
-						/*
-						 *  If the stressor got killed by OOM or SIGKILL
-						 *  then somebody outside of our control nuked it
-						 *  so don't necessarily flag that up as a direct
-						 *  failure.
-						 */
-						if (stress_process_oomed(ret)) {
-							pr_dbg("process [%d] (stress-ng-%s) was killed by the OOM killer\n",
-								ret, stressor_name);
-						} else if (WTERMSIG(status) == SIGKILL) {
-							pr_dbg("process [%d] (stress-ng-%s) was possibly killed by the OOM killer\n",
-								ret, stressor_name);
-						} else {
-							*success = false;
-						}
-					}
-					switch (wexit_status) {
-					case EXIT_SUCCESS:
-						break;
-					case EXIT_NO_RESOURCE:
-						pr_err_skip("process [%d] (stress-ng-%s) aborted early, out of system resources\n",
-							ret, stressor_name);
-						*resource_success = false;
-						do_abort = true;
-						break;
-					case EXIT_NOT_IMPLEMENTED:
-						do_abort = true;
-						break;
-					case EXIT_SIGNALED:
-						do_abort = true;
-#if defined(STRESS_REPORT_EXIT_SIGNALED)
-						pr_dbg("process [%d] (stress-ng-%s) aborted via a termination signal\n",
-							ret, stressor_name);
-#endif
-						break;
-					case EXIT_BY_SYS_EXIT:
-						pr_dbg("process [%d] (stress-ng-%s) aborted via exit() which was not expected\n",
-							ret, stressor_name);
-						do_abort = true;
-						break;
-					case EXIT_METRICS_UNTRUSTWORTHY:
-						*metrics_success = false;
-						break;
-					case EXIT_FAILURE:
-						/*
-						 *  Stressors should really return EXIT_NOT_SUCCESS
-						 *  as EXIT_FAILURE should indicate a core stress-ng
-						 *  problem.
-						 */
-						wexit_status = EXIT_NOT_SUCCESS;
-						CASE_FALLTHROUGH;
-					default:
-						pr_err("process [%d] (stress-ng-%s) terminated with an error, exit status=%d (%s)\n",
-							ret, stressor_name, wexit_status,
-							stress_exit_status_to_string(wexit_status));
-						*success = false;
-						do_abort = true;
-						break;
-					}
-					if ((g_opt_flags & OPT_FLAGS_ABORT) && do_abort) {
-						keep_stressing_set_flag(false);
-						wait_flag = false;
-						stress_kill_stressors(SIGALRM);
-					}
-
-					stress_stressor_finished(&stats->pid);
-					pr_dbg("process [%d] terminated\n", ret);
-
-					stress_clean_dir(name, pid, (uint32_t)j);
-
-				} else if (ret == -1) {
-					/* Somebody interrupted the wait */
-					if (errno == EINTR)
-						goto redo;
-					/* This child did not exist, mark it done anyhow */
-					if (errno == ECHILD)
-						stress_stressor_finished(&stats->pid);
-				}
-			}
-		}
+		for (j = 0; j < ss->started_instances; j++)
+			stress_wait_pid(ss, j, success, resource_success, metrics_success);
 	}
 	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
 		stress_ignite_cpu_stop();
@@ -2186,215 +2926,903 @@ static void stress_getrusage(const int who, stress_stats_t *stats)
 #endif
 
 /*
- *  stress_run()
- *	kick off and run stressors
+ *  stress_sync_start_init()
+ *	create the --sync-start barrier, instances block reading
+ *	the barrier pipe until the parent closes the write end
  */
-static void MLOCKED_TEXT stress_run(
-	stress_stressor_t *stressors_list,
-	double *duration,
-	bool *success,
-	bool *resource_success,
-	bool *metrics_success,
-	stress_checksum_t **checksum)
+static void stress_sync_start_init(void)
 {
-	double time_start, time_finish;
-	int32_t started_instances = 0;
-	const size_t page_size = stress_get_page_size();
+	g_shared->sync_start_time = 0.0;
+	if (!(g_opt_flags & OPT_FLAGS_SYNC_START))
+		return;
 
-	wait_flag = true;
-	time_start = stress_time_now();
-	pr_dbg("starting stressors\n");
+	if (pipe(sync_start_fds) < 0) {
+		pr_inf("sync-start: cannot create start barrier pipe, errno=%d (%s), "
+			"instances will not be started synchronously\n",
+			errno, strerror(errno));
+		sync_start_fds[0] = -1;
+		sync_start_fds[1] = -1;
+	}
+}
 
-	/*
-	 *  Work through the list of stressors to run
-	 */
-	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
-		int32_t j;
+/*
+ *  stress_sync_start_release()
+ *	release all the instances waiting on the start barrier
+ */
+static void stress_sync_start_release(void)
+{
+	if (sync_start_fds[1] < 0)
+		return;
 
-		/*
-		 *  Each stressor has 1 or more instances to run
-		 */
-		for (j = 0; j < g_stressor_current->num_instances; j++, (*checksum)++) {
-			int rc = EXIT_SUCCESS;
-			size_t i;
-			pid_t pid;
-			char name[64];
-			int64_t backoff = DEFAULT_BACKOFF;
-			int32_t ionice_class = UNDEFINED;
-			int32_t ionice_level = UNDEFINED;
-			stress_stats_t *const stats = g_stressor_current->stats[j];
-			double run_duration, fork_time_start;
+	g_shared->sync_start_time = stress_time_now();
+	(void)close(sync_start_fds[1]);
+	(void)close(sync_start_fds[0]);
+	sync_start_fds[0] = -1;
+	sync_start_fds[1] = -1;
+	pr_dbg("sync-start: released all stressor instances\n");
+}
 
-			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
-				goto abort;
+/*
+ *  stress_sync_start_wait()
+ *	wait in a stressor process for the start barrier to be
+ *	released, returns false if --sync-start is not in use
+ */
+static bool stress_sync_start_wait(void)
+{
+	if (sync_start_fds[0] < 0)
+		return false;
 
-			(void)stress_get_setting("backoff", &backoff);
-			(void)stress_get_setting("ionice-class", &ionice_class);
-			(void)stress_get_setting("ionice-level", &ionice_level);
+	(void)close(sync_start_fds[1]);
+	while (keep_stressing_flag()) {
+		char ch;
+		const ssize_t ret = read(sync_start_fds[0], &ch, sizeof(ch));
 
-			stats->counter_ready = true;
-			stats->counter = 0;
-			stats->checksum = *checksum;
-			for (i = 0; i < SIZEOF_ARRAY(stats->misc_stats); i++) {
-				stress_misc_stats_set(stats->misc_stats, i, "", -1.0);
-			}
-again:
-			if (!keep_stressing_flag())
-				break;
-			fork_time_start = stress_time_now();
-			pid = fork();
-			switch (pid) {
-			case -1:
-				if (errno == EAGAIN) {
-					(void)shim_usleep(100000);
-					goto again;
-				}
-				pr_err("Cannot fork: errno=%d (%s)\n",
-					errno, strerror(errno));
-				stress_kill_stressors(SIGALRM);
-				goto wait_for_stressors;
-			case 0:
-				/* Child */
-				(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
-					stress_munge_underscore(g_stressor_current->stressor->name));
-				stress_set_proc_state(name, STRESS_STATE_START);
+		/* EOF, the parent closed the write end */
+		if ((ret == 0) || ((ret < 0) && (errno != EINTR)))
+			break;
+	}
+	(void)close(sync_start_fds[0]);
+	sync_start_fds[0] = -1;
+	sync_start_fds[1] = -1;
 
-				(void)sched_settings_apply(true);
-				(void)atexit(stress_child_atexit);
-				if (stress_set_handler(name, true) < 0) {
-					rc = EXIT_FAILURE;
-					goto child_exit;
-				}
-				stress_parent_died_alarm();
-				stress_process_dumpable(false);
-				stress_set_timer_slack();
+	/* The run time starts from the barrier release */
+	if (g_opt_timeout)
+		(void)alarm((unsigned int)g_opt_timeout);
+
+	return true;
+}
+
+/*
+ *  stress_instance_stats_init()
+ *	reset the per instance stats before an instance is started
+ */
+static void stress_instance_stats_init(stress_stats_t *stats, stress_checksum_t *checksum)
+{
+	size_t i;
+
+	stats->ci.counter_ready = true;
+	stats->ci.counter = 0;
+	stats->checksum = checksum;
+	for (i = 0; i < SIZEOF_ARRAY(stats->misc_stats); i++) {
+		stress_misc_stats_set(stats->misc_stats, i, "", -1.0);
+	}
+	stress_latency_reset(&stats->latency);
+	stress_method_stats_reset(stats->method_stats);
+	if (stats->syscall_stats)
+		(void)memset(stats->syscall_stats, 0, sizeof(*stats->syscall_stats) * STRESS_SYSCALL_MAX);
+	(void)memset(&stats->window, 0, sizeof(stats->window));
+	stats->start = 0.0;
+}
+
+/*
+ *  stress_instance_init()
+ *	set up a newly forked stressor process
+ */
+static int MLOCKED_TEXT stress_instance_init(
+	const char *name,
+	const int32_t ionice_class,
+	const int32_t ionice_level)
+{
+	stress_set_proc_state(name, STRESS_STATE_START);
+
+	(void)sched_settings_apply(true);
+	(void)atexit(stress_child_atexit);
+	if (stress_set_handler(name, true) < 0)
+		return -1;
+	stress_parent_died_alarm();
+	stress_process_dumpable(false);
+	stress_set_timer_slack();
+
+	if (g_opt_timeout)
+		(void)alarm((unsigned int)g_opt_timeout);
+
+	stress_set_proc_state(name, STRESS_STATE_INIT);
+	stress_mwc_reseed();
+	stress_set_oom_adjustment(name, false);
+	stress_set_max_limits();
+	stress_set_iopriority(ionice_class, ionice_level);
+	(void)umask(0077);
+
+	return 0;
+}
+
+/*
+ *  stress_instance_stressor()
+ *	run the current stressor for the given instance, returns
+ *	the stressor exit status
+ */
+static int MLOCKED_TEXT stress_instance_stressor(
+	const char *name,
+	stress_stats_t *stats,
+	stress_checksum_t *checksum,
+	const int32_t instance,
+	const size_t page_size)
+{
+	int rc;
+	stress_schedstat_t schedstat;
+	stress_freq_state_t freq;
+	const stress_args_t args = {
+		.ci = &stats->ci,
+		.name = name,
+		.max_ops = g_stressor_current->bogo_ops,
+		.instance = (uint32_t)instance,
+		.num_instances = (uint32_t)g_stressor_current->num_instances,
+		.pid = getpid(),
+		.page_size = page_size,
+		.mapped = &g_shared->mapped,
+		.misc_stats = stats->misc_stats,
+		.latency = &stats->latency,
+		.method_stats = stats->method_stats
+	};
+
+	(void)memset(checksum, 0, sizeof(*checksum));
+	if (g_opt_flags & OPT_FLAGS_SCHEDSTAT)
+		(void)stress_schedstat_read(&schedstat);
+	if (g_opt_flags & OPT_FLAGS_FREQ_STATS)
+		stress_freq_stats_begin(&freq);
+	stress_verify_init();
+	rc = g_stressor_current->stressor->info->stressor(&args);
+	stats->verify_ops = g_verify.ops;
+	if (g_opt_flags & OPT_FLAGS_FREQ_STATS)
+		stress_freq_stats_end(&freq, &stats->freq);
+	if (g_opt_flags & OPT_FLAGS_SCHEDSTAT) {
+		(void)stress_schedstat_read(&stats->schedstat);
+		stress_schedstat_delta(&stats->schedstat, &schedstat);
+	}
+	stress_window_apply(name, stats);
+	pr_fail_check(&rc);
+	if (rc == EXIT_SUCCESS) {
+		stats->run_ok = true;
+		checksum->data.run_ok = true;
+	}
+
+	/*
+	 *  Bogo ops counter should be OK for reading,
+	 *  if not then flag up that the counter may
+	 *  be untrustyworthy
+	 */
+	if (!stats->ci.counter_ready) {
+		pr_warn("%s: WARNING: bogo-ops counter in non-ready state, "
+			"metrics are untrustworthy (process may have been "
+			"terminated prematurely)\n",
+			name);
+		rc = EXIT_METRICS_UNTRUSTWORTHY;
+	}
+	checksum->data.counter = args.ci->counter;
+	stress_hash_checksum(checksum);
+
+	return rc;
+}
 
-				if (g_opt_timeout)
-					(void)alarm((unsigned int)g_opt_timeout);
+/*
+ *  stress_instance_duration_check()
+ *	warn if a stressor instance apparently succeeded but
+ *	terminated early, this could be a bug
+ */
+static void stress_instance_duration_check(
+	const char *name,
+	const stress_stats_t *stats,
+	const double fork_time_start)
+{
+	/* Allow for some slops of ~0.5 secs */
+	const double run_duration = (stats->finish - fork_time_start) + 0.5;
+
+	if (stats->run_ok && !g_caught_sigint &&
+	    (run_duration < (double)g_opt_timeout) &&
+	    (!(g_stressor_current->bogo_ops && stats->ci.counter >= g_stressor_current->bogo_ops))) {
+
+		pr_warn("%s: WARNING: finished prematurely after just %.2fs%s\n",
+			name, run_duration, stress_duration_to_str((double)g_opt_timeout));
+	}
+}
+
+/*
+ *  stress_instance_exit()
+ *	tidy up and exit a stressor process
+ */
+static void NORETURN MLOCKED_TEXT stress_instance_exit(const char *name, int rc)
+{
+	stress_stressors_free();
+	stress_cache_free();
+	stress_settings_free();
+	stress_temp_path_free();
+	(void)stress_ftrace_free();
+
+	if ((rc != 0) && (g_opt_flags & OPT_FLAGS_ABORT)) {
+		keep_stressing_set_flag(false);
+		wait_flag = false;
+		(void)kill(getppid(), SIGALRM);
+	}
+	stress_set_proc_state(name, STRESS_STATE_EXIT);
+	if (terminate_signum)
+		rc = EXIT_SIGNALED;
+	_exit(rc);
+}
 
-				stress_set_proc_state(name, STRESS_STATE_INIT);
-				stress_mwc_reseed();
-				stress_set_oom_adjustment(name, false);
-				stress_set_max_limits();
-				stress_set_iopriority(ionice_class, ionice_level);
-				(void)umask(0077);
+/*
+ *  stress_instance_run()
+ *	run stressor instance j in an initialized stressor
+ *	process, returns the stressor exit status
+ */
+static int MLOCKED_TEXT stress_instance_run(
+	const char *name,
+	stress_stats_t *stats,
+	stress_checksum_t *checksum,
+	const int32_t j,
+	const size_t page_size,
+	const int64_t backoff,
+	const int32_t started_instances,
+	const double fork_time_start)
+{
+	int rc = EXIT_SUCCESS;
 
-				pr_dbg("%s: started [%d] (instance %" PRIu32 ")\n",
-					name, (int)getpid(), j);
+	pr_dbg("%s: started [%d] (instance %" PRIu32 ")\n",
+		name, (int)getpid(), j);
+	stress_placement_set(name, stats->placement_cpu);
 
-				stats->start = stats->finish = stress_time_now();
+	stats->start = stats->finish = stress_time_now();
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
-				if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-					(void)stress_perf_open(&stats->sp);
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+		(void)stress_perf_open(stats->sp);
 #endif
-				(void)shim_usleep((useconds_t)(backoff * started_instances));
+	if (stress_sync_start_wait())
+		stats->start = stats->finish = g_shared->sync_start_time;
+	else
+		(void)shim_usleep((useconds_t)(backoff * started_instances));
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
-				if (g_opt_flags & OPT_FLAGS_PERF_STATS)
-					(void)stress_perf_enable(&stats->sp);
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+		(void)stress_perf_enable(stats->sp);
 #endif
-				if (keep_stressing_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN)) {
-					const stress_args_t args = {
-						.counter = &stats->counter,
-						.counter_ready = &stats->counter_ready,
-						.name = name,
-						.max_ops = g_stressor_current->bogo_ops,
-						.instance = (uint32_t)j,
-						.num_instances = (uint32_t)g_stressor_current->num_instances,
-						.pid = getpid(),
-						.page_size = page_size,
-						.mapped = &g_shared->mapped,
-						.misc_stats = stats->misc_stats
-					};
-
-					(void)memset(*checksum, 0, sizeof(**checksum));
-					rc = g_stressor_current->stressor->info->stressor(&args);
-					pr_fail_check(&rc);
-					if (rc == EXIT_SUCCESS) {
-						stats->run_ok = true;
-						(*checksum)->data.run_ok = true;
-					}
+	if (keep_stressing_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN)) {
+		stress_syscall_stats_attach(stats->syscall_stats);
+		rc = stress_instance_stressor(name, stats, checksum, j, page_size);
+		stress_syscall_stats_attach(NULL);
 
-					/*
-					 *  We're done, cancel SIGALRM
-					 */
-					(void)alarm(0);
-
-					stress_set_proc_state(name, STRESS_STATE_STOP);
-					/*
-					 *  Bogo ops counter should be OK for reading,
-					 *  if not then flag up that the counter may
-					 *  be untrustyworthy
-					 */
-					if (!stats->counter_ready) {
-						pr_warn("%s: WARNING: bogo-ops counter in non-ready state, "
-							"metrics are untrustworthy (process may have been "
-							"terminated prematurely)\n",
-							name);
-						rc = EXIT_METRICS_UNTRUSTWORTHY;
-					}
-					(*checksum)->data.counter = *args.counter;
-					stress_hash_checksum(*checksum);
-				}
+		/*
+		 *  We're done, cancel SIGALRM
+		 */
+		(void)alarm(0);
+
+		stress_set_proc_state(name, STRESS_STATE_STOP);
+	}
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
-				if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
-					(void)stress_perf_disable(&stats->sp);
-					(void)stress_perf_close(&stats->sp);
-				}
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		(void)stress_perf_disable(stats->sp);
+		(void)stress_perf_close(stats->sp);
+	}
+#endif
+#if defined(STRESS_THERMAL_ZONES)
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+		(void)stress_tz_get_temperatures(&g_shared->tz_info, stats->tz);
+#endif
+	stats->finish = stress_time_now();
+#if defined(HAVE_GETRUSAGE)
+	stats->rusage_utime = 0.0;
+	stats->rusage_stime = 0.0;
+	stress_getrusage(RUSAGE_SELF, stats);
+	stress_getrusage(RUSAGE_CHILDREN, stats);
+#else
+	(void)memset(&stats->tms, 0, sizeof(stats->tms));
+	if (times(&stats->tms) == (clock_t)-1) {
+		pr_dbg("times failed: errno=%d (%s)\n",
+			errno, strerror(errno));
+	}
+#endif
+	pr_dbg("%s: exited [%d] (instance %" PRIu32 ")\n",
+		name, (int)getpid(), j);
+
+	stress_instance_duration_check(name, stats, fork_time_start);
+	stress_window_finish(stats);
+
+	return rc;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/* per instance thread info for --instance-mode threads */
+typedef struct {
+	pthread_t pthread;		/* instance thread */
+	const char *name;		/* stressor name */
+	stress_stats_t *stats;		/* instance stats */
+	stress_checksum_t *checksum;	/* instance checksum */
+	double fork_time_start;		/* time the process was forked */
+	size_t page_size;		/* page size */
+	int32_t instance;		/* stressor instance # */
+	int rc;				/* stressor exit status */
+	bool created;			/* true if thread was created */
+} stress_instance_thread_t;
+
+/*
+ *  stress_instance_thread()
+ *	run one stressor instance as a pthread
+ */
+static void *stress_instance_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_instance_thread_t *it = (stress_instance_thread_t *)arg;
+	stress_stats_t *const stats = it->stats;
+
+	pr_dbg("%s: started [%d] (instance %" PRIu32 ", thread)\n",
+		it->name, (int)getpid(), it->instance);
+	stress_placement_set(it->name, stats->placement_cpu);
+
+	stats->start = stats->finish = (g_shared->sync_start_time > 0.0) ?
+		g_shared->sync_start_time : stress_time_now();
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	/* perf events are per thread, so each instance measures itself */
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		(void)stress_perf_open(stats->sp);
+		(void)stress_perf_enable(stats->sp);
+	}
+#endif
+	if (keep_stressing_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN))
+		it->rc = stress_instance_stressor(it->name, stats,
+			it->checksum, it->instance, it->page_size);
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		(void)stress_perf_disable(stats->sp);
+		(void)stress_perf_close(stats->sp);
+	}
 #endif
+	stats->finish = stress_time_now();
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_THREAD)
+	stats->rusage_utime = 0.0;
+	stats->rusage_stime = 0.0;
+	stress_getrusage(RUSAGE_THREAD, stats);
+#endif
+	pr_dbg("%s: exited [%d] (instance %" PRIu32 ", thread)\n",
+		it->name, (int)getpid(), it->instance);
+
+	stress_instance_duration_check(it->name, stats, it->fork_time_start);
+	stress_window_finish(stats);
+
+	return &nowt;
+}
+
+/*
+ *  stress_instance_threads()
+ *	run all the instances of the current stressor as pthreads
+ *	in this process, returns the first failing exit status
+ */
+static int stress_instance_threads(
+	const char *name,
+	stress_checksum_t *checksum,
+	const double fork_time_start,
+	const size_t page_size)
+{
+	const int32_t num_instances = g_stressor_current->num_instances;
+	stress_instance_thread_t *its;
+	stress_stats_t *const stats = g_stressor_current->stats[0];
+	int32_t j;
+	int rc = EXIT_SUCCESS;
+
+	its = calloc((size_t)num_instances, sizeof(*its));
+	if (!its) {
+		pr_inf("%s: cannot allocate instance thread information, skipping stressor\n",
+			name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (j = 0; j < num_instances; j++) {
+		int ret;
+
+		its[j].name = name;
+		its[j].stats = g_stressor_current->stats[j];
+		its[j].checksum = &checksum[j];
+		its[j].fork_time_start = fork_time_start;
+		its[j].page_size = page_size;
+		its[j].instance = j;
+		its[j].rc = EXIT_SUCCESS;
+
+		ret = pthread_create(&its[j].pthread, NULL, stress_instance_thread, &its[j]);
+		if (ret) {
+			pr_inf("%s: cannot create instance %" PRId32 " thread, errno=%d (%s)\n",
+				name, j, ret, strerror(ret));
+			its[j].rc = EXIT_NO_RESOURCE;
+			continue;
+		}
+		its[j].created = true;
+	}
+
+	for (j = 0; j < num_instances; j++) {
+		if (its[j].created)
+			(void)pthread_join(its[j].pthread, NULL);
+		if ((rc == EXIT_SUCCESS) && (its[j].rc != EXIT_SUCCESS))
+			rc = its[j].rc;
+	}
+	free(its);
+
+	/*
+	 *  We're done, cancel SIGALRM
+	 */
+	(void)alarm(0);
+	stress_set_proc_state(name, STRESS_STATE_STOP);
+
 #if defined(STRESS_THERMAL_ZONES)
-				if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
-					(void)stress_tz_get_temperatures(&g_shared->tz_info, &stats->tz);
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+		(void)stress_tz_get_temperatures(&g_shared->tz_info, stats->tz);
 #endif
-				stats->finish = stress_time_now();
+	/*
+	 *  Process wide usage is accounted to the first instance
+	 */
 #if defined(HAVE_GETRUSAGE)
-				stats->rusage_utime = 0.0;
-				stats->rusage_stime = 0.0;
-				stress_getrusage(RUSAGE_SELF, stats);
-				stress_getrusage(RUSAGE_CHILDREN, stats);
+#if !defined(RUSAGE_THREAD)
+	stats->rusage_utime = 0.0;
+	stats->rusage_stime = 0.0;
+	stress_getrusage(RUSAGE_SELF, stats);
+#endif
+	stress_getrusage(RUSAGE_CHILDREN, stats);
 #else
-				(void)memset(&stats->tms, 0, sizeof(stats->tms));
-				if (times(&stats->tms) == (clock_t)-1) {
-					pr_dbg("times failed: errno=%d (%s)\n",
-						errno, strerror(errno));
+	(void)memset(&stats->tms, 0, sizeof(stats->tms));
+	if (times(&stats->tms) == (clock_t)-1) {
+		pr_dbg("times failed: errno=%d (%s)\n",
+			errno, strerror(errno));
+	}
+#endif
+	return rc;
+}
+
+/*
+ *  stress_run_threads()
+ *	fork a single process that runs all the instances of the
+ *	current stressor as pthreads, returns -1 if the fork failed
+ */
+static int MLOCKED_TEXT stress_run_threads(
+	stress_checksum_t *checksum,
+	int32_t *started_instances,
+	const size_t page_size)
+{
+	int32_t j;
+	pid_t pid;
+	int32_t ionice_class = UNDEFINED;
+	int32_t ionice_level = UNDEFINED;
+	double fork_time_start;
+
+	(void)stress_get_setting("ionice-class", &ionice_class);
+	(void)stress_get_setting("ionice-level", &ionice_level);
+
+	for (j = 0; j < g_stressor_current->num_instances; j++) {
+		stress_stats_t *const stats = g_stressor_current->stats[j];
+
+		stress_instance_stats_init(stats, &checksum[j]);
+		stats->placement_cpu = stress_placement_cpu(*started_instances + j);
+	}
+again:
+	if (!keep_stressing_flag())
+		return 0;
+	fork_time_start = stress_time_now();
+	pid = fork();
+	switch (pid) {
+	case -1:
+		if (errno == EAGAIN) {
+			(void)shim_usleep(100000);
+			goto again;
+		}
+		pr_err("Cannot fork: errno=%d (%s)\n",
+			errno, strerror(errno));
+		stress_kill_stressors(SIGALRM);
+		return -1;
+	case 0: {
+		/* Child */
+		char name[64];
+		int rc = EXIT_FAILURE;
+
+		(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
+			stress_munge_underscore(g_stressor_current->stressor->name));
+		if (stress_instance_init(name, ionice_class, ionice_level) == 0) {
+			(void)stress_sync_start_wait();
+			rc = stress_instance_threads(name, checksum, fork_time_start, page_size);
+		}
+		stress_instance_exit(name, rc);
+	}
+	default:
+		for (j = 0; j < g_stressor_current->num_instances; j++) {
+			stress_stats_t *const stats = g_stressor_current->stats[j];
+
+			stats->pid = pid;
+			stats->signalled = false;
+			g_stressor_current->started_instances++;
+			(*started_instances)++;
+		}
+		stress_ftrace_add_pid(pid);
+		break;
+	}
+	return 0;
+}
+#endif
+
+/*
+ *  stress_pool_job()
+ *	run the job in a --worker-pool slot, thread safe stressors have no
+ *	process wide state and run in the worker, other stressors get a
+ *	pristine process forked from the already initialized worker
+ */
+static void MLOCKED_TEXT stress_pool_job(
+	stress_pool_slot_t *slot,
+	const int32_t j,
+	const size_t page_size)
+{
+	stress_stressor_t *ss = slot->stressor;
+	stress_stats_t *const stats = ss->stats[j];
+	char name[64];
+	pid_t pid;
+
+	g_stressor_current = ss;
+	(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
+		stress_munge_underscore(ss->stressor->name));
+	stress_cgroup_enter(ss);
+	stress_resctrl_enter(ss);
+
+	/* cancel any SIGALRM rearmed by the previous job being stopped */
+	(void)alarm(0);
+	keep_stressing_set_flag(true);
+
+	if (ss->stressor->info->thread_safe) {
+#if defined(HAVE_GETRUSAGE)
+		struct rusage self, children;
+		const bool usage_ok = (shim_getrusage(RUSAGE_SELF, &self) == 0) &&
+				      (shim_getrusage(RUSAGE_CHILDREN, &children) == 0);
+#endif
+		int rc;
+
+		if (g_opt_timeout)
+			(void)alarm((unsigned int)g_opt_timeout);
+		rc = stress_instance_run(name, stats, slot->checksum, j, page_size,
+			slot->backoff, slot->started_instances, slot->fork_time_start);
+		(void)alarm(0);
+#if defined(HAVE_GETRUSAGE)
+		/* the worker usage includes the jobs it ran before */
+		if (usage_ok) {
+			stats->rusage_utime -= stress_timeval_to_double(&self.ru_utime) +
+					       stress_timeval_to_double(&children.ru_utime);
+			stats->rusage_stime -= stress_timeval_to_double(&self.ru_stime) +
+					       stress_timeval_to_double(&children.ru_stime);
+		}
+#endif
+		slot->pid = getpid();
+		slot->status = STRESS_POOL_EXITCODE(rc);
+		stress_set_proc_state(name, STRESS_STATE_WAIT);
+		return;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		pr_inf("%s: cannot fork pool job, errno=%d (%s)\n",
+			name, errno, strerror(errno));
+		slot->pid = getpid();
+		slot->status = STRESS_POOL_EXITCODE(EXIT_NO_RESOURCE);
+		return;
+	} else if (pid == 0) {
+		int rc;
+
+		stress_parent_died_alarm();
+		if (g_opt_timeout)
+			(void)alarm((unsigned int)g_opt_timeout);
+		stress_mwc_reseed();
+		rc = stress_instance_run(name, stats, slot->checksum, j, page_size,
+			slot->backoff, slot->started_instances, slot->fork_time_start);
+		stress_instance_exit(name, rc);
+	}
+
+	slot->pid = pid;
+	for (;;) {
+		int status;
+
+		if (waitpid(pid, &status, 0) == pid) {
+			slot->status = status;
+			break;
+		}
+		if (errno != EINTR) {
+			slot->status = STRESS_POOL_EXITCODE(EXIT_FAILURE);
+			break;
+		}
+		/* parent stopped the worker, pass it on to the job */
+		if (!keep_stressing_flag())
+			(void)kill(pid, SIGALRM);
+	}
+}
+
+/*
+ *  stress_pool_worker()
+ *	--worker-pool worker, set up the process once and
+ *	then run the jobs dispatched to slot until told
+ *	to exit or the parent goes away
+ */
+static void NORETURN MLOCKED_TEXT stress_pool_worker(
+	stress_pool_slot_t *slot,
+	const int32_t j,
+	const size_t page_size)
+{
+	const pid_t ppid = getppid();
+	int32_t ionice_class = UNDEFINED;
+	int32_t ionice_level = UNDEFINED;
+	char name[64];
+
+	(void)stress_get_setting("ionice-class", &ionice_class);
+	(void)stress_get_setting("ionice-level", &ionice_level);
+
+	(void)snprintf(name, sizeof(name), "%s-pool", g_app_name);
+	if (stress_instance_init(name, ionice_class, ionice_level) < 0)
+		stress_instance_exit(name, EXIT_FAILURE);
+	(void)alarm(0);
+	stress_set_proc_state(name, STRESS_STATE_WAIT);
+
+	for (;;) {
+		const int state = stress_pool_state(slot);
+
+		if (state == STRESS_POOL_EXIT)
+			break;
+		if (state == STRESS_POOL_RUN) {
+			stress_pool_job(slot, j, page_size);
+			stress_pool_state_set(slot, STRESS_POOL_DONE);
+			continue;
+		}
+		if (getppid() != ppid)
+			break;
+		stress_pool_state_wait(slot, state, 500000000L);
+	}
+	stress_instance_exit(name, EXIT_SUCCESS);
+}
+
+/*
+ *  stress_pool_spawn()
+ *	fork the --worker-pool worker for slot j
+ */
+static pid_t stress_pool_spawn(const int32_t j, const size_t page_size)
+{
+	stress_pool_slot_t *slot = &stress_pool[j];
+	pid_t pid;
+
+	slot->stressor = NULL;
+	stress_pool_state_store(slot, STRESS_POOL_IDLE);
+	pid = fork();
+	if (pid == 0)
+		stress_pool_worker(slot, j, page_size);
+	slot->worker = (pid > 0) ? pid : 0;
+	return pid;
+}
+
+/*
+ *  stress_pool_dispatch()
+ *	hand instance j of the current stressor to its --worker-pool
+ *	worker, respawning the worker if it died, returns the worker
+ *	pid or -1 if no worker could be started
+ */
+static pid_t MLOCKED_TEXT stress_pool_dispatch(
+	const int32_t j,
+	stress_checksum_t *checksum,
+	const size_t page_size,
+	const int64_t backoff,
+	const int32_t started_instances,
+	const double fork_time_start)
+{
+	stress_pool_slot_t *slot = &stress_pool[j];
+
+	if (!slot->worker && (stress_pool_spawn(j, page_size) < 0))
+		return -1;
+
+	slot->stressor = g_stressor_current;
+	slot->checksum = checksum;
+	slot->backoff = backoff;
+	slot->started_instances = started_instances;
+	slot->fork_time_start = fork_time_start;
+	slot->pid = 0;
+	slot->status = 0;
+	stress_pool_state_set(slot, STRESS_POOL_RUN);
+
+	return slot->worker;
+}
+
+/*
+ *  stress_pool_start()
+ *	pre-fork n --worker-pool workers that stay alive across
+ *	the sequentially run stressors
+ */
+static void stress_pool_start(const int32_t n)
+{
+	const size_t page_size = stress_get_page_size();
+	const size_t sz = page_size + (size_t)n * sizeof(*stress_pool);
+	uint8_t *ptr;
+	int32_t j;
+
+	if (n < 1)
+		return;
+	ptr = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED) {
+		pr_inf("worker-pool: cannot mmap %zu bytes for the worker pool, "
+			"forking each stressor instead\n", sz);
+		return;
+	}
+	/*
+	 *  Stressors run in the workers may deliberately write off the
+	 *  end of a page they mapped, guard the slots from such writes
+	 */
+	(void)mprotect((void *)ptr, page_size, PROT_NONE);
+	stress_pool = (stress_pool_slot_t *)(ptr + page_size);
+	stress_pool_workers = n;
+	for (j = 0; j < n; j++) {
+		if (stress_pool_spawn(j, page_size) < 0)
+			pr_dbg("worker-pool: cannot fork worker %" PRId32 ", errno=%d (%s)\n",
+				j, errno, strerror(errno));
+	}
+	pr_dbg("worker-pool: started %" PRId32 " worker%s\n", n, n == 1 ? "" : "s");
+}
+
+/*
+ *  stress_pool_stop()
+ *	tell the --worker-pool workers to exit and reap them
+ */
+static void stress_pool_stop(void)
+{
+	const size_t page_size = stress_get_page_size();
+	int32_t j;
+
+	if (!stress_pool)
+		return;
+	for (j = 0; j < stress_pool_workers; j++) {
+		if (stress_pool[j].worker)
+			stress_pool_state_set(&stress_pool[j], STRESS_POOL_EXIT);
+	}
+	for (j = 0; j < stress_pool_workers; j++) {
+		int status;
+
+		if (stress_pool[j].worker)
+			(void)shim_waitpid(stress_pool[j].worker, &status, 0);
+	}
+	(void)munmap((void *)((uint8_t *)stress_pool - page_size),
+		page_size + (size_t)stress_pool_workers * sizeof(*stress_pool));
+	stress_pool = NULL;
+	stress_pool_workers = 0;
+}
+
+/*
+ *  stress_run()
+ *	kick off and run stressors
+ */
+static void MLOCKED_TEXT stress_run(
+	stress_stressor_t *stressors_list,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success,
+	stress_checksum_t **checksum)
+{
+	double time_start, time_finish;
+	int32_t started_instances = 0;
+	const size_t page_size = stress_get_page_size();
+
+	wait_flag = true;
+	time_start = stress_time_now();
+	pr_dbg("starting stressors\n");
+	stress_sync_start_init();
+	stress_cgroup_start(stressors_list);
+	stress_resctrl_start(stressors_list);
+	stress_wss_start(stressors_list);
+	stress_psi_start(stressors_list);
+	stress_rapl_start(stressors_list);
+	stress_cpuidle_start(stressors_list);
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	stress_perf_uncore_start(stressors_list);
+#endif
+	stress_ftrace_run_start();
+
+	/*
+	 *  Work through the list of stressors to run
+	 */
+	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
+		int32_t j;
+
+#if defined(HAVE_LIB_PTHREAD)
+		/*
+		 *  Thread safe stressors can run all their
+		 *  instances as threads in a single process
+		 */
+		if ((g_opt_flags & OPT_FLAGS_INSTANCE_THREADS) &&
+		    g_stressor_current->stressor->info->thread_safe &&
+		    (g_stressor_current->num_instances > 0)) {
+			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
+				goto abort;
+			if (stress_run_threads(*checksum, &started_instances, page_size) < 0)
+				goto wait_for_stressors;
+			*checksum += g_stressor_current->num_instances;
+
+			/* Forced early abort during startup? */
+			if (!keep_stressing_flag()) {
+				pr_dbg("abort signal during startup, cleaning up\n");
+				stress_kill_stressors(SIGALRM);
+				goto wait_for_stressors;
+			}
+			continue;
+		}
+#endif
+		if (g_opt_flags & OPT_FLAGS_INSTANCE_THREADS)
+			pr_dbg("%s: not thread safe, running instances as processes\n",
+				stress_munge_underscore(g_stressor_current->stressor->name));
+		/*
+		 *  Each stressor has 1 or more instances to run
+		 */
+		for (j = 0; j < g_stressor_current->num_instances; j++, (*checksum)++) {
+			int rc = EXIT_SUCCESS;
+			pid_t pid;
+			char name[64];
+			int64_t backoff = DEFAULT_BACKOFF;
+			int32_t ionice_class = UNDEFINED;
+			int32_t ionice_level = UNDEFINED;
+			stress_stats_t *const stats = g_stressor_current->stats[j];
+			double fork_time_start;
+
+			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
+				goto abort;
+
+			(void)stress_get_setting("backoff", &backoff);
+			(void)stress_get_setting("ionice-class", &ionice_class);
+			(void)stress_get_setting("ionice-level", &ionice_level);
+
+			stress_instance_stats_init(stats, *checksum);
+			stats->placement_cpu = stress_target_mix_cpu(g_stressor_current, j);
+			if (stats->placement_cpu < 0)
+				stats->placement_cpu = stress_placement_cpu(started_instances);
+again:
+			if (!keep_stressing_flag())
+				break;
+			fork_time_start = stress_time_now();
+			if (stress_pool && (j < stress_pool_workers))
+				pid = stress_pool_dispatch(j, *checksum, page_size,
+					backoff, started_instances, fork_time_start);
+			else
+				pid = fork();
+			switch (pid) {
+			case -1:
+				if (errno == EAGAIN) {
+					(void)shim_usleep(100000);
+					goto again;
 				}
-#endif
-				pr_dbg("%s: exited [%d] (instance %" PRIu32 ")\n",
-					name, (int)getpid(), j);
-
-				/* Allow for some slops of ~0.5 secs */
-				run_duration = (stats->finish - fork_time_start) + 0.5;
-
-				/*
-				 * Apparently succeeded but terminated early?
-				 * Could be a bug, so report a warning
-				 */
-				if (stats->run_ok && !g_caught_sigint &&
-				    (run_duration < (double)g_opt_timeout) &&
-				    (!(g_stressor_current->bogo_ops && stats->counter >= g_stressor_current->bogo_ops))) {
-
-					pr_warn("%s: WARNING: finished prematurely after just %.2fs%s\n",
-						name, run_duration, stress_duration_to_str((double)g_opt_timeout));
+				pr_err("Cannot fork: errno=%d (%s)\n",
+					errno, strerror(errno));
+				stress_kill_stressors(SIGALRM);
+				goto wait_for_stressors;
+			case 0:
+				/* Child */
+				stress_cgroup_enter(g_stressor_current);
+				stress_resctrl_enter(g_stressor_current);
+				(void)snprintf(name, sizeof(name), "%s-%s", g_app_name,
+					stress_munge_underscore(g_stressor_current->stressor->name));
+				if (stress_instance_init(name, ionice_class, ionice_level) < 0) {
+					rc = EXIT_FAILURE;
+					goto child_exit;
 				}
 
+				rc = stress_instance_run(name, stats, *checksum, j,
+					page_size, backoff, started_instances, fork_time_start);
 child_exit:
-				stress_stressors_free();
-				stress_cache_free();
-				stress_settings_free();
-				stress_temp_path_free();
-				(void)stress_ftrace_free();
-
-				if ((rc != 0) && (g_opt_flags & OPT_FLAGS_ABORT)) {
-					keep_stressing_set_flag(false);
-					wait_flag = false;
-					(void)kill(getppid(), SIGALRM);
-				}
-				stress_set_proc_state(name, STRESS_STATE_EXIT);
-				if (terminate_signum)
-					rc = EXIT_SIGNALED;
-				_exit(rc);
+				stress_instance_exit(name, rc);
 			default:
 				if (pid > -1) {
 					stats->pid = pid;
@@ -2421,10 +3849,24 @@ child_exit:
 abort:
 	pr_dbg("%d stressor%s started\n", started_instances,
 		 started_instances == 1 ? "" : "s");
+	stress_window_start(stressors_list);
 
 wait_for_stressors:
+	stress_sync_start_release();
 	stress_wait_stressors(stressors_list, success, resource_success, metrics_success);
 	time_finish = stress_time_now();
+	stress_window_stop();
+	stress_ftrace_run_stop(stressors_list);
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	stress_perf_uncore_stop(stressors_list);
+#endif
+	stress_cpuidle_stop(stressors_list);
+	stress_rapl_stop(stressors_list);
+	stress_psi_stop(stressors_list);
+	stress_wss_stop(stressors_list);
+	stress_resctrl_stop(stressors_list);
+	stress_cgroup_stop(stressors_list);
 
 	*duration += time_finish - time_start;
 }
@@ -2492,7 +3934,7 @@ static void stress_metrics_check(bool *success)
 			stress_checksum_t stats_checksum;
 			const double duration = stats->finish - stats->start;
 
-			counter_check |= stats->counter;
+			counter_check |= stats->ci.counter;
 			if (duration < min_run_time)
 				min_run_time = duration;
 
@@ -2504,14 +3946,14 @@ static void stress_metrics_check(bool *success)
 			}
 
 			(void)memset(&stats_checksum, 0, sizeof(stats_checksum));
-			stats_checksum.data.counter = stats->counter;
+			stats_checksum.data.counter = stats->ci.counter;
 			stats_checksum.data.run_ok = stats->run_ok;
 			stress_hash_checksum(&stats_checksum);
 
-			if (stats->counter != checksum->data.counter) {
+			if (stats->ci.counter != checksum->data.counter) {
 				pr_fail("%s instance %d corrupted bogo-ops counter, %" PRIu64 " vs %" PRIu64 "\n",
 					ss->stressor->name, j,
-					stats->counter, checksum->data.counter);
+					stats->ci.counter, checksum->data.counter);
 				ok = false;
 			}
 			if (stats->run_ok != checksum->data.run_ok) {
@@ -2616,7 +4058,7 @@ static void stress_metrics_dump(
 			const stress_stats_t *const stats = ss->stats[j];
 
 			run_ok  |= stats->run_ok;
-			c_total += stats->counter;
+			c_total += stats->ci.counter;
 #if defined(HAVE_GETRUSAGE)
 			u_total += stats->rusage_utime;
 			s_total += stats->rusage_stime;
@@ -2633,6 +4075,14 @@ static void stress_metrics_dump(
 		/* Real time in terms of average wall clock time of all procs */
 		r_total = ss->started_instances ?
 			r_total / (double)ss->started_instances : 0.0;
+		/* Opted in stressors have the harness cost taken out */
+		if (ss->started_instances) {
+			const double overhead = stress_harness_overhead(ss, c_total) /
+				(double)ss->started_instances;
+
+			if (overhead < r_total)
+				r_total -= overhead;
+		}
 
 		if ((g_opt_flags & OPT_FLAGS_METRICS_BRIEF) &&
 		    (c_total == 0) && (!run_ok))
@@ -2903,6 +4353,85 @@ static void *stress_map_page(int prot, char *prot_str, size_t page_size)
 	return ptr;
 }
 
+#define STRESS_STATS_ALIGN(len)	(((len) + 63) & ~(size_t)63)
+
+/*
+ *  stress_shared_stats_opt_len()
+ *	size of the optional per instance perf, thermal zone and
+ *	system call stats blocks, these are only mapped when the
+ *	option that uses them is enabled
+ */
+static size_t stress_shared_stats_opt_len(const int32_t num_procs)
+{
+	size_t len = 0;
+
+#if defined(STRESS_PERF_STATS)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
+		len += STRESS_STATS_ALIGN(sizeof(stress_perf_t) * (size_t)num_procs);
+#endif
+#if defined(STRESS_THERMAL_ZONES)
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+		len += STRESS_STATS_ALIGN(sizeof(stress_tz_t) * (size_t)num_procs);
+#endif
+	if (g_opt_flags & OPT_FLAGS_SYSCALL_STATS)
+		len += STRESS_STATS_ALIGN(sizeof(stress_syscall_stat_t) *
+			STRESS_SYSCALL_MAX * (size_t)num_procs);
+	return len;
+}
+
+/*
+ *  stress_shared_stats_opt_setup()
+ *	point the per instance stats at their optional blocks that
+ *	follow the stats array in the shared region
+ */
+static void stress_shared_stats_opt_setup(uint8_t *ptr, const int32_t num_procs)
+{
+	int32_t i;
+
+#if defined(STRESS_PERF_STATS)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		stress_perf_t *sp = (stress_perf_t *)ptr;
+
+		for (i = 0; i < num_procs; i++)
+			g_shared->stats[i].sp = &sp[i];
+		ptr += STRESS_STATS_ALIGN(sizeof(stress_perf_t) * (size_t)num_procs);
+	}
+#endif
+#if defined(STRESS_THERMAL_ZONES)
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES) {
+		stress_tz_t *tz = (stress_tz_t *)ptr;
+
+		for (i = 0; i < num_procs; i++)
+			g_shared->stats[i].tz = &tz[i];
+		ptr += STRESS_STATS_ALIGN(sizeof(stress_tz_t) * (size_t)num_procs);
+	}
+#endif
+	if (g_opt_flags & OPT_FLAGS_SYSCALL_STATS) {
+		stress_syscall_stat_t *st = (stress_syscall_stat_t *)ptr;
+
+		for (i = 0; i < num_procs; i++)
+			g_shared->stats[i].syscall_stats = &st[i * STRESS_SYSCALL_MAX];
+	}
+}
+
+/*
+ *  stress_shared_stats_interleave()
+ *	on multi-node NUMA systems interleave the shared stats
+ *	pages across the memory nodes so the instances on one
+ *	node do not all hammer the memory of another node
+ */
+static void stress_shared_stats_interleave(void *addr, const size_t len)
+{
+	unsigned long nodes[STRESS_NUMA_MAX_NODES];
+	const size_t n = stress_numa_mem_nodes(nodes, SIZEOF_ARRAY(nodes));
+
+	if (n < 2)
+		return;
+	if (stress_numa_mbind_nodes(addr, len, true, nodes, n) < 0)
+		pr_dbg("cannot interleave shared stats over %zu NUMA nodes, errno=%d (%s)\n",
+			n, errno, strerror(errno));
+}
+
 /*
  *  stress_shared_map()
  *	mmap shared region, with an extra page at the end
@@ -2912,8 +4441,9 @@ static void *stress_map_page(int prot, char *prot_str, size_t page_size)
 static inline void stress_shared_map(const int32_t num_procs)
 {
 	const size_t page_size = stress_get_page_size();
-	size_t len = sizeof(stress_shared_t) +
+	const size_t stats_len = sizeof(stress_shared_t) +
 		     (sizeof(stress_stats_t) * (size_t)num_procs);
+	size_t len = STRESS_STATS_ALIGN(stats_len) + stress_shared_stats_opt_len(num_procs);
 	size_t sz = (len + (page_size << 1)) & ~(page_size - 1);
 #if defined(HAVE_MPROTECT)
 	void *last_page;
@@ -2928,10 +4458,14 @@ static inline void stress_shared_map(const int32_t num_procs)
 		exit(EXIT_FAILURE);
 	}
 
+	stress_shared_stats_interleave(g_shared, sz - page_size);
+
 	/* Paraniod */
 	(void)memset(g_shared, 0, sz);
 	g_shared->length = sz;
 	g_shared->vfork = vfork;
+	g_shared->num_stats = (uint32_t)num_procs;
+	stress_shared_stats_opt_setup((uint8_t *)g_shared + STRESS_STATS_ALIGN(stats_len), num_procs);
 
 #if defined(HAVE_MPROTECT)
 	last_page = ((uint8_t *)g_shared) + sz - page_size;
@@ -3417,12 +4951,105 @@ next_opt:
 				stress_enable_classes(u32);
 			}
 			break;
+		case OPT_cgroup:
+			if (stress_set_cgroup(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_cpu_max:
+			if (stress_set_cgroup_cpu_max(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_cpuset_cpus:
+			if (stress_set_cgroup_cpuset_cpus(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_cpuset_mems:
+			if (stress_set_cgroup_cpuset_mems(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_io_max:
+			if (stress_set_cgroup_io_max(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_memory_high:
+			if (stress_set_cgroup_memory_high(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_memory_max:
+			if (stress_set_cgroup_memory_max(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_compare:
+			if (stress_set_compare(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_compare_threshold:
+			if (stress_set_compare_threshold(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cooldown:
+			if (stress_set_cooldown(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_exclude:
 			stress_set_setting_global("exclude", TYPE_ID_STR, (void *)optarg);
 			break;
+		case OPT_ftrace_baseline:
+			if (stress_set_ftrace_baseline(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_fleet:
+			stress_set_setting_global("fleet", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_fleet_agent:
+			stress_set_setting_global("fleet-agent", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_fleet_delay:
+			if (stress_set_fleet_delay(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_fleet_outlier:
+			if (stress_set_fleet_outlier(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_fleet_secret:
+			if (stress_set_fleet_secret(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_fleet_report_fd:
+			i32 = stress_get_int32(optarg);
+			stress_set_setting_global("fleet-report-fd", TYPE_ID_INT32, &i32);
+			break;
+		case OPT_fleet_start:
+			stress_set_setting_global("fleet-start", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_ftrace_top:
+			if (stress_set_ftrace_top(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_help:
 			stress_usage();
 			break;
+		case OPT_instance_mode:
+			if (!strcmp(optarg, "threads")) {
+				g_opt_flags |= OPT_FLAGS_INSTANCE_THREADS;
+			} else if (!strcmp(optarg, "processes")) {
+				g_opt_flags &= ~OPT_FLAGS_INSTANCE_THREADS;
+			} else {
+				(void)fprintf(stderr, "instance-mode must be one of: processes threads\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPT_node_alloc:
+			if (!strcmp(optarg, "arena")) {
+				g_opt_flags |= OPT_FLAGS_NODE_ARENA;
+			} else if (!strcmp(optarg, "libc")) {
+				g_opt_flags &= ~OPT_FLAGS_NODE_ARENA;
+			} else {
+				(void)fprintf(stderr, "node-alloc must be one of: libc arena\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case OPT_ionice_class:
 			i32 = stress_get_opt_ionice_class(optarg);
 			stress_set_setting("ionice-class", TYPE_ID_INT32, &i32);
@@ -3448,6 +5075,17 @@ next_opt:
 			if (stress_set_mbind(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_mem_backing:
+			if (stress_set_mem_backing(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_metrics_interval:
+			if (stress_set_metrics_interval(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_metrics_interval_csv:
+			stress_set_setting_global("metrics-interval-csv", TYPE_ID_STR, (void *)optarg);
+			break;
 		case OPT_no_madvise:
 			g_opt_flags &= ~OPT_FLAGS_MMAP_MADVISE;
 			break;
@@ -3466,6 +5104,30 @@ next_opt:
 			stress_check_max_stressors("random", i32);
 			stress_set_setting("random", TYPE_ID_INT32, &i32);
 			break;
+		case OPT_repeat:
+			if (stress_set_repeat(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_resctrl:
+			(void)stress_set_resctrl(NULL);
+			break;
+		case OPT_resctrl_interval:
+			(void)stress_set_resctrl_interval(optarg);
+			break;
+		case OPT_resctrl_l3_ways:
+			(void)stress_set_resctrl_l3_ways(optarg);
+			break;
+		case OPT_resctrl_mb:
+			(void)stress_set_resctrl_mb(optarg);
+			break;
+		case OPT_repeat_cv:
+			if (stress_set_repeat_cv(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_repeat_warmup:
+			if (stress_set_repeat_warmup(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_sched:
 			i32 = stress_get_opt_sched(optarg);
 			stress_set_setting_global("sched", TYPE_ID_INT32, &i32);
@@ -3504,6 +5166,18 @@ next_opt:
 		case OPT_stressors:
 			stress_show_stressor_names();
 			exit(EXIT_SUCCESS);
+		case OPT_target_cpu:
+			if (stress_set_target_cpu(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_target_ops:
+			if (stress_set_target_ops(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_placement:
+			if (stress_set_placement(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_taskset:
 			if (stress_set_cpu_affinity(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3524,6 +5198,13 @@ next_opt:
 		case OPT_verifiable:
 			stress_verifiable();
 			exit(EXIT_SUCCESS);
+		case OPT_verify_sample:
+			(void)stress_set_verify_sample(optarg);
+			break;
+		case OPT_verify_sample_mode:
+			if (stress_set_verify_sample_mode(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_vmstat:
 			if (stress_set_vmstat(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3536,9 +5217,47 @@ next_opt:
 			if (stress_set_iostat(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_sample:
+			if (stress_set_sample(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_sample_file:
+			stress_set_setting_global("sample-file", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_scale_sweep:
+			if (stress_set_scale_sweep(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_warmup:
+			if (stress_set_warmup(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_wss:
+			(void)stress_set_wss(NULL);
+			break;
+		case OPT_wss_interval:
+			(void)stress_set_wss_interval(optarg);
+			break;
+		case OPT_wss_timeline:
+			if (stress_set_wss_timeline(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_yaml:
 			stress_set_setting_global("yaml", TYPE_ID_STR, (void *)optarg);
 			break;
+		case OPT_json:
+			stress_set_setting_global("json", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_csv:
+			stress_set_setting_global("csv", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_openmetrics:
+			stress_set_setting_global("openmetrics", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_openmetrics_interval:
+			if (stress_set_openmetrics_interval(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		default:
 			if (!jobmode)
 				(void)printf("Unknown option (%d)\n",c);
@@ -3643,6 +5362,180 @@ static void stress_setup_parallel(const uint32_t class)
 	}
 }
 
+#define STRESS_WAVE_CPU		STRESS_BIT_UL(0)	/* CPU execution units */
+#define STRESS_WAVE_MEMORY	STRESS_BIT_UL(1)	/* caches and memory bandwidth */
+#define STRESS_WAVE_DISK	STRESS_BIT_UL(2)	/* block I/O and file systems */
+#define STRESS_WAVE_NETWORK	STRESS_BIT_UL(3)	/* network stack */
+#define STRESS_WAVE_SYSCALL	STRESS_BIT_UL(4)	/* kernel system call paths */
+
+/*
+ *  stress_wave_resources()
+ *	map the stressor classes of a stressor onto
+ *	the resources it saturates for --waves
+ */
+static uint32_t stress_wave_resources(const stress_stressor_t *ss)
+{
+	typedef struct {
+		const uint32_t class;		/* stressor class */
+		const uint32_t resource;	/* resource it saturates */
+	} stress_wave_map_t;
+
+	static const stress_wave_map_t stress_wave_map[] = {
+		{ CLASS_CPU,		STRESS_WAVE_CPU },
+		{ CLASS_MEMORY,		STRESS_WAVE_MEMORY },
+		{ CLASS_CPU_CACHE,	STRESS_WAVE_MEMORY },
+		{ CLASS_VM,		STRESS_WAVE_MEMORY },
+		{ CLASS_IO,		STRESS_WAVE_DISK },
+		{ CLASS_FILESYSTEM,	STRESS_WAVE_DISK },
+		{ CLASS_NETWORK,	STRESS_WAVE_NETWORK },
+		{ CLASS_SCHEDULER,	STRESS_WAVE_SYSCALL },
+		{ CLASS_INTERRUPT,	STRESS_WAVE_SYSCALL },
+		{ CLASS_OS,		STRESS_WAVE_SYSCALL },
+		{ CLASS_PIPE_IO,	STRESS_WAVE_SYSCALL },
+		{ CLASS_DEV,		STRESS_WAVE_SYSCALL },
+		{ CLASS_SECURITY,	STRESS_WAVE_SYSCALL },
+		{ CLASS_GPU,		STRESS_WAVE_SYSCALL },
+	};
+	const uint32_t class = ss->stressor->info->class;
+	uint32_t resources = 0;
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_wave_map); i++) {
+		if (class & stress_wave_map[i].class)
+			resources |= stress_wave_map[i].resource;
+	}
+	/* unclassified stressors conflict with everything */
+	return resources ? resources : ~0U;
+}
+
+/*
+ *  stress_wave_count()
+ *	number of resources a stressor saturates
+ */
+static uint32_t stress_wave_count(const stress_stressor_t *ss)
+{
+	uint32_t resources = stress_wave_resources(ss), n;
+
+	for (n = 0; resources; n++)
+		resources &= resources - 1;
+	return n;
+}
+
+/*
+ *  stress_wave_cmp()
+ *	sort stressors by the number of resources they
+ *	saturate, most first, so they are packed first
+ */
+static int stress_wave_cmp(const void *p1, const void *p2)
+{
+	const stress_stressor_t *ss1 = *(const stress_stressor_t * const *)p1;
+	const stress_stressor_t *ss2 = *(const stress_stressor_t * const *)p2;
+	const uint32_t n1 = stress_wave_count(ss1);
+	const uint32_t n2 = stress_wave_count(ss2);
+
+	if (n1 != n2)
+		return (n1 < n2) ? 1 : -1;
+	return strcmp(ss1->stressor->name, ss2->stressor->name);
+}
+
+/*
+ *  stress_run_waves()
+ *	--sequential --waves, pack the stressors into waves where no
+ *	two stressors in a wave saturate the same resource using first
+ *	fit decreasing and run the waves one after another
+ */
+static void stress_run_waves(
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success,
+	stress_checksum_t **checksum)
+{
+	stress_stressor_t *ss, **order, **sorted, *head = stressors_head;
+	uint32_t *wave_resources;
+	size_t *wave;
+	size_t i, n = 0, waves = 0, w;
+
+	for (ss = stressors_head; ss; ss = ss->next)
+		n++;
+	if (!n)
+		return;
+
+	order = (stress_stressor_t **)calloc(n, sizeof(*order));
+	sorted = (stress_stressor_t **)calloc(n, sizeof(*sorted));
+	wave = (size_t *)calloc(n, sizeof(*wave));
+	wave_resources = (uint32_t *)calloc(n, sizeof(*wave_resources));
+	if (!order || !sorted || !wave || !wave_resources) {
+		pr_inf("waves: cannot allocate wave schedule, running stressors one by one\n");
+		for (ss = stressors_head; ss && keep_stressing_flag(); ss = ss->next) {
+			stress_stressor_t *next = ss->next;
+
+			ss->next = NULL;
+			stress_run(ss, duration, success, resource_success,
+				metrics_success, checksum);
+			ss->next = next;
+		}
+		goto free_schedule;
+	}
+
+	for (i = 0, ss = stressors_head; ss; ss = ss->next, i++)
+		order[i] = sorted[i] = ss;
+	qsort(sorted, n, sizeof(*sorted), stress_wave_cmp);
+
+	/* first fit into the earliest wave with no resource conflict */
+	for (i = 0; i < n; i++) {
+		const uint32_t resources = stress_wave_resources(sorted[i]);
+
+		for (w = 0; w < waves; w++) {
+			if (!(wave_resources[w] & resources))
+				break;
+		}
+		if (w == waves)
+			waves++;
+		wave_resources[w] |= resources;
+		wave[i] = w;
+	}
+	pr_inf("waves: %zu stressor%s packed into %zu wave%s\n",
+		n, n == 1 ? "" : "s", waves, waves == 1 ? "" : "s");
+
+	for (w = 0; (w < waves) && keep_stressing_flag(); w++) {
+		stress_stressor_t *wave_head = NULL, *wave_tail = NULL;
+		char names[256];
+
+		*names = '\0';
+		for (i = 0; i < n; i++) {
+			if (wave[i] != w)
+				continue;
+			if (wave_tail)
+				wave_tail->next = sorted[i];
+			else
+				wave_head = sorted[i];
+			wave_tail = sorted[i];
+			if (*names)
+				(void)shim_strlcat(names, " ", sizeof(names));
+			(void)shim_strlcat(names, stress_munge_underscore(sorted[i]->stressor->name), sizeof(names));
+		}
+		wave_tail->next = NULL;
+		pr_inf("waves: wave %zu of %zu: %s\n", w + 1, waves, names);
+
+		/* stressors_head is used to signal the running stressors */
+		stressors_head = wave_head;
+		stress_run(wave_head, duration, success, resource_success,
+			metrics_success, checksum);
+		stressors_head = head;
+	}
+
+	/* restore the original stressor list order */
+	for (i = 0; i < n; i++)
+		order[i]->next = (i + 1 < n) ? order[i + 1] : NULL;
+
+free_schedule:
+	free(wave_resources);
+	free(wave);
+	free(sorted);
+	free(order);
+}
+
 /*
  *  stress_run_sequential()
  *	run stressors sequentially
@@ -3656,6 +5549,17 @@ static inline void stress_run_sequential(
 	stress_stressor_t *ss;
 	stress_checksum_t *checksum = g_shared->checksums;
 
+	if (g_opt_flags & OPT_FLAGS_WAVES) {
+		/* pool slots are per instance, waves run several stressors at once */
+		if (g_opt_flags & OPT_FLAGS_WORKER_POOL)
+			pr_inf("worker-pool: cannot be used with --waves, ignoring it\n");
+		stress_run_waves(duration, success, resource_success,
+			metrics_success, &checksum);
+		return;
+	}
+	if (g_opt_flags & OPT_FLAGS_WORKER_POOL)
+		stress_pool_start(g_opt_sequential);
+
 	/*
 	 *  Step through each stressor one by one
 	 */
@@ -3668,6 +5572,31 @@ static inline void stress_run_sequential(
 		ss->next = next;
 
 	}
+	stress_pool_stop();
+}
+
+/*
+ *  stress_repeat_reset()
+ *	clear the per instance state of the previous run
+ *	before the stressors are run again for --repeat
+ */
+static void stress_repeat_reset(void)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		int32_t j;
+
+		for (j = 0; j < ss->num_instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			stats->pid = 0;
+			stats->run_ok = false;
+			stats->start = 0.0;
+			stats->finish = 0.0;
+		}
+		ss->started_instances = 0;
+	}
 }
 
 /*
@@ -3741,15 +5670,18 @@ int main(int argc, char **argv, char **envp)
 	bool success = true;
 	bool resource_success = true;
 	bool metrics_success = true;
+	bool compare_success = true;
 	FILE *yaml;				/* YAML output file */
 	char *yaml_filename = NULL;		/* YAML file name */
 	char *log_filename;			/* log filename */
 	char *job_filename = NULL;		/* job filename */
+	char *fleet_hosts = NULL;		/* --fleet agents */
+	char *fleet_port = NULL;		/* --fleet-agent port */
 	int32_t ticks_per_sec;			/* clock ticks per second (jiffies) */
 	int32_t ionice_class = UNDEFINED;	/* ionice class */
 	int32_t ionice_level = UNDEFINED;	/* ionice level */
 	size_t i;
-	uint32_t class = 0;
+	uint32_t class = 0, run, runs, steps;
 	const uint32_t cpus_online = (uint32_t)stress_get_processors_online();
 	const uint32_t cpus_configured = (uint32_t)stress_get_processors_configured();
 	int ret;
@@ -3772,7 +5704,7 @@ int main(int argc, char **argv, char **envp)
 	yaml = NULL;
 
 	/* --exec stressor uses this to exec itself and then exit early */
-	if ((argc == 2) && !strcmp(argv[1], "--exec-exit")) {
+	if ((argc >= 2) && !strcmp(argv[1], "--exec-exit")) {
 		ret = EXIT_SUCCESS;
 		goto exit_temp_path_free;
 	}
@@ -3818,6 +5750,21 @@ int main(int argc, char **argv, char **envp)
 		goto exit_stressors_free;
 	}
 
+	/*
+	 *  Fleet agents and coordinators don't run stressors themselves
+	 */
+	if (stress_get_setting("fleet-agent", &fleet_port)) {
+		ret = stress_fleet_agent(argv[0], fleet_port);
+		goto exit_stressors_free;
+	}
+	if (stress_get_setting("fleet", &fleet_hosts)) {
+		(void)stress_get_setting("yaml", &yaml_filename);
+		yaml = stress_yaml_open(yaml_filename);
+		ret = stress_fleet_coordinator(fleet_hosts, job_filename, yaml);
+		stress_yaml_close(yaml);
+		goto exit_stressors_free;
+	}
+
 	/*
 	 *  Sanity check minimize/maximize options
 	 */
@@ -3838,6 +5785,13 @@ int main(int argc, char **argv, char **envp)
 		ret = EXIT_FAILURE;
 		goto exit_stressors_free;
 	}
+	if ((g_opt_flags & OPT_FLAGS_WAVES) &&
+	    !(g_opt_flags & OPT_FLAGS_SEQUENTIAL)) {
+		(void)fprintf(stderr, "waves option is only used with "
+			"--sequential option\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
 	(void)stress_get_setting("class", &class);
 
 	if (class &&
@@ -3933,6 +5887,8 @@ int main(int argc, char **argv, char **envp)
 	(void)stress_get_setting("yaml", &yaml_filename);
 
 	stress_mlock_executable();
+	stress_clock_init();
+	stress_harness_calibrate();
 
 	/*
 	 *  Enable signal handers
@@ -3965,6 +5921,29 @@ int main(int argc, char **argv, char **envp)
 	stress_exclude_unsupported(&unsupported);
 	stress_exclude_pathological();
 
+	if (stress_scale_sweep_steps()) {
+		stress_stressor_t *ss;
+
+		if (stress_repeat_runs() > 1) {
+			pr_err("--scale-sweep cannot be used with --repeat\n");
+			ret = EXIT_FAILURE;
+			goto exit_logging_close;
+		}
+		/* the shared stats are sized for the largest instance count */
+		for (ss = stressors_head; ss; ss = ss->next) {
+			if (!ss->num_instances)
+				continue;
+			ss->num_instances = stress_scale_sweep_max();
+			free(ss->stats);
+			stress_alloc_proc_resources(&ss->stats, ss->num_instances);
+		}
+	}
+
+	if (stress_window_check() < 0) {
+		ret = EXIT_FAILURE;
+		goto exit_logging_close;
+	}
+
 	stress_set_proc_limits();
 
 	if (!stressors_head) {
@@ -4037,33 +6016,86 @@ int main(int argc, char **argv, char **envp)
 	stress_clear_warn_once();
 	stress_stressors_init();
 
+	/* Wait for the synchronized start of a fleet agent run */
+	stress_fleet_start_wait();
+
 	/* Start thrasher process if required */
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_start();
 
 	stress_vmstat_start();
+	stress_metrics_interval_start(stressors_head);
+	stress_openmetrics_start(stressors_head);
+	stress_fleet_report_start(stressors_head);
+	stress_sample_start(stressors_head);
+	stress_target_start(stressors_head);
 	stress_smart_start();
 	stress_klog_start();
 
-	if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
-		stress_run_sequential(&duration,
-			&success, &resource_success, &metrics_success);
-	} else {
-		stress_run_parallel(&duration,
-			&success, &resource_success, &metrics_success);
+	steps = stress_scale_sweep_steps();
+	runs = steps ? steps : stress_repeat_runs();
+	for (run = 0; run < runs; run++) {
+		if (steps) {
+			stress_repeat_reset();
+			stress_scale_sweep_set(stressors_head, run);
+			pr_inf("scale-sweep: step %" PRIu32 " of %" PRIu32 ", %" PRId32 " instance%s per stressor\n",
+				run + 1, steps, stressors_head->num_instances,
+				stressors_head->num_instances == 1 ? "" : "s");
+		} else if (runs > 1) {
+			stress_repeat_reset();
+			pr_inf("repeat: run %" PRIu32 " of %" PRIu32 "\n", run + 1, runs);
+		}
+		if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
+			stress_run_sequential(&duration,
+				&success, &resource_success, &metrics_success);
+		} else {
+			stress_run_parallel(&duration,
+				&success, &resource_success, &metrics_success);
+		}
+		if (steps)
+			stress_scale_sweep_sample(stressors_head, run);
+		else
+			stress_repeat_sample(stressors_head, run);
+		if (!keep_stressing_flag())
+			break;
 	}
 
 	/* Stop thasher process */
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_stop();
 
+	stress_metrics_interval_stop();
+	stress_openmetrics_stop(stressors_head);
+	stress_fleet_report_stop(stressors_head);
+	stress_sample_stop();
+	stress_target_stop();
+
 	yaml = stress_yaml_open(yaml_filename);
 
 	/*
 	 *  Dump metrics
 	 */
-	if (g_opt_flags & OPT_FLAGS_METRICS)
+	if (g_opt_flags & OPT_FLAGS_METRICS) {
 		stress_metrics_dump(yaml, ticks_per_sec);
+		stress_latency_dump(yaml, stressors_head);
+		stress_method_stats_dump(yaml, stressors_head);
+	}
+	stress_metrics_interval_dump(yaml, stressors_head);
+	stress_compare_dump(yaml, stressors_head, &compare_success);
+	stress_repeat_dump(yaml, stressors_head);
+	stress_scale_sweep_dump(yaml, stressors_head);
+	stress_schedstat_dump(yaml, stressors_head);
+	stress_freq_stats_dump(yaml, stressors_head);
+	stress_psi_dump(yaml, stressors_head);
+	stress_rapl_dump(yaml, stressors_head);
+	stress_cpuidle_dump(yaml, stressors_head);
+	stress_verify_dump(yaml, stressors_head);
+	stress_cgroup_dump(yaml);
+	stress_resctrl_dump(yaml);
+	stress_wss_dump(yaml);
+	stress_ftrace_dump(yaml);
+	stress_syscall_stats_dump(yaml, stressors_head);
+	stress_harness_dump(yaml, stressors_head);
 
 	stress_metrics_check(&success);
 
@@ -4074,8 +6106,15 @@ int main(int argc, char **argv, char **envp)
 	 */
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
 		stress_perf_stat_dump(yaml, stressors_head, duration);
+	stress_perf_uncore_dump(yaml, stressors_head);
 #endif
 
+	/*
+	 *  Dump machine readable results, before the thermal
+	 *  zone information is free'd
+	 */
+	stress_results_dump(stressors_head, ticks_per_sec, duration, success && compare_success);
+
 #if defined(STRESS_THERMAL_ZONES)
 	/*
 	 *  Dump thermal zone measurements
@@ -4132,6 +6171,8 @@ int main(int argc, char **argv, char **envp)
 		exit(EXIT_NO_RESOURCE);
 	if (!metrics_success)
 		exit(EXIT_METRICS_UNTRUSTWORTHY);
+	if (!compare_success)
+		exit(EXIT_REGRESSION);
 	exit(EXIT_SUCCESS);
 
 exit_destroy_perf_lock:
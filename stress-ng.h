@@ -209,6 +209,7 @@ typedef unsigned long int __kernel_ulong_t;
 #define EXIT_SIGNALED			(5)
 #define EXIT_BY_SYS_EXIT		(6)
 #define EXIT_METRICS_UNTRUSTWORTHY	(7)
+#define EXIT_REGRESSION			(8)
 
 /*
  *  Stressor run states
@@ -319,6 +320,20 @@ typedef unsigned long int __kernel_ulong_t;
 #define OPT_FLAGS_STDOUT	 STRESS_BIT_ULL(43)	/* --stdout */
 #define OPT_FLAGS_KLOG_CHECK	 STRESS_BIT_ULL(44)	/* --klog-check */
 #define OPT_FLAGS_DRY_RUN	 STRESS_BIT_ULL(45)	/* Don't actually run */
+#define OPT_FLAGS_INSTANCE_THREADS STRESS_BIT_ULL(46)	/* --instance-mode threads */
+#define OPT_FLAGS_SYNC_START	 STRESS_BIT_ULL(47)	/* --sync-start */
+#define OPT_FLAGS_SCHEDSTAT	 STRESS_BIT_ULL(48)	/* --schedstat */
+#define OPT_FLAGS_NODE_ARENA	 STRESS_BIT_ULL(49)	/* --node-alloc arena */
+#define OPT_FLAGS_PSI		 STRESS_BIT_ULL(50)	/* --psi */
+#define OPT_FLAGS_PSI_CGROUP	 STRESS_BIT_ULL(51)	/* --psi-cgroup */
+#define OPT_FLAGS_SYSCALL_STATS	 STRESS_BIT_ULL(52)	/* --syscall-stats */
+#define OPT_FLAGS_RAPL		 STRESS_BIT_ULL(53)	/* --rapl */
+#define OPT_FLAGS_FREQ_STATS	 STRESS_BIT_ULL(54)	/* --freq-stats */
+#define OPT_FLAGS_HARNESS_OVERHEAD STRESS_BIT_ULL(55)	/* --harness-overhead */
+#define OPT_FLAGS_WORKER_POOL	 STRESS_BIT_ULL(56)	/* --worker-pool */
+#define OPT_FLAGS_WAVES		 STRESS_BIT_ULL(57)	/* --waves */
+#define OPT_FLAGS_PERF_UNCORE	 STRESS_BIT_ULL(58)	/* --perf-uncore */
+#define OPT_FLAGS_CPUIDLE	 STRESS_BIT_ULL(59)	/* --cpuidle */
 
 #define OPT_FLAGS_MINMAX_MASK		\
 	(OPT_FLAGS_MINIMIZE | OPT_FLAGS_MAXIMIZE)
@@ -399,8 +414,10 @@ typedef struct {
 /* settings for storing opt arg parsed data */
 typedef struct stress_setting {
 	struct stress_setting *next;	/* next setting in list */
+	struct stress_setting *hash_next; /* next setting in hash bucket */
 	struct stress_stressor_info *proc;
 	char *name;			/* name of setting */
+	uint32_t index;			/* position of setting in list */
 	stress_type_id_t type_id;	/* setting type */
 	bool		global;		/* true if global */
 	union {				/* setting value */
@@ -456,8 +473,7 @@ typedef struct {
 
 /* stressor args */
 typedef struct {
-	uint64_t *counter;		/* stressor counter */
-	bool *counter_ready;		/* counter can be read */
+	struct stress_counter_info *ci;	/* stressor bogo-ops counter info */
 	const char *name;		/* stressor name */
 	uint64_t max_ops;		/* max number of bogo ops */
 	const uint32_t instance;	/* stressor instance # */
@@ -466,6 +482,8 @@ typedef struct {
 	size_t page_size;		/* page size */
 	stress_mapped_t *mapped;	/* mmap'd pages, addr of g_shared mapped */
 	stress_misc_stats_t *misc_stats;/* misc per stressor stats */
+	struct stress_latency *latency;	/* per instance latency histogram */
+	struct stress_method_stats *method_stats; /* per method stats */
 } stress_args_t;
 
 typedef struct {
@@ -491,6 +509,8 @@ typedef struct {
 	const stress_help_t *help;	/* stressor help options */
 	const stress_class_t class;	/* stressor class */
 	const stress_verify_t verify;	/* verification mode */
+	const bool thread_safe;		/* instances can run as threads */
+	const bool harness_adjust;	/* subtract --harness-overhead in metrics */
 } stressor_info_t;
 
 /* gcc 4.7 and later support vector ops */
@@ -797,7 +817,7 @@ typedef int (*stress_func_t)(const stress_args_t *args);
 typedef struct {
 	uint64_t counter;		/* perf counter */
 	int	 fd;			/* perf per counter fd */
-	uint8_t	 padding[4];		/* padding */
+	int	 leader;		/* index of group leader, -1 = no group */
 } stress_perf_stat_t;
 
 /* per stressor perf info */
@@ -831,21 +851,138 @@ typedef struct {
 } stress_tz_t;
 #endif
 
+/*
+ *  Log-linear latency histogram, values below STRESS_LATENCY_SUB_BUCKETS
+ *  are exact, larger values are binned into STRESS_LATENCY_SUB_BUCKETS
+ *  linear buckets per power of 2, giving a worst case error of ~6%.
+ *  Values of 2^STRESS_LATENCY_MAX_BITS ns (~18 minutes) and over all
+ *  land in the last bucket.
+ */
+#define STRESS_LATENCY_SUB_BITS		(4)
+#define STRESS_LATENCY_SUB_BUCKETS	(1U << STRESS_LATENCY_SUB_BITS)
+#define STRESS_LATENCY_MAX_BITS		(40)
+#define STRESS_LATENCY_BUCKETS		\
+	((STRESS_LATENCY_MAX_BITS - STRESS_LATENCY_SUB_BITS + 1) * STRESS_LATENCY_SUB_BUCKETS)
+
+typedef struct stress_latency {
+	uint64_t count;			/* number of samples */
+	uint64_t min;			/* minimum latency in ns */
+	uint64_t max;			/* maximum latency in ns */
+	double sum;			/* sum of latencies in ns */
+	uint64_t buckets[STRESS_LATENCY_BUCKETS]; /* sample counts */
+} stress_latency_t;
+
+/*
+ *  Per method statistics for stressors that cycle through a set of
+ *  methods, rate is the reference rate in calls per second used to
+ *  normalize the method throughput, 0.0 if there is none
+ */
+#define STRESS_METHOD_STATS_MAX		(96)
+
+typedef struct stress_method_stats {
+	char name[24];			/* method name, empty = unused */
+	uint64_t count;			/* number of method calls */
+	double duration;		/* time spent in the method in secs */
+	double rate;			/* reference calls per second */
+} stress_method_stats_t;
+
+/*
+ *  Per stressor instance bogo-ops counter, this is updated in the
+ *  stressor hot path and read by the parent, so give it a cache line
+ *  of its own to avoid false sharing between instances
+ */
+typedef struct stress_counter_info {
+	uint64_t counter;		/* number of bogo ops */
+	double throttle_t_run;		/* end of the last throttle sleep */
+	uint32_t throttle;		/* sleep ppm of each period, 0 = none */
+	bool counter_ready;		/* counter can be read */
+	uint8_t padding[43];		/* pad to 64 byte cache line */
+} ALIGN_CACHELINE stress_counter_info_t;
+
+/* Per stressor instance scheduler statistics from /proc/.../schedstat */
+typedef struct {
+	uint64_t run_ns;		/* time spent running on a CPU */
+	uint64_t wait_ns;		/* time spent runnable waiting for a CPU */
+	uint64_t timeslices;		/* number of timeslices run */
+	bool valid;			/* true if the stats were read */
+} stress_schedstat_t;
+
+/* Per instance effective CPU frequency and throttling, --freq-stats */
+typedef struct {
+	uint64_t cycles;		/* CPU cycles of the instance */
+	uint64_t cpu_ns;		/* CPU time of the cycles */
+	double ghz;			/* effective or sampled frequency */
+	uint64_t core_throttles;	/* core throttle events */
+	uint64_t package_throttles;	/* package throttle events */
+	bool cycles_valid;		/* cycles were counted */
+	bool valid;			/* true if the stats were read */
+} stress_freq_stats_t;
+
+/* Instrumented system calls, --syscall-stats */
+typedef enum {
+	STRESS_SYSCALL_ACCESS,
+	STRESS_SYSCALL_FACCESSAT,
+	STRESS_SYSCALL_FDATASYNC,
+	STRESS_SYSCALL_FSTAT,
+	STRESS_SYSCALL_FSYNC,
+	STRESS_SYSCALL_FUTIMENS,
+	STRESS_SYSCALL_GETCWD,
+	STRESS_SYSCALL_GETDENTS,
+	STRESS_SYSCALL_GETDENTS64,
+	STRESS_SYSCALL_GETGROUPS,
+	STRESS_SYSCALL_GETRANDOM,
+	STRESS_SYSCALL_GETRLIMIT,
+	STRESS_SYSCALL_GETTID,
+	STRESS_SYSCALL_GETTIMEOFDAY,
+	STRESS_SYSCALL_LSTAT,
+	STRESS_SYSCALL_SCHED_YIELD,
+	STRESS_SYSCALL_STAT,
+	STRESS_SYSCALL_STATX,
+	STRESS_SYSCALL_UTIMES,
+	STRESS_SYSCALL_WRITE,
+	STRESS_SYSCALL_MAX,
+} stress_syscall_id_t;
+
+#define STRESS_SYSCALL_BUCKETS	(32)	/* log2 tick histogram buckets */
+
+/* Per system call counts and cost in timer ticks */
+typedef struct {
+	uint64_t count;			/* number of calls */
+	uint64_t ticks;			/* total ticks in calls */
+	uint64_t max;			/* slowest call in ticks */
+	uint32_t buckets[STRESS_SYSCALL_BUCKETS]; /* log2 ticks histogram */
+} stress_syscall_stat_t;
+
+/* Bogo-ops counter snapshots bounding the measure window */
+typedef struct {
+	double warm_time;		/* end of warm-up, 0.0 = not taken */
+	uint64_t warm_counter;		/* bogo-ops at end of warm-up */
+	double cool_time;		/* start of cool-down, 0.0 = not taken */
+	uint64_t cool_counter;		/* bogo-ops at start of cool-down */
+	double end;			/* end of measure window, 0.0 = none */
+} stress_window_t;
+
 /* Per stressor statistics and accounting info */
 typedef struct {
-	uint64_t counter;		/* number of bogo ops */
+	stress_counter_info_t ci;	/* bogo ops counter, own cache line */
 	double start;			/* wall clock start time */
 	double finish;			/* wall clock stop time */
 	pid_t pid;			/* stressor pid */
 	bool signalled;			/* set true if signalled with a kill */
 #if defined(STRESS_PERF_STATS)
-	stress_perf_t sp;		/* perf counters */
+	stress_perf_t *sp;		/* perf counters, NULL if --perf is off */
 #endif
 #if defined(STRESS_THERMAL_ZONES)
-	stress_tz_t tz;			/* thermal zones */
+	stress_tz_t *tz;		/* thermal zones, NULL if --tz is off */
 #endif
 	stress_checksum_t *checksum;	/* pointer to checksum data */
 	stress_misc_stats_t misc_stats[STRESS_MISC_STATS_MAX];
+	stress_latency_t latency;	/* latency histogram */
+	stress_method_stats_t method_stats[STRESS_METHOD_STATS_MAX]; /* per method stats */
+	stress_schedstat_t schedstat;	/* run queue wait, --schedstat */
+	stress_freq_stats_t freq;	/* CPU frequency, --freq-stats */
+	stress_syscall_stat_t *syscall_stats; /* --syscall-stats, NULL if off */
+	stress_window_t window;		/* --warmup, --cooldown */
 #if defined(HAVE_GETRUSAGE)
 	double rusage_utime;		/* rusage user time */
 	double rusage_stime;		/* rusage system time */
@@ -853,9 +990,10 @@ typedef struct {
 #else
 	struct tms tms;			/* run time stats of process */
 #endif
-	bool counter_ready;		/* counter can be read */
+	uint64_t verify_ops;		/* ops verified, --verify */
+	int32_t placement_cpu;		/* CPU of --placement, -1 = not placed */
 	bool run_ok;			/* true if stressor exited OK */
-	uint8_t padding[6];		/* padding */
+	uint8_t padding[3];		/* padding */
 } stress_stats_t;
 
 #define	STRESS_WARN_HASH_MAX		(128)
@@ -923,6 +1061,8 @@ typedef struct {
 	struct {
 		uint32_t ready;				/* incremented when rawsock stressor is ready */
 	} rawsock;
+	double sync_start_time ALIGNED(8);		/* --sync-start barrier release time */
+	uint32_t num_stats;				/* number of stats[] entries */
 	stress_stats_t stats[];				/* Shared statistics */
 } stress_shared_t;
 
@@ -992,8 +1132,11 @@ typedef enum {
 	OPT_aio_requests,
 
 	OPT_aiol,
+	OPT_aiol_batch,
+	OPT_aiol_eventfd,
 	OPT_aiol_ops,
 	OPT_aiol_requests,
+	OPT_aiol_steady,
 
 	OPT_alarm,
 	OPT_alarm_ops,
@@ -1012,6 +1155,7 @@ typedef enum {
 
 	OPT_branch,
 	OPT_branch_ops,
+	OPT_branch_sweep,
 
 	OPT_brk,
 	OPT_brk_ops,
@@ -1019,11 +1163,15 @@ typedef enum {
 	OPT_brk_notouch,
 
 	OPT_bsearch,
+	OPT_bsearch_method,
 	OPT_bsearch_ops,
 	OPT_bsearch_size,
+	OPT_bsearch_sweep,
 
 	OPT_bigheap_ops,
 	OPT_bigheap_growth,
+	OPT_bigheap_bytes,
+	OPT_bigheap_bench,
 
 	OPT_bind_mount,
 	OPT_bind_mount_ops,
@@ -1034,6 +1182,7 @@ typedef enum {
 	OPT_class,
 
 	OPT_cache_ops,
+	OPT_cache_buffer,
 	OPT_cache_clflushopt,
 	OPT_cache_cldemote,
 	OPT_cache_clwb,
@@ -1049,11 +1198,21 @@ typedef enum {
 	OPT_cacheline,
 	OPT_cacheline_ops,
 	OPT_cacheline_affinity,
+	OPT_cacheline_matrix,
+	OPT_cacheline_matrix_csv,
 	OPT_cacheline_method,
 
 	OPT_cap,
 	OPT_cap_ops,
 
+	OPT_cgroup,
+	OPT_cgroup_cpu_max,
+	OPT_cgroup_cpuset_cpus,
+	OPT_cgroup_cpuset_mems,
+	OPT_cgroup_io_max,
+	OPT_cgroup_memory_high,
+	OPT_cgroup_memory_max,
+
 	OPT_chattr,
 	OPT_chattr_ops,
 
@@ -1080,12 +1239,36 @@ typedef enum {
 	OPT_close,
 	OPT_close_ops,
 
+	OPT_compactbench,
+	OPT_compactbench_ops,
+	OPT_compactbench_bytes,
+	OPT_compactbench_mode,
+
+	OPT_compare,
+	OPT_compare_threshold,
+
+	OPT_csv,
+
+	OPT_connchurn,
+	OPT_connchurn_ops,
+	OPT_connchurn_domain,
+	OPT_connchurn_fastopen,
+	OPT_connchurn_linger,
+	OPT_connchurn_port,
+	OPT_connchurn_reuseaddr,
+	OPT_connchurn_threads,
+
 	OPT_context,
 	OPT_context_ops,
+	OPT_context_sweep,
+
+	OPT_cooldown,
 
 	OPT_copy_file,
 	OPT_copy_file_ops,
+	OPT_copy_file_bench,
 	OPT_copy_file_bytes,
+	OPT_copy_file_dest,
 
 	OPT_cpu_ops,
 	OPT_cpu_method,
@@ -1096,12 +1279,20 @@ typedef enum {
 	OPT_cpu_online_ops,
 	OPT_cpu_online_all,
 
+	OPT_cpuidle,
+
 	OPT_crypt,
 	OPT_crypt_ops,
 
+	OPT_cryptbench,
+	OPT_cryptbench_method,
+	OPT_cryptbench_ops,
+	OPT_cryptbench_size,
+
 	OPT_cyclic,
 	OPT_cyclic_ops,
 	OPT_cyclic_method,
+	OPT_cyclic_pin,
 	OPT_cyclic_policy,
 	OPT_cyclic_prio,
 	OPT_cyclic_sleep,
@@ -1151,9 +1342,13 @@ typedef enum {
 
 	OPT_dup,
 	OPT_dup_ops,
+	OPT_dup_fds,
+	OPT_dup_scm,
+	OPT_dup_threads,
 
 	OPT_dynlib,
 	OPT_dynlib_ops,
+	OPT_dynlib_bench,
 
 	OPT_efivar,
 	OPT_efivar_ops,
@@ -1166,9 +1361,13 @@ typedef enum {
 
 	OPT_epoll,
 	OPT_epoll_ops,
+	OPT_epoll_clients,
 	OPT_epoll_port,
 	OPT_epoll_domain,
+	OPT_epoll_mt,
+	OPT_epoll_placement,
 	OPT_epoll_sockets,
+	OPT_epoll_threads,
 
 	OPT_eventfd,
 	OPT_eventfd_ops,
@@ -1180,6 +1379,7 @@ typedef enum {
 	OPT_exec_method,
 	OPT_exec_fork_method,
 	OPT_exec_no_pthread,
+	OPT_exec_startup,
 
 	OPT_exit_group,
 	OPT_exit_group_ops,
@@ -1193,11 +1393,18 @@ typedef enum {
 	OPT_fault,
 	OPT_fault_ops,
 
+	OPT_faultbench,
+	OPT_faultbench_ops,
+	OPT_faultbench_bytes,
+	OPT_faultbench_method,
+	OPT_faultbench_threads,
+
 	OPT_fcntl,
 	OPT_fcntl_ops,
 
 	OPT_fiemap,
 	OPT_fiemap_ops,
+	OPT_fiemap_bench,
 	OPT_fiemap_bytes,
 
 	OPT_fifo,
@@ -1207,10 +1414,24 @@ typedef enum {
 	OPT_file_ioctl,
 	OPT_file_ioctl_ops,
 
+	OPT_filelockbench,
+	OPT_filelockbench_ops,
+	OPT_filelockbench_method,
+	OPT_filelockbench_overlap,
+	OPT_filelockbench_procs,
+
 	OPT_filename,
 	OPT_filename_ops,
 	OPT_filename_opts,
 
+	OPT_fleet,
+	OPT_fleet_agent,
+	OPT_fleet_delay,
+	OPT_fleet_outlier,
+	OPT_fleet_report_fd,
+	OPT_fleet_secret,
+	OPT_fleet_start,
+
 	OPT_flock,
 	OPT_flock_ops,
 
@@ -1220,15 +1441,20 @@ typedef enum {
 
 	OPT_fp_error,
 	OPT_fp_error_ops,
+	OPT_fp_error_penalty,
 
 	OPT_fpunch,
 	OPT_fpunch_ops,
 
+	OPT_freq_stats,
+
 	OPT_fstat,
 	OPT_fstat_ops,
 	OPT_fstat_dir,
 
 	OPT_ftrace,
+	OPT_ftrace_baseline,
+	OPT_ftrace_top,
 
 	OPT_full,
 	OPT_full_ops,
@@ -1242,21 +1468,35 @@ typedef enum {
 	OPT_funcret_method,
 
 	OPT_futex,
+	OPT_futex_method,
 	OPT_futex_ops,
+	OPT_futex_threads,
 
 	OPT_get,
 	OPT_get_ops,
 
 	OPT_getrandom,
 	OPT_getrandom_ops,
+	OPT_getrandom_bench,
+	OPT_getrandom_bench_threads,
 
 	OPT_getdent,
 	OPT_getdent_ops,
+	OPT_getdent_bench,
+	OPT_getdent_entries,
+	OPT_getdent_readers,
 
 	OPT_goto,
 	OPT_goto_ops,
 	OPT_goto_direction,
 
+	OPT_graph,
+	OPT_graph_edgefactor,
+	OPT_graph_method,
+	OPT_graph_ops,
+	OPT_graph_scale,
+	OPT_graph_threads,
+
 	OPT_gpu,
 	OPT_gpu_ops,
 	OPT_gpu_devnode,
@@ -1269,14 +1509,22 @@ typedef enum {
 	OPT_handle,
 	OPT_handle_ops,
 
+	OPT_harness_overhead,
+
 	OPT_hash,
 	OPT_hash_ops,
 	OPT_hash_method,
 
+	OPT_hashtable,
+	OPT_hashtable_method,
+	OPT_hashtable_ops,
+	OPT_hashtable_size,
+
 	OPT_hdd_bytes,
 	OPT_hdd_write_size,
 	OPT_hdd_ops,
 	OPT_hdd_opts,
+	OPT_hdd_profile,
 
 	OPT_heapsort,
 	OPT_heapsort_ops,
@@ -1287,18 +1535,26 @@ typedef enum {
 	OPT_hrtimers_adjust,
 
 	OPT_hsearch,
+	OPT_hsearch_method,
 	OPT_hsearch_ops,
 	OPT_hsearch_size,
 
 	OPT_icache,
 	OPT_icache_ops,
+	OPT_icache_sweep,
 
 	OPT_icmp_flood,
 	OPT_icmp_flood_ops,
+	OPT_icmp_flood_pps,
+	OPT_icmp_flood_size_dist,
 
 	OPT_idle_page,
 	OPT_idle_page_ops,
 
+	OPT_idlewake,
+	OPT_idlewake_ops,
+	OPT_idlewake_samples,
+
 	OPT_ignite_cpu,
 
 	OPT_inode_flags,
@@ -1306,9 +1562,17 @@ typedef enum {
 
 	OPT_inotify,
 	OPT_inotify_ops,
+	OPT_inotify_bench,
+	OPT_inotify_producers,
+	OPT_inotify_queue,
+	OPT_inotify_watches,
+
+	OPT_instance_mode,
 
 	OPT_iomix,
 	OPT_iomix_bytes,
+	OPT_iomix_isolation,
+	OPT_iomix_isolation_writers,
 	OPT_iomix_ops,
 
 	OPT_ioport,
@@ -1327,22 +1591,36 @@ typedef enum {
 
 	OPT_io_uring,
 	OPT_io_uring_ops,
+	OPT_io_uring_batch,
+	OPT_io_uring_depth,
+	OPT_io_uring_fixed,
+	OPT_io_uring_iopoll,
+	OPT_io_uring_net,
+	OPT_io_uring_net_size,
+	OPT_io_uring_sqpoll,
+	OPT_io_uring_sqpoll_cpu,
 
 	OPT_ipsec_mb,
 	OPT_ipsec_mb_ops,
+	OPT_ipsec_mb_bench,
 	OPT_ipsec_mb_feature,
+	OPT_ipsec_mb_threads,
 
 	OPT_itimer,
 	OPT_itimer_ops,
 	OPT_itimer_freq,
 	OPT_itimer_rand,
 
+	OPT_json,
+
 	OPT_jpeg,
 	OPT_jpeg_ops,
+	OPT_jpeg_bench,
 	OPT_jpeg_height,
 	OPT_jpeg_image,
 	OPT_jpeg_width,
 	OPT_jpeg_quality,
+	OPT_jpeg_threads,
 
 	OPT_judy,
 	OPT_judy_ops,
@@ -1364,8 +1642,16 @@ typedef enum {
 
 	OPT_klog_check,
 
+	OPT_ksmbench,
+	OPT_ksmbench_ops,
+	OPT_ksmbench_bytes,
+	OPT_ksmbench_dup,
+	OPT_ksmbench_entropy,
+
 	OPT_kvm,
 	OPT_kvm_ops,
+	OPT_kvm_exit_bench,
+	OPT_kvm_exit_vcpus,
 
 	OPT_l1cache,
 	OPT_l1cache_ops,
@@ -1388,6 +1674,7 @@ typedef enum {
 	OPT_list_ops,
 	OPT_list_method,
 	OPT_list_size,
+	OPT_list_threads,
 
 	OPT_loadavg,
 	OPT_loadavg_ops,
@@ -1402,9 +1689,20 @@ typedef enum {
 	OPT_lockf_ops,
 	OPT_lockf_nonblock,
 
+	OPT_lockfree,
+	OPT_lockfree_ops,
+	OPT_lockfree_consumers,
+	OPT_lockfree_method,
+	OPT_lockfree_producers,
+
 	OPT_lockofd,
 	OPT_lockofd_ops,
 
+	OPT_lockscale,
+	OPT_lockscale_ops,
+	OPT_lockscale_method,
+	OPT_lockscale_threads,
+
 	OPT_log_brief,
 	OPT_log_file,
 
@@ -1413,10 +1711,13 @@ typedef enum {
 
 	OPT_loop,
 	OPT_loop_ops,
+	OPT_loop_bench,
 
 	OPT_lsearch,
+	OPT_lsearch_method,
 	OPT_lsearch_ops,
 	OPT_lsearch_size,
+	OPT_lsearch_sweep,
 
 	OPT_madvise,
 	OPT_madvise_ops,
@@ -1425,6 +1726,9 @@ typedef enum {
 
 	OPT_malloc,
 	OPT_malloc_ops,
+	OPT_malloc_bench,
+	OPT_malloc_bench_trace,
+	OPT_malloc_bench_xfree,
 	OPT_malloc_bytes,
 	OPT_malloc_max,
 	OPT_malloc_pthreads,
@@ -1436,12 +1740,14 @@ typedef enum {
 	OPT_matrix_ops,
 	OPT_matrix_size,
 	OPT_matrix_method,
+	OPT_matrix_type,
 	OPT_matrix_yx,
 
 	OPT_matrix_3d,
 	OPT_matrix_3d_ops,
 	OPT_matrix_3d_size,
 	OPT_matrix_3d_method,
+	OPT_matrix_3d_type,
 	OPT_matrix_3d_zyx,
 
 	OPT_maximize,
@@ -1450,12 +1756,15 @@ typedef enum {
 	OPT_mcontend,
 	OPT_mcontend_ops,
 
+	OPT_mem_backing,
+
 	OPT_membarrier,
 	OPT_membarrier_ops,
 
 	OPT_memcpy,
 	OPT_memcpy_ops,
 	OPT_memcpy_method,
+	OPT_memcpy_sweep,
 
 	OPT_memfd,
 	OPT_memfd_ops,
@@ -1470,6 +1779,9 @@ typedef enum {
 	OPT_memrate_rd_mbs,
 	OPT_memrate_wr_mbs,
 	OPT_memrate_bytes,
+	OPT_memrate_latency,
+	OPT_memrate_latency_steps,
+	OPT_memrate_latency_threads,
 
 	OPT_memthrash,
 	OPT_memthrash_ops,
@@ -1479,7 +1791,14 @@ typedef enum {
 	OPT_mergesort_ops,
 	OPT_mergesort_integers,
 
+	OPT_metamix,
+	OPT_metamix_ops,
+	OPT_metamix_mode,
+	OPT_metamix_threads,
+
 	OPT_metrics_brief,
+	OPT_metrics_interval,
+	OPT_metrics_interval_csv,
 
 	OPT_mincore,
 	OPT_mincore_ops,
@@ -1488,6 +1807,7 @@ typedef enum {
 	OPT_misaligned,
 	OPT_misaligned_ops,
 	OPT_misaligned_method,
+	OPT_misaligned_timing,
 
 	OPT_mknod,
 	OPT_mknod_ops,
@@ -1533,15 +1853,22 @@ typedef enum {
 	OPT_mq,
 	OPT_mq_ops,
 	OPT_mq_size,
+	OPT_mq_sweep,
 
 	OPT_mremap,
 	OPT_mremap_ops,
 	OPT_mremap_bytes,
 	OPT_mremap_mlock,
 
+	OPT_mremapbench,
+	OPT_mremapbench_ops,
+	OPT_mremapbench_bytes,
+	OPT_mremapbench_method,
+
 	OPT_msg,
 	OPT_msg_ops,
 	OPT_msg_types,
+	OPT_msg_sweep,
 
 	OPT_msync,
 	OPT_msync_bytes,
@@ -1572,8 +1899,12 @@ typedef enum {
 
 	OPT_nice,
 	OPT_nice_ops,
+	OPT_nice_fairness,
+	OPT_nice_fairness_slice,
+	OPT_nice_fairness_tasks,
 
 	OPT_no_madvise,
+	OPT_node_alloc,
 	OPT_no_oom_adjust,
 	OPT_no_rand_seed,
 
@@ -1586,9 +1917,15 @@ typedef enum {
 
 	OPT_numa,
 	OPT_numa_ops,
+	OPT_numa_migrate,
+	OPT_numa_migrate_batch,
+	OPT_numa_migrate_bytes,
 
 	OPT_oomable,
 
+	OPT_openmetrics,
+	OPT_openmetrics_interval,
+
 	OPT_oom_pipe,
 	OPT_oom_pipe_ops,
 
@@ -1603,13 +1940,25 @@ typedef enum {
 	OPT_page_in,
 	OPT_pathological,
 
+	OPT_pagecachebench,
+	OPT_pagecachebench_ops,
+	OPT_pagecachebench_bytes,
+	OPT_pagecachebench_method,
+	OPT_pagecachebench_threads,
+
 	OPT_pageswap,
 	OPT_pageswap_ops,
 
 	OPT_pci,
 	OPT_pci_ops,
 
+	OPT_percpu,
+	OPT_percpu_ops,
+	OPT_percpu_method,
+	OPT_percpu_threads,
+
 	OPT_perf_stats,
+	OPT_perf_uncore,
 
 	OPT_personality,
 	OPT_personality_ops,
@@ -1633,21 +1982,34 @@ typedef enum {
 	OPT_pipeherd,
 	OPT_pipeherd_ops,
 	OPT_pipeherd_yield,
+	OPT_pipeherd_bench,
+	OPT_pipeherd_bench_max,
 
 	OPT_pkey,
 	OPT_pkey_ops,
 
+	OPT_placement,
+
 	OPT_plugin,
 	OPT_plugin_ops,
+	OPT_plugin_batch,
 	OPT_plugin_method,
 	OPT_plugin_so,
 
 	OPT_poll_ops,
 	OPT_poll_fds,
 
+	OPT_pollbench,
+	OPT_pollbench_ops,
+	OPT_pollbench_active,
+	OPT_pollbench_fds,
+	OPT_pollbench_method,
+
 	OPT_prefetch,
 	OPT_prefetch_ops,
 	OPT_prefetch_l3_size,
+	OPT_prefetch_sweep,
+	OPT_prefetch_sweep_hwpf,
 
 	OPT_prctl,
 	OPT_prctl_ops,
@@ -1655,13 +2017,29 @@ typedef enum {
 	OPT_procfs,
 	OPT_procfs_ops,
 
+	OPT_pseudofsbench,
+	OPT_pseudofsbench_ops,
+	OPT_pseudofsbench_files,
+	OPT_pseudofsbench_threads,
+
+	OPT_psi,
+	OPT_psi_cgroup,
+
 	OPT_pthread,
 	OPT_pthread_ops,
 	OPT_pthread_max,
+	OPT_pthread_bench,
+	OPT_pthread_bench_tls_so,
 
 	OPT_ptrace,
+	OPT_ptrace_bench,
 	OPT_ptrace_ops,
 
+	OPT_ptrchase,
+	OPT_ptrchase_ops,
+	OPT_ptrchase_max_bytes,
+	OPT_ptrchase_mlp,
+
 	OPT_pty,
 	OPT_pty_ops,
 	OPT_pty_max,
@@ -1683,6 +2061,8 @@ typedef enum {
 	OPT_randlist_items,
 	OPT_randlist_size,
 
+	OPT_rapl,
+
 	OPT_ramfs,
 	OPT_ramfs_ops,
 	OPT_ramfs_size,
@@ -1693,7 +2073,9 @@ typedef enum {
 
 	OPT_rawpkt,
 	OPT_rawpkt_ops,
+	OPT_rawpkt_if,
 	OPT_rawpkt_port,
+	OPT_rawpkt_ring,
 
 	OPT_rawsock,
 	OPT_rawsock_ops,
@@ -1710,6 +2092,7 @@ typedef enum {
 	OPT_readahead,
 	OPT_readahead_ops,
 	OPT_readahead_bytes,
+	OPT_readahead_bench,
 
 	OPT_reboot,
 	OPT_reboot_ops,
@@ -1722,6 +2105,15 @@ typedef enum {
 
 	OPT_rename_ops,
 
+	OPT_repeat,
+	OPT_repeat_cv,
+	OPT_repeat_warmup,
+
+	OPT_resctrl,
+	OPT_resctrl_interval,
+	OPT_resctrl_l3_ways,
+	OPT_resctrl_mb,
+
 	OPT_resched,
 	OPT_resched_ops,
 
@@ -1745,6 +2137,11 @@ typedef enum {
 	OPT_rtc,
 	OPT_rtc_ops,
 
+	OPT_sample,
+	OPT_sample_file,
+
+	OPT_scale_sweep,
+
 	OPT_sched,
 	OPT_sched_prio,
 
@@ -1755,19 +2152,25 @@ typedef enum {
 	OPT_sched_runtime,
 	OPT_sched_deadline,
 	OPT_sched_reclaim,
+	OPT_schedstat,
 
 	OPT_sctp,
 	OPT_sctp_ops,
+	OPT_sctp_assocs,
+	OPT_sctp_bench,
 	OPT_sctp_domain,
 	OPT_sctp_if,
 	OPT_sctp_port,
 	OPT_sctp_sched,
+	OPT_sctp_streams,
 
 	OPT_seal,
 	OPT_seal_ops,
 
 	OPT_seccomp,
 	OPT_seccomp_ops,
+	OPT_seccomp_bench,
+	OPT_seccomp_stack,
 
 	OPT_secretmem,
 	OPT_secretmem_ops,
@@ -1811,6 +2214,12 @@ typedef enum {
 	OPT_shm_sysv_bytes,
 	OPT_shm_sysv_segments,
 
+	OPT_shmbench,
+	OPT_shmbench_ops,
+	OPT_shmbench_bytes,
+	OPT_shmbench_method,
+	OPT_shmbench_wake,
+
 	OPT_sequential,
 
 	OPT_sigabrt,
@@ -1828,6 +2237,11 @@ typedef enum {
 	OPT_sigio,
 	OPT_sigio_ops,
 
+	OPT_siglat,
+	OPT_siglat_ops,
+	OPT_siglat_method,
+	OPT_siglat_threads,
+
 	OPT_signal,
 	OPT_signal_ops,
 
@@ -1858,6 +2272,7 @@ typedef enum {
 	OPT_skiplist,
 	OPT_skiplist_ops,
 	OPT_skiplist_size,
+	OPT_skiplist_threads,
 
 	OPT_skip_silent,
 
@@ -1875,8 +2290,12 @@ typedef enum {
 	OPT_sock_if,
 	OPT_sock_nodelay,
 	OPT_sock_opts,
+	OPT_sock_placement,
 	OPT_sock_port,
 	OPT_sock_protocol,
+	OPT_sock_rr,
+	OPT_sock_rr_req,
+	OPT_sock_rr_resp,
 	OPT_sock_type,
 	OPT_sock_zerocopy,
 
@@ -1884,7 +2303,9 @@ typedef enum {
 	OPT_sockabuse_ops,
 
 	OPT_sockdiag,
+	OPT_sockdiag_bench,
 	OPT_sockdiag_ops,
+	OPT_sockdiag_sockets,
 
 	OPT_sockfd,
 	OPT_sockfd_ops,
@@ -1895,26 +2316,51 @@ typedef enum {
 	OPT_sockmany_if,
 
 	OPT_sockpair,
+	OPT_sockpair_bench,
 	OPT_sockpair_ops,
 
 	OPT_softlockup,
 	OPT_softlockup_ops,
 
+	OPT_sortbench,
+	OPT_sortbench_data,
+	OPT_sortbench_method,
+	OPT_sortbench_ops,
+	OPT_sortbench_presort,
+	OPT_sortbench_size,
+	OPT_sortbench_threads,
+
 	OPT_swap,
 	OPT_swap_ops,
 
+	OPT_swapbench,
+	OPT_swapbench_ops,
+	OPT_swapbench_bytes,
+	OPT_swapbench_page_cluster,
+	OPT_swapbench_pattern,
+	OPT_swapbench_threads,
+
 	OPT_switch_ops,
 	OPT_switch_freq,
+	OPT_switch_matrix,
 	OPT_switch_method,
 
 	OPT_spawn,
 	OPT_spawn_ops,
 
+	OPT_spawnbench,
+	OPT_spawnbench_ops,
+	OPT_spawnbench_method,
+	OPT_spawnbench_rss,
+
 	OPT_sparsematrix,
 	OPT_sparsematrix_ops,
 	OPT_sparsematrix_items,
 	OPT_sparsematrix_method,
 	OPT_sparsematrix_size,
+	OPT_sparsematrix_spmv,
+	OPT_sparsematrix_threads,
+	OPT_sparsematrix_band,
 
 	OPT_splice,
 	OPT_splice_ops,
@@ -1924,6 +2370,8 @@ typedef enum {
 	OPT_stack_ops,
 	OPT_stack_fill,
 	OPT_stack_mlock,
+	OPT_stack_bench,
+	OPT_stack_bench_size,
 
 	OPT_stackmmap,
 	OPT_stackmmap_ops,
@@ -1933,12 +2381,16 @@ typedef enum {
 	OPT_str,
 	OPT_str_ops,
 	OPT_str_method,
+	OPT_str_sweep,
 
 	OPT_stream,
 	OPT_stream_ops,
 	OPT_stream_index,
 	OPT_stream_l3_size,
 	OPT_stream_madvise,
+	OPT_stream_numa,
+	OPT_stream_numa_node,
+	OPT_stream_simd,
 
 	OPT_stressors,
 
@@ -1948,6 +2400,9 @@ typedef enum {
 	OPT_sync_file,
 	OPT_sync_file_ops,
 	OPT_sync_file_bytes,
+	OPT_sync_file_matrix,
+
+	OPT_sync_start,
 
 	OPT_syncload,
 	OPT_syncload_ops,
@@ -1957,6 +2412,8 @@ typedef enum {
 	OPT_sysbadaddr,
 	OPT_sysbadaddr_ops,
 
+	OPT_syscall_stats,
+
 	OPT_sysinfo,
 	OPT_sysinfo_ops,
 
@@ -1971,6 +2428,9 @@ typedef enum {
 	OPT_tee,
 	OPT_tee_ops,
 
+	OPT_target_cpu,
+	OPT_target_ops,
+
 	OPT_taskset,
 
 	OPT_temp_path,
@@ -1986,6 +2446,11 @@ typedef enum {
 	OPT_timer_freq,
 	OPT_timer_rand,
 
+	OPT_timerbench,
+	OPT_timerbench_ops,
+	OPT_timerbench_method,
+	OPT_timerbench_samples,
+
 	OPT_timerfd,
 	OPT_timerfd_ops,
 	OPT_timerfd_fds,
@@ -1998,6 +2463,13 @@ typedef enum {
 
 	OPT_tlb_shootdown,
 	OPT_tlb_shootdown_ops,
+	OPT_tlb_shootdown_sweep,
+
+	OPT_tlbreach,
+	OPT_tlbreach_bytes,
+	OPT_tlbreach_ops,
+	OPT_tlbreach_page,
+	OPT_tlbreach_pattern,
 
 	OPT_tmpfs,
 	OPT_tmpfs_ops,
@@ -2013,6 +2485,7 @@ typedef enum {
 	OPT_tree_ops,
 	OPT_tree_method,
 	OPT_tree_size,
+	OPT_tree_sweep,
 
 	OPT_tsc,
 	OPT_tsc_ops,
@@ -2022,26 +2495,38 @@ typedef enum {
 	OPT_tsearch_size,
 
 	OPT_tun,
+	OPT_tun_bench,
 	OPT_tun_ops,
+	OPT_tun_queues,
 	OPT_tun_tap,
 
 	OPT_udp,
 	OPT_udp_ops,
+	OPT_udp_batch,
+	OPT_udp_bench,
+	OPT_udp_busy_poll,
+	OPT_udp_placement,
 	OPT_udp_port,
 	OPT_udp_domain,
 	OPT_udp_lite,
 	OPT_udp_gro,
+	OPT_udp_gso,
 	OPT_udp_if,
 
 	OPT_udp_flood,
 	OPT_udp_flood_ops,
 	OPT_udp_flood_domain,
 	OPT_udp_flood_if,
+	OPT_udp_flood_pps,
+	OPT_udp_flood_size_dist,
 
 	OPT_unshare,
 	OPT_unshare_ops,
+	OPT_unshare_bench,
+	OPT_unshare_mounts,
 
 	OPT_uprobe,
+	OPT_uprobe_bench,
 	OPT_uprobe_ops,
 
 	OPT_urandom_ops,
@@ -2060,11 +2545,17 @@ typedef enum {
 	OPT_vdso,
 	OPT_vdso_ops,
 	OPT_vdso_func,
+	OPT_vdso_matrix,
 
 	OPT_vecfp,
 	OPT_vecfp_ops,
 	OPT_vecfp_method,
 
+	OPT_vecfreq,
+	OPT_vecfreq_ops,
+	OPT_vecfreq_dwell,
+	OPT_vecfreq_tier,
+
 	OPT_vecmath,
 	OPT_vecmath_ops,
 
@@ -2072,6 +2563,8 @@ typedef enum {
 	OPT_vecwide_ops,
 
 	OPT_verify,
+	OPT_verify_sample,
+	OPT_verify_sample_mode,
 	OPT_verifiable,
 
 	OPT_verity,
@@ -2093,6 +2586,9 @@ typedef enum {
 	OPT_vm_ops,
 	OPT_vm_madvise,
 	OPT_vm_method,
+	OPT_vm_prefault,
+	OPT_vm_rowhammer_sides,
+	OPT_vm_rowhammer_row_stride,
 
 	OPT_vm_addr,
 	OPT_vm_addr_method,
@@ -2100,7 +2596,9 @@ typedef enum {
 
 	OPT_vm_rw,
 	OPT_vm_rw_ops,
+	OPT_vm_rw_bench,
 	OPT_vm_rw_bytes,
+	OPT_vm_rw_threads,
 
 	OPT_vm_segv,
 	OPT_vm_segv_ops,
@@ -2114,12 +2612,35 @@ typedef enum {
 	OPT_wait,
 	OPT_wait_ops,
 
+	OPT_warmup,
+
+	OPT_waves,
+
 	OPT_watchdog,
 	OPT_watchdog_ops,
 
 	OPT_wcs,
 	OPT_wcs_ops,
 	OPT_wcs_method,
+	OPT_wcs_sweep,
+
+	OPT_worker_pool,
+
+	OPT_worksteal,
+	OPT_worksteal_ops,
+	OPT_worksteal_depth,
+	OPT_worksteal_grain,
+	OPT_worksteal_park,
+
+	OPT_wss,
+	OPT_wss_interval,
+	OPT_wss_timeline,
+	OPT_worksteal_threads,
+
+	OPT_writeback,
+	OPT_writeback_ops,
+	OPT_writeback_bytes,
+	OPT_writeback_rate,
 
 	OPT_x86syscall,
 	OPT_x86syscall_ops,
@@ -2127,20 +2648,29 @@ typedef enum {
 
 	OPT_xattr,
 	OPT_xattr_ops,
+	OPT_xattr_bench,
+	OPT_xattr_threads,
 
 	OPT_yield_ops,
 
 	OPT_zero,
 	OPT_zero_ops,
 
+	OPT_zerocopy,
+	OPT_zerocopy_ops,
+	OPT_zerocopy_bytes,
+	OPT_zerocopy_method,
+
 	OPT_zlib,
 	OPT_zlib_ops,
+	OPT_zlib_codec,
 	OPT_zlib_level,
 	OPT_zlib_mem_level,
 	OPT_zlib_method,
 	OPT_zlib_window_bits,
 	OPT_zlib_stream_bytes,
 	OPT_zlib_strategy,
+	OPT_zlib_threads,
 
 	OPT_zombie,
 	OPT_zombie_ops,
@@ -2207,16 +2737,19 @@ static inline void ALWAYS_INLINE OPTIMIZE3 keep_stressing_set_flag(const bool se
 
 /*
  *  inc_counter()
- *	increment the stessor bogo ops counter
+ *	increment the stessor bogo ops counter, the counter_ready
+ *	flag is only cleared while the counter is being updated so
+ *	that a stressor killed mid-update can be detected
  */
 static inline void ALWAYS_INLINE inc_counter(const stress_args_t *args)
 {
-	*args->counter_ready = false;
-	shim_mb();
-	(*(args->counter))++;
+	stress_counter_info_t *const ci = args->ci;
+
+	ci->counter_ready = false;
 	shim_mb();
-	*args->counter_ready = true;
+	ci->counter++;
 	shim_mb();
+	ci->counter_ready = true;
 }
 
 /*
@@ -2225,7 +2758,7 @@ static inline void ALWAYS_INLINE inc_counter(const stress_args_t *args)
  */
 static inline uint64_t ALWAYS_INLINE get_counter(const stress_args_t *args)
 {
-	return *args->counter;
+	return args->ci->counter;
 }
 
 /*
@@ -2234,12 +2767,13 @@ static inline uint64_t ALWAYS_INLINE get_counter(const stress_args_t *args)
  */
 static inline void ALWAYS_INLINE set_counter(const stress_args_t *args, const uint64_t val)
 {
-	*args->counter_ready = false;
-	shim_mb();
-	*args->counter = val;
+	stress_counter_info_t *const ci = args->ci;
+
+	ci->counter_ready = false;
 	shim_mb();
-	*args->counter_ready = true;
+	ci->counter = val;
 	shim_mb();
+	ci->counter_ready = true;
 }
 
 /*
@@ -2248,24 +2782,97 @@ static inline void ALWAYS_INLINE set_counter(const stress_args_t *args, const ui
  */
 static inline void ALWAYS_INLINE add_counter(const stress_args_t *args, const uint64_t inc)
 {
-	*args->counter_ready = false;
-	shim_mb();
-	*args->counter += inc;
+	stress_counter_info_t *const ci = args->ci;
+
+	ci->counter_ready = false;
 	shim_mb();
-	*args->counter_ready = true;
+	ci->counter += inc;
 	shim_mb();
+	ci->counter_ready = true;
 }
 
+extern void stress_throttle(const stress_args_t *args);
+
 /*
  *  keep_stressing()
  *      returns true if we can keep on running a stressor
  */
 static inline bool ALWAYS_INLINE OPTIMIZE3 keep_stressing(const stress_args_t *args)
 {
+	if (UNLIKELY(args->ci->throttle))
+		stress_throttle(args);
 	return (LIKELY(g_keep_stressing_flag) &&
 		LIKELY(!args->max_ops || (get_counter(args) < args->max_ops)));
 }
 
+/*
+ *  Batched bogo ops accounting for tight loops, ops are accumulated
+ *  locally and added to the shared counter every batch ops
+ */
+typedef struct {
+	uint64_t count;		/* ops not yet added to the counter */
+	uint64_t batch;		/* add to the counter every batch ops */
+} stress_counter_batch_t;
+
+/*
+ *  stress_counter_batch_init()
+ *	initialize a batched bogo ops accumulator
+ */
+static inline void ALWAYS_INLINE stress_counter_batch_init(
+	stress_counter_batch_t *cb,
+	const uint64_t batch)
+{
+	cb->count = 0;
+	cb->batch = batch ? batch : 1;
+}
+
+/*
+ *  flush_counter_batch()
+ *	add any locally accumulated bogo ops to the stressor counter
+ */
+static inline void ALWAYS_INLINE flush_counter_batch(
+	const stress_args_t *args,
+	stress_counter_batch_t *cb)
+{
+	if (cb->count) {
+		add_counter(args, cb->count);
+		cb->count = 0;
+	}
+}
+
+/*
+ *  inc_counter_batch()
+ *	increment the local bogo ops count, add it to the
+ *	stressor counter once a full batch has accumulated
+ */
+static inline void ALWAYS_INLINE inc_counter_batch(
+	const stress_args_t *args,
+	stress_counter_batch_t *cb)
+{
+	if (UNLIKELY(++cb->count >= cb->batch))
+		flush_counter_batch(args, cb);
+}
+
+/*
+ *  keep_stressing_batch()
+ *	keep_stressing() for batched counters, takes the locally
+ *	accumulated ops into account so max_ops is honoured exactly
+ *	and flushes them to the counter once the stressor should stop
+ */
+static inline bool ALWAYS_INLINE OPTIMIZE3 keep_stressing_batch(
+	const stress_args_t *args,
+	stress_counter_batch_t *cb)
+{
+	if (UNLIKELY(args->ci->throttle))
+		stress_throttle(args);
+	if (LIKELY(g_keep_stressing_flag) &&
+	    LIKELY(!args->max_ops || ((get_counter(args) + cb->count) < args->max_ops)))
+		return true;
+
+	flush_counter_batch(args, cb);
+	return false;
+}
+
 /*
  *  inc_counter_lock()
  *	increment the stessor bogo ops counter with lock, return true
@@ -2323,9 +2930,38 @@ extern void stress_cwd_readwriteable(void);
 extern const char *stress_signal_name(const int signum);
 extern const char *stress_strsignal(const int signum);
 
+/* Fast random number generator state, see core-mwc.c */
+typedef struct {
+	uint32_t w;
+	uint32_t z;
+} stress_mwc_t;
+
+extern stress_mwc_t g_mwc;
+
+/*
+ *  stress_mwc32()
+ *      Multiply-with-carry random numbers
+ *      fast pseudo random number generator, see
+ *      http://www.cse.yorku.ca/~oz/marsaglia-rng.html
+ */
+static inline uint32_t ALWAYS_INLINE OPTIMIZE3 stress_mwc32(void)
+{
+	g_mwc.z = 36969 * (g_mwc.z & 65535) + (g_mwc.z >> 16);
+	g_mwc.w = 18000 * (g_mwc.w & 65535) + (g_mwc.w >> 16);
+	return (g_mwc.z << 16) + g_mwc.w;
+}
+
+/*
+ *  stress_mwc64()
+ *	get a 64 bit pseudo random number
+ */
+static inline uint64_t ALWAYS_INLINE OPTIMIZE3 stress_mwc64(void)
+{
+	return (((uint64_t)stress_mwc32()) << 32) | stress_mwc32();
+}
+
 /* Fast random numbers */
-extern uint32_t stress_mwc32(void);
-extern uint64_t stress_mwc64(void);
+extern void stress_mwc_fill(void *buf, const size_t len);
 extern uint16_t stress_mwc16(void);
 extern uint8_t stress_mwc8(void);
 extern uint8_t stress_mwc1(void);
@@ -2408,6 +3044,7 @@ extern WARN_UNUSED size_t stress_min_pthread_stack_size(void);
 extern void stress_shared_unmap(void);
 extern void stress_log_system_mem_info(void);
 extern WARN_UNUSED char *stress_munge_underscore(const char *str);
+extern const char *stress_get_class_name(const uint32_t class);
 extern size_t stress_get_page_size(void);
 extern WARN_UNUSED int32_t stress_get_processors_online(void);
 extern WARN_UNUSED int32_t stress_get_processors_configured(void);
@@ -2435,6 +3072,7 @@ extern WARN_UNUSED const char *stress_get_compiler(void);
 extern WARN_UNUSED const char *stress_get_uname_info(void);
 extern WARN_UNUSED int stress_cache_alloc(const char *name);
 extern void stress_cache_free(void);
+extern uint64_t stress_cache_instance_size(void);
 extern void stress_klog_start(void);
 extern void stress_klog_stop(bool *success);
 extern void stress_ignite_cpu_start(void);
@@ -2450,6 +3088,15 @@ extern WARN_UNUSED size_t stress_get_max_file_limit(void);
 extern WARN_UNUSED int stress_get_bad_fd(void);
 extern void stress_vmstat_start(void);
 extern void stress_vmstat_stop(void);
+extern void stress_vmstat_openmetrics(FILE *fp);
+extern void stress_sample_start(stress_stressor_t *stressors_list);
+extern void stress_sample_stop(void);
+extern void stress_sample_json(FILE *fp, stress_stressor_t *stressors_list);
+extern WARN_UNUSED double stress_get_cpu_ghz_average(void);
+extern WARN_UNUSED double stress_get_cpu_ghz(const unsigned int cpu);
+extern int stress_get_meminfo_dirty(uint64_t *dirty_kb, uint64_t *writeback_kb);
+extern int stress_get_vmstat_counters(const char * const *names, uint64_t *values,
+	const size_t n);
 extern WARN_UNUSED char *stress_find_mount_dev(const char *name);
 extern WARN_UNUSED int stress_sigaltstack_no_check(void *stack, const size_t size);
 extern WARN_UNUSED int stress_sigaltstack(void *stack, const size_t size);
@@ -2499,9 +3146,13 @@ extern WARN_UNUSED pid_t stress_get_unused_pid_racy(const bool fork_test);
 extern WARN_UNUSED size_t stress_hostname_length(void);
 extern WARN_UNUSED int32_t stress_set_vmstat(const char *const str);
 extern WARN_UNUSED int32_t stress_set_thermalstat(const char *const str);
+extern WARN_UNUSED int32_t stress_set_sample(const char *const str);
 extern WARN_UNUSED int32_t stress_set_iostat(const char *const str);
 extern void stress_misc_stats_set(stress_misc_stats_t *misc_stats,
 	const size_t idx, const char *description, const double value);
+extern size_t stress_misc_stats_thread_scaling(stress_misc_stats_t *misc_stats,
+	size_t idx, const char *unit, const uint32_t threads1, const double rate1,
+	const uint32_t threadsn, const double raten);
 extern WARN_UNUSED int stress_tty_width(void);
 extern WARN_UNUSED size_t stress_get_extents(const int fd);
 extern WARN_UNUSED bool stress_redo_fork(const int err);
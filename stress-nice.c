@@ -19,11 +19,133 @@
  */
 #include "stress-ng.h"
 #include "core-capabilities.h"
+#include "core-clock.h"
+#include "core-latency.h"
+#include "core-put.h"
+
+#define MIN_NICE_FAIRNESS_SLICE		(100)		/* us */
+#define MAX_NICE_FAIRNESS_SLICE		(100000)	/* us */
+
+#define NICE_FAIRNESS_TASKS_MAX		(32)
+#define NICE_FAIRNESS_WINDOW		(2.0)		/* seconds per pass */
+#define NICE_FAIRNESS_PERIOD_NS		(1000000)	/* interactive wakeup period */
+#define NICE_FAIRNESS_RUN_NS		(100000)	/* interactive run time */
+
+#define NICE_FAIRNESS_OTHER		(0)
+#define NICE_FAIRNESS_BATCH		(1)
+#define NICE_FAIRNESS_IDLE		(2)
+#define NICE_FAIRNESS_INTER		(3)
+
+static const char * const nice_fairness_policies[] = {
+	"other",	/* CPU bound SCHED_OTHER */
+	"batch",	/* CPU bound SCHED_BATCH */
+	"idle",		/* CPU bound SCHED_IDLE */
+	"inter",	/* SCHED_OTHER, runs 100us every 1ms */
+};
+
+/* a task of the fairness mix */
+typedef struct {
+	int policy;			/* NICE_FAIRNESS_OTHER .. INTER */
+	int nice;			/* requested nice level */
+} stress_nice_fairness_task_t;
 
 static const stress_help_t help[] = {
-	{ NULL,	"nice N",	"start N workers that randomly re-adjust nice levels" },
-	{ NULL,	"nice-ops N",	"stop after N nice bogo operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"nice N",		"start N workers that randomly re-adjust nice levels" },
+	{ NULL,	"nice-fairness",	"measure CPU share against weight of a mix of nice levels and policies" },
+	{ NULL,	"nice-fairness-slice N", "request an N us EEVDF slice for the interactive tasks" },
+	{ NULL,	"nice-fairness-tasks L", "task mix, e.g. other:0,other:5,batch:0,idle:0,inter:0" },
+	{ NULL,	"nice-ops N",		"stop after N nice bogo operations" },
+	{ NULL,	NULL,			NULL }
+};
+
+/*
+ *  stress_nice_fairness_parse()
+ *	parse a comma separated list of policy:nice tasks, the
+ *	nice level is optional and defaults to 0
+ */
+static int stress_nice_fairness_parse(
+	const char *str,
+	stress_nice_fairness_task_t *tasks,
+	size_t *n_tasks)
+{
+	char buf[1024];
+	char *ptr, *tok, *saveptr = NULL;
+	size_t n = 0;
+
+	(void)shim_strlcpy(buf, str, sizeof(buf));
+	for (ptr = buf; (tok = strtok_r(ptr, ",", &saveptr)) != NULL; ptr = NULL) {
+		char *colon = strchr(tok, ':');
+		size_t i;
+
+		if (n >= NICE_FAIRNESS_TASKS_MAX) {
+			(void)fprintf(stderr, "nice-fairness-tasks: more than %d tasks\n",
+				NICE_FAIRNESS_TASKS_MAX);
+			return -1;
+		}
+		tasks[n].nice = 0;
+		if (colon) {
+			*colon = '\0';
+			tasks[n].nice = atoi(colon + 1);
+			if ((tasks[n].nice < -20) || (tasks[n].nice > 19)) {
+				(void)fprintf(stderr, "nice-fairness-tasks: nice level %d "
+					"out of range -20..19\n", tasks[n].nice);
+				return -1;
+			}
+		}
+		for (i = 0; i < SIZEOF_ARRAY(nice_fairness_policies); i++) {
+			if (!strcmp(tok, nice_fairness_policies[i]))
+				break;
+		}
+		if (i == SIZEOF_ARRAY(nice_fairness_policies)) {
+			(void)fprintf(stderr, "nice-fairness-tasks: policy must be one of:");
+			for (i = 0; i < SIZEOF_ARRAY(nice_fairness_policies); i++)
+				(void)fprintf(stderr, " %s", nice_fairness_policies[i]);
+			(void)fprintf(stderr, "\n");
+			return -1;
+		}
+		tasks[n].policy = (int)i;
+		n++;
+	}
+	if (!n) {
+		(void)fprintf(stderr, "nice-fairness-tasks: no tasks specified\n");
+		return -1;
+	}
+	*n_tasks = n;
+	return 0;
+}
+
+static int stress_set_nice_fairness(const char *opt)
+{
+	return stress_set_setting_true("nice-fairness", opt);
+}
+
+static int stress_set_nice_fairness_slice(const char *opt)
+{
+	uint32_t nice_fairness_slice;
+
+	nice_fairness_slice = stress_get_uint32(opt);
+	stress_check_range("nice-fairness-slice", (uint64_t)nice_fairness_slice,
+		MIN_NICE_FAIRNESS_SLICE, MAX_NICE_FAIRNESS_SLICE);
+	(void)stress_set_setting_true("nice-fairness", NULL);
+	return stress_set_setting("nice-fairness-slice", TYPE_ID_UINT32, &nice_fairness_slice);
+}
+
+static int stress_set_nice_fairness_tasks(const char *opt)
+{
+	stress_nice_fairness_task_t tasks[NICE_FAIRNESS_TASKS_MAX];
+	size_t n_tasks;
+
+	if (stress_nice_fairness_parse(opt, tasks, &n_tasks) < 0)
+		return -1;
+	(void)stress_set_setting_true("nice-fairness", NULL);
+	return stress_set_setting("nice-fairness-tasks", TYPE_ID_STR, opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_nice_fairness,		stress_set_nice_fairness },
+	{ OPT_nice_fairness_slice,	stress_set_nice_fairness_slice },
+	{ OPT_nice_fairness_tasks,	stress_set_nice_fairness_tasks },
+	{ 0,				NULL }
 };
 
 #if defined(HAVE_NICE) || defined(HAVE_SETPRIORITY)
@@ -38,6 +160,436 @@ static void stress_nice_delay(void)
 		(void)shim_sched_yield();
 }
 
+#if defined(HAVE_SETPRIORITY) &&	\
+    defined(HAVE_GETPRIORITY) &&	\
+    defined(HAVE_AFFINITY) &&		\
+    defined(HAVE_CLOCK_NANOSLEEP) &&	\
+    defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC) &&		\
+    defined(CLOCK_PROCESS_CPUTIME_ID) &&	\
+    defined(TIMER_ABSTIME)
+#define HAVE_NICE_FAIRNESS
+
+/* CFS/EEVDF load weights of nice levels -20..19, kernel sched_prio_to_weight */
+static const uint32_t nice_fairness_weights[40] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	9548, 7620, 6100, 4904, 3906,
+	3121, 2501, 1991, 1586, 1277,
+	1024, 820, 655, 526, 423,
+	335, 272, 215, 172, 137,
+	110, 87, 70, 56, 45,
+	36, 29, 23, 18, 15,
+};
+
+#define NICE_FAIRNESS_IDLE_WEIGHT	(3)	/* SCHED_IDLE load weight */
+
+/* results of one task, shared with the task process */
+typedef struct {
+	uint64_t cpu_ns;		/* CPU time in the window */
+	stress_latency_t latency;	/* interactive wakeup latencies */
+	int nice;			/* nice level actually set */
+	bool policy_ok;			/* scheduling policy was set */
+	bool slice_ok;			/* EEVDF slice request was accepted */
+	bool ready;			/* task is set up */
+} stress_nice_fairness_result_t;
+
+/* state shared between the worker and its tasks */
+typedef struct {
+	bool start;			/* start measuring */
+	bool stop;			/* stop measuring */
+	stress_nice_fairness_result_t results[NICE_FAIRNESS_TASKS_MAX];
+} stress_nice_fairness_shared_t;
+
+/*
+ *  stress_nice_fairness_spin()
+ *	burn CPU until a time in ns or until told to stop
+ */
+static void stress_nice_fairness_spin(
+	stress_nice_fairness_shared_t *shared,
+	const uint64_t until)
+{
+	do {
+		int i;
+
+		for (i = 0; i < 1000; i++)
+			stress_uint64_put((uint64_t)i * (uint64_t)i);
+	} while (!__atomic_load_n(&shared->stop, __ATOMIC_ACQUIRE) &&
+		 (stress_latency_now() < until));
+}
+
+/*
+ *  stress_nice_fairness_setup()
+ *	set the policy, nice level and slice of a task
+ */
+static void stress_nice_fairness_setup(
+	const stress_nice_fairness_task_t *task,
+	stress_nice_fairness_result_t *result,
+	const int32_t cpu,
+	const uint32_t slice_us)
+{
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	result->policy_ok = true;
+#if defined(HAVE_SCHED_SETSCHEDULER)
+	{
+		struct sched_param param;
+		int policy = -1;
+
+		(void)memset(&param, 0, sizeof(param));
+#if defined(SCHED_BATCH)
+		if (task->policy == NICE_FAIRNESS_BATCH)
+			policy = SCHED_BATCH;
+#endif
+#if defined(SCHED_IDLE)
+		if (task->policy == NICE_FAIRNESS_IDLE)
+			policy = SCHED_IDLE;
+#endif
+		if ((task->policy == NICE_FAIRNESS_BATCH) ||
+		    (task->policy == NICE_FAIRNESS_IDLE))
+			result->policy_ok = (policy >= 0) &&
+				(sched_setscheduler(0, policy, &param) == 0);
+	}
+#else
+	if ((task->policy == NICE_FAIRNESS_BATCH) ||
+	    (task->policy == NICE_FAIRNESS_IDLE))
+		result->policy_ok = false;
+#endif
+	(void)setpriority(PRIO_PROCESS, 0, task->nice);
+	errno = 0;
+	result->nice = getpriority(PRIO_PROCESS, 0);
+	if (errno)
+		result->nice = 0;
+
+	/*
+	 *  EEVDF (Linux 6.12+) takes a SCHED_OTHER sched_runtime as
+	 *  the requested slice, older kernels ignore it, so read it
+	 *  back to see if it was accepted
+	 */
+	result->slice_ok = false;
+	if (slice_us && (task->policy == NICE_FAIRNESS_INTER)) {
+		struct shim_sched_attr attr;
+
+		(void)memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.sched_policy = SCHED_OTHER;
+		attr.sched_nice = result->nice;
+		attr.sched_runtime = (uint64_t)slice_us * 1000;
+		if (shim_sched_setattr(0, &attr, 0) == 0) {
+			(void)memset(&attr, 0, sizeof(attr));
+			if ((shim_sched_getattr(0, &attr, sizeof(attr), 0) == 0) &&
+			    (attr.sched_runtime == (uint64_t)slice_us * 1000))
+				result->slice_ok = true;
+		}
+	}
+}
+
+/*
+ *  stress_nice_fairness_task()
+ *	run a CPU bound or an interactive task on the shared CPU
+ *	and measure its CPU time while the worker says so
+ */
+static void NORETURN stress_nice_fairness_task(
+	stress_nice_fairness_shared_t *shared,
+	const stress_nice_fairness_task_t *task,
+	stress_nice_fairness_result_t *result,
+	const int32_t cpu,
+	const uint32_t slice_us)
+{
+	uint64_t cpu_start;
+
+	stress_parent_died_alarm();
+	stress_nice_fairness_setup(task, result, cpu, slice_us);
+	__atomic_store_n(&result->ready, true, __ATOMIC_RELEASE);
+
+	while (!__atomic_load_n(&shared->start, __ATOMIC_ACQUIRE)) {
+		if (__atomic_load_n(&shared->stop, __ATOMIC_ACQUIRE))
+			_exit(0);
+		(void)shim_usleep(1000);
+	}
+
+	cpu_start = stress_clock_id_ns(CLOCK_PROCESS_CPUTIME_ID);
+	if (task->policy == NICE_FAIRNESS_INTER) {
+		uint64_t target = stress_latency_now();
+
+		while (!__atomic_load_n(&shared->stop, __ATOMIC_ACQUIRE)) {
+			struct timespec ts;
+			uint64_t now;
+
+			target += NICE_FAIRNESS_PERIOD_NS;
+			ts.tv_sec = (time_t)(target / STRESS_NANOSECOND);
+			ts.tv_nsec = (long)(target % STRESS_NANOSECOND);
+			(void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+			now = stress_latency_now();
+			stress_latency_record(&result->latency, (now > target) ? now - target : 0);
+			/* do not try to catch up on missed periods */
+			if (now > target + NICE_FAIRNESS_PERIOD_NS)
+				target = now;
+			stress_nice_fairness_spin(shared, now + NICE_FAIRNESS_RUN_NS);
+		}
+	} else {
+		stress_nice_fairness_spin(shared, UINT64_MAX);
+	}
+	result->cpu_ns = stress_clock_id_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+	_exit(0);
+}
+
+/*
+ *  stress_nice_fairness_weight()
+ *	load weight of a task, SCHED_IDLE tasks have a tiny weight
+ */
+static double stress_nice_fairness_weight(
+	const stress_nice_fairness_task_t *task,
+	const int nice)
+{
+	if ((task->policy == NICE_FAIRNESS_IDLE) || (nice < -20) || (nice > 19))
+		return (task->policy == NICE_FAIRNESS_IDLE) ?
+			(double)NICE_FAIRNESS_IDLE_WEIGHT : 1024.0;
+	return (double)nice_fairness_weights[nice + 20];
+}
+
+/*
+ *  stress_nice_fairness_pass()
+ *	run all the tasks on one CPU for a window and add their CPU
+ *	time and wakeup latencies to the totals, returns false if
+ *	the pass could not be run
+ */
+static bool stress_nice_fairness_pass(
+	const stress_args_t *args,
+	stress_nice_fairness_shared_t *shared,
+	const stress_nice_fairness_task_t *tasks,
+	const size_t n_tasks,
+	const int32_t cpu,
+	const uint32_t slice_us,
+	stress_nice_fairness_result_t *totals,
+	double *window)
+{
+	pid_t pids[NICE_FAIRNESS_TASKS_MAX];
+	double t, deadline;
+	size_t i;
+	bool ok = true;
+
+	(void)memset(shared, 0, sizeof(*shared));
+	for (i = 0; i < n_tasks; i++) {
+		stress_latency_reset(&shared->results[i].latency);
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			ok = false;
+			break;
+		} else if (pids[i] == 0) {
+			stress_nice_fairness_task(shared, &tasks[i],
+				&shared->results[i], cpu, slice_us);
+		}
+	}
+
+	/* wait for the tasks to be set up */
+	deadline = stress_time_now() + 5.0;
+	for (i = 0; ok && (i < n_tasks); i++) {
+		while (!__atomic_load_n(&shared->results[i].ready, __ATOMIC_ACQUIRE)) {
+			if (!keep_stressing(args) || (stress_time_now() > deadline)) {
+				ok = false;
+				break;
+			}
+			(void)shim_usleep(1000);
+		}
+	}
+
+	if (ok) {
+		t = stress_time_now();
+		__atomic_store_n(&shared->start, true, __ATOMIC_RELEASE);
+		deadline = t + NICE_FAIRNESS_WINDOW;
+		while (keep_stressing(args) && (stress_time_now() < deadline))
+			(void)shim_usleep(10000);
+		t = stress_time_now() - t;
+		/* a cut short window is still measured over its length */
+		*window += t;
+	}
+	__atomic_store_n(&shared->stop, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < n_tasks; i++) {
+		int status;
+
+		if (pids[i] <= 0)
+			break;
+		if (shim_waitpid(pids[i], &status, 0) < 0) {
+			(void)kill(pids[i], SIGKILL);
+			(void)shim_waitpid(pids[i], &status, 0);
+		}
+	}
+	if (!ok)
+		return false;
+
+	for (i = 0; i < n_tasks; i++) {
+		totals[i].cpu_ns += shared->results[i].cpu_ns;
+		stress_latency_merge(&totals[i].latency, &shared->results[i].latency);
+		totals[i].nice = shared->results[i].nice;
+		totals[i].policy_ok = shared->results[i].policy_ok;
+		totals[i].slice_ok = shared->results[i].slice_ok;
+	}
+	return true;
+}
+
+/*
+ *  stress_nice_fairness_cpu()
+ *	pick the CPU shared by the tasks, instances use different
+ *	allowed CPUs where possible
+ */
+static int32_t stress_nice_fairness_cpu(const stress_args_t *args)
+{
+	cpu_set_t mask;
+	int32_t cpu, allowed, skip;
+
+	CPU_ZERO(&mask);
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0)
+		return 0;
+	allowed = (int32_t)CPU_COUNT(&mask);
+	if (allowed < 1)
+		return 0;
+	skip = (int32_t)(args->instance % (uint32_t)allowed);
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, &mask))
+			continue;
+		if (skip-- == 0)
+			return cpu;
+	}
+	return 0;
+}
+
+/*
+ *  stress_nice_fairness()
+ *	run a mix of CPU bound tasks at different nice levels and
+ *	policies and interactive tasks on one CPU and compare the
+ *	CPU share of each task with the share its weight should get
+ */
+static int stress_nice_fairness(const stress_args_t *args)
+{
+	static const char default_tasks[] = "other:0,other:5,other:10,batch:0,idle:0,inter:0";
+	static stress_nice_fairness_result_t totals[NICE_FAIRNESS_TASKS_MAX];
+	stress_nice_fairness_task_t tasks[NICE_FAIRNESS_TASKS_MAX];
+	stress_nice_fairness_shared_t *shared;
+	stress_latency_t inter;
+	const char *nice_fairness_tasks = default_tasks;
+	uint32_t nice_fairness_slice = 0;
+	double window = 0.0, weights = 0.0, bound_ns = 0.0, total_ns = 0.0;
+	double jain_sum = 0.0, jain_sq = 0.0, max_err = 0.0;
+	size_t i, n_tasks = 0, n_bound = 0;
+	const int32_t cpu = stress_nice_fairness_cpu(args);
+
+	(void)stress_get_setting("nice-fairness-tasks", &nice_fairness_tasks);
+	(void)stress_get_setting("nice-fairness-slice", &nice_fairness_slice);
+	if (stress_nice_fairness_parse(nice_fairness_tasks, tasks, &n_tasks) < 0)
+		return EXIT_FAILURE;
+
+	shared = (stress_nice_fairness_shared_t *)mmap(NULL, sizeof(*shared),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for the task results, "
+			"errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*shared), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(totals, 0, sizeof(totals));
+	for (i = 0; i < n_tasks; i++)
+		stress_latency_reset(&totals[i].latency);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		if (!stress_nice_fairness_pass(args, shared, tasks, n_tasks, cpu,
+				nice_fairness_slice, totals, &window))
+			break;
+		inc_counter(args);
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)shared, sizeof(*shared));
+
+	if (window <= 0.0) {
+		pr_inf("%s: no complete fairness windows were run\n", args->name);
+		return EXIT_SUCCESS;
+	}
+
+	/*
+	 *  The interactive tasks use what they need, the CPU bound
+	 *  tasks share the rest of the measured CPU time by weight
+	 */
+	for (i = 0; i < n_tasks; i++) {
+		total_ns += (double)totals[i].cpu_ns;
+		if (tasks[i].policy == NICE_FAIRNESS_INTER)
+			continue;
+		bound_ns += (double)totals[i].cpu_ns;
+		weights += stress_nice_fairness_weight(&tasks[i], totals[i].nice);
+		n_bound++;
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: CPU share of each task on CPU %" PRId32 " over %.1f seconds:\n",
+			args->name, cpu, window);
+		pr_inf("%s: %-6s %5s %8s %9s %9s %7s %9s %9s %9s\n", args->name,
+			"policy", "nice", "weight", "share %", "expect %", "ratio",
+			"wake p50", "wake p99", "wake max");
+	}
+	stress_latency_reset(&inter);
+	for (i = 0; i < n_tasks; i++) {
+		const stress_nice_fairness_result_t *r = &totals[i];
+		const double weight = stress_nice_fairness_weight(&tasks[i], r->nice);
+		const double share = 100.0 * (double)r->cpu_ns / (window * STRESS_NANOSECOND);
+		double expect = share, ratio = 1.0;
+		char policy[16], lat[3][16];
+
+		if ((tasks[i].policy != NICE_FAIRNESS_INTER) && (weights > 0.0)) {
+			expect = 100.0 * (bound_ns * weight / weights) / (window * STRESS_NANOSECOND);
+			ratio = (expect > 0.0) ? share / expect : 0.0;
+			jain_sum += ratio;
+			jain_sq += ratio * ratio;
+			if (fabs(ratio - 1.0) > max_err)
+				max_err = fabs(ratio - 1.0);
+		}
+		(void)snprintf(policy, sizeof(policy), "%s%s%s", nice_fairness_policies[tasks[i].policy],
+			r->policy_ok ? "" : "?", r->slice_ok ? "*" : "");
+		if (r->latency.count) {
+			stress_latency_merge(&inter, &r->latency);
+			(void)snprintf(lat[0], sizeof(lat[0]), "%.1f",
+				(double)stress_latency_percentile(&r->latency, 50.0) / 1000.0);
+			(void)snprintf(lat[1], sizeof(lat[1]), "%.1f",
+				(double)stress_latency_percentile(&r->latency, 99.0) / 1000.0);
+			(void)snprintf(lat[2], sizeof(lat[2]), "%.1f",
+				(double)r->latency.max / 1000.0);
+		} else {
+			(void)shim_strlcpy(lat[0], "-", sizeof(lat[0]));
+			(void)shim_strlcpy(lat[1], "-", sizeof(lat[1]));
+			(void)shim_strlcpy(lat[2], "-", sizeof(lat[2]));
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %-6s %5d %8.0f %9.2f %9.2f %7.3f %9s %9s %9s\n", args->name,
+				policy, r->nice, weight, share, expect, ratio,
+				lat[0], lat[1], lat[2]);
+	}
+	if (args->instance == 0) {
+		pr_inf("%s: wakeup latencies in us, ? = policy could not be set\n", args->name);
+		if (nice_fairness_slice)
+			pr_inf("%s: * = EEVDF slice of %" PRIu32 "us accepted\n",
+				args->name, nice_fairness_slice);
+		pr_inf("%s: tasks used %.2f%% of the CPU\n", args->name,
+			100.0 * total_ns / (window * STRESS_NANOSECOND));
+	}
+
+	if (n_bound && (jain_sq > 0.0))
+		stress_misc_stats_set(args->misc_stats, 0, "Jain fairness index",
+			(jain_sum * jain_sum) / ((double)n_bound * jain_sq));
+	stress_misc_stats_set(args->misc_stats, 1, "max share error %", 100.0 * max_err);
+	if (inter.count) {
+		stress_misc_stats_set(args->misc_stats, 2, "interactive p50 wake us",
+			(double)stress_latency_percentile(&inter, 50.0) / 1000.0);
+		stress_misc_stats_set(args->misc_stats, 3, "interactive p99 wake us",
+			(double)stress_latency_percentile(&inter, 99.0) / 1000.0);
+	}
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress on sched_nice()
  *	stress system by sched_nice
@@ -45,6 +597,7 @@ static void stress_nice_delay(void)
 static int stress_nice(const stress_args_t *args)
 {
 	const bool cap_sys_nice = stress_check_capability(SHIM_CAP_SYS_NICE);
+	bool nice_fairness = false;
 #if defined(HAVE_SETPRIORITY)
 	/* Make an assumption on priority range */
 	int max_prio = 20, min_prio = -20;
@@ -64,6 +617,18 @@ static int stress_nice(const stress_args_t *args)
 	}
 #endif
 #endif
+	(void)stress_get_setting("nice-fairness", &nice_fairness);
+	if (nice_fairness) {
+#if defined(HAVE_NICE_FAIRNESS)
+		return stress_nice_fairness(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --nice-fairness is not supported on this "
+				"system, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -167,6 +732,7 @@ static int stress_nice(const stress_args_t *args)
 stressor_info_t stress_nice_info = {
 	.stressor = stress_nice,
 	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 
@@ -174,6 +740,7 @@ stressor_info_t stress_nice_info = {
 stressor_info_t stress_nice_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
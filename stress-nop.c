@@ -38,25 +38,26 @@ typedef struct {
 } stress_nop_instr_t;
 
 static stress_nop_instr_t *current_instr = NULL;
+static stress_counter_batch_t nop_counter;
 
 #define OPx1(op)	op();
 #define OPx4(op)	OPx1(op) OPx1(op) OPx1(op) OPx1(op)
 #define OPx16(op)	OPx4(op) OPx4(op) OPx4(op) OPx4(op)
 #define OPx64(op)	do { OPx16(op) OPx16(op) OPx16(op) OPx16(op) } while (0)
 
-#define STRESS_NOP_SPIN_OP(name, op)		\
-static void stress_nop_spin_ ## name(		\
-	const stress_args_t *args,		\
-	const bool flag)			\
-{						\
-	do {					\
-		register int i = 1024;		\
-						\
-		while (i--)			\
-			OPx64(op); 		\
-						\
-		inc_counter(args);		\
-	} while (flag && keep_stressing(args));	\
+#define STRESS_NOP_SPIN_OP(name, op)					\
+static void stress_nop_spin_ ## name(					\
+	const stress_args_t *args,					\
+	const bool flag)						\
+{									\
+	do {								\
+		register int i = 1024;					\
+									\
+		while (i--)						\
+			OPx64(op); 					\
+									\
+		inc_counter_batch(args, &nop_counter);			\
+	} while (flag && keep_stressing_batch(args, &nop_counter));	\
 }
 
 static inline void stress_op_nop(void)
@@ -265,7 +266,7 @@ static void stress_nop_random(const stress_args_t *args, const bool flag)
 		current_instr = &nop_instr[n];
 		if (!current_instr->ignore)
 			stress_nop_callfunc(current_instr, args, false);
-	} while (keep_stressing(args));
+	} while (keep_stressing_batch(args, &nop_counter));
 }
 
 static int stress_set_nop_instr(const char *opt)
@@ -313,9 +314,11 @@ static int stress_nop(const stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 
 	do_random = (instr->func == stress_nop_random);
+	stress_counter_batch_init(&nop_counter, 8);
 
 	if (sigsetjmp(jmpbuf, 1) != 0) {
 		/* We reach here on an SIGILL trap */
+		flush_counter_batch(args, &nop_counter);
 		if (current_instr == &nop_instr[0]) {
 			/* Really should be able to do nop, skip */
 			pr_inf("%s 'nop' instruction was illegal, skipping stressor\n",
@@ -333,6 +336,7 @@ static int stress_nop(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 	current_instr = instr;
 	stress_nop_callfunc(instr, args, true);
+	flush_counter_batch(args, &nop_counter);
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	return EXIT_SUCCESS;
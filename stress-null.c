@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-syscall-stats.h"
 
 #if defined(HAVE_LINUX_FS_H)
 #include <linux/fs.h>
@@ -61,12 +62,15 @@ static int stress_null(const stress_args_t *args)
 	do {
 		ssize_t ret;
 		int flag;
+		uint64_t sc_t;
 #if defined(__linux__)
 		void *ptr;
 		const size_t page_size = args->page_size;
 #endif
 
+		sc_t = stress_syscall_stats_start();
 		ret = write(fd, buffer, sizeof(buffer));
+		stress_syscall_stats_end(STRESS_SYSCALL_WRITE, sc_t);
 		if (ret <= 0) {
 			if ((errno == EAGAIN) || (errno == EINTR))
 				continue;
@@ -140,5 +144,7 @@ stressor_info_t stress_null_info = {
 	.stressor = stress_null,
 	.class = CLASS_DEV | CLASS_MEMORY | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.thread_safe = true,
+	.harness_adjust = true,
 	.help = help
 };
@@ -24,10 +24,51 @@
 #include <linux/mempolicy.h>
 #endif
 
+#define MIN_NUMA_MIGRATE_BYTES		(64 * KB)
+#define MAX_NUMA_MIGRATE_BYTES		(4 * GB)
+#define DEFAULT_NUMA_MIGRATE_BYTES	(64 * MB)
+
+#define MAX_NUMA_MIGRATE_BATCH		(65536)
+
 static const stress_help_t help[] = {
-	{ NULL,	"numa N",	"start N workers stressing NUMA interfaces" },
-	{ NULL,	"numa-ops N",	"stop after N NUMA bogo operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"numa N",		"start N workers stressing NUMA interfaces" },
+	{ NULL,	"numa-migrate",		"benchmark page migration between all NUMA node pairs" },
+	{ NULL,	"numa-migrate-batch N",	"migrate N pages per move_pages call (default sweeps sizes)" },
+	{ NULL,	"numa-migrate-bytes N",	"size of the region to migrate (default 64MB)" },
+	{ NULL,	"numa-ops N",		"stop after N NUMA bogo operations" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_numa_migrate(const char *opt)
+{
+	return stress_set_setting_true("numa-migrate", opt);
+}
+
+static int stress_set_numa_migrate_batch(const char *opt)
+{
+	uint32_t numa_migrate_batch;
+
+	numa_migrate_batch = stress_get_uint32(opt);
+	stress_check_range("numa-migrate-batch", (uint64_t)numa_migrate_batch,
+		1, MAX_NUMA_MIGRATE_BATCH);
+	return stress_set_setting("numa-migrate-batch", TYPE_ID_UINT32, &numa_migrate_batch);
+}
+
+static int stress_set_numa_migrate_bytes(const char *opt)
+{
+	uint64_t numa_migrate_bytes;
+
+	numa_migrate_bytes = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("numa-migrate-bytes", numa_migrate_bytes,
+		MIN_NUMA_MIGRATE_BYTES, MAX_NUMA_MIGRATE_BYTES);
+	return stress_set_setting("numa-migrate-bytes", TYPE_ID_UINT64, &numa_migrate_bytes);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_numa_migrate,		stress_set_numa_migrate },
+	{ OPT_numa_migrate_batch,	stress_set_numa_migrate_batch },
+	{ OPT_numa_migrate_bytes,	stress_set_numa_migrate_bytes },
+	{ 0,				NULL }
 };
 
 #if defined(__NR_get_mempolicy) &&	\
@@ -90,11 +131,39 @@ static const stress_help_t help[] = {
 
 #define MMAP_SZ			(4 * MB)
 
+/* move_pages batch sizes in pages, 0 = all the pages in one call */
+static const size_t numa_migrate_batches[] = {
+	1, 16, 256, 4096, 0
+};
+
+#define NUMA_MIGRATE_METHODS	(SIZEOF_ARRAY(numa_migrate_batches) + 1)
+#define NUMA_MIGRATE_MIGRATE	(SIZEOF_ARRAY(numa_migrate_batches))
+
 typedef struct stress_node {
 	struct stress_node	*next;
 	unsigned long		node_id;
 } stress_node_t;
 
+/* migration totals of one method from one node to another */
+typedef struct {
+	uint64_t pages;		/* pages migrated */
+	double duration;	/* time spent migrating */
+} stress_numa_migrate_stats_t;
+
+/* migration benchmark state */
+typedef struct {
+	uint8_t *buf;			/* region to migrate */
+	size_t num_pages;		/* pages in the region */
+	void **pages;			/* page addresses */
+	int *dest_nodes;		/* destination node per page */
+	int *status;			/* move_pages status per page */
+	unsigned long *node_ids;	/* memory node ids */
+	size_t num_nodes;		/* number of memory nodes */
+	unsigned long max_nodes;	/* maximum node id + 1 */
+	size_t batch;			/* --numa-migrate-batch, 0 = sweep */
+	stress_numa_migrate_stats_t *stats; /* [from][to][method] */
+} stress_numa_migrate_t;
+
 /*
  *  stress_numa_free_nodes()
  *	free circular list of node info
@@ -205,6 +274,324 @@ static long stress_numa_get_mem_nodes(
 	return n;
 }
 
+/*
+ *  stress_numa_migrate_stats()
+ *	stats of a method migrating from node index from to node index to
+ */
+static inline stress_numa_migrate_stats_t *stress_numa_migrate_stats(
+	const stress_numa_migrate_t *nm,
+	const size_t from,
+	const size_t to,
+	const size_t method)
+{
+	return &nm->stats[((from * nm->num_nodes) + to) * NUMA_MIGRATE_METHODS + method];
+}
+
+/*
+ *  stress_numa_migrate_batch_size()
+ *	move_pages batch size of a method, 0 if the method
+ *	is not to be used
+ */
+static size_t stress_numa_migrate_batch_size(
+	const stress_numa_migrate_t *nm,
+	const size_t method)
+{
+	size_t batch;
+
+	if (method == NUMA_MIGRATE_MIGRATE)
+		return 0;
+	if (nm->batch)
+		return (method == 0) ? STRESS_MINIMUM(nm->batch, nm->num_pages) : 0;
+
+	batch = numa_migrate_batches[method];
+	if (batch == 0)
+		return nm->num_pages;
+	/* skip batches that are the whole region, the last batch covers this */
+	return (batch < nm->num_pages) ? batch : 0;
+}
+
+/*
+ *  stress_numa_migrate_count()
+ *	count the pages of the region that are on a node
+ */
+static uint64_t stress_numa_migrate_count(
+	const stress_args_t *args,
+	stress_numa_migrate_t *nm,
+	const unsigned long node)
+{
+	uint64_t count = 0;
+	size_t i;
+
+	(void)memset(nm->status, 0, nm->num_pages * sizeof(*nm->status));
+	if (shim_move_pages(args->pid, nm->num_pages, nm->pages,
+			    NULL, nm->status, 0) < 0)
+		return 0;
+	for (i = 0; i < nm->num_pages; i++) {
+		if (nm->status[i] == (int)node)
+			count++;
+	}
+	return count;
+}
+
+/*
+ *  stress_numa_migrate_move()
+ *	move the region to a node in batches of pages,
+ *	returns the number of pages that ended up on the node
+ */
+static uint64_t stress_numa_migrate_move(
+	const stress_args_t *args,
+	stress_numa_migrate_t *nm,
+	const unsigned long node,
+	const size_t batch)
+{
+	uint64_t count = 0;
+	size_t i, j;
+
+	for (i = 0; i < nm->num_pages; i++)
+		nm->dest_nodes[i] = (int)node;
+	(void)memset(nm->status, 0, nm->num_pages * sizeof(*nm->status));
+
+	for (i = 0; i < nm->num_pages; i += batch) {
+		const size_t n = STRESS_MINIMUM(batch, nm->num_pages - i);
+
+		if (shim_move_pages(args->pid, n, nm->pages + i,
+				    nm->dest_nodes + i, nm->status + i,
+				    MPOL_MF_MOVE) < 0)
+			continue;
+		for (j = i; j < i + n; j++) {
+			if (nm->status[j] == (int)node)
+				count++;
+		}
+	}
+	return count;
+}
+
+/*
+ *  stress_numa_migrate_pair()
+ *	time the migration of the region from one node to
+ *	another with each of the methods
+ */
+static void stress_numa_migrate_pair(
+	const stress_args_t *args,
+	stress_numa_migrate_t *nm,
+	const size_t from,
+	const size_t to)
+{
+	const unsigned long lbits = NUMA_LONG_BITS;
+	const unsigned long from_node = nm->node_ids[from];
+	const unsigned long to_node = nm->node_ids[to];
+	size_t method;
+
+	for (method = 0; method < NUMA_MIGRATE_METHODS; method++) {
+		stress_numa_migrate_stats_t *st = stress_numa_migrate_stats(nm, from, to, method);
+		const size_t batch = stress_numa_migrate_batch_size(nm, method);
+		uint64_t pages;
+		double t;
+
+		if ((method != NUMA_MIGRATE_MIGRATE) && (batch == 0))
+			continue;
+		if (!keep_stressing(args))
+			break;
+
+		/* place region on the source node, untimed */
+		(void)stress_numa_migrate_move(args, nm, from_node, nm->num_pages);
+
+		if (method == NUMA_MIGRATE_MIGRATE) {
+			unsigned long old_node_mask[lbits], node_mask[lbits];
+
+			(void)memset(old_node_mask, 0, sizeof(old_node_mask));
+			(void)memset(node_mask, 0, sizeof(node_mask));
+			STRESS_SETBIT(old_node_mask, from_node);
+			STRESS_SETBIT(node_mask, to_node);
+
+			t = stress_time_now();
+			if (shim_migrate_pages(args->pid, nm->max_nodes,
+					       old_node_mask, node_mask) < 0)
+				continue;
+			t = stress_time_now() - t;
+			pages = stress_numa_migrate_count(args, nm, to_node);
+		} else {
+			t = stress_time_now();
+			pages = stress_numa_migrate_move(args, nm, to_node, batch);
+			t = stress_time_now() - t;
+		}
+		st->pages += pages;
+		st->duration += t;
+	}
+}
+
+/*
+ *  stress_numa_migrate_report()
+ *	report migration rates per direction and the average
+ *	rates of each method
+ */
+static void stress_numa_migrate_report(
+	const stress_args_t *args,
+	const stress_numa_migrate_t *nm)
+{
+	const double page_size = (double)args->page_size;
+	size_t from, to, method, idx = 0;
+
+	if (args->instance == 0) {
+		pr_inf("%s: %5s %5s %-13s %7s %12s %10s\n", args->name,
+			"from", "to", "method", "batch", "pages/s", "GB/s");
+	}
+
+	for (method = 0; method < NUMA_MIGRATE_METHODS; method++) {
+		const size_t batch = stress_numa_migrate_batch_size(nm, method);
+		const char *name = (method == NUMA_MIGRATE_MIGRATE) ?
+			"migrate_pages" : "move_pages";
+		char batch_str[24], desc[64];
+		double rate_total = 0.0;
+		size_t n = 0;
+
+		if ((method != NUMA_MIGRATE_MIGRATE) && (batch == 0))
+			continue;
+		if (method == NUMA_MIGRATE_MIGRATE)
+			(void)shim_strlcpy(batch_str, "-", sizeof(batch_str));
+		else if (batch == nm->num_pages)
+			(void)shim_strlcpy(batch_str, "all", sizeof(batch_str));
+		else
+			(void)snprintf(batch_str, sizeof(batch_str), "%zu", batch);
+
+		for (from = 0; from < nm->num_nodes; from++) {
+			for (to = 0; to < nm->num_nodes; to++) {
+				const stress_numa_migrate_stats_t *st =
+					stress_numa_migrate_stats(nm, from, to, method);
+				double rate;
+
+				if ((from == to) || (st->duration <= 0.0))
+					continue;
+				rate = (double)st->pages / st->duration;
+				rate_total += rate;
+				n++;
+
+				if (args->instance != 0)
+					continue;
+				pr_inf("%s: %5lu %5lu %-13s %7s %12.0f %10.3f\n",
+					args->name, nm->node_ids[from], nm->node_ids[to],
+					name, batch_str, rate,
+					rate * page_size / (double)GB);
+			}
+		}
+		if (n == 0)
+			continue;
+		if (method == NUMA_MIGRATE_MIGRATE)
+			(void)snprintf(desc, sizeof(desc), "%s GB per sec", name);
+		else
+			(void)snprintf(desc, sizeof(desc), "%s GB per sec batch %s", name, batch_str);
+		stress_misc_stats_set(args->misc_stats, idx++, desc,
+			(rate_total / (double)n) * page_size / (double)GB);
+	}
+}
+
+/*
+ *  stress_numa_migrate()
+ *	benchmark move_pages and migrate_pages page migration
+ *	throughput between every pair of memory nodes
+ */
+static int stress_numa_migrate(
+	const stress_args_t *args,
+	const stress_node_t *nodes,
+	const long numa_nodes,
+	const unsigned long max_nodes)
+{
+	stress_numa_migrate_t nm;
+	const stress_node_t *n = nodes;
+	uint64_t numa_migrate_bytes = DEFAULT_NUMA_MIGRATE_BYTES;
+	uint32_t numa_migrate_batch = 0;
+	size_t i, buf_sz, stats_sz;
+	int rc = EXIT_NO_RESOURCE;
+
+	if (numa_nodes < 2) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: migration benchmark needs at least 2 "
+				"NUMA memory nodes, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)stress_get_setting("numa-migrate-bytes", &numa_migrate_bytes);
+	(void)stress_get_setting("numa-migrate-batch", &numa_migrate_batch);
+
+	(void)memset(&nm, 0, sizeof(nm));
+	buf_sz = (size_t)numa_migrate_bytes & ~(args->page_size - 1);
+	nm.num_pages = buf_sz / args->page_size;
+	nm.num_nodes = (size_t)numa_nodes;
+	nm.max_nodes = max_nodes;
+	nm.batch = (size_t)numa_migrate_batch;
+
+	nm.buf = mmap(NULL, buf_sz, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (nm.buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte migration region, "
+			"skipping stressor, errno=%d (%s)\n",
+			args->name, buf_sz, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stats_sz = nm.num_nodes * nm.num_nodes * NUMA_MIGRATE_METHODS;
+	nm.pages = calloc(nm.num_pages, sizeof(*nm.pages));
+	nm.dest_nodes = calloc(nm.num_pages, sizeof(*nm.dest_nodes));
+	nm.status = calloc(nm.num_pages, sizeof(*nm.status));
+	nm.node_ids = calloc(nm.num_nodes, sizeof(*nm.node_ids));
+	nm.stats = calloc(stats_sz, sizeof(*nm.stats));
+	if (!nm.pages || !nm.dest_nodes || !nm.status || !nm.node_ids || !nm.stats) {
+		pr_inf_skip("%s: cannot allocate migration page arrays, "
+			"skipping stressor\n", args->name);
+		goto tidy;
+	}
+
+	for (i = 0; i < nm.num_nodes; i++, n = n->next)
+		nm.node_ids[i] = n->node_id;
+	for (i = 0; i < nm.num_pages; i++)
+		nm.pages[i] = nm.buf + (i * args->page_size);
+	(void)memset(nm.buf, 0xaa, buf_sz);
+
+	if (args->instance == 0)
+		pr_inf("%s: migrating %zuK between %zu nodes\n",
+			args->name, buf_sz / 1024, nm.num_nodes);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	rc = EXIT_SUCCESS;
+	do {
+		size_t from, to;
+
+		for (from = 0; from < nm.num_nodes; from++) {
+			for (to = 0; to < nm.num_nodes; to++) {
+				if (from == to)
+					continue;
+				stress_numa_migrate_pair(args, &nm, from, to);
+			}
+		}
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	/* verify that the region survived all the migrations */
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		for (i = 0; i < buf_sz; i++) {
+			if (nm.buf[i] != 0xaa) {
+				pr_fail("%s: migrated data at offset %zu is "
+					"0x%2.2x, expected 0xaa\n",
+					args->name, i, nm.buf[i]);
+				rc = EXIT_FAILURE;
+				break;
+			}
+		}
+	}
+	stress_numa_migrate_report(args, &nm);
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	free(nm.stats);
+	free(nm.node_ids);
+	free(nm.status);
+	free(nm.dest_nodes);
+	free(nm.pages);
+	(void)munmap((void *)nm.buf, buf_sz);
+
+	return rc;
+}
+
 /*
  *  stress_numa()
  *	stress the Linux NUMA interfaces
@@ -220,6 +607,7 @@ static int stress_numa(const stress_args_t *args)
 	stress_node_t *n;
 	int rc = EXIT_FAILURE;
 	const bool cap_sys_nice = stress_check_capability(SHIM_CAP_SYS_NICE);
+	bool numa_migrate = false;
 
 	numa_nodes = stress_numa_get_mem_nodes(&n, &max_nodes);
 	if (numa_nodes < 1) {
@@ -233,6 +621,12 @@ static int stress_numa(const stress_args_t *args)
 			args->name, numa_nodes, max_nodes);
 	}
 
+	(void)stress_get_setting("numa-migrate", &numa_migrate);
+	if (numa_migrate) {
+		rc = stress_numa_migrate(args, n, numa_nodes, max_nodes);
+		goto numa_free;
+	}
+
 	/*
 	 *  We need a buffer to migrate around NUMA nodes
 	 */
@@ -582,6 +976,7 @@ numa_free:
 stressor_info_t stress_numa_info = {
 	.stressor = stress_numa,
 	.class = CLASS_CPU | CLASS_MEMORY | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -589,6 +984,7 @@ stressor_info_t stress_numa_info = {
 stressor_info_t stress_numa_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_CPU | CLASS_MEMORY | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
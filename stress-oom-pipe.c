@@ -93,7 +93,7 @@ static int stress_oom_pipe_child(const stress_args_t *args, void *ctxt)
 	uint32_t *rd_buffer = context->rd_buffer;
 	uint32_t *wr_buffer = context->wr_buffer;
 
-	stress_uint8rnd4((uint8_t *)wr_buffer, page_size);
+	stress_mwc_fill(wr_buffer, page_size);
 
 	/* Explicitly drop capabilities, makes it more OOM-able */
 	VOID_RET(int, stress_drop_capabilities(args->name));
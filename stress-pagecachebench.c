@@ -0,0 +1,642 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-put.h"
+
+#if defined(HAVE_SYS_MOUNT_H)
+#include <sys/mount.h>
+#endif
+
+#define MIN_PAGECACHEBENCH_BYTES	(16 * MB)
+#define MAX_PAGECACHEBENCH_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_PAGECACHEBENCH_BYTES	(64 * MB)
+
+#define MIN_PAGECACHEBENCH_THREADS	(1)
+#define MAX_PAGECACHEBENCH_THREADS	(1024)
+#define DEFAULT_PAGECACHEBENCH_THREADS	(16)
+
+#define PAGECACHEBENCH_IO_SIZE		(64 * KB)	/* bytes per I/O or mapping */
+#define PAGECACHEBENCH_PHASE		(0.1)		/* seconds per step */
+
+static const stress_help_t help[] = {
+	{ NULL,	"pagecachebench N",		"start N workers measuring page cache scalability" },
+	{ NULL,	"pagecachebench-bytes N",	"size of the shared file and of all private files, default 64M" },
+	{ NULL,	"pagecachebench-method M",	"one of all, pread, pwrite or mmap" },
+	{ NULL,	"pagecachebench-ops N",		"stop after N 64K page cache accesses" },
+	{ NULL,	"pagecachebench-threads N",	"sweep 1, 2, 4 .. N threads, default is online CPUs up to 16" },
+	{ NULL,	NULL,				NULL }
+};
+
+#define PAGECACHEBENCH_PREAD	(1)	/* pread(2) 64K */
+#define PAGECACHEBENCH_PWRITE	(2)	/* pwrite(2) 64K */
+#define PAGECACHEBENCH_MMAP	(3)	/* mmap 64K, read it, munmap */
+
+static const char * const pagecachebench_methods[] = {
+	"all",
+	"pread",
+	"pwrite",
+	"mmap",
+};
+
+#define PAGECACHEBENCH_METHODS	(SIZEOF_ARRAY(pagecachebench_methods))
+
+static int stress_set_pagecachebench_bytes(const char *opt)
+{
+	size_t pagecachebench_bytes;
+
+	pagecachebench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("pagecachebench-bytes", pagecachebench_bytes,
+		MIN_PAGECACHEBENCH_BYTES, MAX_PAGECACHEBENCH_BYTES);
+	return stress_set_setting("pagecachebench-bytes", TYPE_ID_SIZE_T, &pagecachebench_bytes);
+}
+
+static int stress_set_pagecachebench_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < PAGECACHEBENCH_METHODS; i++) {
+		if (!strcmp(opt, pagecachebench_methods[i]))
+			return stress_set_setting("pagecachebench-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "pagecachebench-method must be one of:");
+	for (i = 0; i < PAGECACHEBENCH_METHODS; i++)
+		(void)fprintf(stderr, " %s", pagecachebench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_pagecachebench_threads(const char *opt)
+{
+	uint32_t pagecachebench_threads;
+
+	pagecachebench_threads = stress_get_uint32(opt);
+	stress_check_range("pagecachebench-threads", (uint64_t)pagecachebench_threads,
+		MIN_PAGECACHEBENCH_THREADS, MAX_PAGECACHEBENCH_THREADS);
+	return stress_set_setting("pagecachebench-threads", TYPE_ID_UINT32, &pagecachebench_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_pagecachebench_bytes,	stress_set_pagecachebench_bytes },
+	{ OPT_pagecachebench_method,	stress_set_pagecachebench_method },
+	{ OPT_pagecachebench_threads,	stress_set_pagecachebench_threads },
+	{ 0,				NULL }
+};
+
+#if defined(__linux__) &&	\
+    defined(HAVE_LIB_PTHREAD)
+
+#define PAGECACHEBENCH_STEPS	(11)	/* 1, 2, 4 .. N threads */
+
+#define PAGECACHEBENCH_TEMP	(0)	/* --temp-path, usually a disk file system */
+#define PAGECACHEBENCH_TMPFS	(1)	/* /dev/shm */
+#define PAGECACHEBENCH_RAMFS	(2)	/* ramfs mounted in a private mount namespace */
+
+static const char * const pagecachebench_fs[] = {
+	"temp",
+	"tmpfs",
+	"ramfs",
+};
+
+#define PAGECACHEBENCH_FS	(SIZEOF_ARRAY(pagecachebench_fs))
+
+static const char * const pagecachebench_files[] = {
+	"shared",
+	"private",
+};
+
+#define PAGECACHEBENCH_FILES	(SIZEOF_ARRAY(pagecachebench_files))
+
+struct stress_pagecachebench;
+
+/* a thread accessing the shared file or its own private file */
+typedef struct {
+	struct stress_pagecachebench *pcb;	/* shared state */
+	pthread_t pthread;
+	int	ret;			/* pthread_create return */
+	int	fd;			/* file to access */
+	off_t	size;			/* file size */
+	uint32_t seed;			/* offset generator state */
+	uint64_t bytes;			/* bytes accessed */
+	uint8_t	*buf;			/* I/O buffer */
+	bool	failed;			/* an access failed */
+} ALIGN64 stress_pagecachebench_thread_t;
+
+typedef struct stress_pagecachebench {
+	size_t	method;			/* PAGECACHEBENCH_PREAD .. PAGECACHEBENCH_MMAP */
+	volatile bool start;		/* threads may start */
+	volatile bool stop;		/* threads should stop */
+} stress_pagecachebench_t;
+
+/* the files of one file system */
+typedef struct {
+	char	path[PATH_MAX];		/* directory holding the files */
+	int	shared_fd;		/* the shared hot file */
+	int	*private_fds;		/* one file per thread */
+	off_t	shared_size;
+	off_t	private_size;
+	bool	mounted;		/* path is a ramfs mount */
+	bool	ok;			/* files created */
+} stress_pagecachebench_fs_t;
+
+/*
+ *  stress_pagecachebench_offset()
+ *	random 64K aligned offset in the file, a per thread xorshift
+ *	generator as the mwc state is not thread safe
+ */
+static inline off_t stress_pagecachebench_offset(stress_pagecachebench_thread_t *t)
+{
+	uint32_t x = t->seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	t->seed = x;
+
+	return (off_t)(x % (uint32_t)(t->size / PAGECACHEBENCH_IO_SIZE)) * PAGECACHEBENCH_IO_SIZE;
+}
+
+/*
+ *  stress_pagecachebench_thread()
+ *	access random 64K chunks of the file until told to stop
+ */
+static void *stress_pagecachebench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_pagecachebench_thread_t *t = (stress_pagecachebench_thread_t *)arg;
+	const stress_pagecachebench_t *pcb = t->pcb;
+
+	while (!pcb->start)
+		(void)shim_sched_yield();
+
+	while (!pcb->stop) {
+		const off_t offset = stress_pagecachebench_offset(t);
+
+		switch (pcb->method) {
+		case PAGECACHEBENCH_PREAD:
+			if (pread(t->fd, t->buf, PAGECACHEBENCH_IO_SIZE, offset) != PAGECACHEBENCH_IO_SIZE)
+				t->failed = true;
+			break;
+		case PAGECACHEBENCH_PWRITE:
+			if (pwrite(t->fd, t->buf, PAGECACHEBENCH_IO_SIZE, offset) != PAGECACHEBENCH_IO_SIZE)
+				t->failed = true;
+			break;
+		case PAGECACHEBENCH_MMAP:
+			{
+				const uint64_t *ptr;
+				uint64_t sum = 0;
+				size_t i;
+
+				ptr = (const uint64_t *)mmap(NULL, PAGECACHEBENCH_IO_SIZE,
+					PROT_READ, MAP_SHARED, t->fd, offset);
+				if (ptr == MAP_FAILED) {
+					t->failed = true;
+					break;
+				}
+				/* one read per cache line */
+				for (i = 0; i < PAGECACHEBENCH_IO_SIZE / sizeof(*ptr); i += 8)
+					sum += ptr[i];
+				stress_uint64_put(sum);
+				(void)munmap((void *)ptr, PAGECACHEBENCH_IO_SIZE);
+			}
+			break;
+		default:
+			t->failed = true;
+			break;
+		}
+		if (t->failed)
+			break;
+		t->bytes += PAGECACHEBENCH_IO_SIZE;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_pagecachebench_file()
+ *	create a file of size bytes and read it back so it is hot
+ *	in the page cache, returns the fd or -1 on failure
+ */
+static int stress_pagecachebench_file(
+	const char *path,
+	const char *name,
+	const off_t size,
+	uint8_t *buf)
+{
+	char filename[PATH_MAX + 64];
+	off_t offset;
+	int fd;
+
+	(void)snprintf(filename, sizeof(filename), "%s/%s", path, name);
+	fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return -1;
+	(void)shim_unlink(filename);
+
+	for (offset = 0; offset < size; offset += PAGECACHEBENCH_IO_SIZE) {
+		if (pwrite(fd, buf, PAGECACHEBENCH_IO_SIZE, offset) != PAGECACHEBENCH_IO_SIZE) {
+			(void)close(fd);
+			return -1;
+		}
+	}
+	for (offset = 0; offset < size; offset += PAGECACHEBENCH_IO_SIZE)
+		VOID_RET(ssize_t, pread(fd, buf, PAGECACHEBENCH_IO_SIZE, offset));
+
+	return fd;
+}
+
+/*
+ *  stress_pagecachebench_ramfs()
+ *	mount a ramfs on path in a private mount namespace so that
+ *	the mount is not seen outside of this process
+ */
+static bool stress_pagecachebench_ramfs(const char *path)
+{
+#if defined(HAVE_SYS_MOUNT_H) &&	\
+    defined(HAVE_UNSHARE) &&		\
+    defined(CLONE_NEWNS) &&		\
+    defined(MS_REC) &&			\
+    defined(MS_PRIVATE)
+	if (mkdir(path, S_IRWXU) < 0)
+		return false;
+	if ((shim_unshare(CLONE_NEWNS) < 0) ||
+	    (mount("none", "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0) ||
+	    (mount("none", path, "ramfs", 0, NULL) < 0)) {
+		(void)rmdir(path);
+		return false;
+	}
+	return true;
+#else
+	(void)path;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_pagecachebench_fs_open()
+ *	create the shared file and the private files on a file system
+ */
+static void stress_pagecachebench_fs_open(
+	const stress_args_t *args,
+	const size_t fs,
+	stress_pagecachebench_fs_t *pfs,
+	const size_t bytes,
+	const uint32_t n_threads,
+	uint8_t *buf)
+{
+	uint32_t i;
+
+	pfs->shared_fd = -1;
+	pfs->mounted = false;
+	pfs->ok = false;
+	pfs->private_fds = (int *)calloc(n_threads, sizeof(*pfs->private_fds));
+	if (!pfs->private_fds)
+		return;
+	for (i = 0; i < n_threads; i++)
+		pfs->private_fds[i] = -1;
+
+	switch (fs) {
+	case PAGECACHEBENCH_TEMP:
+		(void)stress_temp_dir_args(args, pfs->path, sizeof(pfs->path));
+		break;
+	case PAGECACHEBENCH_TMPFS:
+		(void)snprintf(pfs->path, sizeof(pfs->path), "/dev/shm/stress-ng-pagecachebench-%"
+			PRIdMAX "-%" PRIu32, (intmax_t)args->pid, args->instance);
+		if (mkdir(pfs->path, S_IRWXU) < 0)
+			return;
+		break;
+	case PAGECACHEBENCH_RAMFS:
+		{
+			char temp[PATH_MAX - 8];
+
+			(void)stress_temp_dir_args(args, temp, sizeof(temp));
+			(void)snprintf(pfs->path, sizeof(pfs->path), "%s/ramfs", temp);
+			pfs->mounted = stress_pagecachebench_ramfs(pfs->path);
+			if (!pfs->mounted)
+				return;
+		}
+		break;
+	default:
+		return;
+	}
+
+	pfs->shared_size = (off_t)bytes;
+	pfs->private_size = (off_t)((bytes / n_threads) & ~(PAGECACHEBENCH_IO_SIZE - 1));
+	if (pfs->private_size < (off_t)PAGECACHEBENCH_IO_SIZE)
+		pfs->private_size = PAGECACHEBENCH_IO_SIZE;
+
+	pfs->shared_fd = stress_pagecachebench_file(pfs->path, "shared",
+		pfs->shared_size, buf);
+	if (pfs->shared_fd < 0)
+		return;
+	for (i = 0; i < n_threads; i++) {
+		char name[32];
+
+		(void)snprintf(name, sizeof(name), "private-%" PRIu32, i);
+		pfs->private_fds[i] = stress_pagecachebench_file(pfs->path, name,
+			pfs->private_size, buf);
+		if (pfs->private_fds[i] < 0)
+			return;
+	}
+	pfs->ok = true;
+}
+
+/*
+ *  stress_pagecachebench_fs_close()
+ *	close the files and remove the tmpfs directory or ramfs mount
+ */
+static void stress_pagecachebench_fs_close(
+	const size_t fs,
+	stress_pagecachebench_fs_t *pfs,
+	const uint32_t n_threads)
+{
+	uint32_t i;
+
+	if (pfs->shared_fd >= 0)
+		(void)close(pfs->shared_fd);
+	if (pfs->private_fds) {
+		for (i = 0; i < n_threads; i++) {
+			if (pfs->private_fds[i] >= 0)
+				(void)close(pfs->private_fds[i]);
+		}
+		free(pfs->private_fds);
+	}
+#if defined(HAVE_SYS_MOUNT_H)
+	if (pfs->mounted)
+		(void)umount(pfs->path);
+#endif
+	if ((fs == PAGECACHEBENCH_TMPFS) || pfs->mounted)
+		(void)rmdir(pfs->path);
+}
+
+/*
+ *  stress_pagecachebench_step()
+ *	run n_threads threads for a short phase, returns GB/sec or
+ *	a negative value if an access failed
+ */
+static double stress_pagecachebench_step(
+	const stress_args_t *args,
+	stress_pagecachebench_t *pcb,
+	stress_pagecachebench_thread_t *threads,
+	const stress_pagecachebench_fs_t *pfs,
+	const bool shared,
+	const uint32_t n_threads)
+{
+	uint32_t i, started = 0;
+	uint64_t bytes = 0;
+	double t1, t2;
+	bool failed = false;
+
+	pcb->start = false;
+	pcb->stop = false;
+	for (i = 0; i < n_threads; i++) {
+		stress_pagecachebench_thread_t *t = &threads[i];
+
+		t->pcb = pcb;
+		t->fd = shared ? pfs->shared_fd : pfs->private_fds[i];
+		t->size = shared ? pfs->shared_size : pfs->private_size;
+		t->seed = stress_mwc32() | 1;
+		t->bytes = 0;
+		t->failed = false;
+		t->ret = pthread_create(&t->pthread, NULL, stress_pagecachebench_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+	if (started < n_threads) {
+		pcb->start = true;
+		pcb->stop = true;
+		for (i = 0; i < started; i++)
+			(void)pthread_join(threads[i].pthread, NULL);
+		return 0.0;
+	}
+
+	t1 = stress_time_now();
+	pcb->start = true;
+	(void)shim_nanosleep_uint64((uint64_t)(PAGECACHEBENCH_PHASE * STRESS_NANOSECOND));
+	pcb->stop = true;
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		bytes += threads[i].bytes;
+		failed |= threads[i].failed;
+	}
+	t2 = stress_time_now();
+	add_counter(args, bytes / PAGECACHEBENCH_IO_SIZE);
+
+	if (failed)
+		return -1.0;
+	return (t2 > t1) ? (double)bytes / ((t2 - t1) * (double)GB) : 0.0;
+}
+
+/*
+ *  stress_pagecachebench()
+ *	measure how pread, pwrite and mmap access to page cache hot
+ *	files scale with threads, for one shared file and for a file
+ *	per thread, on the temp path file system, tmpfs and ramfs
+ */
+static int stress_pagecachebench(const stress_args_t *args)
+{
+	static double rates[PAGECACHEBENCH_FS][PAGECACHEBENCH_METHODS][PAGECACHEBENCH_FILES][PAGECACHEBENCH_STEPS];
+	static stress_pagecachebench_fs_t fss[PAGECACHEBENCH_FS];
+	static uint32_t passes[PAGECACHEBENCH_FS][PAGECACHEBENCH_METHODS][PAGECACHEBENCH_FILES][PAGECACHEBENCH_STEPS];
+	stress_pagecachebench_t pcb;
+	stress_pagecachebench_thread_t *threads;
+	size_t pagecachebench_bytes = DEFAULT_PAGECACHEBENCH_BYTES;
+	size_t pagecachebench_method = 0, fs, m, f, idx = 0;
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t pagecachebench_threads, steps[PAGECACHEBENCH_STEPS], n_steps = 0, s, i;
+	uint8_t *buf;
+	int rc = EXIT_SUCCESS, ret;
+
+	pagecachebench_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+	if (pagecachebench_threads > DEFAULT_PAGECACHEBENCH_THREADS)
+		pagecachebench_threads = DEFAULT_PAGECACHEBENCH_THREADS;
+
+	(void)stress_get_setting("pagecachebench-method", &pagecachebench_method);
+	if (!stress_get_setting("pagecachebench-bytes", &pagecachebench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			pagecachebench_bytes = 1 * GB;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			pagecachebench_bytes = MIN_PAGECACHEBENCH_BYTES;
+	}
+	if (!stress_get_setting("pagecachebench-threads", &pagecachebench_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			pagecachebench_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			pagecachebench_threads = MIN_PAGECACHEBENCH_THREADS;
+	}
+	pagecachebench_bytes /= args->num_instances;
+	if (pagecachebench_bytes < MIN_PAGECACHEBENCH_BYTES)
+		pagecachebench_bytes = MIN_PAGECACHEBENCH_BYTES;
+	pagecachebench_bytes &= ~(size_t)(PAGECACHEBENCH_IO_SIZE - 1);
+
+	for (s = 1; (s < pagecachebench_threads) && (n_steps < PAGECACHEBENCH_STEPS - 1); s <<= 1)
+		steps[n_steps++] = s;
+	steps[n_steps++] = pagecachebench_threads;
+
+	threads = (stress_pagecachebench_thread_t *)calloc(pagecachebench_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " thread contexts, skipping stressor\n",
+			args->name, pagecachebench_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = (uint8_t *)mmap(NULL, (size_t)(pagecachebench_threads + 1) * PAGECACHEBENCH_IO_SIZE,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate I/O buffers, skipping stressor\n", args->name);
+		free(threads);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_mwc_fill(buf, PAGECACHEBENCH_IO_SIZE);
+	for (i = 0; i < pagecachebench_threads; i++) {
+		threads[i].buf = buf + ((size_t)(i + 1) * PAGECACHEBENCH_IO_SIZE);
+		(void)memcpy((void *)threads[i].buf, (void *)buf, PAGECACHEBENCH_IO_SIZE);
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		(void)munmap((void *)buf, (size_t)(pagecachebench_threads + 1) * PAGECACHEBENCH_IO_SIZE);
+		free(threads);
+		return stress_exit_status(-ret);
+	}
+
+	for (fs = 0; fs < PAGECACHEBENCH_FS; fs++) {
+		stress_pagecachebench_fs_open(args, fs, &fss[fs], pagecachebench_bytes,
+			pagecachebench_threads, buf);
+		if (!fss[fs].ok && (args->instance == 0))
+			pr_inf("%s: %s skipped, cannot create files%s\n", args->name,
+				pagecachebench_fs[fs],
+				(fs == PAGECACHEBENCH_RAMFS) ? " or mount ramfs" : "");
+	}
+	if (args->instance == 0)
+		pr_inf("%s: temp path %s%s\n", args->name, fss[PAGECACHEBENCH_TEMP].path,
+			stress_fs_type(fss[PAGECACHEBENCH_TEMP].path));
+
+	(void)memset(rates, 0, sizeof(rates));
+	(void)memset(passes, 0, sizeof(passes));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (fs = 0; (fs < PAGECACHEBENCH_FS) && keep_stressing(args); fs++) {
+			if (!fss[fs].ok)
+				continue;
+			for (m = 1; (m < PAGECACHEBENCH_METHODS) && keep_stressing(args); m++) {
+				if (pagecachebench_method && (pagecachebench_method != m))
+					continue;
+				pcb.method = m;
+				for (f = 0; (f < PAGECACHEBENCH_FILES) && keep_stressing(args); f++) {
+					for (s = 0; (s < n_steps) && keep_stressing(args); s++) {
+						const double rate = stress_pagecachebench_step(args,
+							&pcb, threads, &fss[fs], f == 0, steps[s]);
+
+						if (rate < 0.0) {
+							pr_fail("%s: %s %s on %s failed, errno=%d (%s)\n",
+								args->name, pagecachebench_methods[m],
+								pagecachebench_files[f],
+								pagecachebench_fs[fs], errno, strerror(errno));
+							rc = EXIT_FAILURE;
+							goto report;
+						}
+						rates[fs][m][f][s] += rate;
+						passes[fs][m][f][s]++;
+					}
+				}
+			}
+		}
+	} while (keep_stressing(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		char line[256];
+		size_t len;
+
+		len = (size_t)snprintf(line, sizeof(line), "%-20s", "GB/sec, threads:");
+		for (s = 0; s < n_steps; s++)
+			len += (size_t)snprintf(line + len, sizeof(line) - len, " %7" PRIu32, steps[s]);
+		(void)snprintf(line + len, sizeof(line) - len, " %8s", "scaling");
+		pr_inf("%s: %s\n", args->name, line);
+	}
+	for (fs = 0; fs < PAGECACHEBENCH_FS; fs++) {
+		for (m = 1; m < PAGECACHEBENCH_METHODS; m++) {
+			for (f = 0; f < PAGECACHEBENCH_FILES; f++) {
+				double rate[PAGECACHEBENCH_STEPS], scaling = 0.0;
+				char line[256];
+				size_t len;
+
+				/* only report sweeps that got to the last step */
+				if (!passes[fs][m][f][0] || !passes[fs][m][f][n_steps - 1])
+					continue;
+				for (s = 0; s < n_steps; s++)
+					rate[s] = passes[fs][m][f][s] ?
+						rates[fs][m][f][s] / (double)passes[fs][m][f][s] : 0.0;
+				/* N thread throughput as a percentage of N times 1 thread */
+				if (rate[0] > 0.0)
+					scaling = 100.0 * rate[n_steps - 1] /
+						(rate[0] * (double)steps[n_steps - 1]);
+
+				if (args->instance == 0) {
+					char label[32];
+
+					(void)snprintf(label, sizeof(label), "%s %s %s",
+						pagecachebench_fs[fs], pagecachebench_methods[m],
+						pagecachebench_files[f]);
+					len = (size_t)snprintf(line, sizeof(line), "%-20s", label);
+					for (s = 0; s < n_steps; s++)
+						len += (size_t)snprintf(line + len, sizeof(line) - len,
+							" %7.2f", rate[s]);
+					(void)snprintf(line + len, sizeof(line) - len,
+						" %7.1f%%", scaling);
+					pr_inf("%s: %s\n", args->name, line);
+				}
+				if ((f == 0) && (idx < STRESS_MISC_STATS_MAX)) {
+					char desc[32];
+
+					(void)snprintf(desc, sizeof(desc), "%s %s shared scaling %%",
+						pagecachebench_fs[fs], pagecachebench_methods[m]);
+					stress_misc_stats_set(args->misc_stats, idx++, desc, scaling);
+				}
+			}
+		}
+	}
+
+	for (fs = 0; fs < PAGECACHEBENCH_FS; fs++)
+		stress_pagecachebench_fs_close(fs, &fss[fs], pagecachebench_threads);
+	(void)stress_temp_dir_rm_args(args);
+	(void)munmap((void *)buf, (size_t)(pagecachebench_threads + 1) * PAGECACHEBENCH_IO_SIZE);
+	free(threads);
+
+	return rc;
+}
+
+stressor_info_t stress_pagecachebench_info = {
+	.stressor = stress_pagecachebench,
+	.class = CLASS_FILESYSTEM | CLASS_MEMORY | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_pagecachebench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_FILESYSTEM | CLASS_MEMORY | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -0,0 +1,1014 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+
+#if defined(HAVE_LINUX_RSEQ_H)
+#include <linux/rseq.h>
+#endif
+
+#if defined(HAVE_LINUX_MEMBARRIER_H)
+#include <linux/membarrier.h>
+#endif
+
+#define MIN_PERCPU_THREADS	(1)
+#define MAX_PERCPU_THREADS	(256)
+
+#define PERCPU_STEP		(0.2)	/* seconds per implementation and thread count */
+#define PERCPU_MAX_COUNTS	(10)	/* 1, 2, 4 .. 256 and the maximum */
+#define PERCPU_BATCH		(64)	/* operations between stop checks */
+#define PERCPU_NODES		(64)	/* free list nodes per CPU */
+
+static const stress_help_t help[] = {
+	{ NULL,	"percpu N",		"start N workers comparing per-CPU rseq fast paths with atomics and mutexes" },
+	{ NULL,	"percpu-method M",	"select counter, freelist, membarrier or all, default is all" },
+	{ NULL,	"percpu-ops N",		"stop after N per-CPU operations" },
+	{ NULL,	"percpu-threads N",	"sweep 1 to N threads, default is the number of CPUs" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const percpu_methods[] = {
+	"all",
+	"counter",
+	"freelist",
+	"membarrier",
+};
+
+static int stress_set_percpu_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(percpu_methods); i++) {
+		if (!strcmp(opt, percpu_methods[i]))
+			return stress_set_setting("percpu-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "percpu-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(percpu_methods); i++)
+		(void)fprintf(stderr, " %s", percpu_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_percpu_threads(const char *opt)
+{
+	uint32_t percpu_threads;
+
+	percpu_threads = stress_get_uint32(opt);
+	stress_check_range("percpu-threads", (uint64_t)percpu_threads,
+		MIN_PERCPU_THREADS, MAX_PERCPU_THREADS);
+	return stress_set_setting("percpu-threads", TYPE_ID_UINT32, &percpu_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_percpu_method,	stress_set_percpu_method },
+	{ OPT_percpu_threads,	stress_set_percpu_threads },
+	{ 0,			NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+
+/*
+ *  The rseq critical sections are hand written x86-64 assembler
+ *  in the style of librseq, the commit is the final store
+ */
+#if defined(HAVE_LINUX_RSEQ_H) &&	\
+    defined(__NR_rseq) &&		\
+    defined(__GNUC__) &&		\
+    (defined(__x86_64__) || defined(__x86_64))
+#define HAVE_PERCPU_RSEQ
+#define PERCPU_RSEQ_SIG		(0x53053053)	/* glibc x86 RSEQ_SIG */
+
+/* rseq area registered by glibc 2.35 onwards, weak so older libcs link */
+extern const ptrdiff_t __rseq_offset __attribute__((weak));
+extern const unsigned int __rseq_size __attribute__((weak));
+#endif
+
+#if defined(__NR_membarrier) &&			\
+    defined(HAVE_LINUX_MEMBARRIER_H)
+#define HAVE_PERCPU_MEMBARRIER
+#endif
+
+/* per-CPU counter and free list head, one per cache line */
+typedef struct {
+	intptr_t count;
+	intptr_t head;				/* rseq free list */
+} ALIGN64 stress_percpu_cpu_t;
+
+/* free list node, next must be the first field for the rseq pop */
+typedef struct stress_percpu_node {
+	struct stress_percpu_node *next;	/* rseq and mutex free lists */
+	uint32_t next_idx;			/* atomic free list, index + 1 */
+	uint32_t data;
+} ALIGN64 stress_percpu_node_t;
+
+/* state shared by all the threads of a step */
+typedef struct {
+	stress_percpu_cpu_t *cpus;		/* per-CPU data */
+	uint32_t n_cpus;
+	stress_percpu_node_t *nodes;		/* free list node pool */
+	uint32_t n_nodes;
+
+	uint64_t atomic_count ALIGN64;		/* shared atomic counter */
+	uint64_t atomic_head ALIGN64;		/* atomic free list, tag:index + 1 */
+	pthread_mutex_t mutex ALIGN64;		/* mutex counter and free list */
+	uint64_t mutex_count;
+	stress_percpu_node_t *mutex_head;
+
+	volatile bool start ALIGN64;		/* start the step */
+	volatile bool stop;			/* end the step */
+	volatile bool unsupported;		/* implementation not available */
+} stress_percpu_t;
+
+/* per thread state */
+typedef struct {
+#if defined(HAVE_PERCPU_RSEQ)
+	struct rseq own_rseq;			/* rseq area if libc has none */
+#endif
+	stress_percpu_t *pc;
+	size_t impl;				/* index in percpu_impls */
+	uint32_t cpu;				/* CPU to pin membarrier spinners to */
+	uint64_t ops;
+	uint64_t retries;			/* rseq aborts or CAS retries */
+	uint64_t misses;			/* empty free list pops */
+	pthread_t pthread;
+	int ret;
+} ALIGN64 stress_percpu_thread_t;
+
+/* sweep totals per implementation and thread count */
+typedef struct {
+	uint32_t threads;			/* threads that ran */
+	uint64_t ops;
+	uint64_t retries;
+	double duration;
+	double op_ns;				/* membarrier call time */
+	uint64_t steps;
+} stress_percpu_stats_t;
+
+typedef struct {
+	const char *name;
+	size_t method;				/* index in percpu_methods */
+	void *(*func)(void *arg);		/* thread function */
+} stress_percpu_impl_t;
+
+static void stress_percpu_thread_init(stress_percpu_t *pc)
+{
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!pc->start && !pc->stop)
+		shim_sched_yield();
+}
+
+#if defined(HAVE_PERCPU_RSEQ)
+/*
+ *  stress_percpu_rseq_get()
+ *	use the libc registered rseq area, otherwise register
+ *	the thread's own, returns NULL if rseq is not available
+ */
+static struct rseq *stress_percpu_rseq_get(stress_percpu_thread_t *t, bool *registered)
+{
+	*registered = false;
+	if (&__rseq_size && (__rseq_size > 0)) {
+		uintptr_t tp;
+
+		__asm__ __volatile__("movq %%fs:0, %0" : "=r" (tp));
+		return (struct rseq *)(tp + (uintptr_t)__rseq_offset);
+	}
+	(void)memset((void *)&t->own_rseq, 0, sizeof(t->own_rseq));
+	if (syscall(__NR_rseq, &t->own_rseq, sizeof(t->own_rseq), 0, PERCPU_RSEQ_SIG) < 0)
+		return NULL;
+	*registered = true;
+	return &t->own_rseq;
+}
+
+static void stress_percpu_rseq_put(stress_percpu_thread_t *t, const bool registered)
+{
+	if (registered)
+		(void)syscall(__NR_rseq, &t->own_rseq, sizeof(t->own_rseq),
+			RSEQ_FLAG_UNREGISTER, PERCPU_RSEQ_SIG);
+}
+
+/*
+ *  stress_percpu_rseq_addv()
+ *	add count to *v if still running on cpu, returns -1 on abort
+ */
+static inline int stress_percpu_rseq_addv(
+	struct rseq *rs,
+	intptr_t *v,
+	const intptr_t count,
+	const uint32_t cpu)
+{
+	__asm__ __volatile__ goto (
+		".pushsection __rseq_cs, \"aw\"\n\t"
+		".balign 32\n\t"
+		"3:\n\t"
+		".long 0x0, 0x0\n\t"
+		".quad 1f, (2f - 1f), 4f\n\t"
+		".popsection\n\t"
+		"leaq 3b(%%rip), %%rax\n\t"
+		"movq %%rax, %[rseq_cs]\n\t"
+		"1:\n\t"
+		"cmpl %[cpu_id], %[current_cpu_id]\n\t"
+		"jnz %l[abort]\n\t"
+		"addq %[count], %[v]\n\t"
+		"2:\n\t"
+		".pushsection __rseq_failure, \"ax\"\n\t"
+		".byte 0x0f, 0xb9, 0x3d\n\t"
+		".long 0x53053053\n\t"
+		"4:\n\t"
+		"jmp %l[abort]\n\t"
+		".popsection\n\t"
+		:
+		: [cpu_id] "r" (cpu),
+		  [current_cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "m" (rs->rseq_cs),
+		  [v] "m" (*v),
+		  [count] "er" (count)
+		: "memory", "cc", "rax"
+		: abort);
+	return 0;
+abort:
+	return -1;
+}
+
+/*
+ *  stress_percpu_rseq_pop()
+ *	pop the head of the per-CPU free list into *node if still running
+ *	on cpu, returns 0 on success, 1 if empty and -1 on abort
+ */
+static inline int stress_percpu_rseq_pop(
+	struct rseq *rs,
+	intptr_t *head,
+	stress_percpu_node_t **node,
+	const uint32_t cpu)
+{
+	__asm__ __volatile__ goto (
+		".pushsection __rseq_cs, \"aw\"\n\t"
+		".balign 32\n\t"
+		"3:\n\t"
+		".long 0x0, 0x0\n\t"
+		".quad 1f, (2f - 1f), 4f\n\t"
+		".popsection\n\t"
+		"leaq 3b(%%rip), %%rax\n\t"
+		"movq %%rax, %[rseq_cs]\n\t"
+		"1:\n\t"
+		"cmpl %[cpu_id], %[current_cpu_id]\n\t"
+		"jnz %l[abort]\n\t"
+		"movq %[head], %%rbx\n\t"
+		"testq %%rbx, %%rbx\n\t"
+		"jz %l[empty]\n\t"
+		"movq (%%rbx), %%rcx\n\t"
+		"movq %%rbx, %[node]\n\t"
+		"movq %%rcx, %[head]\n\t"
+		"2:\n\t"
+		".pushsection __rseq_failure, \"ax\"\n\t"
+		".byte 0x0f, 0xb9, 0x3d\n\t"
+		".long 0x53053053\n\t"
+		"4:\n\t"
+		"jmp %l[abort]\n\t"
+		".popsection\n\t"
+		:
+		: [cpu_id] "r" (cpu),
+		  [current_cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "m" (rs->rseq_cs),
+		  [head] "m" (*head),
+		  [node] "m" (*node)
+		: "memory", "cc", "rax", "rbx", "rcx"
+		: abort, empty);
+	return 0;
+abort:
+	return -1;
+empty:
+	return 1;
+}
+
+/*
+ *  stress_percpu_rseq_push()
+ *	push node onto the per-CPU free list if still running on
+ *	cpu, returns -1 on abort
+ */
+static inline int stress_percpu_rseq_push(
+	struct rseq *rs,
+	intptr_t *head,
+	stress_percpu_node_t *node,
+	const uint32_t cpu)
+{
+	__asm__ __volatile__ goto (
+		".pushsection __rseq_cs, \"aw\"\n\t"
+		".balign 32\n\t"
+		"3:\n\t"
+		".long 0x0, 0x0\n\t"
+		".quad 1f, (2f - 1f), 4f\n\t"
+		".popsection\n\t"
+		"leaq 3b(%%rip), %%rax\n\t"
+		"movq %%rax, %[rseq_cs]\n\t"
+		"1:\n\t"
+		"cmpl %[cpu_id], %[current_cpu_id]\n\t"
+		"jnz %l[abort]\n\t"
+		"movq %[head], %%rbx\n\t"
+		"movq %%rbx, (%[node])\n\t"
+		"movq %[node], %[head]\n\t"
+		"2:\n\t"
+		".pushsection __rseq_failure, \"ax\"\n\t"
+		".byte 0x0f, 0xb9, 0x3d\n\t"
+		".long 0x53053053\n\t"
+		"4:\n\t"
+		"jmp %l[abort]\n\t"
+		".popsection\n\t"
+		:
+		: [cpu_id] "r" (cpu),
+		  [current_cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "m" (rs->rseq_cs),
+		  [head] "m" (*head),
+		  [node] "r" (node)
+		: "memory", "cc", "rax", "rbx"
+		: abort);
+	return 0;
+abort:
+	return -1;
+}
+
+/*
+ *  stress_percpu_counter_rseq()
+ *	increment the counter of the CPU the thread is running on
+ */
+static void *stress_percpu_counter_rseq(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+	stress_percpu_t *pc = t->pc;
+	bool registered;
+	struct rseq *rs = stress_percpu_rseq_get(t, &registered);
+
+	if (!rs) {
+		pc->unsupported = true;
+		return &nowt;
+	}
+	stress_percpu_thread_init(pc);
+
+	while (!pc->stop) {
+		int i;
+
+		for (i = 0; i < PERCPU_BATCH; i++) {
+			const uint32_t cpu = *(volatile uint32_t *)&rs->cpu_id_start;
+
+			if (cpu >= pc->n_cpus) {
+				(void)__atomic_add_fetch(&pc->cpus[cpu % pc->n_cpus].count, 1, __ATOMIC_RELAXED);
+			} else if (stress_percpu_rseq_addv(rs, &pc->cpus[cpu].count, 1, cpu) < 0) {
+				t->retries++;
+				i--;
+				continue;
+			}
+		}
+		t->ops += PERCPU_BATCH;
+	}
+	stress_percpu_rseq_put(t, registered);
+	return &nowt;
+}
+
+/*
+ *  stress_percpu_freelist_rseq()
+ *	allocate a node from and free it to the per-CPU free list
+ *	of the CPU the thread is running on
+ */
+static void *stress_percpu_freelist_rseq(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+	stress_percpu_t *pc = t->pc;
+	bool registered;
+	struct rseq *rs = stress_percpu_rseq_get(t, &registered);
+
+	if (!rs) {
+		pc->unsupported = true;
+		return &nowt;
+	}
+	stress_percpu_thread_init(pc);
+
+	while (!pc->stop) {
+		int i;
+
+		for (i = 0; i < PERCPU_BATCH; i++) {
+			stress_percpu_node_t *node = NULL;
+			uint32_t cpu = *(volatile uint32_t *)&rs->cpu_id_start;
+			int ret;
+
+			if (cpu >= pc->n_cpus) {
+				t->misses++;
+				continue;
+			}
+			ret = stress_percpu_rseq_pop(rs, &pc->cpus[cpu].head, &node, cpu);
+			if (ret < 0) {
+				t->retries++;
+				i--;
+				continue;
+			} else if (ret > 0) {
+				t->misses++;
+				continue;
+			}
+			node->data++;
+			for (;;) {
+				cpu = *(volatile uint32_t *)&rs->cpu_id_start;
+				if (cpu >= pc->n_cpus)
+					cpu = 0;
+				if (stress_percpu_rseq_push(rs, &pc->cpus[cpu].head, node, cpu) == 0)
+					break;
+				t->retries++;
+			}
+		}
+		t->ops += PERCPU_BATCH;
+	}
+	stress_percpu_rseq_put(t, registered);
+	return &nowt;
+}
+#else
+static void *stress_percpu_counter_rseq(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+
+	t->pc->unsupported = true;
+	return &nowt;
+}
+
+static void *stress_percpu_freelist_rseq(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+
+	t->pc->unsupported = true;
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_percpu_counter_atomic()
+ *	increment one shared atomic counter
+ */
+static void *stress_percpu_counter_atomic(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+	stress_percpu_t *pc = t->pc;
+
+	stress_percpu_thread_init(pc);
+	while (!pc->stop) {
+		int i;
+
+		for (i = 0; i < PERCPU_BATCH; i++)
+			(void)__atomic_add_fetch(&pc->atomic_count, 1, __ATOMIC_RELAXED);
+		t->ops += PERCPU_BATCH;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_percpu_counter_mutex()
+ *	increment one shared counter protected by a mutex
+ */
+static void *stress_percpu_counter_mutex(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+	stress_percpu_t *pc = t->pc;
+
+	stress_percpu_thread_init(pc);
+	while (!pc->stop) {
+		int i;
+
+		for (i = 0; i < PERCPU_BATCH; i++) {
+			(void)pthread_mutex_lock(&pc->mutex);
+			pc->mutex_count++;
+			(void)pthread_mutex_unlock(&pc->mutex);
+		}
+		t->ops += PERCPU_BATCH;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_percpu_freelist_atomic()
+ *	allocate a node from and free it to one shared lock-free
+ *	free list, the head is tagged to avoid ABA
+ */
+static void *stress_percpu_freelist_atomic(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+	stress_percpu_t *pc = t->pc;
+
+	stress_percpu_thread_init(pc);
+	while (!pc->stop) {
+		int i;
+
+		for (i = 0; i < PERCPU_BATCH; i++) {
+			uint64_t head = __atomic_load_n(&pc->atomic_head, __ATOMIC_ACQUIRE), next;
+			stress_percpu_node_t *node;
+			uint32_t idx;
+
+			for (;;) {
+				idx = (uint32_t)head;
+				if (!idx)
+					break;
+				node = &pc->nodes[idx - 1];
+				next = (((head >> 32) + 1) << 32) |
+					__atomic_load_n(&node->next_idx, __ATOMIC_RELAXED);
+				if (__atomic_compare_exchange_n(&pc->atomic_head, &head, next,
+						false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+					break;
+				t->retries++;
+			}
+			if (!idx) {
+				t->misses++;
+				continue;
+			}
+			node = &pc->nodes[idx - 1];
+			node->data++;
+
+			head = __atomic_load_n(&pc->atomic_head, __ATOMIC_ACQUIRE);
+			for (;;) {
+				__atomic_store_n(&node->next_idx, (uint32_t)head, __ATOMIC_RELAXED);
+				next = (((head >> 32) + 1) << 32) | idx;
+				if (__atomic_compare_exchange_n(&pc->atomic_head, &head, next,
+						false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+					break;
+				t->retries++;
+			}
+		}
+		t->ops += PERCPU_BATCH;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_percpu_freelist_mutex()
+ *	allocate a node from and free it to one shared free
+ *	list protected by a mutex
+ */
+static void *stress_percpu_freelist_mutex(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+	stress_percpu_t *pc = t->pc;
+
+	stress_percpu_thread_init(pc);
+	while (!pc->stop) {
+		int i;
+
+		for (i = 0; i < PERCPU_BATCH; i++) {
+			stress_percpu_node_t *node;
+
+			(void)pthread_mutex_lock(&pc->mutex);
+			node = pc->mutex_head;
+			if (node)
+				pc->mutex_head = node->next;
+			(void)pthread_mutex_unlock(&pc->mutex);
+			if (!node) {
+				t->misses++;
+				continue;
+			}
+			node->data++;
+			(void)pthread_mutex_lock(&pc->mutex);
+			node->next = pc->mutex_head;
+			pc->mutex_head = node;
+			(void)pthread_mutex_unlock(&pc->mutex);
+		}
+		t->ops += PERCPU_BATCH;
+	}
+	return &nowt;
+}
+
+#if defined(HAVE_AFFINITY)
+static void stress_percpu_pin(const uint32_t cpu)
+{
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET((int)cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+}
+#else
+static void stress_percpu_pin(const uint32_t cpu)
+{
+	(void)cpu;
+}
+#endif
+
+/*
+ *  stress_percpu_membarrier_spin()
+ *	keep a CPU busy in the mm so MEMBARRIER_CMD_PRIVATE_EXPEDITED
+ *	has to interrupt it, the barrier calls are made by the
+ *	controlling thread in stress_percpu_step()
+ */
+static void *stress_percpu_membarrier_spin(void *arg)
+{
+	static void *nowt = NULL;
+	stress_percpu_thread_t *t = (stress_percpu_thread_t *)arg;
+	stress_percpu_t *pc = t->pc;
+
+	stress_percpu_pin(t->cpu);
+	stress_percpu_thread_init(pc);
+	while (!pc->stop) {
+		int i;
+
+		for (i = 0; i < PERCPU_BATCH; i++)
+			pc->cpus[t->cpu % pc->n_cpus].count++;
+	}
+	return &nowt;
+}
+
+static const stress_percpu_impl_t percpu_impls[] = {
+	{ "counter-rseq",	1,	stress_percpu_counter_rseq },
+	{ "counter-atomic",	1,	stress_percpu_counter_atomic },
+	{ "counter-mutex",	1,	stress_percpu_counter_mutex },
+	{ "freelist-rseq",	2,	stress_percpu_freelist_rseq },
+	{ "freelist-atomic",	2,	stress_percpu_freelist_atomic },
+	{ "freelist-mutex",	2,	stress_percpu_freelist_mutex },
+	{ "membarrier",		3,	stress_percpu_membarrier_spin },
+};
+
+#define PERCPU_IMPLS	(SIZEOF_ARRAY(percpu_impls))
+
+/*
+ *  stress_percpu_reset()
+ *	reset the shared state and hand out the free list nodes,
+ *	PERCPU_NODES to each per-CPU list and all to the shared lists
+ */
+static void stress_percpu_reset(stress_percpu_t *pc)
+{
+	uint32_t i;
+
+	(void)memset(pc->cpus, 0, sizeof(*pc->cpus) * pc->n_cpus);
+	(void)memset(pc->nodes, 0, sizeof(*pc->nodes) * pc->n_nodes);
+	for (i = 0; i < pc->n_nodes; i++) {
+		stress_percpu_node_t *node = &pc->nodes[i];
+		stress_percpu_cpu_t *cpu = &pc->cpus[i / PERCPU_NODES];
+
+		node->next = (stress_percpu_node_t *)cpu->head;
+		cpu->head = (intptr_t)node;
+	}
+	pc->mutex_head = NULL;
+	pc->atomic_head = 0;
+	for (i = 0; i < pc->n_nodes; i++) {
+		pc->nodes[i].next_idx = (uint32_t)pc->atomic_head;
+		pc->atomic_head = i + 1;
+	}
+	pc->atomic_count = 0;
+	pc->mutex_count = 0;
+	pc->start = false;
+	pc->stop = false;
+	pc->unsupported = false;
+}
+
+/*
+ *  stress_percpu_verify()
+ *	check no counts or free list nodes were lost
+ */
+static void stress_percpu_verify(
+	const stress_args_t *args,
+	stress_percpu_t *pc,
+	const size_t impl,
+	const uint64_t ops)
+{
+	uint64_t total = 0;
+	uint32_t i;
+	const char *what = "count";
+
+	switch (impl) {
+	case 0:
+		for (i = 0; i < pc->n_cpus; i++)
+			total += (uint64_t)pc->cpus[i].count;
+		break;
+	case 1:
+		total = pc->atomic_count;
+		break;
+	case 2:
+		total = pc->mutex_count;
+		break;
+	case 3:
+		for (i = 0; i < pc->n_cpus; i++) {
+			const stress_percpu_node_t *node;
+
+			for (node = (stress_percpu_node_t *)pc->cpus[i].head; node; node = node->next)
+				total++;
+		}
+		what = "free list nodes";
+		break;
+	case 4:
+		for (i = (uint32_t)pc->atomic_head; i; i = pc->nodes[i - 1].next_idx)
+			total++;
+		what = "free list nodes";
+		break;
+	case 5:
+		{
+			const stress_percpu_node_t *node;
+
+			for (node = pc->mutex_head; node; node = node->next)
+				total++;
+		}
+		what = "free list nodes";
+		break;
+	default:
+		return;
+	}
+	if (impl < 3) {
+		if (total != ops)
+			pr_fail("%s: %s %s is %" PRIu64 ", expected %" PRIu64 "\n",
+				args->name, percpu_impls[impl].name, what, total, ops);
+	} else {
+		if (total != pc->n_nodes)
+			pr_fail("%s: %s has %" PRIu64 " %s, expected %" PRIu32 "\n",
+				args->name, percpu_impls[impl].name, total, what, pc->n_nodes);
+	}
+}
+
+/*
+ *  stress_percpu_step()
+ *	run n_threads threads on one implementation for PERCPU_STEP
+ *	seconds and add the results to stats, returns -1 if the
+ *	implementation is not available
+ */
+static int stress_percpu_step(
+	const stress_args_t *args,
+	stress_percpu_t *pc,
+	stress_percpu_thread_t *threads,
+	const int *cpus,
+	const uint32_t n_allowed,
+	const size_t impl,
+	const uint32_t n_threads,
+	stress_percpu_stats_t *stats)
+{
+	uint64_t ops = 0, retries = 0, misses = 0, calls = 0;
+	uint32_t i, started = 0;
+	double t_start, duration, call_time = 0.0;
+
+	stress_percpu_reset(pc);
+	if (impl == 5) {
+		/* the mutex free list starts with all the nodes */
+		for (i = 0; i < pc->n_cpus; i++)
+			pc->cpus[i].head = 0;
+		for (i = 0; i < pc->n_nodes; i++) {
+			pc->nodes[i].next = pc->mutex_head;
+			pc->mutex_head = &pc->nodes[i];
+		}
+	}
+
+	for (i = 0; i < n_threads; i++) {
+		stress_percpu_thread_t *t = &threads[i];
+
+		(void)memset((void *)t, 0, sizeof(*t));
+		t->pc = pc;
+		t->impl = impl;
+		t->cpu = n_allowed ? (uint32_t)cpus[i % n_allowed] : 0;
+		t->ret = pthread_create(&t->pthread, NULL, percpu_impls[impl].func, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+
+	t_start = stress_time_now();
+	pc->start = true;
+	shim_mb();
+	if (percpu_impls[impl].method == 3) {
+#if defined(HAVE_PERCPU_MEMBARRIER)
+		const double t_end = t_start + PERCPU_STEP;
+
+		while (!pc->unsupported && (stress_time_now() < t_end)) {
+			const double t = stress_time_now();
+
+			if (shim_membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) < 0) {
+				pc->unsupported = true;
+				break;
+			}
+			call_time += stress_time_now() - t;
+			calls++;
+		}
+#else
+		pc->unsupported = true;
+#endif
+	} else {
+		(void)shim_usleep((uint64_t)(PERCPU_STEP * 1000000.0));
+	}
+	pc->stop = true;
+	shim_mb();
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	duration = stress_time_now() - t_start;
+
+	if (pc->unsupported)
+		return -1;
+	if (!started)
+		return 0;
+
+	for (i = 0; i < started; i++) {
+		ops += threads[i].ops;
+		retries += threads[i].retries;
+		misses += threads[i].misses;
+	}
+	if (percpu_impls[impl].method == 3) {
+		/* the barrier calls are the operations */
+		ops = calls;
+		stats->op_ns += calls ? (double)STRESS_NANOSECOND * call_time / (double)calls : 0.0;
+	} else {
+		stress_percpu_verify(args, pc, impl, ops - misses);
+		stats->op_ns += (ops > 0) ?
+			(double)STRESS_NANOSECOND * duration * (double)started / (double)ops : 0.0;
+	}
+	stats->threads = started;
+	stats->ops += ops;
+	stats->retries += retries;
+	stats->duration += duration;
+	stats->steps++;
+	add_counter(args, ops);
+
+	return 0;
+}
+
+/*
+ *  stress_percpu()
+ *	sweep per-CPU rseq fast paths, atomics, mutexes and
+ *	membarrier over 1, 2, 4 .. N threads
+ */
+static int stress_percpu(const stress_args_t *args)
+{
+	static stress_percpu_stats_t stats[PERCPU_IMPLS][PERCPU_MAX_COUNTS];
+	bool available[PERCPU_IMPLS];
+	const int32_t cpus_online = stress_get_processors_online();
+	const int32_t cpus_conf = stress_get_processors_configured();
+	uint32_t percpu_threads = (cpus_online > 1) ? (uint32_t)cpus_online : 4;
+	uint32_t counts[PERCPU_MAX_COUNTS], n, n_allowed = 0;
+	size_t percpu_method = 0, i, j, n_counts = 0, idx = 0, cpus_size, nodes_size;
+	stress_percpu_thread_t *threads;
+	stress_percpu_t *pc;
+	static int allowed[CPU_SETSIZE];
+
+	(void)stress_get_setting("percpu-method", &percpu_method);
+	if (!stress_get_setting("percpu-threads", &percpu_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			percpu_threads = MAX_PERCPU_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			percpu_threads = MIN_PERCPU_THREADS;
+	}
+	if (percpu_threads > MAX_PERCPU_THREADS)
+		percpu_threads = MAX_PERCPU_THREADS;
+
+	/* 1, 2, 4 .. up to and including percpu_threads */
+	for (n = 1; (n < percpu_threads) && (n_counts < PERCPU_MAX_COUNTS - 1); n <<= 1)
+		counts[n_counts++] = n;
+	counts[n_counts++] = percpu_threads;
+
+#if defined(HAVE_AFFINITY) &&	\
+    defined(HAVE_SCHED_GETAFFINITY)
+	{
+		cpu_set_t mask;
+
+		if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+			int cpu;
+
+			for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				if (CPU_ISSET(cpu, &mask))
+					allowed[n_allowed++] = cpu;
+			}
+		}
+	}
+#endif
+
+	threads = (stress_percpu_thread_t *)mmap(NULL,
+		sizeof(*threads) * percpu_threads, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %" PRIu32 " thread states, skipping stressor\n",
+			args->name, percpu_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	pc = (stress_percpu_t *)mmap(NULL, sizeof(*pc), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pc == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap per-CPU state, skipping stressor\n", args->name);
+		(void)munmap((void *)threads, sizeof(*threads) * percpu_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	pc->n_cpus = (cpus_conf > 0) ? (uint32_t)cpus_conf : 1;
+	pc->n_nodes = pc->n_cpus * PERCPU_NODES;
+	cpus_size = sizeof(*pc->cpus) * pc->n_cpus;
+	nodes_size = sizeof(*pc->nodes) * pc->n_nodes;
+	pc->cpus = (stress_percpu_cpu_t *)mmap(NULL, cpus_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	pc->nodes = (stress_percpu_node_t *)mmap(NULL, nodes_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((pc->cpus == MAP_FAILED) || (pc->nodes == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot mmap per-CPU data, skipping stressor\n", args->name);
+		if (pc->nodes != MAP_FAILED)
+			(void)munmap((void *)pc->nodes, nodes_size);
+		if (pc->cpus != MAP_FAILED)
+			(void)munmap((void *)pc->cpus, cpus_size);
+		(void)munmap((void *)pc, sizeof(*pc));
+		(void)munmap((void *)threads, sizeof(*threads) * percpu_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)pthread_mutex_init(&pc->mutex, NULL);
+
+	for (i = 0; i < PERCPU_IMPLS; i++)
+		available[i] = (percpu_method == 0) || (percpu_method == percpu_impls[i].method);
+#if defined(HAVE_PERCPU_MEMBARRIER)
+	if (available[PERCPU_IMPLS - 1] &&
+	    (shim_membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) < 0)) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot register for MEMBARRIER_CMD_PRIVATE_EXPEDITED, "
+				"errno=%d (%s)\n", args->name, errno, strerror(errno));
+		available[PERCPU_IMPLS - 1] = false;
+	}
+#endif
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < PERCPU_IMPLS); i++) {
+			if (!available[i])
+				continue;
+			for (j = 0; keep_stressing(args) && (j < n_counts); j++) {
+				if (stress_percpu_step(args, pc, threads, allowed, n_allowed,
+						i, counts[j], &stats[i][j]) < 0) {
+					if (args->instance == 0)
+						pr_inf("%s: %s is not available\n",
+							args->name, percpu_impls[i].name);
+					available[i] = false;
+					break;
+				}
+			}
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: method           threads    Mops/s      ns/op  retry %%\n",
+			args->name);
+	for (i = 0; i < PERCPU_IMPLS; i++) {
+		double top = 0.0;
+
+		for (j = 0; j < n_counts; j++) {
+			const stress_percpu_stats_t *st = &stats[i][j];
+			const double mops = (st->duration > 0.0) ?
+				((double)st->ops / st->duration) / 1000000.0 : 0.0;
+
+			if (!st->steps)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %-16s %7" PRIu32 " %9.3f %10.1f %8.2f\n",
+					args->name, percpu_impls[i].name, st->threads, mops,
+					st->op_ns / (double)st->steps,
+					st->ops ? 100.0 * (double)st->retries / (double)st->ops : 0.0);
+			if (j == n_counts - 1)
+				top = mops;
+		}
+		/* operation rate at the highest thread count */
+		if ((top > 0.0) && (idx < STRESS_MISC_STATS_MAX)) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s Mops/s", percpu_impls[i].name);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, top);
+		}
+	}
+
+	(void)pthread_mutex_destroy(&pc->mutex);
+	(void)munmap((void *)pc->nodes, nodes_size);
+	(void)munmap((void *)pc->cpus, cpus_size);
+	(void)munmap((void *)pc, sizeof(*pc));
+	(void)munmap((void *)threads, sizeof(*threads) * percpu_threads);
+
+	return EXIT_SUCCESS;
+}
+
+stressor_info_t stress_percpu_info = {
+	.stressor = stress_percpu,
+	.class = CLASS_CPU | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_ALWAYS,
+	.help = help
+};
+#else
+stressor_info_t stress_percpu_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_CPU | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
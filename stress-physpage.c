@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-capabilities.h"
+#include "core-pagemap.h"
 
 #if defined(HAVE_ASM_MTRR_H)
 #include <asm/mtrr.h>
@@ -33,9 +34,6 @@ static const stress_help_t help[] = {
 
 #if defined(__linux__)
 
-#define PAGE_PRESENT	(1ULL << 63)
-#define PFN_MASK	((1ULL << 54) - 1)
-
 /*
  *  stress_physpage_supported()
  *      check if we can run this with SHIM_CAP_SYS_ADMIN capability
@@ -127,13 +125,7 @@ static int stress_virt_to_phys(
 	uint64_t pageinfo;
 	ssize_t n;
 
-	offset = (off_t)((virt_addr / page_size) * sizeof(uint64_t));
-	if (lseek(fd_pm, offset, SEEK_SET) != offset) {
-		pr_err("%s: cannot seek on address %p in /proc/self/pagemap, errno=%d (%s)\n",
-			args->name, (void *)virt_addr, errno, strerror(errno));
-		goto err;
-	}
-	n = read(fd_pm, &pageinfo, sizeof(pageinfo));
+	n = stress_pagemap_entry(fd_pm, page_size, virt_addr, &pageinfo);
 	if (n < 0) {
 		pr_err("%s: cannot read address %p in /proc/self/pagemap, errno=%d (%s)\n",
 			args->name, (void *)virt_addr, errno, strerror(errno));
@@ -144,9 +136,9 @@ static int stress_virt_to_phys(
 		goto err;
 	}
 
-	if (pageinfo & PAGE_PRESENT) {
+	if (pageinfo & STRESS_PAGEMAP_PRESENT) {
 		uint64_t page_count;
-		const uint64_t pfn = pageinfo & PFN_MASK;
+		const uint64_t pfn = pageinfo & STRESS_PAGEMAP_PFN_MASK;
 		uintptr_t phys_addr = pfn * page_size;
 
 		phys_addr |= (virt_addr & (page_size - 1));
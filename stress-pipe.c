@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 
 #define PIPE_STOP	"PS!"
 
@@ -256,8 +257,10 @@ again:
 
 		do {
 			ssize_t ret;
+			uint64_t t;
 
 			pipe_memset(buf, (char)val++, pipe_data_size);
+			t = stress_latency_now();
 			ret = write(pipefds[1], buf, pipe_data_size);
 			if (ret <= 0) {
 				if ((errno == EAGAIN) || (errno == EINTR))
@@ -269,6 +272,7 @@ again:
 				}
 				continue;
 			}
+			stress_latency_record(args->latency, stress_latency_now() - t);
 			inc_counter(args);
 		} while (keep_stressing(args));
 
@@ -282,6 +286,7 @@ again:
 		(void)kill(pid, SIGKILL);
 		(void)shim_waitpid(pid, &status, 0);
 		(void)close(pipefds[1]);
+		stress_latency_misc_stats(args, 0, "write");
 		(void)munmap((void *)buf, pipe_data_size);
 	}
 finish:
@@ -19,6 +19,17 @@
  */
 #include "stress-ng.h"
 
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
 /*
  *  Herd of pipe processes, simulates how GNU make passes tokens
  *  when building with -j option, but without the timely building.
@@ -30,10 +41,17 @@
  */
 #define PIPE_HERD_MAX	(100)
 
+#define HERD_BENCH_WAITERS_MIN		(1)
+#define HERD_BENCH_WAITERS_MAX		(4096)
+#define HERD_BENCH_WAITERS_DEFAULT	(1000)
+#define HERD_BENCH_EVENTS		(16)
+
 static const stress_help_t help[] = {
 	{ "p N", "pipeherd N",		"start N multi-process workers exercising pipes I/O" },
 	{ NULL,	"pipeherd-ops N",	"stop after N pipeherd I/O bogo operations" },
 	{ NULL,	"pipeherd-yield",	"force processes to yield after each write" },
+	{ NULL,	"pipeherd-bench",	"measure thundering herd wakeups of N waiters per event" },
+	{ NULL,	"pipeherd-bench-max N",	"sweep the herd benchmark from 1 to N waiters" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -42,6 +60,21 @@ static int stress_set_pipeherd_yield(const char *opt)
 	return stress_set_setting_true("pipeherd-yield", opt);
 }
 
+static int stress_set_pipeherd_bench(const char *opt)
+{
+	return stress_set_setting_true("pipeherd-bench", opt);
+}
+
+static int stress_set_pipeherd_bench_max(const char *opt)
+{
+	uint32_t pipeherd_bench_max;
+
+	pipeherd_bench_max = stress_get_uint32(opt);
+	stress_check_range("pipeherd-bench-max", (uint64_t)pipeherd_bench_max,
+		HERD_BENCH_WAITERS_MIN, HERD_BENCH_WAITERS_MAX);
+	return stress_set_setting("pipeherd-bench-max", TYPE_ID_UINT32, &pipeherd_bench_max);
+}
+
 static int stress_pipeherd_read_write(const stress_args_t *args, const int fd[2], const bool pipeherd_yield)
 {
 	while (keep_stressing(args)) {
@@ -67,6 +100,593 @@ static int stress_pipeherd_read_write(const stress_args_t *args, const int fd[2]
 	return EXIT_SUCCESS;
 }
 
+#if defined(__linux__) &&		\
+    defined(HAVE_ATOMIC_FETCH_ADD) &&	\
+    defined(HAVE_ATOMIC_FETCH_SUB) &&	\
+    defined(HAVE_ATOMIC_LOAD)
+
+#define HAVE_PIPEHERD_BENCH
+
+typedef enum {
+	HERD_PIPE,
+	HERD_EVENTFD,
+	HERD_FUTEX,
+	HERD_FUTEX_ALL,
+	HERD_EPOLL,
+	HERD_EPOLL_EXCL,
+	HERD_ACCEPT,
+} stress_herd_type_t;
+
+typedef struct {
+	const char *name;		/* method name */
+	const char *stat;		/* misc stats description */
+	const stress_herd_type_t type;	/* wait mechanism */
+} stress_herd_method_t;
+
+/*
+ *  state shared between the poster and the herd of waiters,
+ *  woken and first_t are reset by the poster for each event
+ */
+typedef struct {
+	double post_t;			/* time the event was posted */
+	double first_t;			/* time the first waiter returned */
+	uint32_t woken;			/* waiters returned to user space */
+	uint32_t consumed;		/* events consumed by a waiter */
+	uint32_t ready;			/* waiters about to block */
+	int32_t tokens;			/* futex token count */
+} stress_herd_shared_t;
+
+typedef struct {
+	stress_herd_shared_t *shared;
+	int fds[2];			/* pipe fds */
+	int efd;			/* eventfd */
+	int sfd;			/* listening socket */
+	struct sockaddr_in addr;	/* listening socket address */
+} stress_herd_ctx_t;
+
+typedef struct {
+	double first_us;		/* mean time to first wakeup */
+	double wakeups;			/* scheduler wakeups per event */
+	double returns;			/* user space returns per event */
+	double cpu_us;			/* waiter CPU time per event */
+	bool ok;
+} stress_herd_result_t;
+
+static const stress_herd_method_t herd_methods[] = {
+	{ "pipe",	"pipe wakeups per event",	HERD_PIPE },
+	{ "eventfd",	"eventfd wakeups per event",	HERD_EVENTFD },
+	{ "futex",	"futex wakeups per event",	HERD_FUTEX },
+	{ "futex-all",	"futex-all wakeups per event",	HERD_FUTEX_ALL },
+	{ "epoll",	"epoll wakeups per event",	HERD_EPOLL },
+	{ "epoll-excl",	"epoll-excl wakeups per event",	HERD_EPOLL_EXCL },
+	{ "accept",	"accept wakeups per event",	HERD_ACCEPT },
+};
+
+static const uint32_t herd_waiters[] = { 1, 10, 100, 1000 };
+
+#define HERD_METHODS	(SIZEOF_ARRAY(herd_methods))
+#define HERD_SIZES	(SIZEOF_ARRAY(herd_waiters) + 1)
+
+/*
+ *  stress_herd_supported()
+ *	can this system build the given wait mechanism
+ */
+static bool stress_herd_supported(const stress_herd_type_t type)
+{
+	switch (type) {
+	case HERD_EVENTFD:
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+		return true;
+#else
+		return false;
+#endif
+	case HERD_EPOLL:
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE)
+		return true;
+#else
+		return false;
+#endif
+	case HERD_EPOLL_EXCL:
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE) &&	\
+    defined(EPOLLEXCLUSIVE)
+		return true;
+#else
+		return false;
+#endif
+	default:
+		break;
+	}
+	return true;
+}
+
+/*
+ *  stress_herd_schedstat()
+ *	sum the on-cpu time and number of times the waiters got
+ *	scheduled from /proc/$pid/schedstat, returns false if
+ *	schedstats are not available
+ */
+static bool stress_herd_schedstat(
+	const pid_t *pids,
+	const uint32_t n,
+	uint64_t *run_ns,
+	uint64_t *slices)
+{
+	uint32_t i;
+
+	*run_ns = 0;
+	*slices = 0;
+	for (i = 0; i < n; i++) {
+		char path[64], buf[128];
+		unsigned long long int run, wait, count;
+
+		(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/schedstat", (intmax_t)pids[i]);
+		if (system_read(path, buf, sizeof(buf)) <= 0)
+			return false;
+		if (sscanf(buf, "%llu %llu %llu", &run, &wait, &count) != 3)
+			return false;
+		*run_ns += (uint64_t)run;
+		*slices += (uint64_t)count;
+	}
+	return true;
+}
+
+/*
+ *  stress_herd_woken()
+ *	a waiter returned to user space, the first one for
+ *	an event records the time to first wakeup
+ */
+static inline void stress_herd_woken(stress_herd_shared_t *shared)
+{
+	if (__atomic_fetch_add(&shared->woken, 1, __ATOMIC_SEQ_CST) == 0)
+		shared->first_t = stress_time_now();
+}
+
+/*
+ *  stress_herd_waiter()
+ *	block on the shared event source, consume the event if it
+ *	is still there on wakeup and go back to waiting
+ */
+static void NORETURN stress_herd_waiter(
+	const stress_herd_method_t *method,
+	stress_herd_ctx_t *ctx)
+{
+	stress_herd_shared_t *shared = ctx->shared;
+	int epfd = -1;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE)
+	if ((method->type == HERD_EPOLL) || (method->type == HERD_EPOLL_EXCL)) {
+		struct epoll_event ev;
+
+		(void)memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+#if defined(EPOLLEXCLUSIVE)
+		if (method->type == HERD_EPOLL_EXCL)
+			ev.events |= EPOLLEXCLUSIVE;
+#endif
+		epfd = epoll_create(1);
+		if (epfd < 0)
+			_exit(EXIT_FAILURE);
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, ctx->efd, &ev) < 0)
+			_exit(EXIT_FAILURE);
+	}
+#endif
+	(void)__atomic_fetch_add(&shared->ready, 1, __ATOMIC_SEQ_CST);
+
+	for (;;) {
+		bool consumed = false;
+
+		switch (method->type) {
+		case HERD_PIPE: {
+			char ch;
+
+			if (read(ctx->fds[0], &ch, sizeof(ch)) < 0)
+				_exit(EXIT_FAILURE);
+			stress_herd_woken(shared);
+			consumed = true;
+			break;
+		}
+		case HERD_EVENTFD: {
+			uint64_t val;
+
+			if (read(ctx->efd, &val, sizeof(val)) < 0)
+				_exit(EXIT_FAILURE);
+			stress_herd_woken(shared);
+			consumed = true;
+			break;
+		}
+		case HERD_FUTEX:
+		case HERD_FUTEX_ALL: {
+			const int32_t tokens = __atomic_load_n(&shared->tokens, __ATOMIC_SEQ_CST);
+
+			if (tokens <= 0) {
+				if ((shim_futex_wait(&shared->tokens, tokens, NULL) < 0) &&
+				    (errno != EAGAIN) && (errno != EINTR))
+					_exit(EXIT_FAILURE);
+				stress_herd_woken(shared);
+				break;
+			}
+			/* lost the race for the token, put it back */
+			if (__atomic_fetch_sub(&shared->tokens, 1, __ATOMIC_SEQ_CST) <= 0)
+				(void)__atomic_fetch_add(&shared->tokens, 1, __ATOMIC_SEQ_CST);
+			else
+				consumed = true;
+			break;
+		}
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE)
+		case HERD_EPOLL:
+		case HERD_EPOLL_EXCL: {
+			struct epoll_event ev;
+			uint64_t val;
+
+			if (epoll_wait(epfd, &ev, 1, -1) < 0) {
+				if (errno == EINTR)
+					break;
+				_exit(EXIT_FAILURE);
+			}
+			stress_herd_woken(shared);
+			/* non-blocking read, losers get EAGAIN */
+			consumed = (read(ctx->efd, &val, sizeof(val)) == (ssize_t)sizeof(val));
+			break;
+		}
+#endif
+		case HERD_ACCEPT: {
+			int fd;
+
+			fd = accept(ctx->sfd, NULL, NULL);
+			stress_herd_woken(shared);
+			if (fd >= 0) {
+				(void)close(fd);
+				consumed = true;
+			}
+			break;
+		}
+		default:
+			_exit(EXIT_NOT_IMPLEMENTED);
+		}
+		if (consumed)
+			(void)__atomic_fetch_add(&shared->consumed, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+/*
+ *  stress_herd_post()
+ *	post a single event to the herd
+ */
+static int stress_herd_post(const stress_herd_method_t *method, stress_herd_ctx_t *ctx)
+{
+	switch (method->type) {
+	case HERD_PIPE: {
+		const char ch = 'x';
+
+		return (write(ctx->fds[1], &ch, sizeof(ch)) == (ssize_t)sizeof(ch)) ? 0 : -1;
+	}
+	case HERD_EVENTFD:
+	case HERD_EPOLL:
+	case HERD_EPOLL_EXCL: {
+		const uint64_t val = 1;
+
+		return (write(ctx->efd, &val, sizeof(val)) == (ssize_t)sizeof(val)) ? 0 : -1;
+	}
+	case HERD_FUTEX:
+		(void)__atomic_fetch_add(&ctx->shared->tokens, 1, __ATOMIC_SEQ_CST);
+		return (shim_futex_wake(&ctx->shared->tokens, 1) < 0) ? -1 : 0;
+	case HERD_FUTEX_ALL:
+		(void)__atomic_fetch_add(&ctx->shared->tokens, 1, __ATOMIC_SEQ_CST);
+		return (shim_futex_wake(&ctx->shared->tokens, INT_MAX) < 0) ? -1 : 0;
+	case HERD_ACCEPT: {
+		int fd, ret;
+
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+		ret = connect(fd, (struct sockaddr *)&ctx->addr, sizeof(ctx->addr));
+		(void)close(fd);
+		return ret;
+	}
+	default:
+		break;
+	}
+	return -1;
+}
+
+/*
+ *  stress_herd_open()
+ *	create the shared event source for a method
+ */
+static int stress_herd_open(const stress_herd_method_t *method, stress_herd_ctx_t *ctx)
+{
+	ctx->fds[0] = -1;
+	ctx->fds[1] = -1;
+	ctx->efd = -1;
+	ctx->sfd = -1;
+
+	switch (method->type) {
+	case HERD_PIPE:
+		return pipe(ctx->fds);
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+	case HERD_EVENTFD:
+		ctx->efd = eventfd(0, 0);
+		return (ctx->efd < 0) ? -1 : 0;
+	case HERD_EPOLL:
+	case HERD_EPOLL_EXCL:
+		ctx->efd = eventfd(0, EFD_NONBLOCK);
+		return (ctx->efd < 0) ? -1 : 0;
+#endif
+	case HERD_FUTEX:
+	case HERD_FUTEX_ALL:
+		ctx->shared->tokens = 0;
+		return 0;
+	case HERD_ACCEPT: {
+		socklen_t len = (socklen_t)sizeof(ctx->addr);
+
+		ctx->sfd = socket(AF_INET, SOCK_STREAM, 0);
+		if (ctx->sfd < 0)
+			return -1;
+		(void)memset(&ctx->addr, 0, sizeof(ctx->addr));
+		ctx->addr.sin_family = AF_INET;
+		ctx->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		ctx->addr.sin_port = 0;
+		if ((bind(ctx->sfd, (struct sockaddr *)&ctx->addr, sizeof(ctx->addr)) < 0) ||
+		    (getsockname(ctx->sfd, (struct sockaddr *)&ctx->addr, &len) < 0) ||
+		    (listen(ctx->sfd, HERD_BENCH_EVENTS) < 0)) {
+			(void)close(ctx->sfd);
+			ctx->sfd = -1;
+			return -1;
+		}
+		return 0;
+	}
+	default:
+		break;
+	}
+	return -1;
+}
+
+static void stress_herd_close(stress_herd_ctx_t *ctx)
+{
+	if (ctx->fds[0] >= 0)
+		(void)close(ctx->fds[0]);
+	if (ctx->fds[1] >= 0)
+		(void)close(ctx->fds[1]);
+	if (ctx->efd >= 0)
+		(void)close(ctx->efd);
+	if (ctx->sfd >= 0)
+		(void)close(ctx->sfd);
+}
+
+/*
+ *  stress_herd_measure()
+ *	start n waiters blocked on one event source, post events one
+ *	at a time and measure the time to first wakeup, how many
+ *	waiters got woken and how much CPU the herd burned per event
+ */
+static void stress_herd_measure(
+	const stress_args_t *args,
+	const stress_herd_method_t *method,
+	stress_herd_ctx_t *ctx,
+	pid_t *pids,
+	const uint32_t n,
+	stress_herd_result_t *result)
+{
+	stress_herd_shared_t *shared = ctx->shared;
+	const useconds_t settle_us = 1000 + (n * 10);
+	uint64_t run_ns0 = 0, slices0 = 0, run_ns1 = 0, slices1 = 0;
+	uint32_t i, started = 0, returns = 0;
+	double first_total = 0.0, deadline;
+	bool schedstat;
+	int events = 0;
+
+	(void)memset(result, 0, sizeof(*result));
+	(void)memset(shared, 0, sizeof(*shared));
+
+	if (stress_herd_open(method, ctx) < 0)
+		return;
+
+	for (started = 0; started < n; started++) {
+		pids[started] = fork();
+		if (pids[started] < 0)
+			goto reap;
+		if (pids[started] == 0)
+			stress_herd_waiter(method, ctx);
+	}
+
+	/* wait for the herd to get ready and then all block */
+	deadline = stress_time_now() + 10.0;
+	while (__atomic_load_n(&shared->ready, __ATOMIC_SEQ_CST) < n) {
+		if (!keep_stressing(args) || (stress_time_now() > deadline))
+			goto reap;
+		(void)shim_usleep(1000);
+	}
+	(void)shim_usleep(10000 + (n * 20));
+
+	schedstat = stress_herd_schedstat(pids, n, &run_ns0, &slices0);
+
+	for (events = 0; events < HERD_BENCH_EVENTS; events++) {
+		const uint32_t consumed = __atomic_load_n(&shared->consumed, __ATOMIC_SEQ_CST);
+
+		if (!keep_stressing(args))
+			goto reap;
+		shared->woken = 0;
+		shared->first_t = 0.0;
+		shared->post_t = stress_time_now();
+		if (stress_herd_post(method, ctx) < 0)
+			goto reap;
+
+		deadline = shared->post_t + 1.0;
+		while (__atomic_load_n(&shared->consumed, __ATOMIC_SEQ_CST) == consumed) {
+			if (!keep_stressing(args) || (stress_time_now() > deadline))
+				goto reap;
+			(void)shim_sched_yield();
+		}
+		/* let the losers go back to sleep */
+		(void)shim_usleep(settle_us);
+
+		if (shared->first_t > shared->post_t)
+			first_total += shared->first_t - shared->post_t;
+		returns += __atomic_load_n(&shared->woken, __ATOMIC_SEQ_CST);
+	}
+
+	if (schedstat)
+		schedstat = stress_herd_schedstat(pids, n, &run_ns1, &slices1);
+
+	result->first_us = (first_total * 1000000.0) / (double)events;
+	result->returns = (double)returns / (double)events;
+	if (schedstat) {
+		result->wakeups = (double)(slices1 - slices0) / (double)events;
+		result->cpu_us = (double)(run_ns1 - run_ns0) / ((double)events * 1000.0);
+	} else {
+		result->wakeups = -1.0;
+		result->cpu_us = -1.0;
+	}
+	result->ok = true;
+
+reap:
+	for (i = 0; i < started; i++)
+		(void)kill(pids[i], SIGKILL);
+	for (i = 0; i < started; i++) {
+		int status;
+
+		(void)shim_waitpid(pids[i], &status, 0);
+	}
+	stress_herd_close(ctx);
+}
+
+/*
+ *  stress_pipeherd_bench()
+ *	sweep thundering herd wakeup cost over the number of
+ *	waiters for each wait mechanism
+ */
+static int stress_pipeherd_bench(const stress_args_t *args)
+{
+	uint32_t max_waiters = HERD_BENCH_WAITERS_DEFAULT;
+	uint32_t sizes[HERD_SIZES];
+	stress_herd_result_t (*pass)[HERD_SIZES], (*res)[HERD_SIZES];
+	stress_herd_ctx_t ctx;
+	size_t i, j, n_sizes = 0, shared_size, res_size;
+	pid_t *pids;
+	bool done = false;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("pipeherd-bench-max", &max_waiters);
+	for (i = 0; i < SIZEOF_ARRAY(herd_waiters); i++) {
+		if (herd_waiters[i] <= max_waiters)
+			sizes[n_sizes++] = herd_waiters[i];
+	}
+	if ((n_sizes == 0) || (sizes[n_sizes - 1] != max_waiters))
+		sizes[n_sizes++] = max_waiters;
+
+	pids = calloc((size_t)max_waiters, sizeof(*pids));
+	if (!pids) {
+		pr_inf_skip("%s: cannot allocate pid array, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	res_size = sizeof(*res) * HERD_METHODS;
+	pass = calloc(HERD_METHODS, sizeof(*pass));
+	res = calloc(HERD_METHODS, sizeof(*res));
+	if (!pass || !res) {
+		pr_inf_skip("%s: cannot allocate result arrays, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_res;
+	}
+
+	shared_size = STRESS_MAXIMUM(args->page_size, sizeof(*ctx.shared));
+	ctx.shared = (stress_herd_shared_t *)mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ctx.shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes of shared memory, skipping stressor\n",
+			args->name, shared_size);
+		rc = EXIT_NO_RESOURCE;
+		goto free_res;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < HERD_METHODS; i++) {
+			for (j = 0; j < n_sizes; j++) {
+				if (!keep_stressing(args))
+					goto finish;
+				(void)memset(&pass[i][j], 0, sizeof(pass[i][j]));
+				if (!stress_herd_supported(herd_methods[i].type))
+					continue;
+				stress_herd_measure(args, &herd_methods[i], &ctx,
+					pids, sizes[j], &pass[i][j]);
+			}
+		}
+		if (!keep_stressing(args))
+			break;
+		(void)memcpy(res, pass, res_size);
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: thundering herd, %d single events posted per point\n",
+			args->name, HERD_BENCH_EVENTS);
+		pr_inf("%s: %-10s %7s %11s %13s %13s %12s\n", args->name,
+			"method", "waiters", "1st wake us", "wakeups/event",
+			"returns/event", "CPU us/event");
+		for (i = 0; i < HERD_METHODS; i++) {
+			for (j = 0; j < n_sizes; j++) {
+				const stress_herd_result_t *r = &res[i][j];
+				char first[16], wakeups[16], returns[16], cpu[16];
+
+				if (r->ok) {
+					(void)snprintf(first, sizeof(first), "%.2f", r->first_us);
+					(void)snprintf(returns, sizeof(returns), "%.2f", r->returns);
+				} else {
+					(void)shim_strlcpy(first, "-", sizeof(first));
+					(void)shim_strlcpy(returns, "-", sizeof(returns));
+				}
+				if (r->ok && (r->wakeups >= 0.0)) {
+					(void)snprintf(wakeups, sizeof(wakeups), "%.2f", r->wakeups);
+					(void)snprintf(cpu, sizeof(cpu), "%.2f", r->cpu_us);
+				} else {
+					(void)shim_strlcpy(wakeups, "-", sizeof(wakeups));
+					(void)shim_strlcpy(cpu, "-", sizeof(cpu));
+				}
+				pr_inf("%s: %-10s %7" PRIu32 " %11s %13s %13s %12s\n", args->name,
+					j ? "" : herd_methods[i].name, sizes[j],
+					first, wakeups, returns, cpu);
+			}
+		}
+		pr_inf("%s: wakeups/event from /proc/$pid/schedstat, returns/event "
+			"counts waiters back in user space\n", args->name);
+	}
+	if (done) {
+		for (i = 0; i < HERD_METHODS; i++) {
+			const stress_herd_result_t *r = &res[i][n_sizes - 1];
+
+			stress_misc_stats_set(args->misc_stats, (int)i, herd_methods[i].stat,
+				(r->wakeups >= 0.0) ? r->wakeups : r->returns);
+		}
+	}
+
+	(void)munmap((void *)ctx.shared, shared_size);
+free_res:
+	free(res);
+	free(pass);
+	free(pids);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_pipeherd
  *	stress by heavy pipe I/O
@@ -79,6 +699,7 @@ static int stress_pipeherd(const stress_args_t *args)
 	int i, rc;
 	ssize_t sz;
 	bool pipeherd_yield = false;
+	bool pipeherd_bench = false;
 #if defined(HAVE_GETRUSAGE) &&	\
     defined(RUSAGE_CHILDREN) &&	\
     defined(RUSAGE_SELF) &&	\
@@ -87,6 +708,18 @@ static int stress_pipeherd(const stress_args_t *args)
 	double t1, t2;
 #endif
 
+	(void)stress_get_setting("pipeherd-bench", &pipeherd_bench);
+	if (pipeherd_bench) {
+#if defined(HAVE_PIPEHERD_BENCH)
+		return stress_pipeherd_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: pipeherd-bench is not supported on this system, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	(void)stress_get_setting("pipeherd-yield", &pipeherd_yield);
 
 	if (pipe(fd) < 0) {
@@ -208,6 +841,8 @@ static int stress_pipeherd(const stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_pipeherd_yield,	stress_set_pipeherd_yield },
+	{ OPT_pipeherd_bench,	stress_set_pipeherd_bench },
+	{ OPT_pipeherd_bench_max, stress_set_pipeherd_bench_max },
 	{ 0,                    NULL }
 };
 
@@ -17,6 +17,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
+#include "core-plugin.h"
 
 #if defined(HAVE_LINK_H)
 #include <link.h>
@@ -30,6 +32,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"plugin-ops N",	   "stop after N plugin bogo operations" },
 	{ NULL, "plugin-so file",  "specify plugin shared object file" },
 	{ NULL,	"plugin-method M", "set plugin stress method" },
+	{ NULL,	"plugin-batch N",  "ABI plugins run N bogo ops per run_batch call" },
 	{ NULL, NULL,		   NULL }
 };
 
@@ -38,14 +41,19 @@ static const stress_help_t help[] = {
 
 typedef int (*stress_plugin_func)(void);
 
+#define PLUGIN_BATCH_DEFAULT	(1024)
+#define PLUGIN_BATCH_MAX	(1000000)
+
 typedef struct {
 	const char *name;
-	stress_plugin_func func;
+	stress_plugin_func func;		/* legacy stress_*() function */
+	const stress_plugin_method_t *method;	/* ABI method, NULL if legacy */
 } stress_plugin_method_info_t;
 
 static stress_plugin_method_info_t *stress_plugin_methods;
 static size_t stress_plugin_methods_num;
 static void *stress_plugin_so;
+static bool stress_plugin_abi;		/* true if plugin uses the ABI */
 
 typedef struct {
 	const int signum;	/* Signal number */
@@ -97,6 +105,7 @@ static const sig_report_t sig_report[] = {
 #endif
 
 static uint64_t *sig_count;
+static uint64_t *abi_rc;	/* ABI child return code, shared after sig_count */
 
 static bool stress_plugin_report_signum(const int signum)
 {
@@ -130,6 +139,57 @@ static int stress_plugin_method_all(void)
 	return ret;
 }
 
+/*
+ *  stress_plugin_abi_load()
+ *	fetch the method table of a plugin that exports
+ *	stress_plugin_register()
+ */
+static int stress_plugin_abi_load(const char *opt, stress_plugin_register_func_t reg)
+{
+	const stress_plugin_t *plugin;
+	size_t i;
+
+	plugin = reg(STRESS_PLUGIN_ABI_VERSION);
+	if (!plugin) {
+		fprintf(stderr, "plugin-so: %s does not support plugin ABI version %d\n",
+			opt, STRESS_PLUGIN_ABI_VERSION);
+		return -1;
+	}
+	if ((plugin->abi_version == 0) || (plugin->abi_version > STRESS_PLUGIN_ABI_VERSION)) {
+		fprintf(stderr, "plugin-so: %s requires plugin ABI version %" PRIu32
+			", stress-ng supports up to version %d\n",
+			opt, plugin->abi_version, STRESS_PLUGIN_ABI_VERSION);
+		return -1;
+	}
+	if (!plugin->num_methods || !plugin->methods) {
+		fprintf(stderr, "plugin-so: %s registered no methods\n", opt);
+		return -1;
+	}
+	for (i = 0; i < plugin->num_methods; i++) {
+		if (!plugin->methods[i].name || !plugin->methods[i].run_batch) {
+			fprintf(stderr, "plugin-so: %s method %zu has no name or run_batch function\n",
+				opt, i);
+			return -1;
+		}
+	}
+
+	stress_plugin_methods = calloc(plugin->num_methods + 1, sizeof(*stress_plugin_methods));
+	if (!stress_plugin_methods) {
+		fprintf(stderr, "plugin-so: cannot allocate %" PRIu32 " plugin methods\n",
+			plugin->num_methods);
+		return -1;
+	}
+	stress_plugin_methods[0].name = "all";
+	for (i = 0; i < plugin->num_methods; i++) {
+		stress_plugin_methods[i + 1].name = plugin->methods[i].name;
+		stress_plugin_methods[i + 1].method = &plugin->methods[i];
+	}
+	stress_plugin_methods_num = plugin->num_methods + 1;
+	stress_plugin_abi = true;
+
+	return 0;
+}
+
 /*
  *  stress_set_plugin_so()
  *     set default plugin shared object file
@@ -142,9 +202,11 @@ static int stress_set_plugin_so(const char *opt)
 	char * strtab = NULL;
 	int symentries = 0;
 	size_t i, size, n_funcs;
+	stress_plugin_register_func_t reg;
 
 	stress_plugin_methods = NULL;
 	stress_plugin_methods_num = 0;
+	stress_plugin_abi = false;
 
 	stress_plugin_so = dlopen(opt, RTLD_LAZY | RTLD_GLOBAL);
 	if (!stress_plugin_so) {
@@ -152,6 +214,10 @@ static int stress_set_plugin_so(const char *opt)
 		return -1;
 	}
 
+	reg = (stress_plugin_register_func_t)dlsym(stress_plugin_so, STRESS_PLUGIN_REGISTER);
+	if (reg)
+		return stress_plugin_abi_load(opt, reg);
+
 	dlinfo(stress_plugin_so, RTLD_DI_LINKMAP, &map);
 
 	for (section = map->l_ld; section->d_tag != DT_NULL; ++section) {
@@ -261,6 +327,152 @@ static int stress_set_plugin_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_plugin_batch()
+ *	set the number of bogo ops per ABI plugin run_batch call
+ */
+static int stress_set_plugin_batch(const char *opt)
+{
+	uint32_t plugin_batch;
+
+	plugin_batch = stress_get_uint32(opt);
+	stress_check_range("plugin-batch", (uint64_t)plugin_batch, 1, PLUGIN_BATCH_MAX);
+	return stress_set_setting("plugin-batch", TYPE_ID_UINT32, &plugin_batch);
+}
+
+static bool stress_plugin_api_keep_stressing(const stress_plugin_api_t *api)
+{
+	return keep_stressing((const stress_args_t *)api->priv);
+}
+
+static uint64_t stress_plugin_api_now_ns(void)
+{
+	return stress_latency_now();
+}
+
+static void stress_plugin_api_latency(const stress_plugin_api_t *api, const uint64_t ns)
+{
+	const stress_args_t *args = (const stress_args_t *)api->priv;
+
+	stress_latency_record(args->latency, ns);
+}
+
+static void stress_plugin_api_misc_stats(
+	const stress_plugin_api_t *api,
+	const size_t idx,
+	const char *description,
+	const double value)
+{
+	const stress_args_t *args = (const stress_args_t *)api->priv;
+
+	if (description && (idx < STRESS_PLUGIN_MISC_STATS_MAX))
+		stress_misc_stats_set(args->misc_stats, idx, description, value);
+}
+
+static void stress_plugin_api_log(const stress_plugin_api_t *api, const char *fmt, ...)
+{
+	const stress_args_t *args = (const stress_args_t *)api->priv;
+	char buf[256];
+	size_t len;
+	va_list ap;
+
+	va_start(ap, fmt);
+	(void)vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	len = strlen(buf);
+	if (len && (buf[len - 1] == '\n'))
+		buf[len - 1] = '\0';
+	pr_inf("%s: %s\n", args->name, buf);
+}
+
+/*
+ *  stress_plugin_abi_run()
+ *	run ABI plugin method plugin_method, or all methods round
+ *	robin for method 0, in batches of plugin_batch bogo ops
+ */
+static int stress_plugin_abi_run(
+	const stress_args_t *args,
+	const size_t plugin_method,
+	const uint64_t plugin_batch)
+{
+	stress_plugin_api_t api;
+	void **ctxs;
+	const size_t first = plugin_method ? plugin_method : 1;
+	const size_t last = plugin_method ? plugin_method : stress_plugin_methods_num - 1;
+	size_t i, inited;
+	int rc = EXIT_SUCCESS;
+
+	(void)memset(&api, 0, sizeof(api));
+	api.abi_version = STRESS_PLUGIN_ABI_VERSION;
+	api.size = (uint32_t)sizeof(api);
+	api.name = args->name;
+	api.instance = args->instance;
+	api.instances = args->num_instances;
+	api.max_ops = args->max_ops;
+	api.keep_stressing = stress_plugin_api_keep_stressing;
+	api.now_ns = stress_plugin_api_now_ns;
+	api.latency = stress_plugin_api_latency;
+	api.misc_stats = stress_plugin_api_misc_stats;
+	api.log = stress_plugin_api_log;
+	api.priv = (void *)args;
+
+	ctxs = calloc(stress_plugin_methods_num, sizeof(*ctxs));
+	if (!ctxs) {
+		pr_inf("%s: cannot allocate plugin contexts\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (inited = first; inited <= last; inited++) {
+		const stress_plugin_method_t *method = stress_plugin_methods[inited].method;
+
+		if (method->init && (method->init(&api, &ctxs[inited]) != 0)) {
+			pr_fail("%s: plugin method '%s' init failed\n",
+				args->name, method->name);
+			rc = EXIT_FAILURE;
+			goto deinit;
+		}
+	}
+
+	do {
+		for (i = first; (i <= last) && keep_stressing(args); i++) {
+			const stress_plugin_method_t *method = stress_plugin_methods[i].method;
+			uint64_t batch = plugin_batch;
+			int64_t ops;
+
+			if (args->max_ops) {
+				const uint64_t counter = get_counter(args);
+
+				if (counter >= args->max_ops)
+					break;
+				if (batch > args->max_ops - counter)
+					batch = args->max_ops - counter;
+			}
+			ops = method->run_batch(&api, ctxs[i], batch);
+			if (ops < 0) {
+				pr_fail("%s: plugin method '%s' failed, returned %" PRId64 "\n",
+					args->name, method->name, ops);
+				rc = EXIT_FAILURE;
+				goto deinit;
+			}
+			add_counter(args, (uint64_t)ops);
+		}
+	} while (keep_stressing(args));
+
+deinit:
+	for (i = first; i < inited; i++) {
+		const stress_plugin_method_t *method = stress_plugin_methods[i].method;
+
+		if (method->deinit)
+			method->deinit(&api, ctxs[i]);
+	}
+	free(ctxs);
+
+	stress_latency_misc_stats(args, STRESS_PLUGIN_MISC_STATS_MAX, "plugin");
+
+	return rc;
+}
+
 /*
  *  stress_plugin
  *	stress with random plugins
@@ -270,8 +482,9 @@ static int stress_plugin(const stress_args_t *args)
 	int rc;
 	size_t i;
 	size_t plugin_method = 0;
+	uint32_t plugin_batch = PLUGIN_BATCH_DEFAULT;
 	stress_plugin_func func;
-	const size_t sig_count_size = MAX_SIGS * sizeof(*sig_count);
+	const size_t sig_count_size = (MAX_SIGS + 1) * sizeof(*sig_count);
 	bool report_sigs;
 
 	if (!stress_plugin_so) {
@@ -280,6 +493,7 @@ static int stress_plugin(const stress_args_t *args)
 	}
 
 	(void)stress_get_setting("plugin-method", &plugin_method);
+	(void)stress_get_setting("plugin-batch", &plugin_batch);
 	if (!stress_plugin_methods) {
 		pr_inf("%s: no plugin methods found, need to specify a valid shared library with --plug-so\n",
 			args->name);
@@ -301,10 +515,13 @@ static int stress_plugin(const stress_args_t *args)
 		(void)dlclose(stress_plugin_so);
 		return EXIT_NO_RESOURCE;
 	}
+	abi_rc = &sig_count[MAX_SIGS];
 
 	func = stress_plugin_methods[plugin_method].func;
 	if (args->instance == 0)
-		pr_dbg("%s: exercising plugin method '%s'\n", args->name, stress_plugin_methods[plugin_method].name);
+		pr_dbg("%s: exercising %splugin method '%s'\n", args->name,
+			stress_plugin_abi ? "ABI " : "",
+			stress_plugin_methods[plugin_method].name);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -334,6 +551,9 @@ again:
 				_exit(EXIT_NO_RESOURCE);
 			}
 			for (i = 0; i < SIZEOF_ARRAY(sig_report); i++) {
+				/* ABI plugins end gracefully on the alarm via keep_stressing */
+				if (stress_plugin_abi && !sig_report[i].report)
+					continue;
 				if (stress_sighandler(args->name, sig_report[i].signum, stress_sig_handler, NULL) < 0)
 					_exit(EXIT_FAILURE);
 			}
@@ -341,6 +561,12 @@ again:
 			/* Disable stack smashing messages */
 			stress_set_stack_smash_check_flag(false);
 
+			if (stress_plugin_abi) {
+				*abi_rc = (uint64_t)stress_plugin_abi_run(args, plugin_method,
+					(uint64_t)plugin_batch);
+				_exit(0);
+			}
+
 			do {
 				if (func())
 					break;
@@ -359,6 +585,10 @@ again:
 				(void)kill(pid, SIGTERM);
 				(void)kill(pid, SIGKILL);
 				(void)shim_waitpid(pid, &status, 0);
+			} else if (stress_plugin_abi && (*abi_rc != EXIT_SUCCESS)) {
+				/* init or run_batch failed, restarting won't help */
+				rc = (int)*abi_rc;
+				goto err;
 			}
 		}
 	} while (keep_stressing(args));
@@ -392,6 +622,7 @@ err:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_plugin_batch,	stress_set_plugin_batch },
 	{ OPT_plugin_method,	stress_set_plugin_method },
 	{ OPT_plugin_so,	stress_set_plugin_so },
 	{ 0,			NULL }
@@ -414,6 +645,7 @@ static int stress_set_plugin_ignored(const char *opt)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_plugin_batch,	stress_set_plugin_ignored },
 	{ OPT_plugin_method,	stress_set_plugin_ignored },
 	{ OPT_plugin_so,	stress_set_plugin_ignored },
 	{ 0,			NULL }
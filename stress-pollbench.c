@@ -0,0 +1,951 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "io-uring.h"
+#include "core-clock.h"
+
+#if defined(HAVE_SYS_SELECT_H)
+#include <sys/select.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
+
+#define MIN_POLLBENCH_FDS	(16)
+#define MAX_POLLBENCH_FDS	(1000000)
+#define DEFAULT_POLLBENCH_FDS	(16384)
+
+#define MIN_POLLBENCH_ACTIVE	(1)
+#define MAX_POLLBENCH_ACTIVE	(1024)
+#define DEFAULT_POLLBENCH_ACTIVE (8)
+
+static const stress_help_t help[] = {
+	{ NULL,	"pollbench N",		"start N workers benchmarking select, poll, epoll and io-uring readiness" },
+	{ NULL,	"pollbench-active N",	"number of fds that are made ready, default 8" },
+	{ NULL,	"pollbench-fds N",	"sweep 16, 128, 1024 .. N idle fds, default 16384" },
+	{ NULL,	"pollbench-method M",	"one of all, select, poll, epoll-lt, epoll-et, epoll-excl or io-uring" },
+	{ NULL,	"pollbench-ops N",	"stop after N readiness waits" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const pollbench_methods[] = {
+	"all",
+	"select",
+	"poll",
+	"epoll-lt",
+	"epoll-et",
+	"epoll-excl",
+	"io-uring",
+};
+
+#define POLLBENCH_METHODS	(SIZEOF_ARRAY(pollbench_methods))
+
+static int stress_set_pollbench_active(const char *opt)
+{
+	uint32_t pollbench_active;
+
+	pollbench_active = stress_get_uint32(opt);
+	stress_check_range("pollbench-active", (uint64_t)pollbench_active,
+		MIN_POLLBENCH_ACTIVE, MAX_POLLBENCH_ACTIVE);
+	return stress_set_setting("pollbench-active", TYPE_ID_UINT32, &pollbench_active);
+}
+
+static int stress_set_pollbench_fds(const char *opt)
+{
+	uint32_t pollbench_fds;
+
+	pollbench_fds = stress_get_uint32(opt);
+	stress_check_range("pollbench-fds", (uint64_t)pollbench_fds,
+		MIN_POLLBENCH_FDS, MAX_POLLBENCH_FDS);
+	return stress_set_setting("pollbench-fds", TYPE_ID_UINT32, &pollbench_fds);
+}
+
+static int stress_set_pollbench_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < POLLBENCH_METHODS; i++) {
+		if (!strcmp(opt, pollbench_methods[i]))
+			return stress_set_setting("pollbench-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "pollbench-method must be one of:");
+	for (i = 0; i < POLLBENCH_METHODS; i++)
+		(void)fprintf(stderr, " %s", pollbench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_pollbench_active,		stress_set_pollbench_active },
+	{ OPT_pollbench_fds,		stress_set_pollbench_fds },
+	{ OPT_pollbench_method,		stress_set_pollbench_method },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD) &&		\
+    defined(HAVE_POLL_H)
+
+#define POLLBENCH_SELECT	(1)
+#define POLLBENCH_POLL		(2)
+#define POLLBENCH_EPOLL_LT	(3)
+#define POLLBENCH_EPOLL_ET	(4)
+#define POLLBENCH_EPOLL_EXCL	(5)
+#define POLLBENCH_IO_URING	(6)
+
+#define POLLBENCH_STEPS		(8)		/* 16, 128, 1024 .. N idle fds */
+#define POLLBENCH_PHASE		(0.1)		/* seconds per measurement */
+#define POLLBENCH_TIMEOUT_MS	(100)		/* blocking wait timeout */
+
+#if defined(HAVE_SYS_SELECT_H) &&	\
+    defined(HAVE_SELECT)
+#define HAVE_POLLBENCH_SELECT
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+#define HAVE_POLLBENCH_EPOLL
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_uring_enter) &&	\
+    defined(__NR_io_uring_setup) &&	\
+    defined(IORING_OFF_SQ_RING) &&	\
+    defined(IORING_OFF_CQ_RING) &&	\
+    defined(IORING_OFF_SQES) &&		\
+    defined(IORING_POLL_ADD_MULTI) &&	\
+    defined(HAVE_IORING_OP_POLL_ADD)
+#define HAVE_POLLBENCH_IO_URING
+#define POLLBENCH_URING_ENTRIES	(4096)
+
+/* io-uring rings, a minimal version of the io-uring stressor rings */
+typedef struct {
+	int fd;				/* io-uring fd, -1 = not set up */
+	unsigned *sq_head;		/* submission queue */
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned sq_entries;
+	unsigned sq_pending;		/* sqes not yet submitted */
+	unsigned *cq_head;		/* completion queue */
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+	struct io_uring_sqe *sqes;
+	void *sq_mmap;
+	void *cq_mmap;
+	size_t sq_size;
+	size_t cq_size;
+	size_t sqes_size;
+} stress_pollbench_uring_t;
+#endif
+
+/* readiness benchmark state of one method and idle fd count */
+typedef struct {
+	int *fds;			/* waited on fds, idle then active */
+	size_t n_fds;			/* number of waited on fds */
+	size_t n_active;		/* active fds, the last n_active fds */
+	int max_fd;			/* highest fd number */
+	size_t method;			/* POLLBENCH_* */
+	struct pollfd *pollfds;		/* poll array */
+#if defined(HAVE_POLLBENCH_EPOLL)
+	int epfd;			/* epoll fd */
+	struct epoll_event *events;	/* epoll_wait events */
+#endif
+#if defined(HAVE_POLLBENCH_IO_URING)
+	stress_pollbench_uring_t uring;	/* io-uring rings */
+#endif
+	/* shared with the writer thread, accessed with __atomic */
+	uint64_t t_write;		/* ns time of the last ready write */
+	bool armed;			/* waiter is about to block */
+	bool stop;			/* writer thread must stop */
+	int err;			/* errno of a failed wait */
+} stress_pollbench_t;
+
+typedef struct {
+	size_t n_idle;			/* idle fds */
+	uint64_t waits;			/* wait calls in the throughput phase */
+	uint64_t events;		/* ready events in the throughput phase */
+	double wall;			/* throughput phase time */
+	uint64_t wakeups;		/* latency phase wakeups */
+	uint64_t latency_ns;		/* sum of wakeup latencies */
+	uint64_t latency_max_ns;	/* slowest wakeup */
+} stress_pollbench_stats_t;
+
+/*
+ *  stress_pollbench_clear()
+ *	consume the eventfd count of a ready fd
+ */
+static inline void stress_pollbench_clear(const int fd)
+{
+	uint64_t val;
+
+	VOID_RET(ssize_t, read(fd, &val, sizeof(val)));
+}
+
+/*
+ *  stress_pollbench_ready()
+ *	make an fd ready for reading
+ */
+static inline void stress_pollbench_ready(const int fd)
+{
+	const uint64_t val = 1;
+
+	VOID_RET(ssize_t, write(fd, &val, sizeof(val)));
+}
+
+#if defined(HAVE_POLLBENCH_SELECT)
+/*
+ *  stress_pollbench_select_wait()
+ *	select rebuilds the fd set on each call and scans it
+ *	for the ready fds, both O(N) in the user and the kernel
+ */
+static int stress_pollbench_select_wait(stress_pollbench_t *pb, const int timeout_ms)
+{
+	fd_set rfds;
+	struct timeval tv;
+	size_t i;
+	int ret, found = 0;
+
+	FD_ZERO(&rfds);
+	for (i = 0; i < pb->n_fds; i++)
+		FD_SET(pb->fds[i], &rfds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	ret = select(pb->max_fd + 1, &rfds, NULL, NULL, &tv);
+	if (ret < 0) {
+		if (errno == EINTR)
+			return 0;
+		pb->err = errno;
+		return -1;
+	}
+	for (i = 0; (i < pb->n_fds) && (found < ret); i++) {
+		if (FD_ISSET(pb->fds[i], &rfds)) {
+			stress_pollbench_clear(pb->fds[i]);
+			found++;
+		}
+	}
+	return found;
+}
+#endif
+
+/*
+ *  stress_pollbench_poll_wait()
+ *	poll the array and scan it for the ready fds
+ */
+static int stress_pollbench_poll_wait(stress_pollbench_t *pb, const int timeout_ms)
+{
+	size_t i;
+	int ret, found = 0;
+
+	ret = poll(pb->pollfds, (nfds_t)pb->n_fds, timeout_ms);
+	if (ret < 0) {
+		if (errno == EINTR)
+			return 0;
+		pb->err = errno;
+		return -1;
+	}
+	for (i = 0; (i < pb->n_fds) && (found < ret); i++) {
+		if (pb->pollfds[i].revents & POLLIN) {
+			stress_pollbench_clear(pb->pollfds[i].fd);
+			found++;
+		}
+	}
+	return found;
+}
+
+#if defined(HAVE_POLLBENCH_EPOLL)
+/*
+ *  stress_pollbench_epoll_open()
+ *	add the fds to an epoll instance, O(N) once per step
+ */
+static int stress_pollbench_epoll_open(stress_pollbench_t *pb)
+{
+	uint32_t events = EPOLLIN;
+	size_t i;
+
+	if (pb->method == POLLBENCH_EPOLL_ET)
+		events |= EPOLLET;
+	if (pb->method == POLLBENCH_EPOLL_EXCL) {
+#if defined(EPOLLEXCLUSIVE)
+		events |= EPOLLEXCLUSIVE;
+#else
+		return -1;
+#endif
+	}
+
+	pb->epfd = epoll_create1(0);
+	if (pb->epfd < 0)
+		return -1;
+	for (i = 0; i < pb->n_fds; i++) {
+		struct epoll_event ev;
+
+		(void)memset(&ev, 0, sizeof(ev));
+		ev.events = events;
+		ev.data.fd = pb->fds[i];
+		if (epoll_ctl(pb->epfd, EPOLL_CTL_ADD, pb->fds[i], &ev) < 0) {
+			(void)close(pb->epfd);
+			pb->epfd = -1;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_pollbench_epoll_wait()
+ *	only the ready fds are returned, O(ready)
+ */
+static int stress_pollbench_epoll_wait(stress_pollbench_t *pb, const int timeout_ms)
+{
+	int i, ret;
+
+	ret = epoll_wait(pb->epfd, pb->events, (int)pb->n_active, timeout_ms);
+	if (ret < 0) {
+		if (errno == EINTR)
+			return 0;
+		pb->err = errno;
+		return -1;
+	}
+	for (i = 0; i < ret; i++)
+		stress_pollbench_clear(pb->events[i].data.fd);
+	return ret;
+}
+
+static void stress_pollbench_epoll_close(stress_pollbench_t *pb)
+{
+	if (pb->epfd >= 0) {
+		(void)close(pb->epfd);
+		pb->epfd = -1;
+	}
+}
+#endif
+
+#if defined(HAVE_POLLBENCH_IO_URING)
+static int shim_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int shim_io_uring_enter(
+	int fd,
+	unsigned int to_submit,
+	unsigned int min_complete,
+	unsigned int flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+		min_complete, flags, NULL, 0);
+}
+
+#define VOID_ADDR_OFFSET(addr, offset)	\
+	((void *)(((uint8_t *)addr) + offset))
+
+/*
+ *  stress_pollbench_uring_close()
+ *	tear down the rings, this cancels the armed polls
+ */
+static void stress_pollbench_uring_close(stress_pollbench_t *pb)
+{
+	stress_pollbench_uring_t *ur = &pb->uring;
+
+	if (ur->sqes)
+		(void)munmap((void *)ur->sqes, ur->sqes_size);
+	if (ur->cq_mmap && (ur->cq_mmap != ur->sq_mmap))
+		(void)munmap(ur->cq_mmap, ur->cq_size);
+	if (ur->sq_mmap)
+		(void)munmap(ur->sq_mmap, ur->sq_size);
+	if (ur->fd >= 0)
+		(void)close(ur->fd);
+	(void)memset(ur, 0, sizeof(*ur));
+	ur->fd = -1;
+}
+
+/*
+ *  stress_pollbench_uring_submit()
+ *	submit the pending sqes
+ */
+static int stress_pollbench_uring_submit(stress_pollbench_uring_t *ur)
+{
+	while (ur->sq_pending) {
+		const int ret = shim_io_uring_enter(ur->fd, ur->sq_pending, 0, 0);
+
+		if (ret < 0)
+			return -1;
+		ur->sq_pending -= (unsigned)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_pollbench_uring_arm()
+ *	queue a multishot POLL_ADD of fds[idx], a completion is
+ *	posted each time the fd becomes readable
+ */
+static int stress_pollbench_uring_arm(stress_pollbench_t *pb, const size_t idx)
+{
+	stress_pollbench_uring_t *ur = &pb->uring;
+	struct io_uring_sqe *sqe;
+	unsigned tail, index;
+	uint32_t events = POLLIN;
+
+	if ((ur->sq_pending >= ur->sq_entries) &&
+	    (stress_pollbench_uring_submit(ur) < 0))
+		return -1;
+
+	tail = *ur->sq_tail;
+	index = tail & *ur->sq_mask;
+	sqe = &ur->sqes[index];
+	(void)memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = pb->fds[idx];
+#if defined(__BYTE_ORDER__) &&	\
+    (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	events = (events << 16) | (events >> 16);
+#endif
+	sqe->poll32_events = events;
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = (uint64_t)idx;
+	ur->sq_array[index] = index;
+	__atomic_store_n(ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ur->sq_pending++;
+	return 0;
+}
+
+/*
+ *  stress_pollbench_uring_reap()
+ *	consume the completions, re-arming any poll that the
+ *	kernel ended, returns the number of ready fds
+ */
+static int stress_pollbench_uring_reap(stress_pollbench_t *pb)
+{
+	stress_pollbench_uring_t *ur = &pb->uring;
+	unsigned head = *ur->cq_head;
+	int found = 0;
+
+	while (head != __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE)) {
+		const struct io_uring_cqe *cqe = &ur->cqes[head & *ur->cq_mask];
+		const size_t idx = (size_t)cqe->user_data;
+
+		head++;
+		if (cqe->res < 0) {
+			pb->err = -cqe->res;
+			__atomic_store_n(ur->cq_head, head, __ATOMIC_RELEASE);
+			return -1;
+		}
+		if (idx >= pb->n_fds)
+			continue;
+		if (cqe->res & POLLIN) {
+			stress_pollbench_clear(pb->fds[idx]);
+			found++;
+		}
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			(void)stress_pollbench_uring_arm(pb, idx);
+	}
+	__atomic_store_n(ur->cq_head, head, __ATOMIC_RELEASE);
+	if (stress_pollbench_uring_submit(ur) < 0) {
+		pb->err = errno;
+		return -1;
+	}
+	return found;
+}
+
+/*
+ *  stress_pollbench_uring_open()
+ *	set up the rings and arm a multishot poll on every fd
+ */
+static int stress_pollbench_uring_open(stress_pollbench_t *pb)
+{
+	stress_pollbench_uring_t *ur = &pb->uring;
+	struct io_uring_params p;
+	size_t i;
+
+	(void)memset(ur, 0, sizeof(*ur));
+	(void)memset(&p, 0, sizeof(p));
+	ur->fd = shim_io_uring_setup(POLLBENCH_URING_ENTRIES, &p);
+	if (ur->fd < 0)
+		return -1;
+
+	ur->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ur->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ur->cq_size > ur->sq_size)
+			ur->sq_size = ur->cq_size;
+		ur->cq_size = ur->sq_size;
+	}
+	ur->sq_mmap = mmap(NULL, ur->sq_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_SQ_RING);
+	if (ur->sq_mmap == MAP_FAILED) {
+		ur->sq_mmap = NULL;
+		goto fail;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ur->cq_mmap = ur->sq_mmap;
+	} else {
+		ur->cq_mmap = mmap(NULL, ur->cq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_CQ_RING);
+		if (ur->cq_mmap == MAP_FAILED) {
+			ur->cq_mmap = NULL;
+			goto fail;
+		}
+	}
+	ur->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	ur->sqes = (struct io_uring_sqe *)mmap(NULL, ur->sqes_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		ur->fd, IORING_OFF_SQES);
+	if (ur->sqes == MAP_FAILED) {
+		ur->sqes = NULL;
+		goto fail;
+	}
+
+	ur->sq_head = VOID_ADDR_OFFSET(ur->sq_mmap, p.sq_off.head);
+	ur->sq_tail = VOID_ADDR_OFFSET(ur->sq_mmap, p.sq_off.tail);
+	ur->sq_mask = VOID_ADDR_OFFSET(ur->sq_mmap, p.sq_off.ring_mask);
+	ur->sq_array = VOID_ADDR_OFFSET(ur->sq_mmap, p.sq_off.array);
+	ur->sq_entries = p.sq_entries;
+	ur->cq_head = VOID_ADDR_OFFSET(ur->cq_mmap, p.cq_off.head);
+	ur->cq_tail = VOID_ADDR_OFFSET(ur->cq_mmap, p.cq_off.tail);
+	ur->cq_mask = VOID_ADDR_OFFSET(ur->cq_mmap, p.cq_off.ring_mask);
+	ur->cqes = VOID_ADDR_OFFSET(ur->cq_mmap, p.cq_off.cqes);
+
+	for (i = 0; i < pb->n_fds; i++) {
+		if (stress_pollbench_uring_arm(pb, i) < 0)
+			goto fail;
+	}
+	if (stress_pollbench_uring_submit(ur) < 0)
+		goto fail;
+	/* polls the kernel rejects complete straight away with an error */
+	if (stress_pollbench_uring_reap(pb) < 0) {
+		errno = pb->err;
+		goto fail;
+	}
+	return 0;
+
+fail:
+	pb->err = errno;
+	stress_pollbench_uring_close(pb);
+	errno = pb->err;
+	return -1;
+}
+
+/*
+ *  stress_pollbench_uring_wait()
+ *	block until at least one completion is posted
+ */
+static int stress_pollbench_uring_wait(stress_pollbench_t *pb, const int timeout_ms)
+{
+	stress_pollbench_uring_t *ur = &pb->uring;
+	int found;
+
+	(void)timeout_ms;
+
+	found = stress_pollbench_uring_reap(pb);
+	if (found != 0)
+		return found;
+	if (shim_io_uring_enter(ur->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+		if (errno == EINTR)
+			return 0;
+		pb->err = errno;
+		return -1;
+	}
+	return stress_pollbench_uring_reap(pb);
+}
+#endif
+
+/*
+ *  stress_pollbench_open()
+ *	set up the method for the fds of a step, -1 if the
+ *	method cannot be used
+ */
+static int stress_pollbench_open(stress_pollbench_t *pb)
+{
+	size_t i;
+
+	pb->err = 0;
+	switch (pb->method) {
+	case POLLBENCH_SELECT:
+#if defined(HAVE_POLLBENCH_SELECT)
+		return (pb->max_fd < FD_SETSIZE) ? 0 : -1;
+#else
+		return -1;
+#endif
+	case POLLBENCH_POLL:
+		for (i = 0; i < pb->n_fds; i++) {
+			pb->pollfds[i].fd = pb->fds[i];
+			pb->pollfds[i].events = POLLIN;
+			pb->pollfds[i].revents = 0;
+		}
+		return 0;
+	case POLLBENCH_EPOLL_LT:
+	case POLLBENCH_EPOLL_ET:
+	case POLLBENCH_EPOLL_EXCL:
+#if defined(HAVE_POLLBENCH_EPOLL)
+		return stress_pollbench_epoll_open(pb);
+#else
+		return -1;
+#endif
+	case POLLBENCH_IO_URING:
+#if defined(HAVE_POLLBENCH_IO_URING)
+		return stress_pollbench_uring_open(pb);
+#else
+		return -1;
+#endif
+	default:
+		return -1;
+	}
+}
+
+/*
+ *  stress_pollbench_wait()
+ *	wait for and clear ready fds, returns the number of
+ *	ready fds or -1 on error
+ */
+static int stress_pollbench_wait(stress_pollbench_t *pb, const int timeout_ms)
+{
+	switch (pb->method) {
+#if defined(HAVE_POLLBENCH_SELECT)
+	case POLLBENCH_SELECT:
+		return stress_pollbench_select_wait(pb, timeout_ms);
+#endif
+	case POLLBENCH_POLL:
+		return stress_pollbench_poll_wait(pb, timeout_ms);
+#if defined(HAVE_POLLBENCH_EPOLL)
+	case POLLBENCH_EPOLL_LT:
+	case POLLBENCH_EPOLL_ET:
+	case POLLBENCH_EPOLL_EXCL:
+		return stress_pollbench_epoll_wait(pb, timeout_ms);
+#endif
+#if defined(HAVE_POLLBENCH_IO_URING)
+	case POLLBENCH_IO_URING:
+		return stress_pollbench_uring_wait(pb, timeout_ms);
+#endif
+	default:
+		pb->err = ENOSYS;
+		return -1;
+	}
+}
+
+static void stress_pollbench_close(stress_pollbench_t *pb)
+{
+#if defined(HAVE_POLLBENCH_EPOLL)
+	stress_pollbench_epoll_close(pb);
+#endif
+#if defined(HAVE_POLLBENCH_IO_URING)
+	stress_pollbench_uring_close(pb);
+#endif
+}
+
+/*
+ *  stress_pollbench_writer()
+ *	make one active fd ready each time the waiter is about
+ *	to block, timestamping the write for the wakeup latency
+ */
+static void *stress_pollbench_writer(void *arg)
+{
+	static void *nowt = NULL;
+	stress_pollbench_t *pb = (stress_pollbench_t *)arg;
+	size_t i = 0;
+
+	while (!__atomic_load_n(&pb->stop, __ATOMIC_ACQUIRE)) {
+		const int fd = pb->fds[pb->n_fds - pb->n_active + (i % pb->n_active)];
+
+		if (!__atomic_load_n(&pb->armed, __ATOMIC_ACQUIRE)) {
+			(void)shim_sched_yield();
+			continue;
+		}
+		__atomic_store_n(&pb->armed, false, __ATOMIC_RELEASE);
+		/* give the waiter time to block */
+		(void)shim_nanosleep_uint64(20000);
+		__atomic_store_n(&pb->t_write, stress_clock_ns(), __ATOMIC_RELEASE);
+		stress_pollbench_ready(fd);
+		i++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_pollbench_step()
+ *	measure the events/sec with all the active fds made ready
+ *	before each wait, then the wakeup latency of a waiter
+ *	blocked on the fds as a thread makes one of them ready
+ */
+static int stress_pollbench_step(
+	const stress_args_t *args,
+	stress_pollbench_t *pb,
+	stress_pollbench_stats_t *stats)
+{
+	pthread_t pthread;
+	double t_start, t_end;
+	size_t i;
+	int ret = 0;
+
+	t_start = stress_time_now();
+	t_end = t_start + POLLBENCH_PHASE;
+	do {
+		int events = 0;
+
+		for (i = pb->n_fds - pb->n_active; i < pb->n_fds; i++)
+			stress_pollbench_ready(pb->fds[i]);
+		while (events < (int)pb->n_active) {
+			ret = stress_pollbench_wait(pb, POLLBENCH_TIMEOUT_MS);
+			if (ret < 0)
+				return -1;
+			if (ret == 0)
+				break;
+			events += ret;
+			stats->waits++;
+			inc_counter(args);
+		}
+		stats->events += (uint64_t)events;
+	} while (keep_stressing(args) && (stress_time_now() < t_end));
+	stats->wall += stress_time_now() - t_start;
+
+	__atomic_store_n(&pb->armed, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&pb->stop, false, __ATOMIC_RELEASE);
+	if (pthread_create(&pthread, NULL, stress_pollbench_writer, (void *)pb) != 0)
+		return 0;
+	t_end = stress_time_now() + POLLBENCH_PHASE;
+	while (keep_stressing(args) && (stress_time_now() < t_end)) {
+		uint64_t latency;
+
+		__atomic_store_n(&pb->armed, true, __ATOMIC_RELEASE);
+		ret = stress_pollbench_wait(pb, POLLBENCH_TIMEOUT_MS);
+		if (ret < 0)
+			break;
+		if (ret == 0)
+			continue;
+		latency = stress_clock_ns() - __atomic_load_n(&pb->t_write, __ATOMIC_ACQUIRE);
+		stats->wakeups++;
+		stats->latency_ns += latency;
+		if (latency > stats->latency_max_ns)
+			stats->latency_max_ns = latency;
+		inc_counter(args);
+	}
+	__atomic_store_n(&pb->stop, true, __ATOMIC_RELEASE);
+	(void)pthread_join(pthread, NULL);
+
+	/* drain a last write that raced with the stop */
+	for (i = pb->n_fds - pb->n_active; i < pb->n_fds; i++)
+		stress_pollbench_clear(pb->fds[i]);
+	return (ret < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_pollbench()
+ *	benchmark readiness notification over select, poll, epoll
+ *	and io-uring as the number of idle fds grows
+ */
+static int stress_pollbench(const stress_args_t *args)
+{
+	static stress_pollbench_stats_t stats[POLLBENCH_METHODS][POLLBENCH_STEPS];
+	stress_pollbench_t pb;
+	uint32_t pollbench_fds = DEFAULT_POLLBENCH_FDS;
+	uint32_t pollbench_active = DEFAULT_POLLBENCH_ACTIVE;
+	size_t pollbench_method = 0, max_fds, n_fds, n_steps = 0, i, m, s, idx = 0;
+	size_t steps[POLLBENCH_STEPS];
+	bool skipped[POLLBENCH_METHODS];
+	int *all_fds, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("pollbench-method", &pollbench_method);
+	(void)stress_get_setting("pollbench-active", &pollbench_active);
+	if (!stress_get_setting("pollbench-fds", &pollbench_fds)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			pollbench_fds = 100000;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			pollbench_fds = MIN_POLLBENCH_FDS;
+	}
+
+	/* leave some fds spare for the rest of stress-ng */
+	max_fds = stress_get_max_file_limit();
+	if (max_fds < (size_t)pollbench_active + MIN_POLLBENCH_FDS + 64) {
+		pr_inf_skip("%s: file descriptor limit of %zu is too low, skipping stressor\n",
+			args->name, max_fds);
+		return EXIT_NO_RESOURCE;
+	}
+	max_fds -= (size_t)pollbench_active + 64;
+	if (pollbench_fds > max_fds) {
+		if (args->instance == 0)
+			pr_inf("%s: limiting idle fds to %zu, the file descriptor limit\n",
+				args->name, max_fds);
+		pollbench_fds = (uint32_t)max_fds;
+	}
+	for (s = MIN_POLLBENCH_FDS; (s < pollbench_fds) && (n_steps < POLLBENCH_STEPS - 1); s <<= 3)
+		steps[n_steps++] = s;
+	steps[n_steps++] = pollbench_fds;
+
+	/* active fds are opened first so they have the lowest fd numbers */
+	n_fds = (size_t)pollbench_active + pollbench_fds;
+	(void)memset(&pb, 0, sizeof(pb));
+	all_fds = (int *)calloc(n_fds, sizeof(*all_fds));
+	pb.fds = (int *)calloc(n_fds, sizeof(*pb.fds));
+	pb.pollfds = (struct pollfd *)calloc(n_fds, sizeof(*pb.pollfds));
+#if defined(HAVE_POLLBENCH_EPOLL)
+	pb.epfd = -1;
+	pb.events = (struct epoll_event *)calloc(pollbench_active, sizeof(*pb.events));
+	if (!pb.events) {
+		pr_inf_skip("%s: cannot allocate epoll events, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_fds;
+	}
+#endif
+#if defined(HAVE_POLLBENCH_IO_URING)
+	pb.uring.fd = -1;
+#endif
+	if (!all_fds || !pb.fds || !pb.pollfds) {
+		pr_inf_skip("%s: cannot allocate %zu fd slots, skipping stressor\n",
+			args->name, n_fds);
+		rc = EXIT_NO_RESOURCE;
+		goto free_fds;
+	}
+	for (i = 0; i < n_fds; i++)
+		all_fds[i] = -1;
+	for (i = 0; i < n_fds; i++) {
+		all_fds[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (all_fds[i] < 0) {
+			pr_inf_skip("%s: cannot create eventfd %zu of %zu, errno=%d (%s), "
+				"skipping stressor\n", args->name, i, n_fds,
+				errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_fds;
+		}
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(skipped, 0, sizeof(skipped));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 1; (m < POLLBENCH_METHODS) && keep_stressing(args); m++) {
+			if ((pollbench_method && (pollbench_method != m)) || skipped[m])
+				continue;
+			pb.method = m;
+			for (s = 0; (s < n_steps) && keep_stressing(args); s++) {
+				const size_t n_idle = steps[s];
+
+				/* idle fds first, then the active ones */
+				(void)memcpy(pb.fds, all_fds + pollbench_active, n_idle * sizeof(*pb.fds));
+				(void)memcpy(pb.fds + n_idle, all_fds, pollbench_active * sizeof(*pb.fds));
+				pb.n_fds = n_idle + pollbench_active;
+				pb.n_active = pollbench_active;
+				pb.max_fd = all_fds[pollbench_active + n_idle - 1];
+
+				if (stress_pollbench_open(&pb) < 0) {
+					/* select runs out of fd_set bits, others fail outright */
+					if ((m != POLLBENCH_SELECT) || (s == 0)) {
+						if (args->instance == 0)
+							pr_inf("%s: %s skipped, errno=%d (%s)\n",
+								args->name, pollbench_methods[m],
+								errno, strerror(errno));
+						skipped[m] = true;
+					}
+					break;
+				}
+				stats[m][s].n_idle = n_idle;
+				if (stress_pollbench_step(args, &pb, &stats[m][s]) < 0) {
+					pr_fail("%s: %s wait failed, errno=%d (%s)\n",
+						args->name, pollbench_methods[m],
+						pb.err, strerror(pb.err));
+					rc = EXIT_FAILURE;
+				}
+				stress_pollbench_close(&pb);
+				if (rc != EXIT_SUCCESS)
+					goto report;
+			}
+		}
+	} while (keep_stressing(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (args->instance == 0)
+		pr_inf("%s: %-10s %8s %12s %10s %12s %12s\n", args->name,
+			"method", "idle fds", "events/sec", "ns/wait",
+			"wakeup ns", "max wake ns");
+	for (m = 1; m < POLLBENCH_METHODS; m++) {
+		double rate = 0.0;
+		size_t n_idle = 0;
+
+		for (s = 0; s < n_steps; s++) {
+			const stress_pollbench_stats_t *st = &stats[m][s];
+			double ns_wait, wakeup_ns;
+
+			if (!st->waits || (st->wall <= 0.0))
+				continue;
+			rate = (double)st->events / st->wall;
+			n_idle = st->n_idle;
+			ns_wait = (double)STRESS_NANOSECOND * st->wall / (double)st->waits;
+			wakeup_ns = st->wakeups ? (double)st->latency_ns / (double)st->wakeups : 0.0;
+			if (args->instance == 0)
+				pr_inf("%s: %-10s %8zu %12.0f %10.0f %12.0f %12" PRIu64 "\n",
+					args->name, pollbench_methods[m], st->n_idle,
+					rate, ns_wait, wakeup_ns, st->latency_max_ns);
+		}
+		if (rate > 0.0) {
+			char desc[40];
+
+			(void)snprintf(desc, sizeof(desc), "%s events/s %zu fds",
+				pollbench_methods[m], n_idle);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, rate);
+		}
+	}
+
+close_fds:
+	for (i = 0; i < n_fds; i++) {
+		if (all_fds[i] >= 0)
+			(void)close(all_fds[i]);
+	}
+free_fds:
+#if defined(HAVE_POLLBENCH_EPOLL)
+	free(pb.events);
+#endif
+	free(pb.pollfds);
+	free(pb.fds);
+	free(all_fds);
+
+	return rc;
+}
+
+stressor_info_t stress_pollbench_info = {
+	.stressor = stress_pollbench,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_pollbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
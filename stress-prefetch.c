@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-cache.h"
+#include "core-cpu.h"
 #include "core-put.h"
 
 #define MIN_PREFETCH_L3_SIZE      (4 * KB)
@@ -28,11 +29,25 @@
 #define STRESS_PREFETCH_OFFSETS	(128)
 #define STRESS_CACHE_LINE_SIZE	(64)
 
+#define PREFETCH_SWEEP_PATTERNS	(3)	/* sequential, strided, indirect */
+#define PREFETCH_SWEEP_HINTS	(4)	/* locality 3..0 */
+#define PREFETCH_SWEEP_DISTS	(8)	/* 1..128 accesses ahead */
+#define PREFETCH_SWEEP_DIST_MAX	(128)
+#define PREFETCH_SWEEP_STRIDE	(4)	/* cache lines between strided accesses */
+#define PREFETCH_SWEEP_HWPF	(2)	/* hardware prefetchers on, off */
+#define PREFETCH_SWEEP_SCALE	(4)	/* sweep buffer is 4 x L3 size */
+#define PREFETCH_SWEEP_MAX	(256 * MB)	/* up to 256 MB */
+
+/* Intel MISC_FEATURE_CONTROL, bits 0..3 disable the L2, L2 adjacent, DCU and DCU IP prefetchers */
+#define PREFETCH_MSR_MISC_FEATURE_CONTROL	(0x1a4)
+#define PREFETCH_MSR_HWPF_DISABLE		(0xfULL)
 
 static const stress_help_t help[] = {
 	{ NULL,	"prefetch N" ,		"start N workers exercising memory prefetching " },
 	{ NULL,	"prefetch-ops N",	"stop after N bogo prefetching operations" },
 	{ NULL,	"prefetch-l3-size N",	"specify the L3 cache size of the CPU" },
+	{ NULL,	"prefetch-sweep",	"sweep prefetch hint and distance for sequential, strided and indirect reads" },
+	{ NULL,	"prefetch-sweep-hwpf",	"also sweep with the hardware prefetchers disabled (Intel, needs msr)" },
 	{ NULL,	NULL,                   NULL }
 };
 
@@ -57,6 +72,16 @@ static int stress_set_prefetch_L3_size(const char *opt)
 	return stress_set_setting("stream-L3-size", TYPE_ID_SIZE_T, &sz);
 }
 
+static int stress_set_prefetch_sweep(const char *opt)
+{
+	return stress_set_setting_true("prefetch-sweep", opt);
+}
+
+static int stress_set_prefetch_sweep_hwpf(const char *opt)
+{
+	return stress_set_setting_true("prefetch-sweep-hwpf", opt);
+}
+
 static inline uint64_t get_prefetch_L3_size(const stress_args_t *args)
 {
 	uint64_t cache_size = DEFAULT_PREFETCH_L3_SIZE;
@@ -184,6 +209,435 @@ static inline void OPTIMIZE3 stress_prefetch_benchmark(
 	(*total_count)++;
 }
 
+static const char * const prefetch_sweep_patterns[PREFETCH_SWEEP_PATTERNS] = {
+	"sequential", "strided", "indirect"
+};
+
+/* hint names for locality 3, 2, 1 and 0 */
+static const char * const prefetch_sweep_hints[PREFETCH_SWEEP_HINTS] = {
+#if defined(STRESS_ARCH_X86)
+	"t0", "t1", "t2", "nta"
+#elif defined(__aarch64__)
+	"pldl1keep", "pldl2keep", "pldl3keep", "pldl1strm"
+#else
+	"locality3", "locality2", "locality1", "locality0"
+#endif
+};
+
+static const char * const prefetch_sweep_hwpf[PREFETCH_SWEEP_HWPF] = {
+	"hw prefetch on", "hw prefetch off"
+};
+
+/* bytes read and read time, [hwpf][pattern][hint][dist], dist 0 is no prefetch */
+typedef struct {
+	double bytes[PREFETCH_SWEEP_HWPF][PREFETCH_SWEEP_PATTERNS][PREFETCH_SWEEP_HINTS][PREFETCH_SWEEP_DISTS + 1];
+	double secs[PREFETCH_SWEEP_HWPF][PREFETCH_SWEEP_PATTERNS][PREFETCH_SWEEP_HINTS][PREFETCH_SWEEP_DISTS + 1];
+} stress_prefetch_sweep_t;
+
+typedef uint64_t (*stress_prefetch_sweep_func)(const uint64_t *data, const uint32_t *idx,
+	const size_t lines, const size_t dist);
+
+/*
+ *  Sweep read loops, the hint must be a compile time constant so each
+ *  hint gets its own set of loops. Sequential reads all the words of
+ *  each cache line, strided and indirect read one word per line, the
+ *  prefetch is dist accesses ahead. The buffers are padded so the
+ *  prefetches stay inside the mapping.
+ */
+#define STRESS_PREFETCH_SWEEP(name, locality)				\
+static uint64_t OPTIMIZE3 stress_prefetch_sweep_seq_ ## name(		\
+	const uint64_t *data,						\
+	const uint32_t *idx,						\
+	const size_t lines,						\
+	const size_t dist)						\
+{									\
+	register uint64_t sum = 0;					\
+	register size_t i;						\
+									\
+	(void)idx;							\
+	for (i = 0; i < lines; i++) {					\
+		const uint64_t *p = data + (i * 8);			\
+									\
+		if (locality >= 0)					\
+			shim_builtin_prefetch(p + (dist * 8), 0, 		\
+				locality >= 0 ? locality : 0);		\
+		sum += p[0] + p[1] + p[2] + p[3] +			\
+		       p[4] + p[5] + p[6] + p[7];			\
+	}								\
+	return sum;							\
+}									\
+									\
+static uint64_t OPTIMIZE3 stress_prefetch_sweep_stride_ ## name(	\
+	const uint64_t *data,						\
+	const uint32_t *idx,						\
+	const size_t lines,						\
+	const size_t dist)						\
+{									\
+	register uint64_t sum = 0;					\
+	register size_t i;						\
+									\
+	(void)idx;							\
+	for (i = 0; i < lines; i += PREFETCH_SWEEP_STRIDE) {		\
+		const uint64_t *p = data + (i * 8);			\
+									\
+		if (locality >= 0)					\
+			shim_builtin_prefetch(p + (dist * 8 * PREFETCH_SWEEP_STRIDE), \
+				0, locality >= 0 ? locality : 0);	\
+		sum += *p;						\
+	}								\
+	return sum;							\
+}									\
+									\
+static uint64_t OPTIMIZE3 stress_prefetch_sweep_indirect_ ## name(	\
+	const uint64_t *data,						\
+	const uint32_t *idx,						\
+	const size_t lines,						\
+	const size_t dist)						\
+{									\
+	register uint64_t sum = 0;					\
+	register size_t i;						\
+									\
+	for (i = 0; i < lines; i++) {					\
+		if (locality >= 0)					\
+			shim_builtin_prefetch(data + ((size_t)idx[i + dist] * 8), \
+				0, locality >= 0 ? locality : 0);	\
+		sum += data[(size_t)idx[i] * 8];			\
+	}								\
+	return sum;							\
+}
+
+STRESS_PREFETCH_SWEEP(none, -1)
+STRESS_PREFETCH_SWEEP(l3, 3)
+STRESS_PREFETCH_SWEEP(l2, 2)
+STRESS_PREFETCH_SWEEP(l1, 1)
+STRESS_PREFETCH_SWEEP(l0, 0)
+
+/* [pattern][hint + 1], hint 0 is no prefetch */
+static const stress_prefetch_sweep_func prefetch_sweep_funcs[PREFETCH_SWEEP_PATTERNS][PREFETCH_SWEEP_HINTS + 1] = {
+	{ stress_prefetch_sweep_seq_none, stress_prefetch_sweep_seq_l3,
+	  stress_prefetch_sweep_seq_l2, stress_prefetch_sweep_seq_l1,
+	  stress_prefetch_sweep_seq_l0 },
+	{ stress_prefetch_sweep_stride_none, stress_prefetch_sweep_stride_l3,
+	  stress_prefetch_sweep_stride_l2, stress_prefetch_sweep_stride_l1,
+	  stress_prefetch_sweep_stride_l0 },
+	{ stress_prefetch_sweep_indirect_none, stress_prefetch_sweep_indirect_l3,
+	  stress_prefetch_sweep_indirect_l2, stress_prefetch_sweep_indirect_l1,
+	  stress_prefetch_sweep_indirect_l0 },
+};
+
+static inline size_t stress_prefetch_sweep_dist(const size_t d)
+{
+	return (size_t)1 << d;
+}
+
+/*
+ *  stress_prefetch_msr_open()
+ *	open the MSR device of the CPU we are pinned to and read the
+ *	prefetcher control, returns -1 if it is not available
+ */
+static int stress_prefetch_msr_open(const stress_args_t *args, uint64_t *msr_orig)
+{
+#if defined(__linux__) &&	\
+    defined(STRESS_ARCH_X86) &&	\
+    defined(HAVE_AFFINITY)
+	char path[64];
+	cpu_set_t mask;
+	const unsigned int cpu = stress_get_cpu();
+	int fd;
+
+	if (!stress_cpu_is_x86() || !stress_cpu_x86_has_msr()) {
+		pr_inf("%s: hardware prefetcher control needs an Intel CPU with MSRs, "
+			"sweeping with hardware prefetchers on only\n", args->name);
+		return -1;
+	}
+	CPU_ZERO(&mask);
+	CPU_SET((int)cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf("%s: cannot pin to CPU %u, sweeping with hardware prefetchers "
+			"on only\n", args->name, cpu);
+		return -1;
+	}
+	(void)snprintf(path, sizeof(path), "/dev/cpu/%u/msr", cpu);
+	fd = open(path, O_RDWR);
+	if (fd < 0) {
+		pr_inf("%s: cannot open %s, errno=%d (%s), (msr module loaded and root?), "
+			"sweeping with hardware prefetchers on only\n",
+			args->name, path, errno, strerror(errno));
+		return -1;
+	}
+	if (pread(fd, msr_orig, sizeof(*msr_orig), PREFETCH_MSR_MISC_FEATURE_CONTROL) !=
+	    (ssize_t)sizeof(*msr_orig)) {
+		pr_inf("%s: cannot read MSR 0x%x, sweeping with hardware prefetchers "
+			"on only\n", args->name, PREFETCH_MSR_MISC_FEATURE_CONTROL);
+		(void)close(fd);
+		return -1;
+	}
+	return fd;
+#else
+	(void)msr_orig;
+
+	pr_inf("%s: hardware prefetcher control is not available on this system, "
+		"sweeping with hardware prefetchers on only\n", args->name);
+	return -1;
+#endif
+}
+
+static int stress_prefetch_msr_set(const int fd, const uint64_t msr)
+{
+	if (fd < 0)
+		return -1;
+	if (pwrite(fd, &msr, sizeof(msr), PREFETCH_MSR_MISC_FEATURE_CONTROL) !=
+	    (ssize_t)sizeof(msr))
+		return -1;
+	return 0;
+}
+
+/*
+ *  stress_prefetch_sweep_pattern()
+ *	time one pass of each hint and distance of an access pattern
+ */
+static void stress_prefetch_sweep_pattern(
+	stress_prefetch_sweep_t *sweep,
+	const size_t hwpf,
+	const size_t pattern,
+	const uint64_t *data,
+	const uint32_t *idx,
+	const size_t lines)
+{
+	const double bytes = (double)((pattern == 1) ?
+		(lines / PREFETCH_SWEEP_STRIDE) : lines) *
+		((pattern == 0) ? STRESS_CACHE_LINE_SIZE : sizeof(uint64_t));
+	size_t h, d;
+	double t;
+
+	/* untimed pass to settle the TLBs and page cache state */
+	stress_uint64_put(prefetch_sweep_funcs[pattern][0](data, idx, lines, 0));
+
+	t = stress_time_now();
+	stress_uint64_put(prefetch_sweep_funcs[pattern][0](data, idx, lines, 0));
+	sweep->secs[hwpf][pattern][0][0] += stress_time_now() - t;
+	sweep->bytes[hwpf][pattern][0][0] += bytes;
+
+	for (h = 0; h < PREFETCH_SWEEP_HINTS; h++) {
+		for (d = 0; d < PREFETCH_SWEEP_DISTS; d++) {
+			const size_t dist = stress_prefetch_sweep_dist(d);
+
+			t = stress_time_now();
+			stress_uint64_put(prefetch_sweep_funcs[pattern][h + 1](data, idx, lines, dist));
+			sweep->secs[hwpf][pattern][h][d + 1] += stress_time_now() - t;
+			sweep->bytes[hwpf][pattern][h][d + 1] += bytes;
+			if (!keep_stressing_flag())
+				return;
+		}
+	}
+}
+
+static inline double stress_prefetch_sweep_rate(
+	const stress_prefetch_sweep_t *sweep,
+	const size_t hwpf,
+	const size_t pattern,
+	const size_t h,
+	const size_t d)
+{
+	const double secs = sweep->secs[hwpf][pattern][h][d];
+
+	return (secs > 0.0) ? sweep->bytes[hwpf][pattern][h][d] / (secs * 1.0E9) : 0.0;
+}
+
+/*
+ *  stress_prefetch_sweep_report()
+ *	report the read GB/s of each hint and distance, the best hint
+ *	and distance and its speedup over no prefetching
+ */
+static void stress_prefetch_sweep_report(
+	const stress_args_t *args,
+	const stress_prefetch_sweep_t *sweep,
+	const size_t hwpfs)
+{
+	size_t hwpf, pattern, h, d;
+	int idx = 0;
+
+	for (hwpf = 0; hwpf < hwpfs; hwpf++) {
+		for (pattern = 0; pattern < PREFETCH_SWEEP_PATTERNS; pattern++) {
+			const double none = stress_prefetch_sweep_rate(sweep, hwpf, pattern, 0, 0);
+			double best = 0.0;
+			size_t best_h = 0, best_d = 0;
+			char line[256];
+			size_t len;
+
+			if (none <= 0.0)
+				continue;
+			if (args->instance == 0) {
+				pr_inf("%s: %s reads, %s, no prefetch %.2f GB/s\n",
+					args->name, prefetch_sweep_patterns[pattern],
+					prefetch_sweep_hwpf[hwpf], none);
+				len = (size_t)snprintf(line, sizeof(line), "%8s GB/s", "distance");
+				for (h = 0; h < PREFETCH_SWEEP_HINTS; h++)
+					len += (size_t)snprintf(line + len, sizeof(line) - len,
+						" %9s", prefetch_sweep_hints[h]);
+				pr_inf("%s: %s\n", args->name, line);
+			}
+			for (d = 1; d <= PREFETCH_SWEEP_DISTS; d++) {
+				len = (size_t)snprintf(line, sizeof(line), "%13zu",
+					stress_prefetch_sweep_dist(d - 1));
+				for (h = 0; h < PREFETCH_SWEEP_HINTS; h++) {
+					const double rate = stress_prefetch_sweep_rate(sweep, hwpf, pattern, h, d);
+
+					if (rate > 0.0)
+						len += (size_t)snprintf(line + len, sizeof(line) - len, " %9.2f", rate);
+					else
+						len += (size_t)snprintf(line + len, sizeof(line) - len, " %9s", "-");
+					if (rate > best) {
+						best = rate;
+						best_h = h;
+						best_d = d;
+					}
+				}
+				if (args->instance == 0)
+					pr_inf("%s: %s\n", args->name, line);
+			}
+			if (best <= 0.0)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %s reads, %s: best prefetch %s at distance %zu, "
+					"%.2f GB/s, %.2fx speedup over no prefetch\n",
+					args->name, prefetch_sweep_patterns[pattern],
+					prefetch_sweep_hwpf[hwpf], prefetch_sweep_hints[best_h],
+					stress_prefetch_sweep_dist(best_d - 1), best, best / none);
+			if (idx < STRESS_MISC_STATS_MAX - 1) {
+				char desc[64];
+
+				(void)snprintf(desc, sizeof(desc), "%s%s best distance",
+					prefetch_sweep_patterns[pattern], hwpf ? " hwpf off" : "");
+				stress_misc_stats_set(args->misc_stats, idx++, desc,
+					(double)stress_prefetch_sweep_dist(best_d - 1));
+				(void)snprintf(desc, sizeof(desc), "%s%s best speedup",
+					prefetch_sweep_patterns[pattern], hwpf ? " hwpf off" : "");
+				stress_misc_stats_set(args->misc_stats, idx++, desc, best / none);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_prefetch_sweep_run()
+ *	each bogo-op sweeps all the hints and distances of one access
+ *	pattern, with the hardware prefetchers on and then off when
+ *	--prefetch-sweep-hwpf is used
+ */
+static int stress_prefetch_sweep_run(const stress_args_t *args, const size_t l3_data_size)
+{
+	const size_t lines = STRESS_MINIMUM(l3_data_size * PREFETCH_SWEEP_SCALE,
+		(size_t)PREFETCH_SWEEP_MAX) / STRESS_CACHE_LINE_SIZE;
+	const size_t pad = PREFETCH_SWEEP_DIST_MAX * PREFETCH_SWEEP_STRIDE;
+	const size_t data_size = (lines + pad) * STRESS_CACHE_LINE_SIZE;
+	const size_t idx_size = (lines + PREFETCH_SWEEP_DIST_MAX) * sizeof(uint32_t);
+	stress_prefetch_sweep_t *sweep;
+	uint64_t *data, msr_orig = 0;
+	uint32_t *idx;
+	bool prefetch_sweep_hwpf = false;
+	size_t i, hwpfs = 1, op = 0;
+	int msr_fd = -1;
+
+	if (lines > UINT32_MAX) {
+		pr_inf_skip("%s: sweep buffer of %zu cache lines is too large, "
+			"skipping stressor\n", args->name, lines);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)stress_get_setting("prefetch-sweep-hwpf", &prefetch_sweep_hwpf);
+	if (prefetch_sweep_hwpf) {
+		msr_fd = stress_prefetch_msr_open(args, &msr_orig);
+		if (msr_fd >= 0)
+			hwpfs = PREFETCH_SWEEP_HWPF;
+	}
+
+	sweep = calloc(1, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		if (msr_fd >= 0)
+			(void)close(msr_fd);
+		return EXIT_NO_RESOURCE;
+	}
+	data = (uint64_t *)mmap(NULL, data_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte sweep buffer, skipping stressor\n",
+			args->name, data_size);
+		free(sweep);
+		if (msr_fd >= 0)
+			(void)close(msr_fd);
+		return EXIT_NO_RESOURCE;
+	}
+	idx = (uint32_t *)mmap(NULL, idx_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (idx == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte index buffer, skipping stressor\n",
+			args->name, idx_size);
+		(void)munmap((void *)data, data_size);
+		free(sweep);
+		if (msr_fd >= 0)
+			(void)close(msr_fd);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(data, 0xa5, data_size);
+
+	/* random permutation of the lines for the indirect reads */
+	for (i = 0; i < lines; i++)
+		idx[i] = (uint32_t)i;
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)(stress_mwc32() % (uint32_t)(i + 1));
+		const uint32_t tmp = idx[i];
+
+		idx[i] = idx[j];
+		idx[j] = tmp;
+	}
+	for (i = 0; i < PREFETCH_SWEEP_DIST_MAX; i++)
+		idx[lines + i] = idx[i];
+
+	if (args->instance == 0)
+		pr_inf("%s: sweeping prefetch over a %zu KB buffer\n",
+			args->name, (lines * STRESS_CACHE_LINE_SIZE) >> 10);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		const size_t pattern = op % PREFETCH_SWEEP_PATTERNS;
+		const size_t hwpf = (op / PREFETCH_SWEEP_PATTERNS) % hwpfs;
+
+		if (hwpf) {
+			if (stress_prefetch_msr_set(msr_fd, msr_orig | PREFETCH_MSR_HWPF_DISABLE) < 0) {
+				pr_inf("%s: cannot write MSR 0x%x, sweeping with hardware "
+					"prefetchers on only\n", args->name,
+					PREFETCH_MSR_MISC_FEATURE_CONTROL);
+				hwpfs = 1;
+				op = 0;
+				continue;
+			}
+		}
+		stress_prefetch_sweep_pattern(sweep, hwpf, pattern, data, idx, lines);
+		if (hwpf)
+			(void)stress_prefetch_msr_set(msr_fd, msr_orig);
+		op++;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (msr_fd >= 0) {
+		(void)stress_prefetch_msr_set(msr_fd, msr_orig);
+		(void)close(msr_fd);
+	}
+
+	stress_prefetch_sweep_report(args, sweep, hwpfs);
+
+	(void)munmap((void *)idx, idx_size);
+	(void)munmap((void *)data, data_size);
+	free(sweep);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_prefetch()
  *	stress cache/memory/CPU with stream stressors
@@ -195,11 +649,16 @@ static int stress_prefetch(const stress_args_t *args)
 	stress_prefetch_info_t prefetch_info[STRESS_PREFETCH_OFFSETS];
 	size_t i, best;
 	double best_rate, ns;
+	bool prefetch_sweep = false;
 
 	(void)stress_get_setting("stream-L3-size", &l3_data_size);
 	if (l3_data_size == 0)
 		l3_data_size = get_prefetch_L3_size(args);
 
+	(void)stress_get_setting("prefetch-sweep", &prefetch_sweep);
+	if (prefetch_sweep)
+		return stress_prefetch_sweep_run(args, l3_data_size);
+
 	l3_data_mmap_size = l3_data_size + (STRESS_PREFETCH_OFFSETS * STRESS_CACHE_LINE_SIZE);
 
 	l3_data = (uint64_t *)mmap(NULL, l3_data_mmap_size,
@@ -272,6 +731,8 @@ static int stress_prefetch(const stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_prefetch_l3_size,	stress_set_prefetch_L3_size },
+	{ OPT_prefetch_sweep,	stress_set_prefetch_sweep },
+	{ OPT_prefetch_sweep_hwpf, stress_set_prefetch_sweep_hwpf },
 	{ 0,			NULL }
 };
 
@@ -0,0 +1,515 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+
+#define MIN_PSEUDOFSBENCH_FILES		(16)
+#define MAX_PSEUDOFSBENCH_FILES		(1000000)
+#define DEFAULT_PSEUDOFSBENCH_FILES	(4096)
+
+#define MIN_PSEUDOFSBENCH_THREADS	(1)
+#define MAX_PSEUDOFSBENCH_THREADS	(256)
+#define DEFAULT_PSEUDOFSBENCH_THREADS	(4)
+
+#define PSEUDOFSBENCH_DEPTH		(8)		/* directory recursion limit */
+#define PSEUDOFSBENCH_READ_MAX		(256 * KB)	/* bytes read per file */
+#define PSEUDOFSBENCH_BUF_SIZE		(64 * KB)	/* read(2) size */
+#define PSEUDOFSBENCH_PHASE		(0.25)		/* seconds per hot file step */
+#define PSEUDOFSBENCH_RANK		(10)		/* most expensive files shown */
+
+static const stress_help_t help[] = {
+	{ NULL,	"pseudofsbench N",		"start N workers ranking /proc and /sys file read costs" },
+	{ NULL,	"pseudofsbench-files N",	"sample N of the /proc and /sys files, default 4096" },
+	{ NULL,	"pseudofsbench-ops N",		"stop after N file reads" },
+	{ NULL,	"pseudofsbench-threads N",	"read hot files with 1 and N threads, default 4" },
+	{ NULL,	NULL,				NULL }
+};
+
+static int stress_set_pseudofsbench_files(const char *opt)
+{
+	uint32_t pseudofsbench_files;
+
+	pseudofsbench_files = stress_get_uint32(opt);
+	stress_check_range("pseudofsbench-files", (uint64_t)pseudofsbench_files,
+		MIN_PSEUDOFSBENCH_FILES, MAX_PSEUDOFSBENCH_FILES);
+	return stress_set_setting("pseudofsbench-files", TYPE_ID_UINT32, &pseudofsbench_files);
+}
+
+static int stress_set_pseudofsbench_threads(const char *opt)
+{
+	uint32_t pseudofsbench_threads;
+
+	pseudofsbench_threads = stress_get_uint32(opt);
+	stress_check_range("pseudofsbench-threads", (uint64_t)pseudofsbench_threads,
+		MIN_PSEUDOFSBENCH_THREADS, MAX_PSEUDOFSBENCH_THREADS);
+	return stress_set_setting("pseudofsbench-threads", TYPE_ID_UINT32, &pseudofsbench_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_pseudofsbench_files,	stress_set_pseudofsbench_files },
+	{ OPT_pseudofsbench_threads,	stress_set_pseudofsbench_threads },
+	{ 0,				NULL }
+};
+
+#if defined(__linux__) &&	\
+    defined(HAVE_LIB_PTHREAD)
+
+/* files that monitoring agents read all the time */
+static const char * const pseudofsbench_hot[] = {
+	"/proc/stat",
+	"/proc/meminfo",
+	"/proc/self/smaps",
+};
+
+#define PSEUDOFSBENCH_HOT	(SIZEOF_ARRAY(pseudofsbench_hot))
+
+/* read cost of one file */
+typedef struct {
+	char	*path;
+	uint64_t reads;			/* successful reads */
+	uint64_t total_ns;		/* open, read and close time */
+	uint64_t max_ns;
+	uint64_t bytes;			/* bytes read */
+} stress_pseudofsbench_file_t;
+
+/* the sampled files */
+typedef struct {
+	stress_pseudofsbench_file_t *files;
+	size_t	n_files;		/* files held */
+	size_t	max_files;		/* sample size */
+	uint64_t seen;			/* files found by the walk */
+} stress_pseudofsbench_sample_t;
+
+struct stress_pseudofsbench;
+
+/* a thread reading a hot file */
+typedef struct {
+	struct stress_pseudofsbench *pfb;	/* shared state */
+	pthread_t pthread;
+	int	ret;			/* pthread_create return */
+	uint64_t reads;			/* reads completed */
+	uint64_t total_ns;		/* time in reads */
+	uint8_t	*buf;			/* read buffer */
+} ALIGN64 stress_pseudofsbench_thread_t;
+
+typedef struct stress_pseudofsbench {
+	const char *path;		/* hot file to read */
+	volatile bool start;		/* threads may start */
+	volatile bool stop;		/* threads should stop */
+} stress_pseudofsbench_t;
+
+/* hot file throughput, 1 thread and N threads */
+typedef struct {
+	double	rate[2];		/* reads/sec */
+	double	mean_us[2];		/* mean read time */
+	uint32_t passes[2];
+} stress_pseudofsbench_hot_t;
+
+/*
+ *  stress_pseudofsbench_skip()
+ *	skip debug and tracing interfaces, hardware resources and
+ *	paths that are known to cause issues when read
+ */
+static bool stress_pseudofsbench_skip(const char *path)
+{
+	if (!strncmp(path, "/sys/kernel/debug", 17) ||
+	    !strncmp(path, "/sys/kernel/tracing", 19) ||
+	    !strncmp(path, "/proc/self/task", 15))
+		return true;
+	/* PCI BARs and ROMs */
+	if (!strncmp(path, "/sys/devices", 12) &&
+	    (strstr(path, "/resource") || strstr(path, "/rom")))
+		return true;
+	/* can OOPS on Azure, see stress-sysfs.c */
+	if (strstr(path, "PNP0A03") && strstr(path, "VMBUS"))
+		return true;
+	return false;
+}
+
+/*
+ *  stress_pseudofsbench_add()
+ *	reservoir sample the files found by the walk so that a walk
+ *	of any size gives an even sample of at most max_files files
+ */
+static void stress_pseudofsbench_add(
+	stress_pseudofsbench_sample_t *sample,
+	const char *path)
+{
+	size_t n;
+	char *str;
+
+	sample->seen++;
+	if (sample->n_files < sample->max_files) {
+		n = sample->n_files;
+	} else {
+		n = (size_t)(stress_mwc64() % sample->seen);
+		if (n >= sample->max_files)
+			return;
+	}
+	str = strdup(path);
+	if (!str)
+		return;
+	if (n == sample->n_files)
+		sample->n_files++;
+	else
+		free(sample->files[n].path);
+	sample->files[n].path = str;
+}
+
+/*
+ *  stress_pseudofsbench_walk()
+ *	walk a directory tree adding the regular files, symlinks are
+ *	not followed and numeric /proc process directories are skipped
+ */
+static void stress_pseudofsbench_walk(
+	stress_pseudofsbench_sample_t *sample,
+	const char *path,
+	const int depth)
+{
+	DIR *dir;
+	struct dirent *d;
+
+	if ((depth > PSEUDOFSBENCH_DEPTH) || !keep_stressing_flag())
+		return;
+	dir = opendir(path);
+	if (!dir)
+		return;
+	while ((d = readdir(dir)) != NULL) {
+		char tmp[PATH_MAX];
+		unsigned char type = d->d_type;
+
+		if (stress_is_dot_filename(d->d_name))
+			continue;
+		if (!strcmp(path, "/proc") && isdigit((int)d->d_name[0]))
+			continue;
+		(void)snprintf(tmp, sizeof(tmp), "%s/%s", path, d->d_name);
+		if (stress_pseudofsbench_skip(tmp))
+			continue;
+		if (type == DT_UNKNOWN) {
+			struct stat statbuf;
+
+			if (lstat(tmp, &statbuf) < 0)
+				continue;
+			if (S_ISDIR(statbuf.st_mode))
+				type = DT_DIR;
+			else if (S_ISREG(statbuf.st_mode))
+				type = DT_REG;
+		}
+		if (type == DT_DIR)
+			stress_pseudofsbench_walk(sample, tmp, depth + 1);
+		else if (type == DT_REG)
+			stress_pseudofsbench_add(sample, tmp);
+	}
+	(void)closedir(dir);
+}
+
+/*
+ *  stress_pseudofsbench_read()
+ *	open, read up to PSEUDOFSBENCH_READ_MAX bytes and close a file,
+ *	returns the bytes read or -1 if it could not be read
+ */
+static ssize_t stress_pseudofsbench_read(const char *path, uint8_t *buf)
+{
+	ssize_t total = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		return -1;
+	while (total < (ssize_t)PSEUDOFSBENCH_READ_MAX) {
+		const ssize_t ret = read(fd, buf, PSEUDOFSBENCH_BUF_SIZE);
+
+		if (ret <= 0) {
+			if ((ret < 0) && (total == 0)) {
+				(void)close(fd);
+				return -1;
+			}
+			break;
+		}
+		total += ret;
+	}
+	(void)close(fd);
+
+	return total;
+}
+
+/*
+ *  stress_pseudofsbench_thread()
+ *	read the hot file over and over until told to stop
+ */
+static void *stress_pseudofsbench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_pseudofsbench_thread_t *t = (stress_pseudofsbench_thread_t *)arg;
+	const stress_pseudofsbench_t *pfb = t->pfb;
+
+	while (!pfb->start)
+		(void)shim_sched_yield();
+
+	while (!pfb->stop) {
+		uint64_t t1, t2;
+
+		t1 = stress_clock_ns();
+		if (stress_pseudofsbench_read(pfb->path, t->buf) < 0)
+			break;
+		t2 = stress_clock_ns();
+		t->total_ns += t2 - t1;
+		t->reads++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_pseudofsbench_hot()
+ *	read a hot file with n_threads threads for a short phase,
+ *	returns reads/sec and the mean read time in *mean_us
+ */
+static double stress_pseudofsbench_hot(
+	const stress_args_t *args,
+	stress_pseudofsbench_t *pfb,
+	stress_pseudofsbench_thread_t *threads,
+	const uint32_t n_threads,
+	double *mean_us)
+{
+	uint32_t i, started = 0;
+	uint64_t reads = 0, total_ns = 0;
+	double t1, t2;
+
+	*mean_us = 0.0;
+	pfb->start = false;
+	pfb->stop = false;
+	for (i = 0; i < n_threads; i++) {
+		stress_pseudofsbench_thread_t *t = &threads[i];
+
+		t->pfb = pfb;
+		t->reads = 0;
+		t->total_ns = 0;
+		t->ret = pthread_create(&t->pthread, NULL, stress_pseudofsbench_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+	t1 = stress_time_now();
+	pfb->start = true;
+	if (started == n_threads)
+		(void)shim_nanosleep_uint64((uint64_t)(PSEUDOFSBENCH_PHASE * STRESS_NANOSECOND));
+	pfb->stop = true;
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		reads += threads[i].reads;
+		total_ns += threads[i].total_ns;
+	}
+	t2 = stress_time_now();
+	add_counter(args, reads);
+
+	if ((started < n_threads) || !reads || (t2 <= t1))
+		return 0.0;
+	*mean_us = (double)total_ns / ((double)reads * 1000.0);
+	return (double)reads / (t2 - t1);
+}
+
+static int stress_pseudofsbench_cmp(const void *p1, const void *p2)
+{
+	const stress_pseudofsbench_file_t *f1 = (const stress_pseudofsbench_file_t *)p1;
+	const stress_pseudofsbench_file_t *f2 = (const stress_pseudofsbench_file_t *)p2;
+	const double m1 = f1->reads ? (double)f1->total_ns / (double)f1->reads : 0.0;
+	const double m2 = f2->reads ? (double)f2->total_ns / (double)f2->reads : 0.0;
+
+	/* most expensive first */
+	return (m1 < m2) - (m1 > m2);
+}
+
+/*
+ *  stress_pseudofsbench()
+ *	time the reads of a sample of the /proc and /sys files to
+ *	rank the most expensive ones, and measure how reads of hot
+ *	monitoring files scale with concurrent readers
+ */
+static int stress_pseudofsbench(const stress_args_t *args)
+{
+	static stress_pseudofsbench_hot_t hot[PSEUDOFSBENCH_HOT];
+	stress_pseudofsbench_sample_t sample;
+	stress_pseudofsbench_t pfb;
+	stress_pseudofsbench_thread_t *threads;
+	uint32_t pseudofsbench_files = DEFAULT_PSEUDOFSBENCH_FILES;
+	uint32_t pseudofsbench_threads = DEFAULT_PSEUDOFSBENCH_THREADS, i;
+	uint64_t all_reads = 0, all_ns = 0, all_max = 0;
+	size_t f, h, s, idx = 0, buf_size;
+	uint8_t *buf;
+	int rc = EXIT_SUCCESS;
+
+	if (!stress_get_setting("pseudofsbench-files", &pseudofsbench_files)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			pseudofsbench_files = MAX_PSEUDOFSBENCH_FILES;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			pseudofsbench_files = MIN_PSEUDOFSBENCH_FILES;
+	}
+	if (!stress_get_setting("pseudofsbench-threads", &pseudofsbench_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			pseudofsbench_threads = MAX_PSEUDOFSBENCH_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			pseudofsbench_threads = MIN_PSEUDOFSBENCH_THREADS;
+	}
+
+	(void)memset(&sample, 0, sizeof(sample));
+	sample.max_files = (size_t)pseudofsbench_files;
+	sample.files = (stress_pseudofsbench_file_t *)calloc(sample.max_files, sizeof(*sample.files));
+	threads = (stress_pseudofsbench_thread_t *)calloc(pseudofsbench_threads, sizeof(*threads));
+	buf_size = (size_t)(pseudofsbench_threads + 1) * PSEUDOFSBENCH_BUF_SIZE;
+	buf = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (!sample.files || !threads || (buf == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate file sample, threads or read buffers, "
+			"skipping stressor\n", args->name);
+		if (buf != MAP_FAILED)
+			(void)munmap((void *)buf, buf_size);
+		free(threads);
+		free(sample.files);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < pseudofsbench_threads; i++)
+		threads[i].buf = buf + ((size_t)(i + 1) * PSEUDOFSBENCH_BUF_SIZE);
+
+	stress_pseudofsbench_walk(&sample, "/proc", 0);
+	stress_pseudofsbench_walk(&sample, "/proc/self", 1);
+	stress_pseudofsbench_walk(&sample, "/sys", 0);
+	if (!sample.n_files) {
+		pr_inf_skip("%s: no /proc or /sys files found, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_all;
+	}
+	(void)memset(hot, 0, sizeof(hot));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (f = 0; (f < sample.n_files) && keep_stressing(args); f++) {
+			stress_pseudofsbench_file_t *file = &sample.files[f];
+			uint64_t t1, t2, ns;
+			ssize_t ret;
+
+			t1 = stress_clock_ns();
+			ret = stress_pseudofsbench_read(file->path, buf);
+			t2 = stress_clock_ns();
+			if (ret < 0)
+				continue;
+			ns = t2 - t1;
+			file->reads++;
+			file->total_ns += ns;
+			file->bytes += (uint64_t)ret;
+			if (ns > file->max_ns)
+				file->max_ns = ns;
+			inc_counter(args);
+		}
+		for (h = 0; (h < PSEUDOFSBENCH_HOT) && keep_stressing(args); h++) {
+			pfb.path = pseudofsbench_hot[h];
+			for (s = 0; (s < 2) && keep_stressing(args); s++) {
+				double mean_us;
+				const double rate = stress_pseudofsbench_hot(args, &pfb,
+					threads, s ? pseudofsbench_threads : 1, &mean_us);
+
+				if (rate <= 0.0)
+					continue;
+				hot[h].rate[s] += rate;
+				hot[h].mean_us[s] += mean_us;
+				hot[h].passes[s]++;
+			}
+		}
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (f = 0; f < sample.n_files; f++) {
+		all_reads += sample.files[f].reads;
+		all_ns += sample.files[f].total_ns;
+		if (sample.files[f].max_ns > all_max)
+			all_max = sample.files[f].max_ns;
+	}
+	qsort(sample.files, sample.n_files, sizeof(*sample.files), stress_pseudofsbench_cmp);
+
+	if (args->instance == 0) {
+		pr_inf("%s: read %zu of %" PRIu64 " /proc and /sys files, most expensive:\n",
+			args->name, sample.n_files, sample.seen);
+		pr_inf("%s: %10s %10s %10s %6s  %s\n", args->name,
+			"mean us", "max us", "bytes", "reads", "file");
+		for (f = 0; (f < sample.n_files) && (f < PSEUDOFSBENCH_RANK); f++) {
+			const stress_pseudofsbench_file_t *file = &sample.files[f];
+
+			if (!file->reads)
+				break;
+			pr_inf("%s: %10.2f %10.2f %10" PRIu64 " %6" PRIu64 "  %s\n",
+				args->name,
+				(double)file->total_ns / ((double)file->reads * 1000.0),
+				(double)file->max_ns / 1000.0,
+				file->bytes / file->reads, file->reads, file->path);
+		}
+		pr_inf("%s: %-18s %14s %10s %14s %10s\n", args->name,
+			"hot file", "1 reads/sec", "mean us", "N reads/sec", "mean us");
+	}
+	for (h = 0; h < PSEUDOFSBENCH_HOT; h++) {
+		double rate[2], mean_us[2];
+		char desc[32];
+
+		for (s = 0; s < 2; s++) {
+			rate[s] = hot[h].passes[s] ? hot[h].rate[s] / (double)hot[h].passes[s] : 0.0;
+			mean_us[s] = hot[h].passes[s] ? hot[h].mean_us[s] / (double)hot[h].passes[s] : 0.0;
+		}
+		if (!hot[h].passes[0])
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %-18s %14.0f %10.2f %14.0f %10.2f\n", args->name,
+				pseudofsbench_hot[h], rate[0], mean_us[0], rate[1], mean_us[1]);
+		if (idx < STRESS_MISC_STATS_MAX - 1) {
+			(void)snprintf(desc, sizeof(desc), "%s reads/sec", pseudofsbench_hot[h]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, rate[0]);
+			(void)snprintf(desc, sizeof(desc), "%s N reads/sec", pseudofsbench_hot[h]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, rate[1]);
+		}
+	}
+	if (all_reads && (idx < STRESS_MISC_STATS_MAX - 1)) {
+		stress_misc_stats_set(args->misc_stats, idx++, "mean file read us",
+			(double)all_ns / ((double)all_reads * 1000.0));
+		stress_misc_stats_set(args->misc_stats, idx++, "max file read us",
+			(double)all_max / 1000.0);
+	}
+
+free_all:
+	for (f = 0; f < sample.n_files; f++)
+		free(sample.files[f].path);
+	(void)munmap((void *)buf, buf_size);
+	free(threads);
+	free(sample.files);
+
+	return rc;
+}
+
+stressor_info_t stress_pseudofsbench_info = {
+	.stressor = stress_pseudofsbench,
+	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_pseudofsbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
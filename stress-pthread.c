@@ -33,10 +33,22 @@
 #include <sys/prctl.h>
 #endif
 
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
+#if defined(HAVE_LIB_DL)
+#include <dlfcn.h>
+#endif
+
 #define MIN_PTHREAD		(1)
 #define MAX_PTHREAD		(30000)
 #define DEFAULT_PTHREAD		(1024)
 
+#define PTHREAD_BENCH_WINDOW	(0.2)		/* seconds per measurement */
+#define PTHREAD_BENCH_CREATORS	(8)		/* most concurrent creators */
+#define PTHREAD_BENCH_SAMPLES	(4096)		/* latencies kept per creator */
+
 #if defined(__NR_get_thread_area)
 #define HAVE_GET_THREAD_AREA
 #endif
@@ -53,6 +65,8 @@ static const stress_help_t help[] = {
 	{ NULL,	"pthread N",	 "start N workers that create multiple threads" },
 	{ NULL,	"pthread-ops N", "stop pthread workers after N bogo threads created" },
 	{ NULL,	"pthread-max P", "create P threads at a time by each worker" },
+	{ NULL,	"pthread-bench", "measure thread create latency and create/join rate" },
+	{ NULL,	"pthread-bench-tls-so F", "repeat the benchmark with TLS heavy module F loaded" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -76,6 +90,25 @@ static volatile bool keep_running_flag;
 static uint64_t pthread_count;
 static stress_pthread_info_t pthreads[MAX_PTHREAD];
 
+/* a thread create benchmark configuration */
+typedef struct {
+	const char *what;	/* what is being varied */
+	size_t stack_size;	/* stack size, 0 = default */
+	size_t guard_size;	/* guard size, SIZE_MAX = default */
+	uint32_t creators;	/* concurrent creating threads */
+} stress_pthread_bench_t;
+
+/* a thread creating and joining threads for a benchmark */
+typedef struct {
+	pthread_t pthread;	/* the creator */
+	const stress_pthread_bench_t *bench;
+	volatile bool *start;	/* set when all the creators exist */
+	double end;		/* time to stop creating */
+	uint64_t created;	/* threads created and joined */
+	size_t n_latencies;	/* latencies kept */
+	uint64_t *latencies;	/* create to running latencies, ns */
+} stress_pthread_creator_t;
+
 #endif
 
 static int stress_set_pthread_max(const char *opt)
@@ -88,8 +121,20 @@ static int stress_set_pthread_max(const char *opt)
 	return stress_set_setting("pthread-max", TYPE_ID_UINT64, &pthread_max);
 }
 
+static int stress_set_pthread_bench(const char *opt)
+{
+	return stress_set_setting_true("pthread-bench", opt);
+}
+
+static int stress_set_pthread_bench_tls_so(const char *opt)
+{
+	return stress_set_setting("pthread-bench-tls-so", TYPE_ID_STR, opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_pthread_max,	stress_set_pthread_max },
+	{ OPT_pthread_bench,	stress_set_pthread_bench },
+	{ OPT_pthread_bench_tls_so, stress_set_pthread_bench_tls_so },
 	{ 0,			NULL }
 };
 
@@ -398,13 +443,310 @@ die:
 	return &nowt;
 }
 
+/*
+ *  stress_pthread_bench_func()
+ *	note when the new thread starts running
+ */
+static void *stress_pthread_bench_func(void *arg)
+{
+	*(double *)arg = stress_time_now();
+	return NULL;
+}
+
+/*
+ *  stress_pthread_bench_creator()
+ *	create and join threads until the end of the measurement
+ */
+static void *stress_pthread_bench_creator(void *arg)
+{
+	static void *nowt = NULL;
+	stress_pthread_creator_t *creator = (stress_pthread_creator_t *)arg;
+	const stress_pthread_bench_t *bench = creator->bench;
+	pthread_attr_t attr;
+
+	if (pthread_attr_init(&attr) != 0)
+		return &nowt;
+	if (bench->stack_size)
+		(void)pthread_attr_setstacksize(&attr, bench->stack_size);
+	if (bench->guard_size != SIZE_MAX)
+		(void)pthread_attr_setguardsize(&attr, bench->guard_size);
+
+	while (!*creator->start && keep_running())
+		(void)shim_sched_yield();
+
+	while (keep_running() && (stress_time_now() < creator->end)) {
+		pthread_t pthread;
+		double t_create, t_run = 0.0;
+
+		t_create = stress_time_now();
+		if (pthread_create(&pthread, &attr, stress_pthread_bench_func, &t_run) != 0)
+			break;
+		if (pthread_join(pthread, NULL) != 0)
+			break;
+		creator->created++;
+		if ((creator->n_latencies < PTHREAD_BENCH_SAMPLES) && (t_run >= t_create))
+			creator->latencies[creator->n_latencies++] =
+				(uint64_t)((t_run - t_create) * (double)STRESS_NANOSECOND);
+	}
+	(void)pthread_attr_destroy(&attr);
+	return &nowt;
+}
+
+static int stress_pthread_bench_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_pthread_bench_run()
+ *	measure one configuration, returns the create and join rate
+ *	per second or -1.0 on failure, mean and p99 create to running
+ *	latencies are returned in us
+ */
+static double stress_pthread_bench_run(
+	const stress_args_t *args,
+	const stress_pthread_bench_t *bench,
+	uint64_t *latencies,
+	double *mean,
+	double *p99)
+{
+	stress_pthread_creator_t creators[PTHREAD_BENCH_CREATORS];
+	volatile bool start = false;
+	uint64_t created = 0, total = 0;
+	size_t n = 0;
+	uint32_t i, started;
+	double t;
+
+	for (started = 0; started < bench->creators; started++) {
+		stress_pthread_creator_t *creator = &creators[started];
+
+		creator->bench = bench;
+		creator->start = &start;
+		creator->end = 0.0;
+		creator->created = 0;
+		creator->n_latencies = 0;
+		creator->latencies = latencies + ((size_t)started * PTHREAD_BENCH_SAMPLES);
+		if (pthread_create(&creator->pthread, NULL,
+				   stress_pthread_bench_creator, creator) != 0)
+			break;
+	}
+	t = stress_time_now();
+	for (i = 0; i < started; i++)
+		creators[i].end = t + PTHREAD_BENCH_WINDOW;
+	start = true;
+
+	for (i = 0; i < started; i++) {
+		const stress_pthread_creator_t *creator = &creators[i];
+
+		(void)pthread_join(creator->pthread, NULL);
+		created += creator->created;
+		/* pack the latencies together */
+		(void)memmove(latencies + n, creator->latencies,
+			creator->n_latencies * sizeof(*latencies));
+		n += creator->n_latencies;
+	}
+	t = stress_time_now() - t;
+	add_counter(args, created);
+
+	if ((started < bench->creators) || !n || (t <= 0.0))
+		return -1.0;
+
+	qsort(latencies, n, sizeof(*latencies), stress_pthread_bench_cmp);
+	for (i = 0; i < n; i++)
+		total += latencies[i];
+	*mean = ((double)total / (double)n) / 1000.0;
+	*p99 = (double)latencies[(n * 99) / 100] / 1000.0;
+	return (double)created / t;
+}
+
+#if defined(HAVE_LINK_H) &&	\
+    defined(HAVE_LIB_DL)
+/* a loaded module and its TLS segment size */
+typedef struct {
+	const char *name;	/* module path as loaded */
+	size_t size;		/* TLS segment size, 0 = none */
+} stress_pthread_tls_t;
+
+/*
+ *  stress_pthread_bench_tls_size_cb()
+ *	find the TLS segment size of the named module
+ */
+static int stress_pthread_bench_tls_size_cb(struct dl_phdr_info *info, size_t size, void *data)
+{
+	stress_pthread_tls_t *tls = (stress_pthread_tls_t *)data;
+	ElfW(Half) i;
+
+	(void)size;
+
+	if (!info->dlpi_name || strcmp(info->dlpi_name, tls->name))
+		return 0;
+	for (i = 0; i < info->dlpi_phnum; i++) {
+		if (info->dlpi_phdr[i].p_type == PT_TLS) {
+			tls->size = (size_t)info->dlpi_phdr[i].p_memsz;
+			break;
+		}
+	}
+	return 1;
+}
+#endif
+
+/*
+ *  stress_pthread_bench_report()
+ *	report one configuration
+ */
+static void stress_pthread_bench_report(
+	const stress_args_t *args,
+	const char *what,
+	const char *setting,
+	const uint32_t creators,
+	const double rate,
+	const double mean,
+	const double p99)
+{
+	if (args->instance != 0)
+		return;
+	if (rate < 0.0)
+		pr_inf("%s: %-10s %8s %8" PRIu32 " %14s %10s %10s\n", args->name,
+			what, setting, creators, "failed", "-", "-");
+	else
+		pr_inf("%s: %-10s %8s %8" PRIu32 " %14.0f %10.2f %10.2f\n", args->name,
+			what, setting, creators, rate, mean, p99);
+}
+
+/*
+ *  stress_pthread_bench()
+ *	measure the create to running latency and the create and
+ *	join rate against stack size, guard size, the number of
+ *	threads creating at once in the process and optionally with
+ *	a module with a large TLS segment loaded
+ */
+static int stress_pthread_bench(const stress_args_t *args)
+{
+	static const size_t stack_sizes[] = {
+		16 * KB, 64 * KB, 256 * KB, 1 * MB, 8 * MB
+	};
+	static const size_t guard_sizes[] = {
+		0, 4 * KB, 64 * KB, 1 * MB
+	};
+	static const uint32_t creators[] = {
+		1, 2, 4, 8
+	};
+	const size_t min_stack = stress_min_pthread_stack_size();
+	char *tls_so = NULL;
+	uint64_t *latencies;
+	double rate, mean = 0.0, p99 = 0.0, default_rate = 0.0;
+	double max_creators_rate = 0.0;
+	size_t i;
+
+	(void)stress_get_setting("pthread-bench-tls-so", &tls_so);
+
+	if (args->instance != 0)
+		goto idle;
+
+	latencies = (uint64_t *)calloc((size_t)PTHREAD_BENCH_CREATORS * PTHREAD_BENCH_SAMPLES,
+		sizeof(*latencies));
+	if (!latencies) {
+		pr_inf_skip("%s: cannot allocate latency samples, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	pr_inf("%s: %-10s %8s %8s %14s %10s %10s\n", args->name,
+		"attribute", "setting", "creators", "create+join/s", "mean us", "p99 us");
+	{
+		const stress_pthread_bench_t bench = { "default", 0, SIZE_MAX, 1 };
+
+		default_rate = stress_pthread_bench_run(args, &bench, latencies, &mean, &p99);
+		stress_pthread_bench_report(args, bench.what, "-", 1, default_rate, mean, p99);
+		if (default_rate > 0.0) {
+			stress_misc_stats_set(args->misc_stats, 0, "create+join per sec", default_rate);
+			stress_misc_stats_set(args->misc_stats, 1, "create to run mean us", mean);
+			stress_misc_stats_set(args->misc_stats, 2, "create to run p99 us", p99);
+		}
+	}
+	for (i = 0; keep_running() && (i < SIZEOF_ARRAY(stack_sizes)); i++) {
+		const stress_pthread_bench_t bench = {
+			"stack", STRESS_MAXIMUM(stack_sizes[i], min_stack), SIZE_MAX, 1
+		};
+		char str[16];
+
+		rate = stress_pthread_bench_run(args, &bench, latencies, &mean, &p99);
+		(void)stress_uint64_to_str(str, sizeof(str), (uint64_t)bench.stack_size);
+		stress_pthread_bench_report(args, bench.what, str, 1, rate, mean, p99);
+	}
+	for (i = 0; keep_running() && (i < SIZEOF_ARRAY(guard_sizes)); i++) {
+		const stress_pthread_bench_t bench = {
+			"guard", 0, guard_sizes[i], 1
+		};
+		char str[16];
+
+		rate = stress_pthread_bench_run(args, &bench, latencies, &mean, &p99);
+		(void)stress_uint64_to_str(str, sizeof(str), (uint64_t)bench.guard_size);
+		stress_pthread_bench_report(args, bench.what, str, 1, rate, mean, p99);
+	}
+	for (i = 0; keep_running() && (i < SIZEOF_ARRAY(creators)); i++) {
+		const stress_pthread_bench_t bench = {
+			"creators", 0, SIZE_MAX, creators[i]
+		};
+
+		rate = stress_pthread_bench_run(args, &bench, latencies, &mean, &p99);
+		stress_pthread_bench_report(args, bench.what, "-", creators[i], rate, mean, p99);
+		max_creators_rate = STRESS_MAXIMUM(max_creators_rate, rate);
+	}
+	if (max_creators_rate > 0.0)
+		stress_misc_stats_set(args->misc_stats, 3, "best create+join/s creators", max_creators_rate);
+
+	if (tls_so && keep_running()) {
+#if defined(HAVE_LINK_H) &&	\
+    defined(HAVE_LIB_DL)
+		/*
+		 *  glibc sets up the TLS of modules that fit in the static
+		 *  TLS surplus for every new thread, larger modules get
+		 *  their TLS allocated on first use so add nothing here
+		 */
+		void *handle = dlopen(tls_so, RTLD_NOW | RTLD_GLOBAL);
+
+		if (!handle) {
+			pr_inf("%s: cannot load TLS module %s: %s\n", args->name, tls_so, dlerror());
+		} else {
+			const stress_pthread_bench_t bench = { "tls", 0, SIZE_MAX, 1 };
+			stress_pthread_tls_t tls = { tls_so, 0 };
+			char str[16];
+
+			(void)dl_iterate_phdr(stress_pthread_bench_tls_size_cb, &tls);
+			(void)stress_uint64_to_str(str, sizeof(str), (uint64_t)tls.size);
+
+			rate = stress_pthread_bench_run(args, &bench, latencies, &mean, &p99);
+			stress_pthread_bench_report(args, bench.what, str, 1, rate, mean, p99);
+			if ((rate > 0.0) && (default_rate > 0.0))
+				stress_misc_stats_set(args->misc_stats, 4, "TLS module rate change %",
+					100.0 * (rate - default_rate) / default_rate);
+			(void)dlclose(handle);
+		}
+#else
+		pr_inf("%s: --pthread-bench-tls-so is not supported on this system\n", args->name);
+#endif
+	}
+	free(latencies);
+
+idle:
+	while (keep_running() && keep_stressing(args))
+		(void)shim_usleep(100000);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_pthread()
  *	stress by creating pthreads
  */
 static int stress_pthread(const stress_args_t *args)
 {
-	bool locked = false;
+	bool locked = false, pthread_bench = false;
 	uint64_t limited = 0, attempted = 0, maximum = 0;
 	uint64_t pthread_max = DEFAULT_PTHREAD;
 	int ret;
@@ -433,6 +775,10 @@ static int stress_pthread(const stress_args_t *args)
 	sigaddset(&set, SIGALRM);
 	sigprocmask(SIG_BLOCK, &set, NULL);
 
+	(void)stress_get_setting("pthread-bench", &pthread_bench);
+	if (pthread_bench)
+		return stress_pthread_bench(args);
+
 	if (!stress_get_setting("pthread-max", &pthread_max)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			pthread_max = MAX_PTHREAD;
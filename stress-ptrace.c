@@ -31,10 +31,21 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"ptrace N",	"start N workers that trace a child using ptrace" },
+	{ NULL,	"ptrace-bench",	"measure ns added per syscall by PTRACE_SYSCALL and PTRACE_SYSEMU" },
 	{ NULL,	"ptrace-ops N",	"stop ptrace workers after N system calls are traced" },
 	{ NULL, NULL,		NULL }
 };
 
+static int stress_set_ptrace_bench(const char *opt)
+{
+	return stress_set_setting_true("ptrace-bench", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_ptrace_bench,	stress_set_ptrace_bench },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_PTRACE)
 
 /*
@@ -71,6 +82,240 @@ static inline bool stress_syscall_wait(
 	return true;
 }
 
+#define PTRACE_BENCH_CALLS	(20000)
+#define PTRACE_BENCH_RUNS	(3)
+
+typedef enum {
+	PTRACE_BENCH_NONE,	/* untraced child */
+	PTRACE_BENCH_CONT,	/* traced, PTRACE_CONT, no syscall stops */
+	PTRACE_BENCH_SYSCALL,	/* traced, PTRACE_SYSCALL entry + exit stops */
+	PTRACE_BENCH_SYSEMU,	/* traced, PTRACE_SYSEMU entry stop only */
+} stress_ptrace_bench_mode_t;
+
+typedef struct {
+	const char *name;
+	const stress_ptrace_bench_mode_t mode;
+} stress_ptrace_bench_t;
+
+typedef struct {
+	double ns;		/* ns per syscall measured by the child */
+	volatile bool done;	/* child has finished timing */
+} stress_ptrace_bench_shared_t;
+
+static const stress_ptrace_bench_t ptrace_benches[] = {
+	{ "untraced",		PTRACE_BENCH_NONE },
+	{ "PTRACE_CONT",	PTRACE_BENCH_CONT },
+	{ "PTRACE_SYSCALL",	PTRACE_BENCH_SYSCALL },
+#if defined(PT_SYSEMU)
+	{ "PTRACE_SYSEMU",	PTRACE_BENCH_SYSEMU },
+#endif
+};
+
+#define PTRACE_BENCHES	(SIZEOF_ARRAY(ptrace_benches))
+
+/*
+ *  stress_ptrace_bench_child()
+ *	time raw getppid system calls, best of PTRACE_BENCH_RUNS runs
+ */
+static void NORETURN stress_ptrace_bench_child(
+	const stress_ptrace_bench_mode_t mode,
+	stress_ptrace_bench_shared_t *shared)
+{
+	double best = -1.0;
+	int run;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	if (mode != PTRACE_BENCH_NONE) {
+		if (ptrace(PTRACE_TRACEME) != 0)
+			_exit(EXIT_NO_RESOURCE);
+		(void)kill(getpid(), SIGSTOP);
+	}
+
+	for (run = 0; run < PTRACE_BENCH_RUNS; run++) {
+		double t, dt;
+		int i;
+
+		t = stress_time_now();
+		for (i = 0; i < PTRACE_BENCH_CALLS; i++) {
+#if defined(__NR_getppid)
+			VOID_RET(long, syscall(__NR_getppid));
+#else
+			VOID_RET(pid_t, getppid());
+#endif
+		}
+		dt = stress_time_now() - t;
+		if ((best < 0.0) || (dt < best))
+			best = dt;
+	}
+	shared->ns = (best * STRESS_NANOSECOND) / PTRACE_BENCH_CALLS;
+	shared->done = true;
+	/* Under PTRACE_SYSEMU exit only works once the tracer sees done */
+	for (;;)
+		_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_ptrace_bench_mode()
+ *	run one child under the given tracing mode, returns ns
+ *	per syscall or a negative value on failure
+ */
+static double stress_ptrace_bench_mode(
+	const stress_ptrace_bench_mode_t mode,
+	stress_ptrace_bench_shared_t *shared)
+{
+	pid_t pid;
+	int status;
+	bool ok = true;
+
+	shared->ns = -1.0;
+	shared->done = false;
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(errno))
+			goto again;
+		return -1.0;
+	} else if (pid == 0) {
+		stress_ptrace_bench_child(mode, shared);
+	}
+
+	for (;;) {
+		shim_ptrace_request req;
+		int sig = 0;
+
+		if (shim_waitpid(pid, &status, 0) < 0) {
+			if ((errno == EINTR) && keep_stressing_flag())
+				continue;
+			ok = false;
+			break;
+		}
+		if (WIFEXITED(status) || WIFSIGNALED(status))
+			break;
+		if (!WIFSTOPPED(status))
+			continue;
+		if (!keep_stressing_flag()) {
+			ok = false;
+			break;
+		}
+
+		if (WSTOPSIG(status) == SIGSTOP) {
+			/* initial stop after PTRACE_TRACEME */
+			if (ptrace(PTRACE_SETOPTIONS, pid, 0, PTRACE_O_TRACESYSGOOD) < 0) {
+				ok = false;
+				break;
+			}
+		} else if (!(WSTOPSIG(status) & 0x80)) {
+			sig = WSTOPSIG(status);
+		}
+
+		switch (mode) {
+		case PTRACE_BENCH_SYSCALL:
+			req = PTRACE_SYSCALL;
+			break;
+#if defined(PT_SYSEMU)
+		case PTRACE_BENCH_SYSEMU:
+			req = PTRACE_SYSEMU;
+			break;
+#endif
+		default:
+			req = PTRACE_CONT;
+			break;
+		}
+		/* let the child exit without further syscall stops */
+		if (shared->done)
+			req = PTRACE_CONT;
+		if (ptrace(req, pid, 0, sig) < 0) {
+			ok = false;
+			break;
+		}
+	}
+	if (!ok) {
+		(void)kill(pid, SIGKILL);
+		(void)shim_waitpid(pid, &status, 0);
+		return -1.0;
+	}
+	return shared->done ? shared->ns : -1.0;
+}
+
+/*
+ *  stress_ptrace_bench()
+ *	measure the cost added per system call by ptrace syscall
+ *	tracing and by PTRACE_SYSEMU syscall emulation
+ */
+static int stress_ptrace_bench(const stress_args_t *args)
+{
+	stress_ptrace_bench_shared_t *shared;
+	double pass[PTRACE_BENCHES], res[PTRACE_BENCHES];
+	size_t i;
+	bool done = false;
+
+	shared = (stress_ptrace_bench_shared_t *)mmap(NULL, args->page_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes, errno=%d (%s), skipping stressor\n",
+			args->name, args->page_size, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < PTRACE_BENCHES; i++) {
+			if (!keep_stressing(args))
+				goto finish;
+			pass[i] = stress_ptrace_bench_mode(ptrace_benches[i].mode, shared);
+		}
+		if (pass[PTRACE_BENCH_NONE] < 0.0) {
+			pr_fail("%s: untraced child failed to run\n", args->name);
+			break;
+		}
+		if (pass[PTRACE_BENCH_CONT] < 0.0) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: child cannot be traced, skipping stressor\n",
+					args->name);
+			(void)munmap((void *)shared, args->page_size);
+			stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+			return EXIT_NO_RESOURCE;
+		}
+		(void)memcpy(res, pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)shared, args->page_size);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: getppid cost per call, %d calls per run, best of %d runs\n",
+			args->name, PTRACE_BENCH_CALLS, PTRACE_BENCH_RUNS);
+		pr_inf("%s: %-15s %10s %10s\n", args->name, "tracing", "ns/call", "added ns");
+		for (i = 0; i < PTRACE_BENCHES; i++) {
+			if (res[i] < 0.0) {
+				pr_inf("%s: %-15s %10s %10s\n", args->name,
+					ptrace_benches[i].name, "-", "-");
+				continue;
+			}
+			pr_inf("%s: %-15s %10.1f %10.1f\n", args->name,
+				ptrace_benches[i].name, res[i], res[i] - res[0]);
+		}
+	}
+	if (done) {
+		for (i = 0; i < PTRACE_BENCHES; i++) {
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s ns/call", ptrace_benches[i].name);
+			stress_misc_stats_set(args->misc_stats, (int)i, str,
+				res[i] < 0.0 ? 0.0 : res[i]);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_ptrace()
  *	stress ptracing
@@ -78,6 +323,11 @@ static inline bool stress_syscall_wait(
 static int stress_ptrace(const stress_args_t *args)
 {
 	pid_t pid;
+	bool ptrace_bench = false;
+
+	(void)stress_get_setting("ptrace-bench", &ptrace_bench);
+	if (ptrace_bench)
+		return stress_ptrace_bench(args);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -202,12 +452,14 @@ stressor_info_t stress_ptrace_info = {
 	.stressor = stress_ptrace,
 	.class = CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_ptrace_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
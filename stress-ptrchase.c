@@ -0,0 +1,637 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-cache.h"
+#include "core-mem-backing.h"
+#include "core-ptrchase.h"
+
+#define MIN_PTRCHASE_BYTES	(4 * KB)
+#define MAX_PTRCHASE_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_PTRCHASE_BYTES	(64 * MB)	/* if no cache details */
+
+#define PTRCHASE_LINE_SIZE	(64)		/* default cache line size */
+#define PTRCHASE_MAX_LEVELS	(4)		/* L1..L4 */
+#define PTRCHASE_MAX_POINTS	(16)		/* working set sizes */
+#define PTRCHASE_LOADS		(1U << 20)	/* timed loads per size */
+#define PTRCHASE_MLP_MAX_CHAINS	(32)		/* most chains in lock-step */
+#define PTRCHASE_MLP_STARTS	(PTRCHASE_MLP_MAX_CHAINS * 2)
+
+#if defined(__linux__) &&	\
+    defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_AFFINITY)
+#define HAVE_PTRCHASE_MLP_SMT
+#endif
+
+/* Loads and time chasing one working set size */
+typedef struct {
+	uint64_t bytes;		/* working set size */
+	uint64_t loads;		/* timed dependent loads */
+	double duration;	/* time taken by the loads */
+} stress_ptrchase_point_t;
+
+/* Loads and time chasing k chains, alone and with the SMT sibling busy */
+typedef struct {
+	size_t k;		/* chains followed in lock-step */
+	uint64_t loads;		/* timed loads, this CPU alone */
+	double duration;	/* time taken by the loads */
+	uint64_t smt_loads;	/* timed loads, both SMT siblings */
+	double smt_duration;	/* time taken by the loads */
+} stress_ptrchase_mlp_t;
+
+#if defined(HAVE_PTRCHASE_MLP_SMT)
+/* Chains followed on the SMT sibling while this CPU is timed */
+typedef struct {
+	pthread_t pthread;	/* sibling thread */
+	int32_t cpu;		/* SMT sibling CPU */
+	size_t k;		/* chains followed in lock-step */
+	volatile bool ready;	/* set when pinned and about to chase */
+	volatile bool stop;	/* set at the end of the timed chase */
+	uint64_t loads;		/* loads done until stopped */
+	void *ptrs[PTRCHASE_MLP_MAX_CHAINS];
+} stress_ptrchase_sibling_t;
+#endif
+
+static const stress_help_t help[] = {
+	{ NULL,	"ptrchase N",		"start N workers measuring dependent load latency" },
+	{ NULL,	"ptrchase-ops N",	"stop after N sweeps of all the working set sizes" },
+	{ NULL,	"ptrchase-max-bytes N",	"largest working set size, default is 4 x LLC size" },
+	{ NULL,	"ptrchase-mlp",		"measure memory level parallelism with 1..32 chains" },
+	{ NULL,	NULL,			NULL }
+};
+
+static void * volatile ptrchase_sink;	/* keeps the chase live */
+
+static int stress_set_ptrchase_max_bytes(const char *opt)
+{
+	uint64_t ptrchase_max_bytes;
+
+	ptrchase_max_bytes = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("ptrchase-max-bytes", ptrchase_max_bytes,
+		MIN_PTRCHASE_BYTES, MAX_PTRCHASE_BYTES);
+	return stress_set_setting("ptrchase-max-bytes", TYPE_ID_UINT64, &ptrchase_max_bytes);
+}
+
+static int stress_set_ptrchase_mlp(const char *opt)
+{
+	return stress_set_setting_true("ptrchase-mlp", opt);
+}
+
+/*
+ *  stress_ptrchase_cache_sizes()
+ *	get the data cache sizes of each cache level and the
+ *	cache line size, returns the number of levels found
+ */
+static size_t stress_ptrchase_cache_sizes(
+	uint64_t cache_sizes[PTRCHASE_MAX_LEVELS],
+	size_t *line_size)
+{
+	size_t levels = 0;
+#if defined(__linux__)
+	stress_cpus_t *cpu_caches;
+	uint16_t level, max_cache_level;
+
+	cpu_caches = stress_get_all_cpu_cache_details();
+	if (!cpu_caches)
+		return 0;
+
+	max_cache_level = stress_get_max_cache_level(cpu_caches);
+	for (level = 1; (level <= max_cache_level) && (levels < PTRCHASE_MAX_LEVELS); level++) {
+		const stress_cpu_cache_t *cache = stress_get_cpu_cache(cpu_caches, level);
+
+		if (!cache || !cache->size)
+			break;
+		if ((level == 1) && cache->line_size)
+			*line_size = (size_t)cache->line_size;
+		cache_sizes[levels++] = cache->size;
+	}
+	stress_free_cpu_caches(cpu_caches);
+#else
+	(void)cache_sizes;
+	(void)line_size;
+#endif
+	return levels;
+}
+
+/*
+ *  stress_ptrchase_add_point()
+ *	add a working set size to the sorted list of sizes,
+ *	ignoring duplicates and sizes out of range
+ */
+static void stress_ptrchase_add_point(
+	stress_ptrchase_point_t *points,
+	size_t *n_points,
+	uint64_t bytes,
+	const uint64_t max_bytes,
+	const size_t line_size)
+{
+	size_t i, j;
+
+	bytes = STRESS_MINIMUM(bytes, max_bytes);
+	bytes -= bytes % line_size;
+	if ((bytes < MIN_PTRCHASE_BYTES) || (*n_points >= PTRCHASE_MAX_POINTS))
+		return;
+
+	for (i = 0; i < *n_points; i++) {
+		if (points[i].bytes == bytes)
+			return;
+		if (points[i].bytes > bytes)
+			break;
+	}
+	for (j = *n_points; j > i; j--)
+		points[j] = points[j - 1];
+	points[i].bytes = bytes;
+	points[i].loads = 0;
+	points[i].duration = 0.0;
+	(*n_points)++;
+}
+
+/*
+ *  stress_ptrchase_level()
+ *	name the cache level a working set size fits in
+ */
+static void stress_ptrchase_level(
+	char *str,
+	const size_t len,
+	const uint64_t bytes,
+	const uint64_t cache_sizes[PTRCHASE_MAX_LEVELS],
+	const size_t levels)
+{
+	size_t i;
+
+	for (i = 0; i < levels; i++) {
+		if (bytes <= cache_sizes[i]) {
+			(void)snprintf(str, len, "L%zu", i + 1);
+			return;
+		}
+	}
+	(void)shim_strlcpy(str, "memory", len);
+}
+
+/*
+ *  stress_ptrchase_verify()
+ *	check the chain is one cycle through all the lines
+ */
+static int stress_ptrchase_verify(
+	const stress_args_t *args,
+	uint8_t *buf,
+	const uint64_t bytes,
+	const size_t line_size)
+{
+	const uint64_t n = bytes / line_size;
+	void **p = (void **)buf;
+	uint64_t i;
+
+	for (i = 1; i <= n; i++) {
+		p = (void **)*p;
+		if ((void *)p == (void *)buf)
+			break;
+	}
+	if (i != n) {
+		pr_fail("%s: pointer chain of %" PRIu64 " lines has a cycle of "
+			"%" PRIu64 " lines\n", args->name, n, i);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ptrchase_mlp_starts()
+ *	walk the chain once and note PTRCHASE_MLP_STARTS evenly
+ *	spaced lines along it, chains started from these never
+ *	meet when followed in lock-step
+ */
+static void stress_ptrchase_mlp_starts(
+	uint8_t *buf,
+	const uint64_t lines,
+	void *starts[PTRCHASE_MLP_STARTS])
+{
+	const uint64_t gap = lines / PTRCHASE_MLP_STARTS;
+	void **p = (void **)buf;
+	size_t i;
+
+	for (i = 0; i < PTRCHASE_MLP_STARTS; i++) {
+		uint64_t j;
+
+		starts[i] = (void *)p;
+		for (j = 0; j < gap; j++)
+			p = (void **)*p;
+	}
+}
+
+#if defined(HAVE_PTRCHASE_MLP_SMT)
+/*
+ *  stress_ptrchase_smt_sibling()
+ *	find an SMT sibling of cpu, -1 if there is none
+ */
+static int32_t stress_ptrchase_smt_sibling(const int32_t cpu)
+{
+	char path[PATH_MAX], buf[256], *ptr = buf;
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/topology/thread_siblings_list", cpu);
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read(path, buf, sizeof(buf) - 1) <= 0)
+		return -1;
+
+	while (*ptr) {
+		char *end;
+		long lo, hi;
+
+		lo = strtol(ptr, &end, 10);
+		if (end == ptr)
+			break;
+		hi = lo;
+		ptr = end;
+		if (*ptr == '-') {
+			ptr++;
+			hi = strtol(ptr, &end, 10);
+			if (end == ptr)
+				break;
+			ptr = end;
+		}
+		for (; lo <= hi; lo++) {
+			if (lo != (long)cpu)
+				return (int32_t)lo;
+		}
+		if (*ptr != ',')
+			break;
+		ptr++;
+	}
+	return -1;
+}
+
+/*
+ *  stress_ptrchase_sibling_thread()
+ *	follow the sibling's chains until told to stop
+ */
+static void *stress_ptrchase_sibling_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_ptrchase_sibling_t *sibling = (stress_ptrchase_sibling_t *)arg;
+	const uint64_t steps = 256 / sibling->k;
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(sibling->cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	sibling->ready = true;
+	while (!sibling->stop) {
+		stress_ptrchase_chase_chains(sibling->ptrs, sibling->k, steps);
+		sibling->loads += steps * sibling->k;
+	}
+	ptrchase_sink = sibling->ptrs[0];
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_ptrchase_mlp_chase()
+ *	time PTRCHASE_LOADS loads over k chains in lock-step, with
+ *	the SMT sibling following k chains of its own if sibling_cpu
+ *	is not -1, returns false if the sibling could not be run
+ */
+static bool stress_ptrchase_mlp_chase(
+	stress_ptrchase_mlp_t *mlp,
+	void *starts[PTRCHASE_MLP_STARTS],
+	const int32_t sibling_cpu)
+{
+	const size_t k = mlp->k;
+	const size_t stride = PTRCHASE_MLP_STARTS / k;
+	const uint64_t steps = PTRCHASE_LOADS / k;
+	void *ptrs[PTRCHASE_MLP_MAX_CHAINS];
+	double t1, t2;
+	size_t i;
+
+	for (i = 0; i < k; i++)
+		ptrs[i] = starts[i * stride];
+
+	/* warm the TLB and caches with a short untimed chase */
+	stress_ptrchase_chase_chains(ptrs, k, steps / 16);
+
+	if (sibling_cpu < 0) {
+		t1 = stress_time_now();
+		stress_ptrchase_chase_chains(ptrs, k, steps);
+		t2 = stress_time_now();
+
+		mlp->loads += steps * k;
+		mlp->duration += t2 - t1;
+	} else {
+#if defined(HAVE_PTRCHASE_MLP_SMT)
+		stress_ptrchase_sibling_t sibling;
+
+		(void)memset(&sibling, 0, sizeof(sibling));
+		sibling.cpu = sibling_cpu;
+		sibling.k = k;
+		for (i = 0; i < k; i++)
+			sibling.ptrs[i] = starts[(i * stride) + (stride / 2)];
+		if (pthread_create(&sibling.pthread, NULL,
+				   stress_ptrchase_sibling_thread, &sibling) != 0)
+			return false;
+		while (!sibling.ready)
+			(void)shim_sched_yield();
+
+		t1 = stress_time_now();
+		stress_ptrchase_chase_chains(ptrs, k, steps);
+		t2 = stress_time_now();
+		sibling.stop = true;
+		(void)pthread_join(sibling.pthread, NULL);
+
+		mlp->smt_loads += (steps * k) + sibling.loads;
+		mlp->smt_duration += t2 - t1;
+#else
+		return false;
+#endif
+	}
+	ptrchase_sink = ptrs[0];
+	return true;
+}
+
+/*
+ *  stress_ptrchase_mlp()
+ *	follow 1..32 independent chains in lock-step through a working
+ *	set much larger than the caches, the load throughput against
+ *	the single chain latency gives the number of outstanding misses
+ *	the core sustains, alone and with its SMT sibling also chasing
+ */
+static int stress_ptrchase_mlp(
+	const stress_args_t *args,
+	uint8_t *buf,
+	uint32_t *idx,
+	const uint64_t bytes,
+	const size_t line_size)
+{
+	stress_ptrchase_mlp_t mlps[6];
+	void *starts[PTRCHASE_MLP_STARTS];
+	const uint64_t lines = bytes / line_size;
+	const size_t n_mlps = SIZEOF_ARRAY(mlps);
+	int32_t sibling_cpu = -1;
+	double lat1 = 0.0, max_mlp = 0.0, max_rate = 0.0;
+	double max_smt_mlp = 0.0, max_smt_rate = 0.0;
+	size_t i;
+
+	if (lines < PTRCHASE_MLP_STARTS) {
+		pr_inf_skip("%s: working set of %" PRIu64 " lines is too small for "
+			"%d chains, skipping stressor\n", args->name, lines,
+			PTRCHASE_MLP_STARTS);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(mlps, 0, sizeof(mlps));
+	for (i = 0; i < n_mlps; i++)
+		mlps[i].k = (size_t)1 << i;
+
+#if defined(HAVE_PTRCHASE_MLP_SMT)
+	{
+		/* stay on this CPU so the sibling stays the sibling */
+		const int32_t cpu = (int32_t)stress_get_cpu();
+		cpu_set_t mask;
+
+		CPU_ZERO(&mask);
+		CPU_SET(cpu, &mask);
+		if (sched_setaffinity(0, sizeof(mask), &mask) == 0)
+			sibling_cpu = stress_ptrchase_smt_sibling(cpu);
+	}
+#endif
+	if ((args->instance == 0) && (sibling_cpu < 0))
+		pr_inf("%s: no SMT sibling found, measuring this CPU alone\n",
+			args->name);
+
+	stress_ptrchase_build(buf, idx, bytes, line_size);
+	if ((g_opt_flags & OPT_FLAGS_VERIFY) &&
+	    (stress_ptrchase_verify(args, buf, bytes, line_size) < 0))
+		return EXIT_FAILURE;
+	stress_ptrchase_mlp_starts(buf, lines, starts);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; keep_stressing(args) && (i < n_mlps); i++) {
+			(void)stress_ptrchase_mlp_chase(&mlps[i], starts, -1);
+			if ((sibling_cpu >= 0) &&
+			    !stress_ptrchase_mlp_chase(&mlps[i], starts, sibling_cpu))
+				sibling_cpu = -1;
+		}
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	if (mlps[0].loads)
+		lat1 = (mlps[0].duration * (double)STRESS_NANOSECOND) / (double)mlps[0].loads;
+
+	for (i = 0; i < n_mlps; i++) {
+		const stress_ptrchase_mlp_t *mlp = &mlps[i];
+		double ns, rate, mlp_val, smt_rate = 0.0, smt_mlp = 0.0;
+
+		if (!mlp->loads || (mlp->duration <= 0.0))
+			continue;
+
+		ns = (mlp->duration * (double)STRESS_NANOSECOND) / (double)mlp->loads;
+		rate = (double)mlp->loads / mlp->duration;
+		/* Little's law, outstanding loads = latency x throughput */
+		mlp_val = lat1 * rate / (double)STRESS_NANOSECOND;
+		max_mlp = STRESS_MAXIMUM(max_mlp, mlp_val);
+		max_rate = STRESS_MAXIMUM(max_rate, rate);
+		if (mlp->smt_loads && (mlp->smt_duration > 0.0)) {
+			smt_rate = (double)mlp->smt_loads / mlp->smt_duration;
+			smt_mlp = lat1 * smt_rate / (double)STRESS_NANOSECOND;
+			max_smt_mlp = STRESS_MAXIMUM(max_smt_mlp, smt_mlp);
+			max_smt_rate = STRESS_MAXIMUM(max_smt_rate, smt_rate);
+		}
+
+		if (args->instance != 0)
+			continue;
+		if (i == 0)
+			pr_inf("%s: %6s %9s %10s %6s %14s %8s\n", args->name,
+				"chains", "ns/load", "Mloads/s", "MLP",
+				"SMT Mloads/s", "SMT MLP");
+		if (smt_rate > 0.0)
+			pr_inf("%s: %6zu %9.2f %10.2f %6.2f %14.2f %8.2f\n",
+				args->name, mlp->k, ns, rate / 1.0E6, mlp_val,
+				smt_rate / 1.0E6, smt_mlp);
+		else
+			pr_inf("%s: %6zu %9.2f %10.2f %6.2f %14s %8s\n",
+				args->name, mlp->k, ns, rate / 1.0E6, mlp_val,
+				"-", "-");
+	}
+
+	stress_misc_stats_set(args->misc_stats, 0, "ns per load 1 chain", lat1);
+	stress_misc_stats_set(args->misc_stats, 1, "max MLP per core", max_mlp);
+	stress_misc_stats_set(args->misc_stats, 2, "max Mloads/s per core", max_rate / 1.0E6);
+	if (max_smt_rate > 0.0) {
+		stress_misc_stats_set(args->misc_stats, 3, "max MLP per core with SMT", max_smt_mlp);
+		stress_misc_stats_set(args->misc_stats, 4, "max Mloads/s with SMT", max_smt_rate / 1.0E6);
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_ptrchase()
+ *	stress memory with dependent loads, measuring the
+ *	load to use latency over a sweep of working set sizes
+ */
+static int stress_ptrchase(const stress_args_t *args)
+{
+	uint64_t cache_sizes[PTRCHASE_MAX_LEVELS];
+	uint64_t ptrchase_max_bytes = 0;
+	stress_ptrchase_point_t points[PTRCHASE_MAX_POINTS];
+	size_t line_size = PTRCHASE_LINE_SIZE;
+	size_t levels, n_points = 0, i, buf_sz, idx_sz;
+	uint8_t *buf;
+	uint32_t *idx;
+	int rc = EXIT_SUCCESS;
+	bool header = false, ptrchase_mlp = false;
+
+	(void)memset(cache_sizes, 0, sizeof(cache_sizes));
+	levels = stress_ptrchase_cache_sizes(cache_sizes, &line_size);
+	if (line_size < sizeof(void *))
+		line_size = sizeof(void *);
+
+	(void)stress_get_setting("ptrchase-mlp", &ptrchase_mlp);
+	if (!stress_get_setting("ptrchase-max-bytes", &ptrchase_max_bytes)) {
+		ptrchase_max_bytes = levels ? cache_sizes[levels - 1] * 4 : DEFAULT_PTRCHASE_BYTES;
+		if (args->instance == 0) {
+			if (levels)
+				pr_inf("%s: using CPU L%zu cache size of %" PRIu64 "K\n",
+					args->name, levels, cache_sizes[levels - 1] / (uint64_t)KB);
+			else
+				pr_inf("%s: cannot determine CPU cache sizes, defaulting to "
+					"a sweep up to %" PRIu64 "MB\n", args->name,
+					ptrchase_max_bytes / (uint64_t)MB);
+		}
+	}
+
+	/*
+	 *  Sweep from a page up, with a size well inside and a
+	 *  size just past each cache level
+	 */
+	stress_ptrchase_add_point(points, &n_points, MIN_PTRCHASE_BYTES, ptrchase_max_bytes, line_size);
+	for (i = 0; i < levels; i++) {
+		stress_ptrchase_add_point(points, &n_points, cache_sizes[i] / 2, ptrchase_max_bytes, line_size);
+		stress_ptrchase_add_point(points, &n_points, cache_sizes[i] * 2, ptrchase_max_bytes, line_size);
+	}
+	if (!levels) {
+		uint64_t bytes;
+
+		for (bytes = 16 * KB; bytes < ptrchase_max_bytes; bytes *= 4)
+			stress_ptrchase_add_point(points, &n_points, bytes, ptrchase_max_bytes, line_size);
+	}
+	stress_ptrchase_add_point(points, &n_points, ptrchase_max_bytes, ptrchase_max_bytes, line_size);
+	if (!n_points) {
+		pr_inf_skip("%s: no working set sizes to sweep, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	buf_sz = (size_t)points[n_points - 1].bytes;
+	buf = (uint8_t *)stress_mem_backing_mmap(args, &buf_sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %" PRIu64 " bytes, errno=%d (%s), "
+			"skipping stressor\n", args->name,
+			points[n_points - 1].bytes, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	idx_sz = (size_t)(points[n_points - 1].bytes / line_size) * sizeof(*idx);
+	idx = (uint32_t *)mmap(NULL, idx_sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (idx == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), "
+			"skipping stressor\n", args->name,
+			idx_sz, errno, strerror(errno));
+		(void)munmap((void *)buf, buf_sz);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if (ptrchase_mlp) {
+		rc = stress_ptrchase_mlp(args, buf, idx, points[n_points - 1].bytes, line_size);
+		goto done;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; keep_stressing(args) && (i < n_points); i++) {
+			stress_ptrchase_point_t *point = &points[i];
+			const uint64_t lines = point->bytes / line_size;
+			double t1, t2;
+			void *p;
+
+			stress_ptrchase_build(buf, idx, point->bytes, line_size);
+			if ((g_opt_flags & OPT_FLAGS_VERIFY) &&
+			    (stress_ptrchase_verify(args, buf, point->bytes, line_size) < 0)) {
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+
+			/* warm the caches and TLB with a lap of the chain, untimed */
+			p = stress_ptrchase_chase((void *)buf,
+				(STRESS_MINIMUM(lines, PTRCHASE_LOADS) + 7) & ~(uint64_t)7);
+
+			t1 = stress_time_now();
+			p = stress_ptrchase_chase(p, PTRCHASE_LOADS);
+			t2 = stress_time_now();
+
+			ptrchase_sink = p;
+			point->loads += PTRCHASE_LOADS;
+			point->duration += t2 - t1;
+		}
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	for (i = 0; i < n_points; i++) {
+		const stress_ptrchase_point_t *point = &points[i];
+		const double ns = (point->loads > 0) ?
+			(point->duration * (double)STRESS_NANOSECOND) / (double)point->loads : 0.0;
+		char size[16], level[8], desc[48];
+
+		if (!point->loads)
+			continue;
+
+		(void)stress_uint64_to_str(size, sizeof(size), point->bytes);
+		stress_ptrchase_level(level, sizeof(level), point->bytes, cache_sizes, levels);
+		if (args->instance == 0) {
+			if (!header)
+				pr_inf("%s: %10s %-7s %12s\n", args->name,
+					"size", "level", "ns per load");
+			header = true;
+			pr_inf("%s: %10s %-7s %12.2f\n", args->name, size, level, ns);
+		}
+		(void)snprintf(desc, sizeof(desc), "ns per load %s %s", size, level);
+		stress_misc_stats_set(args->misc_stats, i, desc, ns);
+	}
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	(void)munmap((void *)idx, idx_sz);
+	(void)munmap((void *)buf, buf_sz);
+
+	return rc;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_ptrchase_max_bytes,	stress_set_ptrchase_max_bytes },
+	{ OPT_ptrchase_mlp,		stress_set_ptrchase_mlp },
+	{ 0,				NULL }
+};
+
+stressor_info_t stress_ptrchase_info = {
+	.stressor = stress_ptrchase,
+	.class = CLASS_CPU_CACHE | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
@@ -45,6 +45,10 @@
 #include <netinet/ip.h>
 #endif
 
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
 #include <arpa/inet.h>
 
 #define MIN_RAWPKT_PORT		(1024)
@@ -58,8 +62,10 @@
 
 static const stress_help_t help[] = {
 	{ NULL, "rawpkt N",		"start N workers exercising raw packets" },
+	{ NULL,	"rawpkt-if I",		"use network interface I, e.g. lo, veth0, etc." },
 	{ NULL,	"rawpkt-ops N",		"stop after N raw packet bogo operations" },
 	{ NULL,	"rawpkt-port P",	"use raw packet ports P to P + number of workers - 1" },
+	{ NULL,	"rawpkt-ring",		"use mmap'd tx and rx rings, report Mpps per frame size" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -92,8 +98,20 @@ static int stress_set_port(const char *opt)
 	return stress_set_setting("rawpkt-port", TYPE_ID_INT, &port);
 }
 
+static int stress_set_rawpkt_if(const char *name)
+{
+	return stress_set_setting("rawpkt-if", TYPE_ID_STR, name);
+}
+
+static int stress_set_rawpkt_ring(const char *opt)
+{
+	return stress_set_setting_true("rawpkt-ring", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_rawpkt_if,	stress_set_rawpkt_if },
 	{ OPT_rawpkt_port,	stress_set_port },
+	{ OPT_rawpkt_ring,	stress_set_rawpkt_ring },
 	{ 0,			NULL }
 };
 
@@ -398,6 +416,337 @@ die:
 	return rc;
 }
 
+#if defined(PACKET_VERSION) &&		\
+    defined(PACKET_TX_RING) &&		\
+    defined(PACKET_RX_RING) &&		\
+    defined(TP_STATUS_BLK_TMO) &&	\
+    defined(HAVE_POLL_H)
+#define STRESS_RAWPKT_RING
+
+#define RAWPKT_TX_FRAME_SIZE	(2048)
+#define RAWPKT_TX_BLOCK_SIZE	(64 * KB)
+#define RAWPKT_TX_BLOCKS	(8)	/* 256 frames */
+#define RAWPKT_RX_BLOCK_SIZE	(256 * KB)
+#define RAWPKT_RX_BLOCKS	(16)
+#define RAWPKT_RX_BLOCK_TMO	(10)	/* ms before a partial block is retired */
+#define RAWPKT_RING_ROUND	(1.0)	/* seconds per frame size */
+
+/* ethernet frame sizes without the FCS */
+static const size_t rawpkt_ring_sizes[] = { 64, 128, 256, 512, 1024, 1514 };
+
+/*
+ *  frame counts shared by the tx ring sender and the rx ring receiver
+ */
+typedef struct {
+	uint64_t tx_frames[SIZEOF_ARRAY(rawpkt_ring_sizes)];
+	double tx_time[SIZEOF_ARRAY(rawpkt_ring_sizes)];
+} stress_rawpkt_ring_t;
+
+/*
+ *  stress_rawpkt_ring_mmap()
+ *	set the packet version, setup and mmap a tx or rx ring
+ */
+static void *stress_rawpkt_ring_mmap(
+	const stress_args_t *args,
+	const int fd,
+	const int version,
+	const int ring,
+	void *req,
+	const socklen_t req_len,
+	const size_t size)
+{
+	void *ptr;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		pr_inf_skip("%s: cannot set packet version %d, errno=%d (%s), "
+			"skipping stressor\n", args->name, version + 1, errno, strerror(errno));
+		return MAP_FAILED;
+	}
+	if (setsockopt(fd, SOL_PACKET, ring, req, req_len) < 0) {
+		pr_inf_skip("%s: cannot setup %s ring, errno=%d (%s), "
+			"skipping stressor\n", args->name,
+			(ring == PACKET_TX_RING) ? "tx" : "rx" , errno, strerror(errno));
+		return MAP_FAILED;
+	}
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (ptr == MAP_FAILED)
+		pr_inf_skip("%s: cannot mmap %s ring, errno=%d (%s), "
+			"skipping stressor\n", args->name,
+			(ring == PACKET_TX_RING) ? "tx" : "rx" , errno, strerror(errno));
+	return ptr;
+}
+
+/*
+ *  stress_rawpkt_ring_client()
+ *	fill a TPACKET_V2 tx ring with UDP frames and flush it,
+ *	sweeping through the frame sizes a round at a time
+ */
+static void NORETURN stress_rawpkt_ring_client(
+	const stress_args_t *args,
+	struct ifreq *hwaddr,
+	const uint32_t addr,
+	struct ifreq *idx,
+	const int port,
+	const int mtu,
+	stress_rawpkt_ring_t *ring)
+{
+	const size_t size = RAWPKT_TX_BLOCK_SIZE * RAWPKT_TX_BLOCKS;
+	const size_t frames = size / RAWPKT_TX_FRAME_SIZE;
+	const size_t data_off = TPACKET_ALIGN(sizeof(struct tpacket2_hdr));
+	struct tpacket_req req;
+	struct sockaddr_ll sadr;
+	uint8_t *tx_ring;
+	size_t frame = 0, i = 0;
+	uint16_t id = 12345;
+	int fd, rc = EXIT_FAILURE;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	/* protocol 0, the sender does not receive any frames */
+	if ((fd = socket(PF_PACKET, SOCK_RAW, 0)) < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	(void)memset(&sadr, 0, sizeof(sadr));
+	sadr.sll_family = AF_PACKET;
+	sadr.sll_ifindex = idx->ifr_ifindex;
+	if (bind(fd, (struct sockaddr *)&sadr, sizeof(sadr)) < 0) {
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_fd;
+	}
+#if defined(PACKET_QDISC_BYPASS)
+	{
+		const int one = 1;
+
+		(void)setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+	}
+#endif
+	(void)memset(&req, 0, sizeof(req));
+	req.tp_block_size = RAWPKT_TX_BLOCK_SIZE;
+	req.tp_block_nr = RAWPKT_TX_BLOCKS;
+	req.tp_frame_size = RAWPKT_TX_FRAME_SIZE;
+	req.tp_frame_nr = (unsigned int)frames;
+	tx_ring = (uint8_t *)stress_rawpkt_ring_mmap(args, fd, TPACKET_V2,
+		PACKET_TX_RING, &req, sizeof(req), size);
+	if (tx_ring == MAP_FAILED) {
+		rc = EXIT_NO_RESOURCE;
+		goto close_fd;
+	}
+
+	while (keep_stressing_flag()) {
+		const size_t len = rawpkt_ring_sizes[i];
+		const double t_start = stress_time_now();
+		const double t_end = t_start + RAWPKT_RING_ROUND;
+		double t;
+
+		/* frames larger than the interface MTU are not sent */
+		if (len > (size_t)mtu + sizeof(struct ethhdr)) {
+			i = (i + 1) % SIZEOF_ARRAY(rawpkt_ring_sizes);
+			continue;
+		}
+		do {
+			uint64_t queued = 0;
+
+			while (queued < frames) {
+				struct tpacket2_hdr *hdr =
+					(struct tpacket2_hdr *)(tx_ring + (frame * RAWPKT_TX_FRAME_SIZE));
+				uint8_t *buf = (uint8_t *)hdr + data_off;
+				struct ethhdr *eth = (struct ethhdr *)buf;
+				struct iphdr *ip = (struct iphdr *)(buf + sizeof(struct ethhdr));
+				struct udphdr *udp = (struct udphdr *)((uint8_t *)ip + sizeof(struct iphdr));
+
+				if (hdr->tp_status != TP_STATUS_AVAILABLE)
+					break;
+				(void)memset(buf, 0, len);
+				(void)memcpy(eth->h_dest, hwaddr->ifr_addr.sa_data, sizeof(eth->h_dest));
+				(void)memcpy(eth->h_source, hwaddr->ifr_addr.sa_data, sizeof(eth->h_source));
+				eth->h_proto = htons(ETH_P_IP);
+				ip->ihl = 5;
+				ip->version = 4;
+				ip->tot_len = htons((uint16_t)(len - sizeof(struct ethhdr)));
+				ip->id = htons(id++);
+				ip->ttl = 16;
+				ip->protocol = SOL_UDP;
+				ip->saddr = addr;
+				ip->daddr = addr;
+				ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(struct iphdr));
+				udp->source = htons(port);
+				udp->dest = htons(port);
+				udp->len = htons((uint16_t)(len - sizeof(struct ethhdr) - sizeof(struct iphdr)));
+
+				hdr->tp_len = (uint32_t)len;
+				shim_mb();
+				hdr->tp_status = TP_STATUS_SEND_REQUEST;
+				frame = (frame + 1) % frames;
+				queued++;
+			}
+			/* blocking flush, returns once the queued frames are sent */
+			if (send(fd, NULL, 0, 0) < 0) {
+				if ((errno != ENOBUFS) && (errno != EAGAIN) && (errno != EINTR)) {
+					pr_fail("%s: tx ring send failed on port %d, errno=%d (%s)\n",
+						args->name, port, errno, strerror(errno));
+					goto unmap;
+				}
+			}
+			ring->tx_frames[i] += queued;
+			t = stress_time_now();
+		} while (keep_stressing_flag() && (t < t_end));
+		ring->tx_time[i] += t - t_start;
+		i = (i + 1) % SIZEOF_ARRAY(rawpkt_ring_sizes);
+	}
+	rc = EXIT_SUCCESS;
+unmap:
+	(void)munmap((void *)tx_ring, size);
+close_fd:
+	(void)close(fd);
+err:
+	_exit(rc);
+}
+
+/*
+ *  stress_rawpkt_ring_server()
+ *	walk the TPACKET_V3 rx ring blocks counting the
+ *	sender's frames by frame size
+ */
+static int stress_rawpkt_ring_server(
+	const stress_args_t *args,
+	struct ifreq *idx,
+	const uint32_t addr,
+	const int port,
+	uint64_t *rx_frames)
+{
+	const size_t size = RAWPKT_RX_BLOCK_SIZE * RAWPKT_RX_BLOCKS;
+	struct tpacket_req3 req;
+	struct sockaddr_ll sadr;
+	uint8_t *rx_ring;
+	size_t block = 0;
+	int fd, rc = EXIT_SUCCESS;
+
+	if ((fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_IP))) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return rc;
+	}
+	(void)memset(&sadr, 0, sizeof(sadr));
+	sadr.sll_family = AF_PACKET;
+	sadr.sll_protocol = htons(ETH_P_IP);
+	sadr.sll_ifindex = idx->ifr_ifindex;
+	if (bind(fd, (struct sockaddr *)&sadr, sizeof(sadr)) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_fd;
+	}
+#if defined(PACKET_IGNORE_OUTGOING)
+	{
+		const int one = 1;
+
+		(void)setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+	}
+#endif
+	(void)memset(&req, 0, sizeof(req));
+	req.tp_block_size = RAWPKT_RX_BLOCK_SIZE;
+	req.tp_block_nr = RAWPKT_RX_BLOCKS;
+	req.tp_frame_size = RAWPKT_TX_FRAME_SIZE;
+	req.tp_frame_nr = (unsigned int)(size / RAWPKT_TX_FRAME_SIZE);
+	req.tp_retire_blk_tov = RAWPKT_RX_BLOCK_TMO;
+	rx_ring = (uint8_t *)stress_rawpkt_ring_mmap(args, fd, TPACKET_V3,
+		PACKET_RX_RING, &req, sizeof(req), size);
+	if (rx_ring == MAP_FAILED) {
+		rc = EXIT_NO_RESOURCE;
+		goto close_fd;
+	}
+
+	do {
+		struct tpacket_block_desc *desc =
+			(struct tpacket_block_desc *)(rx_ring + (block * RAWPKT_RX_BLOCK_SIZE));
+		const struct tpacket3_hdr *hdr;
+		uint32_t i;
+
+		if (!(desc->hdr.bh1.block_status & TP_STATUS_USER)) {
+			struct pollfd pfd;
+
+			pfd.fd = fd;
+			pfd.events = POLLIN | POLLERR;
+			pfd.revents = 0;
+			(void)poll(&pfd, 1, 100);
+			continue;
+		}
+		shim_mb();
+		hdr = (const struct tpacket3_hdr *)((uint8_t *)desc + desc->hdr.bh1.offset_to_first_pkt);
+		for (i = 0; i < desc->hdr.bh1.num_pkts; i++) {
+			const uint8_t *buf = (const uint8_t *)hdr + hdr->tp_mac;
+			const struct ethhdr *eth = (const struct ethhdr *)buf;
+			const struct iphdr *ip = (const struct iphdr *)(buf + sizeof(struct ethhdr));
+			const struct udphdr *udp = (const struct udphdr *)((const uint8_t *)ip + sizeof(struct iphdr));
+			size_t j;
+
+			if ((hdr->tp_snaplen >= sizeof(struct ethhdr) + sizeof(struct iphdr) + sizeof(struct udphdr)) &&
+			    (eth->h_proto == htons(ETH_P_IP)) &&
+			    (ip->saddr == addr) &&
+			    (ip->protocol == SOL_UDP) &&
+			    (ntohs(udp->source) == port)) {
+				for (j = 0; j < SIZEOF_ARRAY(rawpkt_ring_sizes); j++) {
+					if (hdr->tp_len == rawpkt_ring_sizes[j]) {
+						rx_frames[j]++;
+						break;
+					}
+				}
+				inc_counter(args);
+			}
+			hdr = (const struct tpacket3_hdr *)((const uint8_t *)hdr + hdr->tp_next_offset);
+		}
+		shim_mb();
+		desc->hdr.bh1.block_status = TP_STATUS_KERNEL;
+		shim_mb();
+		block = (block + 1) % RAWPKT_RX_BLOCKS;
+	} while (keep_stressing(args));
+
+	(void)munmap((void *)rx_ring, size);
+close_fd:
+	(void)close(fd);
+
+	return rc;
+}
+
+/*
+ *  stress_rawpkt_ring_report()
+ *	report the tx and rx packet rates per frame size
+ */
+static void stress_rawpkt_ring_report(
+	const stress_args_t *args,
+	const stress_rawpkt_ring_t *ring,
+	const uint64_t *rx_frames)
+{
+	size_t i;
+
+	if (args->instance == 0)
+		pr_inf("%s: frame size  tx Mpps  rx Mpps  rx Gb/s   loss %%\n", args->name);
+	for (i = 0; i < SIZEOF_ARRAY(rawpkt_ring_sizes); i++) {
+		const double t = ring->tx_time[i];
+		const double tx_mpps = (t > 0.0) ? (double)ring->tx_frames[i] / t / 1000000.0 : 0.0;
+		const double rx_mpps = (t > 0.0) ? (double)rx_frames[i] / t / 1000000.0 : 0.0;
+		const double loss = ring->tx_frames[i] ? 100.0 - (100.0 * (double)rx_frames[i] /
+			(double)ring->tx_frames[i]) : 0.0;
+		char desc[40];
+
+		if (t <= 0.0)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %10zu %8.3f %8.3f %8.3f %8.2f\n", args->name,
+				rawpkt_ring_sizes[i], tx_mpps, rx_mpps,
+				rx_mpps * (double)rawpkt_ring_sizes[i] * 8.0 / 1000.0,
+				loss > 0.0 ? loss : 0.0);
+		(void)snprintf(desc, sizeof(desc), "%zu byte frame rx Mpps", rawpkt_ring_sizes[i]);
+		stress_misc_stats_set(args->misc_stats, (int)i, desc, rx_mpps);
+	}
+}
+#endif
+
 static void stress_sock_sigpipe_handler(int signum)
 {
 	(void)signum;
@@ -413,16 +762,35 @@ static int stress_rawpkt(const stress_args_t *args)
 {
 	pid_t pid;
 	int rawpkt_port = DEFAULT_RAWPKT_PORT;
-	int fd, rc = EXIT_FAILURE;
+	int fd, rc = EXIT_FAILURE, mtu = 1500;
 	struct ifreq hwaddr, ifaddr, idx;
+	char *rawpkt_if = NULL;
+	const char *ifname;
+	bool rawpkt_ring = false;
+#if defined(STRESS_RAWPKT_RING)
+	stress_rawpkt_ring_t *ring = NULL;
+	uint64_t rx_frames[SIZEOF_ARRAY(rawpkt_ring_sizes)];
+#endif
+	uint32_t addr;
 
+	(void)stress_get_setting("rawpkt-if", &rawpkt_if);
 	(void)stress_get_setting("rawpkt-port", &rawpkt_port);
+	(void)stress_get_setting("rawpkt-ring", &rawpkt_ring);
 
 	rawpkt_port += args->instance;
 
 	pr_dbg("%s: process [%d] using socket port %d\n",
 		args->name, (int)args->pid, rawpkt_port);
 
+#if !defined(STRESS_RAWPKT_RING)
+	if (rawpkt_ring) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: --rawpkt-ring requires TPACKET_V3 packet "
+				"ring support, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+
 	if (stress_sighandler(args->name, SIGPIPE, stress_sock_sigpipe_handler, NULL) < 0)
 		return EXIT_NO_RESOURCE;
 
@@ -431,34 +799,74 @@ static int stress_rawpkt(const stress_args_t *args)
 			args->name, errno, strerror(errno));
 		return EXIT_FAILURE;
 	}
+	if (rawpkt_if) {
+		(void)memset(&idx, 0, sizeof(idx));
+		(void)shim_strlcpy(idx.ifr_name, rawpkt_if, sizeof(idx.ifr_name));
+		if (ioctl(fd, SIOCGIFINDEX, &idx) < 0) {
+			pr_inf("%s: interface '%s' does not exist, defaulting to using loopback\n",
+				args->name, rawpkt_if);
+			rawpkt_if = NULL;
+		}
+	}
+	ifname = rawpkt_if ? rawpkt_if : "lo";
+
 	(void)memset(&hwaddr, 0, sizeof(hwaddr));
-	(void)shim_strlcpy(hwaddr.ifr_name, "lo", sizeof(hwaddr.ifr_name));
+	(void)shim_strlcpy(hwaddr.ifr_name, ifname, sizeof(hwaddr.ifr_name));
 	if (ioctl(fd, SIOCGIFHWADDR, &hwaddr) < 0) {
-		pr_fail("%s: ioctl SIOCGIFHWADDR on lo failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
+		pr_fail("%s: ioctl SIOCGIFHWADDR on %s failed, errno=%d (%s)\n",
+			args->name, ifname, errno, strerror(errno));
 		(void)close(fd);
 		return EXIT_FAILURE;
 	}
 
 	(void)memset(&ifaddr, 0, sizeof(ifaddr));
-	(void)shim_strlcpy(ifaddr.ifr_name, "lo", sizeof(ifaddr.ifr_name));
+	(void)shim_strlcpy(ifaddr.ifr_name, ifname, sizeof(ifaddr.ifr_name));
 	if (ioctl(fd, SIOCGIFADDR, &ifaddr) < 0) {
-		pr_fail("%s: ioctl SIOCGIFADDR on lo failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
-		(void)close(fd);
-		return EXIT_FAILURE;
+		if (!rawpkt_ring) {
+			pr_fail("%s: ioctl SIOCGIFADDR on %s failed, errno=%d (%s)\n",
+				args->name, ifname, errno, strerror(errno));
+			(void)close(fd);
+			return EXIT_FAILURE;
+		}
+		/* ring frames don't need a configured address, use TEST-NET-1 */
+		((struct sockaddr_in *)&ifaddr.ifr_addr)->sin_addr.s_addr = inet_addr("192.0.2.1");
 	}
+	addr = ((struct sockaddr_in *)&ifaddr.ifr_addr)->sin_addr.s_addr;
 
 	(void)memset(&idx, 0, sizeof(idx));
-	(void)shim_strlcpy(idx.ifr_name, "lo", sizeof(idx.ifr_name));
+	(void)shim_strlcpy(idx.ifr_name, ifname, sizeof(idx.ifr_name));
 	if (ioctl(fd, SIOCGIFINDEX, &idx) < 0) {
-		pr_fail("%s: ioctl SIOCGIFINDEX on lo failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
+		pr_fail("%s: ioctl SIOCGIFINDEX on %s failed, errno=%d (%s)\n",
+			args->name, ifname, errno, strerror(errno));
 		(void)close(fd);
 		return EXIT_FAILURE;
 	}
+#if defined(SIOCGIFMTU)
+	{
+		struct ifreq ifmtu;
+
+		(void)memset(&ifmtu, 0, sizeof(ifmtu));
+		(void)shim_strlcpy(ifmtu.ifr_name, ifname, sizeof(ifmtu.ifr_name));
+		if (ioctl(fd, SIOCGIFMTU, &ifmtu) == 0)
+			mtu = ifmtu.ifr_mtu;
+	}
+#endif
 	(void)close(fd);
 
+#if defined(STRESS_RAWPKT_RING)
+	if (rawpkt_ring) {
+		ring = (stress_rawpkt_ring_t *)mmap(NULL, sizeof(*ring),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (ring == MAP_FAILED) {
+			pr_inf_skip("%s: cannot mmap ring frame counts, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+			return EXIT_NO_RESOURCE;
+		}
+		(void)memset(ring, 0, sizeof(*ring));
+		(void)memset(rx_frames, 0, sizeof(rx_frames));
+	}
+#endif
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 again:
 	pid = fork();
@@ -471,18 +879,37 @@ again:
 		}
 		pr_fail("%s: fork failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
-		return rc;
+		goto finish;
 	} else if (pid == 0) {
+#if defined(STRESS_RAWPKT_RING)
+		if (rawpkt_ring)
+			stress_rawpkt_ring_client(args, &hwaddr, addr, &idx,
+				rawpkt_port, mtu, ring);
+#endif
 		stress_rawpkt_client(args, &hwaddr, &ifaddr, &idx, args->pid, rawpkt_port);
 	} else {
 		int status;
 
-		rc = stress_rawpkt_server(args, &ifaddr, rawpkt_port);
+#if defined(STRESS_RAWPKT_RING)
+		if (rawpkt_ring)
+			rc = stress_rawpkt_ring_server(args, &idx, addr,
+				rawpkt_port, rx_frames);
+		else
+#endif
+			rc = stress_rawpkt_server(args, &ifaddr, rawpkt_port);
 		(void)kill(pid, SIGKILL);
 		(void)shim_waitpid(pid, &status, 0);
+#if defined(STRESS_RAWPKT_RING)
+		if (rawpkt_ring && (rc == EXIT_SUCCESS))
+			stress_rawpkt_ring_report(args, ring, rx_frames);
+#endif
 	}
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+#if defined(STRESS_RAWPKT_RING)
+	if (ring)
+		(void)munmap((void *)ring, sizeof(*ring));
+#endif
 
 	return rc;
 }
@@ -18,18 +18,35 @@
  *
  */
 #include "stress-ng.h"
+#include "core-capabilities.h"
+#include "core-io-buf.h"
+
+#if defined(HAVE_LINUX_FS_H)
+#include <linux/fs.h>
+#endif
+
+#if defined(HAVE_SYS_SYSMACROS_H)
+#include <sys/sysmacros.h>
+#endif
 
 #define MIN_READAHEAD_BYTES	(1 * MB)
 #define MAX_READAHEAD_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_READAHEAD_BYTES	(64 * MB)
 
-#define BUF_ALIGNMENT		(4096)
 #define BUF_SIZE		(4096)
 #define MAX_OFFSETS		(16)
 
+/* --readahead-bench passes */
+#define RA_PASS_SEQ_COLD	(0)
+#define RA_PASS_SEQ_WARM	(1)
+#define RA_PASS_RND_COLD	(2)
+#define RA_PASS_RND_WARM	(3)
+#define RA_PASS_MAX		(4)
+
 static const stress_help_t help[] = {
 	{ NULL,	"readahead N",		"start N workers exercising file readahead" },
 	{ NULL,	"readahead-bytes N",	"size of file to readahead on (default is 1GB)" },
+	{ NULL,	"readahead-bench",	"measure cold and warm read MB/s over a readahead window sweep" },
 	{ NULL,	"readahead-ops N",	"stop after N readahead bogo operations" },
 	{ NULL,	NULL,			NULL }
 };
@@ -44,8 +61,14 @@ static int stress_set_readahead_bytes(const char *opt)
 	return stress_set_setting("readahead-bytes", TYPE_ID_UINT64, &readahead_bytes);
 }
 
+static int stress_set_readahead_bench(const char *opt)
+{
+	return stress_set_setting_true("readahead-bench", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_readahead_bytes,	stress_set_readahead_bytes },
+	{ OPT_readahead_bench,	stress_set_readahead_bench },
 	{ 0,			NULL }
 };
 
@@ -74,6 +97,264 @@ static int do_readahead(
 	return 0;
 }
 
+static const char * const ra_pass_names[RA_PASS_MAX] = {
+	"seq-cold", "seq-warm", "rnd-cold", "rnd-warm"
+};
+
+/* --readahead-bench window, a BLKRASET size or a posix_fadvise hint */
+typedef struct {
+	const char *name;	/* window name */
+	unsigned long ra_kb;	/* BLKRASET window in KB */
+	int advice;		/* posix_fadvise advice, -1 for none */
+	double bytes[RA_PASS_MAX];	/* bytes read per pass */
+	double duration[RA_PASS_MAX];	/* time taken per pass */
+} stress_ra_window_t;
+
+/* device readahead window sweep, needs a block device and CAP_SYS_ADMIN */
+static stress_ra_window_t ra_dev_windows[] = {
+	{ "0K",		0,	-1,	{ 0.0 }, { 0.0 } },
+	{ "32K",	32,	-1,	{ 0.0 }, { 0.0 } },
+	{ "128K",	128,	-1,	{ 0.0 }, { 0.0 } },
+	{ "512K",	512,	-1,	{ 0.0 }, { 0.0 } },
+	{ "2048K",	2048,	-1,	{ 0.0 }, { 0.0 } },
+};
+
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_RANDOM) &&	\
+    defined(POSIX_FADV_NORMAL) &&	\
+    defined(POSIX_FADV_SEQUENTIAL)
+/* per file readahead window sweep, off, default and double window */
+static stress_ra_window_t ra_advise_windows[] = {
+	{ "random",	0,	POSIX_FADV_RANDOM,	{ 0.0 }, { 0.0 } },
+	{ "normal",	0,	POSIX_FADV_NORMAL,	{ 0.0 }, { 0.0 } },
+	{ "sequential",	0,	POSIX_FADV_SEQUENTIAL,	{ 0.0 }, { 0.0 } },
+};
+#endif
+
+/*
+ *  stress_readahead_bench_dev()
+ *	open the block device the file lives on for BLKRASET,
+ *	returns -1 if it is not possible
+ */
+static int stress_readahead_bench_dev(const stress_args_t *args, const int fd)
+{
+#if defined(BLKRAGET) &&	\
+    defined(BLKRASET) &&	\
+    defined(HAVE_SYS_SYSMACROS_H)
+	struct stat statbuf;
+	char path[PATH_MAX];
+	unsigned long ra;
+	int dev_fd;
+
+	/* all instances would fight over the one device setting */
+	if (args->num_instances > 1)
+		return -1;
+	if (!stress_check_capability(SHIM_CAP_SYS_ADMIN))
+		return -1;
+	if (fstat(fd, &statbuf) < 0)
+		return -1;
+	if (major(statbuf.st_dev) == 0)
+		return -1;
+	(void)snprintf(path, sizeof(path), "/dev/block/%u:%u",
+		major(statbuf.st_dev), minor(statbuf.st_dev));
+	dev_fd = open(path, O_RDONLY);
+	if (dev_fd < 0) {
+		char uevent[PATH_MAX], buf[4096], *devname;
+
+		/* no /dev/block links, find the device node name in sysfs */
+		(void)snprintf(uevent, sizeof(uevent), "/sys/dev/block/%u:%u/uevent",
+			major(statbuf.st_dev), minor(statbuf.st_dev));
+		(void)memset(buf, 0, sizeof(buf));
+		if (system_read(uevent, buf, sizeof(buf) - 1) <= 0)
+			return -1;
+		devname = strstr(buf, "DEVNAME=");
+		if (!devname)
+			return -1;
+		devname += 8;
+		devname[strcspn(devname, "\n")] = '\0';
+		(void)snprintf(path, sizeof(path), "/dev/%s", devname);
+		dev_fd = open(path, O_RDONLY);
+		if (dev_fd < 0)
+			return -1;
+	}
+	if (ioctl(dev_fd, BLKRAGET, &ra) < 0) {
+		(void)close(dev_fd);
+		return -1;
+	}
+	return dev_fd;
+#else
+	(void)args;
+	(void)fd;
+
+	return -1;
+#endif
+}
+
+/*
+ *  stress_readahead_bench_drop()
+ *	drop the file's pages from the page cache
+ */
+static void stress_readahead_bench_drop(const int fd, const uint64_t size)
+{
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	(void)fdatasync(fd);
+	VOID_RET(int, posix_fadvise(fd, 0, (off_t)size, POSIX_FADV_DONTNEED));
+#else
+	(void)fd;
+	(void)size;
+#endif
+}
+
+/*
+ *  stress_readahead_bench_pass()
+ *	sequentially or randomly read the file in BUF_SIZE chunks,
+ *	returns bytes read or -1 on a read failure
+ */
+static int64_t stress_readahead_bench_pass(
+	const stress_args_t *args,
+	const int fd,
+	const char *fs_type,
+	buffer_t *buf,
+	const uint64_t size,
+	const bool rnd)
+{
+	const uint64_t blocks = size / BUF_SIZE;
+	/* random passes read a quarter of the blocks */
+	const uint64_t n = rnd ? STRESS_MAXIMUM(blocks / 4, 1) : blocks;
+	uint64_t i;
+	int64_t total = 0;
+
+	for (i = 0; (i < n) && keep_stressing(args); i++) {
+		const uint64_t blk = rnd ? stress_mwc64() % blocks : i;
+		const ssize_t ret = pread(fd, buf, BUF_SIZE, (off_t)(blk * BUF_SIZE));
+
+		if (ret < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			pr_fail("%s: read failed, errno=%d (%s)%s\n",
+				args->name, errno, strerror(errno), fs_type);
+			return -1;
+		}
+		total += ret;
+		inc_counter(args);
+	}
+	return total;
+}
+
+/*
+ *  stress_readahead_bench()
+ *	sweep the readahead window, for each window measure the
+ *	buffered sequential and random read throughput with a
+ *	cold and a warm page cache
+ */
+static int stress_readahead_bench(
+	const stress_args_t *args,
+	const int fd,
+	const char *fs_type,
+	buffer_t *buf,
+	const uint64_t size)
+{
+	stress_ra_window_t *windows;
+	size_t n_windows, w, p;
+	int dev_fd, rc = EXIT_SUCCESS;
+	unsigned long ra_orig = 0;
+	const char *how;
+
+	dev_fd = stress_readahead_bench_dev(args, fd);
+	if (dev_fd >= 0) {
+#if defined(BLKRAGET)
+		(void)ioctl(dev_fd, BLKRAGET, &ra_orig);
+#endif
+		windows = ra_dev_windows;
+		n_windows = SIZEOF_ARRAY(ra_dev_windows);
+		how = "device BLKRASET";
+	} else {
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_RANDOM) &&	\
+    defined(POSIX_FADV_NORMAL) &&	\
+    defined(POSIX_FADV_SEQUENTIAL)
+		windows = ra_advise_windows;
+		n_windows = SIZEOF_ARRAY(ra_advise_windows);
+		how = "posix_fadvise";
+#else
+		pr_inf_skip("%s: cannot change the readahead window, "
+			"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
+	do {
+		for (w = 0; (w < n_windows) && keep_stressing(args); w++) {
+			stress_ra_window_t *window = &windows[w];
+
+#if defined(BLKRASET)
+			if (dev_fd >= 0)
+				(void)ioctl(dev_fd, BLKRASET, window->ra_kb * 2);
+#endif
+#if defined(HAVE_POSIX_FADVISE)
+			if (window->advice >= 0)
+				(void)posix_fadvise(fd, 0, (off_t)size, window->advice);
+#endif
+			for (p = 0; (p < RA_PASS_MAX) && keep_stressing(args); p++) {
+				const bool rnd = (p == RA_PASS_RND_COLD) || (p == RA_PASS_RND_WARM);
+				double t;
+				int64_t bytes;
+
+				if ((p == RA_PASS_SEQ_COLD) || (p == RA_PASS_RND_COLD))
+					stress_readahead_bench_drop(fd, size);
+				t = stress_time_now();
+				bytes = stress_readahead_bench_pass(args, fd, fs_type, buf, size, rnd);
+				t = stress_time_now() - t;
+				if (bytes < 0) {
+					rc = EXIT_FAILURE;
+					goto restore;
+				}
+				window->bytes[p] += (double)bytes;
+				window->duration[p] += t;
+			}
+		}
+	} while (keep_stressing(args));
+
+restore:
+#if defined(BLKRASET)
+	if (dev_fd >= 0)
+		(void)ioctl(dev_fd, BLKRASET, ra_orig);
+#endif
+	if (dev_fd >= 0)
+		(void)close(dev_fd);
+
+	if (args->instance == 0) {
+		pr_inf("%s: read MB/s per readahead window (%s, %" PRIu64 " MB file)%s\n",
+			args->name, how, (uint64_t)(size / MB), fs_type);
+		pr_inf("%s: %-10s %10s %10s %10s %10s\n", args->name, "window",
+			ra_pass_names[0], ra_pass_names[1],
+			ra_pass_names[2], ra_pass_names[3]);
+	}
+	for (w = 0; w < n_windows; w++) {
+		const stress_ra_window_t *window = &windows[w];
+		double mb_per_sec[RA_PASS_MAX];
+		char desc[40];
+
+		for (p = 0; p < RA_PASS_MAX; p++) {
+			mb_per_sec[p] = (window->duration[p] > 0.0) ?
+				(window->bytes[p] / window->duration[p]) / (double)MB : 0.0;
+		}
+		if (args->instance == 0) {
+			pr_inf("%s: %-10s %10.2f %10.2f %10.2f %10.2f\n",
+				args->name, window->name, mb_per_sec[0],
+				mb_per_sec[1], mb_per_sec[2], mb_per_sec[3]);
+		}
+		(void)snprintf(desc, sizeof(desc), "%s seq-cold MB/s", window->name);
+		stress_misc_stats_set(args->misc_stats, w * 2, desc,
+			mb_per_sec[RA_PASS_SEQ_COLD]);
+		(void)snprintf(desc, sizeof(desc), "%s rnd-cold MB/s", window->name);
+		stress_misc_stats_set(args->misc_stats, (w * 2) + 1, desc,
+			mb_per_sec[RA_PASS_RND_COLD]);
+	}
+	return rc;
+}
+
 
 /*
  *  stress_readahead
@@ -81,7 +362,8 @@ static int do_readahead(
  */
 static int stress_readahead(const stress_args_t *args)
 {
-	buffer_t *buf = NULL;
+	buffer_t *buf;
+	stress_io_buf_pool_t pool;
 	uint64_t rounded_readahead_bytes, i;
 	uint64_t readahead_bytes = DEFAULT_READAHEAD_BYTES;
 	uint64_t misreads = 0;
@@ -92,6 +374,7 @@ static int stress_readahead(const stress_args_t *args)
 	int fd, fd_wr;
 	struct stat statbuf;
 	const char *fs_type;
+	bool readahead_bench = false;
 
 	if (!stress_get_setting("readahead-bytes", &readahead_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -99,6 +382,7 @@ static int stress_readahead(const stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			readahead_bytes = MIN_READAHEAD_BYTES;
 	}
+	(void)stress_get_setting("readahead-bench", &readahead_bench);
 	readahead_bytes /= args->num_instances;
 	if (readahead_bytes < MIN_READAHEAD_BYTES)
 		readahead_bytes = MIN_READAHEAD_BYTES;
@@ -107,13 +391,14 @@ static int stress_readahead(const stress_args_t *args)
 	if (ret < 0)
 		return stress_exit_status(-rc);
 
-	ret = posix_memalign((void **)&buf, BUF_ALIGNMENT, BUF_SIZE);
-	if (ret || !buf) {
+	(void)stress_temp_dir_args(args, filename, sizeof(filename));
+	if (stress_io_buf_pool_alloc(args, &pool, filename, BUF_SIZE, 1, 0) < 0) {
 		rc = stress_exit_status(errno);
 		pr_err("%s: cannot allocate buffer\n", args->name);
 		(void)stress_temp_dir_rm_args(args);
 		return rc;
 	}
+	buf = (buffer_t *)stress_io_buf_get(&pool, 0);
 
 	(void)stress_temp_filename_args(args,
 		filename, sizeof(filename), stress_mwc32());
@@ -195,6 +480,11 @@ seq_wr_retry:
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (readahead_bench) {
+		rc = stress_readahead_bench(args, fd, fs_type, buf, rounded_readahead_bytes);
+		goto close_finish;
+	}
+
 	do {
 		off_t offsets[MAX_OFFSETS];
 
@@ -268,7 +558,7 @@ close_finish:
 	(void)close(fd);
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	free(buf);
+	stress_io_buf_pool_free(&pool);
 	(void)stress_temp_dir_rm_args(args);
 
 	if (misreads)
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 #include "core-net.h"
 
 #if defined(HAVE_SYS_UN_H)
@@ -38,6 +39,10 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
 #define MIN_SCTP_PORT		(1024)
 #define MAX_SCTP_PORT		(65535)
 #define DEFAULT_SCTP_PORT	(9000)
@@ -52,10 +57,13 @@ typedef struct {
 static const stress_help_t help[] = {
 	{ NULL,	"sctp N",	 "start N workers performing SCTP send/receives " },
 	{ NULL,	"sctp-ops N",	 "stop after N SCTP bogo operations" },
+	{ NULL,	"sctp-assocs N", "use N associations in the sctp bench" },
+	{ NULL,	"sctp-bench",	 "measure multi-stream message rates and latency" },
 	{ NULL,	"sctp-if I",	 "use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"sctp-domain D", "specify sctp domain, default is ipv4" },
 	{ NULL,	"sctp-port P",	 "use SCTP ports P to P + number of workers - 1" },
 	{ NULL, "sctp-sched S",	 "specify sctp scheduler" },
+	{ NULL,	"sctp-streams N", "use N streams per association in the sctp bench" },
 	{ NULL,	NULL, 		 NULL }
 };
 
@@ -139,11 +147,37 @@ static int stress_set_sctp_if(const char *name)
         return stress_set_setting("sctp-if", TYPE_ID_STR, name);
 }
 
+static int stress_set_sctp_bench(const char *opt)
+{
+	return stress_set_setting_true("sctp-bench", opt);
+}
+
+static int stress_set_sctp_streams(const char *opt)
+{
+	uint32_t sctp_streams;
+
+	sctp_streams = stress_get_uint32(opt);
+	stress_check_range("sctp-streams", (uint64_t)sctp_streams, 1, 65535);
+	return stress_set_setting("sctp-streams", TYPE_ID_UINT32, &sctp_streams);
+}
+
+static int stress_set_sctp_assocs(const char *opt)
+{
+	uint32_t sctp_assocs;
+
+	sctp_assocs = stress_get_uint32(opt);
+	stress_check_range("sctp-assocs", (uint64_t)sctp_assocs, 1, 64);
+	return stress_set_setting("sctp-assocs", TYPE_ID_UINT32, &sctp_assocs);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sctp_assocs,	stress_set_sctp_assocs },
+	{ OPT_sctp_bench,	stress_set_sctp_bench },
 	{ OPT_sctp_domain,	stress_set_sctp_domain },
 	{ OPT_sctp_if,		stress_set_sctp_if },
 	{ OPT_sctp_port,	stress_set_sctp_port },
 	{ OPT_sctp_sched,	stress_set_sctp_sched },
+	{ OPT_sctp_streams,	stress_set_sctp_streams },
 	{ 0,			NULL }
 };
 
@@ -625,6 +659,435 @@ die:
 	return rc;
 }
 
+#if defined(HAVE_POLL_H)
+#define HAVE_SCTP_BENCH
+
+#define SCTP_BENCH_DURATION	(0.5)	/* seconds per measurement point */
+#define SCTP_BENCH_MAX_MSG	(16384)
+#define SCTP_BENCH_MAX_ASSOCS	(64)
+
+typedef struct {
+	uint32_t point;		/* measurement point index */
+	uint32_t seq;		/* message sequence number */
+	uint64_t ns;		/* send time, CLOCK_MONOTONIC ns */
+} stress_sctp_bench_hdr_t;
+
+typedef struct {
+	double start;		/* sender start time of the point */
+	double end;		/* sender end time of the point */
+	uint64_t sent;		/* messages sent */
+} stress_sctp_bench_window_t;
+
+static const size_t sctp_bench_sizes[] = { 64, 512, 4096, SCTP_BENCH_MAX_MSG };
+
+#define SCTP_BENCH_SIZES	(SIZEOF_ARRAY(sctp_bench_sizes))
+#define SCTP_BENCH_POINTS	(SCTP_BENCH_SIZES * 2)	/* ordered, unordered */
+
+/*
+ *  stress_sctp_bench_initmsg()
+ *	request the number of inbound and outbound streams
+ */
+static void stress_sctp_bench_initmsg(const int fd, const uint32_t sctp_streams)
+{
+#if defined(HAVE_SCTP_INITMSG)
+	struct sctp_initmsg initmsg;
+
+	(void)memset(&initmsg, 0, sizeof(initmsg));
+	initmsg.sinit_num_ostreams = (uint16_t)sctp_streams;
+	initmsg.sinit_max_instreams = (uint16_t)sctp_streams;
+	(void)setsockopt(fd, IPPROTO_SCTP, SCTP_INITMSG, &initmsg, sizeof(initmsg));
+#else
+	(void)fd;
+	(void)sctp_streams;
+#endif
+}
+
+/*
+ *  stress_sctp_bench_ostreams()
+ *	number of outbound streams the peer agreed to, the kernel
+ *	rejects sends on a stream beyond this with EINVAL
+ */
+static uint16_t stress_sctp_bench_ostreams(const int fd, const uint32_t sctp_streams)
+{
+#if defined(HAVE_SCTP_STATUS)
+	struct sctp_status status;
+	socklen_t len = sizeof(status);
+
+	(void)memset(&status, 0, sizeof(status));
+	if ((getsockopt(fd, IPPROTO_SCTP, SCTP_STATUS, &status, &len) == 0) &&
+	    (status.sstat_outstrms > 0) &&
+	    (status.sstat_outstrms < sctp_streams))
+		return status.sstat_outstrms;
+#else
+	(void)fd;
+#endif
+	return (uint16_t)sctp_streams;
+}
+
+/*
+ *  stress_sctp_bench_sender()
+ *	connect sctp_assocs associations and send each point's messages
+ *	round robin over the associations and streams for
+ *	SCTP_BENCH_DURATION seconds
+ */
+static int stress_sctp_bench_sender(
+	const stress_args_t *args,
+	const pid_t mypid,
+	const int sctp_port,
+	const int sctp_domain,
+	const char *sctp_if,
+	const uint32_t sctp_streams,
+	const uint32_t sctp_assocs,
+	stress_sctp_bench_window_t *windows)
+{
+	static char ALIGN64 buf[SCTP_BENCH_MAX_MSG];
+	stress_sctp_bench_hdr_t *hdr = (stress_sctp_bench_hdr_t *)buf;
+	int fds[SCTP_BENCH_MAX_ASSOCS];
+	uint16_t ostreams[SCTP_BENCH_MAX_ASSOCS];
+	uint32_t i, n = 0;
+	size_t p;
+	int rc = EXIT_SUCCESS;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	for (n = 0; n < sctp_assocs; n++) {
+		struct sockaddr *addr;
+		socklen_t addr_len = 0;
+		int retries = 0;
+
+		fds[n] = socket(sctp_domain, SOCK_STREAM, IPPROTO_SCTP);
+		if (fds[n] < 0) {
+			rc = EXIT_NO_RESOURCE;
+			goto close_fds;
+		}
+		stress_sctp_bench_initmsg(fds[n], sctp_streams);
+		if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+				sctp_domain, sctp_port, sctp_if,
+				&addr, &addr_len, NET_ADDR_LOOPBACK) < 0) {
+			(void)close(fds[n]);
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		while (connect(fds[n], addr, addr_len) < 0) {
+			if ((++retries > 100) || !keep_stressing_flag()) {
+				(void)close(fds[n]);
+				rc = EXIT_FAILURE;
+				goto close_fds;
+			}
+			(void)shim_usleep(10000);
+		}
+		ostreams[n] = stress_sctp_bench_ostreams(fds[n], sctp_streams);
+	}
+
+	stress_strnrnd(buf, sizeof(buf));
+	for (p = 0; p < SCTP_BENCH_POINTS; p++) {
+		const size_t sz = sctp_bench_sizes[p % SCTP_BENCH_SIZES];
+		const uint32_t flags = (p < SCTP_BENCH_SIZES) ? 0 : SCTP_UNORDERED;
+		stress_sctp_bench_window_t *w = &windows[p];
+		uint32_t seq = 0;
+
+		w->start = stress_time_now();
+		do {
+			const uint32_t assoc = seq % sctp_assocs;
+			const uint16_t stream = (uint16_t)((seq / sctp_assocs) % ostreams[assoc]);
+
+			hdr->point = (uint32_t)p;
+			hdr->seq = seq;
+			hdr->ns = stress_latency_now();
+			if (sctp_sendmsg(fds[assoc], buf, sz, NULL, 0, 0,
+					flags, stream, 0, 0) < 0) {
+				if ((errno == EINTR) || (errno == EAGAIN))
+					continue;
+				rc = EXIT_FAILURE;
+				goto close_fds;
+			}
+			seq++;
+		} while (keep_stressing_flag() &&
+			 ((seq & 63) || (stress_time_now() - w->start < SCTP_BENCH_DURATION)));
+		w->end = stress_time_now();
+		w->sent = seq;
+		if (!keep_stressing_flag())
+			break;
+	}
+
+close_fds:
+	for (i = 0; i < n; i++) {
+		(void)shutdown(fds[i], SHUT_RDWR);
+		(void)close(fds[i]);
+	}
+	return rc;
+}
+
+/*
+ *  stress_sctp_bench_sender_exited()
+ *	check if the sender has exited without reaping it
+ */
+static bool stress_sctp_bench_sender_exited(const pid_t pid)
+{
+#if defined(HAVE_WAITID)
+	siginfo_t info;
+
+	(void)memset(&info, 0, sizeof(info));
+	if (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOHANG | WNOWAIT) < 0)
+		return true;
+	return info.si_pid == pid;
+#else
+	return kill(pid, 0) < 0;
+#endif
+}
+
+/*
+ *  stress_sctp_bench_accept()
+ *	accept an association, giving up if the sender has exited
+ *	before it connected or the run is over
+ */
+static int stress_sctp_bench_accept(const int fd, const pid_t pid)
+{
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	while (keep_stressing_flag()) {
+		const int ret = poll(&pfd, 1, 100);
+
+		if (ret > 0)
+			return accept(fd, NULL, NULL);
+		if ((ret < 0) && (errno != EINTR))
+			return -1;
+		if (stress_sctp_bench_sender_exited(pid))
+			return -1;
+	}
+	return -1;
+}
+
+/*
+ *  stress_sctp_bench_receiver()
+ *	accept sctp_assocs associations and receive until they are
+ *	all shut down, recording the send to receive latency of
+ *	each message
+ */
+static bool stress_sctp_bench_receiver(
+	const int fd,
+	const pid_t pid,
+	const uint32_t sctp_assocs,
+	uint64_t *received,
+	stress_latency_t *lats)
+{
+	static char ALIGN64 buf[SCTP_BENCH_MAX_MSG];
+	struct pollfd pfds[SCTP_BENCH_MAX_ASSOCS];
+	bool partial[SCTP_BENCH_MAX_ASSOCS];
+	uint32_t i, open_fds;
+
+	for (i = 0; i < sctp_assocs; i++) {
+		pfds[i].fd = stress_sctp_bench_accept(fd, pid);
+		if (pfds[i].fd < 0) {
+			while (i > 0)
+				(void)close(pfds[--i].fd);
+			return false;
+		}
+		pfds[i].events = POLLIN;
+		partial[i] = false;
+	}
+
+	open_fds = sctp_assocs;
+	while (open_fds && keep_stressing_flag()) {
+		if (poll(pfds, (nfds_t)sctp_assocs, 1000) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (i = 0; i < sctp_assocs; i++) {
+			struct sctp_sndrcvinfo sinfo;
+			int flags = 0;
+			ssize_t n;
+
+			if ((pfds[i].fd < 0) || !(pfds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+			n = sctp_recvmsg(pfds[i].fd, buf, sizeof(buf), NULL, 0, &sinfo, &flags);
+			if (n <= 0) {
+				(void)close(pfds[i].fd);
+				pfds[i].fd = -1;
+				open_fds--;
+				continue;
+			}
+			/* only the first part of a message carries a header */
+			if (!partial[i] && ((size_t)n >= sizeof(stress_sctp_bench_hdr_t))) {
+				const stress_sctp_bench_hdr_t *hdr = (const stress_sctp_bench_hdr_t *)buf;
+
+				if (hdr->point < SCTP_BENCH_POINTS) {
+					received[hdr->point]++;
+					stress_latency_record(&lats[hdr->point],
+						stress_latency_now() - hdr->ns);
+				}
+			}
+			partial[i] = !(flags & MSG_EOR);
+		}
+	}
+	for (i = 0; i < sctp_assocs; i++) {
+		if (pfds[i].fd >= 0)
+			(void)close(pfds[i].fd);
+	}
+	return true;
+}
+
+/*
+ *  stress_sctp_bench()
+ *	measure multi-stream, multi-association SCTP message rates
+ *	and latency percentiles with ordered and unordered delivery
+ */
+static int stress_sctp_bench(
+	const stress_args_t *args,
+	const pid_t mypid,
+	const int sctp_port,
+	const int sctp_domain,
+	const char *sctp_if)
+{
+	uint32_t sctp_streams = 8, sctp_assocs = 1;
+	stress_sctp_bench_window_t *windows;
+	stress_latency_t *lats, *res_lats;
+	uint64_t received[SCTP_BENCH_POINTS], res_received[SCTP_BENCH_POINTS];
+	stress_sctp_bench_window_t res_windows[SCTP_BENCH_POINTS];
+	const size_t lats_size = sizeof(*lats) * SCTP_BENCH_POINTS;
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	int fd, so_reuseaddr = 1, rc = EXIT_SUCCESS;
+	size_t p;
+	bool done = false;
+
+	(void)stress_get_setting("sctp-streams", &sctp_streams);
+	(void)stress_get_setting("sctp-assocs", &sctp_assocs);
+
+	windows = (stress_sctp_bench_window_t *)mmap(NULL, args->page_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (windows == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes, errno=%d (%s), skipping stressor\n",
+			args->name, args->page_size, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	lats = (stress_latency_t *)calloc(2, lats_size);
+	if (!lats) {
+		pr_inf_skip("%s: cannot allocate latency histograms, skipping stressor\n",
+			args->name);
+		(void)munmap((void *)windows, args->page_size);
+		return EXIT_NO_RESOURCE;
+	}
+	res_lats = lats + SCTP_BENCH_POINTS;
+
+	if ((fd = socket(sctp_domain, SOCK_STREAM, IPPROTO_SCTP)) < 0) {
+		if (errno == EPROTONOSUPPORT) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: SCTP protocol not supported, skipping stressor\n",
+					args->name);
+			rc = EXIT_NOT_IMPLEMENTED;
+		} else {
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+		}
+		goto free_lats;
+	}
+	(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &so_reuseaddr, sizeof(so_reuseaddr));
+	stress_sctp_bench_initmsg(fd, sctp_streams);
+	if ((stress_set_sockaddr_if(args->name, args->instance, mypid,
+		sctp_domain, sctp_port, sctp_if, &addr, &addr_len, NET_ADDR_ANY) < 0) ||
+	    (bind(fd, addr, addr_len) < 0) ||
+	    (listen(fd, (int)sctp_assocs) < 0)) {
+		pr_fail("%s: bind/listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_fd;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		pid_t pid;
+		int status;
+		bool ok;
+
+		(void)memset(windows, 0, sizeof(*windows) * SCTP_BENCH_POINTS);
+		(void)memset(received, 0, sizeof(received));
+		(void)memset(lats, 0, lats_size);
+again:
+		pid = fork();
+		if (pid < 0) {
+			if (stress_redo_fork(errno))
+				goto again;
+			if (!keep_stressing(args))
+				break;
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		} else if (pid == 0) {
+			_exit(stress_sctp_bench_sender(args, mypid, sctp_port,
+				sctp_domain, sctp_if, sctp_streams, sctp_assocs, windows));
+		}
+		ok = stress_sctp_bench_receiver(fd, pid, sctp_assocs, received, lats);
+		if (!ok)
+			(void)kill(pid, SIGKILL);
+		(void)shim_waitpid(pid, &status, 0);
+		if (!ok || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+			break;
+		if (windows[SCTP_BENCH_POINTS - 1].end <= 0.0)
+			break;
+		(void)memcpy(res_windows, windows, sizeof(res_windows));
+		(void)memcpy(res_received, received, sizeof(res_received));
+		(void)memcpy(res_lats, lats, lats_size);
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: %" PRIu32 " association%s, %" PRIu32 " stream%s, "
+			"send to receive latency\n", args->name,
+			sctp_assocs, sctp_assocs == 1 ? "" : "s",
+			sctp_streams, sctp_streams == 1 ? "" : "s");
+		pr_inf("%s: %6s %-9s %12s %9s %9s %9s %9s\n", args->name,
+			"size", "delivery", "msgs/s", "MB/s",
+			"p50 us", "p99 us", "p99.9 us");
+		for (p = 0; p < SCTP_BENCH_POINTS; p++) {
+			const double dt = res_windows[p].end - res_windows[p].start;
+			const double rate = (dt > 0.0) ? (double)res_received[p] / dt : 0.0;
+			const size_t sz = sctp_bench_sizes[p % SCTP_BENCH_SIZES];
+
+			pr_inf("%s: %6zu %-9s %12.0f %9.1f %9.1f %9.1f %9.1f\n",
+				args->name, sz,
+				(p < SCTP_BENCH_SIZES) ? "ordered" : "unordered",
+				rate, rate * (double)sz / (double)MB,
+				(double)stress_latency_percentile(&res_lats[p], 50.0) / 1000.0,
+				(double)stress_latency_percentile(&res_lats[p], 99.0) / 1000.0,
+				(double)stress_latency_percentile(&res_lats[p], 99.9) / 1000.0);
+		}
+	}
+	if (done) {
+		for (p = 0; p < SCTP_BENCH_POINTS; p++) {
+			const double dt = res_windows[p].end - res_windows[p].start;
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%zu %s msgs/s",
+				sctp_bench_sizes[p % SCTP_BENCH_SIZES],
+				(p < SCTP_BENCH_SIZES) ? "ordered" : "unordered");
+			stress_misc_stats_set(args->misc_stats, (int)p, str,
+				(dt > 0.0) ? (double)res_received[p] / dt : 0.0);
+		}
+	}
+
+close_fd:
+	(void)close(fd);
+free_lats:
+	free(lats);
+	(void)munmap((void *)windows, args->page_size);
+
+	return rc;
+}
+#endif
+
 static void stress_sctp_sigpipe(int signum)
 {
 	(void)signum;
@@ -644,7 +1107,9 @@ static int stress_sctp(const stress_args_t *args)
 	int sctp_sched = -1;	/* Undefined */
 	int ret;
 	char *sctp_if = NULL;
+	bool sctp_bench = false;
 
+	(void)stress_get_setting("sctp-bench", &sctp_bench);
 	(void)stress_get_setting("sctp-domain", &sctp_domain);
 	(void)stress_get_setting("sctp-if", &sctp_if);
 	(void)stress_get_setting("sctp-port", &sctp_port);
@@ -669,6 +1134,17 @@ static int stress_sctp(const stress_args_t *args)
 	pr_dbg("%s: process [%" PRIdMAX "] using socket port %d\n",
 		args->name, (intmax_t)args->pid, sctp_port);
 
+	if (sctp_bench) {
+#if defined(HAVE_SCTP_BENCH)
+		return stress_sctp_bench(args, mypid, sctp_port, sctp_domain, sctp_if);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: sctp bench needs poll(), skipping stressor\n",
+				args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	ret = EXIT_FAILURE;
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 again:
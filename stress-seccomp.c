@@ -46,9 +46,31 @@ UNEXPECTED
 static const stress_help_t help[] = {
 	{ NULL,	"seccomp N",	 "start N workers performing seccomp call filtering" },
 	{ NULL,	"seccomp-ops N", "stop after N seccomp bogo operations" },
+	{ NULL,	"seccomp-bench", "measure per syscall filter overhead vs filter size and layout" },
+	{ NULL,	"seccomp-stack N", "stack N copies of the filter in seccomp-bench mode" },
 	{ NULL,	NULL,		 NULL }
 };
 
+static int stress_set_seccomp_bench(const char *opt)
+{
+	return stress_set_setting_true("seccomp-bench", opt);
+}
+
+static int stress_set_seccomp_stack(const char *opt)
+{
+	uint32_t seccomp_stack;
+
+	seccomp_stack = stress_get_uint32(opt);
+	stress_check_range("seccomp-stack", (uint64_t)seccomp_stack, 1, 64);
+	return stress_set_setting("seccomp-stack", TYPE_ID_UINT32, &seccomp_stack);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_seccomp_bench,	stress_set_seccomp_bench },
+	{ OPT_seccomp_stack,	stress_set_seccomp_stack },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LINUX_SECCOMP_H) &&	\
     defined(HAVE_LINUX_AUDIT_H) &&	\
     defined(HAVE_LINUX_FILTER_H) &&	\
@@ -376,12 +398,349 @@ redo_prctl:
 	return 0;
 }
 
+#if defined(__NR_seccomp) &&	\
+    defined(__NR_getppid)
+
+#define SECCOMP_BENCH_CALLS	(100000)
+#define SECCOMP_BENCH_RUNS	(5)
+#define SECCOMP_BENCH_FAKE_NR	(4000)	/* rule syscall numbers never called */
+#define SECCOMP_BENCH_LEAF	(4)	/* rules per binary tree leaf */
+
+static const size_t seccomp_bench_rules[] = { 10, 30, 100, 300, 1000 };
+
+#define SECCOMP_BENCH_SIZES	(SIZEOF_ARRAY(seccomp_bench_rules))
+#define SYSCALL_ARG0		(offsetof(struct seccomp_data, args[0]))
+
+/*
+ *  results of one filter configuration, shared with the
+ *  child that has the filters installed
+ */
+typedef struct {
+	double base_ns;			/* getppid ns without filters */
+	double filter_ns;		/* getppid ns with filters */
+	size_t insns;			/* BPF instructions per filter */
+	int err;			/* errno if filter install failed */
+	bool ok;
+} stress_seccomp_result_t;
+
+/*
+ *  stress_seccomp_bench_tree()
+ *	emit a binary search over the sorted rule numbers nrs[lo..hi),
+ *	BPF_JA is used to reach the upper half as conditional jump
+ *	offsets are only 8 bits, returns number of instructions
+ */
+static size_t stress_seccomp_bench_tree(
+	struct sock_filter *f,
+	const uint32_t *nrs,
+	const uint32_t getppid_nr,
+	const size_t lo,
+	const size_t hi)
+{
+	size_t i, n = 0, left;
+	const size_t mid = lo + ((hi - lo) / 2);
+
+	if ((hi - lo) <= SECCOMP_BENCH_LEAF) {
+		for (i = lo; i < hi; i++) {
+			const uint32_t action = (nrs[i] == getppid_nr) ?
+				SECCOMP_RET_ALLOW : (SECCOMP_RET_ERRNO | EPERM);
+			const struct sock_filter jeq = BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, nrs[i], 0, 1);
+			const struct sock_filter ret = BPF_STMT(BPF_RET + BPF_K, action);
+
+			f[n++] = jeq;
+			f[n++] = ret;
+		}
+		{
+			const struct sock_filter allow = BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW);
+
+			f[n++] = allow;
+		}
+		return n;
+	}
+	{
+		const struct sock_filter jge = BPF_JUMP(BPF_JMP + BPF_JGE + BPF_K, nrs[mid], 0, 1);
+
+		f[n++] = jge;
+	}
+	n++;	/* BPF_JA to the upper half, filled in below */
+	left = stress_seccomp_bench_tree(f + n, nrs, getppid_nr, lo, mid);
+	{
+		const struct sock_filter ja = BPF_STMT(BPF_JMP + BPF_JA, (uint32_t)left);
+
+		f[1] = ja;
+	}
+	n += left;
+	n += stress_seccomp_bench_tree(f + n, nrs, getppid_nr, mid, hi);
+	return n;
+}
+
+/*
+ *  stress_seccomp_bench_filter()
+ *	build a filter of n_rules rules, n_rules - 1 never matching
+ *	deny rules plus an allow rule for getppid that is checked last
+ *	in the linear layout, everything else is allowed by default.
+ *	Filters that only look at the syscall number get their result
+ *	cached in the kernel's constant action bitmap, loading a system
+ *	call argument first defeats this so the BPF runs on every call.
+ */
+static size_t stress_seccomp_bench_filter(
+	struct sock_filter *f,
+	const size_t n_rules,
+	const bool tree,
+	const bool uncached)
+{
+	const uint32_t getppid_nr = (uint32_t)__NR_getppid;
+	const struct sock_filter ld = BPF_STMT(BPF_LD + BPF_W + BPF_ABS, SYSCALL_NR);
+	const struct sock_filter ld_arg = BPF_STMT(BPF_LD + BPF_W + BPF_ABS, SYSCALL_ARG0);
+	uint32_t nrs[n_rules];
+	size_t i, n = 0;
+
+	for (i = 0; i < n_rules - 1; i++)
+		nrs[i] = SECCOMP_BENCH_FAKE_NR + (uint32_t)i;
+	nrs[i] = getppid_nr;
+
+	if (uncached)
+		f[n++] = ld_arg;
+	f[n++] = ld;
+	if (tree) {
+		/* getppid is lower than all the fake numbers, keep it sorted */
+		(void)memmove(&nrs[1], &nrs[0], (n_rules - 1) * sizeof(nrs[0]));
+		nrs[0] = getppid_nr;
+		return n + stress_seccomp_bench_tree(f + n, nrs, getppid_nr, 0, n_rules);
+	}
+	for (i = 0; i < n_rules; i++) {
+		const uint32_t action = (nrs[i] == getppid_nr) ?
+			SECCOMP_RET_ALLOW : (SECCOMP_RET_ERRNO | EPERM);
+		const struct sock_filter jeq = BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, nrs[i], 0, 1);
+		const struct sock_filter ret = BPF_STMT(BPF_RET + BPF_K, action);
+
+		f[n++] = jeq;
+		f[n++] = ret;
+	}
+	{
+		const struct sock_filter allow = BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW);
+
+		f[n++] = allow;
+	}
+	return n;
+}
+
+/*
+ *  stress_seccomp_bench_getppid()
+ *	best of SECCOMP_BENCH_RUNS runs of the cost of a raw
+ *	getppid system call in ns
+ */
+static double stress_seccomp_bench_getppid(void)
+{
+	double best = -1.0;
+	int run;
+
+	for (run = 0; run < SECCOMP_BENCH_RUNS; run++) {
+		double t, dt;
+		int i;
+
+		t = stress_time_now();
+		for (i = 0; i < SECCOMP_BENCH_CALLS; i++)
+			(void)syscall(__NR_getppid);
+		dt = stress_time_now() - t;
+		if ((best < 0.0) || (dt < best))
+			best = dt;
+	}
+	return (best * STRESS_NANOSECOND) / SECCOMP_BENCH_CALLS;
+}
+
+/*
+ *  stress_seccomp_bench_child()
+ *	measure getppid cost, install the stacked filters and
+ *	measure again, filters can't be removed so this runs
+ *	in a child process
+ */
+static void NORETURN stress_seccomp_bench_child(
+	const size_t n_rules,
+	const bool tree,
+	const bool uncached,
+	const bool spec_allow,
+	const uint32_t stack,
+	stress_seccomp_result_t *result)
+{
+	struct sock_filter *f;
+	struct sock_fprog fprog;
+	unsigned int flags = 0;
+	uint32_t i;
+
+	/* linear needs 2 per rule, the tree at most 4 per rule */
+	f = calloc((n_rules * 4) + 8, sizeof(*f));
+	if (!f)
+		_exit(EXIT_NO_RESOURCE);
+	result->insns = stress_seccomp_bench_filter(f, n_rules, tree, uncached);
+	fprog.len = (unsigned short)result->insns;
+	fprog.filter = f;
+
+#if defined(SECCOMP_FILTER_FLAG_SPEC_ALLOW)
+	if (spec_allow)
+		flags |= SECCOMP_FILTER_FLAG_SPEC_ALLOW;
+#else
+	if (spec_allow) {
+		result->err = ENOSYS;
+		_exit(EXIT_NOT_IMPLEMENTED);
+	}
+#endif
+	result->base_ns = stress_seccomp_bench_getppid();
+
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0) {
+		result->err = errno;
+		_exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < stack; i++) {
+		if (shim_seccomp(SECCOMP_SET_MODE_FILTER, flags, &fprog) < 0) {
+			result->err = errno;
+			_exit(EXIT_FAILURE);
+		}
+	}
+	result->filter_ns = stress_seccomp_bench_getppid();
+	result->ok = true;
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_seccomp_bench()
+ *	measure the per system call overhead of seccomp filters
+ *	against filter size, linear vs binary tree layout, cached
+ *	vs uncached and with and without SECCOMP_FILTER_FLAG_SPEC_ALLOW
+ */
+static int stress_seccomp_bench(const stress_args_t *args)
+{
+	uint32_t stack = 1;
+	stress_seccomp_result_t *result;
+	stress_seccomp_result_t pass[SECCOMP_BENCH_SIZES][2][2][2];
+	stress_seccomp_result_t res[SECCOMP_BENCH_SIZES][2][2][2];
+	char jit[16];
+	size_t i, t, c, s;
+	bool done = false;
+
+	(void)stress_get_setting("seccomp-stack", &stack);
+
+	result = (stress_seccomp_result_t *)mmap(NULL, sizeof(*result),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (result == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap result, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(res, 0, sizeof(res));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < SECCOMP_BENCH_SIZES; i++) {
+			for (t = 0; t < 2; t++) {
+				for (c = 0; c < 2; c++) {
+					for (s = 0; s < 2; s++) {
+						pid_t pid;
+
+						if (!keep_stressing(args))
+							goto finish;
+						(void)memset(result, 0, sizeof(*result));
+						pid = fork();
+						if (pid == 0) {
+							stress_parent_died_alarm();
+							stress_seccomp_bench_child(seccomp_bench_rules[i],
+								t == 1, c == 1, s == 1, stack, result);
+						}
+						if (pid > 0) {
+							int status;
+
+							(void)shim_waitpid(pid, &status, 0);
+						}
+						pass[i][t][c][s] = *result;
+					}
+				}
+			}
+		}
+		(void)memcpy(res, pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		if (system_read("/proc/sys/net/core/bpf_jit_enable", jit, sizeof(jit)) > 0)
+			jit[strcspn(jit, "\n")] = '\0';
+		else
+			(void)shim_strlcpy(jit, "unknown", sizeof(jit));
+
+		pr_inf("%s: raw getppid() cost with %" PRIu32 " stacked filter%s, bpf_jit_enable %s\n",
+			args->name, stack, (stack == 1) ? "" : "s", jit);
+		pr_inf("%s: added ns with speculative store bypass mitigation forced and with SPEC_ALLOW\n",
+			args->name);
+		pr_inf("%s: %5s %-6s %-8s %6s %9s %10s %10s\n", args->name,
+			"rules", "layout", "cache", "insns", "base ns", "mitigated", "spec allow");
+		for (i = 0; i < SECCOMP_BENCH_SIZES; i++) {
+			for (t = 0; t < 2; t++) {
+				for (c = 0; c < 2; c++) {
+					const stress_seccomp_result_t *r = res[i][t][c];
+					char added[2][16];
+
+					for (s = 0; s < 2; s++) {
+						if (r[s].ok)
+							(void)snprintf(added[s], sizeof(added[s]), "%.1f",
+								r[s].filter_ns - r[s].base_ns);
+						else
+							(void)shim_strlcpy(added[s], "-", sizeof(added[s]));
+					}
+					pr_inf("%s: %5zu %-6s %-8s %6zu %9.1f %10s %10s\n",
+						args->name, seccomp_bench_rules[i],
+						t ? "tree" : "linear", c ? "uncached" : "cached",
+						r[0].insns, r[0].base_ns, added[0], added[1]);
+				}
+			}
+		}
+	}
+	if (done) {
+		static const char * const stat_names[2][2] = {
+			{ "linear cached added ns",	"linear uncached added ns" },
+			{ "tree cached added ns",	"tree uncached added ns" },
+		};
+		const size_t last = SECCOMP_BENCH_SIZES - 1;
+
+		stress_misc_stats_set(args->misc_stats, 0, "getppid ns, no filter",
+			res[0][0][0][0].base_ns);
+		for (t = 0; t < 2; t++) {
+			for (c = 0; c < 2; c++) {
+				const stress_seccomp_result_t *r = &res[last][t][c][0];
+
+				stress_misc_stats_set(args->misc_stats, (int)(1 + (t * 2) + c),
+					stat_names[t][c], r->ok ? r->filter_ns - r->base_ns : 0.0);
+			}
+		}
+	}
+	(void)munmap((void *)result, sizeof(*result));
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_seccomp()
  *	stress seccomp
  */
 static int stress_seccomp(const stress_args_t *args)
 {
+	bool seccomp_bench = false;
+
+	(void)stress_get_setting("seccomp-bench", &seccomp_bench);
+	if (seccomp_bench) {
+#if defined(__NR_seccomp) &&	\
+    defined(__NR_getppid)
+		return stress_seccomp_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: seccomp-bench requires the seccomp and getppid "
+				"system calls, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -473,6 +832,7 @@ stressor_info_t stress_seccomp_info = {
 	.stressor = stress_seccomp,
 	.supported = stress_seccomp_supported,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -480,6 +840,7 @@ stressor_info_t stress_seccomp_info = {
 stressor_info_t stress_seccomp_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 #include "core-pthread.h"
 
 #if defined(HAVE_SEMAPHORE_H)
@@ -62,24 +63,27 @@ static int p_ret[MAX_SEM_POSIX_PROCS];
 
 /*
  *  semaphore_posix_thrash()
- *	exercise the semaphore
+ *	exercise the semaphore, returns the thread's wait latency
+ *	histogram or NULL if it could not be allocated
  */
 static void *semaphore_posix_thrash(void *arg)
 {
 	const stress_pthread_args_t *p_args = arg;
 	const stress_args_t *args = p_args->args;
-	static void *nowt = NULL;
+	stress_latency_t *latency = calloc(1, sizeof(*latency));
 
 	do {
 		int i;
 
 		for (i = 0; keep_stressing_flag() && i < 1000; i++) {
 			int value;
+			uint64_t t;
 
 			if (sem_getvalue(&sem, &value) < 0)
 				pr_fail("%s: sem_getvalue failed, errno=%d (%s)\n",
 					args->name, errno, strerror(errno));
 
+			t = stress_latency_now();
 			if (i & 1) {
 				if (sem_trywait(&sem) < 0) {
 					if (errno == 0 ||
@@ -111,6 +115,7 @@ static void *semaphore_posix_thrash(void *arg)
 					break;
 				}
 			}
+			stress_latency_record(latency, stress_latency_now() - t);
 			inc_counter(args);
 			if (sem_post(&sem) < 0) {
 				pr_fail("%s: sem_post failed, errno=%d (%s)\n",
@@ -124,7 +129,7 @@ static void *semaphore_posix_thrash(void *arg)
 		}
 	} while (keep_stressing(args));
 
-	return &nowt;
+	return latency;
 }
 
 /*
@@ -184,12 +189,19 @@ static int stress_sem(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	for (i = 0; i < semaphore_posix_procs; i++) {
+		void *latency = NULL;
+
 		if (p_ret[i])
 			continue;
 
-		VOID_RET(int, pthread_join(pthreads[i], NULL));
+		if ((pthread_join(pthreads[i], &latency) == 0) && latency) {
+			/* per thread histograms, merged to avoid racy updates */
+			stress_latency_merge(args->latency, (stress_latency_t *)latency);
+			free(latency);
+		}
 	}
 	(void)sem_destroy(&sem);
+	stress_latency_misc_stats(args, 0, "wait");
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,638 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+
+#if defined(HAVE_SYS_IPC_H)
+#include <sys/ipc.h>
+#endif
+
+#if defined(HAVE_SYS_SHM_H)
+#include <sys/shm.h>
+#endif
+
+#define MIN_SHMBENCH_BYTES	(4 * MB)
+#define MAX_SHMBENCH_BYTES	(1 * GB)
+#define DEFAULT_SHMBENCH_BYTES	(8 * MB)
+
+#define SHMBENCH_PHASE		(0.1)	/* seconds per message size */
+#define SHMBENCH_SPINS		(1024)	/* spins before yielding or sleeping */
+
+static const stress_help_t help[] = {
+	{ NULL,	"shmbench N",		"start N workers measuring shared memory ring throughput" },
+	{ NULL,	"shmbench-bytes N",	"size of the ring buffer, default 8M" },
+	{ NULL,	"shmbench-method M",	"one of all, sysv, posix, memfd or devshm" },
+	{ NULL,	"shmbench-ops N",	"stop after N messages" },
+	{ NULL,	"shmbench-wake M",	"consumer and producer wakeup, one of both, spin or futex" },
+	{ NULL,	NULL,			NULL }
+};
+
+#define SHMBENCH_SYSV		(1)	/* shmget/shmat */
+#define SHMBENCH_POSIX		(2)	/* shm_open and mmap */
+#define SHMBENCH_MEMFD		(3)	/* memfd_create and mmap */
+#define SHMBENCH_DEVSHM		(4)	/* file on /dev/shm and mmap */
+
+static const char * const shmbench_methods[] = {
+	"all",
+	"sysv",
+	"posix",
+	"memfd",
+	"devshm",
+};
+
+#define SHMBENCH_METHODS	(SIZEOF_ARRAY(shmbench_methods))
+
+#define SHMBENCH_SPIN		(1)	/* busy poll the ring indexes */
+#define SHMBENCH_FUTEX		(2)	/* sleep on the ring indexes */
+
+static const char * const shmbench_wakes[] = {
+	"both",
+	"spin",
+	"futex",
+};
+
+#define SHMBENCH_WAKES		(SIZEOF_ARRAY(shmbench_wakes))
+
+static int stress_set_shmbench_bytes(const char *opt)
+{
+	size_t shmbench_bytes;
+
+	shmbench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("shmbench-bytes", shmbench_bytes,
+		MIN_SHMBENCH_BYTES, MAX_SHMBENCH_BYTES);
+	return stress_set_setting("shmbench-bytes", TYPE_ID_SIZE_T, &shmbench_bytes);
+}
+
+static int stress_set_shmbench_choice(
+	const char *opt,
+	const char *name,
+	const char * const *choices,
+	const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (!strcmp(opt, choices[i]))
+			return stress_set_setting(name, TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "%s must be one of:", name);
+	for (i = 0; i < n; i++)
+		(void)fprintf(stderr, " %s", choices[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_shmbench_method(const char *opt)
+{
+	return stress_set_shmbench_choice(opt, "shmbench-method",
+		shmbench_methods, SHMBENCH_METHODS);
+}
+
+static int stress_set_shmbench_wake(const char *opt)
+{
+	return stress_set_shmbench_choice(opt, "shmbench-wake",
+		shmbench_wakes, SHMBENCH_WAKES);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_shmbench_bytes,	stress_set_shmbench_bytes },
+	{ OPT_shmbench_method,	stress_set_shmbench_method },
+	{ OPT_shmbench_wake,	stress_set_shmbench_wake },
+	{ 0,			NULL }
+};
+
+#if defined(__linux__) &&	\
+    defined(HAVE_ATOMIC)
+
+/* message sizes, 64 bytes to 1MB */
+static const size_t shmbench_sizes[] = {
+	64,
+	256,
+	1 * KB,
+	4 * KB,
+	16 * KB,
+	64 * KB,
+	256 * KB,
+	1 * MB,
+};
+
+static const char * const shmbench_size_names[] = {
+	"64B",
+	"256B",
+	"1K",
+	"4K",
+	"16K",
+	"64K",
+	"256K",
+	"1M",
+};
+
+#define SHMBENCH_SIZES		(SIZEOF_ARRAY(shmbench_sizes))
+
+/* ring index, each in its own cache line, also the futex word */
+typedef struct {
+	uint32_t index;		/* messages produced (tail) or consumed (head) */
+	uint32_t waiting;	/* set while the other side sleeps on index */
+} ALIGN64 stress_shmbench_index_t;
+
+/* ring control, shared between the producer and consumer */
+typedef struct {
+	stress_shmbench_index_t tail;	/* written by the producer */
+	stress_shmbench_index_t head;	/* written by the consumer */
+	struct {
+		uint32_t done;		/* producer has finished */
+		uint32_t slots;		/* messages in the ring */
+		size_t msg_size;	/* bytes per message */
+		size_t wake;		/* SHMBENCH_SPIN or SHMBENCH_FUTEX */
+		uint64_t messages;	/* messages consumed */
+		uint64_t errors;	/* messages with a bad sequence stamp */
+		double t_end;		/* time the last message was consumed */
+	} ALIGN64 ctrl;
+} stress_shmbench_ring_t;
+
+/* a shared memory region holding the ring control and data */
+typedef struct {
+	size_t method;			/* SHMBENCH_SYSV .. SHMBENCH_DEVSHM */
+	size_t size;			/* total bytes mapped */
+	stress_shmbench_ring_t *ring;	/* control, first page */
+	uint8_t *data;			/* message slots, after the control */
+} stress_shmbench_shm_t;
+
+/* throughput of one method, wake mode and message size */
+typedef struct {
+	uint64_t messages;
+	uint64_t bytes;
+	double duration;
+} stress_shmbench_stats_t;
+
+/*
+ *  stress_shmbench_map_fd()
+ *	size and map a shared memory file descriptor, the fd is closed
+ */
+static void *stress_shmbench_map_fd(const int fd, const size_t size)
+{
+	void *ptr;
+
+	if (ftruncate(fd, (off_t)size) < 0) {
+		(void)close(fd);
+		return NULL;
+	}
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	(void)close(fd);
+
+	return (ptr == MAP_FAILED) ? NULL : ptr;
+}
+
+/*
+ *  stress_shmbench_create()
+ *	create a shared memory region of size bytes using the given
+ *	method, names are removed straight away so the region goes
+ *	away with the last mapping, returns -1 and errno on failure
+ */
+static int stress_shmbench_create(
+	const stress_args_t *args,
+	const size_t method,
+	const size_t size,
+	stress_shmbench_shm_t *shm)
+{
+	char name[64];
+	void *ptr = NULL;
+	int fd;
+
+	switch (method) {
+#if defined(HAVE_SYS_IPC_H) &&	\
+    defined(HAVE_SYS_SHM_H) &&	\
+    defined(HAVE_SHM_SYSV)
+	case SHMBENCH_SYSV:
+		{
+			const int shm_id = shmget(IPC_PRIVATE, size, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+			if (shm_id < 0)
+				return -1;
+			ptr = shmat(shm_id, NULL, 0);
+			(void)shmctl(shm_id, IPC_RMID, NULL);
+			if (ptr == (void *)-1)
+				return -1;
+		}
+		break;
+#endif
+#if defined(HAVE_LIB_RT)
+	case SHMBENCH_POSIX:
+		(void)snprintf(name, sizeof(name), "/stress-ng-shmbench-%" PRIdMAX "-%" PRIu32,
+			(intmax_t)args->pid, args->instance);
+		fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (fd < 0)
+			return -1;
+		(void)shm_unlink(name);
+		ptr = stress_shmbench_map_fd(fd, size);
+		break;
+#endif
+#if defined(HAVE_MEMFD_CREATE)
+	case SHMBENCH_MEMFD:
+		(void)snprintf(name, sizeof(name), "stress-ng-shmbench-%" PRIu32,
+			args->instance);
+		fd = shim_memfd_create(name, 0);
+		if (fd < 0)
+			return -1;
+		ptr = stress_shmbench_map_fd(fd, size);
+		break;
+#endif
+	case SHMBENCH_DEVSHM:
+		(void)snprintf(name, sizeof(name), "/dev/shm/stress-ng-shmbench-%" PRIdMAX "-%" PRIu32,
+			(intmax_t)args->pid, args->instance);
+		fd = open(name, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (fd < 0)
+			return -1;
+		(void)shim_unlink(name);
+		ptr = stress_shmbench_map_fd(fd, size);
+		break;
+	default:
+		(void)args;
+		(void)name;
+		(void)fd;
+		errno = ENOSYS;
+		return -1;
+	}
+	if (!ptr)
+		return -1;
+
+	shm->method = method;
+	shm->size = size;
+	shm->ring = (stress_shmbench_ring_t *)ptr;
+	shm->data = (uint8_t *)ptr + args->page_size;
+	return 0;
+}
+
+/*
+ *  stress_shmbench_destroy()
+ *	unmap a shared memory region
+ */
+static void stress_shmbench_destroy(stress_shmbench_shm_t *shm)
+{
+#if defined(HAVE_SYS_IPC_H) &&	\
+    defined(HAVE_SYS_SHM_H) &&	\
+    defined(HAVE_SHM_SYSV)
+	if (shm->method == SHMBENCH_SYSV) {
+		(void)shmdt((void *)shm->ring);
+		return;
+	}
+#endif
+	(void)munmap((void *)shm->ring, shm->size);
+}
+
+/*
+ *  stress_shmbench_relax()
+ *	spin wait body, yield now and then so that a producer and
+ *	consumer sharing a CPU make progress
+ */
+static inline void stress_shmbench_relax(uint32_t *spins)
+{
+#if defined(HAVE_ASM_X86_PAUSE)
+	__asm__ __volatile__("pause;\n" ::: "memory");
+#endif
+	if (++(*spins) >= SHMBENCH_SPINS) {
+		*spins = 0;
+		(void)shim_sched_yield();
+	}
+}
+
+/*
+ *  stress_shmbench_wait()
+ *	wait until index no longer holds value or, for the consumer,
+ *	the producer is done. In futex mode spin a little and then
+ *	advertise the wait and sleep on the index, the waker checks
+ *	waiting after updating the index so no wakeup is lost
+ */
+static void stress_shmbench_wait(
+	stress_shmbench_ring_t *ring,
+	stress_shmbench_index_t *idx,
+	const uint32_t value,
+	const bool consumer)
+{
+	uint32_t spins = 0, tries = 0;
+
+	for (;;) {
+		if (__atomic_load_n(&idx->index, __ATOMIC_ACQUIRE) != value)
+			return;
+		if (consumer && __atomic_load_n(&ring->ctrl.done, __ATOMIC_ACQUIRE))
+			return;
+		if ((ring->ctrl.wake == SHMBENCH_SPIN) || (tries++ < SHMBENCH_SPINS)) {
+			stress_shmbench_relax(&spins);
+			continue;
+		}
+		__atomic_store_n(&idx->waiting, 1, __ATOMIC_SEQ_CST);
+		if ((__atomic_load_n(&idx->index, __ATOMIC_SEQ_CST) == value) &&
+		    !(consumer && __atomic_load_n(&ring->ctrl.done, __ATOMIC_SEQ_CST)))
+			(void)shim_futex_wait(&idx->index, (int)value, NULL);
+		__atomic_store_n(&idx->waiting, 0, __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ *  stress_shmbench_publish()
+ *	advance an index and wake the other side if it sleeps on it
+ */
+static inline void stress_shmbench_publish(
+	stress_shmbench_ring_t *ring,
+	stress_shmbench_index_t *idx,
+	const uint32_t value)
+{
+	__atomic_store_n(&idx->index, value, __ATOMIC_SEQ_CST);
+	if ((ring->ctrl.wake == SHMBENCH_FUTEX) &&
+	    __atomic_load_n(&idx->waiting, __ATOMIC_SEQ_CST))
+		(void)shim_futex_wake(&idx->index, 1);
+}
+
+/*
+ *  stress_shmbench_consumer()
+ *	copy messages out of the ring until the producer is done and
+ *	the ring is empty, checking each message sequence stamp
+ */
+static void stress_shmbench_consumer(stress_shmbench_shm_t *shm, uint8_t *buf)
+{
+	stress_shmbench_ring_t *ring = shm->ring;
+	const size_t msg_size = ring->ctrl.msg_size;
+	const uint32_t slots = ring->ctrl.slots;
+	uint32_t head = 0;
+	uint64_t errors = 0;
+
+	for (;;) {
+		const uint8_t *msg;
+		uint64_t seq;
+
+		stress_shmbench_wait(ring, &ring->tail, head, true);
+		if (__atomic_load_n(&ring->tail.index, __ATOMIC_ACQUIRE) == head)
+			break;	/* done and empty */
+
+		msg = shm->data + ((size_t)(head % slots) * msg_size);
+		(void)memcpy((void *)buf, (const void *)msg, msg_size);
+		(void)memcpy((void *)&seq, (const void *)buf, sizeof(seq));
+		if (seq != head)
+			errors++;
+		head++;
+		stress_shmbench_publish(ring, &ring->head, head);
+	}
+	ring->ctrl.messages = head;
+	ring->ctrl.errors = errors;
+	ring->ctrl.t_end = stress_time_now();
+}
+
+/*
+ *  stress_shmbench_run()
+ *	fork a consumer and produce messages of msg_size bytes into
+ *	the ring for a short phase, returns -1 if the consumer could
+ *	not be started, -2 on corrupted messages
+ */
+static int stress_shmbench_run(
+	const stress_args_t *args,
+	stress_shmbench_shm_t *shm,
+	const size_t ring_bytes,
+	const size_t msg_size,
+	const size_t wake,
+	uint8_t *buf,
+	stress_shmbench_stats_t *stats)
+{
+	stress_shmbench_ring_t *ring = shm->ring;
+	const uint32_t slots = (uint32_t)(ring_bytes / msg_size);
+	double t_start, t_end;
+	uint32_t tail = 0;
+	pid_t pid;
+	int status;
+
+	(void)memset((void *)ring, 0, sizeof(*ring));
+	ring->ctrl.slots = slots;
+	ring->ctrl.msg_size = msg_size;
+	ring->ctrl.wake = wake;
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(errno))
+			goto again;
+		return -1;
+	} else if (pid == 0) {
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+		stress_shmbench_consumer(shm, buf);
+		_exit(0);
+	}
+
+	t_start = stress_time_now();
+	t_end = t_start + SHMBENCH_PHASE;
+	for (;;) {
+		uint8_t *msg;
+		const uint64_t seq = tail;
+
+		/* wait while the ring is full */
+		if ((uint32_t)(tail - __atomic_load_n(&ring->head.index, __ATOMIC_ACQUIRE)) >= slots)
+			stress_shmbench_wait(ring, &ring->head, tail - slots, false);
+
+		msg = shm->data + ((size_t)(tail % slots) * msg_size);
+		(void)memcpy((void *)buf, (const void *)&seq, sizeof(seq));
+		(void)memcpy((void *)msg, (const void *)buf, msg_size);
+		tail++;
+		stress_shmbench_publish(ring, &ring->tail, tail);
+
+		if (((tail & 63) == 0) &&
+		    ((stress_time_now() >= t_end) || !keep_stressing(args)))
+			break;
+	}
+	__atomic_store_n(&ring->ctrl.done, 1, __ATOMIC_SEQ_CST);
+	if ((wake == SHMBENCH_FUTEX) &&
+	    __atomic_load_n(&ring->tail.waiting, __ATOMIC_SEQ_CST))
+		(void)shim_futex_wake(&ring->tail.index, 1);
+
+	(void)shim_waitpid(pid, &status, 0);
+	if (ring->ctrl.t_end <= t_start)
+		return 0;
+
+	stats->messages += ring->ctrl.messages;
+	stats->bytes += ring->ctrl.messages * msg_size;
+	stats->duration += ring->ctrl.t_end - t_start;
+	add_counter(args, ring->ctrl.messages);
+
+	if (ring->ctrl.errors) {
+		pr_fail("%s: %s consumer got %" PRIu64 " out of sequence %zu byte messages\n",
+			args->name, shmbench_methods[shm->method],
+			ring->ctrl.errors, msg_size);
+		return -2;
+	}
+	return 0;
+}
+
+/*
+ *  stress_shmbench()
+ *	measure single producer single consumer ring throughput over
+ *	sysv, posix, memfd and /dev/shm shared memory for message
+ *	sizes of 64 bytes to 1MB, with spinning and futex wakeups
+ */
+static int stress_shmbench(const stress_args_t *args)
+{
+	static stress_shmbench_stats_t stats[SHMBENCH_METHODS][SHMBENCH_WAKES][SHMBENCH_SIZES];
+	size_t shmbench_bytes = DEFAULT_SHMBENCH_BYTES;
+	size_t shmbench_method = 0, shmbench_wake = 0, m, w, s, idx = 0;
+	bool skipped[SHMBENCH_METHODS];
+	uint8_t *buf;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("shmbench-method", &shmbench_method);
+	(void)stress_get_setting("shmbench-wake", &shmbench_wake);
+	if (!stress_get_setting("shmbench-bytes", &shmbench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			shmbench_bytes = 64 * MB;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			shmbench_bytes = MIN_SHMBENCH_BYTES;
+	}
+	shmbench_bytes &= ~(args->page_size - 1);
+
+	/* the producer and consumer copy messages through this buffer */
+	buf = (uint8_t *)mmap(NULL, 1 * MB, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate message buffer, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_mwc_fill(buf, 1 * MB);
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(skipped, 0, sizeof(skipped));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 1; (m < SHMBENCH_METHODS) && keep_stressing(args); m++) {
+			stress_shmbench_shm_t shm;
+
+			if ((shmbench_method && (shmbench_method != m)) || skipped[m])
+				continue;
+			if (stress_shmbench_create(args, m,
+					args->page_size + shmbench_bytes, &shm) < 0) {
+				if ((errno == ENOMEM) || (errno == ENOSPC))
+					continue;
+				if (args->instance == 0)
+					pr_inf("%s: %s skipped, errno=%d (%s)\n",
+						args->name, shmbench_methods[m],
+						errno, strerror(errno));
+				skipped[m] = true;
+				continue;
+			}
+			for (w = 1; (w < SHMBENCH_WAKES) && keep_stressing(args); w++) {
+				if (shmbench_wake && (shmbench_wake != w))
+					continue;
+				for (s = 0; (s < SHMBENCH_SIZES) && keep_stressing(args); s++) {
+					const int ret = stress_shmbench_run(args, &shm,
+						shmbench_bytes, shmbench_sizes[s], w,
+						buf, &stats[m][w][s]);
+
+					if (ret == -2) {
+						rc = EXIT_FAILURE;
+						stress_shmbench_destroy(&shm);
+						goto report;
+					}
+					if (ret < 0)
+						break;
+				}
+			}
+			stress_shmbench_destroy(&shm);
+		}
+	} while (keep_stressing(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		char line[256];
+		size_t t;
+
+		/* two tables, millions of messages/sec and GB/sec */
+		for (t = 0; t < 2; t++) {
+			size_t len;
+
+			len = (size_t)snprintf(line, sizeof(line), "%-14s",
+				t ? "GB/sec" : "M msgs/sec");
+			for (s = 0; s < SHMBENCH_SIZES; s++)
+				len += (size_t)snprintf(line + len, sizeof(line) - len,
+					" %7s", shmbench_size_names[s]);
+			pr_inf("%s: %s\n", args->name, line);
+
+			for (m = 1; m < SHMBENCH_METHODS; m++) {
+				for (w = 1; w < SHMBENCH_WAKES; w++) {
+					char label[32];
+
+					if (!stats[m][w][0].messages)
+						continue;
+					(void)snprintf(label, sizeof(label), "%s %s",
+						shmbench_methods[m], shmbench_wakes[w]);
+					len = (size_t)snprintf(line, sizeof(line), "%-14s", label);
+					for (s = 0; s < SHMBENCH_SIZES; s++) {
+						const stress_shmbench_stats_t *st = &stats[m][w][s];
+						double val = 0.0;
+
+						if (st->duration > 0.0)
+							val = t ? (double)st->bytes / (st->duration * (double)GB) :
+								  (double)st->messages / (st->duration * 1000000.0);
+						len += (size_t)snprintf(line + len, sizeof(line) - len,
+							" %7.2f", val);
+					}
+					pr_inf("%s: %s\n", args->name, line);
+				}
+			}
+		}
+	}
+
+	for (m = 1; m < SHMBENCH_METHODS; m++) {
+		for (w = 1; w < SHMBENCH_WAKES; w++) {
+			const stress_shmbench_stats_t *small = &stats[m][w][0];
+			const stress_shmbench_stats_t *large = &stats[m][w][SHMBENCH_SIZES - 1];
+			char desc[32];
+
+			if ((small->duration > 0.0) && (idx < STRESS_MISC_STATS_MAX)) {
+				(void)snprintf(desc, sizeof(desc), "%s %s 64B M msgs/sec",
+					shmbench_methods[m], shmbench_wakes[w]);
+				stress_misc_stats_set(args->misc_stats, idx++, desc,
+					(double)small->messages / (small->duration * 1000000.0));
+			}
+			if ((large->duration > 0.0) && (idx < STRESS_MISC_STATS_MAX)) {
+				(void)snprintf(desc, sizeof(desc), "%s %s 1M GB/sec",
+					shmbench_methods[m], shmbench_wakes[w]);
+				stress_misc_stats_set(args->misc_stats, idx++, desc,
+					(double)large->bytes / (large->duration * (double)GB));
+			}
+		}
+	}
+
+	(void)munmap((void *)buf, 1 * MB);
+
+	return rc;
+}
+
+stressor_info_t stress_shmbench_info = {
+	.stressor = stress_shmbench,
+	.class = CLASS_MEMORY | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_shmbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_MEMORY | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
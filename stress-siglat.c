@@ -0,0 +1,660 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+
+#if defined(HAVE_SYS_SIGNALFD_H)
+#include <sys/signalfd.h>
+#endif
+
+#define MIN_SIGLAT_THREADS	(1)
+#define MAX_SIGLAT_THREADS	(64)
+
+#define SIGLAT_STEP		(0.2)	/* seconds per method and thread count */
+#define SIGLAT_MAX_COUNTS	(8)	/* 1, 2, 4 .. 64 and the maximum */
+#define SIGLAT_TIMEOUT		(0.1)	/* seconds to wait for a lost signal */
+#define SIGLAT_INFLIGHT		(4)	/* rt signals in flight per thread */
+
+static const stress_help_t help[] = {
+	{ NULL,	"siglat N",		"start N workers measuring signal delivery latency" },
+	{ NULL,	"siglat-method M",	"select kill, sigqueue-fd, rt or all, default is all" },
+	{ NULL,	"siglat-ops N",		"stop after N signals have been received" },
+	{ NULL,	"siglat-threads N",	"sweep 1 to N target threads, default is the number of CPUs" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const siglat_methods[] = {
+	"all",
+	"kill",
+	"sigqueue-fd",
+	"rt",
+};
+
+static int stress_set_siglat_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(siglat_methods); i++) {
+		if (!strcmp(opt, siglat_methods[i]))
+			return stress_set_setting("siglat-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "siglat-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(siglat_methods); i++)
+		(void)fprintf(stderr, " %s", siglat_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_siglat_threads(const char *opt)
+{
+	uint32_t siglat_threads;
+
+	siglat_threads = stress_get_uint32(opt);
+	stress_check_range("siglat-threads", (uint64_t)siglat_threads,
+		MIN_SIGLAT_THREADS, MAX_SIGLAT_THREADS);
+	return stress_set_setting("siglat-threads", TYPE_ID_UINT32, &siglat_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_siglat_method,	stress_set_siglat_method },
+	{ OPT_siglat_threads,	stress_set_siglat_threads },
+	{ 0,			NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(HAVE_SIGQUEUE) &&		\
+    defined(HAVE_SYS_SIGNALFD_H) &&	\
+    defined(HAVE_SIGNALFD) &&		\
+    defined(SIGUSR1) &&			\
+    defined(SIGRTMIN) &&		\
+    defined(SA_SIGINFO) &&		\
+    defined(SI_QUEUE)
+
+#define SIGLAT_KILL		(1)
+#define SIGLAT_SIGQUEUE_FD	(2)
+#define SIGLAT_RT		(3)
+#define SIGLAT_METHODS		(SIZEOF_ARRAY(siglat_methods))
+
+/* histogram buckets of the per-method report, upper bounds in ns */
+static const uint64_t siglat_buckets[] = {
+	1000, 2000, 5000, 10000, 20000, 50000,
+	100000, 1000000, 10000000, UINT64_MAX
+};
+
+typedef struct stress_siglat stress_siglat_t;
+
+/* per target thread state */
+typedef struct {
+	stress_siglat_t *sl;
+	pthread_t pthread;
+	pid_t tid;				/* for the signal handler lookup */
+	uint64_t received;			/* signals received */
+	stress_latency_t lat;			/* send to receive latency */
+	int ret;
+} stress_siglat_thread_t;
+
+/* state shared by the sender and the target threads of a step */
+struct stress_siglat {
+	stress_siglat_thread_t *threads;
+	uint32_t n_threads;			/* threads started */
+	int sig;				/* signal being sent */
+	int sfd;				/* signalfd for sigqueue-fd */
+	uint64_t send_ts ALIGN64;		/* kill send time, 0 when idle */
+	uint64_t acked ALIGN64;			/* signals received by all threads */
+	uint32_t ready;				/* threads waiting to start */
+	volatile bool start;
+	volatile bool stop;
+};
+
+/* sweep totals per method and thread count */
+typedef struct {
+	uint32_t threads;			/* threads that ran */
+	uint64_t received;
+	double duration;
+	stress_latency_t lat;
+} stress_siglat_stats_t;
+
+static stress_siglat_t *siglat;
+
+/*
+ *  stress_siglat_thread_find()
+ *	find the state of the thread running the signal handler
+ */
+static inline stress_siglat_thread_t *stress_siglat_thread_find(void)
+{
+	const pid_t tid = shim_gettid();
+	uint32_t i;
+
+	for (i = 0; i < siglat->n_threads; i++) {
+		if (siglat->threads[i].tid == tid)
+			return &siglat->threads[i];
+	}
+	return NULL;
+}
+
+/*
+ *  stress_siglat_record()
+ *	account for a signal sent at send_ts arriving now
+ */
+static inline void stress_siglat_record(stress_siglat_thread_t *t, const uint64_t send_ts)
+{
+	const uint64_t now = stress_latency_now();
+
+	stress_latency_record(&t->lat, (now > send_ts) ? now - send_ts : 0);
+	t->received++;
+	(void)__atomic_add_fetch(&siglat->acked, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ *  stress_siglat_kill_handler()
+ *	kill() has no payload, the send time is in send_ts and
+ *	wake ups to stop the threads find it zero
+ */
+static void MLOCKED_TEXT stress_siglat_kill_handler(int signum)
+{
+	stress_siglat_thread_t *t;
+	uint64_t send_ts;
+
+	(void)signum;
+
+	send_ts = __atomic_exchange_n(&siglat->send_ts, 0, __ATOMIC_ACQ_REL);
+	if (!send_ts)
+		return;
+	t = stress_siglat_thread_find();
+	if (t)
+		stress_siglat_record(t, send_ts);
+}
+
+/*
+ *  stress_siglat_rt_handler()
+ *	queued rt signals carry their send time, wake ups to
+ *	stop the threads are sent with pthread_kill and ignored
+ */
+static void MLOCKED_TEXT stress_siglat_rt_handler(int signum, siginfo_t *info, void *ucontext)
+{
+	stress_siglat_thread_t *t;
+
+	(void)signum;
+	(void)ucontext;
+
+	if (info->si_code != SI_QUEUE)
+		return;
+	t = stress_siglat_thread_find();
+	if (t)
+		stress_siglat_record(t, (uint64_t)(uintptr_t)info->si_value.sival_ptr);
+}
+
+/*
+ *  stress_siglat_thread_init()
+ *	announce the thread and wait for the sender to start
+ */
+static void stress_siglat_thread_init(stress_siglat_thread_t *t)
+{
+	stress_siglat_t *sl = t->sl;
+
+	t->tid = shim_gettid();
+	(void)__atomic_add_fetch(&sl->ready, 1, __ATOMIC_RELEASE);
+	while (!sl->start && !sl->stop)
+		shim_sched_yield();
+}
+
+/*
+ *  stress_siglat_handler_thread()
+ *	target for the kill and rt methods, the signal is only
+ *	unblocked while waiting in sigsuspend so the stop wake
+ *	up cannot be lost
+ */
+static void *stress_siglat_handler_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_siglat_thread_t *t = (stress_siglat_thread_t *)arg;
+	stress_siglat_t *sl = t->sl;
+	sigset_t mask;
+
+	(void)sigfillset(&mask);
+	(void)sigdelset(&mask, sl->sig);
+
+	stress_siglat_thread_init(t);
+	while (!sl->stop)
+		(void)sigsuspend(&mask);
+
+	return &nowt;
+}
+
+/*
+ *  stress_siglat_signalfd_thread()
+ *	target for the sigqueue-fd method, all the threads block
+ *	reading the same signalfd, a NULL payload is a stop wake up
+ */
+static void *stress_siglat_signalfd_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_siglat_thread_t *t = (stress_siglat_thread_t *)arg;
+	stress_siglat_t *sl = t->sl;
+
+	stress_siglat_thread_init(t);
+	while (!sl->stop) {
+		struct signalfd_siginfo fdsi;
+		const ssize_t ret = read(sl->sfd, &fdsi, sizeof(fdsi));
+
+		if (ret != (ssize_t)sizeof(fdsi)) {
+			if ((ret < 0) && (errno != EINTR) && (errno != EAGAIN)) {
+				t->ret = errno;
+				break;
+			}
+			continue;
+		}
+		if (fdsi.ssi_ptr)
+			stress_siglat_record(t, (uint64_t)fdsi.ssi_ptr);
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_siglat_drain()
+ *	discard any signals still queued to the process
+ */
+static void stress_siglat_drain(const sigset_t *set)
+{
+	struct timespec timeout;
+
+	timeout.tv_sec = 0;
+	timeout.tv_nsec = 0;
+	while (sigtimedwait(set, NULL, &timeout) > 0)
+		;
+}
+
+/*
+ *  stress_siglat_wait_ack()
+ *	wait for the target threads to have received acked signals,
+ *	returns false if a signal got lost
+ */
+static bool stress_siglat_wait_ack(stress_siglat_t *sl, const uint64_t acked)
+{
+	double t_timeout = 0.0;
+	uint32_t spins = 0;
+
+	while (__atomic_load_n(&sl->acked, __ATOMIC_ACQUIRE) < acked) {
+		shim_sched_yield();
+		if ((++spins & 1023) == 0) {
+			if (t_timeout == 0.0)
+				t_timeout = stress_time_now() + SIGLAT_TIMEOUT;
+			else if (stress_time_now() > t_timeout)
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ *  stress_siglat_step()
+ *	send signals to n_threads target threads for SIGLAT_STEP
+ *	seconds with the given method, results are added to stats
+ */
+static void stress_siglat_step(
+	const stress_args_t *args,
+	stress_siglat_t *sl,
+	const size_t method,
+	const uint32_t n_threads,
+	const sigset_t *set,
+	stress_siglat_stats_t *stats)
+{
+	const pid_t self = getpid();
+	uint64_t sent = 0, lost = 0, received = 0;
+	uint32_t i;
+	double t_start, t_end, duration;
+	void *(*func)(void *) = (method == SIGLAT_SIGQUEUE_FD) ?
+		stress_siglat_signalfd_thread : stress_siglat_handler_thread;
+
+	sl->sig = (method == SIGLAT_KILL) ? SIGUSR1 :
+		  (method == SIGLAT_SIGQUEUE_FD) ? SIGRTMIN + 1 : SIGRTMIN + 2;
+	sl->n_threads = 0;
+	sl->send_ts = 0;
+	sl->acked = 0;
+	sl->ready = 0;
+	sl->start = false;
+	sl->stop = false;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_siglat_thread_t *t = &sl->threads[i];
+
+		(void)memset((void *)t, 0, sizeof(*t));
+		t->sl = sl;
+		sl->n_threads = i + 1;
+		t->ret = pthread_create(&t->pthread, NULL, func, (void *)t);
+		if (t->ret) {
+			sl->n_threads = i;
+			break;
+		}
+	}
+	if (!sl->n_threads)
+		return;
+	while (__atomic_load_n(&sl->ready, __ATOMIC_ACQUIRE) < sl->n_threads)
+		shim_sched_yield();
+
+	t_start = stress_time_now();
+	t_end = t_start + SIGLAT_STEP;
+	sl->start = true;
+
+	while (keep_stressing_flag() && (stress_time_now() < t_end)) {
+		union sigval s;
+
+		switch (method) {
+		case SIGLAT_KILL:
+			/* one at a time, the handler clears send_ts */
+			__atomic_store_n(&sl->send_ts, stress_latency_now(), __ATOMIC_RELEASE);
+			if (kill(self, sl->sig) < 0)
+				goto done;
+			sent++;
+			if (!stress_siglat_wait_ack(sl, sent)) {
+				__atomic_store_n(&sl->send_ts, 0, __ATOMIC_RELEASE);
+				sent = __atomic_load_n(&sl->acked, __ATOMIC_ACQUIRE);
+				lost++;
+			}
+			break;
+		case SIGLAT_SIGQUEUE_FD:
+			/* one at a time, read by one of the signalfd readers */
+			s.sival_ptr = (void *)(uintptr_t)stress_latency_now();
+			if (sigqueue(self, sl->sig, s) < 0)
+				goto done;
+			sent++;
+			if (!stress_siglat_wait_ack(sl, sent)) {
+				sent = __atomic_load_n(&sl->acked, __ATOMIC_ACQUIRE);
+				lost++;
+			}
+			break;
+		default:
+			/* throughput, keep SIGLAT_INFLIGHT per thread queued */
+			if (sent - __atomic_load_n(&sl->acked, __ATOMIC_ACQUIRE) >=
+			    (uint64_t)SIGLAT_INFLIGHT * sl->n_threads) {
+				shim_sched_yield();
+				break;
+			}
+			s.sival_ptr = (void *)(uintptr_t)stress_latency_now();
+			if (sigqueue(self, sl->sig, s) < 0) {
+				if (errno != EAGAIN)
+					goto done;
+				shim_sched_yield();
+				break;
+			}
+			sent++;
+			break;
+		}
+	}
+	if (method == SIGLAT_RT)
+		(void)stress_siglat_wait_ack(sl, sent);
+done:
+	duration = stress_time_now() - t_start;
+
+	sl->stop = true;
+	shim_mb();
+	for (i = 0; i < sl->n_threads; i++) {
+		if (method == SIGLAT_SIGQUEUE_FD) {
+			union sigval s;
+
+			s.sival_ptr = NULL;
+			(void)sigqueue(self, sl->sig, s);
+		} else {
+			(void)pthread_kill(sl->threads[i].pthread, sl->sig);
+		}
+	}
+	for (i = 0; i < sl->n_threads; i++) {
+		stress_siglat_thread_t *t = &sl->threads[i];
+
+		(void)pthread_join(t->pthread, NULL);
+		if (t->ret && (method == SIGLAT_SIGQUEUE_FD))
+			pr_fail("%s: signalfd read failed, errno=%d (%s)\n",
+				args->name, t->ret, strerror(t->ret));
+		received += t->received;
+		stress_latency_merge(&stats->lat, &t->lat);
+		if (args->latency)
+			stress_latency_merge(args->latency, &t->lat);
+	}
+	stress_siglat_drain(set);
+
+	if (lost)
+		pr_dbg("%s: %s: %" PRIu64 " signals not received within %.1f seconds\n",
+			args->name, siglat_methods[method], lost, SIGLAT_TIMEOUT);
+
+	stats->threads = sl->n_threads;
+	stats->received += received;
+	stats->duration += duration;
+	add_counter(args, received);
+}
+
+/*
+ *  stress_siglat_report()
+ *	report the per thread count rates and latencies and a
+ *	latency histogram for each method
+ */
+static void stress_siglat_report(
+	const stress_args_t *args,
+	stress_siglat_stats_t stats[SIGLAT_METHODS][SIGLAT_MAX_COUNTS],
+	const size_t n_counts,
+	const bool verbose)
+{
+	static stress_latency_t lat;
+	size_t i, j, idx = 0;
+
+	if (verbose)
+		pr_inf("%s: method      threads    ksig/s    mean ns     p50 ns     p99 ns     max ns\n",
+			args->name);
+	for (i = SIGLAT_KILL; i < SIGLAT_METHODS; i++) {
+		for (j = 0; j < n_counts; j++) {
+			const stress_siglat_stats_t *st = &stats[i][j];
+
+			if (!st->lat.count || !verbose)
+				continue;
+			pr_inf("%s: %-11s %7" PRIu32 " %9.2f %10.0f %10" PRIu64
+				" %10" PRIu64 " %10" PRIu64 "\n",
+				args->name, siglat_methods[i], st->threads,
+				(st->duration > 0.0) ? ((double)st->received / st->duration) / 1000.0 : 0.0,
+				stress_latency_mean(&st->lat),
+				stress_latency_percentile(&st->lat, 50.0),
+				stress_latency_percentile(&st->lat, 99.0),
+				st->lat.max);
+		}
+	}
+
+	for (i = SIGLAT_KILL; i < SIGLAT_METHODS; i++) {
+		size_t k, bucket = 0;
+		uint64_t below = 0;
+
+		stress_latency_reset(&lat);
+		for (j = 0; j < n_counts; j++)
+			stress_latency_merge(&lat, &stats[i][j].lat);
+		if (!lat.count)
+			continue;
+
+		/* counts per bucket are to the histogram resolution */
+		if (verbose)
+			pr_inf("%s: %s latency histogram, %" PRIu64 " signals, p99.9 %" PRIu64 " ns\n",
+				args->name, siglat_methods[i], lat.count,
+				stress_latency_percentile(&lat, 99.9));
+		for (k = 0; k < SIZEOF_ARRAY(siglat_buckets); k++) {
+			const size_t end = (siglat_buckets[k] == UINT64_MAX) ?
+				STRESS_LATENCY_BUCKETS : stress_latency_bucket(siglat_buckets[k]);
+			uint64_t n = 0;
+			char range[24];
+
+			for (; bucket < end; bucket++)
+				n += lat.buckets[bucket];
+			if (siglat_buckets[k] == UINT64_MAX)
+				(void)snprintf(range, sizeof(range), ">= %" PRIu64 " us",
+					siglat_buckets[k - 1] / 1000);
+			else
+				(void)snprintf(range, sizeof(range), "< %" PRIu64 " us",
+					siglat_buckets[k] / 1000);
+			below += n;
+			if (n && verbose)
+				pr_inf("%s:   %-12s %12" PRIu64 " %7.3f%%\n",
+					args->name, range, n, 100.0 * (double)n / (double)lat.count);
+			if (below == lat.count)
+				break;
+		}
+
+		if (idx + 2 <= STRESS_MISC_STATS_MAX) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s p99 latency (ns)", siglat_methods[i]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				(double)stress_latency_percentile(&lat, 99.0));
+			(void)snprintf(desc, sizeof(desc), "%s max latency (ns)", siglat_methods[i]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, (double)lat.max);
+		}
+	}
+
+	/* rt throughput at the highest thread count */
+	if ((stats[SIGLAT_RT][n_counts - 1].duration > 0.0) &&
+	    (idx < STRESS_MISC_STATS_MAX)) {
+		const stress_siglat_stats_t *st = &stats[SIGLAT_RT][n_counts - 1];
+
+		stress_misc_stats_set(args->misc_stats, idx, "rt signals/sec",
+			(double)st->received / st->duration);
+	}
+}
+
+/*
+ *  stress_siglat()
+ *	sweep the signal delivery methods over 1, 2, 4 .. N
+ *	target threads measuring the latency and throughput
+ */
+static int stress_siglat(const stress_args_t *args)
+{
+	static stress_siglat_stats_t stats[SIGLAT_METHODS][SIGLAT_MAX_COUNTS];
+	const int32_t cpus_online = stress_get_processors_online();
+	uint32_t siglat_threads = (cpus_online > 1) ? (uint32_t)cpus_online : 4;
+	uint32_t counts[SIGLAT_MAX_COUNTS], n;
+	size_t siglat_method = 0, i, j, n_counts = 0;
+	size_t threads_size;
+	sigset_t set, old_set;
+	struct sigaction action;
+	stress_siglat_t sl;
+	int ret = EXIT_SUCCESS;
+
+	(void)stress_get_setting("siglat-method", &siglat_method);
+	if (!stress_get_setting("siglat-threads", &siglat_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			siglat_threads = MAX_SIGLAT_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			siglat_threads = MIN_SIGLAT_THREADS;
+	}
+	if (siglat_threads > MAX_SIGLAT_THREADS)
+		siglat_threads = MAX_SIGLAT_THREADS;
+
+	/* 1, 2, 4 .. up to and including siglat_threads */
+	for (n = 1; (n < siglat_threads) && (n_counts < SIGLAT_MAX_COUNTS - 1); n <<= 1)
+		counts[n_counts++] = n;
+	counts[n_counts++] = siglat_threads;
+
+	(void)memset(&sl, 0, sizeof(sl));
+	threads_size = sizeof(*sl.threads) * siglat_threads;
+	sl.threads = (stress_siglat_thread_t *)mmap(NULL, threads_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (sl.threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %" PRIu32 " thread states, skipping stressor\n",
+			args->name, siglat_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	siglat = &sl;
+
+	/*
+	 *  The signals are blocked in the sender and inherited
+	 *  blocked by the target threads
+	 */
+	(void)sigemptyset(&set);
+	(void)sigaddset(&set, SIGUSR1);
+	(void)sigaddset(&set, SIGRTMIN + 1);
+	(void)sigaddset(&set, SIGRTMIN + 2);
+	if (sigprocmask(SIG_BLOCK, &set, &old_set) < 0) {
+		pr_fail("%s: sigprocmask failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)munmap((void *)sl.threads, threads_size);
+		return EXIT_FAILURE;
+	}
+
+	(void)memset(&action, 0, sizeof(action));
+	action.sa_handler = stress_siglat_kill_handler;
+	(void)sigemptyset(&action.sa_mask);
+	if (sigaction(SIGUSR1, &action, NULL) < 0) {
+		pr_fail("%s: sigaction SIGUSR1 failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		ret = EXIT_FAILURE;
+		goto restore;
+	}
+	(void)memset(&action, 0, sizeof(action));
+	action.sa_sigaction = stress_siglat_rt_handler;
+	action.sa_flags = SA_SIGINFO;
+	(void)sigemptyset(&action.sa_mask);
+	if (sigaction(SIGRTMIN + 2, &action, NULL) < 0) {
+		pr_fail("%s: sigaction SIGRTMIN+2 failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		ret = EXIT_FAILURE;
+		goto restore;
+	}
+
+	(void)sigemptyset(&set);
+	(void)sigaddset(&set, SIGRTMIN + 1);
+	sl.sfd = signalfd(-1, &set, 0);
+	if (sl.sfd < 0) {
+		pr_fail("%s: signalfd failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		ret = EXIT_FAILURE;
+		goto restore;
+	}
+	(void)sigaddset(&set, SIGUSR1);
+	(void)sigaddset(&set, SIGRTMIN + 2);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = SIGLAT_KILL; keep_stressing(args) && (i < SIGLAT_METHODS); i++) {
+			if (siglat_method && (siglat_method != i))
+				continue;
+			for (j = 0; keep_stressing(args) && (j < n_counts); j++)
+				stress_siglat_step(args, &sl, i, counts[j], &set, &stats[i][j]);
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_siglat_report(args, stats, n_counts, args->instance == 0);
+
+	(void)close(sl.sfd);
+restore:
+	(void)sigprocmask(SIG_SETMASK, &old_set, NULL);
+	(void)munmap((void *)sl.threads, threads_size);
+
+	return ret;
+}
+
+stressor_info_t stress_siglat_info = {
+	.stressor = stress_siglat,
+	.class = CLASS_INTERRUPT | CLASS_OS | CLASS_SCHEDULER,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_siglat_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_INTERRUPT | CLASS_OS | CLASS_SCHEDULER,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -18,11 +18,16 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arena.h"
+#include "core-ebr.h"
 
 #define MIN_SKIPLIST_SIZE	(1 * KB)
 #define MAX_SKIPLIST_SIZE	(4 * MB)
 #define DEFAULT_SKIPLIST_SIZE	(64 * KB)
 
+#define MIN_SKIPLIST_THREADS	(1)
+#define MAX_SKIPLIST_THREADS	(64)
+
 typedef struct skip_node {
 	unsigned long value;
 	struct skip_node *skip_nodes[1];
@@ -32,12 +37,14 @@ typedef struct {
 	size_t level;
 	size_t max_level;
 	skip_node_t *head;
+	stress_arena_t *arena;	/* node arena, NULL for libc */
 } skip_list_t;
 
 static const stress_help_t help[] = {
 	{ NULL,	"skiplist N",	  "start N workers that exercise a skiplist search" },
 	{ NULL,	"skiplist-ops N", "stop after N skiplist search bogo operations" },
 	{ NULL,	"skiplist-size N", "number of 32 bit integers to add to skiplist" },
+	{ NULL,	"skiplist-threads N", "N threads share one lock-free skiplist" },
 	{ NULL,	NULL,		  NULL }
 };
 
@@ -55,6 +62,20 @@ static int stress_set_skiplist_size(const char *opt)
 	return stress_set_setting("skiplist-size", TYPE_ID_UINT64, &skiplist_size);
 }
 
+/*
+ *  stress_set_skiplist_threads()
+ *	set number of threads for the shared skiplist mode
+ */
+static int stress_set_skiplist_threads(const char *opt)
+{
+	uint32_t skiplist_threads;
+
+	skiplist_threads = stress_get_uint32(opt);
+	stress_check_range("skiplist-threads", (uint64_t)skiplist_threads,
+		MIN_SKIPLIST_THREADS, MAX_SKIPLIST_THREADS);
+	return stress_set_setting("skiplist-threads", TYPE_ID_UINT32, &skiplist_threads);
+}
+
 /*
  *  skip_list_random_level()
  *	generate a quasi-random skip list level
@@ -76,10 +97,12 @@ static inline size_t skip_list_random_level(const size_t max_level)
  *  skip_node_alloc()
  *	allocate a skip list node
  */
-static skip_node_t *skip_node_alloc(const size_t levels)
+static skip_node_t *skip_node_alloc(skip_list_t *list, const size_t levels)
 {
 	const size_t sz = sizeof(skip_node_t) + (levels * sizeof(skip_node_t *));
 
+	if (list->arena)
+		return (skip_node_t *)stress_arena_calloc(list->arena, sz);
 	return (skip_node_t *)calloc(1, sz);
 }
 
@@ -87,12 +110,16 @@ static skip_node_t *skip_node_alloc(const size_t levels)
  *  skip_list_init
  *	initialize the skip list, return NULL if failed
  */
-static skip_list_t *skip_list_init(skip_list_t *list, const size_t max_level)
+static skip_list_t *skip_list_init(
+	skip_list_t *list,
+	const size_t max_level,
+	stress_arena_t *arena)
 {
 	register size_t i;
 	skip_node_t *head;
 
-	head = skip_node_alloc(max_level);
+	list->arena = arena;
+	head = skip_node_alloc(list, max_level);
 	if (!head)
 		return NULL;
 	list->level = 1;
@@ -139,7 +166,7 @@ static skip_node_t *skip_list_insert(skip_list_t *list, const unsigned long valu
 
 	if (level < 1)
 		return NULL;
-	skip_node = skip_node_alloc(level);
+	skip_node = skip_node_alloc(list, level);
 	if (!skip_node)
 		return NULL;
 	skip_node->value = value;
@@ -183,13 +210,18 @@ static inline unsigned long skip_list_ln2(unsigned long n)
 
 /*
  *  skip_list_free()
- *	free a skip list
+ *	free a skip list, arena nodes are free'd in one go
  */
 static void skip_list_free(skip_list_t *list)
 {
 	skip_node_t *head = list->head;
 	skip_node_t *skip_node = head;
 
+	if (list->arena) {
+		stress_arena_reset(list->arena);
+		return;
+	}
+
 	while (skip_node && skip_node->skip_nodes[1] != head) {
 		skip_node_t *next = skip_node->skip_nodes[1];
 
@@ -200,6 +232,505 @@ static void skip_list_free(skip_list_t *list)
 		free(skip_node);
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+
+#define LF_SKIP_MAX_LEVEL	(32)
+#define LF_SKIP_MARK		((uintptr_t)1)
+#define LF_SKIP_PTR(p)		((lf_skip_node_t *)((p) & ~LF_SKIP_MARK))
+#define LF_SKIP_MARKED(p)	((p) & LF_SKIP_MARK)
+
+#define SKIPLIST_STEP		(0.5)	/* seconds per thread count */
+#define SKIPLIST_SAMPLES	(32)	/* reclamation samples per step */
+#define SKIPLIST_MAX_COUNTS	(8)	/* thread counts in the sweep */
+
+/*
+ *  Lock-free skip list node, next pointers have the low bit set
+ *  when the node is logically deleted at that level. refs is
+ *  2 at insertion, one reference is dropped when the inserter
+ *  has finished linking the upper levels and the other when the
+ *  node is deleted, the last one to drop it retires the node
+ */
+typedef struct lf_skip_node {
+	uint64_t key;
+	uint32_t level;
+	uint32_t refs;
+	uintptr_t next[];
+} lf_skip_node_t;
+
+typedef struct {
+	lf_skip_node_t *head;		/* key 0 sentinel */
+	lf_skip_node_t *tail;		/* key UINT64_MAX sentinel */
+	uint32_t max_level;		/* levels used by the list */
+	stress_ebr_t ebr;		/* node reclamation */
+} lf_skip_list_t;
+
+typedef struct {
+	lf_skip_list_t *list;		/* shared list */
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	size_t tid;			/* thread id in the ebr domain */
+	uint64_t range;			/* keys are 1..range */
+	uint64_t seed;			/* per thread random state */
+	uint64_t ops;			/* operations completed */
+	int64_t delta;			/* inserts - deletes */
+	volatile bool *stop;		/* stop flag */
+} ALIGN64 lf_skip_thread_t;
+
+/*
+ *  lf_skip_rand()
+ *	per thread xorshift, the global mwc state would be
+ *	a shared cache line between all the threads
+ */
+static inline uint64_t lf_skip_rand(uint64_t *seed)
+{
+	register uint64_t x = *seed;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*seed = x;
+	return x;
+}
+
+static inline size_t lf_skip_node_size(const uint32_t level)
+{
+	return sizeof(lf_skip_node_t) + (level * sizeof(uintptr_t));
+}
+
+static void lf_skip_node_free(void *ptr)
+{
+	free(ptr);
+}
+
+/*
+ *  lf_skip_find()
+ *	find the predecessors and successors of key at each level,
+ *	physically unlinking any marked nodes on the way
+ */
+static bool lf_skip_find(
+	lf_skip_list_t *list,
+	const uint64_t key,
+	lf_skip_node_t **preds,
+	lf_skip_node_t **succs)
+{
+	lf_skip_node_t *pred, *curr;
+	uintptr_t succ;
+	int lvl;
+
+retry:
+	pred = list->head;
+	for (lvl = (int)list->max_level - 1; lvl >= 0; lvl--) {
+		curr = LF_SKIP_PTR(__atomic_load_n(&pred->next[lvl], __ATOMIC_ACQUIRE));
+		for (;;) {
+			succ = __atomic_load_n(&curr->next[lvl], __ATOMIC_ACQUIRE);
+			while (LF_SKIP_MARKED(succ)) {
+				uintptr_t expected = (uintptr_t)curr;
+
+				if (!__atomic_compare_exchange_n(&pred->next[lvl], &expected,
+						(uintptr_t)LF_SKIP_PTR(succ), false,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+					goto retry;
+				curr = LF_SKIP_PTR(succ);
+				succ = __atomic_load_n(&curr->next[lvl], __ATOMIC_ACQUIRE);
+			}
+			if (curr->key >= key)
+				break;
+			pred = curr;
+			curr = LF_SKIP_PTR(succ);
+		}
+		preds[lvl] = pred;
+		succs[lvl] = curr;
+	}
+	return succs[0]->key == key;
+}
+
+/*
+ *  lf_skip_contains()
+ *	wait-free search, marked nodes are stepped over but
+ *	not unlinked
+ */
+static bool lf_skip_contains(lf_skip_list_t *list, const uint64_t key)
+{
+	lf_skip_node_t *pred = list->head, *curr = NULL;
+	uintptr_t succ;
+	int lvl;
+
+	for (lvl = (int)list->max_level - 1; lvl >= 0; lvl--) {
+		curr = LF_SKIP_PTR(__atomic_load_n(&pred->next[lvl], __ATOMIC_ACQUIRE));
+		for (;;) {
+			succ = __atomic_load_n(&curr->next[lvl], __ATOMIC_ACQUIRE);
+			while (LF_SKIP_MARKED(succ)) {
+				curr = LF_SKIP_PTR(succ);
+				succ = __atomic_load_n(&curr->next[lvl], __ATOMIC_ACQUIRE);
+			}
+			if (curr->key >= key)
+				break;
+			pred = curr;
+			curr = LF_SKIP_PTR(succ);
+		}
+	}
+	return curr && (curr->key == key);
+}
+
+/*
+ *  lf_skip_release()
+ *	drop a node reference, the last reference retires it
+ */
+static inline void lf_skip_release(lf_skip_list_t *list, lf_skip_node_t *node, const size_t tid)
+{
+	if (__atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) == 0)
+		stress_ebr_retire(&list->ebr, tid, node, lf_skip_node_size(node->level));
+}
+
+/*
+ *  lf_skip_insert()
+ *	insert key, returns 1 if inserted, 0 if already present
+ *	and -1 if out of memory
+ */
+static int lf_skip_insert(
+	lf_skip_list_t *list,
+	const uint64_t key,
+	const uint32_t level,
+	const size_t tid)
+{
+	lf_skip_node_t *preds[LF_SKIP_MAX_LEVEL], *succs[LF_SKIP_MAX_LEVEL];
+	lf_skip_node_t *node = NULL;
+	uint32_t i;
+
+	for (;;) {
+		uintptr_t expected;
+
+		if (lf_skip_find(list, key, preds, succs)) {
+			free(node);
+			return 0;
+		}
+		if (!node) {
+			node = (lf_skip_node_t *)malloc(lf_skip_node_size(level));
+			if (!node)
+				return -1;
+			node->key = key;
+			node->level = level;
+			node->refs = 2;
+		}
+		for (i = 0; i < level; i++)
+			node->next[i] = (uintptr_t)succs[i];
+		expected = (uintptr_t)succs[0];
+		if (__atomic_compare_exchange_n(&preds[0]->next[0], &expected,
+				(uintptr_t)node, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			break;
+	}
+
+	/* node is now in the list, link it into the upper levels */
+	for (i = 1; i < level; i++) {
+		for (;;) {
+			uintptr_t next = __atomic_load_n(&node->next[i], __ATOMIC_ACQUIRE);
+			uintptr_t expected;
+
+			if (LF_SKIP_MARKED(next))
+				goto linked;
+			if ((LF_SKIP_PTR(next) != succs[i]) &&
+			    !__atomic_compare_exchange_n(&node->next[i], &next, (uintptr_t)succs[i],
+					false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				goto linked;
+			expected = (uintptr_t)succs[i];
+			if (__atomic_compare_exchange_n(&preds[i]->next[i], &expected,
+					(uintptr_t)node, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				break;
+			(void)lf_skip_find(list, key, preds, succs);
+			if (succs[0] != node)
+				goto linked;
+		}
+	}
+linked:
+	/*
+	 *  a delete may have unlinked the node before the upper
+	 *  levels were linked, so unlink it again to be sure it
+	 *  is unreachable when retired
+	 */
+	if (LF_SKIP_MARKED(__atomic_load_n(&node->next[0], __ATOMIC_SEQ_CST)))
+		(void)lf_skip_find(list, key, preds, succs);
+	lf_skip_release(list, node, tid);
+	return 1;
+}
+
+/*
+ *  lf_skip_delete()
+ *	delete key, returns true if this thread deleted it
+ */
+static bool lf_skip_delete(lf_skip_list_t *list, const uint64_t key, const size_t tid)
+{
+	lf_skip_node_t *preds[LF_SKIP_MAX_LEVEL], *succs[LF_SKIP_MAX_LEVEL];
+	lf_skip_node_t *node;
+	uintptr_t next;
+	int i;
+
+	if (!lf_skip_find(list, key, preds, succs))
+		return false;
+	node = succs[0];
+
+	/* mark the upper levels top down, then level 0 decides who deleted it */
+	for (i = (int)node->level - 1; i >= 1; i--) {
+		next = __atomic_load_n(&node->next[i], __ATOMIC_ACQUIRE);
+		while (!LF_SKIP_MARKED(next)) {
+			(void)__atomic_compare_exchange_n(&node->next[i], &next, next | LF_SKIP_MARK,
+				false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+		}
+	}
+	next = __atomic_load_n(&node->next[0], __ATOMIC_ACQUIRE);
+	for (;;) {
+		if (LF_SKIP_MARKED(next))
+			return false;
+		if (__atomic_compare_exchange_n(&node->next[0], &next, next | LF_SKIP_MARK,
+				false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE))
+			break;
+	}
+	(void)lf_skip_find(list, key, preds, succs);
+	lf_skip_release(list, node, tid);
+	return true;
+}
+
+/*
+ *  lf_skip_random_level()
+ *	geometric level distribution, p = 1/2
+ */
+static inline uint32_t lf_skip_random_level(lf_skip_list_t *list, uint64_t *seed)
+{
+	uint64_t r = lf_skip_rand(seed);
+	uint32_t level = 1;
+
+	while ((r & 1) && (level < list->max_level)) {
+		r >>= 1;
+		level++;
+	}
+	return level;
+}
+
+/*
+ *  lf_skip_thread()
+ *	mixed workload, 80% search, 10% insert, 10% delete
+ */
+static void *lf_skip_thread(void *arg)
+{
+	lf_skip_thread_t *t = (lf_skip_thread_t *)arg;
+	lf_skip_list_t *list = t->list;
+	uint64_t ops = 0;
+	int64_t delta = 0;
+
+	while (!__atomic_load_n(t->stop, __ATOMIC_RELAXED)) {
+		const uint64_t r = lf_skip_rand(&t->seed);
+		const uint64_t key = 1 + ((r >> 8) % t->range);
+		const uint32_t op = (uint32_t)(r & 0xff) % 10;
+
+		stress_ebr_enter(&list->ebr, t->tid);
+		if (op == 0) {
+			const int ret = lf_skip_insert(list, key,
+				lf_skip_random_level(list, &t->seed), t->tid);
+
+			if (ret > 0)
+				delta++;
+		} else if (op == 1) {
+			if (lf_skip_delete(list, key, t->tid))
+				delta--;
+		} else {
+			(void)lf_skip_contains(list, key);
+		}
+		stress_ebr_exit(&list->ebr, t->tid);
+		ops++;
+	}
+	t->ops = ops;
+	t->delta = delta;
+	return NULL;
+}
+
+/*
+ *  lf_skip_check()
+ *	with all threads stopped check level 0 is strictly
+ *	ordered, count the nodes and the bytes they use
+ */
+static bool lf_skip_check(lf_skip_list_t *list, size_t *count, size_t *bytes)
+{
+	lf_skip_node_t *node = LF_SKIP_PTR(list->head->next[0]);
+	uint64_t prev = 0;
+	bool ok = true;
+
+	*count = 0;
+	*bytes = 0;
+	while (node != list->tail) {
+		if ((node->key <= prev) || LF_SKIP_MARKED(node->next[0]))
+			ok = false;
+		prev = node->key;
+		(*count)++;
+		*bytes += lf_skip_node_size(node->level);
+		node = LF_SKIP_PTR(node->next[0]);
+	}
+	return ok;
+}
+
+/*
+ *  lf_skip_destroy()
+ *	free all the nodes, all threads must have stopped
+ */
+static void lf_skip_destroy(lf_skip_list_t *list)
+{
+	lf_skip_node_t *node = list->head;
+
+	while (node) {
+		lf_skip_node_t *next = (node == list->tail) ? NULL : LF_SKIP_PTR(node->next[0]);
+
+		free(node);
+		node = next;
+	}
+	stress_ebr_destroy(&list->ebr);
+}
+
+/*
+ *  stress_skiplist_concurrent()
+ *	N threads insert, search and delete on one shared lock-free
+ *	skip list with epoch based reclamation of deleted nodes,
+ *	stepping the thread count 1, 2, 4 .. N to show the scaling
+ */
+static int stress_skiplist_concurrent(
+	const stress_args_t *args,
+	const uint64_t n,
+	const uint32_t max_threads)
+{
+	lf_skip_list_t list;
+	lf_skip_thread_t *threads;
+	stress_ebr_stats_t stats[SKIPLIST_MAX_COUNTS];
+	const size_t threads_size = sizeof(*threads) * max_threads;
+	const uint64_t range = n * 2;
+	uint32_t counts[SKIPLIST_MAX_COUNTS], n_counts = 0, c, i;
+	size_t count;
+	uint64_t seed = stress_mwc64() | 1;
+	int64_t expected;
+	volatile bool stop = false;
+	int rc = EXIT_SUCCESS;
+	char desc[80];
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(&list, 0, sizeof(list));
+	list.max_level = (uint32_t)skip_list_ln2((unsigned long)range);
+	if (list.max_level > LF_SKIP_MAX_LEVEL)
+		list.max_level = LF_SKIP_MAX_LEVEL;
+
+	if (stress_ebr_init(&list.ebr, max_threads, lf_skip_node_free) < 0) {
+		pr_inf_skip("%s: cannot initialize epoch reclamation, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	list.head = (lf_skip_node_t *)calloc(1, lf_skip_node_size(LF_SKIP_MAX_LEVEL));
+	list.tail = (lf_skip_node_t *)calloc(1, lf_skip_node_size(LF_SKIP_MAX_LEVEL));
+	threads = (lf_skip_thread_t *)mmap(NULL, threads_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (!list.head || !list.tail || (threads == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate skip list, skipping stressor\n", args->name);
+		free(list.head);
+		free(list.tail);
+		list.head = NULL;
+		if (threads != MAP_FAILED)
+			(void)munmap((void *)threads, threads_size);
+		stress_ebr_destroy(&list.ebr);
+		return EXIT_NO_RESOURCE;
+	}
+	list.tail->key = UINT64_MAX;
+	list.tail->level = LF_SKIP_MAX_LEVEL;
+	list.head->level = LF_SKIP_MAX_LEVEL;
+	for (i = 0; i < LF_SKIP_MAX_LEVEL; i++)
+		list.head->next[i] = (uintptr_t)list.tail;
+
+	/* half fill the key range */
+	expected = 0;
+	for (count = 0; count < n; count++) {
+		const uint64_t key = 1 + (lf_skip_rand(&seed) % range);
+		int ret;
+
+		stress_ebr_enter(&list.ebr, 0);
+		ret = lf_skip_insert(&list, key, lf_skip_random_level(&list, &seed), 0);
+		stress_ebr_exit(&list.ebr, 0);
+		if (ret < 0) {
+			pr_inf_skip("%s: out of memory filling the skip list, skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+		expected += ret;
+	}
+
+	for (c = 1; (c < max_threads) && (n_counts < SKIPLIST_MAX_COUNTS - 1); c *= 2)
+		counts[n_counts++] = c;
+	counts[n_counts++] = max_threads;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (c = 0; (c < n_counts) && keep_stressing(args); c++) {
+			stress_ebr_stats_t *st = &stats[c];
+			double t_start;
+			size_t k, bytes;
+			uint64_t ops = 0;
+
+			stop = false;
+			for (i = 0; i < counts[c]; i++) {
+				lf_skip_thread_t *t = &threads[i];
+
+				t->list = &list;
+				t->tid = i;
+				t->range = range;
+				t->seed = stress_mwc64() | 1;
+				t->ops = 0;
+				t->delta = 0;
+				t->stop = &stop;
+				t->ret = pthread_create(&t->pthread, NULL, lf_skip_thread, (void *)t);
+			}
+			t_start = stress_time_now();
+			for (k = 0; k < SKIPLIST_SAMPLES; k++) {
+				size_t pending;
+
+				(void)shim_usleep((uint64_t)(SKIPLIST_STEP * 1000000.0 / SKIPLIST_SAMPLES));
+				pending = stress_ebr_pending(&list.ebr);
+				if (pending > st->retired_peak)
+					st->retired_peak = pending;
+				if (!keep_stressing_flag())
+					break;
+			}
+			stop = true;
+			for (i = 0; i < counts[c]; i++) {
+				lf_skip_thread_t *t = &threads[i];
+
+				if (t->ret)
+					continue;
+				(void)pthread_join(t->pthread, NULL);
+				ops += t->ops;
+				expected += t->delta;
+			}
+			st->duration += stress_time_now() - t_start;
+			stress_ebr_drain(&list.ebr);
+			st->threads = counts[c];
+			st->ops += ops;
+
+			if (!lf_skip_check(&list, &count, &bytes) || ((int64_t)count != expected)) {
+				pr_fail("%s: shared skip list corrupt, %zu nodes, expected %" PRId64 "\n",
+					args->name, count, expected);
+				rc = EXIT_FAILURE;
+			}
+			st->live = bytes;
+			add_counter(args, ops);
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	(void)snprintf(desc, sizeof(desc), "shared lock-free skip list, %" PRIu64 " keys, 80%% search, "
+		"10%% insert, 10%% delete", range);
+	(void)stress_ebr_stats_report(args, desc, stats, n_counts, 0);
+
+tidy:
+	(void)munmap((void *)threads, threads_size);
+	lf_skip_destroy(&list);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_skiplist()
  *	stress skiplist
@@ -208,6 +739,10 @@ static int stress_skiplist(const stress_args_t *args)
 {
 	unsigned long n, i, ln2n;
 	uint64_t skiplist_size = 1024;
+	stress_arena_t arena;
+	stress_arena_t *node_arena = stress_node_arena() ? &arena : NULL;
+	uint32_t skiplist_threads = 0;
+	int rc = EXIT_SUCCESS;
 
 	if (!stress_get_setting("skiplist-size", &skiplist_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -215,18 +750,31 @@ static int stress_skiplist(const stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			skiplist_size = MIN_SKIPLIST_SIZE;
 	}
+	(void)stress_get_setting("skiplist-threads", &skiplist_threads);
+	if (skiplist_threads) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC)
+		return stress_skiplist_concurrent(args, skiplist_size, skiplist_threads);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --skiplist-threads requires pthread and atomic "
+				"support, using private skip lists\n", args->name);
+#endif
+	}
 	n = (unsigned long)skiplist_size;
 	ln2n = skip_list_ln2(n);
+	stress_arena_init(&arena, 0);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
 		skip_list_t list;
 
-		if (!skip_list_init(&list, ln2n)) {
+		if (!skip_list_init(&list, ln2n, node_arena)) {
 			pr_inf("%s: out of memory initializing the skip list\n",
 				args->name);
-			return EXIT_NO_RESOURCE;
+			rc = EXIT_NO_RESOURCE;
+			break;
 		}
 
 		for (i = 0; i < n; i++) {
@@ -236,7 +784,8 @@ static int stress_skiplist(const stress_args_t *args)
 				pr_inf("%s: out of memory initializing the skip list\n",
 					args->name);
 				skip_list_free(&list);
-				return EXIT_NO_RESOURCE;
+				rc = EXIT_NO_RESOURCE;
+				goto done;
 			}
 		}
 
@@ -251,14 +800,16 @@ static int stress_skiplist(const stress_args_t *args)
 
 		inc_counter(args);
 	} while (keep_stressing(args));
-
+done:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_arena_destroy(&arena);
 
-	return EXIT_SUCCESS;
+	return rc;
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_skiplist_size,	stress_set_skiplist_size },
+	{ OPT_skiplist_threads,	stress_set_skiplist_threads },
 	{ 0,			NULL },
 };
 
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 #include "core-net.h"
 
 #if defined(HAVE_LINUX_SOCKIOS_H)
@@ -50,6 +51,14 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_ERRQUEUE_H)
+#include <linux/errqueue.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -75,6 +84,26 @@ UNEXPECTED
 
 #define MSGVEC_SIZE		(4)
 
+#define MIN_SOCK_RR_SIZE	(1)
+#define MAX_SOCK_RR_SIZE	(MMAP_BUF_SIZE)
+#define DEFAULT_SOCK_RR_SIZE	(1)
+
+#if defined(MSG_ZEROCOPY) &&		\
+    defined(SO_ZEROCOPY) &&		\
+    defined(MSG_ERRQUEUE) &&		\
+    defined(SO_EE_ORIGIN_ZEROCOPY) &&	\
+    defined(IP_RECVERR) &&		\
+    defined(IPV6_RECVERR) &&		\
+    defined(HAVE_POLL_H)
+#define SOCK_HAVE_ZEROCOPY
+#endif
+
+#define SOCK_ZC_BURST		(64)	/* sends per --sock-zerocopy burst */
+#define SOCK_ZC_PATH_COPY	(0)
+#define SOCK_ZC_PATH_ZEROCOPY	(1)
+#define SOCK_ZC_PATHS		(2)
+#define SOCK_ZC_SIZES		(SIZEOF_ARRAY(sock_zc_sizes))
+
 #define PROC_CONG_CTRLS		"/proc/sys/net/ipv4/tcp_allowed_congestion_control"
 
 typedef struct {
@@ -82,6 +111,24 @@ typedef struct {
 	const int   optval;
 } stress_socket_options_t;
 
+#if defined(SOCK_HAVE_ZEROCOPY)
+/* --sock-zerocopy send sizes, zerocopy only pays off for larger sends */
+static const size_t sock_zc_sizes[] = {
+	1 * KB, 4 * KB, 16 * KB, 64 * KB
+};
+
+/* --sock-zerocopy copy vs zerocopy accounting per send size */
+typedef struct {
+	uint64_t bursts;			/* bursts sent */
+	uint64_t bytes[SOCK_ZC_PATHS][SOCK_ZC_SIZES];	/* bytes sent */
+	double duration[SOCK_ZC_PATHS][SOCK_ZC_SIZES];	/* time sending */
+	uint64_t sends[SOCK_ZC_SIZES];		/* MSG_ZEROCOPY sends */
+	uint64_t done[SOCK_ZC_SIZES];		/* completions reaped */
+	uint64_t copied[SOCK_ZC_SIZES];		/* completions copied after all */
+	uint64_t outstanding_max;		/* max sends awaiting completion */
+} stress_sock_zc_t;
+#endif
+
 static const stress_help_t help[] = {
 	{ "S N", "sock N",		"start N workers exercising socket I/O" },
 	{ NULL,	"sock-domain D",	"specify socket domain, default is ipv4" },
@@ -89,8 +136,12 @@ static const stress_help_t help[] = {
 	{ NULL,	"sock-nodelay",		"disable Nagle algorithm, send data immediately" },
 	{ NULL,	"sock-ops N",		"stop after N socket bogo operations" },
 	{ NULL,	"sock-opts option", 	"socket options [send|sendmsg|sendmmsg]" },
+	{ NULL,	"sock-placement P",	"pin client and server CPUs [same-cpu|smt|llc|socket|cross-socket|irq]" },
 	{ NULL,	"sock-port P",		"use socket ports P to P + number of workers - 1" },
 	{ NULL, "sock-protocol",	"use socket protocol P, default is tcp, can be mptcp" },
+	{ NULL,	"sock-rr",		"request/response round trip latency mode" },
+	{ NULL,	"sock-rr-req N",	"request size in bytes for --sock-rr mode" },
+	{ NULL,	"sock-rr-resp N",	"response size in bytes for --sock-rr mode" },
 	{ NULL,	"sock-type T",		"socket type (stream, seqpacket)" },
 	{ NULL, "sock-zerocopy",	"enable zero copy sends" },
 	{ NULL,	NULL,			NULL }
@@ -201,6 +252,20 @@ static int stress_set_socket_protocol(const char *opt)
 }
 
 
+/*
+ *  stress_set_sock_placement()
+ *	set the client/server CPU placement
+ */
+static int stress_set_sock_placement(const char *name)
+{
+	int ret, sock_placement;
+
+	ret = stress_set_net_placement("sock-placement", name, &sock_placement);
+	stress_set_setting("sock-placement", TYPE_ID_INT, &sock_placement);
+
+	return ret;
+}
+
 /*
  *  stress_set_socket_domain()
  *	set the socket domain option
@@ -231,6 +296,43 @@ static int stress_set_socket_zerocopy(const char *opt)
 #endif
 }
 
+/*
+ *  stress_set_socket_rr()
+ *	set the socket request/response mode option
+ */
+static int stress_set_socket_rr(const char *opt)
+{
+	return stress_set_setting_true("sock-rr", opt);
+}
+
+/*
+ *  stress_set_socket_rr_req()
+ *	set the --sock-rr request size
+ */
+static int stress_set_socket_rr_req(const char *opt)
+{
+	size_t sock_rr_req;
+
+	sock_rr_req = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("sock-rr-req", sock_rr_req,
+		MIN_SOCK_RR_SIZE, MAX_SOCK_RR_SIZE);
+	return stress_set_setting("sock-rr-req", TYPE_ID_SIZE_T, &sock_rr_req);
+}
+
+/*
+ *  stress_set_socket_rr_resp()
+ *	set the --sock-rr response size
+ */
+static int stress_set_socket_rr_resp(const char *opt)
+{
+	size_t sock_rr_resp;
+
+	sock_rr_resp = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("sock-rr-resp", sock_rr_resp,
+		MIN_SOCK_RR_SIZE, MAX_SOCK_RR_SIZE);
+	return stress_set_setting("sock-rr-resp", TYPE_ID_SIZE_T, &sock_rr_resp);
+}
+
 /*
  *  stress_free_congestion_controls()
  *	free congestion controls array
@@ -867,6 +969,174 @@ static bool stress_send_error(const int err)
 		(err != ECONNRESET));
 }
 
+#if defined(SOCK_HAVE_ZEROCOPY)
+/*
+ *  stress_sock_zc_reap()
+ *	drain the MSG_ZEROCOPY completion notifications from the
+ *	socket error queue, returns the number of sends completed
+ */
+static uint64_t stress_sock_zc_reap(
+	const int fd,
+	stress_sock_zc_t *zc,
+	const size_t idx)
+{
+	uint64_t completed = 0;
+
+	for (;;) {
+		char ALIGN64 control[128];
+		struct msghdr msg;
+		struct cmsghdr *cmsg;
+
+		(void)memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			struct sock_extended_err serr;
+			uint64_t n;
+
+			if (!(((cmsg->cmsg_level == IPPROTO_IP) && (cmsg->cmsg_type == IP_RECVERR)) ||
+			      ((cmsg->cmsg_level == IPPROTO_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR))))
+				continue;
+			(void)memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+			if ((serr.ee_errno != 0) || (serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY))
+				continue;
+			/* one notification covers the range of send ids ee_info..ee_data */
+			n = (uint64_t)(serr.ee_data - serr.ee_info) + 1;
+			completed += n;
+			zc->done[idx] += n;
+			if (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				zc->copied[idx] += n;
+		}
+	}
+	return completed;
+}
+
+/*
+ *  stress_sock_zc_wait()
+ *	wait up to timeout_ms for completion notifications
+ */
+static uint64_t stress_sock_zc_wait(
+	const int fd,
+	stress_sock_zc_t *zc,
+	const size_t idx,
+	const int timeout_ms)
+{
+	struct pollfd pfd;
+
+	/* POLLERR is always reported, it means the error queue is not empty */
+	pfd.fd = fd;
+	pfd.events = 0;
+	pfd.revents = 0;
+	(void)poll(&pfd, 1, timeout_ms);
+
+	return stress_sock_zc_reap(fd, zc, idx);
+}
+
+/*
+ *  stress_sock_zc_burst()
+ *	send a burst of one of the sizes either by copying or with
+ *	MSG_ZEROCOPY, alternating path and size per connection. The
+ *	zerocopy burst is timed until its last completion arrives as
+ *	the buffers cannot be reused before then.
+ */
+static void stress_sock_zc_burst(
+	const stress_args_t *args,
+	const int sfd,
+	char *buf,
+	stress_sock_zc_t *zc,
+	uint64_t *msgs)
+{
+	const size_t idx = (size_t)(zc->bursts % SOCK_ZC_SIZES);
+	const int path = (int)((zc->bursts / SOCK_ZC_SIZES) % SOCK_ZC_PATHS);
+	const size_t size = sock_zc_sizes[idx];
+	const int flags = (path == SOCK_ZC_PATH_ZEROCOPY) ? MSG_ZEROCOPY : 0;
+	uint64_t outstanding = 0, bytes = 0, completed;
+	double t, t_end;
+	int i, retries = 0;
+
+	zc->bursts++;
+	t = stress_time_now();
+	for (i = 0; (i < SOCK_ZC_BURST) && keep_stressing_flag(); i++) {
+		const ssize_t ret = send(sfd, buf, size, flags);
+
+		if (ret < 0) {
+			/* out of optmem for notifications, wait for some completions */
+			if ((errno == ENOBUFS) && flags && (retries++ < 100)) {
+				completed = stress_sock_zc_wait(sfd, zc, idx, 10);
+				outstanding -= STRESS_MINIMUM(outstanding, completed);
+				i--;
+				continue;
+			}
+			if (stress_send_error(errno))
+				pr_fail("%s: send failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			break;
+		}
+		bytes += (uint64_t)ret;
+		(*msgs)++;
+		if (flags) {
+			zc->sends[idx]++;
+			outstanding++;
+			if (zc->outstanding_max < outstanding)
+				zc->outstanding_max = outstanding;
+			completed = stress_sock_zc_reap(sfd, zc, idx);
+			outstanding -= STRESS_MINIMUM(outstanding, completed);
+		}
+	}
+	t_end = t + 1.0;
+	while (outstanding && keep_stressing_flag() && (stress_time_now() < t_end)) {
+		completed = stress_sock_zc_wait(sfd, zc, idx, 10);
+		outstanding -= STRESS_MINIMUM(outstanding, completed);
+	}
+
+	zc->bytes[path][idx] += bytes;
+	zc->duration[path][idx] += stress_time_now() - t;
+}
+
+/*
+ *  stress_sock_zc_report()
+ *	report copy and zerocopy throughput and the zerocopy hit
+ *	ratio, the share of sends not copied after all, per size
+ */
+static void stress_sock_zc_report(const stress_args_t *args, const stress_sock_zc_t *zc)
+{
+	size_t i;
+
+	if (!zc->bursts)
+		return;
+	if (args->instance == 0)
+		pr_inf("%s: msg size  copy MB/s  zerocopy MB/s  zerocopy hit %%\n",
+			args->name);
+	for (i = 0; i < SOCK_ZC_SIZES; i++) {
+		const double copy_rate = (zc->duration[SOCK_ZC_PATH_COPY][i] > 0.0) ?
+			(double)zc->bytes[SOCK_ZC_PATH_COPY][i] /
+			zc->duration[SOCK_ZC_PATH_COPY][i] / (double)MB : 0.0;
+		const double zc_rate = (zc->duration[SOCK_ZC_PATH_ZEROCOPY][i] > 0.0) ?
+			(double)zc->bytes[SOCK_ZC_PATH_ZEROCOPY][i] /
+			zc->duration[SOCK_ZC_PATH_ZEROCOPY][i] / (double)MB : 0.0;
+		const double hit = zc->done[i] ?
+			100.0 * (double)(zc->done[i] - zc->copied[i]) / (double)zc->done[i] : 0.0;
+		char desc[48];
+
+		if (args->instance == 0)
+			pr_inf("%s: %7zuK %10.1f %14.1f %15.1f\n", args->name,
+				sock_zc_sizes[i] / (size_t)KB, copy_rate, zc_rate, hit);
+		(void)snprintf(desc, sizeof(desc), "%zuK zerocopy/copy MB/s ratio",
+			sock_zc_sizes[i] / (size_t)KB);
+		stress_misc_stats_set(args->misc_stats, i * 2, desc,
+			copy_rate > 0.0 ? zc_rate / copy_rate : 0.0);
+		(void)snprintf(desc, sizeof(desc), "%zuK zerocopy hit %%",
+			sock_zc_sizes[i] / (size_t)KB);
+		stress_misc_stats_set(args->misc_stats, (i * 2) + 1, desc, hit);
+	}
+	stress_misc_stats_set(args->misc_stats, SOCK_ZC_SIZES * 2,
+		"zerocopy max sends outstanding", (double)zc->outstanding_max);
+}
+#endif
+
 /*
  *  stress_sock_server()
  *	server writer
@@ -895,8 +1165,13 @@ static int stress_sock_server(
 	void *ptr = MAP_FAILED;
 	const pid_t self = getpid();
 	int sendflag = 0;
+	double t_start, duration;
+#if defined(SOCK_HAVE_ZEROCOPY)
+	bool zerocopy = socket_zerocopy;
+	stress_sock_zc_t zc;
 
-#if defined(MSG_ZEROCOPY)
+	(void)memset(&zc, 0, sizeof(zc));
+#elif defined(MSG_ZEROCOPY)
 	if (socket_zerocopy)
 		sendflag |= MSG_ZEROCOPY;
 #else
@@ -957,6 +1232,7 @@ static int stress_sock_server(
 	 */
 	ptr = mmap(NULL, page_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
+	t_start = stress_time_now();
 	do {
 		int sfd;
 
@@ -1046,6 +1322,22 @@ static int stress_sock_server(
 #endif
 			(void)memset(buf, 'A' + (get_counter(args) % 26), MMAP_IO_SIZE);
 
+#if defined(SOCK_HAVE_ZEROCOPY)
+			if (zerocopy) {
+				int one = 1;
+
+				if (setsockopt(sfd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+					if (args->instance == 0)
+						pr_inf("%s: cannot enable SO_ZEROCOPY, errno=%d (%s), "
+							"using copying sends\n",
+							args->name, errno, strerror(errno));
+					zerocopy = false;
+				} else {
+					stress_sock_zc_burst(args, sfd, buf, &zc, &msgs);
+					goto sent;
+				}
+			}
+#endif
 			if (socket_opts == SOCKET_OPT_RANDOM)
 				opt = stress_mwc8() % 3;
 			else
@@ -1104,6 +1396,9 @@ static int stress_sock_server(
 				(void)close(sfd);
 				goto die_close;
 			}
+#if defined(SOCK_HAVE_ZEROCOPY)
+sent:
+#endif
 			if (getpeername(sfd, &saddr, &len) < 0) {
 				if (errno != ENOTCONN)
 					pr_fail("%s: getpeername failed, errno=%d (%s)\n",
@@ -1133,6 +1428,11 @@ static int stress_sock_server(
 		inc_counter(args);
 	} while (keep_stressing(args));
 
+	/* after the --sock-zerocopy stats so the two never collide */
+	duration = stress_time_now() - t_start;
+	if (duration > 0.0)
+		stress_misc_stats_set(args->misc_stats, 9, "messages sent per sec",
+			(double)msgs / duration);
 die_close:
 	(void)close(fd);
 die:
@@ -1151,6 +1451,259 @@ die:
 		(void)shim_waitpid(pid, &status, 0);
 	}
 	pr_dbg("%s: %" PRIu64 " messages sent\n", args->name, msgs);
+#if defined(SOCK_HAVE_ZEROCOPY)
+	stress_sock_zc_report(args, &zc);
+#endif
+
+	return rc;
+}
+
+/*
+ *  stress_sock_rr_xfer()
+ *	send or receive exactly len bytes, returns len on success,
+ *	0 if the peer closed the connection or -1 on error
+ */
+static ssize_t stress_sock_rr_xfer(
+	const int fd,
+	char *buf,
+	const size_t len,
+	const bool do_send)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		const ssize_t n = do_send ?
+			send(fd, buf + done, len - done, 0) :
+			recv(fd, buf + done, len - done, 0);
+
+		if (n == 0)
+			return 0;
+		if (n < 0) {
+			if ((errno == EINTR) && keep_stressing_flag())
+				continue;
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	return (ssize_t)len;
+}
+
+/*
+ *  stress_sock_rr_nodelay()
+ *	disable Nagle for the request/response mode, small requests
+ *	must not sit waiting for the previous response's ACK
+ */
+static void stress_sock_rr_nodelay(const int fd, const int socket_domain)
+{
+#if defined(SOL_TCP) &&	\
+    defined(TCP_NODELAY)
+	if ((socket_domain == AF_INET) || (socket_domain == AF_INET6)) {
+		int one = 1;
+
+		VOID_RET(int, setsockopt(fd, SOL_TCP, TCP_NODELAY, &one, sizeof(one)));
+	}
+#else
+	(void)fd;
+	(void)socket_domain;
+#endif
+}
+
+/*
+ *  stress_sock_rr_client()
+ *	request/response mode responder, reply to each request
+ *	of sock_rr_req bytes with sock_rr_resp bytes
+ */
+static int stress_sock_rr_client(
+	const stress_args_t *args,
+	char *buf,
+	const pid_t mypid,
+	const int socket_domain,
+	const int socket_type,
+	const int socket_protocol,
+	const int socket_port,
+	const char *socket_if,
+	const size_t sock_rr_req,
+	const size_t sock_rr_resp)
+{
+	struct sockaddr *addr;
+	socklen_t addr_len = 0;
+	int fd, retries = 0;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			socket_domain, socket_port, socket_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0) {
+		return EXIT_FAILURE;
+	}
+retry:
+	if (!keep_stressing_flag())
+		return EXIT_SUCCESS;
+	fd = socket(socket_domain, socket_type, socket_protocol);
+	if (fd < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (connect(fd, addr, addr_len) < 0) {
+		int errno_tmp = errno;
+
+		(void)close(fd);
+		(void)shim_usleep(10000);
+		retries++;
+		if (retries > 100) {
+			/* Give up.. */
+			pr_fail("%s: connect failed, errno=%d (%s)\n",
+				args->name, errno_tmp, strerror(errno_tmp));
+			return EXIT_FAILURE;
+		}
+		goto retry;
+	}
+	stress_sock_rr_nodelay(fd, socket_domain);
+	(void)memset(buf, 'R', sock_rr_resp);
+
+	while (keep_stressing_flag()) {
+		if (stress_sock_rr_xfer(fd, buf, sock_rr_req, false) <= 0)
+			break;
+		if (stress_sock_rr_xfer(fd, buf, sock_rr_resp, true) <= 0)
+			break;
+	}
+	(void)shutdown(fd, SHUT_RDWR);
+	(void)close(fd);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_sock_rr_server()
+ *	request/response mode initiator, send a request of sock_rr_req
+ *	bytes and wait for the sock_rr_resp byte response, each round
+ *	trip is one bogo-op and is timed into a latency histogram
+ */
+static int stress_sock_rr_server(
+	const stress_args_t *args,
+	char *buf,
+	const pid_t pid,
+	const pid_t ppid,
+	const int socket_domain,
+	const int socket_type,
+	const int socket_protocol,
+	const int socket_port,
+	const char *socket_if,
+	const size_t sock_rr_req,
+	const size_t sock_rr_resp)
+{
+	int fd, sfd = -1, status;
+	int so_reuseaddr = 1;
+	socklen_t addr_len = 0;
+	struct sockaddr *addr = NULL;
+	stress_latency_t *lat, local_lat;
+	uint64_t t_start = 0;
+	double duration;
+	int rc = EXIT_SUCCESS;
+
+	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0) {
+		rc = EXIT_FAILURE;
+		goto die;
+	}
+	if ((fd = socket(socket_domain, socket_type, socket_protocol)) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die;
+	}
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+		&so_reuseaddr, sizeof(so_reuseaddr)) < 0) {
+		pr_fail("%s: setsockopt failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto die_close;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, ppid,
+			socket_domain, socket_port, socket_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0) {
+		goto die_close;
+	}
+	if (bind(fd, addr, addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed on port %d, errno=%d (%s)\n",
+			args->name, socket_port, errno, strerror(errno));
+		goto die_close;
+	}
+	if (listen(fd, 10) < 0) {
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto die_close;
+	}
+	sfd = accept(fd, (struct sockaddr *)NULL, NULL);
+	if (sfd < 0) {
+		if (keep_stressing(args)) {
+			pr_fail("%s: accept failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+		}
+		goto die_close;
+	}
+	stress_sock_rr_nodelay(sfd, socket_domain);
+	(void)memset(buf, 'Q', sock_rr_req);
+
+	/* round trip latencies go into the --latency histogram if enabled */
+	if (args->latency) {
+		lat = args->latency;
+	} else {
+		stress_latency_reset(&local_lat);
+		lat = &local_lat;
+	}
+
+	t_start = stress_latency_now();
+	do {
+		const uint64_t t = stress_latency_now();
+
+		if (stress_sock_rr_xfer(sfd, buf, sock_rr_req, true) <= 0)
+			break;
+		if (stress_sock_rr_xfer(sfd, buf, sock_rr_resp, false) <= 0)
+			break;
+		stress_latency_record(lat, stress_latency_now() - t);
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	duration = (double)(stress_latency_now() - t_start) / (double)STRESS_NANOSECOND;
+	if ((duration > 0.0) && lat->count) {
+		static const double percentiles[] = { 50.0, 99.0, 99.9 };
+		size_t i;
+
+		stress_misc_stats_set(args->misc_stats, 0, "transactions per sec",
+			(double)lat->count / duration);
+		for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+			char desc[40];
+
+			(void)snprintf(desc, sizeof(desc), "round trip p%g (usec)",
+				percentiles[i]);
+			stress_misc_stats_set(args->misc_stats, 1 + i, desc,
+				(double)stress_latency_percentile(lat, percentiles[i]) / 1000.0);
+		}
+		stress_misc_stats_set(args->misc_stats, 4, "round trip max (usec)",
+			(double)lat->max / 1000.0);
+	}
+	(void)shutdown(sfd, SHUT_RDWR);
+	(void)close(sfd);
+die_close:
+	(void)close(fd);
+die:
+#if defined(AF_UNIX) &&		\
+    defined(HAVE_SOCKADDR_UN)
+	if (addr && (socket_domain == AF_UNIX)) {
+		struct sockaddr_un *addr_un = (struct sockaddr_un *)addr;
+
+		(void)shim_unlink(addr_un->sun_path);
+	}
+#endif
+	if (pid) {
+		(void)kill(pid, SIGKILL);
+		(void)shim_waitpid(pid, &status, 0);
+	}
 
 	return rc;
 }
@@ -1202,19 +1755,34 @@ static int stress_sock(const stress_args_t *args)
 #else
 	int socket_protocol = 0;
 #endif
-	int socket_zerocopy = false;
+	bool socket_zerocopy = false;
+	bool sock_rr = false;
+	size_t sock_rr_req = DEFAULT_SOCK_RR_SIZE;
+	size_t sock_rr_resp = DEFAULT_SOCK_RR_SIZE;
 	int rc = EXIT_SUCCESS;
 	const bool rt = stress_sock_kernel_rt();
 	char *mmap_buffer;
 	char *socket_if = NULL;
+	int sock_placement = NET_PLACEMENT_NONE;
+	int server_cpu, client_cpu;
 
 	(void)stress_get_setting("sock-if", &socket_if);
+	(void)stress_get_setting("sock-placement", &sock_placement);
 	(void)stress_get_setting("sock-domain", &socket_domain);
 	(void)stress_get_setting("sock-type", &socket_type);
 	(void)stress_get_setting("sock-protocol", &socket_protocol);
 	(void)stress_get_setting("sock-port", &socket_port);
 	(void)stress_get_setting("sock-opts", &socket_opts);
 	(void)stress_get_setting("sock-zerocopy", &socket_zerocopy);
+	(void)stress_get_setting("sock-rr", &sock_rr);
+	(void)stress_get_setting("sock-rr-req", &sock_rr_req);
+	(void)stress_get_setting("sock-rr-resp", &sock_rr_resp);
+
+#if defined(AF_UNIX)
+	/* tcp and mptcp protocols are not applicable to unix sockets */
+	if (socket_domain == AF_UNIX)
+		socket_protocol = 0;
+#endif
 
 	if (socket_if) {
 		int ret;
@@ -1227,6 +1795,9 @@ static int stress_sock(const stress_args_t *args)
 			socket_if = NULL;
 		}
 	}
+	if (stress_net_placement_cpus(args, sock_placement, socket_if,
+				      &server_cpu, &client_cpu) < 0)
+		return EXIT_NO_RESOURCE;
 	socket_port += args->instance;
 
 	pr_dbg("%s: process [%d] using socket port %d\n",
@@ -1257,14 +1828,29 @@ again:
 			args->name, errno, strerror(errno));
 		return EXIT_FAILURE;
 	} else if (pid == 0) {
-		rc = stress_sock_client(args, mmap_buffer, mypid, socket_opts,
-			socket_domain, socket_type, socket_protocol,
-			socket_port, socket_if, rt, socket_zerocopy);
+		stress_net_placement_pin(client_cpu);
+		if (sock_rr) {
+			rc = stress_sock_rr_client(args, mmap_buffer, mypid,
+				socket_domain, socket_type, socket_protocol,
+				socket_port, socket_if, sock_rr_req, sock_rr_resp);
+		} else {
+			rc = stress_sock_client(args, mmap_buffer, mypid, socket_opts,
+				socket_domain, socket_type, socket_protocol,
+				socket_port, socket_if, rt, socket_zerocopy);
+		}
 		(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
 
 		/* Inform parent we're all done */
 		(void)kill(getppid(), SIGALRM);
 		_exit(rc);
+	}
+
+	stress_net_placement_pin(server_cpu);
+	if (sock_rr) {
+		rc = stress_sock_rr_server(args, mmap_buffer, pid, mypid,
+			socket_domain, socket_type, socket_protocol,
+			socket_port, socket_if, sock_rr_req, sock_rr_resp);
+		(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
 	} else {
 		rc = stress_sock_server(args, mmap_buffer, pid, mypid, socket_opts,
 			socket_domain, socket_type, socket_protocol,
@@ -1282,9 +1868,13 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_sock_domain,	stress_set_socket_domain },
 	{ OPT_sock_if,		stress_set_sock_if },
 	{ OPT_sock_opts,	stress_set_socket_opts },
+	{ OPT_sock_placement,	stress_set_sock_placement },
 	{ OPT_sock_type,	stress_set_socket_type },
 	{ OPT_sock_port,	stress_set_socket_port },
 	{ OPT_sock_protocol,	stress_set_socket_protocol },
+	{ OPT_sock_rr,		stress_set_socket_rr },
+	{ OPT_sock_rr_req,	stress_set_socket_rr_req },
+	{ OPT_sock_rr_resp,	stress_set_socket_rr_resp },
 	{ OPT_sock_zerocopy,	stress_set_socket_zerocopy },
 	{ 0,			NULL }
 };
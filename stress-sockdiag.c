@@ -43,12 +43,54 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_INET_DIAG_H)
+#include <linux/inet_diag.h>
+#endif
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MIN_SOCKDIAG_SOCKETS		(2)
+#define MAX_SOCKDIAG_SOCKETS		(1000000)
+#define DEFAULT_SOCKDIAG_SOCKETS	(10000)
+
+#define SOCKDIAG_BENCH_BATCH		(256)	/* connects per accept drain */
+#define SOCKDIAG_BENCH_PER_ADDR		(16384)	/* connections per 127.x.y.z */
+#define SOCKDIAG_BENCH_BUF		(64 * KB)
+
+/* kernel TCP states, as used by the inet_diag state mask */
+#define SOCKDIAG_TCP_ESTABLISHED	(1)
+#define SOCKDIAG_TCP_LISTEN		(10)
+
 static const stress_help_t help[] = {
 	{ NULL,	"sockdiag N",	  "start N workers exercising sockdiag netlink" },
+	{ NULL,	"sockdiag-bench", "time inet_diag TCP dumps over many open sockets" },
 	{ NULL,	"sockdiag-ops N", "stop sockdiag workers after N bogo messages" },
+	{ NULL,	"sockdiag-sockets N", "number of TCP sockets to open in --sockdiag-bench" },
 	{ NULL,	NULL,		  NULL }
 };
 
+static int stress_set_sockdiag_bench(const char *opt)
+{
+	return stress_set_setting_true("sockdiag-bench", opt);
+}
+
+static int stress_set_sockdiag_sockets(const char *opt)
+{
+	uint32_t sockdiag_sockets;
+
+	sockdiag_sockets = stress_get_uint32(opt);
+	stress_check_range("sockdiag-sockets", (uint64_t)sockdiag_sockets,
+		MIN_SOCKDIAG_SOCKETS, MAX_SOCKDIAG_SOCKETS);
+	return stress_set_setting("sockdiag-sockets", TYPE_ID_UINT32, &sockdiag_sockets);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sockdiag_bench,	stress_set_sockdiag_bench },
+	{ OPT_sockdiag_sockets,	stress_set_sockdiag_sockets },
+	{ 0,			NULL }
+};
+
 #if defined(__linux__) && 		\
     defined(HAVE_LINUX_SOCK_DIAG_H) &&	\
     defined(HAVE_LINUX_NETLINK_H) && 	\
@@ -276,6 +318,384 @@ static int sockdiag_recv(const stress_args_t *args, const int fd)
 	return 0;
 }
 
+#if defined(HAVE_LINUX_INET_DIAG_H)
+
+#define SOCKDIAG_BENCH_MODES	(SIZEOF_ARRAY(sockdiag_bench_modes))
+
+/* --sockdiag-bench dump variants, from no filter to a bytecode filter */
+typedef struct {
+	const char *name;	/* mode name */
+	const uint32_t states;	/* TCP state mask */
+	const uint8_t ext;	/* extensions requested per socket */
+	const bool bytecode;	/* match the listener source port */
+} stress_sockdiag_mode_t;
+
+static const stress_sockdiag_mode_t sockdiag_bench_modes[] = {
+	{ "all",	~0U,				0,				false },
+	{ "tcp-info",	~0U,				1U << (INET_DIAG_INFO - 1),	false },
+	{ "listen",	1U << SOCKDIAG_TCP_LISTEN,	0,				false },
+	{ "sport",	~0U,				0,				true },
+};
+
+/* --sockdiag-bench per mode totals */
+typedef struct {
+	uint64_t dumps;		/* dumps completed */
+	uint64_t records;	/* sockets returned */
+	uint64_t bytes;		/* netlink bytes received */
+	double duration;	/* total dump time */
+	double max;		/* slowest dump */
+} stress_sockdiag_bench_t;
+
+/* inet_diag dump request with an optional source port bytecode filter */
+typedef struct {
+	struct nlmsghdr nlh;
+	struct inet_diag_req_v2 req;
+	struct rtattr rta;
+	struct inet_diag_bc_op ops[4];
+} stress_sockdiag_inet_request_t;
+
+/*
+ *  stress_sockdiag_bench_dump()
+ *	dump the IPv4 TCP sockets using mode, returns the number of
+ *	records received or -1 on failure with errno set
+ */
+static int64_t stress_sockdiag_bench_dump(
+	const int fd,
+	const stress_sockdiag_mode_t *mode,
+	const uint16_t port,
+	const uint32_t seq,
+	uint8_t *buf,
+	uint64_t *bytes)
+{
+	stress_sockdiag_inet_request_t request;
+	struct sockaddr_nl nladdr;
+	int64_t records = 0;
+	ssize_t ret;
+
+	(void)memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+	(void)memset(&request, 0, sizeof(request));
+	request.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(request.req));
+	request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+	request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	request.nlh.nlmsg_seq = seq;
+	request.req.sdiag_family = AF_INET;
+	request.req.sdiag_protocol = IPPROTO_TCP;
+	request.req.idiag_states = mode->states;
+	request.req.idiag_ext = mode->ext;
+	if (mode->bytecode) {
+		/* sport >= port && sport <= port, a failed test jumps past the end */
+		request.rta.rta_type = INET_DIAG_REQ_BYTECODE;
+		request.rta.rta_len = RTA_LENGTH(sizeof(request.ops));
+		request.ops[0].code = INET_DIAG_BC_S_GE;
+		request.ops[0].yes = sizeof(request.ops[0]) * 2;
+		request.ops[0].no = sizeof(request.ops) + 4;
+		request.ops[1].no = port;
+		request.ops[2].code = INET_DIAG_BC_S_LE;
+		request.ops[2].yes = sizeof(request.ops[0]) * 2;
+		request.ops[2].no = (sizeof(request.ops[0]) * 2) + 4;
+		request.ops[3].no = port;
+		request.nlh.nlmsg_len += RTA_SPACE(sizeof(request.ops));
+	}
+
+	ret = sendto(fd, &request, request.nlh.nlmsg_len, 0,
+		(struct sockaddr *)&nladdr, sizeof(nladdr));
+	if (ret < 0)
+		return -1;
+
+	for (;;) {
+		struct nlmsghdr *h = (struct nlmsghdr *)buf;
+
+		ret = recv(fd, buf, SOCKDIAG_BENCH_BUF, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			break;
+		*bytes += (uint64_t)ret;
+		for (; NLMSG_OK(h, ret); h = NLMSG_NEXT(h, ret)) {
+			if (h->nlmsg_seq != seq)
+				continue;
+			if (h->nlmsg_type == NLMSG_DONE)
+				return records;
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				const struct nlmsgerr *err = (const struct nlmsgerr *)NLMSG_DATA(h);
+
+				errno = -err->error;
+				return -1;
+			}
+			records++;
+		}
+	}
+	return records;
+}
+
+/*
+ *  stress_sockdiag_bench_rlimit()
+ *	try to allow n_fds open files, returns the number of files that
+ *	can be opened
+ */
+static size_t stress_sockdiag_bench_rlimit(const size_t n_fds)
+{
+	struct rlimit rlim;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+		if (rlim.rlim_cur < (rlim_t)n_fds) {
+			struct rlimit new_rlim = rlim;
+
+			/* raising the hard limit needs CAP_SYS_RESOURCE */
+			new_rlim.rlim_cur = (rlim_t)n_fds;
+			if (new_rlim.rlim_max < (rlim_t)n_fds)
+				new_rlim.rlim_max = (rlim_t)n_fds;
+			if (setrlimit(RLIMIT_NOFILE, &new_rlim) < 0) {
+				rlim.rlim_cur = rlim.rlim_max;
+				(void)setrlimit(RLIMIT_NOFILE, &rlim);
+			}
+		}
+	}
+	return stress_get_file_limit();
+}
+
+/*
+ *  stress_sockdiag_bench_open()
+ *	open a listener and connect to it until there are n_sockets
+ *	established sockets, clients cycle through 127.0.0.0/8
+ *	destinations so the ephemeral ports do not run out. Returns
+ *	the number of fds opened in fds, fds[0] is the listener.
+ */
+static size_t stress_sockdiag_bench_open(
+	const stress_args_t *args,
+	const size_t n_sockets,
+	int *fds,
+	uint16_t *port)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	size_t n = 0, conns = 0;
+	int so_reuseaddr = 1, flags;
+
+	fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+	if (fds[0] < 0)
+		return 0;
+	(void)setsockopt(fds[0], SOL_SOCKET, SO_REUSEADDR, &so_reuseaddr, sizeof(so_reuseaddr));
+	(void)memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = 0;
+	if ((bind(fds[0], (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+	    (listen(fds[0], SOCKDIAG_BENCH_BATCH * 2) < 0) ||
+	    (getsockname(fds[0], (struct sockaddr *)&addr, &len) < 0)) {
+		(void)close(fds[0]);
+		return 0;
+	}
+	*port = ntohs(addr.sin_port);
+	flags = fcntl(fds[0], F_GETFL, 0);
+	if (flags >= 0)
+		(void)fcntl(fds[0], F_SETFL, flags | O_NONBLOCK);
+	n = 1;
+
+	while (keep_stressing_flag() && ((n + 2) <= n_sockets + 1)) {
+		size_t i;
+
+		for (i = 0; (i < SOCKDIAG_BENCH_BATCH) && ((n + 2) <= n_sockets + 1); i++) {
+			const uint32_t host = 1 + (uint32_t)(conns / SOCKDIAG_BENCH_PER_ADDR);
+			int cfd;
+
+			if (host >= 0x00ffffff)
+				goto done;
+			cfd = socket(AF_INET, SOCK_STREAM, 0);
+			if (cfd < 0)
+				goto done;
+			addr.sin_addr.s_addr = htonl(0x7f000000 | host);
+			if (connect(cfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+				const int saved_errno = errno;
+
+				(void)close(cfd);
+				if (saved_errno == EINTR)
+					continue;
+				/* out of ports for this destination, move on to the next */
+				if (saved_errno == EADDRNOTAVAIL) {
+					conns = ((conns / SOCKDIAG_BENCH_PER_ADDR) + 1) *
+						SOCKDIAG_BENCH_PER_ADDR;
+					continue;
+				}
+				pr_dbg("%s: connect failed after %zu sockets, errno=%d (%s)\n",
+					args->name, n - 1, saved_errno, strerror(saved_errno));
+				goto done;
+			}
+			fds[n++] = cfd;
+			conns++;
+		}
+		/* drain the accept queue, a failed accept leaves a client without a peer */
+		for (;;) {
+			const int afd = accept(fds[0], NULL, NULL);
+
+			if (afd < 0)
+				break;
+			if (n >= n_sockets + 1) {
+				(void)close(afd);
+				break;
+			}
+			fds[n++] = afd;
+		}
+	}
+done:
+	for (;;) {
+		const int afd = accept(fds[0], NULL, NULL);
+
+		if (afd < 0)
+			break;
+		if (n >= n_sockets + 1) {
+			(void)close(afd);
+			break;
+		}
+		fds[n++] = afd;
+	}
+	return n;
+}
+
+/*
+ *  stress_sockdiag_bench()
+ *	open sockdiag_sockets established TCP sockets and repeatedly
+ *	time full inet_diag dumps of them with and without filters
+ */
+static int stress_sockdiag_bench(const stress_args_t *args)
+{
+	stress_sockdiag_bench_t stats[SOCKDIAG_BENCH_MODES];
+	uint32_t sockdiag_sockets = DEFAULT_SOCKDIAG_SOCKETS;
+	size_t n_sockets, n_fds, max_fds, i;
+	const struct linger lin = { 1, 0 };
+	uint32_t seq = 0;
+	uint16_t port = 0;
+	uint8_t *buf;
+	double t_open;
+	int *fds, fd, rcvbuf = 4 * MB, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("sockdiag-sockets", &sockdiag_sockets);
+	n_sockets = (size_t)sockdiag_sockets;
+
+	fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_SOCK_DIAG);
+	if (fd < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: NETLINK_SOCK_DIAG open failed, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+		return EXIT_NOT_IMPLEMENTED;
+	}
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	/* the listener, the netlink socket and stdio */
+	max_fds = stress_sockdiag_bench_rlimit(n_sockets + 64);
+	if (max_fds < 16) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: too few free file descriptors, skipping stressor\n",
+				args->name);
+		(void)close(fd);
+		return EXIT_NO_RESOURCE;
+	}
+	if (n_sockets > max_fds - 16) {
+		n_sockets = max_fds - 16;
+		if (args->instance == 0)
+			pr_inf("%s: file descriptor limit reduces sockets to %zu\n",
+				args->name, n_sockets);
+	}
+
+	buf = (uint8_t *)malloc(SOCKDIAG_BENCH_BUF);
+	fds = (int *)calloc(n_sockets + 1, sizeof(*fds));
+	if (!buf || !fds) {
+		pr_inf_skip("%s: cannot allocate socket table, skipping stressor\n",
+			args->name);
+		free(fds);
+		free(buf);
+		(void)close(fd);
+		return EXIT_NO_RESOURCE;
+	}
+
+	t_open = stress_time_now();
+	n_fds = stress_sockdiag_bench_open(args, n_sockets, fds, &port);
+	t_open = stress_time_now() - t_open;
+	if (n_fds < 2) {
+		pr_inf_skip("%s: cannot open loopback TCP sockets, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_fds;
+	}
+	if (args->instance == 0)
+		pr_inf("%s: opened %zu TCP sockets in %.2f seconds\n",
+			args->name, n_fds - 1, t_open);
+
+	(void)memset(stats, 0, sizeof(stats));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < SOCKDIAG_BENCH_MODES); i++) {
+			const double t = stress_time_now();
+			const int64_t records = stress_sockdiag_bench_dump(fd,
+				&sockdiag_bench_modes[i], port, ++seq, buf, &stats[i].bytes);
+			const double duration = stress_time_now() - t;
+
+			if (records < 0) {
+				pr_fail("%s: %s inet_diag dump failed, errno=%d (%s)\n",
+					args->name, sockdiag_bench_modes[i].name,
+					errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto report;
+			}
+			stats[i].dumps++;
+			stats[i].records += (uint64_t)records;
+			stats[i].duration += duration;
+			if (stats[i].max < duration)
+				stats[i].max = duration;
+			inc_counter(args);
+		}
+	} while (keep_stressing(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: filter      dumps  records/dump   mean ms    max ms  Krecords/s\n",
+			args->name);
+	for (i = 0; i < SOCKDIAG_BENCH_MODES; i++) {
+		const stress_sockdiag_bench_t *st = &stats[i];
+		const double mean_ms = st->dumps ?
+			(st->duration * 1000.0) / (double)st->dumps : 0.0;
+		const double krecs = (st->duration > 0.0) ?
+			((double)st->records / st->duration) / 1000.0 : 0.0;
+		char desc[40];
+
+		if (!st->dumps)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %-10s %6" PRIu64 " %13.1f %9.3f %9.3f %11.1f\n",
+				args->name, sockdiag_bench_modes[i].name, st->dumps,
+				(double)st->records / (double)st->dumps,
+				mean_ms, st->max * 1000.0, krecs);
+		(void)snprintf(desc, sizeof(desc), "%s dump mean ms",
+			sockdiag_bench_modes[i].name);
+		stress_misc_stats_set(args->misc_stats, i * 2, desc, mean_ms);
+		(void)snprintf(desc, sizeof(desc), "%s Krecords/s",
+			sockdiag_bench_modes[i].name);
+		stress_misc_stats_set(args->misc_stats, (i * 2) + 1, desc, krecs);
+	}
+	stress_misc_stats_set(args->misc_stats, SOCKDIAG_BENCH_MODES * 2,
+		"TCP sockets opened", (double)(n_fds - 1));
+
+	/* reset rather than close to not leave sockets in TIME_WAIT */
+	for (i = 1; i < n_fds; i++) {
+		(void)setsockopt(fds[i], SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+		(void)close(fds[i]);
+	}
+	(void)close(fds[0]);
+free_fds:
+	free(fds);
+	free(buf);
+	(void)close(fd);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_sockdiag
  *	stress by heavy socket I/O
@@ -283,6 +703,19 @@ static int sockdiag_recv(const stress_args_t *args, const int fd)
 static int stress_sockdiag(const stress_args_t *args)
 {
 	int ret = EXIT_SUCCESS;
+	bool sockdiag_bench = false;
+
+	(void)stress_get_setting("sockdiag-bench", &sockdiag_bench);
+	if (sockdiag_bench) {
+#if defined(HAVE_LINUX_INET_DIAG_H)
+		return stress_sockdiag_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --sockdiag-bench requires linux/inet_diag.h, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -327,12 +760,14 @@ static int stress_sockdiag(const stress_args_t *args)
 stressor_info_t stress_sockdiag_info = {
 	.stressor = stress_sockdiag,
 	.class = CLASS_NETWORK | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_sockdiag_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_NETWORK | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
@@ -22,12 +22,61 @@
 #define MAX_SOCKET_PAIRS	(32768)
 #define SOCKET_PAIR_BUF         (64)	/* Socket pair I/O buffer size */
 
+#define SOCKPAIR_BENCH_STEP	(0.1)	/* seconds per sweep step */
+#define SOCKPAIR_BENCH_MAX_SIZE	(1 * MB)
+#define SOCKPAIR_BENCH_MAX_FDS	(253)	/* SCM_MAX_FD */
+#define SOCKPAIR_BENCH_TYPES	(SIZEOF_ARRAY(sockpair_bench_types))
+#define SOCKPAIR_BENCH_SIZES	(SIZEOF_ARRAY(sockpair_bench_sizes))
+#define SOCKPAIR_BENCH_FDS	(SIZEOF_ARRAY(sockpair_bench_fds))
+
 static const stress_help_t help[] = {
 	{ NULL,	"sockpair N",	  "start N workers exercising socket pair I/O activity" },
+	{ NULL,	"sockpair-bench", "sweep message sizes and SCM_RIGHTS fds per message" },
 	{ NULL,	"sockpair-ops N", "stop after N socket pair bogo operations" },
 	{ NULL,	NULL,		  NULL }
 };
 
+typedef struct {
+	const int type;
+	const char *name;
+} stress_sockpair_type_t;
+
+/* --sockpair-bench socket types, message sizes and fds per message */
+static const stress_sockpair_type_t sockpair_bench_types[] = {
+	{ SOCK_STREAM,		"stream" },
+#if defined(SOCK_SEQPACKET)
+	{ SOCK_SEQPACKET,	"seqpacket" },
+#endif
+	{ SOCK_DGRAM,		"dgram" },
+};
+
+static const size_t sockpair_bench_sizes[] = {
+	64, 256, 1 * KB, 4 * KB, 16 * KB, 64 * KB, 256 * KB, 1 * MB
+};
+
+static const int sockpair_bench_fds[] = {
+	1, 4, 16, 64, 253
+};
+
+/* --sockpair-bench totals of one or more steps */
+typedef struct {
+	uint64_t bytes;		/* payload bytes received */
+	uint64_t msgs;		/* messages received */
+	uint64_t fds;		/* SCM_RIGHTS fds received */
+	double duration;	/* first send to last receive */
+	bool unsupported;	/* message size or type not supported */
+} stress_sockpair_bench_t;
+
+static int stress_set_sockpair_bench(const char *opt)
+{
+	return stress_set_setting_true("sockpair-bench", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sockpair_bench,	stress_set_sockpair_bench },
+	{ 0,			NULL }
+};
+
 /*
  *  socket_pair_memset()
  *	set data to be incrementing chars from val upwards
@@ -267,6 +316,334 @@ finish:
 	return EXIT_SUCCESS;
 }
 
+/*
+ *  stress_sockpair_bench_receiver()
+ *	child side of a --sockpair-bench step, receive until EOF or a
+ *	zero length datagram, closing any passed fds, then send the
+ *	totals back to the sender over the same socket
+ */
+static void NORETURN stress_sockpair_bench_receiver(const int fd, uint8_t *buf)
+{
+	stress_sockpair_bench_t result;
+	char ctrl[CMSG_SPACE(sizeof(int) * SOCKPAIR_BENCH_MAX_FDS)];
+	size_t done = 0;
+
+	stress_parent_died_alarm();
+	(void)memset(&result, 0, sizeof(result));
+
+	for (;;) {
+		struct msghdr msg;
+		struct iovec iov;
+		struct cmsghdr *cmsg;
+		ssize_t n;
+
+		iov.iov_base = buf;
+		iov.iov_len = SOCKPAIR_BENCH_MAX_SIZE;
+		(void)memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = ctrl;
+		msg.msg_controllen = sizeof(ctrl);
+
+		n = recvmsg(fd, &msg, 0);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			_exit(EXIT_FAILURE);
+		}
+		if (n == 0)
+			break;
+		result.bytes += (uint64_t)n;
+		result.msgs++;
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			const int *fds = (const int *)CMSG_DATA(cmsg);
+			size_t i, nfds;
+
+			if ((cmsg->cmsg_level != SOL_SOCKET) ||
+			    (cmsg->cmsg_type != SCM_RIGHTS))
+				continue;
+			nfds = ((size_t)cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for (i = 0; i < nfds; i++)
+				(void)close(fds[i]);
+			result.fds += nfds;
+		}
+	}
+
+	while (done < sizeof(result)) {
+		const ssize_t n = send(fd, ((char *)&result) + done, sizeof(result) - done, 0);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			_exit(EXIT_FAILURE);
+		}
+		done += (size_t)n;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_sockpair_bench_step()
+ *	send size byte messages, each carrying nfds SCM_RIGHTS copies of
+ *	pass_fd if nfds is non-zero, over a new socket pair of the given
+ *	type for SOCKPAIR_BENCH_STEP seconds and accumulate what the
+ *	receiver got into bench. Returns 0 on success, -1 on failure.
+ */
+static int stress_sockpair_bench_step(
+	const stress_args_t *args,
+	const int type,
+	const size_t size,
+	const int nfds,
+	const int pass_fd,
+	uint8_t *buf,
+	stress_sockpair_bench_t *bench)
+{
+	stress_sockpair_bench_t result;
+	char ctrl[CMSG_SPACE(sizeof(int) * SOCKPAIR_BENCH_MAX_FDS)];
+	int sv[2], status, rc = 0;
+	uint64_t sent = 0;
+	size_t done = 0;
+	double t, t_end;
+	pid_t pid;
+
+	if (socketpair(AF_UNIX, type, 0, sv) < 0) {
+		if ((errno == EPROTONOSUPPORT) || (errno == EOPNOTSUPP) ||
+		    (errno == ESOCKTNOSUPPORT)) {
+			bench->unsupported = true;
+			return 0;
+		}
+		pr_fail("%s: socketpair failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	/* datagram sizes are limited by the send buffer size */
+	if (type != SOCK_STREAM) {
+		int val = (int)(size * 2);
+
+		(void)setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &val, sizeof(val));
+#if defined(SO_SNDBUFFORCE)
+		(void)setsockopt(sv[0], SOL_SOCKET, SO_SNDBUFFORCE, &val, sizeof(val));
+#endif
+	}
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(errno))
+			goto again;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(sv[0]);
+		(void)close(sv[1]);
+		return -1;
+	} else if (pid == 0) {
+		(void)close(sv[0]);
+		stress_sockpair_bench_receiver(sv[1], buf);
+	}
+	(void)close(sv[1]);
+
+	t = stress_time_now();
+	t_end = t + SOCKPAIR_BENCH_STEP;
+	do {
+		struct msghdr msg;
+		struct iovec iov;
+		ssize_t n;
+
+		iov.iov_base = buf;
+		iov.iov_len = size;
+		(void)memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		if (nfds) {
+			struct cmsghdr *cmsg;
+			int i, *fds;
+
+			msg.msg_control = ctrl;
+			msg.msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)nfds);
+			cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)nfds);
+			fds = (int *)CMSG_DATA(cmsg);
+			for (i = 0; i < nfds; i++)
+				fds[i] = pass_fd;
+		}
+		n = sendmsg(sv[0], &msg, 0);
+		if (n < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN) || (errno == ENOBUFS))
+				continue;
+			/* too many fds in flight, let the receiver catch up */
+			if (errno == ETOOMANYREFS) {
+				(void)shim_sched_yield();
+				continue;
+			}
+			if (errno == EMSGSIZE) {
+				bench->unsupported = true;
+				break;
+			}
+			pr_fail("%s: sendmsg failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = -1;
+			break;
+		}
+		sent++;
+	} while (keep_stressing(args) && (stress_time_now() < t_end));
+
+	/* datagram sockets have no EOF, a zero length datagram ends the step */
+	if (type == SOCK_DGRAM) {
+		while ((send(sv[0], buf, 0, 0) < 0) && (errno == EINTR))
+			;
+	} else {
+		(void)shutdown(sv[0], SHUT_WR);
+	}
+
+	while (done < sizeof(result)) {
+		const ssize_t n = recv(sv[0], ((char *)&result) + done, sizeof(result) - done, 0);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (n == 0)
+			break;
+		done += (size_t)n;
+	}
+	if (done == sizeof(result)) {
+		if (!bench->unsupported)
+			bench->duration += stress_time_now() - t;
+		bench->bytes += result.bytes;
+		/* stream reads coalesce, so count the messages sent */
+		bench->msgs += (type == SOCK_STREAM) ? sent : result.msgs;
+		bench->fds += result.fds;
+	}
+	add_counter(args, sent);
+
+	(void)close(sv[0]);
+	(void)kill(pid, SIGKILL);
+	(void)shim_waitpid(pid, &status, 0);
+
+	return rc;
+}
+
+/*
+ *  stress_sockpair_bench()
+ *	repeatedly sweep the message sizes over each socket type and
+ *	the number of SCM_RIGHTS fds passed per message, one socket
+ *	pair and receiver process per step
+ */
+static int stress_sockpair_bench(const stress_args_t *args)
+{
+	stress_sockpair_bench_t sizes[SOCKPAIR_BENCH_TYPES][SOCKPAIR_BENCH_SIZES];
+	stress_sockpair_bench_t fds[SOCKPAIR_BENCH_FDS];
+	uint8_t *buf;
+	size_t i, j, idx = 0;
+	int pass_fd, rc = EXIT_SUCCESS;
+
+	buf = (uint8_t *)mmap(NULL, SOCKPAIR_BENCH_MAX_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte buffer, errno=%d (%s), "
+			"skipping stressor\n", args->name, (size_t)SOCKPAIR_BENCH_MAX_SIZE,
+			errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(buf, 0x5a, SOCKPAIR_BENCH_MAX_SIZE);
+
+	pass_fd = open("/dev/null", O_RDONLY);
+	if (pass_fd < 0) {
+		pr_inf_skip("%s: cannot open /dev/null, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		(void)munmap((void *)buf, SOCKPAIR_BENCH_MAX_SIZE);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(sizes, 0, sizeof(sizes));
+	(void)memset(fds, 0, sizeof(fds));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < SOCKPAIR_BENCH_TYPES); i++) {
+			for (j = 0; keep_stressing(args) && (j < SOCKPAIR_BENCH_SIZES); j++) {
+				if (sizes[i][j].unsupported)
+					continue;
+				if (stress_sockpair_bench_step(args, sockpair_bench_types[i].type,
+						sockpair_bench_sizes[j], 0, pass_fd, buf, &sizes[i][j]) < 0) {
+					rc = EXIT_FAILURE;
+					goto finish;
+				}
+			}
+		}
+		for (i = 0; keep_stressing(args) && (i < SOCKPAIR_BENCH_FDS); i++) {
+			if (stress_sockpair_bench_step(args, SOCK_DGRAM, 1,
+					sockpair_bench_fds[i], pass_fd, buf, &fds[i]) < 0) {
+				rc = EXIT_FAILURE;
+				goto finish;
+			}
+		}
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: type         size      MB/s   Kmsgs/s\n", args->name);
+	for (i = 0; i < SOCKPAIR_BENCH_TYPES; i++) {
+		for (j = 0; j < SOCKPAIR_BENCH_SIZES; j++) {
+			const stress_sockpair_bench_t *b = &sizes[i][j];
+			const double mbs = (b->duration > 0.0) ?
+				((double)b->bytes / b->duration) / (double)MB : 0.0;
+			const double kmsgs = (b->duration > 0.0) ?
+				((double)b->msgs / b->duration) / 1000.0 : 0.0;
+			char desc[40];
+
+			if (args->instance == 0) {
+				if (b->unsupported)
+					pr_inf("%s: %-10s %7zu  message size not supported\n",
+						args->name, sockpair_bench_types[i].name,
+						sockpair_bench_sizes[j]);
+				else if (b->duration > 0.0)
+					pr_inf("%s: %-10s %7zu %9.1f %9.1f\n",
+						args->name, sockpair_bench_types[i].name,
+						sockpair_bench_sizes[j], mbs, kmsgs);
+			}
+			/* small message rate and large message bandwidth per type */
+			if ((sockpair_bench_sizes[j] == 64) && (idx < 10)) {
+				(void)snprintf(desc, sizeof(desc), "%s 64B Kmsgs/s",
+					sockpair_bench_types[i].name);
+				stress_misc_stats_set(args->misc_stats, idx++, desc, kmsgs);
+			} else if ((sockpair_bench_sizes[j] == 64 * KB) && (idx < 10)) {
+				(void)snprintf(desc, sizeof(desc), "%s 64K MB/s",
+					sockpair_bench_types[i].name);
+				stress_misc_stats_set(args->misc_stats, idx++, desc, mbs);
+			}
+		}
+	}
+	if (args->instance == 0)
+		pr_inf("%s: fds/msg   Kmsgs/s    Kfds/s\n", args->name);
+	for (i = 0; i < SOCKPAIR_BENCH_FDS; i++) {
+		const stress_sockpair_bench_t *b = &fds[i];
+		const double kfds = (b->duration > 0.0) ?
+			((double)b->fds / b->duration) / 1000.0 : 0.0;
+		char desc[40];
+
+		if (b->duration <= 0.0)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %7d %9.1f %9.1f\n", args->name, sockpair_bench_fds[i],
+				((double)b->msgs / b->duration) / 1000.0, kfds);
+		if (((i == 0) || (i == SOCKPAIR_BENCH_FDS - 1)) && (idx < 10)) {
+			(void)snprintf(desc, sizeof(desc), "%d fds per msg Kfds/s",
+				sockpair_bench_fds[i]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, kfds);
+		}
+	}
+
+	(void)close(pass_fd);
+	(void)munmap((void *)buf, SOCKPAIR_BENCH_MAX_SIZE);
+
+	return rc;
+}
+
 /*
  *  stress_sockpair
  *	stress by heavy socket_pair I/O
@@ -274,12 +651,18 @@ finish:
 static int stress_sockpair(const stress_args_t *args)
 {
 	int rc;
+	bool sockpair_bench = false;
 
-	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	(void)stress_get_setting("sockpair-bench", &sockpair_bench);
 
 	if (stress_sighandler(args->name, SIGPIPE, stress_sighandler_nop, NULL) < 0)
 		return EXIT_NO_RESOURCE;
 
+	if (sockpair_bench)
+		return stress_sockpair_bench(args);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
 	rc = stress_oomable_child(args, NULL, stress_sockpair_oomable, STRESS_OOMABLE_DROP_CAP);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -290,6 +673,7 @@ static int stress_sockpair(const stress_args_t *args)
 stressor_info_t stress_sockpair_info = {
 	.stressor = stress_sockpair,
 	.class = CLASS_NETWORK | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -0,0 +1,1070 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-bitops.h"
+
+#define MIN_SORTBENCH_SIZE	(1 * KB)
+#define MAX_SORTBENCH_SIZE	(16 * MB)
+#define DEFAULT_SORTBENCH_SIZE	(1 * MB)
+
+#define MIN_SORTBENCH_THREADS	(1)
+#define MAX_SORTBENCH_THREADS	(64)
+
+#define SORTBENCH_MAX_COUNTS	(8)	/* 1, 2, 4 .. 64 and the maximum */
+#define SORTBENCH_INSERTION	(16)	/* insertion sort partitions below this */
+#define SORTBENCH_STR_LEN	(16)	/* str element length */
+#define SORTBENCH_ELEM_MAX	(16)	/* largest element size in bytes */
+
+static const stress_help_t help[] = {
+	{ NULL,	"sortbench N",		"start N workers comparing parallel sort algorithms" },
+	{ NULL,	"sortbench-data D",	"select u32, u64, str, kv or all, default is all" },
+	{ NULL,	"sortbench-method M",	"select merge, radix, intro, pdq or all, default is all" },
+	{ NULL,	"sortbench-ops N",	"stop after N sorts" },
+	{ NULL,	"sortbench-presort P",	"make P percent of the data already sorted, default is 0" },
+	{ NULL,	"sortbench-size N",	"number of elements to sort, default is 1M" },
+	{ NULL,	"sortbench-threads N",	"sweep 1 to N sorting threads, default is the number of CPUs" },
+	{ NULL,	NULL,			NULL }
+};
+
+#define SORTBENCH_MERGE		(0)
+#define SORTBENCH_RADIX		(1)
+#define SORTBENCH_INTRO		(2)
+#define SORTBENCH_PDQ		(3)
+#define SORTBENCH_METHODS	(4)
+
+static const char * const sortbench_methods[] = {
+	"merge",
+	"radix",
+	"intro",
+	"pdq",
+};
+
+static const char * const sortbench_data[] = {
+	"u32",
+	"u64",
+	"str",
+	"kv",
+};
+
+static int stress_sortbench_name(
+	const char *opt,
+	const char *what,
+	const char * const *names,
+	const size_t n)
+{
+	size_t i;
+
+	/* 0 is all, names are index + 1 */
+	if (!strcmp(opt, "all")) {
+		i = 0;
+		return stress_set_setting(what, TYPE_ID_SIZE_T, &i);
+	}
+	for (i = 0; i < n; i++) {
+		if (!strcmp(opt, names[i])) {
+			const size_t idx = i + 1;
+
+			return stress_set_setting(what, TYPE_ID_SIZE_T, &idx);
+		}
+	}
+
+	(void)fprintf(stderr, "%s must be one of: all", what);
+	for (i = 0; i < n; i++)
+		(void)fprintf(stderr, " %s", names[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_sortbench_method(const char *opt)
+{
+	return stress_sortbench_name(opt, "sortbench-method",
+		sortbench_methods, SIZEOF_ARRAY(sortbench_methods));
+}
+
+static int stress_set_sortbench_data(const char *opt)
+{
+	return stress_sortbench_name(opt, "sortbench-data",
+		sortbench_data, SIZEOF_ARRAY(sortbench_data));
+}
+
+static int stress_set_sortbench_presort(const char *opt)
+{
+	uint32_t sortbench_presort;
+
+	sortbench_presort = stress_get_uint32(opt);
+	stress_check_range("sortbench-presort", (uint64_t)sortbench_presort, 0, 100);
+	return stress_set_setting("sortbench-presort", TYPE_ID_UINT32, &sortbench_presort);
+}
+
+static int stress_set_sortbench_size(const char *opt)
+{
+	uint64_t sortbench_size;
+
+	sortbench_size = stress_get_uint64(opt);
+	stress_check_range("sortbench-size", sortbench_size,
+		MIN_SORTBENCH_SIZE, MAX_SORTBENCH_SIZE);
+	return stress_set_setting("sortbench-size", TYPE_ID_UINT64, &sortbench_size);
+}
+
+static int stress_set_sortbench_threads(const char *opt)
+{
+	uint32_t sortbench_threads;
+
+	sortbench_threads = stress_get_uint32(opt);
+	stress_check_range("sortbench-threads", (uint64_t)sortbench_threads,
+		MIN_SORTBENCH_THREADS, MAX_SORTBENCH_THREADS);
+	return stress_set_setting("sortbench-threads", TYPE_ID_UINT32, &sortbench_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sortbench_data,		stress_set_sortbench_data },
+	{ OPT_sortbench_method,		stress_set_sortbench_method },
+	{ OPT_sortbench_presort,	stress_set_sortbench_presort },
+	{ OPT_sortbench_size,		stress_set_sortbench_size },
+	{ OPT_sortbench_threads,	stress_set_sortbench_threads },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD)
+
+typedef struct {
+	char s[SORTBENCH_STR_LEN];
+} stress_sortbench_str_t;
+
+typedef struct {
+	uint64_t key;
+	uint64_t value;
+} stress_sortbench_kv_t;
+
+/*
+ *  Per element type sort functions, sort[] are single threaded
+ *  sorts indexed by method, radix sorting is done in passes of
+ *  a histogram and a scatter of key byte pass, least significant
+ *  byte first
+ */
+typedef struct {
+	const char *name;
+	const size_t size;		/* element size in bytes */
+	const size_t key_bytes;		/* radix sort passes */
+	void (*generate)(void *base, const size_t n);
+	bool (*sorted)(const void *base, const size_t n);
+	void (*sort[SORTBENCH_METHODS])(void *base, void *tmp, const size_t n);
+	void (*merge)(const void *src, void *dst, const size_t lo,
+		const size_t mid, const size_t hi);
+	void (*radix_hist)(const void *src, const size_t lo, const size_t hi,
+		const size_t pass, size_t *hist);
+	void (*radix_scatter)(const void *src, void *dst, const size_t lo,
+		const size_t hi, const size_t pass, size_t *offsets);
+} stress_sortbench_type_t;
+
+typedef struct stress_sortbench_thread {
+	const stress_sortbench_type_t *type;
+	size_t method;
+	void *src;			/* data to sort or merge */
+	void *dst;			/* merge and scatter destination */
+	size_t lo, mid, hi;		/* element range */
+	size_t pass;			/* radix sort key byte */
+	size_t hist[256];		/* radix histogram, then offsets */
+	void (*func)(struct stress_sortbench_thread *t);
+	pthread_t pthread;
+	int ret;
+} stress_sortbench_thread_t;
+
+typedef struct {
+	double elements;		/* elements sorted */
+	double duration;		/* time spent sorting */
+} stress_sortbench_stats_t;
+
+static inline bool ALWAYS_INLINE stress_sortbench_less_u32(const uint32_t *a, const uint32_t *b)
+{
+	return *a < *b;
+}
+
+static inline uint8_t ALWAYS_INLINE stress_sortbench_byte_u32(const uint32_t *a, const size_t i)
+{
+	return (uint8_t)(*a >> (i << 3));
+}
+
+static inline void ALWAYS_INLINE stress_sortbench_rand_u32(uint32_t *a, const size_t i)
+{
+	(void)i;
+
+	*a = stress_mwc32();
+}
+
+static inline bool ALWAYS_INLINE stress_sortbench_less_u64(const uint64_t *a, const uint64_t *b)
+{
+	return *a < *b;
+}
+
+static inline uint8_t ALWAYS_INLINE stress_sortbench_byte_u64(const uint64_t *a, const size_t i)
+{
+	return (uint8_t)(*a >> (i << 3));
+}
+
+static inline void ALWAYS_INLINE stress_sortbench_rand_u64(uint64_t *a, const size_t i)
+{
+	(void)i;
+
+	*a = stress_mwc64();
+}
+
+static inline bool ALWAYS_INLINE stress_sortbench_less_str(
+	const stress_sortbench_str_t *a,
+	const stress_sortbench_str_t *b)
+{
+	return memcmp(a->s, b->s, SORTBENCH_STR_LEN) < 0;
+}
+
+static inline uint8_t ALWAYS_INLINE stress_sortbench_byte_str(
+	const stress_sortbench_str_t *a,
+	const size_t i)
+{
+	return (uint8_t)a->s[SORTBENCH_STR_LEN - 1 - i];
+}
+
+static inline void ALWAYS_INLINE stress_sortbench_rand_str(stress_sortbench_str_t *a, const size_t i)
+{
+	size_t j;
+
+	(void)i;
+
+	/* lower case letters, a small alphabet like real text keys */
+	for (j = 0; j < SORTBENCH_STR_LEN; j++)
+		a->s[j] = (char)('a' + (stress_mwc8() % 26));
+}
+
+static inline bool ALWAYS_INLINE stress_sortbench_less_kv(
+	const stress_sortbench_kv_t *a,
+	const stress_sortbench_kv_t *b)
+{
+	return a->key < b->key;
+}
+
+static inline uint8_t ALWAYS_INLINE stress_sortbench_byte_kv(
+	const stress_sortbench_kv_t *a,
+	const size_t i)
+{
+	return (uint8_t)(a->key >> (i << 3));
+}
+
+static inline void ALWAYS_INLINE stress_sortbench_rand_kv(stress_sortbench_kv_t *a, const size_t i)
+{
+	a->key = stress_mwc64();
+	a->value = (uint64_t)i;
+}
+
+/*
+ *  STRESS_SORTBENCH_FUNCS()
+ *	generate the sort functions for element type type
+ */
+#define STRESS_SORTBENCH_FUNCS(tname, type)					\
+static inline void ALWAYS_INLINE stress_sortbench_swap_ ## tname(		\
+	type *a,								\
+	type *b)								\
+{										\
+	const type tmp = *a;							\
+										\
+	*a = *b;								\
+	*b = tmp;								\
+}										\
+										\
+static void stress_sortbench_insertion_ ## tname(type *base, const size_t n)	\
+{										\
+	size_t i;								\
+										\
+	for (i = 1; i < n; i++) {						\
+		const type v = base[i];						\
+		size_t j = i;							\
+										\
+		while ((j > 0) && stress_sortbench_less_ ## tname(&v, &base[j - 1])) { \
+			base[j] = base[j - 1];					\
+			j--;							\
+		}								\
+		base[j] = v;							\
+	}									\
+}										\
+										\
+/*										\
+ *  stress_sortbench_partial_insertion()					\
+ *	insertion sort that gives up after 8 element moves,			\
+ *	returns true if the data got sorted					\
+ */										\
+static bool stress_sortbench_partial_insertion_ ## tname(			\
+	type *base,								\
+	const size_t n)								\
+{										\
+	size_t i, moves = 0;							\
+										\
+	for (i = 1; i < n; i++) {						\
+		const type v = base[i];						\
+		size_t j = i;							\
+										\
+		while ((j > 0) && stress_sortbench_less_ ## tname(&v, &base[j - 1])) { \
+			base[j] = base[j - 1];					\
+			j--;							\
+		}								\
+		base[j] = v;							\
+		moves += i - j;							\
+		if (moves > 8)							\
+			return false;						\
+	}									\
+	return true;								\
+}										\
+										\
+static void stress_sortbench_sift_ ## tname(					\
+	type *base,								\
+	size_t root,								\
+	const size_t n)								\
+{										\
+	for (;;) {								\
+		size_t child = (2 * root) + 1;					\
+										\
+		if (child >= n)							\
+			return;							\
+		if ((child + 1 < n) &&						\
+		    stress_sortbench_less_ ## tname(&base[child], &base[child + 1])) \
+			child++;						\
+		if (!stress_sortbench_less_ ## tname(&base[root], &base[child])) \
+			return;							\
+		stress_sortbench_swap_ ## tname(&base[root], &base[child]);	\
+		root = child;							\
+	}									\
+}										\
+										\
+static void stress_sortbench_heapsort_ ## tname(type *base, const size_t n)	\
+{										\
+	size_t i;								\
+										\
+	if (n < 2)								\
+		return;								\
+	for (i = n / 2; i-- > 0; )						\
+		stress_sortbench_sift_ ## tname(base, i, n);			\
+	for (i = n - 1; i > 0; i--) {						\
+		stress_sortbench_swap_ ## tname(&base[0], &base[i]);		\
+		stress_sortbench_sift_ ## tname(base, 0, i);			\
+	}									\
+}										\
+										\
+/*										\
+ *  stress_sortbench_median3()							\
+ *	order base[a], base[b], base[c] so base[b] is the median		\
+ */										\
+static inline void ALWAYS_INLINE stress_sortbench_median3_ ## tname(		\
+	type *base,								\
+	const size_t a,								\
+	const size_t b,								\
+	const size_t c)								\
+{										\
+	if (stress_sortbench_less_ ## tname(&base[b], &base[a]))		\
+		stress_sortbench_swap_ ## tname(&base[a], &base[b]);		\
+	if (stress_sortbench_less_ ## tname(&base[c], &base[b])) {		\
+		stress_sortbench_swap_ ## tname(&base[b], &base[c]);		\
+		if (stress_sortbench_less_ ## tname(&base[b], &base[a]))	\
+			stress_sortbench_swap_ ## tname(&base[a], &base[b]);	\
+	}									\
+}										\
+										\
+/*										\
+ *  stress_sortbench_partition()						\
+ *	Hoare partition around the pivot in base[0], returns the		\
+ *	final pivot index, swapped is false if the data was			\
+ *	already partitioned							\
+ */										\
+static size_t stress_sortbench_partition_ ## tname(				\
+	type *base,								\
+	const size_t n,								\
+	bool *swapped)								\
+{										\
+	const type pivot = base[0];						\
+	size_t i = 0, j = n;							\
+										\
+	*swapped = false;							\
+	for (;;) {								\
+		do {								\
+			i++;							\
+		} while ((i < n) && stress_sortbench_less_ ## tname(&base[i], &pivot)); \
+		do {								\
+			j--;							\
+		} while (stress_sortbench_less_ ## tname(&pivot, &base[j]));	\
+		if (i >= j)							\
+			break;							\
+		stress_sortbench_swap_ ## tname(&base[i], &base[j]);		\
+		*swapped = true;						\
+	}									\
+	stress_sortbench_swap_ ## tname(&base[0], &base[j]);			\
+	return j;								\
+}										\
+										\
+/*										\
+ *  stress_sortbench_introsort_r()						\
+ *	median of 3 quicksort, falls back to heapsort when the			\
+ *	recursion depth is exhausted						\
+ */										\
+static void stress_sortbench_introsort_r_ ## tname(				\
+	type *base,								\
+	size_t n,								\
+	size_t depth)								\
+{										\
+	while (n > SORTBENCH_INSERTION) {					\
+		bool swapped;							\
+		size_t p;							\
+										\
+		if (depth == 0) {						\
+			stress_sortbench_heapsort_ ## tname(base, n);		\
+			return;							\
+		}								\
+		depth--;							\
+		stress_sortbench_median3_ ## tname(base, 0, n / 2, n - 1);	\
+		stress_sortbench_swap_ ## tname(&base[0], &base[n / 2]);	\
+		p = stress_sortbench_partition_ ## tname(base, n, &swapped);	\
+		/* recurse into the smaller side, loop on the larger */		\
+		if (p < n - p - 1) {						\
+			stress_sortbench_introsort_r_ ## tname(base, p, depth);	\
+			base += p + 1;						\
+			n -= p + 1;						\
+		} else {							\
+			stress_sortbench_introsort_r_ ## tname(base + p + 1, n - p - 1, depth); \
+			n = p;							\
+		}								\
+	}									\
+	stress_sortbench_insertion_ ## tname(base, n);				\
+}										\
+										\
+static void stress_sortbench_introsort_ ## tname(void *base, void *tmp, const size_t n) \
+{										\
+	(void)tmp;								\
+										\
+	stress_sortbench_introsort_r_ ## tname((type *)base, n,			\
+		2 * (size_t)stress_msb64((uint64_t)n | 1));			\
+}										\
+										\
+/*										\
+ *  stress_sortbench_pdqsort_r()						\
+ *	pattern defeating quicksort, a ninther pivot for large			\
+ *	partitions, already partitioned data is finished with a			\
+ *	bounded insertion sort and unbalanced partitions have			\
+ *	elements swapped to break up patterns, too many unbalanced		\
+ *	partitions fall back to heapsort					\
+ */										\
+static void stress_sortbench_pdqsort_r_ ## tname(				\
+	type *base,								\
+	size_t n,								\
+	size_t bad_allowed)							\
+{										\
+	while (n > SORTBENCH_INSERTION) {					\
+		const size_t h = n / 2;						\
+		bool swapped;							\
+		size_t p, l, r;							\
+										\
+		if (n > 128) {							\
+			stress_sortbench_median3_ ## tname(base, 0, h, n - 1);	\
+			stress_sortbench_median3_ ## tname(base, 1, h - 1, n - 2); \
+			stress_sortbench_median3_ ## tname(base, 2, h + 1, n - 3); \
+			stress_sortbench_median3_ ## tname(base, h - 1, h, h + 1); \
+		} else {							\
+			stress_sortbench_median3_ ## tname(base, 0, h, n - 1);	\
+		}								\
+		stress_sortbench_swap_ ## tname(&base[0], &base[h]);		\
+		p = stress_sortbench_partition_ ## tname(base, n, &swapped);	\
+		l = p;								\
+		r = n - p - 1;							\
+										\
+		if ((l < n / 8) || (r < n / 8)) {				\
+			if (--bad_allowed == 0) {				\
+				stress_sortbench_heapsort_ ## tname(base, n);	\
+				return;						\
+			}							\
+			if (l >= SORTBENCH_INSERTION) {				\
+				stress_sortbench_swap_ ## tname(&base[0], &base[l / 4]); \
+				stress_sortbench_swap_ ## tname(&base[l - 1], &base[l - l / 4]); \
+			}							\
+			if (r >= SORTBENCH_INSERTION) {				\
+				stress_sortbench_swap_ ## tname(&base[p + 1], &base[p + 1 + r / 4]); \
+				stress_sortbench_swap_ ## tname(&base[n - 1], &base[n - r / 4]); \
+			}							\
+		} else if (!swapped) {						\
+			if (stress_sortbench_partial_insertion_ ## tname(base, l) && \
+			    stress_sortbench_partial_insertion_ ## tname(base + p + 1, r)) \
+				return;						\
+		}								\
+		/* recurse into the smaller side, loop on the larger */		\
+		if (l < r) {							\
+			stress_sortbench_pdqsort_r_ ## tname(base, l, bad_allowed); \
+			base += p + 1;						\
+			n = r;							\
+		} else {							\
+			stress_sortbench_pdqsort_r_ ## tname(base + p + 1, r, bad_allowed); \
+			n = l;							\
+		}								\
+	}									\
+	stress_sortbench_insertion_ ## tname(base, n);				\
+}										\
+										\
+static void stress_sortbench_pdqsort_ ## tname(void *base, void *tmp, const size_t n) \
+{										\
+	(void)tmp;								\
+										\
+	stress_sortbench_pdqsort_r_ ## tname((type *)base, n,			\
+		(size_t)stress_msb64((uint64_t)n | 1) + 1);			\
+}										\
+										\
+/*										\
+ *  stress_sortbench_mergesort_r()						\
+ *	top down stable merge sort, the left half is copied to			\
+ *	tmp and merged back into base						\
+ */										\
+static void stress_sortbench_mergesort_r_ ## tname(				\
+	type *base,								\
+	type *tmp,								\
+	const size_t n)								\
+{										\
+	const size_t mid = n / 2;						\
+	size_t i, j, k;								\
+										\
+	if (n <= SORTBENCH_INSERTION) {						\
+		stress_sortbench_insertion_ ## tname(base, n);			\
+		return;								\
+	}									\
+	stress_sortbench_mergesort_r_ ## tname(base, tmp, mid);			\
+	stress_sortbench_mergesort_r_ ## tname(base + mid, tmp + mid, n - mid);	\
+	/* halves already in order? */						\
+	if (!stress_sortbench_less_ ## tname(&base[mid], &base[mid - 1]))	\
+		return;								\
+										\
+	(void)memcpy(tmp, base, mid * sizeof(type));				\
+	for (i = 0, j = mid, k = 0; (i < mid) && (j < n); k++) {		\
+		if (stress_sortbench_less_ ## tname(&base[j], &tmp[i]))		\
+			base[k] = base[j++];					\
+		else								\
+			base[k] = tmp[i++];					\
+	}									\
+	while (i < mid)								\
+		base[k++] = tmp[i++];						\
+}										\
+										\
+static void stress_sortbench_mergesort_ ## tname(void *base, void *tmp, const size_t n) \
+{										\
+	stress_sortbench_mergesort_r_ ## tname((type *)base, (type *)tmp, n);	\
+}										\
+										\
+/*										\
+ *  stress_sortbench_merge()							\
+ *	merge sorted runs src[lo..mid) and src[mid..hi) into dst		\
+ */										\
+static void stress_sortbench_merge_ ## tname(					\
+	const void *vsrc,							\
+	void *vdst,								\
+	const size_t lo,							\
+	const size_t mid,							\
+	const size_t hi)							\
+{										\
+	const type *src = (const type *)vsrc;					\
+	type *dst = (type *)vdst;						\
+	size_t i = lo, j = mid, k = lo;						\
+										\
+	while ((i < mid) && (j < hi)) {						\
+		if (stress_sortbench_less_ ## tname(&src[j], &src[i]))		\
+			dst[k++] = src[j++];					\
+		else								\
+			dst[k++] = src[i++];					\
+	}									\
+	while (i < mid)								\
+		dst[k++] = src[i++];						\
+	while (j < hi)								\
+		dst[k++] = src[j++];						\
+}										\
+										\
+static void stress_sortbench_radix_hist_ ## tname(				\
+	const void *vsrc,							\
+	const size_t lo,							\
+	const size_t hi,							\
+	const size_t pass,							\
+	size_t *hist)								\
+{										\
+	const type *src = (const type *)vsrc;					\
+	size_t i;								\
+										\
+	for (i = lo; i < hi; i++)						\
+		hist[stress_sortbench_byte_ ## tname(&src[i], pass)]++;		\
+}										\
+										\
+static void stress_sortbench_radix_scatter_ ## tname(				\
+	const void *vsrc,							\
+	void *vdst,								\
+	const size_t lo,							\
+	const size_t hi,							\
+	const size_t pass,							\
+	size_t *offsets)							\
+{										\
+	const type *src = (const type *)vsrc;					\
+	type *dst = (type *)vdst;						\
+	size_t i;								\
+										\
+	for (i = lo; i < hi; i++)						\
+		dst[offsets[stress_sortbench_byte_ ## tname(&src[i], pass)]++] = src[i]; \
+}										\
+										\
+static void stress_sortbench_generate_ ## tname(void *vbase, const size_t n)	\
+{										\
+	type *base = (type *)vbase;						\
+	size_t i;								\
+										\
+	for (i = 0; i < n; i++)							\
+		stress_sortbench_rand_ ## tname(&base[i], i);			\
+}										\
+										\
+static bool stress_sortbench_sorted_ ## tname(const void *vbase, const size_t n) \
+{										\
+	const type *base = (const type *)vbase;					\
+	size_t i;								\
+										\
+	for (i = 1; i < n; i++) {						\
+		if (stress_sortbench_less_ ## tname(&base[i], &base[i - 1]))	\
+			return false;						\
+	}									\
+	return true;								\
+}
+
+STRESS_SORTBENCH_FUNCS(u32, uint32_t)
+STRESS_SORTBENCH_FUNCS(u64, uint64_t)
+STRESS_SORTBENCH_FUNCS(str, stress_sortbench_str_t)
+STRESS_SORTBENCH_FUNCS(kv, stress_sortbench_kv_t)
+
+#define STRESS_SORTBENCH_TYPE(tname, type, key_bytes)				\
+{										\
+	#tname, sizeof(type), key_bytes,					\
+	stress_sortbench_generate_ ## tname,					\
+	stress_sortbench_sorted_ ## tname,					\
+	{ stress_sortbench_mergesort_ ## tname, NULL,				\
+	  stress_sortbench_introsort_ ## tname, stress_sortbench_pdqsort_ ## tname }, \
+	stress_sortbench_merge_ ## tname,					\
+	stress_sortbench_radix_hist_ ## tname,					\
+	stress_sortbench_radix_scatter_ ## tname,				\
+}
+
+/* ordered as sortbench_data */
+static const stress_sortbench_type_t sortbench_types[] = {
+	STRESS_SORTBENCH_TYPE(u32, uint32_t, sizeof(uint32_t)),
+	STRESS_SORTBENCH_TYPE(u64, uint64_t, sizeof(uint64_t)),
+	STRESS_SORTBENCH_TYPE(str, stress_sortbench_str_t, SORTBENCH_STR_LEN),
+	STRESS_SORTBENCH_TYPE(kv, stress_sortbench_kv_t, sizeof(uint64_t)),
+};
+
+static stress_sortbench_thread_t sortbench_threads[MAX_SORTBENCH_THREADS];
+
+static void *stress_sortbench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_sortbench_thread_t *t = (stress_sortbench_thread_t *)arg;
+
+	t->func(t);
+	return &nowt;
+}
+
+/*
+ *  stress_sortbench_parallel()
+ *	run the func of the first n_threads threads in parallel,
+ *	the calling thread runs the first one, threads that cannot
+ *	be created are run by the calling thread afterwards
+ */
+static void stress_sortbench_parallel(const size_t n_threads)
+{
+	size_t i;
+
+	for (i = 1; i < n_threads; i++) {
+		stress_sortbench_thread_t *t = &sortbench_threads[i];
+
+		t->ret = pthread_create(&t->pthread, NULL, stress_sortbench_thread, (void *)t);
+	}
+	sortbench_threads[0].func(&sortbench_threads[0]);
+	for (i = 1; i < n_threads; i++) {
+		stress_sortbench_thread_t *t = &sortbench_threads[i];
+
+		if (t->ret == 0)
+			(void)pthread_join(t->pthread, NULL);
+		else
+			t->func(t);
+	}
+}
+
+static void stress_sortbench_chunk_sort(stress_sortbench_thread_t *t)
+{
+	const size_t size = t->type->size;
+
+	t->type->sort[t->method]((char *)t->src + (t->lo * size),
+		(char *)t->dst + (t->lo * size), t->hi - t->lo);
+}
+
+static void stress_sortbench_chunk_merge(stress_sortbench_thread_t *t)
+{
+	t->type->merge(t->src, t->dst, t->lo, t->mid, t->hi);
+}
+
+static void stress_sortbench_chunk_hist(stress_sortbench_thread_t *t)
+{
+	(void)memset(t->hist, 0, sizeof(t->hist));
+	t->type->radix_hist(t->src, t->lo, t->hi, t->pass, t->hist);
+}
+
+static void stress_sortbench_chunk_scatter(stress_sortbench_thread_t *t)
+{
+	t->type->radix_scatter(t->src, t->dst, t->lo, t->hi, t->pass, t->hist);
+}
+
+/*
+ *  stress_sortbench_comparison()
+ *	each thread sorts a chunk, the chunks are then merged in
+ *	pairs in parallel, halving the threads each round. Returns
+ *	the buffer holding the sorted data
+ */
+static void *stress_sortbench_comparison(
+	const stress_sortbench_type_t *type,
+	const size_t method,
+	void *base,
+	void *tmp,
+	const size_t n,
+	const size_t n_threads)
+{
+	size_t bounds[MAX_SORTBENCH_THREADS + 1];
+	size_t i, runs = n_threads;
+	void *src = base, *dst = tmp;
+
+	for (i = 0; i <= n_threads; i++)
+		bounds[i] = (n * i) / n_threads;
+	for (i = 0; i < n_threads; i++) {
+		stress_sortbench_thread_t *t = &sortbench_threads[i];
+
+		t->type = type;
+		t->method = method;
+		t->src = base;
+		t->dst = tmp;
+		t->lo = bounds[i];
+		t->hi = bounds[i + 1];
+		t->func = stress_sortbench_chunk_sort;
+	}
+	stress_sortbench_parallel(n_threads);
+
+	while (runs > 1) {
+		const size_t pairs = (runs + 1) / 2;
+		void *swap;
+
+		for (i = 0; i < pairs; i++) {
+			stress_sortbench_thread_t *t = &sortbench_threads[i];
+
+			t->src = src;
+			t->dst = dst;
+			t->lo = bounds[2 * i];
+			/* an odd run out is merged with nothing, a copy */
+			t->mid = bounds[STRESS_MINIMUM(2 * i + 1, runs)];
+			t->hi = bounds[STRESS_MINIMUM(2 * i + 2, runs)];
+			t->func = stress_sortbench_chunk_merge;
+		}
+		stress_sortbench_parallel(pairs);
+
+		for (i = 0; i < pairs; i++)
+			bounds[i] = bounds[2 * i];
+		bounds[pairs] = n;
+		runs = pairs;
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	return src;
+}
+
+/*
+ *  stress_sortbench_radix()
+ *	parallel LSD radix sort, each pass the threads histogram
+ *	their chunk of keys, the histograms are turned into per
+ *	thread offsets and the threads scatter their chunks. Passes
+ *	where every key has the same byte are skipped. Returns the
+ *	buffer holding the sorted data
+ */
+static void *stress_sortbench_radix(
+	const stress_sortbench_type_t *type,
+	void *base,
+	void *tmp,
+	const size_t n,
+	const size_t n_threads)
+{
+	size_t pass, i, b;
+	void *src = base, *dst = tmp;
+
+	for (pass = 0; pass < type->key_bytes; pass++) {
+		size_t sum = 0;
+		bool skip = false;
+		void *swap;
+
+		for (i = 0; i < n_threads; i++) {
+			stress_sortbench_thread_t *t = &sortbench_threads[i];
+
+			t->type = type;
+			t->src = src;
+			t->dst = dst;
+			t->lo = (n * i) / n_threads;
+			t->hi = (n * (i + 1)) / n_threads;
+			t->pass = pass;
+			t->func = stress_sortbench_chunk_hist;
+		}
+		stress_sortbench_parallel(n_threads);
+
+		for (b = 0; b < 256; b++) {
+			size_t count = 0;
+
+			for (i = 0; i < n_threads; i++) {
+				const size_t c = sortbench_threads[i].hist[b];
+
+				sortbench_threads[i].hist[b] = sum;
+				sum += c;
+				count += c;
+			}
+			if (count == n) {
+				skip = true;
+				break;
+			}
+		}
+		if (skip)
+			continue;
+
+		for (i = 0; i < n_threads; i++)
+			sortbench_threads[i].func = stress_sortbench_chunk_scatter;
+		stress_sortbench_parallel(n_threads);
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	return src;
+}
+
+/*
+ *  stress_sortbench_presort()
+ *	sort the data and then randomly swap pairs of elements
+ *	so that about presort percent of them stay in order
+ */
+static void stress_sortbench_presort(
+	const stress_sortbench_type_t *type,
+	void *base,
+	const size_t n,
+	const uint32_t presort)
+{
+	const size_t size = type->size;
+	const size_t swaps = (n * (100 - presort)) / 200;
+	size_t i;
+
+	type->sort[SORTBENCH_INTRO](base, NULL, n);
+	for (i = 0; i < swaps; i++) {
+		char tmp[SORTBENCH_ELEM_MAX];
+		char *a = (char *)base + ((stress_mwc64() % n) * size);
+		char *b = (char *)base + ((stress_mwc64() % n) * size);
+
+		(void)memcpy(tmp, a, size);
+		(void)memcpy(a, b, size);
+		(void)memcpy(b, tmp, size);
+	}
+}
+
+/*
+ *  stress_sortbench_report()
+ *	report the sort rate and the scaling efficiency compared
+ *	to a single thread, per method, data type and thread count
+ */
+static void stress_sortbench_report(
+	const stress_args_t *args,
+	stress_sortbench_stats_t stats[SORTBENCH_METHODS][SIZEOF_ARRAY(sortbench_types)][SORTBENCH_MAX_COUNTS],
+	const uint32_t *counts,
+	const size_t n_counts,
+	const bool verbose)
+{
+	const size_t last = n_counts - 1;
+	size_t m, d, c, idx = 0;
+
+	if (verbose)
+		pr_inf("%s: method data  threads    Melem/s  efficiency\n", args->name);
+
+	for (m = 0; m < SORTBENCH_METHODS; m++) {
+		double e1 = 0.0, d1 = 0.0, en = 0.0, dn = 0.0;
+		char desc[32];
+
+		for (d = 0; d < SIZEOF_ARRAY(sortbench_types); d++) {
+			const stress_sortbench_stats_t *s1 = &stats[m][d][0];
+			const double rate1 = (s1->duration > 0.0) ?
+				s1->elements / s1->duration : 0.0;
+
+			for (c = 0; c < n_counts; c++) {
+				const stress_sortbench_stats_t *s = &stats[m][d][c];
+				double rate, eff;
+
+				if (s->duration <= 0.0)
+					continue;
+				rate = s->elements / s->duration;
+				eff = (rate1 > 0.0) ?
+					100.0 * rate / (rate1 * (double)counts[c]) : 0.0;
+				if (verbose)
+					pr_inf("%s: %-6s %-5s %7" PRIu32 " %10.3f %10.1f%%\n",
+						args->name, sortbench_methods[m],
+						sortbench_types[d].name, counts[c],
+						rate / 1000000.0, eff);
+			}
+			e1 += s1->elements;
+			d1 += s1->duration;
+			en += stats[m][d][last].elements;
+			dn += stats[m][d][last].duration;
+		}
+		if ((dn <= 0.0) || (idx + 2 > STRESS_MISC_STATS_MAX))
+			continue;
+
+		(void)snprintf(desc, sizeof(desc), "%s Melem/s", sortbench_methods[m]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, (en / dn) / 1000000.0);
+		if (d1 > 0.0) {
+			(void)snprintf(desc, sizeof(desc), "%s %" PRIu32 " thread scaling %%",
+				sortbench_methods[m], counts[last]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				100.0 * (en / dn) / ((e1 / d1) * (double)counts[last]));
+		}
+	}
+}
+
+/*
+ *  stress_sortbench()
+ *	sort each data type with each method sweeping over
+ *	1, 2, 4 .. N threads
+ */
+static int stress_sortbench(const stress_args_t *args)
+{
+	static stress_sortbench_stats_t stats[SORTBENCH_METHODS][SIZEOF_ARRAY(sortbench_types)][SORTBENCH_MAX_COUNTS];
+	const int32_t cpus_online = stress_get_processors_online();
+	uint32_t sortbench_threads = (cpus_online > 1) ? (uint32_t)cpus_online : 1;
+	uint32_t sortbench_presort = 0;
+	uint64_t sortbench_size = DEFAULT_SORTBENCH_SIZE;
+	uint32_t counts[SORTBENCH_MAX_COUNTS], n;
+	size_t sortbench_method = 0, sortbench_data = 0;
+	size_t i, d, m, n_counts = 0, buf_size, elements;
+	char *data, *work, *tmp;
+	int ret = EXIT_SUCCESS;
+
+	(void)stress_get_setting("sortbench-method", &sortbench_method);
+	(void)stress_get_setting("sortbench-data", &sortbench_data);
+	(void)stress_get_setting("sortbench-presort", &sortbench_presort);
+	if (!stress_get_setting("sortbench-size", &sortbench_size)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			sortbench_size = MAX_SORTBENCH_SIZE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			sortbench_size = MIN_SORTBENCH_SIZE;
+	}
+	if (!stress_get_setting("sortbench-threads", &sortbench_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			sortbench_threads = MAX_SORTBENCH_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			sortbench_threads = MIN_SORTBENCH_THREADS;
+	}
+	if (sortbench_threads > MAX_SORTBENCH_THREADS)
+		sortbench_threads = MAX_SORTBENCH_THREADS;
+
+	/* 1, 2, 4 .. up to and including sortbench_threads */
+	for (n = 1; (n < sortbench_threads) && (n_counts < SORTBENCH_MAX_COUNTS - 1); n <<= 1)
+		counts[n_counts++] = n;
+	counts[n_counts++] = sortbench_threads;
+
+	elements = (size_t)sortbench_size;
+	buf_size = elements * SORTBENCH_ELEM_MAX;
+	data = (char *)mmap(NULL, buf_size * 3, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for %zu elements, skipping stressor\n",
+			args->name, buf_size * 3, elements);
+		return EXIT_NO_RESOURCE;
+	}
+	work = data + buf_size;
+	tmp = work + buf_size;
+
+	if (args->instance == 0)
+		pr_dbg("%s: sorting %zu elements, %" PRIu32 "%% presorted, up to %"
+			PRIu32 " threads\n", args->name, elements,
+			sortbench_presort, sortbench_threads);
+
+	(void)memset(stats, 0, sizeof(stats));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (d = 0; keep_stressing(args) && (d < SIZEOF_ARRAY(sortbench_types)); d++) {
+			const stress_sortbench_type_t *type = &sortbench_types[d];
+
+			if (sortbench_data && (sortbench_data != d + 1))
+				continue;
+
+			type->generate(data, elements);
+			if (sortbench_presort)
+				stress_sortbench_presort(type, data, elements, sortbench_presort);
+
+			for (m = 0; keep_stressing(args) && (m < SORTBENCH_METHODS); m++) {
+				if (sortbench_method && (sortbench_method != m + 1))
+					continue;
+
+				for (i = 0; keep_stressing(args) && (i < n_counts); i++) {
+					double t;
+					void *sorted;
+
+					(void)memcpy(work, data, elements * type->size);
+					t = stress_time_now();
+					if (m == SORTBENCH_RADIX)
+						sorted = stress_sortbench_radix(type, work, tmp,
+							elements, counts[i]);
+					else
+						sorted = stress_sortbench_comparison(type, m, work, tmp,
+							elements, counts[i]);
+					stats[m][d][i].duration += stress_time_now() - t;
+					stats[m][d][i].elements += (double)elements;
+
+					if ((g_opt_flags & OPT_FLAGS_VERIFY) &&
+					    !type->sorted(sorted, elements)) {
+						pr_fail("%s: %s sort of %s data with %" PRIu32
+							" threads is not sorted\n", args->name,
+							sortbench_methods[m], type->name, counts[i]);
+						ret = EXIT_FAILURE;
+					}
+					inc_counter(args);
+				}
+			}
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_sortbench_report(args, stats, counts, n_counts, args->instance == 0);
+
+	(void)munmap((void *)data, buf_size * 3);
+
+	return ret;
+}
+
+stressor_info_t stress_sortbench_info = {
+	.stressor = stress_sortbench,
+	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
+#else
+stressor_info_t stress_sortbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
+#endif
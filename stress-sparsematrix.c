@@ -17,6 +17,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arena.h"
 #include "core-pragma.h"
 
 #if defined(HAVE_SYS_TREE_H)
@@ -45,6 +46,10 @@
 #define MAX_SPARSEMATRIX_SIZE		(10000000)
 #define DEFAULT_SPARSEMATRIX_SIZE	(500)
 
+/* Number of SpMV threads, 0 = one per online CPU */
+#define MIN_SPARSEMATRIX_THREADS	(0)
+#define MAX_SPARSEMATRIX_THREADS	(1024)
+
 #if defined(CIRCLEQ_ENTRY) && 		\
     defined(CIRCLEQ_HEAD) &&		\
     defined(CIRCLEQ_INIT) &&		\
@@ -93,6 +98,9 @@ static const stress_help_t help[] = {
 	{ NULL,	"sparsematrix-method M", "select storage method: all, hash, judy, list or rb" },
 	{ NULL,	"sparsematrix-items N",	 "N is the number of items in the spare matrix" },
 	{ NULL,	"sparsematrix-size N",	 "M is the width and height X x Y of the matrix" },
+	{ NULL,	"sparsematrix-spmv F",	 "SpMV compute in format F: all, csr, csc, ell or bcsr" },
+	{ NULL,	"sparsematrix-threads N", "use N threads for SpMV, 0 = one per online CPU" },
+	{ NULL,	"sparsematrix-band N",	 "SpMV matrix half bandwidth, 0 = uniform random" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -172,6 +180,30 @@ typedef struct {
 	bool	skip_no_mem;	/* True if can't allocate memory */
 } test_info_t;
 
+static stress_arena_t *sparse_arena;	/* node arena, NULL for libc */
+
+/*
+ *  sparse_node_alloc()
+ *	allocate a zero'd matrix node
+ */
+static inline void *sparse_node_alloc(const size_t size)
+{
+	if (sparse_arena)
+		return stress_arena_calloc(sparse_arena, size);
+	return calloc(1, size);
+}
+
+/*
+ *  sparse_node_free()
+ *	free a matrix node, arena nodes are free'd in one
+ *	go when the matrix is destroyed
+ */
+static inline void sparse_node_free(void *ptr)
+{
+	if (!sparse_arena)
+		free(ptr);
+}
+
 /*
  *  stress_set_sparsematrix_items()
  *	set number of items to put into the sparse matrix
@@ -246,7 +278,7 @@ static void hash_destroy(void *handle, size_t *objmem)
 
 		while (node) {
 			next = node->next;
-			free(node);
+			sparse_node_free(node);
 			*objmem += sizeof(*node);
 			node = next;
 		}
@@ -284,7 +316,7 @@ static int hash_put(void *handle, const uint32_t x, const uint32_t y, const uint
 	}
 
 	/* Not found, allocate and add */
-	node = calloc(1, sizeof(*node));
+	node = sparse_node_alloc(sizeof(*node));
 	if (!node)
 		return -1;
 	node->value = value;
@@ -624,13 +656,13 @@ static int rb_put(void *handle, const uint32_t x, const uint32_t y, const uint64
 	if (!found) {
 		sparse_rb_t *new_node;
 
-		new_node = calloc(1, sizeof(*new_node));
+		new_node = sparse_node_alloc(sizeof(*new_node));
 		if (!new_node)
 			return -1;
 		new_node->value = value;
 		new_node->xy = node.xy;
 		if (RB_INSERT(sparse_rb_tree, handle, new_node) != NULL)
-			free(new_node);
+			sparse_node_free(new_node);
 		rb_objmem += sizeof(sparse_rb_t);
 	} else {
 		found->value = value;
@@ -652,7 +684,7 @@ static void rb_del(void *handle, const uint32_t x, const uint32_t y)
 		return;
 
 	RB_REMOVE(sparse_rb_tree, handle, found);
-	free(found);
+	sparse_node_free(found);
 }
 
 /*
@@ -710,11 +742,11 @@ static void list_destroy(void *handle, size_t *objmem)
 
 			CIRCLEQ_REMOVE(x_head, x_node, sparse_x_list);
 			*objmem += sizeof(*x_node);
-			free(x_node);
+			sparse_node_free(x_node);
 		}
 		CIRCLEQ_REMOVE(y_head, y_node, sparse_y_list);
 		*objmem += sizeof(*y_node);
-		free(y_node);
+		sparse_node_free(y_node);
 	}
 }
 
@@ -736,7 +768,7 @@ static int list_put(void *handle, const uint32_t x, const uint32_t y, const uint
 			goto find_x;
 		}
 		if (y_node->y > y) {
-			new_y_node = calloc(1, sizeof(*new_y_node));
+			new_y_node = sparse_node_alloc(sizeof(*new_y_node));
 			if (!new_y_node)
 				return -1;
 			new_y_node->y = y;
@@ -747,7 +779,7 @@ static int list_put(void *handle, const uint32_t x, const uint32_t y, const uint
 		}
 	}
 
-	new_y_node = calloc(1, sizeof(*new_y_node));
+	new_y_node = sparse_node_alloc(sizeof(*new_y_node));
 	if (!new_y_node)
 		return -1;
 	new_y_node->y = y;
@@ -762,7 +794,7 @@ find_x:
 			return 0;
 		}
 		if (x_node->x > x) {
-			new_x_node = calloc(1, sizeof(*new_x_node));
+			new_x_node = sparse_node_alloc(sizeof(*new_x_node));
 			if (!new_x_node)
 				return -1;  /* Leaves new_y_node allocated */
 			new_x_node->x = x;
@@ -771,7 +803,7 @@ find_x:
 			return 0;
 		}
 	}
-	new_x_node = calloc(1, sizeof(*new_x_node));
+	new_x_node = sparse_node_alloc(sizeof(*new_x_node));
 	if (!new_x_node)
 		return -1;  /* Leaves new_y_node allocated */
 	new_x_node->x = x;
@@ -931,6 +963,8 @@ static int stress_sparse_method_test(
 	}
 err:
 	info->destroy(handle, &objmem);
+	if (sparse_arena)
+		stress_arena_reset(sparse_arena);
 	if (objmem > test_info->max_objmem)
 		test_info->max_objmem = objmem;
 
@@ -1043,6 +1077,695 @@ static uint64_t mmap_get(void *handle, const uint32_t x, const uint32_t y)
 	return *((uint64_t *)(m->mmap) + offset);
 }
 
+/*
+ *  Sparse matrix vector multiply, y = A.x, over compressed
+ *  storage formats of a generated n x n matrix
+ */
+#define SPMV_FORMAT_CSR		(1)
+#define SPMV_FORMAT_CSC		(2)
+#define SPMV_FORMAT_ELL		(3)
+#define SPMV_FORMAT_BCSR	(4)
+
+#define SPMV_ITERS		(8)	/* SpMVs per thread per bogo op */
+#define SPMV_BLOCK		(4)	/* BCSR block is 4 x 4 */
+#define SPMV_BCSR_MAX_FILL	(8.0)	/* skip BCSR if blocks pad more than x8 */
+
+typedef struct {
+	uint32_t n;			/* rows and columns */
+	size_t	nnz;			/* non-zero values */
+	/* CSR */
+	uint32_t *row_ptr;		/* n + 1 row starts */
+	uint32_t *col;			/* column of each value */
+	double	*val;			/* values */
+	/* CSC */
+	uint32_t *col_ptr;		/* n + 1 column starts */
+	uint32_t *row;			/* row of each value */
+	double	*cval;			/* values in column order */
+	/* ELLPACK, n x width, padded with zero values */
+	uint32_t width;			/* max non-zeros in a row */
+	uint32_t *ell_col;		/* columns, row major */
+	double	*ell_val;		/* values, row major */
+	/* BCSR, 4 x 4 dense blocks */
+	uint32_t n_brows;		/* block rows */
+	size_t	n_blocks;		/* non-zero blocks */
+	uint32_t *brow_ptr;		/* n_brows + 1 block row starts */
+	uint32_t *bcol;			/* block column of each block */
+	double	*bval;			/* 16 values per block */
+	/* vectors */
+	double	*x;			/* input vector */
+	double	*y;			/* output vector */
+	double	*y_ref;			/* reference result */
+	double	*y_priv;		/* CSC per thread partial results */
+} stress_spmv_t;
+
+typedef struct {
+	stress_spmv_t *m;		/* matrix */
+	size_t	format;			/* SPMV_FORMAT_* */
+	uint32_t begin;			/* first row (column for CSC) */
+	uint32_t end;			/* last row + 1 */
+	double	*y;			/* output */
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;		/* thread handle */
+	int	ret;			/* pthread_create return */
+#endif
+} stress_spmv_part_t;
+
+typedef struct {
+	double	duration;		/* total time of SpMVs */
+	uint64_t spmvs;			/* SpMVs completed */
+	size_t	bytes;			/* bytes touched per SpMV */
+	bool	skipped;		/* format not usable */
+} stress_spmv_stats_t;
+
+static const char * const spmv_formats[] = {
+	"all",
+	"csr",
+	"csc",
+	"ell",
+	"bcsr",
+};
+
+#define SPMV_FORMATS	(SIZEOF_ARRAY(spmv_formats))
+
+/*
+ *  stress_spmv_csr()
+ *	y = A.x for rows begin..end-1, one dot product per row
+ */
+static void OPTIMIZE3 stress_spmv_csr(
+	const stress_spmv_t *m,
+	const uint32_t begin,
+	const uint32_t end,
+	double *restrict y)
+{
+	const uint32_t *restrict row_ptr = m->row_ptr;
+	const uint32_t *restrict col = m->col;
+	const double *restrict val = m->val;
+	const double *restrict x = m->x;
+	register uint32_t r;
+
+	for (r = begin; r < end; r++) {
+		register double sum = 0.0;
+		register uint32_t i;
+
+		for (i = row_ptr[r]; i < row_ptr[r + 1]; i++)
+			sum += val[i] * x[col[i]];
+		y[r] = sum;
+	}
+}
+
+/*
+ *  stress_spmv_csc()
+ *	y += A.x for columns begin..end-1, scatters into y so each
+ *	thread works on a private y that is summed afterwards
+ */
+static void OPTIMIZE3 stress_spmv_csc(
+	const stress_spmv_t *m,
+	const uint32_t begin,
+	const uint32_t end,
+	double *restrict y)
+{
+	const uint32_t *restrict col_ptr = m->col_ptr;
+	const uint32_t *restrict row = m->row;
+	const double *restrict cval = m->cval;
+	const double *restrict x = m->x;
+	register uint32_t c;
+
+	(void)memset(y, 0, sizeof(*y) * m->n);
+	for (c = begin; c < end; c++) {
+		const double xc = x[c];
+		register uint32_t i;
+
+		for (i = col_ptr[c]; i < col_ptr[c + 1]; i++)
+			y[row[i]] += cval[i] * xc;
+	}
+}
+
+/*
+ *  stress_spmv_ell()
+ *	y = A.x for rows begin..end-1, fixed width rows with
+ *	no row pointer indirection
+ */
+static void OPTIMIZE3 stress_spmv_ell(
+	const stress_spmv_t *m,
+	const uint32_t begin,
+	const uint32_t end,
+	double *restrict y)
+{
+	const size_t width = (size_t)m->width;
+	const uint32_t *restrict ell_col = m->ell_col;
+	const double *restrict ell_val = m->ell_val;
+	const double *restrict x = m->x;
+	register uint32_t r;
+
+	for (r = begin; r < end; r++) {
+		const size_t base = (size_t)r * width;
+		register double sum = 0.0;
+		register size_t i;
+
+		for (i = 0; i < width; i++)
+			sum += ell_val[base + i] * x[ell_col[base + i]];
+		y[r] = sum;
+	}
+}
+
+/*
+ *  stress_spmv_bcsr()
+ *	y = A.x for block rows begin..end-1, each block is a dense
+ *	4 x 4 multiply with one column index per 16 values
+ */
+static void OPTIMIZE3 stress_spmv_bcsr(
+	const stress_spmv_t *m,
+	const uint32_t begin,
+	const uint32_t end,
+	double *restrict y)
+{
+	const uint32_t *restrict brow_ptr = m->brow_ptr;
+	const uint32_t *restrict bcol = m->bcol;
+	const double *restrict bval = m->bval;
+	const double *restrict x = m->x;
+	const uint32_t n = m->n;
+	register uint32_t br;
+
+	for (br = begin; br < end; br++) {
+		double sum[SPMV_BLOCK] = { 0.0, 0.0, 0.0, 0.0 };
+		const uint32_t r0 = br * SPMV_BLOCK;
+		register uint32_t b, i;
+
+		for (b = brow_ptr[br]; b < brow_ptr[br + 1]; b++) {
+			const double *restrict blk = &bval[(size_t)b * SPMV_BLOCK * SPMV_BLOCK];
+			const uint32_t c0 = bcol[b] * SPMV_BLOCK;
+
+			/* x is padded to a whole number of blocks */
+			const double x0 = x[c0 + 0], x1 = x[c0 + 1];
+			const double x2 = x[c0 + 2], x3 = x[c0 + 3];
+
+			for (i = 0; i < SPMV_BLOCK; i++, blk += SPMV_BLOCK)
+				sum[i] += blk[0] * x0 + blk[1] * x1 + blk[2] * x2 + blk[3] * x3;
+		}
+		for (i = 0; (i < SPMV_BLOCK) && (r0 + i < n); i++)
+			y[r0 + i] = sum[i];
+	}
+}
+
+/*
+ *  stress_spmv_run()
+ *	run SPMV_ITERS SpMVs over one partition
+ */
+static void *stress_spmv_run(void *arg)
+{
+	const stress_spmv_part_t *p = (const stress_spmv_part_t *)arg;
+	int i;
+
+	for (i = 0; i < SPMV_ITERS; i++) {
+		switch (p->format) {
+		case SPMV_FORMAT_CSR:
+			stress_spmv_csr(p->m, p->begin, p->end, p->y);
+			break;
+		case SPMV_FORMAT_CSC:
+			stress_spmv_csc(p->m, p->begin, p->end, p->y);
+			break;
+		case SPMV_FORMAT_ELL:
+			stress_spmv_ell(p->m, p->begin, p->end, p->y);
+			break;
+		case SPMV_FORMAT_BCSR:
+			stress_spmv_bcsr(p->m, p->begin, p->end, p->y);
+			break;
+		default:
+			break;
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  stress_spmv_partition()
+ *	split the rows (block rows for BCSR, columns for CSC)
+ *	into n_threads ranges with about the same number of
+ *	non-zeros in each, ptr is the row start array
+ */
+static void stress_spmv_partition(
+	stress_spmv_part_t *parts,
+	const uint32_t n_threads,
+	const uint32_t *ptr,
+	const uint32_t n)
+{
+	const uint64_t total = ptr[n];
+	uint32_t t, r = 0;
+
+	for (t = 0; t < n_threads; t++) {
+		const uint64_t target = (total * (t + 1)) / n_threads;
+
+		parts[t].begin = r;
+		while ((r < n) && ((uint64_t)ptr[r] < target))
+			r++;
+		if (t == n_threads - 1)
+			r = n;
+		parts[t].end = r;
+	}
+}
+
+/*
+ *  stress_spmv_format()
+ *	do SPMV_ITERS SpMVs in a format on n_threads threads,
+ *	returns the time taken
+ */
+static double stress_spmv_format(
+	stress_spmv_t *m,
+	stress_spmv_part_t *parts,
+	const uint32_t n_threads,
+	const size_t format)
+{
+	double t_start;
+	uint32_t t;
+
+	switch (format) {
+	case SPMV_FORMAT_CSC:
+		stress_spmv_partition(parts, n_threads, m->col_ptr, m->n);
+		break;
+	case SPMV_FORMAT_BCSR:
+		stress_spmv_partition(parts, n_threads, m->brow_ptr, m->n_brows);
+		break;
+	default:
+		stress_spmv_partition(parts, n_threads, m->row_ptr, m->n);
+		break;
+	}
+	for (t = 0; t < n_threads; t++) {
+		parts[t].m = m;
+		parts[t].format = format;
+		parts[t].y = (format == SPMV_FORMAT_CSC) ?
+			&m->y_priv[(size_t)t * m->n] : m->y;
+	}
+
+	t_start = stress_time_now();
+#if defined(HAVE_LIB_PTHREAD)
+	for (t = 1; t < n_threads; t++)
+		parts[t].ret = pthread_create(&parts[t].pthread, NULL, stress_spmv_run, &parts[t]);
+	(void)stress_spmv_run(&parts[0]);
+	for (t = 1; t < n_threads; t++) {
+		/* run the partition here if the thread could not be created */
+		if (parts[t].ret)
+			(void)stress_spmv_run(&parts[t]);
+		else
+			(void)pthread_join(parts[t].pthread, NULL);
+	}
+#else
+	for (t = 0; t < n_threads; t++)
+		(void)stress_spmv_run(&parts[t]);
+#endif
+	/* sum the CSC partial results */
+	if (format == SPMV_FORMAT_CSC) {
+		uint32_t r;
+
+		for (r = 0; r < m->n; r++) {
+			double sum = 0.0;
+
+			for (t = 0; t < n_threads; t++)
+				sum += m->y_priv[((size_t)t * m->n) + r];
+			m->y[r] = sum;
+		}
+	}
+	return stress_time_now() - t_start;
+}
+
+/*
+ *  stress_spmv_free()
+ *	free the matrix
+ */
+static void stress_spmv_free(stress_spmv_t *m)
+{
+	free(m->row_ptr);
+	free(m->col);
+	free(m->val);
+	free(m->col_ptr);
+	free(m->row);
+	free(m->cval);
+	free(m->ell_col);
+	free(m->ell_val);
+	free(m->brow_ptr);
+	free(m->bcol);
+	free(m->bval);
+	free(m->x);
+	free(m->y);
+	free(m->y_ref);
+	free(m->y_priv);
+	(void)memset(m, 0, sizeof(*m));
+}
+
+/*
+ *  stress_spmv_cmp_u32()
+ *	sort column indexes
+ */
+static int stress_spmv_cmp_u32(const void *p1, const void *p2)
+{
+	const uint32_t v1 = *(const uint32_t *)p1;
+	const uint32_t v2 = *(const uint32_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_spmv_create()
+ *	generate an n x n matrix with about nnz non-zeros spread
+ *	evenly over the rows. With a band the columns of row r are
+ *	in r - band .. r + band, otherwise they are uniformly
+ *	random. Returns -1 if out of memory
+ */
+static int stress_spmv_create(
+	stress_spmv_t *m,
+	const uint32_t n,
+	const size_t nnz,
+	const uint32_t band,
+	const uint32_t n_threads,
+	const size_t format)
+{
+	const size_t per_row = nnz / n, extra = nnz % n;
+	const uint32_t n_pad = (n + SPMV_BLOCK - 1) & ~(uint32_t)(SPMV_BLOCK - 1);
+	uint32_t r, c, *rowbuf, *count;
+	size_t i, k;
+
+	(void)memset(m, 0, sizeof(*m));
+	m->n = n;
+	m->row_ptr = (uint32_t *)calloc((size_t)n + 1, sizeof(*m->row_ptr));
+	m->col = (uint32_t *)calloc(nnz, sizeof(*m->col));
+	m->val = (double *)calloc(nnz, sizeof(*m->val));
+	m->x = (double *)calloc(n_pad, sizeof(*m->x));
+	m->y = (double *)calloc(n_pad, sizeof(*m->y));
+	m->y_ref = (double *)calloc(n_pad, sizeof(*m->y_ref));
+	rowbuf = (uint32_t *)calloc(per_row + 1, sizeof(*rowbuf));
+	if (!m->row_ptr || !m->col || !m->val || !m->x || !m->y || !m->y_ref || !rowbuf)
+		goto err;
+
+	/* CSR, sorted unique columns in each row */
+	for (k = 0, r = 0; r < n; r++) {
+		const uint32_t lo = (band && (r > band)) ? r - band : 0;
+		const uint32_t hi = (band && ((uint64_t)r + band < n)) ? r + band : n - 1;
+		const uint32_t w = hi - lo + 1;
+		size_t want = per_row + (r < extra), got = 0;
+
+		if (want > w)
+			want = w;
+		for (i = 0; i < want; i++)
+			rowbuf[i] = lo + (stress_mwc32() % w);
+		qsort(rowbuf, want, sizeof(*rowbuf), stress_spmv_cmp_u32);
+		m->row_ptr[r] = (uint32_t)k;
+		for (i = 0; i < want; i++) {
+			if (got && (rowbuf[i] == m->col[k - 1]))
+				continue;
+			m->col[k] = rowbuf[i];
+			m->val[k] = 1.0 + (double)(stress_mwc8()) / 256.0;
+			k++;
+			got++;
+		}
+		if (got > m->width)
+			m->width = (uint32_t)got;
+	}
+	m->row_ptr[n] = (uint32_t)k;
+	m->nnz = k;
+	free(rowbuf);
+	rowbuf = NULL;
+
+	for (c = 0; c < n; c++)
+		m->x[c] = 1.0 / (double)(1 + (c % 17));
+	stress_spmv_csr(m, 0, n, m->y_ref);
+
+	/* CSC, transpose by counting the column populations */
+	if ((format == 0) || (format == SPMV_FORMAT_CSC)) {
+		m->col_ptr = (uint32_t *)calloc((size_t)n + 1, sizeof(*m->col_ptr));
+		m->row = (uint32_t *)calloc(m->nnz, sizeof(*m->row));
+		m->cval = (double *)calloc(m->nnz, sizeof(*m->cval));
+		m->y_priv = (double *)calloc((size_t)n * n_threads, sizeof(*m->y_priv));
+		count = (uint32_t *)calloc((size_t)n + 1, sizeof(*count));
+		if (!m->col_ptr || !m->row || !m->cval || !m->y_priv || !count) {
+			free(count);
+			goto err;
+		}
+		for (i = 0; i < m->nnz; i++)
+			m->col_ptr[m->col[i] + 1]++;
+		for (c = 0; c < n; c++)
+			m->col_ptr[c + 1] += m->col_ptr[c];
+		for (r = 0; r < n; r++) {
+			for (i = m->row_ptr[r]; i < m->row_ptr[r + 1]; i++) {
+				const size_t j = m->col_ptr[m->col[i]] + count[m->col[i]]++;
+
+				m->row[j] = r;
+				m->cval[j] = m->val[i];
+			}
+		}
+		free(count);
+	}
+
+	/* ELLPACK, pad short rows with zero values at the row's own column */
+	if ((format == 0) || (format == SPMV_FORMAT_ELL)) {
+		const size_t sz = (size_t)n * m->width;
+
+		m->ell_col = (uint32_t *)calloc(sz ? sz : 1, sizeof(*m->ell_col));
+		m->ell_val = (double *)calloc(sz ? sz : 1, sizeof(*m->ell_val));
+		if (!m->ell_col || !m->ell_val)
+			goto err;
+		for (r = 0; r < n; r++) {
+			const size_t base = (size_t)r * m->width;
+
+			for (k = 0, i = m->row_ptr[r]; i < m->row_ptr[r + 1]; i++, k++) {
+				m->ell_col[base + k] = m->col[i];
+				m->ell_val[base + k] = m->val[i];
+			}
+			for (; k < m->width; k++)
+				m->ell_col[base + k] = r;
+		}
+	}
+
+	/* BCSR, count the distinct block columns in each block row */
+	if ((format == 0) || (format == SPMV_FORMAT_BCSR)) {
+		uint32_t br, *last;
+
+		m->n_brows = n_pad / SPMV_BLOCK;
+		m->brow_ptr = (uint32_t *)calloc((size_t)m->n_brows + 1, sizeof(*m->brow_ptr));
+		last = (uint32_t *)malloc(sizeof(*last) * m->n_brows);
+		if (!m->brow_ptr || !last) {
+			free(last);
+			goto err;
+		}
+		(void)memset(last, 0xff, sizeof(*last) * m->n_brows);
+		for (br = 0; br < m->n_brows; br++) {
+			size_t blocks = 0;
+
+			for (r = br * SPMV_BLOCK; (r < (br + 1) * SPMV_BLOCK) && (r < n); r++) {
+				for (i = m->row_ptr[r]; i < m->row_ptr[r + 1]; i++) {
+					const uint32_t bc = m->col[i] / SPMV_BLOCK;
+
+					/* mark block columns seen in this block row */
+					if (last[bc] != br) {
+						last[bc] = br;
+						blocks++;
+					}
+				}
+			}
+			m->brow_ptr[br + 1] = m->brow_ptr[br] + (uint32_t)blocks;
+		}
+		m->n_blocks = m->brow_ptr[m->n_brows];
+		if ((double)m->n_blocks * SPMV_BLOCK * SPMV_BLOCK >
+		    SPMV_BCSR_MAX_FILL * (double)(m->nnz ? m->nnz : 1)) {
+			/* too sparse within blocks, leave BCSR out */
+			free(last);
+			free(m->brow_ptr);
+			m->brow_ptr = NULL;
+		} else {
+			m->bcol = (uint32_t *)calloc(m->n_blocks ? m->n_blocks : 1, sizeof(*m->bcol));
+			m->bval = (double *)calloc((m->n_blocks ? m->n_blocks : 1) * SPMV_BLOCK * SPMV_BLOCK,
+				sizeof(*m->bval));
+			if (!m->bcol || !m->bval) {
+				free(last);
+				goto err;
+			}
+			(void)memset(last, 0xff, sizeof(*last) * m->n_brows);
+			for (br = 0; br < m->n_brows; br++) {
+				uint32_t nb = m->brow_ptr[br];
+
+				for (r = br * SPMV_BLOCK; (r < (br + 1) * SPMV_BLOCK) && (r < n); r++) {
+					for (i = m->row_ptr[r]; i < m->row_ptr[r + 1]; i++) {
+						const uint32_t bc = m->col[i] / SPMV_BLOCK;
+						uint32_t b;
+
+						/* last[] maps the block column to its block */
+						if ((last[bc] < m->brow_ptr[br]) || (last[bc] >= nb) ||
+						    (m->bcol[last[bc]] != bc)) {
+							last[bc] = nb;
+							m->bcol[nb++] = bc;
+						}
+						b = last[bc];
+						m->bval[((size_t)b * SPMV_BLOCK * SPMV_BLOCK) +
+							((r % SPMV_BLOCK) * SPMV_BLOCK) + (m->col[i] % SPMV_BLOCK)] = m->val[i];
+					}
+				}
+			}
+			free(last);
+		}
+	}
+	return 0;
+err:
+	free(rowbuf);
+	stress_spmv_free(m);
+	return -1;
+}
+
+/*
+ *  stress_spmv_bytes()
+ *	minimum bytes moved by one SpMV in a format, the matrix
+ *	storage plus reading x and writing y once
+ */
+static size_t stress_spmv_bytes(const stress_spmv_t *m, const size_t format)
+{
+	const size_t vectors = (size_t)m->n * 2 * sizeof(double);
+
+	switch (format) {
+	case SPMV_FORMAT_CSR:
+		return vectors + (m->nnz * (sizeof(uint32_t) + sizeof(double))) +
+			(((size_t)m->n + 1) * sizeof(uint32_t));
+	case SPMV_FORMAT_CSC:
+		return vectors + (m->nnz * (sizeof(uint32_t) + sizeof(double))) +
+			(((size_t)m->n + 1) * sizeof(uint32_t));
+	case SPMV_FORMAT_ELL:
+		return vectors + ((size_t)m->n * m->width * (sizeof(uint32_t) + sizeof(double)));
+	case SPMV_FORMAT_BCSR:
+		return vectors + (m->n_blocks * (sizeof(uint32_t) +
+			(SPMV_BLOCK * SPMV_BLOCK * sizeof(double)))) +
+			(((size_t)m->n_brows + 1) * sizeof(uint32_t));
+	default:
+		return 0;
+	}
+}
+
+/*
+ *  stress_spmv_check()
+ *	compare y with the single threaded CSR reference
+ */
+static bool stress_spmv_check(const stress_spmv_t *m)
+{
+	uint32_t r;
+
+	for (r = 0; r < m->n; r++) {
+		const double diff = fabs(m->y[r] - m->y_ref[r]);
+
+		if (diff > 1.0E-9 * (fabs(m->y_ref[r]) + 1.0))
+			return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_sparsematrix_spmv()
+ *	sparse matrix vector multiply in CSR, CSC, ELLPACK and
+ *	4 x 4 blocked CSR formats on row partitioned threads,
+ *	reporting GFLOP/s and effective memory bandwidth
+ */
+static int stress_sparsematrix_spmv(
+	const stress_args_t *args,
+	const uint32_t n,
+	const size_t nnz,
+	const size_t format,
+	const uint32_t band,
+	uint32_t n_threads)
+{
+	stress_spmv_t m;
+	stress_spmv_part_t *parts;
+	stress_spmv_stats_t stats[SPMV_FORMATS];
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t f, first, last, idx = 0;
+	int rc = EXIT_SUCCESS;
+	bool lock = false;
+
+	if (n_threads == 0) {
+		const int32_t cpus = stress_get_processors_online();
+
+		n_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+	}
+#if !defined(HAVE_LIB_PTHREAD)
+	n_threads = 1;
+#endif
+	if (format == 0) {
+		first = 1;
+		last = SPMV_FORMATS - 1;
+	} else {
+		first = format;
+		last = format;
+	}
+
+	(void)memset(stats, 0, sizeof(stats));
+	parts = (stress_spmv_part_t *)calloc(n_threads, sizeof(*parts));
+	if (!parts || (stress_spmv_create(&m, n, nnz, band, n_threads, format) < 0)) {
+		pr_inf_skip("%s: out of memory creating %" PRIu32 " x %" PRIu32
+			" sparse matrix, skipping stressor\n", args->name, n, n);
+		free(parts);
+		return EXIT_NO_RESOURCE;
+	}
+	if (args->instance == 0) {
+		pr_inf("%s: SpMV %" PRIu32 " x %" PRIu32 ", %zu non-zeros, %s, %" PRIu32 " thread%s\n",
+			args->name, n, n, m.nnz, band ? "banded" : "uniform random",
+			n_threads, n_threads > 1 ? "s" : "");
+	}
+	for (f = first; f <= last; f++) {
+		stats[f].bytes = stress_spmv_bytes(&m, f);
+		if ((f == SPMV_FORMAT_BCSR) && !m.brow_ptr) {
+			stats[f].skipped = true;
+			if (args->instance == 0)
+				pr_inf("%s: bcsr skipped, the 4 x 4 blocks would be more than "
+					"%.0f times the non-zeros\n", args->name, SPMV_BCSR_MAX_FILL);
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (f = first; (f <= last) && keep_stressing_flag(); f++) {
+			if (stats[f].skipped)
+				continue;
+			(void)memset(m.y, 0, sizeof(*m.y) * m.n);
+			stats[f].duration += stress_spmv_format(&m, parts, n_threads, f);
+			stats[f].spmvs += SPMV_ITERS;
+			if (verify && !stress_spmv_check(&m)) {
+				pr_fail("%s: %s SpMV result does not match the CSR reference\n",
+					args->name, spmv_formats[f]);
+				rc = EXIT_FAILURE;
+			}
+		}
+		inc_counter(args);
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_lock(&lock);
+	if (args->instance == 0)
+		pr_inf_lock(&lock, "%s: %-6s %10s %10s %12s\n", args->name,
+			"format", "GFLOP/s", "GB/s", "storage MB");
+	for (f = first; f <= last; f++) {
+		const stress_spmv_stats_t *st = &stats[f];
+		double gflops, gbs;
+		char desc[32];
+
+		if (st->skipped || (st->duration <= 0.0))
+			continue;
+		/* 2 flops per stored non-zero, padding is not useful work */
+		gflops = (2.0 * (double)m.nnz * (double)st->spmvs) / st->duration / 1.0E9;
+		gbs = ((double)st->bytes * (double)st->spmvs) / st->duration / 1.0E9;
+		if (args->instance == 0)
+			pr_inf_lock(&lock, "%s: %-6s %10.3f %10.3f %12.2f\n", args->name,
+				spmv_formats[f], gflops, gbs,
+				(double)(st->bytes - ((size_t)m.n * 2 * sizeof(double))) / (double)MB);
+		(void)snprintf(desc, sizeof(desc), "%s GFLOP/s", spmv_formats[f]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, gflops);
+		(void)snprintf(desc, sizeof(desc), "%s GB/s", spmv_formats[f]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, gbs);
+	}
+	if (args->instance == 0)
+		pr_unlock(&lock);
+
+	stress_spmv_free(&m);
+	free(parts);
+
+	return rc;
+}
+
 /*
  * Table of sparse matrix stress methods
  */
@@ -1087,10 +1810,63 @@ static int stress_set_sparsematrix_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_sparsematrix_spmv()
+ *	select SpMV storage format(s) rather than the storage methods
+ */
+static int stress_set_sparsematrix_spmv(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SPMV_FORMATS; i++) {
+		if (!strcmp(spmv_formats[i], name))
+			return stress_set_setting("sparsematrix-spmv", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "sparsematrix-spmv must be one of:");
+	for (i = 0; i < SPMV_FORMATS; i++) {
+		(void)fprintf(stderr, " %s", spmv_formats[i]);
+	}
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_set_sparsematrix_threads()
+ *	set number of SpMV threads, 0 = one per online CPU
+ */
+static int stress_set_sparsematrix_threads(const char *opt)
+{
+	uint32_t sparsematrix_threads;
+
+	sparsematrix_threads = stress_get_uint32(opt);
+	stress_check_range("sparsematrix-threads", sparsematrix_threads,
+		MIN_SPARSEMATRIX_THREADS, MAX_SPARSEMATRIX_THREADS);
+	return stress_set_setting("sparsematrix-threads", TYPE_ID_UINT32, &sparsematrix_threads);
+}
+
+/*
+ *  stress_set_sparsematrix_band()
+ *	set SpMV matrix half bandwidth, 0 = uniform random columns
+ */
+static int stress_set_sparsematrix_band(const char *opt)
+{
+	uint32_t sparsematrix_band;
+
+	sparsematrix_band = stress_get_uint32(opt);
+	stress_check_range("sparsematrix-band", sparsematrix_band,
+		0, MAX_SPARSEMATRIX_SIZE);
+	return stress_set_setting("sparsematrix-band", TYPE_ID_UINT32, &sparsematrix_band);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_sparsematrix_items,	stress_set_sparsematrix_items },
 	{ OPT_sparsematrix_method,	stress_set_sparsematrix_method },
 	{ OPT_sparsematrix_size,	stress_set_sparsematrix_size },
+	{ OPT_sparsematrix_spmv,	stress_set_sparsematrix_spmv },
+	{ OPT_sparsematrix_threads,	stress_set_sparsematrix_threads },
+	{ OPT_sparsematrix_band,	stress_set_sparsematrix_band },
 	{ 0,				NULL }
 };
 
@@ -1114,7 +1890,10 @@ static int stress_sparsematrix(const stress_args_t *args)
 	test_info_t test_info[SIZEOF_ARRAY(sparsematrix_methods)];
 	size_t i, begin, end;
 	size_t method = 0;	/* All methods */
+	size_t spmv = 0;
+	uint32_t sparsematrix_threads = 0, sparsematrix_band = 0;
 	bool lock = false;
+	stress_arena_t arena;
 
 	for (i = 0; i < SIZEOF_ARRAY(test_info); i++) {
 		test_info[i].skip_no_mem = false;
@@ -1141,7 +1920,7 @@ static int stress_sparsematrix(const stress_args_t *args)
 			sparsematrix_items= MIN_SPARSEMATRIX_ITEMS;
 	}
 
-	capacity = sparsematrix_size * sparsematrix_size;
+	capacity = (uint64_t)sparsematrix_size * sparsematrix_size;
 
 	if (sparsematrix_items > capacity) {
 		uint64_t new_items = capacity;
@@ -1152,6 +1931,14 @@ static int stress_sparsematrix(const stress_args_t *args)
 		}
 		sparsematrix_items = new_items;
 	}
+	if (stress_get_setting("sparsematrix-spmv", &spmv)) {
+		(void)stress_get_setting("sparsematrix-threads", &sparsematrix_threads);
+		(void)stress_get_setting("sparsematrix-band", &sparsematrix_band);
+		return stress_sparsematrix_spmv(args, sparsematrix_size,
+			(size_t)sparsematrix_items, spmv, sparsematrix_band,
+			sparsematrix_threads);
+	}
+
 	percent_full = 100.0 * (double)sparsematrix_items / (double)capacity;
 	if (args->instance == 0) {
 		pr_inf("%s: %" PRIu64 " items in %" PRIu32 " x %" PRIu32 " sparse matrix (%.2f%% full)\n",
@@ -1160,6 +1947,9 @@ static int stress_sparsematrix(const stress_args_t *args)
 			percent_full);
 	}
 
+	stress_arena_init(&arena, 0);
+	sparse_arena = stress_node_arena() ? &arena : NULL;
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -1224,6 +2014,8 @@ static int stress_sparsematrix(const stress_args_t *args)
 	rc = EXIT_SUCCESS;
 err:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	sparse_arena = NULL;
+	stress_arena_destroy(&arena);
 
 	return rc;
 }
@@ -0,0 +1,527 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+
+#if defined(HAVE_SPAWN_H)
+#include <spawn.h>
+#endif
+
+#define SPAWNBENCH_MAX_SIZES	(8)
+#define SPAWNBENCH_STEP		(0.2)		/* seconds per method, size and memory */
+#define SPAWNBENCH_STACK_SIZE	(64 * KB)	/* clone child stack */
+#define SPAWNBENCH_DEFAULT_RSS	"1M,100M,10G"
+
+static const stress_help_t help[] = {
+	{ NULL,	"spawnbench N",		"start N workers comparing process creation mechanisms" },
+	{ NULL,	"spawnbench-method M",	"spawn method M, default is all" },
+	{ NULL,	"spawnbench-ops N",	"stop after N spawns" },
+	{ NULL,	"spawnbench-rss L",	"comma separated list of parent RSS sizes, default " SPAWNBENCH_DEFAULT_RSS },
+	{ NULL,	NULL,			NULL }
+};
+
+/* method names, the implementations are in the same order */
+static const char * const spawnbench_methods[] = {
+	"all",
+	"fork",
+	"vfork",
+	"clone",
+	"posix_spawn",
+};
+
+/* parent memory state for each size */
+static const char * const spawnbench_memory[] = {
+	"untouched",
+	"touched",
+	"touched-thp",
+};
+
+#define SPAWNBENCH_METHODS	(SIZEOF_ARRAY(spawnbench_methods) - 1)
+#define SPAWNBENCH_MEMORY	(SIZEOF_ARRAY(spawnbench_memory))
+
+/*
+ *  stress_spawnbench_parse_rss()
+ *	parse a comma separated list of sizes, returns the number
+ *	of sizes or -1 if the list is invalid
+ */
+static int stress_spawnbench_parse_rss(const char *opt, uint64_t *sizes)
+{
+	char *str, *ptr, *token;
+	int n = 0;
+
+	str = stress_const_optdup(opt);
+	if (!str)
+		return -1;
+	for (ptr = str; (token = strtok(ptr, ",")) != NULL; ptr = NULL) {
+		if (n >= SPAWNBENCH_MAX_SIZES) {
+			(void)fprintf(stderr, "spawnbench-rss allows up to %d sizes\n",
+				SPAWNBENCH_MAX_SIZES);
+			free(str);
+			return -1;
+		}
+		sizes[n] = stress_get_uint64_byte(token);
+		if (sizes[n] == 0) {
+			(void)fprintf(stderr, "spawnbench-rss sizes must be non-zero\n");
+			free(str);
+			return -1;
+		}
+		n++;
+	}
+	free(str);
+
+	if (n == 0) {
+		(void)fprintf(stderr, "spawnbench-rss needs at least one size\n");
+		return -1;
+	}
+	return n;
+}
+
+static int stress_set_spawnbench_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(spawnbench_methods); i++) {
+		if (!strcmp(opt, spawnbench_methods[i]))
+			return stress_set_setting("spawnbench-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "spawnbench-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(spawnbench_methods); i++)
+		(void)fprintf(stderr, " %s", spawnbench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_spawnbench_rss(const char *opt)
+{
+	uint64_t sizes[SPAWNBENCH_MAX_SIZES];
+
+	if (stress_spawnbench_parse_rss(opt, sizes) < 0)
+		return -1;
+	return stress_set_setting("spawnbench-rss", TYPE_ID_STR, opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_spawnbench_method,	stress_set_spawnbench_method },
+	{ OPT_spawnbench_rss,		stress_set_spawnbench_rss },
+	{ 0,				NULL }
+};
+
+typedef struct {
+	char path[PATH_MAX + 1];	/* stress-ng executable for posix_spawn */
+	char *stack;			/* clone child stack */
+} stress_spawnbench_ctxt_t;
+
+typedef struct {
+	bool (*available)(const stress_args_t *args, stress_spawnbench_ctxt_t *ctxt);
+	pid_t (*spawn)(stress_spawnbench_ctxt_t *ctxt);
+} stress_spawnbench_impl_t;
+
+/* totals per method, parent RSS size and parent memory state */
+typedef struct {
+	uint64_t spawns;
+	uint64_t failed;
+	double duration;		/* total spawn to exit time */
+	double max;			/* slowest spawn to exit */
+} stress_spawnbench_stats_t;
+
+static bool stress_spawnbench_always(const stress_args_t *args, stress_spawnbench_ctxt_t *ctxt)
+{
+	(void)args;
+	(void)ctxt;
+
+	return true;
+}
+
+static pid_t stress_spawnbench_fork(stress_spawnbench_ctxt_t *ctxt)
+{
+	pid_t pid;
+
+	(void)ctxt;
+	pid = fork();
+	if (pid == 0)
+		_exit(0);
+	return pid;
+}
+
+static pid_t stress_spawnbench_vfork(stress_spawnbench_ctxt_t *ctxt)
+{
+	pid_t pid;
+
+	(void)ctxt;
+	pid = shim_vfork();
+	if (pid == 0)
+		_exit(0);
+	return pid;
+}
+
+#if defined(HAVE_CLONE) &&	\
+    defined(CLONE_VM) &&	\
+    defined(__linux__)
+static int stress_spawnbench_clone_func(void *arg)
+{
+	(void)arg;
+
+	return 0;
+}
+
+static bool stress_spawnbench_clone_available(const stress_args_t *args, stress_spawnbench_ctxt_t *ctxt)
+{
+	(void)args;
+
+	return ctxt->stack != NULL;
+}
+
+/*
+ *  stress_spawnbench_clone()
+ *	clone a child that shares the parent address space
+ */
+static pid_t stress_spawnbench_clone(stress_spawnbench_ctxt_t *ctxt)
+{
+	char *stack_top = (char *)stress_get_stack_top((void *)ctxt->stack, SPAWNBENCH_STACK_SIZE);
+
+	return clone(stress_spawnbench_clone_func, stress_align_stack(stack_top),
+		CLONE_VM | SIGCHLD, NULL);
+}
+#else
+static bool stress_spawnbench_clone_available(const stress_args_t *args, stress_spawnbench_ctxt_t *ctxt)
+{
+	(void)args;
+	(void)ctxt;
+
+	return false;
+}
+
+static pid_t stress_spawnbench_clone(stress_spawnbench_ctxt_t *ctxt)
+{
+	(void)ctxt;
+
+	errno = ENOSYS;
+	return -1;
+}
+#endif
+
+#if defined(HAVE_SPAWN_H) &&	\
+    defined(HAVE_POSIX_SPAWN)
+/*
+ *  stress_spawnbench_posix_spawn_available()
+ *	posix_spawn execs stress-ng --exec-exit, like the spawn
+ *	stressor this is not run as root
+ */
+static bool stress_spawnbench_posix_spawn_available(const stress_args_t *args, stress_spawnbench_ctxt_t *ctxt)
+{
+	ssize_t len;
+
+	if (geteuid() == 0) {
+		if (args->instance == 0)
+			pr_inf("%s: posix_spawn method must not run as root, skipping it\n",
+				args->name);
+		return false;
+	}
+	len = shim_readlink("/proc/self/exe", ctxt->path, sizeof(ctxt->path));
+	if ((len < 0) || (len > PATH_MAX)) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot determine stress-ng executable name, "
+				"skipping posix_spawn method\n", args->name);
+		return false;
+	}
+	ctxt->path[len] = '\0';
+	return true;
+}
+
+static pid_t stress_spawnbench_posix_spawn(stress_spawnbench_ctxt_t *ctxt)
+{
+	static char *env_new[] = { NULL };
+	char *argv_new[] = { ctxt->path, "--exec-exit", NULL };
+	pid_t pid;
+	int ret;
+
+	ret = posix_spawn(&pid, ctxt->path, NULL, NULL, argv_new, env_new);
+	if (ret) {
+		errno = ret;
+		return -1;
+	}
+	return pid;
+}
+#else
+static bool stress_spawnbench_posix_spawn_available(const stress_args_t *args, stress_spawnbench_ctxt_t *ctxt)
+{
+	(void)args;
+	(void)ctxt;
+
+	return false;
+}
+
+static pid_t stress_spawnbench_posix_spawn(stress_spawnbench_ctxt_t *ctxt)
+{
+	(void)ctxt;
+
+	errno = ENOSYS;
+	return -1;
+}
+#endif
+
+/* implementations, in spawnbench_methods order after "all" */
+static const stress_spawnbench_impl_t spawnbench_impls[] = {
+	{ stress_spawnbench_always,			stress_spawnbench_fork },
+	{ stress_spawnbench_always,			stress_spawnbench_vfork },
+	{ stress_spawnbench_clone_available,		stress_spawnbench_clone },
+	{ stress_spawnbench_posix_spawn_available,	stress_spawnbench_posix_spawn },
+};
+
+/*
+ *  stress_spawnbench_step()
+ *	spawn and reap children with one method for SPAWNBENCH_STEP
+ *	seconds, timing each from the spawn call to the child being reaped
+ */
+static int stress_spawnbench_step(
+	const stress_args_t *args,
+	stress_spawnbench_ctxt_t *ctxt,
+	const size_t method,
+	stress_spawnbench_stats_t *stats)
+{
+	const double t_end = stress_time_now() + SPAWNBENCH_STEP;
+
+	do {
+		const double t = stress_time_now();
+		double duration;
+		pid_t pid;
+		int status;
+
+		pid = spawnbench_impls[method].spawn(ctxt);
+		if (pid < 0) {
+			if (stress_redo_fork(errno))
+				continue;
+			if (!keep_stressing(args))
+				break;
+			pr_fail("%s: %s failed, errno=%d (%s)\n",
+				args->name, spawnbench_methods[method + 1],
+				errno, strerror(errno));
+			return -1;
+		}
+		if (shim_waitpid(pid, &status, 0) < 0) {
+			(void)kill(pid, SIGKILL);
+			(void)shim_waitpid(pid, &status, 0);
+			stats->failed++;
+			continue;
+		}
+		duration = stress_time_now() - t;
+
+		if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+			stats->failed++;
+			continue;
+		}
+		stats->spawns++;
+		stats->duration += duration;
+		if (stats->max < duration)
+			stats->max = duration;
+		inc_counter(args);
+	} while (keep_stressing(args) && (stress_time_now() < t_end));
+
+	return 0;
+}
+
+/*
+ *  stress_spawnbench_memory()
+ *	map size bytes for the parent, touched states fault in every page
+ *	with transparent huge pages disabled or enabled, returns NULL if
+ *	the memory state cannot be set up
+ */
+static void *stress_spawnbench_memory(
+	const stress_args_t *args,
+	const uint64_t size,
+	const size_t memory)
+{
+	const size_t page_size = args->page_size;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	uint8_t *buf, *ptr;
+	int advice;
+
+#if defined(MAP_NORESERVE)
+	if (memory == 0)
+		flags |= MAP_NORESERVE;
+#endif
+	buf = (uint8_t *)mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (buf == MAP_FAILED)
+		return NULL;
+	if (memory == 0)
+		return (void *)buf;
+
+	if (memory == 1) {
+#if defined(MADV_NOHUGEPAGE)
+		advice = MADV_NOHUGEPAGE;
+#else
+		advice = -1;
+#endif
+	} else {
+#if defined(MADV_HUGEPAGE)
+		advice = MADV_HUGEPAGE;
+#else
+		advice = -1;
+#endif
+	}
+	if (advice != -1) {
+		if ((shim_madvise((void *)buf, (size_t)size, advice) < 0) && (memory == 2)) {
+			(void)munmap((void *)buf, (size_t)size);
+			return NULL;
+		}
+	} else if (memory == 2) {
+		(void)munmap((void *)buf, (size_t)size);
+		return NULL;
+	}
+
+	for (ptr = buf; ptr < buf + size; ptr += page_size) {
+		*ptr = 1;
+		if (!keep_stressing_flag())
+			break;
+	}
+	return (void *)buf;
+}
+
+/*
+ *  stress_spawnbench()
+ *	compare process creation mechanisms as the parent RSS grows
+ */
+static int stress_spawnbench(const stress_args_t *args)
+{
+	static stress_spawnbench_stats_t stats[SPAWNBENCH_METHODS][SPAWNBENCH_MAX_SIZES][SPAWNBENCH_MEMORY];
+	stress_spawnbench_ctxt_t ctxt;
+	uint64_t sizes[SPAWNBENCH_MAX_SIZES];
+	bool available[SPAWNBENCH_METHODS], skipped[SPAWNBENCH_MAX_SIZES][SPAWNBENCH_MEMORY];
+	char *spawnbench_rss = SPAWNBENCH_DEFAULT_RSS;
+	size_t spawnbench_method = 0, i, j, k, idx = 0;
+	size_t shmall, freemem, totalmem, freeswap;
+	int n_sizes, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("spawnbench-method", &spawnbench_method);
+	(void)stress_get_setting("spawnbench-rss", &spawnbench_rss);
+	n_sizes = stress_spawnbench_parse_rss(spawnbench_rss, sizes);
+	if (n_sizes < 0)
+		return EXIT_FAILURE;
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap);
+
+	(void)memset(&ctxt, 0, sizeof(ctxt));
+	ctxt.stack = (char *)mmap(NULL, SPAWNBENCH_STACK_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ctxt.stack == MAP_FAILED)
+		ctxt.stack = NULL;
+
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(skipped, 0, sizeof(skipped));
+	for (i = 0; i < SPAWNBENCH_METHODS; i++) {
+		available[i] = (spawnbench_method == 0) || (spawnbench_method == i + 1);
+		if (available[i])
+			available[i] = spawnbench_impls[i].available(args, &ctxt);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (j = 0; keep_stressing(args) && (j < (size_t)n_sizes); j++) {
+			for (k = 0; keep_stressing(args) && (k < SPAWNBENCH_MEMORY); k++) {
+				void *buf;
+
+				if (skipped[j][k])
+					continue;
+				/* touched memory must fit in half the free memory */
+				if ((k > 0) && freemem &&
+				    (sizes[j] * args->num_instances > (uint64_t)freemem / 2)) {
+					skipped[j][k] = true;
+					continue;
+				}
+				buf = stress_spawnbench_memory(args, sizes[j], k);
+				if (!buf) {
+					skipped[j][k] = true;
+					continue;
+				}
+				for (i = 0; keep_stressing(args) && (i < SPAWNBENCH_METHODS); i++) {
+					if (!available[i])
+						continue;
+					if (stress_spawnbench_step(args, &ctxt, i, &stats[i][j][k]) < 0) {
+						available[i] = false;
+						rc = EXIT_FAILURE;
+					}
+				}
+				(void)munmap(buf, (size_t)sizes[j]);
+			}
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		for (j = 0; j < (size_t)n_sizes; j++) {
+			for (k = 0; k < SPAWNBENCH_MEMORY; k++) {
+				char str[32];
+
+				if (!skipped[j][k])
+					continue;
+				pr_inf("%s: cannot set up %s parent RSS of %s, skipped it\n",
+					args->name, spawnbench_memory[k],
+					stress_uint64_to_str(str, sizeof(str), sizes[j]));
+			}
+		}
+		pr_inf("%s: method       parent rss  memory       spawns/s    mean us     max us\n",
+			args->name);
+	}
+	for (i = 0; i < SPAWNBENCH_METHODS; i++) {
+		const stress_spawnbench_stats_t *top = NULL;
+
+		for (j = 0; j < (size_t)n_sizes; j++) {
+			for (k = 0; k < SPAWNBENCH_MEMORY; k++) {
+				const stress_spawnbench_stats_t *st = &stats[i][j][k];
+				char str[32];
+
+				if (!st->spawns)
+					continue;
+				if (args->instance == 0)
+					pr_inf("%s: %-12s %10s  %-11s %9.1f %10.1f %10.1f\n",
+						args->name, spawnbench_methods[i + 1],
+						stress_uint64_to_str(str, sizeof(str), sizes[j]),
+						spawnbench_memory[k],
+						(double)st->spawns / st->duration,
+						1000000.0 * st->duration / (double)st->spawns,
+						1000000.0 * st->max);
+				if (st->failed && (g_opt_flags & OPT_FLAGS_VERIFY))
+					pr_fail("%s: %" PRIu64 " %s children did not exit cleanly\n",
+						args->name, st->failed, spawnbench_methods[i + 1]);
+				/* the largest parent with its pages mapped */
+				if (k == 1)
+					top = st;
+			}
+		}
+		if (top && (idx < STRESS_MISC_STATS_MAX)) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s spawns/s", spawnbench_methods[i + 1]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				(double)top->spawns / top->duration);
+		}
+	}
+
+	if (ctxt.stack)
+		(void)munmap((void *)ctxt.stack, SPAWNBENCH_STACK_SIZE);
+
+	return rc;
+}
+
+stressor_info_t stress_spawnbench_info = {
+	.stressor = stress_spawnbench,
+	.class = CLASS_SCHEDULER | CLASS_OS | CLASS_VM,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
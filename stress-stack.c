@@ -19,6 +19,18 @@
  */
 #include "stress-ng.h"
 
+#define MIN_STACK_BENCH_SIZE	(64 * KB)
+#define MAX_STACK_BENCH_SIZE	(256 * MB)
+#define DEFAULT_STACK_BENCH_SIZE (8 * MB)
+
+#define STACK_BENCH_WINDOW	(0.2)		/* seconds per measurement */
+#define STACK_BENCH_THREADS	(8)		/* most concurrent threads */
+#define STACK_BENCH_GUARD_GAP	(256)		/* kernel default stack_guard_gap in pages */
+
+#define STACK_BENCH_THP_DEFAULT	(0)		/* no advice */
+#define STACK_BENCH_THP_OFF	(1)		/* MADV_NOHUGEPAGE */
+#define STACK_BENCH_THP_ON	(2)		/* MADV_HUGEPAGE */
+
 static sigjmp_buf jmp_env;
 
 static const stress_help_t help[] = {
@@ -26,9 +38,38 @@ static const stress_help_t help[] = {
 	{ NULL,	"stack-ops N",	"stop after N bogo stack overflows" },
 	{ NULL,	"stack-fill",	"fill stack, touches all new pages " },
 	{ NULL, "stack-mlock",	"mlock stack, force pages to be unswappable" },
+	{ NULL,	"stack-bench",	"measure stack growth cost per page and faults/s" },
+	{ NULL,	"stack-bench-size N", "grow N byte stacks in the stack benchmark" },
 	{ NULL,	NULL,		NULL }
 };
 
+#if defined(HAVE_LIB_PTHREAD)
+/* a way of mapping the stacks being grown */
+typedef struct {
+	const char *what;	/* method name */
+	bool growsdown;		/* grow a MAP_GROWSDOWN mapping down */
+	size_t guard;		/* PROT_NONE guard below a pre-mapped stack */
+	int thp;		/* transparent huge page advice */
+	uint32_t threads;	/* threads each growing their own stacks */
+} stress_stack_bench_t;
+
+/* per thread state and results */
+typedef struct {
+	pthread_t pthread;
+	const stress_stack_bench_t *bench;
+	volatile bool *start;	/* set once all threads are created */
+	double end;		/* end of the measurement */
+	size_t size;		/* stack size */
+	size_t page_size;
+	size_t gap;		/* unmapped gap needed below MAP_GROWSDOWN */
+	uint64_t stacks;	/* stacks grown */
+	uint64_t pages;		/* pages touched */
+	double setup;		/* time mapping and unmapping stacks */
+	double touch;		/* time touching the pages */
+	bool failed;
+} stress_stack_thread_t;
+#endif
+
 static int stress_set_stack_fill(const char *opt)
 {
 	return stress_set_setting_true("stack-fill", opt);
@@ -39,9 +80,26 @@ static int stress_set_stack_mlock(const char *opt)
 	return stress_set_setting_true("stack-mlock", opt);
 }
 
+static int stress_set_stack_bench(const char *opt)
+{
+	return stress_set_setting_true("stack-bench", opt);
+}
+
+static int stress_set_stack_bench_size(const char *opt)
+{
+	size_t stack_bench_size;
+
+	stack_bench_size = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("stack-bench-size", (uint64_t)stack_bench_size,
+		MIN_STACK_BENCH_SIZE, MAX_STACK_BENCH_SIZE);
+	return stress_set_setting("stack-bench-size", TYPE_ID_SIZE_T, &stack_bench_size);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_stack_fill,	stress_set_stack_fill },
 	{ OPT_stack_mlock,	stress_set_stack_mlock },
+	{ OPT_stack_bench,	stress_set_stack_bench },
+	{ OPT_stack_bench_size,	stress_set_stack_bench_size },
 	{ 0,			NULL }
 };
 
@@ -216,12 +274,361 @@ static int stress_stack_child(const stress_args_t *args, void *context)
 	return EXIT_SUCCESS;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_stack_bench_map()
+ *	map a stack to grow, returns the address of the top page
+ *	or NULL on failure
+ */
+static uint8_t *stress_stack_bench_map(const stress_stack_thread_t *thread)
+{
+	const stress_stack_bench_t *bench = thread->bench;
+	const size_t page_size = thread->page_size;
+	uint8_t *ptr;
+
+	if (bench->growsdown) {
+#if defined(MAP_GROWSDOWN) &&	\
+    defined(MAP_FIXED)
+		/*
+		 *  Reserve the stack and the guard gap the kernel keeps
+		 *  below a stack, map the top page over it to grow down
+		 *  from and unmap just the rest of the stack so faults
+		 *  below the top page expand the stack mapping. The gap
+		 *  stays reserved PROT_NONE, inaccessible mappings are
+		 *  allowed in the gap and it stops other threads mapping
+		 *  into the hole the stack grows into
+		 */
+		const size_t reserve = thread->size + thread->gap;
+		uint8_t *top;
+
+		ptr = (uint8_t *)mmap(NULL, reserve, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (ptr == MAP_FAILED)
+			return NULL;
+		top = ptr + reserve - page_size;
+		if (mmap((void *)top, page_size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_GROWSDOWN, -1, 0) == MAP_FAILED) {
+			(void)munmap((void *)ptr, reserve);
+			return NULL;
+		}
+		(void)munmap((void *)(ptr + thread->gap), thread->size - page_size);
+		return top;
+#else
+		return NULL;
+#endif
+	}
+
+	ptr = (uint8_t *)mmap(NULL, thread->size + bench->guard, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+#if defined(HAVE_MPROTECT)
+	if (bench->guard)
+		(void)mprotect((void *)ptr, bench->guard, PROT_NONE);
+#endif
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	if (bench->thp != STACK_BENCH_THP_DEFAULT)
+		(void)shim_madvise((void *)(ptr + bench->guard), thread->size,
+			(bench->thp == STACK_BENCH_THP_ON) ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#endif
+	return ptr + bench->guard + thread->size - page_size;
+}
+
+/*
+ *  stress_stack_bench_unmap()
+ *	unmap a stack mapped by stress_stack_bench_map
+ */
+static void stress_stack_bench_unmap(const stress_stack_thread_t *thread, uint8_t *top)
+{
+	const stress_stack_bench_t *bench = thread->bench;
+	uint8_t *end = top + thread->page_size;
+
+	if (bench->growsdown)
+		(void)munmap((void *)(end - thread->size - thread->gap),
+			thread->size + thread->gap);
+	else
+		(void)munmap((void *)(end - thread->size - bench->guard),
+			thread->size + bench->guard);
+}
+
+/*
+ *  stress_stack_bench_thread()
+ *	map stacks and touch them a page at a time from the top
+ *	down, as a stack grows, until the end of the measurement
+ */
+static void *stress_stack_bench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_stack_thread_t *thread = (stress_stack_thread_t *)arg;
+	const size_t page_size = thread->page_size;
+	const size_t pages = thread->size / page_size;
+
+	while (!*thread->start && keep_stressing_flag())
+		(void)shim_sched_yield();
+
+	while (keep_stressing_flag() && (stress_time_now() < thread->end)) {
+		volatile uint8_t *ptr;
+		uint8_t *top;
+		size_t i;
+		double t1, t2, t3;
+
+		t1 = stress_time_now();
+		top = stress_stack_bench_map(thread);
+		if (!top) {
+			thread->failed = true;
+			break;
+		}
+		t2 = stress_time_now();
+		for (ptr = top, i = 0; i < pages; i++, ptr -= page_size)
+			*ptr = (uint8_t)i;
+		t3 = stress_time_now();
+		stress_stack_bench_unmap(thread, top);
+
+		thread->setup += (t2 - t1) + (stress_time_now() - t3);
+		thread->touch += t3 - t2;
+		thread->pages += pages;
+		thread->stacks++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_stack_bench_run()
+ *	measure one configuration, returns false on failure,
+ *	ns per page is the average time a thread takes to touch
+ *	a page, the rates are for all the threads together
+ */
+static bool stress_stack_bench_run(
+	const stress_args_t *args,
+	const stress_stack_bench_t *bench,
+	const size_t size,
+	const size_t gap,
+	double *stacks_rate,
+	double *setup_us,
+	double *page_ns,
+	double *faults_rate)
+{
+	stress_stack_thread_t threads[STACK_BENCH_THREADS];
+	volatile bool start = false;
+	struct rusage usage;
+	uint64_t stacks = 0, pages = 0;
+	long int minflt;
+	double setup = 0.0, touch = 0.0, t;
+	uint32_t i, started;
+	bool failed = false;
+
+	for (started = 0; started < bench->threads; started++) {
+		stress_stack_thread_t *thread = &threads[started];
+
+		(void)memset(thread, 0, sizeof(*thread));
+		thread->bench = bench;
+		thread->start = &start;
+		thread->size = size;
+		thread->page_size = args->page_size;
+		thread->gap = gap;
+		if (pthread_create(&thread->pthread, NULL,
+				   stress_stack_bench_thread, thread) != 0)
+			break;
+	}
+	(void)shim_getrusage(RUSAGE_SELF, &usage);
+	minflt = usage.ru_minflt;
+	t = stress_time_now();
+	for (i = 0; i < started; i++)
+		threads[i].end = t + STACK_BENCH_WINDOW;
+	start = true;
+
+	for (i = 0; i < started; i++) {
+		const stress_stack_thread_t *thread = &threads[i];
+
+		(void)pthread_join(thread->pthread, NULL);
+		stacks += thread->stacks;
+		pages += thread->pages;
+		setup += thread->setup;
+		touch += thread->touch;
+		failed |= thread->failed;
+	}
+	t = stress_time_now() - t;
+	(void)shim_getrusage(RUSAGE_SELF, &usage);
+	add_counter(args, stacks);
+
+	if ((started < bench->threads) || failed || !stacks || (t <= 0.0))
+		return false;
+
+	*stacks_rate = (double)stacks / t;
+	*setup_us = (setup * 1.0E6) / (double)stacks;
+	*page_ns = (touch * (double)STRESS_NANOSECOND) / (double)pages;
+	*faults_rate = (double)(usage.ru_minflt - minflt) / t;
+	return true;
+}
+
+/*
+ *  stress_stack_bench_guard_gap()
+ *	the gap in bytes the kernel keeps below a stack
+ *	mapping, set with the stack_guard_gap boot option
+ */
+static size_t stress_stack_bench_guard_gap(const size_t page_size)
+{
+	char buf[4096];
+	const char *ptr;
+	unsigned long int pages = STACK_BENCH_GUARD_GAP;
+
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read("/proc/cmdline", buf, sizeof(buf) - 1) > 0) {
+		ptr = strstr(buf, "stack_guard_gap=");
+		if (ptr && (sscanf(ptr + 16, "%lu", &pages) != 1))
+			pages = STACK_BENCH_GUARD_GAP;
+	}
+	return (size_t)pages * page_size;
+}
+
+/*
+ *  stress_stack_bench()
+ *	measure the cost per page of growing stacks down through
+ *	the MAP_GROWSDOWN stack expansion path against first touch
+ *	of pre-mapped stacks, with guard pages of different sizes
+ *	and transparent huge pages on and off, scaling the number
+ *	of threads each growing their own stacks
+ */
+static int stress_stack_bench(const stress_args_t *args)
+{
+	static const char * const thp_names[] = { "-", "off", "on" };
+	static const size_t guard_sizes[] = {
+		0, 4 * KB, 64 * KB, 1 * MB
+	};
+	static const uint32_t threads[] = {
+		1, 2, 4, 8
+	};
+	stress_stack_bench_t benches[SIZEOF_ARRAY(guard_sizes) + 3];
+	size_t i, j, n = 0;
+	size_t stack_bench_size = DEFAULT_STACK_BENCH_SIZE;
+	size_t gap;
+	int thp_max = STACK_BENCH_THP_DEFAULT;
+	char str[16];
+
+	if (args->instance != 0)
+		goto idle;
+
+	(void)stress_get_setting("stack-bench-size", &stack_bench_size);
+	stack_bench_size = (stack_bench_size + args->page_size - 1) & ~(args->page_size - 1);
+	gap = stress_stack_bench_guard_gap(args->page_size);
+
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	{
+		char buf[128];
+
+		/* only compare THP on and off if THP can be enabled with madvise */
+		(void)memset(buf, 0, sizeof(buf));
+		if ((system_read("/sys/kernel/mm/transparent_hugepage/enabled", buf, sizeof(buf) - 1) > 0) &&
+		    !strstr(buf, "[never]"))
+			thp_max = STACK_BENCH_THP_ON;
+	}
+#endif
+
+	for (i = 0; i < SIZEOF_ARRAY(guard_sizes); i++) {
+		const stress_stack_bench_t bench = {
+			"premapped", false, guard_sizes[i], STACK_BENCH_THP_DEFAULT, 1
+		};
+		benches[n++] = bench;
+	}
+	if (thp_max == STACK_BENCH_THP_ON) {
+		const stress_stack_bench_t bench_off = {
+			"premapped", false, args->page_size, STACK_BENCH_THP_OFF, 1
+		};
+		const stress_stack_bench_t bench_on = {
+			"premapped", false, args->page_size, STACK_BENCH_THP_ON, 1
+		};
+
+		benches[n++] = bench_off;
+		benches[n++] = bench_on;
+	}
+#if defined(MAP_GROWSDOWN) &&	\
+    defined(MAP_FIXED)
+	{
+		const stress_stack_bench_t bench = {
+			"growsdown", true, 0, STACK_BENCH_THP_DEFAULT, 1
+		};
+		benches[n++] = bench;
+	}
+#endif
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	(void)stress_uint64_to_str(str, sizeof(str), (uint64_t)stack_bench_size);
+	pr_inf("%s: growing %s stacks, kernel stack guard gap %zuK\n",
+		args->name, str, gap / (size_t)KB);
+	pr_inf("%s: %-10s %6s %4s %7s %10s %10s %8s %12s\n", args->name,
+		"method", "guard", "THP", "threads", "stacks/s", "setup us",
+		"ns/page", "faults/s");
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; keep_stressing(args) && (j < SIZEOF_ARRAY(threads)); j++) {
+			stress_stack_bench_t bench = benches[i];
+			double stacks_rate, setup_us, page_ns, faults_rate;
+			char guard[16];
+
+			bench.threads = threads[j];
+			if (bench.growsdown)
+				(void)shim_strlcpy(guard, "gap", sizeof(guard));
+			else if (!bench.guard)
+				(void)shim_strlcpy(guard, "none", sizeof(guard));
+			else
+				(void)stress_uint64_to_str(guard, sizeof(guard), (uint64_t)bench.guard);
+
+			if (!stress_stack_bench_run(args, &bench, stack_bench_size, gap,
+					&stacks_rate, &setup_us, &page_ns, &faults_rate)) {
+				pr_inf("%s: %-10s %6s %4s %7" PRIu32 " %10s %10s %8s %12s\n",
+					args->name, bench.what, guard, thp_names[bench.thp],
+					bench.threads, "failed", "-", "-", "-");
+				continue;
+			}
+			pr_inf("%s: %-10s %6s %4s %7" PRIu32 " %10.1f %10.2f %8.1f %12.0f\n",
+				args->name, bench.what, guard, thp_names[bench.thp],
+				bench.threads, stacks_rate, setup_us, page_ns, faults_rate);
+
+			/* summarise the unguarded pre-mapped and the grow down stacks */
+			if (bench.guard || (bench.thp != STACK_BENCH_THP_DEFAULT))
+				continue;
+			if (bench.threads == 1) {
+				const size_t idx = bench.growsdown ? 2 : 0;
+
+				stress_misc_stats_set(args->misc_stats, idx, bench.growsdown ?
+					"growsdown ns per page" : "premapped ns per page", page_ns);
+				stress_misc_stats_set(args->misc_stats, idx + 1, bench.growsdown ?
+					"growsdown faults per sec" : "premapped faults per sec", faults_rate);
+			} else if (bench.threads == STACK_BENCH_THREADS) {
+				stress_misc_stats_set(args->misc_stats, bench.growsdown ? 5 : 4,
+					bench.growsdown ? "growsdown faults/s 8 threads" :
+							  "premapped faults/s 8 threads",
+					faults_rate);
+			}
+		}
+	}
+
+idle:
+	while (keep_stressing(args))
+		(void)shim_usleep(100000);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_stack
  *	stress by forcing stack overflows
  */
 static int stress_stack(const stress_args_t *args)
 {
+#if defined(HAVE_LIB_PTHREAD)
+	bool stack_bench = false;
+
+	(void)stress_get_setting("stack-bench", &stack_bench);
+	if (stack_bench)
+		return stress_stack_bench(args);
+#endif
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	return stress_oomable_child(args, NULL, stress_stack_child, STRESS_OOMABLE_NORMAL);
@@ -18,6 +18,15 @@
  *
  */
 #include "stress-ng.h"
+#include "core-put.h"
+
+#define STR_SWEEP_MIN		(16)		/* shortest sweep string */
+#define STR_SWEEP_LENGTHS	(7)		/* 16 bytes to 64K in powers of 4 */
+#define STR_SWEEP_MAX		((size_t)STR_SWEEP_MIN << (2 * (STR_SWEEP_LENGTHS - 1)))
+#define STR_SWEEP_BYTES		(16 * MB)	/* bytes scanned per measurement */
+#define STR_SWEEP_NEEDLE	(8)		/* strstr needle length */
+#define STR_SWEEP_ALIGNS	(3)
+#define STR_SWEEP_IMPLS		(2)		/* libc and simd */
 
 /*
  *  the STR stress test has different classes of string stressors
@@ -41,6 +50,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"str N",	   "start N workers exercising lib C string functions" },
 	{ NULL,	"str-method func", "specify the string function to stress" },
 	{ NULL,	"str-ops N",	   "stop after N bogo string operations" },
+	{ NULL,	"str-sweep",	   "report libc and SIMD string scan GB/s over lengths and alignments" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -654,6 +664,479 @@ static const stress_str_method_info_t str_methods[] = {
 	{ NULL,			NULL,			NULL }
 };
 
+static int stress_set_str_sweep(const char *opt)
+{
+	return stress_set_setting_true("str-sweep", opt);
+}
+
+#if defined(HAVE_VECMATH)
+/*
+ *  Reference SIMD string scans using 16 byte generic vectors, these
+ *  are the classic aligned block scans so the libc versions can be
+ *  compared against a known simple implementation. Aligned loads
+ *  may read past the end of the string but never cross a page,
+ *  unaligned loads are only used when they do not cross a page.
+ */
+typedef uint8_t stress_str_vec_t
+	__attribute__ ((vector_size(16), __may_alias__));
+typedef uint8_t stress_str_uvec_t
+	__attribute__ ((vector_size(16), aligned(1), __may_alias__));
+
+#define STR_VEC_SIZE		(sizeof(stress_str_vec_t))
+#define STR_VEC_ALIGNED(p)	(!((uintptr_t)(p) & (STR_VEC_SIZE - 1)))
+#define STR_VEC_PAGE_SAFE(p)	(((uintptr_t)(p) & 4095) <= (4096 - STR_VEC_SIZE))
+
+static const size_t str_sweep_align[STR_SWEEP_ALIGNS] = { 0, 1, 7 };
+static const char * const str_sweep_impls[STR_SWEEP_IMPLS] = { "libc", "simd" };
+
+static inline bool ALWAYS_INLINE stress_str_vec_any(const stress_str_vec_t v)
+{
+	uint64_t w[2];
+
+	(void)memcpy(w, &v, sizeof(w));
+	return (w[0] | w[1]) != 0;
+}
+
+static inline stress_str_vec_t ALWAYS_INLINE stress_str_vec_splat(const int c)
+{
+	stress_str_vec_t v;
+	size_t i;
+
+	for (i = 0; i < STR_VEC_SIZE; i++)
+		v[i] = (uint8_t)c;
+	return v;
+}
+
+static OPTIMIZE3 size_t stress_str_simd_strlen(const char *s)
+{
+	const stress_str_vec_t zero = stress_str_vec_splat(0);
+	const char *p;
+
+	for (p = s; !STR_VEC_ALIGNED(p); p++) {
+		if (!*p)
+			return (size_t)(p - s);
+	}
+	for (;; p += STR_VEC_SIZE) {
+		const stress_str_vec_t v = *(const stress_str_vec_t *)p;
+
+		if (stress_str_vec_any((stress_str_vec_t)(v == zero)))
+			break;
+	}
+	while (*p)
+		p++;
+	return (size_t)(p - s);
+}
+
+static OPTIMIZE3 const void *stress_str_simd_memchr(const void *s, const int c, size_t n)
+{
+	const stress_str_vec_t vc = stress_str_vec_splat(c);
+	const uint8_t *p = (const uint8_t *)s;
+
+	for (; n >= STR_VEC_SIZE; n -= STR_VEC_SIZE, p += STR_VEC_SIZE) {
+		const stress_str_vec_t v = *(const stress_str_uvec_t *)p;
+
+		if (stress_str_vec_any((stress_str_vec_t)(v == vc)))
+			break;
+	}
+	for (; n; n--, p++) {
+		if (*p == (uint8_t)c)
+			return p;
+	}
+	return NULL;
+}
+
+static OPTIMIZE3 const char *stress_str_simd_strchr(const char *s, const int c)
+{
+	const stress_str_vec_t vc = stress_str_vec_splat(c);
+	const stress_str_vec_t zero = stress_str_vec_splat(0);
+	const char *p;
+
+	for (p = s; !STR_VEC_ALIGNED(p); p++) {
+		if (*p == (char)c)
+			return p;
+		if (!*p)
+			return NULL;
+	}
+	for (;; p += STR_VEC_SIZE) {
+		const stress_str_vec_t v = *(const stress_str_vec_t *)p;
+
+		if (stress_str_vec_any((stress_str_vec_t)((v == vc) | (v == zero))))
+			break;
+	}
+	for (;; p++) {
+		if (*p == (char)c)
+			return p;
+		if (!*p)
+			return NULL;
+	}
+}
+
+static OPTIMIZE3 const char *stress_str_simd_strrchr(const char *s, const int c)
+{
+	const stress_str_vec_t vc = stress_str_vec_splat(c);
+	const stress_str_vec_t zero = stress_str_vec_splat(0);
+	const char *p, *last = NULL, *block = NULL, *tail = NULL;
+
+	if (!c)
+		return s + stress_str_simd_strlen(s);
+
+	for (p = s; !STR_VEC_ALIGNED(p); p++) {
+		if (!*p)
+			return last;
+		if (*p == (char)c)
+			last = p;
+	}
+	/* remember the last block holding c before the terminator block */
+	for (;; p += STR_VEC_SIZE) {
+		const stress_str_vec_t v = *(const stress_str_vec_t *)p;
+
+		if (stress_str_vec_any((stress_str_vec_t)(v == zero)))
+			break;
+		if (stress_str_vec_any((stress_str_vec_t)(v == vc)))
+			block = p;
+	}
+	for (; *p; p++) {
+		if (*p == (char)c)
+			tail = p;
+	}
+	if (tail)
+		return tail;
+	if (!block)
+		return last;
+	for (p = block + STR_VEC_SIZE - 1; *p != (char)c; p--)
+		;
+	return p;
+}
+
+static OPTIMIZE3 int stress_str_simd_strcmp(const char *s1, const char *s2)
+{
+	const stress_str_vec_t zero = stress_str_vec_splat(0);
+
+	for (;;) {
+		stress_str_vec_t v1, v2;
+
+		if (!STR_VEC_PAGE_SAFE(s1) || !STR_VEC_PAGE_SAFE(s2)) {
+			if ((*s1 != *s2) || !*s1)
+				break;
+			s1++;
+			s2++;
+			continue;
+		}
+		v1 = *(const stress_str_uvec_t *)s1;
+		v2 = *(const stress_str_uvec_t *)s2;
+		if (stress_str_vec_any((stress_str_vec_t)((v1 != v2) | (v1 == zero)))) {
+			while (*s1 && (*s1 == *s2)) {
+				s1++;
+				s2++;
+			}
+			break;
+		}
+		s1 += STR_VEC_SIZE;
+		s2 += STR_VEC_SIZE;
+	}
+	return (int)(unsigned char)*s1 - (int)(unsigned char)*s2;
+}
+
+static OPTIMIZE3 const char *stress_str_simd_strstr(const char *hay, const char *needle)
+{
+	const size_t n = strlen(needle);
+	const stress_str_vec_t zero = stress_str_vec_splat(0);
+	stress_str_vec_t vn0, vn1;
+	const char *p;
+
+	if (n < 2)
+		return n ? stress_str_simd_strchr(hay, *needle) : hay;
+
+	/* filter on the first two needle chars, verify the candidates */
+	vn0 = stress_str_vec_splat(needle[0]);
+	vn1 = stress_str_vec_splat(needle[1]);
+	for (p = hay;; ) {
+		stress_str_vec_t v0, v1;
+		size_t i;
+
+		if (!STR_VEC_PAGE_SAFE(p) || !STR_VEC_PAGE_SAFE(p + 1)) {
+			if (!*p)
+				return NULL;
+			if ((*p == needle[0]) && !strncmp(p, needle, n))
+				return p;
+			p++;
+			continue;
+		}
+		v0 = *(const stress_str_uvec_t *)p;
+		v1 = *(const stress_str_uvec_t *)(p + 1);
+		if (stress_str_vec_any((stress_str_vec_t)(((v0 == vn0) & (v1 == vn1)) | (v0 == zero)))) {
+			for (i = 0; i < STR_VEC_SIZE; i++) {
+				if (!p[i])
+					return NULL;
+				if ((p[i] == needle[0]) && !strncmp(p + i, needle, n))
+					return p + i;
+			}
+		}
+		p += STR_VEC_SIZE;
+	}
+}
+
+/*
+ *  sweep strings are len chars of a..y with a trailing z, the
+ *  scans return the offset of the z or the strcmp sign so the
+ *  libc and simd results can be compared
+ */
+static inline size_t stress_str_offset(const char *s, const void *p)
+{
+	return p ? (size_t)((const char *)p - s) : ~(size_t)0;
+}
+
+static inline size_t stress_str_sign(const int ret)
+{
+	return (ret < 0) ? 0 : ((ret > 0) ? 2 : 1);
+}
+
+typedef size_t (*stress_str_sweep_func)(const char *s1, const char *s2, const size_t len);
+
+#define STRESS_STR_SWEEP(name, libc_expr, simd_expr)			\
+static NOINLINE size_t stress_str_sweep_ ## name ## _libc(		\
+	const char *s1,							\
+	const char *s2,							\
+	const size_t len)						\
+{									\
+	(void)s2;							\
+	(void)len;							\
+	return libc_expr;						\
+}									\
+									\
+static NOINLINE size_t stress_str_sweep_ ## name ## _simd(		\
+	const char *s1,							\
+	const char *s2,							\
+	const size_t len)						\
+{									\
+	(void)s2;							\
+	(void)len;							\
+	return simd_expr;						\
+}
+
+STRESS_STR_SWEEP(strlen, strlen(s1), stress_str_simd_strlen(s1))
+STRESS_STR_SWEEP(memchr, stress_str_offset(s1, memchr(s1, 'z', len)),
+	stress_str_offset(s1, stress_str_simd_memchr(s1, 'z', len)))
+STRESS_STR_SWEEP(strchr, stress_str_offset(s1, strchr(s1, 'z')),
+	stress_str_offset(s1, stress_str_simd_strchr(s1, 'z')))
+STRESS_STR_SWEEP(strrchr, stress_str_offset(s1, strrchr(s1, 'z')),
+	stress_str_offset(s1, stress_str_simd_strrchr(s1, 'z')))
+STRESS_STR_SWEEP(strcmp, stress_str_sign(strcmp(s1, s2)),
+	stress_str_sign(stress_str_simd_strcmp(s1, s2)))
+STRESS_STR_SWEEP(strstr, stress_str_offset(s1, strstr(s1, s1 + len - STR_SWEEP_NEEDLE)),
+	stress_str_offset(s1, stress_str_simd_strstr(s1, s1 + len - STR_SWEEP_NEEDLE)))
+
+typedef struct {
+	const char *name;
+	const stress_str_sweep_func func[STR_SWEEP_IMPLS];
+} stress_str_sweep_info_t;
+
+static const stress_str_sweep_info_t str_sweeps[] = {
+	{ "strlen",	{ stress_str_sweep_strlen_libc,	stress_str_sweep_strlen_simd } },
+	{ "memchr",	{ stress_str_sweep_memchr_libc,	stress_str_sweep_memchr_simd } },
+	{ "strchr",	{ stress_str_sweep_strchr_libc,	stress_str_sweep_strchr_simd } },
+	{ "strrchr",	{ stress_str_sweep_strrchr_libc, stress_str_sweep_strrchr_simd } },
+	{ "strcmp",	{ stress_str_sweep_strcmp_libc,	stress_str_sweep_strcmp_simd } },
+	{ "strstr",	{ stress_str_sweep_strstr_libc,	stress_str_sweep_strstr_simd } },
+};
+
+#define STR_SWEEPS	SIZEOF_ARRAY(str_sweeps)
+
+/* bytes scanned and scan time of each function, impl, alignment and length */
+typedef struct {
+	double bytes[STR_SWEEPS][STR_SWEEP_IMPLS][STR_SWEEP_ALIGNS][STR_SWEEP_LENGTHS];
+	double secs[STR_SWEEPS][STR_SWEEP_IMPLS][STR_SWEEP_ALIGNS][STR_SWEEP_LENGTHS];
+} stress_str_sweep_t;
+
+/*
+ *  stress_str_sweep()
+ *	time the libc and simd scans of one function over all the
+ *	string lengths and alignments
+ */
+static void stress_str_sweep(
+	const stress_args_t *args,
+	const size_t f,
+	stress_str_sweep_t *sweep,
+	char *buf1,
+	char *buf2,
+	bool *failed)
+{
+	size_t a, l, i;
+
+	for (a = 0; a < STR_SWEEP_ALIGNS; a++) {
+		char *s1 = buf1 + str_sweep_align[a];
+		char *s2 = buf2 + str_sweep_align[a];
+
+		for (l = 0; l < STR_SWEEP_LENGTHS; l++) {
+			const size_t len = (size_t)STR_SWEEP_MIN << (2 * l);
+			const size_t reps = STR_SWEEP_BYTES / len;
+			size_t result[STR_SWEEP_IMPLS];
+
+			for (i = 0; i < len - 1; i++)
+				s1[i] = (char)((stress_mwc8() % 25) + 'a');
+			s1[len - 1] = 'z';
+			s1[len] = '\0';
+			(void)memcpy(s2, s1, len + 1);
+
+			for (i = 0; i < STR_SWEEP_IMPLS; i++) {
+				const stress_str_sweep_func func = str_sweeps[f].func[i];
+				uint64_t sum = 0;
+				double t;
+				size_t r;
+
+				t = stress_time_now();
+				for (r = 0; r < reps; r++)
+					sum += func(s1, s2, len);
+				sweep->secs[f][i][a][l] += stress_time_now() - t;
+				sweep->bytes[f][i][a][l] += (double)len * (double)reps;
+				stress_uint64_put(sum);
+				result[i] = func(s1, s2, len);
+			}
+			if ((g_opt_flags & OPT_FLAGS_VERIFY) && (result[0] != result[1])) {
+				pr_fail("%s: %s: %zu byte string at alignment %zu, simd result %zu "
+					"does not match libc result %zu\n",
+					args->name, str_sweeps[f].name, len, str_sweep_align[a],
+					result[1], result[0]);
+				*failed = true;
+			}
+			if (!keep_stressing_flag())
+				return;
+		}
+	}
+}
+
+/*
+ *  stress_str_sweep_report()
+ *	report the GB/s of the libc and simd scans of each function
+ */
+static void stress_str_sweep_report(
+	const stress_args_t *args,
+	const stress_str_sweep_t *sweep,
+	const bool *used)
+{
+	size_t f, a, l, i;
+	int idx = 0;
+
+	for (f = 0; f < STR_SWEEPS; f++) {
+		char line[256];
+		size_t len;
+
+		if (!used[f])
+			continue;
+		if (args->instance == 0) {
+			len = (size_t)snprintf(line, sizeof(line), "%-7s GB/s", str_sweeps[f].name);
+			for (a = 0; a < STR_SWEEP_ALIGNS; a++) {
+				for (i = 0; i < STR_SWEEP_IMPLS; i++)
+					len += (size_t)snprintf(line + len, sizeof(line) - len,
+						" %6s+%zu", str_sweep_impls[i], str_sweep_align[a]);
+			}
+			pr_inf("%s: %s\n", args->name, line);
+		}
+		for (l = 0; l < STR_SWEEP_LENGTHS; l++) {
+			const size_t size = (size_t)STR_SWEEP_MIN << (2 * l);
+
+			if (size >= KB)
+				len = (size_t)snprintf(line, sizeof(line), "%11zuK", (size_t)(size / KB));
+			else
+				len = (size_t)snprintf(line, sizeof(line), "%11zuB", size);
+			for (a = 0; a < STR_SWEEP_ALIGNS; a++) {
+				for (i = 0; i < STR_SWEEP_IMPLS; i++) {
+					const double secs = sweep->secs[f][i][a][l];
+					const double rate = (secs > 0.0) ?
+						sweep->bytes[f][i][a][l] / (secs * 1.0E9) : 0.0;
+
+					len += (size_t)snprintf(line + len, sizeof(line) - len,
+						" %8.2f", rate);
+					/* libc rate of the aligned 4K strings */
+					if ((size == 4 * KB) && (a == 0) && (i == 0) &&
+					    (idx < STRESS_MISC_STATS_MAX)) {
+						char desc[32];
+
+						(void)snprintf(desc, sizeof(desc), "%s 4K libc GB/s",
+							str_sweeps[f].name);
+						stress_misc_stats_set(args->misc_stats, idx++, desc, rate);
+					}
+				}
+			}
+			if (args->instance == 0)
+				pr_inf("%s: %s\n", args->name, line);
+		}
+	}
+}
+
+/*
+ *  stress_str_sweep_run()
+ *	each bogo-op is a sweep of one function, the all method
+ *	cycles through all the sweep functions
+ */
+static int stress_str_sweep_run(
+	const stress_args_t *args,
+	const stress_str_method_info_t *str_method)
+{
+	const size_t buf_size = STR_SWEEP_MAX + args->page_size;
+	stress_str_sweep_t *sweep;
+	bool used[STR_SWEEPS], failed = false;
+	char *buf1, *buf2;
+	size_t f, n = 0;
+
+	for (f = 0; f < STR_SWEEPS; f++) {
+		used[f] = (str_method->func == stress_str_all) ||
+			  !strcmp(str_sweeps[f].name, str_method->name);
+		n += used[f];
+	}
+	if (!n) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: str-method '%s' is not supported by the sweep, "
+				"skipping stressor\n", args->name, str_method->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	sweep = calloc(1, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	buf1 = (char *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf1 == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte sweep buffer, skipping stressor\n",
+			args->name, buf_size);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+	buf2 = (char *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf2 == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte sweep buffer, skipping stressor\n",
+			args->name, buf_size);
+		(void)munmap((void *)buf1, buf_size);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	f = 0;
+	do {
+		while (!used[f])
+			f = (f + 1) % STR_SWEEPS;
+		stress_str_sweep(args, f, sweep, buf1, buf2, &failed);
+		f = (f + 1) % STR_SWEEPS;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_str_sweep_report(args, sweep, used);
+
+	(void)munmap((void *)buf2, buf_size);
+	(void)munmap((void *)buf1, buf_size);
+	free(sweep);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_set_str_method()
  *	set the default string stress method
@@ -692,8 +1175,20 @@ static int stress_str(const stress_args_t *args)
 	register char *ptr1, *ptr2;
 	register size_t len1, len2;
 	const char *name = args->name;
+	bool str_sweep = false;
 
 	(void)stress_get_setting("str-method", &str_method);
+	(void)stress_get_setting("str-sweep", &str_sweep);
+	if (str_sweep) {
+#if defined(HAVE_VECMATH)
+		return stress_str_sweep_run(args, str_method);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: str-sweep needs compiler vector support, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 	func = str_method->func;
 	libc_func = str_method->libc_func;
 
@@ -736,6 +1231,7 @@ static void stress_str_set_default(void)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_str_method,	stress_set_str_method },
+	{ OPT_str_sweep,	stress_set_str_sweep },
 	{ 0,			NULL }
 };
 
@@ -31,6 +31,8 @@
 #include "stress-ng.h"
 #include "core-cache.h"
 #include "core-cpu.h"
+#include "core-mem-backing.h"
+#include "core-numa.h"
 #include "core-nt-store.h"
 
 #define MIN_STREAM_L3_SIZE	(4 * KB)
@@ -43,17 +45,49 @@
 
 #define STORE(dst, src)			dst = src
 
+/* --stream-numa modes */
+#define STREAM_NUMA_NONE		(0)	/* no NUMA placement */
+#define STREAM_NUMA_LOCAL		(1)	/* memory on the CPU's node */
+#define STREAM_NUMA_REMOTE		(2)	/* memory on a remote node */
+#define STREAM_NUMA_INTERLEAVE		(3)	/* memory interleaved on all nodes */
+#define STREAM_NUMA_MATRIX		(4)	/* node to node bandwidth matrix */
+
+/* --stream-simd kernel selection, >= 0 indexes stream_simd[] */
+#define STREAM_SIMD_DEFAULT		(-2)	/* non-temporal if available */
+#define STREAM_SIMD_AUTO		(-1)	/* widest supported vectors */
+
 typedef struct {
 	const char *name;
 	const int advice;
 } stress_stream_madvise_info_t;
 
+typedef struct {
+	const char *name;
+	const int mode;
+} stress_stream_numa_info_t;
+
+typedef struct {
+	const char *name;		/* --stream-simd width name */
+	bool (*supported)(void);	/* can the CPU run these kernels? */
+	void (*copy)(double *RESTRICT c, const double *RESTRICT a,
+		const uint64_t n);
+	void (*scale)(double *RESTRICT b, const double *RESTRICT c,
+		const double q, const uint64_t n);
+	void (*add)(const double *RESTRICT a, const double *RESTRICT b,
+		double *RESTRICT c, const uint64_t n);
+	void (*triad)(double *RESTRICT a, const double *RESTRICT b,
+		const double *RESTRICT c, const double q, const uint64_t n);
+} stress_stream_simd_t;
+
 static const stress_help_t help[] = {
 	{ NULL,	"stream N",		"start N workers exercising memory bandwidth" },
 	{ NULL,	"stream-ops N",		"stop after N bogo stream operations" },
 	{ NULL,	"stream-index",		"specify number of indices into the data (0..3)" },
 	{ NULL,	"stream-l3-size N",	"specify the L3 cache size of the CPU" },
 	{ NULL,	"stream-madvise M",	"specify mmap'd stream buffer madvise advice" },
+	{ NULL,	"stream-numa M",	"NUMA placement: local, remote, interleave or matrix" },
+	{ NULL,	"stream-numa-node N",	"specify the remote NUMA node for --stream-numa remote" },
+	{ NULL,	"stream-simd W",	"kernel width: auto, scalar, nt, 128, 256 or 512" },
 	{ NULL,	NULL,                   NULL }
 };
 
@@ -103,6 +137,42 @@ static int stress_set_stream_madvise(const char *opt)
 	return -1;
 }
 
+static const stress_stream_numa_info_t stream_numa_info[] = {
+	{ "none",	STREAM_NUMA_NONE },
+	{ "local",	STREAM_NUMA_LOCAL },
+	{ "remote",	STREAM_NUMA_REMOTE },
+	{ "interleave",	STREAM_NUMA_INTERLEAVE },
+	{ "matrix",	STREAM_NUMA_MATRIX },
+	{ NULL,		0 },
+};
+
+static int stress_set_stream_numa(const char *opt)
+{
+	const stress_stream_numa_info_t *info;
+
+	for (info = stream_numa_info; info->name; info++) {
+		if (!strcmp(opt, info->name)) {
+			stress_set_setting("stream-numa", TYPE_ID_INT, &info->mode);
+			return 0;
+		}
+	}
+	(void)fprintf(stderr, "invalid stream-numa mode '%s', allowed modes are:", opt);
+	for (info = stream_numa_info; info->name; info++) {
+		(void)fprintf(stderr, " %s", info->name);
+	}
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_stream_numa_node(const char *opt)
+{
+	uint32_t stream_numa_node;
+
+	stream_numa_node = stress_get_uint32(opt);
+	stress_check_range("stream-numa-node", stream_numa_node, 0, STRESS_NUMA_MAX_NODES - 1);
+	return stress_set_setting("stream-numa-node", TYPE_ID_UINT32, &stream_numa_node);
+}
+
 static int stress_set_stream_index(const char *opt)
 {
 	uint32_t stream_index;
@@ -384,6 +454,225 @@ static inline void OPTIMIZE3 stress_stream_triad_index3(
 		STORE(a[idx1[i]], b[idx2[i]] + (c[idx3[i]] * q));
 }
 
+#if defined(HAVE_VECMATH)
+/*
+ *  Explicit fixed width vector kernels, the width is chosen by the
+ *  vector type and not by the compiler's autovectorizer so the
+ *  results do not vary with the toolchain. The target attribute
+ *  allows the wider kernels to be built without -mavx2 etc, they
+ *  are only called once the CPU is known to support them.
+ */
+#define STRESS_STREAM_SIMD_KERNELS(width, target)			\
+typedef double stress_stream_v ## width ## _t				\
+	__attribute__ ((vector_size(width / 8)));			\
+									\
+static void target OPTIMIZE3 stress_stream_copy_v ## width(		\
+	double *RESTRICT c,						\
+	const double *RESTRICT a,					\
+	const uint64_t n)						\
+{									\
+	const uint64_t lanes = sizeof(stress_stream_v ## width ## _t) / sizeof(double);	\
+	const uint64_t nv = n / lanes;					\
+	stress_stream_v ## width ## _t *vc = (stress_stream_v ## width ## _t *)c;	\
+	const stress_stream_v ## width ## _t *va = (const stress_stream_v ## width ## _t *)a;	\
+	register uint64_t i;						\
+									\
+	for (i = 0; i < nv; i++)					\
+		vc[i] = va[i];						\
+	for (i = nv * lanes; i < n; i++)				\
+		c[i] = a[i];						\
+}									\
+									\
+static void target OPTIMIZE3 stress_stream_scale_v ## width(		\
+	double *RESTRICT b,						\
+	const double *RESTRICT c,					\
+	const double q,							\
+	const uint64_t n)						\
+{									\
+	const uint64_t lanes = sizeof(stress_stream_v ## width ## _t) / sizeof(double);	\
+	const uint64_t nv = n / lanes;					\
+	stress_stream_v ## width ## _t *vb = (stress_stream_v ## width ## _t *)b;	\
+	const stress_stream_v ## width ## _t *vc = (const stress_stream_v ## width ## _t *)c;	\
+	stress_stream_v ## width ## _t vq;				\
+	register uint64_t i;						\
+									\
+	for (i = 0; i < lanes; i++)					\
+		vq[i] = q;						\
+	for (i = 0; i < nv; i++)					\
+		vb[i] = vq * vc[i];					\
+	for (i = nv * lanes; i < n; i++)				\
+		b[i] = q * c[i];					\
+}									\
+									\
+static void target OPTIMIZE3 stress_stream_add_v ## width(		\
+	const double *RESTRICT a,					\
+	const double *RESTRICT b,					\
+	double *RESTRICT c,						\
+	const uint64_t n)						\
+{									\
+	const uint64_t lanes = sizeof(stress_stream_v ## width ## _t) / sizeof(double);	\
+	const uint64_t nv = n / lanes;					\
+	const stress_stream_v ## width ## _t *va = (const stress_stream_v ## width ## _t *)a;	\
+	const stress_stream_v ## width ## _t *vb = (const stress_stream_v ## width ## _t *)b;	\
+	stress_stream_v ## width ## _t *vc = (stress_stream_v ## width ## _t *)c;	\
+	register uint64_t i;						\
+									\
+	for (i = 0; i < nv; i++)					\
+		vc[i] = va[i] + vb[i];					\
+	for (i = nv * lanes; i < n; i++)				\
+		c[i] = a[i] + b[i];					\
+}									\
+									\
+static void target OPTIMIZE3 stress_stream_triad_v ## width(		\
+	double *RESTRICT a,						\
+	const double *RESTRICT b,					\
+	const double *RESTRICT c,					\
+	const double q,							\
+	const uint64_t n)						\
+{									\
+	const uint64_t lanes = sizeof(stress_stream_v ## width ## _t) / sizeof(double);	\
+	const uint64_t nv = n / lanes;					\
+	stress_stream_v ## width ## _t *va = (stress_stream_v ## width ## _t *)a;	\
+	const stress_stream_v ## width ## _t *vb = (const stress_stream_v ## width ## _t *)b;	\
+	const stress_stream_v ## width ## _t *vc = (const stress_stream_v ## width ## _t *)c;	\
+	stress_stream_v ## width ## _t vq;				\
+	register uint64_t i;						\
+									\
+	for (i = 0; i < lanes; i++)					\
+		vq[i] = q;						\
+	for (i = 0; i < nv; i++)					\
+		va[i] = vb[i] + (vc[i] * vq);				\
+	for (i = nv * lanes; i < n; i++)				\
+		a[i] = b[i] + (c[i] * q);				\
+}
+
+#if defined(STRESS_ARCH_X86)
+STRESS_STREAM_SIMD_KERNELS(128, __attribute__ ((target("sse2"))))
+#define HAVE_STREAM_SIMD_128
+
+#if defined(HAVE_TARGET_CLONES_AVX2)
+STRESS_STREAM_SIMD_KERNELS(256, __attribute__ ((target("avx2"))))
+#define HAVE_STREAM_SIMD_256
+#endif
+
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+STRESS_STREAM_SIMD_KERNELS(512, __attribute__ ((target("avx512f"))))
+#define HAVE_STREAM_SIMD_512
+#endif
+#elif defined(__aarch64__)
+/* 128 bit NEON is always available on 64 bit ARM */
+STRESS_STREAM_SIMD_KERNELS(128, )
+#define HAVE_STREAM_SIMD_128
+#endif
+#endif
+
+/*
+ *  stress_stream_simd_always()
+ *	kernels that run on any CPU
+ */
+static bool stress_stream_simd_always(void)
+{
+	return true;
+}
+
+#if defined(HAVE_STREAM_SIMD_128)
+/*
+ *  stress_stream_simd_has_128()
+ *	can the 128 bit vector kernels be used?
+ */
+static bool stress_stream_simd_has_128(void)
+{
+#if defined(STRESS_ARCH_X86)
+	return stress_cpu_x86_has_sse2();
+#else
+	return true;
+#endif
+}
+#endif
+
+/* kernel sets in order of vector width, narrowest first */
+static const stress_stream_simd_t stream_simd[] = {
+	{ "scalar",	stress_stream_simd_always,
+	  stress_stream_copy_index0, stress_stream_scale_index0,
+	  stress_stream_add_index0, stress_stream_triad_index0 },
+#if defined(HAVE_NT_STORE_DOUBLE)
+	{ "nt",		stress_cpu_x86_has_sse2,
+	  stress_stream_copy_index0_nt, stress_stream_scale_index0_nt,
+	  stress_stream_add_index0_nt, stress_stream_triad_index0_nt },
+#endif
+#if defined(HAVE_STREAM_SIMD_128)
+	{ "128",	stress_stream_simd_has_128,
+	  stress_stream_copy_v128, stress_stream_scale_v128,
+	  stress_stream_add_v128, stress_stream_triad_v128 },
+#endif
+#if defined(HAVE_STREAM_SIMD_256)
+	{ "256",	stress_cpu_x86_has_avx2,
+	  stress_stream_copy_v256, stress_stream_scale_v256,
+	  stress_stream_add_v256, stress_stream_triad_v256 },
+#endif
+#if defined(HAVE_STREAM_SIMD_512)
+	{ "512",	stress_cpu_x86_has_avx512f,
+	  stress_stream_copy_v512, stress_stream_scale_v512,
+	  stress_stream_add_v512, stress_stream_triad_v512 },
+#endif
+};
+
+static int stress_set_stream_simd(const char *opt)
+{
+	int stream_simd_index;
+	size_t i;
+
+	if (!strcmp(opt, "auto")) {
+		stream_simd_index = STREAM_SIMD_AUTO;
+		return stress_set_setting("stream-simd", TYPE_ID_INT, &stream_simd_index);
+	}
+	for (i = 0; i < SIZEOF_ARRAY(stream_simd); i++) {
+		if (!strcmp(opt, stream_simd[i].name)) {
+			stream_simd_index = (int)i;
+			return stress_set_setting("stream-simd", TYPE_ID_INT, &stream_simd_index);
+		}
+	}
+	(void)fprintf(stderr, "invalid stream-simd width '%s', allowed widths are: auto", opt);
+	for (i = 0; i < SIZEOF_ARRAY(stream_simd); i++) {
+		(void)fprintf(stderr, " %s", stream_simd[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+/*
+ *  stress_stream_simd_select()
+ *	select the non-indexed kernels; by default use the non-temporal
+ *	store kernels if available, auto picks the widest vector kernels
+ *	the CPU supports and a forced width that the CPU does not support
+ *	falls back to the next narrowest one
+ */
+static const stress_stream_simd_t *stress_stream_simd_select(
+	const stress_args_t *args,
+	const int stream_simd_index)
+{
+	int i;
+
+	if (stream_simd_index == STREAM_SIMD_DEFAULT) {
+		for (i = 0; i < (int)SIZEOF_ARRAY(stream_simd); i++) {
+			if (!strcmp(stream_simd[i].name, "nt") && stream_simd[i].supported())
+				return &stream_simd[i];
+		}
+		return &stream_simd[0];
+	}
+
+	i = (stream_simd_index == STREAM_SIMD_AUTO) ?
+		(int)SIZEOF_ARRAY(stream_simd) - 1 : stream_simd_index;
+	for (; i > 0; i--) {
+		if (stream_simd[i].supported())
+			break;
+	}
+	if ((stream_simd_index >= 0) && (i != stream_simd_index) && (args->instance == 0))
+		pr_inf("%s: %s kernels not supported by this CPU, using %s kernels\n",
+			args->name, stream_simd[stream_simd_index].name, stream_simd[i].name);
+	return &stream_simd[i];
+}
+
 static void stress_stream_init_data(
 	double *RESTRICT data,
 	const uint64_t n)
@@ -398,11 +687,11 @@ static void stress_stream_init_data(
 	}
 }
 
-static inline void *stress_stream_mmap(const stress_args_t *args, uint64_t sz)
+static inline void *stress_stream_mmap(const stress_args_t *args, size_t *sz)
 {
 	void *ptr;
 
-	ptr = mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+	ptr = stress_mem_backing_mmap(args, sz, PROT_READ | PROT_WRITE,
 #if defined(MAP_POPULATE)
 		MAP_POPULATE |
 #endif
@@ -411,11 +700,11 @@ static inline void *stress_stream_mmap(const stress_args_t *args, uint64_t sz)
 #else
 		MAP_SHARED |
 #endif
-		MAP_ANONYMOUS, -1, 0);
+		MAP_ANONYMOUS);
 	/* Coverity Scan believes NULL can be returned, doh */
 	if (!ptr || (ptr == MAP_FAILED)) {
-		pr_err("%s: cannot allocate %" PRIu64 " bytes\n",
-			args->name, sz);
+		pr_err("%s: cannot allocate %zu bytes\n",
+			args->name, *sz);
 		ptr = MAP_FAILED;
 	} else {
 #if defined(HAVE_MADVISE)
@@ -423,7 +712,7 @@ static inline void *stress_stream_mmap(const stress_args_t *args, uint64_t sz)
 
 		(void)stress_get_setting("stream-madvise", &advice);
 
-		VOID_RET(int, madvise(ptr, sz, advice));
+		VOID_RET(int, madvise(ptr, *sz, advice));
 #else
 		UNEXPECTED
 #endif
@@ -496,6 +785,245 @@ static void stress_stream_init_index(
 	}
 }
 
+/*
+ *  stress_stream_round_timed()
+ *	run copy, scale, add and triad once on non-indexed data,
+ *	adding the time taken by each kernel to t[0..3]
+ */
+static void stress_stream_round_timed(
+	double *RESTRICT a,
+	double *RESTRICT b,
+	double *RESTRICT c,
+	const double q,
+	const uint64_t n,
+	const stress_stream_simd_t *simd,
+	double t[4])
+{
+	double t0, t1;
+
+	t0 = stress_time_now();
+	simd->copy(c, a, n);
+	t1 = stress_time_now();
+	t[0] += t1 - t0;
+	simd->scale(b, c, q, n);
+	t0 = stress_time_now();
+	t[1] += t0 - t1;
+	simd->add(c, b, a, n);
+	t1 = stress_time_now();
+	t[2] += t1 - t0;
+	simd->triad(a, b, c, q, n);
+	t[3] += stress_time_now() - t1;
+}
+
+#if defined(HAVE_AFFINITY)
+/*
+ *  stress_stream_numa_cpu_nodes()
+ *	find the NUMA nodes that have CPUs
+ */
+static size_t stress_stream_numa_cpu_nodes(
+	const unsigned long *nodes,
+	const size_t n_nodes,
+	unsigned long *cpu_nodes)
+{
+	size_t i, n = 0;
+
+	for (i = 0; i < n_nodes; i++) {
+		cpu_set_t mask;
+
+		if (stress_numa_node_cpus(nodes[i], &mask) > 0)
+			cpu_nodes[n++] = nodes[i];
+	}
+	return n;
+}
+
+/*
+ *  stress_stream_numa_pin()
+ *	pin the stressor to the CPUs of a NUMA node
+ */
+static int stress_stream_numa_pin(const stress_args_t *args, const unsigned long node)
+{
+	cpu_set_t mask;
+
+	if (stress_numa_node_cpus(node, &mask) < 1)
+		return -1;
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_dbg("%s: cannot set CPU affinity to node %lu, errno=%d (%s)\n",
+			args->name, node, errno, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_stream_numa_place()
+ *	pin the instance to a node and bind the arrays to the local,
+ *	a remote or all nodes, instances are spread across the nodes
+ */
+static void stress_stream_numa_place(
+	const stress_args_t *args,
+	const int stream_numa,
+	double *a,
+	double *b,
+	double *c,
+	const uint64_t sz)
+{
+	unsigned long nodes[STRESS_NUMA_MAX_NODES], cpu_nodes[STRESS_NUMA_MAX_NODES];
+	unsigned long cpu_node, mem_node;
+	uint32_t stream_numa_node;
+	size_t n_nodes, n_cpu_nodes, i;
+	const char *where;
+	char buf[32];
+
+	n_nodes = stress_numa_mem_nodes(nodes, SIZEOF_ARRAY(nodes));
+	n_cpu_nodes = stress_stream_numa_cpu_nodes(nodes, n_nodes, cpu_nodes);
+	if (!n_nodes || !n_cpu_nodes) {
+		if (args->instance == 0)
+			pr_inf("%s: no NUMA nodes found, ignoring --stream-numa\n", args->name);
+		return;
+	}
+
+	cpu_node = cpu_nodes[args->instance % n_cpu_nodes];
+	(void)stress_stream_numa_pin(args, cpu_node);
+
+	if (stream_numa == STREAM_NUMA_INTERLEAVE) {
+		where = "interleaved on all nodes";
+		if (stress_numa_mbind_nodes(a, (size_t)sz, true, nodes, n_nodes) ||
+		    stress_numa_mbind_nodes(b, (size_t)sz, true, nodes, n_nodes) ||
+		    stress_numa_mbind_nodes(c, (size_t)sz, true, nodes, n_nodes))
+			goto mbind_fail;
+	} else {
+		mem_node = cpu_node;
+		if (stream_numa == STREAM_NUMA_REMOTE) {
+			if (stress_get_setting("stream-numa-node", &stream_numa_node)) {
+				mem_node = (unsigned long)stream_numa_node;
+			} else {
+				/* default to the next node with memory */
+				for (i = 0; i < n_nodes; i++) {
+					if (nodes[i] == cpu_node) {
+						mem_node = nodes[(i + 1) % n_nodes];
+						break;
+					}
+				}
+			}
+		}
+		(void)snprintf(buf, sizeof(buf), "on node %lu", mem_node);
+		where = buf;
+		if (stress_numa_mbind_nodes(a, (size_t)sz, false, &mem_node, 1) ||
+		    stress_numa_mbind_nodes(b, (size_t)sz, false, &mem_node, 1) ||
+		    stress_numa_mbind_nodes(c, (size_t)sz, false, &mem_node, 1))
+			goto mbind_fail;
+	}
+	pr_dbg("%s: instance %" PRIu32 " running on node %lu, memory %s\n",
+		args->name, args->instance, cpu_node, where);
+	return;
+
+mbind_fail:
+	pr_inf("%s: cannot bind memory %s, errno=%d (%s)\n",
+		args->name, where, errno, strerror(errno));
+}
+
+/*
+ *  stress_stream_numa_matrix()
+ *	measure the copy, scale, add and triad bandwidth for each
+ *	pair of CPU node and memory node and report it as a matrix
+ */
+static void stress_stream_numa_matrix(
+	const stress_args_t *args,
+	double *a,
+	double *b,
+	double *c,
+	const double q,
+	const uint64_t sz,
+	const uint64_t n,
+	const stress_stream_simd_t *simd)
+{
+	static const char * const kernels[] = { "copy", "scale", "add", "triad" };
+	/* bytes moved per element by each kernel */
+	static const double kernel_bytes[] = { 2.0, 2.0, 3.0, 3.0 };
+	unsigned long nodes[STRESS_NUMA_MAX_NODES], cpu_nodes[STRESS_NUMA_MAX_NODES];
+	size_t n_nodes, n_cpu_nodes, i, j, k;
+	double *rates, slice;
+	cpu_set_t saved_mask;
+	bool saved;
+
+	n_nodes = stress_numa_mem_nodes(nodes, SIZEOF_ARRAY(nodes));
+	n_cpu_nodes = stress_stream_numa_cpu_nodes(nodes, n_nodes, cpu_nodes);
+	if (!n_nodes || !n_cpu_nodes) {
+		if (args->instance == 0)
+			pr_inf("%s: no NUMA nodes found, ignoring --stream-numa\n", args->name);
+		return;
+	}
+
+	rates = calloc(SIZEOF_ARRAY(kernels) * n_cpu_nodes * n_nodes, sizeof(*rates));
+	if (!rates) {
+		pr_inf("%s: cannot allocate NUMA bandwidth matrix, skipping it\n", args->name);
+		return;
+	}
+	saved = (sched_getaffinity(0, sizeof(saved_mask), &saved_mask) == 0);
+
+	/* share the run time between the matrix cells */
+	slice = g_opt_timeout ? (double)g_opt_timeout / (double)(2 * n_cpu_nodes * n_nodes) : 1.0;
+	slice = STRESS_MINIMUM(STRESS_MAXIMUM(slice, 0.1), 5.0);
+
+	for (i = 0; i < n_cpu_nodes; i++) {
+		if (stress_stream_numa_pin(args, cpu_nodes[i]) < 0)
+			continue;
+		for (j = 0; j < n_nodes; j++) {
+			double t[4] = { 0.0, 0.0, 0.0, 0.0 };
+			double t_end;
+			uint64_t rounds = 0;
+
+			if (stress_numa_mbind_nodes(a, (size_t)sz, false, &nodes[j], 1) ||
+			    stress_numa_mbind_nodes(b, (size_t)sz, false, &nodes[j], 1) ||
+			    stress_numa_mbind_nodes(c, (size_t)sz, false, &nodes[j], 1))
+				continue;
+
+			t_end = stress_time_now() + slice;
+			do {
+				stress_stream_round_timed(a, b, c, q, n, simd, t);
+				rounds++;
+				inc_counter(args);
+			} while (keep_stressing(args) && (stress_time_now() < t_end));
+
+			for (k = 0; k < SIZEOF_ARRAY(kernels); k++) {
+				const double bytes = kernel_bytes[k] * (double)sz * (double)rounds;
+
+				rates[(k * n_cpu_nodes + i) * n_nodes + j] =
+					(t[k] > 0.0) ? bytes / (t[k] * (double)MB) : 0.0;
+			}
+			if (!keep_stressing(args))
+				goto done;
+		}
+	}
+done:
+	if (saved)
+		(void)sched_setaffinity(0, sizeof(saved_mask), &saved_mask);
+
+	if (args->instance == 0) {
+		for (k = 0; k < SIZEOF_ARRAY(kernels); k++) {
+			char line[32 + (STRESS_NUMA_MAX_NODES * 12)];
+			size_t len;
+
+			pr_inf("%s: %s bandwidth (MB/sec), CPU node (rows) to memory node (columns):\n",
+				args->name, kernels[k]);
+			len = (size_t)snprintf(line, sizeof(line), "%8s", "");
+			for (j = 0; j < n_nodes; j++)
+				len += (size_t)snprintf(line + len, sizeof(line) - len,
+					" %11lu", nodes[j]);
+			pr_inf("%s: %s\n", args->name, line);
+			for (i = 0; i < n_cpu_nodes; i++) {
+				len = (size_t)snprintf(line, sizeof(line), "%8lu", cpu_nodes[i]);
+				for (j = 0; j < n_nodes; j++)
+					len += (size_t)snprintf(line + len, sizeof(line) - len,
+						" %11.2f", rates[(k * n_cpu_nodes + i) * n_nodes + j]);
+				pr_inf("%s: %s\n", args->name, line);
+			}
+		}
+	}
+	free(rates);
+}
+#endif
+
 /*
  *  stress_stream()
  *	stress cache/memory/CPU with stream stressors
@@ -509,11 +1037,12 @@ static int stress_stream(const stress_args_t *args)
 	double mb_rate, mb, fp_rate, fp, t1, t2, dt;
 	uint32_t stream_index = 0;
 	uint64_t L3, sz, n, sz_idx;
+	size_t sz_a, sz_b, sz_c, sz_idx1, sz_idx2, sz_idx3;
 	uint64_t stream_L3_size = DEFAULT_STREAM_L3_SIZE;
+	int stream_numa = STREAM_NUMA_NONE;
 	bool guess = false;
-#if defined(HAVE_NT_STORE_DOUBLE)
-	const bool has_sse2 = stress_cpu_x86_has_sse2();
-#endif
+	int stream_simd_index = STREAM_SIMD_DEFAULT;
+	const stress_stream_simd_t *simd;
 
 	if (stress_get_setting("stream-L3-size", &stream_L3_size))
 		L3 = stream_L3_size;
@@ -521,6 +1050,10 @@ static int stress_stream(const stress_args_t *args)
 		L3 = get_stream_L3_size(args);
 
 	(void)stress_get_setting("stream-index", &stream_index);
+	(void)stress_get_setting("stream-numa", &stream_numa);
+	(void)stress_get_setting("stream-simd", &stream_simd_index);
+
+	simd = stress_stream_simd_select(args, stream_simd_index);
 
 	/* Have to take a hunch and badly guess size */
 	if (!L3) {
@@ -541,6 +1074,9 @@ static int stress_stream(const stress_args_t *args)
 			pr_inf("%s: Using CPU cache size of %" PRIu64 "K\n",
 				args->name, L3 / 1024);
 		}
+		if (stream_index == 0)
+			pr_inf("%s: using %s copy, scale, add and triad kernels\n",
+				args->name, simd->name);
 	}
 
 	/* ..and shared amongst all the STREAM stressor instances */
@@ -554,33 +1090,39 @@ static int stress_stream(const stress_args_t *args)
 	 */
 	sz = (L3 * 4);
 	n = sz / sizeof(*a);
+	sz_a = (size_t)sz;
+	sz_b = (size_t)sz;
+	sz_c = (size_t)sz;
 
-	a = stress_stream_mmap(args, sz);
+	a = stress_stream_mmap(args, &sz_a);
 	if (a == MAP_FAILED)
 		goto err_a;
-	b = stress_stream_mmap(args, sz);
+	b = stress_stream_mmap(args, &sz_b);
 	if (b == MAP_FAILED)
 		goto err_b;
-	c = stress_stream_mmap(args, sz);
+	c = stress_stream_mmap(args, &sz_c);
 	if (c == MAP_FAILED)
 		goto err_c;
 
 	sz_idx = n * sizeof(size_t);
+	sz_idx1 = (size_t)sz_idx;
+	sz_idx2 = (size_t)sz_idx;
+	sz_idx3 = (size_t)sz_idx;
 	switch (stream_index) {
 	case 3:
-		idx3 = stress_stream_mmap(args, sz_idx);
+		idx3 = stress_stream_mmap(args, &sz_idx3);
 		if (idx3 == MAP_FAILED)
 			goto err_idx3;
 		stress_stream_init_index(idx3, n);
 		CASE_FALLTHROUGH;
 	case 2:
-		idx2 = stress_stream_mmap(args, sz_idx);
+		idx2 = stress_stream_mmap(args, &sz_idx2);
 		if (idx2 == MAP_FAILED)
 			goto err_idx2;
 		stress_stream_init_index(idx2, n);
 		CASE_FALLTHROUGH;
 	case 1:
-		idx1 = stress_stream_mmap(args, sz_idx);
+		idx1 = stress_stream_mmap(args, &sz_idx1);
 		if (idx1 == MAP_FAILED)
 			goto err_idx1;
 		stress_stream_init_index(idx1, n);
@@ -590,6 +1132,11 @@ static int stress_stream(const stress_args_t *args)
 		break;
 	}
 
+#if defined(HAVE_AFFINITY)
+	if ((stream_numa != STREAM_NUMA_NONE) && (stream_numa != STREAM_NUMA_MATRIX))
+		stress_stream_numa_place(args, stream_numa, a, b, c, sz);
+#endif
+
 	stress_stream_init_data(a, n);
 	stress_stream_init_data(b, n);
 	stress_stream_init_data(c, n);
@@ -597,6 +1144,13 @@ static int stress_stream(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	t1 = stress_time_now();
+#if defined(HAVE_AFFINITY)
+	if (stream_numa == STREAM_NUMA_MATRIX)
+		stress_stream_numa_matrix(args, a, b, c, q, sz, n, simd);
+#else
+	if ((stream_numa != STREAM_NUMA_NONE) && (args->instance == 0))
+		pr_inf("%s: CPU affinity not supported, ignoring --stream-numa\n", args->name);
+#endif
 	do {
 		switch (stream_index) {
 		case 3:
@@ -619,19 +1173,10 @@ static int stress_stream(const stress_args_t *args)
 			break;
 		case 0:
 		default:
-#if defined(HAVE_NT_STORE_DOUBLE)
-			if (has_sse2) {
-				stress_stream_copy_index0_nt(c, a, n);
-				stress_stream_scale_index0_nt(b, c, q, n);
-				stress_stream_add_index0_nt(c, b, a, n);
-				stress_stream_triad_index0_nt(a, b, c, q, n);
-				break;
-			}
-#endif
-			stress_stream_copy_index0(c, a, n);
-			stress_stream_scale_index0(b, c, q, n);
-			stress_stream_add_index0(c, b, a, n);
-			stress_stream_triad_index0(a, b, c, q, n);
+			simd->copy(c, a, n);
+			simd->scale(b, c, q, n);
+			simd->add(c, b, a, n);
+			simd->triad(a, b, c, q, n);
 			break;
 		}
 		inc_counter(args);
@@ -659,24 +1204,24 @@ static int stress_stream(const stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	if (idx3)
-		(void)munmap((void *)idx3, sz_idx);
+		(void)munmap((void *)idx3, sz_idx3);
 err_idx3:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	if (idx2)
-		(void)munmap((void *)idx2, sz_idx);
+		(void)munmap((void *)idx2, sz_idx2);
 err_idx2:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	if (idx1)
-		(void)munmap((void *)idx1, sz_idx);
+		(void)munmap((void *)idx1, sz_idx1);
 err_idx1:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	(void)munmap((void *)c, sz);
+	(void)munmap((void *)c, sz_c);
 err_c:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	(void)munmap((void *)b, sz);
+	(void)munmap((void *)b, sz_b);
 err_b:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	(void)munmap((void *)a, sz);
+	(void)munmap((void *)a, sz_a);
 err_a:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -687,6 +1232,9 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_stream_index,	stress_set_stream_index },
 	{ OPT_stream_l3_size,	stress_set_stream_L3_size },
 	{ OPT_stream_madvise,	stress_set_stream_madvise },
+	{ OPT_stream_numa,	stress_set_stream_numa },
+	{ OPT_stream_numa_node,	stress_set_stream_numa_node },
+	{ OPT_stream_simd,	stress_set_stream_simd },
 	{ 0,			NULL }
 };
 
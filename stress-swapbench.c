@@ -0,0 +1,545 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+
+#define MIN_SWAPBENCH_BYTES	(1 * MB)
+#define MAX_SWAPBENCH_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_SWAPBENCH_BYTES	(64 * MB)
+
+#define MIN_SWAPBENCH_THREADS	(1)
+#define MAX_SWAPBENCH_THREADS	(256)
+#define DEFAULT_SWAPBENCH_THREADS (4)
+
+#define MIN_SWAPBENCH_PAGE_CLUSTER	(0)
+#define MAX_SWAPBENCH_PAGE_CLUSTER	(10)
+
+static const stress_help_t help[] = {
+	{ NULL,	"swapbench N",		"start N workers measuring swap in throughput and major fault latency" },
+	{ NULL,	"swapbench-bytes N",	"size of the working set paged out and back in, default 64M" },
+	{ NULL,	"swapbench-ops N",	"stop after N pages swapped back in" },
+	{ NULL,	"swapbench-page-cluster N", "set vm.page-cluster to N while running, 0 disables swap readahead" },
+	{ NULL,	"swapbench-pattern P",	"touch pages back in seq, rand or both" },
+	{ NULL,	"swapbench-threads N",	"sweep 1, 2, 4 .. N threads touching pages back in, default 4" },
+	{ NULL,	NULL,			NULL }
+};
+
+#define SWAPBENCH_SEQ		(1)	/* touch pages in address order */
+#define SWAPBENCH_RAND		(2)	/* touch pages in a random order */
+
+static const char * const swapbench_patterns[] = {
+	"both",
+	"seq",
+	"rand",
+};
+
+#define SWAPBENCH_PATTERNS	(SIZEOF_ARRAY(swapbench_patterns))
+
+static int stress_set_swapbench_bytes(const char *opt)
+{
+	size_t swapbench_bytes;
+
+	swapbench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("swapbench-bytes", swapbench_bytes,
+		MIN_SWAPBENCH_BYTES, MAX_SWAPBENCH_BYTES);
+	return stress_set_setting("swapbench-bytes", TYPE_ID_SIZE_T, &swapbench_bytes);
+}
+
+static int stress_set_swapbench_page_cluster(const char *opt)
+{
+	uint32_t swapbench_page_cluster;
+
+	swapbench_page_cluster = stress_get_uint32(opt);
+	stress_check_range("swapbench-page-cluster", (uint64_t)swapbench_page_cluster,
+		MIN_SWAPBENCH_PAGE_CLUSTER, MAX_SWAPBENCH_PAGE_CLUSTER);
+	return stress_set_setting("swapbench-page-cluster", TYPE_ID_UINT32, &swapbench_page_cluster);
+}
+
+static int stress_set_swapbench_pattern(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SWAPBENCH_PATTERNS; i++) {
+		if (!strcmp(opt, swapbench_patterns[i]))
+			return stress_set_setting("swapbench-pattern", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "swapbench-pattern must be one of:");
+	for (i = 0; i < SWAPBENCH_PATTERNS; i++)
+		(void)fprintf(stderr, " %s", swapbench_patterns[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_swapbench_threads(const char *opt)
+{
+	uint32_t swapbench_threads;
+
+	swapbench_threads = stress_get_uint32(opt);
+	stress_check_range("swapbench-threads", (uint64_t)swapbench_threads,
+		MIN_SWAPBENCH_THREADS, MAX_SWAPBENCH_THREADS);
+	return stress_set_setting("swapbench-threads", TYPE_ID_UINT32, &swapbench_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_swapbench_bytes,		stress_set_swapbench_bytes },
+	{ OPT_swapbench_page_cluster,	stress_set_swapbench_page_cluster },
+	{ OPT_swapbench_pattern,	stress_set_swapbench_pattern },
+	{ OPT_swapbench_threads,	stress_set_swapbench_threads },
+	{ 0,				NULL }
+};
+
+#if defined(__linux__) &&		\
+    defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_MADVISE) &&		\
+    defined(MADV_PAGEOUT) &&		\
+    defined(HAVE_GETRUSAGE) &&		\
+    defined(HAVE_RUSAGE_RU_MINFLT)
+
+#define SWAPBENCH_STEPS		(9)	/* 1, 2, 4 .. N threads */
+
+struct stress_swapbench;
+
+/* a thread touching a slice of the working set back in */
+typedef struct {
+	struct stress_swapbench *sb;	/* shared state */
+	pthread_t pthread;
+	int	ret;			/* pthread_create return */
+	size_t	lo;			/* first entry of the touch order */
+	size_t	hi;			/* end of the slice */
+	bool	corrupt;		/* page came back with wrong contents */
+} ALIGN64 stress_swapbench_thread_t;
+
+typedef struct stress_swapbench {
+	uint8_t	*buf;			/* working set */
+	size_t	page_size;
+	uint32_t *order;		/* page indexes in touch order */
+	uint64_t *latencies;		/* touch latency of each order entry */
+	volatile bool start;		/* threads may start */
+} stress_swapbench_t;
+
+typedef struct {
+	uint32_t threads;
+	double	swapout_rate;		/* MADV_PAGEOUT bytes/sec */
+	double	swapin_rate;		/* touch back in bytes/sec */
+	uint64_t majflt;		/* major faults taken */
+	uint64_t pswpin;		/* pages read from swap, including readahead */
+	uint64_t p50;			/* all touches */
+	uint64_t maj_p50;		/* the slowest majflt touches */
+	uint64_t maj_p99;
+	uint64_t max;
+	bool	valid;
+} stress_swapbench_stats_t;
+
+/*
+ *  stress_swapbench_vmstat()
+ *	read the pages swapped in and out and the pages under
+ *	writeback from /proc/vmstat
+ */
+static void stress_swapbench_vmstat(uint64_t *pswpin, uint64_t *pswpout, uint64_t *writeback)
+{
+	FILE *fp;
+	char buf[128];
+
+	*pswpin = 0;
+	*pswpout = 0;
+	*writeback = 0;
+	fp = fopen("/proc/vmstat", "r");
+	if (!fp)
+		return;
+	while (fgets(buf, sizeof(buf), fp)) {
+		unsigned long long val;
+
+		if (sscanf(buf, "pswpin %llu", &val) == 1)
+			*pswpin = (uint64_t)val;
+		else if (sscanf(buf, "pswpout %llu", &val) == 1)
+			*pswpout = (uint64_t)val;
+		else if (sscanf(buf, "nr_writeback %llu", &val) == 1)
+			*writeback = (uint64_t)val;
+	}
+	(void)fclose(fp);
+}
+
+static uint64_t stress_swapbench_majflt(void)
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return (uint64_t)usage.ru_majflt;
+	return 0;
+}
+
+/*
+ *  stress_swapbench_thread()
+ *	touch a slice of the touch order back in, timing each read
+ *	and checking each page kept its index stamp
+ */
+static void *stress_swapbench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_swapbench_thread_t *t = (stress_swapbench_thread_t *)arg;
+	const stress_swapbench_t *sb = t->sb;
+	size_t i;
+
+	while (!sb->start)
+		(void)shim_sched_yield();
+
+	for (i = t->lo; i < t->hi; i++) {
+		const uint32_t page = sb->order[i];
+		volatile uint32_t *ptr = (volatile uint32_t *)(sb->buf + ((size_t)page * sb->page_size));
+		uint64_t t1, t2;
+		uint32_t val;
+
+		t1 = stress_clock_ns();
+		val = *ptr;
+		t2 = stress_clock_ns();
+		sb->latencies[i] = t2 - t1;
+		if (val != page)
+			t->corrupt = true;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_swapbench_map()
+ *	map a fresh working set of random data that does not compress
+ *	or merge, each page stamped with its index. A fresh mapping
+ *	each step frees the swap slots of the previous one
+ */
+static int stress_swapbench_map(stress_swapbench_t *sb, const size_t n_pages)
+{
+	const size_t bytes = n_pages * sb->page_size;
+	size_t i;
+
+	sb->buf = (uint8_t *)mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (sb->buf == MAP_FAILED) {
+		sb->buf = NULL;
+		return -1;
+	}
+#if defined(MADV_NOHUGEPAGE)
+	VOID_RET(int, madvise((void *)sb->buf, bytes, MADV_NOHUGEPAGE));
+#endif
+	for (i = 0; i < n_pages; i++) {
+		uint8_t *page = sb->buf + (i * sb->page_size);
+
+		stress_mwc_fill(page, sb->page_size);
+		*(uint32_t *)page = (uint32_t)i;
+	}
+	return 0;
+}
+
+static int stress_swapbench_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_swapbench_step()
+ *	page the working set out and touch it back in with n_threads
+ *	threads, returns -1 if no pages went out to swap, -2 if the
+ *	pages came back corrupted and -3 if out of memory
+ */
+static int stress_swapbench_step(
+	const stress_args_t *args,
+	stress_swapbench_t *sb,
+	stress_swapbench_thread_t *threads,
+	const size_t n_pages,
+	const size_t pattern,
+	const uint32_t n_threads,
+	stress_swapbench_stats_t *stats)
+{
+	const size_t bytes = n_pages * sb->page_size;
+	uint64_t pswpin1, pswpout1, pswpin2, pswpout2, writeback, majflt;
+	double t1, t2;
+	size_t i, n;
+	uint32_t started = 0;
+	bool corrupt = false;
+
+	/* the touch order, random steps shuffle each thread's slice */
+	for (i = 0; i < n_pages; i++)
+		sb->order[i] = (uint32_t)i;
+	if (pattern == SWAPBENCH_RAND) {
+		for (i = n_pages - 1; i > 0; i--) {
+			const size_t j = (size_t)stress_mwc32() % (i + 1);
+			const uint32_t tmp = sb->order[i];
+
+			sb->order[i] = sb->order[j];
+			sb->order[j] = tmp;
+		}
+	}
+
+	if (stress_swapbench_map(sb, n_pages) < 0)
+		return -3;
+	stress_swapbench_vmstat(&pswpin1, &pswpout1, &writeback);
+	t1 = stress_time_now();
+	if (madvise((void *)sb->buf, bytes, MADV_PAGEOUT) < 0) {
+		(void)munmap((void *)sb->buf, bytes);
+		return -1;
+	}
+	/* swap out is complete once the writeback has drained */
+	do {
+		stress_swapbench_vmstat(&pswpin2, &pswpout2, &writeback);
+		if (!writeback)
+			break;
+		(void)shim_usleep(1000);
+	} while (stress_time_now() < t1 + 2.0);
+	t2 = stress_time_now();
+	if (pswpout2 - pswpout1 < n_pages / 4) {
+		(void)munmap((void *)sb->buf, bytes);
+		return -1;
+	}
+	stats->swapout_rate = (t2 > t1) ? (double)bytes / (t2 - t1) : 0.0;
+
+	sb->start = false;
+	(void)memset(threads, 0, sizeof(*threads) * n_threads);
+	n = n_pages / n_threads;
+	for (i = 0; i < n_threads; i++) {
+		stress_swapbench_thread_t *t = &threads[i];
+
+		t->sb = sb;
+		t->lo = i * n;
+		t->hi = (i == n_threads - 1) ? n_pages : t->lo + n;
+		t->ret = pthread_create(&t->pthread, NULL, stress_swapbench_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+
+	majflt = stress_swapbench_majflt();
+	stress_swapbench_vmstat(&pswpin1, &pswpout1, &writeback);
+	t1 = stress_time_now();
+	sb->start = true;
+	/* touch the pages of threads that could not be started */
+	if (started < n_threads) {
+		stress_swapbench_thread_t t;
+
+		(void)memset(&t, 0, sizeof(t));
+		t.sb = sb;
+		t.lo = started * n;
+		t.hi = n_pages;
+		(void)stress_swapbench_thread((void *)&t);
+		corrupt |= t.corrupt;
+	}
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		corrupt |= threads[i].corrupt;
+	}
+	t2 = stress_time_now();
+	stress_swapbench_vmstat(&pswpin2, &pswpout2, &writeback);
+	majflt = stress_swapbench_majflt() - majflt;
+	add_counter(args, (uint64_t)n_pages);
+	(void)munmap((void *)sb->buf, bytes);
+
+	if (corrupt) {
+		pr_fail("%s: pages swapped back in did not contain the data swapped out\n",
+			args->name);
+		return -2;
+	}
+
+	/* the slowest majflt touches are taken to be the major faults */
+	qsort(sb->latencies, n_pages, sizeof(*sb->latencies), stress_swapbench_cmp);
+	if (majflt > n_pages)
+		majflt = n_pages;
+	stats->threads = n_threads;
+	stats->swapin_rate = (t2 > t1) ? (double)bytes / (t2 - t1) : 0.0;
+	stats->majflt = majflt;
+	stats->pswpin = pswpin2 - pswpin1;
+	stats->p50 = sb->latencies[n_pages / 2];
+	stats->max = sb->latencies[n_pages - 1];
+	if (majflt) {
+		const uint64_t *maj = sb->latencies + (n_pages - majflt);
+
+		stats->maj_p50 = maj[majflt / 2];
+		stats->maj_p99 = maj[(majflt * 99) / 100];
+	} else {
+		stats->maj_p50 = 0;
+		stats->maj_p99 = 0;
+	}
+	stats->valid = true;
+	return 0;
+}
+
+/*
+ *  stress_swapbench()
+ *	measure swap out and swap in throughput and major fault
+ *	latency of a working set paged out with MADV_PAGEOUT
+ */
+static int stress_swapbench(const stress_args_t *args)
+{
+	static stress_swapbench_stats_t stats[SWAPBENCH_PATTERNS][SWAPBENCH_STEPS];
+	static const char page_cluster_path[] = "/proc/sys/vm/page-cluster";
+	stress_swapbench_t sb;
+	stress_swapbench_thread_t *threads;
+	size_t swapbench_bytes = DEFAULT_SWAPBENCH_BYTES;
+	size_t swapbench_pattern = 0, n_pages, p, idx = 0;
+	uint32_t swapbench_threads = DEFAULT_SWAPBENCH_THREADS;
+	uint32_t swapbench_page_cluster, steps[SWAPBENCH_STEPS], n_steps = 0, s;
+	char old_page_cluster[16];
+	bool restore_page_cluster = false;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("swapbench-pattern", &swapbench_pattern);
+	if (!stress_get_setting("swapbench-bytes", &swapbench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			swapbench_bytes = 1 * GB;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			swapbench_bytes = MIN_SWAPBENCH_BYTES;
+	}
+	if (!stress_get_setting("swapbench-threads", &swapbench_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			swapbench_threads = MAX_SWAPBENCH_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			swapbench_threads = MIN_SWAPBENCH_THREADS;
+	}
+	swapbench_bytes /= args->num_instances;
+	if (swapbench_bytes < MIN_SWAPBENCH_BYTES)
+		swapbench_bytes = MIN_SWAPBENCH_BYTES;
+	n_pages = swapbench_bytes / args->page_size;
+	swapbench_bytes = n_pages * args->page_size;
+
+	for (s = 1; (s < swapbench_threads) && (n_steps < SWAPBENCH_STEPS - 1); s <<= 1)
+		steps[n_steps++] = s;
+	steps[n_steps++] = swapbench_threads;
+
+	/* vm.page-cluster is system wide, the first instance sets and restores it */
+	if (stress_get_setting("swapbench-page-cluster", &swapbench_page_cluster) &&
+	    (args->instance == 0)) {
+		char buf[16];
+
+		(void)memset(old_page_cluster, 0, sizeof(old_page_cluster));
+		(void)snprintf(buf, sizeof(buf), "%" PRIu32, swapbench_page_cluster);
+		if ((system_read(page_cluster_path, old_page_cluster,
+				 sizeof(old_page_cluster) - 1) > 0) &&
+		    (system_write(page_cluster_path, buf, strlen(buf)) > 0)) {
+			restore_page_cluster = true;
+		} else {
+			pr_inf("%s: cannot set %s to %" PRIu32 ", errno=%d (%s)\n",
+				args->name, page_cluster_path, swapbench_page_cluster,
+				errno, strerror(errno));
+		}
+	}
+
+	(void)memset(&sb, 0, sizeof(sb));
+	(void)memset(stats, 0, sizeof(stats));
+	sb.page_size = args->page_size;
+	sb.order = (uint32_t *)calloc(n_pages, sizeof(*sb.order));
+	sb.latencies = (uint64_t *)calloc(n_pages, sizeof(*sb.latencies));
+	threads = (stress_swapbench_thread_t *)calloc(swapbench_threads, sizeof(*threads));
+	if (!sb.order || !sb.latencies || !threads) {
+		pr_inf_skip("%s: cannot allocate a %zu byte working set, skipping stressor\n",
+			args->name, swapbench_bytes);
+		rc = EXIT_NO_RESOURCE;
+		goto free_all;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (p = 1; (p < SWAPBENCH_PATTERNS) && keep_stressing(args); p++) {
+			if (swapbench_pattern && (swapbench_pattern != p))
+				continue;
+			for (s = 0; (s < n_steps) && keep_stressing(args); s++) {
+				const int ret = stress_swapbench_step(args, &sb, threads,
+					n_pages, p, steps[s], &stats[p][s]);
+
+				if (ret == -2) {
+					rc = EXIT_FAILURE;
+					goto report;
+				}
+				if (ret == -3) {
+					/* out of memory, try again later */
+					(void)shim_usleep(100000);
+					continue;
+				}
+				if (ret < 0) {
+					pr_inf_skip("%s: pages were not paged out, is swap "
+						"enabled? skipping stressor\n", args->name);
+					rc = EXIT_NO_RESOURCE;
+					stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+					goto free_all;
+				}
+			}
+		}
+	} while (keep_stressing(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-4s %7s %10s %10s %9s %9s %9s %11s %11s %11s\n", args->name,
+			"", "threads", "out MB/s", "in MB/s", "majflt", "pswpin",
+			"p50 ns", "majflt p50", "majflt p99", "max ns");
+	for (p = 1; p < SWAPBENCH_PATTERNS; p++) {
+		for (s = 0; s < n_steps; s++) {
+			const stress_swapbench_stats_t *st = &stats[p][s];
+
+			if (!st->valid)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %-4s %7" PRIu32 " %10.1f %10.1f %9" PRIu64
+					" %9" PRIu64 " %9" PRIu64 " %11" PRIu64 " %11" PRIu64
+					" %11" PRIu64 "\n", args->name,
+					swapbench_patterns[p], st->threads,
+					st->swapout_rate / (double)MB, st->swapin_rate / (double)MB,
+					st->majflt, st->pswpin, st->p50, st->maj_p50,
+					st->maj_p99, st->max);
+		}
+		/* single threaded swap in rate and major fault latency */
+		if (stats[p][0].valid && (idx + 1 < STRESS_MISC_STATS_MAX)) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s swap in MB/sec",
+				swapbench_patterns[p]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				stats[p][0].swapin_rate / (double)MB);
+			(void)snprintf(desc, sizeof(desc), "%s majflt p99 ns",
+				swapbench_patterns[p]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				(double)stats[p][0].maj_p99);
+		}
+	}
+
+free_all:
+	if (restore_page_cluster)
+		VOID_RET(ssize_t, system_write(page_cluster_path, old_page_cluster,
+			strlen(old_page_cluster)));
+	free(threads);
+	free(sb.latencies);
+	free(sb.order);
+
+	return rc;
+}
+
+stressor_info_t stress_swapbench_info = {
+	.stressor = stress_swapbench,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_swapbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
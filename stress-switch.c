@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
+#include "core-net.h"
 
 #if defined(HAVE_MQUEUE_H)
 #include <mqueue.h>
@@ -31,11 +33,16 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ "s N","switch N",	 	"start N workers doing rapid context switches" },
 	{ NULL,	"switch-ops N",	 	"stop after N context switch bogo operations" },
 	{ NULL, "switch-freq N", 	"set frequency of context switches" },
-	{ NULL, "switch-method M",	"mq | pipe | sem-sysv" },
+	{ NULL, "switch-matrix",	"report round trip latency over CPU placements" },
+	{ NULL, "switch-method M",	"eventfd | futex | mq | pipe | sem-sysv" },
 	{ NULL, NULL, 		 NULL }
 };
 
@@ -46,6 +53,43 @@ typedef struct {
 } stress_switch_method_t;
 
 #define THRESH_FREQ	(100)		/* Delay adjustment rate in HZ */
+#define MATRIX_STEP	(0.2)		/* seconds per matrix cell */
+
+/* ping-pong state, each side blocks until the other wakes it */
+typedef struct {
+	int fds[4];
+	int sem_id;
+	uint32_t *futex;
+#if defined(HAVE_MQUEUE_H) &&   \
+    defined(HAVE_LIB_RT) &&     \
+    defined(HAVE_MQ_POSIX)
+	mqd_t mq[2];
+	char mq_name[2][64];
+#endif
+} stress_switch_pp_t;
+
+/* ping-pong round trip methods */
+typedef struct {
+	const char *name;
+	int (*open)(const stress_args_t *args, stress_switch_pp_t *pp);
+	int (*ping)(stress_switch_pp_t *pp);	/* wake the child, wait for reply */
+	int (*pong)(stress_switch_pp_t *pp);	/* wait for the parent, reply */
+	void (*close)(stress_switch_pp_t *pp);
+} stress_switch_pp_method_t;
+
+/* placements swept by the matrix */
+static const int switch_placements[] = {
+	NET_PLACEMENT_SAME_CPU,
+	NET_PLACEMENT_SMT,
+	NET_PLACEMENT_LLC,
+	NET_PLACEMENT_SOCKET,
+	NET_PLACEMENT_CROSS_SOCKET,
+};
+
+static int stress_set_switch_matrix(const char *opt)
+{
+	return stress_set_setting_true("switch-matrix", opt);
+}
 
 /*
  *  stress_set_switch_freq()
@@ -66,7 +110,7 @@ static int stress_set_switch_freq(const char *opt)
  */
 static void stress_switch_rate(
 	const stress_args_t *args,
-	char *method,
+	const char *method,
 	const double t_start,
 	const double t_end,
 	uint64_t counter)
@@ -226,9 +270,11 @@ again:
 		t_start = stress_time_now();
 		do {
 			ssize_t ret;
+			uint64_t t;
 
 			inc_counter(args);
 
+			t = stress_latency_now();
 			ret = write(pipefds[1], buf, sizeof(buf));
 			if (ret <= 0) {
 				if ((errno == EAGAIN) || (errno == EINTR))
@@ -242,12 +288,14 @@ again:
 				}
 				continue;
 			}
+			stress_latency_record(args->latency, stress_latency_now() - t);
 
 			if (switch_freq)
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
 		} while (keep_stressing(args));
 
 		stress_switch_rate(args, "pipe", t_start, stress_time_now(), get_counter(args));
+		stress_latency_misc_stats(args, 0, "pipe write");
 
 		(void)close(pipefds[0]);
 
@@ -332,6 +380,8 @@ again:
 		/* Parent */
 		t_start = stress_time_now();
 		do {
+			uint64_t t;
+
 			inc_counter(args);
 
 			sem.sem_num = 0;
@@ -346,15 +396,18 @@ again:
 
 			if (!keep_stressing(args))
 				break;
+			t = stress_latency_now();
 			sem.sem_num = 0;
 			sem.sem_op = -1;
 			sem.sem_flg = SEM_UNDO;
 
 			if (semop(sem_id, &sem, 1) < 0)
 				break;
+			stress_latency_record(args->latency, stress_latency_now() - t);
 		} while (keep_stressing(args));
 
 		stress_switch_rate(args, "sem-sysv", t_start, stress_time_now(), 2 * get_counter(args));
+		stress_latency_misc_stats(args, 0, "sem wait");
 
 		(void)kill(pid, SIGKILL);
 		(void)shim_waitpid(pid, &status, 0);
@@ -435,16 +488,20 @@ again:
 		t_start = stress_time_now();
 		do {
 			unsigned int prio;
+			uint64_t t;
 
 			inc_counter(args);
+			t = stress_latency_now();
 			if (mq_receive(mq, (char *)&msg, sizeof(msg), &prio) < 0)
 				break;
+			stress_latency_record(args->latency, stress_latency_now() - t);
 
 			if (switch_freq)
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
 		} while (keep_stressing(args));
 
 		stress_switch_rate(args, "mq", t_start, stress_time_now(), get_counter(args));
+		stress_latency_misc_stats(args, 0, "mq receive");
 
 		(void)kill(pid, SIGKILL);
 		(void)shim_waitpid(pid, &status, 0);
@@ -459,7 +516,547 @@ finish:
 }
 #endif
 
+/*
+ *  pipe ping-pong, a pipe in each direction
+ */
+static int stress_switch_pp_pipe_open(const stress_args_t *args, stress_switch_pp_t *pp)
+{
+	if (pipe(&pp->fds[0]) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	if (pipe(&pp->fds[2]) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(pp->fds[0]);
+		(void)close(pp->fds[1]);
+		return -1;
+	}
+	return 0;
+}
+
+static int stress_switch_pp_pipe_ping(stress_switch_pp_t *pp)
+{
+	char ch = '_';
+
+	if (write(pp->fds[1], &ch, sizeof(ch)) != sizeof(ch))
+		return -1;
+	return (read(pp->fds[2], &ch, sizeof(ch)) == sizeof(ch)) ? 0 : -1;
+}
+
+static int stress_switch_pp_pipe_pong(stress_switch_pp_t *pp)
+{
+	char ch;
+
+	if (read(pp->fds[0], &ch, sizeof(ch)) != sizeof(ch))
+		return -1;
+	return (write(pp->fds[3], &ch, sizeof(ch)) == sizeof(ch)) ? 0 : -1;
+}
+
+static void stress_switch_pp_pipe_close(stress_switch_pp_t *pp)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		(void)close(pp->fds[i]);
+}
+
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+/*
+ *  eventfd ping-pong, an eventfd in each direction
+ */
+static int stress_switch_pp_eventfd_open(const stress_args_t *args, stress_switch_pp_t *pp)
+{
+	pp->fds[0] = eventfd(0, 0);
+	if (pp->fds[0] < 0) {
+		pr_fail("%s: eventfd failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	pp->fds[1] = eventfd(0, 0);
+	if (pp->fds[1] < 0) {
+		pr_fail("%s: eventfd failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(pp->fds[0]);
+		return -1;
+	}
+	return 0;
+}
+
+static int stress_switch_pp_eventfd_ping(stress_switch_pp_t *pp)
+{
+	uint64_t val = 1;
+
+	if (write(pp->fds[0], &val, sizeof(val)) != sizeof(val))
+		return -1;
+	return (read(pp->fds[1], &val, sizeof(val)) == sizeof(val)) ? 0 : -1;
+}
+
+static int stress_switch_pp_eventfd_pong(stress_switch_pp_t *pp)
+{
+	uint64_t val;
+
+	if (read(pp->fds[0], &val, sizeof(val)) != sizeof(val))
+		return -1;
+	return (write(pp->fds[1], &val, sizeof(val)) == sizeof(val)) ? 0 : -1;
+}
+
+static void stress_switch_pp_eventfd_close(stress_switch_pp_t *pp)
+{
+	(void)close(pp->fds[0]);
+	(void)close(pp->fds[1]);
+}
+#endif
+
+/*
+ *  futex ping-pong on a shared word, 1 is the parent's turn
+ *  to wait and the child's turn to run, 0 is the reverse
+ */
+static int stress_switch_pp_futex_open(const stress_args_t *args, stress_switch_pp_t *pp)
+{
+	pp->futex = (uint32_t *)mmap(NULL, args->page_size, PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+	if (pp->futex == MAP_FAILED) {
+		pr_inf("%s: cannot mmap futex page, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	*pp->futex = 0;
+	if ((shim_futex_wake(pp->futex, 1) < 0) && (errno == ENOSYS)) {
+		pr_inf("%s: futex is not implemented\n", args->name);
+		(void)munmap((void *)pp->futex, args->page_size);
+		return -1;
+	}
+	return 0;
+}
+
+static int stress_switch_pp_futex_ping(stress_switch_pp_t *pp)
+{
+	/* a timeout so the parent notices the end of the run */
+	const struct timespec timeout = { 0, 100000000 };
+
+	__atomic_store_n(pp->futex, 1, __ATOMIC_SEQ_CST);
+	(void)shim_futex_wake(pp->futex, 1);
+	while (__atomic_load_n(pp->futex, __ATOMIC_SEQ_CST) == 1) {
+		(void)shim_futex_wait(pp->futex, 1, &timeout);
+		if (!keep_stressing_flag())
+			return -1;
+	}
+	return 0;
+}
+
+static int stress_switch_pp_futex_pong(stress_switch_pp_t *pp)
+{
+	while (__atomic_load_n(pp->futex, __ATOMIC_SEQ_CST) == 0)
+		(void)shim_futex_wait(pp->futex, 0, NULL);
+	__atomic_store_n(pp->futex, 0, __ATOMIC_SEQ_CST);
+	(void)shim_futex_wake(pp->futex, 1);
+	return 0;
+}
+
+static void stress_switch_pp_futex_close(stress_switch_pp_t *pp)
+{
+	(void)munmap((void *)pp->futex, (size_t)stress_get_page_size());
+}
+
+#if defined(HAVE_SEM_SYSV) &&	\
+    defined(HAVE_KEY_T)
+/*
+ *  SYSV semaphore ping-pong, a semaphore in each direction
+ */
+static int stress_switch_pp_sem_sysv_open(const stress_args_t *args, stress_switch_pp_t *pp)
+{
+	int i;
+
+	for (i = 0; i < 100; i++) {
+		const key_t key_id = (key_t)stress_mwc16();
+
+		pp->sem_id = semget(key_id, 2, IPC_CREAT | IPC_EXCL | S_IRUSR | S_IWUSR);
+		if (pp->sem_id >= 0)
+			return 0;
+	}
+	pr_err("%s: semaphore init (SYSV) failed: errno=%d (%s)\n",
+		args->name, errno, strerror(errno));
+	return -1;
+}
+
+static int stress_switch_pp_sem_sysv_ping(stress_switch_pp_t *pp)
+{
+	struct sembuf sem;
+
+	sem.sem_num = 0;
+	sem.sem_op = 1;
+	sem.sem_flg = 0;
+	if (semop(pp->sem_id, &sem, 1) < 0)
+		return -1;
+	sem.sem_num = 1;
+	sem.sem_op = -1;
+	sem.sem_flg = 0;
+	return semop(pp->sem_id, &sem, 1);
+}
+
+static int stress_switch_pp_sem_sysv_pong(stress_switch_pp_t *pp)
+{
+	struct sembuf sem;
+
+	sem.sem_num = 0;
+	sem.sem_op = -1;
+	sem.sem_flg = 0;
+	if (semop(pp->sem_id, &sem, 1) < 0)
+		return -1;
+	sem.sem_num = 1;
+	sem.sem_op = 1;
+	sem.sem_flg = 0;
+	return semop(pp->sem_id, &sem, 1);
+}
+
+static void stress_switch_pp_sem_sysv_close(stress_switch_pp_t *pp)
+{
+	(void)semctl(pp->sem_id, 0, IPC_RMID);
+}
+#endif
+
+#if defined(HAVE_MQUEUE_H) &&   \
+    defined(HAVE_LIB_RT) &&     \
+    defined(HAVE_MQ_POSIX)
+/*
+ *  POSIX message queue ping-pong, a 1 message queue in each direction
+ */
+static int stress_switch_pp_mq_open(const stress_args_t *args, stress_switch_pp_t *pp)
+{
+	struct mq_attr attr;
+	int i;
+
+	attr.mq_flags = 0;
+	attr.mq_maxmsg = 1;
+	attr.mq_msgsize = sizeof(uint64_t);
+	attr.mq_curmsgs = 0;
+	for (i = 0; i < 2; i++) {
+		(void)snprintf(pp->mq_name[i], sizeof(pp->mq_name[i]),
+			"/%s-%" PRIdMAX "-%" PRIu32 "-%d",
+			args->name, (intmax_t)args->pid, args->instance, i);
+		pp->mq[i] = mq_open(pp->mq_name[i], O_CREAT | O_RDWR, S_IRUSR | S_IWUSR, &attr);
+		if (pp->mq[i] < 0) {
+			pr_err("%s: message queue open failed: errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			if (i) {
+				(void)mq_close(pp->mq[0]);
+				(void)mq_unlink(pp->mq_name[0]);
+			}
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int stress_switch_pp_mq_ping(stress_switch_pp_t *pp)
+{
+	uint64_t msg = 0;
+	unsigned int prio;
+
+	if (mq_send(pp->mq[0], (char *)&msg, sizeof(msg), 0) < 0)
+		return -1;
+	return (mq_receive(pp->mq[1], (char *)&msg, sizeof(msg), &prio) < 0) ? -1 : 0;
+}
+
+static int stress_switch_pp_mq_pong(stress_switch_pp_t *pp)
+{
+	uint64_t msg;
+	unsigned int prio;
+
+	if (mq_receive(pp->mq[0], (char *)&msg, sizeof(msg), &prio) < 0)
+		return -1;
+	return (mq_send(pp->mq[1], (char *)&msg, sizeof(msg), 0) < 0) ? -1 : 0;
+}
+
+static void stress_switch_pp_mq_close(stress_switch_pp_t *pp)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		(void)mq_close(pp->mq[i]);
+		(void)mq_unlink(pp->mq_name[i]);
+	}
+}
+#endif
+
+/* same names as the --switch-method methods */
+static const stress_switch_pp_method_t stress_switch_pp_methods[] = {
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+	{ "eventfd",	stress_switch_pp_eventfd_open, stress_switch_pp_eventfd_ping,
+			stress_switch_pp_eventfd_pong, stress_switch_pp_eventfd_close },
+#endif
+	{ "futex",	stress_switch_pp_futex_open, stress_switch_pp_futex_ping,
+			stress_switch_pp_futex_pong, stress_switch_pp_futex_close },
+#if defined(HAVE_MQUEUE_H) &&   \
+    defined(HAVE_LIB_RT) &&     \
+    defined(HAVE_MQ_POSIX)
+	{ "mq",		stress_switch_pp_mq_open, stress_switch_pp_mq_ping,
+			stress_switch_pp_mq_pong, stress_switch_pp_mq_close },
+#endif
+	{ "pipe",	stress_switch_pp_pipe_open, stress_switch_pp_pipe_ping,
+			stress_switch_pp_pipe_pong, stress_switch_pp_pipe_close },
+#if defined(HAVE_SEM_SYSV) &&	\
+    defined(HAVE_KEY_T)
+	{ "sem-sysv",	stress_switch_pp_sem_sysv_open, stress_switch_pp_sem_sysv_ping,
+			stress_switch_pp_sem_sysv_pong, stress_switch_pp_sem_sysv_close },
+#endif
+};
+
+/*
+ *  stress_switch_pp_run()
+ *	ping-pong between the parent pinned to cpu and a child pinned to
+ *	child_cpu (no pinning if negative) for duration seconds or until
+ *	the end of the run if duration is zero. The number of round trips
+ *	and the time taken are returned in trips and t_taken.
+ */
+static int stress_switch_pp_run(
+	const stress_args_t *args,
+	const stress_switch_pp_method_t *method,
+	const int cpu,
+	const int child_cpu,
+	const double duration,
+	const uint64_t switch_freq,
+	const uint64_t switch_delay,
+	const uint64_t threshold,
+	uint64_t *trips,
+	double *t_taken)
+{
+	stress_switch_pp_t pp;
+	pid_t pid;
+	int status;
+	double t_start, t_end;
+	uint64_t delay = switch_delay;
+
+	*trips = 0;
+	*t_taken = 0.0;
+	(void)memset(&pp, 0, sizeof(pp));
+	if (method->open(args, &pp) < 0)
+		return -1;
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(errno))
+			goto again;
+		method->close(&pp);
+		if (!keep_stressing(args))
+			return 0;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	} else if (pid == 0) {
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+		stress_net_placement_pin(child_cpu);
+
+		while (keep_stressing_flag()) {
+			if (method->pong(&pp) < 0)
+				break;
+		}
+		_exit(EXIT_SUCCESS);
+	}
+
+	/* Parent */
+	stress_net_placement_pin(cpu);
+	t_start = stress_time_now();
+	t_end = t_start + duration;
+	do {
+		const uint64_t t = stress_latency_now();
+
+		if (method->ping(&pp) < 0)
+			break;
+		stress_latency_record(args->latency, stress_latency_now() - t);
+		inc_counter(args);
+		(*trips)++;
+
+		if (switch_freq)
+			stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
+	} while (keep_stressing(args) && ((duration == 0.0) || (stress_time_now() < t_end)));
+	*t_taken = stress_time_now() - t_start;
+
+	(void)kill(pid, SIGKILL);
+	(void)shim_waitpid(pid, &status, 0);
+	method->close(&pp);
+
+	return 0;
+}
+
+/*
+ *  stress_switch_pp()
+ *	stress by heavy context switching with round trip ping-pong
+ */
+static int stress_switch_pp(
+	const stress_args_t *args,
+	const char *name,
+	const uint64_t switch_freq,
+	const uint64_t switch_delay,
+	const uint64_t threshold)
+{
+	const stress_switch_pp_method_t *method = NULL;
+	uint64_t trips;
+	double t_taken;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_switch_pp_methods); i++) {
+		if (!strcmp(stress_switch_pp_methods[i].name, name))
+			method = &stress_switch_pp_methods[i];
+	}
+	if (!method)
+		return EXIT_NOT_IMPLEMENTED;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	ret = stress_switch_pp_run(args, method, -1, -1, 0.0,
+		switch_freq, switch_delay, threshold, &trips, &t_taken);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (ret < 0)
+		return EXIT_FAILURE;
+	if (trips) {
+		stress_switch_rate(args, method->name, 0.0, t_taken, 2 * trips);
+		stress_latency_misc_stats(args, 0, method->name);
+	}
+	return EXIT_SUCCESS;
+}
+
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+/*
+ *  stress_switch_eventfd
+ *	stress by heavy context switching using eventfd
+ */
+static int stress_switch_eventfd(
+	const stress_args_t *args,
+	const uint64_t switch_freq,
+	const uint64_t switch_delay,
+	const uint64_t threshold)
+{
+	return stress_switch_pp(args, "eventfd", switch_freq, switch_delay, threshold);
+}
+#endif
+
+/*
+ *  stress_switch_futex
+ *	stress by heavy context switching using a futex
+ */
+static int stress_switch_futex(
+	const stress_args_t *args,
+	const uint64_t switch_freq,
+	const uint64_t switch_delay,
+	const uint64_t threshold)
+{
+	return stress_switch_pp(args, "futex", switch_freq, switch_delay, threshold);
+}
+
+/*
+ *  stress_switch_matrix()
+ *	measure the round trip latency of each ping-pong method with the
+ *	two processes pinned to CPU pairs of each topology placement
+ */
+static int stress_switch_matrix(const stress_args_t *args, const char *name)
+{
+	typedef struct {
+		uint64_t trips;
+		double duration;
+	} stress_switch_cell_t;
+
+	const size_t n_methods = SIZEOF_ARRAY(stress_switch_pp_methods);
+	stress_switch_cell_t cells[SIZEOF_ARRAY(switch_placements)][SIZEOF_ARRAY(stress_switch_pp_methods)];
+	int cpus[SIZEOF_ARRAY(switch_placements)][2];
+	char header[256], line[256];
+	size_t i, j, idx = 0;
+	int rc = EXIT_SUCCESS;
+
+	(void)memset(cells, 0, sizeof(cells));
+	for (i = 0; i < SIZEOF_ARRAY(switch_placements); i++) {
+		if (stress_net_placement_pair(switch_placements[i], args->instance,
+					      &cpus[i][0], &cpus[i][1]) < 0)
+			cpus[i][0] = -1;
+	}
+	if (cpus[0][0] < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot determine the CPU topology, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < SIZEOF_ARRAY(switch_placements)); i++) {
+			if (cpus[i][0] < 0)
+				continue;
+			for (j = 0; keep_stressing(args) && (j < n_methods); j++) {
+				uint64_t trips;
+				double duration;
+
+				if (stress_switch_pp_run(args, &stress_switch_pp_methods[j],
+						cpus[i][0], cpus[i][1], MATRIX_STEP,
+						0, 0, 0, &trips, &duration) < 0) {
+					rc = EXIT_FAILURE;
+					break;
+				}
+				cells[i][j].trips += trips;
+				cells[i][j].duration += duration;
+			}
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	(void)snprintf(header, sizeof(header), "placement     cpus  ");
+	for (j = 0; j < n_methods; j++) {
+		const size_t len = strlen(header);
+
+		(void)snprintf(header + len, sizeof(header) - len, " %9s",
+			stress_switch_pp_methods[j].name);
+	}
+	if (args->instance == 0) {
+		pr_inf("%s: round trip latency (ns)\n", args->name);
+		pr_inf("%s: %s\n", args->name, header);
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(switch_placements); i++) {
+		const char *placement = stress_net_placement_name(switch_placements[i]);
+
+		if (cpus[i][0] < 0) {
+			(void)snprintf(line, sizeof(line), "%-12s   n/a  ", placement);
+		} else {
+			(void)snprintf(line, sizeof(line), "%-12s %3d,%-3d",
+				placement, cpus[i][0], cpus[i][1]);
+		}
+		for (j = 0; j < n_methods; j++) {
+			const stress_switch_cell_t *cell = &cells[i][j];
+			const size_t len = strlen(line);
+
+			if (cell->trips) {
+				const double ns = (cell->duration * STRESS_NANOSECOND) / (double)cell->trips;
+
+				(void)snprintf(line + len, sizeof(line) - len, " %9.1f", ns);
+				if (!strcmp(stress_switch_pp_methods[j].name, name) &&
+				    (idx < STRESS_MISC_STATS_MAX)) {
+					char desc[40];
+
+					(void)snprintf(desc, sizeof(desc), "%s %s round trip ns",
+						placement, name);
+					stress_misc_stats_set(args->misc_stats, idx++, desc, ns);
+				}
+			} else {
+				(void)snprintf(line + len, sizeof(line) - len, " %9s", "n/a");
+			}
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %s\n", args->name, line);
+	}
+	return rc;
+}
+
 static stress_switch_method_t stress_switch_methods[] = {
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+	{ "eventfd",	stress_switch_eventfd },
+#endif
+	{ "futex",	stress_switch_futex },
 #if defined(HAVE_MQUEUE_H) &&   \
     defined(HAVE_LIB_RT) &&     \
     defined(HAVE_MQ_POSIX)
@@ -503,12 +1100,17 @@ static int stress_set_switch_method(const char *name)
 static int stress_switch(const stress_args_t *args)
 {
 	uint64_t switch_freq = 0, switch_delay, threshold;
+	bool switch_matrix = false;
 
 	stress_switch_method_t *switch_method;
 
 	(void)stress_get_setting("switch-freq", &switch_freq);
+	(void)stress_get_setting("switch-matrix", &switch_matrix);
 	(void)stress_get_setting("switch-method", (void *)&switch_method);
 
+	if (switch_matrix)
+		return stress_switch_matrix(args, switch_method->name);
+
 	switch_delay = (switch_freq == 0) ? 0 : STRESS_NANOSECOND / switch_freq;
 	threshold = switch_freq / THRESH_FREQ;
 
@@ -522,6 +1124,7 @@ static void stress_switch_set_default(void)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_switch_freq,	stress_set_switch_freq },
+	{ OPT_switch_matrix,	stress_set_switch_matrix },
 	{ OPT_switch_method,	stress_set_switch_method },
 	{ 0,			NULL }
 };
@@ -18,15 +18,32 @@
  *
  */
 #include "stress-ng.h"
+#include "core-io-buf.h"
+#include "core-latency.h"
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
 
 #define MIN_SYNC_FILE_BYTES	(1 * MB)
 #define MAX_SYNC_FILE_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_SYNC_FILE_BYTES	(1 * GB)
 
+/* --sync-file-matrix durability methods */
+#define SYNC_MATRIX_FSYNC	(0)	/* write + fsync */
+#define SYNC_MATRIX_FDATASYNC	(1)	/* write + fdatasync */
+#define SYNC_MATRIX_SFR		(2)	/* write + sync_file_range and wait */
+#define SYNC_MATRIX_DSYNC	(3)	/* O_DSYNC write */
+#define SYNC_MATRIX_URING	(4)	/* write + io_uring fsync */
+#define SYNC_MATRIX_METHODS	(5)
+
+#define SYNC_MATRIX_BURST	(4)	/* ops per combination per sweep */
+
 static const stress_help_t help[] = {
 	{ NULL,	"sync-file N",	     "start N workers exercise sync_file_range" },
 	{ NULL,	"sync-file-ops N",   "stop after N sync_file_range bogo operations" },
 	{ NULL,	"sync-file-bytes N", "size of file to be sync'd" },
+	{ NULL,	"sync-file-matrix",  "measure write + sync latency per size and sync method" },
 	{ NULL,	NULL,		     NULL }
 };
 
@@ -53,8 +70,14 @@ static int stress_set_sync_file_bytes(const char *opt)
 	return stress_set_setting("sync_file-bytes", TYPE_ID_OFF_T, &sync_file_bytes);
 }
 
+static int stress_set_sync_file_matrix(const char *opt)
+{
+	return stress_set_setting_true("sync_file-matrix", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_sync_file_bytes,	stress_set_sync_file_bytes },
+	{ OPT_sync_file_matrix,	stress_set_sync_file_matrix },
 	{ 0,			NULL }
 };
 
@@ -103,6 +126,349 @@ static int stress_sync_allocate(
 	return 0;
 }
 
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(__NR_io_uring_setup) &&	\
+    defined(__NR_io_uring_enter) &&	\
+    defined(IORING_OFF_SQ_RING) &&	\
+    defined(IORING_OFF_CQ_RING) &&	\
+    defined(IORING_OFF_SQES) &&		\
+    defined(IORING_ENTER_GETEVENTS)
+#define HAVE_SYNC_FILE_URING
+#endif
+
+static const char * const sync_matrix_methods[SYNC_MATRIX_METHODS] = {
+	"fsync", "fdatasync", "sync_file_range", "O_DSYNC", "io_uring-fsync"
+};
+
+static const size_t sync_matrix_sizes[] = {
+	4 * KB, 16 * KB, 64 * KB, 256 * KB, 1 * MB
+};
+
+/* Per size and method results */
+typedef struct {
+	stress_latency_t latency;	/* write + sync latencies */
+	uint64_t ops;			/* completed write + syncs */
+	double duration;		/* time spent in write + syncs */
+} stress_sync_matrix_stats_t;
+
+/* A single entry io_uring for fsync requests */
+typedef struct {
+	int fd;				/* io_uring fd, -1 if not available */
+#if defined(HAVE_SYNC_FILE_URING)
+	struct io_uring_params p;	/* ring offsets */
+	uint8_t *sq_mmap;		/* submission ring */
+	size_t sq_size;
+	uint8_t *cq_mmap;		/* completion ring */
+	size_t cq_size;
+	struct io_uring_sqe *sqes;	/* submission queue entries */
+	size_t sqes_size;
+#endif
+} stress_sync_uring_t;
+
+/*
+ *  stress_sync_uring_close()
+ *	tear down the fsync io_uring
+ */
+static void stress_sync_uring_close(stress_sync_uring_t *ring)
+{
+#if defined(HAVE_SYNC_FILE_URING)
+	if (ring->sqes && (ring->sqes != MAP_FAILED))
+		(void)munmap((void *)ring->sqes, ring->sqes_size);
+	if (ring->cq_mmap && (ring->cq_mmap != MAP_FAILED))
+		(void)munmap((void *)ring->cq_mmap, ring->cq_size);
+	if (ring->sq_mmap && (ring->sq_mmap != MAP_FAILED))
+		(void)munmap((void *)ring->sq_mmap, ring->sq_size);
+#endif
+	if (ring->fd >= 0)
+		(void)close(ring->fd);
+	ring->fd = -1;
+}
+
+/*
+ *  stress_sync_uring_open()
+ *	set up a single entry io_uring, returns -1 if not possible
+ */
+static int stress_sync_uring_open(stress_sync_uring_t *ring)
+{
+	(void)memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+#if defined(HAVE_SYNC_FILE_URING)
+	ring->fd = (int)syscall(__NR_io_uring_setup, 1, &ring->p);
+	if (ring->fd < 0)
+		return -1;
+	ring->sq_size = ring->p.sq_off.array + (ring->p.sq_entries * sizeof(uint32_t));
+	ring->cq_size = ring->p.cq_off.cqes + (ring->p.cq_entries * sizeof(struct io_uring_cqe));
+	ring->sqes_size = ring->p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sq_mmap = (uint8_t *)mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+	ring->cq_mmap = (uint8_t *)mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+	ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, ring->fd, IORING_OFF_SQES);
+	if ((ring->sq_mmap == MAP_FAILED) || (ring->cq_mmap == MAP_FAILED) ||
+	    (ring->sqes == MAP_FAILED)) {
+		stress_sync_uring_close(ring);
+		return -1;
+	}
+	return 0;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ *  stress_sync_uring_fsync()
+ *	fsync fd with an IORING_OP_FSYNC request and wait for it
+ */
+static int stress_sync_uring_fsync(stress_sync_uring_t *ring, const int fd)
+{
+#if defined(HAVE_SYNC_FILE_URING)
+	const struct io_uring_params *p = &ring->p;
+	uint32_t *sq_tail = (uint32_t *)(void *)(ring->sq_mmap + p->sq_off.tail);
+	uint32_t *sq_array = (uint32_t *)(void *)(ring->sq_mmap + p->sq_off.array);
+	const uint32_t sq_mask = *(uint32_t *)(void *)(ring->sq_mmap + p->sq_off.ring_mask);
+	uint32_t *cq_head = (uint32_t *)(void *)(ring->cq_mmap + p->cq_off.head);
+	const uint32_t *cq_tail = (uint32_t *)(void *)(ring->cq_mmap + p->cq_off.tail);
+	const uint32_t cq_mask = *(uint32_t *)(void *)(ring->cq_mmap + p->cq_off.ring_mask);
+	const struct io_uring_cqe *cqes = (struct io_uring_cqe *)(void *)(ring->cq_mmap + p->cq_off.cqes);
+	const uint32_t tail = *sq_tail, idx = tail & sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+	uint32_t head;
+	int res;
+
+	(void)memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_FSYNC;
+	sqe->fd = fd;
+	sq_array[idx] = idx;
+	shim_mb();
+	*sq_tail = tail + 1;
+	shim_mb();
+
+	if (syscall(__NR_io_uring_enter, ring->fd, 1, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+		return -1;
+	shim_mb();
+	head = *cq_head;
+	if (head == *cq_tail) {
+		errno = EAGAIN;
+		return -1;
+	}
+	res = cqes[head & cq_mask].res;
+	*cq_head = head + 1;
+	shim_mb();
+	if (res < 0) {
+		errno = -res;
+		return -1;
+	}
+	return 0;
+#else
+	(void)ring;
+	(void)fd;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ *  stress_sync_matrix_op()
+ *	write size bytes at offset and make them durable with
+ *	the given method, returns -1 on failure with errno set
+ */
+static int stress_sync_matrix_op(
+	const int method,
+	const int fd,
+	const int fd_dsync,
+	stress_sync_uring_t *ring,
+	const uint8_t *buf,
+	const size_t size,
+	const off_t offset)
+{
+	if (method == SYNC_MATRIX_DSYNC)
+		return (pwrite(fd_dsync, buf, size, offset) < 0) ? -1 : 0;
+
+	if (pwrite(fd, buf, size, offset) < 0)
+		return -1;
+
+	switch (method) {
+	case SYNC_MATRIX_FSYNC:
+		return shim_fsync(fd);
+	case SYNC_MATRIX_FDATASYNC:
+		return shim_fdatasync(fd);
+	case SYNC_MATRIX_SFR:
+		return shim_sync_file_range(fd, offset, (shim_off64_t)size,
+			SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+			SYNC_FILE_RANGE_WAIT_AFTER);
+	case SYNC_MATRIX_URING:
+		return stress_sync_uring_fsync(ring, fd);
+	default:
+		break;
+	}
+	errno = EINVAL;
+	return -1;
+}
+
+/*
+ *  stress_sync_matrix_report()
+ *	report ops/s and latencies of each size and method
+ */
+static void stress_sync_matrix_report(
+	const stress_args_t *args,
+	const char *fs_type,
+	const stress_sync_matrix_stats_t *stats,
+	const bool *method_ok)
+{
+	size_t s, m;
+
+	if (args->instance == 0) {
+		pr_inf("%s: write + sync cost per size and method%s\n", args->name, fs_type);
+		pr_inf("%s: %-6s %-16s %10s %10s %10s %10s %10s\n", args->name,
+			"size", "method", "ops/s", "mean-us", "p50-us", "p99-us", "max-us");
+	}
+	for (s = 0; s < SIZEOF_ARRAY(sync_matrix_sizes); s++) {
+		for (m = 0; m < SYNC_MATRIX_METHODS; m++) {
+			const stress_sync_matrix_stats_t *st = &stats[(s * SYNC_MATRIX_METHODS) + m];
+			const stress_latency_t *lat = &st->latency;
+			const double ops_sec = (st->duration > 0.0) ?
+				(double)st->ops / st->duration : 0.0;
+			char size_str[32];
+
+			if (args->instance != 0)
+				break;
+			(void)snprintf(size_str, sizeof(size_str), "%zuK", (size_t)(sync_matrix_sizes[s] / KB));
+			if (!method_ok[m] || !st->ops) {
+				pr_inf("%s: %-6s %-16s %10s\n", args->name,
+					size_str, sync_matrix_methods[m], "n/a");
+				continue;
+			}
+			pr_inf("%s: %-6s %-16s %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+				args->name, size_str, sync_matrix_methods[m], ops_sec,
+				stress_latency_mean(lat) / 1000.0,
+				(double)stress_latency_percentile(lat, 50.0) / 1000.0,
+				(double)stress_latency_percentile(lat, 99.0) / 1000.0,
+				(double)lat->max / 1000.0);
+		}
+	}
+
+	/* smallest size ops/s and p99 per method as metrics */
+	for (m = 0; m < SYNC_MATRIX_METHODS; m++) {
+		const stress_sync_matrix_stats_t *st = &stats[m];
+		char desc[40];
+
+		if (!method_ok[m] || !st->ops || (st->duration <= 0.0))
+			continue;
+		(void)snprintf(desc, sizeof(desc), "4K %s ops/s", sync_matrix_methods[m]);
+		stress_misc_stats_set(args->misc_stats, m * 2, desc,
+			(double)st->ops / st->duration);
+		(void)snprintf(desc, sizeof(desc), "4K %s p99 usec", sync_matrix_methods[m]);
+		stress_misc_stats_set(args->misc_stats, (m * 2) + 1, desc,
+			(double)stress_latency_percentile(&st->latency, 99.0) / 1000.0);
+	}
+}
+
+/*
+ *  stress_sync_matrix()
+ *	sweep the write sizes and durability methods, timing
+ *	each write and the sync that makes it durable
+ */
+static int stress_sync_matrix(
+	const stress_args_t *args,
+	const int fd,
+	const int fd_dsync,
+	const char *fs_type,
+	const char *path,
+	const off_t sync_file_bytes)
+{
+	const size_t n_stats = SIZEOF_ARRAY(sync_matrix_sizes) * SYNC_MATRIX_METHODS;
+	stress_sync_matrix_stats_t *stats;
+	stress_io_buf_pool_t pool;
+	stress_sync_uring_t ring;
+	bool method_ok[SYNC_MATRIX_METHODS];
+	off_t offset = 0;
+	size_t s, m, i;
+	uint8_t *buf;
+	int rc = EXIT_SUCCESS;
+
+	stats = calloc(n_stats, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: cannot allocate matrix statistics, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (stress_io_buf_pool_alloc(args, &pool, path, sync_matrix_sizes[SIZEOF_ARRAY(sync_matrix_sizes) - 1], 1, 0) < 0) {
+		pr_inf_skip("%s: cannot allocate write buffer, skipping stressor\n",
+			args->name);
+		free(stats);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = stress_io_buf_get(&pool, 0);
+	stress_mwc_fill(buf, pool.buf_size);
+
+	for (m = 0; m < SYNC_MATRIX_METHODS; m++)
+		method_ok[m] = true;
+	if (fd_dsync < 0)
+		method_ok[SYNC_MATRIX_DSYNC] = false;
+	if (stress_sync_uring_open(&ring) < 0)
+		method_ok[SYNC_MATRIX_URING] = false;
+	if (stress_sync_allocate(args, fd, fs_type, sync_file_bytes) < 0) {
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	do {
+		for (s = 0; s < SIZEOF_ARRAY(sync_matrix_sizes); s++) {
+			const size_t size = sync_matrix_sizes[s];
+
+			for (m = 0; m < SYNC_MATRIX_METHODS; m++) {
+				stress_sync_matrix_stats_t *st = &stats[(s * SYNC_MATRIX_METHODS) + m];
+
+				if (!method_ok[m])
+					continue;
+				for (i = 0; i < SYNC_MATRIX_BURST; i++) {
+					uint64_t t, ns;
+
+					if (!keep_stressing(args))
+						goto done;
+					/* overwrite a preallocated file sequentially, like a WAL */
+					if (offset + (off_t)size > sync_file_bytes)
+						offset = 0;
+					t = stress_latency_now();
+					if (stress_sync_matrix_op((int)m, fd, fd_dsync, &ring,
+								  buf, size, offset) < 0) {
+						if ((errno == ENOSYS) || (errno == EINVAL) ||
+						    (errno == EOPNOTSUPP)) {
+							method_ok[m] = false;
+							break;
+						}
+						if ((errno == EINTR) || (errno == ENOSPC))
+							continue;
+						pr_fail("%s: %s of %zu bytes failed, errno=%d (%s)%s\n",
+							args->name, sync_matrix_methods[m], size,
+							errno, strerror(errno), fs_type);
+						rc = EXIT_FAILURE;
+						goto done;
+					}
+					ns = stress_latency_now() - t;
+					stress_latency_record(&st->latency, ns);
+					st->duration += (double)ns / (double)STRESS_NANOSECOND;
+					st->ops++;
+					offset += (off_t)size;
+					inc_counter(args);
+				}
+			}
+		}
+	} while (keep_stressing(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_sync_matrix_report(args, fs_type, stats, method_ok);
+tidy:
+	stress_sync_uring_close(&ring);
+	stress_io_buf_pool_free(&pool);
+	free(stats);
+
+	return rc;
+}
+
 /*
  *  stress_sync_file
  *	stress the sync_file_range system call
@@ -114,7 +480,9 @@ static int stress_sync_file(const stress_args_t *args)
 	off_t sync_file_bytes = DEFAULT_SYNC_FILE_BYTES;
 	char filename[PATH_MAX];
 	const char *fs_type;
+	bool sync_file_matrix = false;
 
+	(void)stress_get_setting("sync_file-matrix", &sync_file_matrix);
 	if (!stress_get_setting("sync_file-bytes", &sync_file_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			sync_file_bytes = MAXIMIZED_FILE_SIZE;
@@ -145,6 +513,23 @@ static int stress_sync_file(const stress_args_t *args)
 		return ret;
 	}
 	fs_type = stress_fs_type(filename);
+
+	if (sync_file_matrix) {
+		int fd_dsync = -1;
+
+#if defined(O_DSYNC)
+		fd_dsync = open(filename, O_WRONLY | O_DSYNC);
+#endif
+		(void)shim_unlink(filename);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		(void)stress_temp_dir_args(args, filename, sizeof(filename));
+		ret = stress_sync_matrix(args, fd, fd_dsync, fs_type, filename, sync_file_bytes);
+		if (fd_dsync >= 0)
+			(void)close(fd_dsync);
+		(void)close(fd);
+		(void)stress_temp_dir_rm_args(args);
+		return ret;
+	}
 	(void)shim_unlink(filename);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -0,0 +1,607 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-clock.h"
+
+#if defined(HAVE_SYS_PRCTL_H)
+#include <sys/prctl.h>
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_TIMERFD_H)
+#include <sys/timerfd.h>
+#endif
+
+#define MIN_TIMERBENCH_SAMPLES		(8)
+#define MAX_TIMERBENCH_SAMPLES		(100000)
+#define DEFAULT_TIMERBENCH_SAMPLES	(64)
+
+static const stress_help_t help[] = {
+	{ NULL,	"timerbench N",		"start N workers measuring timer overshoot over 1us .. 10ms intervals" },
+	{ NULL,	"timerbench-method M",	"one of all, nanosleep, clock_nanosleep, timerfd, posix-timer or epoll" },
+	{ NULL,	"timerbench-ops N",	"stop after N timer expiries" },
+	{ NULL,	"timerbench-samples N",	"timer expiries measured per interval and timer slack, default 64" },
+	{ NULL,	NULL,			NULL }
+};
+
+#define TIMERBENCH_NANOSLEEP		(1)	/* relative nanosleep */
+#define TIMERBENCH_CLOCK_NANOSLEEP	(2)	/* absolute CLOCK_MONOTONIC sleep */
+#define TIMERBENCH_TIMERFD		(3)	/* one shot timerfd read */
+#define TIMERBENCH_POSIX_TIMER		(4)	/* one shot timer_create signal */
+#define TIMERBENCH_EPOLL		(5)	/* epoll_wait timeout, ms resolution */
+
+static const char * const timerbench_methods[] = {
+	"all",
+	"nanosleep",
+	"clock_nanosleep",
+	"timerfd",
+	"posix-timer",
+	"epoll",
+};
+
+#define TIMERBENCH_METHODS	(SIZEOF_ARRAY(timerbench_methods))
+
+static int stress_set_timerbench_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < TIMERBENCH_METHODS; i++) {
+		if (!strcmp(opt, timerbench_methods[i]))
+			return stress_set_setting("timerbench-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "timerbench-method must be one of:");
+	for (i = 0; i < TIMERBENCH_METHODS; i++)
+		(void)fprintf(stderr, " %s", timerbench_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_timerbench_samples(const char *opt)
+{
+	uint32_t timerbench_samples;
+
+	timerbench_samples = stress_get_uint32(opt);
+	stress_check_range("timerbench-samples", (uint64_t)timerbench_samples,
+		MIN_TIMERBENCH_SAMPLES, MAX_TIMERBENCH_SAMPLES);
+	return stress_set_setting("timerbench-samples", TYPE_ID_UINT32, &timerbench_samples);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_timerbench_method,	stress_set_timerbench_method },
+	{ OPT_timerbench_samples,	stress_set_timerbench_samples },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(HAVE_NANOSLEEP) &&		\
+    defined(CLOCK_MONOTONIC)
+
+#if defined(HAVE_CLOCK_NANOSLEEP) &&	\
+    defined(TIMER_ABSTIME)
+#define HAVE_TIMERBENCH_CLOCK_NANOSLEEP
+#endif
+
+#if defined(HAVE_SYS_TIMERFD_H) &&	\
+    defined(HAVE_TIMERFD_CREATE) &&	\
+    defined(HAVE_TIMERFD_SETTIME)
+#define HAVE_TIMERBENCH_TIMERFD
+#endif
+
+#if defined(HAVE_LIB_RT) &&		\
+    defined(HAVE_TIMER_CREATE) &&	\
+    defined(HAVE_TIMER_DELETE) &&	\
+    defined(HAVE_TIMER_SETTIME) &&	\
+    defined(HAVE_SIGWAITINFO) &&	\
+    defined(SIGRTMIN)
+#define HAVE_TIMERBENCH_POSIX_TIMER
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+#define HAVE_TIMERBENCH_EPOLL
+#endif
+
+/* prctl(2) timer slack support, as in core-helper.c */
+#if defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(HAVE_PRCTL) &&		\
+    defined(PR_SET_TIMERSLACK) &&	\
+    defined(PR_GET_TIMERSLACK)
+#define HAVE_TIMERBENCH_SLACK
+#endif
+
+/* requested intervals in nanoseconds */
+static const uint64_t timerbench_intervals[] = {
+	1000ULL,
+	10000ULL,
+	100000ULL,
+	1000000ULL,
+	10000000ULL,
+};
+
+#define TIMERBENCH_INTERVALS	(SIZEOF_ARRAY(timerbench_intervals))
+
+/* timer slack values in nanoseconds, 0 = leave the process slack as is */
+#if defined(HAVE_TIMERBENCH_SLACK)
+static const unsigned long timerbench_slacks[] = {
+	1UL,
+	50000UL,
+	1000000UL,
+};
+#else
+static const unsigned long timerbench_slacks[] = {
+	0UL,
+};
+#endif
+
+#define TIMERBENCH_SLACKS	(SIZEOF_ARRAY(timerbench_slacks))
+
+/* a one shot timer that is re-armed for each sample */
+typedef struct {
+	size_t method;			/* TIMERBENCH_* */
+#if defined(HAVE_TIMERBENCH_TIMERFD)
+	int tfd;			/* timerfd */
+#endif
+#if defined(HAVE_TIMERBENCH_POSIX_TIMER)
+	timer_t timerid;		/* POSIX timer */
+	bool timer_created;
+	sigset_t mask;			/* SIGRTMIN, blocked */
+#endif
+#if defined(HAVE_TIMERBENCH_EPOLL)
+	int epfd;			/* empty epoll set */
+#endif
+} stress_timerbench_t;
+
+/* overshoot percentiles of one method, interval and slack */
+typedef struct {
+	bool valid;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t max;
+	double irq_rate;		/* system wide timer interrupts/sec */
+} stress_timerbench_stats_t;
+
+/*
+ *  stress_timerbench_irqs()
+ *	total of the local timer interrupts over all CPUs from
+ *	/proc/interrupts, the LOC: line on x86 and the arch_timer
+ *	lines on arm. Returns -1 if not available
+ */
+static int stress_timerbench_irqs(uint64_t *irqs)
+{
+	FILE *fp;
+	char buf[8192];
+	bool found = false;
+
+	*irqs = 0;
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *ptr = buf, *end;
+
+		while (*ptr == ' ')
+			ptr++;
+		if (!strncmp(ptr, "LOC:", 4)) {
+			ptr += 4;
+		} else if (strstr(ptr, "arch_timer")) {
+			ptr = strchr(ptr, ':');
+			if (!ptr)
+				continue;
+			ptr++;
+		} else {
+			continue;
+		}
+		found = true;
+		for (;;) {
+			const unsigned long long val = strtoull(ptr, &end, 10);
+
+			if (end == ptr)
+				break;
+			*irqs += (uint64_t)val;
+			ptr = end;
+		}
+	}
+	(void)fclose(fp);
+
+	return found ? 0 : -1;
+}
+
+static inline void stress_timerbench_ns_to_timespec(const uint64_t ns, struct timespec *ts)
+{
+	ts->tv_sec = (time_t)(ns / STRESS_NANOSECOND);
+	ts->tv_nsec = (long)(ns % STRESS_NANOSECOND);
+}
+
+/*
+ *  stress_timerbench_open()
+ *	create the timer of a method, -1 if it is not available
+ */
+static int stress_timerbench_open(stress_timerbench_t *tb)
+{
+	switch (tb->method) {
+	case TIMERBENCH_NANOSLEEP:
+		return 0;
+	case TIMERBENCH_CLOCK_NANOSLEEP:
+#if defined(HAVE_TIMERBENCH_CLOCK_NANOSLEEP)
+		return 0;
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	case TIMERBENCH_TIMERFD:
+#if defined(HAVE_TIMERBENCH_TIMERFD)
+		tb->tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+		return (tb->tfd < 0) ? -1 : 0;
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	case TIMERBENCH_POSIX_TIMER:
+#if defined(HAVE_TIMERBENCH_POSIX_TIMER)
+		{
+			struct sigevent sev;
+
+			(void)sigemptyset(&tb->mask);
+			(void)sigaddset(&tb->mask, SIGRTMIN);
+			if (sigprocmask(SIG_BLOCK, &tb->mask, NULL) < 0)
+				return -1;
+			(void)memset(&sev, 0, sizeof(sev));
+			sev.sigev_notify = SIGEV_SIGNAL;
+			sev.sigev_signo = SIGRTMIN;
+			if (timer_create(CLOCK_MONOTONIC, &sev, &tb->timerid) < 0)
+				return -1;
+			tb->timer_created = true;
+		}
+		return 0;
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	case TIMERBENCH_EPOLL:
+#if defined(HAVE_TIMERBENCH_EPOLL)
+		tb->epfd = epoll_create1(0);
+		return (tb->epfd < 0) ? -1 : 0;
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	default:
+		errno = ENOSYS;
+		return -1;
+	}
+}
+
+static void stress_timerbench_close(stress_timerbench_t *tb)
+{
+#if defined(HAVE_TIMERBENCH_TIMERFD)
+	if (tb->tfd >= 0) {
+		(void)close(tb->tfd);
+		tb->tfd = -1;
+	}
+#endif
+#if defined(HAVE_TIMERBENCH_POSIX_TIMER)
+	if (tb->timer_created) {
+		(void)timer_delete(tb->timerid);
+		tb->timer_created = false;
+	}
+#endif
+#if defined(HAVE_TIMERBENCH_EPOLL)
+	if (tb->epfd >= 0) {
+		(void)close(tb->epfd);
+		tb->epfd = -1;
+	}
+#endif
+}
+
+/*
+ *  stress_timerbench_wait()
+ *	wait for a timer of interval ns and return how many ns the
+ *	wakeup came after the requested expiry, -1 on error
+ */
+static int stress_timerbench_wait(
+	stress_timerbench_t *tb,
+	const uint64_t interval,
+	uint64_t *overshoot)
+{
+	struct timespec ts;
+	uint64_t t1, t2, elapsed;
+
+	stress_timerbench_ns_to_timespec(interval, &ts);
+
+	switch (tb->method) {
+	case TIMERBENCH_NANOSLEEP:
+		t1 = stress_clock_ns();
+		if (nanosleep(&ts, NULL) < 0)
+			return -1;
+		t2 = stress_clock_ns();
+		break;
+#if defined(HAVE_TIMERBENCH_CLOCK_NANOSLEEP)
+	case TIMERBENCH_CLOCK_NANOSLEEP:
+		{
+			struct timespec now, target;
+			int ret;
+
+			/* absolute expiry, so the set up cost is not counted */
+			if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+				return -1;
+			t1 = ((uint64_t)now.tv_sec * STRESS_NANOSECOND) + (uint64_t)now.tv_nsec;
+			stress_timerbench_ns_to_timespec(t1 + interval, &target);
+			ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL);
+			if (ret) {
+				errno = ret;
+				return -1;
+			}
+			if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+				return -1;
+			t2 = ((uint64_t)now.tv_sec * STRESS_NANOSECOND) + (uint64_t)now.tv_nsec;
+		}
+		break;
+#endif
+#if defined(HAVE_TIMERBENCH_TIMERFD)
+	case TIMERBENCH_TIMERFD:
+		{
+			struct itimerspec its;
+			uint64_t expirations;
+
+			(void)memset(&its, 0, sizeof(its));
+			its.it_value = ts;
+			t1 = stress_clock_ns();
+			if (timerfd_settime(tb->tfd, 0, &its, NULL) < 0)
+				return -1;
+			if (read(tb->tfd, &expirations, sizeof(expirations)) < 0)
+				return -1;
+			t2 = stress_clock_ns();
+		}
+		break;
+#endif
+#if defined(HAVE_TIMERBENCH_POSIX_TIMER)
+	case TIMERBENCH_POSIX_TIMER:
+		{
+			struct itimerspec its;
+			siginfo_t info;
+
+			(void)memset(&its, 0, sizeof(its));
+			its.it_value = ts;
+			t1 = stress_clock_ns();
+			if (timer_settime(tb->timerid, 0, &its, NULL) < 0)
+				return -1;
+			do {
+				if (sigwaitinfo(&tb->mask, &info) < 0) {
+					if (errno != EINTR)
+						return -1;
+					if (!keep_stressing_flag())
+						return -1;
+				}
+			} while (info.si_signo != SIGRTMIN);
+			t2 = stress_clock_ns();
+		}
+		break;
+#endif
+#if defined(HAVE_TIMERBENCH_EPOLL)
+	case TIMERBENCH_EPOLL:
+		{
+			struct epoll_event ev;
+			/* epoll_wait rounds the timeout up to whole milliseconds */
+			const int timeout_ms = (int)((interval + 999999ULL) / 1000000ULL);
+
+			t1 = stress_clock_ns();
+			if (epoll_wait(tb->epfd, &ev, 1, timeout_ms) < 0)
+				return -1;
+			t2 = stress_clock_ns();
+		}
+		break;
+#endif
+	default:
+		errno = ENOSYS;
+		return -1;
+	}
+	elapsed = t2 - t1;
+	*overshoot = (elapsed > interval) ? elapsed - interval : 0;
+	return 0;
+}
+
+static int stress_timerbench_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  stress_timerbench_cell()
+ *	measure the overshoot of n_samples timer expiries of one
+ *	interval and compute the percentiles
+ */
+static int stress_timerbench_cell(
+	const stress_args_t *args,
+	stress_timerbench_t *tb,
+	const uint64_t interval,
+	uint64_t *samples,
+	const size_t n_samples,
+	stress_timerbench_stats_t *stats)
+{
+	uint64_t irqs1, irqs2;
+	double t1, t2;
+	size_t n;
+	const bool have_irqs = (stress_timerbench_irqs(&irqs1) == 0);
+
+	t1 = stress_time_now();
+	for (n = 0; (n < n_samples) && keep_stressing(args); n++) {
+		if (stress_timerbench_wait(tb, interval, &samples[n]) < 0)
+			return keep_stressing(args) ? -1 : 0;
+		inc_counter(args);
+	}
+	t2 = stress_time_now();
+	if (n < MIN_TIMERBENCH_SAMPLES)
+		return 0;
+
+	qsort(samples, n, sizeof(*samples), stress_timerbench_cmp);
+	stats->p50 = samples[n / 2];
+	stats->p99 = samples[(n * 99) / 100];
+	stats->max = samples[n - 1];
+	stats->irq_rate = 0.0;
+	if (have_irqs && (stress_timerbench_irqs(&irqs2) == 0) && (t2 > t1))
+		stats->irq_rate = (double)(irqs2 - irqs1) / (t2 - t1);
+	stats->valid = true;
+	return 0;
+}
+
+/*
+ *  stress_timerbench()
+ *	characterize timer accuracy, the overshoot of the actual over
+ *	the requested interval for a range of timer APIs, intervals
+ *	and timer slack values
+ */
+static int stress_timerbench(const stress_args_t *args)
+{
+	static stress_timerbench_stats_t stats[TIMERBENCH_METHODS][TIMERBENCH_SLACKS][TIMERBENCH_INTERVALS];
+	stress_timerbench_t tb;
+	uint32_t timerbench_samples = DEFAULT_TIMERBENCH_SAMPLES;
+	size_t timerbench_method = 0, m, sl, iv, idx = 0;
+	bool skipped[TIMERBENCH_METHODS];
+	uint64_t *samples;
+	int rc = EXIT_SUCCESS;
+#if defined(HAVE_TIMERBENCH_SLACK)
+	const int old_slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+#endif
+
+	(void)stress_get_setting("timerbench-method", &timerbench_method);
+	if (!stress_get_setting("timerbench-samples", &timerbench_samples)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			timerbench_samples = 1000;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			timerbench_samples = MIN_TIMERBENCH_SAMPLES;
+	}
+
+	samples = (uint64_t *)calloc(timerbench_samples, sizeof(*samples));
+	if (!samples) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " samples, skipping stressor\n",
+			args->name, timerbench_samples);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)memset(&tb, 0, sizeof(tb));
+#if defined(HAVE_TIMERBENCH_TIMERFD)
+	tb.tfd = -1;
+#endif
+#if defined(HAVE_TIMERBENCH_EPOLL)
+	tb.epfd = -1;
+#endif
+	(void)memset(stats, 0, sizeof(stats));
+	(void)memset(skipped, 0, sizeof(skipped));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 1; (m < TIMERBENCH_METHODS) && keep_stressing(args); m++) {
+			if ((timerbench_method && (timerbench_method != m)) || skipped[m])
+				continue;
+			tb.method = m;
+			if (stress_timerbench_open(&tb) < 0) {
+				if (args->instance == 0)
+					pr_inf("%s: %s skipped, errno=%d (%s)\n",
+						args->name, timerbench_methods[m],
+						errno, strerror(errno));
+				skipped[m] = true;
+				stress_timerbench_close(&tb);
+				continue;
+			}
+			for (sl = 0; (sl < TIMERBENCH_SLACKS) && keep_stressing(args); sl++) {
+#if defined(HAVE_TIMERBENCH_SLACK)
+				VOID_RET(int, prctl(PR_SET_TIMERSLACK, timerbench_slacks[sl], 0, 0, 0));
+#endif
+				for (iv = 0; (iv < TIMERBENCH_INTERVALS) && keep_stressing(args); iv++) {
+					if (stress_timerbench_cell(args, &tb, timerbench_intervals[iv],
+							samples, (size_t)timerbench_samples,
+							&stats[m][sl][iv]) < 0) {
+						pr_fail("%s: %s timer wait failed, errno=%d (%s)\n",
+							args->name, timerbench_methods[m],
+							errno, strerror(errno));
+						rc = EXIT_FAILURE;
+						break;
+					}
+				}
+			}
+			stress_timerbench_close(&tb);
+			if (rc != EXIT_SUCCESS)
+				goto report;
+		}
+	} while (keep_stressing(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+#if defined(HAVE_TIMERBENCH_SLACK)
+	if (old_slack >= 0)
+		VOID_RET(int, prctl(PR_SET_TIMERSLACK, (unsigned long)old_slack, 0, 0, 0));
+#endif
+
+	if (args->instance == 0)
+		pr_inf("%s: %-15s %9s %9s %12s %12s %12s %11s\n", args->name,
+			"method", "slack ns", "interval", "p50 over ns",
+			"p99 over ns", "max over ns", "timer irq/s");
+	for (m = 1; m < TIMERBENCH_METHODS; m++) {
+		for (sl = 0; sl < TIMERBENCH_SLACKS; sl++) {
+			for (iv = 0; iv < TIMERBENCH_INTERVALS; iv++) {
+				const stress_timerbench_stats_t *st = &stats[m][sl][iv];
+				char interval[24];
+
+				if (!st->valid || (args->instance != 0))
+					continue;
+				(void)snprintf(interval, sizeof(interval), "%" PRIu64 "us",
+					timerbench_intervals[iv] / 1000);
+				pr_inf("%s: %-15s %9lu %9s %12" PRIu64 " %12" PRIu64
+					" %12" PRIu64 " %11.0f\n", args->name,
+					timerbench_methods[m], timerbench_slacks[sl], interval,
+					st->p50, st->p99, st->max, st->irq_rate);
+			}
+		}
+		/* p99 overshoot of a 1ms interval at the lowest timer slack */
+		if (stats[m][0][3].valid) {
+			char desc[32];
+
+			(void)snprintf(desc, sizeof(desc), "%s 1ms p99 over ns",
+				timerbench_methods[m]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				(double)stats[m][0][3].p99);
+		}
+	}
+
+	free(samples);
+
+	return rc;
+}
+
+stressor_info_t stress_timerbench_info = {
+	.stressor = stress_timerbench,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_timerbench_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
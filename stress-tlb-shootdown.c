@@ -22,9 +22,20 @@
 static const stress_help_t help[] = {
 	{ NULL,	"tlb-shootdown N",	"start N workers that force TLB shootdowns" },
 	{ NULL,	"tlb-shootdown-ops N",	"stop after N TLB shootdown bogo ops" },
+	{ NULL,	"tlb-shootdown-sweep",	"measure shootdown latency over the number of CPUs using the mm" },
 	{ NULL,	NULL,			NULL }
 };
 
+static int stress_set_tlb_shootdown_sweep(const char *opt)
+{
+	return stress_set_setting_true("tlb-shootdown-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_tlb_shootdown_sweep,	stress_set_tlb_shootdown_sweep },
+	{ 0,				NULL }
+};
+
 #if defined(HAVE_SCHED_GETAFFINITY) && 	\
     defined(HAVE_MPROTECT)
 
@@ -32,6 +43,344 @@ static const stress_help_t help[] = {
 #define MIN_TLB_PROCS	(2)
 #define MMAP_PAGES	(512)
 
+#if defined(HAVE_LIB_PTHREAD)
+
+#define TLB_SWEEP_STEPS		(16)	/* 0, 1, 2, 4 .. remote CPUs */
+#define TLB_SWEEP_STEP		(0.25)	/* seconds per step */
+#define TLB_SWEEP_PAGES		(16)	/* pages the remote threads read */
+#define TLB_SWEEP_PLACEMENTS	(2)
+
+static const char * const tlb_sweep_placements[TLB_SWEEP_PLACEMENTS] = {
+	"same-socket",
+	"cross-socket",
+};
+
+/* remote thread that keeps the mm active on its CPU */
+typedef struct {
+	pthread_t pthread;		/* thread handle */
+	int	ret;			/* pthread_create return */
+	int	cpu;			/* CPU to run on */
+	uint8_t	*buf;			/* pages to read */
+	size_t	page_size;		/* page size */
+	volatile bool running;		/* thread is on its CPU */
+	volatile bool *stop;		/* stop flag */
+} stress_tlb_sweep_thread_t;
+
+/* one step of the sweep */
+typedef struct {
+	uint32_t cpus;			/* CPUs with the mm active */
+	double	mprotect_time;		/* total mprotect time */
+	double	munmap_time;		/* total munmap time */
+	uint64_t ops;			/* mprotect and munmap calls */
+	uint64_t ipis;			/* TLB and call function IPIs */
+	bool	ipis_ok;		/* ipis is valid */
+} stress_tlb_sweep_stats_t;
+
+/*
+ *  stress_tlb_cpu_package()
+ *	get the physical package (socket) id of cpu, -1 if unknown
+ */
+static int stress_tlb_cpu_package(const int cpu)
+{
+	char path[PATH_MAX], buf[64];
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+	(void)memset(buf, 0, sizeof(buf));
+	if (system_read(path, buf, sizeof(buf) - 1) < 1)
+		return -1;
+	return atoi(buf);
+}
+
+/*
+ *  stress_tlb_ipis()
+ *	total of the TLB shootdown and function call IPIs over all
+ *	CPUs from /proc/interrupts, newer x86 kernels count the
+ *	shootdowns as function call IPIs. Returns -1 if not available
+ */
+static int stress_tlb_ipis(uint64_t *ipis)
+{
+	FILE *fp;
+	char buf[8192];
+	bool found = false;
+
+	*ipis = 0;
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *ptr = buf, *end;
+
+		while (*ptr == ' ')
+			ptr++;
+		if (strncmp(ptr, "TLB:", 4) && strncmp(ptr, "CAL:", 4))
+			continue;
+		found = true;
+		ptr += 4;
+		for (;;) {
+			const unsigned long long val = strtoull(ptr, &end, 10);
+
+			if (end == ptr)
+				break;
+			*ipis += (uint64_t)val;
+			ptr = end;
+		}
+	}
+	(void)fclose(fp);
+
+	return found ? 0 : -1;
+}
+
+/*
+ *  stress_tlb_sweep_thread()
+ *	spin on a CPU reading pages so the mm stays active there and
+ *	the CPU has to take part in every shootdown
+ */
+static void *stress_tlb_sweep_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_tlb_sweep_thread_t *t = (stress_tlb_sweep_thread_t *)arg;
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(t->cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+	t->running = true;
+
+	while (!*t->stop) {
+		size_t i;
+
+		for (i = 0; i < TLB_SWEEP_PAGES; i++)
+			(void)*(volatile uint8_t *)(t->buf + (i * t->page_size));
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_tlb_sweep_step()
+ *	keep the mm active on n_remote CPUs and time mprotect and
+ *	munmap calls on the initiator CPU for TLB_SWEEP_STEP seconds
+ */
+static int stress_tlb_sweep_step(
+	const stress_args_t *args,
+	const int *order,
+	const uint32_t n_remote,
+	uint8_t *buf,
+	stress_tlb_sweep_thread_t *threads,
+	stress_tlb_sweep_stats_t *stats)
+{
+	const size_t page_size = args->page_size;
+	volatile bool stop = false;
+	uint64_t ipis_begin = 0, ipis_end = 0, ops = 0;
+	double t_end, mprotect_time = 0.0, munmap_time = 0.0;
+	uint32_t i, started = 0;
+	bool ipis_ok;
+	int rc = EXIT_SUCCESS;
+
+	for (i = 0; i < n_remote; i++) {
+		stress_tlb_sweep_thread_t *t = &threads[i];
+
+		t->cpu = order[i];
+		t->buf = buf;
+		t->page_size = page_size;
+		t->running = false;
+		t->stop = &stop;
+		t->ret = pthread_create(&t->pthread, NULL, stress_tlb_sweep_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+	if (started < n_remote) {
+		pr_inf_skip("%s: cannot create %" PRIu32 " pthreads, errno=%d (%s), "
+			"skipping stressor\n", args->name, n_remote,
+			threads[started].ret, strerror(threads[started].ret));
+		rc = EXIT_NO_RESOURCE;
+		goto stop;
+	}
+	for (i = 0; i < started; i++) {
+		while (!threads[i].running && keep_stressing_flag())
+			(void)shim_sched_yield();
+	}
+
+	ipis_ok = (stress_tlb_ipis(&ipis_begin) == 0);
+	t_end = stress_time_now() + TLB_SWEEP_STEP;
+	while (keep_stressing(args) && (stress_time_now() < t_end)) {
+		uint8_t *page;
+		double t1, t2, t3;
+
+		page = (uint8_t *)mmap(NULL, page_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED)
+			continue;
+		*page = 0xff;
+
+		/* a permission downgrade has to flush every CPU using the mm */
+		t1 = stress_time_now();
+		(void)mprotect((void *)page, page_size, PROT_READ);
+		t2 = stress_time_now();
+		(void)munmap((void *)page, page_size);
+		t3 = stress_time_now();
+
+		mprotect_time += t2 - t1;
+		munmap_time += t3 - t2;
+		ops += 2;
+		add_counter(args, 2);
+	}
+	if (ipis_ok && (stress_tlb_ipis(&ipis_end) == 0) && (ipis_end >= ipis_begin)) {
+		stats->ipis += ipis_end - ipis_begin;
+		stats->ipis_ok = true;
+	}
+	stats->cpus = n_remote + 1;
+	stats->mprotect_time += mprotect_time;
+	stats->munmap_time += munmap_time;
+	stats->ops += ops;
+stop:
+	stop = true;
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	return rc;
+}
+
+/*
+ *  stress_tlb_sweep()
+ *	measure shootdown latency and IPIs per call while sweeping
+ *	the number of CPUs that have the mm active, the remote CPUs
+ *	are taken from the initiator's socket first (same-socket)
+ *	or from the other sockets first (cross-socket)
+ */
+static int stress_tlb_sweep(const stress_args_t *args, const cpu_set_t *allowed)
+{
+	static stress_tlb_sweep_stats_t stats[TLB_SWEEP_PLACEMENTS][TLB_SWEEP_STEPS];
+	static int order[TLB_SWEEP_PLACEMENTS][CPU_SETSIZE];
+	const size_t page_size = args->page_size;
+	const size_t buf_size = page_size * TLB_SWEEP_PAGES;
+	stress_tlb_sweep_thread_t *threads;
+	size_t threads_size, idx = 0;
+	uint32_t n_same = 0, n_cross = 0, n_remote, steps[TLB_SWEEP_STEPS], n_steps = 0;
+	int cpu, initiator = -1, package, rc = EXIT_SUCCESS;
+	size_t pl, s;
+	cpu_set_t mask;
+	uint8_t *buf;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, allowed)) {
+			initiator = cpu;
+			break;
+		}
+	}
+	if (initiator < 0)
+		return EXIT_NO_RESOURCE;
+	package = stress_tlb_cpu_package(initiator);
+	for (cpu = initiator + 1; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, allowed))
+			continue;
+		if (stress_tlb_cpu_package(cpu) == package)
+			order[0][n_same++] = cpu;
+		else
+			order[1][n_cross++] = cpu;
+	}
+	/* same-socket: own socket then the rest, cross-socket: the reverse */
+	for (s = 0; s < n_cross; s++)
+		order[0][n_same + s] = order[1][s];
+	for (s = 0; s < n_same; s++)
+		order[1][n_cross + s] = order[0][s];
+	n_remote = n_same + n_cross;
+
+	/* 0, 1, 2, 4 .. remote CPUs, always ending with all of them */
+	steps[n_steps++] = 0;
+	for (s = 1; (s < n_remote) && (n_steps < TLB_SWEEP_STEPS - 1); s <<= 1)
+		steps[n_steps++] = (uint32_t)s;
+	if (n_remote)
+		steps[n_steps++] = n_remote;
+
+	buf = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, skipping stressor\n",
+			args->name, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(buf, 0xff, buf_size);
+	threads_size = sizeof(*threads) * (n_remote ? n_remote : 1);
+	threads = (stress_tlb_sweep_thread_t *)mmap(NULL, threads_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for the thread state, skipping stressor\n",
+			args->name, threads_size);
+		(void)munmap((void *)buf, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(stats, 0, sizeof(stats));
+
+	CPU_ZERO(&mask);
+	CPU_SET(initiator, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (pl = 0; (pl < TLB_SWEEP_PLACEMENTS) && (rc == EXIT_SUCCESS); pl++) {
+			/* with a single socket there is nothing to cross */
+			if ((pl == 1) && !n_cross)
+				continue;
+			for (s = 0; (s < n_steps) && keep_stressing(args); s++) {
+				rc = stress_tlb_sweep_step(args, order[pl], steps[s],
+					buf, threads, &stats[pl][s]);
+				if (rc != EXIT_SUCCESS)
+					break;
+			}
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	(void)sched_setaffinity(0, sizeof(*allowed), allowed);
+	(void)munmap((void *)threads, threads_size);
+	(void)munmap((void *)buf, buf_size);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-12s %5s %12s %12s %8s\n", args->name,
+			"placement", "CPUs", "mprotect ns", "munmap ns", "IPIs/op");
+	for (pl = 0; pl < TLB_SWEEP_PLACEMENTS; pl++) {
+		for (s = 0; s < n_steps; s++) {
+			const stress_tlb_sweep_stats_t *st = &stats[pl][s];
+			const double calls = (double)(st->ops / 2);
+			double mprotect_ns, munmap_ns, ipis;
+			char ipis_str[16], desc[40];
+
+			if (!st->ops)
+				continue;
+			mprotect_ns = (double)STRESS_NANOSECOND * st->mprotect_time / calls;
+			munmap_ns = (double)STRESS_NANOSECOND * st->munmap_time / calls;
+			ipis = (double)st->ipis / (double)st->ops;
+			if (st->ipis_ok)
+				(void)snprintf(ipis_str, sizeof(ipis_str), "%8.2f", ipis);
+			else
+				(void)shim_strlcpy(ipis_str, "n/a", sizeof(ipis_str));
+			if (args->instance == 0)
+				pr_inf("%s: %-12s %5" PRIu32 " %12.1f %12.1f %8s\n", args->name,
+					tlb_sweep_placements[pl], st->cpus,
+					mprotect_ns, munmap_ns, ipis_str);
+			/* the single CPU baseline and all CPUs */
+			if ((s != 0) && (s != n_steps - 1))
+				continue;
+			if ((pl == 1) && (s == 0))
+				continue;
+			(void)snprintf(desc, sizeof(desc), "%s mprotect ns, %" PRIu32 " CPU%s",
+				pl ? "cross" : "same", st->cpus, st->cpus > 1 ? "s" : "");
+			stress_misc_stats_set(args->misc_stats, idx++, desc, mprotect_ns);
+			(void)snprintf(desc, sizeof(desc), "%s munmap ns, %" PRIu32 " CPU%s",
+				pl ? "cross" : "same", st->cpus, st->cpus > 1 ? "s" : "");
+			stress_misc_stats_set(args->misc_stats, idx++, desc, munmap_ns);
+			if (st->ipis_ok) {
+				(void)snprintf(desc, sizeof(desc), "%s IPIs per op, %" PRIu32 " CPU%s",
+					pl ? "cross" : "same", st->cpus, st->cpus > 1 ? "s" : "");
+				stress_misc_stats_set(args->misc_stats, idx++, desc, ipis);
+			}
+		}
+	}
+	return rc;
+}
+#endif
+
 /*
  *  stress_tlb_shootdown()
  *	stress out TLB shootdowns
@@ -42,6 +391,7 @@ static int stress_tlb_shootdown(const stress_args_t *args)
 	const size_t mmap_size = page_size * MMAP_PAGES;
 	pid_t pids[MAX_TLB_PROCS];
 	cpu_set_t proc_mask_initial;
+	bool tlb_shootdown_sweep = false;
 
 	if (sched_getaffinity(0, sizeof(proc_mask_initial), &proc_mask_initial) < 0) {
 		pr_fail("%s: sched_getaffinity could not get CPU affinity, errno=%d (%s)\n",
@@ -49,6 +399,17 @@ static int stress_tlb_shootdown(const stress_args_t *args)
 		return EXIT_FAILURE;
 	}
 
+	(void)stress_get_setting("tlb-shootdown-sweep", &tlb_shootdown_sweep);
+	if (tlb_shootdown_sweep) {
+#if defined(HAVE_LIB_PTHREAD)
+		return stress_tlb_sweep(args, &proc_mask_initial);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --tlb-shootdown-sweep needs pthreads, "
+				"running the default shootdown stressor\n", args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -173,12 +534,14 @@ static int stress_tlb_shootdown(const stress_args_t *args)
 stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_tlb_shootdown,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
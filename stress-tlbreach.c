@@ -0,0 +1,397 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-mem-backing.h"
+#include "core-perf.h"
+#include "core-put.h"
+
+#define TLBREACH_MIN_PAGES	(64)		/* smallest working set in pages */
+#define TLBREACH_ROWS		(15)		/* 64 .. 1M pages, x 2 each row */
+#define TLBREACH_MIN_ACCESSES	(256 * 1024)	/* timed accesses per measurement */
+
+#define MIN_TLBREACH_BYTES	(TLBREACH_MIN_PAGES * 4 * KB)
+#define MAX_TLBREACH_BYTES	(MAX_MEM_LIMIT)
+#define DEFAULT_TLBREACH_BYTES	(256 * MB)
+
+#define TLBREACH_PATTERN_STRIDE	(0)
+#define TLBREACH_PATTERN_RANDOM	(1)
+#define TLBREACH_PATTERNS	(2)
+
+static const stress_help_t help[] = {
+	{ NULL,	"tlbreach N",		"start N workers measuring TLB miss cost over page counts" },
+	{ NULL,	"tlbreach-bytes N",	"largest working set of each page size" },
+	{ NULL,	"tlbreach-ops N",	"stop after N working set measurements" },
+	{ NULL,	"tlbreach-page P",	"page size, one of all, 4k, thp, 2m or 1g" },
+	{ NULL,	"tlbreach-pattern P",	"page access order, one of all, stride or random" },
+	{ NULL,	NULL,			NULL }
+};
+
+typedef struct {
+	const char *name;	/* --tlbreach-page name */
+	const int backing;	/* STRESS_MEM_BACKING_* */
+	const size_t size;	/* page size, 0 = system page size */
+} stress_tlbreach_page_t;
+
+static const stress_tlbreach_page_t tlbreach_pages[] = {
+	{ "all",	STRESS_MEM_BACKING_DEFAULT,	0 },
+	{ "4k",		STRESS_MEM_BACKING_4K,		0 },
+	{ "thp",	STRESS_MEM_BACKING_THP,		2 * MB },
+	{ "2m",		STRESS_MEM_BACKING_2M,		2 * MB },
+	{ "1g",		STRESS_MEM_BACKING_1G,		GB },
+};
+
+#define TLBREACH_PAGES		(SIZEOF_ARRAY(tlbreach_pages))
+
+static const char * const tlbreach_patterns[] = {
+	"all",
+	"stride",
+	"random",
+};
+
+static int stress_set_tlbreach_bytes(const char *opt)
+{
+	size_t tlbreach_bytes;
+
+	tlbreach_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("tlbreach-bytes", tlbreach_bytes,
+		MIN_TLBREACH_BYTES, MAX_TLBREACH_BYTES);
+	return stress_set_setting("tlbreach-bytes", TYPE_ID_SIZE_T, &tlbreach_bytes);
+}
+
+static int stress_set_tlbreach_page(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < TLBREACH_PAGES; i++) {
+		if (!strcmp(opt, tlbreach_pages[i].name))
+			return stress_set_setting("tlbreach-page", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "tlbreach-page must be one of:");
+	for (i = 0; i < TLBREACH_PAGES; i++)
+		(void)fprintf(stderr, " %s", tlbreach_pages[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_tlbreach_pattern(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(tlbreach_patterns); i++) {
+		if (!strcmp(opt, tlbreach_patterns[i]))
+			return stress_set_setting("tlbreach-pattern", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "tlbreach-pattern must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(tlbreach_patterns); i++)
+		(void)fprintf(stderr, " %s", tlbreach_patterns[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_tlbreach_bytes,		stress_set_tlbreach_bytes },
+	{ OPT_tlbreach_page,		stress_set_tlbreach_page },
+	{ OPT_tlbreach_pattern,		stress_set_tlbreach_pattern },
+	{ 0,				NULL }
+};
+
+/* one working set measurement */
+typedef struct {
+	double	duration;	/* time of timed accesses */
+	uint64_t accesses;	/* timed accesses */
+	uint64_t misses;	/* dTLB load misses in timed accesses */
+	bool	perf_ok;	/* misses is valid */
+} stress_tlbreach_cell_t;
+
+static stress_tlbreach_cell_t tlbreach_cells[TLBREACH_PAGES][TLBREACH_PATTERNS][TLBREACH_ROWS];
+
+/*
+ *  stress_tlbreach_line()
+ *	the cache line touched in page n, the line offset varies
+ *	over the first 4K of the page so that the lines do not all
+ *	land in the same cache set
+ */
+static inline uint8_t *stress_tlbreach_line(
+	uint8_t *buf,
+	const size_t page_size,
+	const size_t n)
+{
+	return buf + (n * page_size) + (((n * 37) & 63) * 64);
+}
+
+/*
+ *  stress_tlbreach_chase()
+ *	follow n links of the pointer chain, each load depends on
+ *	the previous one so the page walk latency is not hidden
+ */
+static void * OPTIMIZE3 stress_tlbreach_chase(void *ptr, uint64_t n)
+{
+	register void **p = (void **)ptr;
+
+	while (n >= 8) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		n -= 8;
+	}
+	while (n--)
+		p = (void **)*p;
+	return (void *)p;
+}
+
+/*
+ *  stress_tlbreach_measure()
+ *	link one line in each of the first pages pages into a cycle,
+ *	in page order for stride or a random single cycle for random,
+ *	then time a pass of dependent loads around the cycle
+ */
+static void stress_tlbreach_measure(
+	uint8_t *buf,
+	const size_t page_size,
+	const size_t pages,
+	const size_t pattern,
+	uint32_t *order,
+	const int dtlb_fd,
+	stress_tlbreach_cell_t *cell)
+{
+	const uint64_t accesses = STRESS_MAXIMUM((uint64_t)pages * 2, TLBREACH_MIN_ACCESSES);
+	void *ptr;
+	double t;
+	size_t i;
+#if defined(STRESS_PERF_STATS)
+	uint64_t misses_begin = 0, misses_end = 0;
+	bool perf_ok = false;
+#endif
+
+	for (i = 0; i < pages; i++)
+		order[i] = (uint32_t)i;
+	if (pattern == TLBREACH_PATTERN_RANDOM) {
+		/* Sattolo's shuffle, a single cycle through every page */
+		for (i = pages - 1; i > 0; i--) {
+			const size_t j = (size_t)(stress_mwc32() % i);
+			const uint32_t tmp = order[i];
+
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+	}
+	for (i = 0; i < pages; i++) {
+		void **line = (void **)stress_tlbreach_line(buf, page_size, order[i]);
+
+		*line = (void *)stress_tlbreach_line(buf, page_size,
+			order[(i + 1 < pages) ? i + 1 : 0]);
+	}
+
+	/* warm the caches and TLBs up as far as they reach */
+	ptr = stress_tlbreach_chase((void *)stress_tlbreach_line(buf, page_size, order[0]), pages);
+
+#if defined(STRESS_PERF_STATS)
+	if (dtlb_fd >= 0)
+		perf_ok = (stress_perf_dtlb_read(dtlb_fd, &misses_begin) == 0);
+#else
+	(void)dtlb_fd;
+#endif
+	t = stress_time_now();
+	ptr = stress_tlbreach_chase(ptr, accesses);
+	t = stress_time_now() - t;
+#if defined(STRESS_PERF_STATS)
+	if (perf_ok && (stress_perf_dtlb_read(dtlb_fd, &misses_end) == 0)) {
+		cell->misses += misses_end - misses_begin;
+		cell->perf_ok = true;
+	}
+#endif
+	stress_void_ptr_put(ptr);
+
+	cell->duration += t;
+	cell->accesses += accesses;
+}
+
+/*
+ *  stress_tlbreach()
+ *	measure the cost of TLB misses over working sets of an
+ *	increasing number of pages of each page size
+ */
+static int stress_tlbreach(const stress_args_t *args)
+{
+	size_t tlbreach_bytes = DEFAULT_TLBREACH_BYTES;
+	size_t tlbreach_page = 0, tlbreach_pattern = 0;
+	size_t order_size, p, idx = 0;
+	uint32_t *order;
+	bool skipped[TLBREACH_PAGES], thp_reported = false;
+	int dtlb_fd = -1;
+
+	(void)stress_get_setting("tlbreach-page", &tlbreach_page);
+	(void)stress_get_setting("tlbreach-pattern", &tlbreach_pattern);
+	if (!stress_get_setting("tlbreach-bytes", &tlbreach_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			tlbreach_bytes = MAX_TLBREACH_BYTES;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			tlbreach_bytes = MIN_TLBREACH_BYTES;
+	}
+
+	order_size = (tlbreach_bytes / args->page_size) * sizeof(*order);
+	order = (uint32_t *)mmap(NULL, order_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (order == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for the page order, skipping stressor\n",
+			args->name, order_size);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(skipped, 0, sizeof(skipped));
+	(void)memset(tlbreach_cells, 0, sizeof(tlbreach_cells));
+
+#if defined(STRESS_PERF_STATS)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		dtlb_fd = stress_perf_dtlb_open();
+		if ((dtlb_fd < 0) && (args->instance == 0))
+			pr_inf("%s: dTLB load miss counter not available\n", args->name);
+	}
+#endif
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (p = 1; (p < TLBREACH_PAGES) && keep_stressing(args); p++) {
+			const size_t page_size = tlbreach_pages[p].size ?
+				tlbreach_pages[p].size : args->page_size;
+			const size_t max_pages = STRESS_MINIMUM(tlbreach_bytes / page_size,
+				(size_t)TLBREACH_MIN_PAGES << (TLBREACH_ROWS - 1));
+			size_t sz = max_pages * page_size, pattern;
+			uint8_t *buf;
+
+			if ((tlbreach_page && (tlbreach_page != p)) || skipped[p])
+				continue;
+			if (max_pages < TLBREACH_MIN_PAGES) {
+				if (args->instance == 0)
+					pr_inf("%s: %s pages skipped, %d pages need more than "
+						"--tlbreach-bytes %zu\n", args->name,
+						tlbreach_pages[p].name, TLBREACH_MIN_PAGES, tlbreach_bytes);
+				skipped[p] = true;
+				continue;
+			}
+			buf = (uint8_t *)stress_mem_backing_mmap_type(tlbreach_pages[p].backing,
+				&sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS);
+			if (buf == MAP_FAILED) {
+				if (args->instance == 0)
+					pr_inf("%s: %s pages skipped, cannot mmap %zu bytes, "
+						"errno=%d (%s)\n", args->name, tlbreach_pages[p].name,
+						sz, errno, strerror(errno));
+				skipped[p] = true;
+				continue;
+			}
+			if ((tlbreach_pages[p].backing == STRESS_MEM_BACKING_THP) && !thp_reported) {
+				double percent;
+
+				/* touch every page so that the smaps count is meaningful */
+				(void)memset(buf, 0, sz);
+				percent = stress_mem_backing_thp_percent(buf);
+				if ((percent >= 0.0) && (args->instance == 0))
+					pr_inf("%s: thp pages, %.1f%% of the buffer in huge pages\n",
+						args->name, percent);
+				thp_reported = true;
+			}
+
+			for (pattern = 0; pattern < TLBREACH_PATTERNS; pattern++) {
+				size_t row;
+
+				if (tlbreach_pattern && (tlbreach_pattern != pattern + 1))
+					continue;
+				for (row = 0; row < TLBREACH_ROWS; row++) {
+					const size_t pages = (size_t)TLBREACH_MIN_PAGES << row;
+
+					if ((pages > max_pages) || !keep_stressing(args))
+						break;
+					stress_tlbreach_measure(buf, page_size, pages, pattern,
+						order, dtlb_fd, &tlbreach_cells[p][pattern][row]);
+					inc_counter(args);
+				}
+			}
+			(void)munmap((void *)buf, sz);
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (dtlb_fd >= 0)
+		(void)close(dtlb_fd);
+	(void)munmap((void *)order, order_size);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-4s %-7s %9s %11s %10s %13s\n", args->name,
+			"page", "pattern", "pages", "working set", "ns/access", "dTLB miss/acc");
+	for (p = 1; p < TLBREACH_PAGES; p++) {
+		const size_t page_size = tlbreach_pages[p].size ?
+			tlbreach_pages[p].size : args->page_size;
+		size_t pattern;
+
+		for (pattern = 0; pattern < TLBREACH_PATTERNS; pattern++) {
+			const stress_tlbreach_cell_t *last = NULL;
+			size_t row;
+
+			for (row = 0; row < TLBREACH_ROWS; row++) {
+				const stress_tlbreach_cell_t *cell = &tlbreach_cells[p][pattern][row];
+				const size_t pages = (size_t)TLBREACH_MIN_PAGES << row;
+				char ws[32], misses[32];
+
+				if (!cell->accesses || (cell->duration <= 0.0))
+					continue;
+				last = cell;
+				if (args->instance != 0)
+					continue;
+				stress_uint64_to_str(ws, sizeof(ws), (uint64_t)pages * page_size);
+				if (cell->perf_ok)
+					(void)snprintf(misses, sizeof(misses), "%13.4f",
+						(double)cell->misses / (double)cell->accesses);
+				else
+					shim_strlcpy(misses, "n/a", sizeof(misses));
+				pr_inf("%s: %-4s %-7s %9zu %11s %10.2f %13s\n", args->name,
+					tlbreach_pages[p].name, tlbreach_patterns[pattern + 1],
+					pages, ws, (double)STRESS_NANOSECOND * cell->duration /
+					(double)cell->accesses, misses);
+			}
+			/* summarise the random pattern at its largest working set */
+			if (last && (pattern == TLBREACH_PATTERN_RANDOM)) {
+				char desc[32];
+
+				(void)snprintf(desc, sizeof(desc), "%s random ns/access", tlbreach_pages[p].name);
+				stress_misc_stats_set(args->misc_stats, idx++, desc,
+					(double)STRESS_NANOSECOND * last->duration / (double)last->accesses);
+				if (last->perf_ok) {
+					(void)snprintf(desc, sizeof(desc), "%s random dTLB miss/access", tlbreach_pages[p].name);
+					stress_misc_stats_set(args->misc_stats, idx++, desc,
+						(double)last->misses / (double)last->accesses);
+				}
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+stressor_info_t stress_tlbreach_info = {
+	.stressor = stress_tlbreach,
+	.class = CLASS_VM | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arena.h"
+#include "core-cache.h"
 
 #if defined(HAVE_SYS_TREE_H)
 #include <sys/tree.h>
@@ -31,6 +33,15 @@
 #define MAX_TREE_SIZE		(25000000)
 #define DEFAULT_TREE_SIZE	(250000)
 
+#define TREE_SWEEP_MIN		(1024)	/* smallest --tree-sweep size */
+#define TREE_MAX_SIZES		(16)	/* maximum --tree-sweep steps */
+#define TREE_MAX_METHODS	(16)	/* maximum number of tree methods */
+
+#if defined(HAVE_LIB_BSD) &&	\
+    !defined(__APPLE__)
+#define HAVE_RB_TREE		(1)
+#endif
+
 struct tree_node;
 
 typedef void (*stress_tree_func)(const stress_args_t *args,
@@ -42,21 +53,26 @@ typedef struct {
 	const stress_tree_func   func;	/* the tree method function */
 } stress_tree_method_info_t;
 
+typedef struct {
+	double	lookups;		/* number of timed lookups */
+	double	duration;		/* duration of timed lookups */
+} stress_tree_lookup_stats_t;
+
 static const stress_tree_method_info_t tree_methods[];
 
 static const stress_help_t help[] = {
 	{ NULL,	"tree N",	 "start N workers that exercise tree structures" },
 	{ NULL,	"tree-ops N",	 "stop after N bogo tree operations" },
-	{ NULL,	"tree-method M", "select tree method: all,avl,binary,btree,rb,splay" },
+	{ NULL,	"tree-method M", "select tree method: all,avl,binary,bplus-cl,bplus-page,btree,eytzinger,rb,splay,veb" },
 	{ NULL,	"tree-size N",	 "N is the number of items in the tree" },
+	{ NULL,	"tree-sweep",	 "sweep tree sizes from 1K items up to the tree size" },
 	{ NULL,	NULL,		 NULL }
 };
 
-#if defined(HAVE_LIB_BSD) &&	\
-    !defined(__APPLE__)
-
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
+static stress_slab_t slab;		/* btree node slab */
+static stress_slab_t *btree_slab;	/* &slab, NULL for libc */
 
 struct binary_node {
 	struct tree_node *left;
@@ -86,15 +102,18 @@ typedef struct btree_node {
 struct tree_node {
 	uint64_t value;
 	union {
+#if defined(HAVE_RB_TREE)
 		RB_ENTRY(tree_node)	rb;
 		SPLAY_ENTRY(tree_node)	splay;
+#endif
 		struct binary_node	binary;
 		struct avl_node		avl;
 		uint64_t		padding[3]; /* cppcheck-suppress unusedStructMember */
 	} u;
 };
 
-#endif
+static stress_tree_lookup_stats_t tree_stats[TREE_MAX_METHODS][TREE_MAX_SIZES];
+static size_t tree_size_idx;		/* current --tree-sweep size index */
 
 /*
  *  stress_set_tree_size()
@@ -110,8 +129,10 @@ static int stress_set_tree_size(const char *opt)
 	return stress_set_setting("tree-size", TYPE_ID_UINT64, &tree_size);
 }
 
-#if defined(HAVE_LIB_BSD) &&	\
-    !defined(__APPLE__)
+static int stress_set_tree_sweep(const char *opt)
+{
+	return stress_set_setting_true("tree-sweep", opt);
+}
 
 /*
  *  stress_tree_handler()
@@ -127,6 +148,26 @@ static void MLOCKED_TEXT stress_tree_handler(int signum)
 	}
 }
 
+/*
+ *  stress_tree_lookups()
+ *	account duration of n timed lookups to the named method
+ *	at the current tree size
+ */
+static void stress_tree_lookups(const char *name, const size_t n, const double duration)
+{
+	size_t i;
+
+	for (i = 0; (i < TREE_MAX_METHODS) && tree_methods[i].name; i++) {
+		if (!strcmp(tree_methods[i].name, name)) {
+			tree_stats[i][tree_size_idx].lookups += (double)n;
+			tree_stats[i][tree_size_idx].duration += duration;
+			return;
+		}
+	}
+}
+
+#if defined(HAVE_RB_TREE)
+
 static int tree_node_cmp_fwd(struct tree_node *n1, struct tree_node *n2)
 {
 	if (n1->value == n2->value)
@@ -151,6 +192,7 @@ static void stress_tree_rb(
 	struct tree_node *nodes)
 {
 	size_t i;
+	double t;
 	register struct tree_node *node, *next;
 	struct tree_node *find;
 
@@ -165,12 +207,14 @@ static void stress_tree_rb(
 	}
 
 	/* Manditory forward tree check */
+	t = stress_time_now();
 	for (node = nodes, i = 0; i < n; i++, node++) {
 		find = RB_FIND(stress_rb_tree, &rb_root, node);
 		if (!find)
 			pr_fail("%s: rb tree node #%zd not found\n",
 				args->name, i);
 	}
+	stress_tree_lookups("rb", n, stress_time_now() - t);
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		/* optional reverse find */
 		for (node = &nodes[n - 1], i = n - 1; node >= nodes; node--, i--) {
@@ -202,6 +246,7 @@ static void stress_tree_splay(
 	struct tree_node *nodes)
 {
 	size_t i;
+	double t;
 	register struct tree_node *node, *next;
 	struct tree_node *find;
 
@@ -216,12 +261,14 @@ static void stress_tree_splay(
 	}
 
 	/* Manditory forward tree check */
+	t = stress_time_now();
 	for (node = nodes, i = 0; i < n; i++, node++) {
 		find = SPLAY_FIND(stress_splay_tree, &splay_root, node);
 		if (!find)
 			pr_fail("%s: splay tree node #%zd not found\n",
 				args->name, i);
 	}
+	stress_tree_lookups("splay", n, stress_time_now() - t);
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		/* optional reverse find */
 		for (node = &nodes[n - 1], i = n - 1; node >= nodes; node--, i--) {
@@ -246,6 +293,7 @@ static void stress_tree_splay(
 		(void)memset(&node->u.splay, 0, sizeof(node->u.splay));
 	}
 }
+#endif
 
 static void OPTIMIZE3 binary_insert(
 	struct tree_node **head,
@@ -290,6 +338,7 @@ static void stress_tree_binary(
 	struct tree_node *nodes)
 {
 	size_t i;
+	double t;
 	struct tree_node *node, *head = NULL;
 	struct tree_node *find;
 
@@ -298,12 +347,14 @@ static void stress_tree_binary(
 	}
 
 	/* Manditory forward tree check */
+	t = stress_time_now();
 	for (node = nodes, i = 0; i < n; i++, node++) {
 		find = binary_find(head, node);
 		if (!find)
 			pr_fail("%s: binary tree node #%zd not found\n",
 				args->name, i);
 	}
+	stress_tree_lookups("binary", n, stress_time_now() - t);
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		/* optional reverse find */
 		for (node = &nodes[n - 1], i = n - 1; node >= nodes; node--, i--) {
@@ -483,6 +534,7 @@ static void stress_tree_avl(
 	struct tree_node *nodes)
 {
 	size_t i;
+	double t;
 	struct tree_node *node, *head = NULL;
 	struct tree_node *find;
 
@@ -492,12 +544,14 @@ static void stress_tree_avl(
 	}
 
 	/* Manditory forward tree check */
+	t = stress_time_now();
 	for (node = nodes, i = 0; i < n; i++, node++) {
 		find = avl_find(head, node);
 		if (!find)
 			pr_fail("%s: avl tree node #%zd not found\n",
 				args->name, i);
 	}
+	stress_tree_lookups("avl", n, stress_time_now() - t);
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		/* optional reverse find */
 		for (node = &nodes[n - 1], i = n - 1; node >= nodes; node--, i--) {
@@ -519,6 +573,17 @@ static void stress_tree_avl(
 	avl_remove_tree(head);
 }
 
+/*
+ *  btree_node_alloc()
+ *	allocate a zero'd btree node
+ */
+static inline btree_node_t *btree_node_alloc(void)
+{
+	if (btree_slab)
+		return (btree_node_t *)stress_slab_alloc(btree_slab);
+	return (btree_node_t *)calloc(1, sizeof(btree_node_t));
+}
+
 static void OPTIMIZE3 btree_insert_node(
 	const uint64_t value,
 	const int pos,
@@ -548,7 +613,7 @@ static btree_node_t * OPTIMIZE3 btree_split_node(
 	register int j;
 	int median = (pos > BTREE_MIN) ? BTREE_MIN + 1 : BTREE_MIN;
 
-	new_node = (btree_node_t *)calloc(1, sizeof(*new_node));
+	new_node = btree_node_alloc();
 	if (UNLIKELY(!new_node))
 		return NULL;
 
@@ -625,7 +690,7 @@ static bool OPTIMIZE3 btree_insert(btree_node_t **root, const uint64_t value)
 	if (flag) {
 		btree_node_t *node;
 
-		node = (btree_node_t *)calloc(1, sizeof(*node));
+		node = btree_node_alloc();
 		if (UNLIKELY(!node))
 			return false;
 		node->count = 1;
@@ -644,6 +709,12 @@ static void OPTIMIZE3 btree_remove_tree(btree_node_t **node)
 
 	if (!*node)
 		return;
+	if (btree_slab) {
+		/* all the nodes are free'd in one go */
+		stress_slab_reset(btree_slab);
+		*node = NULL;
+		return;
+	}
 
 	for (i = 0; i <= (*node)->count; i++) {
 		btree_remove_tree(&(*node)->node[i]);
@@ -690,6 +761,7 @@ static void stress_tree_btree(
 	struct tree_node *nodes)
 {
 	size_t i;
+	double t;
 	struct tree_node *node;
 	btree_node_t *root = NULL;
 	bool find;
@@ -698,12 +770,14 @@ static void stress_tree_btree(
 		btree_insert(&root, node->value);
 
 	/* Manditory forward tree check */
+	t = stress_time_now();
 	for (node = nodes, i = 0; i < n; i++, node++) {
 		find = btree_find(root, node->value);
 		if (!find)
 			pr_fail("%s: btree node #%zd not found\n",
 				args->name, i);
 	}
+	stress_tree_lookups("btree", n, stress_time_now() - t);
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		/* optional reverse find */
 		for (node = &nodes[n - 1], i = n - 1; node >= nodes; node--, i--) {
@@ -725,32 +799,452 @@ static void stress_tree_btree(
 	btree_remove_tree(&root);
 }
 
+/*
+ *  Cache conscious search structures. These are static structures
+ *  bulk loaded from the sorted keys, so insertion cost is a sort
+ *  and the lookups are what is being compared against the pointer
+ *  linked trees above.
+ */
+#define BPLUS_CL_KEYS		(64 / sizeof(uint64_t))		/* keys per cache line node */
+#define BPLUS_PAGE_KEYS		(4096 / sizeof(uint64_t))	/* keys per page node */
+#define BPLUS_MAX_LEVELS	(32)
+#define VEB_NONE		(~(uint32_t)0)
+
+typedef struct {
+	uint64_t *level[BPLUS_MAX_LEVELS];	/* level 0 holds all the keys */
+	size_t	size[BPLUS_MAX_LEVELS];		/* keys per level, padded to b */
+	size_t	levels;				/* number of levels */
+	size_t	n;				/* number of real keys */
+	uint64_t *mem;				/* all levels */
+	size_t	mem_size;			/* size of mem mapping */
+} bplus_tree_t;
+
+typedef struct {
+	uint64_t value;
+	uint32_t child[2];			/* left, right, VEB_NONE if none */
+} veb_node_t;
+
+static int OPTIMIZE3 tree_value_cmp(const void *p1, const void *p2)
+{
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+/*
+ *  tree_sorted_values()
+ *	return sorted copy of the node values, NULL if out of memory
+ */
+static uint64_t *tree_sorted_values(const struct tree_node *nodes, const size_t n)
+{
+	uint64_t *values;
+	size_t i;
+
+	values = (uint64_t *)malloc(n * sizeof(*values));
+	if (!values)
+		return NULL;
+	for (i = 0; i < n; i++)
+		values[i] = nodes[i].value;
+	qsort(values, n, sizeof(*values), tree_value_cmp);
+
+	return values;
+}
+
+/*
+ *  bplus_build()
+ *	bulk load a static B+tree with b keys per node, each level
+ *	holds the largest key of each node of the level below and
+ *	child nodes are found implicitly by index
+ */
+static bool bplus_build(bplus_tree_t *tree, const uint64_t *values, const size_t n, const size_t b)
+{
+	size_t l, i, total = 0;
+	uint64_t *ptr;
+
+	(void)memset(tree, 0, sizeof(*tree));
+	tree->n = n;
+	tree->size[0] = ((n + b - 1) / b) * b;
+	for (l = 0; (tree->size[l] > b) && (l < BPLUS_MAX_LEVELS - 1); l++) {
+		const size_t nodes = tree->size[l] / b;
+
+		tree->size[l + 1] = ((nodes + b - 1) / b) * b;
+	}
+	tree->levels = l + 1;
+	for (l = 0; l < tree->levels; l++)
+		total += tree->size[l];
+
+	/* mmap'd so nodes are cache line and page aligned */
+	tree->mem_size = total * sizeof(uint64_t);
+	tree->mem = (uint64_t *)mmap(NULL, tree->mem_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (tree->mem == MAP_FAILED)
+		return false;
+
+	for (ptr = tree->mem, l = 0; l < tree->levels; l++) {
+		tree->level[l] = ptr;
+		ptr += tree->size[l];
+	}
+	(void)memcpy(tree->level[0], values, n * sizeof(*values));
+	for (i = n; i < tree->size[0]; i++)
+		tree->level[0][i] = ~(uint64_t)0;
+	for (l = 1; l < tree->levels; l++) {
+		const size_t nodes = tree->size[l - 1] / b;
+
+		for (i = 0; i < nodes; i++)
+			tree->level[l][i] = tree->level[l - 1][(i * b) + b - 1];
+		for (; i < tree->size[l]; i++)
+			tree->level[l][i] = ~(uint64_t)0;
+	}
+	return true;
+}
+
+static void bplus_free(bplus_tree_t *tree)
+{
+	if (tree->mem && (tree->mem != MAP_FAILED))
+		(void)munmap((void *)tree->mem, tree->mem_size);
+	tree->mem = NULL;
+}
+
+/*
+ *  bplus_node_search()
+ *	index of first key >= value in a node of b sorted keys,
+ *	b if all keys are less than value; branchless
+ */
+static inline size_t OPTIMIZE3 bplus_node_search(
+	const uint64_t *node,
+	const size_t b,
+	const uint64_t value)
+{
+	register size_t j = 0, len = b;
+	register const uint64_t *base = node;
+
+	if (b <= BPLUS_CL_KEYS) {
+		/* whole cache line, just count the smaller keys */
+		for (j = 0; len; len--, base++)
+			j += (*base < value);
+		return j;
+	}
+	while (len > 1) {
+		const size_t half = len / 2;
+
+		base += (base[half - 1] < value) * half;
+		len -= half;
+	}
+	return (size_t)(base - node) + (*base < value);
+}
+
+static inline bool OPTIMIZE3 bplus_find(
+	const bplus_tree_t *tree,
+	const size_t b,
+	const uint64_t value)
+{
+	register size_t l = tree->levels - 1, idx = 0;
+
+	for (;;) {
+		const size_t j = bplus_node_search(tree->level[l] + (idx * b), b, value);
+
+		if (j == b)
+			return false;
+		idx = (idx * b) + j;
+		if (l == 0)
+			return (idx < tree->n) && (tree->level[0][idx] == value);
+		l--;
+	}
+}
+
+static void stress_tree_bplus(
+	const stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes,
+	const char *name,
+	const size_t b)
+{
+	size_t i;
+	double t;
+	bplus_tree_t tree;
+	uint64_t *values;
+	bool ok;
+
+	values = tree_sorted_values(nodes, n);
+	if (!values)
+		return;
+	ok = bplus_build(&tree, values, n, b);
+	free(values);
+	if (!ok)
+		return;
+
+	/* Manditory forward tree check */
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		if (!bplus_find(&tree, b, nodes[i].value))
+			pr_fail("%s: %s node #%zd not found\n",
+				args->name, name, i);
+	}
+	stress_tree_lookups(name, n, stress_time_now() - t);
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		/* optional random find */
+		for (i = 0; i < n; i++) {
+			const size_t j = stress_mwc32() % n;
+
+			if (!bplus_find(&tree, b, nodes[j].value))
+				pr_fail("%s: %s node #%zd not found\n",
+					args->name, name, j);
+		}
+	}
+	bplus_free(&tree);
+}
+
+static void stress_tree_bplus_cl(
+	const stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes)
+{
+	stress_tree_bplus(args, n, nodes, "bplus-cl", BPLUS_CL_KEYS);
+}
+
+static void stress_tree_bplus_page(
+	const stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes)
+{
+	stress_tree_bplus(args, n, nodes, "bplus-page", BPLUS_PAGE_KEYS);
+}
+
+/*
+ *  veb_layout()
+ *	assign van Emde Boas layout positions to the nodes of a
+ *	complete binary tree of height h rooted at breadth first
+ *	index root; the top half of the tree is laid out first
+ *	followed by each of the bottom half subtrees
+ */
+static void veb_layout(uint32_t *pos, const size_t root, const size_t h, uint32_t *next)
+{
+	size_t top, bottom, i;
+
+	if (h == 1) {
+		pos[root] = (*next)++;
+		return;
+	}
+	bottom = h / 2;
+	top = h - bottom;
+	veb_layout(pos, root, top, next);
+	for (i = 0; i < ((size_t)1 << top); i++)
+		veb_layout(pos, (root << top) + i, bottom, next);
+}
+
+/*
+ *  veb_fill()
+ *	fill in node values in order and the child links
+ */
+static size_t veb_fill(
+	veb_node_t *tree,
+	const uint32_t *pos,
+	const size_t total,
+	const size_t k,
+	const uint64_t *values,
+	const size_t n,
+	size_t i)
+{
+	veb_node_t *node = &tree[pos[k]];
+	const size_t left = 2 * k, right = (2 * k) + 1;
+
+	if (left <= total)
+		i = veb_fill(tree, pos, total, left, values, n, i);
+	node->value = (i < n) ? values[i] : ~(uint64_t)0;
+	node->child[0] = (left <= total) ? pos[left] : VEB_NONE;
+	node->child[1] = (right <= total) ? pos[right] : VEB_NONE;
+	i++;
+	if (right <= total)
+		i = veb_fill(tree, pos, total, right, values, n, i);
+	return i;
+}
+
+static inline bool OPTIMIZE3 veb_find(const veb_node_t *tree, const uint64_t value)
+{
+	register uint32_t idx = 0;
+
+	while (idx != VEB_NONE) {
+		register const veb_node_t *node = &tree[idx];
+
+		if (node->value == value)
+			return true;
+		idx = node->child[value > node->value];
+	}
+	return false;
+}
+
+static void stress_tree_veb(
+	const stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes)
+{
+	size_t i, h, total;
+	double t;
+	uint64_t *values;
+	uint32_t *pos, next = 0;
+	veb_node_t *tree;
+
+	for (h = 1; (((size_t)1 << h) - 1) < n; h++)
+		;
+	total = ((size_t)1 << h) - 1;
+
+	values = tree_sorted_values(nodes, n);
+	if (!values)
+		return;
+	pos = (uint32_t *)malloc((total + 1) * sizeof(*pos));
+	if (!pos)
+		goto free_values;
+	tree = (veb_node_t *)malloc(total * sizeof(*tree));
+	if (!tree)
+		goto free_pos;
+
+	veb_layout(pos, 1, h, &next);
+	(void)veb_fill(tree, pos, total, 1, values, n, 0);
+
+	/* Manditory forward tree check */
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		if (!veb_find(tree, nodes[i].value))
+			pr_fail("%s: veb node #%zd not found\n",
+				args->name, i);
+	}
+	stress_tree_lookups("veb", n, stress_time_now() - t);
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		/* optional random find */
+		for (i = 0; i < n; i++) {
+			const size_t j = stress_mwc32() % n;
+
+			if (!veb_find(tree, nodes[j].value))
+				pr_fail("%s: veb node #%zd not found\n",
+					args->name, j);
+		}
+	}
+	free(tree);
+free_pos:
+	free(pos);
+free_values:
+	free(values);
+}
+
+/*
+ *  eytzinger_fill()
+ *	fill 1 based breadth first array from sorted values
+ */
+static size_t eytzinger_fill(
+	uint64_t *array,
+	const size_t k,
+	const uint64_t *values,
+	const size_t n,
+	size_t i)
+{
+	if (k <= n) {
+		i = eytzinger_fill(array, 2 * k, values, n, i);
+		array[k] = values[i++];
+		i = eytzinger_fill(array, (2 * k) + 1, values, n, i);
+	}
+	return i;
+}
+
+static inline bool OPTIMIZE3 eytzinger_find(
+	const uint64_t *array,
+	const size_t n,
+	const uint64_t value)
+{
+	register size_t k = 1;
+
+	while (k <= n) {
+		/* 8 keys, 3 levels down, are in one cache line */
+		shim_builtin_prefetch(array + (k * 8));
+		k = (2 * k) + (array[k] < value);
+	}
+	/* undo the right turns taken after the last left turn */
+#if defined(HAVE_BUILTIN_CTZ)
+	k >>= (size_t)__builtin_ctz(~(unsigned int)k) + 1;
+#else
+	while (k & 1)
+		k >>= 1;
+	k >>= 1;
+#endif
+	return (k != 0) && (array[k] == value);
+}
+
+static void stress_tree_eytzinger(
+	const stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes)
+{
+	size_t i;
+	double t;
+	uint64_t *values, *array;
+
+	values = tree_sorted_values(nodes, n);
+	if (!values)
+		return;
+	array = (uint64_t *)malloc((n + 1) * sizeof(*array));
+	if (!array) {
+		free(values);
+		return;
+	}
+	array[0] = 0;
+	(void)eytzinger_fill(array, 1, values, n, 0);
+	free(values);
+
+	/* Manditory forward tree check */
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		if (!eytzinger_find(array, n, nodes[i].value))
+			pr_fail("%s: eytzinger node #%zd not found\n",
+				args->name, i);
+	}
+	stress_tree_lookups("eytzinger", n, stress_time_now() - t);
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		/* optional random find */
+		for (i = 0; i < n; i++) {
+			const size_t j = stress_mwc32() % n;
+
+			if (!eytzinger_find(array, n, nodes[j].value))
+				pr_fail("%s: eytzinger node #%zd not found\n",
+					args->name, j);
+		}
+	}
+	free(array);
+}
+
 static void stress_tree_all(
 	const stress_args_t *args,
 	const size_t n,
 	struct tree_node *nodes)
 {
+#if defined(HAVE_RB_TREE)
 	stress_tree_rb(args, n, nodes);
 	stress_tree_splay(args, n, nodes);
+#endif
 	stress_tree_binary(args, n, nodes);
 	stress_tree_avl(args, n, nodes);
 	stress_tree_btree(args, n, nodes);
+	stress_tree_bplus_cl(args, n, nodes);
+	stress_tree_bplus_page(args, n, nodes);
+	stress_tree_veb(args, n, nodes);
+	stress_tree_eytzinger(args, n, nodes);
 }
-#endif
 
 /*
  * Table of tree stress methods
  */
 static const stress_tree_method_info_t tree_methods[] = {
-#if defined(HAVE_LIB_BSD) &&	\
-    !defined(__APPLE__)
 	{ "all",	stress_tree_all },
 	{ "avl",	stress_tree_avl },
 	{ "binary",	stress_tree_binary },
+#if defined(HAVE_RB_TREE)
 	{ "rb",		stress_tree_rb },
 	{ "splay",	stress_tree_splay },
-	{ "btree",	stress_tree_btree },
 #endif
+	{ "btree",	stress_tree_btree },
+	{ "bplus-cl",	stress_tree_bplus_cl },
+	{ "bplus-page",	stress_tree_bplus_page },
+	{ "veb",	stress_tree_veb },
+	{ "eytzinger",	stress_tree_eytzinger },
 	{ NULL,		NULL },
 };
 
@@ -781,12 +1275,10 @@ static int stress_set_tree_method(const char *name)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_tree_method,	stress_set_tree_method },
 	{ OPT_tree_size,	stress_set_tree_size },
+	{ OPT_tree_sweep,	stress_set_tree_sweep },
 	{ 0,			NULL }
 };
 
-#if defined(HAVE_LIB_BSD) && 	\
-    !defined(__APPLE__)
-
 /*
  *  Rotate right a 64 bit value, compiler
  *  optimizes this down to a rotate and store
@@ -800,6 +1292,67 @@ static inline uint64_t ror64(const uint64_t val)
 	return (tmp | bit0);
 }
 
+/*
+ *  stress_tree_report()
+ *	report lookups per second for each method and tree size
+ */
+static void stress_tree_report(
+	const stress_args_t *args,
+	const size_t *sizes,
+	const size_t n_sizes)
+{
+	size_t i, s, idx = 0;
+	bool lock = false;
+	char buf[256];
+	int len;
+
+	if (args->instance == 0) {
+		pr_lock(&lock);
+		len = snprintf(buf, sizeof(buf), "%-10s", "method");
+		for (s = 0; s < n_sizes; s++) {
+			char str[12];
+
+			stress_uint64_to_str(str, sizeof(str), (uint64_t)sizes[s]);
+			len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9.9s", str);
+		}
+		pr_inf_lock(&lock, "%s: lookups per second (millions) vs tree size (items):\n", args->name);
+		pr_inf_lock(&lock, "%s: %s\n", args->name, buf);
+	}
+	for (i = 1; (i < TREE_MAX_METHODS) && tree_methods[i].name; i++) {
+		const stress_tree_lookup_stats_t *st = tree_stats[i];
+		bool used = false;
+
+		len = snprintf(buf, sizeof(buf), "%-10s", tree_methods[i].name);
+		for (s = 0; s < n_sizes; s++) {
+			if (st[s].duration > 0.0) {
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+					" %9.2f", st[s].lookups / st[s].duration / 1000000.0);
+				used = true;
+			} else {
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9s", "-");
+			}
+		}
+		if (!used)
+			continue;
+		if (args->instance == 0)
+			pr_inf_lock(&lock, "%s: %s\n", args->name, buf);
+
+		/* report the largest tree size that was measured */
+		for (s = n_sizes; s > 0; s--) {
+			if (st[s - 1].duration > 0.0) {
+				char desc[32];
+
+				(void)snprintf(desc, sizeof(desc), "%s lookups/sec", tree_methods[i].name);
+				stress_misc_stats_set(args->misc_stats, idx++, desc,
+					st[s - 1].lookups / st[s - 1].duration);
+				break;
+			}
+		}
+	}
+	if (args->instance == 0)
+		pr_unlock(&lock);
+}
+
 /*
  *  stress_tree()
  *	stress tree
@@ -812,6 +1365,8 @@ static int stress_tree(const stress_args_t *args)
 	struct sigaction old_action;
 	int ret;
 	stress_tree_method_info_t const *info = &tree_methods[0];
+	bool tree_sweep = false;
+	size_t sizes[TREE_MAX_SIZES], n_sizes = 0;
 
 	(void)stress_get_setting("tree-method", &info);
 
@@ -823,6 +1378,21 @@ static int stress_tree(const stress_args_t *args)
 	}
 	n = (size_t)tree_size;
 
+	/* sweep from L1 cache sized trees in x4 steps up to the tree size */
+	(void)stress_get_setting("tree-sweep", &tree_sweep);
+	if (tree_sweep) {
+		size_t sz;
+
+		for (sz = TREE_SWEEP_MIN; (sz < n) && (n_sizes < TREE_MAX_SIZES - 1); sz *= 4)
+			sizes[n_sizes++] = sz;
+	}
+	sizes[n_sizes++] = n;
+	tree_size_idx = 0;
+	(void)memset(tree_stats, 0, sizeof(tree_stats));
+
+	stress_slab_init(&slab, sizeof(btree_node_t), 0);
+	btree_slab = stress_node_arena() ? &slab : NULL;
+
 	nodes = calloc(n, sizeof(*nodes));
 	if (!nodes) {
 		pr_fail("%s: malloc failed, out of memory\n", args->name);
@@ -861,7 +1431,8 @@ static int stress_tree(const stress_args_t *args)
 	do {
 		uint64_t rnd;
 
-		info->func(args, n, nodes);
+		info->func(args, sizes[tree_size_idx], nodes);
+		tree_size_idx = (tree_size_idx + 1) % n_sizes;
 
 		rnd = stress_mwc64();
 		for (node = nodes, i = 0; i < n; i++, node++)
@@ -874,7 +1445,10 @@ static int stress_tree(const stress_args_t *args)
 	(void)stress_sigrestore(args->name, SIGALRM, &old_action);
 tidy:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_tree_report(args, sizes, n_sizes);
 	free(nodes);
+	btree_slab = NULL;
+	stress_slab_destroy(&slab);
 
 	return EXIT_SUCCESS;
 }
@@ -886,11 +1460,3 @@ stressor_info_t stress_tree_info = {
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
-#else
-stressor_info_t stress_tree_info = {
-	.stressor = stress_not_implemented,
-	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
-	.opt_set_funcs = opt_set_funcs,
-	.help = help
-};
-#endif
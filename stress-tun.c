@@ -38,13 +38,23 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_NETINET_IP_H)
+#include <netinet/ip.h>
+#endif
+
+#if defined(HAVE_LINUX_UDP_H)
+#include <linux/udp.h>
+#endif
+
 #include <arpa/inet.h>
 
 #define PACKETS_TO_SEND		(64)
 
 static const stress_help_t help[] = {
 	{ NULL,	"tun N",	"start N workers exercising tun interface" },
+	{ NULL,	"tun-bench",	"measure multiqueue tun write Mpps and Gb/s" },
 	{ NULL,	"tun-ops N",	"stop after N tun bogo operations" },
+	{ NULL,	"tun-queues N",	"sweep tun bench from 1 up to N queues" },
 	{ NULL, "tun-tap",	"use TAP interface instead of TUN" },
 	{ NULL,	NULL,		NULL }
 };
@@ -89,6 +99,537 @@ static int stress_set_tun_tap(const char *opt)
 	return stress_set_setting_true("tun-tap", opt);
 }
 
+static int stress_set_tun_bench(const char *opt)
+{
+	return stress_set_setting_true("tun-bench", opt);
+}
+
+static int stress_set_tun_queues(const char *opt)
+{
+	uint32_t tun_queues;
+
+	tun_queues = stress_get_uint32(opt);
+	stress_check_range("tun-queues", (uint64_t)tun_queues, 1, 256);
+	return stress_set_setting("tun-queues", TYPE_ID_UINT32, &tun_queues);
+}
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_NETINET_IP_H) &&	\
+    defined(HAVE_LINUX_UDP_H) &&	\
+    defined(IFF_NO_PI) &&		\
+    defined(IFF_MULTI_QUEUE) &&		\
+    defined(IFF_VNET_HDR) &&		\
+    defined(SIOCSIFFLAGS)
+
+#define HAVE_TUN_BENCH
+
+#define TUN_BENCH_DURATION	(0.25)	/* seconds per measurement */
+#define TUN_BENCH_MAX_QUEUES	(256)	/* kernel MAX_TAP_QUEUES */
+#define TUN_BENCH_MAX_POINTS	(10)	/* queue counts 1, 2, 4 .. 256 */
+#define TUN_BENCH_PORT		(9)	/* UDP discard port */
+#define TUN_BENCH_MTU		(1500)
+#define TUN_BENCH_GSO_SEGS	(44)	/* GSO segments per 64K write */
+
+/* virtio_net_hdr, kept local as older headers lack UDP_L4 */
+#define TUN_VNET_HDR_F_NEEDS_CSUM	(1)
+#define TUN_VNET_HDR_GSO_NONE		(0)
+#define TUN_VNET_HDR_GSO_UDP_L4		(5)
+
+typedef struct {
+	uint8_t flags;
+	uint8_t gso_type;
+	uint16_t hdr_len;
+	uint16_t gso_size;
+	uint16_t csum_start;
+	uint16_t csum_offset;
+} stress_tun_vnet_hdr_t;
+
+typedef struct {
+	const char *name;	/* packet size name */
+	const size_t ip_len;	/* IP packet length per segment */
+	const bool gso;		/* one write is a GSO super-frame */
+} stress_tun_bench_size_t;
+
+static const stress_tun_bench_size_t tun_bench_sizes[] = {
+	{ "64",		64,			false },
+	{ "512",	512,			false },
+	{ "1500",	TUN_BENCH_MTU,		false },
+	{ "gso-64K",	TUN_BENCH_MTU,		true },
+};
+
+#define TUN_BENCH_SIZES	(SIZEOF_ARRAY(tun_bench_sizes))
+
+typedef struct {
+	double mpps;		/* million packets (segments) per second */
+	double gbps;		/* IP Gb/s */
+	bool ok;
+} stress_tun_bench_result_t;
+
+typedef struct {
+	stress_tun_bench_result_t res[TUN_BENCH_SIZES][TUN_BENCH_MAX_POINTS];
+	uint32_t queues[TUN_BENCH_MAX_POINTS];
+	size_t n_points;
+	bool napi;		/* IFF_NAPI was accepted */
+	bool done;		/* a full sweep completed */
+	int err;		/* setup errno, 0 if ok */
+} stress_tun_bench_shared_t;
+
+typedef struct {
+	pthread_t pthread;
+	int fd;			/* tun queue fd */
+	const uint8_t *pkt;	/* vnet header + IP packet */
+	size_t len;		/* write length */
+	volatile bool *stop;
+	uint64_t writes;	/* successful writes */
+	int err;		/* write errno, 0 if ok */
+} stress_tun_bench_thread_t;
+
+/*
+ *  stress_tun_bench_csum_add()
+ *	add n bytes to a 32 bit ones complement sum
+ */
+static uint32_t stress_tun_bench_csum_add(uint32_t sum, const void *ptr, size_t n)
+{
+	const uint16_t *p16 = (const uint16_t *)ptr;
+
+	while (n > 1) {
+		sum += *p16++;
+		n -= 2;
+	}
+	if (n)
+		sum += *(const uint8_t *)p16;
+	return sum;
+}
+
+/*
+ *  stress_tun_bench_pkt()
+ *	fill in a vnet header and IPv4 UDP packet from src to dst,
+ *	returns the write length
+ */
+static size_t stress_tun_bench_pkt(
+	uint8_t *buf,
+	const stress_tun_bench_size_t *size,
+	const struct in_addr *src,
+	const struct in_addr *dst)
+{
+	stress_tun_vnet_hdr_t *vnet = (stress_tun_vnet_hdr_t *)buf;
+	struct iphdr *ip = (struct iphdr *)(buf + sizeof(*vnet));
+	struct udphdr *udp = (struct udphdr *)((uint8_t *)ip + sizeof(*ip));
+	const size_t seg_payload = size->ip_len - sizeof(*ip) - sizeof(*udp);
+	const size_t payload = size->gso ? seg_payload * TUN_BENCH_GSO_SEGS : seg_payload;
+	const size_t udp_len = sizeof(*udp) + payload;
+	const size_t ip_len = sizeof(*ip) + udp_len;
+
+	(void)memset(buf, 0, sizeof(*vnet) + ip_len);
+
+	ip->ihl = 5;
+	ip->version = 4;
+	ip->tot_len = htons((uint16_t)ip_len);
+	ip->ttl = 64;
+	ip->protocol = IPPROTO_UDP;
+	ip->saddr = src->s_addr;
+	ip->daddr = dst->s_addr;
+	ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(*ip));
+
+	udp->source = htons(TUN_BENCH_PORT);
+	udp->dest = htons(TUN_BENCH_PORT);
+	udp->len = htons((uint16_t)udp_len);
+
+	if (size->gso) {
+		uint32_t sum = 0;
+		const uint16_t proto_len[2] = { htons(IPPROTO_UDP), htons((uint16_t)udp_len) };
+
+		/* partial checksum, the kernel completes it per segment */
+		sum = stress_tun_bench_csum_add(sum, &ip->saddr, sizeof(ip->saddr));
+		sum = stress_tun_bench_csum_add(sum, &ip->daddr, sizeof(ip->daddr));
+		sum = stress_tun_bench_csum_add(sum, proto_len, sizeof(proto_len));
+		sum = (sum >> 16) + (sum & 0xffff);
+		sum += (sum >> 16);
+		udp->check = (uint16_t)sum;
+
+		vnet->flags = TUN_VNET_HDR_F_NEEDS_CSUM;
+		vnet->gso_type = TUN_VNET_HDR_GSO_UDP_L4;
+		vnet->hdr_len = (uint16_t)(sizeof(*ip) + sizeof(*udp));
+		vnet->gso_size = (uint16_t)seg_payload;
+		vnet->csum_start = (uint16_t)sizeof(*ip);
+		vnet->csum_offset = (uint16_t)offsetof(struct udphdr, check);
+	} else {
+		vnet->gso_type = TUN_VNET_HDR_GSO_NONE;
+	}
+	return sizeof(*vnet) + ip_len;
+}
+
+/*
+ *  stress_tun_bench_writer()
+ *	write the same packet to a tun queue until told to stop
+ */
+static void *stress_tun_bench_writer(void *arg)
+{
+	stress_tun_bench_thread_t *t = (stress_tun_bench_thread_t *)arg;
+
+	while (!*t->stop) {
+		if (write(t->fd, t->pkt, t->len) < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR) || (errno == ENOBUFS))
+				continue;
+			t->err = errno;
+			break;
+		}
+		t->writes++;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_tun_bench_open()
+ *	create a multiqueue tun device with n queues, with IFF_NAPI
+ *	when the kernel supports it, returns 0 on success or -errno
+ */
+static int stress_tun_bench_open(
+	int *fds,
+	const uint32_t n,
+	char *ifname,
+	bool *napi)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		struct ifreq ifr;
+		int flags = IFF_TUN | IFF_NO_PI | IFF_VNET_HDR | IFF_MULTI_QUEUE;
+		int ret;
+
+		fds[i] = open(tun_dev, O_RDWR);
+		if (fds[i] < 0)
+			goto err;
+#if defined(IFF_NAPI)
+		if (*napi)
+			flags |= IFF_NAPI;
+#endif
+		(void)memset(&ifr, 0, sizeof(ifr));
+		ifr.ifr_flags = (short)flags;
+		if (i > 0)
+			(void)shim_strlcpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name));
+		ret = ioctl(fds[i], TUNSETIFF, (void *)&ifr);
+		if ((ret < 0) && (i == 0) && *napi) {
+			/* retry without IFF_NAPI */
+			*napi = false;
+			ifr.ifr_flags = (short)(flags & ~IFF_NAPI);
+			ret = ioctl(fds[i], TUNSETIFF, (void *)&ifr);
+		}
+		if (ret < 0) {
+			(void)close(fds[i]);
+			goto err;
+		}
+		if (i == 0)
+			(void)shim_strlcpy(ifname, ifr.ifr_name, IFNAMSIZ);
+	}
+	return 0;
+err:
+	{
+		const int err = errno;
+
+		while (i > 0)
+			(void)close(fds[--i]);
+		return -err;
+	}
+}
+
+/*
+ *  stress_tun_bench_up()
+ *	give the tun device an address and bring it up, and bind a
+ *	UDP socket on that address for the packets to be delivered to
+ */
+static int stress_tun_bench_up(
+	const char *ifname,
+	const struct in_addr *addr,
+	int *ufd)
+{
+	struct ifreq ifr;
+	struct sockaddr_in *sin = (struct sockaddr_in *)&ifr.ifr_addr;
+	struct sockaddr_in uaddr;
+	int sfd, rcvbuf = 4096;
+
+	sfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sfd < 0)
+		return -errno;
+
+	(void)memset(&ifr, 0, sizeof(ifr));
+	(void)shim_strlcpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name));
+	sin->sin_family = AF_INET;
+	sin->sin_addr = *addr;
+	if (ioctl(sfd, SIOCSIFADDR, &ifr) < 0)
+		goto err;
+	if (ioctl(sfd, SIOCGIFFLAGS, &ifr) < 0)
+		goto err;
+	ifr.ifr_flags |= IFF_UP;
+	if (ioctl(sfd, SIOCSIFFLAGS, &ifr) < 0)
+		goto err;
+	(void)close(sfd);
+
+	*ufd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (*ufd < 0)
+		return -errno;
+	(void)memset(&uaddr, 0, sizeof(uaddr));
+	uaddr.sin_family = AF_INET;
+	uaddr.sin_port = htons(TUN_BENCH_PORT);
+	uaddr.sin_addr = *addr;
+	(void)setsockopt(*ufd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	if (bind(*ufd, (struct sockaddr *)&uaddr, sizeof(uaddr)) < 0) {
+		const int err = errno;
+
+		(void)close(*ufd);
+		return -err;
+	}
+	return 0;
+err:
+	{
+		const int err = errno;
+
+		(void)close(sfd);
+		return -err;
+	}
+}
+
+/*
+ *  stress_tun_bench_point()
+ *	write packets of one size on all queues for TUN_BENCH_DURATION
+ *	seconds, one thread per queue
+ */
+static void stress_tun_bench_point(
+	const int *fds,
+	const uint32_t n,
+	const uint8_t *pkt,
+	const size_t len,
+	const stress_tun_bench_size_t *size,
+	stress_tun_bench_result_t *result)
+{
+	stress_tun_bench_thread_t threads[TUN_BENCH_MAX_QUEUES];
+	volatile bool stop = false;
+	uint64_t writes = 0;
+	uint32_t i, started;
+	double t, dt, pkts;
+	bool ok = true;
+
+	t = stress_time_now();
+	for (started = 0; started < n; started++) {
+		stress_tun_bench_thread_t *th = &threads[started];
+
+		th->fd = fds[started];
+		th->pkt = pkt;
+		th->len = len;
+		th->stop = &stop;
+		th->writes = 0;
+		th->err = 0;
+		if (pthread_create(&th->pthread, NULL, stress_tun_bench_writer, th) != 0) {
+			ok = false;
+			break;
+		}
+	}
+	while (keep_stressing_flag() && (stress_time_now() - t < TUN_BENCH_DURATION))
+		(void)shim_usleep(10000);
+	stop = true;
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		writes += threads[i].writes;
+		if (threads[i].err || !threads[i].writes)
+			ok = false;
+	}
+	dt = stress_time_now() - t;
+
+	result->ok = ok && keep_stressing_flag() && (dt > 0.0);
+	if (!result->ok)
+		return;
+	pkts = (double)writes * (size->gso ? TUN_BENCH_GSO_SEGS : 1);
+	result->mpps = pkts / dt / 1.0E6;
+	result->gbps = (pkts * (double)size->ip_len * 8.0) / dt / 1.0E9;
+}
+
+/*
+ *  stress_tun_bench_child()
+ *	run the queue count and packet size sweep in a private
+ *	network namespace so the tun address does not leak onto
+ *	the host
+ */
+static void NORETURN stress_tun_bench_child(
+	const stress_args_t *args,
+	stress_tun_bench_shared_t *shared)
+{
+	int fds[TUN_BENCH_MAX_QUEUES];
+	struct in_addr addr, src;
+	uint8_t *pkt;
+	size_t p;
+	uint32_t q;
+	const size_t pkt_size = sizeof(stress_tun_vnet_hdr_t) + 65536;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	if (shim_unshare(CLONE_NEWNET) < 0) {
+		shared->err = errno;
+		_exit(EXIT_NO_RESOURCE);
+	}
+	pkt = (uint8_t *)malloc(pkt_size);
+	if (!pkt) {
+		shared->err = ENOMEM;
+		_exit(EXIT_NO_RESOURCE);
+	}
+	(void)inet_pton(AF_INET, "192.168.100.1", &addr);
+	(void)inet_pton(AF_INET, "192.168.100.2", &src);
+
+	shared->napi = true;
+	for (p = 0; p < shared->n_points; p++) {
+		const uint32_t n = shared->queues[p];
+		char ifname[IFNAMSIZ];
+		size_t s;
+		int ret, ufd = -1;
+
+		ret = stress_tun_bench_open(fds, n, ifname, &shared->napi);
+		if (ret < 0) {
+			/* queue count beyond what the kernel allows */
+			if (p > 0)
+				continue;
+			shared->err = -ret;
+			_exit(EXIT_NO_RESOURCE);
+		}
+		ret = stress_tun_bench_up(ifname, &addr, &ufd);
+		if (ret < 0) {
+			shared->err = -ret;
+			_exit(EXIT_NO_RESOURCE);
+		}
+		for (s = 0; s < TUN_BENCH_SIZES; s++) {
+			const size_t len = stress_tun_bench_pkt(pkt, &tun_bench_sizes[s], &src, &addr);
+
+			if (!keep_stressing(args))
+				break;
+			stress_tun_bench_point(fds, n, pkt, len,
+				&tun_bench_sizes[s], &shared->res[s][p]);
+		}
+		(void)close(ufd);
+		for (q = 0; q < n; q++)
+			(void)close(fds[q]);
+		if (!keep_stressing(args))
+			_exit(EXIT_SUCCESS);
+	}
+	free(pkt);
+	shared->done = true;
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_tun_bench()
+ *	measure multiqueue tun write throughput in Mpps and Gb/s
+ *	per queue count and packet size
+ */
+static int stress_tun_bench(const stress_args_t *args)
+{
+	stress_tun_bench_shared_t *shared;
+	stress_tun_bench_result_t res[TUN_BENCH_SIZES][TUN_BENCH_MAX_POINTS];
+	uint32_t tun_queues = 4, q;
+	size_t i, p, n_points = 0;
+	bool done = false, napi = false;
+	const size_t shared_size = (sizeof(*shared) + args->page_size - 1) & ~(args->page_size - 1);
+
+	(void)stress_get_setting("tun-queues", &tun_queues);
+
+	shared = (stress_tun_bench_shared_t *)mmap(NULL, shared_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes, errno=%d (%s), skipping stressor\n",
+			args->name, shared_size, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		pid_t pid;
+		int status;
+
+		(void)memset(shared, 0, sizeof(*shared));
+		for (q = 1; q < tun_queues; q <<= 1)
+			shared->queues[shared->n_points++] = q;
+		shared->queues[shared->n_points++] = tun_queues;
+again:
+		pid = fork();
+		if (pid < 0) {
+			if (stress_redo_fork(errno))
+				goto again;
+			if (!keep_stressing(args))
+				break;
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			(void)munmap((void *)shared, shared_size);
+			return EXIT_FAILURE;
+		} else if (pid == 0) {
+			stress_tun_bench_child(args, shared);
+		}
+		if (shim_waitpid(pid, &status, 0) < 0) {
+			(void)kill(pid, SIGKILL);
+			(void)shim_waitpid(pid, &status, 0);
+		}
+		if (shared->err) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: cannot set up multiqueue tun device in a "
+					"private network namespace, errno=%d (%s), "
+					"skipping stressor\n", args->name,
+					shared->err, strerror(shared->err));
+			(void)munmap((void *)shared, shared_size);
+			stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+			return EXIT_NO_RESOURCE;
+		}
+		if (!shared->done)
+			break;
+		(void)memcpy(res, shared->res, sizeof(res));
+		n_points = shared->n_points;
+		napi = shared->napi;
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: multiqueue tun write throughput, one writer thread per "
+			"queue, %s, vnet headers, UDP GSO %d x %d byte segments\n",
+			args->name, napi ? "IFF_NAPI" : "no IFF_NAPI",
+			TUN_BENCH_GSO_SEGS, TUN_BENCH_MTU);
+		pr_inf("%s: %-8s %6s %10s %10s\n", args->name,
+			"size", "queues", "Mpps", "Gb/s");
+		for (i = 0; i < TUN_BENCH_SIZES; i++) {
+			for (p = 0; p < n_points; p++) {
+				const stress_tun_bench_result_t *r = &res[i][p];
+
+				if (!r->ok) {
+					pr_inf("%s: %-8s %6" PRIu32 " %10s %10s\n", args->name,
+						tun_bench_sizes[i].name, shared->queues[p], "-", "-");
+					continue;
+				}
+				pr_inf("%s: %-8s %6" PRIu32 " %10.3f %10.3f\n", args->name,
+					tun_bench_sizes[i].name, shared->queues[p],
+					r->mpps, r->gbps);
+			}
+		}
+	}
+	if (done) {
+		for (i = 0; i < TUN_BENCH_SIZES; i++) {
+			const stress_tun_bench_result_t *r = &res[i][n_points - 1];
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s Mpps %" PRIu32 " queues",
+				tun_bench_sizes[i].name, tun_queues);
+			stress_misc_stats_set(args->misc_stats, (int)i, str,
+				r->ok ? r->mpps : 0.0);
+			(void)snprintf(str, sizeof(str), "%s Gb/s %" PRIu32 " queues",
+				tun_bench_sizes[i].name, tun_queues);
+			stress_misc_stats_set(args->misc_stats, (int)(i + TUN_BENCH_SIZES), str,
+				r->ok ? r->gbps : 0.0);
+		}
+	}
+	(void)munmap((void *)shared, shared_size);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_tun
  *	stress tun interface
@@ -99,9 +640,20 @@ static int stress_tun(const stress_args_t *args)
 	const uid_t owner = geteuid();
 	const gid_t group = getegid();
 	char ip_addr[32];
-	bool tun_tap = false;
+	bool tun_tap = false, tun_bench = false;
 
 	(void)stress_get_setting("tun-tap", &tun_tap);
+	(void)stress_get_setting("tun-bench", &tun_bench);
+	if (tun_bench) {
+#if defined(HAVE_TUN_BENCH)
+		return stress_tun_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: multiqueue tun bench not supported, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -385,6 +937,8 @@ clean_up:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_tun_bench,	stress_set_tun_bench },
+	{ OPT_tun_queues,	stress_set_tun_queues },
 	{ OPT_tun_tap,		stress_set_tun_tap },
 	{ 0,                    NULL }
 };
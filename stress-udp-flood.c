@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-net.h"
+#include "core-pacer.h"
 
 #if defined(HAVE_LINUX_SOCKIOS_H)
 #include <linux/sockios.h>
@@ -31,6 +32,8 @@ static const stress_help_t help[] = {
 	{ NULL,	"udp-flood-ops N",	"stop after N udp flood bogo operations" },
 	{ NULL,	"udp-flood-domain D",	"specify domain, default is ipv4" },
 	{ NULL, "udp-flood-if I",	"use network interface I, e.g. lo, eth0, etc." },
+	{ NULL,	"udp-flood-pps N",	"pace the flood at N packets per second" },
+	{ NULL,	"udp-flood-size-dist D", "paced packet sizes, fixed, uniform or imix" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -54,14 +57,82 @@ static int stress_set_udp_flood_if(const char *name)
 	return stress_set_setting("udp-flood-if", TYPE_ID_STR, name);
 }
 
+static int stress_set_udp_flood_pps(const char *opt)
+{
+	uint64_t udp_flood_pps;
+
+	udp_flood_pps = stress_get_uint64(opt);
+	stress_check_range("udp-flood-pps", udp_flood_pps, 1, 100000000);
+	return stress_set_setting("udp-flood-pps", TYPE_ID_UINT64, &udp_flood_pps);
+}
+
+static int stress_set_udp_flood_size_dist(const char *opt)
+{
+	return stress_set_pacer_size_dist("udp-flood-size-dist", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_udp_flood_domain,	stress_set_udp_flood_domain },
 	{ OPT_udp_flood_if,	stress_set_udp_flood_if },
+	{ OPT_udp_flood_pps,	stress_set_udp_flood_pps },
+	{ OPT_udp_flood_size_dist, stress_set_udp_flood_size_dist },
 	{ 0,			NULL }
 };
 
 #if defined(AF_PACKET)
 
+#define UDP_FLOOD_MTU		(1500)
+
+/*
+ *  stress_udp_flood_paced()
+ *	UDP flood at a fixed packet rate, token bucket paced and
+ *	sent in batches with packet sizes from a size distribution
+ */
+static void stress_udp_flood_paced(
+	const stress_args_t *args,
+	const int fd,
+	const int udp_flood_domain,
+	const struct sockaddr *addr,
+	const socklen_t addr_len,
+	const uint64_t udp_flood_pps,
+	const size_t udp_flood_size_dist)
+{
+	static char ALIGN64 buf[UDP_FLOOD_MTU];
+	struct sockaddr_storage names[STRESS_PACER_BATCH];
+	struct iovec iov[STRESS_PACER_BATCH];
+	const size_t hdr_len = (udp_flood_domain == AF_INET6) ? 48 : 28;
+	stress_pacer_t pacer;
+	int port = 1024;
+	size_t i;
+
+	stress_strnrnd(buf, sizeof(buf));
+	for (i = 0; i < STRESS_PACER_BATCH; i++) {
+		(void)memcpy(&names[i], addr, addr_len);
+		iov[i].iov_base = buf;
+	}
+
+	stress_pacer_init(&pacer, udp_flood_pps);
+	do {
+		const size_t n = stress_pacer_wait(&pacer, STRESS_PACER_BATCH);
+
+		if (!n)
+			break;
+		for (i = 0; i < n; i++) {
+			const size_t sz = stress_pacer_size(udp_flood_size_dist,
+				hdr_len + 1, UDP_FLOOD_MTU);
+
+			stress_set_sockaddr_port(udp_flood_domain, port, (struct sockaddr *)&names[i]);
+			if (++port > 65535)
+				port = 1024;
+			iov[i].iov_len = sz - hdr_len;
+		}
+		stress_pacer_send(&pacer, fd, iov, names, addr_len, sizeof(names[0]), n);
+		set_counter(args, pacer.sent);
+	} while (keep_stressing(args));
+
+	stress_pacer_stats(args, &pacer);
+}
+
 /*
  *  stress_udp_flood
  *	UDP flood
@@ -76,6 +147,8 @@ static int stress_udp_flood(const stress_args_t *args)
 	const size_t sz_max = 23 + args->instance;
 	size_t sz = 1;
 	char *udp_flood_if = NULL;
+	uint64_t udp_flood_pps = 0;
+	size_t udp_flood_size_dist = STRESS_PACER_SIZE_UNIFORM;
 
 	static const char ALIGN64 data[64] =
 		"0123456789ABCDEFGHIJKLMNOPQRSTUV"
@@ -83,6 +156,8 @@ static int stress_udp_flood(const stress_args_t *args)
 
 	(void)stress_get_setting("udp-flood-domain", &udp_flood_domain);
 	(void)stress_get_setting("udp-flood-if", &udp_flood_if);
+	(void)stress_get_setting("udp-flood-pps", &udp_flood_pps);
+	(void)stress_get_setting("udp-flood-size-dist", &udp_flood_size_dist);
 
 	if (udp_flood_if) {
 		int ret;
@@ -114,6 +189,12 @@ static int stress_udp_flood(const stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (udp_flood_pps) {
+		stress_udp_flood_paced(args, fd, udp_flood_domain, addr, addr_len,
+			udp_flood_pps, udp_flood_size_dist);
+		goto deinit;
+	}
+
 	do {
 		char buf[sz];
 		int rand_port;
@@ -148,6 +229,7 @@ static int stress_udp_flood(const stress_args_t *args)
 			sz = 1;
 	} while (keep_stressing(args));
 
+deinit:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	(void)close(fd);
@@ -47,6 +47,17 @@ UNEXPECTED
 
 #define UDP_BUF			(1024)	/* UDP I/O buffer size */
 
+#define MIN_UDP_BATCH		(1)
+#define MAX_UDP_BATCH		(256)
+#define DEFAULT_UDP_BATCH	(64)
+#define MIN_UDP_GSO		(0)	/* disabled */
+#define MAX_UDP_GSO		(64)
+#define MIN_UDP_BUSY_POLL	(0)	/* disabled */
+#define MAX_UDP_BUSY_POLL	(1000000)
+
+#define UDP_BENCH_STEP		(1.0)	/* seconds per payload size */
+#define UDP_BENCH_MAX_GSO_BYTES	(65000)	/* GSO super datagram limit */
+
 /* See bugs section of udplite(7) */
 #if !defined(SOL_UDPLITE)
 #define SOL_UDPLITE		(136)
@@ -61,9 +72,14 @@ UNEXPECTED
 static const stress_help_t help[] = {
 	{ NULL,	"udp N",	"start N workers performing UDP send/receives " },
 	{ NULL,	"udp-ops N",	"stop after N udp bogo operations" },
+	{ NULL,	"udp-batch N",	"datagrams per sendmmsg/recvmmsg call in --udp-bench" },
+	{ NULL,	"udp-bench",	"batched UDP packet rate sweep over payload sizes" },
+	{ NULL,	"udp-busy-poll N", "set SO_BUSY_POLL to N usecs in --udp-bench" },
 	{ NULL,	"udp-domain D",	"specify domain, default is ipv4" },
+	{ NULL,	"udp-gso N",	"send N segment UDP_SEGMENT datagrams in --udp-bench" },
 	{ NULL, "udp-gro",	"enable UDP-GRO" },
 	{ NULL,	"udp-lite",	"use the UDP-Lite (RFC 3828) protocol" },
+	{ NULL,	"udp-placement P", "pin client and server CPUs [same-cpu|smt|llc|socket|cross-socket|irq]" },
 	{ NULL,	"udp-port P",	"use ports P to P + number of workers - 1" },
 	{ NULL,	"udp-if I",	"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	NULL,		NULL }
@@ -93,6 +109,20 @@ static int stress_set_udp_domain(const char *name)
 	return ret;
 }
 
+/*
+ *  stress_set_udp_placement()
+ *	set the client/server CPU placement
+ */
+static int stress_set_udp_placement(const char *name)
+{
+	int ret, udp_placement;
+
+	ret = stress_set_net_placement("udp-placement", name, &udp_placement);
+	stress_set_setting("udp-placement", TYPE_ID_INT, &udp_placement);
+
+	return ret;
+}
+
 static int stress_set_udp_lite(const char *opt)
 {
 	return stress_set_setting_true("udp-lite", opt);
@@ -108,6 +138,41 @@ static int stress_set_udp_if(const char *name)
 	return stress_set_setting("udp-if", TYPE_ID_STR, name);
 }
 
+static int stress_set_udp_bench(const char *opt)
+{
+	return stress_set_setting_true("udp-bench", opt);
+}
+
+static int stress_set_udp_batch(const char *opt)
+{
+	uint32_t udp_batch;
+
+	udp_batch = stress_get_uint32(opt);
+	stress_check_range("udp-batch", (uint64_t)udp_batch,
+		MIN_UDP_BATCH, MAX_UDP_BATCH);
+	return stress_set_setting("udp-batch", TYPE_ID_UINT32, &udp_batch);
+}
+
+static int stress_set_udp_gso(const char *opt)
+{
+	uint32_t udp_gso;
+
+	udp_gso = stress_get_uint32(opt);
+	stress_check_range("udp-gso", (uint64_t)udp_gso,
+		MIN_UDP_GSO, MAX_UDP_GSO);
+	return stress_set_setting("udp-gso", TYPE_ID_UINT32, &udp_gso);
+}
+
+static int stress_set_udp_busy_poll(const char *opt)
+{
+	uint32_t udp_busy_poll;
+
+	udp_busy_poll = stress_get_uint32(opt);
+	stress_check_range("udp-busy-poll", (uint64_t)udp_busy_poll,
+		MIN_UDP_BUSY_POLL, MAX_UDP_BUSY_POLL);
+	return stress_set_setting("udp-busy-poll", TYPE_ID_UINT32, &udp_busy_poll);
+}
+
 static int stress_udp_client(
 	const stress_args_t *args,
 	const pid_t mypid,
@@ -309,6 +374,8 @@ static int stress_udp_server(
 	socklen_t addr_len = 0;
 	struct sockaddr *addr = NULL;
 	int rc = EXIT_FAILURE;
+	uint64_t bytes = 0;
+	double t_start, duration;
 
 	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0)
 		goto die;
@@ -362,6 +429,7 @@ static int stress_udp_server(
 #else
 	(void)udp_gro;
 #endif
+	t_start = stress_time_now();
 	do {
 		socklen_t len = addr_len;
 		ssize_t n;
@@ -383,9 +451,14 @@ static int stress_udp_server(
 					args->name, errno, strerror(errno));
 			break;
 		}
+		bytes += (uint64_t)n;
 		inc_counter(args);
 	} while (keep_stressing(args));
 
+	duration = stress_time_now() - t_start;
+	if (duration > 0.0)
+		stress_misc_stats_set(args->misc_stats, 0, "MB per sec received",
+			((double)bytes / duration) / (double)MB);
 	rc = EXIT_SUCCESS;
 die_close:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -407,6 +480,347 @@ die:
 	return rc;
 }
 
+#if defined(HAVE_SENDMMSG) &&	\
+    defined(HAVE_RECVMMSG)
+
+#define UDP_BENCH_SIZES		(SIZEOF_ARRAY(udp_bench_sizes))
+
+/* payload sizes of the --udp-bench sweep, 1400 fits a 1500 byte MTU */
+static const size_t udp_bench_sizes[] = {
+	64, 256, 512, 1024, 1400
+};
+
+/* Sender side totals per payload size, shared with the receiver */
+typedef struct {
+	uint64_t tx_pkts[UDP_BENCH_SIZES];	/* payloads sent */
+	double tx_time[UDP_BENCH_SIZES];	/* time spent sending */
+} stress_udp_bench_t;
+
+/*
+ *  stress_udp_bench_size_index()
+ *	map a payload size to its sweep index, -1 if unknown
+ */
+static int stress_udp_bench_size_index(const size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < UDP_BENCH_SIZES; i++) {
+		if (udp_bench_sizes[i] == size)
+			return (int)i;
+	}
+	return -1;
+}
+
+/*
+ *  stress_udp_bench_client()
+ *	sweep the payload sizes, UDP_BENCH_STEP seconds each, sending
+ *	batches of udp_batch datagrams per sendmmsg call, each of
+ *	udp_gso segments if GSO is enabled
+ */
+static int stress_udp_bench_client(
+	const stress_args_t *args,
+	const pid_t mypid,
+	const int udp_domain,
+	const int udp_proto,
+	const int udp_port,
+	const char *udp_if,
+	const uint32_t udp_batch,
+	const uint32_t udp_gso,
+	stress_udp_bench_t *bench)
+{
+	struct sockaddr *addr = NULL;
+	socklen_t len = 0;
+	struct mmsghdr *msgvec;
+	struct iovec iov;
+	char *buf;
+	int fd, rc = EXIT_FAILURE;
+	const size_t buf_size = UDP_BENCH_MAX_GSO_BYTES;
+	bool gso = (udp_gso > 0);
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	msgvec = calloc(udp_batch, sizeof(*msgvec));
+	if (!msgvec)
+		return EXIT_NO_RESOURCE;
+	buf = malloc(buf_size);
+	if (!buf) {
+		free(msgvec);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(buf, 'U', buf_size);
+
+	if ((fd = socket(udp_domain, SOCK_DGRAM, udp_proto)) < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_bufs;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			udp_domain, udp_port, udp_if,
+			&addr, &len, NET_ADDR_ANY) < 0)
+		goto close_fd;
+	/* connected, so the kernel does not look up the route per datagram */
+	if (connect(fd, addr, len) < 0) {
+		pr_fail("%s: connect failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_fd;
+	}
+
+	while (keep_stressing_flag()) {
+		size_t i;
+
+		for (i = 0; i < UDP_BENCH_SIZES; i++) {
+			const size_t size = udp_bench_sizes[i];
+			size_t segs = 1;
+			double t, t_end;
+			uint32_t j;
+
+#if defined(UDP_SEGMENT)
+			if (gso) {
+				int val = (int)size;
+
+				if (setsockopt(fd, udp_proto, UDP_SEGMENT, &val, sizeof(val)) < 0) {
+					if (args->instance == 0)
+						pr_inf("%s: cannot enable UDP_SEGMENT GSO, "
+							"errno=%d (%s), continuing without GSO\n",
+							args->name, errno, strerror(errno));
+					gso = false;
+				} else {
+					segs = STRESS_MINIMUM((size_t)udp_gso, buf_size / size);
+				}
+			}
+#endif
+			iov.iov_base = buf;
+			iov.iov_len = size * segs;
+			for (j = 0; j < udp_batch; j++) {
+				msgvec[j].msg_hdr.msg_iov = &iov;
+				msgvec[j].msg_hdr.msg_iovlen = 1;
+			}
+
+			t = stress_time_now();
+			t_end = t + UDP_BENCH_STEP;
+			do {
+				const int n = sendmmsg(fd, msgvec, udp_batch, 0);
+				const double now = stress_time_now();
+
+				if (n < 0) {
+					if ((errno == EINTR) || (errno == ENETUNREACH) ||
+					    (errno == ECONNREFUSED) || (errno == ENOBUFS) ||
+					    (errno == EAGAIN))
+						continue;
+					pr_fail("%s: sendmmsg failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					goto close_fd;
+				}
+				bench->tx_pkts[i] += (uint64_t)n * segs;
+				bench->tx_time[i] += now - t;
+				t = now;
+			} while (keep_stressing_flag() && (t < t_end));
+		}
+	}
+	rc = EXIT_SUCCESS;
+close_fd:
+	(void)close(fd);
+free_bufs:
+	free(buf);
+	free(msgvec);
+
+	return rc;
+}
+
+/*
+ *  stress_udp_bench_server()
+ *	receive with recvmmsg in batches of udp_batch, counting
+ *	payloads per size, GRO coalesced datagrams are split by
+ *	the segment size reported in the UDP_GRO control message
+ */
+static int stress_udp_bench_server(
+	const stress_args_t *args,
+	const pid_t pid,
+	const pid_t mypid,
+	const int udp_domain,
+	const int udp_proto,
+	const int udp_port,
+	const bool udp_gro,
+	const char *udp_if,
+	const uint32_t udp_batch,
+	const uint32_t udp_busy_poll,
+	stress_udp_bench_t *bench)
+{
+	uint64_t rx_pkts[UDP_BENCH_SIZES];
+	const size_t buf_size = udp_gro ? UDP_BENCH_MAX_GSO_BYTES : UDP_BUF * 2;
+	const size_t ctrl_size = CMSG_SPACE(sizeof(int));
+	struct mmsghdr *msgvec = NULL;
+	struct iovec *iovs = NULL;
+	char *bufs = NULL, *ctrls = NULL;
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	struct timeval tv;
+	int fd = -1, status, rx_buf = 4 * MB;
+	int rc = EXIT_FAILURE;
+	uint32_t i;
+
+	(void)memset(rx_pkts, 0, sizeof(rx_pkts));
+	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0)
+		goto die;
+
+	msgvec = calloc(udp_batch, sizeof(*msgvec));
+	iovs = calloc(udp_batch, sizeof(*iovs));
+	bufs = malloc(buf_size * udp_batch);
+	ctrls = calloc(udp_batch, ctrl_size);
+	if (!msgvec || !iovs || !bufs || !ctrls) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " receive buffers, "
+			"skipping stressor\n", args->name, udp_batch);
+		rc = EXIT_NO_RESOURCE;
+		goto die;
+	}
+
+	if ((fd = socket(udp_domain, SOCK_DGRAM, udp_proto)) < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			udp_domain, udp_port, udp_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0)
+		goto die;
+	if (bind(fd, addr, addr_len) < 0) {
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die;
+	}
+	/* a large receive queue, the sender is not flow controlled */
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rx_buf, sizeof(rx_buf));
+	/* wake periodically so --udp-ops and the run time are honoured */
+	tv.tv_sec = 0;
+	tv.tv_usec = 100000;
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+#if defined(UDP_GRO)
+	if (udp_gro) {
+		int val = 1;
+
+		if ((setsockopt(fd, udp_proto, UDP_GRO, &val, sizeof(val)) < 0) &&
+		    (args->instance == 0))
+			pr_inf("%s: cannot enable UDP_GRO, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+	}
+#endif
+#if defined(SO_BUSY_POLL)
+	if (udp_busy_poll) {
+		int val = (int)udp_busy_poll;
+
+		if ((setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)) < 0) &&
+		    (args->instance == 0))
+			pr_inf("%s: cannot set SO_BUSY_POLL, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+	}
+#else
+	if (udp_busy_poll && (args->instance == 0))
+		pr_inf("%s: SO_BUSY_POLL is not available, ignoring "
+			"--udp-busy-poll\n", args->name);
+#endif
+
+	for (i = 0; i < udp_batch; i++) {
+		iovs[i].iov_base = bufs + (i * buf_size);
+		iovs[i].iov_len = buf_size;
+		msgvec[i].msg_hdr.msg_iov = &iovs[i];
+		msgvec[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	do {
+		int n, k;
+
+		for (i = 0; i < udp_batch; i++) {
+			msgvec[i].msg_hdr.msg_control = ctrls + (i * ctrl_size);
+			msgvec[i].msg_hdr.msg_controllen = ctrl_size;
+		}
+		n = recvmmsg(fd, msgvec, udp_batch, MSG_WAITFORONE, NULL);
+		if (n < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				continue;
+			if (errno != EINTR)
+				pr_fail("%s: recvmmsg failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			break;
+		}
+		for (k = 0; k < n; k++) {
+			size_t seg = msgvec[k].msg_len;
+			uint64_t pkts = 1;
+			int idx;
+#if defined(UDP_GRO)
+			struct cmsghdr *cmsg;
+
+			for (cmsg = CMSG_FIRSTHDR(&msgvec[k].msg_hdr); cmsg;
+			     cmsg = CMSG_NXTHDR(&msgvec[k].msg_hdr, cmsg)) {
+				if ((cmsg->cmsg_level == IPPROTO_UDP) &&
+				    (cmsg->cmsg_type == UDP_GRO)) {
+					int gso_size;
+
+					(void)memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+					if (gso_size > 0)
+						seg = (size_t)gso_size;
+				}
+			}
+#endif
+			if (seg && (msgvec[k].msg_len > seg))
+				pkts = (msgvec[k].msg_len + seg - 1) / seg;
+			idx = stress_udp_bench_size_index(seg);
+			if (idx >= 0)
+				rx_pkts[idx] += pkts;
+			add_counter(args, pkts);
+		}
+	} while (keep_stressing(args));
+
+	rc = EXIT_SUCCESS;
+die:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (fd >= 0)
+		(void)close(fd);
+	if (pid) {
+		(void)kill(pid, SIGKILL);
+		(void)shim_waitpid(pid, &status, 0);
+	}
+
+	if (rc == EXIT_SUCCESS) {
+		size_t j;
+
+		if (args->instance == 0)
+			pr_inf("%s: payload   tx Kpps   rx Kpps   rx Gb/s  loss %%\n",
+				args->name);
+		for (j = 0; j < UDP_BENCH_SIZES; j++) {
+			const double t = bench->tx_time[j];
+			const double rx_pps = (t > 0.0) ? (double)rx_pkts[j] / t : 0.0;
+			const double rx_gbps = (rx_pps * (double)udp_bench_sizes[j] * 8.0) / 1.0E9;
+			const uint64_t tx = bench->tx_pkts[j];
+			char desc[40];
+
+			/* run too short to reach this payload size */
+			if (t <= 0.0)
+				continue;
+			if (args->instance == 0) {
+				pr_inf("%s: %7zu %9.1f %9.1f %9.3f %7.2f\n",
+					args->name, udp_bench_sizes[j],
+					((double)tx / t) / 1000.0,
+					rx_pps / 1000.0, rx_gbps,
+					(tx > rx_pkts[j]) ?
+						100.0 * (double)(tx - rx_pkts[j]) / (double)tx : 0.0);
+			}
+			(void)snprintf(desc, sizeof(desc), "%zu byte rx Kpps", udp_bench_sizes[j]);
+			stress_misc_stats_set(args->misc_stats, j * 2, desc, rx_pps / 1000.0);
+			(void)snprintf(desc, sizeof(desc), "%zu byte rx Gb/s", udp_bench_sizes[j]);
+			stress_misc_stats_set(args->misc_stats, (j * 2) + 1, desc, rx_gbps);
+		}
+	}
+	free(ctrls);
+	free(bufs);
+	free(iovs);
+	free(msgvec);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_udp
  *	stress by heavy udp ops
@@ -422,11 +836,26 @@ static int stress_udp(const stress_args_t *args)
 	bool udp_lite = false;
 #endif
 	bool udp_gro = false;
+	bool udp_bench = false;
+	uint32_t udp_batch = DEFAULT_UDP_BATCH;
+	uint32_t udp_gso = 0;
+	uint32_t udp_busy_poll = 0;
+#if defined(HAVE_SENDMMSG) &&	\
+    defined(HAVE_RECVMMSG)
+	stress_udp_bench_t *bench = NULL;
+#endif
 	char *udp_if = NULL;
+	int udp_placement = NET_PLACEMENT_NONE;
+	int server_cpu, client_cpu;
 
 	(void)stress_get_setting("udp-if", &udp_if);
+	(void)stress_get_setting("udp-placement", &udp_placement);
 	(void)stress_get_setting("udp-port", &udp_port);
 	(void)stress_get_setting("udp-domain", &udp_domain);
+	(void)stress_get_setting("udp-bench", &udp_bench);
+	(void)stress_get_setting("udp-batch", &udp_batch);
+	(void)stress_get_setting("udp-gso", &udp_gso);
+	(void)stress_get_setting("udp-busy-poll", &udp_busy_poll);
 #if defined(IPPROTO_UDPLITE)
 	(void)stress_get_setting("udp-lite", &udp_lite);
 
@@ -458,11 +887,39 @@ static int stress_udp(const stress_args_t *args)
 		}
 	}
 
+	if (stress_net_placement_cpus(args, udp_placement, udp_if,
+				      &server_cpu, &client_cpu) < 0)
+		return EXIT_NO_RESOURCE;
 	udp_port += args->instance;
 
 	pr_dbg("%s: process [%d] using udp port %d\n",
 		args->name, (int)args->pid, udp_port);
 
+	if (udp_bench) {
+#if defined(HAVE_SENDMMSG) &&	\
+    defined(HAVE_RECVMMSG)
+		if ((udp_domain != AF_INET) && (udp_domain != AF_INET6)) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: --udp-bench requires the ipv4 or ipv6 "
+					"domain, skipping stressor\n", args->name);
+			return EXIT_NOT_IMPLEMENTED;
+		}
+		bench = (stress_udp_bench_t *)mmap(NULL, sizeof(*bench),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (bench == MAP_FAILED) {
+			pr_inf_skip("%s: cannot mmap benchmark state, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+			return EXIT_NO_RESOURCE;
+		}
+		(void)memset(bench, 0, sizeof(*bench));
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --udp-bench requires sendmmsg and recvmmsg, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 again:
 	pid = fork();
@@ -473,19 +930,41 @@ again:
 			args->name, errno, strerror(errno));
 		return EXIT_FAILURE;
 	} else if (pid == 0) {
-		rc = stress_udp_client(args, mypid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
+		stress_net_placement_pin(client_cpu);
+#if defined(HAVE_SENDMMSG) &&	\
+    defined(HAVE_RECVMMSG)
+		if (udp_bench)
+			rc = stress_udp_bench_client(args, mypid, udp_domain, udp_proto,
+				udp_port, udp_if, udp_batch, udp_gso, bench);
+		else
+#endif
+			rc = stress_udp_client(args, mypid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
 
 		/* Inform parent we're all done */
 		(void)kill(getppid(), SIGALRM);
 		_exit(rc);
 	} else {
-		rc = stress_udp_server(args, pid, mypid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
+		stress_net_placement_pin(server_cpu);
+#if defined(HAVE_SENDMMSG) &&	\
+    defined(HAVE_RECVMMSG)
+		if (udp_bench) {
+			rc = stress_udp_bench_server(args, pid, mypid, udp_domain, udp_proto,
+				udp_port, udp_gro, udp_if, udp_batch, udp_busy_poll, bench);
+			(void)munmap((void *)bench, sizeof(*bench));
+		} else
+#endif
+			rc = stress_udp_server(args, pid, mypid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
 	}
 	return rc;
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_udp_batch,	stress_set_udp_batch },
+	{ OPT_udp_bench,	stress_set_udp_bench },
+	{ OPT_udp_busy_poll,	stress_set_udp_busy_poll },
 	{ OPT_udp_domain,	stress_set_udp_domain },
+	{ OPT_udp_gso,		stress_set_udp_gso },
+	{ OPT_udp_placement,	stress_set_udp_placement },
 	{ OPT_udp_port,		stress_set_udp_port },
 	{ OPT_udp_lite,		stress_set_udp_lite },
 	{ OPT_udp_gro,		stress_set_udp_gro },
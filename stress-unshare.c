@@ -18,13 +18,45 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
+
+#if defined(HAVE_SYS_MOUNT_H)
+#include <sys/mount.h>
+#endif
+
+#define UNSHARE_MOUNTS_MIN	(1)
+#define UNSHARE_MOUNTS_MAX	(65536)
+#define UNSHARE_MOUNTS_DEFAULT	(1024)
 
 static const stress_help_t help[] = {
 	{ NULL,	"unshare N",	 "start N workers exercising resource unsharing" },
 	{ NULL,	"unshare-ops N", "stop after N bogo unshare operations" },
+	{ NULL,	"unshare-bench", "measure namespace creation, copy and teardown latency" },
+	{ NULL,	"unshare-mounts N", "sweep mount namespace copy cost up to N mounts" },
 	{ NULL,	NULL,		 NULL }
 };
 
+static int stress_set_unshare_bench(const char *opt)
+{
+	return stress_set_setting_true("unshare-bench", opt);
+}
+
+static int stress_set_unshare_mounts(const char *opt)
+{
+	uint32_t unshare_mounts;
+
+	unshare_mounts = stress_get_uint32(opt);
+	stress_check_range("unshare-mounts", (uint64_t)unshare_mounts,
+		UNSHARE_MOUNTS_MIN, UNSHARE_MOUNTS_MAX);
+	return stress_set_setting("unshare-mounts", TYPE_ID_UINT32, &unshare_mounts);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_unshare_bench,	stress_set_unshare_bench },
+	{ OPT_unshare_mounts,	stress_set_unshare_mounts },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_UNSHARE)
 
 #define MAX_PIDS	(32)
@@ -122,6 +154,371 @@ static inline bool enough_memory(void)
 	return enough;
 }
 
+#define UNSHARE_BENCH_SAMPLES	(100)
+#define UNSHARE_BENCH_DURATION	(0.5)
+#define UNSHARE_MOUNT_POINTS	(8)
+
+typedef struct {
+	const char *name;		/* namespace name */
+	const int flag;			/* CLONE_NEW* flag, 0 for none */
+} stress_unshare_ns_t;
+
+static const stress_unshare_ns_t unshare_ns[] = {
+	{ "none",	0 },
+#if defined(CLONE_NEWNS)
+	{ "mnt",	CLONE_NEWNS },
+#endif
+#if defined(CLONE_NEWNET)
+	{ "net",	CLONE_NEWNET },
+#endif
+#if defined(CLONE_NEWPID)
+	{ "pid",	CLONE_NEWPID },
+#endif
+#if defined(CLONE_NEWUSER)
+	{ "user",	CLONE_NEWUSER },
+#endif
+#if defined(CLONE_NEWIPC)
+	{ "ipc",	CLONE_NEWIPC },
+#endif
+#if defined(CLONE_NEWUTS)
+	{ "uts",	CLONE_NEWUTS },
+#endif
+#if defined(CLONE_NEWCGROUP)
+	{ "cgroup",	CLONE_NEWCGROUP },
+#endif
+#if defined(CLONE_NEWTIME)
+	{ "time",	CLONE_NEWTIME },
+#endif
+};
+
+#define UNSHARE_NS		(SIZEOF_ARRAY(unshare_ns))
+
+static const uint32_t unshare_mount_counts[] = { 0, 16, 64, 256, 1024, 4096, 16384, 65536 };
+
+/*
+ *  per namespace type unshare and exit to reap latencies
+ */
+typedef struct {
+	stress_latency_t unshare_lat;
+	stress_latency_t exit_lat;
+	int err;			/* last unshare errno */
+} stress_unshare_lat_t;
+
+/*
+ *  state shared with the sampling children and the
+ *  mount namespace helper
+ */
+typedef struct {
+	uint64_t unshare_ns;		/* unshare time, 0 if failed */
+	uint64_t exit_ns;		/* time child called _exit */
+	int err;			/* unshare errno */
+	uint32_t mounts[UNSHARE_MOUNT_POINTS];	/* mounts actually made */
+	stress_unshare_lat_t mnt[UNSHARE_MOUNT_POINTS];
+} stress_unshare_shared_t;
+
+/*
+ *  stress_unshare_sample()
+ *	fork a child that times a single unshare() of the given
+ *	flags and exits, the exit to reap time includes the
+ *	synchronous part of tearing the new namespaces down
+ */
+static void stress_unshare_sample(
+	stress_unshare_shared_t *shared,
+	const int flags,
+	stress_unshare_lat_t *lat)
+{
+	uint64_t t_reap;
+	pid_t pid;
+	int status;
+
+	shared->unshare_ns = 0;
+	shared->exit_ns = 0;
+	shared->err = 0;
+
+	pid = fork();
+	if (pid < 0) {
+		lat->err = errno;
+		return;
+	}
+	if (pid == 0) {
+		uint64_t t1, t2;
+		int ret;
+
+		t1 = stress_latency_now();
+		ret = flags ? shim_unshare(flags) : 0;
+		t2 = stress_latency_now();
+		if (ret < 0) {
+			shared->err = errno;
+			_exit(EXIT_FAILURE);
+		}
+		shared->unshare_ns = (t2 > t1) ? t2 - t1 : 1;
+		shared->exit_ns = stress_latency_now();
+		_exit(EXIT_SUCCESS);
+	}
+	if (shim_waitpid(pid, &status, 0) < 0)
+		return;
+	t_reap = stress_latency_now();
+	if (!shared->unshare_ns) {
+		lat->err = shared->err;
+		return;
+	}
+	stress_latency_record(&lat->unshare_lat, shared->unshare_ns);
+	if (t_reap > shared->exit_ns)
+		stress_latency_record(&lat->exit_lat, t_reap - shared->exit_ns);
+}
+
+/*
+ *  stress_unshare_samples()
+ *	gather unshare samples for flags for a limited time
+ */
+static void stress_unshare_samples(
+	const stress_args_t *args,
+	stress_unshare_shared_t *shared,
+	const int flags,
+	stress_unshare_lat_t *lat)
+{
+	const double t_end = stress_time_now() + UNSHARE_BENCH_DURATION;
+	int i;
+
+	stress_latency_reset(&lat->unshare_lat);
+	stress_latency_reset(&lat->exit_lat);
+	lat->err = 0;
+
+	for (i = 0; i < UNSHARE_BENCH_SAMPLES; i++) {
+		if (!keep_stressing(args))
+			break;
+		stress_unshare_sample(shared, flags, lat);
+		if (lat->err || (stress_time_now() > t_end))
+			break;
+	}
+}
+
+#if defined(HAVE_SYS_MOUNT_H) &&	\
+    defined(CLONE_NEWNS) &&		\
+    defined(MS_BIND) &&			\
+    defined(MS_REC) &&			\
+    defined(MS_PRIVATE)
+#define HAVE_UNSHARE_MOUNT_SWEEP
+
+/*
+ *  stress_unshare_mount_sweep()
+ *	in a private mount namespace, add bind mounts of a tmpfs
+ *	directory up to each of the sweep counts and time how long
+ *	unshare(CLONE_NEWNS) takes to copy the mount tree
+ */
+static void NORETURN stress_unshare_mount_sweep(
+	const stress_args_t *args,
+	stress_unshare_shared_t *shared,
+	const char *path,
+	const size_t n_points)
+{
+	char base[PATH_MAX - 16], src[PATH_MAX];
+	uint32_t mounts = 0;
+	size_t i;
+
+	(void)shim_strlcpy(base, path, sizeof(base));
+
+	if ((shim_unshare(CLONE_NEWNS) < 0) ||
+	    (mount("none", "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0) ||
+	    (mount("none", path, "tmpfs", 0, "size=64k") < 0))
+		_exit(EXIT_NO_RESOURCE);
+	(void)snprintf(src, sizeof(src), "%s/src", base);
+	if (mkdir(src, S_IRWXU) < 0)
+		_exit(EXIT_NO_RESOURCE);
+
+	for (i = 0; i < n_points; i++) {
+		while (mounts < unshare_mount_counts[i]) {
+			char dst[PATH_MAX];
+
+			if (!keep_stressing(args))
+				_exit(EXIT_SUCCESS);
+			(void)snprintf(dst, sizeof(dst), "%s/%" PRIu32, base, mounts);
+			if ((mkdir(dst, S_IRWXU) < 0) ||
+			    (mount(src, dst, NULL, MS_BIND, NULL) < 0))
+				break;
+			mounts++;
+		}
+		shared->mounts[i] = mounts;
+		stress_unshare_samples(args, shared, CLONE_NEWNS, &shared->mnt[i]);
+		if (mounts < unshare_mount_counts[i])
+			break;
+	}
+	_exit(EXIT_SUCCESS);
+}
+#endif
+
+/*
+ *  stress_unshare_us()
+ *	latency percentile in microseconds
+ */
+static inline double stress_unshare_us(const stress_latency_t *lat, const double percentile)
+{
+	return (double)stress_latency_percentile(lat, percentile) / 1000.0;
+}
+
+/*
+ *  stress_unshare_report()
+ *	report unshare and exit to reap percentiles for one row
+ */
+static void stress_unshare_report(
+	const stress_args_t *args,
+	const char *name,
+	const stress_unshare_lat_t *lat)
+{
+	if (lat->unshare_lat.count == 0) {
+		pr_inf("%s: %-12s %9s %9s %9s %9s %9s  %s\n", args->name, name,
+			"-", "-", "-", "-", "-", lat->err ? strerror(lat->err) : "");
+		return;
+	}
+	pr_inf("%s: %-12s %9.1f %9.1f %9.1f %9.1f %9.1f\n", args->name, name,
+		stress_unshare_us(&lat->unshare_lat, 50.0),
+		stress_unshare_us(&lat->unshare_lat, 90.0),
+		stress_unshare_us(&lat->unshare_lat, 99.0),
+		stress_unshare_us(&lat->exit_lat, 50.0),
+		stress_unshare_us(&lat->exit_lat, 99.0));
+}
+
+/*
+ *  stress_unshare_bench()
+ *	time namespace creation for each namespace type alone and
+ *	all combined, mount namespace copy cost against the number
+ *	of mounts and the exit to reap time that covers the
+ *	synchronous part of namespace teardown
+ */
+static int stress_unshare_bench(const stress_args_t *args)
+{
+	uint32_t max_mounts = UNSHARE_MOUNTS_DEFAULT;
+	stress_unshare_shared_t *shared;
+	stress_unshare_lat_t *lat, *res;
+	stress_unshare_lat_t mnt_res[UNSHARE_MOUNT_POINTS];
+	uint32_t mnt_counts[UNSHARE_MOUNT_POINTS];
+	const size_t n_rows = UNSHARE_NS + 1;
+	size_t i, n_points = 0, res_size;
+	char path[PATH_MAX];
+	int all_flags = 0, ret;
+	bool done = false, mount_done = false;
+
+	(void)stress_get_setting("unshare-mounts", &max_mounts);
+	for (i = 0; i < SIZEOF_ARRAY(unshare_mount_counts); i++) {
+		if (unshare_mount_counts[i] > max_mounts)
+			break;
+		n_points++;
+	}
+	for (i = 0; i < UNSHARE_NS; i++)
+		all_flags |= unshare_ns[i].flag;
+
+	res_size = n_rows * sizeof(*lat);
+	lat = calloc(1, res_size);
+	res = calloc(1, res_size);
+	shared = (stress_unshare_shared_t *)mmap(NULL, sizeof(*shared),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (!lat || !res || (shared == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate latency histograms, skipping stressor\n",
+			args->name);
+		if (shared != MAP_FAILED)
+			(void)munmap((void *)shared, sizeof(*shared));
+		free(res);
+		free(lat);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(mnt_res, 0, sizeof(mnt_res));
+	(void)memset(mnt_counts, 0, sizeof(mnt_counts));
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		(void)munmap((void *)shared, sizeof(*shared));
+		free(res);
+		free(lat);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_dir_args(args, path, sizeof(path));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < UNSHARE_NS; i++) {
+			stress_unshare_samples(args, shared, unshare_ns[i].flag, &lat[i]);
+			if (!keep_stressing(args))
+				goto finish;
+		}
+		stress_unshare_samples(args, shared, all_flags, &lat[UNSHARE_NS]);
+		if (!keep_stressing(args))
+			goto finish;
+
+#if defined(HAVE_UNSHARE_MOUNT_SWEEP)
+		if (n_points > 0) {
+			pid_t pid;
+
+			(void)memset(shared->mounts, 0, sizeof(shared->mounts));
+			(void)memset(shared->mnt, 0, sizeof(shared->mnt));
+			pid = fork();
+			if (pid == 0) {
+				stress_parent_died_alarm();
+				stress_unshare_mount_sweep(args, shared, path, n_points);
+			} else if (pid > 0) {
+				int status;
+
+				(void)shim_waitpid(pid, &status, 0);
+				if (!keep_stressing(args))
+					goto finish;
+				if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS)) {
+					(void)memcpy(mnt_res, shared->mnt, sizeof(mnt_res));
+					(void)memcpy(mnt_counts, shared->mounts, sizeof(mnt_counts));
+					mount_done = true;
+				}
+			}
+		}
+#endif
+		(void)memcpy(res, lat, res_size);
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: namespace creation latency in us, unshare() and child exit to reap\n",
+			args->name);
+		pr_inf("%s: %-12s %9s %9s %9s %9s %9s\n", args->name, "namespace",
+			"p50", "p90", "p99", "exit p50", "exit p99");
+		for (i = 0; i < UNSHARE_NS; i++)
+			stress_unshare_report(args, unshare_ns[i].name, &res[i]);
+		stress_unshare_report(args, "all", &res[UNSHARE_NS]);
+	}
+	if (mount_done && (args->instance == 0)) {
+		pr_inf("%s: unshare(CLONE_NEWNS) mount tree copy latency in us\n", args->name);
+		pr_inf("%s: %-12s %9s %9s %9s %9s %9s\n", args->name, "mounts",
+			"p50", "p90", "p99", "exit p50", "exit p99");
+		for (i = 0; i < n_points; i++) {
+			char str[16];
+
+			if ((i > 0) && (mnt_counts[i] == mnt_counts[i - 1]))
+				break;
+			(void)snprintf(str, sizeof(str), "%" PRIu32, mnt_counts[i]);
+			stress_unshare_report(args, str, &mnt_res[i]);
+		}
+	}
+	if (done) {
+		for (i = 1; (i < UNSHARE_NS) && (i < 9); i++) {
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s unshare p50 us", unshare_ns[i].name);
+			stress_misc_stats_set(args->misc_stats, (int)(i - 1), str,
+				stress_unshare_us(&res[i].unshare_lat, 50.0));
+		}
+		stress_misc_stats_set(args->misc_stats, 9, "all unshare p50 us",
+			stress_unshare_us(&res[UNSHARE_NS].unshare_lat, 50.0));
+	}
+
+	(void)stress_temp_dir_rm_args(args);
+	(void)munmap((void *)shared, sizeof(*shared));
+	free(res);
+	free(lat);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_unshare()
  *	stress resource unsharing
@@ -134,6 +531,11 @@ static int stress_unshare(const stress_args_t *args)
 #endif
 	int *clone_flag_perms, all_flags;
 	size_t i, clone_flag_count;
+	bool unshare_bench = false;
+
+	(void)stress_get_setting("unshare-bench", &unshare_bench);
+	if (unshare_bench)
+		return stress_unshare_bench(args);
 
 	for (all_flags = 0, i = 0; i < SIZEOF_ARRAY(clone_flags); i++)
 		all_flags |= clone_flags[i];
@@ -261,6 +663,7 @@ static int stress_unshare(const stress_args_t *args)
 stressor_info_t stress_unshare_info = {
 	.stressor = stress_unshare,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -268,6 +671,7 @@ stressor_info_t stress_unshare_info = {
 stressor_info_t stress_unshare_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
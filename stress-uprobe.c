@@ -22,10 +22,21 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"uprobe N",	"start N workers that generate uprobe events" },
+	{ NULL,	"uprobe-bench",	"measure ns per uprobe and uretprobe hit" },
 	{ NULL,	"uprobe-ops N",	"stop after N uprobe events" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_uprobe_bench(const char *opt)
+{
+	return stress_set_setting_true("uprobe-bench", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_uprobe_bench,	stress_set_uprobe_bench },
+	{ 0,			NULL }
+};
+
 /*
  *  stress_uprobe_supported()
  *      check if we can run this with CAP_SYS_ADMIN capability
@@ -111,6 +122,284 @@ static void *stress_uprobe_libc_start(const pid_t pid, char *libc_path)
 	return addr;
 }
 
+#define UPROBE_BENCH_CALLS	(20000)
+#define UPROBE_BENCH_RUNS	(3)
+#define UPROBE_BENCH_PROBES	(8)
+
+typedef struct {
+	const char *name;		/* variant name */
+	const int n_entry;		/* number of entry uprobes */
+	const int n_ret;		/* number of uretprobes */
+} stress_uprobe_variant_t;
+
+typedef struct {
+	double ns;			/* ns per target call */
+	double hits;			/* probe hits per target call */
+	bool ok;
+} stress_uprobe_result_t;
+
+static const stress_uprobe_variant_t uprobe_variants[] = {
+	{ "none",		0, 0 },
+	{ "uprobe",		1, 0 },
+	{ "uretprobe",		0, 1 },
+	{ "uprobe+uretprobe",	1, 1 },
+	{ "2 uprobes",		2, 0 },
+	{ "4 uprobes",		4, 0 },
+	{ "8 uprobes",		8, 0 },
+};
+
+#define UPROBE_VARIANTS	(SIZEOF_ARRAY(uprobe_variants))
+
+/*
+ *  stress_uprobe_bench_target()
+ *	empty function that the benchmark probes
+ */
+static NOINLINE void stress_uprobe_bench_target(void)
+{
+	__asm__ __volatile__("");
+}
+
+static void (* volatile uprobe_bench_target)(void) = stress_uprobe_bench_target;
+
+/*
+ *  stress_uprobe_tracefs()
+ *	find the tracefs mount, newer kernels mount it on
+ *	/sys/kernel/tracing, older ones under debugfs
+ */
+static const char *stress_uprobe_tracefs(void)
+{
+	if (access("/sys/kernel/tracing/uprobe_events", W_OK) == 0)
+		return "/sys/kernel/tracing";
+	return "/sys/kernel/debug/tracing";
+}
+
+/*
+ *  stress_uprobe_self_offset()
+ *	find the file and file offset of addr in our own text
+ *	by scanning /proc/self/maps
+ */
+static bool stress_uprobe_self_offset(const void *addr, char *exe_path, uint64_t *file_offset)
+{
+	char buf[1024];
+	FILE *fp;
+	bool found = false;
+	const uint64_t a = (uint64_t)(uintptr_t)addr;
+
+	fp = fopen("/proc/self/maps", "r");
+	if (!fp)
+		return false;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		uint64_t start, end, offset, dev_major, dev_minor, inode;
+		char perm[5];
+		int n;
+
+		n = sscanf(buf, "%" SCNx64 "-%" SCNx64 "%4s %" SCNx64 " %" SCNx64
+			":%" SCNx64 " %" SCNu64 "%" X_STR(PATH_MAX) "s\n",
+			&start, &end, perm, &offset, &dev_major, &dev_minor,
+			&inode, exe_path);
+		if ((n == 8) && (perm[2] == 'x') && (a >= start) && (a < end)) {
+			*file_offset = (a - start) + offset;
+			found = true;
+			break;
+		}
+	}
+	(void)fclose(fp);
+
+	return found;
+}
+
+/*
+ *  stress_uprobe_bench_time()
+ *	best of UPROBE_BENCH_RUNS runs of ns per call of the target
+ */
+static double stress_uprobe_bench_time(void)
+{
+	double best = -1.0;
+	int run;
+
+	for (run = 0; run < UPROBE_BENCH_RUNS; run++) {
+		double t, dt;
+		int i;
+
+		t = stress_time_now();
+		for (i = 0; i < UPROBE_BENCH_CALLS; i++)
+			uprobe_bench_target();
+		dt = stress_time_now() - t;
+		if ((best < 0.0) || (dt < best))
+			best = dt;
+	}
+	return (best * STRESS_NANOSECOND) / UPROBE_BENCH_CALLS;
+}
+
+/*
+ *  stress_uprobe_bench_hits()
+ *	sum the hits of all our events from uprobe_profile
+ */
+static uint64_t stress_uprobe_bench_hits(const char *tracefs, const char *prefix)
+{
+	char path[PATH_MAX], buf[PATH_MAX + 256];
+	FILE *fp;
+	uint64_t hits = 0;
+
+	(void)snprintf(path, sizeof(path), "%s/uprobe_profile", tracefs);
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		char file[PATH_MAX], event[128];
+		uint64_t count;
+
+		if (sscanf(buf, "%" X_STR(PATH_MAX) "s %127s %" SCNu64, file, event, &count) != 3)
+			continue;
+		if (!strncmp(event, prefix, strlen(prefix)))
+			hits += count;
+	}
+	(void)fclose(fp);
+
+	return hits;
+}
+
+/*
+ *  stress_uprobe_bench_variant()
+ *	attach the variant's uprobes and uretprobes to the target,
+ *	enable them and measure the target call cost
+ */
+static void stress_uprobe_bench_variant(
+	const char *tracefs,
+	const char *exe_path,
+	const uint64_t file_offset,
+	const char *prefix,
+	const stress_uprobe_variant_t *variant,
+	stress_uprobe_result_t *result)
+{
+	char buf[PATH_MAX * 2], path[PATH_MAX], event[UPROBE_BENCH_PROBES * 2][128];
+	int i, n = 0, enabled = 0;
+	uint64_t hits;
+
+	result->ok = false;
+	for (i = 0; i < variant->n_entry + variant->n_ret; i++) {
+		const bool ret_probe = (i >= variant->n_entry);
+
+		(void)snprintf(event[n], sizeof(event[n]), "%s%d", prefix, i);
+		(void)snprintf(buf, sizeof(buf), "%c:%s %s:0x%" PRIx64 "\n",
+			ret_probe ? 'r' : 'p', event[n], exe_path, file_offset);
+		(void)snprintf(path, sizeof(path), "%s/uprobe_events", tracefs);
+		if (stress_uprobe_write(path, O_WRONLY | O_APPEND, buf) < 0)
+			goto remove;
+		n++;
+	}
+	for (i = 0; i < n; i++) {
+		(void)snprintf(buf, sizeof(buf), "%s/events/uprobes/%s/enable", tracefs, event[i]);
+		if (stress_uprobe_write(buf, O_WRONLY | O_TRUNC, "1\n") < 0)
+			goto disable;
+		enabled++;
+	}
+
+	hits = stress_uprobe_bench_hits(tracefs, prefix);
+	result->ns = stress_uprobe_bench_time();
+	result->hits = (double)(stress_uprobe_bench_hits(tracefs, prefix) - hits) /
+		(double)(UPROBE_BENCH_CALLS * UPROBE_BENCH_RUNS);
+	result->ok = true;
+
+disable:
+	for (i = 0; i < enabled; i++) {
+		(void)snprintf(buf, sizeof(buf), "%s/events/uprobes/%s/enable", tracefs, event[i]);
+		VOID_RET(int, stress_uprobe_write(buf, O_WRONLY | O_TRUNC, "0\n"));
+	}
+remove:
+	for (i = 0; i < n; i++) {
+		(void)snprintf(path, sizeof(path), "%s/uprobe_events", tracefs);
+		(void)snprintf(buf, sizeof(buf), "-:%s\n", event[i]);
+		VOID_RET(int, stress_uprobe_write(path, O_WRONLY | O_APPEND, buf));
+	}
+}
+
+/*
+ *  stress_uprobe_bench()
+ *	measure the cost per hit of uprobes, uretprobes and multiple
+ *	uprobes on an empty function in stress-ng itself
+ */
+static int stress_uprobe_bench(const stress_args_t *args)
+{
+	const char *tracefs = stress_uprobe_tracefs();
+	char exe_path[PATH_MAX + 1], prefix[64];
+	stress_uprobe_result_t pass[UPROBE_VARIANTS], res[UPROBE_VARIANTS];
+	uint64_t file_offset;
+	size_t i;
+	bool done = false;
+
+	if (!stress_uprobe_self_offset((void *)stress_uprobe_bench_target, exe_path, &file_offset)) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot find uprobe target in /proc/self/maps, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)snprintf(prefix, sizeof(prefix), "stressngbench%" PRIdMAX "_%" PRIu32 "_",
+		(intmax_t)getpid(), args->instance);
+	(void)memset(res, 0, sizeof(res));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < UPROBE_VARIANTS; i++) {
+			if (!keep_stressing(args))
+				goto finish;
+			stress_uprobe_bench_variant(tracefs, exe_path, file_offset,
+				prefix, &uprobe_variants[i], &pass[i]);
+		}
+		if (!pass[1].ok) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: cannot attach uprobes via %s/uprobe_events, "
+					"skipping stressor\n", args->name, tracefs);
+			stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+			return EXIT_NO_RESOURCE;
+		}
+		(void)memcpy(res, pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: uprobe cost on an empty function, %d calls per run, best of %d runs\n",
+			args->name, UPROBE_BENCH_CALLS, UPROBE_BENCH_RUNS);
+		pr_inf("%s: %-17s %10s %10s %10s %10s\n", args->name,
+			"probes", "ns/call", "added ns", "hits/call", "ns/hit");
+		for (i = 0; i < UPROBE_VARIANTS; i++) {
+			const stress_uprobe_result_t *r = &res[i];
+			char per_hit[32];
+
+			if (!r->ok) {
+				pr_inf("%s: %-17s %10s %10s %10s %10s\n", args->name,
+					uprobe_variants[i].name, "-", "-", "-", "-");
+				continue;
+			}
+			const double added = r->ns - res[0].ns;
+
+			if (r->hits > 0.0)
+				(void)snprintf(per_hit, sizeof(per_hit), "%.1f", added / r->hits);
+			else
+				(void)shim_strlcpy(per_hit, "-", sizeof(per_hit));
+			pr_inf("%s: %-17s %10.1f %10.1f %10.2f %10s\n", args->name,
+				uprobe_variants[i].name, r->ns, added, r->hits, per_hit);
+		}
+	}
+	if (done) {
+		for (i = 1; i < UPROBE_VARIANTS; i++) {
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s added ns", uprobe_variants[i].name);
+			stress_misc_stats_set(args->misc_stats, (int)(i - 1), str,
+				res[i].ok ? res[i].ns - res[0].ns : 0.0);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_uprobe()
  *	stress uprobe events
@@ -125,6 +414,11 @@ static int stress_uprobe(const stress_args_t *args)
 	int rc = EXIT_SUCCESS;
 	int fd;
 	pid_t pid = getpid();
+	bool uprobe_bench = false;
+
+	(void)stress_get_setting("uprobe-bench", &uprobe_bench);
+	if (uprobe_bench)
+		return stress_uprobe_bench(args);
 
 	libc_addr = stress_uprobe_libc_start(pid, libc_path);
 	if (!libc_addr) {
@@ -257,6 +551,7 @@ stressor_info_t stress_uprobe_info = {
 	.stressor = stress_uprobe,
 	.class = CLASS_CPU,
 	.supported = stress_uprobe_supported,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
@@ -264,6 +559,7 @@ stressor_info_t stress_uprobe_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_CPU,
 	.supported = stress_uprobe_supported,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
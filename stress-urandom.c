@@ -303,5 +303,6 @@ stressor_info_t stress_urandom_info = {
 	.stressor = stress_urandom,
 	.class = CLASS_DEV | CLASS_OS,
 	.verify = VERIFY_OPTIONAL,
+	.thread_safe = true,
 	.help = help
 };
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-syscall-stats.h"
 #include "core-pragma.h"
 
 #if defined(HAVE_UTIME_H)
@@ -112,6 +113,7 @@ static int stress_utime(const stress_args_t *args)
 
 	do {
 		struct timeval timevals[2];
+		uint64_t sc_t;
 #if (defined(HAVE_FUTIMENS) || defined(HAVE_UTIMENSAT)) && \
     (defined(UTIME_NOW) || defined(UTIME_OMIT))
 		struct timespec ts[2];
@@ -119,7 +121,10 @@ static int stress_utime(const stress_args_t *args)
 
 		(void)gettimeofday(&timevals[0], NULL);
 		timevals[1] = timevals[0];
-		if (utimes(filename, timevals) < 0) {
+		sc_t = stress_syscall_stats_start();
+		ret = utimes(filename, timevals);
+		stress_syscall_stats_end(STRESS_SYSCALL_UTIMES, sc_t);
+		if (ret < 0) {
 			pr_dbg("%s: utimes failed: errno=%d (%s)%s\n",
 				args->name, errno, strerror(errno),
 				stress_fs_type(filename));
@@ -139,7 +144,10 @@ static int stress_utime(const stress_args_t *args)
 		VOID_RET(int, utimes(hugename, timevals));
 
 #if defined(HAVE_FUTIMENS)
-		if (futimens(fd, NULL) < 0) {
+		sc_t = stress_syscall_stats_start();
+		ret = futimens(fd, NULL);
+		stress_syscall_stats_end(STRESS_SYSCALL_FUTIMENS, sc_t);
+		if (ret < 0) {
 			pr_dbg("%s: futimens failed: errno=%d (%s)%s\n",
 				args->name, errno, strerror(errno),
 				stress_fs_type(filename));
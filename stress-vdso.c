@@ -35,6 +35,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"vdso N",	"start N workers exercising functions in the VDSO" },
 	{ NULL,	"vdso-ops N",	"stop after N vDSO function calls" },
 	{ NULL,	"vdso-func F",	"use just vDSO function F" },
+	{ NULL,	"vdso-matrix",	"report ns per call of each clock via vDSO vs system call" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -47,8 +48,14 @@ static int stress_set_vdso_func(const char *name)
 	return stress_set_setting("vdso-func", TYPE_ID_STR, name);
 }
 
+static int stress_set_vdso_matrix(const char *opt)
+{
+	return stress_set_setting_true("vdso-matrix", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_vdso_func,	stress_set_vdso_func },
+	{ OPT_vdso_matrix,	stress_set_vdso_matrix },
 	{ 0,			NULL }
 };
 
@@ -449,6 +456,352 @@ static int vdso_sym_list_check_vdso_func(stress_vdso_sym_t **list)
 	return 0;
 }
 
+#define VDSO_MATRIX_CHUNK	(1024)		/* calls between time checks */
+#define VDSO_MATRIX_DURATION	(0.02)		/* seconds per measurement */
+#define VDSO_MATRIX_FALLBACK	(0.5)		/* vDSO / syscall ratio that flags a fallback */
+
+#define VDSO_CALL_CLOCK_GETTIME	(0)
+#define VDSO_CALL_GETTIMEOFDAY	(1)
+#define VDSO_CALL_TIME		(2)
+#define VDSO_CALL_GETCPU	(3)
+
+/* a row of the call cost matrix */
+typedef struct {
+	const char *name;	/* row name */
+	int call;		/* VDSO_CALL_* function */
+	clockid_t clk_id;	/* clock id for clock_gettime */
+} stress_vdso_matrix_row_t;
+
+static const stress_vdso_matrix_row_t vdso_matrix_rows[] = {
+#if defined(HAVE_CLOCK_GETTIME)
+#if defined(CLOCK_REALTIME)
+	{ "CLOCK_REALTIME",		VDSO_CALL_CLOCK_GETTIME, CLOCK_REALTIME },
+#endif
+#if defined(CLOCK_REALTIME_COARSE)
+	{ "CLOCK_REALTIME_COARSE",	VDSO_CALL_CLOCK_GETTIME, CLOCK_REALTIME_COARSE },
+#endif
+#if defined(CLOCK_MONOTONIC)
+	{ "CLOCK_MONOTONIC",		VDSO_CALL_CLOCK_GETTIME, CLOCK_MONOTONIC },
+#endif
+#if defined(CLOCK_MONOTONIC_COARSE)
+	{ "CLOCK_MONOTONIC_COARSE",	VDSO_CALL_CLOCK_GETTIME, CLOCK_MONOTONIC_COARSE },
+#endif
+#if defined(CLOCK_MONOTONIC_RAW)
+	{ "CLOCK_MONOTONIC_RAW",	VDSO_CALL_CLOCK_GETTIME, CLOCK_MONOTONIC_RAW },
+#endif
+#if defined(CLOCK_BOOTTIME)
+	{ "CLOCK_BOOTTIME",		VDSO_CALL_CLOCK_GETTIME, CLOCK_BOOTTIME },
+#endif
+#if defined(CLOCK_TAI)
+	{ "CLOCK_TAI",			VDSO_CALL_CLOCK_GETTIME, CLOCK_TAI },
+#endif
+#endif
+	{ "gettimeofday",		VDSO_CALL_GETTIMEOFDAY,	 0 },
+	{ "time",			VDSO_CALL_TIME,		 0 },
+	{ "getcpu",			VDSO_CALL_GETCPU,	 0 },
+};
+
+/*
+ *  vdso_sym_find()
+ *	find a vDSO function by its plain, __vdso_ or __kernel_ name
+ */
+static void *vdso_sym_find(const char *name)
+{
+	stress_vdso_sym_t *vdso_sym;
+
+	for (vdso_sym = vdso_sym_list; vdso_sym; vdso_sym = vdso_sym->next) {
+		const char *sym = vdso_sym->name;
+
+		if (!strncmp(sym, "__vdso_", 7))
+			sym += 7;
+		else if (!strncmp(sym, "__kernel_", 9))
+			sym += 9;
+		if (!strcmp(sym, name))
+			return vdso_sym->addr;
+	}
+	return NULL;
+}
+
+/*
+ *  vdso_matrix_call()
+ *	make one call of a matrix row, via the vDSO if addr is
+ *	non-NULL, otherwise via a forced system call
+ */
+static inline int vdso_matrix_call(
+	const stress_vdso_matrix_row_t *row,
+	void *addr)
+{
+	struct timespec ts;
+	struct timeval tv;
+	time_t t;
+	unsigned cpu, node;
+
+	switch (row->call) {
+	case VDSO_CALL_CLOCK_GETTIME:
+		if (addr) {
+			int (*vdso_clock_gettime)(clockid_t clk_id, struct timespec *tp);
+
+			*(void **)(&vdso_clock_gettime) = addr;
+			return vdso_clock_gettime(row->clk_id, &ts);
+		}
+#if defined(__NR_clock_gettime)
+		return (int)syscall(__NR_clock_gettime, row->clk_id, &ts);
+#else
+		break;
+#endif
+	case VDSO_CALL_GETTIMEOFDAY:
+		if (addr) {
+			int (*vdso_gettimeofday)(struct timeval *tv, struct timezone *tz);
+
+			*(void **)(&vdso_gettimeofday) = addr;
+			return vdso_gettimeofday(&tv, NULL);
+		}
+#if defined(__NR_gettimeofday)
+		return (int)syscall(__NR_gettimeofday, &tv, NULL);
+#else
+		break;
+#endif
+	case VDSO_CALL_TIME:
+		if (addr) {
+			time_t (*vdso_time)(time_t *tloc);
+
+			*(void **)(&vdso_time) = addr;
+			return (vdso_time(&t) == (time_t)-1) ? -1 : 0;
+		}
+#if defined(__NR_time)
+		return ((time_t)syscall(__NR_time, &t) == (time_t)-1) ? -1 : 0;
+#else
+		break;
+#endif
+	case VDSO_CALL_GETCPU:
+		if (addr) {
+			int (*vdso_getcpu)(unsigned *cpu, unsigned *node, void *tcache);
+
+			*(void **)(&vdso_getcpu) = addr;
+			return vdso_getcpu(&cpu, &node, NULL);
+		}
+#if defined(__NR_getcpu)
+		return (int)syscall(__NR_getcpu, &cpu, &node, NULL);
+#else
+		break;
+#endif
+	default:
+		break;
+	}
+	return -1;
+}
+
+/*
+ *  vdso_matrix_syscall_available()
+ *	true if there is a forced system call path for a row
+ */
+static bool vdso_matrix_syscall_available(const stress_vdso_matrix_row_t *row)
+{
+	switch (row->call) {
+	case VDSO_CALL_CLOCK_GETTIME:
+#if defined(__NR_clock_gettime)
+		return true;
+#else
+		return false;
+#endif
+	case VDSO_CALL_GETTIMEOFDAY:
+#if defined(__NR_gettimeofday)
+		return true;
+#else
+		return false;
+#endif
+	case VDSO_CALL_TIME:
+#if defined(__NR_time)
+		return true;
+#else
+		return false;
+#endif
+	case VDSO_CALL_GETCPU:
+#if defined(__NR_getcpu)
+		return true;
+#else
+		return false;
+#endif
+	default:
+		break;
+	}
+	return false;
+}
+
+/*
+ *  vdso_matrix_measure()
+ *	ns per call of a row, < 0.0 if the call fails or is not available
+ */
+static double vdso_matrix_measure(
+	const stress_vdso_matrix_row_t *row,
+	void *addr)
+{
+	double t1, t2;
+	uint64_t calls = 0;
+
+	if (vdso_matrix_call(row, addr) < 0)
+		return -1.0;
+
+	t1 = stress_time_now();
+	do {
+		register int i;
+
+		for (i = 0; i < VDSO_MATRIX_CHUNK; i++)
+			(void)vdso_matrix_call(row, addr);
+		calls += VDSO_MATRIX_CHUNK;
+		t2 = stress_time_now();
+	} while ((t2 - t1) < VDSO_MATRIX_DURATION);
+
+	return ((t2 - t1) * (double)STRESS_NANOSECOND) / (double)calls;
+}
+
+/*
+ *  vdso_matrix_clocksource()
+ *	read a clocksource sysfs attribute, "unknown" if not readable
+ */
+static void vdso_matrix_clocksource(const char *attr, char *buf, const size_t buf_len)
+{
+	char path[PATH_MAX];
+	char *ptr;
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/clocksource/clocksource0/%s", attr);
+	(void)memset(buf, 0, buf_len);
+	if (system_read(path, buf, buf_len - 1) <= 0) {
+		(void)shim_strlcpy(buf, "unknown", buf_len);
+		return;
+	}
+	for (ptr = buf + strlen(buf); (ptr > buf) && isspace((int)ptr[-1]); ptr--)
+		ptr[-1] = '\0';
+}
+
+/*
+ *  vdso_matrix_str()
+ *	format a ns per call cell, "-" if not measured
+ */
+static void vdso_matrix_str(char *str, const size_t len, const double ns)
+{
+	if (ns < 0.0)
+		(void)shim_strlcpy(str, "-", len);
+	else
+		(void)snprintf(str, len, "%.2f", ns);
+}
+
+/*
+ *  stress_vdso_matrix()
+ *	ns per call of each clock id and time function via the vDSO
+ *	and via a forced system call, flags calls where the vDSO is
+ *	not much cheaper than the system call as this happens when the
+ *	active clocksource cannot be read from user space
+ */
+static int stress_vdso_matrix(const stress_args_t *args)
+{
+	const size_t n = SIZEOF_ARRAY(vdso_matrix_rows);
+	double vdso_ns[SIZEOF_ARRAY(vdso_matrix_rows)];
+	double sys_ns[SIZEOF_ARRAY(vdso_matrix_rows)];
+	void *addrs[SIZEOF_ARRAY(vdso_matrix_rows)];
+	char current[64], available[256];
+	size_t i, fallbacks = 0;
+	int idx = 0;
+
+	for (i = 0; i < n; i++) {
+		static const char * const call_names[] = {
+			"clock_gettime", "gettimeofday", "time", "getcpu"
+		};
+
+		addrs[i] = vdso_sym_find(call_names[vdso_matrix_rows[i].call]);
+		vdso_ns[i] = -1.0;
+		sys_ns[i] = -1.0;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < n) && keep_stressing(args); i++) {
+			double ns;
+
+			if (addrs[i]) {
+				ns = vdso_matrix_measure(&vdso_matrix_rows[i], addrs[i]);
+				if ((ns >= 0.0) && ((vdso_ns[i] < 0.0) || (ns < vdso_ns[i])))
+					vdso_ns[i] = ns;
+			}
+			if (vdso_matrix_syscall_available(&vdso_matrix_rows[i])) {
+				ns = vdso_matrix_measure(&vdso_matrix_rows[i], NULL);
+				if ((ns >= 0.0) && ((sys_ns[i] < 0.0) || (ns < sys_ns[i])))
+					sys_ns[i] = ns;
+			}
+		}
+		if (i < n)
+			break;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0; i < n; i++) {
+		if ((vdso_ns[i] >= 0.0) && (sys_ns[i] > 0.0) &&
+		    (vdso_ns[i] > sys_ns[i] * VDSO_MATRIX_FALLBACK))
+			fallbacks++;
+	}
+
+	if (args->instance == 0) {
+		vdso_matrix_clocksource("current_clocksource", current, sizeof(current));
+		vdso_matrix_clocksource("available_clocksource", available, sizeof(available));
+		pr_inf("%s: clocksource: %s (available: %s)\n", args->name, current, available);
+		if (strcmp(current, "tsc") && strstr(available, "tsc"))
+			pr_inf("%s: warning: tsc is available but not the active clocksource, "
+				"check the kernel log for an unstable tsc\n", args->name);
+
+		pr_inf("%s: %-22s %12s %12s %8s\n", args->name,
+			"call", "vDSO ns", "syscall ns", "speedup");
+		for (i = 0; i < n; i++) {
+			char vstr[16], sstr[16], rstr[16];
+			const bool fallback = (vdso_ns[i] >= 0.0) && (sys_ns[i] > 0.0) &&
+					      (vdso_ns[i] > sys_ns[i] * VDSO_MATRIX_FALLBACK);
+
+			vdso_matrix_str(vstr, sizeof(vstr), vdso_ns[i]);
+			vdso_matrix_str(sstr, sizeof(sstr), sys_ns[i]);
+			if ((vdso_ns[i] > 0.0) && (sys_ns[i] >= 0.0))
+				(void)snprintf(rstr, sizeof(rstr), "%.1fx", sys_ns[i] / vdso_ns[i]);
+			else
+				(void)shim_strlcpy(rstr, "-", sizeof(rstr));
+			pr_inf("%s: %-22s %12s %12s %8s%s\n", args->name,
+				vdso_matrix_rows[i].name, vstr, sstr, rstr,
+				fallback ? "  syscall fallback?" : "");
+		}
+		if (fallbacks) {
+			pr_inf("%s: warning: %zu vDSO call%s cost more than %.0f%% of a system call, "
+				"the %s clocksource is probably not readable from user space\n",
+				args->name, fallbacks, fallbacks == 1 ? "" : "s",
+				VDSO_MATRIX_FALLBACK * 100.0, current);
+		}
+	}
+
+	for (i = 0; (i < n) && (idx < STRESS_MISC_STATS_MAX - 1); i++) {
+		char desc[32];
+
+		if ((vdso_matrix_rows[i].call == VDSO_CALL_CLOCK_GETTIME) &&
+		    (strcmp(vdso_matrix_rows[i].name, "CLOCK_MONOTONIC") &&
+		     strcmp(vdso_matrix_rows[i].name, "CLOCK_REALTIME_COARSE")))
+			continue;
+		if (vdso_ns[i] >= 0.0) {
+			(void)snprintf(desc, sizeof(desc), "vDSO ns %s", vdso_matrix_rows[i].name +
+				((vdso_matrix_rows[i].call == VDSO_CALL_CLOCK_GETTIME) ? 6 : 0));
+			stress_misc_stats_set(args->misc_stats, idx++, desc, vdso_ns[i]);
+		}
+		if ((sys_ns[i] >= 0.0) && (idx < STRESS_MISC_STATS_MAX - 1)) {
+			(void)snprintf(desc, sizeof(desc), "syscall ns %s", vdso_matrix_rows[i].name +
+				((vdso_matrix_rows[i].call == VDSO_CALL_CLOCK_GETTIME) ? 6 : 0));
+			stress_misc_stats_set(args->misc_stats, idx++, desc, sys_ns[i]);
+		}
+	}
+	stress_misc_stats_set(args->misc_stats, idx, "vDSO syscall fallbacks", (double)fallbacks);
+
+	vdso_sym_list_free(&vdso_sym_list);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_vdso()
  *	stress system wraps in vDSO
@@ -458,6 +811,7 @@ static int stress_vdso(const stress_args_t *args)
 	char *str;
 	double t1, t2, t3, dt, overhead_ns;
 	uint64_t counter;
+	bool vdso_matrix = false;
 
 	if (!vdso_sym_list) {
 		/* Should not fail, but worth checking to avoid breakage */
@@ -466,6 +820,10 @@ static int stress_vdso(const stress_args_t *args)
 				args->name);
 		return EXIT_NOT_IMPLEMENTED;
 	}
+	(void)stress_get_setting("vdso-matrix", &vdso_matrix);
+	if (vdso_matrix)
+		return stress_vdso_matrix(args);
+
 	vdso_sym_list_remove_duplicates(&vdso_sym_list);
 	if (vdso_sym_list_check_vdso_func(&vdso_sym_list) < 0) {
 		return EXIT_FAILURE;
@@ -0,0 +1,508 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-arch.h"
+#include "core-cpu.h"
+#include "core-put.h"
+
+#define MIN_VECFREQ_DWELL	(1)
+#define MAX_VECFREQ_DWELL	(3600)
+#define DEFAULT_VECFREQ_DWELL	(2)
+
+#define VECFREQ_LOOPS		(4096)	/* kernel loop iterations per call */
+#define VECFREQ_ACCUMULATORS	(8)	/* independent chains per iteration */
+#define VECFREQ_SAMPLE		(0.1)	/* seconds between frequency samples */
+
+#define ARCH_REQ_XCOMP_PERM	(0x1023)
+#define XFEATURE_XTILEDATA	(18)
+
+static const stress_help_t help[] = {
+	{ NULL,	"vecfreq N",		"start N workers measuring vector ISA throughput and core frequency" },
+	{ NULL,	"vecfreq-dwell S",	"run each ISA tier for S seconds, default is 2" },
+	{ NULL,	"vecfreq-ops N",	"stop after N vector kernel bogo operations" },
+	{ NULL,	"vecfreq-tier T",	"select scalar, sse, avx2, avx512-light, avx512-heavy, amx or all" },
+	{ NULL,	NULL,			NULL }
+};
+
+/*
+ *  Each kernel returns the number of instructions it executed,
+ *  a multiply-add counts as two instructions unless the tier
+ *  fuses it into a single FMA instruction
+ */
+typedef uint64_t (*stress_vecfreq_func_t)(void);
+
+typedef struct {
+	const char *name;		/* ISA tier name */
+	bool (*supported)(void);	/* can the tier run on this CPU? */
+	stress_vecfreq_func_t func;	/* tier kernel */
+} stress_vecfreq_tier_t;
+
+typedef struct {
+	uint64_t instrs;		/* instructions executed */
+	double duration;		/* time spent in the tier */
+	double ghz_sum;			/* sum of frequency samples */
+	double ghz_min;			/* lowest frequency sample */
+	uint64_t ghz_samples;		/* number of frequency samples */
+} stress_vecfreq_stats_t;
+
+/*
+ *  STRESS_VECFREQ_FP_KERNEL()
+ *	generate a floating point multiply-add kernel of width
+ *	bytes per vector, a = a * m + c converges to 1.0 so the
+ *	data never becomes denormal or infinite
+ */
+#define STRESS_VECFREQ_FP_KERNEL(tname, width, target, instrs)		\
+typedef double stress_vecfreq_ ## tname ## _t				\
+	__attribute__ ((vector_size(width)));				\
+									\
+static uint64_t target OPTIMIZE3 stress_vecfreq_ ## tname(void)		\
+{									\
+	const size_t lanes = width / sizeof(double);			\
+	stress_vecfreq_ ## tname ## _t a0, a1, a2, a3, a4, a5, a6, a7;	\
+	stress_vecfreq_ ## tname ## _t m, c;				\
+	register size_t i;						\
+									\
+	for (i = 0; i < lanes; i++) {					\
+		m[i] = 0.9999;						\
+		c[i] = 0.0001;						\
+		a0[i] = 1.0 + (double)i;				\
+		a1[i] = 2.0 + (double)i;				\
+		a2[i] = 3.0 + (double)i;				\
+		a3[i] = 4.0 + (double)i;				\
+		a4[i] = 5.0 + (double)i;				\
+		a5[i] = 6.0 + (double)i;				\
+		a6[i] = 7.0 + (double)i;				\
+		a7[i] = 8.0 + (double)i;				\
+	}								\
+									\
+	for (i = 0; i < VECFREQ_LOOPS; i++) {				\
+		a0 = a0 * m + c;					\
+		a1 = a1 * m + c;					\
+		a2 = a2 * m + c;					\
+		a3 = a3 * m + c;					\
+		a4 = a4 * m + c;					\
+		a5 = a5 * m + c;					\
+		a6 = a6 * m + c;					\
+		a7 = a7 * m + c;					\
+	}								\
+	a0 += a1 + a2 + a3 + a4 + a5 + a6 + a7;				\
+	stress_double_put(a0[0]);					\
+									\
+	return (uint64_t)VECFREQ_LOOPS * VECFREQ_ACCUMULATORS * instrs;	\
+}
+
+/*
+ *  STRESS_VECFREQ_INT_KERNEL()
+ *	generate an integer xor and add kernel of width bytes
+ *	per vector, these are "light" instructions that do not
+ *	use the floating point units
+ */
+#define STRESS_VECFREQ_INT_KERNEL(tname, width, target)			\
+typedef uint64_t stress_vecfreq_ ## tname ## _t				\
+	__attribute__ ((vector_size(width)));				\
+									\
+static uint64_t target OPTIMIZE3 stress_vecfreq_ ## tname(void)		\
+{									\
+	const size_t lanes = width / sizeof(uint64_t);			\
+	stress_vecfreq_ ## tname ## _t a0, a1, a2, a3, a4, a5, a6, a7;	\
+	stress_vecfreq_ ## tname ## _t m, c;				\
+	register size_t i;						\
+									\
+	for (i = 0; i < lanes; i++) {					\
+		m[i] = 0x5555aaaa5555aaaaULL;				\
+		c[i] = 0x9e3779b97f4a7c15ULL;				\
+		a0[i] = stress_mwc64();					\
+		a1[i] = stress_mwc64();					\
+		a2[i] = stress_mwc64();					\
+		a3[i] = stress_mwc64();					\
+		a4[i] = stress_mwc64();					\
+		a5[i] = stress_mwc64();					\
+		a6[i] = stress_mwc64();					\
+		a7[i] = stress_mwc64();					\
+	}								\
+									\
+	for (i = 0; i < VECFREQ_LOOPS; i++) {				\
+		a0 = (a0 ^ m) + c;					\
+		a1 = (a1 ^ m) + c;					\
+		a2 = (a2 ^ m) + c;					\
+		a3 = (a3 ^ m) + c;					\
+		a4 = (a4 ^ m) + c;					\
+		a5 = (a5 ^ m) + c;					\
+		a6 = (a6 ^ m) + c;					\
+		a7 = (a7 ^ m) + c;					\
+	}								\
+	a0 += a1 + a2 + a3 + a4 + a5 + a6 + a7;				\
+	stress_uint64_put(a0[0]);					\
+									\
+	return (uint64_t)VECFREQ_LOOPS * VECFREQ_ACCUMULATORS * 2;	\
+}
+
+/* scalar baseline, no FMA on the default x86 target */
+STRESS_VECFREQ_FP_KERNEL(scalar, 8, , 2)
+
+#if defined(STRESS_ARCH_X86)
+STRESS_VECFREQ_FP_KERNEL(sse, 16, __attribute__ ((target("sse2"))), 2)
+#define HAVE_VECFREQ_SSE
+
+#if defined(HAVE_TARGET_CLONES_AVX2)
+STRESS_VECFREQ_FP_KERNEL(avx2, 32, __attribute__ ((target("avx2,fma"))), 1)
+#define HAVE_VECFREQ_AVX2
+#endif
+
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+STRESS_VECFREQ_INT_KERNEL(avx512_light, 64, __attribute__ ((target("avx512f"))))
+STRESS_VECFREQ_FP_KERNEL(avx512_heavy, 64, __attribute__ ((target("avx512f"))), 1)
+#define HAVE_VECFREQ_AVX512
+#endif
+#endif
+
+#if defined(__x86_64__) &&		\
+    defined(__linux__) &&		\
+    defined(HAVE_ASM_X86_AMX)
+#define HAVE_VECFREQ_AMX
+
+/* 16 rows x 64 bytes per tile */
+#define VECFREQ_AMX_ROWS	(16)
+#define VECFREQ_AMX_COLSB	(64)
+#define VECFREQ_AMX_TILE	(VECFREQ_AMX_ROWS * VECFREQ_AMX_COLSB)
+
+typedef struct {
+	uint8_t palette_id;
+	uint8_t start_row;
+	uint8_t reserved[14];
+	uint16_t colsb[16];
+	uint8_t rows[16];
+} stress_vecfreq_amx_cfg_t;
+
+static int8_t vecfreq_amx_data[4][VECFREQ_AMX_TILE] ALIGN64;
+static int32_t vecfreq_amx_result[VECFREQ_AMX_ROWS * VECFREQ_AMX_COLSB / sizeof(int32_t)] ALIGN64;
+
+/*
+ *  stress_vecfreq_amx_supported()
+ *	amx needs the cpu support and permission from the
+ *	kernel to use the tile data state
+ */
+static bool stress_vecfreq_amx_supported(void)
+{
+	static int supported = -1;
+
+	if (supported < 0) {
+		size_t i;
+
+		supported = stress_cpu_x86_has_amx_int8() &&
+			(shim_arch_prctl(ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) == 0);
+		for (i = 0; i < sizeof(vecfreq_amx_data); i++)
+			((int8_t *)vecfreq_amx_data)[i] = (int8_t)stress_mwc8();
+	}
+	return supported;
+}
+
+/*
+ *  stress_vecfreq_amx()
+ *	int8 tile dot products, tmm0..tmm3 accumulate the
+ *	products of a tiles tmm4, tmm5 and b tiles tmm6, tmm7
+ */
+static uint64_t OPTIMIZE3 stress_vecfreq_amx(void)
+{
+	stress_vecfreq_amx_cfg_t cfg ALIGN64;
+	const uint64_t stride = VECFREQ_AMX_COLSB;
+	register size_t i;
+
+	(void)memset(&cfg, 0, sizeof(cfg));
+	cfg.palette_id = 1;
+	for (i = 0; i < 8; i++) {
+		cfg.colsb[i] = VECFREQ_AMX_COLSB;
+		cfg.rows[i] = VECFREQ_AMX_ROWS;
+	}
+
+	__asm__ __volatile__("ldtilecfg %0\n" : : "m"(cfg));
+	__asm__ __volatile__("tilezero %%tmm0\n"
+			     "tilezero %%tmm1\n"
+			     "tilezero %%tmm2\n"
+			     "tilezero %%tmm3\n" : :);
+	__asm__ __volatile__("tileloadd (%0,%4,1), %%tmm4\n"
+			     "tileloadd (%1,%4,1), %%tmm5\n"
+			     "tileloadd (%2,%4,1), %%tmm6\n"
+			     "tileloadd (%3,%4,1), %%tmm7\n"
+		: : "r"(vecfreq_amx_data[0]), "r"(vecfreq_amx_data[1]),
+		    "r"(vecfreq_amx_data[2]), "r"(vecfreq_amx_data[3]),
+		    "r"(stride) : "memory");
+
+	for (i = 0; i < VECFREQ_LOOPS / 4; i++) {
+		__asm__ __volatile__("tdpbssd %%tmm6, %%tmm4, %%tmm0\n"
+				     "tdpbssd %%tmm7, %%tmm4, %%tmm1\n"
+				     "tdpbssd %%tmm6, %%tmm5, %%tmm2\n"
+				     "tdpbssd %%tmm7, %%tmm5, %%tmm3\n" : :);
+	}
+
+	__asm__ __volatile__("tilestored %%tmm0, (%0,%1,1)\n"
+		: : "r"(vecfreq_amx_result), "r"(stride) : "memory");
+	__asm__ __volatile__("tilerelease\n" : :);
+	stress_uint32_put((uint32_t)vecfreq_amx_result[0]);
+
+	return (uint64_t)(VECFREQ_LOOPS / 4) * 4;
+}
+#endif
+
+/*
+ *  stress_vecfreq_always()
+ *	tiers that run on any CPU
+ */
+static bool stress_vecfreq_always(void)
+{
+	return true;
+}
+
+#if defined(HAVE_VECFREQ_AVX2)
+static bool stress_vecfreq_avx2_supported(void)
+{
+	return stress_cpu_x86_has_avx2() && stress_cpu_x86_has_fma();
+}
+#endif
+
+/* ISA tiers, narrowest first */
+static const stress_vecfreq_tier_t vecfreq_tiers[] = {
+	{ "scalar",		stress_vecfreq_always,		stress_vecfreq_scalar },
+#if defined(HAVE_VECFREQ_SSE)
+	{ "sse",		stress_cpu_x86_has_sse2,	stress_vecfreq_sse },
+#endif
+#if defined(HAVE_VECFREQ_AVX2)
+	{ "avx2",		stress_vecfreq_avx2_supported,	stress_vecfreq_avx2 },
+#endif
+#if defined(HAVE_VECFREQ_AVX512)
+	{ "avx512-light",	stress_cpu_x86_has_avx512f,	stress_vecfreq_avx512_light },
+	{ "avx512-heavy",	stress_cpu_x86_has_avx512f,	stress_vecfreq_avx512_heavy },
+#endif
+#if defined(HAVE_VECFREQ_AMX)
+	{ "amx",		stress_vecfreq_amx_supported,	stress_vecfreq_amx },
+#endif
+};
+
+static int stress_set_vecfreq_dwell(const char *opt)
+{
+	uint32_t vecfreq_dwell;
+
+	vecfreq_dwell = stress_get_uint32(opt);
+	stress_check_range("vecfreq-dwell", (uint64_t)vecfreq_dwell,
+		MIN_VECFREQ_DWELL, MAX_VECFREQ_DWELL);
+	return stress_set_setting("vecfreq-dwell", TYPE_ID_UINT32, &vecfreq_dwell);
+}
+
+/*
+ *  stress_set_vecfreq_tier()
+ *	select a tier, 0 is all, tiers are index + 1
+ */
+static int stress_set_vecfreq_tier(const char *opt)
+{
+	size_t i;
+
+	if (!strcmp(opt, "all")) {
+		i = 0;
+		return stress_set_setting("vecfreq-tier", TYPE_ID_SIZE_T, &i);
+	}
+	for (i = 0; i < SIZEOF_ARRAY(vecfreq_tiers); i++) {
+		if (!strcmp(opt, vecfreq_tiers[i].name)) {
+			const size_t tier = i + 1;
+
+			return stress_set_setting("vecfreq-tier", TYPE_ID_SIZE_T, &tier);
+		}
+	}
+
+	(void)fprintf(stderr, "vecfreq-tier must be one of: all");
+	for (i = 0; i < SIZEOF_ARRAY(vecfreq_tiers); i++)
+		(void)fprintf(stderr, " %s", vecfreq_tiers[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_vecfreq_dwell,	stress_set_vecfreq_dwell },
+	{ OPT_vecfreq_tier,	stress_set_vecfreq_tier },
+	{ 0,			NULL }
+};
+
+/*
+ *  stress_vecfreq_sample()
+ *	sample the frequency of the CPU the stressor is running
+ *	on, fall back to the average of all the CPUs
+ */
+static void stress_vecfreq_sample(stress_vecfreq_stats_t *stats)
+{
+	double ghz = stress_get_cpu_ghz(stress_get_cpu());
+
+	if (ghz <= 0.0)
+		ghz = stress_get_cpu_ghz_average();
+	if (ghz <= 0.0)
+		return;
+	if ((stats->ghz_samples == 0) || (ghz < stats->ghz_min))
+		stats->ghz_min = ghz;
+	stats->ghz_sum += ghz;
+	stats->ghz_samples++;
+}
+
+/*
+ *  stress_vecfreq_dwell()
+ *	run a tier for dwell seconds, sampling the core frequency
+ *	every VECFREQ_SAMPLE seconds
+ */
+static void stress_vecfreq_dwell(
+	const stress_args_t *args,
+	const stress_vecfreq_tier_t *tier,
+	const double dwell,
+	stress_vecfreq_stats_t *stats)
+{
+	const double t_start = stress_time_now();
+	const double t_end = t_start + dwell;
+	double t, t_sample = t_start + VECFREQ_SAMPLE;
+	uint64_t instrs = 0;
+
+	do {
+		instrs += tier->func();
+		inc_counter(args);
+		t = stress_time_now();
+		if (t >= t_sample) {
+			stress_vecfreq_sample(stats);
+			t_sample += VECFREQ_SAMPLE;
+		}
+	} while ((t < t_end) && keep_stressing(args));
+
+	stats->instrs += instrs;
+	stats->duration += t - t_start;
+}
+
+/*
+ *  stress_vecfreq_report()
+ *	report instruction rate and core frequency per tier,
+ *	the frequency drop is relative to the scalar tier
+ */
+static void stress_vecfreq_report(
+	const stress_args_t *args,
+	const stress_vecfreq_stats_t *stats,
+	const bool verbose)
+{
+	const stress_vecfreq_stats_t *scalar = &stats[0];
+	const double scalar_ghz = scalar->ghz_samples ?
+		scalar->ghz_sum / (double)scalar->ghz_samples : 0.0;
+	double max_drop = 0.0;
+	size_t i, idx = 0;
+
+	if (verbose)
+		pr_inf("%s: tier          Ginstr/s  mean GHz   min GHz   GHz drop\n",
+			args->name);
+
+	for (i = 0; i < SIZEOF_ARRAY(vecfreq_tiers); i++) {
+		const stress_vecfreq_stats_t *s = &stats[i];
+		const double rate = (s->duration > 0.0) ?
+			((double)s->instrs / s->duration) / 1000000000.0 : 0.0;
+		const double ghz = s->ghz_samples ?
+			s->ghz_sum / (double)s->ghz_samples : 0.0;
+		double drop = 0.0;
+		char desc[32];
+
+		if (s->duration <= 0.0)
+			continue;
+		if ((scalar_ghz > 0.0) && (ghz > 0.0))
+			drop = 100.0 * (scalar_ghz - ghz) / scalar_ghz;
+		if (drop > max_drop)
+			max_drop = drop;
+
+		if (verbose) {
+			if (s->ghz_samples)
+				pr_inf("%s: %-12s %9.3f %9.3f %9.3f %9.2f%%\n",
+					args->name, vecfreq_tiers[i].name, rate,
+					ghz, s->ghz_min, drop);
+			else
+				pr_inf("%s: %-12s %9.3f %9s %9s %10s\n",
+					args->name, vecfreq_tiers[i].name, rate,
+					"n/a", "n/a", "n/a");
+		}
+
+		if (idx < STRESS_MISC_STATS_MAX - 1) {
+			(void)snprintf(desc, sizeof(desc), "%s Ginstr/s",
+				vecfreq_tiers[i].name);
+			stress_misc_stats_set(args->misc_stats, idx++, desc, rate);
+		}
+	}
+	if (scalar_ghz > 0.0)
+		stress_misc_stats_set(args->misc_stats, idx, "max GHz drop %", max_drop);
+}
+
+/*
+ *  stress_vecfreq()
+ *	stress the vector units at each ISA tier for a dwell time
+ */
+static int stress_vecfreq(const stress_args_t *args)
+{
+	stress_vecfreq_stats_t stats[SIZEOF_ARRAY(vecfreq_tiers)];
+	uint32_t vecfreq_dwell = DEFAULT_VECFREQ_DWELL;
+	size_t vecfreq_tier = 0;
+	bool supported[SIZEOF_ARRAY(vecfreq_tiers)];
+	size_t i, n_supported = 0;
+
+	(void)stress_get_setting("vecfreq-dwell", &vecfreq_dwell);
+	(void)stress_get_setting("vecfreq-tier", &vecfreq_tier);
+
+	(void)memset(stats, 0, sizeof(stats));
+	for (i = 0; i < SIZEOF_ARRAY(vecfreq_tiers); i++) {
+		supported[i] = ((vecfreq_tier == 0) || (vecfreq_tier == i + 1)) &&
+			vecfreq_tiers[i].supported();
+		if (supported[i])
+			n_supported++;
+		else if ((vecfreq_tier == i + 1) && (args->instance == 0))
+			pr_inf_skip("%s: tier %s is not supported by this CPU, "
+				"skipping stressor\n", args->name, vecfreq_tiers[i].name);
+	}
+	if (!n_supported)
+		return EXIT_NOT_IMPLEMENTED;
+
+	if (args->instance == 0) {
+		char tiers[128];
+
+		*tiers = '\0';
+		for (i = 0; i < SIZEOF_ARRAY(vecfreq_tiers); i++) {
+			if (supported[i]) {
+				(void)shim_strlcat(tiers, " ", sizeof(tiers));
+				(void)shim_strlcat(tiers, vecfreq_tiers[i].name, sizeof(tiers));
+			}
+		}
+		pr_dbg("%s: running tiers%s for %" PRIu32 " seconds each\n",
+			args->name, tiers, vecfreq_dwell);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < SIZEOF_ARRAY(vecfreq_tiers)); i++) {
+			if (supported[i])
+				stress_vecfreq_dwell(args, &vecfreq_tiers[i],
+					(double)vecfreq_dwell, &stats[i]);
+		}
+	} while (keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_vecfreq_report(args, stats, args->instance == 0);
+
+	return EXIT_SUCCESS;
+}
+
+stressor_info_t stress_vecfreq_info = {
+	.stressor = stress_vecfreq,
+	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
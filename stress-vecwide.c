@@ -18,6 +18,7 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-clock.h"
 #include "core-put.h"
 #include "core-target-clones.h"
 #include "core-vecmath.h"
@@ -166,12 +167,13 @@ static int stress_vecwide(const stress_args_t *args)
 
 	do {
 		for (i = 0; i < SIZEOF_ARRAY(stress_vecwide_funcs); i++) {
-			double t1, t2, dt;
+			uint64_t t1, t2;
+			double dt;
 
-			t1 = stress_time_now();
+			t1 = stress_clock_ns();
 			stress_vecwide_funcs[i].vecwide_func(vec_args);
-			t2 = stress_time_now();
-			dt = (t2 - t1);
+			t2 = stress_clock_ns();
+			dt = (double)stress_clock_delta_ns(t1, t2) * ONE_BILLIONTH;
 
 			total_duration += dt;
 			stress_vecwide_funcs[i].duration += dt;
@@ -29,11 +29,17 @@ UNEXPECTED
 #define MAX_VM_RW_BYTES		(MAX_MEM_LIMIT)
 #define DEFAULT_VM_RW_BYTES	(16 * MB)
 
+#define MIN_VM_RW_THREADS	(1)
+#define MAX_VM_RW_THREADS	(64)
+#define DEFAULT_VM_RW_THREADS	(4)
+
 static const stress_help_t help[] = {
-	{ NULL,	"vm-rw N",	 "start N vm read/write process_vm* copy workers" },
-	{ NULL,	"vm-rw-bytes N", "transfer N bytes of memory per bogo operation" },
-	{ NULL,	"vm-rw-ops N",	 "stop after N vm process_vm* copy bogo operations" },
-	{ NULL,	NULL,		 NULL }
+	{ NULL,	"vm-rw N",		"start N vm read/write process_vm* copy workers" },
+	{ NULL,	"vm-rw-bench",		"measure process_vm* bandwidth vs memcpy and vmsplice" },
+	{ NULL,	"vm-rw-bytes N",	"transfer N bytes of memory per bogo operation" },
+	{ NULL,	"vm-rw-ops N",		"stop after N vm process_vm* copy bogo operations" },
+	{ NULL,	"vm-rw-threads N",	"maximum concurrent copier threads for --vm-rw-bench" },
+	{ NULL,	NULL,			NULL }
 };
 
 #if defined(HAVE_PROCESS_VM_READV) &&	\
@@ -70,8 +76,25 @@ static int stress_set_vm_rw_bytes(const char *opt)
 	return stress_set_setting("vm-rw-bytes", TYPE_ID_SIZE_T, &vm_rw_bytes);
 }
 
+static int stress_set_vm_rw_bench(const char *opt)
+{
+	return stress_set_setting_true("vm-rw-bench", opt);
+}
+
+static int stress_set_vm_rw_threads(const char *opt)
+{
+	uint32_t vm_rw_threads;
+
+	vm_rw_threads = stress_get_uint32(opt);
+	stress_check_range("vm-rw-threads", (uint64_t)vm_rw_threads,
+		MIN_VM_RW_THREADS, MAX_VM_RW_THREADS);
+	return stress_set_setting("vm-rw-threads", TYPE_ID_UINT32, &vm_rw_threads);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_vm_rw_bench,	stress_set_vm_rw_bench },
 	{ OPT_vm_rw_bytes,	stress_set_vm_rw_bytes },
+	{ OPT_vm_rw_threads,	stress_set_vm_rw_threads },
 	{ 0,			NULL }
 };
 
@@ -352,6 +375,513 @@ fail:
 	return EXIT_SUCCESS;
 }
 
+#define VM_RW_BENCH_TIME	(0.1)		/* seconds per measurement */
+#define VM_RW_BENCH_IOV_MAX	(256)
+#define VM_RW_BENCH_MAX_POINTS	(8)
+#define VM_RW_BENCH_THREAD_SEG	(1 * MB)	/* segment size for thread sweep */
+
+static const size_t vm_rw_bench_segs[] = {
+	4 * KB, 64 * KB, 1 * MB
+};
+
+static const size_t vm_rw_bench_iovs[] = {
+	1, 16, VM_RW_BENCH_IOV_MAX
+};
+
+#define VM_RW_BENCH_SEGS	SIZEOF_ARRAY(vm_rw_bench_segs)
+#define VM_RW_BENCH_IOVS	SIZEOF_ARRAY(vm_rw_bench_iovs)
+
+enum {
+	VM_RW_BENCH_READV,
+	VM_RW_BENCH_WRITEV,
+	VM_RW_BENCH_MEMCPY,
+	VM_RW_BENCH_VMSPLICE,
+	VM_RW_BENCH_METHODS,
+};
+
+typedef struct {
+	double gb_rate;		/* GB per second, < 0 if not measured */
+	double usec_call;	/* microseconds per call */
+} stress_vm_rw_bench_cell_t;
+
+typedef struct {
+	stress_vm_rw_bench_cell_t sweep[VM_RW_BENCH_SEGS][VM_RW_BENCH_IOVS][2];
+	stress_vm_rw_bench_cell_t base[VM_RW_BENCH_SEGS][VM_RW_BENCH_METHODS];
+	uint32_t threads[VM_RW_BENCH_MAX_POINTS];
+	double thread_rate[VM_RW_BENCH_MAX_POINTS];
+	size_t n_points;
+} stress_vm_rw_bench_t;
+
+typedef struct {
+	const stress_args_t *args;
+	pid_t pid;		/* child owning the remote memory */
+	uint8_t *remote;	/* remote private region, same address in child */
+	uint8_t *shared;	/* region shared with the child */
+	size_t sz;		/* size of the regions */
+	int ctl[2];		/* vmsplice request pipe to child */
+	int data[2];		/* vmsplice data pipe from child */
+} stress_vm_rw_bench_ctxt_t;
+
+/*
+ *  stress_vm_rw_bench_child()
+ *	take private ownership of the remote region, signal ready and
+ *	then serve vmsplice requests until told to stop
+ */
+static void NORETURN stress_vm_rw_bench_child(const stress_vm_rw_bench_ctxt_t *ctxt)
+{
+	const uint8_t ready = 1;
+	size_t off = 0;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	(void)close(ctxt->ctl[1]);
+	(void)close(ctxt->data[0]);
+	/* break copy-on-write sharing so the pages are the child's own */
+	(void)memset(ctxt->remote, 0x5a, ctxt->sz);
+	if (write(ctxt->data[1], &ready, sizeof(ready)) != sizeof(ready))
+		_exit(EXIT_FAILURE);
+
+	for (;;) {
+		size_t len;
+
+		if (read(ctxt->ctl[0], &len, sizeof(len)) != sizeof(len) || (len == 0))
+			break;
+		if (off + len > ctxt->sz)
+			off = 0;
+#if defined(HAVE_VMSPLICE)
+		while (len > 0) {
+			struct iovec iov;
+			ssize_t ret;
+
+			iov.iov_base = ctxt->remote + off;
+			iov.iov_len = len;
+			ret = vmsplice(ctxt->data[1], &iov, 1, 0);
+			if (ret <= 0)
+				_exit(EXIT_FAILURE);
+			off += (size_t)ret;
+			len -= (size_t)ret;
+		}
+#else
+		_exit(EXIT_FAILURE);
+#endif
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_vm_rw_bench_copy()
+ *	one transfer of iov_count segments of seg bytes between the
+ *	local buffer and the child by the given method
+ */
+static ssize_t stress_vm_rw_bench_copy(
+	const stress_vm_rw_bench_ctxt_t *ctxt,
+	const int method,
+	uint8_t *local,
+	const size_t seg,
+	const size_t iov_count,
+	const size_t off)
+{
+	struct iovec local_iov[VM_RW_BENCH_IOV_MAX], remote_iov[VM_RW_BENCH_IOV_MAX];
+	const size_t len = seg * iov_count;
+	size_t i, got;
+
+	switch (method) {
+	case VM_RW_BENCH_READV:
+	case VM_RW_BENCH_WRITEV:
+		for (i = 0; i < iov_count; i++) {
+			local_iov[i].iov_base = local + (i * seg);
+			local_iov[i].iov_len = seg;
+			remote_iov[i].iov_base = ctxt->remote + off + (i * seg);
+			remote_iov[i].iov_len = seg;
+		}
+		if (method == VM_RW_BENCH_READV)
+			return process_vm_readv(ctxt->pid, local_iov, iov_count,
+				remote_iov, iov_count, 0);
+		return process_vm_writev(ctxt->pid, local_iov, iov_count,
+				remote_iov, iov_count, 0);
+	case VM_RW_BENCH_MEMCPY:
+		(void)memcpy(local, ctxt->shared + off, len);
+		return (ssize_t)len;
+	default:
+		if (write(ctxt->ctl[1], &len, sizeof(len)) != sizeof(len))
+			return -1;
+		for (got = 0; got < len; ) {
+			const ssize_t ret = read(ctxt->data[0], local + got, len - got);
+
+			if (ret <= 0)
+				return -1;
+			got += (size_t)ret;
+		}
+		return (ssize_t)len;
+	}
+}
+
+/*
+ *  stress_vm_rw_bench_rate()
+ *	measure bandwidth and time per call of a method for
+ *	VM_RW_BENCH_TIME seconds, walking through the regions
+ */
+static void stress_vm_rw_bench_rate(
+	const stress_vm_rw_bench_ctxt_t *ctxt,
+	const int method,
+	uint8_t *local,
+	const size_t seg,
+	const size_t iov_count,
+	stress_vm_rw_bench_cell_t *cell)
+{
+	const size_t len = seg * iov_count;
+	uint64_t calls = 0, bytes = 0;
+	size_t off = 0;
+	double t, dt;
+
+	cell->gb_rate = -1.0;
+	cell->usec_call = -1.0;
+	if (len > ctxt->sz)
+		return;
+
+	t = stress_time_now();
+	do {
+		const ssize_t ret = stress_vm_rw_bench_copy(ctxt, method, local,
+			seg, iov_count, off);
+
+		if (ret < 0)
+			return;
+		bytes += (uint64_t)ret;
+		calls++;
+		off += len;
+		if (off + len > ctxt->sz)
+			off = 0;
+		dt = stress_time_now() - t;
+	} while (keep_stressing(ctxt->args) && (dt < VM_RW_BENCH_TIME));
+
+	if ((dt > 0.0) && (calls > 0)) {
+		cell->gb_rate = (double)bytes / dt / (double)GB;
+		cell->usec_call = dt * 1000000.0 / (double)calls;
+	}
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_t pthread;
+	const stress_vm_rw_bench_ctxt_t *ctxt;
+	size_t off;		/* start of this thread's remote slice */
+	size_t len;		/* length of this thread's remote slice */
+	double rate;		/* GB per second, < 0 on failure */
+} stress_vm_rw_bench_thread_t;
+
+/*
+ *  stress_vm_rw_bench_thread()
+ *	process_vm_readv this thread's slice of the remote region
+ */
+static void *stress_vm_rw_bench_thread(void *arg)
+{
+	stress_vm_rw_bench_thread_t *t = (stress_vm_rw_bench_thread_t *)arg;
+	const size_t seg = STRESS_MINIMUM(t->len, VM_RW_BENCH_THREAD_SEG);
+	uint64_t bytes = 0;
+	size_t off = 0;
+	uint8_t *local;
+	double t_start, dt;
+
+	t->rate = -1.0;
+	local = (uint8_t *)mmap(NULL, seg, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (local == MAP_FAILED)
+		return NULL;
+
+	t_start = stress_time_now();
+	do {
+		struct iovec local_iov, remote_iov;
+		ssize_t ret;
+
+		local_iov.iov_base = local;
+		local_iov.iov_len = seg;
+		remote_iov.iov_base = t->ctxt->remote + t->off + off;
+		remote_iov.iov_len = seg;
+		ret = process_vm_readv(t->ctxt->pid, &local_iov, 1, &remote_iov, 1, 0);
+		if (ret < 0)
+			goto unmap;
+		bytes += (uint64_t)ret;
+		off += seg;
+		if (off + seg > t->len)
+			off = 0;
+		dt = stress_time_now() - t_start;
+	} while (keep_stressing(t->ctxt->args) && (dt < VM_RW_BENCH_TIME * 2));
+
+	if (dt > 0.0)
+		t->rate = (double)bytes / dt / (double)GB;
+unmap:
+	(void)munmap((void *)local, seg);
+	return NULL;
+}
+
+/*
+ *  stress_vm_rw_bench_threads()
+ *	aggregate GB per second of n threads reading disjoint slices
+ */
+static double stress_vm_rw_bench_threads(
+	const stress_vm_rw_bench_ctxt_t *ctxt,
+	const uint32_t n)
+{
+	static stress_vm_rw_bench_thread_t threads[MAX_VM_RW_THREADS];
+	const size_t slice = (ctxt->sz / n) & ~(ctxt->args->page_size - 1);
+	double rate = 0.0;
+	uint32_t i, started;
+	bool ok = true;
+
+	if (slice == 0)
+		return -1.0;
+	for (started = 0; started < n; started++) {
+		threads[started].ctxt = ctxt;
+		threads[started].off = started * slice;
+		threads[started].len = slice;
+		if (pthread_create(&threads[started].pthread, NULL,
+				stress_vm_rw_bench_thread, &threads[started]) != 0) {
+			ok = false;
+			break;
+		}
+	}
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		if (threads[i].rate < 0.0)
+			ok = false;
+		rate += threads[i].rate;
+	}
+	return ok ? rate : -1.0;
+}
+#endif
+
+static void stress_vm_rw_bench_str(
+	char *str,
+	const size_t len,
+	const stress_vm_rw_bench_cell_t *cell)
+{
+	const size_t n = strlen(str);
+
+	if (cell->gb_rate < 0.0)
+		(void)snprintf(str + n, len - n, " %8s %9s", "-", "-");
+	else
+		(void)snprintf(str + n, len - n, " %8.2f %9.2f", cell->gb_rate, cell->usec_call);
+}
+
+/*
+ *  stress_vm_rw_bench()
+ *	measure process_vm_readv/writev bandwidth and per call cost over
+ *	segment sizes and iovec counts, compare with shared memory memcpy
+ *	and pipe + vmsplice, then scale with concurrent reader threads
+ */
+static int stress_vm_rw_bench(const stress_args_t *args, const size_t sz)
+{
+	static stress_vm_rw_bench_t pass, res;
+	static const char * const method_names[] = {
+		"readv", "writev", "memcpy", "vmsplice"
+	};
+	stress_vm_rw_bench_ctxt_t ctxt;
+	uint32_t vm_rw_threads = DEFAULT_VM_RW_THREADS, t;
+	uint8_t *local;
+	uint8_t ready;
+	size_t s, v, p;
+	int m, status, rc = EXIT_SUCCESS;
+	bool done = false;
+
+	(void)stress_get_setting("vm-rw-threads", &vm_rw_threads);
+
+	(void)memset(&ctxt, 0, sizeof(ctxt));
+	ctxt.args = args;
+	ctxt.sz = sz;
+	ctxt.remote = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ctxt.shared = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	local = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((ctxt.remote == MAP_FAILED) || (ctxt.shared == MAP_FAILED) || (local == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot mmap %zu byte buffers, skipping stressor\n",
+			args->name, sz);
+		rc = EXIT_NO_RESOURCE;
+		goto unmap;
+	}
+	(void)memset(ctxt.shared, 0xa5, sz);
+	(void)memset(local, 0, sz);
+
+	if (pipe(ctxt.ctl) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto unmap;
+	}
+	if (pipe(ctxt.data) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(ctxt.ctl[0]);
+		(void)close(ctxt.ctl[1]);
+		rc = EXIT_NO_RESOURCE;
+		goto unmap;
+	}
+#if defined(F_SETPIPE_SZ)
+	(void)fcntl(ctxt.data[1], F_SETPIPE_SZ, (int)(1 * MB));
+#endif
+
+again:
+	ctxt.pid = fork();
+	if (ctxt.pid < 0) {
+		if (stress_redo_fork(errno))
+			goto again;
+		if (keep_stressing(args))
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		rc = keep_stressing(args) ? EXIT_FAILURE : EXIT_SUCCESS;
+		goto close_pipes;
+	} else if (ctxt.pid == 0) {
+		stress_vm_rw_bench_child(&ctxt);
+	}
+	(void)close(ctxt.ctl[0]);
+	(void)close(ctxt.data[1]);
+	ctxt.ctl[0] = -1;
+	ctxt.data[1] = -1;
+	if (read(ctxt.data[0], &ready, sizeof(ready)) != sizeof(ready)) {
+		pr_fail("%s: child failed to start\n", args->name);
+		rc = EXIT_FAILURE;
+		goto reap;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		(void)memset(&pass, 0, sizeof(pass));
+		for (s = 0; s < VM_RW_BENCH_SEGS; s++) {
+			for (v = 0; v < VM_RW_BENCH_IOVS; v++) {
+				for (m = VM_RW_BENCH_READV; m <= VM_RW_BENCH_WRITEV; m++) {
+					stress_vm_rw_bench_rate(&ctxt, m, local, vm_rw_bench_segs[s],
+						vm_rw_bench_iovs[v], &pass.sweep[s][v][m]);
+				}
+			}
+			for (m = 0; m < VM_RW_BENCH_METHODS; m++) {
+#if !defined(HAVE_VMSPLICE)
+				if (m == VM_RW_BENCH_VMSPLICE) {
+					pass.base[s][m].gb_rate = -1.0;
+					continue;
+				}
+#endif
+				stress_vm_rw_bench_rate(&ctxt, m, local, vm_rw_bench_segs[s],
+					1, &pass.base[s][m]);
+			}
+		}
+		for (t = 1; (t < vm_rw_threads) && (pass.n_points < VM_RW_BENCH_MAX_POINTS - 1); t <<= 1)
+			pass.threads[pass.n_points++] = t;
+		pass.threads[pass.n_points++] = vm_rw_threads;
+		for (p = 0; p < pass.n_points; p++) {
+#if defined(HAVE_LIB_PTHREAD)
+			pass.thread_rate[p] = keep_stressing(args) ?
+				stress_vm_rw_bench_threads(&ctxt, pass.threads[p]) : -1.0;
+#else
+			pass.thread_rate[p] = -1.0;
+#endif
+		}
+		if (!keep_stressing(args))
+			break;
+		(void)memcpy(&res, &pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		char str[128], sz_str[16];
+
+		pr_inf("%s: process_vm_readv/writev GB/sec and usec per call, "
+			"%d MB remote region\n", args->name, (int)(sz / MB));
+		pr_inf("%s: %7s %4s %8s %9s %8s %9s\n", args->name,
+			"segment", "iovs", "rd GB/s", "rd us", "wr GB/s", "wr us");
+		for (s = 0; s < VM_RW_BENCH_SEGS; s++) {
+			for (v = 0; v < VM_RW_BENCH_IOVS; v++) {
+				(void)snprintf(str, sizeof(str), "%7s %4zu",
+					stress_uint64_to_str(sz_str, sizeof(sz_str),
+						(uint64_t)vm_rw_bench_segs[s]),
+					vm_rw_bench_iovs[v]);
+				for (m = VM_RW_BENCH_READV; m <= VM_RW_BENCH_WRITEV; m++)
+					stress_vm_rw_bench_str(str, sizeof(str), &res.sweep[s][v][m]);
+				pr_inf("%s: %s\n", args->name, str);
+			}
+		}
+		(void)snprintf(str, sizeof(str), "%7s", "chunk");
+		for (m = 0; m < VM_RW_BENCH_METHODS; m++) {
+			const size_t n = strlen(str);
+
+			(void)snprintf(str + n, sizeof(str) - n, " %8.8s %9s",
+				method_names[m], "us");
+		}
+		pr_inf("%s: single chunk GB/sec and usec per call, readv and writev "
+			"vs shared memory memcpy and pipe + vmsplice\n", args->name);
+		pr_inf("%s: %s\n", args->name, str);
+		for (s = 0; s < VM_RW_BENCH_SEGS; s++) {
+			(void)snprintf(str, sizeof(str), "%7s",
+				stress_uint64_to_str(sz_str, sizeof(sz_str),
+					(uint64_t)vm_rw_bench_segs[s]));
+			for (m = 0; m < VM_RW_BENCH_METHODS; m++)
+				stress_vm_rw_bench_str(str, sizeof(str), &res.base[s][m]);
+			pr_inf("%s: %s\n", args->name, str);
+		}
+#if defined(HAVE_LIB_PTHREAD)
+		pr_inf("%s: concurrent process_vm_readv threads, %d KB segments\n",
+			args->name, (int)(VM_RW_BENCH_THREAD_SEG / KB));
+		pr_inf("%s: %7s %8s %8s\n", args->name, "threads", "GB/sec", "speedup");
+		for (p = 0; p < res.n_points; p++) {
+			if ((res.thread_rate[p] < 0.0) || (res.thread_rate[0] <= 0.0)) {
+				pr_inf("%s: %7" PRIu32 " %8s %8s\n", args->name,
+					res.threads[p], "-", "-");
+				continue;
+			}
+			pr_inf("%s: %7" PRIu32 " %8.2f %7.2fx\n", args->name,
+				res.threads[p], res.thread_rate[p],
+				res.thread_rate[p] / res.thread_rate[0]);
+		}
+#endif
+	}
+	if (done) {
+		/* 1 MB chunks and 4K single segment call overhead */
+		s = VM_RW_BENCH_SEGS - 1;
+		for (m = 0; m < VM_RW_BENCH_METHODS; m++) {
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s 1M GB/sec", method_names[m]);
+			stress_misc_stats_set(args->misc_stats, m, str,
+				STRESS_MAXIMUM(res.base[s][m].gb_rate, 0.0));
+		}
+		stress_misc_stats_set(args->misc_stats, VM_RW_BENCH_METHODS,
+			"readv 4K usec per call", STRESS_MAXIMUM(res.base[0][VM_RW_BENCH_READV].usec_call, 0.0));
+		stress_misc_stats_set(args->misc_stats, VM_RW_BENCH_METHODS + 1,
+			"writev 4K usec per call", STRESS_MAXIMUM(res.base[0][VM_RW_BENCH_WRITEV].usec_call, 0.0));
+		stress_misc_stats_set(args->misc_stats, VM_RW_BENCH_METHODS + 2,
+			"readv threads GB/sec", STRESS_MAXIMUM(res.thread_rate[res.n_points - 1], 0.0));
+	}
+
+reap:
+	(void)close(ctxt.ctl[1]);
+	ctxt.ctl[1] = -1;
+	if (shim_waitpid(ctxt.pid, &status, 0) < 0) {
+		(void)kill(ctxt.pid, SIGKILL);
+		(void)shim_waitpid(ctxt.pid, &status, 0);
+	}
+close_pipes:
+	for (m = 0; m < 2; m++) {
+		if (ctxt.ctl[m] >= 0)
+			(void)close(ctxt.ctl[m]);
+		if (ctxt.data[m] >= 0)
+			(void)close(ctxt.data[m]);
+	}
+unmap:
+	if (local != MAP_FAILED)
+		(void)munmap((void *)local, sz);
+	if (ctxt.shared != MAP_FAILED)
+		(void)munmap((void *)ctxt.shared, sz);
+	if (ctxt.remote != MAP_FAILED)
+		(void)munmap((void *)ctxt.remote, sz);
+
+	return rc;
+}
+
 /*
  *  stress_vm_rw
  *	stress vm_read_v/vm_write_v
@@ -363,7 +893,9 @@ static int stress_vm_rw(const stress_args_t *args)
 	uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)stack, STACK_SIZE);
 	size_t vm_rw_bytes = DEFAULT_VM_RW_BYTES;
 	int rc;
+	bool vm_rw_bench = false;
 
+	(void)stress_get_setting("vm-rw-bench", &vm_rw_bench);
 	if (!stress_get_setting("vm-rw-bytes", &vm_rw_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			vm_rw_bytes = MAX_32;
@@ -377,6 +909,8 @@ static int stress_vm_rw(const stress_args_t *args)
 		vm_rw_bytes = args->page_size;
 	ctxt.args = args;
 	ctxt.sz = vm_rw_bytes & ~(args->page_size - 1);
+	if (vm_rw_bench)
+		return stress_vm_rw_bench(args, ctxt.sz);
 	ctxt.iov_count = (ctxt.sz + CHUNK_SIZE - 1) / CHUNK_SIZE;
 
 	if (pipe(ctxt.pipe_wr) < 0) {
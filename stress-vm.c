@@ -22,12 +22,17 @@
 #include "core-target-clones.h"
 #include "core-nt-load.h"
 #include "core-nt-store.h"
+#include "core-pagemap.h"
 #include "core-vecmath.h"
 
 #define MIN_VM_BYTES		(4 * KB)
 #define MAX_VM_BYTES		(MAX_MEM_LIMIT)
 #define DEFAULT_VM_BYTES	(256 * MB)
 
+#define MIN_VM_PREFAULT		(0)
+#define MAX_VM_PREFAULT		(256)
+#define DEFAULT_VM_PREFAULT	(1)
+
 #define MIN_VM_HANG		(0)
 #define MAX_VM_HANG		(3600)
 #define DEFAULT_VM_HANG		(~0ULL)
@@ -40,6 +45,14 @@
 
 #define VM_BOGO_SHIFT		(12)
 #define VM_ROWHAMMER_LOOPS	(1000000)
+#define MIN_VM_ROWHAMMER_SIDES	(2)
+#define MAX_VM_ROWHAMMER_SIDES	(32)
+#define MIN_VM_ROWHAMMER_STRIDE	(1 * KB)
+#define MAX_VM_ROWHAMMER_STRIDE	(64 * MB)
+#define DEFAULT_VM_ROWHAMMER_STRIDE (128 * KB)	/* 8K rows x 16 banks */
+#define VM_ROWHAMMER_BASE_TRIES	(32)		/* tries for contiguous rows */
+#define VM_ROWHAMMER_FLIPS_LOG	(16)		/* flips logged per hammer */
+#define VM_REFRESH_WINDOW	(0.064)		/* DRAM refresh window, secs */
 
 #define NO_MEM_RETRIES_MAX	(100)
 
@@ -59,13 +72,52 @@ typedef struct {
 	const int advice;
 } stress_vm_madvise_info_t;
 
+/* per method memory traffic and timing */
+typedef struct {
+	uint64_t bytes_read;		/* bytes read by the method */
+	uint64_t bytes_written;		/* bytes written by the method */
+	uint64_t counter;		/* bogo counter, before VM_BOGO_SHIFT */
+	double duration;		/* time spent in the method */
+} stress_vm_method_stats_t;
+
+/* page population (prefault) traffic and timing */
+typedef struct {
+	uint64_t bytes;			/* bytes prefaulted */
+	double duration;		/* time spent mapping and prefaulting */
+} stress_vm_prefault_stats_t;
+
+/* a prefault thread's part of the mapping */
+typedef struct {
+	uint8_t *addr;			/* start of the region */
+	size_t size;			/* size of the region in bytes */
+	size_t page_size;		/* page size */
+} stress_vm_prefault_t;
+
+/* rowhammer activation rate and flips */
+typedef struct {
+	uint64_t activations;		/* uncached aggressor row reads */
+	uint64_t flips;			/* bit flips found */
+	double duration;		/* time spent hammering */
+	uint32_t sides;			/* aggressor rows, 0 = random pair */
+	bool phys_rows;			/* rows checked physically contiguous */
+} stress_vm_rowhammer_stats_t;
+
 typedef struct {
 	uint64_t *bit_error_count;
+	stress_vm_method_stats_t *method_stats;
+	stress_vm_prefault_stats_t *prefault_stats;
+	stress_vm_rowhammer_stats_t *rowhammer_stats;
 	const stress_vm_method_info_t *vm_method;
 } stress_vm_context_t;
 
 static const stress_vm_method_info_t vm_methods[];
 
+static uint64_t vm_bytes_read;		/* bytes read by the current method */
+static uint64_t vm_bytes_written;	/* bytes written by the current method */
+static size_t vm_method_index;		/* index of the current method */
+static stress_vm_rowhammer_stats_t *vm_rowhammer_stats;	/* shared rowhammer stats */
+static int vm_pagemap_fd = -1;		/* /proc/self/pagemap, rowhammer */
+
 static const stress_help_t help[] = {
 	{ "m N", "vm N",	 "start N workers spinning on anonymous mmap" },
 	{ NULL,	 "vm-bytes N",	 "allocate N bytes per vm worker (default 256MB)" },
@@ -80,6 +132,9 @@ static const stress_help_t help[] = {
 #if defined(MAP_POPULATE)
 	{ NULL,	 "vm-populate",	 "populate (prefault) page tables for a mapping" },
 #endif
+	{ NULL,	 "vm-prefault N", "prefault new mappings using N threads (0 = off)" },
+	{ NULL,	 "vm-rowhammer-sides N", "rowhammer N aggressor rows (2 = double-sided)" },
+	{ NULL,	 "vm-rowhammer-row-stride N", "bytes between adjacent rows in a bank" },
 	{ NULL,	 NULL,		 NULL }
 };
 
@@ -182,6 +237,36 @@ static int stress_set_vm_mmap_populate(const char *opt)
 #endif
 }
 
+static int stress_set_vm_prefault(const char *opt)
+{
+	uint32_t vm_prefault;
+
+	vm_prefault = stress_get_uint32(opt);
+	stress_check_range("vm-prefault", (uint64_t)vm_prefault,
+		MIN_VM_PREFAULT, MAX_VM_PREFAULT);
+	return stress_set_setting("vm-prefault", TYPE_ID_UINT32, &vm_prefault);
+}
+
+static int stress_set_vm_rowhammer_sides(const char *opt)
+{
+	uint32_t vm_rowhammer_sides;
+
+	vm_rowhammer_sides = stress_get_uint32(opt);
+	stress_check_range("vm-rowhammer-sides", (uint64_t)vm_rowhammer_sides,
+		MIN_VM_ROWHAMMER_SIDES, MAX_VM_ROWHAMMER_SIDES);
+	return stress_set_setting("vm-rowhammer-sides", TYPE_ID_UINT32, &vm_rowhammer_sides);
+}
+
+static int stress_set_vm_rowhammer_row_stride(const char *opt)
+{
+	size_t vm_rowhammer_row_stride;
+
+	vm_rowhammer_row_stride = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("vm-rowhammer-row-stride", vm_rowhammer_row_stride,
+		MIN_VM_ROWHAMMER_STRIDE, MAX_VM_ROWHAMMER_STRIDE);
+	return stress_set_setting("vm-rowhammer-row-stride", TYPE_ID_SIZE_T, &vm_rowhammer_row_stride);
+}
+
 static int stress_set_vm_madvise(const char *opt)
 {
 	const stress_vm_madvise_info_t *info;
@@ -295,6 +380,16 @@ static void stress_vm_check(const char *name, const size_t bit_errors)
 #endif
 }
 
+/*
+ *  stress_vm_bytes()
+ *	account memory read and written by a method
+ */
+static inline void stress_vm_bytes(const uint64_t rd, const uint64_t wr)
+{
+	vm_bytes_read += rd;
+	vm_bytes_written += wr;
+}
+
 /*
  *  stress_vm_count_bits8()
  *	count number of bits set (K and R)
@@ -349,6 +444,7 @@ static size_t TARGET_CLONES stress_vm_moving_inversion(
 	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ) {
 		*(ptr++) = stress_mwc64();
 	}
+	stress_vm_bytes(0, sz);
 
 	stress_mwc_set_seed(w, z);
 	for (bit_errors = 0, ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ) {
@@ -359,6 +455,7 @@ static size_t TARGET_CLONES stress_vm_moving_inversion(
 		*(ptr++) = ~val;
 		c++;
 	}
+	stress_vm_bytes(sz, sz);
 	if (UNLIKELY(max_ops && c >= max_ops))
 		goto ret;
 	if (UNLIKELY(!keep_stressing_flag()))
@@ -376,6 +473,7 @@ static size_t TARGET_CLONES stress_vm_moving_inversion(
 			bit_errors++;
 		c++;
 	}
+	stress_vm_bytes(sz, 0);
 	if (UNLIKELY(max_ops && c >= max_ops))
 		goto ret;
 	if (UNLIKELY(!keep_stressing_flag()))
@@ -385,6 +483,7 @@ static size_t TARGET_CLONES stress_vm_moving_inversion(
 	for (ptr = (uint64_t *)buf_end; ptr > (uint64_t *)buf; ) {
 		*--ptr = stress_mwc64();
 	}
+	stress_vm_bytes(0, sz);
 	if (UNLIKELY(!keep_stressing_flag()))
 		goto ret;
 
@@ -400,6 +499,7 @@ static size_t TARGET_CLONES stress_vm_moving_inversion(
 		*ptr = ~val;
 		c++;
 	}
+	stress_vm_bytes(sz, sz);
 	if (UNLIKELY(max_ops && c >= max_ops))
 		goto ret;
 	if (UNLIKELY(!keep_stressing_flag()))
@@ -413,6 +513,7 @@ static size_t TARGET_CLONES stress_vm_moving_inversion(
 			bit_errors++;
 		c++;
 	}
+	stress_vm_bytes(sz, 0);
 	if (UNLIKELY(max_ops && c >= max_ops))
 		goto ret;
 	if (UNLIKELY(!keep_stressing_flag()))
@@ -478,6 +579,7 @@ static size_t TARGET_CLONES stress_vm_modulo_x(
 			if (UNLIKELY(*ptr != pattern))
 				bit_errors++;
 		}
+		stress_vm_bytes(sz / stride, sz);
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 		if (UNLIKELY(max_ops && c >= max_ops))
@@ -526,6 +628,8 @@ static size_t TARGET_CLONES stress_vm_walking_one_data(
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
+	stress_vm_bytes(8 * (uint64_t)((uint8_t *)ptr - (uint8_t *)buf),
+			8 * (uint64_t)((uint8_t *)ptr - (uint8_t *)buf));
 	stress_vm_check("walking one (data)", bit_errors);
 	set_counter(args, c);
 
@@ -565,6 +669,8 @@ static size_t TARGET_CLONES stress_vm_walking_zero_data(
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
+	stress_vm_bytes(8 * (uint64_t)((uint8_t *)ptr - (uint8_t *)buf),
+			8 * (uint64_t)((uint8_t *)ptr - (uint8_t *)buf));
 	stress_vm_check("walking zero (data)", bit_errors);
 	set_counter(args, c);
 
@@ -586,7 +692,7 @@ static size_t TARGET_CLONES stress_vm_walking_one_addr(
 {
 	volatile uint8_t *ptr;
 	uint8_t d1 = 0, d2 = ~d1;
-	size_t bit_errors = 0;
+	size_t bit_errors = 0, n = 0;
 	uint64_t c = get_counter(args);
 
 	(void)memset(buf, d1, sz);
@@ -604,6 +710,7 @@ static size_t TARGET_CLONES stress_vm_walking_one_addr(
 			if (UNLIKELY(*ptr != d1)) /* cppcheck-suppress knownConditionTrueFalse */
 				bit_errors++;
 			mask <<= 1;
+			n++;
 		}
 		c++;
 		if (UNLIKELY(max_ops && c >= max_ops))
@@ -611,6 +718,8 @@ static size_t TARGET_CLONES stress_vm_walking_one_addr(
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
+	/* memset, then a byte write per address line and a byte read back */
+	stress_vm_bytes(n, sz + n + (((uint8_t *)ptr - (uint8_t *)buf) / 256));
 	stress_vm_check("walking one (address)", bit_errors);
 	set_counter(args, c);
 
@@ -632,7 +741,7 @@ static size_t TARGET_CLONES stress_vm_walking_zero_addr(
 {
 	volatile uint8_t *ptr;
 	uint8_t d1 = 0, d2 = ~d1;
-	size_t bit_errors = 0;
+	size_t bit_errors = 0, n = 0;
 	uint64_t sz_mask;
 	uint64_t c = get_counter(args);
 
@@ -656,6 +765,7 @@ static size_t TARGET_CLONES stress_vm_walking_zero_addr(
 			if (UNLIKELY(*ptr != d1)) /* cppcheck-suppress knownConditionTrueFalse */
 				bit_errors++;
 			mask <<= 1;
+			n++;
 		}
 		c++;
 		if (UNLIKELY(max_ops && c >= max_ops))
@@ -663,6 +773,8 @@ static size_t TARGET_CLONES stress_vm_walking_zero_addr(
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
+	/* memset, then a byte write per address line and a byte read back */
+	stress_vm_bytes(n, sz + n + (((uint8_t *)ptr - (uint8_t *)buf) / 256));
 	stress_vm_check("walking zero (address)", bit_errors);
 	set_counter(args, c);
 
@@ -694,6 +806,7 @@ static size_t TARGET_CLONES stress_vm_gray(
 			return 0;
 		*ptr = (v >> 1) ^ v;
 	}
+	stress_vm_bytes(0, sz);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
@@ -707,6 +820,7 @@ static size_t TARGET_CLONES stress_vm_gray(
 			break;
 	}
 	val++;
+	stress_vm_bytes((uint64_t)((uint8_t *)ptr - (uint8_t *)buf), 0);
 
 	stress_vm_check("gray code", bit_errors);
 	set_counter(args, c);
@@ -744,6 +858,7 @@ static size_t TARGET_CLONES stress_vm_grayflip(
 		gray = ~gray;
 		*ptr++ = gray;
 	}
+	stress_vm_bytes(0, sz);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
@@ -765,6 +880,7 @@ static size_t TARGET_CLONES stress_vm_grayflip(
 			break;
 	}
 	val++;
+	stress_vm_bytes((uint64_t)((uint8_t *)ptr - (uint8_t *)buf), 0);
 
 	stress_vm_check("gray code", bit_errors);
 	set_counter(args, c);
@@ -804,6 +920,7 @@ static size_t TARGET_CLONES stress_vm_incdec(
 		*ptr -= val;
 	}
 	c += sz;
+	stress_vm_bytes(2 * (uint64_t)sz, 3 * (uint64_t)sz);
 	if (UNLIKELY(max_ops && c >= max_ops))
 		c = max_ops;
 
@@ -811,6 +928,7 @@ static size_t TARGET_CLONES stress_vm_incdec(
 		if (UNLIKELY(*ptr != 0))
 			bit_errors++;
 	}
+	stress_vm_bytes(sz, 0);
 
 	stress_vm_check("incdec code", bit_errors);
 	set_counter(args, c);
@@ -851,6 +969,7 @@ static size_t TARGET_CLONES stress_vm_prime_incdec(
 		if (UNLIKELY(max_ops && c >= max_ops))
 			return 0;
 	}
+	stress_vm_bytes(sz, 2 * (uint64_t)sz);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 	/*
@@ -864,11 +983,13 @@ static size_t TARGET_CLONES stress_vm_prime_incdec(
 		if (UNLIKELY(max_ops && c >= max_ops))
 			return 0;
 	}
+	stress_vm_bytes(sz, sz);
 
 	for (ptr = (uint8_t *)buf; ptr < (uint8_t *)buf_end; ptr++) {
 		if (UNLIKELY(*ptr != 0))
 			bit_errors++;
 	}
+	stress_vm_bytes(sz, 0);
 
 	stress_vm_check("prime-incdec", bit_errors);
 	set_counter(args, c);
@@ -913,6 +1034,7 @@ static size_t TARGET_CLONES stress_vm_swap(
 		uint8_t val = stress_mwc8();
 		(void)memset((void *)ptr, val, chunk_sz);
 	}
+	stress_vm_bytes(0, sz);
 
 	/* Forward swaps */
 	for (i = 0, ptr = (uint8_t *)buf; ptr < (uint8_t *)buf_end; ptr += chunk_sz, i++) {
@@ -927,6 +1049,7 @@ static size_t TARGET_CLONES stress_vm_swap(
 			*src++ = *dst;
 			*dst++ = tmp;
 		}
+		stress_vm_bytes(2 * chunk_sz, 2 * chunk_sz);
 		c++;
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
@@ -946,6 +1069,7 @@ static size_t TARGET_CLONES stress_vm_swap(
 			*src++ = *dst;
 			*dst++ = tmp;
 		}
+		stress_vm_bytes(2 * chunk_sz, 2 * chunk_sz);
 		c++;
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
@@ -967,6 +1091,7 @@ static size_t TARGET_CLONES stress_vm_swap(
 				bit_errors++;
 			p++;
 		}
+		stress_vm_bytes(chunk_sz, 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
@@ -1013,6 +1138,7 @@ static size_t TARGET_CLONES stress_vm_rand_set(
 		*(ptr + 6) = val;
 		*(ptr + 7) = val;
 		c++;
+		stress_vm_bytes(0, chunk_sz);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1034,6 +1160,7 @@ static size_t TARGET_CLONES stress_vm_rand_set(
 		bit_errors += (*(ptr + 5) != val);
 		bit_errors += (*(ptr + 6) != val);
 		bit_errors += (*(ptr + 7) != val);
+		stress_vm_bytes(chunk_sz, 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
@@ -1081,6 +1208,7 @@ static size_t TARGET_CLONES stress_vm_ror(
 		*(ptr + 6) = val;
 		*(ptr + 7) = val;
 		c++;
+		stress_vm_bytes(0, chunk_sz);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1099,6 +1227,7 @@ static size_t TARGET_CLONES stress_vm_ror(
 		ROR8(*(ptr + 7));
 
 		c++;
+		stress_vm_bytes(chunk_sz, chunk_sz);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1121,6 +1250,7 @@ static size_t TARGET_CLONES stress_vm_ror(
 		bit_errors += (*(ptr + 5) != val);
 		bit_errors += (*(ptr + 6) != val);
 		bit_errors += (*(ptr + 7) != val);
+		stress_vm_bytes(chunk_sz, 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
@@ -1176,6 +1306,7 @@ static size_t TARGET_CLONES stress_vm_flip(
 		ROR8(val);
 		*(ptr + 7) = val;
 		c++;
+		stress_vm_bytes(0, chunk_sz);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1195,6 +1326,7 @@ static size_t TARGET_CLONES stress_vm_flip(
 			*(ptr + 6) ^= bit;
 			*(ptr + 7) ^= bit;
 			c++;
+			stress_vm_bytes(chunk_sz, chunk_sz);
 			if (UNLIKELY(max_ops && c >= max_ops))
 				goto abort;
 			if (UNLIKELY(!keep_stressing_flag()))
@@ -1224,6 +1356,7 @@ static size_t TARGET_CLONES stress_vm_flip(
 		bit_errors += (*(ptr + 6) != val);
 		ROR8(val);
 		bit_errors += (*(ptr + 7) != val);
+		stress_vm_bytes(chunk_sz, 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
@@ -1257,6 +1390,7 @@ static size_t TARGET_CLONES stress_vm_zero_one(
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 	c += sz / 8;
+	stress_vm_bytes(sz, sz);
 
 	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
 		bit_errors += stress_vm_count_bits(*(ptr + 0));
@@ -1276,6 +1410,7 @@ static size_t TARGET_CLONES stress_vm_zero_one(
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 	c += sz / 8;
+	stress_vm_bytes(sz, sz);
 
 	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
 		bit_errors += stress_vm_count_bits(~*(ptr + 0));
@@ -1317,6 +1452,7 @@ static size_t TARGET_CLONES stress_vm_galpat_zero(
 
 	(void)memset(buf, 0x00, sz);
 
+	stress_vm_bytes(0, sz);
 	stress_mwc_reseed();
 
 	for (i = 0; i < bits_bad; i++) {
@@ -1345,6 +1481,7 @@ static size_t TARGET_CLONES stress_vm_galpat_zero(
 		bits_set += stress_vm_count_bits(*(ptr + 7));
 
 		c++;
+		stress_vm_bytes(8 * sizeof(*ptr), 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			goto ret;
 	}
@@ -1381,6 +1518,7 @@ static size_t TARGET_CLONES stress_vm_galpat_one(
 
 	(void)memset(buf, 0xff, sz);
 
+	stress_vm_bytes(0, sz);
 	stress_mwc_reseed();
 
 	for (i = 0; i < bits_bad; i++) {
@@ -1409,6 +1547,7 @@ static size_t TARGET_CLONES stress_vm_galpat_one(
 		bits_set += stress_vm_count_bits(~(*(ptr + 7)));
 
 		c++;
+		stress_vm_bytes(8 * sizeof(*ptr), 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			goto ret;
 	}
@@ -1443,6 +1582,7 @@ static size_t TARGET_CLONES stress_vm_inc_nybble(
 	uint64_t c = get_counter(args);
 
 	(void)memset(buf, val, sz);
+	stress_vm_bytes(0, sz);
 	INC_LO_NYBBLE(val);
 	INC_HI_NYBBLE(val);
 
@@ -1457,6 +1597,7 @@ static size_t TARGET_CLONES stress_vm_inc_nybble(
 		INC_LO_NYBBLE(*(ptr + 6));
 		INC_LO_NYBBLE(*(ptr + 7));
 		c++;
+		stress_vm_bytes(8, 8);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1473,6 +1614,7 @@ static size_t TARGET_CLONES stress_vm_inc_nybble(
 		INC_HI_NYBBLE(*(ptr + 6));
 		INC_HI_NYBBLE(*(ptr + 7));
 		c++;
+		stress_vm_bytes(8, 8);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1490,6 +1632,7 @@ static size_t TARGET_CLONES stress_vm_inc_nybble(
 		bit_errors += (*(ptr + 5) != val);
 		bit_errors += (*(ptr + 6) != val);
 		bit_errors += (*(ptr + 7) != val);
+		stress_vm_bytes(8, 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
@@ -1536,6 +1679,7 @@ static size_t TARGET_CLONES stress_vm_rand_sum(
 		*(ptr + 6) = stress_mwc64();
 		*(ptr + 7) = stress_mwc64();
 		c++;
+		stress_vm_bytes(0, 8 * sizeof(*ptr));
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1555,6 +1699,7 @@ static size_t TARGET_CLONES stress_vm_rand_sum(
 		bit_errors += stress_vm_count_bits(*(ptr + 5) ^ stress_mwc64());
 		bit_errors += stress_vm_count_bits(*(ptr + 6) ^ stress_mwc64());
 		bit_errors += stress_vm_count_bits(*(ptr + 7) ^ stress_mwc64());
+		stress_vm_bytes(8 * sizeof(*ptr), 0);
 		if (UNLIKELY(!keep_stressing_flag()))
 			break;
 	}
@@ -1592,6 +1737,7 @@ static size_t TARGET_CLONES stress_vm_prime_zero(
 		return 0;
 #endif
 
+	stress_vm_bytes(0, sz);
 	(void)memset(buf, 0xff, sz);
 
 	for (j = 0; j < 8; j++) {
@@ -1609,11 +1755,13 @@ static size_t TARGET_CLONES stress_vm_prime_zero(
 			if (UNLIKELY(!keep_stressing_flag()))
 				goto abort;
 		}
+		stress_vm_bytes(sz, sz);
 	}
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
 	ptr8 = (uint8_t *)buf;
+	stress_vm_bytes(sz, 0);
 	for (i = 0; i < sz; i++) {
 		bit_errors += stress_vm_count_bits8(ptr8[i]);
 	}
@@ -1652,6 +1800,7 @@ static size_t TARGET_CLONES stress_vm_prime_one(
 		return 0;
 #endif
 
+	stress_vm_bytes(0, sz);
 	(void)memset(buf, 0x00, sz);
 
 	for (j = 0; j < 8; j++) {
@@ -1669,11 +1818,13 @@ static size_t TARGET_CLONES stress_vm_prime_one(
 			if (UNLIKELY(!keep_stressing_flag()))
 				goto abort;
 		}
+		stress_vm_bytes(sz, sz);
 	}
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
 	ptr8 = (uint8_t *)buf;
+	stress_vm_bytes(sz, 0);
 	for (i = 0; i < sz; i++) {
 		bit_errors += 8 - stress_vm_count_bits8(ptr8[i]);
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1713,6 +1864,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_zero(
 		return 0;
 #endif
 
+	stress_vm_bytes(0, sz);
 	(void)memset(buf, 0xff, sz);
 
 	for (i = 0, j = prime; i < sz; i++, j += prime) {
@@ -1728,6 +1880,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_zero(
 		if (max_ops && c >= max_ops)
 			goto abort;
 	}
+	stress_vm_bytes(sz, sz);
 	for (i = 0, j = prime; i < sz; i++, j += prime) {
 		/*
 		 *  Step through memory in prime sized steps
@@ -1741,10 +1894,12 @@ static size_t TARGET_CLONES stress_vm_prime_gray_zero(
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 	}
+	stress_vm_bytes(sz, sz);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
 	ptr8 = (uint8_t *)buf;
+	stress_vm_bytes(sz, 0);
 	for (i = 0; i < sz; i++) {
 		bit_errors += stress_vm_count_bits8(ptr8[i]);
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1784,6 +1939,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_one(
 		return 0;
 #endif
 
+	stress_vm_bytes(0, sz);
 	(void)memset(buf, 0x00, sz);
 
 	for (i = 0, j = prime; i < sz; i++, j += prime) {
@@ -1799,6 +1955,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_one(
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 	}
+	stress_vm_bytes(sz, sz);
 	(void)stress_mincore_touch_pages(buf, sz);
 	for (i = 0, j = prime; i < sz; i++, j += prime) {
 		/*
@@ -1813,10 +1970,12 @@ static size_t TARGET_CLONES stress_vm_prime_gray_one(
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 	}
+	stress_vm_bytes(sz, sz);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
 	ptr8 = (uint8_t *)buf;
+	stress_vm_bytes(sz, 0);
 	for (i = 0; i < sz; i++) {
 		bit_errors += 8 - stress_vm_count_bits8(ptr8[i]);
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -1888,6 +2047,7 @@ static size_t OPTIMIZE3 TARGET_CLONES stress_vm_write64(
 			break;
 	}
 	add_counter(args, i);
+	stress_vm_bytes(0, i * sizeof(*ptr) * 32);
 	val++;
 
 	return 0;
@@ -1955,6 +2115,7 @@ static size_t TARGET_CLONES stress_vm_write64nt(
 				break;
 		}
 		add_counter(args, i);
+		stress_vm_bytes(0, i * sizeof(*ptr) * 32);
 		val++;
 		return 0;
 	}
@@ -2025,6 +2186,7 @@ static size_t OPTIMIZE3 TARGET_CLONES stress_vm_read64(
 			break;
 	}
 	add_counter(args, i);
+	stress_vm_bytes(i * sizeof(*ptr) * 32, 0);
 
 	return 0;
 }
@@ -2080,15 +2242,121 @@ static size_t TARGET_CLONES stress_vm_write1024v(
 			break;
 	}
 	add_counter(args, i);
+	stress_vm_bytes(0, i * sizeof(*ptr));
 	val++;
 
 	return 0;
 }
 #endif
 
+/*
+ *  stress_vm_rowhammer_phys()
+ *	physical address of addr, returns 0 if it cannot be found
+ */
+static uint64_t stress_vm_rowhammer_phys(const volatile void *addr)
+{
+	uint64_t phys_addr;
+
+#if defined(__linux__)
+	if (vm_pagemap_fd == -1) {
+		vm_pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+		if (vm_pagemap_fd < 0)
+			vm_pagemap_fd = -2;
+	}
+#endif
+	if (vm_pagemap_fd < 0)
+		return 0;
+	if (stress_pagemap_phys(vm_pagemap_fd, stress_get_page_size(),
+				(uintptr_t)addr, &phys_addr) < 0)
+		return 0;
+	return phys_addr;
+}
+
+/*
+ *  stress_vm_rowhammer_rows()
+ *	pick 2 x sides + 1 rows row_stride bytes apart, rows 1, 3, 5..
+ *	are the aggressors and rows 0, 2, 4.. the victims either side
+ *	of them. Try to find rows that are physically contiguous, if
+ *	the physical addresses can't be read the rows are virtually
+ *	contiguous which is only physically contiguous on huge pages.
+ *	Returns the first row or NULL if the buffer is too small
+ */
+static uint8_t *stress_vm_rowhammer_rows(
+	uint8_t *buf,
+	const size_t sz,
+	const uint32_t sides,
+	const size_t row_stride,
+	bool *phys_rows)
+{
+	const size_t span = ((2 * (size_t)sides) + 1) * row_stride;
+	const size_t page_size = stress_get_page_size();
+	uint8_t *base = NULL;
+	int tries;
+
+	*phys_rows = false;
+	if (span > sz)
+		return NULL;
+
+	for (tries = 0; tries < VM_ROWHAMMER_BASE_TRIES; tries++) {
+		uint64_t phys0;
+		size_t i;
+
+		base = buf + ((stress_mwc64() % (sz - span + 1)) & ~(page_size - 1));
+		phys0 = stress_vm_rowhammer_phys(base);
+
+		if (!phys0)
+			return base;
+		for (i = 1; i <= 2 * (size_t)sides; i++) {
+			if (stress_vm_rowhammer_phys(base + (i * row_stride)) != phys0 + (i * row_stride))
+				break;
+		}
+		if (i > 2 * (size_t)sides) {
+			*phys_rows = true;
+			break;
+		}
+	}
+	return base;
+}
+
+/*
+ *  stress_vm_rowhammer_flip()
+ *	log the location of a bit flip
+ */
+static void stress_vm_rowhammer_flip(
+	const volatile uint32_t *addr,
+	const uint32_t expected,
+	const uint32_t got,
+	const uint8_t *rows,
+	const size_t row_stride)
+{
+	const uint64_t phys_addr = stress_vm_rowhammer_phys(addr);
+	char row[32], phys[32];
+
+	if (rows) {
+		const intptr_t delta = (const uint8_t *)addr - rows;
+
+		(void)snprintf(row, sizeof(row), "row %+" PRIdPTR,
+			(delta < 0) ? ((delta + 1) / (intptr_t)row_stride) - 1 :
+				       delta / (intptr_t)row_stride);
+	} else {
+		(void)shim_strlcpy(row, "random pair", sizeof(row));
+	}
+	if (phys_addr)
+		(void)snprintf(phys, sizeof(phys), "0x%" PRIx64, phys_addr);
+	else
+		(void)shim_strlcpy(phys, "unknown", sizeof(phys));
+
+	pr_inf("stress-vm: rowhammer: bit flip at %p (physical %s, %s), "
+		"expected 0x%8.8" PRIx32 " got 0x%8.8" PRIx32 ", flipped bits 0x%8.8" PRIx32 "\n",
+		(const volatile void *)addr, phys, row, expected, got, expected ^ got);
+}
+
 /*
  *  stress_vm_rowhammer()
- *
+ *	repeatedly read and flush aggressor rows to force row
+ *	activations, by default two random addresses, with
+ *	--vm-rowhammer-sides N aggressor rows either side of
+ *	victim rows (2 = double-sided, > 2 = many-sided)
  */
 static size_t TARGET_CLONES stress_vm_rowhammer(
 	void *buf,
@@ -2102,8 +2370,15 @@ static size_t TARGET_CLONES stress_vm_rowhammer(
 	static uint32_t val = 0xff5a00a5;
 	register size_t j;
 	register volatile uint32_t *addr0, *addr1;
+	volatile uint32_t *aggressors[MAX_VM_ROWHAMMER_SIDES];
 	register size_t errors = 0;
 	const size_t n = sz / sizeof(*addr0);
+	uint32_t sides = 0;
+	size_t row_stride = DEFAULT_VM_ROWHAMMER_STRIDE;
+	uint8_t *rows = NULL;
+	uint64_t activations;
+	bool phys_rows = false;
+	double t;
 
 	(void)buf_end;
 	(void)max_ops;
@@ -2114,47 +2389,100 @@ static size_t TARGET_CLONES stress_vm_rowhammer(
 		return 0;
 	}
 
+	(void)stress_get_setting("vm-rowhammer-sides", &sides);
+	(void)stress_get_setting("vm-rowhammer-row-stride", &row_stride);
+
 	(void)stress_mincore_touch_pages(buf, sz);
 
 	for (j = 0; j < n; j++)
 		buf32[j] = val;
 
-	/* Pick two random addresses */
-	addr0 = &buf32[(stress_mwc64() << 12) % n];
-	addr1 = &buf32[(stress_mwc64() << 12) % n];
-
-	/* Hammer the rows */
-	for (j = VM_ROWHAMMER_LOOPS / 4; j; j--) {
-		*addr0;
-		*addr1;
-		shim_clflush(addr0);
-		shim_clflush(addr1);
-		shim_mfence();
-		*addr0;
-		*addr1;
-		shim_clflush(addr0);
-		shim_clflush(addr1);
-		shim_mfence();
-		*addr0;
-		*addr1;
-		shim_clflush(addr0);
-		shim_clflush(addr1);
-		shim_mfence();
-		*addr0;
-		*addr1;
-		shim_clflush(addr0);
-		shim_clflush(addr1);
-		shim_mfence();
+	if (sides) {
+		rows = stress_vm_rowhammer_rows((uint8_t *)buf, sz, sides, row_stride, &phys_rows);
+		if (!rows) {
+			pr_dbg("stress-vm: rowhammer: %zu bytes is too small for %" PRIu32
+				" rows %zu bytes apart, using a random pair\n",
+				sz, (2 * sides) + 1, row_stride);
+			sides = 0;
+		}
 	}
-	for (j = 0; j < n; j++)
-		if (UNLIKELY(buf32[j] != val))
+
+	if (sides) {
+		/* same number of uncached reads as the random pair */
+		const size_t loops = (2 * VM_ROWHAMMER_LOOPS) / sides;
+
+		for (j = 0; j < sides; j++)
+			aggressors[j] = (volatile uint32_t *)(rows + (((2 * j) + 1) * row_stride));
+
+		t = stress_time_now();
+		for (j = loops; j; j--) {
+			register size_t i;
+
+			for (i = 0; i < sides; i++)
+				(void)*aggressors[i];
+			for (i = 0; i < sides; i++)
+				shim_clflush(aggressors[i]);
+			shim_mfence();
+		}
+		t = stress_time_now() - t;
+		activations = (uint64_t)loops * sides;
+		addr0 = aggressors[0];
+		addr1 = aggressors[sides - 1];
+	} else {
+		/* Pick two random addresses */
+		addr0 = &buf32[(stress_mwc64() << 12) % n];
+		addr1 = &buf32[(stress_mwc64() << 12) % n];
+
+		/* Hammer the rows */
+		t = stress_time_now();
+		for (j = VM_ROWHAMMER_LOOPS / 4; j; j--) {
+			*addr0;
+			*addr1;
+			shim_clflush(addr0);
+			shim_clflush(addr1);
+			shim_mfence();
+			*addr0;
+			*addr1;
+			shim_clflush(addr0);
+			shim_clflush(addr1);
+			shim_mfence();
+			*addr0;
+			*addr1;
+			shim_clflush(addr0);
+			shim_clflush(addr1);
+			shim_mfence();
+			*addr0;
+			*addr1;
+			shim_clflush(addr0);
+			shim_clflush(addr1);
+			shim_mfence();
+		}
+		t = stress_time_now() - t;
+		activations = 2 * VM_ROWHAMMER_LOOPS;
+	}
+
+	for (j = 0; j < n; j++) {
+		if (UNLIKELY(buf32[j] != val)) {
+			if (errors < VM_ROWHAMMER_FLIPS_LOG)
+				stress_vm_rowhammer_flip(&buf32[j], val, buf32[j], rows, row_stride);
 			errors++;
+		}
+	}
 	if (errors) {
 		bit_errors += errors;
 		pr_dbg("stress-vm: rowhammer: %zu errors on addresses "
 			"%p and %p\n", errors, (volatile void *)addr0, (volatile void *)addr1);
 	}
+	if (vm_rowhammer_stats) {
+		vm_rowhammer_stats->activations += activations;
+		vm_rowhammer_stats->flips += errors;
+		vm_rowhammer_stats->duration += t;
+		vm_rowhammer_stats->sides = sides;
+		vm_rowhammer_stats->phys_rows = phys_rows;
+	}
 	add_counter(args, VM_ROWHAMMER_LOOPS);
+	/* fill, check and the uncached hammering reads */
+	stress_vm_bytes(sz + (activations * sizeof(*addr0)), sz);
 	val = (val >> 31) | (val << 1);
 
 	stress_vm_check("rowhammer", bit_errors);
@@ -2207,6 +2535,8 @@ static size_t TARGET_CLONES stress_vm_mscan(
 			break;
 	}
 	end = (volatile uint8_t *)ptr;
+	stress_vm_bytes(9 * (uint64_t)(end - (volatile uint8_t *)buf),
+			8 * (uint64_t)(end - (volatile uint8_t *)buf));
 
 	add_counter(args, c);
 
@@ -2225,9 +2555,11 @@ static size_t TARGET_CLONES stress_vm_mscan(
 		*ptr &= 0x7f;
 
 		if (UNLIKELY(!keep_stressing_flag() || (max_ops && (c >= max_ops))))
-			goto abort;
+			break;
 	}
 	end = (volatile uint8_t *)ptr;
+	stress_vm_bytes(9 * (uint64_t)(end - (volatile uint8_t *)buf),
+			8 * (uint64_t)(end - (volatile uint8_t *)buf));
 
 	add_counter(args, c);
 
@@ -2235,7 +2567,6 @@ static size_t TARGET_CLONES stress_vm_mscan(
 		bit_errors += stress_vm_popcount(*ptr);
 	}
 
-abort:
 	stress_vm_check("mscan", bit_errors);
 	set_counter(args, c);
 
@@ -2325,6 +2656,7 @@ static size_t TARGET_CLONES stress_vm_cache_stripe(
 		ptr[0x20] = 0x30;
 
 		c++;
+		stress_vm_bytes(0, 64);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -2398,6 +2730,7 @@ static size_t TARGET_CLONES stress_vm_cache_stripe(
 		bit_errors += (ptr[0x20] != 0x30);
 	}
 
+	stress_vm_bytes(sz, 0);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 	stress_vm_check("cache-stripe", bit_errors);
@@ -2428,6 +2761,7 @@ static size_t TARGET_CLONES stress_vm_cache_lines(
 	for (i = 0, ptr = (uint8_t *)buf + offset; ptr < (uint8_t *)buf_end; ptr += 64) {
 		*ptr = i++;
 	}
+	stress_vm_bytes(0, sz / 64);
 	c++;
 	if (UNLIKELY(max_ops && c >= max_ops))
 		goto abort;
@@ -2437,6 +2771,7 @@ static size_t TARGET_CLONES stress_vm_cache_lines(
 	for (i = 0, ptr = (uint8_t *)buf + offset; ptr < (uint8_t *)buf_end; ptr += 64) {
 		bit_errors += (*ptr != i++);
 	}
+	stress_vm_bytes(sz / 64, 0);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 	stress_vm_check("cache-stripe", bit_errors);
@@ -2517,6 +2852,7 @@ static size_t TARGET_CLONES stress_vm_wrrd128nt(
 		val++;
 		c++;
 	}
+	stress_vm_bytes(0, 4 * (uint64_t)sz);
 	if (UNLIKELY(max_ops && c >= max_ops))
 		goto abort;
 	if (UNLIKELY(!keep_stressing_flag()))
@@ -2562,6 +2898,7 @@ static size_t TARGET_CLONES stress_vm_wrrd128nt(
 		bit_errors += (tmp != (val + 3));
 		val++;
 	}
+	stress_vm_bytes(4 * (uint64_t)sz, 0);
 	inject_random_bit_errors(buf, sz);
 	stress_vm_check("wrrd128nt", bit_errors);
 abort:
@@ -2625,6 +2962,7 @@ static size_t TARGET_CLONES stress_vm_fwdrev(
 		fwdptr += 16;
 		revptr -= 16;
 		c++;
+		stress_vm_bytes(0, 16);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -2667,6 +3005,7 @@ static size_t TARGET_CLONES stress_vm_fwdrev(
 		fwdptr += 16;
 		revptr -= 16;
 		c++;
+		stress_vm_bytes(16, 0);
 		if (UNLIKELY(max_ops && c >= max_ops))
 			goto abort;
 		if (UNLIKELY(!keep_stressing_flag()))
@@ -2695,6 +3034,7 @@ static size_t stress_vm_all(
 	static int i = 1;
 	size_t bit_errors = 0;
 
+	vm_method_index = (size_t)i;
 	bit_errors = vm_methods[i].func(buf, buf_end, sz, args, max_ops);
 	i++;
 	if (vm_methods[i].func == NULL)
@@ -2771,6 +3111,214 @@ static int stress_set_vm_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_vm_method_exec()
+ *	run a vm method and account the memory traffic it generated
+ */
+static void stress_vm_method_exec(
+	const stress_args_t *args,
+	stress_vm_context_t *context,
+	const stress_vm_func func,
+	void *buf,
+	void *buf_end,
+	const size_t buf_sz,
+	const uint64_t max_ops)
+{
+	const uint64_t counter = get_counter(args);
+	const double t = stress_time_now();
+	stress_vm_method_stats_t *ms;
+
+	vm_bytes_read = 0;
+	vm_bytes_written = 0;
+	vm_method_index = (size_t)(context->vm_method - vm_methods);
+
+	*(context->bit_error_count) += func(buf, buf_end, buf_sz, args, max_ops);
+
+	/* stress_vm_all sets vm_method_index to the method it ran */
+	ms = &context->method_stats[vm_method_index];
+	ms->duration += stress_time_now() - t;
+	ms->bytes_read += vm_bytes_read;
+	ms->bytes_written += vm_bytes_written;
+	ms->counter += get_counter(args) - counter;
+}
+
+/*
+ *  stress_vm_prefault_region()
+ *	fault in and dirty the pages of a region, use
+ *	MADV_POPULATE_WRITE if possible, otherwise write
+ *	to each page
+ */
+static void stress_vm_prefault_region(uint8_t *addr, const size_t size, const size_t page_size)
+{
+	volatile uint8_t *ptr;
+	const uint8_t *end = addr + size;
+
+#if defined(MADV_POPULATE_WRITE) &&	\
+    defined(HAVE_MADVISE)
+	if (madvise((void *)addr, size, MADV_POPULATE_WRITE) == 0)
+		return;
+#endif
+	for (ptr = addr; (ptr < end) && keep_stressing_flag(); ptr += page_size)
+		*ptr = 0;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_vm_prefault_thread()
+ *	prefault a thread's part of the mapping
+ */
+static void *stress_vm_prefault_thread(void *arg)
+{
+	static void *nowt = NULL;
+	const stress_vm_prefault_t *pf = (const stress_vm_prefault_t *)arg;
+
+	stress_vm_prefault_region(pf->addr, pf->size, pf->page_size);
+
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_vm_prefault()
+ *	fault in a new mapping, large mappings can take a long
+ *	time to fault in, so split them between threads
+ */
+static void stress_vm_prefault(
+	uint8_t *buf,
+	const size_t buf_sz,
+	const size_t page_size,
+	const uint32_t threads)
+{
+#if defined(HAVE_LIB_PTHREAD)
+	stress_vm_prefault_t pf[MAX_VM_PREFAULT];
+	pthread_t pthreads[MAX_VM_PREFAULT];
+	bool started[MAX_VM_PREFAULT];
+	const size_t pages = buf_sz / page_size;
+	const size_t n = STRESS_MINIMUM((size_t)threads, pages);
+	size_t i, offset = 0;
+
+	if (n < 2) {
+		stress_vm_prefault_region(buf, buf_sz, page_size);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		/* spread the pages evenly, the first threads get any remainder */
+		const size_t chunk_pages = (pages / n) + ((i < (pages % n)) ? 1 : 0);
+
+		pf[i].addr = buf + offset;
+		pf[i].size = chunk_pages * page_size;
+		pf[i].page_size = page_size;
+		offset += pf[i].size;
+
+		started[i] = (pthread_create(&pthreads[i], NULL,
+			stress_vm_prefault_thread, &pf[i]) == 0);
+		if (!started[i])
+			stress_vm_prefault_region(pf[i].addr, pf[i].size, page_size);
+	}
+	for (i = 0; i < n; i++) {
+		if (started[i])
+			(void)pthread_join(pthreads[i], NULL);
+	}
+#else
+	(void)threads;
+
+	stress_vm_prefault_region(buf, buf_sz, page_size);
+#endif
+}
+
+/*
+ *  stress_vm_rowhammer_report()
+ *	report the achieved row activation rate, overall and per
+ *	aggressor row in each DRAM refresh window
+ */
+static void stress_vm_rowhammer_report(
+	const stress_args_t *args,
+	const stress_vm_rowhammer_stats_t *rs)
+{
+	const double aggressors = rs->sides ? (double)rs->sides : 2.0;
+	double rate, per_window;
+
+	if (!rs->activations || (rs->duration <= 0.0))
+		return;
+
+	rate = (double)rs->activations / rs->duration;
+	per_window = rate * VM_REFRESH_WINDOW;
+	stress_misc_stats_set(args->misc_stats, 4, "M row activations/sec", rate / 1.0E6);
+	stress_misc_stats_set(args->misc_stats, 5, "activations per 64ms", per_window);
+	stress_misc_stats_set(args->misc_stats, 6, "per row per 64ms", per_window / aggressors);
+	stress_misc_stats_set(args->misc_stats, 7, "rowhammer bit flips", (double)rs->flips);
+
+	if (args->instance != 0)
+		return;
+	if (rs->sides)
+		pr_inf("%s: rowhammer: %" PRIu32 "-sided, %s contiguous rows\n",
+			args->name, rs->sides, rs->phys_rows ? "physically" : "virtually");
+	else
+		pr_inf("%s: rowhammer: random address pair\n", args->name);
+	pr_inf("%s: rowhammer: %.2f M activations/sec, %.0f per 64ms refresh window, "
+		"%.0f per aggressor row, %" PRIu64 " bit flip%s\n",
+		args->name, rate / 1.0E6, per_window, per_window / aggressors,
+		rs->flips, (rs->flips == 1) ? "" : "s");
+}
+
+/*
+ *  stress_vm_method_stats()
+ *	report the measured read and write bandwidth, for the
+ *	all method also dump a per method breakdown
+ */
+static void stress_vm_method_stats(
+	const stress_args_t *args,
+	const stress_vm_context_t *context)
+{
+	const stress_vm_method_stats_t *ms = context->method_stats;
+	const bool all = (context->vm_method->func == stress_vm_all);
+	uint64_t bytes_read = 0, bytes_written = 0, counter = 0;
+	double duration = 0.0;
+	size_t i;
+
+	for (i = 0; vm_methods[i].func; i++) {
+		bytes_read += ms[i].bytes_read;
+		bytes_written += ms[i].bytes_written;
+		counter += ms[i].counter;
+		duration += ms[i].duration;
+	}
+	if (duration <= 0.0)
+		return;
+
+	stress_misc_stats_set(args->misc_stats, 0, "GB per sec read",
+		(double)bytes_read / (duration * (double)GB));
+	stress_misc_stats_set(args->misc_stats, 1, "GB per sec write",
+		(double)bytes_written / (duration * (double)GB));
+	if (counter >> VM_BOGO_SHIFT)
+		stress_misc_stats_set(args->misc_stats, 2, "bytes per bogo-op",
+			(double)(bytes_read + bytes_written) /
+			((double)counter / (double)(1ULL << VM_BOGO_SHIFT)));
+	if (context->prefault_stats->duration > 0.0)
+		stress_misc_stats_set(args->misc_stats, 3, "GB per sec prefault",
+			(double)context->prefault_stats->bytes /
+			(context->prefault_stats->duration * (double)GB));
+
+	stress_vm_rowhammer_report(args, context->rowhammer_stats);
+
+	if (!all || (args->instance != 0))
+		return;
+
+	pr_inf("%s: %-14s %12s %12s %14s\n", args->name,
+		"method", "read GB/s", "write GB/s", "bytes/bogo-op");
+	for (i = 0; vm_methods[i].func; i++) {
+		const double ops = (double)ms[i].counter / (double)(1ULL << VM_BOGO_SHIFT);
+
+		if (ms[i].duration <= 0.0)
+			continue;
+		pr_inf("%s: %-14s %12.3f %12.3f %14.1f\n", args->name,
+			vm_methods[i].name,
+			(double)ms[i].bytes_read / (ms[i].duration * (double)GB),
+			(double)ms[i].bytes_written / (ms[i].duration * (double)GB),
+			ops > 0.0 ? (double)(ms[i].bytes_read + ms[i].bytes_written) / ops : 0.0);
+	}
+}
+
 static int stress_vm_child(const stress_args_t *args, void *ctxt)
 {
 	int no_mem_retries = 0;
@@ -2779,6 +3327,7 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
 	void *buf = NULL, *buf_end = NULL;
 	int vm_flags = 0;                      /* VM mmap flags */
 	int vm_madvise = -1;
+	uint32_t vm_prefault = DEFAULT_VM_PREFAULT;
 	size_t buf_sz;
 	size_t vm_bytes = DEFAULT_VM_BYTES;
 	const size_t page_size = args->page_size;
@@ -2789,6 +3338,7 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
 	(void)stress_get_setting("vm-hang", &vm_hang);
 	(void)stress_get_setting("vm-keep", &vm_keep);
 	(void)stress_get_setting("vm-flags", &vm_flags);
+	(void)stress_get_setting("vm-prefault", &vm_prefault);
 
 	if (!stress_get_setting("vm-bytes", &vm_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -2809,8 +3359,11 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
 			break;
 		}
 		if (!vm_keep || (buf == NULL)) {
+			double t;
+
 			if (!keep_stressing_flag())
 				return EXIT_SUCCESS;
+			t = stress_time_now();
 			buf = (uint8_t *)mmap(NULL, buf_sz,
 				PROT_READ | PROT_WRITE,
 				MAP_PRIVATE | MAP_ANONYMOUS |
@@ -2826,11 +3379,22 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
 				(void)stress_madvise_random(buf, buf_sz);
 			else
 				(void)shim_madvise(buf, buf_sz, vm_madvise);
+
+			/*
+			 *  Fault in the new mapping before running the
+			 *  method and account for it separately, the
+			 *  mmap is included to cover MAP_POPULATE too
+			 */
+			if (vm_prefault > 0) {
+				stress_vm_prefault((uint8_t *)buf, buf_sz, page_size, vm_prefault);
+				context->prefault_stats->duration += stress_time_now() - t;
+				context->prefault_stats->bytes += buf_sz;
+			}
 		}
 
 		no_mem_retries = 0;
 		(void)stress_mincore_touch_pages(buf, buf_sz);
-		*(context->bit_error_count) += func(buf, buf_end, buf_sz, args, max_ops);
+		stress_vm_method_exec(args, context, func, buf, buf_end, buf_sz, max_ops);
 
 		if (vm_hang == 0) {
 			while (keep_stressing_vm(args)) {
@@ -2848,6 +3412,8 @@ static int stress_vm_child(const stress_args_t *args, void *ctxt)
 
 	if (vm_keep && buf != NULL)
 		(void)munmap((void *)buf, buf_sz);
+	if (vm_pagemap_fd >= 0)
+		(void)close(vm_pagemap_fd);
 
 	return EXIT_SUCCESS;
 }
@@ -2860,20 +3426,27 @@ static int stress_vm(const stress_args_t *args)
 {
 	uint64_t tmp_counter;
 	const size_t page_size = args->page_size;
-	size_t retries;
+	size_t retries, shared_sz;
 	int err = 0, ret = EXIT_SUCCESS;
 	stress_vm_context_t context;
 
 	context.vm_method = &vm_methods[0];
 	context.bit_error_count = MAP_FAILED;
 
+	/* bit error counter followed by the per method, prefault and rowhammer stats */
+	shared_sz = sizeof(*context.bit_error_count) +
+		    (SIZEOF_ARRAY(vm_methods) * sizeof(*context.method_stats)) +
+		    sizeof(*context.prefault_stats) +
+		    sizeof(*context.rowhammer_stats);
+	shared_sz = (shared_sz + page_size - 1) & ~(page_size - 1);
+
 	(void)stress_get_setting("vm-method", &context.vm_method);
 
 	pr_dbg("%s: using method '%s'\n", args->name, context.vm_method->name);
 
 	for (retries = 0; (retries < 100) && keep_stressing_flag(); retries++) {
 		context.bit_error_count = (uint64_t *)
-			mmap(NULL, page_size, PROT_READ | PROT_WRITE,
+			mmap(NULL, shared_sz, PROT_READ | PROT_WRITE,
 				MAP_SHARED | MAP_ANONYMOUS, -1, 0);
 		err = errno;
 		if (context.bit_error_count != MAP_FAILED)
@@ -2892,12 +3465,18 @@ static int stress_vm(const stress_args_t *args)
 	}
 
 	*context.bit_error_count = 0ULL;
+	context.method_stats = (stress_vm_method_stats_t *)(context.bit_error_count + 1);
+	context.prefault_stats = (stress_vm_prefault_stats_t *)
+		(context.method_stats + SIZEOF_ARRAY(vm_methods));
+	context.rowhammer_stats = (stress_vm_rowhammer_stats_t *)
+		(context.prefault_stats + 1);
+	vm_rowhammer_stats = context.rowhammer_stats;
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	ret = stress_oomable_child(args, &context, stress_vm_child, STRESS_OOMABLE_NORMAL);
 
-	(void)shim_msync(context.bit_error_count, page_size, MS_SYNC);
+	(void)shim_msync(context.bit_error_count, shared_sz, MS_SYNC);
 	if (*context.bit_error_count > 0) {
 		pr_fail("%s: detected %" PRIu64 " bit errors while "
 			"stressing memory\n",
@@ -2905,8 +3484,10 @@ static int stress_vm(const stress_args_t *args)
 		ret = EXIT_FAILURE;
 	}
 
+	stress_vm_method_stats(args, &context);
+
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	(void)munmap((void *)context.bit_error_count, page_size);
+	(void)munmap((void *)context.bit_error_count, shared_sz);
 
 	tmp_counter = get_counter(args) >> VM_BOGO_SHIFT;
 	set_counter(args, tmp_counter);
@@ -2927,6 +3508,9 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_vm_method,	stress_set_vm_method },
 	{ OPT_vm_mmap_locked,	stress_set_vm_mmap_locked },
 	{ OPT_vm_mmap_populate,	stress_set_vm_mmap_populate },
+	{ OPT_vm_prefault,	stress_set_vm_prefault },
+	{ OPT_vm_rowhammer_sides, stress_set_vm_rowhammer_sides },
+	{ OPT_vm_rowhammer_row_stride, stress_set_vm_rowhammer_row_stride },
 	{ 0,			NULL }
 };
 
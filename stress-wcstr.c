@@ -20,6 +20,7 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-put.h"
 
 #if defined(HAVE_BSD_WCHAR)
 #include <bsd/wchar.h>
@@ -32,10 +33,19 @@
 #define STR1LEN 256
 #define STR2LEN 128
 
+#define WCS_SWEEP_MIN		(16)		/* shortest sweep string */
+#define WCS_SWEEP_LENGTHS	(7)		/* 16 to 64K chars in powers of 4 */
+#define WCS_SWEEP_MAX		((size_t)WCS_SWEEP_MIN << (2 * (WCS_SWEEP_LENGTHS - 1)))
+#define WCS_SWEEP_BYTES		(16 * MB)	/* bytes scanned per measurement */
+#define WCS_SWEEP_NEEDLE	(8)		/* wcsstr needle length */
+#define WCS_SWEEP_ALIGNS	(3)
+#define WCS_SWEEP_IMPLS		(2)		/* libc and simd */
+
 static const stress_help_t help[] = {
 	{ NULL,	"wcs N",	   "start N workers on lib C wide char string functions" },
 	{ NULL,	"wcs-method func", "specify the wide character string function to stress" },
 	{ NULL,	"wcs-ops N",	   "stop after N bogo wide character string operations" },
+	{ NULL,	"wcs-sweep",	   "report libc and SIMD wide string scan GB/s over lengths and alignments" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -665,6 +675,522 @@ static const stress_wcs_method_info_t wcs_methods[] = {
 	{ NULL,			NULL,			NULL }
 };
 
+static int stress_set_wcs_sweep(const char *opt)
+{
+	return stress_set_setting_true("wcs-sweep", opt);
+}
+
+#if defined(HAVE_VECMATH) &&	\
+    defined(HAVE_WCSLEN)
+/*
+ *  Reference SIMD wide string scans using 16 byte generic vectors,
+ *  see stress-str.c, aligned loads may read past the end of the
+ *  string but never cross a page, unaligned loads are only used
+ *  when they do not cross a page.
+ */
+typedef wchar_t stress_wcs_vec_t
+	__attribute__ ((vector_size(16), __may_alias__));
+typedef wchar_t stress_wcs_uvec_t
+	__attribute__ ((vector_size(16), aligned(sizeof(wchar_t)), __may_alias__));
+
+#define WCS_VEC_SIZE		(sizeof(stress_wcs_vec_t))
+#define WCS_VEC_CHARS		(WCS_VEC_SIZE / sizeof(wchar_t))
+#define WCS_VEC_ALIGNED(p)	(!((uintptr_t)(p) & (WCS_VEC_SIZE - 1)))
+#define WCS_VEC_PAGE_SAFE(p)	(((uintptr_t)(p) & 4095) <= (4096 - WCS_VEC_SIZE))
+
+/* alignments are in wide chars, wide strings are always char aligned */
+static const size_t wcs_sweep_align[WCS_SWEEP_ALIGNS] = { 0, 1, 3 };
+static const char * const wcs_sweep_impls[WCS_SWEEP_IMPLS] = { "libc", "simd" };
+
+static inline bool ALWAYS_INLINE stress_wcs_vec_any(const stress_wcs_vec_t v)
+{
+	uint64_t w[2];
+
+	(void)memcpy(w, &v, sizeof(w));
+	return (w[0] | w[1]) != 0;
+}
+
+static inline stress_wcs_vec_t ALWAYS_INLINE stress_wcs_vec_splat(const wchar_t c)
+{
+	stress_wcs_vec_t v;
+	size_t i;
+
+	for (i = 0; i < WCS_VEC_CHARS; i++)
+		v[i] = c;
+	return v;
+}
+
+static OPTIMIZE3 size_t stress_wcs_simd_wcslen(const wchar_t *s)
+{
+	const stress_wcs_vec_t zero = stress_wcs_vec_splat(0);
+	const wchar_t *p;
+
+	for (p = s; !WCS_VEC_ALIGNED(p); p++) {
+		if (!*p)
+			return (size_t)(p - s);
+	}
+	for (;; p += WCS_VEC_CHARS) {
+		const stress_wcs_vec_t v = *(const stress_wcs_vec_t *)p;
+
+		if (stress_wcs_vec_any((stress_wcs_vec_t)(v == zero)))
+			break;
+	}
+	while (*p)
+		p++;
+	return (size_t)(p - s);
+}
+
+#if defined(HAVE_WMEMCHR)
+static OPTIMIZE3 const wchar_t *stress_wcs_simd_wmemchr(const wchar_t *s, const wchar_t c, size_t n)
+{
+	const stress_wcs_vec_t vc = stress_wcs_vec_splat(c);
+	const wchar_t *p = s;
+
+	for (; n >= WCS_VEC_CHARS; n -= WCS_VEC_CHARS, p += WCS_VEC_CHARS) {
+		const stress_wcs_vec_t v = *(const stress_wcs_uvec_t *)p;
+
+		if (stress_wcs_vec_any((stress_wcs_vec_t)(v == vc)))
+			break;
+	}
+	for (; n; n--, p++) {
+		if (*p == c)
+			return p;
+	}
+	return NULL;
+}
+#endif
+
+#if defined(HAVE_WCSCHR) ||	\
+    defined(HAVE_WCSSTR)
+static OPTIMIZE3 const wchar_t *stress_wcs_simd_wcschr(const wchar_t *s, const wchar_t c)
+{
+	const stress_wcs_vec_t vc = stress_wcs_vec_splat(c);
+	const stress_wcs_vec_t zero = stress_wcs_vec_splat(0);
+	const wchar_t *p;
+
+	for (p = s; !WCS_VEC_ALIGNED(p); p++) {
+		if (*p == c)
+			return p;
+		if (!*p)
+			return NULL;
+	}
+	for (;; p += WCS_VEC_CHARS) {
+		const stress_wcs_vec_t v = *(const stress_wcs_vec_t *)p;
+
+		if (stress_wcs_vec_any((stress_wcs_vec_t)((v == vc) | (v == zero))))
+			break;
+	}
+	for (;; p++) {
+		if (*p == c)
+			return p;
+		if (!*p)
+			return NULL;
+	}
+}
+#endif
+
+#if defined(HAVE_WCSRCHR)
+static OPTIMIZE3 const wchar_t *stress_wcs_simd_wcsrchr(const wchar_t *s, const wchar_t c)
+{
+	const stress_wcs_vec_t vc = stress_wcs_vec_splat(c);
+	const stress_wcs_vec_t zero = stress_wcs_vec_splat(0);
+	const wchar_t *p, *last = NULL, *block = NULL, *tail = NULL;
+
+	if (!c)
+		return s + stress_wcs_simd_wcslen(s);
+
+	for (p = s; !WCS_VEC_ALIGNED(p); p++) {
+		if (!*p)
+			return last;
+		if (*p == c)
+			last = p;
+	}
+	/* remember the last block holding c before the terminator block */
+	for (;; p += WCS_VEC_CHARS) {
+		const stress_wcs_vec_t v = *(const stress_wcs_vec_t *)p;
+
+		if (stress_wcs_vec_any((stress_wcs_vec_t)(v == zero)))
+			break;
+		if (stress_wcs_vec_any((stress_wcs_vec_t)(v == vc)))
+			block = p;
+	}
+	for (; *p; p++) {
+		if (*p == c)
+			tail = p;
+	}
+	if (tail)
+		return tail;
+	if (!block)
+		return last;
+	for (p = block + WCS_VEC_CHARS - 1; *p != c; p--)
+		;
+	return p;
+}
+#endif
+
+#if defined(HAVE_WCSCMP)
+static OPTIMIZE3 int stress_wcs_simd_wcscmp(const wchar_t *s1, const wchar_t *s2)
+{
+	const stress_wcs_vec_t zero = stress_wcs_vec_splat(0);
+
+	for (;;) {
+		stress_wcs_vec_t v1, v2;
+
+		if (!WCS_VEC_PAGE_SAFE(s1) || !WCS_VEC_PAGE_SAFE(s2)) {
+			if ((*s1 != *s2) || !*s1)
+				break;
+			s1++;
+			s2++;
+			continue;
+		}
+		v1 = *(const stress_wcs_uvec_t *)s1;
+		v2 = *(const stress_wcs_uvec_t *)s2;
+		if (stress_wcs_vec_any((stress_wcs_vec_t)((v1 != v2) | (v1 == zero)))) {
+			while (*s1 && (*s1 == *s2)) {
+				s1++;
+				s2++;
+			}
+			break;
+		}
+		s1 += WCS_VEC_CHARS;
+		s2 += WCS_VEC_CHARS;
+	}
+	return (*s1 < *s2) ? -1 : (*s1 > *s2);
+}
+#endif
+
+#if defined(HAVE_WCSSTR)
+static inline bool stress_wcs_prefix(const wchar_t *s, const wchar_t *prefix, size_t n)
+{
+	for (; n; n--, s++, prefix++) {
+		if (*s != *prefix)
+			return false;
+	}
+	return true;
+}
+
+static OPTIMIZE3 const wchar_t *stress_wcs_simd_wcsstr(const wchar_t *hay, const wchar_t *needle)
+{
+	const size_t n = stress_wcs_simd_wcslen(needle);
+	const stress_wcs_vec_t zero = stress_wcs_vec_splat(0);
+	stress_wcs_vec_t vn0, vn1;
+	const wchar_t *p;
+
+	if (n < 2)
+		return n ? stress_wcs_simd_wcschr(hay, *needle) : hay;
+
+	/* filter on the first two needle chars, verify the candidates */
+	vn0 = stress_wcs_vec_splat(needle[0]);
+	vn1 = stress_wcs_vec_splat(needle[1]);
+	for (p = hay;; ) {
+		stress_wcs_vec_t v0, v1;
+		size_t i;
+
+		if (!WCS_VEC_PAGE_SAFE(p) || !WCS_VEC_PAGE_SAFE(p + 1)) {
+			if (!*p)
+				return NULL;
+			if ((*p == needle[0]) && stress_wcs_prefix(p, needle, n))
+				return p;
+			p++;
+			continue;
+		}
+		v0 = *(const stress_wcs_uvec_t *)p;
+		v1 = *(const stress_wcs_uvec_t *)(p + 1);
+		if (stress_wcs_vec_any((stress_wcs_vec_t)(((v0 == vn0) & (v1 == vn1)) | (v0 == zero)))) {
+			for (i = 0; i < WCS_VEC_CHARS; i++) {
+				if (!p[i])
+					return NULL;
+				if ((p[i] == needle[0]) && stress_wcs_prefix(p + i, needle, n))
+					return p + i;
+			}
+		}
+		p += WCS_VEC_CHARS;
+	}
+}
+#endif
+
+/*
+ *  sweep strings are len chars of a..y with a trailing z, the
+ *  scans return the offset of the z or the wcscmp sign so the
+ *  libc and simd results can be compared
+ */
+static inline size_t stress_wcs_offset(const wchar_t *s, const wchar_t *p)
+{
+	return p ? (size_t)(p - s) : ~(size_t)0;
+}
+
+static inline size_t stress_wcs_sign(const int ret)
+{
+	return (ret < 0) ? 0 : ((ret > 0) ? 2 : 1);
+}
+
+typedef size_t (*stress_wcs_sweep_func)(const wchar_t *s1, const wchar_t *s2, const size_t len);
+
+#define STRESS_WCS_SWEEP(name, libc_expr, simd_expr)			\
+static NOINLINE size_t stress_wcs_sweep_ ## name ## _libc(		\
+	const wchar_t *s1,						\
+	const wchar_t *s2,						\
+	const size_t len)						\
+{									\
+	(void)s2;							\
+	(void)len;							\
+	return libc_expr;						\
+}									\
+									\
+static NOINLINE size_t stress_wcs_sweep_ ## name ## _simd(		\
+	const wchar_t *s1,						\
+	const wchar_t *s2,						\
+	const size_t len)						\
+{									\
+	(void)s2;							\
+	(void)len;							\
+	return simd_expr;						\
+}
+
+STRESS_WCS_SWEEP(wcslen, wcslen(s1), stress_wcs_simd_wcslen(s1))
+#if defined(HAVE_WMEMCHR)
+STRESS_WCS_SWEEP(wmemchr, stress_wcs_offset(s1, wmemchr(s1, L'z', len)),
+	stress_wcs_offset(s1, stress_wcs_simd_wmemchr(s1, L'z', len)))
+#endif
+#if defined(HAVE_WCSCHR)
+STRESS_WCS_SWEEP(wcschr, stress_wcs_offset(s1, wcschr(s1, L'z')),
+	stress_wcs_offset(s1, stress_wcs_simd_wcschr(s1, L'z')))
+#endif
+#if defined(HAVE_WCSRCHR)
+STRESS_WCS_SWEEP(wcsrchr, stress_wcs_offset(s1, wcsrchr(s1, L'z')),
+	stress_wcs_offset(s1, stress_wcs_simd_wcsrchr(s1, L'z')))
+#endif
+#if defined(HAVE_WCSCMP)
+STRESS_WCS_SWEEP(wcscmp, stress_wcs_sign(wcscmp(s1, s2)),
+	stress_wcs_sign(stress_wcs_simd_wcscmp(s1, s2)))
+#endif
+#if defined(HAVE_WCSSTR)
+STRESS_WCS_SWEEP(wcsstr, stress_wcs_offset(s1, wcsstr(s1, s1 + len - WCS_SWEEP_NEEDLE)),
+	stress_wcs_offset(s1, stress_wcs_simd_wcsstr(s1, s1 + len - WCS_SWEEP_NEEDLE)))
+#endif
+
+typedef struct {
+	const char *name;
+	const stress_wcs_sweep_func func[WCS_SWEEP_IMPLS];
+} stress_wcs_sweep_info_t;
+
+static const stress_wcs_sweep_info_t wcs_sweeps[] = {
+	{ "wcslen",	{ stress_wcs_sweep_wcslen_libc,	stress_wcs_sweep_wcslen_simd } },
+#if defined(HAVE_WMEMCHR)
+	{ "wmemchr",	{ stress_wcs_sweep_wmemchr_libc, stress_wcs_sweep_wmemchr_simd } },
+#endif
+#if defined(HAVE_WCSCHR)
+	{ "wcschr",	{ stress_wcs_sweep_wcschr_libc,	stress_wcs_sweep_wcschr_simd } },
+#endif
+#if defined(HAVE_WCSRCHR)
+	{ "wcsrchr",	{ stress_wcs_sweep_wcsrchr_libc, stress_wcs_sweep_wcsrchr_simd } },
+#endif
+#if defined(HAVE_WCSCMP)
+	{ "wcscmp",	{ stress_wcs_sweep_wcscmp_libc,	stress_wcs_sweep_wcscmp_simd } },
+#endif
+#if defined(HAVE_WCSSTR)
+	{ "wcsstr",	{ stress_wcs_sweep_wcsstr_libc,	stress_wcs_sweep_wcsstr_simd } },
+#endif
+};
+
+#define WCS_SWEEPS	SIZEOF_ARRAY(wcs_sweeps)
+
+/* bytes scanned and scan time of each function, impl, alignment and length */
+typedef struct {
+	double bytes[WCS_SWEEPS][WCS_SWEEP_IMPLS][WCS_SWEEP_ALIGNS][WCS_SWEEP_LENGTHS];
+	double secs[WCS_SWEEPS][WCS_SWEEP_IMPLS][WCS_SWEEP_ALIGNS][WCS_SWEEP_LENGTHS];
+} stress_wcs_sweep_t;
+
+/*
+ *  stress_wcs_sweep()
+ *	time the libc and simd scans of one function over all the
+ *	string lengths and alignments
+ */
+static void stress_wcs_sweep(
+	const stress_args_t *args,
+	const size_t f,
+	stress_wcs_sweep_t *sweep,
+	wchar_t *buf1,
+	wchar_t *buf2,
+	bool *failed)
+{
+	size_t a, l, i;
+
+	for (a = 0; a < WCS_SWEEP_ALIGNS; a++) {
+		wchar_t *s1 = buf1 + wcs_sweep_align[a];
+		wchar_t *s2 = buf2 + wcs_sweep_align[a];
+
+		for (l = 0; l < WCS_SWEEP_LENGTHS; l++) {
+			const size_t len = (size_t)WCS_SWEEP_MIN << (2 * l);
+			const size_t bytes = len * sizeof(wchar_t);
+			const size_t reps = (bytes >= WCS_SWEEP_BYTES) ? 1 : WCS_SWEEP_BYTES / bytes;
+			size_t result[WCS_SWEEP_IMPLS];
+
+			for (i = 0; i < len - 1; i++)
+				s1[i] = (wchar_t)((stress_mwc8() % 25) + L'a');
+			s1[len - 1] = L'z';
+			s1[len] = L'\0';
+			(void)memcpy(s2, s1, (len + 1) * sizeof(wchar_t));
+
+			for (i = 0; i < WCS_SWEEP_IMPLS; i++) {
+				const stress_wcs_sweep_func func = wcs_sweeps[f].func[i];
+				uint64_t sum = 0;
+				double t;
+				size_t r;
+
+				t = stress_time_now();
+				for (r = 0; r < reps; r++)
+					sum += func(s1, s2, len);
+				sweep->secs[f][i][a][l] += stress_time_now() - t;
+				sweep->bytes[f][i][a][l] += (double)bytes * (double)reps;
+				stress_uint64_put(sum);
+				result[i] = func(s1, s2, len);
+			}
+			if ((g_opt_flags & OPT_FLAGS_VERIFY) && (result[0] != result[1])) {
+				pr_fail("%s: %s: %zu char string at alignment %zu, simd result %zu "
+					"does not match libc result %zu\n",
+					args->name, wcs_sweeps[f].name, len, wcs_sweep_align[a],
+					result[1], result[0]);
+				*failed = true;
+			}
+			if (!keep_stressing_flag())
+				return;
+		}
+	}
+}
+
+/*
+ *  stress_wcs_sweep_report()
+ *	report the GB/s of the libc and simd scans of each function
+ */
+static void stress_wcs_sweep_report(
+	const stress_args_t *args,
+	const stress_wcs_sweep_t *sweep,
+	const bool *used)
+{
+	size_t f, a, l, i;
+	int idx = 0;
+
+	for (f = 0; f < WCS_SWEEPS; f++) {
+		char line[256];
+		size_t len;
+
+		if (!used[f])
+			continue;
+		if (args->instance == 0) {
+			len = (size_t)snprintf(line, sizeof(line), "%-7s GB/s", wcs_sweeps[f].name);
+			for (a = 0; a < WCS_SWEEP_ALIGNS; a++) {
+				for (i = 0; i < WCS_SWEEP_IMPLS; i++)
+					len += (size_t)snprintf(line + len, sizeof(line) - len,
+						" %6s+%zu", wcs_sweep_impls[i], wcs_sweep_align[a]);
+			}
+			pr_inf("%s: %s\n", args->name, line);
+		}
+		for (l = 0; l < WCS_SWEEP_LENGTHS; l++) {
+			const size_t chars = (size_t)WCS_SWEEP_MIN << (2 * l);
+
+			if (chars >= KB)
+				len = (size_t)snprintf(line, sizeof(line), "%7zuK chars", (size_t)(chars / KB));
+			else
+				len = (size_t)snprintf(line, sizeof(line), "%7zu chars ", chars);
+			for (a = 0; a < WCS_SWEEP_ALIGNS; a++) {
+				for (i = 0; i < WCS_SWEEP_IMPLS; i++) {
+					const double secs = sweep->secs[f][i][a][l];
+					const double rate = (secs > 0.0) ?
+						sweep->bytes[f][i][a][l] / (secs * 1.0E9) : 0.0;
+
+					len += (size_t)snprintf(line + len, sizeof(line) - len,
+						" %8.2f", rate);
+					/* libc rate of the aligned 4K char strings */
+					if ((chars == 4 * KB) && (a == 0) && (i == 0) &&
+					    (idx < STRESS_MISC_STATS_MAX)) {
+						char desc[32];
+
+						(void)snprintf(desc, sizeof(desc), "%s 4K libc GB/s",
+							wcs_sweeps[f].name);
+						stress_misc_stats_set(args->misc_stats, idx++, desc, rate);
+					}
+				}
+			}
+			if (args->instance == 0)
+				pr_inf("%s: %s\n", args->name, line);
+		}
+	}
+}
+
+/*
+ *  stress_wcs_sweep_run()
+ *	each bogo-op is a sweep of one function, the all method
+ *	cycles through all the sweep functions
+ */
+static int stress_wcs_sweep_run(
+	const stress_args_t *args,
+	const stress_wcs_method_info_t *wcs_method)
+{
+	const size_t buf_size = (WCS_SWEEP_MAX * sizeof(wchar_t)) + args->page_size;
+	stress_wcs_sweep_t *sweep;
+	bool used[WCS_SWEEPS], failed = false;
+	wchar_t *buf1, *buf2;
+	size_t f, n = 0;
+
+	for (f = 0; f < WCS_SWEEPS; f++) {
+		used[f] = (wcs_method->func == stress_wcs_all) ||
+			  !strcmp(wcs_sweeps[f].name, wcs_method->name);
+		n += used[f];
+	}
+	if (!n) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: wcs-method '%s' is not supported by the sweep, "
+				"skipping stressor\n", args->name, wcs_method->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	sweep = calloc(1, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	buf1 = (wchar_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf1 == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte sweep buffer, skipping stressor\n",
+			args->name, buf_size);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+	buf2 = (wchar_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf2 == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte sweep buffer, skipping stressor\n",
+			args->name, buf_size);
+		(void)munmap((void *)buf1, buf_size);
+		free(sweep);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	f = 0;
+	do {
+		while (!used[f])
+			f = (f + 1) % WCS_SWEEPS;
+		stress_wcs_sweep(args, f, sweep, buf1, buf2, &failed);
+		f = (f + 1) % WCS_SWEEPS;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_wcs_sweep_report(args, sweep, used);
+
+	(void)munmap((void *)buf2, buf_size);
+	(void)munmap((void *)buf1, buf_size);
+	free(sweep);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_set_wcs_method()
  *	set the specified wcs stress method
@@ -702,6 +1228,21 @@ static int stress_wcs(const stress_args_t *args)
 	wchar_t ALIGN64 str1[STR1LEN], ALIGN64 str2[STR2LEN];
 	register wchar_t *ptr1, *ptr2;
 	size_t len1, len2;
+	bool wcs_sweep = false;
+
+	(void)stress_get_setting("wcs-sweep", &wcs_sweep);
+	if (wcs_sweep) {
+#if defined(HAVE_VECMATH) &&	\
+    defined(HAVE_WCSLEN)
+		(void)stress_get_setting("wcs-method", &wcs_method);
+		return stress_wcs_sweep_run(args, wcs_method);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: wcs-sweep needs wcslen and compiler vector support, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 
 	/* No wcs* functions available on this system? */
 	if (SIZEOF_ARRAY(wcs_methods) <= 2)
@@ -750,6 +1291,7 @@ static void stress_wcs_set_default(void)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_wcs_method,	stress_set_wcs_method },
+	{ OPT_wcs_sweep,	stress_set_wcs_sweep },
 	{ 0,			NULL }
 };
 
@@ -0,0 +1,627 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+
+#define MIN_WORKSTEAL_THREADS	(1)
+#define MAX_WORKSTEAL_THREADS	(256)
+
+#define MIN_WORKSTEAL_DEPTH	(1)
+#define MAX_WORKSTEAL_DEPTH	(22)
+#define DEFAULT_WORKSTEAL_DEPTH	(14)
+
+#define MIN_WORKSTEAL_GRAIN	(0)
+#define MAX_WORKSTEAL_GRAIN	(1000000)
+#define DEFAULT_WORKSTEAL_GRAIN	(1000)
+
+#define WORKSTEAL_DEQUE_SIZE	(64)		/* power of 2, > max depth + 1 */
+#define WORKSTEAL_SPINS		(20000)		/* spin-park spins before parking */
+#define WORKSTEAL_STEP		(0.5)		/* seconds per idle policy */
+
+#define WORKSTEAL_EMPTY		(-1)
+#define WORKSTEAL_ABORT		(-2)
+
+static const stress_help_t help[] = {
+	{ NULL,	"worksteal N",		"start N workers running fork/join task trees on a work-stealing pool" },
+	{ NULL,	"worksteal-depth N",	"fork/join task tree depth, 2^N leaf tasks per tree" },
+	{ NULL,	"worksteal-grain N",	"loop iterations of work per leaf task" },
+	{ NULL,	"worksteal-ops N",	"stop after N tasks" },
+	{ NULL,	"worksteal-park P",	"idle policy, spin-park, futex-park or all" },
+	{ NULL,	"worksteal-threads N",	"number of pool threads, default is the number of CPUs" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const worksteal_parks[] = {
+	"all",
+	"spin-park",
+	"futex-park",
+};
+
+static int stress_set_worksteal_depth(const char *opt)
+{
+	uint32_t worksteal_depth;
+
+	worksteal_depth = stress_get_uint32(opt);
+	stress_check_range("worksteal-depth", (uint64_t)worksteal_depth,
+		MIN_WORKSTEAL_DEPTH, MAX_WORKSTEAL_DEPTH);
+	return stress_set_setting("worksteal-depth", TYPE_ID_UINT32, &worksteal_depth);
+}
+
+static int stress_set_worksteal_grain(const char *opt)
+{
+	uint32_t worksteal_grain;
+
+	worksteal_grain = stress_get_uint32(opt);
+	stress_check_range("worksteal-grain", (uint64_t)worksteal_grain,
+		MIN_WORKSTEAL_GRAIN, MAX_WORKSTEAL_GRAIN);
+	return stress_set_setting("worksteal-grain", TYPE_ID_UINT32, &worksteal_grain);
+}
+
+static int stress_set_worksteal_park(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(worksteal_parks); i++) {
+		if (!strcmp(opt, worksteal_parks[i]))
+			return stress_set_setting("worksteal-park", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "worksteal-park must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(worksteal_parks); i++)
+		(void)fprintf(stderr, " %s", worksteal_parks[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_worksteal_threads(const char *opt)
+{
+	uint32_t worksteal_threads;
+
+	worksteal_threads = stress_get_uint32(opt);
+	stress_check_range("worksteal-threads", (uint64_t)worksteal_threads,
+		MIN_WORKSTEAL_THREADS, MAX_WORKSTEAL_THREADS);
+	return stress_set_setting("worksteal-threads", TYPE_ID_UINT32, &worksteal_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_worksteal_depth,		stress_set_worksteal_depth },
+	{ OPT_worksteal_grain,		stress_set_worksteal_grain },
+	{ OPT_worksteal_park,		stress_set_worksteal_park },
+	{ OPT_worksteal_threads,	stress_set_worksteal_threads },
+	{ 0,				NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC) &&		\
+    defined(__linux__)
+
+#define WORKSTEAL_PARKS		(SIZEOF_ARRAY(worksteal_parks) - 1)
+#define WORKSTEAL_SPIN_PARK	(0)
+#define WORKSTEAL_FUTEX_PARK	(1)
+
+/* per pool thread Chase-Lev deque and statistics */
+typedef struct {
+	int64_t top ALIGN64;			/* thieves take from the top */
+	int64_t bottom ALIGN64;			/* the owner pushes and pops at the bottom */
+	int32_t tasks[WORKSTEAL_DEQUE_SIZE];
+
+	uint64_t executed ALIGN64;		/* tasks run */
+	uint64_t steals;			/* tasks stolen from others */
+	uint64_t steal_attempts;
+	uint64_t parks;				/* futex waits */
+	uint64_t idle_ns;			/* time spent without work */
+	uint64_t sink;				/* leaf work results */
+	uint32_t rnd;				/* victim selection */
+	uint32_t id;
+	pthread_t pthread;
+	int ret;
+	struct stress_worksteal *ws;
+} ALIGN64 stress_worksteal_thread_t;
+
+typedef struct stress_worksteal {
+	uint32_t epoch ALIGN64;			/* futex, bumped when work is available */
+	uint32_t n_parked ALIGN64;		/* threads parked or about to park */
+	uint32_t inject ALIGN64;		/* a new tree root is waiting */
+	uint32_t tree_done ALIGN64;		/* futex, root task completed */
+	volatile bool stop;
+	uint32_t *pending ALIGN64;		/* per node outstanding child count */
+	uint32_t depth;
+	uint32_t grain;
+	uint32_t n_threads;
+	size_t park;
+	stress_worksteal_thread_t *threads;
+} stress_worksteal_t;
+
+typedef struct {
+	uint64_t tasks;
+	uint64_t steals;
+	uint64_t steal_attempts;
+	uint64_t parks;
+	uint64_t idle_ns;
+	uint64_t trees;
+	double tree_time;			/* total tree run time */
+	double duration;			/* total phase time */
+	double thread_time;			/* duration * threads */
+} stress_worksteal_stats_t;
+
+static inline void stress_worksteal_relax(void)
+{
+#if defined(HAVE_ASM_X86_PAUSE)
+	__asm__ __volatile__("pause;\n" ::: "memory");
+#else
+	shim_mb();
+#endif
+}
+
+/*
+ *  Chase-Lev work-stealing deque, the owner pushes and takes at the
+ *  bottom without contention, thieves CAS the top
+ */
+static inline void stress_worksteal_push(stress_worksteal_thread_t *t, const int32_t task)
+{
+	const int64_t b = __atomic_load_n(&t->bottom, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&t->tasks[b & (WORKSTEAL_DEQUE_SIZE - 1)], task, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&t->bottom, b + 1, __ATOMIC_RELAXED);
+}
+
+static inline int32_t stress_worksteal_take(stress_worksteal_thread_t *t)
+{
+	const int64_t b = __atomic_load_n(&t->bottom, __ATOMIC_RELAXED) - 1;
+	int64_t top;
+	int32_t task;
+
+	__atomic_store_n(&t->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&t->top, __ATOMIC_RELAXED);
+	if (top > b) {
+		__atomic_store_n(&t->bottom, b + 1, __ATOMIC_RELAXED);
+		return WORKSTEAL_EMPTY;
+	}
+	task = __atomic_load_n(&t->tasks[b & (WORKSTEAL_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if (top == b) {
+		/* last task, race any thieves for it */
+		if (!__atomic_compare_exchange_n(&t->top, &top, top + 1, false,
+				__ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			task = WORKSTEAL_EMPTY;
+		__atomic_store_n(&t->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return task;
+}
+
+static inline int32_t stress_worksteal_steal(stress_worksteal_thread_t *victim)
+{
+	int64_t top = __atomic_load_n(&victim->top, __ATOMIC_ACQUIRE);
+	int64_t b;
+	int32_t task;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&victim->bottom, __ATOMIC_ACQUIRE);
+	if (top >= b)
+		return WORKSTEAL_EMPTY;
+	task = __atomic_load_n(&victim->tasks[top & (WORKSTEAL_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&victim->top, &top, top + 1, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return WORKSTEAL_ABORT;
+	return task;
+}
+
+/*
+ *  stress_worksteal_wake()
+ *	wake a parked thread if there are any, new work is available
+ */
+static inline void stress_worksteal_wake(stress_worksteal_t *ws)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ws->n_parked, __ATOMIC_RELAXED)) {
+		__atomic_add_fetch(&ws->epoch, 1, __ATOMIC_SEQ_CST);
+		(void)shim_futex_wake(&ws->epoch, 1);
+	}
+}
+
+/*
+ *  stress_worksteal_complete()
+ *	a task and all its children are done, complete the parent
+ *	when this was its last outstanding child
+ */
+static void stress_worksteal_complete(stress_worksteal_t *ws, int32_t task)
+{
+	while (task > 0) {
+		const int32_t parent = (task - 1) / 2;
+
+		if (__atomic_sub_fetch(&ws->pending[parent], 1, __ATOMIC_ACQ_REL))
+			return;
+		task = parent;
+	}
+	__atomic_store_n(&ws->tree_done, 1, __ATOMIC_RELEASE);
+	(void)shim_futex_wake(&ws->tree_done, 1);
+}
+
+/*
+ *  stress_worksteal_run()
+ *	run a task, the tree is implicit, node n has children 2n + 1 and
+ *	2n + 2. The right child is pushed for others to steal and the
+ *	left child is run directly until a leaf is reached.
+ */
+static void stress_worksteal_run(
+	stress_worksteal_t *ws,
+	stress_worksteal_thread_t *t,
+	int32_t task,
+	uint32_t level)
+{
+	uint64_t x = t->sink;
+	uint32_t i;
+
+	while (level < ws->depth) {
+		__atomic_store_n(&ws->pending[task], 2, __ATOMIC_RELAXED);
+		stress_worksteal_push(t, (2 * task) + 2);
+		stress_worksteal_wake(ws);
+		t->executed++;
+		task = (2 * task) + 1;
+		level++;
+	}
+	for (i = 0; i < ws->grain; i++)
+		x = (x * 6364136223846793005ULL) + 1442695040888963407ULL;
+	t->sink = x;
+	t->executed++;
+	stress_worksteal_complete(ws, task);
+}
+
+/*
+ *  stress_worksteal_level()
+ *	tree level of node task
+ */
+static inline uint32_t stress_worksteal_level(int32_t task)
+{
+	uint32_t level = 0;
+
+	while (task > 0) {
+		task = (task - 1) / 2;
+		level++;
+	}
+	return level;
+}
+
+/*
+ *  stress_worksteal_find()
+ *	find work, a new tree root or a task stolen from a random victim
+ */
+static int32_t stress_worksteal_find(stress_worksteal_t *ws, stress_worksteal_thread_t *t)
+{
+	uint32_t i;
+
+	if (__atomic_load_n(&ws->inject, __ATOMIC_RELAXED) &&
+	    __atomic_exchange_n(&ws->inject, 0, __ATOMIC_ACQUIRE))
+		return 0;
+	if (ws->n_threads < 2)
+		return WORKSTEAL_EMPTY;
+
+	for (i = 0; i < 2 * ws->n_threads; i++) {
+		stress_worksteal_thread_t *victim;
+		int32_t task;
+
+		t->rnd ^= t->rnd << 13;
+		t->rnd ^= t->rnd >> 17;
+		t->rnd ^= t->rnd << 5;
+		victim = &ws->threads[t->rnd % ws->n_threads];
+		if (victim == t)
+			continue;
+		t->steal_attempts++;
+		task = stress_worksteal_steal(victim);
+		if (task >= 0) {
+			t->steals++;
+			return task;
+		}
+	}
+	return WORKSTEAL_EMPTY;
+}
+
+/*
+ *  stress_worksteal_anywork()
+ *	check for work before parking so a wakeup is not missed
+ */
+static bool stress_worksteal_anywork(stress_worksteal_t *ws)
+{
+	uint32_t i;
+
+	if (__atomic_load_n(&ws->inject, __ATOMIC_SEQ_CST))
+		return true;
+	for (i = 0; i < ws->n_threads; i++) {
+		const stress_worksteal_thread_t *t = &ws->threads[i];
+
+		if (__atomic_load_n(&t->top, __ATOMIC_SEQ_CST) <
+		    __atomic_load_n(&t->bottom, __ATOMIC_SEQ_CST))
+			return true;
+	}
+	return false;
+}
+
+/*
+ *  stress_worksteal_idle()
+ *	no work was found, spin a while (spin-park) and then park on
+ *	the epoch futex until new work is pushed
+ */
+static int32_t stress_worksteal_idle(stress_worksteal_t *ws, stress_worksteal_thread_t *t)
+{
+	const uint64_t t_idle = stress_latency_now();
+	int32_t task = WORKSTEAL_EMPTY;
+
+	if (ws->park == WORKSTEAL_SPIN_PARK) {
+		uint32_t spins;
+
+		for (spins = 0; !ws->stop && (spins < WORKSTEAL_SPINS); spins++) {
+			stress_worksteal_relax();
+			if ((spins & 63) == 0) {
+				task = stress_worksteal_find(ws, t);
+				if (task >= 0)
+					goto done;
+			}
+		}
+	}
+
+	while (!ws->stop) {
+		const uint32_t epoch = __atomic_load_n(&ws->epoch, __ATOMIC_SEQ_CST);
+
+		task = stress_worksteal_find(ws, t);
+		if (task >= 0)
+			break;
+		__atomic_add_fetch(&ws->n_parked, 1, __ATOMIC_SEQ_CST);
+		if (!stress_worksteal_anywork(ws) && !ws->stop) {
+			t->parks++;
+			(void)shim_futex_wait(&ws->epoch, (int)epoch, NULL);
+		}
+		__atomic_sub_fetch(&ws->n_parked, 1, __ATOMIC_SEQ_CST);
+	}
+done:
+	t->idle_ns += stress_latency_now() - t_idle;
+	return task;
+}
+
+/*
+ *  stress_worksteal_thread()
+ *	run local tasks, steal when there are none, idle when there
+ *	is nothing to steal
+ */
+static void *stress_worksteal_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_worksteal_thread_t *t = (stress_worksteal_thread_t *)arg;
+	stress_worksteal_t *ws = t->ws;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!ws->stop) {
+		int32_t task = stress_worksteal_take(t);
+
+		if (task < 0)
+			task = stress_worksteal_find(ws, t);
+		if (task < 0)
+			task = stress_worksteal_idle(ws, t);
+		if (task >= 0)
+			stress_worksteal_run(ws, t, task, stress_worksteal_level(task));
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_worksteal_phase()
+ *	start a pool with the given idle policy and run task trees one
+ *	after another for WORKSTEAL_STEP seconds
+ */
+static int stress_worksteal_phase(
+	const stress_args_t *args,
+	stress_worksteal_t *ws,
+	const size_t park,
+	stress_worksteal_stats_t *stats)
+{
+	const struct timespec timeout = { 0, 10000000 };
+	uint32_t i, started = 0;
+	double t_start, t_end;
+	uint64_t tasks = 0;
+	int rc = EXIT_SUCCESS;
+
+	ws->epoch = 0;
+	ws->n_parked = 0;
+	ws->inject = 0;
+	ws->stop = false;
+	ws->park = park;
+	(void)memset(ws->threads, 0, sizeof(*ws->threads) * ws->n_threads);
+
+	for (i = 0; i < ws->n_threads; i++) {
+		stress_worksteal_thread_t *t = &ws->threads[i];
+
+		t->ws = ws;
+		t->id = i;
+		t->rnd = stress_mwc32() | 1;
+		t->ret = pthread_create(&t->pthread, NULL, stress_worksteal_thread, (void *)t);
+		if (t->ret)
+			break;
+		started++;
+	}
+	if (started < ws->n_threads) {
+		pr_inf_skip("%s: cannot create %" PRIu32 " pthreads, errno=%d (%s), "
+			"skipping stressor\n", args->name, ws->n_threads,
+			ws->threads[started].ret, strerror(ws->threads[started].ret));
+		ws->stop = true;
+		ws->n_threads = started;
+		rc = EXIT_NO_RESOURCE;
+	}
+
+	t_start = stress_time_now();
+	t_end = t_start + WORKSTEAL_STEP;
+	while (!ws->stop && keep_stressing(args) && (stress_time_now() < t_end)) {
+		const double t_tree = stress_time_now();
+
+		__atomic_store_n(&ws->tree_done, 0, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&ws->inject, 1, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&ws->epoch, 1, __ATOMIC_SEQ_CST);
+		(void)shim_futex_wake(&ws->epoch, 1);
+		while (!__atomic_load_n(&ws->tree_done, __ATOMIC_ACQUIRE) && keep_stressing_flag())
+			(void)shim_futex_wait(&ws->tree_done, 0, &timeout);
+		if (!__atomic_load_n(&ws->tree_done, __ATOMIC_ACQUIRE))
+			break;
+		stats->tree_time += stress_time_now() - t_tree;
+		stats->trees++;
+		/* all the tasks of a tree are done, count them as bogo ops */
+		add_counter(args, (2ULL << ws->depth) - 1);
+	}
+
+	ws->stop = true;
+	__atomic_add_fetch(&ws->epoch, 1, __ATOMIC_SEQ_CST);
+	(void)shim_futex_wake(&ws->epoch, INT_MAX);
+	for (i = 0; i < started; i++)
+		(void)pthread_join(ws->threads[i].pthread, NULL);
+	if (started)
+		stats->duration += stress_time_now() - t_start;
+
+	for (i = 0; i < started; i++) {
+		const stress_worksteal_thread_t *t = &ws->threads[i];
+
+		tasks += t->executed;
+		stats->steals += t->steals;
+		stats->steal_attempts += t->steal_attempts;
+		stats->parks += t->parks;
+		stats->idle_ns += t->idle_ns;
+	}
+	stats->tasks += tasks;
+	stats->thread_time += (stress_time_now() - t_start) * (double)started;
+
+	return rc;
+}
+
+/*
+ *  stress_worksteal()
+ *	stress a work-stealing thread pool running fork/join task trees
+ */
+static int stress_worksteal(const stress_args_t *args)
+{
+	static stress_worksteal_stats_t stats[WORKSTEAL_PARKS];
+	stress_worksteal_t ws;
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t worksteal_threads = (cpus > 1) ? (uint32_t)cpus : 2;
+	uint32_t worksteal_depth = DEFAULT_WORKSTEAL_DEPTH;
+	uint32_t worksteal_grain = DEFAULT_WORKSTEAL_GRAIN;
+	size_t worksteal_park = 0, pending_size, threads_size, i, idx = 0;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("worksteal-depth", &worksteal_depth);
+	(void)stress_get_setting("worksteal-grain", &worksteal_grain);
+	(void)stress_get_setting("worksteal-park", &worksteal_park);
+	if (!stress_get_setting("worksteal-threads", &worksteal_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			worksteal_threads = MAX_WORKSTEAL_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			worksteal_threads = MIN_WORKSTEAL_THREADS;
+	}
+	if (worksteal_threads > MAX_WORKSTEAL_THREADS)
+		worksteal_threads = MAX_WORKSTEAL_THREADS;
+
+	(void)memset(&ws, 0, sizeof(ws));
+	ws.depth = worksteal_depth;
+	ws.grain = worksteal_grain;
+	ws.n_threads = worksteal_threads;
+
+	pending_size = sizeof(*ws.pending) << (worksteal_depth + 1);
+	ws.pending = (uint32_t *)mmap(NULL, pending_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ws.pending == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes for the task tree, skipping stressor\n",
+			args->name, pending_size);
+		return EXIT_NO_RESOURCE;
+	}
+	threads_size = sizeof(*ws.threads) * worksteal_threads;
+	ws.threads = (stress_worksteal_thread_t *)mmap(NULL, threads_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ws.threads == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zd bytes for the thread state, skipping stressor\n",
+			args->name, threads_size);
+		(void)munmap((void *)ws.pending, pending_size);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(stats, 0, sizeof(stats));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; keep_stressing(args) && (i < WORKSTEAL_PARKS); i++) {
+			if (worksteal_park && (worksteal_park != i + 1))
+				continue;
+			rc = stress_worksteal_phase(args, &ws, i, &stats[i]);
+			if (rc != EXIT_SUCCESS)
+				break;
+		}
+	} while ((rc == EXIT_SUCCESS) && keep_stressing(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " threads, %" PRIu64 " tasks per tree, grain %" PRIu32 "\n",
+			args->name, ws.n_threads, (uint64_t)((2ULL << worksteal_depth) - 1), worksteal_grain);
+	for (i = 0; i < WORKSTEAL_PARKS; i++) {
+		const stress_worksteal_stats_t *st = &stats[i];
+		const char *name = worksteal_parks[i + 1];
+		double mtasks, steal_pc, idle_pc, parks;
+		char desc[40];
+
+		if (!st->trees || (st->duration <= 0.0))
+			continue;
+		mtasks = ((double)st->tasks / st->duration) / 1000000.0;
+		steal_pc = st->tasks ? 100.0 * (double)st->steals / (double)st->tasks : 0.0;
+		idle_pc = (st->thread_time > 0.0) ?
+			100.0 * ((double)st->idle_ns / (double)STRESS_NANOSECOND) / st->thread_time : 0.0;
+		parks = (double)st->parks / st->duration;
+
+		if (args->instance == 0)
+			pr_inf("%s: %-10s %8.3f Mtasks/s, %5.1f%% stolen (%.1f%% of attempts), "
+				"%5.1f%% idle, %.0f parks/s, %.3f ms per tree\n",
+				args->name, name, mtasks, steal_pc,
+				st->steal_attempts ? 100.0 * (double)st->steals / (double)st->steal_attempts : 0.0,
+				idle_pc, parks, 1000.0 * st->tree_time / (double)st->trees);
+		(void)snprintf(desc, sizeof(desc), "%s Mtasks/s", name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, mtasks);
+		(void)snprintf(desc, sizeof(desc), "%s tasks stolen %%", name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, steal_pc);
+		(void)snprintf(desc, sizeof(desc), "%s idle time %%", name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, idle_pc);
+		(void)snprintf(desc, sizeof(desc), "%s parks per sec", name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, parks);
+	}
+
+	(void)munmap((void *)ws.threads, threads_size);
+	(void)munmap((void *)ws.pending, pending_size);
+
+	return rc;
+}
+
+stressor_info_t stress_worksteal_info = {
+	.stressor = stress_worksteal,
+	.class = CLASS_SCHEDULER | CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_ALWAYS,
+	.help = help
+};
+#else
+stressor_info_t stress_worksteal_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_SCHEDULER | CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
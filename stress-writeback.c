@@ -0,0 +1,297 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-io-buf.h"
+#include "core-latency.h"
+
+#define MIN_WRITEBACK_BYTES	(1 * MB)
+#define MAX_WRITEBACK_BYTES	(MAX_FILE_LIMIT)
+#define DEFAULT_WRITEBACK_BYTES	(1 * GB)
+
+#define MIN_WRITEBACK_RATE	(0)		/* unlimited */
+#define MAX_WRITEBACK_RATE	(64ULL * GB)
+#define DEFAULT_WRITEBACK_RATE	(0)
+
+#define WRITEBACK_WRITE_SIZE	(64 * KB)
+#define WRITEBACK_SAMPLE_NS	(100000000ULL)	/* /proc/meminfo sample period */
+#define WRITEBACK_STALL_NS	(10000000ULL)	/* writes slower than 10ms */
+
+/* /proc/meminfo Dirty and Writeback samples */
+typedef struct {
+	uint64_t samples;	/* number of samples */
+	double dirty_sum;	/* sum of Dirty KB */
+	double writeback_sum;	/* sum of Writeback KB */
+	uint64_t dirty_max;	/* max Dirty KB */
+	uint64_t writeback_max;	/* max Writeback KB */
+	uint64_t dirty;		/* last Dirty KB */
+	uint64_t writeback;	/* last Writeback KB */
+} stress_writeback_meminfo_t;
+
+static const stress_help_t help[] = {
+	{ NULL,	"writeback N",		"start N workers measuring buffered write stalls" },
+	{ NULL,	"writeback-bytes N",	"size of the file written per worker" },
+	{ NULL,	"writeback-ops N",	"stop after N 64K writes" },
+	{ NULL,	"writeback-rate N",	"write at N bytes per second, 0 is unlimited" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_writeback_bytes(const char *opt)
+{
+	uint64_t writeback_bytes;
+
+	writeback_bytes = stress_get_uint64_byte_filesystem(opt, 1);
+	stress_check_range_bytes("writeback-bytes", writeback_bytes,
+		MIN_WRITEBACK_BYTES, MAX_WRITEBACK_BYTES);
+	return stress_set_setting("writeback-bytes", TYPE_ID_UINT64, &writeback_bytes);
+}
+
+static int stress_set_writeback_rate(const char *opt)
+{
+	uint64_t writeback_rate;
+
+	writeback_rate = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("writeback-rate", writeback_rate,
+		MIN_WRITEBACK_RATE, MAX_WRITEBACK_RATE);
+	return stress_set_setting("writeback-rate", TYPE_ID_UINT64, &writeback_rate);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_writeback_bytes,	stress_set_writeback_bytes },
+	{ OPT_writeback_rate,	stress_set_writeback_rate },
+	{ 0,			NULL }
+};
+
+#if defined(__linux__)
+
+/*
+ *  stress_writeback_sample()
+ *	sample the Dirty and Writeback page cache sizes
+ */
+static void stress_writeback_sample(stress_writeback_meminfo_t *meminfo)
+{
+	uint64_t dirty, writeback;
+
+	if (stress_get_meminfo_dirty(&dirty, &writeback) < 0)
+		return;
+	meminfo->samples++;
+	meminfo->dirty_sum += (double)dirty;
+	meminfo->writeback_sum += (double)writeback;
+	if (meminfo->dirty_max < dirty)
+		meminfo->dirty_max = dirty;
+	if (meminfo->writeback_max < writeback)
+		meminfo->writeback_max = writeback;
+	meminfo->dirty = dirty;
+	meminfo->writeback = writeback;
+}
+
+/*
+ *  stress_writeback
+ *	stream buffered writes and measure how long each write
+ *	is stalled by dirty page throttling
+ */
+static int stress_writeback(const stress_args_t *args)
+{
+	uint64_t writeback_bytes = DEFAULT_WRITEBACK_BYTES;
+	uint64_t writeback_rate = DEFAULT_WRITEBACK_RATE;
+	uint64_t offset = 0, total = 0, stalls = 0;
+	uint64_t t_start, t_sample, worst = 0;
+	uint64_t worst_dirty = 0, worst_writeback = 0;
+	stress_writeback_meminfo_t meminfo;
+	stress_io_buf_pool_t pool;
+	stress_latency_t *lat, local_lat;
+	char filename[PATH_MAX];
+	const char *fs_type;
+	uint8_t *buf;
+	double duration;
+	int fd, ret, rc = EXIT_SUCCESS;
+
+	if (!stress_get_setting("writeback-bytes", &writeback_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			writeback_bytes = MAXIMIZED_FILE_SIZE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			writeback_bytes = MIN_WRITEBACK_BYTES;
+	}
+	writeback_bytes /= args->num_instances;
+	if (writeback_bytes < MIN_WRITEBACK_BYTES)
+		writeback_bytes = MIN_WRITEBACK_BYTES;
+	(void)stress_get_setting("writeback-rate", &writeback_rate);
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0)
+		return stress_exit_status(-ret);
+
+	(void)stress_temp_dir_args(args, filename, sizeof(filename));
+	if (stress_io_buf_pool_alloc(args, &pool, filename, WRITEBACK_WRITE_SIZE, 1, 0) < 0) {
+		pr_inf_skip("%s: cannot allocate write buffer, skipping stressor\n",
+			args->name);
+		(void)stress_temp_dir_rm_args(args);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = stress_io_buf_get(&pool, 0);
+	stress_mwc_fill(buf, WRITEBACK_WRITE_SIZE);
+
+	(void)stress_temp_filename_args(args,
+		filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto free_buf;
+	}
+	fs_type = stress_fs_type(filename);
+	(void)shim_unlink(filename);
+
+	/* per write latencies go into the --latency histogram if enabled */
+	if (args->latency) {
+		lat = args->latency;
+	} else {
+		stress_latency_reset(&local_lat);
+		lat = &local_lat;
+	}
+	(void)memset(&meminfo, 0, sizeof(meminfo));
+	stress_writeback_sample(&meminfo);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	t_start = stress_latency_now();
+	t_sample = t_start;
+	do {
+		uint64_t t, now;
+		ssize_t n;
+
+		/* append, a full file is truncated like a rotated log */
+		if (offset + WRITEBACK_WRITE_SIZE > writeback_bytes) {
+			if (ftruncate(fd, 0) < 0) {
+				rc = stress_exit_status(errno);
+				pr_fail("%s: ftruncate failed, errno=%d (%s)%s\n",
+					args->name, errno, strerror(errno), fs_type);
+				break;
+			}
+			offset = 0;
+		}
+
+		t = stress_latency_now();
+		n = pwrite(fd, buf, WRITEBACK_WRITE_SIZE, (off_t)offset);
+		now = stress_latency_now();
+		if (n < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			if (errno == ENOSPC) {
+				offset = writeback_bytes;
+				continue;
+			}
+			rc = stress_exit_status(errno);
+			pr_fail("%s: write failed, errno=%d (%s)%s\n",
+				args->name, errno, strerror(errno), fs_type);
+			break;
+		}
+		stress_latency_record(lat, now - t);
+		if ((now - t) > WRITEBACK_STALL_NS)
+			stalls++;
+		offset += (uint64_t)n;
+		total += (uint64_t)n;
+		inc_counter(args);
+
+		if ((now - t_sample) >= WRITEBACK_SAMPLE_NS) {
+			stress_writeback_sample(&meminfo);
+			t_sample = now;
+		}
+		/* the worst stall and the dirty state closest to it */
+		if ((now - t) > worst) {
+			worst = now - t;
+			stress_writeback_sample(&meminfo);
+			worst_dirty = meminfo.dirty;
+			worst_writeback = meminfo.writeback;
+		}
+
+		if (writeback_rate) {
+			const uint64_t due = t_start +
+				(uint64_t)(((double)total * STRESS_NANOSECOND) / (double)writeback_rate);
+
+			now = stress_latency_now();
+			if (due > now)
+				(void)shim_nanosleep_uint64(due - now);
+		}
+	} while (keep_stressing(args));
+
+	duration = (double)(stress_latency_now() - t_start) / (double)STRESS_NANOSECOND;
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((duration > 0.0) && lat->count) {
+		const double mean_dirty = meminfo.samples ?
+			meminfo.dirty_sum / (double)meminfo.samples : 0.0;
+		const double mean_writeback = meminfo.samples ?
+			meminfo.writeback_sum / (double)meminfo.samples : 0.0;
+		static const double percentiles[] = { 50.0, 99.0, 99.9 };
+		size_t i;
+
+		if (args->instance == 0) {
+			pr_inf("%s: worst write stall %.3f ms with %.1f MB dirty, "
+				"%.1f MB under writeback%s\n", args->name,
+				(double)worst / 1000000.0,
+				(double)worst_dirty / 1024.0,
+				(double)worst_writeback / 1024.0, fs_type);
+		}
+		stress_misc_stats_set(args->misc_stats, 0, "write MB per sec",
+			((double)total / duration) / (double)MB);
+		for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+			char desc[40];
+
+			(void)snprintf(desc, sizeof(desc), "write p%g latency (usec)",
+				percentiles[i]);
+			stress_misc_stats_set(args->misc_stats, 1 + i, desc,
+				(double)stress_latency_percentile(lat, percentiles[i]) / 1000.0);
+		}
+		stress_misc_stats_set(args->misc_stats, 4, "write max latency (usec)",
+			(double)lat->max / 1000.0);
+		stress_misc_stats_set(args->misc_stats, 5, "writes stalled > 10ms",
+			(double)stalls);
+		stress_misc_stats_set(args->misc_stats, 6, "Dirty MB (mean)",
+			mean_dirty / 1024.0);
+		stress_misc_stats_set(args->misc_stats, 7, "Dirty MB (max)",
+			(double)meminfo.dirty_max / 1024.0);
+		stress_misc_stats_set(args->misc_stats, 8, "Writeback MB (mean)",
+			mean_writeback / 1024.0);
+		stress_misc_stats_set(args->misc_stats, 9, "Writeback MB (max)",
+			(double)meminfo.writeback_max / 1024.0);
+	}
+
+	(void)close(fd);
+free_buf:
+	stress_io_buf_pool_free(&pool);
+	(void)stress_temp_dir_rm_args(args);
+
+	return rc;
+}
+
+stressor_info_t stress_writeback_info = {
+	.stressor = stress_writeback,
+	.class = CLASS_IO | CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_writeback_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_IO | CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#endif
@@ -31,10 +31,37 @@
 #error cannot have both HAVE_SYS_XATTR_H and HAVE_ATTR_XATTR_H
 #endif
 
+#define MIN_XATTR_THREADS	(1)
+#define MAX_XATTR_THREADS	(64)
+#define DEFAULT_XATTR_THREADS	(4)
+
 static const stress_help_t help[] = {
-	{ NULL,	"xattr N",	"start N workers stressing file extended attributes" },
-	{ NULL,	"xattr-ops N",	"stop after N bogo xattr operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"xattr N",		"start N workers stressing file extended attributes" },
+	{ NULL,	"xattr-bench",		"measure xattr op rates against value size and count" },
+	{ NULL,	"xattr-ops N",		"stop after N bogo xattr operations" },
+	{ NULL,	"xattr-threads N",	"maximum concurrent threads for --xattr-bench" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_xattr_bench(const char *opt)
+{
+	return stress_set_setting_true("xattr-bench", opt);
+}
+
+static int stress_set_xattr_threads(const char *opt)
+{
+	uint32_t xattr_threads;
+
+	xattr_threads = stress_get_uint32(opt);
+	stress_check_range("xattr-threads", (uint64_t)xattr_threads,
+		MIN_XATTR_THREADS, MAX_XATTR_THREADS);
+	return stress_set_setting("xattr-threads", TYPE_ID_UINT32, &xattr_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_xattr_bench,	stress_set_xattr_bench },
+	{ OPT_xattr_threads,	stress_set_xattr_threads },
+	{ 0,			NULL }
 };
 
 #if (defined(HAVE_SYS_XATTR_H) ||	\
@@ -49,6 +76,439 @@ static const stress_help_t help[] = {
 
 #define MAX_XATTRS		(4096)
 
+#define XATTR_BENCH_TIME	(0.1)		/* seconds per measurement */
+#define XATTR_BENCH_THREAD_TIME	(0.25)		/* seconds per thread measurement */
+#define XATTR_BENCH_VALUE_MAX	(64 * KB)
+#define XATTR_BENCH_LIST_MAX	(64 * KB)
+#define XATTR_BENCH_COUNT_SIZE	(32)		/* value size for the count sweep */
+#define XATTR_BENCH_THREAD_SIZE	(64)		/* value size for the thread sweep */
+#define XATTR_BENCH_THREAD_ATTRS (16)		/* attributes per inode for threads */
+#define XATTR_BENCH_MAX_POINTS	(8)
+
+enum {
+	XATTR_BENCH_SET,
+	XATTR_BENCH_GET,
+	XATTR_BENCH_LIST,
+	XATTR_BENCH_OPS,
+};
+
+enum {
+	XATTR_BENCH_SAME,
+	XATTR_BENCH_DIFF,
+};
+
+static const size_t xattr_bench_sizes[] = {
+	16, 64, 256, 1 * KB, 2 * KB, 4 * KB, 16 * KB, 64 * KB
+};
+
+static const uint32_t xattr_bench_counts[] = {
+	1, 4, 16, 64, 256, 1024
+};
+
+typedef struct {
+	/* K ops per second, < 0 if not measured */
+	double size_rate[SIZEOF_ARRAY(xattr_bench_sizes)][XATTR_BENCH_OPS];
+	double count_rate[SIZEOF_ARRAY(xattr_bench_counts)][XATTR_BENCH_OPS];
+	int size_spill[SIZEOF_ARRAY(xattr_bench_sizes)];	/* -1 unknown, 0 no, 1 yes */
+	int count_spill[SIZEOF_ARRAY(xattr_bench_counts)];
+	uint32_t threads[XATTR_BENCH_MAX_POINTS];
+	double thread_rate[XATTR_BENCH_MAX_POINTS][2];
+	size_t n_points;
+} stress_xattr_bench_t;
+
+static inline void stress_xattr_bench_name(char *name, const size_t len, const uint32_t i)
+{
+	(void)snprintf(name, len, "user.bench_%5.5" PRIu32, i);
+}
+
+/*
+ *  stress_xattr_bench_file()
+ *	create an empty unlinked file with n attributes of size bytes,
+ *	sets spill to 1 if the attributes needed blocks outside the inode
+ */
+static int stress_xattr_bench_file(
+	const stress_args_t *args,
+	const uint32_t n,
+	const char *value,
+	const size_t size,
+	int *spill)
+{
+	char filename[PATH_MAX];
+	struct stat statbuf;
+	uint32_t i;
+	int fd;
+
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return -1;
+	(void)shim_unlink(filename);
+
+	for (i = 0; i < n; i++) {
+		char name[32];
+
+		stress_xattr_bench_name(name, sizeof(name), i);
+		if (shim_fsetxattr(fd, name, value, size, XATTR_CREATE) < 0) {
+			(void)close(fd);
+			return -1;
+		}
+	}
+	if (spill) {
+		/* an empty file only has blocks if xattrs spilled out of the inode */
+		*spill = (fstat(fd, &statbuf) < 0) ? -1 : (statbuf.st_blocks > 0);
+	}
+	return fd;
+}
+
+/*
+ *  stress_xattr_bench_op()
+ *	perform one set, get or list operation on the i'th attribute
+ */
+static inline int stress_xattr_bench_op(
+	const int fd,
+	const int op,
+	const uint32_t i,
+	const char *value,
+	const size_t size,
+	char *buf)
+{
+	char name[32];
+
+	switch (op) {
+	case XATTR_BENCH_SET:
+		stress_xattr_bench_name(name, sizeof(name), i);
+		return shim_fsetxattr(fd, name, value, size, XATTR_REPLACE);
+	case XATTR_BENCH_GET:
+		stress_xattr_bench_name(name, sizeof(name), i);
+		return (shim_fgetxattr(fd, name, buf, XATTR_BENCH_VALUE_MAX) == (ssize_t)size) ? 0 : -1;
+	default:
+		return (shim_flistxattr(fd, buf, XATTR_BENCH_LIST_MAX) < 0) ? -1 : 0;
+	}
+}
+
+/*
+ *  stress_xattr_bench_rate()
+ *	K ops per second of op cycling over n attributes
+ */
+static double stress_xattr_bench_rate(
+	const stress_args_t *args,
+	const int fd,
+	const int op,
+	const uint32_t n,
+	const char *value,
+	const size_t size,
+	char *buf)
+{
+	double t, dt;
+	uint64_t ops = 0;
+
+	t = stress_time_now();
+	do {
+		if (stress_xattr_bench_op(fd, op, (uint32_t)(ops % n), value, size, buf) < 0)
+			return -1.0;
+		ops++;
+		dt = stress_time_now() - t;
+	} while (keep_stressing(args) && (dt < XATTR_BENCH_TIME));
+
+	return (dt > 0.0) ? (double)ops / dt / 1000.0 : -1.0;
+}
+
+/*
+ *  stress_xattr_bench_sweep()
+ *	measure set, get and list rates on a new file with n attributes
+ *	of size bytes
+ */
+static void stress_xattr_bench_sweep(
+	const stress_args_t *args,
+	const uint32_t n,
+	const char *value,
+	const size_t size,
+	char *buf,
+	double *rate,
+	int *spill)
+{
+	int fd, op;
+
+	for (op = 0; op < XATTR_BENCH_OPS; op++)
+		rate[op] = -1.0;
+	*spill = -1;
+	fd = stress_xattr_bench_file(args, n, value, size, spill);
+	if (fd < 0)
+		return;
+	for (op = 0; (op < XATTR_BENCH_OPS) && keep_stressing(args); op++)
+		rate[op] = stress_xattr_bench_rate(args, fd, op, n, value, size, buf);
+	(void)close(fd);
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_t pthread;
+	const stress_args_t *args;
+	const char *value;
+	int fd;
+	double rate;		/* K ops per second, < 0 on failure */
+} stress_xattr_bench_thread_t;
+
+/*
+ *  stress_xattr_bench_thread()
+ *	alternate attribute sets and gets for XATTR_BENCH_THREAD_TIME seconds
+ */
+static void *stress_xattr_bench_thread(void *arg)
+{
+	stress_xattr_bench_thread_t *t = (stress_xattr_bench_thread_t *)arg;
+	char buf[XATTR_BENCH_THREAD_SIZE];
+	const uint32_t offset = stress_mwc32();
+	double t_start, dt;
+	uint64_t ops = 0;
+
+	t->rate = -1.0;
+	t_start = stress_time_now();
+	do {
+		const uint32_t i = (uint32_t)((ops + offset) % XATTR_BENCH_THREAD_ATTRS);
+		char name[32];
+
+		stress_xattr_bench_name(name, sizeof(name), i);
+		if (ops & 1) {
+			if (shim_fgetxattr(t->fd, name, buf, sizeof(buf)) < 0)
+				return NULL;
+		} else {
+			if (shim_fsetxattr(t->fd, name, t->value,
+					XATTR_BENCH_THREAD_SIZE, XATTR_REPLACE) < 0)
+				return NULL;
+		}
+		ops++;
+		dt = stress_time_now() - t_start;
+	} while (keep_stressing(t->args) && (dt < XATTR_BENCH_THREAD_TIME));
+
+	if (dt > 0.0)
+		t->rate = (double)ops / dt / 1000.0;
+	return NULL;
+}
+
+/*
+ *  stress_xattr_bench_threads()
+ *	aggregate K ops per second of n threads setting and getting
+ *	attributes on the same inode or on an inode each
+ */
+static double stress_xattr_bench_threads(
+	const stress_args_t *args,
+	const uint32_t n,
+	const bool same,
+	const char *value)
+{
+	static stress_xattr_bench_thread_t threads[MAX_XATTR_THREADS];
+	double rate = 0.0;
+	uint32_t i, started;
+	bool ok = true;
+
+	for (i = 0; i < n; i++) {
+		threads[i].args = args;
+		threads[i].value = value;
+		threads[i].fd = -1;
+		if (same && (i > 0)) {
+			threads[i].fd = threads[0].fd;
+			continue;
+		}
+		threads[i].fd = stress_xattr_bench_file(args,
+			XATTR_BENCH_THREAD_ATTRS, value, XATTR_BENCH_THREAD_SIZE, NULL);
+		if (threads[i].fd < 0) {
+			ok = false;
+			break;
+		}
+	}
+	for (started = 0; ok && (started < n); started++) {
+		if (pthread_create(&threads[started].pthread, NULL,
+				stress_xattr_bench_thread, &threads[started]) != 0) {
+			ok = false;
+			break;
+		}
+	}
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		if (threads[i].rate < 0.0)
+			ok = false;
+		rate += threads[i].rate;
+	}
+	for (i = 0; i < n; i++) {
+		if (threads[i].fd < 0)
+			break;
+		if (!same || (i == 0))
+			(void)close(threads[i].fd);
+	}
+	return ok ? rate : -1.0;
+}
+#endif
+
+static void stress_xattr_bench_row(
+	const stress_args_t *args,
+	const char *label,
+	const int spill,
+	const double *rate)
+{
+	static const char * const spill_names[] = { "-", "no", "yes" };
+	char str[80];
+	int op;
+
+	(void)snprintf(str, sizeof(str), "%8s %9s", label, spill_names[spill + 1]);
+	for (op = 0; op < XATTR_BENCH_OPS; op++) {
+		const size_t len = strlen(str);
+
+		if (rate[op] < 0.0)
+			(void)snprintf(str + len, sizeof(str) - len, " %10s", "-");
+		else
+			(void)snprintf(str + len, sizeof(str) - len, " %10.1f", rate[op]);
+	}
+	pr_inf("%s: %s\n", args->name, str);
+}
+
+/*
+ *  stress_xattr_bench()
+ *	measure set, get and list rates against value size and against
+ *	attribute count per inode, then concurrent threads on the same
+ *	and on different inodes
+ */
+static int stress_xattr_bench(const stress_args_t *args)
+{
+	static stress_xattr_bench_t pass, res;
+	uint32_t xattr_threads = DEFAULT_XATTR_THREADS, t;
+	char *value, *buf, path[PATH_MAX];
+	size_t i, p;
+	int ret, fd;
+	bool done = false;
+
+	(void)stress_get_setting("xattr-threads", &xattr_threads);
+
+	value = (char *)calloc(1, XATTR_BENCH_VALUE_MAX);
+	buf = (char *)calloc(1, STRESS_MAXIMUM(XATTR_BENCH_VALUE_MAX, XATTR_BENCH_LIST_MAX));
+	if (!value || !buf) {
+		pr_inf_skip("%s: failed to allocate xattr buffers, skipping stressor\n",
+			args->name);
+		free(buf);
+		free(value);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memset(value, 'X', XATTR_BENCH_VALUE_MAX);
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(buf);
+		free(value);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_dir_args(args, path, sizeof(path));
+
+	/* check the file system supports user xattrs at all */
+	fd = stress_xattr_bench_file(args, 1, value, 1, NULL);
+	if (fd < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot set user xattrs, errno=%d (%s)%s, "
+				"skipping stressor\n", args->name, errno,
+				strerror(errno), stress_fs_type(path));
+		(void)stress_temp_dir_rm_args(args);
+		free(buf);
+		free(value);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)close(fd);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		(void)memset(&pass, 0, sizeof(pass));
+		for (i = 0; i < SIZEOF_ARRAY(xattr_bench_sizes); i++)
+			stress_xattr_bench_sweep(args, 1, value, xattr_bench_sizes[i],
+				buf, pass.size_rate[i], &pass.size_spill[i]);
+		for (i = 0; i < SIZEOF_ARRAY(xattr_bench_counts); i++)
+			stress_xattr_bench_sweep(args, xattr_bench_counts[i], value,
+				XATTR_BENCH_COUNT_SIZE, buf, pass.count_rate[i],
+				&pass.count_spill[i]);
+		for (t = 1; (t < xattr_threads) && (pass.n_points < XATTR_BENCH_MAX_POINTS - 1); t <<= 1)
+			pass.threads[pass.n_points++] = t;
+		pass.threads[pass.n_points++] = xattr_threads;
+		for (p = 0; p < pass.n_points; p++) {
+#if defined(HAVE_LIB_PTHREAD)
+			pass.thread_rate[p][XATTR_BENCH_SAME] = keep_stressing(args) ?
+				stress_xattr_bench_threads(args, pass.threads[p], true, value) : -1.0;
+			pass.thread_rate[p][XATTR_BENCH_DIFF] = keep_stressing(args) ?
+				stress_xattr_bench_threads(args, pass.threads[p], false, value) : -1.0;
+#else
+			pass.thread_rate[p][XATTR_BENCH_SAME] = -1.0;
+			pass.thread_rate[p][XATTR_BENCH_DIFF] = -1.0;
+#endif
+		}
+		if (!keep_stressing(args))
+			break;
+		(void)memcpy(&res, &pass, sizeof(res));
+		done = true;
+		inc_counter(args);
+	} while (keep_stressing(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (done && (args->instance == 0)) {
+		pr_inf("%s: xattr K ops/sec against value size, 1 attribute per inode%s\n",
+			args->name, stress_fs_type(path));
+		pr_inf("%s: %8s %9s %10s %10s %10s\n", args->name,
+			"size", "spilled", "set", "get", "list");
+		for (i = 0; i < SIZEOF_ARRAY(xattr_bench_sizes); i++) {
+			char sz[32];
+
+			if (xattr_bench_sizes[i] < KB)
+				(void)snprintf(sz, sizeof(sz), "%zuB", xattr_bench_sizes[i]);
+			else
+				(void)snprintf(sz, sizeof(sz), "%zuK", xattr_bench_sizes[i] >> 10);
+			stress_xattr_bench_row(args, sz, res.size_spill[i], res.size_rate[i]);
+		}
+		pr_inf("%s: xattr K ops/sec against attributes per inode, %d byte values\n",
+			args->name, XATTR_BENCH_COUNT_SIZE);
+		pr_inf("%s: %8s %9s %10s %10s %10s\n", args->name,
+			"attrs", "spilled", "set", "get", "list");
+		for (i = 0; i < SIZEOF_ARRAY(xattr_bench_counts); i++) {
+			char label[16];
+
+			(void)snprintf(label, sizeof(label), "%" PRIu32, xattr_bench_counts[i]);
+			stress_xattr_bench_row(args, label, res.count_spill[i], res.count_rate[i]);
+		}
+		pr_inf("%s: concurrent set/get K ops/sec, %d byte values, %d attributes per inode\n",
+			args->name, XATTR_BENCH_THREAD_SIZE, XATTR_BENCH_THREAD_ATTRS);
+		pr_inf("%s: %7s %12s %12s\n", args->name, "threads", "same inode", "diff inodes");
+		for (p = 0; p < res.n_points; p++) {
+			char same[16], diff[16];
+
+			(void)snprintf(same, sizeof(same), "%.1f", res.thread_rate[p][XATTR_BENCH_SAME]);
+			(void)snprintf(diff, sizeof(diff), "%.1f", res.thread_rate[p][XATTR_BENCH_DIFF]);
+			pr_inf("%s: %7" PRIu32 " %12s %12s\n", args->name, res.threads[p],
+				res.thread_rate[p][XATTR_BENCH_SAME] < 0.0 ? "-" : same,
+				res.thread_rate[p][XATTR_BENCH_DIFF] < 0.0 ? "-" : diff);
+		}
+	}
+	if (done) {
+		/* 64 byte values and 1K values, 1 attribute per inode */
+		for (i = 0; i < XATTR_BENCH_OPS; i++) {
+			static const char * const op_names[] = { "set", "get", "list" };
+			char str[32];
+
+			(void)snprintf(str, sizeof(str), "%s 64B K ops/sec", op_names[i]);
+			stress_misc_stats_set(args->misc_stats, (int)i, str,
+				STRESS_MAXIMUM(res.size_rate[1][i], 0.0));
+			(void)snprintf(str, sizeof(str), "%s 1K K ops/sec", op_names[i]);
+			stress_misc_stats_set(args->misc_stats, (int)i + XATTR_BENCH_OPS, str,
+				STRESS_MAXIMUM(res.size_rate[3][i], 0.0));
+		}
+		p = res.n_points - 1;
+		stress_misc_stats_set(args->misc_stats, 6, "same inode threads K ops/sec",
+			STRESS_MAXIMUM(res.thread_rate[p][XATTR_BENCH_SAME], 0.0));
+		stress_misc_stats_set(args->misc_stats, 7, "diff inode threads K ops/sec",
+			STRESS_MAXIMUM(res.thread_rate[p][XATTR_BENCH_DIFF], 0.0));
+	}
+
+	(void)stress_temp_dir_rm_args(args);
+	free(buf);
+	free(value);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_xattr
  *	stress the xattr operations
@@ -67,6 +527,11 @@ static int stress_xattr(const stress_args_t *args)
 #else
 	const size_t hugevalue_sz = 256 * KB;
 #endif
+	bool xattr_bench = false;
+
+	(void)stress_get_setting("xattr-bench", &xattr_bench);
+	if (xattr_bench)
+		return stress_xattr_bench(args);
 
 #if defined(XATTR_SIZE_MAX)
 	large_tmp = calloc(XATTR_SIZE_MAX + 2, sizeof(*large_tmp));
@@ -522,6 +987,7 @@ out_free:
 stressor_info_t stress_xattr_info = {
 	.stressor = stress_xattr,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -529,6 +995,7 @@ stressor_info_t stress_xattr_info = {
 stressor_info_t stress_xattr_info = {
 	.stressor = stress_not_implemented,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #endif
@@ -202,5 +202,7 @@ stressor_info_t stress_zero_info = {
 	.stressor = stress_zero,
 	.class = CLASS_DEV | CLASS_MEMORY | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.thread_safe = true,
+	.harness_adjust = true,
 	.help = help
 };
@@ -0,0 +1,731 @@
+/*
+ * Copyright (C)      2022 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-perf.h"
+
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MIN_ZEROCOPY_BYTES	(1 * MB)
+#define MAX_ZEROCOPY_BYTES	(1 * GB)
+#define DEFAULT_ZEROCOPY_BYTES	(16 * MB)
+
+#define ZEROCOPY_PIPE_SIZE	(1 * MB)	/* preferred pipe size */
+
+/* Data path methods, the receiver splices unless the method is copy */
+#define ZEROCOPY_SENDFILE	(0)	/* file -> sendfile -> socket */
+#define ZEROCOPY_SPLICE		(1)	/* file -> splice -> pipe -> splice -> socket */
+#define ZEROCOPY_COPY		(2)	/* file -> read/write -> socket baseline */
+#define ZEROCOPY_METHODS	(3)
+#define ZEROCOPY_ALL		(ZEROCOPY_METHODS)
+
+static const char * const zerocopy_methods[] = {
+	"sendfile", "splice", "copy", "all"
+};
+
+/* Sent by the sender at the start of each file transfer */
+typedef struct {
+	uint64_t method;	/* ZEROCOPY_* data path */
+	uint64_t bytes;		/* bytes to transfer */
+} stress_zerocopy_hdr_t;
+
+/* Sent back by the receiver once all the data has been written */
+typedef struct {
+	uint64_t cpu_ns;	/* receiver CPU time for the transfer */
+	uint64_t cycles;	/* receiver CPU cycles, 0 if not available */
+	int64_t err;		/* errno of a failed transfer, 0 if OK */
+} stress_zerocopy_ack_t;
+
+/* Per method end-to-end totals */
+typedef struct {
+	uint64_t passes;	/* completed file transfers */
+	uint64_t bytes;		/* bytes transferred */
+	double duration;	/* end-to-end transfer time */
+	double cpu_ns;		/* sender + receiver CPU time */
+	double cycles;		/* sender + receiver CPU cycles */
+	bool cycles_ok;		/* cycles were counted on both sides */
+} stress_zerocopy_stats_t;
+
+static const stress_help_t help[] = {
+	{ NULL,	"zerocopy N",		"start N workers copying a file over TCP loopback" },
+	{ NULL,	"zerocopy-bytes N",	"size of the file to transfer" },
+	{ NULL,	"zerocopy-method M",	"data path: sendfile, splice, copy or all" },
+	{ NULL,	"zerocopy-ops N",	"stop after N file transfers" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_zerocopy_bytes(const char *opt)
+{
+	uint64_t zerocopy_bytes;
+
+	zerocopy_bytes = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("zerocopy-bytes", zerocopy_bytes,
+		MIN_ZEROCOPY_BYTES, MAX_ZEROCOPY_BYTES);
+	return stress_set_setting("zerocopy-bytes", TYPE_ID_UINT64, &zerocopy_bytes);
+}
+
+static int stress_set_zerocopy_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(zerocopy_methods); i++) {
+		if (!strcmp(opt, zerocopy_methods[i]))
+			return stress_set_setting("zerocopy-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "invalid zerocopy-method '%s', allowed methods are:", opt);
+	for (i = 0; i < SIZEOF_ARRAY(zerocopy_methods); i++)
+		(void)fprintf(stderr, " %s", zerocopy_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_zerocopy_bytes,	stress_set_zerocopy_bytes },
+	{ OPT_zerocopy_method,	stress_set_zerocopy_method },
+	{ 0,			NULL }
+};
+
+#if defined(HAVE_SYS_SENDFILE_H) &&	\
+    defined(HAVE_SENDFILE) &&		\
+    defined(HAVE_SPLICE) &&		\
+    defined(SPLICE_F_MOVE)
+
+/*
+ *  stress_zerocopy_cpu_ns()
+ *	user + system CPU time of the calling process in ns
+ */
+static uint64_t stress_zerocopy_cpu_ns(void)
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0;
+	return (uint64_t)((stress_timeval_to_double(&usage.ru_utime) +
+			   stress_timeval_to_double(&usage.ru_stime)) * (double)STRESS_NANOSECOND);
+}
+
+/*
+ *  stress_zerocopy_cycles()
+ *	CPU cycles of the calling process, 0 if not available
+ */
+static uint64_t stress_zerocopy_cycles(const int fd)
+{
+#if defined(STRESS_PERF_STATS)
+	uint64_t cycles;
+
+	if ((fd >= 0) && (stress_perf_cycles_read(fd, &cycles) == 0))
+		return cycles;
+#else
+	(void)fd;
+#endif
+	return 0;
+}
+
+/*
+ *  stress_zerocopy_xfer()
+ *	read or write all of a small control message
+ */
+static int stress_zerocopy_xfer(const int fd, void *buf, const size_t len, const bool rd)
+{
+	uint8_t *ptr = (uint8_t *)buf;
+	size_t n = 0;
+
+	while (n < len) {
+		const ssize_t ret = rd ? read(fd, ptr + n, len - n) :
+					 write(fd, ptr + n, len - n);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			return -1;
+		n += (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_zerocopy_nodelay()
+ *	disable Nagle so the small control messages are not delayed
+ */
+static void stress_zerocopy_nodelay(const int sfd)
+{
+#if defined(TCP_NODELAY)
+	int one = 1;
+
+	(void)setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#else
+	(void)sfd;
+#endif
+}
+
+/*
+ *  stress_zerocopy_pipe()
+ *	create a pipe, try to enlarge it to reduce the splice count,
+ *	returns the pipe size or -1 on error
+ */
+static ssize_t stress_zerocopy_pipe(int fds[2])
+{
+	ssize_t size = 64 * KB;
+
+	if (pipe(fds) < 0)
+		return -1;
+#if defined(F_SETPIPE_SZ) &&	\
+    defined(F_GETPIPE_SZ)
+	{
+		int ret;
+
+		(void)fcntl(fds[1], F_SETPIPE_SZ, ZEROCOPY_PIPE_SIZE);
+		ret = fcntl(fds[1], F_GETPIPE_SZ);
+		if (ret > 0)
+			size = (ssize_t)ret;
+	}
+#endif
+	return size;
+}
+
+/*
+ *  stress_zerocopy_splice_out()
+ *	move n bytes from a pipe to fd
+ */
+static int stress_zerocopy_splice_out(
+	const int pipefd,
+	const int fd,
+	loff_t *off,
+	size_t n,
+	const unsigned int flags)
+{
+	while (n > 0) {
+		const ssize_t ret = splice(pipefd, NULL, fd, off, n, flags);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			return -1;
+		n -= (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_zerocopy_send()
+ *	send bytes of the file down the socket, returns 0 or errno
+ */
+static int stress_zerocopy_send(
+	const int method,
+	const int sfd,
+	const int fd,
+	const int pipefds[2],
+	const size_t chunk,
+	uint8_t *buf,
+	const uint64_t bytes)
+{
+	off_t off = 0;
+	loff_t loff = 0;
+
+	while ((uint64_t)off < bytes) {
+		const size_t len = (size_t)STRESS_MINIMUM((uint64_t)chunk, bytes - (uint64_t)off);
+		ssize_t ret;
+
+		switch (method) {
+		case ZEROCOPY_SENDFILE:
+			ret = sendfile(sfd, fd, &off, len);
+			break;
+		case ZEROCOPY_SPLICE:
+			ret = splice(fd, &loff, pipefds[1], NULL, len, SPLICE_F_MOVE);
+			if ((ret > 0) && (stress_zerocopy_splice_out(pipefds[0], sfd,
+					NULL, (size_t)ret, SPLICE_F_MOVE | SPLICE_F_MORE) < 0))
+				return errno;
+			if (ret > 0)
+				off = (off_t)loff;
+			break;
+		default:
+			ret = pread(fd, buf, len, off);
+			if ((ret > 0) && (stress_zerocopy_xfer(sfd, buf, (size_t)ret, false) < 0))
+				return errno;
+			if (ret > 0)
+				off += (off_t)ret;
+			break;
+		}
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (ret == 0)
+			return EIO;
+	}
+	return 0;
+}
+
+/*
+ *  stress_zerocopy_receive()
+ *	receive bytes from the socket into the file, returns 0 or errno
+ */
+static int stress_zerocopy_receive(
+	const int method,
+	const int sfd,
+	const int fd,
+	const int pipefds[2],
+	const size_t chunk,
+	uint8_t *buf,
+	const uint64_t bytes)
+{
+	loff_t off = 0;
+
+	while ((uint64_t)off < bytes) {
+		const size_t len = (size_t)STRESS_MINIMUM((uint64_t)chunk, bytes - (uint64_t)off);
+		ssize_t ret;
+
+		if (method == ZEROCOPY_COPY) {
+			ret = read(sfd, buf, len);
+			if ((ret > 0) && (pwrite(fd, buf, (size_t)ret, (off_t)off) != ret))
+				return errno ? errno : EIO;
+		} else {
+			ret = splice(sfd, NULL, pipefds[1], NULL, len, SPLICE_F_MOVE);
+			if ((ret > 0) && (stress_zerocopy_splice_out(pipefds[0], fd,
+					&off, (size_t)ret, SPLICE_F_MOVE) < 0))
+				return errno;
+		}
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (ret == 0)
+			return EPIPE;
+		if (method == ZEROCOPY_COPY)
+			off += (loff_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_zerocopy_receiver()
+ *	child process, accept the connection and write each
+ *	transfer into the destination file
+ */
+static int stress_zerocopy_receiver(
+	const int listenfd,
+	const int fd,
+	uint8_t *buf,
+	const size_t buf_size)
+{
+	int sfd, pipefds[2], cycles_fd = -1;
+	ssize_t chunk;
+
+	sfd = accept(listenfd, NULL, NULL);
+	(void)close(listenfd);
+	if (sfd < 0)
+		return EXIT_FAILURE;
+	stress_zerocopy_nodelay(sfd);
+	chunk = stress_zerocopy_pipe(pipefds);
+	if (chunk < 0) {
+		(void)close(sfd);
+		return EXIT_NO_RESOURCE;
+	}
+	chunk = STRESS_MINIMUM(chunk, (ssize_t)buf_size);
+#if defined(STRESS_PERF_STATS)
+	cycles_fd = stress_perf_cycles_open();
+#endif
+
+	for (;;) {
+		stress_zerocopy_hdr_t hdr;
+		stress_zerocopy_ack_t ack;
+		uint64_t cpu_ns, cycles;
+
+		if (stress_zerocopy_xfer(sfd, &hdr, sizeof(hdr), true) < 0)
+			break;
+		cpu_ns = stress_zerocopy_cpu_ns();
+		cycles = stress_zerocopy_cycles(cycles_fd);
+		ack.err = (int64_t)stress_zerocopy_receive((int)hdr.method, sfd, fd,
+			pipefds, (size_t)chunk, buf, hdr.bytes);
+		ack.cpu_ns = stress_zerocopy_cpu_ns() - cpu_ns;
+		ack.cycles = (cycles_fd >= 0) ? stress_zerocopy_cycles(cycles_fd) - cycles : 0;
+		if (stress_zerocopy_xfer(sfd, &ack, sizeof(ack), false) < 0)
+			break;
+	}
+
+	if (cycles_fd >= 0)
+		(void)close(cycles_fd);
+	(void)close(pipefds[0]);
+	(void)close(pipefds[1]);
+	(void)close(sfd);
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_zerocopy_verify()
+ *	check the destination file matches the source file
+ */
+static int stress_zerocopy_verify(
+	const stress_args_t *args,
+	const int fd_src,
+	const int fd_dst,
+	uint8_t *buf,
+	const size_t buf_size,
+	const uint64_t bytes,
+	const int method)
+{
+	const size_t half = buf_size / 2;
+	uint64_t off;
+
+	for (off = 0; off < bytes; off += half) {
+		const size_t len = (size_t)STRESS_MINIMUM((uint64_t)half, bytes - off);
+
+		if ((pread(fd_src, buf, len, (off_t)off) != (ssize_t)len) ||
+		    (pread(fd_dst, buf + half, len, (off_t)off) != (ssize_t)len) ||
+		    memcmp(buf, buf + half, len)) {
+			pr_fail("%s: %s transfer data mismatch at offset %" PRIu64 "\n",
+				args->name, zerocopy_methods[method], off);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_zerocopy_report()
+ *	report end-to-end throughput and CPU cost per byte of each method
+ */
+static void stress_zerocopy_report(
+	const stress_args_t *args,
+	const stress_zerocopy_stats_t *stats)
+{
+	const stress_zerocopy_stats_t *copy = &stats[ZEROCOPY_COPY];
+	const double copy_rate = ((copy->duration > 0.0) && copy->passes) ?
+		(double)copy->bytes / copy->duration : 0.0;
+	size_t i, idx = 0;
+
+	if (args->instance == 0)
+		pr_inf("%s: %-8s %8s %10s %12s %10s\n", args->name,
+			"method", "GB/s", "CPU ns/B", "cycles/B", "vs copy");
+
+	for (i = 0; i < ZEROCOPY_METHODS; i++) {
+		const stress_zerocopy_stats_t *s = &stats[i];
+		double rate, cpu_per_byte;
+		char cycles_str[16], ratio_str[16], desc[48];
+
+		if (!s->passes || (s->duration <= 0.0))
+			continue;
+
+		rate = (double)s->bytes / s->duration;
+		cpu_per_byte = s->cpu_ns / (double)s->bytes;
+		if (s->cycles_ok)
+			(void)snprintf(cycles_str, sizeof(cycles_str), "%.3f",
+				s->cycles / (double)s->bytes);
+		else
+			(void)shim_strlcpy(cycles_str, "n/a", sizeof(cycles_str));
+		if (copy_rate > 0.0)
+			(void)snprintf(ratio_str, sizeof(ratio_str), "%.2fx", rate / copy_rate);
+		else
+			(void)shim_strlcpy(ratio_str, "n/a", sizeof(ratio_str));
+
+		if (args->instance == 0)
+			pr_inf("%s: %-8s %8.3f %10.3f %12s %10s\n", args->name,
+				zerocopy_methods[i], rate / (double)GB, cpu_per_byte,
+				cycles_str, ratio_str);
+
+		(void)snprintf(desc, sizeof(desc), "%s GB per sec", zerocopy_methods[i]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, rate / (double)GB);
+		(void)snprintf(desc, sizeof(desc), "%s CPU ns per byte", zerocopy_methods[i]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, cpu_per_byte);
+		if (s->cycles_ok) {
+			(void)snprintf(desc, sizeof(desc), "%s cycles per byte", zerocopy_methods[i]);
+			stress_misc_stats_set(args->misc_stats, idx++, desc,
+				s->cycles / (double)s->bytes);
+		}
+	}
+}
+
+/*
+ *  stress_zerocopy_sender()
+ *	parent process, send the file for each method in turn
+ *	and account the end-to-end time and CPU cost
+ */
+static int stress_zerocopy_sender(
+	const stress_args_t *args,
+	const int sfd,
+	const int fd_src,
+	const int fd_dst,
+	uint8_t *buf,
+	const size_t buf_size,
+	const uint64_t bytes,
+	const size_t zerocopy_method)
+{
+	stress_zerocopy_stats_t stats[ZEROCOPY_METHODS];
+	int pipefds[2], cycles_fd = -1, rc = EXIT_SUCCESS;
+	uint64_t pass = 0;
+	ssize_t chunk;
+
+	(void)memset(stats, 0, sizeof(stats));
+	chunk = stress_zerocopy_pipe(pipefds);
+	if (chunk < 0) {
+		pr_inf_skip("%s: pipe failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	chunk = STRESS_MINIMUM(chunk, (ssize_t)buf_size);
+#if defined(STRESS_PERF_STATS)
+	cycles_fd = stress_perf_cycles_open();
+#endif
+
+	do {
+		const int method = (zerocopy_method == ZEROCOPY_ALL) ?
+			(int)(pass % ZEROCOPY_METHODS) : (int)zerocopy_method;
+		stress_zerocopy_stats_t *s = &stats[method];
+		stress_zerocopy_hdr_t hdr;
+		stress_zerocopy_ack_t ack;
+		uint64_t cpu_ns, cycles;
+		double t;
+		int err;
+
+		hdr.method = (uint64_t)method;
+		hdr.bytes = bytes;
+		t = stress_time_now();
+		cpu_ns = stress_zerocopy_cpu_ns();
+		cycles = stress_zerocopy_cycles(cycles_fd);
+		if (stress_zerocopy_xfer(sfd, &hdr, sizeof(hdr), false) < 0)
+			break;
+		err = stress_zerocopy_send(method, sfd, fd_src, pipefds,
+			(size_t)chunk, buf, bytes);
+		if (err) {
+			if (!keep_stressing_flag())
+				break;
+			pr_fail("%s: %s send failed, errno=%d (%s)\n",
+				args->name, zerocopy_methods[method], err, strerror(err));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (stress_zerocopy_xfer(sfd, &ack, sizeof(ack), true) < 0)
+			break;
+		t = stress_time_now() - t;
+		if (ack.err) {
+			pr_fail("%s: %s receive failed, errno=%d (%s)\n",
+				args->name, zerocopy_methods[method],
+				(int)ack.err, strerror((int)ack.err));
+			rc = EXIT_FAILURE;
+			break;
+		}
+
+		s->passes++;
+		s->bytes += bytes;
+		s->duration += t;
+		s->cpu_ns += (double)(stress_zerocopy_cpu_ns() - cpu_ns + ack.cpu_ns);
+		s->cycles_ok = (cycles_fd >= 0) && (ack.cycles > 0);
+		if (s->cycles_ok)
+			s->cycles += (double)(stress_zerocopy_cycles(cycles_fd) - cycles + ack.cycles);
+		pass++;
+		inc_counter(args);
+
+		if ((g_opt_flags & OPT_FLAGS_VERIFY) &&
+		    (stress_zerocopy_verify(args, fd_src, fd_dst, buf, buf_size, bytes, method) < 0)) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+	} while (keep_stressing(args));
+
+	if (rc == EXIT_SUCCESS)
+		stress_zerocopy_report(args, stats);
+
+	if (cycles_fd >= 0)
+		(void)close(cycles_fd);
+	(void)close(pipefds[0]);
+	(void)close(pipefds[1]);
+	return rc;
+}
+
+/*
+ *  stress_zerocopy_file()
+ *	open a temporary file, optionally filling it with random data
+ */
+static int stress_zerocopy_file(
+	const stress_args_t *args,
+	uint8_t *buf,
+	const size_t buf_size,
+	const uint64_t bytes,
+	const bool fill)
+{
+	char filename[PATH_MAX];
+	uint64_t off;
+	int fd;
+
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return -1;
+	}
+	(void)shim_unlink(filename);
+
+	for (off = 0; fill && (off < bytes); off += buf_size) {
+		const size_t len = (size_t)STRESS_MINIMUM((uint64_t)buf_size, bytes - off);
+
+		stress_mwc_fill(buf, len);
+		if (pwrite(fd, buf, len, (off_t)off) != (ssize_t)len) {
+			pr_inf_skip("%s: cannot write %" PRIu64 " byte file, errno=%d (%s), "
+				"skipping stressor\n", args->name, bytes, errno, strerror(errno));
+			(void)close(fd);
+			return -1;
+		}
+	}
+	return fd;
+}
+
+/*
+ *  stress_zerocopy
+ *	stress a zero copy file to TCP socket to file data path
+ */
+static int stress_zerocopy(const stress_args_t *args)
+{
+	uint64_t zerocopy_bytes = DEFAULT_ZEROCOPY_BYTES;
+	size_t zerocopy_method = ZEROCOPY_ALL;
+	const size_t buf_size = 2 * ZEROCOPY_PIPE_SIZE;
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	uint8_t *buf;
+	int ret, listenfd, sfd, fd_src = -1, fd_dst = -1, rc = EXIT_NO_RESOURCE;
+	pid_t pid;
+
+	if (!stress_get_setting("zerocopy-bytes", &zerocopy_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			zerocopy_bytes = MAX_ZEROCOPY_BYTES;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			zerocopy_bytes = MIN_ZEROCOPY_BYTES;
+	}
+	(void)stress_get_setting("zerocopy-method", &zerocopy_method);
+
+	if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0)
+		return EXIT_NO_RESOURCE;
+
+	buf = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte buffer, skipping stressor\n",
+			args->name, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto unmap;
+	}
+	fd_src = stress_zerocopy_file(args, buf, buf_size, zerocopy_bytes, true);
+	fd_dst = stress_zerocopy_file(args, buf, buf_size, zerocopy_bytes, false);
+	if ((fd_src < 0) || (fd_dst < 0))
+		goto close_files;
+
+	/* loopback listener on an ephemeral port */
+	listenfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listenfd < 0) {
+		pr_inf_skip("%s: socket failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		goto close_files;
+	}
+	(void)memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	if ((bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+	    (listen(listenfd, 1) < 0) ||
+	    (getsockname(listenfd, (struct sockaddr *)&addr, &addr_len) < 0)) {
+		pr_inf_skip("%s: cannot listen on a loopback port, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		(void)close(listenfd);
+		goto close_files;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(errno))
+			goto again;
+		(void)close(listenfd);
+		if (!keep_stressing(args)) {
+			rc = EXIT_SUCCESS;
+			goto close_files;
+		}
+		pr_err("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_files;
+	} else if (pid == 0) {
+		(void)close(fd_src);
+		rc = stress_zerocopy_receiver(listenfd, fd_dst, buf, buf_size);
+		_exit(rc);
+	}
+
+	(void)close(listenfd);
+	sfd = socket(AF_INET, SOCK_STREAM, 0);
+	if ((sfd < 0) || (connect(sfd, (struct sockaddr *)&addr, addr_len) < 0)) {
+		pr_fail("%s: connect to the receiver failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+	} else {
+		stress_zerocopy_nodelay(sfd);
+		rc = stress_zerocopy_sender(args, sfd, fd_src, fd_dst, buf,
+			buf_size, zerocopy_bytes, zerocopy_method);
+	}
+	if (sfd >= 0)
+		(void)close(sfd);
+	(void)kill(pid, SIGKILL);
+	(void)shim_waitpid(pid, &ret, 0);
+
+close_files:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (fd_dst >= 0)
+		(void)close(fd_dst);
+	if (fd_src >= 0)
+		(void)close(fd_src);
+	(void)stress_temp_dir_rm_args(args);
+unmap:
+	(void)munmap((void *)buf, buf_size);
+
+	return rc;
+}
+
+stressor_info_t stress_zerocopy_info = {
+	.stressor = stress_zerocopy,
+	.class = CLASS_NETWORK | CLASS_IO | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
+#else
+stressor_info_t stress_zerocopy_info = {
+	.stressor = stress_not_implemented,
+	.class = CLASS_NETWORK | CLASS_IO | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
+#endif
@@ -20,15 +20,18 @@
 #include "stress-ng.h"
 #include "core-cpu.h"
 #include "core-target-clones.h"
+#include "core-verify.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"zlib N",		"start N workers compressing data with zlib" },
+	{ NULL,	"zlib-codec C",		"compare codecs C, one of all, zlib, lz4 or zstd, over the data methods" },
 	{ NULL,	"zlib-level L",		"specify zlib compression level 0=fast, 9=best" },
 	{ NULL,	"zlib-mem-level L",	"specify zlib compression state memory usage 1=minimum, 9=maximum" },
 	{ NULL,	"zlib-method M",	"specify zlib random data generation method M" },
 	{ NULL,	"zlib-ops N",		"stop after N zlib bogo compression operations" },
 	{ NULL,	"zlib-strategy S",	"specify zlib strategy 0=default, 1=filtered, 2=huffman only, 3=rle, 4=fixed" },
 	{ NULL,	"zlib-stream-bytes S",	"specify the number of bytes to deflate until the current stream will be closed" },
+	{ NULL,	"zlib-threads N",	"compress and decompress 128K chunks in parallel with 1 to N threads" },
 	{ NULL,	"zlib-window-bits W",	"specify zlib window bits -8-(-15) | 8-15 | 24-31 | 40-47" },
 	{ NULL,	NULL,			NULL }
 };
@@ -37,9 +40,26 @@ static const stress_help_t help[] = {
 
 #include "zlib.h"
 
+#if defined(HAVE_LIB_LZ4)
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#if defined(HAVE_LIB_ZSTD)
+#include <zstd.h>
+#endif
+
 #define DATA_SIZE_64K 	(KB * 64)	/* Must be a multiple of 64 bytes */
 #define DATA_SIZE DATA_SIZE_64K
 
+#define MIN_ZLIB_THREADS	(1)
+#define MAX_ZLIB_THREADS	(64)
+#define ZLIB_CHUNK_SIZE		(KB * 128)	/* Must be a multiple of DATA_SIZE */
+#define ZLIB_MIN_CHUNKS		(16)
+#define ZLIB_MAX_COUNTS		(8)		/* 1, 2, 4 .. 64 and the maximum */
+#define ZLIB_CODEC_SIZE		(MB * 1)	/* Must be a multiple of DATA_SIZE */
+#define ZLIB_ZSTD_WINDOW_LOG	(27)		/* zstd long distance window */
+
 typedef void (*stress_zlib_rand_data_func)(const stress_args_t *args,
 	uint64_t *RESTRICT data, uint64_t *RESTRICT data_end);
 
@@ -243,17 +263,9 @@ static void stress_rand_data_binary(
 	uint64_t *RESTRICT data,
 	uint64_t *RESTRICT data_end)
 {
-	register uint32_t *ptr = (uint32_t *)data;
-	register const uint32_t *end = (uint32_t *)data_end;
-
 	(void)args;
 
-	while (ptr < end) {
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-	}
+	stress_mwc_fill(data, (size_t)((uint8_t *)data_end - (uint8_t *)data));
 }
 
 /*
@@ -416,10 +428,10 @@ static void TARGET_CLONES stress_rand_data_rarely_1(
 	(void)args;
 
 	while (ptr < end) {
-		*(ptr++) = 1 << (stress_mwc32() & 0x1f);
-		*(ptr++) = 1 << (stress_mwc32() & 0x1f);
-		*(ptr++) = 1 << (stress_mwc32() & 0x1f);
-		*(ptr++) = 1 << (stress_mwc32() & 0x1f);
+		*(ptr++) = 1U << (stress_mwc32() & 0x1f);
+		*(ptr++) = 1U << (stress_mwc32() & 0x1f);
+		*(ptr++) = 1U << (stress_mwc32() & 0x1f);
+		*(ptr++) = 1U << (stress_mwc32() & 0x1f);
 	}
 }
 
@@ -438,10 +450,10 @@ static void TARGET_CLONES stress_rand_data_rarely_0(
 	(void)args;
 
 	while (ptr < end) {
-		*(ptr++) = ~(1 << (stress_mwc32() & 0x1f));
-		*(ptr++) = ~(1 << (stress_mwc32() & 0x1f));
-		*(ptr++) = ~(1 << (stress_mwc32() & 0x1f));
-		*(ptr++) = ~(1 << (stress_mwc32() & 0x1f));
+		*(ptr++) = ~(1U << (stress_mwc32() & 0x1f));
+		*(ptr++) = ~(1U << (stress_mwc32() & 0x1f));
+		*(ptr++) = ~(1U << (stress_mwc32() & 0x1f));
+		*(ptr++) = ~(1U << (stress_mwc32() & 0x1f));
 	}
 }
 
@@ -510,12 +522,7 @@ static void stress_rand_data_rdrand(
 			*(ptr++) = rand64();
 		}
 	} else {
-		while (ptr < end) {
-			*(ptr++) = stress_mwc64();
-			*(ptr++) = stress_mwc64();
-			*(ptr++) = stress_mwc64();
-			*(ptr++) = stress_mwc64();
-		}
+		stress_mwc_fill(data, (size_t)((uint8_t *)data_end - (uint8_t *)data));
 	}
 }
 #endif
@@ -1202,6 +1209,213 @@ static void stress_zlib_random_test(
 	zlib_rand_data_methods[idx].func(args, data, data_end);
 }
 
+/*
+ *  Compression codecs, each entry is a codec at a specific level,
+ *  compress and decompress return the output size or 0 on failure
+ */
+typedef struct stress_zlib_codec {
+	const char *codec;	/* codec name, as selected by --zlib-codec */
+	const char *name;	/* codec and level */
+	const int level;	/* compression level */
+	const bool report;	/* report in the metrics */
+	size_t (*bound)(const size_t len);
+	size_t (*compress)(const struct stress_zlib_codec *codec,
+		const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_len);
+	size_t (*decompress)(const struct stress_zlib_codec *codec,
+		const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_len);
+} stress_zlib_codec_t;
+
+static size_t stress_zlib_codec_zlib_bound(const size_t len)
+{
+	return (size_t)compressBound((uLong)len);
+}
+
+static size_t stress_zlib_codec_zlib_compress(
+	const stress_zlib_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_len)
+{
+	uLongf len = (uLongf)dst_len;
+
+	if (compress2(dst, &len, src, (uLong)src_len, codec->level) != Z_OK)
+		return 0;
+	return (size_t)len;
+}
+
+static size_t stress_zlib_codec_zlib_decompress(
+	const stress_zlib_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_len)
+{
+	uLongf len = (uLongf)dst_len;
+
+	(void)codec;
+
+	if (uncompress(dst, &len, src, (uLong)src_len) != Z_OK)
+		return 0;
+	return (size_t)len;
+}
+
+#if defined(HAVE_LIB_LZ4)
+static size_t stress_zlib_codec_lz4_bound(const size_t len)
+{
+	return (size_t)LZ4_compressBound((int)len);
+}
+
+/*
+ *  stress_zlib_codec_lz4_compress()
+ *	levels > 1 use the high compression lz4hc compressor
+ */
+static size_t stress_zlib_codec_lz4_compress(
+	const stress_zlib_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_len)
+{
+	int len;
+
+	if (codec->level > 1)
+		len = LZ4_compress_HC((const char *)src, (char *)dst,
+			(int)src_len, (int)dst_len, codec->level);
+	else
+		len = LZ4_compress_fast((const char *)src, (char *)dst,
+			(int)src_len, (int)dst_len, 1);
+	return (len > 0) ? (size_t)len : 0;
+}
+
+static size_t stress_zlib_codec_lz4_decompress(
+	const stress_zlib_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_len)
+{
+	int len;
+
+	(void)codec;
+
+	len = LZ4_decompress_safe((const char *)src, (char *)dst, (int)src_len, (int)dst_len);
+	return (len > 0) ? (size_t)len : 0;
+}
+#endif
+
+#if defined(HAVE_LIB_ZSTD)
+static ZSTD_CCtx *zstd_cctx;
+static ZSTD_DCtx *zstd_dctx;
+
+static size_t stress_zlib_codec_zstd_bound(const size_t len)
+{
+	return ZSTD_compressBound(len);
+}
+
+/*
+ *  stress_zlib_codec_zstd_compress()
+ *	negative levels select long distance matching at the
+ *	absolute level with a ZLIB_ZSTD_WINDOW_LOG sized window
+ */
+static size_t stress_zlib_codec_zstd_compress(
+	const stress_zlib_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_len)
+{
+	const bool ldm = (codec->level < 0);
+	size_t len;
+
+	(void)ZSTD_CCtx_reset(zstd_cctx, ZSTD_reset_session_and_parameters);
+	(void)ZSTD_CCtx_setParameter(zstd_cctx, ZSTD_c_compressionLevel,
+		ldm ? -codec->level : codec->level);
+	if (ldm) {
+		(void)ZSTD_CCtx_setParameter(zstd_cctx, ZSTD_c_enableLongDistanceMatching, 1);
+		(void)ZSTD_CCtx_setParameter(zstd_cctx, ZSTD_c_windowLog, ZLIB_ZSTD_WINDOW_LOG);
+	}
+	len = ZSTD_compress2(zstd_cctx, dst, dst_len, src, src_len);
+	return ZSTD_isError(len) ? 0 : len;
+}
+
+static size_t stress_zlib_codec_zstd_decompress(
+	const stress_zlib_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_len)
+{
+	size_t len;
+
+	(void)codec;
+
+	len = ZSTD_decompressDCtx(zstd_dctx, dst, dst_len, src, src_len);
+	return ZSTD_isError(len) ? 0 : len;
+}
+#endif
+
+#define ZLIB_CODEC(codec, name, level, report)		\
+	{ #codec, name, level, report,		\
+	  stress_zlib_codec_ ## codec ## _bound,	\
+	  stress_zlib_codec_ ## codec ## _compress,	\
+	  stress_zlib_codec_ ## codec ## _decompress }
+
+static const stress_zlib_codec_t zlib_codecs[] = {
+	ZLIB_CODEC(zlib, "zlib-1", 1, false),
+	ZLIB_CODEC(zlib, "zlib-6", 6, true),
+	ZLIB_CODEC(zlib, "zlib-9", 9, false),
+#if defined(HAVE_LIB_LZ4)
+	ZLIB_CODEC(lz4, "lz4", 1, true),
+	ZLIB_CODEC(lz4, "lz4hc-9", 9, false),
+#endif
+#if defined(HAVE_LIB_ZSTD)
+	ZLIB_CODEC(zstd, "zstd-1", 1, false),
+	ZLIB_CODEC(zstd, "zstd-3", 3, true),
+	ZLIB_CODEC(zstd, "zstd-9", 9, false),
+	ZLIB_CODEC(zstd, "zstd-19", 19, false),
+	ZLIB_CODEC(zstd, "zstd-3-long", -3, false),
+#endif
+};
+
+static const char * const zlib_codec_names[] = {
+	"zlib",
+#if defined(HAVE_LIB_LZ4)
+	"lz4",
+#endif
+#if defined(HAVE_LIB_ZSTD)
+	"zstd",
+#endif
+};
+
+/*
+ *  stress_set_zlib_codec()
+ *	select the codecs to compare, 0 = all, otherwise index + 1
+ *	into zlib_codec_names
+ */
+static int stress_set_zlib_codec(const char *opt)
+{
+	size_t zlib_codec, i;
+
+	if (!strcmp(opt, "all")) {
+		zlib_codec = 0;
+		return stress_set_setting("zlib-codec", TYPE_ID_SIZE_T, &zlib_codec);
+	}
+	for (i = 0; i < SIZEOF_ARRAY(zlib_codec_names); i++) {
+		if (!strcmp(zlib_codec_names[i], opt)) {
+			zlib_codec = i + 1;
+			return stress_set_setting("zlib-codec", TYPE_ID_SIZE_T, &zlib_codec);
+		}
+	}
+
+	(void)fprintf(stderr, "zlib-codec must be one of: all");
+	for (i = 0; i < SIZEOF_ARRAY(zlib_codec_names); i++)
+		(void)fprintf(stderr, " %s", zlib_codec_names[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 /*
  *  stress_set_zlib_level
  *	set zlib compression level, 0..9,
@@ -1298,6 +1512,19 @@ static int stress_set_zlib_stream_bytes(const char *opt)
 	return stress_set_setting("zlib-stream-bytes", TYPE_ID_UINT64, &zlib_stream_bytes);
 }
 
+/*
+ *  stress_set_zlib_threads
+ *	use the parallel chunked compression mode with up to N threads
+ */
+static int stress_set_zlib_threads(const char *opt)
+{
+	uint32_t zlib_threads;
+
+	zlib_threads = stress_get_uint32(opt);
+	stress_check_range("zlib-threads", zlib_threads, MIN_ZLIB_THREADS, MAX_ZLIB_THREADS);
+	return stress_set_setting("zlib-threads", TYPE_ID_UINT32, &zlib_threads);
+}
+
 /*
  *  stress_set_zlib_strategy
  *	set the zlib compression strategy to be used for compression
@@ -1312,12 +1539,14 @@ static int stress_set_zlib_strategy(const char *opt)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_zlib_codec,		stress_set_zlib_codec },
 	{ OPT_zlib_level,		stress_set_zlib_level },
 	{ OPT_zlib_mem_level,		stress_set_zlib_mem_level },
 	{ OPT_zlib_method,		stress_set_zlib_method },
 	{ OPT_zlib_window_bits,		stress_set_zlib_window_bits },
 	{ OPT_zlib_stream_bytes,	stress_set_zlib_stream_bytes },
 	{ OPT_zlib_strategy,		stress_set_zlib_strategy },
+	{ OPT_zlib_threads,		stress_set_zlib_threads },
 	{ 0,				NULL }
 };
 
@@ -1683,6 +1912,537 @@ zlib_checksum_error:
 	return ret;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	double		in;		/* uncompressed bytes */
+	double		out;		/* compressed bytes */
+	double		compress;	/* compress duration */
+	double		decompress;	/* decompress duration */
+} stress_zlib_parallel_stats_t;
+
+/*
+ *  Parallel chunked compression state, each chunk is compressed
+ *  independently to a raw deflate block ending with a full flush,
+ *  the chunks are then reassembled in order into a single deflate
+ *  stream that can be inflated serially or chunk by chunk in parallel
+ */
+typedef struct stress_zlib_parallel {
+	const stress_zlib_args_t *zlib_args;
+	int		window_bits;	/* raw deflate window bits */
+	uint8_t		*in;		/* uncompressed data */
+	uint8_t		*out;		/* decompressed data */
+	uint8_t		*chunks;	/* compressed data, per chunk */
+	uint8_t		*stream;	/* chunks reassembled in order */
+	size_t		chunk_bound;	/* compressed chunk buffer size */
+	size_t		n_chunks;	/* number of chunks */
+	size_t		*chunk_len;	/* compressed size of each chunk */
+	size_t		*chunk_off;	/* offset of each chunk in the stream */
+	uint32_t	next;		/* next chunk to be processed */
+	int		err;		/* last zlib error, Z_OK if none */
+	bool (*func)(struct stress_zlib_parallel *zp, const size_t i);
+} stress_zlib_parallel_t;
+
+/*
+ *  stress_zlib_parallel_deflate()
+ *	compress chunk i, all but the last chunk end with a full flush
+ *	so the next chunk does not depend on it, the last chunk ends
+ *	the deflate stream
+ */
+static bool stress_zlib_parallel_deflate(stress_zlib_parallel_t *zp, const size_t i)
+{
+	const bool last = (i == zp->n_chunks - 1);
+	z_stream stream_def;
+	int ret;
+
+	(void)memset(&stream_def, 0, sizeof(stream_def));
+	ret = deflateInit2(&stream_def, (int)zp->zlib_args->level, Z_DEFLATED,
+		zp->window_bits, (int)zp->zlib_args->mem_level,
+		(int)zp->zlib_args->strategy);
+	if (ret != Z_OK) {
+		zp->err = ret;
+		return false;
+	}
+	stream_def.next_in = zp->in + (i * ZLIB_CHUNK_SIZE);
+	stream_def.avail_in = ZLIB_CHUNK_SIZE;
+	stream_def.next_out = zp->chunks + (i * zp->chunk_bound);
+	stream_def.avail_out = (unsigned int)zp->chunk_bound;
+
+	ret = deflate(&stream_def, last ? Z_FINISH : Z_FULL_FLUSH);
+	zp->chunk_len[i] = zp->chunk_bound - stream_def.avail_out;
+	(void)deflateEnd(&stream_def);
+
+	if ((ret != (last ? Z_STREAM_END : Z_OK)) || (stream_def.avail_in != 0)) {
+		zp->err = (ret == Z_OK) ? Z_BUF_ERROR : ret;
+		return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_zlib_parallel_inflate()
+ *	decompress chunk i from its offset in the reassembled stream
+ */
+static bool stress_zlib_parallel_inflate(stress_zlib_parallel_t *zp, const size_t i)
+{
+	z_stream stream_inf;
+	int ret;
+
+	(void)memset(&stream_inf, 0, sizeof(stream_inf));
+	ret = inflateInit2(&stream_inf, zp->window_bits);
+	if (ret != Z_OK) {
+		zp->err = ret;
+		return false;
+	}
+	stream_inf.next_in = zp->stream + zp->chunk_off[i];
+	stream_inf.avail_in = (unsigned int)zp->chunk_len[i];
+	stream_inf.next_out = zp->out + (i * ZLIB_CHUNK_SIZE);
+	stream_inf.avail_out = ZLIB_CHUNK_SIZE;
+
+	ret = inflate(&stream_inf, Z_SYNC_FLUSH);
+	(void)inflateEnd(&stream_inf);
+
+	if (((ret != Z_OK) && (ret != Z_STREAM_END)) || (stream_inf.avail_out != 0)) {
+		zp->err = (ret == Z_OK) ? Z_DATA_ERROR : ret;
+		return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_zlib_parallel_worker()
+ *	process chunks until there are none left
+ */
+static void *stress_zlib_parallel_worker(void *arg)
+{
+	static void *nowt = NULL;
+	stress_zlib_parallel_t *zp = (stress_zlib_parallel_t *)arg;
+
+	for (;;) {
+		const uint32_t i = __atomic_fetch_add(&zp->next, 1, __ATOMIC_RELAXED);
+
+		if (i >= zp->n_chunks)
+			break;
+		(void)zp->func(zp, (size_t)i);
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_zlib_parallel_run()
+ *	run func over all the chunks with a pool of n_threads threads,
+ *	the calling thread is one of them, threads that cannot be
+ *	created just leave more chunks for the others
+ */
+static bool stress_zlib_parallel_run(
+	stress_zlib_parallel_t *zp,
+	const uint32_t n_threads,
+	bool (*func)(stress_zlib_parallel_t *zp, const size_t i))
+{
+	pthread_t pthreads[MAX_ZLIB_THREADS];
+	int rets[MAX_ZLIB_THREADS];
+	uint32_t i;
+
+	zp->next = 0;
+	zp->err = Z_OK;
+	zp->func = func;
+	for (i = 1; i < n_threads; i++)
+		rets[i] = pthread_create(&pthreads[i], NULL, stress_zlib_parallel_worker, (void *)zp);
+	(void)stress_zlib_parallel_worker((void *)zp);
+	for (i = 1; i < n_threads; i++) {
+		if (rets[i] == 0)
+			(void)pthread_join(pthreads[i], NULL);
+	}
+	return zp->err == Z_OK;
+}
+
+/*
+ *  stress_zlib_parallel_verify()
+ *	inflate the whole reassembled stream serially, it must be a
+ *	single valid deflate stream of the original data
+ */
+static bool stress_zlib_parallel_verify(stress_zlib_parallel_t *zp, const size_t stream_len)
+{
+	const size_t size = zp->n_chunks * ZLIB_CHUNK_SIZE;
+	z_stream stream_inf;
+	int ret;
+
+	(void)memset(zp->out, 0, size);
+	(void)memset(&stream_inf, 0, sizeof(stream_inf));
+	if (inflateInit2(&stream_inf, zp->window_bits) != Z_OK)
+		return false;
+	stream_inf.next_in = zp->stream;
+	stream_inf.avail_in = (unsigned int)stream_len;
+	stream_inf.next_out = zp->out;
+	stream_inf.avail_out = (unsigned int)size;
+	ret = inflate(&stream_inf, Z_FINISH);
+	(void)inflateEnd(&stream_inf);
+
+	return (ret == Z_STREAM_END) && (stream_inf.avail_out == 0) &&
+	       (memcmp(zp->in, zp->out, size) == 0);
+}
+
+/*
+ *  stress_zlib_parallel()
+ *	pigz style parallel compression, the data is split into chunks
+ *	that are compressed by a pool of threads and reassembled in
+ *	order, the chunks are then decompressed in parallel. The thread
+ *	count is swept over 1, 2, 4 .. zlib_threads for each data method
+ */
+static int stress_zlib_parallel(const stress_args_t *args, const uint32_t zlib_threads)
+{
+	static stress_zlib_parallel_stats_t stats[SIZEOF_ARRAY(zlib_rand_data_methods)][ZLIB_MAX_COUNTS];
+	static stress_zlib_parallel_t zp;
+	const size_t n_methods = SIZEOF_ARRAY(zlib_rand_data_methods) - 1;
+	stress_zlib_args_t zlib_args;
+	const stress_zlib_rand_data_info_t *info;
+	uint32_t counts[ZLIB_MAX_COUNTS], n;
+	size_t n_counts = 0, i, c, size, buf_size, m, method, idx = 0;
+	z_stream stream_def;
+	int bits, ret = EXIT_SUCCESS;
+	uint8_t *buf;
+	double e1 = 0.0, c1 = 0.0, d1 = 0.0, en = 0.0, cn = 0.0, dn = 0.0, in = 0.0, out = 0.0;
+	bool lock = false;
+
+	(void)memset(&zlib_args, 0, sizeof(zlib_args));
+	(void)stress_zlib_get_args(&zlib_args);
+	info = (const stress_zlib_rand_data_info_t *)zlib_args.data_func;
+	method = (size_t)(info - zlib_rand_data_methods);
+
+	/* chunks are raw deflate data, use the window size of any format */
+	bits = (zlib_args.window_bits < 0) ? -zlib_args.window_bits : (zlib_args.window_bits & 15);
+	zp.window_bits = -((bits < 9) ? 9 : bits);
+	zp.zlib_args = &zlib_args;
+
+	/* 1, 2, 4 .. up to and including zlib_threads */
+	for (n = 1; (n < zlib_threads) && (n_counts < ZLIB_MAX_COUNTS - 1); n <<= 1)
+		counts[n_counts++] = n;
+	counts[n_counts++] = zlib_threads;
+
+	(void)memset(&stream_def, 0, sizeof(stream_def));
+	if (deflateInit2(&stream_def, (int)zlib_args.level, Z_DEFLATED, zp.window_bits,
+			 (int)zlib_args.mem_level, (int)zlib_args.strategy) != Z_OK) {
+		pr_fail("%s: zlib deflateInit error\n", args->name);
+		return EXIT_FAILURE;
+	}
+	/* deflateBound does not include the full flush marker */
+	zp.chunk_bound = (size_t)deflateBound(&stream_def, ZLIB_CHUNK_SIZE) + 64;
+	(void)deflateEnd(&stream_def);
+
+	zp.n_chunks = STRESS_MAXIMUM(ZLIB_MIN_CHUNKS, 4 * (size_t)zlib_threads);
+	size = zp.n_chunks * ZLIB_CHUNK_SIZE;
+	buf_size = (2 * size) + (2 * zp.n_chunks * zp.chunk_bound) +
+		   (2 * zp.n_chunks * sizeof(size_t));
+	buf = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for %zu chunks, skipping stressor\n",
+			args->name, buf_size, zp.n_chunks);
+		return EXIT_NO_RESOURCE;
+	}
+	zp.in = buf;
+	zp.out = zp.in + size;
+	zp.chunks = zp.out + size;
+	zp.stream = zp.chunks + (zp.n_chunks * zp.chunk_bound);
+	zp.chunk_len = (size_t *)(zp.stream + (zp.n_chunks * zp.chunk_bound));
+	zp.chunk_off = zp.chunk_len + zp.n_chunks;
+
+	if (args->instance == 0)
+		pr_dbg("%s: compressing %zu chunks of %zuK with up to %" PRIu32 " threads\n",
+			args->name, zp.n_chunks, (size_t)(ZLIB_CHUNK_SIZE / KB), zlib_threads);
+
+	(void)memset(stats, 0, sizeof(stats));
+	m = 0;
+	do {
+		const stress_zlib_rand_data_info_t *data_info;
+
+		/* the "random" method cycles through all the data methods */
+		if (method == 0) {
+			m = (m % (n_methods - 1)) + 1;
+		} else {
+			m = method;
+		}
+		data_info = &zlib_rand_data_methods[m];
+		for (i = 0; i < size; i += DATA_SIZE)
+			data_info->func(args, (uint64_t *)(zp.in + i), (uint64_t *)(zp.in + i + DATA_SIZE));
+
+		for (c = 0; keep_stressing(args) && (c < n_counts); c++) {
+			stress_zlib_parallel_stats_t *st = &stats[m][c];
+			size_t stream_len = 0;
+			double t;
+
+			t = stress_time_now();
+			if (!stress_zlib_parallel_run(&zp, counts[c], stress_zlib_parallel_deflate)) {
+				pr_fail("%s: zlib deflate of %s data chunk failed: %s\n",
+					args->name, data_info->name, stress_zlib_err(zp.err));
+				ret = EXIT_FAILURE;
+				goto finish;
+			}
+			/* ordered reassembly */
+			for (i = 0; i < zp.n_chunks; i++) {
+				zp.chunk_off[i] = stream_len;
+				(void)memcpy(zp.stream + stream_len,
+					zp.chunks + (i * zp.chunk_bound), zp.chunk_len[i]);
+				stream_len += zp.chunk_len[i];
+			}
+			st->compress += stress_time_now() - t;
+
+			t = stress_time_now();
+			if (!stress_zlib_parallel_run(&zp, counts[c], stress_zlib_parallel_inflate)) {
+				pr_fail("%s: zlib inflate of %s data chunk failed: %s\n",
+					args->name, data_info->name, stress_zlib_err(zp.err));
+				ret = EXIT_FAILURE;
+				goto finish;
+			}
+			st->decompress += stress_time_now() - t;
+			st->in += (double)size;
+			st->out += (double)stream_len;
+
+			if (stress_verify_sample()) {
+				if (memcmp(zp.in, zp.out, size)) {
+					pr_fail("%s: zlib parallel inflate of %s data with %" PRIu32
+						" threads does not match the original data\n",
+						args->name, data_info->name, counts[c]);
+					ret = EXIT_FAILURE;
+				} else if (!stress_zlib_parallel_verify(&zp, stream_len)) {
+					pr_fail("%s: zlib reassembled stream of %s data with %" PRIu32
+						" threads does not inflate to the original data\n",
+						args->name, data_info->name, counts[c]);
+					ret = EXIT_FAILURE;
+				}
+			}
+			inc_counter(args);
+		}
+	} while (keep_stressing(args));
+
+finish:
+	if (args->instance == 0) {
+		pr_lock(&lock);
+		pr_inf_lock(&lock, "%s: %-12s %7s %12s %12s %7s %9s %9s\n",
+			args->name, "method", "threads", "comp MB/s", "decomp MB/s",
+			"ratio", "comp eff", "decomp eff");
+	}
+	for (m = 1; m < n_methods; m++) {
+		const stress_zlib_parallel_stats_t *s1 = &stats[m][0];
+
+		for (c = 0; c < n_counts; c++) {
+			const stress_zlib_parallel_stats_t *st = &stats[m][c];
+			double comp, decomp, comp1, decomp1;
+
+			if ((st->compress <= 0.0) || (st->decompress <= 0.0))
+				continue;
+			comp = (st->in / st->compress) / MB;
+			decomp = (st->in / st->decompress) / MB;
+			comp1 = (s1->compress > 0.0) ? (s1->in / s1->compress) / MB : 0.0;
+			decomp1 = (s1->decompress > 0.0) ? (s1->in / s1->decompress) / MB : 0.0;
+			if (args->instance == 0)
+				pr_inf_lock(&lock, "%s: %-12s %7" PRIu32 " %12.2f %12.2f %6.2f%% %8.1f%% %8.1f%%\n",
+					args->name, zlib_rand_data_methods[m].name, counts[c],
+					comp, decomp, 100.0 * st->out / st->in,
+					(comp1 > 0.0) ? 100.0 * comp / (comp1 * counts[c]) : 0.0,
+					(decomp1 > 0.0) ? 100.0 * decomp / (decomp1 * counts[c]) : 0.0);
+			in += st->in;
+			out += st->out;
+		}
+		/* only compare methods that completed the full thread sweep */
+		if (stats[m][n_counts - 1].decompress <= 0.0)
+			continue;
+		e1 += s1->in;
+		c1 += s1->compress;
+		d1 += s1->decompress;
+		en += stats[m][n_counts - 1].in;
+		cn += stats[m][n_counts - 1].compress;
+		dn += stats[m][n_counts - 1].decompress;
+	}
+	if (args->instance == 0)
+		pr_unlock(&lock);
+
+	if ((cn > 0.0) && (dn > 0.0)) {
+		char desc[40];
+		const double last = (double)counts[n_counts - 1];
+
+		(void)snprintf(desc, sizeof(desc), "compress MB/sec, %" PRIu32 " threads", counts[n_counts - 1]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, (en / cn) / MB);
+		(void)snprintf(desc, sizeof(desc), "decompress MB/sec, %" PRIu32 " threads", counts[n_counts - 1]);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, (en / dn) / MB);
+		stress_misc_stats_set(args->misc_stats, idx++, "compression ratio %", 100.0 * out / in);
+		if ((c1 > 0.0) && (d1 > 0.0)) {
+			stress_misc_stats_set(args->misc_stats, idx++, "compress scaling %",
+				100.0 * (en / cn) / ((e1 / c1) * last));
+			stress_misc_stats_set(args->misc_stats, idx++, "decompress scaling %",
+				100.0 * (en / dn) / ((e1 / d1) * last));
+		}
+	}
+
+	(void)munmap((void *)buf, buf_size);
+
+	return ret;
+}
+#endif
+
+typedef struct {
+	double		in;		/* uncompressed bytes */
+	double		out;		/* compressed bytes */
+	double		compress;	/* compress duration */
+	double		decompress;	/* decompress duration */
+} stress_zlib_codec_stats_t;
+
+/*
+ *  stress_zlib_codecs()
+ *	compress and decompress the data of each data method with
+ *	each selected codec and level, measuring the ratio and
+ *	the compress and decompress rates
+ */
+static int stress_zlib_codecs(const stress_args_t *args, const size_t zlib_codec)
+{
+	static stress_zlib_codec_stats_t stats[SIZEOF_ARRAY(zlib_rand_data_methods)][SIZEOF_ARRAY(zlib_codecs)];
+	const size_t n_methods = SIZEOF_ARRAY(zlib_rand_data_methods) - 1;
+	const char *codec_name = zlib_codec ? zlib_codec_names[zlib_codec - 1] : NULL;
+	const stress_zlib_rand_data_info_t *info;
+	size_t m, method, i, j, buf_size, bound = 0, idx = 0;
+	uint8_t *buf, *in, *out, *cbuf;
+	int ret = EXIT_SUCCESS;
+	bool lock = false;
+
+	(void)stress_get_setting("zlib-method", &info);
+	method = (size_t)(info - zlib_rand_data_methods);
+
+	for (i = 0; i < SIZEOF_ARRAY(zlib_codecs); i++) {
+		const size_t b = zlib_codecs[i].bound(ZLIB_CODEC_SIZE);
+
+		bound = STRESS_MAXIMUM(bound, b);
+	}
+	buf_size = (2 * ZLIB_CODEC_SIZE) + bound;
+	buf = (uint8_t *)mmap(NULL, buf_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for the codec buffers, skipping stressor\n",
+			args->name, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	in = buf;
+	out = in + ZLIB_CODEC_SIZE;
+	cbuf = out + ZLIB_CODEC_SIZE;
+
+#if defined(HAVE_LIB_ZSTD)
+	zstd_cctx = ZSTD_createCCtx();
+	zstd_dctx = ZSTD_createDCtx();
+	if (!zstd_cctx || !zstd_dctx) {
+		pr_inf_skip("%s: cannot create zstd contexts, skipping stressor\n", args->name);
+		ret = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	(void)ZSTD_DCtx_setParameter(zstd_dctx, ZSTD_d_windowLogMax, ZLIB_ZSTD_WINDOW_LOG);
+#endif
+
+	(void)memset(stats, 0, sizeof(stats));
+	m = 0;
+	do {
+		const stress_zlib_rand_data_info_t *data_info;
+
+		/* the "random" method cycles through all the data methods */
+		if (method == 0) {
+			m = (m % (n_methods - 1)) + 1;
+		} else {
+			m = method;
+		}
+		data_info = &zlib_rand_data_methods[m];
+		for (i = 0; i < ZLIB_CODEC_SIZE; i += DATA_SIZE)
+			data_info->func(args, (uint64_t *)(in + i), (uint64_t *)(in + i + DATA_SIZE));
+
+		for (j = 0; keep_stressing(args) && (j < SIZEOF_ARRAY(zlib_codecs)); j++) {
+			const stress_zlib_codec_t *codec = &zlib_codecs[j];
+			stress_zlib_codec_stats_t *st = &stats[m][j];
+			size_t clen, dlen;
+			double t1, t2, t3;
+
+			if (codec_name && strcmp(codec_name, codec->codec))
+				continue;
+
+			t1 = stress_time_now();
+			clen = codec->compress(codec, in, ZLIB_CODEC_SIZE, cbuf, bound);
+			t2 = stress_time_now();
+			if (!clen) {
+				pr_fail("%s: %s compression of %s data failed\n",
+					args->name, codec->name, data_info->name);
+				ret = EXIT_FAILURE;
+				goto tidy;
+			}
+			dlen = codec->decompress(codec, cbuf, clen, out, ZLIB_CODEC_SIZE);
+			t3 = stress_time_now();
+			if (dlen != ZLIB_CODEC_SIZE) {
+				pr_fail("%s: %s decompression of %s data failed, got %zu bytes, expected %zu\n",
+					args->name, codec->name, data_info->name, dlen, (size_t)ZLIB_CODEC_SIZE);
+				ret = EXIT_FAILURE;
+				goto tidy;
+			}
+			if (stress_verify_sample() && memcmp(in, out, ZLIB_CODEC_SIZE)) {
+				pr_fail("%s: %s decompressed %s data does not match the original data\n",
+					args->name, codec->name, data_info->name);
+				ret = EXIT_FAILURE;
+			}
+			st->in += (double)ZLIB_CODEC_SIZE;
+			st->out += (double)clen;
+			st->compress += t2 - t1;
+			st->decompress += t3 - t2;
+			inc_counter(args);
+		}
+	} while (keep_stressing(args));
+
+tidy:
+	if (args->instance == 0) {
+		pr_lock(&lock);
+		pr_inf_lock(&lock, "%s: %-12s %-12s %7s %12s %12s\n",
+			args->name, "method", "codec", "ratio", "comp MB/s", "decomp MB/s");
+		for (m = 1; m < n_methods; m++) {
+			for (j = 0; j < SIZEOF_ARRAY(zlib_codecs); j++) {
+				const stress_zlib_codec_stats_t *st = &stats[m][j];
+
+				if ((st->compress <= 0.0) || (st->decompress <= 0.0))
+					continue;
+				pr_inf_lock(&lock, "%s: %-12s %-12s %6.2f%% %12.2f %12.2f\n",
+					args->name, zlib_rand_data_methods[m].name,
+					zlib_codecs[j].name, 100.0 * st->out / st->in,
+					(st->in / st->compress) / MB, (st->in / st->decompress) / MB);
+			}
+		}
+		pr_unlock(&lock);
+	}
+
+	/* ratio and rates over all the data methods for the default level of each codec */
+	for (j = 0; j < SIZEOF_ARRAY(zlib_codecs); j++) {
+		stress_zlib_codec_stats_t total;
+		char desc[40];
+
+		if (!zlib_codecs[j].report)
+			continue;
+		(void)memset(&total, 0, sizeof(total));
+		for (m = 1; m < n_methods; m++) {
+			total.in += stats[m][j].in;
+			total.out += stats[m][j].out;
+			total.compress += stats[m][j].compress;
+			total.decompress += stats[m][j].decompress;
+		}
+		if ((total.compress <= 0.0) || (total.decompress <= 0.0))
+			continue;
+		(void)snprintf(desc, sizeof(desc), "%s compression ratio %%", zlib_codecs[j].name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, 100.0 * total.out / total.in);
+		(void)snprintf(desc, sizeof(desc), "%s compress MB/sec", zlib_codecs[j].name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, (total.in / total.compress) / MB);
+		(void)snprintf(desc, sizeof(desc), "%s decompress MB/sec", zlib_codecs[j].name);
+		stress_misc_stats_set(args->misc_stats, idx++, desc, (total.in / total.decompress) / MB);
+	}
+
+#if defined(HAVE_LIB_ZSTD)
+	if (zstd_cctx)
+		(void)ZSTD_freeCCtx(zstd_cctx);
+	if (zstd_dctx)
+		(void)ZSTD_freeDCtx(zstd_dctx);
+#endif
+	(void)munmap((void *)buf, buf_size);
+
+	return ret;
+}
+
 /*
  *  stress_zlib()
  *	stress cpu with compression and decompression
@@ -1698,6 +2458,28 @@ static int stress_zlib(const stress_args_t *args)
 	bool bad_zlib_checksum_reads = false;
 	bool error = false;
 	bool interrupted = false;
+	uint32_t zlib_threads = 0;
+	size_t zlib_codec = 0;
+
+	if (stress_get_setting("zlib-codec", &zlib_codec)) {
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		ret = stress_zlib_codecs(args, zlib_codec);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return ret;
+	}
+
+	if (stress_get_setting("zlib-threads", &zlib_threads)) {
+#if defined(HAVE_LIB_PTHREAD)
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		ret = stress_zlib_parallel(args, zlib_threads);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return ret;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: pthreads not supported, ignoring the --zlib-threads option\n",
+				args->name);
+#endif
+	}
 
 	(void)memset(&deflate_zlib_checksum, 0, sizeof(deflate_zlib_checksum));
 	(void)memset(&inflate_zlib_checksum, 0, sizeof(inflate_zlib_checksum));
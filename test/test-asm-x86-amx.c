@@ -0,0 +1,37 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__x86_64)
+int main(void)
+{
+	static uint8_t cfg[64] __attribute__((aligned(64)));
+	static int8_t buf[1024] __attribute__((aligned(64)));
+
+	__asm__ __volatile__("ldtilecfg %0\n" :: "m"(cfg));
+	__asm__ __volatile__("tileloadd (%0,%1,1), %%tmm1\n" :: "r"(buf), "r"((uint64_t)64));
+	__asm__ __volatile__("tdpbssd %%tmm2, %%tmm1, %%tmm0\n" : :);
+	__asm__ __volatile__("tilestored %%tmm0, (%0,%1,1)\n" :: "r"(buf), "r"((uint64_t)64) : "memory");
+	__asm__ __volatile__("tilerelease\n" : :);
+
+	return 0;
+}
+#else
+#error not an x86 so no amx instructions
+#endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__x86_64)
+typedef long long int v2di __attribute__((vector_size(16)));
+typedef int v4si __attribute__((vector_size(16)));
+
+static v2di __attribute__((target("aes,pclmul,sse4.1"))) enc(v2di x, v2di k)
+{
+	const v4si zero = { 0, 0, 0, 0 };
+	v2di a;
+
+	a = __builtin_ia32_aeskeygenassist128(k, 0x01);
+	a = (v2di)__builtin_shuffle((v4si)a, zero, (v4si){ 3, 3, 3, 3 });
+	x = __builtin_ia32_aesenc128(x, a);
+	x = __builtin_ia32_aesenclast128(x, k);
+
+	return __builtin_ia32_pclmulqdq128(x, k, 0x11);
+}
+
+int main(int argc, char **argv)
+{
+	v2di x = { argc, argc };
+
+	(void)argv;
+
+	x = enc(x, x);
+
+	return (int)x[0];
+}
+#else
+#error not a 64 bit x86 so no aes-ni builtins
+#endif
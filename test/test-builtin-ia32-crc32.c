@@ -0,0 +1,36 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__x86_64)
+static uint32_t __attribute__((target("sse4.2"))) crc(uint32_t c, uint64_t v)
+{
+	return (uint32_t)__builtin_ia32_crc32qi(
+		(uint32_t)__builtin_ia32_crc32di((uint64_t)c, v), (uint8_t)v);
+}
+
+int main(int argc, char **argv)
+{
+	(void)argv;
+
+	return (int)crc(~0U, (uint64_t)argc);
+}
+#else
+#error not a 64 bit x86 so no crc32 builtins
+#endif
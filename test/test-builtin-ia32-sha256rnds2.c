@@ -0,0 +1,45 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__x86_64)
+typedef int v4si __attribute__((vector_size(16)));
+
+static v4si __attribute__((target("sha,sse4.1"))) rounds(v4si a, v4si b, v4si m)
+{
+	m = __builtin_ia32_sha256msg1(m, a);
+	m = __builtin_ia32_sha256msg2(m, b);
+	a = __builtin_ia32_sha256rnds2(a, b, m);
+
+	return __builtin_shuffle(a, b, (v4si){ 0, 1, 6, 7 });
+}
+
+int main(int argc, char **argv)
+{
+	v4si x = { argc, argc, argc, argc };
+
+	(void)argv;
+
+	x = rounds(x, x, x);
+
+	return x[0];
+}
+#else
+#error not a 64 bit x86 so no sha builtins
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <lz4.h>
+#include <lz4hc.h>
+
+int main(void)
+{
+	static const char src[] = "test123test123test123";
+	char dst[LZ4_COMPRESSBOUND(sizeof(src))], out[sizeof(src)];
+	int n;
+
+	n = LZ4_compress_fast(src, dst, (int)sizeof(src), (int)sizeof(dst), 1);
+	n = LZ4_compress_HC(src, dst, (int)sizeof(src), (int)sizeof(dst), LZ4HC_CLEVEL_DEFAULT);
+	n = LZ4_decompress_safe(dst, out, n, (int)sizeof(out));
+
+	return n;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C)      2022 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <zstd.h>
+
+int main(void)
+{
+	static const char src[] = "test123test123test123";
+	char dst[ZSTD_COMPRESSBOUND(sizeof(src))], out[sizeof(src)];
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+	ZSTD_DCtx *dctx = ZSTD_createDCtx();
+	size_t n;
+
+	(void)ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, 3);
+	(void)ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1);
+	n = ZSTD_compress2(cctx, dst, sizeof(dst), src, sizeof(src));
+	(void)ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, 27);
+	n = ZSTD_decompressDCtx(dctx, out, sizeof(out), dst, n);
+	(void)ZSTD_freeCCtx(cctx);
+	(void)ZSTD_freeDCtx(dctx);
+
+	return ZSTD_isError(n);
+}